@@ -0,0 +1,352 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/audio/audio_capturer_pulse.h"
+
+#include "base/logging.h"
+#include "base/system_time.h"
+#include "base/audio/linux/pulseaudio_symbol_table.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+const uint32_t kSampleRate = 48000;
+const uint8_t kChannels = 2;
+const size_t kBytesPerSample = sizeof(int16_t);
+
+// A packet holds 10 ms of audio. It matches the Opus frame duration the client requests by
+// default, so the encoder does not have to wait for the data.
+const size_t kPacketFrames = kSampleRate / 100;
+const size_t kPacketSize = kPacketFrames * kChannels * kBytesPerSample;
+
+// Tolerance for catching packets of silence. See audio_capturer_win.cc.
+const int kSilenceThreshold = 2;
+
+} // namespace
+
+AudioCapturerPulse::AudioCapturerPulse()
+    : silence_detector_(kSilenceThreshold)
+{
+    silence_detector_.reset(kSampleRate, kChannels);
+}
+
+AudioCapturerPulse::~AudioCapturerPulse()
+{
+    terminate();
+}
+
+bool AudioCapturerPulse::start(const PacketCapturedCallback& callback)
+{
+    DCHECK(callback);
+    DCHECK(!pa_main_loop_);
+
+    callback_ = callback;
+
+    if (!initPulseAudio() || !initRecording())
+    {
+        terminate();
+        return false;
+    }
+
+    LOG(LS_INFO) << "Audio capture started (source: " << monitor_source_ << ")";
+    return true;
+}
+
+// static
+void AudioCapturerPulse::paContextStateCallback(pa_context* /* c */, void* self)
+{
+    AudioCapturerPulse* capturer = static_cast<AudioCapturerPulse*>(self);
+    LATE(pa_threaded_mainloop_signal)(capturer->pa_main_loop_, 0);
+}
+
+// static
+void AudioCapturerPulse::paServerInfoCallback(
+    pa_context* /* c */, const pa_server_info* i, void* self)
+{
+    static_cast<AudioCapturerPulse*>(self)->paServerInfoCallbackHandler(i);
+}
+
+// static
+void AudioCapturerPulse::paStreamStateCallback(pa_stream* /* p */, void* self)
+{
+    AudioCapturerPulse* capturer = static_cast<AudioCapturerPulse*>(self);
+    LATE(pa_threaded_mainloop_signal)(capturer->pa_main_loop_, 0);
+}
+
+// static
+void AudioCapturerPulse::paStreamReadCallback(pa_stream* /* p */, size_t /* nbytes */, void* self)
+{
+    static_cast<AudioCapturerPulse*>(self)->paStreamReadCallbackHandler();
+}
+
+void AudioCapturerPulse::paServerInfoCallbackHandler(const pa_server_info* i)
+{
+    // The monitor source of a sink gets everything that is played through the sink.
+    if (i && i->default_sink_name)
+        monitor_source_ = std::string(i->default_sink_name) + ".monitor";
+
+    LATE(pa_threaded_mainloop_signal)(pa_main_loop_, 0);
+}
+
+void AudioCapturerPulse::paStreamReadCallbackHandler()
+{
+    while (LATE(pa_stream_readable_size)(record_stream_) > 0)
+    {
+        const void* data = nullptr;
+        size_t size = 0;
+
+        if (LATE(pa_stream_peek)(record_stream_, &data, &size) != PA_OK)
+        {
+            LOG(LS_ERROR) << "pa_stream_peek failed: " << LATE(pa_context_errno)(pa_context_);
+            return;
+        }
+
+        // The buffer is empty.
+        if (!size)
+            return;
+
+        // The data is copied from the PulseAudio buffer directly into the packet. If the data is
+        // null, there is a hole in the stream and we fill it with silence.
+        appendData(static_cast<const char*>(data), size);
+
+        LATE(pa_stream_drop)(record_stream_);
+    }
+}
+
+bool AudioCapturerPulse::initPulseAudio()
+{
+    if (!pulseSymbolTable()->load())
+    {
+        LOG(LS_ERROR) << "Failed to load symbol table";
+        return false;
+    }
+
+    pa_main_loop_ = LATE(pa_threaded_mainloop_new)();
+    if (!pa_main_loop_)
+    {
+        LOG(LS_ERROR) << "Could not create mainloop";
+        return false;
+    }
+
+    int ret = LATE(pa_threaded_mainloop_start)(pa_main_loop_);
+    if (ret != PA_OK)
+    {
+        LOG(LS_ERROR) << "Failed to start main loop: " << ret;
+        return false;
+    }
+
+    ScopedPaLock pa_lock(pa_main_loop_);
+
+    pa_context_ = LATE(pa_context_new)(
+        LATE(pa_threaded_mainloop_get_api)(pa_main_loop_), "Aspia Host");
+    if (!pa_context_)
+    {
+        LOG(LS_ERROR) << "Could not create context";
+        return false;
+    }
+
+    LATE(pa_context_set_state_callback)(pa_context_, paContextStateCallback, this);
+
+    ret = LATE(pa_context_connect)(pa_context_, nullptr, PA_CONTEXT_NOAUTOSPAWN, nullptr);
+    if (ret != PA_OK)
+    {
+        LOG(LS_ERROR) << "Failed to connect context: " << ret;
+        return false;
+    }
+
+    while (true)
+    {
+        pa_context_state_t state = LATE(pa_context_get_state)(pa_context_);
+        if (state == PA_CONTEXT_READY)
+            break;
+
+        if (!PA_CONTEXT_IS_GOOD(state))
+        {
+            LOG(LS_ERROR) << "Failed to connect to PulseAudio sound server: " << state;
+            return false;
+        }
+
+        LATE(pa_threaded_mainloop_wait)(pa_main_loop_);
+    }
+
+    pa_operation* op = LATE(pa_context_get_server_info)(pa_context_, paServerInfoCallback, this);
+    if (op)
+    {
+        while (LATE(pa_operation_get_state)(op) == PA_OPERATION_RUNNING)
+            LATE(pa_threaded_mainloop_wait)(pa_main_loop_);
+
+        LATE(pa_operation_unref)(op);
+    }
+
+    if (monitor_source_.empty())
+    {
+        LOG(LS_ERROR) << "Unable to get the default sink";
+        return false;
+    }
+
+    return true;
+}
+
+bool AudioCapturerPulse::initRecording()
+{
+    ScopedPaLock pa_lock(pa_main_loop_);
+
+    pa_sample_spec sample_spec;
+    sample_spec.format = PA_SAMPLE_S16LE;
+    sample_spec.rate = kSampleRate;
+    sample_spec.channels = kChannels;
+
+    record_stream_ = LATE(pa_stream_new)(pa_context_, "Desktop Audio", &sample_spec, nullptr);
+    if (!record_stream_)
+    {
+        LOG(LS_ERROR) << "Cannot create record stream: " << LATE(pa_context_errno)(pa_context_);
+        return false;
+    }
+
+    LATE(pa_stream_set_state_callback)(record_stream_, paStreamStateCallback, this);
+    LATE(pa_stream_set_read_callback)(record_stream_, paStreamReadCallback, this);
+
+    // Ask the server to deliver the data in fragments of one packet. Without this the server
+    // chooses a fragment size of about two seconds.
+    pa_buffer_attr buffer_attr;
+    buffer_attr.maxlength = static_cast<uint32_t>(-1);
+    buffer_attr.tlength = static_cast<uint32_t>(-1);
+    buffer_attr.prebuf = static_cast<uint32_t>(-1);
+    buffer_attr.minreq = static_cast<uint32_t>(-1);
+    buffer_attr.fragsize = static_cast<uint32_t>(kPacketSize);
+
+    int ret = LATE(pa_stream_connect_record)(
+        record_stream_, monitor_source_.c_str(), &buffer_attr, PA_STREAM_ADJUST_LATENCY);
+    if (ret != PA_OK)
+    {
+        LOG(LS_ERROR) << "Failed to connect record stream: " << LATE(pa_context_errno)(pa_context_);
+        return false;
+    }
+
+    while (true)
+    {
+        pa_stream_state_t state = LATE(pa_stream_get_state)(record_stream_);
+        if (state == PA_STREAM_READY)
+            break;
+
+        if (!PA_STREAM_IS_GOOD(state))
+        {
+            LOG(LS_ERROR) << "Failed to start record stream: "
+                          << LATE(pa_context_errno)(pa_context_);
+            return false;
+        }
+
+        LATE(pa_threaded_mainloop_wait)(pa_main_loop_);
+    }
+
+    return true;
+}
+
+void AudioCapturerPulse::terminate()
+{
+    if (!pa_main_loop_)
+        return;
+
+    {
+        ScopedPaLock pa_lock(pa_main_loop_);
+
+        if (record_stream_)
+        {
+            LATE(pa_stream_set_state_callback)(record_stream_, nullptr, nullptr);
+            LATE(pa_stream_set_read_callback)(record_stream_, nullptr, nullptr);
+            LATE(pa_stream_disconnect)(record_stream_);
+            LATE(pa_stream_unref)(record_stream_);
+            record_stream_ = nullptr;
+        }
+
+        if (pa_context_)
+        {
+            LATE(pa_context_set_state_callback)(pa_context_, nullptr, nullptr);
+            LATE(pa_context_disconnect)(pa_context_);
+            LATE(pa_context_unref)(pa_context_);
+            pa_context_ = nullptr;
+        }
+    }
+
+    LATE(pa_threaded_mainloop_stop)(pa_main_loop_);
+    LATE(pa_threaded_mainloop_free)(pa_main_loop_);
+    pa_main_loop_ = nullptr;
+}
+
+void AudioCapturerPulse::appendData(const char* data, size_t size)
+{
+    while (size)
+    {
+        if (!packet_)
+        {
+            packet_ = std::make_unique<proto::AudioPacket>();
+            packet_->set_encoding(proto::AUDIO_ENCODING_RAW);
+            packet_->set_sampling_rate(proto::AudioPacket::SAMPLING_RATE_48000);
+            packet_->set_bytes_per_sample(proto::AudioPacket::BYTES_PER_SAMPLE_2);
+            packet_->set_channels(proto::AudioPacket::CHANNELS_STEREO);
+            packet_->add_data()->reserve(kPacketSize);
+        }
+
+        std::string* buffer = packet_->mutable_data(0);
+
+        const size_t count = std::min(size, kPacketSize - buffer->size());
+        if (data)
+        {
+            buffer->append(data, count);
+            data += count;
+        }
+        else
+        {
+            buffer->append(count, 0);
+        }
+
+        size -= count;
+
+        if (buffer->size() < kPacketSize)
+            continue;
+
+        if (silence_detector_.isSilence(
+                reinterpret_cast<const int16_t*>(buffer->data()), kPacketFrames))
+        {
+            // Keep the packet and its memory for the next chunk.
+            buffer->clear();
+            continue;
+        }
+
+        // The last frame of the packet has just been captured.
+        packet_->set_capture_time(SystemTime::microsecondsSinceEpoch() -
+                                  static_cast<int64_t>(kPacketFrames) * 1000000 / kSampleRate);
+
+        callback_(std::move(packet_));
+    }
+}
+
+bool AudioCapturer::isSupported()
+{
+    return pulseSymbolTable()->load();
+}
+
+std::unique_ptr<AudioCapturer> AudioCapturer::create()
+{
+    return std::unique_ptr<AudioCapturer>(new AudioCapturerPulse());
+}
+
+} // namespace base
@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__AUDIO__AUDIO_CAPTURER_PULSE_H
+#define BASE__AUDIO__AUDIO_CAPTURER_PULSE_H
+
+#include "base/macros_magic.h"
+#include "base/audio/audio_capturer.h"
+#include "base/audio/audio_silence_detector.h"
+
+#include <string>
+
+#include <pulse/pulseaudio.h>
+
+namespace base {
+
+// An AudioCapturer implementation for Linux. It records the monitor source of the default sink,
+// so the client hears everything that is played on the host. PulseAudio pushes the samples to us
+// and the capturer slices them into packets of 10 ms. The callback is called on the thread of the
+// PulseAudio main loop.
+class AudioCapturerPulse : public AudioCapturer
+{
+public:
+    AudioCapturerPulse();
+    ~AudioCapturerPulse() override;
+
+    // AudioCapturer interface.
+    bool start(const PacketCapturedCallback& callback) override;
+
+private:
+    static void paContextStateCallback(pa_context* c, void* self);
+    static void paServerInfoCallback(pa_context* c, const pa_server_info* i, void* self);
+    static void paStreamStateCallback(pa_stream* p, void* self);
+    static void paStreamReadCallback(pa_stream* p, size_t nbytes, void* self);
+
+    void paServerInfoCallbackHandler(const pa_server_info* i);
+    void paStreamReadCallbackHandler();
+
+    bool initPulseAudio();
+    bool initRecording();
+    void terminate();
+
+    // Appends |size| bytes to the current packet and sends each filled packet. If |data| is null,
+    // silence is appended instead.
+    void appendData(const char* data, size_t size);
+
+    PacketCapturedCallback callback_;
+    AudioSilenceDetector silence_detector_;
+
+    // Packet that is being filled. It is reused when the captured chunk was silent.
+    std::unique_ptr<proto::AudioPacket> packet_;
+
+    std::string monitor_source_;
+
+    pa_threaded_mainloop* pa_main_loop_ = nullptr;
+    pa_context* pa_context_ = nullptr;
+    pa_stream* record_stream_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(AudioCapturerPulse);
+};
+
+} // namespace base
+
+#endif // BASE__AUDIO__AUDIO_CAPTURER_PULSE_H
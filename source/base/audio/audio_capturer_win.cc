@@ -19,6 +19,7 @@
 #include "base/audio/audio_capturer_win.h"
 
 #include "base/logging.h"
+#include "base/system_time.h"
 #include "base/audio/win/default_audio_device_change_detector.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
@@ -49,8 +50,17 @@ const int k100nsPerMillisecond = 10000;
 // -1, even when no audio is playing.
 const int kSilenceThreshold = 2;
 
-// Lower bound for timer intervals, in milliseconds.
-const std::chrono::milliseconds kMinTimerInterval { 30 };
+// Lower bound for timer intervals, in milliseconds. The capture interval adds to the audio
+// latency, so the packets are fetched as often as the usual device period allows.
+const std::chrono::milliseconds kMinTimerInterval { 10 };
+
+// After this period without audible packets the capturer polls the device less often. Nothing is
+// captured and sent in the silence, so the idle sessions do not wake the CPU up for the audio.
+const std::chrono::seconds kSilenceSleepDelay { 2 };
+
+// Timer interval while the capturer sleeps. The first audible packet after the silence is
+// delayed by up to this interval.
+const std::chrono::milliseconds kIdleTimerInterval { 100 };
 
 // Upper bound for the timer precision error, in milliseconds.
 // Timers are supposed to be accurate to 20ms, so we use 30ms to be safe.
@@ -231,7 +241,9 @@ bool AudioCapturerWin::initialize()
     hr = audio_client_->Initialize(
         AUDCLNT_SHAREMODE_SHARED,
         AUDCLNT_STREAMFLAGS_LOOPBACK,
-        (kMaxExpectedTimerLag + audio_device_period_.count()) * k100nsPerMillisecond,
+        // The buffer holds the audio accumulated while the capturer sleeps.
+        (kMaxExpectedTimerLag + std::max(audio_device_period_, kIdleTimerInterval).count()) *
+            k100nsPerMillisecond,
         0,
         wave_format_ex_,
         nullptr);
@@ -318,7 +330,12 @@ void AudioCapturerWin::doCapture()
             packet->set_channels(static_cast<proto::AudioPacket::Channels>(
                 wave_format_ex_->nChannels));
 
+            // The last frame of the buffer has just been captured.
+            packet->set_capture_time(SystemTime::microsecondsSinceEpoch() -
+                static_cast<int64_t>(frames) * 1000000 / wave_format_ex_->nSamplesPerSec);
+
             callback_(std::move(packet));
+            last_audible_time_ = std::chrono::steady_clock::now();
         }
 
         hr = audio_capture_client_->ReleaseBuffer(frames);
@@ -348,7 +365,20 @@ void AudioCapturerWin::onCaptureTimeout(const std::error_code& error_code)
 
     doCapture();
 
-    capture_timer_.expires_after(audio_device_period_);
+    std::chrono::milliseconds interval = audio_device_period_;
+
+    const bool sleeping =
+        std::chrono::steady_clock::now() - last_audible_time_ > kSilenceSleepDelay;
+    if (sleeping != sleeping_)
+    {
+        LOG(LS_INFO) << (sleeping ? "Sustained silence, capturer sleeps" : "Capturer wakes up");
+        sleeping_ = sleeping;
+    }
+
+    if (sleeping)
+        interval = std::max(interval, kIdleTimerInterval);
+
+    capture_timer_.expires_after(interval);
     capture_timer_.async_wait(
         std::bind(&AudioCapturerWin::onCaptureTimeout, this, std::placeholders::_1));
 }
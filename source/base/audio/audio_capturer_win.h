@@ -76,6 +76,10 @@ private:
     std::chrono::milliseconds audio_device_period_;
     AudioVolumeFilterWin volume_filter_;
 
+    // Time of the last packet that was not dropped as silence.
+    std::chrono::steady_clock::time_point last_audible_time_;
+    bool sleeping_ = false;
+
     base::win::ScopedCoMem<WAVEFORMATEX> wave_format_ex_;
     Microsoft::WRL::ComPtr<IAudioCaptureClient> audio_capture_client_;
     Microsoft::WRL::ComPtr<IAudioClient> audio_client_;
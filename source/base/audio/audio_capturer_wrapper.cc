@@ -18,6 +18,7 @@
 
 #include "base/audio/audio_capturer_wrapper.h"
 
+#include "base/logging.h"
 #include "base/audio/audio_capturer.h"
 #include "base/ipc/ipc_channel_proxy.h"
 #include "build/build_config.h"
@@ -37,24 +38,30 @@ AudioCapturerWrapper::~AudioCapturerWrapper()
 }
 
 void AudioCapturerWrapper::start()
-{
-    thread_->start(MessageLoop::Type::ASIO, this);
-}
-
-void AudioCapturerWrapper::onBeforeThreadRunning()
 {
 #if defined(OS_WIN)
-    thread_->setPriority(Thread::Priority::HIGHEST);
+    thread_->setThreadPriority(ThreadPriority::REALTIME_AUDIO);
+#elif defined(OS_LINUX)
+    // The audio is captured on the thread of the PulseAudio main loop.
 #else
 #warning Not implemented
 #endif
 
+    thread_->start(MessageLoop::Type::ASIO, this);
+}
+
+void AudioCapturerWrapper::onBeforeThreadRunning()
+{
     capturer_ = AudioCapturer::create();
-    capturer_->start([this](std::unique_ptr<proto::AudioPacket> packet)
+    if (!capturer_->start([this](std::unique_ptr<proto::AudioPacket> packet)
     {
         outgoing_message_.set_allocated_audio_packet(packet.release());
         channel_proxy_->send(base::serialize(outgoing_message_));
-    });
+    }))
+    {
+        LOG(LS_WARNING) << "Unable to start audio capture";
+        capturer_.reset();
+    }
 }
 
 void AudioCapturerWrapper::onAfterThreadRunning()
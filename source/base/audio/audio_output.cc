@@ -67,7 +67,9 @@ void AudioOutput::onDataRequest(int16_t* audio_samples, size_t audio_samples_cou
         size_t num_bytes = need_more_data_cb_(audio_samples + (i * kSamplesPer10ms), kBytesPer10ms);
         if (!num_bytes)
         {
-            memset(audio_samples, 0, audio_samples_count * sizeof(int16_t));
+            // Keep the audio received in the previous rounds and fill the rest with silence.
+            const size_t offset = i * kSamplesPer10ms;
+            memset(audio_samples + offset, 0, (audio_samples_count - offset) * sizeof(int16_t));
             return;
         }
     }
@@ -21,41 +21,8 @@
 #include "base/logging.h"
 #include "base/threading/simple_thread.h"
 
-base::PulseAudioSymbolTable* pulseSymbolTable()
-{
-    static base::PulseAudioSymbolTable* pulse_symbol_table = new base::PulseAudioSymbolTable();
-    return pulse_symbol_table;
-}
-
-// Accesses Pulse functions through our late-binding symbol table instead of directly. This way we
-// don't have to link to libpulse, which means our binary will work on systems that don't have it.
-#define LATE(sym) LATESYM_GET(base::PulseAudioSymbolTable, pulseSymbolTable(), sym)
-
 namespace base {
 
-namespace {
-
-class ScopedPaLock
-{
-public:
-    explicit ScopedPaLock(pa_threaded_mainloop* pa_main_loop)
-        : pa_main_loop_(pa_main_loop)
-    {
-        LATE(pa_threaded_mainloop_lock)(pa_main_loop_);
-    }
-
-    ~ScopedPaLock()
-    {
-        LATE(pa_threaded_mainloop_unlock)(pa_main_loop_);
-    }
-
-private:
-    pa_threaded_mainloop* pa_main_loop_;
-    DISALLOW_COPY_AND_ASSIGN(ScopedPaLock);
-};
-
-} // namespace
-
 AudioOutputPulse::AudioOutputPulse(const NeedMoreDataCB& need_more_data_cb)
     : AudioOutput(need_more_data_cb),
       time_event_play_(WaitableEvent::ResetPolicy::AUTOMATIC,
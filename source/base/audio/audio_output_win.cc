@@ -248,14 +248,25 @@ bool AudioOutputWin::init()
     if (!isFormatSupported(audio_client.Get(), AUDCLNT_SHAREMODE_SHARED, &format_extensible))
         return false;
 
-    // Initialize the audio stream between the client and the device in shared mode using
-    // event-driven buffer handling. Also, using 0 as requested buffer size results in a default
-    // (minimum) endpoint buffer size.
-    const REFERENCE_TIME requested_buffer_size = 0;
-    if (!sharedModeInitialize(audio_client.Get(), &format_extensible, audio_samples_event_,
-                              requested_buffer_size, true, &endpoint_buffer_size_frames_))
+    // The smallest period of the audio engine removes most of the latency of the endpoint buffer.
+    // The network jitter is absorbed by the jitter buffer of AudioPlayer, not by the endpoint.
+    if (!sharedModeInitializeLowLatency(audio_client.Get(), &format_extensible,
+                                        audio_samples_event_, true, &endpoint_buffer_size_frames_))
     {
-        return false;
+        // The client can be initialized only once.
+        audio_client = createClient(device.Get());
+        if (!audio_client.Get())
+            return false;
+
+        // Initialize the audio stream between the client and the device in shared mode using
+        // event-driven buffer handling. Also, using 0 as requested buffer size results in a
+        // default (minimum) endpoint buffer size.
+        const REFERENCE_TIME requested_buffer_size = 0;
+        if (!sharedModeInitialize(audio_client.Get(), &format_extensible, audio_samples_event_,
+                                  requested_buffer_size, true, &endpoint_buffer_size_frames_))
+        {
+            return false;
+        }
     }
 
     // Create an IAudioRenderClient for an initialized IAudioClient. The IAudioRenderClient
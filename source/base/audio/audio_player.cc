@@ -22,9 +22,44 @@
 #include "base/audio/audio_output.h"
 #include "proto/desktop.pb.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace base {
 
-AudioPlayer::AudioPlayer() = default;
+namespace {
+
+const size_t kBytesPerFrame = AudioOutput::kChannels * (AudioOutput::kBitsPerSample / 8);
+const size_t kBytesPerSecond = AudioOutput::kSampleRate * kBytesPerFrame;
+
+// Limits of the jitter buffer size.
+const std::chrono::microseconds kMinBufferTime { 10000 };
+const std::chrono::microseconds kMaxBufferTime { 200000 };
+
+// A longer pause between packets is not jitter: the host does not send the silence.
+const std::chrono::microseconds kMaxArrivalDeviation { 500000 };
+
+// The jitter is smoothed the same way as in RFC 3550.
+const double kJitterGain = 1.0 / 16.0;
+
+size_t timeToBytes(std::chrono::microseconds time)
+{
+    size_t bytes = static_cast<size_t>(time.count()) * kBytesPerSecond / 1000000;
+    return bytes - (bytes % kBytesPerFrame);
+}
+
+std::chrono::microseconds bytesToTime(size_t bytes)
+{
+    return std::chrono::microseconds(static_cast<int64_t>(bytes) * 1000000 / kBytesPerSecond);
+}
+
+} // namespace
+
+AudioPlayer::AudioPlayer()
+    : target_bytes_(timeToBytes(kMinBufferTime))
+{
+    // Nothing
+}
 
 AudioPlayer::~AudioPlayer() = default;
 
@@ -40,24 +75,144 @@ std::unique_ptr<AudioPlayer> AudioPlayer::create()
 
 void AudioPlayer::addPacket(std::unique_ptr<proto::AudioPacket> packet)
 {
+    if (packet->data_size() != 1)
+    {
+        LOG(LS_WARNING) << "Invalid audio packet";
+        return;
+    }
+
+    updateJitter(packet->data(0).size());
+
     std::scoped_lock lock(incoming_queue_lock_);
     incoming_queue_.emplace(std::move(packet));
 }
 
+std::chrono::milliseconds AudioPlayer::bufferedTime() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        bytesToTime(buffered_bytes_.load(std::memory_order_relaxed)));
+}
+
+std::chrono::milliseconds AudioPlayer::jitter() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::microseconds(published_jitter_us_.load(std::memory_order_relaxed)));
+}
+
+void AudioPlayer::setSyncDelay(std::chrono::milliseconds delay)
+{
+    sync_bytes_.store(timeToBytes(delay), std::memory_order_relaxed);
+}
+
+void AudioPlayer::updateJitter(size_t packet_size)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const std::chrono::microseconds packet_duration = bytesToTime(packet_size);
+
+    if (last_arrival_time_ != std::chrono::steady_clock::time_point())
+    {
+        // A packet is expected to arrive after the time it takes to play it.
+        std::chrono::microseconds deviation =
+            std::chrono::duration_cast<std::chrono::microseconds>(now - last_arrival_time_) -
+            packet_duration;
+        if (deviation.count() < 0)
+            deviation = -deviation;
+
+        if (deviation < kMaxArrivalDeviation)
+            jitter_us_ += (static_cast<double>(deviation.count()) - jitter_us_) * kJitterGain;
+    }
+
+    last_arrival_time_ = now;
+
+    std::chrono::microseconds target_time =
+        packet_duration + std::chrono::microseconds(static_cast<int64_t>(jitter_us_ * 2));
+    target_time = std::clamp(target_time, kMinBufferTime, kMaxBufferTime);
+
+    published_jitter_us_.store(static_cast<int64_t>(jitter_us_), std::memory_order_relaxed);
+    target_bytes_.store(timeToBytes(target_time), std::memory_order_relaxed);
+}
+
+void AudioPlayer::dropExcess(size_t target_bytes)
+{
+    DCHECK_GT(work_bytes_, target_bytes);
+    size_t excess = work_bytes_ - target_bytes;
+
+    while (excess >= kBytesPerFrame && !work_queue_.empty())
+    {
+        size_t remaining = work_queue_.front()->data(0).size() - source_pos_;
+        if (remaining <= excess)
+        {
+            work_queue_.pop();
+            source_pos_ = 0;
+            work_bytes_ -= remaining;
+            excess -= remaining;
+        }
+        else
+        {
+            size_t skip = excess - (excess % kBytesPerFrame);
+            source_pos_ += skip;
+            work_bytes_ -= skip;
+            break;
+        }
+    }
+}
+
 size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
 {
-    if (work_queue_.empty())
     {
+        std::scoped_lock lock(incoming_queue_lock_);
+
+        while (!incoming_queue_.empty())
         {
-            std::scoped_lock lock(incoming_queue_lock_);
-            work_queue_.swap(incoming_queue_);
+            work_bytes_ += incoming_queue_.front()->data(0).size();
+            work_queue_.emplace(std::move(incoming_queue_.front()));
+            incoming_queue_.pop();
         }
+    }
 
-        if (work_queue_.empty())
+    const size_t sync_bytes = sync_bytes_.load(std::memory_order_relaxed);
+    const size_t target_bytes = target_bytes_.load(std::memory_order_relaxed) + sync_bytes;
+
+    size_t target_pos = 0;
+
+    if (prebuffering_)
+    {
+        // Wait until the jitter buffer is filled. The sync delay is included in the target.
+        if (work_bytes_ < target_bytes)
+        {
+            buffered_bytes_.store(work_bytes_, std::memory_order_relaxed);
             return 0;
+        }
+
+        prebuffering_ = false;
+        played_sync_bytes_ = sync_bytes;
     }
+    else if (sync_bytes > played_sync_bytes_)
+    {
+        // The audio is ahead of the video. The playback is paused for the difference and the
+        // rest of the request is filled with the audio.
+        size_t silence = std::min(sync_bytes - played_sync_bytes_, size);
+        silence -= silence % kBytesPerFrame;
 
-    size_t target_pos = 0;
+        memset(data, 0, silence);
+        played_sync_bytes_ += silence;
+        target_pos = silence;
+    }
+    else if (sync_bytes < played_sync_bytes_)
+    {
+        // The audio is behind the video. The difference is dropped.
+        const size_t excess = std::min(played_sync_bytes_ - sync_bytes, work_bytes_);
+        if (excess >= kBytesPerFrame)
+            dropExcess(work_bytes_ - excess);
+
+        played_sync_bytes_ = sync_bytes;
+    }
+
+    if (work_bytes_ > target_bytes * 2 + size)
+    {
+        // The latency grows. The buffered audio is more than is required by the current jitter.
+        dropExcess(target_bytes);
+    }
 
     while (!work_queue_.empty())
     {
@@ -71,6 +226,7 @@ size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
                packet_data.data() + source_pos_,
                num_bytes);
         target_pos += num_bytes;
+        work_bytes_ -= num_bytes;
 
         if (target_size < source_size)
         {
@@ -87,7 +243,21 @@ size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
         }
     }
 
-    return target_pos;
+    buffered_bytes_.store(work_bytes_, std::memory_order_relaxed);
+
+    if (target_pos < size)
+    {
+        // Underrun. The rest is filled with silence and the buffer is filled again before the
+        // playback continues.
+        prebuffering_ = true;
+
+        if (!target_pos)
+            return 0;
+
+        memset(reinterpret_cast<uint8_t*>(data) + target_pos, 0, size - target_pos);
+    }
+
+    return size;
 }
 
 bool AudioPlayer::init()
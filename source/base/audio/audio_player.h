@@ -21,6 +21,8 @@
 
 #include "base/macros_magic.h"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -33,6 +35,11 @@ namespace base {
 
 class AudioOutput;
 
+// Plays the decoded audio packets. The packets pass through an adaptive jitter buffer: its target
+// size follows the measured jitter of the packet arrival times. The playback starts (and restarts
+// after an underrun) only when the target amount of audio is buffered. If more than twice the
+// target is buffered, the oldest audio is dropped to keep the latency low. An additional delay
+// can be set to play the audio in sync with the video.
 class AudioPlayer
 {
 public:
@@ -41,9 +48,22 @@ public:
     static std::unique_ptr<AudioPlayer> create();
     void addPacket(std::unique_ptr<proto::AudioPacket> packet);
 
+    // Duration of the audio received but not yet played. May be called from any thread.
+    std::chrono::milliseconds bufferedTime() const;
+
+    // Estimated jitter of the packet arrival times. May be called from any thread.
+    std::chrono::milliseconds jitter() const;
+
+    // Sets the delay added to the jitter buffer. When the delay grows, the silence is inserted
+    // into the playback; when it decreases, the buffered audio is dropped. May be called from any
+    // thread.
+    void setSyncDelay(std::chrono::milliseconds delay);
+
 private:
     AudioPlayer();
     bool init();
+    void updateJitter(size_t packet_size);
+    void dropExcess(size_t target_bytes);
     size_t onMoreDataRequired(void* data, size_t size);
 
     std::unique_ptr<AudioOutput> output_;
@@ -51,8 +71,22 @@ private:
     std::queue<std::unique_ptr<proto::AudioPacket>> incoming_queue_;
     std::mutex incoming_queue_lock_;
 
+    // Used only in addPacket().
+    std::chrono::steady_clock::time_point last_arrival_time_;
+    double jitter_us_ = 0;
+
+    std::atomic<int64_t> published_jitter_us_ { 0 };
+    std::atomic<size_t> target_bytes_;
+    std::atomic<size_t> buffered_bytes_ { 0 };
+    std::atomic<size_t> sync_bytes_ { 0 };
+
+    // Used only in onMoreDataRequired().
     std::queue<std::unique_ptr<proto::AudioPacket>> work_queue_;
+    size_t work_bytes_ = 0;
     size_t source_pos_ = 0;
+    bool prebuffering_ = true;
+    // The sync delay which is already applied to the playback.
+    size_t played_sync_bytes_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(AudioPlayer);
 };
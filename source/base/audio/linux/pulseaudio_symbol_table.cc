@@ -18,6 +18,8 @@
 
 #include "base/audio/linux/pulseaudio_symbol_table.h"
 
+#include <pulse/pulseaudio.h>
+
 namespace base {
 
 LATE_BINDING_SYMBOL_TABLE_DEFINE_BEGIN(PulseAudioSymbolTable, "libpulse.so.0")
@@ -26,4 +28,21 @@ PULSE_AUDIO_SYMBOLS_LIST
 #undef X
 LATE_BINDING_SYMBOL_TABLE_DEFINE_END(PulseAudioSymbolTable)
 
+PulseAudioSymbolTable* pulseSymbolTable()
+{
+    static PulseAudioSymbolTable* pulse_symbol_table = new PulseAudioSymbolTable();
+    return pulse_symbol_table;
+}
+
+ScopedPaLock::ScopedPaLock(pa_threaded_mainloop* pa_main_loop)
+    : pa_main_loop_(pa_main_loop)
+{
+    LATE(pa_threaded_mainloop_lock)(pa_main_loop_);
+}
+
+ScopedPaLock::~ScopedPaLock()
+{
+    LATE(pa_threaded_mainloop_unlock)(pa_main_loop_);
+}
+
 } // namespace base
@@ -21,6 +21,8 @@
 
 #include "base/audio/linux/late_binding_symbol_table.h"
 
+struct pa_threaded_mainloop;
+
 namespace base {
 
 // The PulseAudio symbols we need, as an X-Macro list.
@@ -87,6 +89,25 @@ PULSE_AUDIO_SYMBOLS_LIST
 #undef X
 LATE_BINDING_SYMBOL_TABLE_DECLARE_END(PulseAudioSymbolTable)
 
+// Returns the table shared by the audio output and the audio capturer.
+PulseAudioSymbolTable* pulseSymbolTable();
+
+// Holds the lock of the threaded main loop for the lifetime of the object.
+class ScopedPaLock
+{
+public:
+    explicit ScopedPaLock(pa_threaded_mainloop* pa_main_loop);
+    ~ScopedPaLock();
+
+private:
+    pa_threaded_mainloop* pa_main_loop_;
+    DISALLOW_COPY_AND_ASSIGN(ScopedPaLock);
+};
+
 } // namespace base
 
+// Accesses Pulse functions through our late-binding symbol table instead of directly. This way we
+// don't have to link to libpulse, which means our binary will work on systems that don't have it.
+#define LATE(sym) LATESYM_GET(base::PulseAudioSymbolTable, base::pulseSymbolTable(), sym)
+
 #endif // BASE__AUDIO__LINUX__PULSEAUDIO_SYMBOL_TABLE_H
@@ -226,6 +226,85 @@ bool sharedModeInitialize(IAudioClient* client,
     return true;
 }
 
+bool sharedModeInitializeLowLatency(IAudioClient* client,
+                                    const WAVEFORMATEXTENSIBLE* format,
+                                    HANDLE event_handle,
+                                    bool auto_convert_pcm,
+                                    uint32_t* endpoint_buffer_size)
+{
+    DCHECK(client);
+    DCHECK(event_handle != nullptr && event_handle != INVALID_HANDLE_VALUE);
+
+    Microsoft::WRL::ComPtr<IAudioClient3> client3;
+    HRESULT hr = client->QueryInterface(IID_PPV_ARGS(&client3));
+    if (FAILED(hr))
+    {
+        LOG(LS_INFO) << "IAudioClient3 is not supported";
+        return false;
+    }
+
+    const WAVEFORMATEX* wave_format = reinterpret_cast<const WAVEFORMATEX*>(format);
+
+    // The periods are expressed in frames. The default period is used by IAudioClient::Initialize
+    // (usually 10 ms). The minimum period is equal to the default one if the driver does not
+    // support small buffers.
+    UINT32 default_period = 0;
+    UINT32 fundamental_period = 0;
+    UINT32 min_period = 0;
+    UINT32 max_period = 0;
+
+    hr = client3->GetSharedModeEnginePeriod(
+        wave_format, &default_period, &fundamental_period, &min_period, &max_period);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IAudioClient3::GetSharedModeEnginePeriod failed: "
+                      << SystemError(hr).toString();
+        return false;
+    }
+
+    if (min_period >= default_period)
+    {
+        LOG(LS_INFO) << "Low latency period is not supported by the device";
+        return false;
+    }
+
+    DWORD stream_flags = AUDCLNT_STREAMFLAGS_NOPERSIST | AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+    if (auto_convert_pcm)
+    {
+        stream_flags |= AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM;
+        stream_flags |= AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY;
+    }
+
+    hr = client3->InitializeSharedAudioStream(stream_flags, min_period, wave_format, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IAudioClient3::InitializeSharedAudioStream failed: "
+                      << SystemError(hr).toString();
+        return false;
+    }
+
+    hr = client->SetEventHandle(event_handle);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IAudioClient::SetEventHandle failed: " << SystemError(hr).toString();
+        return false;
+    }
+
+    UINT32 buffer_size_in_frames = 0;
+    hr = client->GetBufferSize(&buffer_size_in_frames);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IAudioClient::GetBufferSize failed: " << SystemError(hr).toString();
+        return false;
+    }
+
+    *endpoint_buffer_size = buffer_size_in_frames;
+
+    LOG(LS_INFO) << "Low latency audio stream (period: " << min_period << " of "
+                 << default_period << " frames, buffer: " << buffer_size_in_frames << " frames)";
+    return true;
+}
+
 bool isFormatSupported(IAudioClient* client,
                        AUDCLNT_SHAREMODE share_mode,
                        const WAVEFORMATEXTENSIBLE* format)
@@ -41,6 +41,16 @@ bool sharedModeInitialize(IAudioClient* client,
                           bool auto_convert_pcm,
                           uint32_t* endpoint_buffer_size);
 
+// Initializes |client| in shared mode with the smallest period of the audio engine supported by
+// the device (IAudioClient3, Windows 10 and later). Returns false if the system or the driver does
+// not allow a period smaller than the default one. If the initialization fails, |client| can not
+// be used anymore and a new client must be created.
+bool sharedModeInitializeLowLatency(IAudioClient* client,
+                                    const WAVEFORMATEXTENSIBLE* format,
+                                    HANDLE event_handle,
+                                    bool auto_convert_pcm,
+                                    uint32_t* endpoint_buffer_size);
+
 bool isFormatSupported(IAudioClient* client,
                        AUDCLNT_SHAREMODE share_mode,
                        const WAVEFORMATEXTENSIBLE* format);
@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/coalesced_timer.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+
+namespace base {
+
+CoalescedTimer::CoalescedTimer(const Milliseconds& slack)
+    : CoalescedTimer(MessageLoop::current()->pumpAsio()->timerService(), slack)
+{
+    // Nothing
+}
+
+CoalescedTimer::CoalescedTimer(TimerService* service, const Milliseconds& slack)
+    : service_(service),
+      slack_(std::chrono::duration_cast<TimerService::Clock::duration>(slack))
+{
+    DCHECK(service_);
+    DCHECK_GE(slack.count(), 0);
+}
+
+CoalescedTimer::~CoalescedTimer()
+{
+    stop();
+}
+
+void CoalescedTimer::start(const Milliseconds& delay, Callback callback)
+{
+    DCHECK(callback);
+
+    stop();
+
+    TimerService::TimePoint deadline = TimerService::Clock::now() + delay;
+
+    if (slack_.count() > 0)
+    {
+        // Rounded up, so the timer never fires earlier than requested.
+        const TimerService::Clock::duration::rep ticks = deadline.time_since_epoch().count();
+        const TimerService::Clock::duration::rep slack = slack_.count();
+
+        deadline = TimerService::TimePoint(
+            TimerService::Clock::duration(((ticks + slack - 1) / slack) * slack));
+    }
+
+    callback_ = std::move(callback);
+    bucket_time_ = deadline;
+
+    service_->add(this);
+}
+
+void CoalescedTimer::stop()
+{
+    if (!active_)
+        return;
+
+    service_->remove(this);
+    callback_ = nullptr;
+}
+
+} // namespace base
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__COALESCED_TIMER_H
+#define BASE__COALESCED_TIMER_H
+
+#include "base/message_loop/timer_service.h"
+
+#include <functional>
+
+namespace base {
+
+// Single shot timer for the threads with MessagePumpForAsio. The timers are served by the
+// TimerService of the thread, which fires the timers with close deadlines at once. A timer can
+// fire up to |slack| later than requested, but never earlier. Suited for the timeouts kept by
+// every connection, where the accuracy does not matter and the number of timers is large.
+class CoalescedTimer
+{
+public:
+    using Callback = std::function<void()>;
+    using Milliseconds = std::chrono::milliseconds;
+
+    // Uses the timer service of the current thread.
+    explicit CoalescedTimer(const Milliseconds& slack);
+    CoalescedTimer(TimerService* service, const Milliseconds& slack);
+    ~CoalescedTimer();
+
+    // Starts the timer. If the timer is already active, it is restarted with the new callback.
+    // The callback can start the timer again or destroy it.
+    void start(const Milliseconds& delay, Callback callback);
+
+    void stop();
+
+    bool isActive() const { return active_; }
+
+private:
+    friend class TimerService;
+
+    TimerService* service_;
+    const TimerService::Clock::duration slack_;
+
+    Callback callback_;
+    bool active_ = false;
+
+    // The bucket of the timer and the neighbours in it.
+    TimerService::TimePoint bucket_time_;
+    CoalescedTimer* prev_ = nullptr;
+    CoalescedTimer* next_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(CoalescedTimer);
+};
+
+} // namespace base
+
+#endif // BASE__COALESCED_TIMER_H
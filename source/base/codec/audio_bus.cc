@@ -20,11 +20,82 @@
 
 #include "base/logging.h"
 #include "base/codec/vector_math.h"
+#include "build/build_config.h"
 
 #include <cstring>
 
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+#if defined(CC_MSVC)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif // defined(CC_*)
+#endif
+
 namespace base {
 
+namespace {
+
+// The scaling factors of SignedInt16SampleTypeTraits.
+constexpr float kInt16ForNegativeInput = 32768.0f;
+constexpr float kInt16ForPositiveInput = 32767.0f;
+constexpr float kInt16InverseForNegativeInput = 1.0f / kInt16ForNegativeInput;
+constexpr float kInt16InverseForPositiveInput = 1.0f / kInt16ForPositiveInput;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+__m128 selectBySign(__m128 value, __m128 for_negative, __m128 for_positive)
+{
+    const __m128 mask = _mm_cmplt_ps(value, _mm_setzero_ps());
+    return _mm_or_ps(_mm_and_ps(mask, for_negative), _mm_andnot_ps(mask, for_positive));
+}
+
+__m128 int16ToFloat(__m128i value)
+{
+    const __m128 result = _mm_cvtepi32_ps(value);
+    return _mm_mul_ps(result, selectBySign(result,
+                                           _mm_set1_ps(kInt16InverseForNegativeInput),
+                                           _mm_set1_ps(kInt16InverseForPositiveInput)));
+}
+
+__m128i floatToInt16(__m128 value)
+{
+    // Clipping. The clipped values are converted exactly to the limits of int16_t.
+    value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_mul_ps(value, selectBySign(value,
+                                                           _mm_set1_ps(kInt16ForNegativeInput),
+                                                           _mm_set1_ps(kInt16ForPositiveInput))));
+}
+
+#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+
+float32x4_t selectBySign(float32x4_t value, float32x4_t for_negative, float32x4_t for_positive)
+{
+    return vbslq_f32(vcltq_f32(value, vdupq_n_f32(0.0f)), for_negative, for_positive);
+}
+
+float32x4_t int16ToFloat(int16x4_t value)
+{
+    const float32x4_t result = vcvtq_f32_s32(vmovl_s16(value));
+    return vmulq_f32(result, selectBySign(result,
+                                          vdupq_n_f32(kInt16InverseForNegativeInput),
+                                          vdupq_n_f32(kInt16InverseForPositiveInput)));
+}
+
+int16x4_t floatToInt16(float32x4_t value)
+{
+    // Clipping. The clipped values are converted exactly to the limits of int16_t.
+    value = vminq_f32(vmaxq_f32(value, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+    return vqmovn_s32(vcvtq_s32_f32(vmulq_f32(value, selectBySign(
+        value, vdupq_n_f32(kInt16ForNegativeInput), vdupq_n_f32(kInt16ForPositiveInput)))));
+}
+
+#endif // defined(ARCH_CPU_*)
+
+} // namespace
+
 static bool IsAligned(void* ptr)
 {
     return (reinterpret_cast<uintptr_t>(ptr) & (AudioBus::kChannelAlignment - 1)) == 0U;
@@ -320,6 +391,113 @@ void AudioBus::Scale(float volume)
     }
 }
 
+template <>
+void AudioBus::CopyConvertFromInterleavedSourceToAudioBus<SignedInt16SampleTypeTraits>(
+    const int16_t* source_buffer,
+    int write_offset_in_frames,
+    int num_frames_to_write,
+    AudioBus* dest)
+{
+    const int channels = dest->channels();
+    int frame = 0;
+
+#if defined(ARCH_CPU_X86_FAMILY) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
+    if (channels == 2)
+    {
+        float* left = dest->channel(0) + write_offset_in_frames;
+        float* right = dest->channel(1) + write_offset_in_frames;
+
+        // 4 stereo frames per iteration.
+        for (; frame + 4 <= num_frames_to_write; frame += 4)
+        {
+#if defined(ARCH_CPU_X86_FAMILY)
+            const __m128i samples =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_buffer + frame * 2));
+
+            // Sign extension: L0 R0 L1 R1 and L2 R2 L3 R3.
+            const __m128 low =
+                int16ToFloat(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+            const __m128 high =
+                int16ToFloat(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+
+            _mm_storeu_ps(left + frame, _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + frame, _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+#else
+            const int16x4x2_t samples = vld2_s16(source_buffer + frame * 2);
+
+            vst1q_f32(left + frame, int16ToFloat(samples.val[0]));
+            vst1q_f32(right + frame, int16ToFloat(samples.val[1]));
+#endif // defined(ARCH_CPU_*)
+        }
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY) || defined(USE_NEON)
+
+    // The source is read sequentially for any number of channels.
+    for (; frame < num_frames_to_write; ++frame)
+    {
+        const int16_t* source_frame = source_buffer + frame * channels;
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            dest->channel(ch)[write_offset_in_frames + frame] =
+                SignedInt16SampleTypeTraits::ToFloat(source_frame[ch]);
+        }
+    }
+}
+
+template <>
+void AudioBus::CopyConvertFromAudioBusToInterleavedTarget<SignedInt16SampleTypeTraits>(
+    const AudioBus* source,
+    int read_offset_in_frames,
+    int num_frames_to_read,
+    int16_t* dest_buffer)
+{
+    const int channels = source->channels();
+    int frame = 0;
+
+#if defined(ARCH_CPU_X86_FAMILY) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
+    if (channels == 2)
+    {
+        const float* left = source->channel(0) + read_offset_in_frames;
+        const float* right = source->channel(1) + read_offset_in_frames;
+
+        // 4 stereo frames per iteration.
+        for (; frame + 4 <= num_frames_to_read; frame += 4)
+        {
+#if defined(ARCH_CPU_X86_FAMILY)
+            const __m128i left_samples = floatToInt16(_mm_loadu_ps(left + frame));
+            const __m128i right_samples = floatToInt16(_mm_loadu_ps(right + frame));
+
+            // The values are already in the range of int16_t, the saturation does not change them.
+            const __m128i samples =
+                _mm_packs_epi32(_mm_unpacklo_epi32(left_samples, right_samples),
+                                _mm_unpackhi_epi32(left_samples, right_samples));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest_buffer + frame * 2), samples);
+#else
+            int16x4x2_t samples;
+            samples.val[0] = floatToInt16(vld1q_f32(left + frame));
+            samples.val[1] = floatToInt16(vld1q_f32(right + frame));
+
+            vst2_s16(dest_buffer + frame * 2, samples);
+#endif // defined(ARCH_CPU_*)
+        }
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY) || defined(USE_NEON)
+
+    // The target is written sequentially for any number of channels.
+    for (; frame < num_frames_to_read; ++frame)
+    {
+        int16_t* dest_frame = dest_buffer + frame * channels;
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            dest_frame[ch] = SignedInt16SampleTypeTraits::FromFloat(
+                source->channel(ch)[read_offset_in_frames + frame]);
+        }
+    }
+}
+
 void AudioBus::SwapChannels(int a, int b)
 {
     DCHECK(!is_bitstream_format_);
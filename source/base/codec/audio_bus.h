@@ -264,8 +264,7 @@ void AudioBus::ToInterleavedPartial(
         this, read_offset_in_frames, num_frames_to_read, dest);
 }
 
-// TODO(chfremer): Consider using vector instructions to speed this up,
-//                 https://crbug.com/619628
+// The 16-bit samples used by the audio codecs have a vectorized specialization below.
 template <class SourceSampleTypeTraits>
 void AudioBus::CopyConvertFromInterleavedSourceToAudioBus(
     const typename SourceSampleTypeTraits::ValueType* source_buffer,
@@ -287,8 +286,7 @@ void AudioBus::CopyConvertFromInterleavedSourceToAudioBus(
     }
 }
 
-// TODO(chfremer): Consider using vector instructions to speed this up,
-//                 https://crbug.com/619628
+// The 16-bit samples used by the audio codecs have a vectorized specialization below.
 template <class TargetSampleTypeTraits>
 void AudioBus::CopyConvertFromAudioBusToInterleavedTarget(
     const AudioBus* source,
@@ -310,6 +308,22 @@ void AudioBus::CopyConvertFromAudioBusToInterleavedTarget(
     }
 }
 
+// Convert the whole frames at once: stereo with SSE2 or NEON, the other layouts frame by frame.
+// The results are the same as for the generic versions.
+template <>
+void AudioBus::CopyConvertFromInterleavedSourceToAudioBus<SignedInt16SampleTypeTraits>(
+    const int16_t* source_buffer,
+    int write_offset_in_frames,
+    int num_frames_to_write,
+    AudioBus* dest);
+
+template <>
+void AudioBus::CopyConvertFromAudioBusToInterleavedTarget<SignedInt16SampleTypeTraits>(
+    const AudioBus* source,
+    int read_offset_in_frames,
+    int num_frames_to_read,
+    int16_t* dest_buffer);
+
 } // namespace base
 
 #endif // BASE__CODEC__AUDIO_BUS_H
@@ -0,0 +1,143 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_bus.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+std::vector<int16_t> generateSamples(int channels, int frames)
+{
+    std::vector<int16_t> samples(channels * frames);
+    std::mt19937 random(channels * frames);
+    std::uniform_int_distribution<int> distribution(-32768, 32767);
+
+    for (auto& sample : samples)
+        sample = static_cast<int16_t>(distribution(random));
+
+    // The limits and zero.
+    samples[0] = -32768;
+    samples[1 % samples.size()] = 32767;
+    samples[2 % samples.size()] = 0;
+
+    return samples;
+}
+
+void testFromInterleaved(int channels, int frames)
+{
+    const std::vector<int16_t> samples = generateSamples(channels, frames);
+
+    std::unique_ptr<AudioBus> bus = AudioBus::Create(channels, frames);
+    bus->FromInterleaved<SignedInt16SampleTypeTraits>(samples.data(), frames);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            ASSERT_EQ(bus->channel(ch)[frame], SignedInt16SampleTypeTraits::ToFloat(
+                samples[frame * channels + ch])) << "channel " << ch << ", frame " << frame;
+        }
+    }
+}
+
+void testToInterleaved(int channels, int frames)
+{
+    std::unique_ptr<AudioBus> bus = AudioBus::Create(channels, frames);
+    std::mt19937 random(channels * frames);
+    std::uniform_real_distribution<float> distribution(-1.2f, 1.2f);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        for (int frame = 0; frame < frames; ++frame)
+            bus->channel(ch)[frame] = distribution(random);
+    }
+
+    // The limits, out of range values and the negative zero.
+    bus->channel(0)[0] = -1.0f;
+    bus->channel(0)[1 % frames] = 1.0f;
+    bus->channel(channels - 1)[2 % frames] = -0.0f;
+    bus->channel(channels - 1)[3 % frames] = 100.0f;
+
+    std::vector<int16_t> samples(channels * frames);
+    bus->ToInterleaved<SignedInt16SampleTypeTraits>(frames, samples.data());
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            ASSERT_EQ(samples[frame * channels + ch],
+                      SignedInt16SampleTypeTraits::FromFloat(bus->channel(ch)[frame]))
+                << "channel " << ch << ", frame " << frame;
+        }
+    }
+}
+
+} // namespace
+
+TEST(AudioBusTest, from_interleaved_int16)
+{
+    for (int channels : { 1, 2, 6, 8 })
+    {
+        // A number of frames that is not a multiple of the vector size is checked too.
+        testFromInterleaved(channels, 480);
+        testFromInterleaved(channels, 7);
+    }
+}
+
+TEST(AudioBusTest, to_interleaved_int16)
+{
+    for (int channels : { 1, 2, 6, 8 })
+    {
+        testToInterleaved(channels, 480);
+        testToInterleaved(channels, 7);
+    }
+}
+
+TEST(AudioBusTest, interleaved_partial)
+{
+    const int kChannels = 2;
+    const int kFrames = 64;
+    const int kOffset = 5;
+
+    const std::vector<int16_t> samples = generateSamples(kChannels, kFrames - kOffset);
+
+    std::unique_ptr<AudioBus> bus = AudioBus::Create(kChannels, kFrames);
+    bus->Zero();
+    bus->FromInterleavedPartial<SignedInt16SampleTypeTraits>(
+        samples.data(), kOffset, kFrames - kOffset);
+
+    for (int ch = 0; ch < kChannels; ++ch)
+    {
+        for (int frame = 0; frame < kOffset; ++frame)
+            EXPECT_EQ(bus->channel(ch)[frame], 0.0f);
+    }
+
+    std::vector<int16_t> result(samples.size());
+    bus->ToInterleavedPartial<SignedInt16SampleTypeTraits>(
+        kOffset, kFrames - kOffset, result.data());
+
+    EXPECT_EQ(result, samples);
+}
+
+} // namespace base
@@ -115,6 +115,7 @@ std::unique_ptr<proto::AudioPacket> AudioDecoderOpus::decode(const proto::AudioP
     decoded_packet->set_sampling_rate(kSamplingRate);
     decoded_packet->set_bytes_per_sample(proto::AudioPacket::BYTES_PER_SAMPLE_2);
     decoded_packet->set_channels(packet.channels());
+    decoded_packet->set_capture_time(packet.capture_time());
 
     int max_frame_samples = kMaxFrameSizeMs * kSamplingRate / std::chrono::milliseconds(1000);
     int max_frame_bytes = max_frame_samples * channels_ * decoded_packet->bytes_per_sample();
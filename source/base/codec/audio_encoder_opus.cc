@@ -35,16 +35,12 @@ const int kOutputBitrateBps = 64 * 1024;
 const proto::AudioPacket::SamplingRate kOpusSamplingRate =
     proto::AudioPacket::SAMPLING_RATE_48000;
 
-// Opus supports frame sizes of 2.5, 5, 10, 20, 40 and 60 ms. We use 20 ms
-// frames to balance latency and efficiency.
-const std::chrono::milliseconds kFrameSizeMs { 20 };
-
-// Number of samples per frame when using default sampling rate.
-const int kFrameSamples = kOpusSamplingRate * kFrameSizeMs / std::chrono::milliseconds(1000);
-
 const proto::AudioPacket::BytesPerSample kBytesPerSample =
     proto::AudioPacket::BYTES_PER_SAMPLE_2;
 
+// With DTX enabled, the frames of 1 or 2 bytes contain only the silence.
+const int kMaxDtxFrameSize = 2;
+
 bool IsSupportedSampleRate(int rate)
 {
     return rate == 44100 || rate == 48000;
@@ -52,7 +48,20 @@ bool IsSupportedSampleRate(int rate)
 
 } // namespace
 
-AudioEncoderOpus::AudioEncoderOpus() = default;
+// static
+const std::chrono::milliseconds AudioEncoderOpus::kDefaultFrameDuration { 20 };
+
+AudioEncoderOpus::AudioEncoderOpus(std::chrono::milliseconds frame_duration)
+    : frame_duration_(isValidFrameDuration(frame_duration) ?
+                      frame_duration : kDefaultFrameDuration),
+      frame_samples_(kOpusSamplingRate * frame_duration_ / std::chrono::milliseconds(1000))
+{
+    if (frame_duration_ != frame_duration)
+    {
+        LOG(LS_WARNING) << "Unsupported frame duration: " << frame_duration.count()
+                        << " ms. The default is used";
+    }
+}
 
 AudioEncoderOpus::~AudioEncoderOpus()
 {
@@ -73,11 +82,15 @@ void AudioEncoderOpus::initEncoder()
 
     opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(kOutputBitrateBps));
 
-    frame_size_ = sampling_rate_ * kFrameSizeMs / std::chrono::milliseconds(1000);
+    // Discontinuous transmission: in the silence the encoder produces the frames that are not
+    // sent (see encode()).
+    opus_encoder_ctl(encoder_, OPUS_SET_DTX(1));
+
+    frame_size_ = sampling_rate_ * frame_duration_ / std::chrono::milliseconds(1000);
 
     if (sampling_rate_ != kOpusSamplingRate)
     {
-        resample_buffer_.reset(new char[kFrameSamples * kBytesPerSample * channels_]);
+        resample_buffer_.reset(new char[frame_samples_ * kBytesPerSample * channels_]);
         // TODO(sergeyu): Figure out the right buffer size to use per packet instead
         // of using SincResampler::kDefaultRequestSize.
         resampler_.reset(new MultiChannelResampler(
@@ -86,7 +99,7 @@ void AudioEncoderOpus::initEncoder()
             SincResampler::kDefaultRequestSize,
             std::bind(&AudioEncoderOpus::fetchBytesToResample,
                 this, std::placeholders::_1, std::placeholders::_2)));
-        resampler_bus_ = AudioBus::Create(channels_, kFrameSamples);
+        resampler_bus_ = AudioBus::Create(channels_, frame_samples_);
     }
 
     // Drop leftover data because it's for different sampling rate.
@@ -149,6 +162,14 @@ int AudioEncoderOpus::bitrate()
     return kOutputBitrateBps;
 }
 
+// static
+bool AudioEncoderOpus::isValidFrameDuration(std::chrono::milliseconds frame_duration)
+{
+    return frame_duration == std::chrono::milliseconds(5) ||
+           frame_duration == std::chrono::milliseconds(10) ||
+           frame_duration == std::chrono::milliseconds(20);
+}
+
 bool AudioEncoderOpus::encode(
     const proto::AudioPacket& input_packet, proto::AudioPacket* output_packet)
 {
@@ -163,7 +184,8 @@ bool AudioEncoderOpus::encode(
     }
 
     int samples_in_packet = input_packet.data(0).size() / kBytesPerSample / channels_;
-    const int16_t* next_sample = reinterpret_cast<const int16_t*>(input_packet.data(0).data());
+    const int16_t* first_sample = reinterpret_cast<const int16_t*>(input_packet.data(0).data());
+    const int16_t* next_sample = first_sample;
 
     // Create a new packet of encoded data.
     output_packet->set_encoding(proto::AUDIO_ENCODING_OPUS);
@@ -197,12 +219,12 @@ bool AudioEncoderOpus::encode(
             resampling_data_ = reinterpret_cast<const char*>(pcm_buffer);
             resampling_data_pos_ = 0;
             resampling_data_size_ = samples_wanted * channels_ * kBytesPerSample;
-            resampler_->Resample(kFrameSamples, resampler_bus_.get());
+            resampler_->Resample(frame_samples_, resampler_bus_.get());
             resampling_data_ = nullptr;
             samples_consumed = resampling_data_pos_ / channels_ / kBytesPerSample;
 
             resampler_bus_->ToInterleaved<SignedInt16SampleTypeTraits>(
-                kFrameSamples, reinterpret_cast<int16_t*>(resample_buffer_.get()));
+                frame_samples_, reinterpret_cast<int16_t*>(resample_buffer_.get()));
             pcm_buffer = reinterpret_cast<int16_t*>(resample_buffer_.get());
         }
         else
@@ -212,11 +234,11 @@ bool AudioEncoderOpus::encode(
 
         // Initialize output buffer.
         std::string* data = output_packet->add_data();
-        data->resize(kFrameSamples * kBytesPerSample * channels_);
+        data->resize(frame_samples_ * kBytesPerSample * channels_);
 
         // Encode.
         unsigned char* buffer = reinterpret_cast<unsigned char*>(std::data(*data));
-        int result = opus_encode(encoder_, pcm_buffer, kFrameSamples, buffer, data->length());
+        int result = opus_encode(encoder_, pcm_buffer, frame_samples_, buffer, data->length());
         if (result < 0)
         {
             LOG(LS_ERROR) << "opus_encode() failed with error code: " << result;
@@ -224,7 +246,26 @@ bool AudioEncoderOpus::encode(
         }
 
         DCHECK_LE(result, static_cast<int>(data->length()));
-        data->resize(result);
+
+        if (result <= kMaxDtxFrameSize)
+        {
+            // The frame does not need to be transmitted, the decoder plays the silence.
+            output_packet->mutable_data()->RemoveLast();
+        }
+        else
+        {
+            data->resize(result);
+
+            // The capture time of the packet is the time of its first transmitted frame. The frame
+            // starts with the leftover samples of the previous input packets.
+            if (output_packet->data_size() == 1 && input_packet.capture_time())
+            {
+                const int64_t offset_samples =
+                    (next_sample - first_sample) / channels_ - leftover_samples_;
+                output_packet->set_capture_time(input_packet.capture_time() +
+                    offset_samples * 1000000 / input_packet.sampling_rate());
+            }
+        }
 
         // Cleanup leftover buffer.
         if (samples_consumed >= leftover_samples_)
@@ -252,7 +293,7 @@ bool AudioEncoderOpus::encode(
         leftover_samples_ += samples_in_packet;
     }
 
-    // Return nullptr if there's nothing in the packet.
+    // Return false if there's nothing in the packet. It is also the case for the silence.
     if (output_packet->data_size() == 0)
         return false;
 
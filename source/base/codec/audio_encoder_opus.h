@@ -23,6 +23,8 @@
 #include "base/codec/audio_encoder.h"
 #include "proto/desktop.pb.h"
 
+#include <chrono>
+
 struct OpusEncoder;
 
 namespace base {
@@ -33,13 +35,21 @@ class MultiChannelResampler;
 class AudioEncoderOpus : public AudioEncoder
 {
 public:
-    AudioEncoderOpus();
+    // Opus supports frame durations of 2.5, 5, 10, 20, 40 and 60 ms. We accept 5, 10 and 20 ms:
+    // the shorter frames lower the latency at the cost of a larger overhead per second.
+    static const std::chrono::milliseconds kDefaultFrameDuration;
+
+    explicit AudioEncoderOpus(std::chrono::milliseconds frame_duration = kDefaultFrameDuration);
     ~AudioEncoderOpus() override;
 
     // AudioEncoder interface.
     bool encode(const proto::AudioPacket& input_packet, proto::AudioPacket* output_packet) override;
     int bitrate() override;
 
+    static bool isValidFrameDuration(std::chrono::milliseconds frame_duration);
+
+    std::chrono::milliseconds frameDuration() const { return frame_duration_; }
+
 private:
     void initEncoder();
     void destroyEncoder();
@@ -50,6 +60,12 @@ private:
     proto::AudioPacket::Channels channels_ = proto::AudioPacket::CHANNELS_STEREO;
     OpusEncoder* encoder_ = nullptr;
 
+    const std::chrono::milliseconds frame_duration_;
+
+    // Number of samples per frame at the Opus sampling rate.
+    const int frame_samples_;
+
+    // Number of samples per frame at the input sampling rate.
     int frame_size_ = 0;
     std::unique_ptr<MultiChannelResampler> resampler_;
     std::unique_ptr<char[]> resample_buffer_;
@@ -28,6 +28,7 @@ namespace {
 
 constexpr size_t kMinCacheSize = 2;
 constexpr size_t kMaxCacheSize = 30;
+constexpr size_t kMaxKeyedCacheSize = 256;
 
 } // namespace
 
@@ -39,7 +40,7 @@ CursorDecoder::CursorDecoder()
 
 CursorDecoder::~CursorDecoder() = default;
 
-ByteArray CursorDecoder::decompressCursor(const proto::CursorShape& cursor_shape) const
+ByteArray CursorDecoder::decompressCursor(const proto::CursorShape& cursor_shape)
 {
     const std::string& data = cursor_shape.data();
 
@@ -52,6 +53,24 @@ ByteArray CursorDecoder::decompressCursor(const proto::CursorShape& cursor_shape
     size_t ret = ZSTD_initDStream(stream_.get());
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
+    if (cursor_shape.dictionary() == proto::ZSTD_DICTIONARY_CURSOR)
+    {
+        if (previous_image_.empty())
+        {
+            LOG(LS_ERROR) << "No previous cursor for the dictionary";
+            return ByteArray();
+        }
+
+        // The prefix is used only for the next frame.
+        ret = ZSTD_DCtx_refPrefix(stream_.get(), previous_image_.data(), previous_image_.size());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+    else if (cursor_shape.dictionary() != proto::ZSTD_DICTIONARY_NONE)
+    {
+        LOG(LS_ERROR) << "Unsupported dictionary: " << cursor_shape.dictionary();
+        return ByteArray();
+    }
+
     ZSTD_inBuffer input = { data.data(), data.size(), 0 };
     ZSTD_outBuffer output = { image.data(), image.size(), 0 };
 
@@ -65,6 +84,7 @@ ByteArray CursorDecoder::decompressCursor(const proto::CursorShape& cursor_shape
         }
     }
 
+    previous_image_ = image;
     return image;
 }
 
@@ -80,6 +100,9 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
             return nullptr;
         }
 
+        if (is_keyed_cache_)
+            return findInKeyedCache(cursor_shape.cache_key());
+
         // Bits 0-4 contain the cursor position in the cache.
         cache_index = cursor_shape.flags() & 0x1F;
     }
@@ -105,14 +128,33 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
 
         if (cursor_shape.flags() & proto::CursorShape::RESET_CACHE)
         {
-            size_t cache_size = cursor_shape.flags() & 0x1F;
-
-            if (cache_size < kMinCacheSize || cache_size > kMaxCacheSize)
+            is_keyed_cache_ = cursor_shape.cache_size() != 0;
+
+            size_t cache_size;
+            size_t max_cache_size;
+
+            if (is_keyed_cache_)
+            {
+                cache_size = cursor_shape.cache_size();
+                max_cache_size = kMaxKeyedCacheSize;
+            }
+            else
+            {
+                cache_size = cursor_shape.flags() & 0x1F;
+                max_cache_size = kMaxCacheSize;
+            }
+
+            if (cache_size < kMinCacheSize || cache_size > max_cache_size)
+            {
+                cache_size_.reset();
                 return nullptr;
+            }
 
             cache_size_.emplace(cache_size);
             cache_.reserve(cache_size);
             cache_.clear();
+            keyed_cache_.clear();
+            keyed_cache_index_.clear();
         }
 
         if (!cache_size_.has_value())
@@ -121,6 +163,13 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
             return nullptr;
         }
 
+        if (is_keyed_cache_)
+        {
+            std::shared_ptr<MouseCursor> shared_cursor(std::move(mouse_cursor));
+            addToKeyedCache(cursor_shape.cache_key(), shared_cursor);
+            return shared_cursor;
+        }
+
         // Add the cursor to the end of the list.
         cache_.emplace_back(std::move(mouse_cursor));
 
@@ -143,4 +192,38 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
     return cache_.at(cache_index);
 }
 
+std::shared_ptr<MouseCursor> CursorDecoder::findInKeyedCache(uint32_t key)
+{
+    auto result = keyed_cache_index_.find(key);
+    if (result == keyed_cache_index_.end())
+    {
+        LOG(LS_ERROR) << "Invalid cache key: " << key;
+        return nullptr;
+    }
+
+    // The cursor becomes the most recently used. The host does the same.
+    keyed_cache_.splice(keyed_cache_.begin(), keyed_cache_, result->second);
+    return result->second->second;
+}
+
+void CursorDecoder::addToKeyedCache(uint32_t key, std::shared_ptr<MouseCursor> mouse_cursor)
+{
+    auto result = keyed_cache_index_.find(key);
+    if (result != keyed_cache_index_.end())
+    {
+        keyed_cache_.erase(result->second);
+        keyed_cache_index_.erase(result);
+    }
+
+    keyed_cache_.emplace_front(key, std::move(mouse_cursor));
+    keyed_cache_index_.emplace(key, keyed_cache_.begin());
+
+    if (keyed_cache_.size() > cache_size_.value())
+    {
+        // Delete the least recently used cursor.
+        keyed_cache_index_.erase(keyed_cache_.back().first);
+        keyed_cache_.pop_back();
+    }
+}
+
 } // namespace base
@@ -23,7 +23,9 @@
 #include "base/codec/scoped_zstd_stream.h"
 #include "base/memory/byte_array.h"
 
+#include <list>
 #include <optional>
+#include <unordered_map>
 
 namespace proto {
 class CursorShape;
@@ -42,12 +44,26 @@ public:
     std::shared_ptr<MouseCursor> decode(const proto::CursorShape& cursor_shape);
 
 private:
-    ByteArray decompressCursor(const proto::CursorShape& cursor_shape) const;
+    using KeyedCache = std::list<std::pair<uint32_t, std::shared_ptr<MouseCursor>>>;
+
+    ByteArray decompressCursor(const proto::CursorShape& cursor_shape);
+    std::shared_ptr<MouseCursor> findInKeyedCache(uint32_t key);
+    void addToKeyedCache(uint32_t key, std::shared_ptr<MouseCursor> mouse_cursor);
 
     std::vector<std::shared_ptr<MouseCursor>> cache_;
     std::optional<size_t> cache_size_;
+
+    // The keyed cache is used if the host passed its size with the reset command. The most
+    // recently used cursor is at the front of the list.
+    bool is_keyed_cache_ = false;
+    KeyedCache keyed_cache_;
+    std::unordered_map<uint32_t, KeyedCache::iterator> keyed_cache_index_;
     ScopedZstdDStream stream_;
 
+    // The image of the last decompressed cursor. It is the dictionary for the next image if the
+    // host uses proto::ZSTD_DICTIONARY_CURSOR.
+    ByteArray previous_image_;
+
     DISALLOW_COPY_AND_ASSIGN(CursorDecoder);
 };
 
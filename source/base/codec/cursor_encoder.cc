@@ -31,6 +31,9 @@ namespace {
 // Cache size can be in the range from 2 to 30.
 constexpr size_t kCacheSize = 30;
 
+// Size of the keyed cache.
+constexpr size_t kKeyedCacheSize = 256;
+
 // The compression ratio can be in the range of 1 to 22.
 constexpr int kCompressionRatio = 8;
 
@@ -45,24 +48,38 @@ uint8_t* outputBuffer(proto::CursorShape* cursor_shape, size_t size)
 
 } // namespace
 
-CursorEncoder::CursorEncoder()
-    : stream_(ZSTD_createCStream())
+CursorEncoder::CursorEncoder(CacheType cache_type, bool use_dictionary)
+    : cache_type_(cache_type),
+      use_dictionary_(use_dictionary),
+      stream_(ZSTD_createCStream())
 {
     static_assert(kCacheSize >= 2 && kCacheSize <= 30);
     static_assert(kCompressionRatio >= 1 && kCompressionRatio <= 22);
 
     // Reserve memory for the maximum number of elements in the cache.
-    cache_.reserve(kCacheSize);
+    if (cache_type_ == CacheType::INDEXED)
+        cache_.reserve(kCacheSize);
+    else
+        keyed_cache_index_.reserve(kKeyedCacheSize + 1);
 }
 
 CursorEncoder::~CursorEncoder() = default;
 
 bool CursorEncoder::compressCursor(
-    const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape) const
+    const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape)
 {
     size_t ret = ZSTD_initCStream(stream_.get(), kCompressionRatio);
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
+    if (use_dictionary_ && !previous_image_.empty())
+    {
+        // The prefix is used only for the next frame.
+        ret = ZSTD_CCtx_refPrefix(stream_.get(), previous_image_.data(), previous_image_.size());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        cursor_shape->set_dictionary(proto::ZSTD_DICTIONARY_CURSOR);
+    }
+
     const size_t input_size = mouse_cursor.constImage().size();
     const uint8_t* input_data = mouse_cursor.constImage().data();
 
@@ -86,6 +103,10 @@ bool CursorEncoder::compressCursor(
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
     cursor_shape->mutable_data()->resize(output.pos);
+
+    if (use_dictionary_)
+        previous_image_ = mouse_cursor.constImage();
+
     return true;
 }
 
@@ -107,16 +128,29 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
                                      mouse_cursor.constImage().size(),
                                      kHashingSeed);
 
-    // Trying to find cursor in cache.
-    for (size_t index = 0; index < cache_.size(); ++index)
+    if (cache_type_ == CacheType::KEYED)
     {
-        if (cache_[index] == hash)
+        if (findInKeyedCache(hash))
         {
             // Cursor found in cache.
-            cursor_shape->set_flags(proto::CursorShape::CACHE | (index & 0x1F));
+            cursor_shape->set_flags(proto::CursorShape::CACHE);
+            cursor_shape->set_cache_key(hash);
             return true;
         }
     }
+    else
+    {
+        // Trying to find cursor in cache.
+        for (size_t index = 0; index < cache_.size(); ++index)
+        {
+            if (cache_[index] == hash)
+            {
+                // Cursor found in cache.
+                cursor_shape->set_flags(proto::CursorShape::CACHE | (index & 0x1F));
+                return true;
+            }
+        }
+    }
 
     // Set cursor parameters.
     cursor_shape->set_width(size.width());
@@ -128,6 +162,19 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
     if (!compressCursor(mouse_cursor, cursor_shape))
         return false;
 
+    if (cache_type_ == CacheType::KEYED)
+    {
+        if (keyed_cache_.empty())
+        {
+            cursor_shape->set_flags(proto::CursorShape::RESET_CACHE);
+            cursor_shape->set_cache_size(kKeyedCacheSize);
+        }
+
+        cursor_shape->set_cache_key(hash);
+        addToKeyedCache(hash);
+        return true;
+    }
+
     if (cache_.empty())
     {
         // If the cache is empty, then set the cache reset flag on the client side and pass the
@@ -148,4 +195,28 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
     return true;
 }
 
+bool CursorEncoder::findInKeyedCache(uint32_t hash)
+{
+    auto result = keyed_cache_index_.find(hash);
+    if (result == keyed_cache_index_.end())
+        return false;
+
+    // The cursor becomes the most recently used. The client does the same.
+    keyed_cache_.splice(keyed_cache_.begin(), keyed_cache_, result->second);
+    return true;
+}
+
+void CursorEncoder::addToKeyedCache(uint32_t hash)
+{
+    keyed_cache_.push_front(hash);
+    keyed_cache_index_[hash] = keyed_cache_.begin();
+
+    if (keyed_cache_.size() > kKeyedCacheSize)
+    {
+        // Delete the least recently used cursor.
+        keyed_cache_index_.erase(keyed_cache_.back());
+        keyed_cache_.pop_back();
+    }
+}
+
 } // namespace base
@@ -21,7 +21,10 @@
 
 #include "base/macros_magic.h"
 #include "base/codec/scoped_zstd_stream.h"
+#include "base/memory/byte_array.h"
 
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 namespace proto {
@@ -32,20 +35,47 @@ namespace base {
 
 class MouseCursor;
 
+// Every new cursor image is compressed with Zstd. A single cursor of a few kilobytes has little
+// history to find the matches in, so the encoder may use the previous compressed image as the
+// dictionary (the client must support proto::ZSTD_DICTIONARY_CURSOR). The frames of the animated
+// cursors differ a little, so they are compressed better.
 class CursorEncoder
 {
 public:
-    CursorEncoder();
+    enum class CacheType
+    {
+        // Up to 30 cursors which are identified by the position in the cache.
+        INDEXED,
+
+        // Up to 256 cursors which are identified by the hash of the image. The least recently
+        // used cursor is removed when the cache is full.
+        KEYED
+    };
+
+    explicit CursorEncoder(CacheType cache_type = CacheType::INDEXED, bool use_dictionary = false);
     ~CursorEncoder();
 
     bool encode(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape);
 
 private:
-    bool compressCursor(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape) const;
+    bool compressCursor(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape);
+    bool findInKeyedCache(uint32_t hash);
+    void addToKeyedCache(uint32_t hash);
+
+    const CacheType cache_type_;
+    const bool use_dictionary_;
 
     ScopedZstdCStream stream_;
+
+    // The image of the last compressed cursor. The client keeps the same one.
+    ByteArray previous_image_;
+
     std::vector<uint32_t> cache_;
 
+    // The most recently used cursor is at the front of the list.
+    std::list<uint32_t> keyed_cache_;
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> keyed_cache_index_;
+
     DISALLOW_COPY_AND_ASSIGN(CursorEncoder);
 };
 
@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/cursor_encoder.h"
+
+#include "base/codec/cursor_decoder.h"
+#include "base/desktop/mouse_cursor.h"
+#include "proto/desktop.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+constexpr int kFrameCount = 12;
+
+// A frame of the animated "busy" cursor: a ring of segments where the bright segment moves with
+// each frame.
+MouseCursor busyCursor(int size, int frame)
+{
+    ByteArray image(static_cast<size_t>(size * size) * sizeof(uint32_t));
+    uint32_t* pixels = reinterpret_cast<uint32_t*>(image.data());
+
+    const double center = size / 2.0;
+    const double pi = std::acos(-1.0);
+
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            const double dx = x + 0.5 - center;
+            const double dy = y + 0.5 - center;
+            const double radius = std::sqrt(dx * dx + dy * dy);
+
+            uint32_t pixel = 0;
+
+            if (radius > size * 0.25 && radius < size * 0.45)
+            {
+                const double angle = std::atan2(dy, dx) + pi;
+                const int segment = static_cast<int>(angle / (2 * pi) * kFrameCount) % kFrameCount;
+                const uint32_t value = 255 - ((segment - frame + kFrameCount) % kFrameCount) * 16;
+
+                pixel = 0xFF000000 | (value << 16) | ((value / 2) << 8) | 0x28;
+            }
+
+            pixels[y * size + x] = pixel;
+        }
+    }
+
+    return MouseCursor(std::move(image), Size(size, size), Point(size / 2, size / 2));
+}
+
+size_t encodeAnimation(bool use_dictionary, int size)
+{
+    CursorEncoder encoder(CursorEncoder::CacheType::KEYED, use_dictionary);
+    CursorDecoder decoder;
+
+    size_t total_size = 0;
+
+    for (int frame = 0; frame < kFrameCount; ++frame)
+    {
+        const MouseCursor cursor = busyCursor(size, frame);
+
+        proto::CursorShape cursor_shape;
+        EXPECT_TRUE(encoder.encode(cursor, &cursor_shape));
+
+        // The first image has no previous one.
+        const bool with_dictionary = use_dictionary && frame != 0;
+        EXPECT_EQ(cursor_shape.dictionary() == proto::ZSTD_DICTIONARY_CURSOR, with_dictionary);
+
+        std::shared_ptr<MouseCursor> decoded = decoder.decode(cursor_shape);
+        EXPECT_NE(decoded, nullptr);
+        if (!decoded)
+            break;
+
+        EXPECT_EQ(decoded->constImage(), cursor.constImage());
+        total_size += cursor_shape.data().size();
+    }
+
+    return total_size;
+}
+
+} // namespace
+
+TEST(CursorEncoderTest, previous_cursor_dictionary)
+{
+    for (int size : { 32, 48 })
+    {
+        const size_t plain_size = encodeAnimation(false, size);
+        const size_t dictionary_size = encodeAnimation(true, size);
+
+        EXPECT_LT(dictionary_size, plain_size);
+    }
+}
+
+TEST(CursorEncoderTest, dictionary_without_previous_cursor)
+{
+    CursorEncoder encoder(CursorEncoder::CacheType::KEYED, true);
+
+    proto::CursorShape first_shape;
+    ASSERT_TRUE(encoder.encode(busyCursor(32, 0), &first_shape));
+
+    proto::CursorShape second_shape;
+    ASSERT_TRUE(encoder.encode(busyCursor(32, 1), &second_shape));
+    ASSERT_EQ(second_shape.dictionary(), proto::ZSTD_DICTIONARY_CURSOR);
+
+    // The decoder has not received the first image.
+    second_shape.set_flags(proto::CursorShape::RESET_CACHE);
+    second_shape.set_cache_size(256);
+
+    CursorDecoder decoder;
+    EXPECT_EQ(decoder.decode(second_shape), nullptr);
+}
+
+} // namespace base
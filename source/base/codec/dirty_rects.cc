@@ -0,0 +1,173 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/dirty_rects.h"
+
+#include "base/logging.h"
+#include "proto/desktop.pb.h"
+
+#include <limits>
+
+namespace base {
+
+namespace {
+
+// A 32-bit value takes up to 5 bytes.
+constexpr int kMaxVarintSize = 5;
+
+void writeVarint(uint32_t value, std::string* out)
+{
+    while (value >= 0x80)
+    {
+        out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out->push_back(static_cast<char>(value));
+}
+
+bool readVarint(std::string_view* in, uint32_t* value)
+{
+    uint64_t result = 0;
+
+    for (int i = 0; i < kMaxVarintSize && !in->empty(); ++i)
+    {
+        const uint8_t byte = static_cast<uint8_t>(in->front());
+        in->remove_prefix(1);
+
+        result |= static_cast<uint64_t>(byte & 0x7F) << (i * 7);
+
+        if (!(byte & 0x80))
+        {
+            if (result > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+                return false;
+
+            *value = static_cast<uint32_t>(result);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+void packRects(const Region& region, std::string* out)
+{
+    Rect previous;
+    bool first = true;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        DCHECK(first || rect.top() >= previous.top());
+
+        const bool same_band = !first && rect.top() == previous.top() &&
+            rect.height() == previous.height();
+        DCHECK(!same_band || rect.left() >= previous.right());
+
+        writeVarint(static_cast<uint32_t>(rect.top() - (first ? 0 : previous.top())), out);
+        writeVarint(static_cast<uint32_t>(rect.height()), out);
+        writeVarint(static_cast<uint32_t>(rect.left() - (same_band ? previous.right() : 0)), out);
+        writeVarint(static_cast<uint32_t>(rect.width()), out);
+
+        previous = rect;
+        first = false;
+    }
+}
+
+bool unpackRects(std::string_view in, std::vector<Rect>* rects)
+{
+    DCHECK(rects);
+
+    constexpr int64_t kMaxCoordinate = std::numeric_limits<int32_t>::max();
+
+    Rect previous;
+    bool first = true;
+
+    while (!in.empty())
+    {
+        uint32_t top_offset;
+        uint32_t height;
+        uint32_t left;
+        uint32_t width;
+
+        if (!readVarint(&in, &top_offset) || !readVarint(&in, &height) ||
+            !readVarint(&in, &left) || !readVarint(&in, &width))
+        {
+            LOG(LS_WARNING) << "Malformed packed rects";
+            return false;
+        }
+
+        const int64_t top = (first ? 0 : static_cast<int64_t>(previous.top())) + top_offset;
+        const bool same_band = !first && top == previous.top() &&
+            static_cast<int64_t>(height) == previous.height();
+        const int64_t x = (same_band ? static_cast<int64_t>(previous.right()) : 0) + left;
+
+        if (top + height > kMaxCoordinate || x + width > kMaxCoordinate)
+        {
+            LOG(LS_WARNING) << "Packed rect out of range";
+            return false;
+        }
+
+        previous = Rect::makeXYWH(static_cast<int32_t>(x), static_cast<int32_t>(top),
+                                  static_cast<int32_t>(width), static_cast<int32_t>(height));
+        rects->emplace_back(previous);
+        first = false;
+    }
+
+    return true;
+}
+
+void setDirtyRects(const Region& region, bool packed, proto::VideoPacket* packet)
+{
+    if (packed)
+    {
+        packRects(region, packet->mutable_packed_dirty_rects());
+        return;
+    }
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        proto::Rect* dirty_rect = packet->add_dirty_rect();
+        dirty_rect->set_x(rect.x());
+        dirty_rect->set_y(rect.y());
+        dirty_rect->set_width(rect.width());
+        dirty_rect->set_height(rect.height());
+    }
+}
+
+bool dirtyRects(const proto::VideoPacket& packet, std::vector<Rect>* rects)
+{
+    DCHECK(rects);
+
+    rects->reserve(rects->size() + packet.dirty_rect_size());
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        const proto::Rect& dirty_rect = packet.dirty_rect(i);
+        rects->emplace_back(Rect::makeXYWH(
+            dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height()));
+    }
+
+    return unpackRects(packet.packed_dirty_rects(), rects);
+}
+
+} // namespace base
@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__DIRTY_RECTS_H
+#define BASE__CODEC__DIRTY_RECTS_H
+
+#include "base/desktop/region.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace proto {
+class VideoPacket;
+} // namespace proto
+
+namespace base {
+
+// The dirty rects of a video packet are sent as the list of |dirty_rect| messages or, if the
+// client supports proto::ENABLE_PACKED_DIRTY_RECTS, packed into |packed_dirty_rects|.
+// The packed rects follow the order of Region::Iterator. Each rect is four varints:
+//   - the offset of the top edge from the top edge of the previous rect;
+//   - the height;
+//   - the left edge. If the rect is in the same band as the previous one (the same top edge and
+//     height), it is the offset from the right edge of the previous rect;
+//   - the width.
+// The rects from the blocks of the differ usually take 4-5 bytes instead of about 12.
+
+// Appends the rects of |region| to |out| in the packed form.
+void packRects(const Region& region, std::string* out);
+
+// Appends the packed rects of |in| to |rects|. Returns false if the data is malformed.
+bool unpackRects(std::string_view in, std::vector<Rect>* rects);
+
+// Writes the rects of |region| to |packet| in the packed or in the plain form.
+void setDirtyRects(const Region& region, bool packed, proto::VideoPacket* packet);
+
+// Reads the dirty rects of |packet| in any form. Returns false if the packed rects are malformed.
+bool dirtyRects(const proto::VideoPacket& packet, std::vector<Rect>* rects);
+
+} // namespace base
+
+#endif // BASE__CODEC__DIRTY_RECTS_H
@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/dirty_rects.h"
+
+#include "proto/desktop.pb.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+// Scattered blocks of 32x32 pixels like the updates of a terminal or a spreadsheet.
+Region scatteredBlocks()
+{
+    Region region;
+
+    for (int y = 0; y < 1080; y += 32)
+    {
+        for (int x = (y / 32) % 3 * 32; x < 1920; x += 96)
+            region.addRect(Rect::makeXYWH(x, y, 32, 32));
+    }
+
+    // The edges of the screen are not aligned to the blocks.
+    region.intersectWith(Rect::makeWH(1900, 1060));
+    return region;
+}
+
+std::vector<Rect> regionRects(const Region& region)
+{
+    std::vector<Rect> rects;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        rects.emplace_back(it.rect());
+
+    return rects;
+}
+
+} // namespace
+
+TEST(DirtyRectsTest, pack_unpack)
+{
+    const Region region = scatteredBlocks();
+
+    std::string packed;
+    packRects(region, &packed);
+
+    std::vector<Rect> rects;
+    ASSERT_TRUE(unpackRects(packed, &rects));
+    EXPECT_EQ(rects, regionRects(region));
+
+    // The same rects as the list of messages.
+    proto::VideoPacket packet;
+    setDirtyRects(region, false, &packet);
+    EXPECT_EQ(packet.dirty_rect_size(), static_cast<int>(rects.size()));
+    EXPECT_LT(packed.size() * 2, packet.ByteSizeLong());
+}
+
+TEST(DirtyRectsTest, empty_region)
+{
+    std::string packed;
+    packRects(Region(), &packed);
+    EXPECT_TRUE(packed.empty());
+
+    std::vector<Rect> rects;
+    EXPECT_TRUE(unpackRects(packed, &rects));
+    EXPECT_TRUE(rects.empty());
+}
+
+TEST(DirtyRectsTest, packet)
+{
+    const Region region = scatteredBlocks();
+
+    for (bool packed : { false, true })
+    {
+        proto::VideoPacket packet;
+        setDirtyRects(region, packed, &packet);
+
+        EXPECT_EQ(packet.dirty_rect_size() == 0, packed);
+        EXPECT_EQ(packet.packed_dirty_rects().empty(), !packed);
+
+        std::vector<Rect> rects;
+        ASSERT_TRUE(dirtyRects(packet, &rects));
+        EXPECT_EQ(rects, regionRects(region));
+    }
+}
+
+TEST(DirtyRectsTest, malformed)
+{
+    std::string packed;
+    packRects(Region(Rect::makeXYWH(100, 200, 300, 400)), &packed);
+
+    std::vector<Rect> rects;
+
+    // A rect without the last varint.
+    EXPECT_FALSE(unpackRects(std::string_view(packed).substr(0, packed.size() - 1), &rects));
+
+    // A varint without the end.
+    EXPECT_FALSE(unpackRects(std::string("\x80\x80", 2), &rects));
+
+    // A value which is larger than 32 bits.
+    EXPECT_FALSE(unpackRects(std::string("\xFF\xFF\xFF\xFF\x7F\x01\x01\x01", 8), &rects));
+
+    // A rect which exceeds the range of the coordinates.
+    EXPECT_FALSE(unpackRects(std::string("\x01\x01\xFE\xFF\xFF\xFF\x07\x02", 8), &rects));
+}
+
+} // namespace base
@@ -25,10 +25,38 @@
 
 namespace base {
 
+namespace {
+
+int integerScaleFactor(const Size& source_size, const Size& target_size)
+{
+    static const int kFactors[] = { 2, 4 };
+
+    for (int factor : kFactors)
+    {
+        if (source_size.width() == target_size.width() * factor &&
+            source_size.height() == target_size.height() * factor)
+        {
+            return factor;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
 ScaleReducer::ScaleReducer() = default;
 
 ScaleReducer::~ScaleReducer() = default;
 
+size_t ScaleReducer::memoryUsage() const
+{
+    if (!target_frame_)
+        return 0;
+
+    return static_cast<size_t>(target_frame_->stride()) * target_frame_->size().height();
+}
+
 const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& target_size)
 {
     DCHECK(source_frame);
@@ -46,15 +74,22 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
             static_cast<double>(source_size.height());
         source_size_ = source_size;
         target_size_ = target_size;
+        integer_factor_ = integerScaleFactor(source_size, target_size);
         target_frame_.reset();
 
         LOG(LS_INFO) << "Scale mode changed (dpi:" << source_frame->dpi()
                      << " source:" << source_size << " target:" << target_size
-                     << " scale_x:" << scale_x_ << " scale_y:" << scale_y_ << ")";
+                     << " scale_x:" << scale_x_ << " scale_y:" << scale_y_
+                     << " integer_factor:" << integer_factor_ << ")";
     }
 
     if (source_size == target_size)
+    {
+        last_scale_time_ = std::chrono::microseconds::zero();
         return source_frame;
+    }
+
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
 
     Rect target_frame_rect = Rect::makeSize(target_size);
 
@@ -78,12 +113,17 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
     }
     else
     {
-        Region* updated_region = target_frame_->updatedRegion();
-        updated_region->clear();
+        updated_rects_.clear();
 
         for (Region::Iterator it(source_frame->constUpdatedRegion());
              !it.isAtEnd(); it.advance())
         {
+            if (integer_factor_)
+            {
+                updated_rects_.emplace_back(scaleRectExact(source_frame, it.rect()));
+                continue;
+            }
+
             Rect target_rect = scaledRect(it.rect());
             target_rect.intersectWith(target_frame_rect);
 
@@ -101,13 +141,50 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
                                   target_rect.height(),
                                   libyuv::kFilterBox);
 
-            updated_region->addRect(target_rect);
+            updated_rects_.emplace_back(target_rect);
         }
+
+        Region* updated_region = target_frame_->updatedRegion();
+        updated_region->clear();
+        updated_region->addRects(updated_rects_.data(), static_cast<int>(updated_rects_.size()));
     }
 
+    last_scale_time_ = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+
     return target_frame_.get();
 }
 
+Rect ScaleReducer::scaleRectExact(const Frame* source_frame, const Rect& source_rect)
+{
+    const int factor = integer_factor_;
+
+    // Each target pixel is the average of a |factor| x |factor| block of the source, so the
+    // rectangle is expanded to whole blocks and no padding for the filter is needed.
+    Rect target_rect = Rect::makeLTRB(source_rect.left() / factor,
+                                      source_rect.top() / factor,
+                                      (source_rect.right() + factor - 1) / factor,
+                                      (source_rect.bottom() + factor - 1) / factor);
+    target_rect.intersectWith(Rect::makeSize(target_size_));
+
+    if (target_rect.isEmpty())
+        return target_rect;
+
+    // libyuv uses its SIMD 2x and 4x box kernels for these sizes.
+    libyuv::ARGBScale(source_frame->frameDataAtPos(target_rect.x() * factor,
+                                                   target_rect.y() * factor),
+                      source_frame->stride(),
+                      target_rect.width() * factor,
+                      target_rect.height() * factor,
+                      target_frame_->frameDataAtPos(target_rect.topLeft()),
+                      target_frame_->stride(),
+                      target_rect.width(),
+                      target_rect.height(),
+                      libyuv::kFilterBox);
+
+    return target_rect;
+}
+
 Rect ScaleReducer::scaledRect(const Rect& source_rect)
 {
     int left = static_cast<int>(
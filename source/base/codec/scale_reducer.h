@@ -22,7 +22,9 @@
 #include "base/macros_magic.h"
 #include "base/desktop/geometry.h"
 
+#include <chrono>
 #include <memory>
+#include <vector>
 
 namespace base {
 
@@ -39,15 +41,33 @@ public:
     double scaleFactorX() const { return scale_x_; }
     double scaleFactorY() const { return scale_y_; }
 
+    // Returns the time spent on scaling of the last frame.
+    std::chrono::microseconds lastScaleTime() const { return last_scale_time_; }
+
+    // Returns the size of the scaled frame.
+    size_t memoryUsage() const;
+
 private:
     Rect scaledRect(const Rect& source_rect);
 
+    // Scales |source_rect| when the source is exactly |integer_factor_| times larger than the
+    // target. Returns the updated rectangle of the target frame.
+    Rect scaleRectExact(const Frame* source_frame, const Rect& source_rect);
+
     std::unique_ptr<Frame> target_frame_;
     Size source_size_;
     Size target_size_;
     double scale_x_ = 0;
     double scale_y_ = 0;
 
+    // 2 or 4 if the source is exactly that many times larger in both dimensions, otherwise 0.
+    int integer_factor_ = 0;
+
+    // The updated rectangles of the target frame. They are added to its region at once.
+    std::vector<Rect> updated_rects_;
+
+    std::chrono::microseconds last_scale_time_{ 0 };
+
     DISALLOW_COPY_AND_ASSIGN(ScaleReducer);
 };
 
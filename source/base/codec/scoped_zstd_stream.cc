@@ -30,4 +30,14 @@ void ZstdDStreamDeleter::operator()(ZSTD_DStream* dstream)
     ZSTD_freeDStream(dstream);
 }
 
+void ZstdCDictDeleter::operator()(ZSTD_CDict* cdict)
+{
+    ZSTD_freeCDict(cdict);
+}
+
+void ZstdDDictDeleter::operator()(ZSTD_DDict* ddict)
+{
+    ZSTD_freeDDict(ddict);
+}
+
 } // namespace base
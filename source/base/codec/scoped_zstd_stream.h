@@ -35,8 +35,20 @@ struct ZstdDStreamDeleter
     void operator()(ZSTD_DStream* dstream);
 };
 
+struct ZstdCDictDeleter
+{
+    void operator()(ZSTD_CDict* cdict);
+};
+
+struct ZstdDDictDeleter
+{
+    void operator()(ZSTD_DDict* ddict);
+};
+
 using ScopedZstdCStream = std::unique_ptr<ZSTD_CStream, ZstdCStreamDeleter>;
 using ScopedZstdDStream = std::unique_ptr<ZSTD_DStream, ZstdDStreamDeleter>;
+using ScopedZstdCDict = std::unique_ptr<ZSTD_CDict, ZstdCDictDeleter>;
+using ScopedZstdDDict = std::unique_ptr<ZSTD_DDict, ZstdDDictDeleter>;
 
 } // namespace base
 
@@ -90,6 +90,7 @@
 #include "base/codec/sinc_resampler.h"
 
 #include "base/logging.h"
+#include "base/codec/sinc_resampler_avx2.h"
 
 #include <cmath>
 #include <cstring>
@@ -97,12 +98,13 @@
 
 #if defined(ARCH_CPU_X86_FAMILY)
 #include <xmmintrin.h>
-#define CONVOLVE_FUNC Convolve_SSE
+#include <libyuv/cpu_id.h>
 #elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
-#include <arm_neon.h>
-#define CONVOLVE_FUNC Convolve_NEON
+#if defined(CC_MSVC)
+#include <arm64_neon.h>
 #else
-#define CONVOLVE_FUNC Convolve_C
+#include <arm_neon.h>
+#endif // defined(CC_*)
 #endif
 
 namespace base {
@@ -161,7 +163,8 @@ static int CalculateChunkSize(int block_size_, double io_ratio)
 SincResampler::SincResampler(double io_sample_rate_ratio,
                              int request_frames,
                              const ReadCB& read_cb)
-    : io_sample_rate_ratio_(io_sample_rate_ratio),
+    : convolve_(convolveFunction()),
+      io_sample_rate_ratio_(io_sample_rate_ratio),
       read_cb_(read_cb),
       request_frames_(request_frames),
       input_buffer_size_(request_frames_ + kKernelSize),
@@ -310,7 +313,7 @@ void SincResampler::Resample(int frames, float* destination)
 
                 // Figure out how much to weight each kernel's "convolution".
                 const double kernel_interpolation_factor = virtual_offset_idx - offset_idx;
-                *destination++ = CONVOLVE_FUNC(input_ptr, k1, k2, kernel_interpolation_factor);
+                *destination++ = convolve_(input_ptr, k1, k2, kernel_interpolation_factor);
 
                 // Advance the virtual index.
                 virtual_source_idx_ += io_sample_rate_ratio_;
@@ -358,6 +361,22 @@ double SincResampler::BufferedFrames() const
     return buffer_primed_ ? request_frames_ - virtual_source_idx_ : 0;
 }
 
+// static
+SincResampler::ConvolveFunc SincResampler::convolveFunction()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        return Convolve_AVX2;
+
+    return Convolve_SSE;
+#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+    return Convolve_NEON;
+#else
+    return Convolve_C;
+#endif
+}
+
+// static
 float SincResampler::Convolve_C(const float* input_ptr, const float* k1,
                                 const float* k2,
                                 double kernel_interpolation_factor)
@@ -379,6 +398,7 @@ float SincResampler::Convolve_C(const float* input_ptr, const float* k1,
 }
 
 #if defined(ARCH_CPU_X86_FAMILY)
+// static
 float SincResampler::Convolve_SSE(const float* input_ptr, const float* k1,
                                   const float* k2,
                                   double kernel_interpolation_factor)
@@ -420,7 +440,16 @@ float SincResampler::Convolve_SSE(const float* input_ptr, const float* k1,
 
     return result;
 }
+
+// static
+float SincResampler::Convolve_AVX2(const float* input_ptr, const float* k1,
+                                   const float* k2,
+                                   double kernel_interpolation_factor)
+{
+    return sincConvolve_AVX2(input_ptr, k1, k2, kKernelSize, kernel_interpolation_factor);
+}
 #elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+// static
 float SincResampler::Convolve_NEON(const float* input_ptr, const float* k1,
                                    const float* k2,
                                    double kernel_interpolation_factor)
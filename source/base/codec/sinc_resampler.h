@@ -95,26 +95,38 @@ public:
     // Zero before first call to Resample().
     double BufferedFrames() const;
 
-private:
-    void InitializeKernel();
-    void UpdateRegions(bool second_load);
+    using ConvolveFunc = float(*)(const float* input_ptr, const float* k1, const float* k2,
+                                  double kernel_interpolation_factor);
 
     // Compute convolution of |k1| and |k2| over |input_ptr|, resultant sums are
     // linearly interpolated using |kernel_interpolation_factor|.  On x86, the
-    // underlying implementation is chosen at run time based on SSE support.  On
-    // ARM, NEON support is chosen at compile time based on compilation flags.
+    // underlying implementation is chosen at run time based on SSE and AVX2
+    // support.  On ARM, NEON support is chosen at compile time (see USE_NEON).
+    // The functions are public for the tests and benchmarks.
+    static ConvolveFunc convolveFunction();
+
     static float Convolve_C(const float* input_ptr, const float* k1,
                             const float* k2, double kernel_interpolation_factor);
 #if defined(ARCH_CPU_X86_FAMILY)
     static float Convolve_SSE(const float* input_ptr, const float* k1,
                               const float* k2,
                               double kernel_interpolation_factor);
+    static float Convolve_AVX2(const float* input_ptr, const float* k1,
+                               const float* k2,
+                               double kernel_interpolation_factor);
 #elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
     static float Convolve_NEON(const float* input_ptr, const float* k1,
                                const float* k2,
                                double kernel_interpolation_factor);
 #endif
 
+private:
+    void InitializeKernel();
+    void UpdateRegions(bool second_load);
+
+    // The fastest implementation of the convolution supported by the CPU.
+    const ConvolveFunc convolve_;
+
     // The ratio of input / output sample rates.
     double io_sample_rate_ratio_;
 
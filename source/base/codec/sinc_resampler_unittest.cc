@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/sinc_resampler.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+// The vector versions sum the products in a different order, so the results are not exactly the
+// same as for the C version.
+const float kEpsilon = 1e-5f;
+
+class SincResamplerConvolveTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // One extra float for the unaligned input.
+        input_.reset(static_cast<float*>(alignedAlloc(sizeof(float) * (kSize + 1), 16)));
+        k1_.reset(static_cast<float*>(alignedAlloc(sizeof(float) * kSize, 16)));
+        k2_.reset(static_cast<float*>(alignedAlloc(sizeof(float) * kSize, 16)));
+
+        for (int i = 0; i < kSize + 1; ++i)
+            input_.get()[i] = std::sin(static_cast<float>(i) * 0.37f);
+
+        for (int i = 0; i < kSize; ++i)
+        {
+            k1_.get()[i] = std::cos(static_cast<float>(i) * 0.21f) / kSize;
+            k2_.get()[i] = std::cos(static_cast<float>(i) * 0.23f) / kSize;
+        }
+    }
+
+    void compare(SincResampler::ConvolveFunc convolve)
+    {
+        for (double factor : { 0.0, 0.25, 0.5, 0.999 })
+        {
+            // Aligned and unaligned input.
+            for (int offset : { 0, 1 })
+            {
+                const float* input = input_.get() + offset;
+
+                EXPECT_NEAR(convolve(input, k1_.get(), k2_.get(), factor),
+                            SincResampler::Convolve_C(input, k1_.get(), k2_.get(), factor),
+                            kEpsilon) << "factor " << factor << ", offset " << offset;
+            }
+        }
+    }
+
+    static const int kSize = SincResampler::kKernelSize;
+
+    std::unique_ptr<float[], AlignedFreeDeleter> input_;
+    std::unique_ptr<float[], AlignedFreeDeleter> k1_;
+    std::unique_ptr<float[], AlignedFreeDeleter> k2_;
+};
+
+} // namespace
+
+TEST_F(SincResamplerConvolveTest, selected)
+{
+    compare(SincResampler::convolveFunction());
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+TEST_F(SincResamplerConvolveTest, sse)
+{
+    compare(SincResampler::Convolve_SSE);
+}
+
+TEST_F(SincResamplerConvolveTest, avx2)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        return;
+
+    compare(SincResampler::Convolve_AVX2);
+}
+
+#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+
+TEST_F(SincResamplerConvolveTest, neon)
+{
+    compare(SincResampler::Convolve_NEON);
+}
+
+#endif // defined(ARCH_CPU_*)
+
+} // namespace base
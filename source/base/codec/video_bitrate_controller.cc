@@ -0,0 +1,78 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_bitrate_controller.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+// If the queue is longer, the channel is considered congested.
+const size_t kCongestionThreshold = 2;
+
+// If the send queue of the socket holds more data than is sent in this time, the channel is
+// considered congested.
+const int64_t kSocketDelayThresholdMs = 200;
+
+bool isSocketCongested(int64_t speed_tx, size_t socket_pending_bytes)
+{
+    if (speed_tx <= 0)
+        return false;
+
+    return static_cast<int64_t>(socket_pending_bytes) > speed_tx * kSocketDelayThresholdMs / 1000;
+}
+
+} // namespace
+
+VideoBitrateController::VideoBitrateController()
+    : target_bitrate_(kDefaultBitrate)
+{
+    // Nothing
+}
+
+bool VideoBitrateController::update(
+    int64_t speed_tx, size_t pending_messages, size_t socket_pending_bytes)
+{
+    const uint32_t last_bitrate = target_bitrate_;
+    uint32_t bitrate = target_bitrate_;
+
+    if (pending_messages > kCongestionThreshold ||
+        isSocketCongested(speed_tx, socket_pending_bytes))
+    {
+        // Multiplicative decrease. The measured throughput is the best estimate of the link
+        // capacity, so we go a little below it to let the queue drain.
+        bitrate = bitrate * 3 / 4;
+
+        const int64_t measured_bitrate = speed_tx * 8 / 1000;
+        if (measured_bitrate > 0)
+            bitrate = std::min(bitrate, static_cast<uint32_t>(measured_bitrate * 9 / 10));
+    }
+    else if (pending_messages == 0)
+    {
+        // Additive increase. The measured throughput is not used here: with the empty queue it
+        // shows how much the encoder produced, not how much the link can carry.
+        bitrate += std::max(bitrate / 8, kMinBitrate / 2);
+    }
+
+    target_bitrate_ = std::clamp(bitrate, kMinBitrate, kMaxBitrate);
+    return target_bitrate_ != last_bitrate;
+}
+
+} // namespace base
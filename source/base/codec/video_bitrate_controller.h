@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_BITRATE_CONTROLLER_H
+#define BASE__CODEC__VIDEO_BITRATE_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Chooses the target bitrate of the video encoder from the state of the network channel. When the
+// outgoing queue grows, the link cannot carry the current stream and the bitrate is decreased
+// below the measured throughput. When the queue is empty, the bitrate is slowly increased to
+// improve the quality on fast links.
+class VideoBitrateController
+{
+public:
+    VideoBitrateController();
+    ~VideoBitrateController() = default;
+
+    static constexpr uint32_t kMinBitrate = 200; // kbps
+    static constexpr uint32_t kMaxBitrate = 20000; // kbps
+    static constexpr uint32_t kDefaultBitrate = 1000; // kbps
+
+    // |speed_tx| is the outgoing speed of the channel in bytes per second.
+    // |pending_messages| is the number of messages in the outgoing queue of the channel.
+    // |socket_pending_bytes| is the number of bytes in the send queue of the socket which are not
+    // sent yet. The queue of the channel stays short while the socket buffer is large, so it is
+    // checked too. The bytes in flight must not be counted: on a link with a long round trip time
+    // they exceed the threshold even when the link is not congested.
+    // Returns true if the target bitrate has been changed.
+    bool update(int64_t speed_tx, size_t pending_messages, size_t socket_pending_bytes = 0);
+
+    // Returns the target bitrate in kbps.
+    uint32_t targetBitrate() const { return target_bitrate_; }
+
+private:
+    uint32_t target_bitrate_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoBitrateController);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_BITRATE_CONTROLLER_H
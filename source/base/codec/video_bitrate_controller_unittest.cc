@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_bitrate_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(VideoBitrateControllerTest, default_bitrate)
+{
+    VideoBitrateController controller;
+    EXPECT_EQ(controller.targetBitrate(), VideoBitrateController::kDefaultBitrate);
+
+    // One or two messages in the queue are normal, nothing changes.
+    EXPECT_FALSE(controller.update(100000, 1));
+    EXPECT_FALSE(controller.update(100000, 2));
+    EXPECT_EQ(controller.targetBitrate(), VideoBitrateController::kDefaultBitrate);
+}
+
+TEST(VideoBitrateControllerTest, congestion)
+{
+    VideoBitrateController controller;
+
+    // 50 kB/s = 400 kbps. The target goes below the measured throughput.
+    EXPECT_TRUE(controller.update(50000, 10));
+    EXPECT_EQ(controller.targetBitrate(), 360u);
+
+    for (int i = 0; i < 20; ++i)
+        controller.update(0, 10);
+
+    EXPECT_EQ(controller.targetBitrate(), VideoBitrateController::kMinBitrate);
+}
+
+TEST(VideoBitrateControllerTest, socket_congestion)
+{
+    VideoBitrateController controller;
+
+    // 50 kB/s. 5 kB in the socket is 100 ms of data, which is normal.
+    EXPECT_TRUE(controller.update(50000, 0, 5000));
+    EXPECT_GT(controller.targetBitrate(), VideoBitrateController::kDefaultBitrate);
+
+    // 50 kB in the socket is one second of data. The queue of the channel is empty, but the link
+    // is congested.
+    EXPECT_TRUE(controller.update(50000, 0, 50000));
+    EXPECT_EQ(controller.targetBitrate(), 360u);
+}
+
+TEST(VideoBitrateControllerTest, high_rtt_steady_state)
+{
+    VideoBitrateController controller;
+
+    // 500 kB/s with a round trip time of 400 ms keeps 200 kB in flight. Only a few kilobytes are
+    // waiting in the socket, so the link is not congested and the bitrate keeps growing.
+    const int64_t speed_tx = 500000;
+    const size_t unsent_bytes = 8000;
+
+    uint32_t last_bitrate = controller.targetBitrate();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_TRUE(controller.update(speed_tx, 0, unsent_bytes));
+        EXPECT_GT(controller.targetBitrate(), last_bitrate);
+        last_bitrate = controller.targetBitrate();
+    }
+}
+
+TEST(VideoBitrateControllerTest, idle_link)
+{
+    VideoBitrateController controller;
+
+    uint32_t last_bitrate = controller.targetBitrate();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_TRUE(controller.update(10000, 0));
+        EXPECT_GT(controller.targetBitrate(), last_bitrate);
+        last_bitrate = controller.targetBitrate();
+    }
+
+    for (int i = 0; i < 100; ++i)
+        controller.update(10000, 0);
+
+    EXPECT_EQ(controller.targetBitrate(), VideoBitrateController::kMaxBitrate);
+    EXPECT_FALSE(controller.update(10000, 0));
+}
+
+} // namespace base
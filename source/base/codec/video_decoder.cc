@@ -19,6 +19,20 @@
 #include "base/codec/video_decoder.h"
 
 #include "base/codec/video_decoder_vpx.h"
+#include "base/codec/video_decoder_zstd.h"
+#include "build/build_config.h"
+
+#if defined(USE_AV1)
+#include "base/codec/video_decoder_dav1d.h"
+#endif // defined(USE_AV1)
+
+#if defined(OS_WIN)
+#include "base/codec/video_decoder_mf.h"
+#endif // defined(OS_WIN)
+
+#if defined(OS_MAC)
+#include "base/codec/video_decoder_vt.h"
+#endif // defined(OS_MAC)
 
 namespace base {
 
@@ -33,6 +47,24 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding
         case proto::VIDEO_ENCODING_VP9:
             return VideoDecoderVPX::createVP9();
 
+        case proto::VIDEO_ENCODING_ZSTD:
+            return VideoDecoderZstd::create();
+
+#if defined(USE_AV1)
+        case proto::VIDEO_ENCODING_AV1:
+            return VideoDecoderDav1d::createAV1();
+#endif // defined(USE_AV1)
+
+#if defined(OS_WIN)
+        case proto::VIDEO_ENCODING_H264:
+            return VideoDecoderMF::createH264();
+#endif // defined(OS_WIN)
+
+#if defined(OS_MAC)
+        case proto::VIDEO_ENCODING_H264:
+            return VideoDecoderVT::createH264();
+#endif // defined(OS_MAC)
+
         default:
             return nullptr;
     }
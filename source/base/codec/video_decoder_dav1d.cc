@@ -0,0 +1,180 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_dav1d.h"
+
+#include "base/logging.h"
+#include "base/codec/dirty_rects.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <libyuv/convert_argb.h>
+
+#include <dav1d/dav1d.h>
+
+namespace base {
+
+namespace {
+
+// dav1d decodes the tiles and, with the row based threading, the rows of superblocks in parallel.
+// The host encodes up to 16 tile columns.
+const int kMaxDecoderThreadCount = 8;
+
+int decoderThreadCount()
+{
+    const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+    return std::clamp((cpu_count + 1) / 2, 2, kMaxDecoderThreadCount);
+}
+
+} // namespace
+
+// static
+std::unique_ptr<VideoDecoderDav1d> VideoDecoderDav1d::createAV1()
+{
+    return std::unique_ptr<VideoDecoderDav1d>(new VideoDecoderDav1d());
+}
+
+VideoDecoderDav1d::VideoDecoderDav1d()
+{
+    Dav1dSettings settings;
+    dav1d_default_settings(&settings);
+
+    settings.n_threads = decoderThreadCount();
+
+    // Each packet contains a single frame which must be shown immediately. The frame threading
+    // would delay the output by several frames.
+    settings.max_frame_delay = 1;
+
+    int ret = dav1d_open(&context_, &settings);
+    CHECK_EQ(ret, 0);
+}
+
+VideoDecoderDav1d::~VideoDecoderDav1d()
+{
+    dav1d_close(&context_);
+}
+
+bool VideoDecoderDav1d::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    Dav1dData data;
+    memset(&data, 0, sizeof(data));
+
+    uint8_t* buffer = dav1d_data_create(&data, packet.data().size());
+    if (!buffer)
+    {
+        LOG(LS_WARNING) << "dav1d_data_create failed";
+        return false;
+    }
+
+    memcpy(buffer, packet.data().data(), packet.data().size());
+
+    int ret = dav1d_send_data(context_, &data);
+    if (ret < 0 && ret != DAV1D_ERR(EAGAIN))
+    {
+        LOG(LS_WARNING) << "dav1d_send_data failed: " << ret;
+        dav1d_data_unref(&data);
+        return false;
+    }
+
+    Dav1dPicture picture;
+    memset(&picture, 0, sizeof(picture));
+
+    ret = dav1d_get_picture(context_, &picture);
+
+    // The packet contains a whole frame. If something is left, the stream is broken.
+    if (data.sz > 0)
+        dav1d_data_unref(&data);
+
+    if (ret < 0)
+    {
+        LOG(LS_WARNING) << "No video frame decoded: " << ret;
+        return false;
+    }
+
+    const bool result = convertPicture(packet, picture, frame);
+    dav1d_picture_unref(&picture);
+    return result;
+}
+
+bool VideoDecoderDav1d::convertPicture(
+    const proto::VideoPacket& packet, const Dav1dPicture& picture, Frame* frame)
+{
+    if (picture.p.layout != DAV1D_PIXEL_LAYOUT_I420 || picture.p.bpc != 8)
+    {
+        LOG(LS_WARNING) << "Unsupported picture format (layout: " << picture.p.layout
+                        << ", bpc: " << picture.p.bpc << ")";
+        return false;
+    }
+
+    if (Size(picture.p.w, picture.p.h) != frame->size())
+    {
+        LOG(LS_WARNING) << "Size of the encoded frame doesn't match size in the header";
+        return false;
+    }
+
+    const uint8_t* y_data = static_cast<const uint8_t*>(picture.data[0]);
+    const uint8_t* u_data = static_cast<const uint8_t*>(picture.data[1]);
+    const uint8_t* v_data = static_cast<const uint8_t*>(picture.data[2]);
+
+    const int y_stride = static_cast<int>(picture.stride[0]);
+    const int uv_stride = static_cast<int>(picture.stride[1]);
+
+    const Rect frame_rect = Rect::makeSize(frame->size());
+
+    std::vector<Rect> dirty_rects;
+    if (!dirtyRects(packet, &dirty_rects))
+        return false;
+
+    for (Rect rect : dirty_rects)
+    {
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        // One chroma sample covers 2x2 pixels. A rect with odd coordinates is extended to the even
+        // ones, otherwise the chroma planes are read with an offset of one sample.
+        rect = Rect::makeLTRB(rect.left() & ~1, rect.top() & ~1,
+                              rect.right() + (rect.right() & 1),
+                              rect.bottom() + (rect.bottom() & 1));
+        rect.intersectWith(frame_rect);
+
+        if (rect.isEmpty())
+            continue;
+
+        const int y_offset = y_stride * rect.y() + rect.x();
+        const int uv_offset = uv_stride * (rect.y() / 2) + rect.x() / 2;
+
+        libyuv::I420ToARGB(y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+
+    return true;
+}
+
+} // namespace base
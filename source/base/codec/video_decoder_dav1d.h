@@ -0,0 +1,57 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_DECODER_DAV1D_H
+#define BASE__CODEC__VIDEO_DECODER_DAV1D_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_decoder.h"
+
+extern "C"
+{
+typedef struct Dav1dContext Dav1dContext;
+typedef struct Dav1dPicture Dav1dPicture;
+}
+
+namespace base {
+
+// Decodes AV1 with dav1d. As for VP8 and VP9, the decoded YUV image is converted to ARGB only
+// inside the dirty rects.
+class VideoDecoderDav1d : public VideoDecoder
+{
+public:
+    ~VideoDecoderDav1d();
+
+    static std::unique_ptr<VideoDecoderDav1d> createAV1();
+
+    bool decode(const proto::VideoPacket& packet, Frame* frame) override;
+
+private:
+    VideoDecoderDav1d();
+
+    bool convertPicture(const proto::VideoPacket& packet, const Dav1dPicture& picture,
+                        Frame* frame);
+
+    Dav1dContext* context_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderDav1d);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_DECODER_DAV1D_H
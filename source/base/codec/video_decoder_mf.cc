@@ -0,0 +1,482 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_mf.h"
+
+#include "base/logging.h"
+#include "base/codec/dirty_rects.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert_argb.h>
+
+#include <iterator>
+
+#include <codecapi.h>
+#include <d3d10.h>
+#include <mfapi.h>
+#include <mferror.h>
+#include <wmcodecdsp.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+VideoDecoderMF::VideoDecoderMF()
+{
+    // Nothing
+}
+
+VideoDecoderMF::~VideoDecoderMF()
+{
+    transform_.Reset();
+    device_manager_.Reset();
+    device_.Reset();
+    MFShutdown();
+}
+
+// static
+std::unique_ptr<VideoDecoderMF> VideoDecoderMF::createH264()
+{
+    HRESULT hr = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFStartup failed: " << hr;
+        return nullptr;
+    }
+
+    // The destructor calls MFShutdown().
+    std::unique_ptr<VideoDecoderMF> decoder(new VideoDecoderMF());
+    if (!decoder->init())
+        return nullptr;
+
+    return decoder;
+}
+
+bool VideoDecoderMF::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    const DWORD data_size = static_cast<DWORD>(packet.data().size());
+
+    ComPtr<IMFMediaBuffer> buffer;
+    HRESULT hr = MFCreateMemoryBuffer(data_size, buffer.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateMemoryBuffer failed: " << hr;
+        return false;
+    }
+
+    BYTE* data = nullptr;
+    hr = buffer->Lock(&data, nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFMediaBuffer::Lock failed: " << hr;
+        return false;
+    }
+
+    memcpy(data, packet.data().data(), data_size);
+    buffer->Unlock();
+    buffer->SetCurrentLength(data_size);
+
+    ComPtr<IMFSample> input_sample;
+    hr = MFCreateSample(input_sample.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateSample failed: " << hr;
+        return false;
+    }
+
+    input_sample->AddBuffer(buffer.Get());
+
+    hr = transform_->ProcessInput(0, input_sample.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::ProcessInput failed: " << hr;
+        return false;
+    }
+
+    ComPtr<IMFSample> output_sample;
+    if (!processOutput(&output_sample))
+        return false;
+
+    if (image_size_.width() < frame->size().width() ||
+        image_size_.height() < frame->size().height())
+    {
+        LOG(LS_WARNING) << "Size of the encoded frame doesn't match size in the header";
+        return false;
+    }
+
+    return convertImage(packet, output_sample.Get(), frame);
+}
+
+bool VideoDecoderMF::init()
+{
+    HRESULT hr = CoCreateInstance(CLSID_CMSH264DecoderMFT, nullptr, CLSCTX_INPROC_SERVER,
+                                  IID_PPV_ARGS(transform_.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "Unable to create H.264 decoder: " << hr;
+        return false;
+    }
+
+    ComPtr<IMFAttributes> attributes;
+    if (SUCCEEDED(transform_->GetAttributes(attributes.GetAddressOf())))
+    {
+        // Without it the decoder buffers several frames before the output.
+        attributes->SetUINT32(CODECAPI_AVLowLatencyMode, TRUE);
+    }
+
+    // The device manager must be set before the media types.
+    if (initD3D())
+        LOG(LS_INFO) << "H.264 decoder uses DXVA";
+    else
+        LOG(LS_INFO) << "H.264 decoder uses software decoding";
+
+    ComPtr<IMFMediaType> input_type;
+    hr = MFCreateMediaType(input_type.GetAddressOf());
+    if (FAILED(hr) ||
+        FAILED(input_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video)) ||
+        FAILED(input_type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264)) ||
+        FAILED(input_type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive)))
+    {
+        LOG(LS_WARNING) << "Unable to create the input type";
+        return false;
+    }
+
+    hr = transform_->SetInputType(0, input_type.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::SetInputType failed: " << hr;
+        return false;
+    }
+
+    if (!setOutputType())
+        return false;
+
+    if (FAILED(transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0)) ||
+        FAILED(transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0)))
+    {
+        LOG(LS_WARNING) << "Unable to start the stream";
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoDecoderMF::initD3D()
+{
+    ComPtr<IMFAttributes> attributes;
+    UINT32 d3d11_aware = FALSE;
+
+    if (FAILED(transform_->GetAttributes(attributes.GetAddressOf())) ||
+        FAILED(attributes->GetUINT32(MF_SA_D3D11_AWARE, &d3d11_aware)) || !d3d11_aware)
+    {
+        LOG(LS_INFO) << "The decoder does not support D3D11";
+        return false;
+    }
+
+    static const D3D_FEATURE_LEVEL kFeatureLevels[] =
+    {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0,
+        D3D_FEATURE_LEVEL_10_1,
+        D3D_FEATURE_LEVEL_10_0,
+        D3D_FEATURE_LEVEL_9_3
+    };
+
+    ComPtr<ID3D11Device> device;
+    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr,
+                                   D3D11_CREATE_DEVICE_VIDEO_SUPPORT, kFeatureLevels,
+                                   static_cast<UINT>(std::size(kFeatureLevels)),
+                                   D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "D3D11CreateDevice failed: " << hr;
+        return false;
+    }
+
+    // The transform uses the device from its own threads.
+    ComPtr<ID3D10Multithread> multithread;
+    if (SUCCEEDED(device.As(&multithread)))
+        multithread->SetMultithreadProtected(TRUE);
+
+    UINT reset_token = 0;
+    ComPtr<IMFDXGIDeviceManager> device_manager;
+
+    hr = MFCreateDXGIDeviceManager(&reset_token, device_manager.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateDXGIDeviceManager failed: " << hr;
+        return false;
+    }
+
+    hr = device_manager->ResetDevice(device.Get(), reset_token);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFDXGIDeviceManager::ResetDevice failed: " << hr;
+        return false;
+    }
+
+    hr = transform_->ProcessMessage(MFT_MESSAGE_SET_D3D_MANAGER,
+                                    reinterpret_cast<ULONG_PTR>(device_manager.Get()));
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "Unable to set the device manager: " << hr;
+        return false;
+    }
+
+    device_ = std::move(device);
+    device_manager_ = std::move(device_manager);
+    return true;
+}
+
+bool VideoDecoderMF::setOutputType()
+{
+    for (DWORD index = 0;; ++index)
+    {
+        ComPtr<IMFMediaType> type;
+
+        HRESULT hr = transform_->GetOutputAvailableType(0, index, type.GetAddressOf());
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "NV12 output type is not available: " << hr;
+            return false;
+        }
+
+        GUID subtype;
+        if (FAILED(type->GetGUID(MF_MT_SUBTYPE, &subtype)) || subtype != MFVideoFormat_NV12)
+            continue;
+
+        hr = transform_->SetOutputType(0, type.Get(), 0);
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFTransform::SetOutputType failed: " << hr;
+            return false;
+        }
+
+        UINT32 width = 0;
+        UINT32 height = 0;
+        MFGetAttributeSize(type.Get(), MF_MT_FRAME_SIZE, &width, &height);
+
+        UINT32 stride = 0;
+        if (FAILED(type->GetUINT32(MF_MT_DEFAULT_STRIDE, &stride)))
+            stride = width;
+
+        image_size_ = Size(static_cast<int32_t>(width), static_cast<int32_t>(height));
+        stride_ = static_cast<int>(stride);
+        return true;
+    }
+}
+
+bool VideoDecoderMF::processOutput(ComPtr<IMFSample>* sample)
+{
+    while (true)
+    {
+        MFT_OUTPUT_STREAM_INFO stream_info;
+        memset(&stream_info, 0, sizeof(stream_info));
+
+        HRESULT hr = transform_->GetOutputStreamInfo(0, &stream_info);
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFTransform::GetOutputStreamInfo failed: " << hr;
+            return false;
+        }
+
+        // With DXVA the transform allocates the samples from its pool of surfaces. The software
+        // decoder does not allocate the output samples.
+        const bool provides_samples = (stream_info.dwFlags &
+            (MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES)) != 0;
+
+        ComPtr<IMFSample> output_sample;
+
+        if (!provides_samples)
+        {
+            ComPtr<IMFMediaBuffer> buffer;
+
+            if (FAILED(MFCreateSample(output_sample.GetAddressOf())) ||
+                FAILED(MFCreateMemoryBuffer(stream_info.cbSize, buffer.GetAddressOf())) ||
+                FAILED(output_sample->AddBuffer(buffer.Get())))
+            {
+                LOG(LS_WARNING) << "Unable to create the output sample";
+                return false;
+            }
+        }
+
+        MFT_OUTPUT_DATA_BUFFER output;
+        memset(&output, 0, sizeof(output));
+        output.pSample = output_sample.Get();
+
+        DWORD status = 0;
+        hr = transform_->ProcessOutput(0, 1, &output, &status);
+
+        if (output.pEvents)
+            output.pEvents->Release();
+
+        // The sample allocated by the transform is owned by the caller.
+        if (provides_samples && output.pSample)
+            output_sample.Attach(output.pSample);
+
+        if (hr == MF_E_TRANSFORM_STREAM_CHANGE)
+        {
+            // The size of the image is known after the first key frame is parsed.
+            if (!setOutputType())
+                return false;
+            continue;
+        }
+
+        if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+        {
+            LOG(LS_WARNING) << "No video frame decoded";
+            return false;
+        }
+
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFTransform::ProcessOutput failed: " << hr;
+            return false;
+        }
+
+        *sample = std::move(output_sample);
+        return true;
+    }
+}
+
+bool VideoDecoderMF::convertImage(
+    const proto::VideoPacket& packet, IMFSample* sample, Frame* frame)
+{
+    if (device_manager_)
+    {
+        ComPtr<IMFMediaBuffer> buffer;
+        HRESULT hr = sample->GetBufferByIndex(0, buffer.GetAddressOf());
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFSample::GetBufferByIndex failed: " << hr;
+            return false;
+        }
+
+        ComPtr<IMFDXGIBuffer> dxgi_buffer;
+        if (SUCCEEDED(buffer.As(&dxgi_buffer)))
+            return convertSurface(packet, buffer.Get(), frame);
+    }
+
+    ComPtr<IMFMediaBuffer> buffer;
+    HRESULT hr = sample->ConvertToContiguousBuffer(buffer.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFSample::ConvertToContiguousBuffer failed: " << hr;
+        return false;
+    }
+
+    BYTE* data = nullptr;
+    hr = buffer->Lock(&data, nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFMediaBuffer::Lock failed: " << hr;
+        return false;
+    }
+
+    bool result = convertRects(packet, data, data + stride_ * image_size_.height(), stride_, frame);
+
+    buffer->Unlock();
+    return result;
+}
+
+bool VideoDecoderMF::convertSurface(
+    const proto::VideoPacket& packet, IMFMediaBuffer* buffer, Frame* frame)
+{
+    ComPtr<IMFDXGIBuffer> dxgi_buffer;
+    ComPtr<ID3D11Texture2D> texture;
+    ComPtr<IMF2DBuffer> buffer_2d;
+
+    HRESULT hr = buffer->QueryInterface(IID_PPV_ARGS(dxgi_buffer.GetAddressOf()));
+    if (SUCCEEDED(hr))
+        hr = dxgi_buffer->GetResource(IID_PPV_ARGS(texture.GetAddressOf()));
+    if (SUCCEEDED(hr))
+        hr = buffer->QueryInterface(IID_PPV_ARGS(buffer_2d.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "Unable to get the decoded surface: " << hr;
+        return false;
+    }
+
+    // The height of the surface is aligned by the decoder, the chroma plane follows it.
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+
+    // Only the mapped copy of the surface is read, the pixels outside the dirty rectangles are not
+    // converted.
+    BYTE* data = nullptr;
+    LONG pitch = 0;
+
+    hr = buffer_2d->Lock2D(&data, &pitch);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMF2DBuffer::Lock2D failed: " << hr;
+        return false;
+    }
+
+    bool result = false;
+
+    if (pitch > 0 && desc.Height >= static_cast<UINT>(image_size_.height()))
+    {
+        result = convertRects(packet, data, data + pitch * desc.Height,
+                              static_cast<int>(pitch), frame);
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unsupported surface layout (pitch: " << pitch
+                        << ", height: " << desc.Height << ")";
+    }
+
+    buffer_2d->Unlock2D();
+    return result;
+}
+
+bool VideoDecoderMF::convertRects(const proto::VideoPacket& packet, const uint8_t* y_data,
+                                  const uint8_t* uv_data, int stride, Frame* frame)
+{
+    std::vector<Rect> dirty_rects;
+    if (!dirtyRects(packet, &dirty_rects))
+        return false;
+
+    const Rect frame_rect = Rect::makeSize(frame->size());
+
+    for (const Rect& dirty_rect : dirty_rects)
+    {
+        // The chroma planes are subsampled, so the rectangle must start at an even position.
+        Rect rect = Rect::makeXYWH(dirty_rect.x() & ~1, dirty_rect.y() & ~1,
+                                   dirty_rect.width() + (dirty_rect.x() & 1),
+                                   dirty_rect.height() + (dirty_rect.y() & 1));
+        rect.intersectWith(frame_rect);
+
+        if (rect.isEmpty() || !frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        libyuv::NV12ToARGB(y_data + stride * rect.y() + rect.x(), stride,
+                           uv_data + stride * (rect.y() / 2) + rect.x(), stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+
+    return true;
+}
+
+} // namespace base
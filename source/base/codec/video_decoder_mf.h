@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_DECODER_MF_H
+#define BASE__CODEC__VIDEO_DECODER_MF_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+
+#include <d3d11.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// H.264 decoder based on the Media Foundation decoder transform which is provided by the system.
+// If the video adapter supports it, the transform decodes with DXVA into D3D11 surfaces and only
+// the dirty rectangles are converted to the frame. Otherwise the transform decodes in software.
+// The decoder must be created and used on a thread with initialized COM.
+class VideoDecoderMF : public VideoDecoder
+{
+public:
+    ~VideoDecoderMF() override;
+
+    // Returns nullptr if the decoder is not available in the system.
+    static std::unique_ptr<VideoDecoderMF> createH264();
+
+    bool decode(const proto::VideoPacket& packet, Frame* frame) override;
+
+private:
+    VideoDecoderMF();
+
+    bool init();
+    bool initD3D();
+    bool setOutputType();
+    bool processOutput(Microsoft::WRL::ComPtr<IMFSample>* sample);
+    bool convertImage(const proto::VideoPacket& packet, IMFSample* sample, Frame* frame);
+    bool convertSurface(const proto::VideoPacket& packet, IMFMediaBuffer* buffer, Frame* frame);
+    bool convertRects(const proto::VideoPacket& packet, const uint8_t* y_data,
+                      const uint8_t* uv_data, int stride, Frame* frame);
+
+    Microsoft::WRL::ComPtr<IMFTransform> transform_;
+
+    // Set if the transform decodes with DXVA.
+    Microsoft::WRL::ComPtr<ID3D11Device> device_;
+    Microsoft::WRL::ComPtr<IMFDXGIDeviceManager> device_manager_;
+
+    // Size and stride of the decoded NV12 image.
+    Size image_size_;
+    int stride_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderMF);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_DECODER_MF_H
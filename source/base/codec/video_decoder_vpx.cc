@@ -19,47 +19,69 @@
 #include "base/codec/video_decoder_vpx.h"
 
 #include "base/logging.h"
+#include "base/codec/dirty_rects.h"
 #include "base/desktop/frame.h"
+#include "base/memory/buffer_pool.h"
+#include "base/threading/stripe_workers.h"
+
+#include <algorithm>
+#include <thread>
 
 #include <libyuv/convert_from.h>
 #include <libyuv/convert_argb.h>
 
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_decoder.h>
+#include <vpx/vpx_frame_buffer.h>
 #include <vpx/vp8dx.h>
 
 namespace base {
 
 namespace {
 
-bool convertImage(const proto::VideoPacket& packet, vpx_image_t* image, Frame* frame)
-{
-    if (image->fmt != VPX_IMG_FMT_I420)
-        return false;
+// Height of the bands the dirty rects are split into. The bands are converted in parallel.
+const int kTileHeight = 64;
 
-    Rect frame_rect = Rect::makeSize(frame->size());
+// Updates smaller than this are converted on the decoder thread only. Waking up the workers takes
+// longer than the conversion itself.
+const int64_t kMinPixelsPerThread = 512 * 512;
+const int kMaxThreadCount = 4;
 
-    uint8_t* y_data = image->planes[0];
-    uint8_t* u_data = image->planes[1];
-    uint8_t* v_data = image->planes[2];
+// The VP9 decoder decodes the tile columns and, with the row based multithreading, the rows of
+// superblocks in parallel. The host encodes up to 16 tile columns.
+const unsigned int kMaxDecoderThreadCount = 8;
 
-    int y_stride = image->stride[0];
-    int uv_stride = image->stride[1];
+// The VP9 decoder keeps up to 8 reference frames and the frame being decoded. The free buffers
+// are kept for the frames of the same size after a change of the references.
+const size_t kMaxFreeFrameBuffers = 4;
 
-    for (int i = 0; i < packet.dirty_rect_size(); ++i)
-    {
-        const proto::Rect& dirty_rect = packet.dirty_rect(i);
-        Rect rect = Rect::makeXYWH(
-            dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height());
+void convertTile(const vpx_image_t* image, const Rect& rect, Frame* frame)
+{
+    const uint8_t* y_data = image->planes[0];
+    const uint8_t* u_data = image->planes[1];
+    const uint8_t* v_data = image->planes[2];
 
-        if (!frame_rect.containsRect(rect))
-        {
-            LOG(LS_WARNING) << "The rectangle is outside the screen area";
-            return false;
-        }
+    const int y_stride = image->stride[0];
+    const int uv_stride = image->stride[1];
+
+    const int y_offset = y_stride * rect.y() + rect.x();
 
-        int y_offset = y_stride * rect.y() + rect.x();
-        int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+    if (image->fmt == VPX_IMG_FMT_I444)
+    {
+        const int uv_offset = uv_stride * rect.y() + rect.x();
+
+        libyuv::I444ToARGB(y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+    else
+    {
+        // The rect is aligned to even coordinates, so the chroma samples are not shifted.
+        const int uv_offset = uv_stride * (rect.y() / 2) + rect.x() / 2;
 
         libyuv::I420ToARGB(y_data + y_offset, y_stride,
                            u_data + uv_offset, uv_stride,
@@ -69,8 +91,24 @@ bool convertImage(const proto::VideoPacket& packet, vpx_image_t* image, Frame* f
                            rect.width(),
                            rect.height());
     }
+}
 
-    return true;
+unsigned int decoderThreadCount(proto::VideoEncoding encoding)
+{
+    // The VP8 stream of the host has a single token partition, more threads are not used.
+    if (encoding != proto::VIDEO_ENCODING_VP9)
+        return 2;
+
+    const unsigned int cpu_count = std::thread::hardware_concurrency();
+    return std::clamp((cpu_count + 1) / 2, 2U, kMaxDecoderThreadCount);
+}
+
+int workerThreadCount()
+{
+    const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+
+    // The decoder thread converts the first stripe itself.
+    return std::min((cpu_count + 1) / 2, kMaxThreadCount) - 1;
 }
 
 } // namespace
@@ -95,7 +133,7 @@ VideoDecoderVPX::VideoDecoderVPX(proto::VideoEncoding encoding)
 
     config.w = 0;
     config.h = 0;
-    config.threads = 2;
+    config.threads = decoderThreadCount(encoding);
 
     vpx_codec_iface_t* algo;
 
@@ -116,8 +154,32 @@ VideoDecoderVPX::VideoDecoderVPX(proto::VideoEncoding encoding)
 
     int ret = vpx_codec_dec_init(codec_.get(), algo, &config, 0);
     CHECK_EQ(ret, VPX_CODEC_OK);
+
+    if (encoding == proto::VIDEO_ENCODING_VP9)
+    {
+        ret = vpx_codec_control(codec_.get(), VP9D_SET_ROW_MT, 1);
+        if (ret != VPX_CODEC_OK)
+            LOG(LS_WARNING) << "Unable to enable the row based multithreading: " << ret;
+
+        // The VP8 decoder does not support the external frame buffers.
+        frame_buffers_ = std::make_unique<BufferPool>(kMaxFreeFrameBuffers);
+
+        ret = vpx_codec_set_frame_buffer_functions(
+            codec_.get(), getFrameBuffer, releaseFrameBuffer, frame_buffers_.get());
+        if (ret != VPX_CODEC_OK)
+        {
+            LOG(LS_WARNING) << "Unable to set the frame buffer functions: " << ret;
+            frame_buffers_.reset();
+        }
+    }
+
+    const int thread_count = workerThreadCount();
+    if (thread_count > 0)
+        workers_ = std::make_unique<StripeWorkers>(thread_count);
 }
 
+VideoDecoderVPX::~VideoDecoderVPX() = default;
+
 bool VideoDecoderVPX::decode(const proto::VideoPacket& packet, Frame* frame)
 {
     // Do the actual decoding.
@@ -156,4 +218,97 @@ bool VideoDecoderVPX::decode(const proto::VideoPacket& packet, Frame* frame)
     return convertImage(packet, image, frame);
 }
 
+bool VideoDecoderVPX::convertImage(
+    const proto::VideoPacket& packet, const vpx_image_t* image, Frame* frame)
+{
+    if (image->fmt != VPX_IMG_FMT_I420 && image->fmt != VPX_IMG_FMT_I444)
+    {
+        LOG(LS_WARNING) << "Unsupported image format: " << image->fmt;
+        return false;
+    }
+
+    const bool is_i420 = image->fmt == VPX_IMG_FMT_I420;
+    const Rect frame_rect = Rect::makeSize(frame->size());
+
+    tiles_.clear();
+    int64_t pixel_count = 0;
+
+    std::vector<Rect> dirty_rects;
+    if (!dirtyRects(packet, &dirty_rects))
+        return false;
+
+    for (Rect rect : dirty_rects)
+    {
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        if (is_i420)
+        {
+            // One chroma sample covers 2x2 pixels. A rect with odd coordinates is extended to the
+            // even ones, otherwise the chroma planes are read with an offset of one sample.
+            rect = Rect::makeLTRB(rect.left() & ~1, rect.top() & ~1,
+                                  rect.right() + (rect.right() & 1),
+                                  rect.bottom() + (rect.bottom() & 1));
+            rect.intersectWith(frame_rect);
+        }
+
+        if (rect.isEmpty())
+            continue;
+
+        pixel_count += static_cast<int64_t>(rect.width()) * rect.height();
+
+        // The tile height is even, so the bands stay aligned to the chroma samples.
+        for (int y = rect.top(); y < rect.bottom(); y += kTileHeight)
+        {
+            tiles_.emplace_back(Rect::makeLTRB(
+                rect.left(), y, rect.right(), std::min(y + kTileHeight, rect.bottom())));
+        }
+    }
+
+    auto convert_tiles = [&](int first_tile, int last_tile)
+    {
+        for (int i = first_tile; i < last_tile; ++i)
+            convertTile(image, tiles_[i], frame);
+    };
+
+    // Each tile writes only its own pixels of the frame, so the tiles are converted in parallel
+    // without any synchronization.
+    const int tile_count = static_cast<int>(tiles_.size());
+
+    if (workers_ && pixel_count >= kMinPixelsPerThread && tile_count > 1)
+        workers_->run(tile_count, convert_tiles);
+    else
+        convert_tiles(0, tile_count);
+
+    return true;
+}
+
+// static
+int VideoDecoderVPX::getFrameBuffer(void* context, size_t min_size, vpx_codec_frame_buffer_t* fb)
+{
+    DCHECK(context);
+    DCHECK(fb);
+
+    // The callbacks are called on the thread of vpx_codec_decode() only.
+    Buffer* buffer = static_cast<BufferPool*>(context)->acquire(min_size);
+
+    fb->data = buffer->data();
+    fb->size = buffer->size();
+    fb->priv = buffer;
+    return 0;
+}
+
+// static
+int VideoDecoderVPX::releaseFrameBuffer(void* context, vpx_codec_frame_buffer_t* fb)
+{
+    DCHECK(context);
+    DCHECK(fb);
+
+    static_cast<BufferPool*>(context)->release(static_cast<Buffer*>(fb->priv));
+    return 0;
+}
+
 } // namespace base
@@ -22,13 +22,29 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_vpx_codec.h"
 #include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+
+#include <vector>
+
+extern "C"
+{
+typedef struct vpx_image vpx_image_t;
+typedef struct vpx_codec_frame_buffer vpx_codec_frame_buffer_t;
+}
 
 namespace base {
 
+class BufferPool;
+class StripeWorkers;
+
+// Decodes VP8 and VP9. The decoded YUV image is converted to ARGB only inside the dirty rects. The
+// rects are split into bands of rows, and large updates are converted on several threads.
+// The VP9 decoder takes the memory for its frames from a pool of aligned buffers, which is kept
+// for the whole session. The dirty rects are converted right from these frames.
 class VideoDecoderVPX : public VideoDecoder
 {
 public:
-    ~VideoDecoderVPX() = default;
+    ~VideoDecoderVPX();
 
     static std::unique_ptr<VideoDecoderVPX> createVP8();
     static std::unique_ptr<VideoDecoderVPX> createVP9();
@@ -38,7 +54,19 @@ public:
 private:
     explicit VideoDecoderVPX(proto::VideoEncoding encoding);
 
+    bool convertImage(const proto::VideoPacket& packet, const vpx_image_t* image, Frame* frame);
+
+    static int getFrameBuffer(void* context, size_t min_size, vpx_codec_frame_buffer_t* fb);
+    static int releaseFrameBuffer(void* context, vpx_codec_frame_buffer_t* fb);
+
+    // The decoder releases its frames to the pool when it is destroyed, so the pool is destroyed
+    // after it.
+    std::unique_ptr<BufferPool> frame_buffers_;
     ScopedVpxCodec codec_;
+    std::unique_ptr<StripeWorkers> workers_;
+
+    // Bands of the dirty rects of the current packet. Kept to avoid an allocation for each packet.
+    std::vector<Rect> tiles_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderVPX);
 };
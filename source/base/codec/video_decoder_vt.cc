@@ -0,0 +1,378 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_vt.h"
+
+#include "base/logging.h"
+#include "base/codec/dirty_rects.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert_argb.h>
+
+namespace base {
+
+namespace {
+
+const uint8_t kNalTypeSps = 7;
+const uint8_t kNalTypePps = 8;
+const uint8_t kNalTypeAud = 9;
+
+// The size of the length prefix of the NAL units in the samples.
+const int kNalLengthSize = 4;
+
+// Returns the position of the next start code (00 00 01) at or after |offset|, or |size|.
+size_t findStartCode(const uint8_t* data, size_t size, size_t offset)
+{
+    for (size_t i = offset; i + 3 <= size; ++i)
+    {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+            return i;
+    }
+
+    return size;
+}
+
+void appendLengthPrefixed(const uint8_t* nal, size_t size, ByteArray* buffer)
+{
+    const uint32_t length = static_cast<uint32_t>(size);
+
+    buffer->push_back(static_cast<uint8_t>(length >> 24));
+    buffer->push_back(static_cast<uint8_t>(length >> 16));
+    buffer->push_back(static_cast<uint8_t>(length >> 8));
+    buffer->push_back(static_cast<uint8_t>(length));
+    buffer->insert(buffer->end(), nal, nal + size);
+}
+
+CFDictionaryRef createDictionary(const void** keys, const void** values, CFIndex count)
+{
+    return CFDictionaryCreate(kCFAllocatorDefault, keys, values, count,
+                              &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+}
+
+} // namespace
+
+VideoDecoderVT::VideoDecoderVT() = default;
+
+VideoDecoderVT::~VideoDecoderVT()
+{
+    destroySession();
+}
+
+// static
+std::unique_ptr<VideoDecoderVT> VideoDecoderVT::createH264()
+{
+    // The session is created when the parameter sets of the stream are received with the first
+    // key frame.
+    return std::unique_ptr<VideoDecoderVT>(new VideoDecoderVT());
+}
+
+bool VideoDecoderVT::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(packet.data().data());
+    const size_t size = packet.data().size();
+
+    ByteArray sps;
+    ByteArray pps;
+
+    sample_data_.clear();
+
+    // The encoder produces an Annex B stream. VideoToolbox requires the parameter sets separately
+    // and the NAL units with the length prefixes.
+    size_t start = findStartCode(data, size, 0);
+    while (start < size)
+    {
+        const size_t nal_start = start + 3;
+        const size_t next = findStartCode(data, size, nal_start);
+
+        // A zero byte before the next start code belongs to the four-byte start code.
+        size_t nal_end = next;
+        while (nal_end > nal_start && data[nal_end - 1] == 0 && next != size)
+            --nal_end;
+
+        if (nal_end > nal_start)
+        {
+            const uint8_t* nal = data + nal_start;
+            const size_t nal_size = nal_end - nal_start;
+
+            switch (nal[0] & 0x1F)
+            {
+                case kNalTypeSps:
+                    sps.assign(nal, nal + nal_size);
+                    break;
+
+                case kNalTypePps:
+                    pps.assign(nal, nal + nal_size);
+                    break;
+
+                case kNalTypeAud:
+                    break;
+
+                default:
+                    appendLengthPrefixed(nal, nal_size, &sample_data_);
+                    break;
+            }
+        }
+
+        start = next;
+    }
+
+    if (!sps.empty() && !pps.empty() && (!session_ || sps != sps_ || pps != pps_))
+    {
+        sps_ = std::move(sps);
+        pps_ = std::move(pps);
+
+        if (!createSession())
+            return false;
+    }
+
+    if (!session_)
+    {
+        LOG(LS_WARNING) << "No key frame received";
+        return false;
+    }
+
+    if (sample_data_.empty())
+    {
+        LOG(LS_WARNING) << "No video frame in the packet";
+        return false;
+    }
+
+    // The block does not copy the data, the sample is decoded synchronously.
+    CMBlockBufferRef block = nullptr;
+    OSStatus status = CMBlockBufferCreateWithMemoryBlock(
+        kCFAllocatorDefault, sample_data_.data(), sample_data_.size(), kCFAllocatorNull, nullptr,
+        0, sample_data_.size(), 0, &block);
+    if (status != noErr)
+    {
+        LOG(LS_WARNING) << "CMBlockBufferCreateWithMemoryBlock failed: " << status;
+        return false;
+    }
+
+    CMSampleBufferRef sample = nullptr;
+    const size_t sample_size = sample_data_.size();
+
+    status = CMSampleBufferCreateReady(
+        kCFAllocatorDefault, block, format_, 1, 0, nullptr, 1, &sample_size, &sample);
+    CFRelease(block);
+
+    if (status != noErr)
+    {
+        LOG(LS_WARNING) << "CMSampleBufferCreateReady failed: " << status;
+        return false;
+    }
+
+    status = VTDecompressionSessionDecodeFrame(session_, sample, 0, nullptr, nullptr);
+    if (status == noErr)
+        status = VTDecompressionSessionWaitForAsynchronousFrames(session_);
+    CFRelease(sample);
+
+    if (status != noErr)
+    {
+        LOG(LS_WARNING) << "VTDecompressionSessionDecodeFrame failed: " << status;
+
+        // The session is invalid after the system has been put to sleep for example. It is
+        // recreated with the next key frame.
+        if (status == kVTInvalidSessionErr)
+            destroySession();
+        return false;
+    }
+
+    CVPixelBufferRef image = decoded_image_;
+    decoded_image_ = nullptr;
+
+    if (!image)
+    {
+        LOG(LS_WARNING) << "No video frame decoded";
+        return false;
+    }
+
+    bool result = convertImage(packet, image, frame);
+    CVPixelBufferRelease(image);
+    return result;
+}
+
+bool VideoDecoderVT::createSession()
+{
+    destroySession();
+
+    const uint8_t* parameter_sets[] = { sps_.data(), pps_.data() };
+    const size_t parameter_set_sizes[] = { sps_.size(), pps_.size() };
+
+    OSStatus status = CMVideoFormatDescriptionCreateFromH264ParameterSets(
+        kCFAllocatorDefault, 2, parameter_sets, parameter_set_sizes, kNalLengthSize, &format_);
+    if (status != noErr)
+    {
+        LOG(LS_WARNING) << "CMVideoFormatDescriptionCreateFromH264ParameterSets failed: "
+                        << status;
+        return false;
+    }
+
+    // The software decoder is used only if the hardware one is not available.
+    const void* decoder_keys[] =
+        { kVTVideoDecoderSpecification_EnableHardwareAcceleratedVideoDecoder };
+    const void* decoder_values[] = { kCFBooleanTrue };
+
+    CFDictionaryRef decoder_spec = createDictionary(decoder_keys, decoder_values, 1);
+
+    // The decoded image is in NV12 like the output of the other H.264 decoders.
+    const int32_t pixel_format = kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
+    CFNumberRef pixel_format_number =
+        CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &pixel_format);
+
+    const void* image_keys[] = { kCVPixelBufferPixelFormatTypeKey };
+    const void* image_values[] = { pixel_format_number };
+
+    CFDictionaryRef image_attributes = createDictionary(image_keys, image_values, 1);
+    CFRelease(pixel_format_number);
+
+    VTDecompressionOutputCallbackRecord callback;
+    callback.decompressionOutputCallback = &VideoDecoderVT::onFrameDecoded;
+    callback.decompressionOutputRefCon = this;
+
+    status = VTDecompressionSessionCreate(
+        kCFAllocatorDefault, format_, decoder_spec, image_attributes, &callback, &session_);
+
+    CFRelease(image_attributes);
+    CFRelease(decoder_spec);
+
+    if (status != noErr)
+    {
+        LOG(LS_WARNING) << "VTDecompressionSessionCreate failed: " << status;
+        session_ = nullptr;
+        destroySession();
+        return false;
+    }
+
+    CFBooleanRef hardware = nullptr;
+    if (VTSessionCopyProperty(session_,
+                              kVTDecompressionPropertyKey_UsingHardwareAcceleratedVideoDecoder,
+                              kCFAllocatorDefault, &hardware) == noErr && hardware)
+    {
+        LOG(LS_INFO) << "H.264 decoder created (hardware: " << CFBooleanGetValue(hardware) << ")";
+        CFRelease(hardware);
+    }
+
+    return true;
+}
+
+void VideoDecoderVT::destroySession()
+{
+    if (session_)
+    {
+        VTDecompressionSessionInvalidate(session_);
+        CFRelease(session_);
+        session_ = nullptr;
+    }
+
+    if (format_)
+    {
+        CFRelease(format_);
+        format_ = nullptr;
+    }
+
+    if (decoded_image_)
+    {
+        CVPixelBufferRelease(decoded_image_);
+        decoded_image_ = nullptr;
+    }
+}
+
+bool VideoDecoderVT::convertImage(
+    const proto::VideoPacket& packet, CVPixelBufferRef image, Frame* frame)
+{
+    if (CVPixelBufferGetPixelFormatType(image) != kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange)
+    {
+        LOG(LS_WARNING) << "Unexpected pixel format: " << CVPixelBufferGetPixelFormatType(image);
+        return false;
+    }
+
+    if (static_cast<int>(CVPixelBufferGetWidth(image)) < frame->size().width() ||
+        static_cast<int>(CVPixelBufferGetHeight(image)) < frame->size().height())
+    {
+        LOG(LS_WARNING) << "Size of the encoded frame doesn't match size in the header";
+        return false;
+    }
+
+    std::vector<Rect> dirty_rects;
+    if (!dirtyRects(packet, &dirty_rects))
+        return false;
+
+    if (CVPixelBufferLockBaseAddress(image, kCVPixelBufferLock_ReadOnly) != kCVReturnSuccess)
+    {
+        LOG(LS_WARNING) << "CVPixelBufferLockBaseAddress failed";
+        return false;
+    }
+
+    const uint8_t* y_data =
+        static_cast<const uint8_t*>(CVPixelBufferGetBaseAddressOfPlane(image, 0));
+    const uint8_t* uv_data =
+        static_cast<const uint8_t*>(CVPixelBufferGetBaseAddressOfPlane(image, 1));
+    const int y_stride = static_cast<int>(CVPixelBufferGetBytesPerRowOfPlane(image, 0));
+    const int uv_stride = static_cast<int>(CVPixelBufferGetBytesPerRowOfPlane(image, 1));
+
+    const Rect frame_rect = Rect::makeSize(frame->size());
+    bool result = true;
+
+    for (const Rect& dirty_rect : dirty_rects)
+    {
+        // The chroma planes are subsampled, so the rectangle must start at an even position.
+        Rect rect = Rect::makeXYWH(dirty_rect.x() & ~1, dirty_rect.y() & ~1,
+                                   dirty_rect.width() + (dirty_rect.x() & 1),
+                                   dirty_rect.height() + (dirty_rect.y() & 1));
+        rect.intersectWith(frame_rect);
+
+        if (rect.isEmpty() || !frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            result = false;
+            break;
+        }
+
+        libyuv::NV12ToARGB(y_data + y_stride * rect.y() + rect.x(), y_stride,
+                           uv_data + uv_stride * (rect.y() / 2) + rect.x(), uv_stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+
+    CVPixelBufferUnlockBaseAddress(image, kCVPixelBufferLock_ReadOnly);
+    return result;
+}
+
+// static
+void VideoDecoderVT::onFrameDecoded(void* decoder, void* /* source_frame */, OSStatus status,
+                                    VTDecodeInfoFlags /* info_flags */, CVImageBufferRef image,
+                                    CMTime /* presentation_time */,
+                                    CMTime /* presentation_duration */)
+{
+    VideoDecoderVT* self = static_cast<VideoDecoderVT*>(decoder);
+
+    if (status != noErr || !image)
+    {
+        LOG(LS_WARNING) << "Decoding failed: " << status;
+        return;
+    }
+
+    if (self->decoded_image_)
+        CVPixelBufferRelease(self->decoded_image_);
+
+    self->decoded_image_ = CVPixelBufferRetain(image);
+}
+
+} // namespace base
@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_DECODER_VT_H
+#define BASE__CODEC__VIDEO_DECODER_VT_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_decoder.h"
+#include "base/memory/byte_array.h"
+
+#include <VideoToolbox/VideoToolbox.h>
+
+namespace base {
+
+// H.264 decoder based on VideoToolbox. The system decodes on the GPU if it is able to do it and
+// only the dirty rectangles of the decoded image are converted to the frame.
+class VideoDecoderVT : public VideoDecoder
+{
+public:
+    ~VideoDecoderVT() override;
+
+    // The decompression session is created from the parameter sets of the first key frame, so
+    // the decoder is always created. If the system is not able to decode the stream, decode()
+    // returns false.
+    static std::unique_ptr<VideoDecoderVT> createH264();
+
+    bool decode(const proto::VideoPacket& packet, Frame* frame) override;
+
+private:
+    VideoDecoderVT();
+
+    bool createSession();
+    void destroySession();
+    bool convertImage(const proto::VideoPacket& packet, CVPixelBufferRef image, Frame* frame);
+
+    static void onFrameDecoded(void* decoder, void* source_frame, OSStatus status,
+                               VTDecodeInfoFlags info_flags, CVImageBufferRef image,
+                               CMTime presentation_time, CMTime presentation_duration);
+
+    CMVideoFormatDescriptionRef format_ = nullptr;
+    VTDecompressionSessionRef session_ = nullptr;
+
+    // The parameter sets of the current session.
+    ByteArray sps_;
+    ByteArray pps_;
+
+    // The NAL units of the current packet with the length prefixes instead of the start codes.
+    ByteArray sample_data_;
+
+    // The image decoded by the last call of VTDecompressionSessionDecodeFrame.
+    CVPixelBufferRef decoded_image_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderVT);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_DECODER_VT_H
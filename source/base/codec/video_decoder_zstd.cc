@@ -0,0 +1,127 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_zstd.h"
+
+#include "base/logging.h"
+#include "base/codec/dirty_rects.h"
+#include "base/desktop/frame.h"
+
+namespace base {
+
+namespace {
+
+const uint8_t* restoreRect(const uint8_t* in, const Rect& rect, Frame* frame)
+{
+    const int row_size = rect.width() * Frame::kBytesPerPixel;
+    uint8_t* out = frame->frameDataAtPos(rect.topLeft());
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        for (int i = 0; i < Frame::kBytesPerPixel; ++i)
+            out[i] = in[i];
+
+        for (int i = Frame::kBytesPerPixel; i < row_size; ++i)
+            out[i] = in[i] + out[i - Frame::kBytesPerPixel];
+
+        in += row_size;
+        out += frame->stride();
+    }
+
+    return in;
+}
+
+} // namespace
+
+VideoDecoderZstd::VideoDecoderZstd()
+    : stream_(ZSTD_createDStream())
+{
+    // Nothing
+}
+
+// static
+std::unique_ptr<VideoDecoderZstd> VideoDecoderZstd::create()
+{
+    return std::unique_ptr<VideoDecoderZstd>(new VideoDecoderZstd());
+}
+
+bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    const Rect frame_rect = Rect::makeSize(frame->size());
+    size_t data_size = 0;
+
+    std::vector<Rect> dirty_rects;
+    if (!dirtyRects(packet, &dirty_rects))
+        return false;
+
+    for (const Rect& rect : dirty_rects)
+    {
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        data_size += static_cast<size_t>(rect.width()) * rect.height() * Frame::kBytesPerPixel;
+    }
+
+    if (!data_size)
+        return true;
+
+    if (translate_buffer_.size() < data_size)
+        translate_buffer_.resize(data_size);
+
+    size_t ret = ZSTD_initDStream(stream_.get());
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_ERROR) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
+        return false;
+    }
+
+    ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
+    ZSTD_outBuffer output = { translate_buffer_.data(), data_size, 0 };
+
+    while (input.pos < input.size)
+    {
+        ret = ZSTD_decompressStream(stream_.get(), &output, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (output.pos == output.size)
+            break;
+    }
+
+    if (output.pos != data_size)
+    {
+        LOG(LS_WARNING) << "Wrong size of the decompressed data: " << output.pos
+                        << " (expected: " << data_size << ")";
+        return false;
+    }
+
+    const uint8_t* in = translate_buffer_.data();
+
+    for (const Rect& rect : dirty_rects)
+        in = restoreRect(in, rect, frame);
+
+    return true;
+}
+
+} // namespace base
@@ -18,6 +18,7 @@
 
 #include "base/codec/video_encoder.h"
 
+#include "base/codec/dirty_rects.h"
 #include "base/desktop/frame.h"
 
 namespace base {
@@ -42,4 +43,9 @@ void VideoEncoder::fillPacketInfo(const Frame* frame, proto::VideoPacket* packet
     }
 }
 
+void VideoEncoder::setDirtyRects(const Region& region, proto::VideoPacket* packet) const
+{
+    base::setDirtyRects(region, packed_dirty_rects_, packet);
+}
+
 } // namespace base
@@ -20,8 +20,11 @@
 #define BASE__CODEC__VIDEO_ENCODER_H
 
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
 #include "proto/desktop.pb.h"
 
+#include <chrono>
+
 namespace base {
 
 class Frame;
@@ -34,14 +37,81 @@ public:
 
     virtual void encode(const Frame* frame, proto::VideoPacket* packet) = 0;
 
+    // Returns true if the encoder is unable to encode the frames any more, for example a hardware
+    // encoder which could not be created for the new frame size. The packet of the failed frame
+    // has no data, the caller has to encode the frame with another encoder.
+    virtual bool isFailed() const { return false; }
+
+    // Changes the target bitrate (in kbps) of the encoder. Encoders without the rate control
+    // ignore it.
+    virtual void setTargetBitrate(uint32_t /* bitrate */) {}
+
+    // Enables the temporal scalability: the frames are split into the base layer and the
+    // enhancement layer, and the frames of the enhancement layer can be dropped for slow viewers.
+    // Takes effect from the next key frame. Returns false if the encoder does not support it.
+    virtual bool setTemporalLayering(bool /* enable */) { return false; }
+
+    // Returns the temporal layer of the last encoded packet. 0 is the base layer.
+    virtual int temporalLayer() const { return 0; }
+
+    // Returns the quantizer (0..63) of the last encoded packet or -1 if the encoder does not
+    // report it.
+    virtual int lastQuantizer() const { return -1; }
+
+    // The blocks of the frame inside |region| are encoded with a lower quantizer than the rest of
+    // the frame. An empty region disables it. Encoders without the support ignore it.
+    virtual void setRegionOfInterest(const Region& /* region */) {}
+
+    // The blocks of the frame inside |region| contain a natural video. They are encoded with a
+    // higher quantizer than the rest of the frame, the motion hides the loss. An empty region
+    // disables it. Encoders without the support ignore it.
+    virtual void setVideoRegion(const Region& /* region */) {}
+
+    // Allows the encoder to change the frame size without a key frame. The packet with the new
+    // format then contains an inter frame. Encoders without the support ignore it.
+    virtual void setInterFrameResize(bool /* enable */) {}
+
+    // Limits the CPU time of the encoder to |share| (0..1] of all the processor cores of the host.
+    // The encoder chooses a faster or a slower speed preset to stay within it. Encoders without
+    // the speed presets ignore it.
+    virtual void setCpuBudget(double /* share */) {}
+
+    // Returns the minimum interval between the frames when even the fastest preset exceeds the
+    // CPU budget. Otherwise returns zero.
+    virtual std::chrono::microseconds minFrameInterval() const
+    {
+        return std::chrono::microseconds::zero();
+    }
+
+    // Returns an estimate of the memory used by the encoder: its buffers and the reference frames
+    // of the codec.
+    virtual size_t memoryUsage() const { return 0; }
+
+    // The dirty rects are written to the packets in the packed form (see base::packRects()).
+    void setPackedDirtyRects(bool enable) { packed_dirty_rects_ = enable; }
+
     proto::VideoEncoding encoding() const { return encoding_; }
 
+    // The next encoded packet contains the format and a key frame.
+    void setKeyFrameRequired() { last_size_ = Size(); }
+
+    // Returns true if the next packet for a frame of |size| contains the format and a key frame.
+    bool isKeyFrameRequired(const Size& size) const { return last_size_ != size; }
+
 protected:
     void fillPacketInfo(const Frame* frame, proto::VideoPacket* packet);
 
+    // Returns the size of the previous encoded frame. It is empty before the first frame and after
+    // setKeyFrameRequired().
+    const Size& lastSize() const { return last_size_; }
+
+    // Writes the rects of |region| to |packet| in the negotiated form.
+    void setDirtyRects(const Region& region, proto::VideoPacket* packet) const;
+
 private:
     const proto::VideoEncoding encoding_;
     Size last_size_;
+    bool packed_dirty_rects_ = false;
 };
 
 } // namespace base
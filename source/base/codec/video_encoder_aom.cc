@@ -0,0 +1,454 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_aom.h"
+
+#include "base/logging.h"
+#include "base/codec/video_bitrate_controller.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert_from_argb.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace base {
+
+namespace {
+
+// Frame duration for the rate control if the previous frame was encoded too long ago or never.
+const std::chrono::milliseconds kTargetFrameInterval{ 80 };
+const std::chrono::milliseconds kMinFrameInterval{ 10 };
+const std::chrono::milliseconds kMaxFrameInterval{ 1000 };
+
+// Above and below these bitrates (in kbps) the quantizer range is shifted.
+const uint32_t kHighBitrate = 5000;
+const uint32_t kLowBitrate = 500;
+
+// The active map of libaom is set for blocks of 16x16 pixels.
+const int kMacroBlockSize = 16;
+
+// libaom does not report its allocations. Most of them are the 8 reference frames, the new frame
+// and the buffers of the loop filters and CDEF of the frame size.
+const size_t kFrameBuffers = 11;
+
+// The deblocking filter of AV1 changes up to 6 pixels on each side of a block edge and CDEF
+// reads 2 more pixels, so the unchanged pixels up to 8 pixels away may still be affected.
+const int kPadding = 8;
+
+// The speed 9 of the real time mode still searches the palette modes for the screen content. The
+// higher speeds are meant for low end devices, they are used when the encoder exceeds the CPU
+// budget.
+const int kMinCpuUsed = 7;
+const int kMaxCpuUsed = 10;
+const int kInitialCpuUsed = 9;
+
+// The size of a key frame is limited to this percentage of the average frame at the target
+// bitrate. The static areas get their quality back with the next frames.
+const unsigned int kMaxIntraBitratePercent = 400;
+
+// The tile columns are at least 256 pixels wide. The columns are encoded in parallel, and with
+// the row based multithreading the threads also share the rows of superblocks in a column.
+const int kMinTileWidth = 256;
+const int kMaxTileColumnsLog2 = 4;
+
+// More threads do not speed up the encoding of a screen in real time.
+const unsigned int kMaxThreadCount = 16;
+
+// Magic encoder constant for adaptive quantization strategy.
+const unsigned int kAqModeCyclicRefresh = 3;
+
+unsigned int threadCount()
+{
+    return std::min((std::thread::hardware_concurrency() + 1) / 2, kMaxThreadCount);
+}
+
+// Returns log2 of the number of tile columns for a frame of |size|. There are no more columns
+// than threads, and a column is not narrower than the minimum.
+unsigned int tileColumnsLog2(const Size& size, unsigned int threads)
+{
+    unsigned int columns_log2 = 0;
+
+    while (columns_log2 < kMaxTileColumnsLog2 &&
+           (1U << columns_log2) < threads &&
+           (size.width() >> (columns_log2 + 1)) >= kMinTileWidth)
+    {
+        ++columns_log2;
+    }
+
+    return columns_log2;
+}
+
+int roundToTwosMultiple(int x)
+{
+    return x & (~1);
+}
+
+Rect alignRect(const Rect& rect)
+{
+    int x = roundToTwosMultiple(rect.left());
+    int y = roundToTwosMultiple(rect.top());
+    int right = roundToTwosMultiple(rect.right() + 1);
+    int bottom = roundToTwosMultiple(rect.bottom() + 1);
+
+    return Rect::makeLTRB(x, y, right, bottom);
+}
+
+} // namespace
+
+// static
+std::unique_ptr<VideoEncoderAOM> VideoEncoderAOM::createAV1()
+{
+    return std::unique_ptr<VideoEncoderAOM>(new VideoEncoderAOM());
+}
+
+VideoEncoderAOM::VideoEncoderAOM()
+    : VideoEncoder(proto::VIDEO_ENCODING_AV1),
+      target_bitrate_(VideoBitrateController::kDefaultBitrate),
+      speed_controller_(kMinCpuUsed, kMaxCpuUsed, kInitialCpuUsed)
+{
+    memset(&config_, 0, sizeof(config_));
+    memset(&active_map_, 0, sizeof(active_map_));
+    memset(&image_, 0, sizeof(image_));
+}
+
+void VideoEncoderAOM::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    fillPacketInfo(frame, packet);
+
+    bool is_key_frame = false;
+
+    if (packet->has_format())
+    {
+        const Size& frame_size = frame->size();
+
+        createImage(frame_size);
+        createActiveMap(frame_size);
+        createCodec(frame_size);
+
+        is_key_frame = true;
+    }
+
+    // Convert the updated capture data ready for encode.
+    // Update active map based on updated region.
+    prepareImageAndActiveMap(is_key_frame, frame, packet);
+
+    // Apply active map to the encoder.
+    aom_codec_err_t ret = aom_codec_control(codec_.get(), AOME_SET_ACTIVEMAP, &active_map_);
+    DCHECK_EQ(ret, AOM_CODEC_OK);
+
+    // The rate control spends the bitrate budget according to the real time between frames.
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    std::chrono::microseconds duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(current_time - last_encode_time_);
+
+    if (is_key_frame || duration > kMaxFrameInterval)
+        duration = kTargetFrameInterval;
+    else if (duration < kMinFrameInterval)
+        duration = kMinFrameInterval;
+
+    last_encode_time_ = current_time;
+
+    if (is_key_frame)
+        pts_ = 0;
+
+    // Do the actual encoding.
+    ret = aom_codec_encode(codec_.get(),
+                           &image_,
+                           pts_,
+                           static_cast<unsigned long>(duration.count()),
+                           0); // flags
+    DCHECK_EQ(ret, AOM_CODEC_OK);
+
+    // A key frame takes much longer than the others at any speed, it does not count.
+    if (!is_key_frame)
+    {
+        const std::chrono::microseconds encode_time =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - current_time);
+
+        if (speed_controller_.update(encode_time, duration))
+        {
+            LOG(LS_INFO) << "Speed changed to " << speed_controller_.speed()
+                         << " (load: " << speed_controller_.load() << ")";
+
+            ret = aom_codec_control(codec_.get(), AOME_SET_CPUUSED, speed_controller_.speed());
+            DCHECK_EQ(ret, AOM_CODEC_OK);
+        }
+    }
+
+    pts_ += duration.count();
+
+    // Read the encoded data.
+    aom_codec_iter_t iter = nullptr;
+
+    while (true)
+    {
+        const aom_codec_cx_pkt_t* pkt = aom_codec_get_cx_data(codec_.get(), &iter);
+        if (!pkt)
+            break;
+
+        if (pkt->kind == AOM_CODEC_CX_FRAME_PKT)
+        {
+            packet->set_data(pkt->data.frame.buf, pkt->data.frame.sz);
+            break;
+        }
+    }
+}
+
+void VideoEncoderAOM::setTargetBitrate(uint32_t bitrate)
+{
+    if (target_bitrate_ == bitrate)
+        return;
+
+    target_bitrate_ = bitrate;
+
+    // The codec is not created yet. The parameters are applied at creation.
+    if (!codec_)
+        return;
+
+    setRateControlParameters();
+
+    aom_codec_err_t ret = aom_codec_enc_config_set(codec_.get(), &config_);
+    if (ret != AOM_CODEC_OK)
+        LOG(LS_WARNING) << "aom_codec_enc_config_set failed: " << ret;
+}
+
+void VideoEncoderAOM::setCpuBudget(double share)
+{
+    // The load is the share of the real time spent encoding with all the threads of the encoder.
+    const double cores = std::max(std::thread::hardware_concurrency(), 1U);
+    speed_controller_.setBudget(share * cores / threadCount());
+}
+
+size_t VideoEncoderAOM::memoryUsage() const
+{
+    size_t usage = image_buffer_.capacity() + active_map_buffer_.capacity();
+
+    if (codec_)
+        usage += static_cast<size_t>(config_.g_w) * config_.g_h * 3 / 2 * kFrameBuffers;
+
+    return usage;
+}
+
+void VideoEncoderAOM::createCodec(const Size& size)
+{
+    codec_.reset(new aom_codec_ctx_t());
+
+    // Configure the encoder.
+    aom_codec_iface_t* algo = aom_codec_av1_cx();
+
+    aom_codec_err_t ret = aom_codec_enc_config_default(algo, &config_, AOM_USAGE_REALTIME);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    // Use microsecond granularity time base.
+    config_.g_timebase.num = 1;
+    config_.g_timebase.den = static_cast<int>(
+        std::chrono::microseconds(std::chrono::seconds(1)).count());
+
+    config_.g_w = size.width();
+    config_.g_h = size.height();
+    config_.g_pass = AOM_RC_ONE_PASS;
+    config_.g_threads = threadCount();
+
+    // Start emitting packets immediately.
+    config_.g_lag_in_frames = 0;
+
+    // Since the transport layer is reliable, the key frames are sent only on request.
+    config_.kf_mode = AOM_KF_DISABLED;
+
+    // Do not drop any frames at encoder.
+    config_.rc_dropframe_thresh = 0;
+
+    // We do not want variations in bandwidth.
+    config_.rc_end_usage = AOM_VBR;
+    config_.rc_undershoot_pct = 100;
+    config_.rc_overshoot_pct = 15;
+
+    setRateControlParameters();
+
+    ret = aom_codec_enc_init(codec_.get(), algo, &config_, 0);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AOME_SET_CPUUSED, speed_controller_.speed());
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_TUNE_CONTENT, AOM_CONTENT_SCREEN);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    // The palette mode codes the blocks with a few colors (text, icons, window frames). The intra
+    // block copy predicts a block from the already coded part of the same frame, it is used in
+    // the key frames only.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_PALETTE, 1);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_INTRABC, 1);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_TILE_COLUMNS,
+                            tileColumnsLog2(size, config_.g_threads));
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ROW_MT, 1U);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    // Use the lowest level of noise sensitivity so as to spend less time on motion estimation and
+    // inter-prediction mode.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_NOISE_SENSITIVITY, 0U);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AOME_SET_MAX_INTRA_BITRATE_PCT, kMaxIntraBitratePercent);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_AQ_MODE, kAqModeCyclicRefresh);
+    DCHECK_EQ(AOM_CODEC_OK, ret);
+}
+
+void VideoEncoderAOM::createImage(const Size& size)
+{
+    // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
+    // planes' strides to multiples of 16 bytes.
+    const int y_stride = ((size.width() - 1) & ~15) + 16;
+    const int uv_stride = y_stride >> 1;
+
+    // The planes are padded out to the next macro block.
+    const int y_rows = ((size.height() - 1) & ~(kMacroBlockSize - 1)) + kMacroBlockSize;
+    const int uv_rows = y_rows >> 1;
+
+    // The previous data is not copied, the whole buffer is filled below.
+    image_buffer_.clear();
+    image_buffer_.resize(y_stride * y_rows + (2 * uv_stride) * uv_rows);
+
+    // Reset image value to 128 so we just need to fill in the y plane.
+    memset(image_buffer_.data(), 128, image_buffer_.size());
+
+    // With the alignment of 16 the image gets the same strides as computed above.
+    aom_image_t* image = aom_img_wrap(&image_, AOM_IMG_FMT_I420, size.width(), size.height(), 16,
+                                      image_buffer_.data());
+    DCHECK(image);
+    DCHECK_EQ(image_.stride[AOM_PLANE_Y], y_stride);
+}
+
+void VideoEncoderAOM::createActiveMap(const Size& size)
+{
+    active_map_.cols = (size.width() + kMacroBlockSize - 1) / kMacroBlockSize;
+    active_map_.rows = (size.height() + kMacroBlockSize - 1) / kMacroBlockSize;
+
+    active_map_buffer_.resize(active_map_.cols * active_map_.rows);
+    active_map_.active_map = active_map_buffer_.data();
+}
+
+void VideoEncoderAOM::prepareImageAndActiveMap(
+    bool is_key_frame, const Frame* frame, proto::VideoPacket* packet)
+{
+    Rect image_rect = Rect::makeWH(image_.d_w, image_.d_h);
+    Region updated_region;
+
+    if (!is_key_frame)
+    {
+        for (Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+
+            // Pad each rectangle to include the pixels changed by the loop filters. The aligned
+            // rects have even top-left coords, which is required by ARGBToI420().
+            updated_region.addRect(
+                alignRect(Rect::makeLTRB(
+                    rect.left() - kPadding, rect.top() - kPadding,
+                    rect.right() + kPadding, rect.bottom() + kPadding)));
+        }
+
+        // Clip back to the screen dimensions.
+        updated_region.intersectWith(image_rect);
+    }
+    else
+    {
+        updated_region = Region(image_rect);
+    }
+
+    memset(active_map_buffer_.data(), 0, active_map_buffer_.size());
+
+    const int y_stride = image_.stride[AOM_PLANE_Y];
+    const int uv_stride = image_.stride[AOM_PLANE_U];
+    uint8_t* y_data = image_.planes[AOM_PLANE_Y];
+    uint8_t* u_data = image_.planes[AOM_PLANE_U];
+    uint8_t* v_data = image_.planes[AOM_PLANE_V];
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        const int y_offset = y_stride * rect.y() + rect.x();
+        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
+        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           rect.width(),
+                           rect.height());
+
+        addRectToActiveMap(rect);
+    }
+
+    setDirtyRects(updated_region, packet);
+}
+
+void VideoEncoderAOM::addRectToActiveMap(const Rect& rect)
+{
+    int left = rect.left() / kMacroBlockSize;
+    int top = rect.top() / kMacroBlockSize;
+    int right = (rect.right() - 1) / kMacroBlockSize;
+    int bottom = (rect.bottom() - 1) / kMacroBlockSize;
+
+    uint8_t* map = active_map_.active_map + top * active_map_.cols;
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        for (int x = left; x <= right; ++x)
+            map[x] = 1;
+
+        map += active_map_.cols;
+    }
+}
+
+void VideoEncoderAOM::setRateControlParameters()
+{
+    config_.rc_target_bitrate = target_bitrate_;
+
+    // The quantizer range is the same as for VPX. The quality will get topped-off in subsequent
+    // frames.
+    if (target_bitrate_ >= kHighBitrate)
+    {
+        config_.rc_min_quantizer = 10;
+        config_.rc_max_quantizer = 25;
+    }
+    else if (target_bitrate_ <= kLowBitrate)
+    {
+        config_.rc_min_quantizer = 20;
+        config_.rc_max_quantizer = 45;
+    }
+    else
+    {
+        config_.rc_min_quantizer = 20;
+        config_.rc_max_quantizer = 30;
+    }
+}
+
+} // namespace base
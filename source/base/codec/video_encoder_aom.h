@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_ENCODER_AOM_H
+#define BASE__CODEC__VIDEO_ENCODER_AOM_H
+
+#include "base/macros_magic.h"
+#include "base/codec/scoped_aom_codec.h"
+#include "base/codec/video_encoder.h"
+#include "base/codec/video_speed_controller.h"
+#include "base/memory/buffer.h"
+#include "base/memory/byte_array.h"
+
+#include <aom/aomcx.h>
+
+#include <chrono>
+
+namespace base {
+
+// AV1 encoder based on the real time mode of libaom. The screen content tools (the palette mode
+// and the intra block copy) are enabled, they code text and flat areas much better than VP9. As
+// with VP8 and VP9, only the blocks of the updated region are active.
+class VideoEncoderAOM : public VideoEncoder
+{
+public:
+    ~VideoEncoderAOM() = default;
+
+    static std::unique_ptr<VideoEncoderAOM> createAV1();
+
+    void encode(const Frame* frame, proto::VideoPacket* packet) override;
+    void setTargetBitrate(uint32_t bitrate) override;
+    void setCpuBudget(double share) override;
+    std::chrono::microseconds minFrameInterval() const override
+    {
+        return speed_controller_.minFrameInterval();
+    }
+    size_t memoryUsage() const override;
+
+private:
+    VideoEncoderAOM();
+
+    void createCodec(const Size& size);
+    void createImage(const Size& size);
+    void createActiveMap(const Size& size);
+    void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame,
+                                  proto::VideoPacket* packet);
+    void addRectToActiveMap(const Rect& rect);
+    void setRateControlParameters();
+
+    aom_codec_enc_cfg_t config_;
+    uint32_t target_bitrate_;
+    std::chrono::steady_clock::time_point last_encode_time_;
+    aom_codec_pts_t pts_ = 0;
+
+    VideoSpeedController speed_controller_;
+
+    ScopedAomCodec codec_;
+
+    ByteArray active_map_buffer_;
+    aom_active_map_t active_map_;
+
+    // The image refers to the planes in the buffer.
+    aom_image_t image_;
+    Buffer image_buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderAOM);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_ENCODER_AOM_H
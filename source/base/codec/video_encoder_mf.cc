@@ -0,0 +1,538 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_mf.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert_from_argb.h>
+
+#include <codecapi.h>
+#include <mferror.h>
+#include <mfidl.h>
+#include <strmif.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+namespace {
+
+const UINT32 kFrameRate = 30;
+
+// Hardware encoders need a higher bitrate than VPX for the same quality of the screen content.
+const UINT32 kTargetBitrate = 2000000;
+
+// Since the transport layer is reliable, key frames are needed only at the start of the stream.
+const UINT32 kGopSize = 10000;
+
+// 100-nanosecond units used by Media Foundation.
+const LONGLONG kFrameDuration = 10000000 / kFrameRate;
+
+int alignToEven(int value)
+{
+    return (value + 1) & ~1;
+}
+
+ComPtr<IMFTransform> createHardwareTransform()
+{
+    MFT_REGISTER_TYPE_INFO output_type = { MFMediaType_Video, MFVideoFormat_H264 };
+
+    IMFActivate** activates = nullptr;
+    UINT32 count = 0;
+
+    HRESULT hr = MFTEnumEx(MFT_CATEGORY_VIDEO_ENCODER,
+                           MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER,
+                           nullptr,
+                           &output_type,
+                           &activates,
+                           &count);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFTEnumEx failed: " << hr;
+        return nullptr;
+    }
+
+    ComPtr<IMFTransform> transform;
+
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        if (!transform)
+        {
+            hr = activates[i]->ActivateObject(IID_PPV_ARGS(transform.GetAddressOf()));
+            if (FAILED(hr))
+            {
+                LOG(LS_WARNING) << "IMFActivate::ActivateObject failed: " << hr;
+                transform.Reset();
+            }
+        }
+
+        activates[i]->Release();
+    }
+
+    CoTaskMemFree(activates);
+    return transform;
+}
+
+// The encoded image is aligned to the even size. The padding of the Y plane repeats the last
+// column and the last row of the frame, so the encoder does not get uninitialized pixels. The UV
+// plane is subsampled and is covered by the conversion.
+void replicateEdges(uint8_t* y_plane, const Size& frame_size, const Size& image_size)
+{
+    const int stride = image_size.width();
+
+    if (frame_size.width() < image_size.width())
+    {
+        for (int y = 0; y < frame_size.height(); ++y)
+        {
+            uint8_t* row = y_plane + y * stride;
+            row[image_size.width() - 1] = row[frame_size.width() - 1];
+        }
+    }
+
+    if (frame_size.height() < image_size.height())
+    {
+        memcpy(y_plane + (image_size.height() - 1) * stride,
+               y_plane + (frame_size.height() - 1) * stride,
+               stride);
+    }
+}
+
+bool setVideoType(IMFMediaType* type, const GUID& subtype, const Size& size)
+{
+    return SUCCEEDED(type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video)) &&
+           SUCCEEDED(type->SetGUID(MF_MT_SUBTYPE, subtype)) &&
+           SUCCEEDED(type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive)) &&
+           SUCCEEDED(MFSetAttributeSize(type, MF_MT_FRAME_SIZE, size.width(), size.height())) &&
+           SUCCEEDED(MFSetAttributeRatio(type, MF_MT_FRAME_RATE, kFrameRate, 1)) &&
+           SUCCEEDED(MFSetAttributeRatio(type, MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+}
+
+void setCodecValue(ICodecAPI* codec_api, const GUID& api, UINT32 value)
+{
+    VARIANT variant;
+    variant.vt = VT_UI4;
+    variant.ulVal = value;
+
+    HRESULT hr = codec_api->SetValue(&api, &variant);
+    if (FAILED(hr))
+        LOG(LS_WARNING) << "ICodecAPI::SetValue failed: " << hr;
+}
+
+void setCodecValue(ICodecAPI* codec_api, const GUID& api, bool value)
+{
+    VARIANT variant;
+    variant.vt = VT_BOOL;
+    variant.boolVal = value ? VARIANT_TRUE : VARIANT_FALSE;
+
+    HRESULT hr = codec_api->SetValue(&api, &variant);
+    if (FAILED(hr))
+        LOG(LS_WARNING) << "ICodecAPI::SetValue failed: " << hr;
+}
+
+} // namespace
+
+VideoEncoderMF::VideoEncoderMF()
+    : VideoEncoder(proto::VIDEO_ENCODING_H264)
+{
+    // Nothing
+}
+
+VideoEncoderMF::~VideoEncoderMF()
+{
+    if (transform_ && streaming_)
+        transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+
+    event_generator_.Reset();
+    transform_.Reset();
+
+    MFShutdown();
+}
+
+// static
+bool VideoEncoderMF::isH264Supported()
+{
+    if (FAILED(MFStartup(MF_VERSION, MFSTARTUP_LITE)))
+        return false;
+
+    const bool result = createHardwareTransform() != nullptr;
+
+    MFShutdown();
+    return result;
+}
+
+// static
+std::unique_ptr<VideoEncoderMF> VideoEncoderMF::createH264()
+{
+    HRESULT hr = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFStartup failed: " << hr;
+        return nullptr;
+    }
+
+    // The destructor calls MFShutdown().
+    std::unique_ptr<VideoEncoderMF> encoder(new VideoEncoderMF());
+
+    // The found transform is configured for the first frame.
+    encoder->transform_ = createHardwareTransform();
+    if (!encoder->transform_)
+    {
+        LOG(LS_WARNING) << "No hardware H.264 encoder found";
+        return nullptr;
+    }
+
+    return encoder;
+}
+
+void VideoEncoderMF::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    fillPacketInfo(frame, packet);
+
+    if (packet->has_format())
+    {
+        // The encoder is recreated for the new size, so the next frame is a key frame.
+        if (!createTransform(frame->size()))
+        {
+            LOG(LS_WARNING) << "Unable to create the transform for size " << frame->size();
+
+            transform_.Reset();
+            event_generator_.Reset();
+            streaming_ = false;
+            failed_ = true;
+        }
+    }
+
+    if (!transform_)
+        return;
+
+    // The hardware transforms are asynchronous. First the transform requests the input.
+    while (pending_input_requests_ == 0)
+    {
+        MediaEventType type;
+        if (!waitForEvent(&type))
+            return;
+
+        if (type == METransformNeedInput)
+            ++pending_input_requests_;
+    }
+
+    if (!processInput(frame))
+        return;
+
+    --pending_input_requests_;
+
+    // In the low latency mode the transform returns the output for each input.
+    while (true)
+    {
+        MediaEventType type;
+        if (!waitForEvent(&type))
+            return;
+
+        if (type == METransformNeedInput)
+        {
+            ++pending_input_requests_;
+        }
+        else if (type == METransformHaveOutput)
+        {
+            if (!processOutput(packet))
+                return;
+            break;
+        }
+    }
+
+    // The whole image is encoded and decoded on each frame.
+    setDirtyRects(Region(Rect::makeSize(frame->size())), packet);
+}
+
+bool VideoEncoderMF::createTransform(const Size& size)
+{
+    // The transform is recreated for each stream. The transform found by createH264() has not
+    // been used yet.
+    if (streaming_)
+    {
+        transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+        transform_.Reset();
+        streaming_ = false;
+    }
+
+    event_generator_.Reset();
+
+    if (!transform_)
+        transform_ = createHardwareTransform();
+    if (!transform_)
+        return false;
+
+    pending_input_requests_ = 0;
+    frame_index_ = 0;
+
+    // NV12 requires the even width and height.
+    image_size_ = Size(alignToEven(size.width()), alignToEven(size.height()));
+
+    ComPtr<IMFAttributes> attributes;
+    HRESULT hr = transform_->GetAttributes(attributes.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::GetAttributes failed: " << hr;
+        return false;
+    }
+
+    // The asynchronous transforms must be unlocked before use.
+    UINT32 is_async = FALSE;
+    attributes->GetUINT32(MF_TRANSFORM_ASYNC, &is_async);
+    if (!is_async)
+    {
+        LOG(LS_WARNING) << "Hardware transform is not asynchronous";
+        return false;
+    }
+
+    hr = attributes->SetUINT32(MF_TRANSFORM_ASYNC_UNLOCK, TRUE);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "Unable to unlock the transform: " << hr;
+        return false;
+    }
+
+    hr = transform_.As(&event_generator_);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "Unable to get IMFMediaEventGenerator: " << hr;
+        return false;
+    }
+
+    hr = transform_->GetStreamIDs(1, &input_stream_id_, 1, &output_stream_id_);
+    if (hr == E_NOTIMPL)
+    {
+        input_stream_id_ = 0;
+        output_stream_id_ = 0;
+    }
+    else if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::GetStreamIDs failed: " << hr;
+        return false;
+    }
+
+    ComPtr<ICodecAPI> codec_api;
+    if (SUCCEEDED(transform_.As(&codec_api)))
+    {
+        setCodecValue(codec_api.Get(), CODECAPI_AVLowLatencyMode, true);
+        setCodecValue(codec_api.Get(), CODECAPI_AVEncCommonRateControlMode,
+                      static_cast<UINT32>(eAVEncCommonRateControlMode_CBR));
+        setCodecValue(codec_api.Get(), CODECAPI_AVEncCommonMeanBitRate, kTargetBitrate);
+        setCodecValue(codec_api.Get(), CODECAPI_AVEncMPVGOPSize, kGopSize);
+    }
+
+    // The encoders require the output type to be set before the input type.
+    ComPtr<IMFMediaType> output_type;
+    hr = MFCreateMediaType(output_type.GetAddressOf());
+    if (FAILED(hr) || !setVideoType(output_type.Get(), MFVideoFormat_H264, image_size_) ||
+        FAILED(output_type->SetUINT32(MF_MT_AVG_BITRATE, kTargetBitrate)) ||
+        FAILED(output_type->SetUINT32(MF_MT_MPEG2_PROFILE, eAVEncH264VProfile_Main)))
+    {
+        LOG(LS_WARNING) << "Unable to create the output type";
+        return false;
+    }
+
+    hr = transform_->SetOutputType(output_stream_id_, output_type.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::SetOutputType failed: " << hr;
+        return false;
+    }
+
+    ComPtr<IMFMediaType> input_type;
+    hr = MFCreateMediaType(input_type.GetAddressOf());
+    if (FAILED(hr) || !setVideoType(input_type.Get(), MFVideoFormat_NV12, image_size_))
+    {
+        LOG(LS_WARNING) << "Unable to create the input type";
+        return false;
+    }
+
+    hr = transform_->SetInputType(input_stream_id_, input_type.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::SetInputType failed: " << hr;
+        return false;
+    }
+
+    if (FAILED(transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0)) ||
+        FAILED(transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0)))
+    {
+        LOG(LS_WARNING) << "Unable to start the stream";
+        return false;
+    }
+
+    streaming_ = true;
+
+    LOG(LS_INFO) << "Hardware H.264 encoder created (size: " << image_size_ << ")";
+    return true;
+}
+
+bool VideoEncoderMF::waitForEvent(MediaEventType* type)
+{
+    ComPtr<IMFMediaEvent> event;
+
+    HRESULT hr = event_generator_->GetEvent(0, event.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFMediaEventGenerator::GetEvent failed: " << hr;
+        return false;
+    }
+
+    hr = event->GetType(type);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFMediaEvent::GetType failed: " << hr;
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoEncoderMF::processInput(const Frame* frame)
+{
+    const int y_size = image_size_.width() * image_size_.height();
+    const int uv_size = y_size / 2;
+
+    ComPtr<IMFMediaBuffer> buffer;
+    HRESULT hr = MFCreateMemoryBuffer(y_size + uv_size, buffer.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateMemoryBuffer failed: " << hr;
+        return false;
+    }
+
+    BYTE* data = nullptr;
+    hr = buffer->Lock(&data, nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFMediaBuffer::Lock failed: " << hr;
+        return false;
+    }
+
+    libyuv::ARGBToNV12(frame->frameData(), frame->stride(),
+                       data, image_size_.width(),
+                       data + y_size, image_size_.width(),
+                       frame->size().width(), frame->size().height());
+    replicateEdges(data, frame->size(), image_size_);
+
+    buffer->Unlock();
+    buffer->SetCurrentLength(y_size + uv_size);
+
+    ComPtr<IMFSample> sample;
+    hr = MFCreateSample(sample.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateSample failed: " << hr;
+        return false;
+    }
+
+    sample->AddBuffer(buffer.Get());
+    sample->SetSampleTime(frame_index_ * kFrameDuration);
+    sample->SetSampleDuration(kFrameDuration);
+    ++frame_index_;
+
+    hr = transform_->ProcessInput(input_stream_id_, sample.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::ProcessInput failed: " << hr;
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoEncoderMF::processOutput(proto::VideoPacket* packet)
+{
+    MFT_OUTPUT_STREAM_INFO stream_info;
+    memset(&stream_info, 0, sizeof(stream_info));
+
+    HRESULT hr = transform_->GetOutputStreamInfo(output_stream_id_, &stream_info);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::GetOutputStreamInfo failed: " << hr;
+        return false;
+    }
+
+    ComPtr<IMFSample> sample;
+
+    const DWORD provides_samples =
+        MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES;
+    if (!(stream_info.dwFlags & provides_samples))
+    {
+        ComPtr<IMFMediaBuffer> buffer;
+
+        if (FAILED(MFCreateSample(sample.GetAddressOf())) ||
+            FAILED(MFCreateMemoryBuffer(stream_info.cbSize, buffer.GetAddressOf())) ||
+            FAILED(sample->AddBuffer(buffer.Get())))
+        {
+            LOG(LS_WARNING) << "Unable to create the output sample";
+            return false;
+        }
+    }
+
+    MFT_OUTPUT_DATA_BUFFER output;
+    memset(&output, 0, sizeof(output));
+    output.dwStreamID = output_stream_id_;
+    output.pSample = sample.Get();
+
+    DWORD status = 0;
+    hr = transform_->ProcessOutput(0, 1, &output, &status);
+
+    if (output.pEvents)
+        output.pEvents->Release();
+
+    // If the transform provides the sample, we own it now.
+    ComPtr<IMFSample> output_sample;
+    if (!sample)
+        output_sample.Attach(output.pSample);
+    else
+        output_sample = sample;
+
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::ProcessOutput failed: " << hr;
+        return false;
+    }
+
+    ComPtr<IMFMediaBuffer> buffer;
+    hr = output_sample->ConvertToContiguousBuffer(buffer.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFSample::ConvertToContiguousBuffer failed: " << hr;
+        return false;
+    }
+
+    BYTE* data = nullptr;
+    DWORD length = 0;
+
+    hr = buffer->Lock(&data, nullptr, &length);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFMediaBuffer::Lock failed: " << hr;
+        return false;
+    }
+
+    packet->set_data(data, length);
+    buffer->Unlock();
+
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_ENCODER_MF_H
+#define BASE__CODEC__VIDEO_ENCODER_MF_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_encoder.h"
+
+#include <memory>
+
+#include <mfapi.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// H.264 encoder based on a hardware Media Foundation transform. The video card vendors provide
+// their encoders (NVENC, Quick Sync, AMF) as such transforms, so the encoding is done on the GPU
+// and the CPU is used only for the color conversion.
+// The encoder must be created and used on a thread with initialized COM.
+class VideoEncoderMF : public VideoEncoder
+{
+public:
+    ~VideoEncoderMF() override;
+
+    // Returns true if the system has a hardware H.264 encoder.
+    static bool isH264Supported();
+
+    // Returns nullptr if the system does not have a hardware H.264 encoder.
+    static std::unique_ptr<VideoEncoderMF> createH264();
+
+    void encode(const Frame* frame, proto::VideoPacket* packet) override;
+    bool isFailed() const override { return failed_; }
+
+private:
+    VideoEncoderMF();
+
+    bool createTransform(const Size& size);
+    bool waitForEvent(MediaEventType* type);
+    bool processInput(const Frame* frame);
+    bool processOutput(proto::VideoPacket* packet);
+
+    Microsoft::WRL::ComPtr<IMFTransform> transform_;
+    Microsoft::WRL::ComPtr<IMFMediaEventGenerator> event_generator_;
+    DWORD input_stream_id_ = 0;
+    DWORD output_stream_id_ = 0;
+
+    // The number of METransformNeedInput events not yet answered with ProcessInput().
+    int pending_input_requests_ = 0;
+
+    // The streaming of |transform_| has been started.
+    bool streaming_ = false;
+
+    // The transform could not be created for the current size.
+    bool failed_ = false;
+
+    Size image_size_;
+    int64_t frame_index_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderMF);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_ENCODER_MF_H
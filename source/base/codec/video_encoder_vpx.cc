@@ -19,28 +19,90 @@
 #include "base/codec/video_encoder_vpx.h"
 
 #include "base/logging.h"
+#include "base/codec/video_bitrate_controller.h"
 #include "base/desktop/frame.h"
 
 #include <libyuv/convert.h>
+#include <libyuv/convert_from_argb.h>
 #include <libyuv/cpu_id.h>
 
+#include <algorithm>
 #include <thread>
 
 namespace base {
 
 namespace {
 
+// Frame duration for the rate control if the previous frame was encoded too long ago or never.
 const std::chrono::milliseconds kTargetFrameInterval{ 80 };
+const std::chrono::milliseconds kMinFrameInterval{ 10 };
+const std::chrono::milliseconds kMaxFrameInterval{ 1000 };
+
+// Above and below these bitrates (in kbps) the quantizer range is shifted.
+const uint32_t kHighBitrate = 5000;
+const uint32_t kLowBitrate = 500;
 
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
-// Magic encoder profile numbers for I420 input formats.
+// libvpx does not report its allocations. Most of them are the reference frames, the new frame
+// and the scaled source in the format of the source.
+const size_t kVp8FrameBuffers = 4;
+const size_t kVp9FrameBuffers = 10;
+
+// The ROI map of VP9 is set for blocks of 8x8 pixels, the ROI map of VP8 for macro blocks.
+const int kVp9RoiBlockSize = 8;
+
+// Quantizer deltas for the blocks of the region of interest. VP8 quantizer index is in 0..127,
+// VP9 quantizer index is in 0..255.
+const int kVp8RoiDeltaQ = -12;
+const int kVp9RoiDeltaQ = -24;
+
+// Quantizer deltas for the blocks of the video region.
+const int kVp8VideoDeltaQ = 16;
+const int kVp9VideoDeltaQ = 32;
+
+// The size of a key frame is limited to this percentage of the average frame at the target
+// bitrate. The static areas get their quality back with the next frames.
+const unsigned int kMaxIntraBitratePercent = 400;
+
+// The tile columns of VP9 are at least 256 pixels wide. The columns are encoded in parallel, and
+// with the row based multithreading the threads also share the rows of superblocks in a column.
+const int kVp9MinTileWidth = 256;
+const int kVp9MaxTileColumnsLog2 = 4;
+
+// More threads do not speed up the encoding of a screen in real time.
+const unsigned int kMaxThreadCount = 16;
+
+// The range of the speed presets (cpu-used) chosen according to the CPU budget. VP8 starts with
+// the fastest preset, it turns off the subpixel motion search. VP9 starts with the fastest preset
+// that still does a full partition search of the text.
+const int kVp8MinCpuUsed = 10;
+const int kVp8MaxCpuUsed = 16;
+const int kVp8InitialCpuUsed = 16;
+const int kVp9MinCpuUsed = 5;
+const int kVp9MaxCpuUsed = 9;
+const int kVp9InitialCpuUsed = 6;
+
+// Magic encoder profile numbers for I420 and I444 input formats.
 const int kVp9I420ProfileNumber = 0;
+const int kVp9I444ProfileNumber = 1;
+
+// Two temporal layers: even frames are the base layer, odd frames can be dropped.
+const unsigned int kTemporalLayers = 2;
+const uint32_t kBaseLayerBitratePercent = 60;
 
 // Magic encoder constant for adaptive quantization strategy.
 const int kVp9AqModeCyclicRefresh = 3;
 
+// Using 2 threads gives a great boost in performance for most systems with adequate processing
+// power. NB: Going to multiple threads on low end windows systems can really hurt performance.
+// http://crbug.com/99179
+unsigned int threadCount()
+{
+    return std::min((std::thread::hardware_concurrency() + 1) / 2, kMaxThreadCount);
+}
+
 void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
 {
     // Use millisecond granularity time base.
@@ -61,11 +123,7 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
     config->kf_min_dist = 10000;
     config->kf_max_dist = 10000;
 
-    // Using 2 threads gives a great boost in performance for most systems with
-    // adequate processing power. NB: Going to multiple threads on low end
-    // windows systems can really hurt performance.
-    // http://crbug.com/99179
-    config->g_threads = (std::thread::hardware_concurrency() + 1) / 2;
+    config->g_threads = threadCount();
 
     // Do not drop any frames at encoder.
     config->rc_dropframe_thresh = 0;
@@ -76,9 +134,26 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
     config->rc_overshoot_pct = 15;
 }
 
+// Returns log2 of the number of VP9 tile columns for a frame of |size|. There are no more columns
+// than threads, and a column is not narrower than the minimum.
+int vp9TileColumnsLog2(const Size& size, unsigned int threads)
+{
+    int columns_log2 = 0;
+
+    while (columns_log2 < kVp9MaxTileColumnsLog2 &&
+           (1U << columns_log2) < threads &&
+           (size.width() >> (columns_log2 + 1)) >= kVp9MinTileWidth)
+    {
+        ++columns_log2;
+    }
+
+    return columns_log2;
+}
+
 void createImage(const Size& size,
+                 bool is_i444,
                  std::unique_ptr<vpx_image_t>* out_image,
-                 ByteArray* out_image_buffer)
+                 Buffer* out_image_buffer)
 {
     std::unique_ptr<vpx_image_t> image = std::make_unique<vpx_image_t>();
 
@@ -87,9 +162,18 @@ void createImage(const Size& size,
     image->d_w = image->w = size.width();
     image->d_h = image->h = size.height();
 
-    image->fmt = VPX_IMG_FMT_YV12;
-    image->x_chroma_shift = 1;
-    image->y_chroma_shift = 1;
+    if (is_i444)
+    {
+        image->fmt = VPX_IMG_FMT_I444;
+        image->x_chroma_shift = 0;
+        image->y_chroma_shift = 0;
+    }
+    else
+    {
+        image->fmt = VPX_IMG_FMT_YV12;
+        image->x_chroma_shift = 1;
+        image->y_chroma_shift = 1;
+    }
 
     // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
     // planes' strides to multiples of 16 bytes.
@@ -105,9 +189,13 @@ void createImage(const Size& size,
     const int y_rows = ((image->h - 1) & ~(kMacroBlockSize - 1)) + kMacroBlockSize;
     const int uv_rows = y_rows >> image->y_chroma_shift;
 
-    ByteArray image_buffer;
+    // The buffer of the previous size is reused. It does not shrink, so the size changes of a
+    // resized window do not allocate memory each time.
+    Buffer image_buffer = std::move(*out_image_buffer);
 
-    // Allocate a YUV buffer large enough for the aligned data & padding.
+    // Allocate a YUV buffer large enough for the aligned data & padding. The previous data is not
+    // copied, the whole buffer is filled below.
+    image_buffer.clear();
     image_buffer.resize(y_stride * y_rows + (2 * uv_stride) * uv_rows);
 
     // Reset image value to 128 so we just need to fill in the y plane.
@@ -145,66 +233,156 @@ Rect alignRect(const Rect& rect)
 // static
 std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP8()
 {
-    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP8));
+    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP8, false));
 }
 
 // static
 std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP9()
 {
-    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP9));
+    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP9, false));
 }
 
-VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
-    : VideoEncoder(encoding)
+// static
+std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP9I444()
 {
+    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP9, true));
+}
+
+VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding, bool is_i444)
+    : VideoEncoder(encoding),
+      is_i444_(is_i444),
+      target_bitrate_(VideoBitrateController::kDefaultBitrate),
+      speed_controller_(encoding == proto::VIDEO_ENCODING_VP8 ? kVp8MinCpuUsed : kVp9MinCpuUsed,
+                        encoding == proto::VIDEO_ENCODING_VP8 ? kVp8MaxCpuUsed : kVp9MaxCpuUsed,
+                        encoding == proto::VIDEO_ENCODING_VP8 ?
+                            kVp8InitialCpuUsed : kVp9InitialCpuUsed)
+{
+    DCHECK(!is_i444_ || encoding == proto::VIDEO_ENCODING_VP9);
+
     memset(&config_, 0, sizeof(config_));
     memset(&active_map_, 0, sizeof(active_map_));
 }
 
 void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
 {
+    const Size last_size = lastSize();
     fillPacketInfo(frame, packet);
 
     bool is_key_frame = false;
+    bool is_resized = false;
 
     if (packet->has_format())
     {
         const Size& frame_size = frame->size();
 
-        createImage(frame_size, &image_, &image_buffer_);
+        createImage(frame_size, is_i444_, &image_, &image_buffer_);
         createActiveMap(frame_size);
 
-        if (encoding() == proto::VIDEO_ENCODING_VP8)
+        // The whole frame is encoded as an inter frame with the scaled reference frames.
+        if (canResizeCodec(last_size, frame_size) && resizeCodec(frame_size))
         {
-            createVp8Codec(frame_size);
+            packet->mutable_format()->set_inter_frame(true);
+            is_resized = true;
         }
         else
         {
-            DCHECK_EQ(encoding(), proto::VIDEO_ENCODING_VP9);
-            createVp9Codec(frame_size);
+            // The layering mode can be changed only with a new key frame.
+            temporal_layering_ = next_temporal_layering_;
+            layer_region_.clear();
+
+            if (encoding() == proto::VIDEO_ENCODING_VP8)
+            {
+                createVp8Codec(frame_size);
+            }
+            else
+            {
+                DCHECK_EQ(encoding(), proto::VIDEO_ENCODING_VP9);
+                createVp9Codec(frame_size);
+            }
+
+            is_key_frame = true;
         }
-
-        is_key_frame = true;
     }
 
     // Convert the updated capture data ready for encode.
-    // Update active map based on updated region.
-    prepareImageAndActiveMap(is_key_frame, frame, packet);
+    // Update active map based on updated region. The whole frame is updated after a size change.
+    prepareImageAndActiveMap(packet->has_format(), frame, packet);
 
     // Apply active map to the encoder.
     vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
     DCHECK_EQ(ret, VPX_CODEC_OK);
 
+    // The rate control spends the bitrate budget according to the real time between frames.
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    std::chrono::microseconds duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(current_time - last_encode_time_);
+
+    if (is_key_frame || duration > kMaxFrameInterval)
+        duration = kTargetFrameInterval;
+    else if (duration < kMinFrameInterval)
+        duration = kMinFrameInterval;
+
+    last_encode_time_ = current_time;
+
+    if (is_key_frame)
+        pts_ = 0;
+
+    // A new codec is created for the key frame, so the map is applied again. The size of the map
+    // depends on the size of the frame.
+    if (is_key_frame || is_resized || roi_changed_)
+        applyRoiMap();
+
     // Do the actual encoding.
     ret = vpx_codec_encode(codec_.get(),
                            image_.get(),
-                           0, // pts
-                           static_cast<unsigned long>(
-                               std::chrono::microseconds(kTargetFrameInterval).count()),
+                           pts_,
+                           static_cast<unsigned long>(duration.count()),
                            0, // flags
                            VPX_DL_REALTIME);
     DCHECK_EQ(ret, VPX_CODEC_OK);
 
+    // A key frame takes much longer than the others at any speed, it does not count.
+    if (!is_key_frame)
+    {
+        const std::chrono::microseconds encode_time =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - current_time);
+
+        if (speed_controller_.update(encode_time, duration))
+        {
+            LOG(LS_INFO) << "Speed changed to " << speed_controller_.speed()
+                         << " (load: " << speed_controller_.load() << ")";
+
+            ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, speed_controller_.speed());
+            DCHECK_EQ(ret, VPX_CODEC_OK);
+        }
+    }
+
+    pts_ += duration.count();
+
+    if (vpx_codec_control(codec_.get(), VP8E_GET_LAST_QUANTIZER_64, &last_quantizer_) !=
+        VPX_CODEC_OK)
+    {
+        last_quantizer_ = -1;
+    }
+
+    temporal_layer_ = 0;
+
+    if (temporal_layering_)
+    {
+        vpx_svc_layer_id_t layer_id;
+        memset(&layer_id, 0, sizeof(layer_id));
+
+        ret = vpx_codec_control(codec_.get(), VP9E_GET_SVC_LAYER_ID, &layer_id);
+        DCHECK_EQ(ret, VPX_CODEC_OK);
+
+        temporal_layer_ = layer_id.temporal_layer_id;
+
+        // The next frames refer to this base layer frame.
+        if (temporal_layer_ == 0)
+            layer_region_.clear();
+    }
+
     // Read the encoded data.
     vpx_codec_iter_t iter = nullptr;
 
@@ -222,6 +400,76 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
     }
 }
 
+bool VideoEncoderVPX::setTemporalLayering(bool enable)
+{
+    if (encoding() != proto::VIDEO_ENCODING_VP9)
+        return false;
+
+    next_temporal_layering_ = enable;
+    return true;
+}
+
+void VideoEncoderVPX::setRegionOfInterest(const Region& region)
+{
+    if (roi_region_.equals(region))
+        return;
+
+    roi_region_ = region;
+    roi_changed_ = true;
+}
+
+void VideoEncoderVPX::setVideoRegion(const Region& region)
+{
+    if (video_region_.equals(region))
+        return;
+
+    video_region_ = region;
+    roi_changed_ = true;
+}
+
+void VideoEncoderVPX::setTargetBitrate(uint32_t bitrate)
+{
+    if (target_bitrate_ == bitrate)
+        return;
+
+    target_bitrate_ = bitrate;
+
+    // The codec is not created yet. The parameters are applied at creation.
+    if (!codec_)
+        return;
+
+    setRateControlParameters();
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    if (ret != VPX_CODEC_OK)
+        LOG(LS_WARNING) << "vpx_codec_enc_config_set failed: " << ret;
+}
+
+void VideoEncoderVPX::setCpuBudget(double share)
+{
+    // The load is the share of the real time spent encoding with all the threads of the encoder.
+    const double cores = std::max(std::thread::hardware_concurrency(), 1U);
+    speed_controller_.setBudget(share * cores / threadCount());
+}
+
+size_t VideoEncoderVPX::memoryUsage() const
+{
+    size_t usage = image_buffer_.capacity() + active_map_buffer_.capacity() +
+        roi_map_buffer_.capacity();
+
+    if (codec_)
+    {
+        const size_t frame_size =
+            static_cast<size_t>(config_.g_w) * config_.g_h * (is_i444_ ? 6 : 3) / 2;
+        const size_t frame_buffers = encoding() == proto::VIDEO_ENCODING_VP8 ?
+            kVp8FrameBuffers : kVp9FrameBuffers;
+
+        usage += frame_size * frame_buffers;
+    }
+
+    return usage;
+}
+
 void VideoEncoderVPX::createActiveMap(const Size& size)
 {
     active_map_.cols = (size.width() + kMacroBlockSize - 1) / kMacroBlockSize;
@@ -249,20 +497,14 @@ void VideoEncoderVPX::createVp8Codec(const Size& size)
     // explicitly select real time mode when doing encoding.
     config_.g_profile = 2;
 
-    // To enable remoting to be highly interactive and allow the target bitrate to be met, we relax
-    // the max quantizer. The quality will get topped-off in subsequent frames.
-    config_.rc_min_quantizer = 20;
-    config_.rc_max_quantizer = 30;
-
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config_.rc_target_bitrate = 1000;
+    setRateControlParameters();
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
-    // Value of 16 will have the smallest CPU load. This turns off subpixel motion search.
-    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, 16);
+    // Value of 16 will have the smallest CPU load. This turns off subpixel motion search. The
+    // slower presets are used while the encoder stays well within the CPU budget.
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, speed_controller_.speed());
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     ret = vpx_codec_control(codec_.get(), VP8E_SET_SCREEN_CONTENT_MODE, 1);
@@ -272,6 +514,9 @@ void VideoEncoderVPX::createVp8Codec(const Size& size)
     // inter-prediction mode.
     ret = vpx_codec_control(codec_.get(), VP8E_SET_NOISE_SENSITIVITY, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_MAX_INTRA_BITRATE_PCT, kMaxIntraBitratePercent);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
 }
 
 void VideoEncoderVPX::createVp9Codec(const Size& size)
@@ -285,44 +530,104 @@ void VideoEncoderVPX::createVp9Codec(const Size& size)
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     setCommonCodecParameters(&config_, size);
+    codec_size_ = size;
 
-    // Configure VP9 for I420 source frames.
-    config_.g_profile = kVp9I420ProfileNumber;
-    config_.rc_min_quantizer = 20;
-    config_.rc_max_quantizer = 30;
+    // Configure VP9 for I420 or I444 source frames.
+    config_.g_profile = is_i444_ ? kVp9I444ProfileNumber : kVp9I420ProfileNumber;
+
+    if (temporal_layering_)
+    {
+        config_.ss_number_layers = 1;
+        config_.ts_number_layers = kTemporalLayers;
+        config_.ts_periodicity = kTemporalLayers;
+        config_.ts_rate_decimator[0] = 2;
+        config_.ts_rate_decimator[1] = 1;
+        config_.ts_layer_id[0] = 0;
+        config_.ts_layer_id[1] = 1;
+        config_.temporal_layering_mode = VP9E_TEMPORAL_LAYERING_MODE_0101;
+    }
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config_.rc_target_bitrate = 1000;
+    setRateControlParameters();
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
-    // Request the lowest-CPU usage that VP9 supports, which depends on whether we are encoding
-    // lossy or lossless.
-    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, 6);
+    // The speed depends on the CPU budget.
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, speed_controller_.speed());
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     ret = vpx_codec_control(codec_.get(), VP9E_SET_TUNE_CONTENT, VP9E_CONTENT_SCREEN);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
+    // Without the tile columns and the row based multithreading VP9 uses only one thread.
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS,
+                            vp9TileColumnsLog2(size, config_.g_threads));
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_ROW_MT, 1);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    if (temporal_layering_)
+    {
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_SVC, 1);
+        DCHECK_EQ(VPX_CODEC_OK, ret);
+    }
+
     // Use the lowest level of noise sensitivity so as to spend less time on motion estimation and
     // inter-prediction mode.
     ret = vpx_codec_control(codec_.get(), VP9E_SET_NOISE_SENSITIVITY, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_MAX_INTRA_BITRATE_PCT, kMaxIntraBitratePercent);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
     // Set cyclic refresh (aka "top-off") only for lossy encoding.
     ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE, kVp9AqModeCyclicRefresh);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 }
 
+bool VideoEncoderVPX::canResizeCodec(const Size& last_size, const Size& size) const
+{
+    // VP8 can not scale the reference frames. With the temporal layers the slow viewers may not
+    // receive the resized frame.
+    if (!inter_frame_resize_ || !codec_ || encoding() != proto::VIDEO_ENCODING_VP9 ||
+        temporal_layering_ || next_temporal_layering_ || last_size.isEmpty())
+    {
+        return false;
+    }
+
+    // The encoder buffers are allocated for the size at the creation. A reference frame can be
+    // scaled down at most 2 times (libvpx forces a key frame otherwise).
+    return size.width() <= codec_size_.width() && size.height() <= codec_size_.height() &&
+           size.width() * 2 >= last_size.width() && size.height() * 2 >= last_size.height();
+}
+
+bool VideoEncoderVPX::resizeCodec(const Size& size)
+{
+    config_.g_w = size.width();
+    config_.g_h = size.height();
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    if (ret != VPX_CODEC_OK)
+    {
+        // A new codec is created instead.
+        LOG(LS_WARNING) << "Unable to resize the codec: " << ret;
+        return false;
+    }
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS,
+                            vp9TileColumnsLog2(size, config_.g_threads));
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+    return true;
+}
+
 void VideoEncoderVPX::prepareImageAndActiveMap(
-    bool is_key_frame, const Frame* frame, proto::VideoPacket* packet)
+    bool is_full_frame, const Frame* frame, proto::VideoPacket* packet)
 {
     Rect image_rect = Rect::makeWH(image_->w, image_->h);
     Region updated_region;
 
-    if (!is_key_frame)
+    if (!is_full_frame)
     {
         const int padding = ((encoding() == proto::VIDEO_ENCODING_VP9) ? 8 : 3);
 
@@ -365,25 +670,80 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
         Rect rect = it.rect();
 
         const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
         const int width = rect.width();
         const int height = rect.height();
 
-        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
-                           frame->stride(),
-                           y_data + y_offset, y_stride,
-                           u_data + uv_offset, uv_stride,
-                           v_data + uv_offset, uv_stride,
-                           width,
-                           height);
-
-        addRectToActiveMap(rect);
-
-        proto::Rect* dirty_rect = packet->add_dirty_rect();
-        dirty_rect->set_x(rect.x());
-        dirty_rect->set_y(rect.y());
-        dirty_rect->set_width(rect.width());
-        dirty_rect->set_height(rect.height());
+        if (is_i444_)
+        {
+            const int uv_offset = uv_stride * rect.y() + rect.x();
+
+            libyuv::ARGBToI444(frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               width,
+                               height);
+        }
+        else
+        {
+            const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
+            libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               width,
+                               height);
+        }
+
+    }
+
+    // With the temporal layers each frame refers to the previous base layer frame, and a viewer
+    // which receives only the base layer misses the enhancement frames. Therefore the active map
+    // and the dirty rects cover everything that has changed since the previous base layer frame.
+    const Region* active_region = &updated_region;
+    if (temporal_layering_)
+    {
+        layer_region_.addRegion(updated_region);
+        active_region = &layer_region_;
+    }
+
+    for (Region::Iterator it(*active_region); !it.isAtEnd(); it.advance())
+        addRectToActiveMap(it.rect());
+
+    setDirtyRects(*active_region, packet);
+}
+
+void VideoEncoderVPX::setRateControlParameters()
+{
+    config_.rc_target_bitrate = target_bitrate_;
+
+    if (config_.ts_number_layers == kTemporalLayers)
+    {
+        // The bitrates of the layers are cumulative.
+        config_.ts_target_bitrate[0] = target_bitrate_ * kBaseLayerBitratePercent / 100;
+        config_.ts_target_bitrate[1] = target_bitrate_;
+    }
+
+    // To enable remoting to be highly interactive and allow the target bitrate to be met, we relax
+    // the max quantizer. The quality will get topped-off in subsequent frames. Fast links afford
+    // a lower quantizer, and slow links need a higher one to meet the target.
+    if (target_bitrate_ >= kHighBitrate)
+    {
+        config_.rc_min_quantizer = 10;
+        config_.rc_max_quantizer = 25;
+    }
+    else if (target_bitrate_ <= kLowBitrate)
+    {
+        config_.rc_min_quantizer = 20;
+        config_.rc_max_quantizer = 45;
+    }
+    else
+    {
+        config_.rc_min_quantizer = 20;
+        config_.rc_max_quantizer = 30;
     }
 }
 
@@ -410,4 +770,77 @@ void VideoEncoderVPX::clearActiveMap()
     memset(active_map_buffer_.data(), 0, active_map_buffer_.size());
 }
 
+void VideoEncoderVPX::applyRoiMap()
+{
+    roi_changed_ = false;
+
+    const bool is_vp9 = encoding() == proto::VIDEO_ENCODING_VP9;
+    const int block_size = is_vp9 ? kVp9RoiBlockSize : kMacroBlockSize;
+
+    vpx_roi_map_t roi_map;
+    memset(&roi_map, 0, sizeof(roi_map));
+
+    // The size of the map must match the frame even if the map is disabled.
+    roi_map.cols = (image_->w + block_size - 1) / block_size;
+    roi_map.rows = (image_->h + block_size - 1) / block_size;
+
+    if (!roi_region_.isEmpty() || !video_region_.isEmpty())
+    {
+        roi_map_buffer_.assign(roi_map.cols * roi_map.rows, 0);
+
+        const Rect image_rect = Rect::makeWH(image_->w, image_->h);
+
+        auto fill_map = [&](const Region& region, uint8_t segment)
+        {
+            for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            {
+                Rect rect = it.rect();
+                rect.intersectWith(image_rect);
+                if (rect.isEmpty())
+                    continue;
+
+                for (int y = rect.top() / block_size; y <= (rect.bottom() - 1) / block_size; ++y)
+                {
+                    uint8_t* map = roi_map_buffer_.data() + y * roi_map.cols;
+
+                    for (int x = rect.left() / block_size; x <= (rect.right() - 1) / block_size;
+                         ++x)
+                    {
+                        map[x] = segment;
+                    }
+                }
+            }
+        };
+
+        // Segment 0 is the rest of the frame, segment 1 is the region of interest and segment 2 is
+        // the video region. The region of interest is filled last, so it wins where they overlap.
+        fill_map(video_region_, 2);
+        fill_map(roi_region_, 1);
+
+        roi_map.roi_map = roi_map_buffer_.data();
+        roi_map.delta_q[1] = is_vp9 ? kVp9RoiDeltaQ : kVp8RoiDeltaQ;
+        roi_map.delta_q[2] = is_vp9 ? kVp9VideoDeltaQ : kVp8VideoDeltaQ;
+    }
+
+    vpx_codec_err_t ret;
+
+    if (is_vp9)
+    {
+        // The ROI map and the cyclic refresh use the same segmentation of VP9, so the cyclic
+        // refresh is turned off while the map is set.
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE,
+                                roi_map.roi_map ? 0 : kVp9AqModeCyclicRefresh);
+        DCHECK_EQ(ret, VPX_CODEC_OK);
+
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_ROI_MAP, &roi_map);
+    }
+    else
+    {
+        ret = vpx_codec_control(codec_.get(), VP8E_SET_ROI_MAP, &roi_map);
+    }
+
+    if (ret != VPX_CODEC_OK)
+        LOG(LS_WARNING) << "Unable to set the ROI map: " << ret;
+}
+
 } // namespace base
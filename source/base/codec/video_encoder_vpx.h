@@ -22,13 +22,17 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_vpx_codec.h"
 #include "base/codec/video_encoder.h"
+#include "base/codec/video_speed_controller.h"
 #include "base/desktop/region.h"
+#include "base/memory/buffer.h"
 #include "base/memory/byte_array.h"
 
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
 
+#include <chrono>
+
 namespace base {
 
 class VideoEncoderVPX : public VideoEncoder
@@ -39,27 +43,74 @@ public:
     static std::unique_ptr<VideoEncoderVPX> createVP8();
     static std::unique_ptr<VideoEncoderVPX> createVP9();
 
+    // Creates VP9 encoder for the profile 1 without chroma subsampling. It keeps colored text
+    // sharp at the cost of a larger stream.
+    static std::unique_ptr<VideoEncoderVPX> createVP9I444();
+
     void encode(const Frame* frame, proto::VideoPacket* packet) override;
+    void setTargetBitrate(uint32_t bitrate) override;
+    bool setTemporalLayering(bool enable) override;
+    int temporalLayer() const override { return temporal_layer_; }
+    int lastQuantizer() const override { return last_quantizer_; }
+    void setRegionOfInterest(const Region& region) override;
+    void setVideoRegion(const Region& region) override;
+    void setInterFrameResize(bool enable) override { inter_frame_resize_ = enable; }
+    void setCpuBudget(double share) override;
+    std::chrono::microseconds minFrameInterval() const override
+    {
+        return speed_controller_.minFrameInterval();
+    }
+    size_t memoryUsage() const override;
 
 private:
-    explicit VideoEncoderVPX(proto::VideoEncoding encoding);
+    VideoEncoderVPX(proto::VideoEncoding encoding, bool is_i444);
 
     void createActiveMap(const Size& size);
     void createVp8Codec(const Size& size);
     void createVp9Codec(const Size& size);
-    void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame, proto::VideoPacket* packet);
+    bool canResizeCodec(const Size& last_size, const Size& size) const;
+    bool resizeCodec(const Size& size);
+    void prepareImageAndActiveMap(bool is_full_frame, const Frame* frame,
+                                  proto::VideoPacket* packet);
     void addRectToActiveMap(const Rect& rect);
     void clearActiveMap();
+    void applyRoiMap();
+    void setRateControlParameters();
+
+    const bool is_i444_;
 
     vpx_codec_enc_cfg_t config_;
+    uint32_t target_bitrate_;
+    std::chrono::steady_clock::time_point last_encode_time_;
+    vpx_codec_pts_t pts_ = 0;
+
+    VideoSpeedController speed_controller_;
+
+    // The size at the creation of the codec. The VP9 codec is resized without a key frame only
+    // within it.
+    Size codec_size_;
+    bool inter_frame_resize_ = false;
+
+    bool next_temporal_layering_ = false;
+    bool temporal_layering_ = false;
+    int temporal_layer_ = 0;
+    int last_quantizer_ = -1;
+
+    // Region changed since the last base layer frame.
+    Region layer_region_;
     ScopedVpxCodec codec_;
 
     ByteArray active_map_buffer_;
     vpx_active_map_t active_map_;
 
+    Region roi_region_;
+    Region video_region_;
+    bool roi_changed_ = false;
+    ByteArray roi_map_buffer_;
+
     // VPX image and buffer to hold the actual YUV planes.
     std::unique_ptr<vpx_image_t> image_;
-    ByteArray image_buffer_;
+    Buffer image_buffer_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderVPX);
 };
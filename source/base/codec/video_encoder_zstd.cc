@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_zstd.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+namespace base {
+
+namespace {
+
+// The static areas are refined rarely, so the encoding speed is more important than the ratio.
+const int kCompressionLevel = 1;
+
+uint8_t* translateRect(const Frame* frame, const Rect& rect, uint8_t* out)
+{
+    const int row_size = rect.width() * Frame::kBytesPerPixel;
+    const uint8_t* in = frame->frameDataAtPos(rect.topLeft());
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        for (int i = 0; i < Frame::kBytesPerPixel; ++i)
+            out[i] = in[i];
+
+        for (int i = Frame::kBytesPerPixel; i < row_size; ++i)
+            out[i] = in[i] - in[i - Frame::kBytesPerPixel];
+
+        in += frame->stride();
+        out += row_size;
+    }
+
+    return out;
+}
+
+} // namespace
+
+VideoEncoderZstd::VideoEncoderZstd()
+    : VideoEncoder(proto::VIDEO_ENCODING_ZSTD),
+      stream_(ZSTD_createCStream())
+{
+    // Nothing
+}
+
+// static
+std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::create()
+{
+    return std::unique_ptr<VideoEncoderZstd>(new VideoEncoderZstd());
+}
+
+void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    encode(frame, frame->constUpdatedRegion(), packet);
+}
+
+void VideoEncoderZstd::encode(const Frame* frame, const Region& region, proto::VideoPacket* packet)
+{
+    fillPacketInfo(frame, packet);
+
+    size_t data_size = 0;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        data_size += static_cast<size_t>(rect.width()) * rect.height() * Frame::kBytesPerPixel;
+    }
+
+    setDirtyRects(region, packet);
+
+    if (!data_size)
+        return;
+
+    if (translate_buffer_.size() < data_size)
+        translate_buffer_.resize(data_size);
+
+    uint8_t* out = translate_buffer_.data();
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        out = translateRect(frame, it.rect(), out);
+
+    size_t ret = ZSTD_initCStream(stream_.get(), kCompressionLevel);
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_ERROR) << "ZSTD_initCStream failed: " << ZSTD_getErrorName(ret);
+        packet->clear_dirty_rect();
+        packet->clear_packed_dirty_rects();
+        return;
+    }
+
+    std::string* data = packet->mutable_data();
+    data->resize(ZSTD_compressBound(data_size));
+
+    ZSTD_inBuffer input = { translate_buffer_.data(), data_size, 0 };
+    ZSTD_outBuffer output = { data->data(), data->size(), 0 };
+
+    while (input.pos < input.size)
+    {
+        ret = ZSTD_compressStream(stream_.get(), &output, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
+            packet->clear_dirty_rect();
+        packet->clear_packed_dirty_rects();
+            packet->clear_data();
+            return;
+        }
+    }
+
+    ret = ZSTD_endStream(stream_.get(), &output);
+    if (ret != 0)
+    {
+        // The output buffer has the size of the compress bound, so the stream is always flushed.
+        LOG(LS_ERROR) << "ZSTD_endStream failed: " << ZSTD_getErrorName(ret);
+        packet->clear_dirty_rect();
+        packet->clear_packed_dirty_rects();
+        packet->clear_data();
+        return;
+    }
+
+    data->resize(output.pos);
+}
+
+} // namespace base
@@ -0,0 +1,57 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_ENCODER_ZSTD_H
+#define BASE__CODEC__VIDEO_ENCODER_ZSTD_H
+
+#include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/codec/video_encoder.h"
+#include "base/desktop/region.h"
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Lossless encoder for the updated region of the frame. Each byte of a pixel is replaced by its
+// difference with the same byte of the pixel to the left, and the result is compressed with zstd.
+// The areas of text and flat colors become long runs of zeros and are compressed very well.
+// It is used to refine the static areas of the video encoded by a lossy encoder.
+class VideoEncoderZstd : public VideoEncoder
+{
+public:
+    ~VideoEncoderZstd() = default;
+
+    static std::unique_ptr<VideoEncoderZstd> create();
+
+    void encode(const Frame* frame, proto::VideoPacket* packet) override;
+
+    // Encodes |region| of |frame| instead of its updated region.
+    void encode(const Frame* frame, const Region& region, proto::VideoPacket* packet);
+
+private:
+    VideoEncoderZstd();
+
+    ScopedZstdCStream stream_;
+    ByteArray translate_buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_ENCODER_ZSTD_H
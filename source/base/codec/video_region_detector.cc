@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_region_detector.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+const std::chrono::seconds kPeriod{ 1 };
+
+} // namespace
+
+VideoRegionDetector::VideoRegionDetector() = default;
+
+VideoRegionDetector::~VideoRegionDetector() = default;
+
+bool VideoRegionDetector::addFrame(const Size& size, const Region& updated_region, TimePoint time)
+{
+    const Size grid_size((size.width() + kTileSize - 1) / kTileSize,
+                         (size.height() + kTileSize - 1) / kTileSize);
+
+    if (grid_size != grid_size_)
+    {
+        const bool changed = !video_region_.isEmpty();
+
+        reset();
+        grid_size_ = grid_size;
+        tiles_.resize(static_cast<size_t>(grid_size.width()) * grid_size.height());
+        period_start_ = time;
+        return changed;
+    }
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        const int right = std::min((rect.right() - 1) / kTileSize, grid_size_.width() - 1);
+        const int bottom = std::min((rect.bottom() - 1) / kTileSize, grid_size_.height() - 1);
+
+        for (int y = std::max(rect.top() / kTileSize, 0); y <= bottom; ++y)
+        {
+            for (int x = std::max(rect.left() / kTileSize, 0); x <= right; ++x)
+            {
+                Tile& tile = tiles_[y * grid_size_.width() + x];
+                if (tile.updates < UINT16_MAX)
+                    ++tile.updates;
+            }
+        }
+    }
+
+    const TimePoint::duration elapsed = time - period_start_;
+    if (elapsed < kPeriod)
+        return false;
+
+    // The rates are scaled to the length of the period, frames may stop for a while.
+    using std::chrono::milliseconds;
+
+    const int64_t ratio_num = std::chrono::duration_cast<milliseconds>(kPeriod).count();
+    const int64_t ratio_den =
+        std::max<int64_t>(std::chrono::duration_cast<milliseconds>(elapsed).count(), 1);
+
+    Region video_region;
+    int video_tiles = 0;
+
+    for (int y = 0; y < grid_size_.height(); ++y)
+    {
+        for (int x = 0; x < grid_size_.width(); ++x)
+        {
+            Tile& tile = tiles_[y * grid_size_.width() + x];
+
+            const int64_t rate = tile.updates * ratio_num / ratio_den;
+            const int64_t threshold = tile.video ? kMinUpdateRate / 2 : kMinUpdateRate;
+
+            tile.video = rate >= threshold;
+            tile.updates = 0;
+
+            if (!tile.video)
+                continue;
+
+            video_region.addRect(
+                Rect::makeXYWH(x * kTileSize, y * kTileSize, kTileSize, kTileSize));
+            ++video_tiles;
+        }
+    }
+
+    period_start_ = time;
+
+    if (video_tiles < kMinTiles)
+        video_region.clear();
+    else
+        video_region.intersectWith(Rect::makeSize(size));
+
+    if (video_region.equals(video_region_))
+        return false;
+
+    video_region_.swap(&video_region);
+    return true;
+}
+
+void VideoRegionDetector::reset()
+{
+    grid_size_ = Size();
+    tiles_.clear();
+    video_region_.clear();
+}
+
+} // namespace base
@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_REGION_DETECTOR_H
+#define BASE__CODEC__VIDEO_REGION_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace base {
+
+// Finds the areas of the screen which change in almost every frame, like a playing video or a 3D
+// viewport. The updates of the tiles of the screen are counted over periods of one second. A tile
+// with a high update rate becomes a part of the video region, and it leaves the region when its
+// rate drops to a half. The region is used only if it is large enough, so a blinking caret or the
+// typed text do not match.
+class VideoRegionDetector
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    VideoRegionDetector();
+    ~VideoRegionDetector();
+
+    static const int kTileSize = 32;
+    static const int kMinUpdateRate = 12; // Updates per second.
+    static const int kMinTiles = 24;
+
+    // Adds the updated region of a frame of |size| captured at |time|. Returns true if the video
+    // region has been changed.
+    bool addFrame(const Size& size, const Region& updated_region, TimePoint time);
+
+    const Region& videoRegion() const { return video_region_; }
+
+    void reset();
+
+private:
+    struct Tile
+    {
+        uint16_t updates = 0;
+        bool video = false;
+    };
+
+    Size grid_size_;
+    std::vector<Tile> tiles_;
+    TimePoint period_start_;
+    Region video_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoRegionDetector);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_REGION_DETECTOR_H
@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_region_detector.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const Size kScreenSize(1024, 768);
+const std::chrono::milliseconds kFrameInterval{ 40 };
+
+} // namespace
+
+TEST(VideoRegionDetectorTest, video)
+{
+    VideoRegionDetector detector;
+    VideoRegionDetector::TimePoint time = VideoRegionDetector::TimePoint::clock::now();
+
+    const Rect video_rect = Rect::makeXYWH(100, 100, 320, 240);
+    bool changed = false;
+
+    // Two seconds of 25 fps video.
+    for (int i = 0; i < 50; ++i)
+    {
+        changed = detector.addFrame(kScreenSize, Region(video_rect), time) || changed;
+        time += kFrameInterval;
+    }
+
+    EXPECT_TRUE(changed);
+
+    // The region consists of whole tiles which cover the video.
+    Region missed(video_rect);
+    missed.subtract(detector.videoRegion());
+    EXPECT_TRUE(missed.isEmpty());
+    EXPECT_FALSE(detector.videoRegion().equals(Region(Rect::makeSize(kScreenSize))));
+
+    // The video is stopped. The other frames update only a small area.
+    for (int i = 0; i < 75; ++i)
+    {
+        detector.addFrame(kScreenSize, Region(Rect::makeXYWH(0, 0, 8, 16)), time);
+        time += kFrameInterval;
+    }
+
+    EXPECT_TRUE(detector.videoRegion().isEmpty());
+}
+
+TEST(VideoRegionDetectorTest, typing)
+{
+    VideoRegionDetector detector;
+    VideoRegionDetector::TimePoint time = VideoRegionDetector::TimePoint::clock::now();
+
+    // Fast typing changes a small area in each frame.
+    for (int i = 0; i < 100; ++i)
+    {
+        detector.addFrame(kScreenSize, Region(Rect::makeXYWH(200 + i * 8, 300, 8, 16)), time);
+        time += kFrameInterval;
+    }
+
+    EXPECT_TRUE(detector.videoRegion().isEmpty());
+}
+
+TEST(VideoRegionDetectorTest, slow_updates)
+{
+    VideoRegionDetector detector;
+    VideoRegionDetector::TimePoint time = VideoRegionDetector::TimePoint::clock::now();
+
+    // A large area which is updated 5 times per second is not a video.
+    for (int i = 0; i < 20; ++i)
+    {
+        detector.addFrame(kScreenSize, Region(Rect::makeSize(kScreenSize)), time);
+        time += std::chrono::milliseconds(200);
+    }
+
+    EXPECT_TRUE(detector.videoRegion().isEmpty());
+}
+
+} // namespace base
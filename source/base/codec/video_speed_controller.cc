@@ -0,0 +1,105 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_speed_controller.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+// Weight of a new frame in the averages.
+const double kSmoothing = 0.1;
+
+// The speed is changed at most once in this number of frames. The averages of the new preset
+// need some frames to settle.
+const int kMinFramesPerChange = 15;
+
+// A slower preset takes about twice as long, so it is used only if the load is well below the
+// budget.
+const double kSlowDownRatio = 0.4;
+
+// A single long frame (a key frame or a system stall) does not outweigh the average.
+const double kMaxFrameLoad = 2.0;
+
+const double kMinBudget = 0.01;
+
+} // namespace
+
+VideoSpeedController::VideoSpeedController(int min_speed, int max_speed, int initial_speed)
+    : min_speed_(min_speed),
+      max_speed_(max_speed),
+      speed_(std::clamp(initial_speed, min_speed, max_speed))
+{
+    DCHECK_LE(min_speed_, max_speed_);
+}
+
+void VideoSpeedController::setBudget(double budget)
+{
+    budget_ = std::clamp(budget, kMinBudget, 1.0);
+}
+
+bool VideoSpeedController::update(
+    std::chrono::microseconds encode_time, std::chrono::microseconds frame_interval)
+{
+    const double interval = static_cast<double>(std::max(frame_interval.count(), int64_t(1)));
+    const double time = static_cast<double>(std::max(encode_time.count(), int64_t(0)));
+    const double load = std::min(time / interval, kMaxFrameLoad);
+
+    if (!frame_count_)
+    {
+        load_ = load;
+        encode_time_ = time;
+    }
+    else
+    {
+        load_ += (load - load_) * kSmoothing;
+        encode_time_ += (time - encode_time_) * kSmoothing;
+    }
+
+    ++frame_count_;
+    if (frame_count_ < kMinFramesPerChange)
+        return false;
+
+    int speed = speed_;
+
+    if (load_ > budget_)
+        speed = std::min(speed_ + 1, max_speed_);
+    else if (load_ < budget_ * kSlowDownRatio)
+        speed = std::max(speed_ - 1, min_speed_);
+
+    if (speed == speed_)
+        return false;
+
+    speed_ = speed;
+    frame_count_ = 0;
+    return true;
+}
+
+std::chrono::microseconds VideoSpeedController::minFrameInterval() const
+{
+    if (speed_ < max_speed_ || frame_count_ < kMinFramesPerChange || load_ <= budget_)
+        return std::chrono::microseconds::zero();
+
+    return std::chrono::microseconds(static_cast<int64_t>(encode_time_ / budget_));
+}
+
+} // namespace base
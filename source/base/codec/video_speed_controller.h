@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_SPEED_CONTROLLER_H
+#define BASE__CODEC__VIDEO_SPEED_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+
+namespace base {
+
+// Chooses the speed preset (cpu-used) of the video encoder from the time it spends on the frames.
+// The load is the share of the time between the frames which the encoder spends encoding. When it
+// exceeds the budget, a faster preset is used. When it stays far below the budget, a slower preset
+// with a better compression is used. If even the fastest preset exceeds the budget, the frame rate
+// has to be lowered: minFrameInterval() returns the interval which keeps the load within it.
+class VideoSpeedController
+{
+public:
+    VideoSpeedController(int min_speed, int max_speed, int initial_speed);
+    ~VideoSpeedController() = default;
+
+    // Sets the maximum load in (0..1]. With 1 the encoder may encode all the time.
+    void setBudget(double budget);
+    double budget() const { return budget_; }
+
+    // Adds the time spent on a frame and the time since the previous frame. Returns true if the
+    // speed has been changed.
+    bool update(std::chrono::microseconds encode_time, std::chrono::microseconds frame_interval);
+
+    int speed() const { return speed_; }
+    double load() const { return load_; }
+
+    // Returns the minimum interval between the frames if the load exceeds the budget at the fastest
+    // preset. Otherwise returns zero.
+    std::chrono::microseconds minFrameInterval() const;
+
+private:
+    const int min_speed_;
+    const int max_speed_;
+    int speed_;
+    double budget_ = 1.0;
+
+    // The averages since the last change of the speed.
+    double load_ = 0;
+    double encode_time_ = 0;
+    int frame_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoSpeedController);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_SPEED_CONTROLLER_H
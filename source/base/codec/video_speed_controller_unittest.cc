@@ -0,0 +1,88 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_speed_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const std::chrono::microseconds kFrameInterval{ 40000 };
+
+void encodeFrames(VideoSpeedController* controller, int count, std::chrono::microseconds time)
+{
+    for (int i = 0; i < count; ++i)
+        controller->update(time, kFrameInterval);
+}
+
+} // namespace
+
+TEST(VideoSpeedControllerTest, within_budget)
+{
+    VideoSpeedController controller(5, 9, 6);
+    controller.setBudget(0.5);
+
+    // 40% of the frame interval, nothing changes.
+    encodeFrames(&controller, 100, std::chrono::microseconds(16000));
+    EXPECT_EQ(controller.speed(), 6);
+    EXPECT_EQ(controller.minFrameInterval(), std::chrono::microseconds::zero());
+}
+
+TEST(VideoSpeedControllerTest, over_budget)
+{
+    VideoSpeedController controller(5, 9, 6);
+    controller.setBudget(0.5);
+
+    // The speed is not changed before the average settles.
+    for (int i = 0; i < 14; ++i)
+        EXPECT_FALSE(controller.update(std::chrono::microseconds(30000), kFrameInterval));
+    EXPECT_TRUE(controller.update(std::chrono::microseconds(30000), kFrameInterval));
+    EXPECT_EQ(controller.speed(), 7);
+
+    // Then it goes up to the fastest preset and the frame rate has to be lowered.
+    encodeFrames(&controller, 100, std::chrono::microseconds(30000));
+    EXPECT_EQ(controller.speed(), 9);
+    EXPECT_NEAR(static_cast<double>(controller.minFrameInterval().count()), 60000.0, 1.0);
+}
+
+TEST(VideoSpeedControllerTest, under_budget)
+{
+    VideoSpeedController controller(5, 9, 6);
+    controller.setBudget(0.5);
+
+    encodeFrames(&controller, 100, std::chrono::microseconds(2000));
+    EXPECT_EQ(controller.speed(), 5);
+    EXPECT_EQ(controller.minFrameInterval(), std::chrono::microseconds::zero());
+}
+
+TEST(VideoSpeedControllerTest, budget_change)
+{
+    VideoSpeedController controller(5, 9, 6);
+
+    // The whole frame interval is allowed.
+    encodeFrames(&controller, 100, std::chrono::microseconds(30000));
+    EXPECT_EQ(controller.speed(), 6);
+
+    controller.setBudget(0.25);
+    encodeFrames(&controller, 15, std::chrono::microseconds(30000));
+    EXPECT_EQ(controller.speed(), 7);
+}
+
+} // namespace base
@@ -0,0 +1,177 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_tile_cache.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+constexpr uint64_t kHashMultiplier1 = 0x87c37b91114253d5ULL;
+constexpr uint64_t kHashMultiplier2 = 0x4cf5ad432745937fULL;
+
+uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t mixWord(uint64_t hash, uint64_t word)
+{
+    hash ^= rotateLeft(word * kHashMultiplier1, 31) * kHashMultiplier2;
+    return rotateLeft(hash, 27) * 5 + 0x52dce729;
+}
+
+// The final mix of MurmurHash3, so that every bit of the key depends on every bit of the input.
+uint64_t finalizeHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+} // namespace
+
+VideoTileCache::VideoTileCache(size_t capacity, bool keep_pixels)
+    : capacity_(capacity),
+      keep_pixels_(keep_pixels)
+{
+    DCHECK_GT(capacity_, 0u);
+    index_.reserve(capacity_ + 1);
+}
+
+VideoTileCache::~VideoTileCache() = default;
+
+// static
+uint64_t VideoTileCache::tileKey(const Frame& frame, const Rect& rect)
+{
+    DCHECK(Rect::makeSize(frame.size()).containsRect(rect));
+
+    uint64_t hash = (static_cast<uint64_t>(rect.width()) << 32) |
+                    static_cast<uint64_t>(rect.height());
+
+    const size_t row_size = static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel;
+    const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        size_t offset = 0;
+
+        for (; offset + sizeof(uint64_t) <= row_size; offset += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, row + offset, sizeof(word));
+            hash = mixWord(hash, word);
+        }
+
+        // A row of an odd width ends with a single pixel.
+        if (offset < row_size)
+        {
+            uint32_t pixel;
+            memcpy(&pixel, row + offset, sizeof(pixel));
+            hash = mixWord(hash, pixel);
+        }
+
+        row += frame.stride();
+    }
+
+    return finalizeHash(hash);
+}
+
+bool VideoTileCache::touch(uint64_t key)
+{
+    auto result = index_.find(key);
+    if (result == index_.end())
+        return false;
+
+    tiles_.splice(tiles_.begin(), tiles_, result->second);
+    return true;
+}
+
+void VideoTileCache::add(uint64_t key, const Frame& frame, const Rect& rect)
+{
+    DCHECK(Rect::makeSize(frame.size()).containsRect(rect));
+
+    auto result = index_.find(key);
+    if (result != index_.end())
+    {
+        tiles_.splice(tiles_.begin(), tiles_, result->second);
+    }
+    else
+    {
+        tiles_.push_front({ key, Size(), std::vector<uint8_t>() });
+        index_[key] = tiles_.begin();
+
+        if (tiles_.size() > capacity_)
+        {
+            // Delete the least recently used tile. The other side does the same.
+            index_.erase(tiles_.back().key);
+            tiles_.pop_back();
+        }
+    }
+
+    Tile& tile = tiles_.front();
+    tile.size = rect.size();
+
+    if (!keep_pixels_)
+        return;
+
+    const size_t row_size = static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel;
+    tile.pixels.resize(row_size * rect.height());
+
+    const uint8_t* src = frame.frameDataAtPos(rect.topLeft());
+    uint8_t* dst = tile.pixels.data();
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        memcpy(dst, src, row_size);
+        src += frame.stride();
+        dst += row_size;
+    }
+}
+
+bool VideoTileCache::paint(uint64_t key, const Rect& rect, Frame* frame)
+{
+    DCHECK(frame);
+    DCHECK(keep_pixels_);
+
+    if (!touch(key))
+        return false;
+
+    const Tile& tile = tiles_.front();
+    if (tile.size != rect.size() || !Rect::makeSize(frame->size()).containsRect(rect))
+        return false;
+
+    frame->copyPixelsFrom(tile.pixels.data(), rect.width() * Frame::kBytesPerPixel, rect);
+    return true;
+}
+
+void VideoTileCache::clear()
+{
+    index_.clear();
+    tiles_.clear();
+}
+
+} // namespace base
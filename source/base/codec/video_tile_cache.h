@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_TILE_CACHE_H
+#define BASE__CODEC__VIDEO_TILE_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Content-addressed cache of the tiles of the video (like the bitmap cache of RDP). A tile that
+// reappears on the screen (e.g. after switching between windows) is painted from the cache of the
+// client instead of being encoded again.
+// The host and the client keep caches of the same capacity and apply the same operations in the
+// same order, so the least recently used tile is removed from both of them at once. The host keeps
+// only the keys, the client also keeps the pixels.
+class VideoTileCache
+{
+public:
+    // The tiles are squares of this size aligned to the grid (smaller at the right and bottom edges
+    // of the frame).
+    static const int kTileSize = 64;
+
+    // 1024 tiles is 16 MB of pixels on the client, enough for about two Full HD screens.
+    static const size_t kDefaultCapacity = 1024;
+
+    // The client does not accept a larger cache.
+    static const size_t kMaxCapacity = 4096;
+
+    VideoTileCache(size_t capacity, bool keep_pixels);
+    ~VideoTileCache();
+
+    // Returns the key of the tile |rect| of |frame|. The key also depends on the size of the tile.
+    static uint64_t tileKey(const Frame& frame, const Rect& rect);
+
+    size_t capacity() const { return capacity_; }
+    size_t count() const { return tiles_.size(); }
+
+    // Returns true if the tile with |key| is in the cache. The tile becomes the most recently used.
+    bool touch(uint64_t key);
+
+    // Adds the tile with |key| (or replaces it) as the most recently used one. If the pixels are
+    // kept, they are copied from |rect| of |frame|.
+    void add(uint64_t key, const Frame& frame, const Rect& rect);
+
+    // Copies the tile with |key| into |rect| of |frame|. The tile becomes the most recently used.
+    // Returns false if the tile is not in the cache or it has a different size.
+    bool paint(uint64_t key, const Rect& rect, Frame* frame);
+
+    void clear();
+
+private:
+    struct Tile
+    {
+        uint64_t key;
+        Size size;
+        std::vector<uint8_t> pixels;
+    };
+
+    using TileList = std::list<Tile>;
+
+    const size_t capacity_;
+    const bool keep_pixels_;
+
+    // The most recently used tile is at the front.
+    TileList tiles_;
+    std::unordered_map<uint64_t, TileList::iterator> index_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoTileCache);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_TILE_CACHE_H
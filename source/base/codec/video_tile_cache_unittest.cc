@@ -0,0 +1,134 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_tile_cache.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+void fillRect(Frame* frame, const Rect& rect, uint8_t value)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+        memset(frame->frameDataAtPos(rect.left(), y), value, rect.width() * Frame::kBytesPerPixel);
+}
+
+} // namespace
+
+TEST(VideoTileCacheTest, tile_key)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(128, 64));
+    fillRect(frame.get(), Rect::makeSize(frame->size()), 0x20);
+
+    const Rect left = Rect::makeXYWH(0, 0, 64, 64);
+    const Rect right = Rect::makeXYWH(64, 0, 64, 64);
+
+    // The same pixels at different positions have the same key.
+    EXPECT_EQ(VideoTileCache::tileKey(*frame, left), VideoTileCache::tileKey(*frame, right));
+
+    // The same pixels in a tile of another size have another key.
+    EXPECT_NE(VideoTileCache::tileKey(*frame, left),
+              VideoTileCache::tileKey(*frame, Rect::makeXYWH(0, 0, 64, 32)));
+
+    // A single changed byte changes the key.
+    frame->frameDataAtPos(100, 40)[2] = 0x21;
+    EXPECT_NE(VideoTileCache::tileKey(*frame, left), VideoTileCache::tileKey(*frame, right));
+
+    // Odd widths are hashed completely.
+    const Rect odd = Rect::makeXYWH(64, 40, 37, 1);
+    const uint64_t odd_key = VideoTileCache::tileKey(*frame, odd);
+    frame->frameDataAtPos(100, 40)[2] = 0x20;
+    EXPECT_NE(odd_key, VideoTileCache::tileKey(*frame, odd));
+}
+
+TEST(VideoTileCacheTest, paint)
+{
+    std::unique_ptr<Frame> source = FrameSimple::create(Size(64, 64));
+    fillRect(source.get(), Rect::makeSize(source->size()), 0x40);
+
+    const Rect rect = Rect::makeXYWH(0, 0, 64, 64);
+    const uint64_t key = VideoTileCache::tileKey(*source, rect);
+
+    VideoTileCache cache(4, true);
+    EXPECT_FALSE(cache.touch(key));
+
+    cache.add(key, *source, rect);
+    EXPECT_EQ(cache.count(), 1u);
+
+    std::unique_ptr<Frame> target = FrameSimple::create(Size(192, 128));
+    fillRect(target.get(), Rect::makeSize(target->size()), 0);
+
+    const Rect target_rect = Rect::makeXYWH(128, 64, 64, 64);
+    ASSERT_TRUE(cache.paint(key, target_rect, target.get()));
+    EXPECT_EQ(VideoTileCache::tileKey(*target, target_rect), key);
+    EXPECT_EQ(target->frameDataAtPos(127, 64)[0], 0);
+
+    // The size of the tile must match.
+    EXPECT_FALSE(cache.paint(key, Rect::makeXYWH(0, 0, 32, 64), target.get()));
+
+    // The tile must be inside the frame.
+    EXPECT_FALSE(cache.paint(key, Rect::makeXYWH(160, 64, 64, 64), target.get()));
+}
+
+TEST(VideoTileCacheTest, least_recently_used)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(64, 64));
+    const Rect rect = Rect::makeSize(frame->size());
+
+    // The host does not keep the pixels, but removes the same tiles as the client.
+    VideoTileCache host_cache(3, false);
+    VideoTileCache client_cache(3, true);
+
+    for (uint64_t key = 1; key <= 3; ++key)
+    {
+        host_cache.add(key, *frame, rect);
+        client_cache.add(key, *frame, rect);
+    }
+
+    // The tile 1 becomes the most recently used, so the tile 2 is removed.
+    EXPECT_TRUE(host_cache.touch(1));
+    EXPECT_TRUE(client_cache.paint(1, rect, frame.get()));
+
+    host_cache.add(4, *frame, rect);
+    client_cache.add(4, *frame, rect);
+
+    for (VideoTileCache* cache : { &host_cache, &client_cache })
+    {
+        EXPECT_EQ(cache->count(), 3u);
+        EXPECT_FALSE(cache->touch(2));
+        EXPECT_TRUE(cache->touch(1));
+        EXPECT_TRUE(cache->touch(3));
+        EXPECT_TRUE(cache->touch(4));
+    }
+
+    // A tile added again is not duplicated.
+    host_cache.add(4, *frame, rect);
+    EXPECT_EQ(host_cache.count(), 3u);
+
+    host_cache.clear();
+    EXPECT_EQ(host_cache.count(), 0u);
+    EXPECT_FALSE(host_cache.touch(4));
+}
+
+} // namespace base
@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/system_time.h"
 #include "base/codec/webm_file_muxer.h"
+#include "base/threading/thread.h"
 #include "build/build_config.h"
 
 #include <iomanip>
@@ -28,24 +29,143 @@
 
 namespace base {
 
+namespace {
+
+// Limits of a single file.
+const int64_t kMaxSegmentSize = 1024LL * 1024 * 1024; // 1 GB
+const std::chrono::seconds kMaxSegmentDuration = std::chrono::minutes(30);
+
+// If the packets that are not written yet exceed this size, the disk cannot keep up with the
+// session and new packets are dropped.
+const int64_t kMaxPendingSize = 32 * 1024 * 1024; // 32 MB
+
+} // namespace
+
 WebmFileWriter::WebmFileWriter(const std::filesystem::path& path, std::string_view name)
     : path_(path),
-      name_(name)
+      name_(name),
+      thread_(std::make_unique<Thread>())
 {
-    // Nothing
+    // The recording is not watched live, it may wait for the session.
+    thread_->setThreadPriority(ThreadPriority::BACKGROUND);
+    thread_->start(MessageLoop::Type::DEFAULT);
 }
 
 WebmFileWriter::~WebmFileWriter()
 {
+    // The packets that are already posted are written before the thread stops.
+    thread_->stop();
     close();
 }
 
 void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
+{
+    // The lossless refinement of the static areas is not a part of the VP8/VP9 stream.
+    if (packet.encoding() == proto::VIDEO_ENCODING_ZSTD)
+        return;
+
+    const TimePoint time = Clock::now();
+
+    if (wait_key_frame_)
+    {
+        // The frames after a dropped frame cannot be decoded until the next key frame.
+        if (!packet.has_format() && !isKeyFrame(packet.encoding(), packet.data()))
+            return;
+
+        wait_key_frame_ = false;
+    }
+
+    const int64_t size = static_cast<int64_t>(packet.data().size());
+    if (pending_size_ + size > kMaxPendingSize)
+    {
+        LOG(LS_WARNING) << "Recording is too slow, video frames are dropped until a key frame";
+        wait_key_frame_ = true;
+        return;
+    }
+
+    pending_size_ += size;
+
+    std::shared_ptr<proto::VideoPacket> copy = std::make_shared<proto::VideoPacket>(packet);
+    thread_->taskRunner()->postTask([this, copy, time, size]()
+    {
+        writeVideoPacket(*copy, time);
+        pending_size_ -= size;
+    });
+}
+
+void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet)
+{
+    if (packet.encoding() != proto::AUDIO_ENCODING_OPUS ||
+        packet.channels() != proto::AudioPacket::CHANNELS_STEREO ||
+        packet.sampling_rate() != proto::AudioPacket::SAMPLING_RATE_48000)
+    {
+        // Unsupported audio packet.
+        return;
+    }
+
+    const TimePoint time = Clock::now();
+
+    int64_t size = 0;
+    for (int i = 0; i < packet.data_size(); ++i)
+        size += static_cast<int64_t>(packet.data(i).size());
+
+    // Lost audio does not break the following packets.
+    if (pending_size_ + size > kMaxPendingSize)
+        return;
+
+    pending_size_ += size;
+
+    std::shared_ptr<proto::AudioPacket> copy = std::make_shared<proto::AudioPacket>(packet);
+    thread_->taskRunner()->postTask([this, copy, time, size]()
+    {
+        writeAudioPacket(*copy, time);
+        pending_size_ -= size;
+    });
+}
+
+// static
+bool WebmFileWriter::isKeyFrame(proto::VideoEncoding encoding, std::string_view data)
+{
+    if (data.empty())
+        return false;
+
+    const uint8_t header = static_cast<uint8_t>(data[0]);
+
+    if (encoding == proto::VIDEO_ENCODING_VP8)
+    {
+        // The lowest bit of the frame tag is zero for a key frame.
+        return (header & 0x01) == 0;
+    }
+
+    if (encoding == proto::VIDEO_ENCODING_VP9)
+    {
+        // The uncompressed header starts with frame_marker (2 bits), profile_low_bit,
+        // profile_high_bit, a reserved bit for profile 3, show_existing_frame and frame_type. The
+        // frame type is zero for a key frame.
+        if ((header >> 6) != 0x02)
+            return false;
+
+        const int profile = ((header >> 5) & 0x01) | (((header >> 4) & 0x01) << 1);
+        const int shift = (profile == 3) ? 2 : 3;
+
+        if ((header >> shift) & 0x01)
+            return false; // show_existing_frame
+
+        return ((header >> (shift - 1)) & 0x01) == 0;
+    }
+
+    return false;
+}
+
+void WebmFileWriter::writeVideoPacket(const proto::VideoPacket& packet, TimePoint time)
 {
     if (packet.encoding() != last_video_encoding_ || packet.has_format())
     {
         close();
 
+        // The encoding is remembered even if it is not supported, so the error is logged once.
+        last_video_encoding_ = packet.encoding();
+
         switch (packet.encoding())
         {
             case proto::VIDEO_ENCODING_VP8:
@@ -53,98 +173,59 @@ void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
                 break;
 
             default:
-                LOG(LS_ERROR) << "Not supported video encoding";
+                LOG(LS_ERROR) << "Not supported video encoding: " << packet.encoding();
                 return;
         }
 
-        last_video_encoding_ = packet.encoding();
-
         if (!packet.has_format())
             return;
-    }
 
-    bool is_key_frame = false;
+        video_width_ = packet.format().video_rect().width();
+        video_height_ = packet.format().video_rect().height();
 
-    if (packet.has_format())
-    {
         if (!init())
             return;
+    }
 
-        const char* video_codec_id = mkvmuxer::Tracks::kVp8CodecId;
-        if (packet.encoding() == proto::VIDEO_ENCODING_VP9)
-            video_codec_id = mkvmuxer::Tracks::kVp9CodecId;
+    if (!muxer_)
+        return;
 
-        if (!muxer_->addVideoTrack(packet.format().video_rect().width(),
-                                   packet.format().video_rect().height(),
-                                   video_codec_id))
-        {
-            LOG(LS_ERROR) << "WebmFileMuxer::addVideoTrack failed";
-            return;
-        }
+    const bool is_key_frame = isKeyFrame(packet.encoding(), packet.data());
 
-        if (!muxer_->addAudioTrack(proto::AudioPacket::SAMPLING_RATE_48000,
-                                   proto::AudioPacket::CHANNELS_STEREO,
-                                   mkvmuxer::Tracks::kOpusCodecId))
-        {
-            LOG(LS_ERROR) << "WebmFileMuxer::addAudioTrack failed";
-            return;
-        }
+    // A new file can start only with a key frame.
+    if (is_key_frame && start_time_.has_value() &&
+        (segment_size_ >= kMaxSegmentSize || time - *start_time_ >= kMaxSegmentDuration))
+    {
+        LOG(LS_INFO) << "Segment limit reached (size: " << segment_size_ << ")";
 
-        is_key_frame = true;
-    }
+        close();
+        last_video_encoding_ = packet.encoding();
 
-    if (!muxer_)
-        return;
+        if (!init())
+            return;
+    }
 
     DCHECK(muxer_->hasVideoTrack());
     DCHECK(muxer_->hasAudioTrack());
 
-    TimePoint current = Clock::now();
-    NanoSeconds timestamp;
-
-    if (video_start_time_.has_value())
-    {
-        timestamp = std::chrono::duration_cast<NanoSeconds>(current - video_start_time_.value());
-    }
-    else
-    {
-        video_start_time_.emplace(current);
-        timestamp = NanoSeconds(0);
-    }
+    // The first frame of a file must be a key frame.
+    if (!start_time_.has_value() && !is_key_frame)
+        return;
 
-    muxer_->writeVideoFrame(packet.data(), timestamp, is_key_frame);
+    if (muxer_->writeVideoFrame(packet.data(), timestamp(time), is_key_frame))
+        segment_size_ += static_cast<int64_t>(packet.data().size());
 }
 
-void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet)
+void WebmFileWriter::writeAudioPacket(const proto::AudioPacket& packet, TimePoint time)
 {
-    if (packet.encoding() != proto::AUDIO_ENCODING_OPUS ||
-        packet.channels() != proto::AudioPacket::CHANNELS_STEREO ||
-        packet.sampling_rate() != proto::AudioPacket::SAMPLING_RATE_48000)
-    {
-        // Unsupported audio packet.
-        return;
-    }
-
-    if (!muxer_ || !muxer_->hasAudioTrack())
+    // The audio is written only after the first video frame of the file.
+    if (!muxer_ || !muxer_->hasAudioTrack() || !start_time_.has_value())
         return;
 
     for (int i = 0; i < packet.data_size(); ++i)
     {
-        TimePoint current = Clock::now();
-        NanoSeconds timestamp;
-
-        if (video_start_time_.has_value())
-        {
-            timestamp = std::chrono::duration_cast<NanoSeconds>(
-                current - video_start_time_.value());
-        }
-        else
-        {
-            video_start_time_.emplace(current);
-            timestamp = NanoSeconds(0);
-        }
-
-        muxer_->writeAudioFrame(packet.data(i), timestamp);
+        if (muxer_->writeAudioFrame(packet.data(i), timestamp(time)))
+            segment_size_ += static_cast<int64_t>(packet.data(i).size());
     }
 }
 
@@ -167,15 +248,18 @@ bool WebmFileWriter::init()
               << file_counter_
               << ".webm";
 
+    std::error_code error_code;
+    std::filesystem::create_directories(path_, error_code);
+
     std::filesystem::path file_path(path_);
     file_path.append(file_name.str());
 
     LOG(LS_INFO) << "New video file: " << file_path;
 
 #if defined(OS_WIN)
-    if (fopen_s(&file_, file_path.string().c_str(), "wb") != 0)
+    if (_wfopen_s(&file_, file_path.c_str(), L"wb") != 0)
 #else
-    file_ = fopen(file_path.string().c_str(), "wb");
+    file_ = fopen(file_path.c_str(), "wb");
     if (!file_)
 #endif
     {
@@ -184,7 +268,7 @@ bool WebmFileWriter::init()
     }
 
     muxer_ = std::make_unique<WebmFileMuxer>();
-    if (!muxer_->init(file_))
+    if (!muxer_->init(file_) || !addTracks())
     {
         LOG(LS_ERROR) << "WebmFileMuxer::init failed";
         close();
@@ -195,11 +279,34 @@ bool WebmFileWriter::init()
     return true;
 }
 
+bool WebmFileWriter::addTracks()
+{
+    const char* video_codec_id = mkvmuxer::Tracks::kVp8CodecId;
+    if (last_video_encoding_ == proto::VIDEO_ENCODING_VP9)
+        video_codec_id = mkvmuxer::Tracks::kVp9CodecId;
+
+    if (!muxer_->addVideoTrack(video_width_, video_height_, video_codec_id))
+    {
+        LOG(LS_ERROR) << "WebmFileMuxer::addVideoTrack failed";
+        return false;
+    }
+
+    if (!muxer_->addAudioTrack(proto::AudioPacket::SAMPLING_RATE_48000,
+                               proto::AudioPacket::CHANNELS_STEREO,
+                               mkvmuxer::Tracks::kOpusCodecId))
+    {
+        LOG(LS_ERROR) << "WebmFileMuxer::addAudioTrack failed";
+        return false;
+    }
+
+    return true;
+}
+
 void WebmFileWriter::close()
 {
     last_video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
-    video_start_time_.reset();
-    audio_start_time_.reset();
+    start_time_.reset();
+    segment_size_ = 0;
 
     if (muxer_)
     {
@@ -218,4 +325,20 @@ void WebmFileWriter::close()
     }
 }
 
+WebmFileWriter::NanoSeconds WebmFileWriter::timestamp(TimePoint time)
+{
+    if (!start_time_.has_value())
+    {
+        start_time_.emplace(time);
+        return NanoSeconds(0);
+    }
+
+    // The audio and the video may be added from different threads, so a packet may be a bit
+    // older than the first one.
+    if (time < *start_time_)
+        return NanoSeconds(0);
+
+    return std::chrono::duration_cast<NanoSeconds>(time - *start_time_);
+}
+
 } // namespace base
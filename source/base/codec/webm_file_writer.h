@@ -20,20 +20,24 @@
 #define BASE__CODEC__WEBM_FILE_WRITER_H
 
 #include "base/macros_magic.h"
-#include "base/desktop/geometry.h"
-#include "base/memory/byte_array.h"
 #include "proto/desktop.pb.h"
 
+#include <atomic>
 #include <chrono>
 #include <filesystem>
-#include <fstream>
 #include <memory>
 #include <optional>
 
 namespace base {
 
+class Thread;
 class WebmFileMuxer;
 
+// Writes the encoded VP8/VP9 video and Opus audio of a session into WebM files as is, without
+// decoding and encoding them again. A new file is started at a key frame after the current file
+// exceeds the size or the duration limit. The files are written on a separate thread, so the
+// methods do not block on the disk. If the disk cannot keep up, the packets are dropped until the
+// next key frame. The methods may be called from different threads.
 class WebmFileWriter
 {
 public:
@@ -43,24 +47,42 @@ public:
     void addVideoPacket(const proto::VideoPacket& packet);
     void addAudioPacket(const proto::AudioPacket& packet);
 
+    // Returns true if |data| of a VP8 or VP9 packet is a key frame.
+    static bool isKeyFrame(proto::VideoEncoding encoding, std::string_view data);
+
 private:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using NanoSeconds = std::chrono::nanoseconds;
+
+    // Methods called on the thread of the writer.
+    void writeVideoPacket(const proto::VideoPacket& packet, TimePoint time);
+    void writeAudioPacket(const proto::AudioPacket& packet, TimePoint time);
     bool init();
+    bool addTracks();
     void close();
+    NanoSeconds timestamp(TimePoint time);
 
     std::filesystem::path path_;
     std::string name_;
+
+    std::unique_ptr<Thread> thread_;
+
+    // The size of the packets that are posted to the thread and not written yet.
+    std::atomic<int64_t> pending_size_ { 0 };
+    std::atomic<bool> wait_key_frame_ { false };
+
+    // The fields below are used only on the thread of the writer.
     int file_counter_ = 0;
     FILE* file_ = nullptr;
 
-    using Clock = std::chrono::high_resolution_clock;
-    using TimePoint = std::chrono::time_point<Clock>;
-    using NanoSeconds = std::chrono::nanoseconds;
-
     std::unique_ptr<WebmFileMuxer> muxer_;
-    std::optional<TimePoint> video_start_time_;
-    std::optional<TimePoint> audio_start_time_;
+    std::optional<TimePoint> start_time_;
+    int64_t segment_size_ = 0;
 
     proto::VideoEncoding last_video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
+    int video_width_ = 0;
+    int video_height_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(WebmFileWriter);
 };
@@ -330,7 +330,7 @@ bool CommandLine::hasSwitch(std::u16string_view switch_string) const
     return switches_.find(switch_string) != switches_.end();
 }
 
-const std::filesystem::path& CommandLine::switchValuePath(std::u16string_view switch_string) const
+std::filesystem::path CommandLine::switchValuePath(std::u16string_view switch_string) const
 {
     DCHECK(toLower(switch_string) == switch_string);
     auto result = switches_.find(switch_string);
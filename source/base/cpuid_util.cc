@@ -79,6 +79,28 @@ bool CpuidUtil::hasAesNi()
     return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(25);
 }
 
+// static
+bool CpuidUtil::hasSse42()
+{
+    if (CpuidUtil(0).eax() < 1)
+        return false;
+
+    // Bit 20 of register ECX set to 1 indicates the support of SSE4.2 instructions.
+    return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(20);
+}
+
+// static
+bool CpuidUtil::hasPclmul()
+{
+    if (CpuidUtil(0).eax() < 1)
+        return false;
+
+    // Bit 1 of register ECX indicates the support of PCLMULQDQ instruction. The folding also uses
+    // SSE4.1 instructions (bit 19).
+    BitSet<uint32_t> ecx(CpuidUtil(1).ecx());
+    return ecx.test(1) && ecx.test(19);
+}
+
 } // namespace base
 
 #endif // defined(ARCH_CPU_X86_FAMILY)
@@ -18,8 +18,147 @@
 
 #include "base/crc32.h"
 
+#include "base/crc32_simd.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include "base/cpuid_util.h"
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && defined(OS_LINUX)
+#include <sys/auxv.h>
+#if !defined(HWCAP_CRC32)
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif // defined(ARCH_CPU_ARM64) && defined(OS_LINUX)
+
+#include <array>
+
 namespace base {
 
+namespace {
+
+using CrcFunction = uint32_t(*)(uint32_t crc, const uint8_t* data, size_t size);
+
+// The reversed Castagnoli polynomial.
+const uint32_t kCrc32cPolynomial = 0x82F63B78;
+
+// The folding needs at least 4 blocks of 16 bytes.
+const size_t kMinFoldingSize = 64;
+
+constexpr std::array<uint32_t, 256> crc32cTable()
+{
+    std::array<uint32_t, 256> table = {};
+
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+
+        for (int j = 0; j < 8; ++j)
+            crc = (crc & 1) ? (kCrc32cPolynomial ^ (crc >> 1)) : (crc >> 1);
+
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> kCrc32cTable = crc32cTable();
+
+uint32_t crc32Generic(uint32_t sum, const uint8_t* bytes, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        sum = kCrcTable[(sum & 0x000000FF) ^ bytes[i]] ^ (sum >> 8);
+
+    return sum;
+}
+
+uint32_t crc32cGeneric(uint32_t crc, const uint8_t* bytes, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        crc = kCrc32cTable[(crc & 0x000000FF) ^ bytes[i]] ^ (crc >> 8);
+
+    return crc;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+uint32_t crc32Folding(uint32_t sum, const uint8_t* bytes, size_t size)
+{
+    if (size >= kMinFoldingSize)
+    {
+        // The tail that does not fill a block of 16 bytes is added by the table.
+        const size_t folded_size = size & ~static_cast<size_t>(15);
+
+        sum = crc32_PCLMUL(sum, bytes, folded_size);
+        bytes += folded_size;
+        size -= folded_size;
+    }
+
+    return crc32Generic(sum, bytes, size);
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+bool hasArmCrc()
+{
+#if defined(OS_LINUX)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#elif defined(OS_MAC)
+    // All 64-bit Apple processors have the CRC instructions.
+    return true;
+#else
+    return false;
+#endif
+}
+
+#endif // defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+CrcFunction selectCrc32()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (CpuidUtil::hasPclmul())
+        return crc32Folding;
+#elif defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+    if (hasArmCrc())
+        return crc32_ARMV8;
+#endif
+
+    return crc32Generic;
+}
+
+CrcFunction selectCrc32c()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (CpuidUtil::hasSse42())
+        return crc32c_SSE42;
+#elif defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+    if (hasArmCrc())
+        return crc32c_ARMV8;
+#endif
+
+    return crc32cGeneric;
+}
+
+// Multiplies |a| and |b| modulo the Castagnoli polynomial. The bits are reflected.
+uint32_t multiplyModulo(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+
+    for (uint32_t mask = 1U << 31; mask; mask >>= 1)
+    {
+        if (a & mask)
+            product ^= b;
+
+        b = (b & 1) ? ((b >> 1) ^ kCrc32cPolynomial) : (b >> 1);
+    }
+
+    return product;
+}
+
+} // namespace
+
 // Static table of checksums for all possible 8 bit bytes.
 const uint32_t kCrcTable[256] =
 {
@@ -86,12 +225,32 @@ const uint32_t kCrcTable[256] =
 // place impacting changes in another place.
 uint32_t crc32(uint32_t sum, const void* data, size_t size)
 {
-    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    static const CrcFunction function = selectCrc32();
+    return function(sum, reinterpret_cast<const uint8_t*>(data), size);
+}
 
-    for (size_t i = 0; i < size; ++i)
-        sum = kCrcTable[(sum & 0x000000FF) ^ bytes[i]] ^ (sum >> 8);
+uint32_t crc32c(uint32_t crc, const void* data, size_t size)
+{
+    static const CrcFunction function = selectCrc32c();
+    return ~function(~crc, reinterpret_cast<const uint8_t*>(data), size);
+}
 
-    return sum;
+uint32_t crc32cCombine(uint32_t crc1, uint32_t crc2, uint64_t size2)
+{
+    // The first CRC is shifted by the size of the second part: multiplied by x^(8 * size2). The
+    // power is built from the squares x^(2^k), starting with x^8 for one byte.
+    uint32_t square = 1U << 23; // x^8
+    uint32_t shift = 1U << 31; // x^0
+
+    for (; size2; size2 >>= 1)
+    {
+        if (size2 & 1)
+            shift = multiplyModulo(square, shift);
+
+        square = multiplyModulo(square, square);
+    }
+
+    return multiplyModulo(shift, crc1) ^ crc2;
 }
 
 } // namespace base
@@ -31,6 +31,15 @@ extern const uint32_t kCrcTable[256];
 // operation began with previous data.
 uint32_t crc32(uint32_t sum, const void* data, size_t size);
 
+// Calculates the standard CRC-32C (Castagnoli) of the data. Unlike crc32(), the result includes
+// the initial and the final inversion, so |crc| is 0 for new data or the result for the previous
+// data to continue the calculation. SSE4.2 or ARMv8 CRC instructions are used if available.
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+// Returns the CRC-32C of the concatenation of two parts of data from the CRC-32C of the first part
+// |crc1|, the CRC-32C of the second part |crc2| and the size of the second part |size2|.
+uint32_t crc32cCombine(uint32_t crc1, uint32_t crc2, uint64_t size2);
+
 } // namespace base
 
 #endif // BASE__CRC32_H
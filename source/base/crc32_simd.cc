@@ -0,0 +1,210 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crc32_simd.h"
+
+#include <cstring>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <nmmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+#include <arm_acle.h>
+#endif // defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+uint32_t crc32c_SSE42(uint32_t crc, const uint8_t* data, size_t size)
+{
+#if defined(ARCH_CPU_X86_64)
+    uint64_t crc64 = crc;
+
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += sizeof(value);
+        size -= sizeof(value);
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+#else
+    while (size >= sizeof(uint32_t))
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+
+        crc = _mm_crc32_u32(crc, value);
+        data += sizeof(value);
+        size -= sizeof(value);
+    }
+#endif // defined(ARCH_CPU_X86_64)
+
+    while (size--)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    return crc;
+}
+
+// The folding follows "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+// by Intel. The constants are the bit-reflected values of x^(4*128+32), x^(4*128-32),
+// x^(128+32), x^(128-32) and x^64 modulo the polynomial, and the Barrett constants.
+uint32_t crc32_PCLMUL(uint32_t crc, const uint8_t* data, size_t size)
+{
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+    const __m128i* blocks = reinterpret_cast<const __m128i*>(data);
+
+    // Four blocks of 16 bytes are folded in parallel.
+    __m128i x1 = _mm_loadu_si128(blocks + 0);
+    __m128i x2 = _mm_loadu_si128(blocks + 1);
+    __m128i x3 = _mm_loadu_si128(blocks + 2);
+    __m128i x4 = _mm_loadu_si128(blocks + 3);
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+
+    __m128i x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+    blocks += 4;
+    size -= 64;
+
+    while (size >= 64)
+    {
+        __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(blocks + 0));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(blocks + 1));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(blocks + 2));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(blocks + 3));
+
+        blocks += 4;
+        size -= 64;
+    }
+
+    // Fold the four blocks into one.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+    __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Fold the remaining blocks of 16 bytes one by one.
+    while (size >= 16)
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(blocks)), x5);
+
+        ++blocks;
+        size -= 16;
+    }
+
+    // Fold 128 bits to 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+uint32_t crc32_ARMV8(uint32_t crc, const uint8_t* data, size_t size)
+{
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        crc = __crc32d(crc, value);
+        data += sizeof(value);
+        size -= sizeof(value);
+    }
+
+    while (size--)
+        crc = __crc32b(crc, *data++);
+
+    return crc;
+}
+
+uint32_t crc32c_ARMV8(uint32_t crc, const uint8_t* data, size_t size)
+{
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        crc = __crc32cd(crc, value);
+        data += sizeof(value);
+        size -= sizeof(value);
+    }
+
+    while (size--)
+        crc = __crc32cb(crc, *data++);
+
+    return crc;
+}
+
+#endif // defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+} // namespace base
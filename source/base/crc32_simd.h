@@ -0,0 +1,53 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CRC32_SIMD_H
+#define BASE__CRC32_SIMD_H
+
+#include "build/build_config.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// The kernels update the CRC register |crc| without the initial and the final inversion. They are
+// selected at runtime in crc32.cc and must be called only if the processor supports them.
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+// CRC-32C with the instructions of SSE4.2.
+uint32_t crc32c_SSE42(uint32_t crc, const uint8_t* data, size_t size);
+
+// CRC-32 folded with carry-less multiplication (requires SSE4.1 and PCLMULQDQ). |size| must be at
+// least 64 and a multiple of 16.
+uint32_t crc32_PCLMUL(uint32_t crc, const uint8_t* data, size_t size);
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+// CRC-32 and CRC-32C with the CRC instructions of ARMv8.
+uint32_t crc32_ARMV8(uint32_t crc, const uint8_t* data, size_t size);
+uint32_t crc32c_ARMV8(uint32_t crc, const uint8_t* data, size_t size);
+
+#endif // defined(ARCH_CPU_ARM64) && !defined(CC_MSVC)
+
+} // namespace base
+
+#endif // BASE__CRC32_SIMD_H
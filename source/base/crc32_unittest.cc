@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace base {
 
 // Table was generated similarly to sample code for CRC-32 given on:
@@ -47,4 +49,53 @@ TEST(Crc32Test, ZeroTest)
     EXPECT_EQ(0U, crc32(0, nullptr, 0));
 }
 
+// The hardware kernels must give the same result as the table for all sizes and alignments.
+TEST(Crc32Test, MatchesTable)
+{
+    std::vector<uint8_t> data(1024 + 3);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+
+    for (size_t offset = 0; offset < 3; ++offset)
+    {
+        for (size_t size = 0; size <= 1024; ++size)
+        {
+            uint32_t expected = 0x12345678;
+            for (size_t i = 0; i < size; ++i)
+                expected = kCrcTable[(expected & 0xFF) ^ data[offset + i]] ^ (expected >> 8);
+
+            EXPECT_EQ(expected, crc32(0x12345678, data.data() + offset, size)) << size;
+        }
+    }
+}
+
+TEST(Crc32Test, Crc32c)
+{
+    EXPECT_EQ(0U, crc32c(0, nullptr, 0));
+    EXPECT_EQ(0xE3069283U, crc32c(0, "123456789", 9));
+
+    // 32 bytes of zeros from RFC 3720.
+    const std::vector<uint8_t> zeros(32, 0);
+    EXPECT_EQ(0x8A9136AAU, crc32c(0, zeros.data(), zeros.size()));
+
+    // The calculation can be continued.
+    EXPECT_EQ(0xE3069283U, crc32c(crc32c(0, "1234", 4), "56789", 5));
+}
+
+TEST(Crc32Test, Crc32cCombine)
+{
+    std::vector<uint8_t> data(4096);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 13 + 1);
+
+    for (size_t split = 0; split <= data.size(); split += 97)
+    {
+        const uint32_t first = crc32c(0, data.data(), split);
+        const uint32_t second = crc32c(0, data.data() + split, data.size() - split);
+
+        EXPECT_EQ(crc32c(0, data.data(), data.size()),
+                  crc32cCombine(first, second, data.size() - split)) << split;
+    }
+}
+
 } // namespace base
@@ -0,0 +1,100 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crypto/cipher_benchmark.h"
+
+#include "base/logging.h"
+#include "base/crypto/message_encryptor_openssl.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace base {
+
+namespace {
+
+// The size of a fragment of the network channel.
+const size_t kMessageSize = 32 * 1024;
+
+// Each cipher is measured for at least this time and this number of messages.
+const std::chrono::milliseconds kMinDuration{ 2 };
+const int kMinMessageCount = 8;
+
+uint32_t measureEncryptor(MessageEncryptor* encryptor)
+{
+    if (!encryptor)
+        return 0;
+
+    ByteArray message(kMessageSize);
+    ByteArray tag(encryptor->encryptedDataSize(kMessageSize) - kMessageSize);
+
+    // The first message warms up the caches and is not counted.
+    if (!encryptor->encryptInPlace(message.data(), message.size(), tag.data()))
+        return 0;
+
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point start_time = Clock::now();
+    Clock::duration duration;
+    int64_t count = 0;
+
+    do
+    {
+        if (!encryptor->encryptInPlace(message.data(), message.size(), tag.data()))
+            return 0;
+
+        ++count;
+        duration = Clock::now() - start_time;
+    }
+    while (count < kMinMessageCount || duration < kMinDuration);
+
+    const double seconds = std::chrono::duration<double>(duration).count();
+    if (seconds <= 0)
+        return 0;
+
+    const double speed = static_cast<double>(count * kMessageSize) / seconds / (1024 * 1024);
+    return std::max(static_cast<uint32_t>(speed), 1U);
+}
+
+} // namespace
+
+// static
+const CipherBenchmark::Result& CipherBenchmark::result()
+{
+    static const Result result = measure();
+    return result;
+}
+
+// static
+CipherBenchmark::Result CipherBenchmark::measure()
+{
+    const ByteArray key(32);
+    const ByteArray iv(12);
+
+    Result result;
+    result.aes256_gcm =
+        measureEncryptor(MessageEncryptorOpenssl::createForAes256Gcm(key, iv).get());
+    result.chacha20_poly1305 =
+        measureEncryptor(MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv).get());
+
+    LOG(LS_INFO) << "Cipher speed (AES256 GCM: " << result.aes256_gcm
+                 << " MB/s, ChaCha20+Poly1305: " << result.chacha20_poly1305 << " MB/s)";
+    return result;
+}
+
+} // namespace base
@@ -0,0 +1,54 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CRYPTO__CIPHER_BENCHMARK_H
+#define BASE__CRYPTO__CIPHER_BENCHMARK_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+
+namespace base {
+
+// Measures the speed of the ciphers of the network channels on this CPU. OpenSSL uses the hardware
+// acceleration where it is available (AES-NI, ARMv8 crypto extensions and others), so the measured
+// speed gives the right answer where the CPU features are not known to us.
+class CipherBenchmark
+{
+public:
+    // The speed of the encryption in megabytes per second.
+    struct Result
+    {
+        uint32_t aes256_gcm = 0;
+        uint32_t chacha20_poly1305 = 0;
+    };
+
+    // Returns the result of the measurement, which is done once on the first call. It takes a few
+    // milliseconds.
+    static const Result& result();
+
+    // Measures the speed of the ciphers again.
+    static Result measure();
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(CipherBenchmark);
+};
+
+} // namespace base
+
+#endif // BASE__CRYPTO__CIPHER_BENCHMARK_H
@@ -106,6 +106,62 @@ void wrongKey(MessageEncryptor* client_encryptor, MessageDecryptor* host_decrypt
     ASSERT_FALSE(ret);
 }
 
+void inPlace(MessageEncryptor* encryptor, MessageDecryptor* decryptor)
+{
+    const ByteArray message = fromHex(
+        "6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c28f2ff048d4f7eb7bcf5048c901a4adaa7fd");
+
+    // A message encrypted in place must be decrypted by |decrypt|.
+    ByteArray data = message;
+    ByteArray tag(encryptor->encryptedDataSize(data.size()) - data.size());
+    ASSERT_EQ(tag.size(), 16);
+
+    ASSERT_TRUE(encryptor->encryptInPlace(data.data(), data.size(), tag.data()));
+    ASSERT_NE(data, message);
+
+    ByteArray encrypted = tag;
+    encrypted.insert(encrypted.end(), data.begin(), data.end());
+
+    ByteArray decrypted(decryptor->decryptedDataSize(encrypted.size()));
+    ASSERT_TRUE(decryptor->decrypt(encrypted.data(), encrypted.size(), decrypted.data()));
+    ASSERT_EQ(decrypted, message);
+
+    // A message encrypted by |encrypt| must be decrypted in place.
+    encrypted.resize(encryptor->encryptedDataSize(message.size()));
+    ASSERT_TRUE(encryptor->encrypt(message.data(), message.size(), encrypted.data()));
+
+    data.assign(encrypted.begin() + tag.size(), encrypted.end());
+    ASSERT_TRUE(decryptor->decryptInPlace(encrypted.data(), data.data(), data.size()));
+    ASSERT_EQ(data, message);
+
+    // The changed data must not be decrypted.
+    ASSERT_TRUE(encryptor->encryptInPlace(data.data(), data.size(), tag.data()));
+    data[0] ^= 1;
+    ASSERT_FALSE(decryptor->decryptInPlace(tag.data(), data.data(), data.size()));
+}
+
+void gather(MessageEncryptor* encryptor, MessageDecryptor* decryptor)
+{
+    const ByteArray message = fromHex(
+        "6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c28f2ff048d4f7eb7bcf5048c901a4adaa7fd");
+
+    // The parts of the message (with an empty one) must be decrypted as the whole message.
+    const MessageEncryptor::Buffer parts[] =
+    {
+        { message.data(), 3 },
+        { message.data() + 3, 0 },
+        { message.data() + 3, 17 },
+        { message.data() + 20, message.size() - 20 }
+    };
+
+    ByteArray encrypted(encryptor->encryptedDataSize(message.size()));
+    ASSERT_TRUE(encryptor->encryptGather(parts, std::size(parts), encrypted.data()));
+
+    ByteArray decrypted(decryptor->decryptedDataSize(encrypted.size()));
+    ASSERT_TRUE(decryptor->decrypt(encrypted.data(), encrypted.size(), decrypted.data()));
+    ASSERT_EQ(decrypted, message);
+}
+
 TEST(CryptorAes256GcmTest, TestVector)
 {
     const ByteArray key =
@@ -162,6 +218,38 @@ TEST(CryptorAes256GcmTest, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorAes256GcmTest, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor = MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor = MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    inPlace(encryptor.get(), decryptor.get());
+}
+
+TEST(CryptorAes256GcmTest, Gather)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    gather(encryptor.get(), decryptor.get());
+}
+
 TEST(CryptorChaCha20Poly1305Test, TestVector)
 {
     const ByteArray key =
@@ -218,4 +306,36 @@ TEST(CryptorChaCha20Poly1305Test, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorChaCha20Poly1305Test, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor = MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor = MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    inPlace(encryptor.get(), decryptor.get());
+}
+
+TEST(CryptorChaCha20Poly1305Test, Gather)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    gather(encryptor.get(), decryptor.get());
+}
+
 } // namespace base
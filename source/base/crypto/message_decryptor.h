@@ -30,6 +30,10 @@ public:
 
     virtual size_t decryptedDataSize(size_t in_size) = 0;
     virtual bool decrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Decrypts |size| bytes of |data| in place. |tag| is the authentication tag which precedes the
+    // data in the message, its size is |in_size - decryptedDataSize(in_size)|.
+    virtual bool decryptInPlace(const void* tag, void* data, size_t size) = 0;
 };
 
 } // namespace base
@@ -37,4 +37,10 @@ bool MessageDecryptorFake::decrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageDecryptorFake::decryptInPlace(
+    const void* /* tag */, void* /* data */, size_t /* size */)
+{
+    return true;
+}
+
 } // namespace base
@@ -85,6 +85,19 @@ size_t MessageDecryptorOpenssl::decryptedDataSize(size_t in_size)
 }
 
 bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
+{
+    return decryptImpl(
+        in, reinterpret_cast<const uint8_t*>(in) + kTagSize, in_size - kTagSize, out);
+}
+
+bool MessageDecryptorOpenssl::decryptInPlace(const void* tag, void* data, size_t size)
+{
+    // AEAD ciphers in OpenSSL allow the input and output buffers to be the same.
+    return decryptImpl(tag, data, size, data);
+}
+
+bool MessageDecryptorOpenssl::decryptImpl(
+    const void* tag, const void* in, size_t in_size, void* out)
 {
     if (EVP_DecryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
     {
@@ -96,14 +109,14 @@ bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
 
     if (EVP_DecryptUpdate(ctx_.get(),
                           reinterpret_cast<uint8_t*>(out), &length,
-                          reinterpret_cast<const uint8_t*>(in) + kTagSize, in_size - kTagSize) != 1)
+                          reinterpret_cast<const uint8_t*>(in), in_size) != 1)
     {
         LOG(LS_WARNING) << "EVP_DecryptUpdate failed";
         return false;
     }
 
     if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_SET_TAG, kTagSize,
-                            const_cast<void*>(in)) != 1)
+                            const_cast<void*>(tag)) != 1)
     {
         LOG(LS_WARNING) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
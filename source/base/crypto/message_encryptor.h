@@ -28,8 +28,23 @@ class MessageEncryptor
 public:
     virtual ~MessageEncryptor() = default;
 
+    struct Buffer
+    {
+        const void* data;
+        size_t size;
+    };
+
     virtual size_t encryptedDataSize(size_t in_size) = 0;
     virtual bool encrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Encrypts |size| bytes of |data| in place and writes the authentication tag to |tag|. The tag
+    // size is |encryptedDataSize(size) - size|. Sending the tag followed by the data is equal to
+    // sending the output of |encrypt|.
+    virtual bool encryptInPlace(void* data, size_t size, void* tag) = 0;
+
+    // Encrypts |count| buffers of |in| as one message into |out|. The result is equal to the output
+    // of |encrypt| for the buffers copied one after another, but the data is not copied.
+    virtual bool encryptGather(const Buffer* in, size_t count, void* out) = 0;
 };
 
 } // namespace base
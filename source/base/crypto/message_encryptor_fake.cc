@@ -18,6 +18,7 @@
 
 #include "base/crypto/message_encryptor_fake.h"
 
+#include <cstdint>
 #include <cstring>
 
 namespace base {
@@ -37,4 +38,22 @@ bool MessageEncryptorFake::encrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageEncryptorFake::encryptInPlace(void* /* data */, size_t /* size */, void* /* tag */)
+{
+    return true;
+}
+
+bool MessageEncryptorFake::encryptGather(const Buffer* in, size_t count, void* out)
+{
+    uint8_t* out_data = reinterpret_cast<uint8_t*>(out);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        memcpy(out_data, in[i].data, in[i].size);
+        out_data += in[i].size;
+    }
+
+    return true;
+}
+
 } // namespace base
@@ -33,6 +33,8 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) override;
     bool encrypt(const void* in, size_t in_size, void* out) override;
+    bool encryptInPlace(void* data, size_t size, void* tag) override;
+    bool encryptGather(const Buffer* in, size_t count, void* out) override;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MessageEncryptorFake);
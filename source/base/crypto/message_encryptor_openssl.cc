@@ -85,6 +85,24 @@ size_t MessageEncryptorOpenssl::encryptedDataSize(size_t in_size)
 }
 
 bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
+{
+    const Buffer buffer = { in, in_size };
+    return encryptImpl(&buffer, 1, reinterpret_cast<uint8_t*>(out) + kTagSize, out);
+}
+
+bool MessageEncryptorOpenssl::encryptInPlace(void* data, size_t size, void* tag)
+{
+    // AEAD ciphers in OpenSSL allow the input and output buffers to be the same.
+    const Buffer buffer = { data, size };
+    return encryptImpl(&buffer, 1, data, tag);
+}
+
+bool MessageEncryptorOpenssl::encryptGather(const Buffer* in, size_t count, void* out)
+{
+    return encryptImpl(in, count, reinterpret_cast<uint8_t*>(out) + kTagSize, out);
+}
+
+bool MessageEncryptorOpenssl::encryptImpl(const Buffer* in, size_t count, void* out, void* tag)
 {
     if (EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
     {
@@ -92,25 +110,35 @@ bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
         return false;
     }
 
+    uint8_t* out_data = reinterpret_cast<uint8_t*>(out);
     int length;
 
-    if (EVP_EncryptUpdate(ctx_.get(),
-                          reinterpret_cast<uint8_t*>(out) + kTagSize, &length,
-                          reinterpret_cast<const uint8_t*>(in), in_size) != 1)
+    // GCM and Poly1305 are stream modes, so the buffers are encrypted one after another as one
+    // message.
+    for (size_t i = 0; i < count; ++i)
     {
-        LOG(LS_WARNING) << "EVP_EncryptUpdate failed";
-        return false;
+        if (!in[i].size)
+            continue;
+
+        if (EVP_EncryptUpdate(ctx_.get(),
+                              out_data, &length,
+                              reinterpret_cast<const uint8_t*>(in[i].data),
+                              static_cast<int>(in[i].size)) != 1)
+        {
+            LOG(LS_WARNING) << "EVP_EncryptUpdate failed";
+            return false;
+        }
+
+        out_data += length;
     }
 
-    if (EVP_EncryptFinal_ex(ctx_.get(),
-                            reinterpret_cast<uint8_t*>(out) + kTagSize + length,
-                            &length) != 1)
+    if (EVP_EncryptFinal_ex(ctx_.get(), out_data, &length) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptFinal_ex failed";
         return false;
     }
 
-    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, out) != 1)
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, tag) != 1)
     {
         LOG(LS_WARNING) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
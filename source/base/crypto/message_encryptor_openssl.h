@@ -40,10 +40,14 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) override;
     bool encrypt(const void* in, size_t in_size, void* out) override;
+    bool encryptInPlace(void* data, size_t size, void* tag) override;
+    bool encryptGather(const Buffer* in, size_t count, void* out) override;
 
 private:
     MessageEncryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
 
+    bool encryptImpl(const Buffer* in, size_t count, void* out, void* tag);
+
     EVP_CIPHER_CTX_ptr ctx_;
     ByteArray iv_;
 
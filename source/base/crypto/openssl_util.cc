@@ -35,6 +35,11 @@ void BIGNUM_Deleter::operator()(bignum_st* bignum)
     BN_clear_free(bignum);
 }
 
+void BN_MONT_CTX_Deleter::operator()(bn_mont_ctx_st* ctx)
+{
+    BN_MONT_CTX_free(ctx);
+}
+
 void EVP_CIPHER_CTX_Deleter::operator()(evp_cipher_ctx_st* ctx)
 {
     EVP_CIPHER_CTX_cleanup(ctx);
@@ -0,0 +1,157 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crypto/srp_ephemeral_pool.h"
+
+#include "base/logging.h"
+#include "base/crypto/random.h"
+#include "base/crypto/srp_math.h"
+
+namespace base {
+
+namespace {
+
+// The size of b in bytes (1024 bits).
+const size_t kSecretSize = 128;
+
+} // namespace
+
+SrpEphemeralPool::SrpEphemeralPool(size_t capacity)
+    : capacity_(capacity)
+{
+    DCHECK_GT(capacity_, 0u);
+    thread_ = std::thread(&SrpEphemeralPool::threadMain, this);
+}
+
+SrpEphemeralPool::~SrpEphemeralPool()
+{
+    {
+        std::scoped_lock lock(lock_);
+        terminating_ = true;
+    }
+
+    event_.notify_one();
+    thread_.join();
+}
+
+void SrpEphemeralPool::prepare(const SrpNgPair& group)
+{
+    {
+        std::scoped_lock lock(lock_);
+        groupLocked(group);
+    }
+
+    event_.notify_one();
+}
+
+SrpEphemeralPool::Ephemeral SrpEphemeralPool::take(const SrpNgPair& group)
+{
+    Ephemeral ephemeral;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        Group* entry = groupLocked(group);
+        if (!entry->ephemerals.empty())
+        {
+            ephemeral = std::move(entry->ephemerals.front());
+            entry->ephemerals.pop_front();
+        }
+    }
+
+    event_.notify_one();
+
+    if (ephemeral.gb.isValid())
+        return ephemeral;
+
+    return calculate(BigNum::fromStdString(group.first), BigNum::fromStdString(group.second));
+}
+
+// static
+SrpEphemeralPool::Ephemeral SrpEphemeralPool::calculate(const BigNum& N, const BigNum& g)
+{
+    Ephemeral ephemeral;
+
+    ephemeral.b = BigNum::fromByteArray(Random::byteArray(kSecretSize));
+    ephemeral.gb = SrpMath::calc_gb(ephemeral.b, N, g);
+
+    return ephemeral;
+}
+
+SrpEphemeralPool::Group* SrpEphemeralPool::groupLocked(const SrpNgPair& group)
+{
+    std::string key(group.first);
+
+    auto it = groups_.find(key);
+    if (it != groups_.end())
+        return it->second.get();
+
+    std::unique_ptr<Group> entry = std::make_unique<Group>();
+    entry->N = BigNum::fromStdString(group.first);
+    entry->g = BigNum::fromStdString(group.second);
+
+    return groups_.emplace(std::move(key), std::move(entry)).first->second.get();
+}
+
+SrpEphemeralPool::Group* SrpEphemeralPool::groupToRefillLocked()
+{
+    for (const auto& group : groups_)
+    {
+        if (!group.second->failed && group.second->ephemerals.size() < capacity_)
+            return group.second.get();
+    }
+
+    return nullptr;
+}
+
+void SrpEphemeralPool::threadMain()
+{
+    std::unique_lock lock(lock_);
+
+    while (true)
+    {
+        Group* group = nullptr;
+
+        event_.wait(lock, [&]()
+        {
+            if (terminating_)
+                return true;
+
+            group = groupToRefillLocked();
+            return group != nullptr;
+        });
+
+        if (terminating_)
+            return;
+
+        lock.unlock();
+        Ephemeral ephemeral = calculate(group->N, group->g);
+        lock.lock();
+
+        if (!ephemeral.gb.isValid())
+        {
+            LOG(LS_ERROR) << "Unable to calculate SRP ephemeral";
+            group->failed = true;
+            continue;
+        }
+
+        group->ephemerals.emplace_back(std::move(ephemeral));
+    }
+}
+
+} // namespace base
@@ -0,0 +1,92 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CRYPTO__SRP_EPHEMERAL_POOL_H
+#define BASE__CRYPTO__SRP_EPHEMERAL_POOL_H
+
+#include "base/crypto/big_num.h"
+#include "base/crypto/srp_constants.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace base {
+
+// Keeps the secret values b and g^b % N of the server side of SRP calculated in advance for each
+// SRP group. The modular exponentiation is the most expensive part of the server key exchange, so
+// with a ready g^b the handshake only adds the part of the user (k*v). A background thread
+// calculates new values while the number of ready values of a group is below the capacity. Each
+// value is given out only once.
+class SrpEphemeralPool
+{
+public:
+    static const size_t kDefaultCapacity = 16;
+
+    explicit SrpEphemeralPool(size_t capacity = kDefaultCapacity);
+    ~SrpEphemeralPool();
+
+    struct Ephemeral
+    {
+        BigNum b;
+        BigNum gb;
+    };
+
+    // Starts calculating the values of |group| before they are requested. Can be called from any
+    // thread.
+    void prepare(const SrpNgPair& group);
+
+    // Returns the ready values of |group| and wakes the background thread to replace them. If
+    // there are no ready values, they are calculated on the calling thread. Can be called from any
+    // thread.
+    Ephemeral take(const SrpNgPair& group);
+
+private:
+    struct Group
+    {
+        BigNum N;
+        BigNum g;
+        std::deque<Ephemeral> ephemerals;
+        bool failed = false;
+    };
+
+    static Ephemeral calculate(const BigNum& N, const BigNum& g);
+
+    Group* groupLocked(const SrpNgPair& group);
+    Group* groupToRefillLocked();
+    void threadMain();
+
+    const size_t capacity_;
+
+    std::mutex lock_;
+    std::condition_variable event_;
+
+    // The groups are never removed, so the background thread can use N and g without the lock.
+    std::map<std::string, std::unique_ptr<Group>> groups_;
+    bool terminating_ = false;
+
+    std::thread thread_;
+
+    DISALLOW_COPY_AND_ASSIGN(SrpEphemeralPool);
+};
+
+} // namespace base
+
+#endif // BASE__CRYPTO__SRP_EPHEMERAL_POOL_H
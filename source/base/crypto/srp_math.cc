@@ -23,6 +23,9 @@
 #include "base/strings/string_util.h"
 #include "base/strings/unicode.h"
 
+#include <map>
+#include <mutex>
+
 #include <openssl/opensslv.h>
 #include <openssl/bn.h>
 
@@ -62,6 +65,55 @@ BigNum calc_k(const BigNum& N, const BigNum& g)
     return calc_xy(N, g, N);
 }
 
+// The context keeps the temporary numbers of the calculations between the calls on the thread.
+bignum_ctx* threadContext()
+{
+    thread_local BigNum::Context ctx = BigNum::Context::create();
+    return ctx;
+}
+
+// The Montgomery contexts are created once for each modulus and are only read after that. The
+// client gets the modulus from the peer, so the number of the cached contexts is limited.
+const size_t kMaxMontContexts = 8;
+
+bn_mont_ctx_st* montContext(const BigNum& N, bignum_ctx* ctx)
+{
+    static std::mutex lock;
+    static std::map<std::string, BN_MONT_CTX_ptr> contexts;
+
+    std::string key = N.toStdString();
+
+    std::scoped_lock scoped_lock(lock);
+
+    auto it = contexts.find(key);
+    if (it != contexts.end())
+        return it->second.get();
+
+    if (contexts.size() >= kMaxMontContexts)
+        return nullptr;
+
+    BN_MONT_CTX_ptr mont(BN_MONT_CTX_new());
+    if (!mont || !BN_MONT_CTX_set(mont.get(), N, ctx))
+        return nullptr;
+
+    return contexts.emplace(std::move(key), std::move(mont)).first->second.get();
+}
+
+// r = a^p % N
+bool modExp(BigNum* r, const BigNum& a, const BigNum& p, const BigNum& N, bignum_ctx* ctx)
+{
+    bn_mont_ctx_st* mont = BN_is_odd(N) ? montContext(N, ctx) : nullptr;
+    if (!mont)
+        return BN_mod_exp(*r, a, p, N, ctx) != 0;
+
+    // The same choice as in BN_mod_exp: the generators are small and a secret exponent needs the
+    // constant time calculation.
+    if (BN_num_bits(a) <= BN_BITS2 && !BN_get_flags(p, BN_FLG_CONSTTIME))
+        return BN_mod_exp_mont_word(*r, BN_get_word(a), p, N, ctx, mont) != 0;
+
+    return BN_mod_exp_mont(*r, a, p, N, ctx, mont) != 0;
+}
+
 } // namespace
 
 // static
@@ -75,18 +127,26 @@ BigNum SrpMath::calc_u(const BigNum& A, const BigNum& B, const BigNum& N)
 // B = k*v + g^b % N
 BigNum SrpMath::calc_B(const BigNum& b, const BigNum& N, const BigNum& g, const BigNum& v)
 {
-    if (!b.isValid() || !N.isValid() || !g.isValid() || !v.isValid())
-        return BigNum();
+    return calc_B_from_gb(calc_gb(b, N, g), N, g, v);
+}
 
-    BigNum::Context ctx = BigNum::Context::create();
-    if (!ctx.isValid())
-        return BigNum();
+// static
+// gb = g^b % N
+BigNum SrpMath::calc_gb(const BigNum& b, const BigNum& N, const BigNum& g)
+{
+    return calc_A(b, N, g);
+}
 
-    BigNum gb = BigNum::create();
-    if (!gb.isValid())
+// static
+// B = k*v + gb % N
+BigNum SrpMath::calc_B_from_gb(const BigNum& gb, const BigNum& N, const BigNum& g,
+                               const BigNum& v)
+{
+    if (!gb.isValid() || !N.isValid() || !g.isValid() || !v.isValid())
         return BigNum();
 
-    if (!BN_mod_exp(gb, g, b, N, ctx))
+    bignum_ctx* ctx = threadContext();
+    if (!ctx)
         return BigNum();
 
     BigNum k = calc_k(N, g);
@@ -147,13 +207,13 @@ BigNum SrpMath::calc_A(const BigNum& a, const BigNum& N, const BigNum& g)
     if (!a.isValid() || !N.isValid() || !g.isValid())
         return BigNum();
 
-    BigNum::Context ctx = BigNum::Context::create();
+    bignum_ctx* ctx = threadContext();
     BigNum A = BigNum::create();
 
-    if (!A.isValid() || !ctx.isValid())
+    if (!A.isValid() || !ctx)
         return BigNum();
 
-    if (!BN_mod_exp(A, g, a, N, ctx))
+    if (!modExp(&A, g, a, N, ctx))
         return BigNum();
 
     return A;
@@ -170,13 +230,13 @@ BigNum SrpMath::calcServerKey(const BigNum& A, const BigNum& v, const BigNum& u,
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
+    bignum_ctx* ctx = threadContext();
     BigNum tmp = BigNum::create();
 
-    if (!ctx.isValid() || !tmp.isValid())
+    if (!ctx || !tmp.isValid())
         return BigNum();
 
-    if (!BN_mod_exp(tmp, v, u, N, ctx))
+    if (!modExp(&tmp, v, u, N, ctx))
         return BigNum();
 
     if (!BN_mod_mul(tmp, A, tmp, N, ctx))
@@ -186,7 +246,7 @@ BigNum SrpMath::calcServerKey(const BigNum& A, const BigNum& v, const BigNum& u,
     if (!S.isValid())
         return BigNum();
 
-    if (!BN_mod_exp(S, tmp, b, N, ctx))
+    if (!modExp(&S, tmp, b, N, ctx))
         return BigNum();
 
     return S;
@@ -200,8 +260,8 @@ BigNum SrpMath::calcClientKey(const BigNum& N, const BigNum& B, const BigNum& g,
     if (!N.isValid() || !B.isValid() || !g.isValid() || !x.isValid() || !a.isValid() || !u.isValid())
         return BigNum();
 
-    BigNum::Context ctx = BigNum::Context::create();
-    if (!ctx.isValid())
+    bignum_ctx* ctx = threadContext();
+    if (!ctx)
         return BigNum();
 
     BigNum tmp = BigNum::create();
@@ -211,7 +271,7 @@ BigNum SrpMath::calcClientKey(const BigNum& N, const BigNum& B, const BigNum& g,
     if (!tmp.isValid() || !tmp2.isValid() || !tmp3.isValid())
         return BigNum();
 
-    if (!BN_mod_exp(tmp, g, x, N, ctx))
+    if (!modExp(&tmp, g, x, N, ctx))
         return BigNum();
 
     BigNum k = calc_k(N, g);
@@ -234,7 +294,7 @@ BigNum SrpMath::calcClientKey(const BigNum& N, const BigNum& B, const BigNum& g,
     if (!K.isValid())
         return BigNum();
 
-    if (!BN_mod_exp(K, tmp, tmp2, N, ctx))
+    if (!modExp(&K, tmp, tmp2, N, ctx))
         return BigNum();
 
     return K;
@@ -246,10 +306,10 @@ bool SrpMath::verify_B_mod_N(const BigNum& B, const BigNum& N)
     if (!B.isValid() || !N.isValid())
         return false;
 
-    BigNum::Context ctx = BigNum::Context::create();
+    bignum_ctx* ctx = threadContext();
     BigNum result = BigNum::create();
 
-    if (!ctx.isValid() || !result.isValid())
+    if (!ctx || !result.isValid())
         return false;
 
     if (!BN_nnmod(result, B, N, ctx))
@@ -271,15 +331,15 @@ BigNum SrpMath::calc_v(std::u16string_view I, std::u16string_view p, const BigNu
     if (I.empty() || p.empty() || !N.isValid() || !g.isValid() || !s.isValid())
         return BigNum();
 
-    BigNum::Context ctx = BigNum::Context::create();
+    bignum_ctx* ctx = threadContext();
     BigNum v = BigNum::create();
 
-    if (!ctx.isValid() || !v.isValid())
+    if (!ctx || !v.isValid())
         return BigNum();
 
     BigNum x = calc_x(s, I, p);
 
-    if (!BN_mod_exp(v, g, x, N, ctx))
+    if (!modExp(&v, g, x, N, ctx))
         return BigNum();
 
     return v;
@@ -292,15 +352,15 @@ BigNum SrpMath::calc_v(std::u16string_view I, const ByteArray& p, const BigNum&
     if (I.empty() || p.empty() || !N.isValid() || !g.isValid() || !s.isValid())
         return BigNum();
 
-    BigNum::Context ctx = BigNum::Context::create();
+    bignum_ctx* ctx = threadContext();
     BigNum v = BigNum::create();
 
-    if (!ctx.isValid() || !v.isValid())
+    if (!ctx || !v.isValid())
         return BigNum();
 
     BigNum x = calc_x(s, I, p);
 
-    if (!BN_mod_exp(v, g, x, N, ctx))
+    if (!modExp(&v, g, x, N, ctx))
         return BigNum();
 
     return v;
@@ -41,6 +41,12 @@ public:
 
     static BigNum calc_u(const BigNum& A, const BigNum& B, const BigNum& N);
     static BigNum calc_B(const BigNum& b, const BigNum& N, const BigNum& g, const BigNum& v);
+
+    // The server ephemeral in two steps. g^b does not depend on the user and can be calculated in
+    // advance (see SrpEphemeralPool).
+    static BigNum calc_gb(const BigNum& b, const BigNum& N, const BigNum& g);
+    static BigNum calc_B_from_gb(const BigNum& gb, const BigNum& N, const BigNum& g,
+                                 const BigNum& v);
     static BigNum calc_x(const BigNum& s, std::u16string_view I, std::u16string_view p);
     static BigNum calc_x(const BigNum& s, std::u16string_view I, const ByteArray& p);
     static BigNum calc_A(const BigNum& a, const BigNum& N, const BigNum& g);
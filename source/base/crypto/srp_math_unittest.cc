@@ -190,4 +190,24 @@ TEST(srp_math_test, test_vector)
     ASSERT_EQ(memcmp(client_key_string.c_str(), key_ref_buf, sizeof(key_ref_buf)), 0);
 }
 
+TEST(srp_math_test, precomputed_ephemeral)
+{
+    BigNum N = BigNum::fromStdString(kSrpNgPair_4096.first);
+    BigNum g = BigNum::fromStdString(kSrpNgPair_4096.second);
+    BigNum b = BigNum::fromStdString("0123456789abcdef0123456789abcdef");
+    BigNum v = SrpMath::calc_v(u"user", u"password", BigNum::fromStdString("salt"), N, g);
+    ASSERT_TRUE(v.isValid());
+
+    BigNum B = SrpMath::calc_B(b, N, g, v);
+    ASSERT_TRUE(B.isValid());
+
+    BigNum gb = SrpMath::calc_gb(b, N, g);
+    ASSERT_TRUE(gb.isValid());
+
+    BigNum B_from_gb = SrpMath::calc_B_from_gb(gb, N, g, v);
+    ASSERT_TRUE(B_from_gb.isValid());
+
+    EXPECT_EQ(B.toStdString(), B_from_gb.toStdString());
+}
+
 } // namespace base
@@ -18,10 +18,37 @@
 
 #include "base/desktop/capture_scheduler.h"
 
+#include <algorithm>
+
 namespace base {
 
-CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
-    : update_interval_(update_interval)
+namespace {
+
+// The interval never grows above this value, so the screen is updated at least once per second
+// even on very slow connections.
+const std::chrono::milliseconds kMaxInterval(1000);
+
+// If the slowest client has more messages in the queue, the capture rate is decreased.
+const uint32_t kMaxPendingMessages = 2;
+
+// Step by which the interval decreases when the send queue is empty.
+const std::chrono::milliseconds kIntervalStep(5);
+
+// Number of captures without changes after which the captures are slowed down. At the default
+// rate it is about a half of a second.
+const int kIdleCaptures = 12;
+
+// The maximum delay between the captures of an idle screen. It limits the latency of the first
+// change that is not caused by the input of the client.
+const std::chrono::milliseconds kMaxIdleInterval(250);
+
+} // namespace
+
+CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval, Mode mode)
+    : mode_(mode),
+      update_interval_(update_interval),
+      current_interval_(update_interval),
+      idle_interval_(std::chrono::milliseconds::zero())
 {
     // Nothing
 }
@@ -29,6 +56,11 @@ CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_inter
 void CaptureScheduler::setUpdateInterval(const std::chrono::milliseconds& update_interval)
 {
     update_interval_ = update_interval;
+
+    if (mode_ == Mode::FIXED)
+        current_interval_ = update_interval_;
+    else
+        current_interval_ = std::max(current_interval_, update_interval_);
 }
 
 std::chrono::milliseconds CaptureScheduler::updateInterval() const
@@ -36,6 +68,32 @@ std::chrono::milliseconds CaptureScheduler::updateInterval() const
     return update_interval_;
 }
 
+std::chrono::milliseconds CaptureScheduler::currentInterval() const
+{
+    return current_interval_;
+}
+
+void CaptureScheduler::setPendingMessages(uint32_t pending_messages)
+{
+    pending_messages_ = pending_messages;
+}
+
+void CaptureScheduler::setScreenChanged(bool changed)
+{
+    screen_changed_ = changed;
+}
+
+bool CaptureScheduler::isIdle() const
+{
+    return idle_interval_ != std::chrono::milliseconds::zero();
+}
+
+void CaptureScheduler::resetIdle()
+{
+    unchanged_captures_ = 0;
+    idle_interval_ = std::chrono::milliseconds::zero();
+}
+
 void CaptureScheduler::beginCapture()
 {
     begin_time_ = std::chrono::high_resolution_clock::now();
@@ -44,17 +102,69 @@ void CaptureScheduler::beginCapture()
 void CaptureScheduler::endCapture()
 {
     end_time_ = std::chrono::high_resolution_clock::now();
+
+    if (mode_ == Mode::ADAPTIVE)
+        updateCurrentInterval();
+
+    updateIdleInterval();
 }
 
 std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
 {
+    const std::chrono::milliseconds interval = std::max(current_interval_, idle_interval_);
+
     std::chrono::milliseconds diff_time =
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+    if (diff_time > interval)
+        diff_time = interval;
+
+    return interval - diff_time;
+}
+
+void CaptureScheduler::updateCurrentInterval()
+{
+    const std::chrono::milliseconds max_interval = std::max(update_interval_, kMaxInterval);
+
+    if (pending_messages_ > kMaxPendingMessages)
+    {
+        // The frames are produced faster than the network (or the client) can take them. Each
+        // frame in the queue adds latency, so the rate quickly goes down.
+        current_interval_ = std::min(current_interval_ * 3 / 2, max_interval);
+    }
+    else if (pending_messages_ == 0)
+    {
+        // The queue is empty. Slowly return to the maximum rate.
+        current_interval_ = std::max(current_interval_ - kIntervalStep, update_interval_);
+    }
+
+    // It makes no sense to capture more often than the frame can be captured and encoded.
+    const std::chrono::milliseconds busy_time =
+        std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
+
+    current_interval_ = std::clamp(std::max(current_interval_, busy_time),
+                                   update_interval_, max_interval);
+}
+
+void CaptureScheduler::updateIdleInterval()
+{
+    const bool changed = screen_changed_;
+    screen_changed_ = true;
+
+    if (changed)
+    {
+        resetIdle();
+        return;
+    }
+
+    if (++unchanged_captures_ < kIdleCaptures)
+        return;
+
+    // The delay grows quickly, so there are only a few captures until it reaches the maximum.
+    const std::chrono::milliseconds max_interval = std::max(update_interval_, kMaxIdleInterval);
+    const std::chrono::milliseconds interval = std::max(current_interval_, idle_interval_);
 
-    return update_interval_ - diff_time;
+    idle_interval_ = std::min(interval * 2, max_interval);
 }
 
 } // namespace base
@@ -22,24 +22,71 @@
 #include "base/macros_magic.h"
 
 #include <chrono>
+#include <cstdint>
 
 namespace base {
 
+// Calculates the delay before the next screen capture.
+// In the FIXED mode the screen is captured every |update_interval|. In the ADAPTIVE mode the
+// interval is changed depending on the feedback from the consumers of the frames: it grows when
+// the frames are queued faster than they are sent to the clients and decreases back to
+// |update_interval| (which is the maximum capture rate) when the queue is empty.
+// In both modes the captures are slowed down while the screen does not change: after a number of
+// captures without changes the delay grows up to a bounded maximum, so an idle session costs almost
+// no CPU. The first change or resetIdle() returns to the normal rate.
 class CaptureScheduler
 {
 public:
-    explicit CaptureScheduler(const std::chrono::milliseconds& update_interval);
+    enum class Mode { FIXED, ADAPTIVE };
+
+    explicit CaptureScheduler(const std::chrono::milliseconds& update_interval,
+                              Mode mode = Mode::FIXED);
     ~CaptureScheduler() = default;
 
     void setUpdateInterval(const std::chrono::milliseconds& update_interval);
     std::chrono::milliseconds updateInterval() const;
 
+    Mode mode() const { return mode_; }
+
+    // Returns the current interval between captures. In the FIXED mode it is always equal to
+    // updateInterval().
+    std::chrono::milliseconds currentInterval() const;
+
+    // Sets the number of messages that are waiting to be sent to the slowest client. It must be
+    // called before endCapture() for each frame.
+    void setPendingMessages(uint32_t pending_messages);
+
+    // Sets whether the last capture has found changes of the screen or of the cursor. It must be
+    // called before endCapture(). If it is not called, the capture is considered changed.
+    void setScreenChanged(bool changed);
+
+    // Returns true if the captures are slowed down because the screen does not change.
+    bool isIdle() const;
+
+    // Returns to the normal capture rate (e.g. when the user input arrives, since it is likely to
+    // change the screen).
+    void resetIdle();
+
     void beginCapture();
+
+    // The time between beginCapture() and endCapture() includes the capture, the transfer of the
+    // frame to the encoders and the wait until they can take the next frame.
     void endCapture();
     std::chrono::milliseconds nextCaptureDelay() const;
 
 private:
+    void updateCurrentInterval();
+    void updateIdleInterval();
+
+    const Mode mode_;
     std::chrono::milliseconds update_interval_;
+    std::chrono::milliseconds current_interval_;
+    uint32_t pending_messages_ = 0;
+
+    bool screen_changed_ = true;
+    int unchanged_captures_ = 0;
+    std::chrono::milliseconds idle_interval_;
+
     std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
     std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
 
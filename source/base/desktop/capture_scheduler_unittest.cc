@@ -0,0 +1,144 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/capture_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Milliseconds = std::chrono::milliseconds;
+
+void captureFrame(CaptureScheduler* scheduler, uint32_t pending_messages)
+{
+    scheduler->beginCapture();
+    scheduler->setPendingMessages(pending_messages);
+    scheduler->endCapture();
+}
+
+void captureUnchangedFrame(CaptureScheduler* scheduler)
+{
+    scheduler->beginCapture();
+    scheduler->setPendingMessages(0);
+    scheduler->setScreenChanged(false);
+    scheduler->endCapture();
+}
+
+} // namespace
+
+TEST(capture_scheduler_test, fixed_mode)
+{
+    CaptureScheduler scheduler(Milliseconds(40));
+
+    captureFrame(&scheduler, 100);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(40));
+    EXPECT_LE(scheduler.nextCaptureDelay(), Milliseconds(40));
+
+    scheduler.setUpdateInterval(Milliseconds(100));
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(100));
+}
+
+TEST(capture_scheduler_test, adaptive_slow_client)
+{
+    CaptureScheduler scheduler(Milliseconds(40), CaptureScheduler::Mode::ADAPTIVE);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(40));
+
+    captureFrame(&scheduler, 10);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(60));
+
+    captureFrame(&scheduler, 10);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(90));
+
+    // A small queue does not change the rate.
+    captureFrame(&scheduler, 1);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(90));
+
+    for (int i = 0; i < 100; ++i)
+        captureFrame(&scheduler, 1000);
+
+    // The interval is limited.
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(1000));
+}
+
+TEST(capture_scheduler_test, adaptive_recovery)
+{
+    CaptureScheduler scheduler(Milliseconds(40), CaptureScheduler::Mode::ADAPTIVE);
+
+    captureFrame(&scheduler, 10);
+    captureFrame(&scheduler, 10);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(90));
+
+    captureFrame(&scheduler, 0);
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(85));
+
+    for (int i = 0; i < 100; ++i)
+        captureFrame(&scheduler, 0);
+
+    // The rate never exceeds the configured maximum.
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(40));
+}
+
+TEST(capture_scheduler_test, idle_screen)
+{
+    CaptureScheduler scheduler(Milliseconds(40), CaptureScheduler::Mode::ADAPTIVE);
+
+    // A few captures without changes do not change the rate.
+    for (int i = 0; i < 5; ++i)
+        captureUnchangedFrame(&scheduler);
+
+    EXPECT_FALSE(scheduler.isIdle());
+    EXPECT_LE(scheduler.nextCaptureDelay(), Milliseconds(40));
+
+    for (int i = 0; i < 100; ++i)
+        captureUnchangedFrame(&scheduler);
+
+    // The delay is limited.
+    EXPECT_TRUE(scheduler.isIdle());
+    EXPECT_GT(scheduler.nextCaptureDelay(), Milliseconds(200));
+    EXPECT_LE(scheduler.nextCaptureDelay(), Milliseconds(250));
+
+    // The congestion interval is not affected.
+    EXPECT_EQ(scheduler.currentInterval(), Milliseconds(40));
+
+    // The first change returns to the normal rate.
+    captureFrame(&scheduler, 0);
+    EXPECT_FALSE(scheduler.isIdle());
+    EXPECT_LE(scheduler.nextCaptureDelay(), Milliseconds(40));
+}
+
+TEST(capture_scheduler_test, idle_reset)
+{
+    CaptureScheduler scheduler(Milliseconds(40));
+
+    for (int i = 0; i < 100; ++i)
+        captureUnchangedFrame(&scheduler);
+
+    EXPECT_TRUE(scheduler.isIdle());
+
+    scheduler.resetIdle();
+    EXPECT_FALSE(scheduler.isIdle());
+    EXPECT_LE(scheduler.nextCaptureDelay(), Milliseconds(40));
+
+    // The counter starts over.
+    captureUnchangedFrame(&scheduler);
+    EXPECT_FALSE(scheduler.isIdle());
+}
+
+} // namespace base
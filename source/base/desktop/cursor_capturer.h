@@ -22,6 +22,7 @@
 namespace base {
 
 class MouseCursor;
+class Point;
 
 class CursorCapturer
 {
@@ -29,6 +30,10 @@ public:
     virtual ~CursorCapturer() = default;
 
     virtual const MouseCursor* captureCursor() = 0;
+
+    // Gets the position of the cursor hotspot in the coordinates of the virtual screen. It is
+    // cheaper than captureCursor() and may be called more often.
+    virtual bool cursorPosition(Point* position) = 0;
     virtual void reset() = 0;
 };
 
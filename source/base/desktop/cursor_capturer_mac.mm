@@ -32,6 +32,12 @@ const MouseCursor* CursorCapturerMac::captureCursor()
     return nullptr;
 }
 
+bool CursorCapturerMac::cursorPosition(Point* /* position */)
+{
+    NOTIMPLEMENTED();
+    return false;
+}
+
 void CursorCapturerMac::reset()
 {
     NOTIMPLEMENTED();
@@ -18,6 +18,7 @@
 
 #include "base/desktop/cursor_capturer_win.h"
 
+#include "base/logging.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/win/cursor.h"
 
@@ -74,6 +75,18 @@ const MouseCursor* CursorCapturerWin::captureCursor()
     return nullptr;
 }
 
+bool CursorCapturerWin::cursorPosition(Point* position)
+{
+    DCHECK(position);
+
+    POINT point;
+    if (!GetCursorPos(&point))
+        return false;
+
+    *position = Point(point.x, point.y);
+    return true;
+}
+
 void CursorCapturerWin::reset()
 {
     desktop_dc_.close();
@@ -33,6 +33,7 @@ public:
     ~CursorCapturerWin();
 
     const MouseCursor* captureCursor() override;
+    bool cursorPosition(Point* position) override;
     void reset() override;
 
 private:
@@ -32,6 +32,12 @@ const MouseCursor* CursorCapturerX11::captureCursor()
     return nullptr;
 }
 
+bool CursorCapturerX11::cursorPosition(Point* /* position */)
+{
+    NOTIMPLEMENTED();
+    return false;
+}
+
 void CursorCapturerX11::reset()
 {
     NOTIMPLEMENTED();
@@ -31,6 +31,7 @@ public:
     ~CursorCapturerX11();
 
     const MouseCursor* captureCursor() override;
+    bool cursorPosition(Point* position) override;
     void reset() override;
 
 private:
@@ -19,24 +19,41 @@
 #include "base/desktop/differ.h"
 
 #include "base/logging.h"
-#include "base/desktop/diff_block_32bpp_sse2.h"
+#include "base/trace_event.h"
+#include "base/desktop/diff_block_32bpp_avx2.h"
 #include "base/desktop/diff_block_32bpp_c.h"
+#include "base/desktop/diff_block_32bpp_neon.h"
+#include "base/desktop/diff_block_32bpp_sse2.h"
+#include "base/threading/stripe_workers.h"
 
+#include <algorithm>
 #include <cstring>
+#include <thread>
+
 #include <libyuv/cpu_id.h>
 
 namespace base {
 
 namespace {
 
-const int kBlockSize = 16;
+using DiffBlockFunc = uint8_t(*)(const uint8_t*, const uint8_t*, int);
+
 const int kBytesPerPixel = 4;
-const int kBytesPerBlock = kBlockSize * kBytesPerPixel;
+
+// The large screens are compared in larger blocks. The blocks are found faster and there are fewer
+// of them to merge into the region. The smaller screens keep the more precise small blocks.
+const int64_t kMinPixelsForBlock32 = 3840 * 2160;
+const int64_t kMinPixelsForBlock64 = 7680 * 4320;
+
+// Minimum number of pixels per thread. Smaller screens are compared faster than the threads can
+// be woken up.
+const int kMinPixelsPerThread = 1920 * 1080 * 2;
+const int kMaxThreadCount = 4;
 
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and height are multiples
-// of kBlockSize, then this will never be called.
+// of the block size, then this will never be called.
 uint8_t diffPartialBlock(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          int bytes_per_row,
@@ -55,19 +72,70 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
+// A block of 64x64 pixels is compared as four blocks of 32x32 pixels with the kernel |kDiffBlock|.
+template <DiffBlockFunc kDiffBlock>
+uint8_t diffFullBlock64x64(const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    const int kHalfWidth = 32 * kBytesPerPixel;
+    const int half_height = 32 * bytes_per_row;
+
+    if (kDiffBlock(image1, image2, bytes_per_row) ||
+        kDiffBlock(image1 + kHalfWidth, image2 + kHalfWidth, bytes_per_row) ||
+        kDiffBlock(image1 + half_height, image2 + half_height, bytes_per_row) ||
+        kDiffBlock(image1 + half_height + kHalfWidth, image2 + half_height + kHalfWidth,
+                   bytes_per_row))
+    {
+        return 1U;
+    }
+
+    return 0U;
+}
 
+template <DiffBlockFunc kDiffBlock16, DiffBlockFunc kDiffBlock32>
+DiffBlockFunc selectDiffFunction(int block_size)
+{
+    switch (block_size)
+    {
+        case 16:
+            return kDiffBlock16;
+
+        case 32:
+            return kDiffBlock32;
+
+        case 64:
+            return diffFullBlock64x64<kDiffBlock32>;
+
+        default:
+            return nullptr;
+    }
+}
 
 } // namespace
 
 Differ::Differ(const Size& size)
-    : screen_rect_(Rect::makeSize(size)),
+    : Differ(size, defaultThreadCount(size))
+{
+    // Nothing
+}
+
+Differ::Differ(const Size& size, int thread_count)
+    : Differ(size, thread_count, defaultBlockSize(size))
+{
+    // Nothing
+}
+
+Differ::Differ(const Size& size, int thread_count, int block_size)
+    : block_size_(block_size),
+      bytes_per_block_(block_size * kBytesPerPixel),
+      screen_rect_(Rect::makeSize(size)),
       bytes_per_row_(size.width() * kBytesPerPixel),
-      diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
-      diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
-      full_blocks_x_(size.width() / kBlockSize),
-      full_blocks_y_(size.height() / kBlockSize)
+      diff_width_(((size.width() + block_size - 1) / block_size) + 1),
+      diff_height_(((size.height() + block_size - 1) / block_size) + 1),
+      full_blocks_x_(size.width() / block_size),
+      full_blocks_y_(size.height() / block_size)
 {
     DLOG(LS_INFO) << "Screen size: " << size;
+    DLOG(LS_INFO) << "Block size: " << block_size_;
     DLOG(LS_INFO) << "Bytes per row: " << bytes_per_row_;
     DLOG(LS_INFO) << "Diff size: " << diff_width_ << "x" << diff_height_;
     DLOG(LS_INFO) << "Full blocks: " << full_blocks_x_ << "x" << full_blocks_y_;
@@ -78,60 +146,144 @@ Differ::Differ(const Size& size)
     memset(diff_info_.get(), 0, diff_info_size);
 
     // Calc size of partial blocks which may be present on right and bottom edge.
-    partial_column_width_ = size.width() - (full_blocks_x_ * kBlockSize);
-    partial_row_height_ = size.height() - (full_blocks_y_ * kBlockSize);
+    partial_column_width_ = size.width() - (full_blocks_x_ * block_size_);
+    partial_row_height_ = size.height() - (full_blocks_y_ * block_size_);
 
     DLOG(LS_INFO) << "Partial column: " << partial_column_width_;
     DLOG(LS_INFO) << "Partial row: " << partial_row_height_;
 
     // Offset from the start of one block-row to the next.
-    block_stride_y_ = bytes_per_row_ * kBlockSize;
+    block_stride_y_ = bytes_per_row_ * block_size_;
 
     DLOG(LS_INFO) << "Block stride: " << block_stride_y_;
 
-    diff_full_block_func_ = diffFunction();
-    CHECK(diff_full_block_func_);
+    diff_full_block_func_ = diffFunction(block_size_);
+    CHECK(diff_full_block_func_) << "Unsupported block size: " << block_size_;
+
+    // There is no need for more stripes than rows of blocks.
+    thread_count = std::min(thread_count, diff_height_ - 1);
+    if (thread_count > 1)
+    {
+        DLOG(LS_INFO) << "Differ threads: " << thread_count;
+        workers_ = std::make_unique<StripeWorkers>(thread_count - 1);
+    }
+}
+
+Differ::~Differ() = default;
+
+int Differ::threadCount() const
+{
+    return workers_ ? workers_->stripeCount() : 1;
+}
+
+// static
+int Differ::defaultBlockSize(const Size& size)
+{
+    const int64_t pixels = static_cast<int64_t>(size.width()) * size.height();
+
+    if (pixels >= kMinPixelsForBlock64)
+        return 64;
+
+    if (pixels >= kMinPixelsForBlock32)
+        return 32;
+
+    return 16;
 }
 
 // static
-Differ::DiffFullBlockFunc Differ::diffFunction()
+bool Differ::isSupportedBlockSize(int block_size)
 {
+    return block_size == 16 || block_size == 32 || block_size == 64;
+}
+
+// static
+Differ::DiffFullBlockFunc Differ::diffFunction(int block_size)
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 differ loaded";
+        return selectDiffFunction<diffFullBlock_32bpp_16x16_AVX2,
+                                  diffFullBlock_32bpp_32x32_AVX2>(block_size);
+    }
+
     if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
     {
-#if defined(ARCH_CPU_X86_FAMILY)
         LOG(LS_INFO) << "SSE2 differ loaded";
-
-        if constexpr (kBlockSize == 16)
-            return diffFullBlock_32bpp_16x16_SSE2;
-        else if constexpr (kBlockSize == 32)
-            return diffFullBlock_32bpp_32x32_SSE2;
-#endif // defined(ARCH_CPU_X86_FAMILY)
+        return selectDiffFunction<diffFullBlock_32bpp_16x16_SSE2,
+                                  diffFullBlock_32bpp_32x32_SSE2>(block_size);
     }
-    else
+#elif defined(ARCH_CPU_ARM_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
     {
-        LOG(LS_INFO) << "C differ loaded";
-
-        if constexpr (kBlockSize == 16)
-            return diffFullBlock_32bpp_16x16_C;
-        else if constexpr (kBlockSize == 32)
-            return diffFullBlock_32bpp_32x32_C;
+        LOG(LS_INFO) << "NEON differ loaded";
+        return selectDiffFunction<diffFullBlock_32bpp_16x16_NEON,
+                                  diffFullBlock_32bpp_32x32_NEON>(block_size);
     }
+#endif // defined(ARCH_CPU_*)
 
-    return nullptr;
+    LOG(LS_INFO) << "C differ loaded";
+    return selectDiffFunction<diffFullBlock_32bpp_16x16_C,
+                              diffFullBlock_32bpp_32x32_C>(block_size);
+}
+
+// static
+int Differ::defaultThreadCount(const Size& size)
+{
+    const int64_t pixels = static_cast<int64_t>(size.width()) * size.height();
+    const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+
+    int thread_count = static_cast<int>(pixels / kMinPixelsPerThread);
+    thread_count = std::min(thread_count, (cpu_count + 1) / 2);
+    thread_count = std::min(thread_count, kMaxThreadCount);
+
+    return std::max(thread_count, 1);
+}
+
+uint8_t Differ::diffBlock(const uint8_t* prev_image,
+                          const uint8_t* curr_image,
+                          int x,
+                          int y) const
+{
+    const int offset = y * block_stride_y_ + x * bytes_per_block_;
+
+    const bool partial_column = (x == full_blocks_x_);
+    const bool partial_row = (y == full_blocks_y_);
+
+    if (!partial_column && !partial_row)
+        return diff_full_block_func_(prev_image + offset, curr_image + offset, bytes_per_row_);
+
+    const int bytes_per_block =
+        partial_column ? partial_column_width_ * kBytesPerPixel : bytes_per_block_;
+    const int height = partial_row ? partial_row_height_ : block_size_;
+
+    return diffPartialBlock(prev_image + offset, curr_image + offset, bytes_per_row_,
+                            bytes_per_block, height);
 }
 
 // Identify all of the blocks that contain changed pixels.
 void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    runForAllRows([&](int first_row, int last_row)
+    {
+        markDirtyRows(prev_image, curr_image, first_row, last_row);
+    });
+}
 
+void Differ::markDirtyRows(const uint8_t* prev_image,
+                           const uint8_t* curr_image,
+                           int first_row,
+                           int last_row)
+{
     // Offset from the start of one diff_info row to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    const uint8_t* prev_block_row_start = prev_image + first_row * block_stride_y_;
+    const uint8_t* curr_block_row_start = curr_image + first_row * block_stride_y_;
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    uint8_t* is_diff_row_start = diff_info_.get() + first_row * diff_stride;
+
+    for (int y = first_row; y < std::min(last_row, full_blocks_y_); ++y)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -143,8 +295,8 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
             // Mark this block as being modified so that it gets incorporated into a dirty rect.
             *is_different = diff_full_block_func_(prev_block, curr_block, bytes_per_row_);
 
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
+            prev_block += bytes_per_block_;
+            curr_block += bytes_per_block_;
 
             ++is_different;
         }
@@ -157,7 +309,7 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
                                              curr_block,
                                              bytes_per_row_,
                                              partial_column_width_ * kBytesPerPixel,
-                                             kBlockSize);
+                                             block_size_);
         }
 
         // Update pointers for next row.
@@ -169,7 +321,7 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 
     // If the screen height is not a multiple of the block size, then this handles the last partial
     // row. This situation is far more common than the 'partial column' case.
-    if (partial_row_height_ != 0)
+    if (partial_row_height_ != 0 && last_row > full_blocks_y_)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -181,11 +333,11 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
             *is_different = diffPartialBlock(prev_block,
                                              curr_block,
                                              bytes_per_row_,
-                                             kBytesPerBlock,
+                                             bytes_per_block_,
                                              partial_row_height_);
 
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
+            prev_block += bytes_per_block_;
+            curr_block += bytes_per_block_;
             ++is_different;
         }
 
@@ -201,10 +353,78 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
     }
 }
 
+void Differ::markDirtyBlocks(const uint8_t* prev_image,
+                             const uint8_t* curr_image,
+                             const Region& hint_region)
+{
+    // The last column and row of |diff_info_| are boundary blocks and are never marked.
+    const int blocks_x = diff_width_ - 1;
+    const int blocks_y = diff_height_ - 1;
+
+    // First mark all the blocks covered by the hint. At this point |diff_info_| is cleared by the
+    // previous call of mergeBlocks().
+    for (Region::Iterator it(hint_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+        rect.intersectWith(screen_rect_);
+        if (rect.isEmpty())
+            continue;
+
+        const int left = rect.left() / block_size_;
+        const int top = rect.top() / block_size_;
+        const int right = std::min((rect.right() + block_size_ - 1) / block_size_, blocks_x);
+        const int bottom = std::min((rect.bottom() + block_size_ - 1) / block_size_, blocks_y);
+
+        for (int y = top; y < bottom; ++y)
+            memset(diff_info_.get() + y * diff_width_ + left, 1, right - left);
+    }
+
+    // Now compare only the marked blocks.
+    runForAllRows([&](int first_row, int last_row)
+    {
+        markDirtyRowsInHint(prev_image, curr_image, first_row, last_row);
+    });
+}
+
+void Differ::markDirtyRowsInHint(const uint8_t* prev_image,
+                                 const uint8_t* curr_image,
+                                 int first_row,
+                                 int last_row)
+{
+    // The last column of |diff_info_| contains boundary blocks.
+    const int blocks_x = diff_width_ - 1;
+
+    for (int y = first_row; y < last_row; ++y)
+    {
+        uint8_t* is_different = diff_info_.get() + y * diff_width_;
+
+        for (int x = 0; x < blocks_x; ++x)
+        {
+            if (is_different[x])
+                is_different[x] = diffBlock(prev_image, curr_image, x, y);
+        }
+    }
+}
+
+void Differ::runForAllRows(const RowsTask& task)
+{
+    // The last row of |diff_info_| contains boundary blocks.
+    const int row_count = diff_height_ - 1;
+
+    // Each stripe writes only its own rows of |diff_info_|, so the stripes do not need any
+    // synchronization. The rows are merged into the region after all stripes are completed.
+    if (workers_)
+        workers_->run(row_count, task);
+    else
+        task(0, row_count);
+}
+
 // After the dirty blocks have been identified, this routine merges adjacent blocks into a region.
 // The goal is to minimize the region that covers the dirty blocks.
 void Differ::mergeBlocks(Region* dirty_region)
 {
+    dirty_rects_.clear();
+
     uint8_t* is_diff_row_start = diff_info_.get();
     const int diff_stride = diff_width_;
 
@@ -266,13 +486,11 @@ void Differ::mergeBlocks(Region* dirty_region)
                     }
                 } while (found_new_row);
 
-                Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
-                                                 width * kBlockSize, height * kBlockSize);
+                Rect dirty_rect = Rect::makeXYWH(x * block_size_, y * block_size_,
+                                                 width * block_size_, height * block_size_);
 
                 dirty_rect.intersectWith(screen_rect_);
-
-                // Add rect to region.
-                dirty_region->addRect(dirty_rect);
+                dirty_rects_.emplace_back(dirty_rect);
             }
 
             // Increment to next block in this row.
@@ -282,12 +500,17 @@ void Differ::mergeBlocks(Region* dirty_region)
         // Go to start of next row.
         is_diff_row_start += diff_stride;
     }
+
+    // The rectangles are added at once, so the bands of the region are built in a single pass.
+    dirty_region->addRects(dirty_rects_.data(), static_cast<int>(dirty_rects_.size()));
 }
 
 void Differ::calcDirtyRegion(const uint8_t* prev_image,
                              const uint8_t* curr_image,
                              Region* dirty_region)
 {
+    TRACE_EVENT("capture", "Differ::calcDirtyRegion");
+
     dirty_region->clear();
 
     // Identify all the blocks that contain changed pixels.
@@ -298,4 +521,19 @@ void Differ::calcDirtyRegion(const uint8_t* prev_image,
     mergeBlocks(dirty_region);
 }
 
+void Differ::calcDirtyRegion(const uint8_t* prev_image,
+                             const uint8_t* curr_image,
+                             const Region& hint_region,
+                             Region* dirty_region)
+{
+    TRACE_EVENT("capture", "Differ::calcDirtyRegion");
+
+    dirty_region->clear();
+
+    // Identify the blocks inside the hint that contain changed pixels.
+    markDirtyBlocks(prev_image, curr_image, hint_region);
+
+    mergeBlocks(dirty_region);
+}
+
 } // namespace base
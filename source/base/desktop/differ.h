@@ -22,29 +22,83 @@
 #include "base/macros_magic.h"
 #include "base/desktop/region.h"
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace base {
 
+class StripeWorkers;
+
 // Class to search for changed regions of the screen.
+// The screen is compared in square blocks. The size of the blocks is selected depending on the
+// screen size: 16 pixels for the usual screens, 32 for 4K and 64 for 8K.
+// For large screens the rows of blocks are split into stripes which are compared in parallel on a
+// small pool of worker threads. The result does not depend on the number of threads.
 class Differ
 {
 public:
+    // The number of threads and the block size are selected depending on the screen size.
     explicit Differ(const Size& size);
-    ~Differ() = default;
 
+    // |thread_count| is the total number of threads used to compare the blocks, including the
+    // calling thread. If it is 1, no worker threads are created.
+    Differ(const Size& size, int thread_count);
+
+    // |block_size| must be supported (see isSupportedBlockSize()).
+    Differ(const Size& size, int thread_count, int block_size);
+    ~Differ();
+
+    static int defaultBlockSize(const Size& size);
+    static bool isSupportedBlockSize(int block_size);
+
+    int threadCount() const;
+    int blockSize() const { return block_size_; }
+
+    void calcDirtyRegion(const uint8_t* prev_image,
+                         const uint8_t* curr_image,
+                         Region* changed_region);
+
+    // Same as above, but only the blocks that intersect |hint_region| are compared. Everything
+    // outside of |hint_region| is considered unchanged. The capturers that receive the changed
+    // areas from the OS (for example, DXGI dirty and move rects) use it to drop the blocks that
+    // were reported but whose pixels are the same.
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
+                         const Region& hint_region,
                          Region* changed_region);
 
 private:
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
+    using RowsTask = std::function<void(int first_row, int last_row)>;
 
-    static DiffFullBlockFunc diffFunction();
+    static DiffFullBlockFunc diffFunction(int block_size);
+    static int defaultThreadCount(const Size& size);
 
+    uint8_t diffBlock(const uint8_t* prev_image, const uint8_t* curr_image, int x, int y) const;
     void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
+    void markDirtyBlocks(const uint8_t* prev_image,
+                         const uint8_t* curr_image,
+                         const Region& hint_region);
+
+    // Compares the blocks in the block rows [first_row, last_row).
+    void markDirtyRows(const uint8_t* prev_image,
+                       const uint8_t* curr_image,
+                       int first_row,
+                       int last_row);
+
+    // Compares the blocks in the block rows [first_row, last_row) that are already marked.
+    void markDirtyRowsInHint(const uint8_t* prev_image,
+                             const uint8_t* curr_image,
+                             int first_row,
+                             int last_row);
+
+    // Runs |task| for all rows of blocks, split into stripes between the threads.
+    void runForAllRows(const RowsTask& task);
     void mergeBlocks(Region* dirty_region);
 
+    const int block_size_;
+    const int bytes_per_block_;
     const Rect screen_rect_;
     const int bytes_per_row_;
     const int diff_width_;
@@ -57,8 +111,11 @@ private:
     int block_stride_y_;
 
     std::unique_ptr<uint8_t[]> diff_info_;
+    std::vector<Rect> dirty_rects_;
     DiffFullBlockFunc diff_full_block_func_;
 
+    std::unique_ptr<StripeWorkers> workers_;
+
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
 
@@ -0,0 +1,242 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/differ.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+
+class DifferTest : public testing::Test
+{
+protected:
+    void init(const Size& size, int thread_count = 1, int block_size = 0)
+    {
+        size_ = size;
+        bytes_per_row_ = size.width() * kBytesPerPixel;
+
+        prev_.assign(bytes_per_row_ * size.height(), 0);
+        curr_.assign(bytes_per_row_ * size.height(), 0);
+
+        if (!block_size)
+            block_size = Differ::defaultBlockSize(size);
+
+        differ_ = std::make_unique<Differ>(size, thread_count, block_size);
+    }
+
+    void writePixel(int x, int y, uint8_t value)
+    {
+        curr_[y * bytes_per_row_ + x * kBytesPerPixel] = value;
+    }
+
+    Region calcFull()
+    {
+        Region region;
+        differ_->calcDirtyRegion(prev_.data(), curr_.data(), &region);
+        return region;
+    }
+
+    Region calcWithHint(const Region& hint)
+    {
+        Region region;
+        differ_->calcDirtyRegion(prev_.data(), curr_.data(), hint, &region);
+        return region;
+    }
+
+    Size size_;
+    int bytes_per_row_ = 0;
+    std::vector<uint8_t> prev_;
+    std::vector<uint8_t> curr_;
+    std::unique_ptr<Differ> differ_;
+};
+
+} // namespace
+
+TEST_F(DifferTest, same_images)
+{
+    init(Size(96, 64));
+
+    EXPECT_TRUE(calcFull().isEmpty());
+    EXPECT_TRUE(calcWithHint(Region(Rect::makeWH(96, 64))).isEmpty());
+}
+
+TEST_F(DifferTest, single_pixel)
+{
+    init(Size(96, 64));
+    writePixel(20, 40, 0xFF);
+
+    Region expected(Rect::makeXYWH(16, 32, 16, 16));
+
+    EXPECT_TRUE(calcFull().equals(expected));
+    EXPECT_TRUE(calcWithHint(Region(Rect::makeWH(96, 64))).equals(expected));
+    EXPECT_TRUE(calcWithHint(Region(Rect::makeXYWH(20, 40, 1, 1))).equals(expected));
+}
+
+TEST_F(DifferTest, change_outside_hint)
+{
+    init(Size(96, 64));
+    writePixel(5, 5, 0xFF);
+    writePixel(80, 50, 0xFF);
+
+    Region result = calcWithHint(Region(Rect::makeXYWH(64, 48, 32, 16)));
+    EXPECT_TRUE(result.equals(Region(Rect::makeXYWH(80, 48, 16, 16))));
+}
+
+TEST_F(DifferTest, empty_hint)
+{
+    init(Size(96, 64));
+    writePixel(5, 5, 0xFF);
+
+    EXPECT_TRUE(calcWithHint(Region()).isEmpty());
+}
+
+TEST_F(DifferTest, hint_matches_full_with_partial_blocks)
+{
+    // The size is not a multiple of the block size.
+    init(Size(101, 75));
+
+    writePixel(0, 0, 1);
+    writePixel(100, 10, 1);
+    writePixel(50, 74, 1);
+    writePixel(100, 74, 1);
+    writePixel(33, 33, 1);
+
+    Region hint;
+    hint.addRect(Rect::makeXYWH(0, 0, 40, 40));
+    hint.addRect(Rect::makeXYWH(90, 0, 11, 75));
+    hint.addRect(Rect::makeXYWH(0, 70, 101, 5));
+
+    Region full = calcFull();
+    Region with_hint = calcWithHint(hint);
+
+    EXPECT_FALSE(full.isEmpty());
+    EXPECT_TRUE(full.equals(with_hint));
+
+    // The region is clipped to the screen.
+    full.intersectWith(Rect::makeWH(101, 75));
+    EXPECT_TRUE(full.equals(with_hint));
+}
+
+TEST_F(DifferTest, repeated_calls)
+{
+    init(Size(64, 64));
+    writePixel(10, 10, 1);
+
+    Region hint(Rect::makeWH(64, 64));
+    Region expected(Rect::makeXYWH(0, 0, 16, 16));
+
+    // The block map must be cleared between the calls.
+    EXPECT_TRUE(calcWithHint(hint).equals(expected));
+    EXPECT_TRUE(calcFull().equals(expected));
+    EXPECT_TRUE(calcWithHint(Region(Rect::makeXYWH(48, 48, 16, 16))).isEmpty());
+}
+
+TEST_F(DifferTest, threads_match_single_thread)
+{
+    const Size kSize(1283, 1031);
+
+    std::mt19937 random(42);
+
+    for (int thread_count = 2; thread_count <= 5; ++thread_count)
+    {
+        init(kSize, 1);
+        std::unique_ptr<Differ> threaded_differ = std::make_unique<Differ>(kSize, thread_count);
+        EXPECT_EQ(threaded_differ->threadCount(), thread_count);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 200; ++j)
+            {
+                writePixel(random() % kSize.width(), random() % kSize.height(),
+                           static_cast<uint8_t>(random() | 1));
+            }
+
+            Region single;
+            differ_->calcDirtyRegion(prev_.data(), curr_.data(), &single);
+
+            Region threaded;
+            threaded_differ->calcDirtyRegion(prev_.data(), curr_.data(), &threaded);
+
+            EXPECT_FALSE(single.isEmpty());
+            EXPECT_TRUE(single.equals(threaded));
+
+            Region hint;
+            hint.addRect(Rect::makeXYWH(0, 0, 600, 1031));
+            hint.addRect(Rect::makeXYWH(900, 500, 383, 531));
+
+            differ_->calcDirtyRegion(prev_.data(), curr_.data(), hint, &single);
+            threaded_differ->calcDirtyRegion(prev_.data(), curr_.data(), hint, &threaded);
+
+            EXPECT_TRUE(single.equals(threaded));
+
+            prev_ = curr_;
+        }
+    }
+}
+
+TEST_F(DifferTest, thread_count_limited_by_rows)
+{
+    Differ differ(Size(64, 20), 8);
+    EXPECT_EQ(differ.threadCount(), 2);
+}
+
+TEST_F(DifferTest, default_block_size)
+{
+    EXPECT_EQ(Differ::defaultBlockSize(Size(1920, 1080)), 16);
+    EXPECT_EQ(Differ::defaultBlockSize(Size(3840, 2160)), 32);
+    EXPECT_EQ(Differ::defaultBlockSize(Size(7680, 4320)), 64);
+
+    EXPECT_EQ(Differ(Size(96, 64), 1).blockSize(), 16);
+}
+
+TEST_F(DifferTest, large_blocks)
+{
+    for (int block_size : { 32, 64 })
+    {
+        init(Size(200, 150), 1, block_size);
+        EXPECT_EQ(differ_->blockSize(), block_size);
+
+        // Changes in the different quarters of the full block and in the partial blocks.
+        writePixel(block_size - 1, block_size - 1, 1);
+        writePixel(block_size + block_size / 2, 1, 1);
+        writePixel(199, 149, 1);
+
+        Region expected;
+        expected.addRect(Rect::makeXYWH(0, 0, block_size * 2, block_size));
+        expected.addRect(Rect::makeXYWH((200 / block_size) * block_size,
+                                        (150 / block_size) * block_size,
+                                        block_size, block_size));
+        expected.intersectWith(Rect::makeWH(200, 150));
+
+        Region full = calcFull();
+        full.intersectWith(Rect::makeWH(200, 150));
+
+        EXPECT_TRUE(full.equals(expected)) << block_size;
+        EXPECT_TRUE(calcWithHint(Region(Rect::makeWH(200, 150))).equals(expected)) << block_size;
+    }
+}
+
+} // namespace base
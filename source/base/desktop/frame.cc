@@ -19,11 +19,10 @@
 #include "base/desktop/frame.h"
 
 #include "base/logging.h"
+#include "base/desktop/pixel_copy.h"
 
 #include <cstring>
 
-#include <libyuv/convert_argb.h>
-
 namespace base {
 
 Frame::Frame(const Size& size,
@@ -46,9 +45,8 @@ bool Frame::contains(int x, int y) const
 
 void Frame::copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect)
 {
-    libyuv::ARGBCopy(src_buffer, src_stride,
-                     frameDataAtPos(dest_rect.topLeft()), stride(),
-                     dest_rect.width(), dest_rect.height());
+    copyPixels(src_buffer, src_stride, frameDataAtPos(dest_rect.topLeft()), stride(),
+               dest_rect.width() * kBytesPerPixel, dest_rect.height());
 }
 
 void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect)
@@ -56,6 +54,24 @@ void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const R
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+void Frame::movePixels(const Point& src_pos, const Rect& dest_rect)
+{
+    const size_t row_size = static_cast<size_t>(dest_rect.width()) * kBytesPerPixel;
+
+    // If the area moves down, the rows are moved from the bottom, so a source row is not
+    // overwritten before it is moved.
+    const bool bottom_up = src_pos.y() < dest_rect.y();
+
+    for (int i = 0; i < dest_rect.height(); ++i)
+    {
+        const int row = bottom_up ? dest_rect.height() - 1 - i : i;
+
+        memmove(frameDataAtPos(dest_rect.x(), dest_rect.y() + row),
+                frameDataAtPos(src_pos.x(), src_pos.y() + row),
+                row_size);
+    }
+}
+
 uint8_t* Frame::frameDataAtPos(const Point& pos) const
 {
     return frameDataAtPos(pos.x(), pos.y());
@@ -72,6 +88,12 @@ void Frame::copyFrameInfoFrom(const Frame& other)
     top_left_ = other.top_left_;
     dpi_ = other.dpi_;
     capturer_type_ = other.capturer_type_;
+    active_window_rect_ = other.active_window_rect_;
+    screen_rects_ = other.screen_rects_;
+    capture_time_ = other.capture_time_;
+    diff_time_ = other.diff_time_;
+    copy_rect_ = other.copy_rect_;
+    copy_source_ = other.copy_source_;
 }
 
 // static
@@ -22,6 +22,8 @@
 #include "base/macros_magic.h"
 #include "base/desktop/region.h"
 
+#include <vector>
+
 namespace base {
 
 class SharedMemoryBase;
@@ -43,9 +45,13 @@ public:
     int stride() const { return stride_; }
     bool contains(int x, int y) const;
 
+    // The full copies of the large screens do not pass through the caches (see copyPixels()).
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Moves the pixels of the area at |src_pos| of the frame to |dest_rect|. The areas may overlap.
+    void movePixels(const Point& src_pos, const Rect& dest_rect);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
@@ -58,6 +64,32 @@ public:
     void setCapturerType(uint32_t capturer_type) { capturer_type_ = capturer_type; }
     uint32_t capturerType() const { return capturer_type_; }
 
+    // Rectangle of the foreground window in the frame coordinates. Empty if it is unknown.
+    void setActiveWindowRect(const Rect& rect) { active_window_rect_ = rect; }
+    const Rect& activeWindowRect() const { return active_window_rect_; }
+
+    // Rectangles of the screens in the frame coordinates. Empty if the frame contains one screen.
+    void setScreenRects(const std::vector<Rect>& rects) { screen_rects_ = rects; }
+    const std::vector<Rect>& screenRects() const { return screen_rects_; }
+
+    // Time when the capture of the frame was started and time when its updated region became
+    // known (microseconds since the Unix epoch). Zero if it is unknown.
+    void setCaptureTime(int64_t capture_time) { capture_time_ = capture_time; }
+    int64_t captureTime() const { return capture_time_; }
+    void setDiffTime(int64_t diff_time) { diff_time_ = diff_time; }
+    int64_t diffTime() const { return diff_time_; }
+
+    // Area of the frame which has the same pixels as the area of the previous frame at |source|
+    // (e.g. after a scroll). The receiver may copy them instead of encoding them again. Empty if
+    // there is no such area.
+    void setCopyRect(const Rect& rect, const Point& source)
+    {
+        copy_rect_ = rect;
+        copy_source_ = source;
+    }
+    const Rect& copyRect() const { return copy_rect_; }
+    const Point& copySource() const { return copy_source_; }
+
     // Copies various information from |other|. Anything initialized in constructor are not copied.
     // This function is usually used when sharing a source Frame with several clients: the original
     // Frame should be kept unchanged. For example and SharedFrame::share().
@@ -84,6 +116,12 @@ private:
     Point top_left_;
     Point dpi_;
     uint32_t capturer_type_ = 0;
+    Rect active_window_rect_;
+    std::vector<Rect> screen_rects_;
+    int64_t capture_time_ = 0;
+    int64_t diff_time_ = 0;
+    Rect copy_rect_;
+    Point copy_source_;
 
     DISALLOW_COPY_AND_ASSIGN(Frame);
 };
@@ -30,14 +30,14 @@ FrameAligned::FrameAligned(const Size& size, uint8_t* data)
 
 FrameAligned::~FrameAligned()
 {
-    alignedFree(data_);
+    largeFree(data_, calcMemorySize(size(), kBytesPerPixel));
 }
 
 // static
 std::unique_ptr<FrameAligned> FrameAligned::create(const Size& size, size_t alignment)
 {
     uint8_t* data = reinterpret_cast<uint8_t*>(
-        alignedAlloc(calcMemorySize(size, kBytesPerPixel), alignment));
+        largeAlloc(calcMemorySize(size, kBytesPerPixel), alignment));
     if (!data)
         return nullptr;
 
@@ -28,7 +28,7 @@ namespace base {
 FrameDib::FrameDib(const Size& size,
                    int stride,
                    uint8_t* data,
-                   std::unique_ptr<SharedMemory> shared_memory,
+                   std::unique_ptr<SharedMemoryBase> shared_memory,
                    HBITMAP bitmap)
     : Frame(size, stride, data, shared_memory.get()),
       bitmap_(bitmap),
@@ -57,7 +57,7 @@ std::unique_ptr<FrameDib> FrameDib::create(const Size& size,
     bmi.u.mask.green = 255 << 8;
     bmi.u.mask.blue  = 255 << 0;
 
-    std::unique_ptr<SharedMemory> shared_memory;
+    std::unique_ptr<SharedMemoryBase> shared_memory;
     HANDLE section_handle = nullptr;
 
     if (shared_memory_factory)
@@ -0,0 +1,51 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__FRAME_IOSURFACE_H
+#define BASE__DESKTOP__FRAME_IOSURFACE_H
+
+#include "base/desktop/frame.h"
+
+#include <memory>
+
+#include <IOSurface/IOSurface.h>
+
+namespace base {
+
+// Frame that points directly into the memory of an IOSurface. The surface is retained and locked
+// for reading while the frame is alive, so no copy of the pixels is made.
+class FrameIOSurface : public Frame
+{
+public:
+    ~FrameIOSurface();
+
+    // Wraps |surface|. Returns nullptr if the surface has an unsupported pixel format or cannot be
+    // locked.
+    static std::unique_ptr<FrameIOSurface> wrap(IOSurfaceRef surface);
+
+private:
+    FrameIOSurface(IOSurfaceRef surface, const Size& size, int stride);
+
+    IOSurfaceRef surface_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameIOSurface);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__FRAME_IOSURFACE_H
@@ -0,0 +1,69 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_iosurface.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+FrameIOSurface::FrameIOSurface(IOSurfaceRef surface, const Size& size, int stride)
+    : Frame(size, stride, static_cast<uint8_t*>(IOSurfaceGetBaseAddress(surface)), nullptr),
+      surface_(surface)
+{
+    // Nothing
+}
+
+FrameIOSurface::~FrameIOSurface()
+{
+    IOSurfaceUnlock(surface_, kIOSurfaceLockReadOnly, nullptr);
+    IOSurfaceDecrementUseCount(surface_);
+    CFRelease(surface_);
+}
+
+// static
+std::unique_ptr<FrameIOSurface> FrameIOSurface::wrap(IOSurfaceRef surface)
+{
+    if (!surface)
+        return nullptr;
+
+    if (IOSurfaceGetBytesPerElement(surface) != kBytesPerPixel)
+    {
+        LOG(LS_WARNING) << "Unsupported IOSurface format: " << IOSurfaceGetPixelFormat(surface);
+        return nullptr;
+    }
+
+    IOReturn status = IOSurfaceLock(surface, kIOSurfaceLockReadOnly, nullptr);
+    if (status != kIOReturnSuccess)
+    {
+        LOG(LS_WARNING) << "IOSurfaceLock failed: " << status;
+        return nullptr;
+    }
+
+    // The display stream does not reuse the surface for new frames while it is in use.
+    CFRetain(surface);
+    IOSurfaceIncrementUseCount(surface);
+
+    const Size size(static_cast<int32_t>(IOSurfaceGetWidth(surface)),
+                    static_cast<int32_t>(IOSurfaceGetHeight(surface)));
+    const int stride = static_cast<int>(IOSurfaceGetBytesPerRow(surface));
+
+    return std::unique_ptr<FrameIOSurface>(new FrameIOSurface(surface, size, stride));
+}
+
+} // namespace base
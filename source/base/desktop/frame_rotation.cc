@@ -26,6 +26,11 @@ namespace base {
 
 namespace {
 
+// The rotation by 90 and 270 degrees reads the source by columns. The rectangle is rotated in
+// square tiles, so the source rows of a tile (16 kB) stay in the L1 cache while its columns are
+// read.
+const int kTileSize = 64;
+
 libyuv::RotationMode ToLibyuvRotationMode(Rotation rotation)
 {
     switch (rotation)
@@ -126,12 +131,36 @@ void rotateDesktopFrame(const Frame& source,
     if (target_rect.isEmpty())
         return;
 
-    int result = libyuv::ARGBRotate(
-        source.frameDataAtPos(source_rect.topLeft()), source.stride(),
-        target->frameDataAtPos(target_rect.topLeft()), target->stride(),
-        source_rect.width(), source_rect.height(),
-        ToLibyuvRotationMode(rotation));
-    DCHECK_EQ(result, 0);
+    const libyuv::RotationMode mode = ToLibyuvRotationMode(rotation);
+
+    auto rotate = [&](const Rect& rect, const Point& target_pos)
+    {
+        int result = libyuv::ARGBRotate(
+            source.frameDataAtPos(rect.topLeft()), source.stride(),
+            target->frameDataAtPos(target_pos), target->stride(),
+            rect.width(), rect.height(), mode);
+        DCHECK_EQ(result, 0);
+    };
+
+    // The rows are read and written sequentially without the rotation or with the rotation by
+    // 180 degrees.
+    if (rotation == Rotation::CLOCK_WISE_0 || rotation == Rotation::CLOCK_WISE_180)
+    {
+        rotate(source_rect, target_rect.topLeft());
+        return;
+    }
+
+    for (int y = source_rect.top(); y < source_rect.bottom(); y += kTileSize)
+    {
+        for (int x = source_rect.left(); x < source_rect.right(); x += kTileSize)
+        {
+            Rect tile = Rect::makeXYWH(x, y, kTileSize, kTileSize);
+            tile.intersectWith(source_rect);
+
+            rotate(tile, rotateAndOffsetRect(tile, source.size(), rotation, target_offset)
+                .topLeft());
+        }
+    }
 }
 
 } // namespace base
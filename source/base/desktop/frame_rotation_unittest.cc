@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_rotation.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+uint32_t pixelAt(const Frame& frame, int x, int y)
+{
+    uint32_t pixel;
+    memcpy(&pixel, frame.frameDataAtPos(x, y), sizeof(pixel));
+    return pixel;
+}
+
+std::unique_ptr<Frame> createNumberedFrame(const Size& size)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(size);
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        for (int x = 0; x < size.width(); ++x)
+        {
+            const uint32_t pixel = static_cast<uint32_t>(y * size.width() + x + 1);
+            memcpy(frame->frameDataAtPos(x, y), &pixel, sizeof(pixel));
+        }
+    }
+
+    return frame;
+}
+
+} // namespace
+
+TEST(FrameRotationTest, RotatesEachPixel)
+{
+    const Size source_size(211, 150);
+    const Rect source_rect = Rect::makeXYWH(13, 7, 190, 131);
+    const Point target_offset(5, 9);
+
+    std::unique_ptr<Frame> source = createNumberedFrame(source_size);
+
+    const Rotation rotations[] =
+    {
+        Rotation::CLOCK_WISE_0,
+        Rotation::CLOCK_WISE_90,
+        Rotation::CLOCK_WISE_180,
+        Rotation::CLOCK_WISE_270
+    };
+
+    for (const auto& rotation : rotations)
+    {
+        const Size rotated_size = rotateSize(source_size, rotation);
+        std::unique_ptr<Frame> target = FrameSimple::create(
+            Size(rotated_size.width() + target_offset.x(),
+                 rotated_size.height() + target_offset.y()));
+        memset(target->frameData(), 0, target->stride() * target->size().height());
+
+        rotateDesktopFrame(*source, source_rect, rotation, target_offset, target.get());
+
+        for (int y = source_rect.top(); y < source_rect.bottom(); ++y)
+        {
+            for (int x = source_rect.left(); x < source_rect.right(); ++x)
+            {
+                const Point target_pos = rotateRect(
+                    Rect::makeXYWH(x, y, 1, 1), source_size, rotation).topLeft();
+
+                ASSERT_EQ(pixelAt(*source, x, y),
+                          pixelAt(*target, target_pos.x() + target_offset.x(),
+                                  target_pos.y() + target_offset.y()))
+                    << "rotation: " << static_cast<int>(rotation) << ", x: " << x << ", y: " << y;
+            }
+        }
+    }
+}
+
+} // namespace base
@@ -18,8 +18,17 @@
 
 #include "base/desktop/frame_simple.h"
 
+#include "base/memory/aligned_memory.h"
+
 namespace base {
 
+namespace {
+
+// The alignment of malloc() on 64-bit systems, which was used before.
+const size_t kFrameAlignment = 16;
+
+} // namespace
+
 FrameSimple::FrameSimple(const Size& size, uint8_t* data)
     : Frame(size, size.width() * kBytesPerPixel, data, nullptr)
 {
@@ -28,13 +37,15 @@ FrameSimple::FrameSimple(const Size& size, uint8_t* data)
 
 FrameSimple::~FrameSimple()
 {
-    free(data_);
+    largeFree(data_, calcMemorySize(size(), kBytesPerPixel));
 }
 
 // static
 std::unique_ptr<FrameSimple> FrameSimple::create(const Size& size)
 {
-    uint8_t* data = reinterpret_cast<uint8_t*>(malloc(calcMemorySize(size, kBytesPerPixel)));
+    // The whole frame is read by the differ and the encoders, so it is placed in the large pages.
+    uint8_t* data = reinterpret_cast<uint8_t*>(
+        largeAlloc(calcMemorySize(size, kBytesPerPixel), kFrameAlignment));
     if (!data)
         return nullptr;
 
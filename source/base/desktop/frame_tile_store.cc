@@ -0,0 +1,210 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_tile_store.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const int kTileStride = FrameTileStore::kTileSize * Frame::kBytesPerPixel;
+
+// Calls |callback| for each tile that intersects |rect| with the index of the tile, its rectangle
+// and the part of |rect| in it.
+template <class Callback>
+void forEachTile(const Rect& rect, int columns, Callback callback)
+{
+    const int kTileSize = FrameTileStore::kTileSize;
+
+    for (int row = rect.top() / kTileSize; row <= (rect.bottom() - 1) / kTileSize; ++row)
+    {
+        for (int column = rect.left() / kTileSize; column <= (rect.right() - 1) / kTileSize;
+             ++column)
+        {
+            const Rect tile_rect =
+                Rect::makeXYWH(column * kTileSize, row * kTileSize, kTileSize, kTileSize);
+
+            Rect part = rect;
+            part.intersectWith(tile_rect);
+
+            callback(row * columns + column, tile_rect, part);
+        }
+    }
+}
+
+} // namespace
+
+// The tiles at the right and bottom edges have the full size, so all tiles have the same stride.
+struct FrameTileStore::Snapshot::Tile
+{
+    uint8_t pixels[kTileSize * kTileStride];
+};
+
+FrameTileStore::Snapshot::Snapshot(
+    const Size& size, int columns, const std::vector<std::shared_ptr<Tile>>& tiles)
+    : size_(size),
+      columns_(columns),
+      tiles_(tiles)
+{
+    // Nothing
+}
+
+void FrameTileStore::Snapshot::copyTo(const Rect& rect, Frame* frame, const Point& dest_pos) const
+{
+    DCHECK(frame);
+    DCHECK(Rect::makeSize(size_).containsRect(rect));
+
+    if (rect.isEmpty())
+        return;
+
+    forEachTile(rect, columns_, [&](int index, const Rect& tile_rect, const Rect& part)
+    {
+        const uint8_t* src = tiles_[index]->pixels +
+            (part.y() - tile_rect.y()) * kTileStride +
+            (part.x() - tile_rect.x()) * Frame::kBytesPerPixel;
+
+        const Rect dest_rect = Rect::makeXYWH(
+            dest_pos.x() + part.x() - rect.x(), dest_pos.y() + part.y() - rect.y(),
+            part.width(), part.height());
+
+        frame->copyPixelsFrom(src, kTileStride, dest_rect);
+    });
+}
+
+FrameTileStore::FrameTileStore()
+    : tile_count_(std::make_shared<std::atomic<size_t>>(0))
+{
+    // Nothing
+}
+
+FrameTileStore::~FrameTileStore() = default;
+
+void FrameTileStore::update(const Frame& frame)
+{
+    Region updated_region;
+
+    if (frame.size() != size_)
+    {
+        size_ = frame.size();
+        columns_ = (size_.width() + kTileSize - 1) / kTileSize;
+
+        const int rows = (size_.height() + kTileSize - 1) / kTileSize;
+
+        // The tiles of the snapshots keep their size.
+        tiles_.clear();
+        tiles_.resize(static_cast<size_t>(columns_) * rows);
+
+        updated_region.setRect(Rect::makeSize(size_));
+    }
+    else
+    {
+        updated_region = frame.constUpdatedRegion();
+        updated_region.intersectWith(Rect::makeSize(size_));
+
+        if (updated_region.isEmpty())
+            return;
+    }
+
+    // The tiles of the previous snapshot are released by the store, so only the snapshots held by
+    // the consumers cause their copies.
+    snapshot_.reset();
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        forEachTile(it.rect(), columns_, [&](int index, const Rect& tile_rect, const Rect& part)
+        {
+            const uint8_t* src = frame.frameDataAtPos(part.topLeft());
+            uint8_t* dest = writableTile(index)->pixels +
+                (part.y() - tile_rect.y()) * kTileStride +
+                (part.x() - tile_rect.x()) * Frame::kBytesPerPixel;
+
+            const size_t row_size = static_cast<size_t>(part.width()) * Frame::kBytesPerPixel;
+
+            for (int y = 0; y < part.height(); ++y)
+            {
+                memcpy(dest, src, row_size);
+                src += frame.stride();
+                dest += kTileStride;
+            }
+        });
+    }
+}
+
+std::shared_ptr<const FrameTileStore::Snapshot> FrameTileStore::snapshot()
+{
+    if (tiles_.empty())
+        return nullptr;
+
+    if (!snapshot_)
+        snapshot_.reset(new Snapshot(size_, columns_, tiles_));
+
+    return snapshot_;
+}
+
+size_t FrameTileStore::memoryUsage() const
+{
+    return tile_count_->load(std::memory_order_relaxed) * sizeof(Tile);
+}
+
+std::shared_ptr<FrameTileStore::Tile> FrameTileStore::createTile()
+{
+    tile_count_->fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_ptr<std::atomic<size_t>> tile_count = tile_count_;
+    return std::shared_ptr<Tile>(new Tile, [tile_count](Tile* tile)
+    {
+        tile_count->fetch_sub(1, std::memory_order_relaxed);
+        delete tile;
+    });
+}
+
+FrameTileStore::Tile* FrameTileStore::writableTile(int index)
+{
+    std::shared_ptr<Tile>& tile = tiles_[index];
+
+    // New tiles are not zeroed: a new tile is always written as a whole by the full update after a
+    // resize.
+    if (!tile)
+    {
+        tile = createTile();
+        return tile.get();
+    }
+
+    if (tile.use_count() == 1)
+    {
+        // The snapshots are released on other threads after they read the tile. The fence orders
+        // the writes after those reads.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return tile.get();
+    }
+
+    // The tile is used by a snapshot. Only a part of the tile may be updated, so the copy starts
+    // with its current pixels.
+    std::shared_ptr<Tile> copy = createTile();
+    memcpy(copy->pixels, tile->pixels, sizeof(copy->pixels));
+    tile = std::move(copy);
+
+    return tile.get();
+}
+
+} // namespace base
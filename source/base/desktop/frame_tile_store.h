@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__FRAME_TILE_STORE_H
+#define BASE__DESKTOP__FRAME_TILE_STORE_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Keeps the captured screen in tiles of kTileSize x kTileSize pixels. A snapshot refers to the
+// tiles of the screen at the moment it is taken, and a tile which is used by a snapshot is copied
+// before it is updated. So the consumers that run at different speeds (e.g. the encoders of the
+// clients) may keep the frames they have not encoded yet, and the memory grows only with the area
+// changed since then instead of a copy of the screen for each consumer.
+// update() and snapshot() must be called on the same thread. The snapshots may be used and
+// released on any thread.
+class FrameTileStore
+{
+public:
+    static const int kTileSize = 64;
+
+    class Snapshot
+    {
+    public:
+        const Size& size() const { return size_; }
+
+        // Copies |rect| of the snapshot to |frame| at |dest_pos|.
+        void copyTo(const Rect& rect, Frame* frame, const Point& dest_pos) const;
+
+    private:
+        friend class FrameTileStore;
+        struct Tile;
+
+        Snapshot(const Size& size, int columns, const std::vector<std::shared_ptr<Tile>>& tiles);
+
+        const Size size_;
+        const int columns_;
+        const std::vector<std::shared_ptr<Tile>> tiles_;
+
+        DISALLOW_COPY_AND_ASSIGN(Snapshot);
+    };
+
+    FrameTileStore();
+    ~FrameTileStore();
+
+    // Copies the updated region of |frame| into the tiles. If the size of the frame has changed,
+    // the whole frame is copied.
+    void update(const Frame& frame);
+
+    // Returns the current screen. The same snapshot is returned until the next update with
+    // changes. Null if the store has not been updated yet.
+    std::shared_ptr<const Snapshot> snapshot();
+
+    const Size& size() const { return size_; }
+
+    // Returns the size of the tiles which are used by the store or by the snapshots that are not
+    // released yet. May be called on any thread.
+    size_t memoryUsage() const;
+
+private:
+    using Tile = Snapshot::Tile;
+
+    std::shared_ptr<Tile> createTile();
+    Tile* writableTile(int index);
+
+    Size size_;
+    int columns_ = 0;
+    std::vector<std::shared_ptr<Tile>> tiles_;
+    std::shared_ptr<const Snapshot> snapshot_;
+
+    // The number of the tiles that are not destroyed yet. The tiles may outlive the store in the
+    // snapshots.
+    std::shared_ptr<std::atomic<size_t>> tile_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameTileStore);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__FRAME_TILE_STORE_H
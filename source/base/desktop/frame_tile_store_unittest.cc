@@ -0,0 +1,187 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_tile_store.h"
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+void fillRect(Frame* frame, const Rect& rect, uint8_t value)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        memset(frame->frameDataAtPos(rect.left(), y), value,
+               static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel);
+    }
+}
+
+bool isFilled(const Frame& frame, const Rect& rect, uint8_t value)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const uint8_t* row = frame.frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width() * Frame::kBytesPerPixel; ++x)
+        {
+            if (row[x] != value)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr<Frame> copySnapshot(const FrameTileStore::Snapshot& snapshot)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(snapshot.size());
+    snapshot.copyTo(Rect::makeSize(snapshot.size()), frame.get(), Point());
+    return frame;
+}
+
+} // namespace
+
+TEST(FrameTileStoreTest, FullUpdateOnResize)
+{
+    // The size is not a multiple of the tile size.
+    const Size size(150, 70);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(size);
+    fillRect(frame.get(), Rect::makeSize(size), 0x11);
+
+    FrameTileStore store;
+    EXPECT_FALSE(store.snapshot());
+
+    // The updated region is ignored for a new size.
+    store.update(*frame);
+
+    std::shared_ptr<const FrameTileStore::Snapshot> snapshot = store.snapshot();
+    ASSERT_TRUE(snapshot);
+    EXPECT_EQ(snapshot->size(), size);
+    EXPECT_TRUE(isFilled(*copySnapshot(*snapshot), Rect::makeSize(size), 0x11));
+}
+
+TEST(FrameTileStoreTest, SnapshotIsNotChanged)
+{
+    const Size size(200, 130);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(size);
+    fillRect(frame.get(), Rect::makeSize(size), 0x11);
+
+    FrameTileStore store;
+    store.update(*frame);
+
+    std::shared_ptr<const FrameTileStore::Snapshot> old_snapshot = store.snapshot();
+
+    // The same snapshot is returned while there are no changes.
+    frame->updatedRegion()->clear();
+    store.update(*frame);
+    EXPECT_EQ(store.snapshot(), old_snapshot);
+
+    // The changed rect covers parts of several tiles.
+    const Rect changed_rect = Rect::makeXYWH(50, 40, 100, 60);
+    fillRect(frame.get(), changed_rect, 0x22);
+    frame->updatedRegion()->setRect(changed_rect);
+    store.update(*frame);
+
+    std::shared_ptr<const FrameTileStore::Snapshot> new_snapshot = store.snapshot();
+    ASSERT_TRUE(new_snapshot);
+    EXPECT_NE(new_snapshot, old_snapshot);
+
+    EXPECT_TRUE(isFilled(*copySnapshot(*old_snapshot), Rect::makeSize(size), 0x11));
+
+    std::unique_ptr<Frame> new_frame = copySnapshot(*new_snapshot);
+    EXPECT_EQ(memcmp(new_frame->frameData(), frame->frameData(),
+                     static_cast<size_t>(frame->stride()) * size.height()), 0);
+}
+
+TEST(FrameTileStoreTest, UpdateWithoutSnapshots)
+{
+    const Size size(128, 128);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(size);
+    fillRect(frame.get(), Rect::makeSize(size), 0x11);
+
+    FrameTileStore store;
+    store.update(*frame);
+    store.snapshot().reset();
+
+    // The tiles are updated in place. The rest of the tile keeps its pixels.
+    const Rect changed_rect = Rect::makeXYWH(10, 10, 20, 20);
+    fillRect(frame.get(), changed_rect, 0x33);
+    frame->updatedRegion()->setRect(changed_rect);
+    store.update(*frame);
+
+    std::unique_ptr<Frame> copy = copySnapshot(*store.snapshot());
+    EXPECT_TRUE(isFilled(*copy, changed_rect, 0x33));
+    EXPECT_TRUE(isFilled(*copy, Rect::makeXYWH(0, 0, 128, 10), 0x11));
+    EXPECT_TRUE(isFilled(*copy, Rect::makeXYWH(64, 0, 64, 128), 0x11));
+}
+
+TEST(FrameTileStoreTest, CopyPart)
+{
+    const Size size(100, 100);
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(size);
+    fillRect(frame.get(), Rect::makeSize(size), 0x11);
+    fillRect(frame.get(), Rect::makeXYWH(60, 60, 10, 10), 0x44);
+
+    FrameTileStore store;
+    store.update(*frame);
+
+    std::unique_ptr<Frame> part = FrameSimple::create(Size(20, 20));
+    fillRect(part.get(), Rect::makeWH(20, 20), 0);
+
+    store.snapshot()->copyTo(Rect::makeXYWH(55, 55, 10, 10), part.get(), Point(5, 5));
+
+    EXPECT_TRUE(isFilled(*part, Rect::makeXYWH(5, 5, 5, 10), 0x11));
+    EXPECT_TRUE(isFilled(*part, Rect::makeXYWH(10, 10, 5, 5), 0x44));
+    EXPECT_TRUE(isFilled(*part, Rect::makeXYWH(0, 0, 20, 5), 0));
+}
+
+TEST(FrameTileStoreTest, MemoryUsage)
+{
+    const size_t kTileBytes =
+        FrameTileStore::kTileSize * FrameTileStore::kTileSize * Frame::kBytesPerPixel;
+
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(128, 128));
+    fillRect(frame.get(), Rect::makeSize(frame->size()), 0x11);
+
+    FrameTileStore store;
+    EXPECT_EQ(store.memoryUsage(), 0U);
+
+    store.update(*frame);
+    EXPECT_EQ(store.memoryUsage(), 4 * kTileBytes);
+
+    // The tile which is used by a snapshot is copied.
+    std::shared_ptr<const FrameTileStore::Snapshot> snapshot = store.snapshot();
+
+    frame->updatedRegion()->setRect(Rect::makeXYWH(0, 0, 10, 10));
+    store.update(*frame);
+    EXPECT_EQ(store.memoryUsage(), 5 * kTileBytes);
+
+    snapshot.reset();
+    EXPECT_EQ(store.memoryUsage(), 4 * kTileBytes);
+}
+
+} // namespace base
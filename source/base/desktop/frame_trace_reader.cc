@@ -0,0 +1,244 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_trace_reader.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/desktop/frame_trace_writer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const size_t kFrameAlignment = 32;
+const int kMaxFrameDimension = 16384;
+
+// The rects are read one by one, this many are reserved in advance at most. The count comes from
+// the trace and may be corrupted.
+const uint32_t kMaxReservedRects = 1024;
+
+} // namespace
+
+FrameTraceReader::FrameTraceReader(std::ifstream&& stream, ScopedZstdDStream&& dstream)
+    : stream_(std::move(stream)),
+      dstream_(std::move(dstream)),
+      buffer_(ZSTD_DStreamInSize())
+{
+    // Nothing
+}
+
+FrameTraceReader::~FrameTraceReader() = default;
+
+// static
+std::unique_ptr<FrameTraceReader> FrameTraceReader::open(const std::filesystem::path& file_path)
+{
+    std::ifstream stream(file_path, std::ifstream::binary);
+    if (!stream.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to open file: " << file_path;
+        return nullptr;
+    }
+
+    uint32_t header[2];
+
+    stream.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (stream.fail())
+    {
+        LOG(LS_WARNING) << "Unable to read header: " << file_path;
+        return nullptr;
+    }
+
+    if (EndianUtil::fromLittle(header[0]) != FrameTraceWriter::kMagic ||
+        EndianUtil::fromLittle(header[1]) != FrameTraceWriter::kVersion)
+    {
+        LOG(LS_WARNING) << "Unsupported file format: " << file_path;
+        return nullptr;
+    }
+
+    ScopedZstdDStream dstream(ZSTD_createDStream());
+    if (!dstream)
+    {
+        LOG(LS_WARNING) << "ZSTD_createDStream failed";
+        return nullptr;
+    }
+
+    size_t ret = ZSTD_initDStream(dstream.get());
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_WARNING) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
+        return nullptr;
+    }
+
+    return std::unique_ptr<FrameTraceReader>(
+        new FrameTraceReader(std::move(stream), std::move(dstream)));
+}
+
+const Frame* FrameTraceReader::readFrame()
+{
+    if (error_)
+        return nullptr;
+
+    uint64_t capture_time;
+
+    // A trace without the end of the stream (the writing process was terminated) ends here too.
+    if (!readValue(&capture_time))
+        return nullptr;
+
+    uint64_t diff_time;
+    uint32_t capturer_type;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rect_count;
+
+    if (!readValue(&diff_time) || !readValue(&capturer_type) || !readValue(&width) ||
+        !readValue(&height) || !readValue(&rect_count))
+    {
+        setError("Unable to read frame header");
+        return nullptr;
+    }
+
+    if (!width || !height || width > kMaxFrameDimension || height > kMaxFrameDimension)
+    {
+        setError("Invalid frame size");
+        return nullptr;
+    }
+
+    // The writer stores the rects of a region, which do not overlap and are not empty.
+    if (static_cast<uint64_t>(rect_count) > static_cast<uint64_t>(width) * height)
+    {
+        setError("Invalid rect count");
+        return nullptr;
+    }
+
+    const Size size(static_cast<int32_t>(width), static_cast<int32_t>(height));
+    const Rect frame_rect = Rect::makeSize(size);
+    const bool new_size = !frame_ || frame_->size() != size;
+
+    if (new_size)
+        frame_ = FrameAligned::create(size, kFrameAlignment);
+
+    Region* region = frame_->updatedRegion();
+    region->clear();
+
+    std::vector<Rect> rects;
+    rects.reserve(std::min(rect_count, kMaxReservedRects));
+
+    for (uint32_t i = 0; i < rect_count; ++i)
+    {
+        uint32_t x, y, rect_width, rect_height;
+
+        if (!readValue(&x) || !readValue(&y) || !readValue(&rect_width) || !readValue(&rect_height))
+        {
+            setError("Unable to read rect");
+            return nullptr;
+        }
+
+        const Rect rect = Rect::makeXYWH(static_cast<int32_t>(x), static_cast<int32_t>(y),
+                                         static_cast<int32_t>(rect_width),
+                                         static_cast<int32_t>(rect_height));
+        if (rect.isEmpty() || !frame_rect.containsRect(rect))
+        {
+            setError("Invalid rect");
+            return nullptr;
+        }
+
+        rects.emplace_back(rect);
+        region->addRect(rect);
+    }
+
+    if (new_size && !region->equals(Region(frame_rect)))
+    {
+        setError("The first frame of the size is not complete");
+        return nullptr;
+    }
+
+    for (const auto& rect : rects)
+    {
+        const size_t row_size = static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel;
+
+        for (int row = rect.top(); row < rect.bottom(); ++row)
+        {
+            if (!readData(frame_->frameDataAtPos(rect.left(), row), row_size))
+            {
+                setError("Unable to read pixels");
+                return nullptr;
+            }
+        }
+    }
+
+    frame_->setCaptureTime(static_cast<int64_t>(capture_time));
+    frame_->setDiffTime(static_cast<int64_t>(diff_time));
+    frame_->setCapturerType(capturer_type);
+
+    return frame_.get();
+}
+
+template <typename T>
+bool FrameTraceReader::readValue(T* value)
+{
+    if (!readData(value, sizeof(*value)))
+        return false;
+
+    *value = EndianUtil::fromLittle(*value);
+    return true;
+}
+
+bool FrameTraceReader::readData(void* data, size_t size)
+{
+    ZSTD_outBuffer output = { data, size, 0 };
+
+    while (output.pos < output.size)
+    {
+        if (input_.pos == input_.size)
+        {
+            stream_.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size());
+
+            const size_t read = static_cast<size_t>(stream_.gcount());
+            if (!read)
+                return false;
+
+            input_ = { buffer_.data(), read, 0 };
+        }
+
+        size_t ret = ZSTD_decompressStream(dstream_.get(), &output, &input_);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            setError("Invalid compressed data");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FrameTraceReader::setError(const char* message)
+{
+    if (error_)
+        return;
+
+    LOG(LS_WARNING) << "Corrupted trace: " << message;
+    error_ = true;
+}
+
+} // namespace base
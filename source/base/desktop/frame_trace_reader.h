@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__FRAME_TRACE_READER_H
+#define BASE__DESKTOP__FRAME_TRACE_READER_H
+
+#include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/memory/byte_array.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace base {
+
+class Frame;
+
+// Reads the frames of a trace written by FrameTraceWriter.
+class FrameTraceReader
+{
+public:
+    ~FrameTraceReader();
+
+    // Opens the trace |file_path|. Returns nullptr if the file cannot be opened or is not a trace.
+    static std::unique_ptr<FrameTraceReader> open(const std::filesystem::path& file_path);
+
+    // Returns the next frame of the trace. The updated region, the capture times and the capturer
+    // type are restored from the trace. The frame is owned by the reader and its pixels are updated
+    // in place by the next call. Returns nullptr at the end of the trace or if the trace is
+    // corrupted. In the last case hasError() returns true.
+    const Frame* readFrame();
+
+    bool hasError() const { return error_; }
+
+private:
+    FrameTraceReader(std::ifstream&& stream, ScopedZstdDStream&& dstream);
+
+    template <typename T>
+    bool readValue(T* value);
+
+    // Decompresses the next |size| bytes of the trace to |data|. Returns false if the trace ends
+    // earlier or is corrupted.
+    bool readData(void* data, size_t size);
+
+    void setError(const char* message);
+
+    std::ifstream stream_;
+    ScopedZstdDStream dstream_;
+    ByteArray buffer_;
+    ZSTD_inBuffer input_ = { nullptr, 0, 0 };
+
+    std::unique_ptr<Frame> frame_;
+    bool error_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameTraceReader);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__FRAME_TRACE_READER_H
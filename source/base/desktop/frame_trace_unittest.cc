@@ -0,0 +1,193 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/endian_util.h"
+#include "base/desktop/frame_simple.h"
+#include "base/desktop/frame_trace_reader.h"
+#include "base/desktop/frame_trace_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <zstd.h>
+
+namespace base {
+
+namespace {
+
+class FrameTraceTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::error_code error_code;
+        path_ = std::filesystem::temp_directory_path(error_code) / "aspia_frame_trace_test.trace";
+    }
+
+    void TearDown() override
+    {
+        std::error_code error_code;
+        std::filesystem::remove(path_, error_code);
+    }
+
+    static std::unique_ptr<Frame> createFrame(const Size& size, uint8_t seed)
+    {
+        std::unique_ptr<Frame> frame = FrameSimple::create(size);
+
+        for (int y = 0; y < size.height(); ++y)
+        {
+            uint8_t* row = frame->frameDataAtPos(0, y);
+            for (int x = 0; x < size.width() * Frame::kBytesPerPixel; ++x)
+                row[x] = static_cast<uint8_t>(seed + x * 7 + y * 13);
+        }
+
+        return frame;
+    }
+
+    static bool sameRect(const Frame& frame1, const Frame& frame2, const Rect& rect)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            if (memcmp(frame1.frameDataAtPos(rect.left(), y), frame2.frameDataAtPos(rect.left(), y),
+                       rect.width() * Frame::kBytesPerPixel) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST_F(FrameTraceTest, write_and_read)
+{
+    const Size size(100, 60);
+    std::unique_ptr<Frame> frame1 = createFrame(size, 1);
+    frame1->setCaptureTime(1000);
+    frame1->setDiffTime(1500);
+    frame1->setCapturerType(3);
+
+    std::unique_ptr<Frame> frame2 = createFrame(size, 2);
+    frame2->updatedRegion()->addRect(Rect::makeXYWH(10, 10, 20, 20));
+    frame2->updatedRegion()->addRect(Rect::makeXYWH(50, 30, 40, 10));
+
+    const Size new_size(64, 32);
+    std::unique_ptr<Frame> frame3 = createFrame(new_size, 3);
+    frame3->updatedRegion()->addRect(Rect::makeXYWH(0, 0, 8, 8));
+
+    {
+        std::unique_ptr<FrameTraceWriter> writer = FrameTraceWriter::create(path_);
+        ASSERT_TRUE(writer);
+
+        // The first frame is written in full even if its updated region is empty.
+        EXPECT_TRUE(writer->writeFrame(*frame1));
+        EXPECT_TRUE(writer->writeFrame(*frame2));
+        EXPECT_TRUE(writer->writeFrame(*frame3));
+        EXPECT_EQ(writer->frameCount(), 3);
+    }
+
+    std::unique_ptr<FrameTraceReader> reader = FrameTraceReader::open(path_);
+    ASSERT_TRUE(reader);
+
+    const Frame* frame = reader->readFrame();
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->size(), size);
+    EXPECT_TRUE(frame->constUpdatedRegion().equals(Region(Rect::makeSize(size))));
+    EXPECT_EQ(frame->captureTime(), 1000);
+    EXPECT_EQ(frame->diffTime(), 1500);
+    EXPECT_EQ(frame->capturerType(), 3u);
+    EXPECT_TRUE(sameRect(*frame, *frame1, Rect::makeSize(size)));
+
+    frame = reader->readFrame();
+    ASSERT_TRUE(frame);
+    EXPECT_TRUE(frame->constUpdatedRegion().equals(frame2->constUpdatedRegion()));
+    EXPECT_TRUE(sameRect(*frame, *frame2, Rect::makeXYWH(10, 10, 20, 20)));
+    EXPECT_TRUE(sameRect(*frame, *frame2, Rect::makeXYWH(50, 30, 40, 10)));
+
+    // The pixels outside the updated region are kept from the previous frame.
+    EXPECT_TRUE(sameRect(*frame, *frame1, Rect::makeXYWH(0, 0, 10, 10)));
+
+    // A frame with a new size is written in full.
+    frame = reader->readFrame();
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->size(), new_size);
+    EXPECT_TRUE(frame->constUpdatedRegion().equals(Region(Rect::makeSize(new_size))));
+    EXPECT_TRUE(sameRect(*frame, *frame3, Rect::makeSize(new_size)));
+
+    EXPECT_FALSE(reader->readFrame());
+    EXPECT_FALSE(reader->hasError());
+}
+
+TEST_F(FrameTraceTest, invalid_file)
+{
+    {
+        std::ofstream stream(path_, std::ofstream::binary);
+        stream << "not a trace file";
+    }
+
+    EXPECT_FALSE(FrameTraceReader::open(path_));
+}
+
+TEST_F(FrameTraceTest, invalid_rect_count)
+{
+    std::vector<uint8_t> payload;
+    auto append = [&payload](auto value)
+    {
+        value = EndianUtil::toLittle(value);
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+        payload.insert(payload.end(), data, data + sizeof(value));
+    };
+
+    // A frame of 16x16 pixels which claims to have 4 billion rects.
+    append(uint64_t(1));
+    append(uint64_t(2));
+    append(uint32_t(0));
+    append(uint32_t(16));
+    append(uint32_t(16));
+    append(uint32_t(0xFFFFFFFF));
+
+    std::vector<uint8_t> compressed(ZSTD_compressBound(payload.size()));
+    const size_t compressed_size = ZSTD_compress(
+        compressed.data(), compressed.size(), payload.data(), payload.size(), 1);
+    ASSERT_FALSE(ZSTD_isError(compressed_size));
+
+    {
+        const uint32_t header[2] = { EndianUtil::toLittle(FrameTraceWriter::kMagic),
+                                     EndianUtil::toLittle(FrameTraceWriter::kVersion) };
+
+        std::ofstream stream(path_, std::ofstream::binary);
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(compressed.data()),
+                     static_cast<std::streamsize>(compressed_size));
+    }
+
+    std::unique_ptr<FrameTraceReader> reader = FrameTraceReader::open(path_);
+    ASSERT_TRUE(reader);
+
+    EXPECT_FALSE(reader->readFrame());
+    EXPECT_TRUE(reader->hasError());
+}
+
+} // namespace base
@@ -0,0 +1,223 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_trace_writer.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+namespace base {
+
+namespace {
+
+// The trace is written on the capture thread, so the fastest level is used.
+const int kCompressionLevel = 1;
+
+} // namespace
+
+FrameTraceWriter::FrameTraceWriter(std::ofstream&& stream, ScopedZstdCStream&& cstream)
+    : stream_(std::move(stream)),
+      cstream_(std::move(cstream)),
+      buffer_(ZSTD_CStreamOutSize())
+{
+    // Nothing
+}
+
+FrameTraceWriter::~FrameTraceWriter()
+{
+    if (!failed_)
+        flush(true);
+}
+
+// static
+std::unique_ptr<FrameTraceWriter> FrameTraceWriter::create(const std::filesystem::path& file_path)
+{
+    std::ofstream stream(file_path, std::ofstream::binary | std::ofstream::trunc);
+    if (!stream.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to create file: " << file_path;
+        return nullptr;
+    }
+
+    ScopedZstdCStream cstream(ZSTD_createCStream());
+    if (!cstream)
+    {
+        LOG(LS_WARNING) << "ZSTD_createCStream failed";
+        return nullptr;
+    }
+
+    size_t ret = ZSTD_initCStream(cstream.get(), kCompressionLevel);
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_WARNING) << "ZSTD_initCStream failed: " << ZSTD_getErrorName(ret);
+        return nullptr;
+    }
+
+    const uint32_t header[] = { EndianUtil::toLittle(kMagic), EndianUtil::toLittle(kVersion) };
+
+    stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (stream.fail())
+    {
+        LOG(LS_WARNING) << "Unable to write file: " << file_path;
+        return nullptr;
+    }
+
+    std::unique_ptr<FrameTraceWriter> writer(
+        new FrameTraceWriter(std::move(stream), std::move(cstream)));
+    writer->file_size_ = sizeof(header);
+    return writer;
+}
+
+bool FrameTraceWriter::writeFrame(const Frame& frame)
+{
+    return writeFrame(frame, frame.captureTime(), frame.diffTime());
+}
+
+bool FrameTraceWriter::writeFrame(const Frame& frame, int64_t capture_time, int64_t diff_time)
+{
+    if (failed_)
+        return false;
+
+    const Rect frame_rect = Rect::makeSize(frame.size());
+    Region region(frame.constUpdatedRegion());
+
+    if (frame.size() != last_size_)
+    {
+        region.setRect(frame_rect);
+        last_size_ = frame.size();
+    }
+    else
+    {
+        region.intersectWith(frame_rect);
+    }
+
+    uint32_t rect_count = 0;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        ++rect_count;
+
+    bool result = compressValue(static_cast<uint64_t>(capture_time)) &&
+                  compressValue(static_cast<uint64_t>(diff_time)) &&
+                  compressValue(frame.capturerType()) &&
+                  compressValue(static_cast<uint32_t>(frame.size().width())) &&
+                  compressValue(static_cast<uint32_t>(frame.size().height())) &&
+                  compressValue(rect_count);
+
+    for (Region::Iterator it(region); result && !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        result = compressValue(static_cast<uint32_t>(rect.x())) &&
+                 compressValue(static_cast<uint32_t>(rect.y())) &&
+                 compressValue(static_cast<uint32_t>(rect.width())) &&
+                 compressValue(static_cast<uint32_t>(rect.height()));
+    }
+
+    for (Region::Iterator it(region); result && !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const size_t row_size = static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel;
+
+        for (int y = rect.top(); result && y < rect.bottom(); ++y)
+            result = compress(frame.frameDataAtPos(rect.left(), y), row_size);
+    }
+
+    if (!result || !flush(false))
+    {
+        failed_ = true;
+        return false;
+    }
+
+    ++frame_count_;
+    return true;
+}
+
+template <typename T>
+bool FrameTraceWriter::compressValue(T value)
+{
+    value = EndianUtil::toLittle(value);
+    return compress(&value, sizeof(value));
+}
+
+bool FrameTraceWriter::compress(const void* data, size_t size)
+{
+    ZSTD_inBuffer input = { data, size, 0 };
+
+    while (input.pos < input.size)
+    {
+        ZSTD_outBuffer output = { buffer_.data(), buffer_.size(), 0 };
+
+        size_t ret = ZSTD_compressStream(cstream_.get(), &output, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (!writeOutput(output.pos))
+            return false;
+    }
+
+    return true;
+}
+
+bool FrameTraceWriter::flush(bool end_stream)
+{
+    size_t ret;
+
+    do
+    {
+        ZSTD_outBuffer output = { buffer_.data(), buffer_.size(), 0 };
+
+        if (end_stream)
+            ret = ZSTD_endStream(cstream_.get(), &output);
+        else
+            ret = ZSTD_flushStream(cstream_.get(), &output);
+
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_flushStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (!writeOutput(output.pos))
+            return false;
+    }
+    while (ret != 0);
+
+    stream_.flush();
+    return !stream_.fail();
+}
+
+bool FrameTraceWriter::writeOutput(size_t size)
+{
+    if (!size)
+        return true;
+
+    stream_.write(reinterpret_cast<const char*>(buffer_.data()), size);
+    if (stream_.fail())
+    {
+        LOG(LS_WARNING) << "Unable to write the trace file";
+        return false;
+    }
+
+    file_size_ += size;
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__FRAME_TRACE_WRITER_H
+#define BASE__DESKTOP__FRAME_TRACE_WRITER_H
+
+#include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/desktop/geometry.h"
+#include "base/memory/byte_array.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace base {
+
+class Frame;
+
+// Writes the captured frames into a trace file that can be replayed with FrameTraceReader.
+//
+// The file starts with |kMagic| and |kVersion| followed by a zstd stream of the frame records.
+// Each record contains the capture times, the capturer type, the size of the frame, the rects of
+// the updated region and the pixels of these rects. The first frame and every frame with a new
+// size are written in full. The stream is flushed after each frame, so the trace stays readable
+// if the process is terminated. The numbers are written in the little-endian byte order.
+class FrameTraceWriter
+{
+public:
+    ~FrameTraceWriter();
+
+    static const uint32_t kMagic = 0x54465341; // "ASFT"
+    static const uint32_t kVersion = 1;
+
+    // Creates the file |file_path|. Returns nullptr if the file cannot be created.
+    static std::unique_ptr<FrameTraceWriter> create(const std::filesystem::path& file_path);
+
+    // Writes |frame| with its updated region and capture times. Returns false if the write failed.
+    // The writer is unusable after that.
+    bool writeFrame(const Frame& frame);
+
+    // Same as above, but the capture times are given separately (the capturers do not fill them).
+    bool writeFrame(const Frame& frame, int64_t capture_time, int64_t diff_time);
+
+    int frameCount() const { return frame_count_; }
+
+    // Number of bytes written to the file.
+    int64_t fileSize() const { return file_size_; }
+
+private:
+    FrameTraceWriter(std::ofstream&& stream, ScopedZstdCStream&& cstream);
+
+    template <typename T>
+    bool compressValue(T value);
+
+    bool compress(const void* data, size_t size);
+    bool flush(bool end_stream);
+    bool writeOutput(size_t size);
+
+    std::ofstream stream_;
+    ScopedZstdCStream cstream_;
+    ByteArray buffer_;
+    Size last_size_;
+    bool failed_ = false;
+
+    int frame_count_ = 0;
+    int64_t file_size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameTraceWriter);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__FRAME_TRACE_WRITER_H
@@ -68,4 +68,25 @@ TEST(FrameTest, Performance)
     }
 }
 
+TEST(FrameTest, MoveOverlappingPixels)
+{
+    auto frame = FrameSimple::create(Size(16, 16));
+
+    // Each row is filled with its number.
+    for (int y = 0; y < 16; ++y)
+        memset(frame->frameDataAtPos(0, y), y, frame->stride());
+
+    // Down by 3 rows.
+    frame->movePixels(Point(0, 2), Rect::makeXYWH(0, 5, 16, 8));
+
+    for (int y = 5; y < 13; ++y)
+        EXPECT_EQ(*frame->frameDataAtPos(8, y), y - 3);
+
+    // Back up by 3 rows.
+    frame->movePixels(Point(0, 5), Rect::makeXYWH(0, 2, 16, 8));
+
+    for (int y = 2; y < 10; ++y)
+        EXPECT_EQ(*frame->frameDataAtPos(8, y), y);
+}
+
 } // namespace base
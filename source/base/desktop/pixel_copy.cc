@@ -0,0 +1,189 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/pixel_copy.h"
+
+#include "base/threading/stripe_workers.h"
+#include "build/build_config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <emmintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+// A larger copy does not fit into the last level cache of the usual CPUs anyway.
+const size_t kLargePixelCopySize = 8 * 1024 * 1024;
+
+namespace {
+
+// The memory bandwidth is saturated by a few threads.
+const int kMaxStripeCount = 4;
+
+// The workers are shared by all the copies. A copy made while the workers are busy with another
+// one is made on the calling thread.
+struct SharedWorkers
+{
+    SharedWorkers()
+    {
+        const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+        const int stripe_count = std::min((cpu_count + 1) / 2, kMaxStripeCount);
+
+        if (stripe_count > 1)
+            workers = std::make_unique<StripeWorkers>(stripe_count - 1);
+    }
+
+    std::mutex lock;
+    std::unique_ptr<StripeWorkers> workers;
+};
+
+SharedWorkers& sharedWorkers()
+{
+    // The threads are never stopped, the copies can be made until the process exits.
+    static SharedWorkers* workers = new SharedWorkers();
+    return *workers;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+void copyRowNonTemporal(const uint8_t* src, uint8_t* dst, size_t size)
+{
+    // The streaming stores require the aligned destination.
+    const size_t head = std::min((16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15, size);
+
+    memcpy(dst, src, head);
+    src += head;
+    dst += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, src += 64, dst += 64)
+    {
+        const __m128i* s = reinterpret_cast<const __m128i*>(src);
+        __m128i* d = reinterpret_cast<__m128i*>(dst);
+
+        const __m128i x0 = _mm_loadu_si128(s + 0);
+        const __m128i x1 = _mm_loadu_si128(s + 1);
+        const __m128i x2 = _mm_loadu_si128(s + 2);
+        const __m128i x3 = _mm_loadu_si128(s + 3);
+
+        _mm_stream_si128(d + 0, x0);
+        _mm_stream_si128(d + 1, x1);
+        _mm_stream_si128(d + 2, x2);
+        _mm_stream_si128(d + 3, x3);
+    }
+
+    for (; size >= 16; size -= 16, src += 16, dst += 16)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    }
+
+    memcpy(dst, src, size);
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace
+
+void copyPixels(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                int row_size, int row_count)
+{
+    if (row_size <= 0 || row_count <= 0)
+        return;
+
+    if (static_cast<size_t>(row_size) * static_cast<size_t>(row_count) < kLargePixelCopySize)
+    {
+        copyPixelsTemporal(src, src_stride, dst, dst_stride, row_size, row_count);
+        return;
+    }
+
+    auto copy_rows = [&](int first_row, int last_row)
+    {
+        copyPixelsNonTemporal(src + static_cast<ptrdiff_t>(src_stride) * first_row, src_stride,
+                              dst + static_cast<ptrdiff_t>(dst_stride) * first_row, dst_stride,
+                              row_size, last_row - first_row);
+    };
+
+    SharedWorkers& shared = sharedWorkers();
+
+    std::unique_lock lock(shared.lock, std::try_to_lock);
+    if (lock.owns_lock() && shared.workers)
+    {
+        // The stripes do not overlap.
+        shared.workers->run(row_count, copy_rows);
+    }
+    else
+    {
+        copy_rows(0, row_count);
+    }
+}
+
+void copyPixelsTemporal(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                        int row_size, int row_count)
+{
+    if (row_size <= 0 || row_count <= 0)
+        return;
+
+    // The rows without padding are copied at once.
+    if (src_stride == row_size && dst_stride == row_size)
+    {
+        memcpy(dst, src, static_cast<size_t>(row_size) * static_cast<size_t>(row_count));
+        return;
+    }
+
+    for (int i = 0; i < row_count; ++i)
+    {
+        memcpy(dst, src, static_cast<size_t>(row_size));
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void copyPixelsNonTemporal(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                           int row_size, int row_count)
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (row_size <= 0 || row_count <= 0)
+        return;
+
+    for (int i = 0; i < row_count; ++i)
+    {
+        copyRowNonTemporal(src, dst, static_cast<size_t>(row_size));
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    // The streaming stores are weakly ordered. They must be visible to the other threads before
+    // the copy is reported as completed.
+    _mm_sfence();
+#else
+    copyPixelsTemporal(src, src_stride, dst, dst_stride, row_size, row_count);
+#endif // defined(ARCH_CPU_X86_FAMILY)
+}
+
+} // namespace base
@@ -0,0 +1,47 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__PIXEL_COPY_H
+#define BASE__DESKTOP__PIXEL_COPY_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Copies |row_count| rows of |row_size| bytes. The copies larger than the caches (a full 4K or
+// 8K screen) are made with the stores which bypass the caches, so they do not evict the data
+// the differ and the encoder use next. If the CPU has enough cores, such copies are also split
+// into stripes which are copied in parallel.
+void copyPixels(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                int row_size, int row_count);
+
+// The paths selected by copyPixels(). Exposed for the tests and the benchmarks.
+void copyPixelsTemporal(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                        int row_size, int row_count);
+
+// Falls back to copyPixelsTemporal() on the CPUs without the non-temporal stores.
+void copyPixelsNonTemporal(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                           int row_size, int row_count);
+
+// Copies of at least this size are made by the non-temporal stores and in parallel.
+extern const size_t kLargePixelCopySize;
+
+} // namespace base
+
+#endif // BASE__DESKTOP__PIXEL_COPY_H
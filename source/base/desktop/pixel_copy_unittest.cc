@@ -0,0 +1,122 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/pixel_copy.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+using CopyFunction = void(*)(const uint8_t*, int, uint8_t*, int, int, int);
+
+std::vector<uint8_t> generateData(size_t size)
+{
+    std::vector<uint8_t> data(size);
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+
+    return data;
+}
+
+// Copies the rows at the offsets which make the source and the destination misaligned and checks
+// that the bytes around the rows are not touched.
+void testCopy(CopyFunction copy, int row_size, int row_count, int offset)
+{
+    const int src_stride = row_size + 36;
+    const int dst_stride = row_size + 20;
+
+    const std::vector<uint8_t> src =
+        generateData(static_cast<size_t>(src_stride) * row_count + offset);
+    std::vector<uint8_t> dst(static_cast<size_t>(dst_stride) * row_count + offset, 0xCD);
+
+    copy(src.data() + offset, src_stride, dst.data() + offset, dst_stride, row_size, row_count);
+
+    for (int y = 0; y < row_count; ++y)
+    {
+        const uint8_t* src_row = src.data() + offset + static_cast<size_t>(src_stride) * y;
+        const uint8_t* dst_row = dst.data() + offset + static_cast<size_t>(dst_stride) * y;
+
+        ASSERT_EQ(memcmp(src_row, dst_row, row_size), 0) << "row " << y;
+
+        for (int x = row_size; x < dst_stride; ++x)
+            ASSERT_EQ(dst_row[x], 0xCD) << "row " << y;
+    }
+
+    for (int x = 0; x < offset; ++x)
+        ASSERT_EQ(dst[x], 0xCD);
+}
+
+} // namespace
+
+TEST(PixelCopyTest, Temporal)
+{
+    for (int offset = 0; offset < 16; offset += 3)
+    {
+        testCopy(copyPixelsTemporal, 4, 3, offset);
+        testCopy(copyPixelsTemporal, 100 * 4, 50, offset);
+    }
+}
+
+TEST(PixelCopyTest, NonTemporal)
+{
+    // The rows shorter than a vector, the rows with the unaligned head and tail and the rows
+    // copied in the blocks of 64 bytes.
+    for (int offset = 0; offset < 16; offset += 3)
+    {
+        testCopy(copyPixelsNonTemporal, 4, 3, offset);
+        testCopy(copyPixelsNonTemporal, 5 * 4, 7, offset);
+        testCopy(copyPixelsNonTemporal, 17 * 4, 9, offset);
+        testCopy(copyPixelsNonTemporal, 1921 * 4, 11, offset);
+    }
+}
+
+TEST(PixelCopyTest, Contiguous)
+{
+    const std::vector<uint8_t> src = generateData(64 * 4 * 32);
+    std::vector<uint8_t> dst(src.size());
+
+    copyPixels(src.data(), 64 * 4, dst.data(), 64 * 4, 64 * 4, 32);
+    EXPECT_EQ(src, dst);
+}
+
+TEST(PixelCopyTest, Large)
+{
+    // A 4K frame is larger than kLargePixelCopySize and is split into stripes.
+    ASSERT_GE(static_cast<size_t>(3840) * 4 * 2160, kLargePixelCopySize);
+
+    testCopy(copyPixels, 3840 * 4, 2160, 0);
+    testCopy(copyPixels, 3840 * 4, 2160, 5);
+}
+
+TEST(PixelCopyTest, Empty)
+{
+    uint8_t src[4] = { 1, 2, 3, 4 };
+    uint8_t dst[4] = { 0, 0, 0, 0 };
+
+    copyPixels(src, 4, dst, 4, 0, 1);
+    copyPixels(src, 4, dst, 4, 4, 0);
+
+    EXPECT_EQ(dst[0], 0);
+}
+
+} // namespace base
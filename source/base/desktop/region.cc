@@ -29,6 +29,27 @@ ALWAYS_INLINE RegionPtr region_cast(const RegionRec* region)
     return reinterpret_cast<RegionPtr>(const_cast<RegionRec*>(region));
 }
 
+ALWAYS_INLINE BoxRec toBox(const Rect& rect)
+{
+    BoxRec box;
+    box.x1 = static_cast<short>(rect.left());
+    box.x2 = static_cast<short>(rect.right());
+    box.y1 = static_cast<short>(rect.top());
+    box.y2 = static_cast<short>(rect.bottom());
+    return box;
+}
+
+// Returns true if |box| covers |other|.
+ALWAYS_INLINE bool containsBox(const BoxRec& box, const BoxRec& other)
+{
+    return box.x1 <= other.x1 && box.x2 >= other.x2 && box.y1 <= other.y1 && box.y2 >= other.y2;
+}
+
+ALWAYS_INLINE bool overlapsBox(const BoxRec& box, const BoxRec& other)
+{
+    return box.x1 < other.x2 && box.x2 > other.x1 && box.y1 < other.y2 && box.y2 > other.y1;
+}
+
 } // namespace
 
 Region::Region()
@@ -40,11 +61,7 @@ Region::Region(const Rect& rect)
 {
     if (!rect.isEmpty())
     {
-        BoxRec box;
-        box.x1 = static_cast<short>(rect.left());
-        box.x2 = static_cast<short>(rect.right());
-        box.y1 = static_cast<short>(rect.top());
-        box.y2 = static_cast<short>(rect.bottom());
+        BoxRec box = toBox(rect);
         miRegionInit(&x11reg_, &box, 0);
     }
     else
@@ -125,17 +142,73 @@ void Region::setRect(const Rect& rect)
 
 void Region::addRect(const Rect& rect)
 {
-    if (!rect.isEmpty())
+    if (rect.isEmpty())
+        return;
+
+    BoxRec box = toBox(rect);
+
+    if (isEmpty())
     {
-        Region temp(rect);
-        addRegion(temp);
+        miRegionUninit(&x11reg_);
+        miRegionInit(&x11reg_, &box, 0);
+        return;
     }
+
+    // The rectangle is already covered by the region.
+    if (!x11reg_.data && containsBox(x11reg_.extents, box))
+        return;
+
+    RegionRec temp;
+    miRegionInit(&temp, &box, 0);
+    miUnion(&x11reg_, &x11reg_, &temp);
 }
 
 void Region::addRects(const Rect* rects, int count)
 {
+    if (count <= 1)
+    {
+        if (count == 1)
+            addRect(rects[0]);
+        return;
+    }
+
+    // The rectangles are put into one array and ordered into bands in a single pass. Adding them
+    // one by one would merge the whole region for each of them.
+    RegionRec temp;
+    miRegionInit(&temp, NullBox, count);
+    if (!temp.data || !temp.data->size)
+    {
+        for (int i = 0; i < count; ++i)
+            addRect(rects[i]);
+        return;
+    }
+
+    BoxPtr boxes = REGION_BOXPTR(&temp);
+    long box_count = 0;
+
     for (int i = 0; i < count; ++i)
-        addRect(rects[i]);
+    {
+        if (!rects[i].isEmpty())
+            boxes[box_count++] = toBox(rects[i]);
+    }
+
+    temp.data->numRects = box_count;
+
+    if (box_count)
+    {
+        // Empty extents mark the boxes as not validated yet.
+        temp.extents.x1 = temp.extents.x2 = 0;
+
+        Bool overlap;
+        miRegionValidate(&temp, &overlap);
+
+        if (isEmpty())
+            std::swap(x11reg_, temp);
+        else
+            miUnion(&x11reg_, &x11reg_, &temp);
+    }
+
+    miRegionUninit(&temp);
 }
 
 void Region::addRegion(const Region& region)
@@ -155,9 +228,30 @@ void Region::intersectWith(const Region& region)
 
 void Region::intersectWith(const Rect& rect)
 {
-    Region region;
-    region.addRect(rect);
-    intersectWith(region);
+    if (isEmpty())
+        return;
+
+    if (rect.isEmpty())
+    {
+        clear();
+        return;
+    }
+
+    const BoxRec box = toBox(rect);
+
+    // The region is inside of the rectangle.
+    if (containsBox(box, x11reg_.extents))
+        return;
+
+    if (!overlapsBox(box, x11reg_.extents))
+    {
+        clear();
+        return;
+    }
+
+    RegionRec temp;
+    miRegionInit(&temp, const_cast<BoxPtr>(&box), 0);
+    miIntersect(&x11reg_, &x11reg_, &temp);
 }
 
 void Region::subtract(const Region& region)
@@ -167,9 +261,24 @@ void Region::subtract(const Region& region)
 
 void Region::subtract(const Rect& rect)
 {
-    Region region;
-    region.addRect(rect);
-    subtract(region);
+    if (rect.isEmpty() || isEmpty())
+        return;
+
+    BoxRec box = toBox(rect);
+
+    // Nothing to subtract.
+    if (!overlapsBox(box, x11reg_.extents))
+        return;
+
+    if (containsBox(box, x11reg_.extents))
+    {
+        clear();
+        return;
+    }
+
+    RegionRec temp;
+    miRegionInit(&temp, &box, 0);
+    miSubtract(&x11reg_, &x11reg_, &temp);
 }
 
 void Region::translate(int32_t dx, int32_t dy)
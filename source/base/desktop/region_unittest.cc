@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <vector>
 
 namespace base {
 
@@ -983,6 +984,78 @@ TEST(desktop_region_test, subtract_rect_on_same_col)
     }
 }
 
+TEST(desktop_region_test, add_rects)
+{
+    for (int c = 0; c < 1000; ++c)
+    {
+        std::vector<Rect> rects;
+
+        const int count = radmonInt(50);
+        for (int i = 0; i < count; ++i)
+        {
+            // Some of the rectangles are empty.
+            rects.push_back(Rect::makeXYWH(radmonInt(100), radmonInt(100),
+                                           radmonInt(50), radmonInt(50)));
+        }
+
+        Region initial;
+        if (c % 2)
+            initial.addRect(Rect::makeXYWH(radmonInt(100), radmonInt(100), 30, 30));
+
+        Region expected(initial);
+        for (const auto& rect : rects)
+            expected.addRect(rect);
+
+        Region region(initial);
+        region.addRects(rects.data(), static_cast<int>(rects.size()));
+
+        EXPECT_TRUE(region.equals(expected)) << "c = " << c;
+
+        // The result must be a valid banded region: adding it again does not change it.
+        Region copy(region);
+        copy.addRegion(region);
+        EXPECT_TRUE(copy.equals(expected)) << "c = " << c;
+    }
+}
+
+TEST(desktop_region_test, rect_operations)
+{
+    for (int c = 0; c < 1000; ++c)
+    {
+        Region region;
+        const int count = radmonInt(10);
+        for (int i = 0; i < count; ++i)
+        {
+            region.addRect(Rect::makeXYWH(radmonInt(100), radmonInt(100),
+                                          1 + radmonInt(50), 1 + radmonInt(50)));
+        }
+
+        const Rect rect = Rect::makeXYWH(radmonInt(150) - 25, radmonInt(150) - 25,
+                                         radmonInt(100), radmonInt(100));
+
+        Region intersected(region);
+        intersected.intersectWith(rect);
+
+        Region expected_intersected;
+        expected_intersected.intersect(region, Region(rect));
+        EXPECT_TRUE(intersected.equals(expected_intersected)) << "c = " << c;
+
+        Region subtracted(region);
+        subtracted.subtract(rect);
+
+        Region expected_subtracted(region);
+        expected_subtracted.subtract(Region(rect));
+        EXPECT_TRUE(subtracted.equals(expected_subtracted)) << "c = " << c;
+
+        Region added(region);
+        added.addRect(rect);
+
+        Region expected_added(region);
+        expected_added.addRegion(Region(rect));
+        EXPECT_TRUE(added.equals(expected_added)) << "c = " << c;
+    }
+}
+
 TEST(desktop_region_test, performance)
 {
     for (int c = 0; c < 1000; ++c)
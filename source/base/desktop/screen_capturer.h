@@ -21,6 +21,7 @@
 
 #include "base/desktop/frame.h"
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -66,11 +67,26 @@ public:
     static const ScreenId kFullDesktopScreenId = -1;
     static const ScreenId kInvalidScreenId = -2;
 
+    // Number of frames which are used by the capturers in turn. A frame is not written until
+    // the next |kFrameQueueLength - 1| frames are captured, so the consumer can use it while the
+    // capture goes on.
+    static const int kFrameQueueLength = 3;
+
     virtual int screenCount() = 0;
     virtual bool screenList(ScreenList* screens) = 0;
     virtual bool selectScreen(ScreenId screen_id) = 0;
     virtual const Frame* captureFrame(Error* error) = 0;
 
+    // The capturers which are notified of the changes by the OS call |callback| on any thread when
+    // a new frame is available. It is called once until the next captureFrame(). The other
+    // capturers ignore it.
+    using FrameCallback = std::function<void()>;
+    virtual void setFrameCallback(FrameCallback /* callback */) {}
+
+    // Returns true if the callback is called for the next frame. Otherwise the capturer has to be
+    // polled.
+    virtual bool isFrameDriven() const { return false; }
+
     void setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory);
     SharedMemoryFactory* sharedMemoryFactory() const;
 
@@ -103,7 +119,7 @@ protected:
         // Index of the current frame.
         int current_ = 0;
 
-        static const int kQueueLength = 2;
+        static const int kQueueLength = kFrameQueueLength;
         std::unique_ptr<FrameType> frames_[kQueueLength];
 
         DISALLOW_COPY_AND_ASSIGN(FrameQueue);
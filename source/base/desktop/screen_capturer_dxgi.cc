@@ -19,6 +19,7 @@
 #include "base/desktop/screen_capturer_dxgi.h"
 
 #include "base/logging.h"
+#include "base/desktop/differ.h"
 #include "base/desktop/win/screen_capture_utils.h"
 #include "base/ipc/shared_memory_factory.h"
 #include "base/strings/unicode.h"
@@ -172,12 +173,16 @@ const Frame* ScreenCapturerDxgi::captureFrame(Error* error)
     {
         LOG(LS_ERROR) << "DxgiDuplicatorController failed to capture desktop, error code "
                       << DxgiDuplicatorController::resultName(result);
+        has_previous_frame_ = false;
     }
 
     switch (result)
     {
         case DuplicateResult::SUCCEEDED:
         {
+            calcUpdatedRegion();
+            has_previous_frame_ = true;
+
             *error = Error::SUCCEEDED;
             return queue_.currentFrame()->frame();
         }
@@ -219,6 +224,33 @@ const Frame* ScreenCapturerDxgi::captureFrame(Error* error)
 void ScreenCapturerDxgi::reset()
 {
     queue_.reset();
+    has_previous_frame_ = false;
+    differ_.reset();
+}
+
+void ScreenCapturerDxgi::calcUpdatedRegion()
+{
+    SharedFrame* current = queue_.currentFrame()->frame();
+    DxgiFrame* previous = queue_.previousFrame();
+
+    if (!has_previous_frame_ || !previous || previous->frame()->size() != current->size())
+    {
+        // Without the previous image there is nothing to compare with. The region from DXGI is
+        // used as is.
+        differ_ = std::make_unique<Differ>(current->size());
+        return;
+    }
+
+    // DXGI reports the region changed since the last capture into the same buffer. It always
+    // covers the changes since the previous frame, but dirty rects are often much larger than the
+    // really changed pixels and move rects are reported for both the source and the destination.
+    // The VPX encoders have no copy primitive, so the moved areas are treated as dirty and only
+    // the blocks that differ from the previous frame are left.
+    Region hint_region;
+    hint_region.swap(current->updatedRegion());
+
+    differ_->calcDirtyRegion(previous->frame()->frameData(), current->frameData(), hint_region,
+                             current->updatedRegion());
 }
 
 } // namespace base
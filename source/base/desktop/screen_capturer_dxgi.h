@@ -25,6 +25,8 @@
 
 namespace base {
 
+class Differ;
+
 class ScreenCapturerDxgi : public ScreenCapturer
 {
 public:
@@ -52,11 +54,19 @@ protected:
     void reset() override;
 
 private:
+    // Narrows the region reported by DXGI down to the blocks that really changed since the
+    // previous frame.
+    void calcUpdatedRegion();
+
     std::shared_ptr<DxgiDuplicatorController> controller_;
 
     ScreenId current_screen_id_ = kFullDesktopScreenId;
     FrameQueue<DxgiFrame> queue_;
 
+    // Whether the previous frame in the queue contains a valid image of the screen.
+    bool has_previous_frame_ = false;
+    std::unique_ptr<Differ> differ_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerDxgi);
 };
 
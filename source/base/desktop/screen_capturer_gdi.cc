@@ -25,10 +25,49 @@
 #include "base/desktop/differ.h"
 #include "base/win/scoped_select_object.h"
 
+#include <cstring>
+#include <unordered_map>
+
 #include <dwmapi.h>
 
 namespace base {
 
+namespace {
+
+// The screen is scanned for changes in horizontal bands, one band per frame. A change outside of
+// the other scanned areas is found after this number of frames at the latest.
+const int kScanBandCount = 4;
+
+// The areas changed in the previous frame are scanned again with this margin, so the moving and
+// growing content (video, animations, scrolling) is followed in each frame.
+const int kChangedAreaMargin = 32;
+
+// The hover effects of the controls change the screen around the cursor.
+const int kCursorAreaSize = 128;
+const int kCaretAreaMargin = 16;
+
+// If the scanned areas consist of more rectangles, their bounding rectangle is blitted at once.
+const size_t kMaxBlitRects = 32;
+
+// The current frame of the queue differs from the previous one by the updates of these frames.
+const size_t kRecentUpdateCount = ScreenCapturer::kFrameQueueLength - 1;
+
+// If the scanned areas cover more than this part of the screen, the whole screen is blitted and
+// compared.
+const int64_t kMaxPartialScanPercent = 50;
+
+int64_t regionArea(const Region& region)
+{
+    int64_t area = 0;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    return area;
+}
+
+} // namespace
+
 ScreenCapturerGdi::ScreenCapturerGdi()
     : ScreenCapturer(Type::WIN_GDI)
 {
@@ -119,37 +158,236 @@ const Frame* ScreenCapturerGdi::captureImage()
     Frame* current = queue_.currentFrame();
     Frame* previous = queue_.previousFrame();
 
+    const Rect frame_rect = Rect::makeSize(screen_rect.size());
+    const bool size_changed = !previous || previous->size() != current->size();
+
+    // A new frame buffer does not contain the previous content, so it is blitted completely.
+    bool full_capture = size_changed || recent_updates_.size() < kRecentUpdateCount;
+
+    Region scan_region;
+    if (!full_capture)
+    {
+        scan_region = scanRegion(screen_rect);
+
+        full_capture = regionArea(scan_region) * 100 >
+            static_cast<int64_t>(frame_rect.width()) * frame_rect.height() *
+            kMaxPartialScanPercent;
+    }
+
+    if (!full_capture)
+    {
+        // The current frame of the queue was captured several frames ago. The changes since then
+        // are copied from the previous frame, so only the scanned areas are blitted.
+        Region outdated_region;
+        for (const auto& region : recent_updates_)
+            outdated_region.addRegion(region);
+
+        for (Region::Iterator it(outdated_region); !it.isAtEnd(); it.advance())
+            current->copyPixelsFrom(*previous, it.rect().topLeft(), it.rect());
+    }
+
     {
         win::ScopedSelectObject select_object(
             memory_dc_, static_cast<FrameDib*>(current)->bitmap());
 
-        BitBlt(memory_dc_,
-               0, 0,
-               screen_rect.width(), screen_rect.height(),
-               desktop_dc_,
-               screen_rect.left(), screen_rect.top(),
-               CAPTUREBLT | SRCCOPY);
+        std::vector<Rect> blit_rects;
+
+        if (full_capture)
+        {
+            blit_rects.emplace_back(frame_rect);
+        }
+        else
+        {
+            Rect bounds;
+
+            for (Region::Iterator it(scan_region); !it.isAtEnd(); it.advance())
+            {
+                blit_rects.emplace_back(it.rect());
+                bounds.unionWith(it.rect());
+            }
+
+            if (blit_rects.size() > kMaxBlitRects)
+                blit_rects.assign(1, bounds);
+        }
+
+        for (const auto& rect : blit_rects)
+        {
+            BitBlt(memory_dc_,
+                   rect.left(), rect.top(),
+                   rect.width(), rect.height(),
+                   desktop_dc_,
+                   screen_rect.left() + rect.left(), screen_rect.top() + rect.top(),
+                   CAPTUREBLT | SRCCOPY);
+        }
     }
 
     current->setTopLeft(screen_rect.topLeft().subtract(desktop_dc_rect_.topLeft()));
     current->setDpi(Point(GetDeviceCaps(desktop_dc_, LOGPIXELSX),
                           GetDeviceCaps(desktop_dc_, LOGPIXELSY)));
 
-    if (!previous || previous->size() != current->size())
+    if (size_changed)
     {
         differ_ = std::make_unique<Differ>(screen_rect.size());
-        current->updatedRegion()->addRect(Rect::makeSize(screen_rect.size()));
+        current->updatedRegion()->addRect(frame_rect);
+        current->setCopyRect(Rect(), Point());
+
+        recent_updates_.clear();
+        windows_.clear();
+    }
+    else if (full_capture)
+    {
+        differ_->calcDirtyRegion(previous->frameData(),
+                                 current->frameData(),
+                                 current->updatedRegion());
+        scroll_detector_.detect(*previous, current);
     }
     else
     {
+        // Outside of the scanned areas the frame is the same as the previous one.
         differ_->calcDirtyRegion(previous->frameData(),
                                  current->frameData(),
+                                 scan_region,
                                  current->updatedRegion());
+
+        // The scanned areas are too small to contain a scroll.
+        current->setCopyRect(Rect(), Point());
     }
 
+    recent_updates_.push_back(current->constUpdatedRegion());
+    while (recent_updates_.size() > kRecentUpdateCount)
+        recent_updates_.pop_front();
+
     return current;
 }
 
+Region ScreenCapturerGdi::scanRegion(const Rect& screen_rect)
+{
+    const Rect frame_rect = Rect::makeSize(screen_rect.size());
+    Region region;
+
+    const int band_height = (frame_rect.height() + kScanBandCount - 1) / kScanBandCount;
+    region.addRect(Rect::makeXYWH(0, scan_band_ * band_height, frame_rect.width(), band_height));
+    scan_band_ = (scan_band_ + 1) % kScanBandCount;
+
+    if (!recent_updates_.empty())
+    {
+        for (Region::Iterator it(recent_updates_.back()); !it.isAtEnd(); it.advance())
+        {
+            Rect rect = it.rect();
+            rect.extend(kChangedAreaMargin, kChangedAreaMargin,
+                        kChangedAreaMargin, kChangedAreaMargin);
+            region.addRect(rect);
+        }
+    }
+
+    addWindowChanges(screen_rect.topLeft(), &region);
+    addInputAreas(screen_rect.topLeft(), &region);
+
+    region.intersectWith(frame_rect);
+    return region;
+}
+
+void ScreenCapturerGdi::addWindowChanges(const Point& origin, Region* region)
+{
+    std::vector<WindowRect> windows;
+    EnumWindows(enumWindowsProc, reinterpret_cast<LPARAM>(&windows));
+
+    std::unordered_map<HWND, size_t> previous_windows;
+    for (size_t i = 0; i < windows_.size(); ++i)
+        previous_windows.emplace(windows_[i].window, i);
+
+    auto add_rect = [&](const Rect& rect)
+    {
+        region->addRect(rect.translated(-origin.x(), -origin.y()));
+    };
+
+    // The windows are enumerated in the z-order. A window that was moved, resized, shown or
+    // raised above another window changes the areas under its old and new positions.
+    for (size_t i = 0; i < windows.size(); ++i)
+    {
+        auto previous = previous_windows.find(windows[i].window);
+        if (previous == previous_windows.end())
+        {
+            add_rect(windows[i].rect);
+            continue;
+        }
+
+        const size_t previous_index = previous->second;
+        const HWND above = i ? windows[i - 1].window : nullptr;
+        const HWND previous_above = previous_index ? windows_[previous_index - 1].window : nullptr;
+
+        if (windows_[previous_index].rect != windows[i].rect || above != previous_above)
+        {
+            add_rect(windows_[previous_index].rect);
+            add_rect(windows[i].rect);
+        }
+
+        previous_windows.erase(previous);
+    }
+
+    // The windows that were hidden or closed.
+    for (const auto& previous : previous_windows)
+        add_rect(windows_[previous.second].rect);
+
+    windows_.swap(windows);
+}
+
+// static
+void ScreenCapturerGdi::addInputAreas(const Point& origin, Region* region)
+{
+    POINT cursor_pos;
+    if (GetCursorPos(&cursor_pos))
+    {
+        region->addRect(Rect::makeXYWH(cursor_pos.x - origin.x() - kCursorAreaSize / 2,
+                                       cursor_pos.y - origin.y() - kCursorAreaSize / 2,
+                                       kCursorAreaSize,
+                                       kCursorAreaSize));
+    }
+
+    HWND foreground_window = GetForegroundWindow();
+    if (!foreground_window)
+        return;
+
+    GUITHREADINFO thread_info;
+    memset(&thread_info, 0, sizeof(thread_info));
+    thread_info.cbSize = sizeof(thread_info);
+
+    const DWORD thread_id = GetWindowThreadProcessId(foreground_window, nullptr);
+    if (!GetGUIThreadInfo(thread_id, &thread_info) || !thread_info.hwndCaret)
+        return;
+
+    // The caret rectangle is in the client coordinates of its window.
+    RECT caret_rect = thread_info.rcCaret;
+    MapWindowPoints(thread_info.hwndCaret, nullptr, reinterpret_cast<POINT*>(&caret_rect), 2);
+
+    Rect rect = Rect::makeLTRB(
+        caret_rect.left, caret_rect.top, caret_rect.right, caret_rect.bottom);
+    rect.translate(-origin.x(), -origin.y());
+
+    // The typed text appears after the caret.
+    rect.extend(kCaretAreaMargin, kCaretAreaMargin, kCursorAreaSize, kCaretAreaMargin);
+    region->addRect(rect);
+}
+
+// static
+BOOL CALLBACK ScreenCapturerGdi::enumWindowsProc(HWND window, LPARAM lparam)
+{
+    if (!IsWindowVisible(window) || IsIconic(window))
+        return TRUE;
+
+    RECT window_rect;
+    if (!GetWindowRect(window, &window_rect))
+        return TRUE;
+
+    Rect rect = Rect::makeLTRB(
+        window_rect.left, window_rect.top, window_rect.right, window_rect.bottom);
+    if (rect.isEmpty())
+        return TRUE;
+
+    reinterpret_cast<std::vector<WindowRect>*>(lparam)->push_back({ window, rect });
+    return TRUE;
+}
+
 bool ScreenCapturerGdi::prepareCaptureResources()
 {
     Rect desktop_rect = ScreenCaptureUtils::fullScreenRect();
@@ -20,14 +20,23 @@
 #define BASE__DESKTOP__SCREEN_CAPTURER_GDI_H
 
 #include "base/desktop/screen_capturer.h"
+#include "base/desktop/scroll_detector.h"
 #include "base/desktop/shared_frame.h"
 #include "base/win/scoped_hdc.h"
 
+#include <deque>
+#include <vector>
+
 namespace base {
 
 class Differ;
 class SharedMemoryFactory;
 
+// Screen capturer based on BitBlt. Blitting and comparing the whole screen in each frame is too
+// slow for large screens, so only the areas where a change is likely are blitted: the areas
+// changed in the previous frame, the cursor and the caret, and the windows that were moved,
+// resized, shown, hidden or raised. The rest of the screen is scanned in bands, so any other
+// change is found within a few frames.
 class ScreenCapturerGdi : public ScreenCapturer
 {
 public:
@@ -45,9 +54,21 @@ protected:
     void reset() override;
 
 private:
+    struct WindowRect
+    {
+        HWND window;
+        Rect rect;
+    };
+
     const Frame* captureImage();
     bool prepareCaptureResources();
 
+    // Returns the areas of the frame that are blitted and compared in the next frame.
+    Region scanRegion(const Rect& screen_rect);
+    void addWindowChanges(const Point& origin, Region* region);
+    static void addInputAreas(const Point& origin, Region* region);
+    static BOOL CALLBACK enumWindowsProc(HWND window, LPARAM lparam);
+
     bool composition_changed_ = false;
 
     ScreenId current_screen_id_ = kFullDesktopScreenId;
@@ -56,11 +77,20 @@ private:
     Rect desktop_dc_rect_;
 
     std::unique_ptr<Differ> differ_;
+    ScrollDetector scroll_detector_;
     win::ScopedGetDC desktop_dc_;
     win::ScopedCreateDC memory_dc_;
 
     FrameQueue<Frame> queue_;
 
+    // The updated regions of the last frames. The current frame of the queue differs from the
+    // previous one by these regions.
+    std::deque<Region> recent_updates_;
+
+    // Visible top-level windows of the previous frame in the z-order.
+    std::vector<WindowRect> windows_;
+    int scan_band_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerGdi);
 };
 
@@ -21,8 +21,16 @@
 
 #include "base/desktop/screen_capturer.h"
 
+#include <CoreGraphics/CoreGraphics.h>
+
 namespace base {
 
+// Screen capturer based on CGDisplayStream. The OS pushes a new IOSurface together with the list
+// of dirty rects only when the screen content changes. The capturer keeps the latest surface and
+// returns it wrapped into a frame without copying the pixels. If nothing has changed since the
+// previous call, the previous frame is returned with an empty updated region.
+// While the stream runs, the frame callback is called from the handler of the stream, so the
+// consumer captures only when the screen has changed.
 class ScreenCapturerMac : public ScreenCapturer
 {
 public:
@@ -34,12 +42,30 @@ public:
     bool screenList(ScreenList* screens) override;
     bool selectScreen(ScreenId screen_id) override;
     const Frame* captureFrame(Error* error) override;
+    void setFrameCallback(FrameCallback callback) override;
+    bool isFrameDriven() const override;
 
 protected:
     // ScreenCapturer implementation.
     void reset() override;
 
 private:
+    struct StreamState;
+
+    bool startStream();
+    void stopStream();
+    CGDirectDisplayID selectedDisplay() const;
+
+    ScreenId current_screen_id_ = kFullDesktopScreenId;
+
+    FrameCallback frame_callback_;
+    std::shared_ptr<StreamState> state_;
+    CGDisplayStreamRef stream_ = nullptr;
+    Point top_left_;
+    Point dpi_;
+
+    std::unique_ptr<Frame> frame_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerMac);
 };
 
@@ -19,46 +19,433 @@
 #include "base/desktop/screen_capturer_mac.h"
 
 #include "base/logging.h"
+#include "base/desktop/frame_iosurface.h"
+#include "base/strings/string_number_conversions.h"
+
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include <dispatch/dispatch.h>
 
 namespace base {
 
+namespace {
+
+const uint32_t kMaxDisplays = 32;
+
+std::vector<CGDirectDisplayID> activeDisplays()
+{
+    CGDirectDisplayID displays[kMaxDisplays];
+    uint32_t count = 0;
+
+    if (CGGetActiveDisplayList(kMaxDisplays, displays, &count) != kCGErrorSuccess)
+    {
+        LOG(LS_WARNING) << "CGGetActiveDisplayList failed";
+        return std::vector<CGDirectDisplayID>();
+    }
+
+    return std::vector<CGDirectDisplayID>(displays, displays + count);
+}
+
+Size pixelSize(CGDirectDisplayID display_id)
+{
+    Size size(static_cast<int32_t>(CGDisplayPixelsWide(display_id)),
+              static_cast<int32_t>(CGDisplayPixelsHigh(display_id)));
+
+    CGDisplayModeRef mode = CGDisplayCopyDisplayMode(display_id);
+    if (mode)
+    {
+        size = Size(static_cast<int32_t>(CGDisplayModeGetPixelWidth(mode)),
+                    static_cast<int32_t>(CGDisplayModeGetPixelHeight(mode)));
+        CGDisplayModeRelease(mode);
+    }
+
+    return size;
+}
+
+// Returns the ratio between the physical pixels and the points of the display.
+double pixelScale(CGDirectDisplayID display_id, const Size& pixel_size)
+{
+    const CGRect bounds = CGDisplayBounds(display_id);
+    if (bounds.size.width <= 0)
+        return 1.0;
+
+    return static_cast<double>(pixel_size.width()) / bounds.size.width;
+}
+
+Rect scaleRect(const CGRect& rect, double scale)
+{
+    return Rect::makeLTRB(static_cast<int32_t>(std::floor(CGRectGetMinX(rect) * scale)),
+                          static_cast<int32_t>(std::floor(CGRectGetMinY(rect) * scale)),
+                          static_cast<int32_t>(std::ceil(CGRectGetMaxX(rect) * scale)),
+                          static_cast<int32_t>(std::ceil(CGRectGetMaxY(rect) * scale)));
+}
+
+} // namespace
+
+// State shared between the capturer and the display stream handler. The handler is called on a
+// dispatch queue and may outlive the capturer until the stream is fully stopped.
+struct ScreenCapturerMac::StreamState
+{
+    StreamState()
+        : queue(dispatch_queue_create("aspia.screen_capturer", DISPATCH_QUEUE_SERIAL))
+    {
+        // Nothing
+    }
+
+    ~StreamState()
+    {
+        releaseSurface();
+        dispatch_release(queue);
+    }
+
+    void releaseSurface()
+    {
+        if (!surface)
+            return;
+
+        IOSurfaceDecrementUseCount(surface);
+        CFRelease(surface);
+        surface = nullptr;
+    }
+
+    dispatch_queue_t queue;
+    double scale = 1.0;
+
+    std::mutex lock;
+
+    // The last surface delivered by the stream and not yet taken by the capturer.
+    IOSurfaceRef surface = nullptr;
+
+    // Region changed since the last call of captureFrame().
+    Region dirty_region;
+
+    // Called with the first surface after a call of captureFrame(). It is cleared before the
+    // stream is stopped, so it is not called after the capturer is destroyed.
+    FrameCallback frame_callback;
+    bool frame_notified = false;
+
+    // The stream was stopped by the OS.
+    bool stopped = false;
+};
+
 ScreenCapturerMac::ScreenCapturerMac()
     : ScreenCapturer(ScreenCapturer::Type::MACOSX)
 {
     // Nothing
 }
 
-ScreenCapturerMac::~ScreenCapturerMac() = default;
+ScreenCapturerMac::~ScreenCapturerMac()
+{
+    stopStream();
+}
 
 int ScreenCapturerMac::screenCount()
 {
-    NOTIMPLEMENTED();
-    return 0;
+    uint32_t count = 0;
+
+    if (CGGetActiveDisplayList(0, nullptr, &count) != kCGErrorSuccess)
+        return 0;
+
+    return static_cast<int>(count);
 }
 
-bool ScreenCapturerMac::screenList(ScreenList* /* screens */)
+bool ScreenCapturerMac::screenList(ScreenList* screens)
 {
-    NOTIMPLEMENTED();
-    return false;
+    DCHECK(screens);
+
+    const CGDirectDisplayID main_display = CGMainDisplayID();
+
+    for (const auto& display_id : activeDisplays())
+    {
+        screens->push_back({ static_cast<ScreenId>(display_id),
+                             numberToString(display_id),
+                             display_id == main_display });
+    }
+
+    return true;
 }
 
-bool ScreenCapturerMac::selectScreen(ScreenId /* screen_id */)
+bool ScreenCapturerMac::selectScreen(ScreenId screen_id)
 {
-    NOTIMPLEMENTED();
-    return false;
+    if (screen_id != kFullDesktopScreenId)
+    {
+        bool found = false;
+
+        for (const auto& display_id : activeDisplays())
+        {
+            if (static_cast<ScreenId>(display_id) == screen_id)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            LOG(LS_WARNING) << "Invalid screen id: " << screen_id;
+            return false;
+        }
+    }
+
+    current_screen_id_ = screen_id;
+
+    // At next screen capture, the stream is recreated for the new display.
+    stopStream();
+    return true;
 }
 
 const Frame* ScreenCapturerMac::captureFrame(Error* error)
 {
     DCHECK(error);
-    NOTIMPLEMENTED();
-    *error = Error::PERMANENT;
-    return nullptr;
+
+    if (stream_)
+    {
+        bool stopped;
+        {
+            std::scoped_lock lock(state_->lock);
+            stopped = state_->stopped;
+        }
+
+        if (stopped)
+        {
+            LOG(LS_INFO) << "Display stream stopped";
+            stopStream();
+        }
+    }
+
+    if (!stream_ && !startStream())
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    IOSurfaceRef surface = nullptr;
+    Region dirty_region;
+
+    {
+        std::scoped_lock lock(state_->lock);
+
+        surface = state_->surface;
+        state_->surface = nullptr;
+
+        dirty_region.swap(&state_->dirty_region);
+        state_->frame_notified = false;
+    }
+
+    if (surface)
+    {
+        const bool first_frame = !frame_;
+
+        frame_ = FrameIOSurface::wrap(surface);
+
+        IOSurfaceDecrementUseCount(surface);
+        CFRelease(surface);
+
+        if (!frame_)
+        {
+            *error = Error::TEMPORARY;
+            return nullptr;
+        }
+
+        frame_->setCapturerType(static_cast<uint32_t>(type()));
+        frame_->setTopLeft(top_left_);
+        frame_->setDpi(dpi_);
+
+        const Rect frame_rect = Rect::makeSize(frame_->size());
+
+        if (first_frame)
+        {
+            frame_->updatedRegion()->setRect(frame_rect);
+        }
+        else
+        {
+            dirty_region.intersectWith(frame_rect);
+            frame_->updatedRegion()->swap(&dirty_region);
+        }
+    }
+    else if (frame_)
+    {
+        // The screen has not changed since the previous call.
+        frame_->updatedRegion()->clear();
+    }
+    else
+    {
+        // The stream has not delivered the first frame yet.
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    *error = Error::SUCCEEDED;
+    return frame_.get();
+}
+
+void ScreenCapturerMac::setFrameCallback(FrameCallback callback)
+{
+    frame_callback_ = std::move(callback);
+
+    if (state_)
+    {
+        std::scoped_lock lock(state_->lock);
+        state_->frame_callback = frame_callback_;
+    }
+}
+
+bool ScreenCapturerMac::isFrameDriven() const
+{
+    // The stream is started by captureFrame(), until then the capturer is polled.
+    return stream_ != nullptr && frame_callback_ != nullptr;
 }
 
 void ScreenCapturerMac::reset()
 {
-    NOTIMPLEMENTED();
+    stopStream();
+}
+
+bool ScreenCapturerMac::startStream()
+{
+    DCHECK(!stream_);
+
+    const CGDirectDisplayID display_id = selectedDisplay();
+    const Size size = pixelSize(display_id);
+    if (size.isEmpty())
+    {
+        LOG(LS_WARNING) << "Unable to get size of display " << display_id;
+        return false;
+    }
+
+    std::shared_ptr<StreamState> state = std::make_shared<StreamState>();
+    state->scale = pixelScale(display_id, size);
+    state->frame_callback = frame_callback_;
+
+    // The cursor is captured separately.
+    const void* keys[] = { kCGDisplayStreamShowCursor };
+    const void* values[] = { kCFBooleanFalse };
+
+    CFDictionaryRef properties = CFDictionaryCreate(
+        kCFAllocatorDefault, keys, values, 1,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+
+    CGDisplayStreamFrameAvailableHandler handler =
+        ^(CGDisplayStreamFrameStatus status,
+          uint64_t /* display_time */,
+          IOSurfaceRef frame_surface,
+          CGDisplayStreamUpdateRef update_ref)
+    {
+        if (status == kCGDisplayStreamFrameStatusStopped)
+        {
+            // The display was reconfigured. The next capture starts a new stream.
+            std::scoped_lock lock(state->lock);
+            state->stopped = true;
+
+            if (state->frame_callback && !state->frame_notified)
+            {
+                state->frame_notified = true;
+                state->frame_callback();
+            }
+            return;
+        }
+
+        if (status != kCGDisplayStreamFrameStatusFrameComplete || !frame_surface)
+            return;
+
+        size_t count = 0;
+        const CGRect* rects = CGDisplayStreamUpdateGetRects(
+            update_ref, kCGDisplayStreamUpdateDirtyRects, &count);
+
+        std::scoped_lock lock(state->lock);
+
+        // If the previous surface was not taken it is simply replaced. Its dirty rects remain in
+        // the accumulated region.
+        state->releaseSurface();
+
+        CFRetain(frame_surface);
+        IOSurfaceIncrementUseCount(frame_surface);
+        state->surface = frame_surface;
+
+        for (size_t i = 0; i < count; ++i)
+            state->dirty_region.addRect(scaleRect(rects[i], state->scale));
+
+        // The consumer is notified once until it takes the surface.
+        if (state->frame_callback && !state->frame_notified)
+        {
+            state->frame_notified = true;
+            state->frame_callback();
+        }
+    };
+
+    stream_ = CGDisplayStreamCreateWithDispatchQueue(
+        display_id, size.width(), size.height(), 'BGRA', properties, state->queue, handler);
+    CFRelease(properties);
+
+    if (!stream_)
+    {
+        LOG(LS_WARNING) << "CGDisplayStreamCreateWithDispatchQueue failed";
+        return false;
+    }
+
+    CGError error = CGDisplayStreamStart(stream_);
+    if (error != kCGErrorSuccess)
+    {
+        LOG(LS_WARNING) << "CGDisplayStreamStart failed: " << error;
+        CFRelease(stream_);
+        stream_ = nullptr;
+        return false;
+    }
+
+    const CGRect bounds = CGDisplayBounds(display_id);
+    const CGSize screen_size_mm = CGDisplayScreenSize(display_id);
+
+    static const int kDefaultDpi = 96;
+
+    int dpi_x = kDefaultDpi;
+    int dpi_y = kDefaultDpi;
+
+    if (screen_size_mm.width > 0 && screen_size_mm.height > 0)
+    {
+        dpi_x = static_cast<int>(size.width() * 25.4 / screen_size_mm.width);
+        dpi_y = static_cast<int>(size.height() * 25.4 / screen_size_mm.height);
+    }
+
+    top_left_ = Point(static_cast<int32_t>(bounds.origin.x * state->scale),
+                      static_cast<int32_t>(bounds.origin.y * state->scale));
+    dpi_ = Point(dpi_x, dpi_y);
+
+    LOG(LS_INFO) << "Display stream started (display: " << display_id << ", size: " << size
+                 << ", scale: " << state->scale << ")";
+
+    state_ = std::move(state);
+    return true;
+}
+
+void ScreenCapturerMac::stopStream()
+{
+    frame_.reset();
+
+    if (!stream_)
+        return;
+
+    {
+        std::scoped_lock lock(state_->lock);
+        state_->frame_callback = nullptr;
+    }
+
+    CGDisplayStreamStop(stream_);
+    CFRelease(stream_);
+    stream_ = nullptr;
+
+    // The handler keeps its own reference to the state until the stream is released.
+    state_.reset();
+}
+
+CGDirectDisplayID ScreenCapturerMac::selectedDisplay() const
+{
+    // A display stream captures a single display. The full desktop is captured as the main display.
+    if (current_screen_id_ == kFullDesktopScreenId)
+        return CGMainDisplayID();
+
+    return static_cast<CGDirectDisplayID>(current_screen_id_);
 }
 
 } // namespace base
@@ -19,10 +19,14 @@
 #include "base/desktop/screen_capturer_wrapper.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/desktop/cursor_capturer.h"
 #include "base/desktop/desktop_environment.h"
+#include "base/desktop/frame_simple.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/power_save_blocker.h"
+#include "base/desktop/shared_memory_frame.h"
+#include "base/desktop/window_tracker.h"
 #include "base/ipc/shared_memory_factory.h"
 
 #if defined(OS_WIN)
@@ -31,15 +35,62 @@
 #include "base/desktop/screen_capturer_gdi.h"
 #include "base/win/windows_version.h"
 #elif defined(OS_LINUX)
-// TODO
+#include "base/desktop/cursor_capturer_x11.h"
+#include "base/desktop/screen_capturer_x11.h"
 #elif defined(OS_MAC)
-// TODO
+#include "base/desktop/cursor_capturer_mac.h"
+#include "base/desktop/screen_capturer_mac.h"
 #else
 #error Platform support not implemented
 #endif
 
+#include <cstring>
+
 namespace base {
 
+namespace {
+
+// The list of windows changes constantly, it is checked for the changes with this interval.
+constexpr std::chrono::seconds kWindowListInterval(3);
+
+bool isSameList(const ScreenCapturer::ScreenList& first, const ScreenCapturer::ScreenList& second)
+{
+    if (first.size() != second.size())
+        return false;
+
+    for (size_t i = 0; i < first.size(); ++i)
+    {
+        if (first[i].id != second[i].id || first[i].title != second[i].title)
+            return false;
+    }
+
+    return true;
+}
+
+bool intersects(const Region& region, const Rect& rect)
+{
+    Region intersection(rect);
+    intersection.intersectWith(region);
+    return !intersection.isEmpty();
+}
+
+void fillBlack(Frame* frame, const Region& region)
+{
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        uint8_t* data = frame->frameDataAtPos(rect.topLeft());
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            memset(data, 0, static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel);
+            data += frame->stride();
+        }
+    }
+}
+
+} // namespace
+
 ScreenCapturerWrapper::ScreenCapturerWrapper(ScreenCapturer::Type preferred_type,
                                              Delegate* delegate)
     : preferred_type_(preferred_type),
@@ -68,17 +119,13 @@ void ScreenCapturerWrapper::selectScreen(ScreenCapturer::ScreenId screen_id)
     {
         LOG(LS_INFO) << "Screen " << screen_id << " selected";
 
-        ScreenCapturer::ScreenList screens;
+        current_screen_ = screen_id;
+        window_id_ = ScreenCapturer::kInvalidScreenId;
+        window_frames_.reset();
+        window_updates_.clear();
+        window_mask_.clear();
 
-        if (screen_capturer_->screenList(&screens))
-        {
-            LOG(LS_INFO) << "Received an updated list of screens";
-            delegate_->onScreenListChanged(screens, screen_id);
-        }
-        else
-        {
-            LOG(LS_ERROR) << "ScreenCapturer::screenList failed";
-        }
+        sendScreenList();
     }
     else
     {
@@ -86,9 +133,45 @@ void ScreenCapturerWrapper::selectScreen(ScreenCapturer::ScreenId screen_id)
     }
 }
 
+void ScreenCapturerWrapper::selectWindow(ScreenCapturer::ScreenId window_id)
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+    LOG(LS_INFO) << "Try to select window: " << window_id;
+
+    if (!window_tracker_)
+        window_tracker_ = std::make_unique<WindowTracker>();
+
+    Rect window_rect;
+    if (!window_tracker_->windowRect(window_id, &window_rect))
+    {
+        LOG(LS_ERROR) << "Window " << window_id << " NOT found";
+        return;
+    }
+
+    // The window may be moved to any screen.
+    if (!screen_capturer_->selectScreen(ScreenCapturer::kFullDesktopScreenId))
+    {
+        LOG(LS_ERROR) << "ScreenCapturer::selectScreen failed";
+        return;
+    }
+
+    LOG(LS_INFO) << "Window " << window_id << " selected";
+
+    current_screen_ = ScreenCapturer::kInvalidScreenId;
+    window_id_ = window_id;
+    window_rect_ = Rect();
+    window_frames_.reset();
+    window_updates_.clear();
+    window_mask_.clear();
+
+    sendScreenList();
+}
+
 void ScreenCapturerWrapper::captureFrame()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+    TRACE_EVENT("capture", "ScreenCapturerWrapper::captureFrame");
 
     if (!screen_capturer_)
     {
@@ -104,12 +187,23 @@ void ScreenCapturerWrapper::captureFrame()
         LOG(LS_INFO) << "Screen count changed: " << count;
 
         screen_count_ = count;
-        selectScreen(defaultScreen());
+
+        if (window_id_ != ScreenCapturer::kInvalidScreenId)
+            selectWindow(window_id_);
+        else
+            selectScreen(defaultScreen());
     }
 
+    if (std::chrono::steady_clock::now() - windows_time_ >= kWindowListInterval)
+        updateWindowList();
+
     ScreenCapturer::Error error;
     const Frame* frame = screen_capturer_->captureFrame(&error);
-    if (!frame)
+    if (frame && window_id_ != ScreenCapturer::kInvalidScreenId)
+    {
+        frame = cropToWindow(frame);
+    }
+    else if (!frame)
     {
         switch (error)
         {
@@ -129,24 +223,73 @@ void ScreenCapturerWrapper::captureFrame()
     delegate_->onScreenCaptured(frame, cursor_capturer_->captureCursor());
 }
 
+bool ScreenCapturerWrapper::isFrameDriven() const
+{
+    return screen_capturer_ && screen_capturer_->isFrameDriven();
+}
+
+bool ScreenCapturerWrapper::cursorPosition(Point* position)
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+    if (!cursor_capturer_)
+        return false;
+
+    return cursor_capturer_->cursorPosition(position);
+}
+
 void ScreenCapturerWrapper::setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory)
 {
+    shared_memory_factory_ = shared_memory_factory;
     screen_capturer_->setSharedMemoryFactory(shared_memory_factory);
+
+    // The frames of the window must be allocated by the new factory.
+    window_frames_.reset();
 }
 
 void ScreenCapturerWrapper::enableWallpaper(bool enable)
 {
-    environment_->setWallpaper(enable);
+    if (environment_)
+        environment_->setWallpaper(enable);
 }
 
 void ScreenCapturerWrapper::enableEffects(bool enable)
 {
-    environment_->setEffects(enable);
+    if (environment_)
+        environment_->setEffects(enable);
 }
 
 void ScreenCapturerWrapper::enableFontSmoothing(bool enable)
 {
-    environment_->setFontSmoothing(enable);
+    if (environment_)
+        environment_->setFontSmoothing(enable);
+}
+
+void ScreenCapturerWrapper::setActive(bool active)
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+    if (active == (power_save_blocker_ != nullptr))
+        return;
+
+    LOG(LS_INFO) << "Screen capturer " << (active ? "activated" : "deactivated");
+
+    if (active)
+    {
+#if defined(OS_WIN)
+        // If the monitor is turned off, this call will turn it on.
+        SetThreadExecutionState(ES_DISPLAY_REQUIRED);
+#endif // defined(OS_WIN)
+
+        power_save_blocker_ = std::make_unique<PowerSaveBlocker>();
+        environment_ = std::make_unique<DesktopEnvironment>();
+    }
+    else
+    {
+        // The wallpaper and the effects are restored.
+        environment_.reset();
+        power_save_blocker_.reset();
+    }
 }
 
 ScreenCapturer::ScreenId ScreenCapturerWrapper::defaultScreen()
@@ -198,12 +341,24 @@ void ScreenCapturerWrapper::selectCapturer()
     }
 
 #elif defined(OS_LINUX)
-    NOTIMPLEMENTED();
+    cursor_capturer_ = std::make_unique<CursorCapturerX11>();
+
+    LOG(LS_INFO) << "Using X11 capturer";
+    screen_capturer_ = std::make_unique<ScreenCapturerX11>();
 #elif defined(OS_MAC)
-    NOTIMPLEMENTED();
+    cursor_capturer_ = std::make_unique<CursorCapturerMac>();
+
+    LOG(LS_INFO) << "Using CGDisplayStream capturer";
+    screen_capturer_ = std::make_unique<ScreenCapturerMac>();
 #else
     NOTIMPLEMENTED();
 #endif
+
+    // The delegate outlives the wrapper, and the capturer does not call the callback after it is
+    // destroyed.
+    Delegate* delegate = delegate_;
+    if (screen_capturer_)
+        screen_capturer_->setFrameCallback([delegate]() { delegate->onFrameAvailable(); });
 }
 
 void ScreenCapturerWrapper::switchToInputDesktop()
@@ -228,4 +383,191 @@ void ScreenCapturerWrapper::switchToInputDesktop()
 #endif // defined(OS_WIN)
 }
 
+void ScreenCapturerWrapper::sendScreenList()
+{
+    ScreenCapturer::ScreenList screens;
+    if (!screen_capturer_->screenList(&screens))
+    {
+        LOG(LS_ERROR) << "ScreenCapturer::screenList failed";
+        return;
+    }
+
+    if (!window_tracker_)
+        window_tracker_ = std::make_unique<WindowTracker>();
+
+    windows_.clear();
+    if (!window_tracker_->windowList(&windows_))
+        LOG(LS_WARNING) << "WindowTracker::windowList failed";
+
+    windows_time_ = std::chrono::steady_clock::now();
+
+    LOG(LS_INFO) << "Received an updated list of screens (windows: " << windows_.size() << ")";
+    delegate_->onScreenListChanged(screens, current_screen_, windows_, window_id_);
+}
+
+void ScreenCapturerWrapper::updateWindowList()
+{
+    if (!window_tracker_)
+        window_tracker_ = std::make_unique<WindowTracker>();
+
+    windows_time_ = std::chrono::steady_clock::now();
+
+    ScreenCapturer::ScreenList windows;
+    if (!window_tracker_->windowList(&windows) || isSameList(windows, windows_))
+        return;
+
+    sendScreenList();
+}
+
+const Frame* ScreenCapturerWrapper::cropToWindow(const Frame* screen_frame)
+{
+    DCHECK_NE(window_id_, ScreenCapturer::kInvalidScreenId);
+
+    Rect window_rect;
+    if (!window_tracker_->windowRect(window_id_, &window_rect))
+    {
+        LOG(LS_INFO) << "Window " << window_id_ << " closed";
+        selectScreen(defaultScreen());
+        return nullptr;
+    }
+
+    window_rect.translate(-screen_frame->topLeft().x(), -screen_frame->topLeft().y());
+    window_rect.intersectWith(Rect::makeSize(screen_frame->size()));
+
+    if (window_rect.isEmpty())
+    {
+        // The window is minimized or is out of the desktop. The last frame is repeated unchanged.
+        // The changes of the desktop are not tracked meanwhile, so the window is copied completely
+        // when it appears again.
+        window_rect_ = Rect();
+
+        Frame* last_frame = window_frames_.currentFrame();
+        if (last_frame)
+        {
+            last_frame->updatedRegion()->clear();
+            last_frame->setCopyRect(Rect(), Point());
+        }
+        return last_frame;
+    }
+
+    window_frames_.moveToNextFrame();
+
+    Frame* frame = window_frames_.currentFrame();
+    bool full_copy = window_rect != window_rect_;
+
+    if (!frame || frame->size() != window_rect.size())
+    {
+        std::unique_ptr<Frame> new_frame;
+
+        if (shared_memory_factory_)
+            new_frame = SharedMemoryFrame::create(window_rect.size(), shared_memory_factory_);
+        else
+            new_frame = FrameSimple::create(window_rect.size());
+
+        if (!new_frame)
+        {
+            LOG(LS_WARNING) << "Failed to create window frame";
+            window_frames_.reset();
+            window_updates_.clear();
+            return nullptr;
+        }
+
+        window_frames_.replaceCurrentFrame(std::move(new_frame));
+        frame = window_frames_.currentFrame();
+        full_copy = true;
+    }
+
+    window_rect_ = window_rect;
+
+    // The other windows above the window are masked out, they must not be shared with it. If they
+    // can not be determined, the whole window is masked.
+    Region mask;
+    std::vector<Rect> occluding_rects;
+
+    if (window_tracker_->occludingRects(window_id_, &occluding_rects))
+    {
+        const Point offset = screen_frame->topLeft().add(window_rect.topLeft());
+
+        for (const auto& rect : occluding_rects)
+            mask.addRect(rect.translated(-offset.x(), -offset.y()));
+
+        mask.intersectWith(Rect::makeSize(window_rect.size()));
+    }
+    else
+    {
+        mask.setRect(Rect::makeSize(window_rect.size()));
+    }
+
+    Region* updated_region = frame->updatedRegion();
+
+    if (full_copy)
+    {
+        // The window is moved or resized. The whole window is sent and the previous frames of the
+        // queue are outdated completely.
+        updated_region->setRect(Rect::makeSize(window_rect.size()));
+        frame->copyPixelsFrom(*screen_frame, window_rect.topLeft(), Rect::makeSize(frame->size()));
+    }
+    else
+    {
+        updated_region->clear();
+        updated_region->addRegion(screen_frame->constUpdatedRegion());
+        updated_region->intersectWith(window_rect);
+        updated_region->translate(-window_rect.x(), -window_rect.y());
+        updated_region->subtract(mask);
+
+        // The areas which are masked or uncovered since the previous frame.
+        Region mask_changes(mask);
+        mask_changes.addRegion(window_mask_);
+
+        Region unchanged_mask(mask);
+        unchanged_mask.intersectWith(window_mask_);
+        mask_changes.subtract(unchanged_mask);
+
+        updated_region->addRegion(mask_changes);
+
+        Region copy_region(*updated_region);
+        for (const auto& region : window_updates_)
+            copy_region.addRegion(region);
+
+        for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+        {
+            frame->copyPixelsFrom(
+                *screen_frame, it.rect().topLeft().add(window_rect.topLeft()), it.rect());
+        }
+    }
+
+    fillBlack(frame, mask);
+    window_mask_ = mask;
+
+    window_updates_.push_back(*updated_region);
+    while (window_updates_.size() > static_cast<size_t>(ScreenCapturer::kFrameQueueLength - 1))
+        window_updates_.pop_front();
+
+    // The copy of an area is kept only if both of its positions are inside the window and none of
+    // them is masked.
+    const Rect& copy_rect = screen_frame->copyRect();
+    const Rect copy_source = Rect::makeXYWH(screen_frame->copySource(), copy_rect.size());
+
+    if (!full_copy && !copy_rect.isEmpty() &&
+        window_rect.containsRect(copy_rect) && window_rect.containsRect(copy_source) &&
+        !intersects(mask, copy_rect.translated(-window_rect.x(), -window_rect.y())) &&
+        !intersects(mask, copy_source.translated(-window_rect.x(), -window_rect.y())))
+    {
+        frame->setCopyRect(copy_rect.translated(-window_rect.x(), -window_rect.y()),
+                           screen_frame->copySource().subtract(window_rect.topLeft()));
+    }
+    else
+    {
+        frame->setCopyRect(Rect(), Point());
+    }
+
+    frame->setTopLeft(screen_frame->topLeft().add(window_rect.topLeft()));
+    frame->setDpi(screen_frame->dpi());
+    frame->setCapturerType(screen_frame->capturerType());
+    frame->setCaptureTime(screen_frame->captureTime());
+    frame->setDiffTime(screen_frame->diffTime());
+
+    return frame;
+}
+
 } // namespace base
@@ -23,6 +23,9 @@
 #include "base/threading/thread_checker.h"
 #include "build/build_config.h"
 
+#include <chrono>
+#include <deque>
+
 #if defined(OS_WIN)
 #include "base/win/scoped_thread_desktop.h"
 #elif defined(OS_LINUX)
@@ -34,6 +37,7 @@ class CursorCapturer;
 class DesktopEnvironment;
 class MouseCursor;
 class PowerSaveBlocker;
+class WindowTracker;
 
 class ScreenCapturerWrapper
 {
@@ -43,25 +47,56 @@ public:
     public:
         virtual ~Delegate() = default;
 
-        virtual void onScreenListChanged(
-            const ScreenCapturer::ScreenList& list, ScreenCapturer::ScreenId current) = 0;
+        // |current_screen| is kInvalidScreenId while a window is shared. |current_window| is
+        // kInvalidScreenId while a screen is shared.
+        virtual void onScreenListChanged(const ScreenCapturer::ScreenList& screens,
+                                         ScreenCapturer::ScreenId current_screen,
+                                         const ScreenCapturer::ScreenList& windows,
+                                         ScreenCapturer::ScreenId current_window) = 0;
         virtual void onScreenCaptured(const Frame* frame, const MouseCursor* mouse_cursor) = 0;
+
+        // Called on any thread when a frame driven capturer has a new frame (see
+        // isFrameDriven()). The delegate calls captureFrame() on the thread of the wrapper.
+        virtual void onFrameAvailable() {}
     };
 
     ScreenCapturerWrapper(ScreenCapturer::Type preferred_type, Delegate* delegate);
     ~ScreenCapturerWrapper();
 
     void selectScreen(ScreenCapturer::ScreenId screen_id);
+
+    // Shares a single window of an application instead of a screen. The full desktop is captured
+    // and the frames are cropped to the window, so the frames, their updated regions and the
+    // encoded video shrink with the window. The other windows above it are masked out with black.
+    // If the window is closed, the default screen is selected again.
+    void selectWindow(ScreenCapturer::ScreenId window_id);
+
     void captureFrame();
+
+    // Returns true if the delegate is notified of the new frames with onFrameAvailable(), so the
+    // unchanged screen does not have to be polled.
+    bool isFrameDriven() const;
+
+    // Gets the position of the cursor in the coordinates of the virtual screen. It does not
+    // capture the screen, so it may be called between the captures.
+    bool cursorPosition(Point* position);
+
     void setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory);
     void enableWallpaper(bool enable);
     void enableEffects(bool enable);
     void enableFontSmoothing(bool enable);
 
+    // An inactive wrapper keeps the capturer initialized, but does not keep the display on and does
+    // not change the desktop environment. The wrapper is active after creation.
+    void setActive(bool active);
+
 private:
     ScreenCapturer::ScreenId defaultScreen();
     void selectCapturer();
     void switchToInputDesktop();
+    void sendScreenList();
+    void updateWindowList();
+    const Frame* cropToWindow(const Frame* screen_frame);
 
     ScreenCapturer::Type preferred_type_;
     Delegate* delegate_;
@@ -71,6 +106,26 @@ private:
 #endif // defined(OS_WIN)
 
     int screen_count_ = 0;
+    ScreenCapturer::ScreenId current_screen_ = ScreenCapturer::kFullDesktopScreenId;
+
+    SharedMemoryFactory* shared_memory_factory_ = nullptr;
+
+    // The window is shared if |window_id_| is valid.
+    std::unique_ptr<WindowTracker> window_tracker_;
+    ScreenCapturer::ScreenList windows_;
+    std::chrono::steady_clock::time_point windows_time_;
+    ScreenCapturer::ScreenId window_id_ = ScreenCapturer::kInvalidScreenId;
+
+    // Position of the window in the previous frame in the coordinates of the captured desktop.
+    Rect window_rect_;
+    ScreenCapturer::FrameQueue<Frame> window_frames_;
+
+    // Updated regions of the previous window frames. The frame of the queue is written again only
+    // after |kFrameQueueLength - 1| other frames, so these regions are outdated in it.
+    std::deque<Region> window_updates_;
+
+    // Areas of the other windows above the window in the previous window frame.
+    Region window_mask_;
 
     std::unique_ptr<PowerSaveBlocker> power_save_blocker_;
     std::unique_ptr<DesktopEnvironment> environment_;
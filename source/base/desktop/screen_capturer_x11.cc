@@ -19,46 +19,672 @@
 #include "base/desktop/screen_capturer_x11.h"
 
 #include "base/logging.h"
+#include "base/desktop/differ.h"
+#include "base/desktop/shared_memory_frame.h"
+#include "base/ipc/shared_memory.h"
+
+#include <cstring>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xrandr.h>
 
 namespace base {
 
+namespace {
+
+// X errors are asynchronous and by default terminate the process. While the trap is alive, the
+// errors are recorded instead.
+class ScopedXErrorTrap
+{
+public:
+    explicit ScopedXErrorTrap(Display* display)
+        : display_(display)
+    {
+        XSync(display_, False);
+        last_error_code_ = Success;
+        original_handler_ = XSetErrorHandler(&ScopedXErrorTrap::errorHandler);
+    }
+
+    ~ScopedXErrorTrap()
+    {
+        if (enabled_)
+            XSetErrorHandler(original_handler_);
+    }
+
+    // Returns the last error code and stops trapping.
+    int lastErrorAndStop()
+    {
+        DCHECK(enabled_);
+
+        XSync(display_, False);
+        XSetErrorHandler(original_handler_);
+        enabled_ = false;
+        return last_error_code_;
+    }
+
+private:
+    static int errorHandler(Display* /* display */, XErrorEvent* error_event)
+    {
+        last_error_code_ = error_event->error_code;
+        return 0;
+    }
+
+    static int last_error_code_;
+
+    Display* display_;
+    XErrorHandler original_handler_;
+    bool enabled_ = true;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedXErrorTrap);
+};
+
+int ScopedXErrorTrap::last_error_code_ = Success;
+
+// MIT-SHM segment attached to the X server and wrapped into a pixmap. Owns the memory of a
+// SharedMemoryFrame.
+class XShmSegment : public SharedMemoryBase
+{
+public:
+    ~XShmSegment() override;
+
+    static std::unique_ptr<XShmSegment> create(
+        Display* display, Drawable drawable, int depth, const Size& size);
+
+    // SharedMemoryBase implementation.
+    void* data() override { return shm_info_.shmaddr; }
+    PlatformHandle handle() const override { return shm_info_.shmid; }
+    int id() const override { return shm_info_.shmid; }
+
+    Pixmap pixmap() const { return pixmap_; }
+
+private:
+    explicit XShmSegment(Display* display);
+
+    Display* display_;
+    XShmSegmentInfo shm_info_;
+    bool attached_ = false;
+    Pixmap pixmap_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(XShmSegment);
+};
+
+XShmSegment::XShmSegment(Display* display)
+    : display_(display)
+{
+    memset(&shm_info_, 0, sizeof(shm_info_));
+    shm_info_.shmid = -1;
+    shm_info_.shmaddr = reinterpret_cast<char*>(-1);
+}
+
+XShmSegment::~XShmSegment()
+{
+    if (pixmap_)
+        XFreePixmap(display_, pixmap_);
+
+    if (attached_)
+    {
+        XShmDetach(display_, &shm_info_);
+        XSync(display_, False);
+    }
+
+    if (shm_info_.shmaddr != reinterpret_cast<char*>(-1))
+        shmdt(shm_info_.shmaddr);
+}
+
+// static
+std::unique_ptr<XShmSegment> XShmSegment::create(
+    Display* display, Drawable drawable, int depth, const Size& size)
+{
+    std::unique_ptr<XShmSegment> segment(new XShmSegment(display));
+
+    const size_t buffer_size = size.width() * size.height() * Frame::kBytesPerPixel;
+
+    segment->shm_info_.shmid = shmget(IPC_PRIVATE, buffer_size, IPC_CREAT | 0600);
+    if (segment->shm_info_.shmid == -1)
+    {
+        PLOG(LS_WARNING) << "shmget failed";
+        return nullptr;
+    }
+
+    segment->shm_info_.shmaddr = reinterpret_cast<char*>(shmat(segment->shm_info_.shmid, 0, 0));
+    segment->shm_info_.readOnly = False;
+
+    // The segment is destroyed after the last detach. We never open it anywhere else, so mark it
+    // for removal right away to not leak it if the process crashes.
+    shmctl(segment->shm_info_.shmid, IPC_RMID, 0);
+
+    if (segment->shm_info_.shmaddr == reinterpret_cast<char*>(-1))
+    {
+        PLOG(LS_WARNING) << "shmat failed";
+        return nullptr;
+    }
+
+    {
+        ScopedXErrorTrap error_trap(display);
+
+        segment->attached_ = XShmAttach(display, &segment->shm_info_);
+        if (error_trap.lastErrorAndStop() != Success)
+            segment->attached_ = false;
+    }
+
+    if (!segment->attached_)
+    {
+        LOG(LS_WARNING) << "XShmAttach failed";
+        return nullptr;
+    }
+
+    {
+        ScopedXErrorTrap error_trap(display);
+
+        segment->pixmap_ = XShmCreatePixmap(display, drawable, segment->shm_info_.shmaddr,
+                                            &segment->shm_info_, size.width(), size.height(),
+                                            depth);
+        if (error_trap.lastErrorAndStop() != Success)
+        {
+            // The pixmap id is not valid.
+            segment->pixmap_ = 0;
+        }
+    }
+
+    if (!segment->pixmap_)
+    {
+        LOG(LS_WARNING) << "XShmCreatePixmap failed";
+        return nullptr;
+    }
+
+    return segment;
+}
+
+bool isFormatSupported(Display* display, Visual* visual, int depth)
+{
+    // The frame memory is BGRA (little-endian ARGB) with 4 bytes per pixel and without padding.
+    if (visual->red_mask != 0xFF0000 || visual->green_mask != 0xFF00 || visual->blue_mask != 0xFF)
+        return false;
+
+    if (ImageByteOrder(display) != LSBFirst)
+        return false;
+
+    int count = 0;
+    XPixmapFormatValues* formats = XListPixmapFormats(display, &count);
+    if (!formats)
+        return false;
+
+    bool result = false;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (formats[i].depth == depth)
+        {
+            result = formats[i].bits_per_pixel == Frame::kBitsPerPixel &&
+                     formats[i].scanline_pad == Frame::kBitsPerPixel;
+            break;
+        }
+    }
+
+    XFree(formats);
+    return result;
+}
+
+} // namespace
+
 ScreenCapturerX11::ScreenCapturerX11()
     : ScreenCapturer(ScreenCapturer::Type::LINUX_X11)
 {
     // Nothing
 }
 
-ScreenCapturerX11::~ScreenCapturerX11() = default;
+ScreenCapturerX11::~ScreenCapturerX11()
+{
+    deinitXlib();
+}
 
 int ScreenCapturerX11::screenCount()
 {
-    NOTIMPLEMENTED();
-    return 0;
+    if (!display_ && !init())
+        return 0;
+
+    processPendingXEvents();
+    return static_cast<int>(monitors_.size());
 }
 
-bool ScreenCapturerX11::screenList(ScreenList* /* screens */)
+bool ScreenCapturerX11::screenList(ScreenList* screens)
 {
-    NOTIMPLEMENTED();
-    return false;
+    DCHECK(screens);
+
+    if (!display_ && !init())
+        return false;
+
+    processPendingXEvents();
+
+    for (size_t i = 0; i < monitors_.size(); ++i)
+    {
+        const Monitor& monitor = monitors_[i];
+        screens->push_back({ static_cast<ScreenId>(i), monitor.title, monitor.is_primary });
+    }
+
+    return true;
 }
 
-bool ScreenCapturerX11::selectScreen(ScreenId /* screen_id */)
+bool ScreenCapturerX11::selectScreen(ScreenId screen_id)
 {
-    NOTIMPLEMENTED();
-    return false;
+    if (screen_id != kFullDesktopScreenId &&
+        (screen_id < 0 || screen_id >= static_cast<ScreenId>(monitors_.size())))
+    {
+        LOG(LS_WARNING) << "Invalid screen id: " << screen_id;
+        return false;
+    }
+
+    current_screen_id_ = screen_id;
+
+    // At next screen capture, the frames are recreated.
+    queue_.reset();
+    full_refresh_ = true;
+    return true;
 }
 
 const Frame* ScreenCapturerX11::captureFrame(Error* error)
 {
     DCHECK(error);
-    NOTIMPLEMENTED();
-    *error = Error::PERMANENT;
-    return nullptr;
+
+    if (!display_ && !init())
+    {
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    processPendingXEvents();
+
+    const Frame* frame = captureImage();
+    if (!frame)
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    *error = Error::SUCCEEDED;
+    return frame;
 }
 
 void ScreenCapturerX11::reset()
 {
-    NOTIMPLEMENTED();
+    queue_.reset();
+    differ_.reset();
+    full_refresh_ = true;
+}
+
+bool ScreenCapturerX11::init()
+{
+    DCHECK(!display_);
+
+    display_ = XOpenDisplay(nullptr);
+    if (!display_)
+    {
+        LOG(LS_WARNING) << "XOpenDisplay failed";
+        return false;
+    }
+
+    root_window_ = RootWindow(display_, DefaultScreen(display_));
+
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(display_, root_window_, &attributes))
+    {
+        LOG(LS_WARNING) << "XGetWindowAttributes failed";
+        deinitXlib();
+        return false;
+    }
+
+    depth_ = attributes.depth;
+
+    if (!isFormatSupported(display_, attributes.visual, depth_))
+    {
+        LOG(LS_WARNING) << "Unsupported pixel format (depth: " << depth_ << ")";
+        deinitXlib();
+        return false;
+    }
+
+    int major = 0;
+    int minor = 0;
+    Bool have_pixmaps = False;
+
+    if (!XShmQueryVersion(display_, &major, &minor, &have_pixmaps) || !have_pixmaps ||
+        XShmPixmapFormat(display_) != ZPixmap)
+    {
+        LOG(LS_WARNING) << "MIT-SHM pixmaps are not supported by the X server";
+        deinitXlib();
+        return false;
+    }
+
+    LOG(LS_INFO) << "Using MIT-SHM extension v" << major << "." << minor;
+
+    // Copy the contents of all child windows (IncludeInferiors) into pixmaps.
+    XGCValues gc_values;
+    gc_values.subwindow_mode = IncludeInferiors;
+    gc_values.graphics_exposures = False;
+
+    gc_ = XCreateGC(display_, root_window_, GCSubwindowMode | GCGraphicsExposures, &gc_values);
+    if (!gc_)
+    {
+        LOG(LS_WARNING) << "XCreateGC failed";
+        deinitXlib();
+        return false;
+    }
+
+    int error_base = 0;
+    if (XRRQueryExtension(display_, &randr_event_base_, &error_base))
+    {
+        has_randr_ = true;
+        XRRSelectInput(display_, root_window_, RRScreenChangeNotifyMask);
+    }
+    else
+    {
+        LOG(LS_INFO) << "X server does not support XRandR";
+    }
+
+    initXDamage();
+    updateMonitors();
+    return true;
+}
+
+void ScreenCapturerX11::initXDamage()
+{
+    int error_base = 0;
+    if (!XDamageQueryExtension(display_, &damage_event_base_, &error_base))
+    {
+        LOG(LS_INFO) << "X server does not support XDamage";
+        return;
+    }
+
+    // XFixes is required to fetch the damaged region.
+    int major = 0;
+    int minor = 0;
+    if (!XFixesQueryVersion(display_, &major, &minor))
+    {
+        LOG(LS_INFO) << "X server does not support XFixes";
+        return;
+    }
+
+    damage_handle_ = XDamageCreate(display_, root_window_, XDamageReportNonEmpty);
+    if (!damage_handle_)
+    {
+        LOG(LS_WARNING) << "XDamageCreate failed";
+        return;
+    }
+
+    damage_region_ = XFixesCreateRegion(display_, nullptr, 0);
+    if (!damage_region_)
+    {
+        XDamageDestroy(display_, damage_handle_);
+        damage_handle_ = 0;
+
+        LOG(LS_WARNING) << "XFixesCreateRegion failed";
+        return;
+    }
+
+    LOG(LS_INFO) << "Using XDamage extension";
+    use_damage_ = true;
+}
+
+void ScreenCapturerX11::deinitXlib()
+{
+    // The frames hold pixmaps of the display.
+    queue_.reset();
+    differ_.reset();
+
+    if (!display_)
+        return;
+
+    if (damage_region_)
+    {
+        XFixesDestroyRegion(display_, damage_region_);
+        damage_region_ = 0;
+    }
+
+    if (damage_handle_)
+    {
+        XDamageDestroy(display_, damage_handle_);
+        damage_handle_ = 0;
+    }
+
+    if (gc_)
+    {
+        XFreeGC(display_, gc_);
+        gc_ = nullptr;
+    }
+
+    XCloseDisplay(display_);
+    display_ = nullptr;
+
+    use_damage_ = false;
+    has_randr_ = false;
+    full_refresh_ = true;
+}
+
+void ScreenCapturerX11::processPendingXEvents()
+{
+    bool screen_changed = false;
+
+    // Damage events only signal that the damage region is not empty. The region itself is fetched
+    // at the time of capture.
+    const int events_count = XPending(display_);
+    for (int i = 0; i < events_count; ++i)
+    {
+        XEvent event;
+        XNextEvent(display_, &event);
+
+        if (has_randr_ && event.type == randr_event_base_ + RRScreenChangeNotify)
+        {
+            XRRUpdateConfiguration(&event);
+            screen_changed = true;
+        }
+    }
+
+    if (screen_changed)
+    {
+        LOG(LS_INFO) << "Screen configuration changed";
+
+        updateMonitors();
+
+        if (current_screen_id_ >= static_cast<ScreenId>(monitors_.size()))
+            current_screen_id_ = kFullDesktopScreenId;
+
+        queue_.reset();
+        full_refresh_ = true;
+    }
+}
+
+void ScreenCapturerX11::updateMonitors()
+{
+    monitors_.clear();
+
+    desktop_rect_ = Rect::makeWH(WidthOfScreen(DefaultScreenOfDisplay(display_)),
+                                 HeightOfScreen(DefaultScreenOfDisplay(display_)));
+
+    const int width_mm = WidthMMOfScreen(DefaultScreenOfDisplay(display_));
+    const int height_mm = HeightMMOfScreen(DefaultScreenOfDisplay(display_));
+
+    static const int kDefaultDpi = 96;
+
+    dpi_ = Point(width_mm ? (desktop_rect_.width() * 254 / (width_mm * 10)) : kDefaultDpi,
+                 height_mm ? (desktop_rect_.height() * 254 / (height_mm * 10)) : kDefaultDpi);
+
+    if (!has_randr_)
+        return;
+
+    int count = 0;
+    XRRMonitorInfo* monitors = XRRGetMonitors(display_, root_window_, True, &count);
+    if (!monitors)
+        return;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Monitor monitor;
+        monitor.rect = Rect::makeXYWH(monitors[i].x, monitors[i].y,
+                                      monitors[i].width, monitors[i].height);
+        monitor.is_primary = monitors[i].primary;
+
+        char* name = XGetAtomName(display_, monitors[i].name);
+        if (name)
+        {
+            monitor.title = name;
+            XFree(name);
+        }
+
+        monitor.rect.intersectWith(desktop_rect_);
+        if (monitor.rect.isEmpty())
+            continue;
+
+        monitors_.emplace_back(std::move(monitor));
+    }
+
+    XRRFreeMonitors(monitors);
+}
+
+Rect ScreenCapturerX11::selectedRect() const
+{
+    if (current_screen_id_ == kFullDesktopScreenId)
+        return desktop_rect_;
+
+    return monitors_[current_screen_id_].rect;
+}
+
+std::unique_ptr<Frame> ScreenCapturerX11::createFrame(const Size& size)
+{
+    std::unique_ptr<XShmSegment> segment =
+        XShmSegment::create(display_, root_window_, depth_, size);
+    if (!segment)
+        return nullptr;
+
+    return SharedMemoryFrame::attach(size, std::move(segment));
+}
+
+const Frame* ScreenCapturerX11::captureImage()
+{
+    queue_.moveToNextFrame();
+
+    const Rect screen_rect = selectedRect();
+    if (screen_rect.isEmpty())
+    {
+        LOG(LS_WARNING) << "Empty screen rect";
+        return nullptr;
+    }
+
+    if (!queue_.currentFrame() || queue_.currentFrame()->size() != screen_rect.size())
+    {
+        std::unique_ptr<Frame> frame = createFrame(screen_rect.size());
+        if (!frame)
+        {
+            LOG(LS_WARNING) << "Failed to create frame buffer";
+            return nullptr;
+        }
+
+        frame->setCapturerType(static_cast<uint32_t>(type()));
+        queue_.replaceCurrentFrame(std::move(frame));
+
+        // The new buffer has no content at all.
+        full_refresh_ = true;
+    }
+
+    Frame* current = queue_.currentFrame();
+    Frame* previous = queue_.previousFrame();
+
+    const Rect frame_rect = Rect::makeSize(screen_rect.size());
+
+    current->setTopLeft(screen_rect.topLeft());
+    current->setDpi(dpi_);
+
+    if (!previous || previous->size() != current->size())
+        full_refresh_ = true;
+
+    if (use_damage_)
+    {
+        Region damage;
+
+        // Fetch the damage accumulated since the previous capture and reset it.
+        XDamageSubtract(display_, damage_handle_, 0, damage_region_);
+
+        int rects_count = 0;
+        XRectangle* rects = XFixesFetchRegion(display_, damage_region_, &rects_count);
+        if (rects)
+        {
+            for (int i = 0; i < rects_count; ++i)
+            {
+                damage.addRect(Rect::makeXYWH(
+                    rects[i].x, rects[i].y, rects[i].width, rects[i].height));
+            }
+
+            XFree(rects);
+        }
+
+        damage.translate(-screen_rect.x(), -screen_rect.y());
+        damage.intersectWith(frame_rect);
+
+        if (full_refresh_)
+        {
+            copyScreenRegion(current, Region(frame_rect));
+
+            current->updatedRegion()->setRect(frame_rect);
+            current->setCopyRect(Rect(), Point());
+            full_refresh_ = false;
+            return current;
+        }
+
+        // The current buffer holds the frame captured two frames ago. Besides the new damage, it
+        // misses the area updated in the previous frame.
+        Region copy_region(damage);
+        copy_region.addRegion(previous->constUpdatedRegion());
+
+        copyScreenRegion(current, copy_region);
+
+        current->updatedRegion()->swap(&damage);
+        scroll_detector_.detect(*previous, current);
+        return current;
+    }
+
+    copyScreenRegion(current, Region(frame_rect));
+
+    if (full_refresh_)
+    {
+        differ_ = std::make_unique<Differ>(screen_rect.size());
+        current->updatedRegion()->setRect(frame_rect);
+        current->setCopyRect(Rect(), Point());
+        full_refresh_ = false;
+    }
+    else
+    {
+        differ_->calcDirtyRegion(previous->frameData(),
+                                 current->frameData(),
+                                 current->updatedRegion());
+        scroll_detector_.detect(*previous, current);
+    }
+
+    return current;
+}
+
+void ScreenCapturerX11::copyScreenRegion(Frame* frame, const Region& region)
+{
+    XShmSegment* segment = static_cast<XShmSegment*>(frame->sharedMemory());
+    DCHECK(segment);
+
+    const Point& offset = frame->topLeft();
+
+    // The X server copies the pixels directly into the frame memory.
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+
+        XCopyArea(display_, root_window_, segment->pixmap(), gc_,
+                  rect.x() + offset.x(), rect.y() + offset.y(),
+                  rect.width(), rect.height(),
+                  rect.x(), rect.y());
+    }
+
+    // Wait until the copying is complete.
+    XSync(display_, False);
 }
 
 } // namespace base
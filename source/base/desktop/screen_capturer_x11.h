@@ -20,9 +20,22 @@
 #define BASE__DESKTOP__SCREEN_CAPTURER_X11_H
 
 #include "base/desktop/screen_capturer.h"
+#include "base/desktop/scroll_detector.h"
+
+#include <vector>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xdamage.h>
 
 namespace base {
 
+class Differ;
+
+// Captures the X11 root window. The frame buffers are MIT-SHM segments that are shared with the
+// X server as pixmaps, so the server copies the pixels directly into the frame memory and the
+// capturer never touches them. If the XDamage extension is available, only the damaged areas are
+// copied and the damage is used as the updated region of the frame. Otherwise the whole screen is
+// copied and the updated region is calculated with |Differ|.
 class ScreenCapturerX11 : public ScreenCapturer
 {
 public:
@@ -40,6 +53,53 @@ protected:
     void reset() override;
 
 private:
+    struct Monitor
+    {
+        Rect rect;
+        std::string title;
+        bool is_primary;
+    };
+
+    bool init();
+    void initXDamage();
+    void deinitXlib();
+
+    void processPendingXEvents();
+    void updateMonitors();
+
+    Rect selectedRect() const;
+    std::unique_ptr<Frame> createFrame(const Size& size);
+    const Frame* captureImage();
+
+    // Copies |region| of the screen (in frame coordinates) to the |frame|.
+    void copyScreenRegion(Frame* frame, const Region& region);
+
+    Display* display_ = nullptr;
+    Window root_window_ = 0;
+    GC gc_ = nullptr;
+    int depth_ = 0;
+
+    bool has_randr_ = false;
+    int randr_event_base_ = 0;
+
+    bool use_damage_ = false;
+    Damage damage_handle_ = 0;
+    int damage_event_base_ = 0;
+    XserverRegion damage_region_ = 0;
+
+    // Set when the next captured frame must be copied in full (after the start or a change of the
+    // screen configuration).
+    bool full_refresh_ = true;
+
+    std::vector<Monitor> monitors_;
+    ScreenId current_screen_id_ = kFullDesktopScreenId;
+    Rect desktop_rect_;
+    Point dpi_;
+
+    std::unique_ptr<Differ> differ_;
+    ScrollDetector scroll_detector_;
+    FrameQueue<Frame> queue_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerX11);
 };
 
@@ -0,0 +1,232 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/scroll_detector.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// A smaller area is cheaper to encode than to search.
+const int kMinScrollWidth = 64;
+const int kMinScrollHeight = 32;
+
+// The shift of the copy rect must be confirmed by this number of the unique rows.
+const int kMinVotes = 4;
+
+constexpr uint64_t kHashMultiplier1 = 0x87c37b91114253d5ULL;
+constexpr uint64_t kHashMultiplier2 = 0x4cf5ad432745937fULL;
+
+uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t hashRow(const uint8_t* row, size_t size)
+{
+    uint64_t hash = size;
+    size_t offset = 0;
+
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, row + offset, sizeof(word));
+
+        hash ^= rotateLeft(word * kHashMultiplier1, 31) * kHashMultiplier2;
+        hash = rotateLeft(hash, 27) * 5 + 0x52dce729;
+    }
+
+    // A row of an odd width ends with a single pixel.
+    if (offset < size)
+    {
+        uint32_t pixel;
+        memcpy(&pixel, row + offset, sizeof(pixel));
+
+        hash ^= rotateLeft(pixel * kHashMultiplier1, 31) * kHashMultiplier2;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+bool equalRows(const Frame& prev_frame, const Frame& curr_frame, const Rect& rect, int offset,
+               int y)
+{
+    return memcmp(prev_frame.frameDataAtPos(rect.left(), y - offset),
+                  curr_frame.frameDataAtPos(rect.left(), y),
+                  static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel) == 0;
+}
+
+} // namespace
+
+ScrollDetector::ScrollDetector() = default;
+
+ScrollDetector::~ScrollDetector() = default;
+
+void ScrollDetector::detect(const Frame& prev_frame, Frame* curr_frame)
+{
+    DCHECK(curr_frame);
+    DCHECK_EQ(prev_frame.size(), curr_frame->size());
+
+    curr_frame->setCopyRect(Rect(), Point());
+
+    const Region& updated_region = curr_frame->constUpdatedRegion();
+    if (updated_region.isEmpty())
+        return;
+
+    // A scrolled view usually changes as a whole, but its scroll bar or a status line may change
+    // too. So both the bounds of the updated region and its largest rectangle are tried.
+    auto area = [](const Rect& rect)
+    {
+        return static_cast<int64_t>(rect.width()) * rect.height();
+    };
+
+    Rect bounds;
+    Rect largest_rect;
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        bounds.unionWith(rect);
+
+        if (area(rect) > area(largest_rect))
+            largest_rect = rect;
+    }
+
+    Rect copy_rect;
+    int offset = 0;
+
+    detectInRect(prev_frame, *curr_frame, bounds, &copy_rect, &offset);
+
+    Rect largest_copy_rect;
+    int largest_offset = 0;
+
+    if (largest_rect != bounds &&
+        detectInRect(prev_frame, *curr_frame, largest_rect, &largest_copy_rect, &largest_offset) &&
+        area(largest_copy_rect) > area(copy_rect))
+    {
+        copy_rect = largest_copy_rect;
+        offset = largest_offset;
+    }
+
+    if (copy_rect.isEmpty())
+        return;
+
+    curr_frame->setCopyRect(copy_rect, Point(copy_rect.left(), copy_rect.top() - offset));
+}
+
+bool ScrollDetector::detectInRect(const Frame& prev_frame, const Frame& curr_frame,
+                                  const Rect& rect, Rect* copy_rect, int* offset)
+{
+    if (rect.width() < kMinScrollWidth || rect.height() < kMinScrollHeight)
+        return false;
+
+    hashRows(prev_frame, rect, &prev_hashes_);
+    hashRows(curr_frame, rect, &curr_hashes_);
+
+    prev_rows_.clear();
+    for (int i = 0; i < rect.height(); ++i)
+    {
+        auto result = prev_rows_.emplace(prev_hashes_[i], i);
+        if (!result.second)
+            result.first->second = -1;
+    }
+
+    // The rows which are the same as the previous ones (e.g. the empty lines) do not vote.
+    votes_.clear();
+    for (int i = 0; i < rect.height(); ++i)
+    {
+        if (i > 0 && curr_hashes_[i] == curr_hashes_[i - 1])
+            continue;
+
+        auto result = prev_rows_.find(curr_hashes_[i]);
+        if (result == prev_rows_.end() || result->second < 0 || result->second == i)
+            continue;
+
+        ++votes_[i - result->second];
+    }
+
+    int best_offset = 0;
+    int best_votes = 0;
+
+    for (const auto& vote : votes_)
+    {
+        if (vote.second > best_votes ||
+            (vote.second == best_votes && std::abs(vote.first) < std::abs(best_offset)))
+        {
+            best_offset = vote.first;
+            best_votes = vote.second;
+        }
+    }
+
+    if (best_votes < kMinVotes)
+        return false;
+
+    // The longest run of the rows shifted by the offset. Both the row and its source must be
+    // inside the rectangle.
+    const int first = std::max(0, best_offset);
+    const int last = std::min(rect.height(), rect.height() + best_offset);
+
+    int best_start = 0;
+    int best_length = 0;
+    int start = first;
+
+    for (int i = first; i <= last; ++i)
+    {
+        const bool matched = i < last && curr_hashes_[i] == prev_hashes_[i - best_offset] &&
+            equalRows(prev_frame, curr_frame, rect, best_offset, rect.top() + i);
+        if (matched)
+            continue;
+
+        if (i - start > best_length)
+        {
+            best_start = start;
+            best_length = i - start;
+        }
+
+        start = i + 1;
+    }
+
+    if (best_length < kMinScrollHeight)
+        return false;
+
+    *copy_rect = Rect::makeXYWH(rect.left(), rect.top() + best_start, rect.width(), best_length);
+    *offset = best_offset;
+    return true;
+}
+
+void ScrollDetector::hashRows(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes)
+{
+    const size_t row_size = static_cast<size_t>(rect.width()) * Frame::kBytesPerPixel;
+
+    hashes->resize(static_cast<size_t>(rect.height()));
+
+    for (int i = 0; i < rect.height(); ++i)
+        (*hashes)[i] = hashRow(frame.frameDataAtPos(rect.left(), rect.top() + i), row_size);
+}
+
+} // namespace base
@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__SCROLL_DETECTOR_H
+#define BASE__DESKTOP__SCROLL_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Finds the vertical scrolls for the capturers which do not get the move rects from the OS.
+// The rows of the updated area of both frames are hashed. The unique rows of the current frame
+// which are found in the previous frame at another position vote for a shift, and the longest run
+// of the rows shifted by the winning offset becomes the copy rect of the frame (see
+// Frame::setCopyRect()). The rows of the run are compared completely, the hashes only select the
+// candidates.
+class ScrollDetector
+{
+public:
+    ScrollDetector();
+    ~ScrollDetector();
+
+    // Sets the copy rect of |curr_frame| in its updated region, or clears it if no scroll is
+    // found. |prev_frame| must have the same size.
+    void detect(const Frame& prev_frame, Frame* curr_frame);
+
+private:
+    bool detectInRect(const Frame& prev_frame, const Frame& curr_frame, const Rect& rect,
+                      Rect* copy_rect, int* offset);
+    void hashRows(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes);
+
+    std::vector<uint64_t> prev_hashes_;
+    std::vector<uint64_t> curr_hashes_;
+
+    // The row of the previous frame for each hash, or -1 if the hash is not unique.
+    std::unordered_map<uint64_t, int> prev_rows_;
+
+    // Number of the rows which vote for each offset.
+    std::unordered_map<int, int> votes_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScrollDetector);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__SCROLL_DETECTOR_H
@@ -0,0 +1,127 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/scroll_detector.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(320, 240);
+
+// Each row of the document has its own pixels.
+void drawDocument(Frame* frame, const Rect& view, int first_line)
+{
+    for (int y = view.top(); y < view.bottom(); ++y)
+    {
+        const uint32_t line = static_cast<uint32_t>(first_line + y - view.top());
+
+        for (int x = view.left(); x < view.right(); ++x)
+        {
+            const uint32_t pixel = (line * 2654435761u) ^ (static_cast<uint32_t>(x) * 40503u);
+            memcpy(frame->frameDataAtPos(x, y), &pixel, sizeof(pixel));
+        }
+    }
+}
+
+} // namespace
+
+TEST(ScrollDetectorTest, scroll_down)
+{
+    std::unique_ptr<Frame> prev_frame = FrameSimple::create(kFrameSize);
+    std::unique_ptr<Frame> curr_frame = FrameSimple::create(kFrameSize);
+
+    const Rect view = Rect::makeXYWH(20, 30, 200, 180);
+    drawDocument(prev_frame.get(), view, 0);
+    drawDocument(curr_frame.get(), view, 25);
+
+    curr_frame->updatedRegion()->setRect(view);
+
+    ScrollDetector detector;
+    detector.detect(*prev_frame, curr_frame.get());
+
+    // The content moves up by 25 rows. The last rows of the view are new.
+    EXPECT_EQ(curr_frame->copyRect(), Rect::makeXYWH(20, 30, 200, 155));
+    EXPECT_EQ(curr_frame->copySource(), Point(20, 55));
+}
+
+TEST(ScrollDetectorTest, scroll_up_with_scroll_bar)
+{
+    std::unique_ptr<Frame> prev_frame = FrameSimple::create(kFrameSize);
+    std::unique_ptr<Frame> curr_frame = FrameSimple::create(kFrameSize);
+
+    const Rect view = Rect::makeXYWH(0, 0, 280, 240);
+    drawDocument(prev_frame.get(), view, 100);
+    drawDocument(curr_frame.get(), view, 60);
+
+    // The scroll bar at the right of the view has changed too.
+    const Rect scroll_bar = Rect::makeXYWH(300, 0, 20, 240);
+    memset(prev_frame->frameDataAtPos(300, 10), 0xFF, 20 * Frame::kBytesPerPixel);
+    memset(curr_frame->frameDataAtPos(300, 200), 0xFF, 20 * Frame::kBytesPerPixel);
+
+    curr_frame->updatedRegion()->setRect(view);
+    curr_frame->updatedRegion()->addRect(scroll_bar);
+
+    ScrollDetector detector;
+    detector.detect(*prev_frame, curr_frame.get());
+
+    // The whole row does not match, only the view.
+    EXPECT_EQ(curr_frame->copyRect(), Rect::makeXYWH(0, 40, 280, 200));
+    EXPECT_EQ(curr_frame->copySource(), Point(0, 0));
+}
+
+TEST(ScrollDetectorTest, no_scroll)
+{
+    std::unique_ptr<Frame> prev_frame = FrameSimple::create(kFrameSize);
+    std::unique_ptr<Frame> curr_frame = FrameSimple::create(kFrameSize);
+
+    const Rect view = Rect::makeSize(kFrameSize);
+    drawDocument(prev_frame.get(), view, 0);
+    drawDocument(curr_frame.get(), view, 1000);
+
+    curr_frame->updatedRegion()->setRect(view);
+    curr_frame->setCopyRect(view, Point());
+
+    ScrollDetector detector;
+    detector.detect(*prev_frame, curr_frame.get());
+    EXPECT_TRUE(curr_frame->copyRect().isEmpty());
+
+    // The flat areas match at any offset and are not taken for a scroll.
+    memset(prev_frame->frameData(), 0x80, prev_frame->stride() * kFrameSize.height());
+    memset(curr_frame->frameData(), 0x80, curr_frame->stride() * kFrameSize.height());
+    memset(curr_frame->frameDataAtPos(0, 100), 0, kFrameSize.width() * Frame::kBytesPerPixel);
+
+    detector.detect(*prev_frame, curr_frame.get());
+    EXPECT_TRUE(curr_frame->copyRect().isEmpty());
+
+    // A small area is not searched.
+    drawDocument(prev_frame.get(), Rect::makeXYWH(0, 0, 32, 240), 0);
+    drawDocument(curr_frame.get(), Rect::makeXYWH(0, 0, 32, 240), 10);
+    curr_frame->updatedRegion()->setRect(Rect::makeXYWH(0, 0, 32, 240));
+
+    detector.detect(*prev_frame, curr_frame.get());
+    EXPECT_TRUE(curr_frame->copyRect().isEmpty());
+}
+
+} // namespace base
@@ -42,7 +42,7 @@ std::unique_ptr<Frame> SharedMemoryFrame::create(
 {
     const size_t buffer_size = calcMemorySize(size, kBytesPerPixel);
 
-    std::unique_ptr<SharedMemory> shared_memory = shared_memory_factory->create(buffer_size);
+    std::unique_ptr<SharedMemoryBase> shared_memory = shared_memory_factory->create(buffer_size);
     if (!shared_memory)
         return nullptr;
 
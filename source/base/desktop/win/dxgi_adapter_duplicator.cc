@@ -150,7 +150,8 @@ void DxgiAdapterDuplicator::unregister(const Context* const context)
         duplicators_[i].unregister(&context->contexts[i]);
 }
 
-bool DxgiAdapterDuplicator::duplicate(Context* context, SharedFrame* target)
+bool DxgiAdapterDuplicator::duplicate(Context* context, SharedFrame* target,
+                                      Region* target_region)
 {
     DCHECK_EQ(context->contexts.size(), duplicators_.size());
 
@@ -158,7 +159,8 @@ bool DxgiAdapterDuplicator::duplicate(Context* context, SharedFrame* target)
     {
         if (!duplicators_[i].duplicate(&context->contexts[i],
                                        duplicators_[i].desktopRect().topLeft(),
-                                       target))
+                                       target,
+                                       target_region))
         {
             return false;
         }
@@ -173,7 +175,8 @@ bool DxgiAdapterDuplicator::duplicateMonitor(Context* context, int monitor_id, S
     DCHECK_LT(monitor_id, static_cast<int>(duplicators_.size()));
     DCHECK_EQ(context->contexts.size(), duplicators_.size());
 
-    return duplicators_[monitor_id].duplicate(&context->contexts[monitor_id], Point(), target);
+    return duplicators_[monitor_id].duplicate(
+        &context->contexts[monitor_id], Point(), target, target->updatedRegion());
 }
 
 Rect DxgiAdapterDuplicator::screenRect(int id) const
@@ -48,8 +48,8 @@ public:
     bool initialize();
 
     // Sequentially calls Duplicate function of all the DxgiOutputDuplicator instances owned by
-    // this instance, and writes into |target|.
-    bool duplicate(Context* context, SharedFrame* target);
+    // this instance, and writes into |target|. The updated area is added to |target_region|.
+    bool duplicate(Context* context, SharedFrame* target, Region* target_region);
 
     // Captures one monitor and writes into |target|. |monitor_id| should be between [0, screenCount()).
     bool duplicateMonitor(Context* context, int monitor_id, SharedFrame* target);
@@ -24,6 +24,8 @@
 #include "base/desktop/win/screen_capture_utils.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 namespace base {
@@ -287,6 +289,10 @@ bool DxgiDuplicatorController::doInitialize()
 
     translateRect();
 
+    // One thread for each additional adapter.
+    if (duplicators_.size() > 1)
+        worker_pool_ = std::make_unique<WorkerPool>(static_cast<int>(duplicators_.size() - 1));
+
     HDC hdc = GetDC(nullptr);
     // Use old DPI value if failed.
     if (hdc)
@@ -308,6 +314,7 @@ bool DxgiDuplicatorController::doInitialize()
 void DxgiDuplicatorController::deinitialize()
 {
     desktop_rect_ = Rect();
+    worker_pool_.reset();
     duplicators_.clear();
     display_configuration_monitor_.reset();
 }
@@ -336,13 +343,64 @@ void DxgiDuplicatorController::setup(Context* context)
 
 bool DxgiDuplicatorController::doDuplicateAll(Context* context, SharedFrame* target)
 {
-    for (size_t i = 0; i < duplicators_.size(); ++i)
+    if (!worker_pool_)
     {
-        if (!duplicators_[i].duplicate(&context->contexts[i], target))
-            return false;
+        for (size_t i = 0; i < duplicators_.size(); ++i)
+        {
+            if (!duplicators_[i].duplicate(&context->contexts[i], target, target->updatedRegion()))
+                return false;
+        }
+
+        return true;
     }
 
-    return true;
+    // Each adapter has its own D3D device, so the adapters are duplicated in parallel: the first
+    // one on this thread and the others on the worker threads. The outputs write disjoint areas of
+    // |target|, their updated regions are merged when all of them are finished.
+    const size_t count = duplicators_.size();
+    DCHECK_EQ(static_cast<size_t>(worker_pool_->threadCount()), count - 1);
+
+    adapter_results_.resize(count);
+
+    std::mutex lock;
+    std::condition_variable finished_event;
+    size_t pending_count = count - 1;
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        worker_pool_->postTask([&, i]()
+        {
+            AdapterResult& adapter_result = adapter_results_[i];
+            adapter_result.succeeded = duplicators_[i].duplicate(
+                &context->contexts[i], target, &adapter_result.updated_region);
+
+            std::scoped_lock scoped_lock(lock);
+            if (--pending_count == 0)
+                finished_event.notify_one();
+        });
+    }
+
+    AdapterResult& first_result = adapter_results_[0];
+    first_result.succeeded = duplicators_[0].duplicate(
+        &context->contexts[0], target, &first_result.updated_region);
+
+    {
+        std::unique_lock unique_lock(lock);
+        finished_event.wait(unique_lock, [&]() { return pending_count == 0; });
+    }
+
+    bool result = true;
+
+    for (AdapterResult& adapter_result : adapter_results_)
+    {
+        if (!adapter_result.succeeded)
+            result = false;
+
+        target->updatedRegion()->addRegion(adapter_result.updated_region);
+        adapter_result.updated_region.clear();
+    }
+
+    return result;
 }
 
 bool DxgiDuplicatorController::doDuplicateOne(Context* context, int monitor_id, SharedFrame* target)
@@ -24,9 +24,11 @@
 #include "base/desktop/win/dxgi_adapter_duplicator.h"
 #include "base/desktop/win/dxgi_context.h"
 #include "base/desktop/win/dxgi_frame.h"
+#include "base/threading/worker_pool.h"
 
 #include <D3DCommon.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -188,6 +190,18 @@ private:
     Rect desktop_rect_;
     Point dpi_;
     std::vector<DxgiAdapterDuplicator> duplicators_;
+
+    // The result of the duplication of one adapter in doDuplicateAll().
+    struct AdapterResult
+    {
+        Region updated_region;
+        bool succeeded = false;
+    };
+
+    // Duplicates the adapters except the first one in parallel with it. Created only if there are
+    // several adapters.
+    std::unique_ptr<WorkerPool> worker_pool_;
+    std::vector<AdapterResult> adapter_results_;
     D3dInfo d3d_info_;
     DisplayConfigurationMonitor display_configuration_monitor_;
     // A number to indicate how many succeeded duplications have been performed.
@@ -190,11 +190,13 @@ bool DxgiOutputDuplicator::releaseFrame()
     return true;
 }
 
-bool DxgiOutputDuplicator::duplicate(Context* context, const Point& offset, SharedFrame* target)
+bool DxgiOutputDuplicator::duplicate(Context* context, const Point& offset, SharedFrame* target,
+                                     Region* target_region)
 {
     DCHECK(duplication_);
     DCHECK(texture_);
     DCHECK(target);
+    DCHECK(target_region);
 
     if (!Rect::makeSize(target->size()).containsRect(translatedDesktopRect(offset)))
     {
@@ -228,7 +230,11 @@ bool DxgiOutputDuplicator::duplicate(Context* context, const Point& offset, Shar
         detectUpdatedRegion(frame_info, &context->updated_region);
         spreadContextChange(context);
 
-        if (!texture_->copyFrom(frame_info, resource.Get()))
+        // The updated region is rotated, but the texture is not.
+        const bool copied = (rotation_ == Rotation::CLOCK_WISE_0) ?
+            texture_->copyFrom(frame_info, resource.Get(), context->updated_region) :
+            texture_->copyFrom(frame_info, resource.Get());
+        if (!copied)
             return false;
 
         updated_region.addRegion(context->updated_region);
@@ -264,7 +270,7 @@ bool DxgiOutputDuplicator::duplicate(Context* context, const Point& offset, Shar
         last_frame_offset_ = offset;
 
         updated_region.translate(offset.x(), offset.y());
-        target->updatedRegion()->addRegion(updated_region);
+        target_region->addRegion(updated_region);
         ++num_frames_captured_;
 
         return texture_->release() && releaseFrame();
@@ -289,7 +295,7 @@ bool DxgiOutputDuplicator::duplicate(Context* context, const Point& offset, Shar
         }
 
         updated_region.translate(offset.x(), offset.y());
-        target->updatedRegion()->addRegion(updated_region);
+        target_region->addRegion(updated_region);
     }
     else
     {
@@ -64,7 +64,10 @@ public:
     // this function copies the content to the rectangle of (offset.x(), offset.y()) to
     // (offset.x() + desktop_rect_.width(), offset.y() + desktop_rect_.height()).
     // Returns false in case of a failure.
-    bool duplicate(Context* context, const Point& offset, SharedFrame* target);
+    // The updated area of |target| is added to |target_region|. The outputs write disjoint areas
+    // of |target|, so they can be duplicated in parallel if each of them has its own region.
+    bool duplicate(Context* context, const Point& offset, SharedFrame* target,
+                   Region* target_region);
 
     // Returns the desktop rect covered by this DxgiOutputDuplicator.
     const Rect& desktopRect() const { return desktop_rect_; }
@@ -51,6 +51,20 @@ DxgiTexture::DxgiTexture() = default;
 DxgiTexture::~DxgiTexture() = default;
 
 bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResource* resource)
+{
+    return copyFrom(frame_info, resource, nullptr);
+}
+
+bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                           IDXGIResource* resource,
+                           const Region& updated_region)
+{
+    return copyFrom(frame_info, resource, &updated_region);
+}
+
+bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                           IDXGIResource* resource,
+                           const Region* updated_region)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(resource);
@@ -71,7 +85,7 @@ bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResou
 
     desktop_size_.set(desc.Width, desc.Height);
 
-    return copyFromTexture(frame_info, texture.Get());
+    return copyFromTexture(frame_info, texture.Get(), updated_region);
 }
 
 const Frame& DxgiTexture::asDesktopFrame()
@@ -20,6 +20,7 @@
 #define BASE__DESKTOP__WIN__DXGI_TEXTURE_H
 
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 
 #include <memory>
 
@@ -41,6 +42,13 @@ public:
     // Returns false if anything wrong.
     bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResource* resource);
 
+    // Same as above, but only |updated_region| of the frame has changed since the previous call.
+    // The implementation may copy only this region, the rest of the texture keeps the pixels of
+    // the previous frames.
+    bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                  IDXGIResource* resource,
+                  const Region& updated_region);
+
     const Size& desktopSize() const { return desktop_size_; }
     uint8_t* bits() const { return static_cast<uint8_t*>(rect_.pBits); }
     int pitch() const { return static_cast<int>(rect_.Pitch); }
@@ -59,12 +67,18 @@ public:
 protected:
     DXGI_MAPPED_RECT* rect();
 
+    // If |updated_region| is null, the entire frame has to be copied.
     virtual bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                 ID3D11Texture2D* texture) = 0;
+                                 ID3D11Texture2D* texture,
+                                 const Region* updated_region) = 0;
 
     virtual bool doRelease() = 0;
 
 private:
+    bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                  IDXGIResource* resource,
+                  const Region* updated_region);
+
     DXGI_MAPPED_RECT rect_ = { 0 };
     Size desktop_size_;
     std::unique_ptr<Frame> frame_;
@@ -35,7 +35,8 @@ DxgiTextureMapping::DxgiTextureMapping(IDXGIOutputDuplication* duplication)
 DxgiTextureMapping::~DxgiTextureMapping() = default;
 
 bool DxgiTextureMapping::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                         ID3D11Texture2D* texture)
+                                         ID3D11Texture2D* texture,
+                                         const Region* /* updated_region */)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(texture);
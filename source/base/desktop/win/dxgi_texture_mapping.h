@@ -39,7 +39,8 @@ public:
 
 protected:
     bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                         ID3D11Texture2D* texture) override;
+                         ID3D11Texture2D* texture,
+                         const Region* updated_region) override;
 
     bool doRelease() override;
 
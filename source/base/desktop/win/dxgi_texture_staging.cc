@@ -66,6 +66,7 @@ bool DxgiTextureStaging::initializeStage(ID3D11Texture2D* texture)
         // The descriptions are not consistent, we need to create a new ID3D11Texture2D instance.
         stage_.Reset();
         surface_.Reset();
+        full_copy_needed_ = true;
     }
     else
     {
@@ -106,7 +107,8 @@ void DxgiTextureStaging::assertStageAndSurfaceAreSameObject()
 }
 
 bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                         ID3D11Texture2D* texture)
+                                         ID3D11Texture2D* texture,
+                                         const Region* updated_region)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(texture);
@@ -116,8 +118,39 @@ bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_in
     if (!initializeStage(texture))
         return false;
 
-    device_.context()->CopyResource(static_cast<ID3D11Resource*>(stage_.Get()),
-                                    static_cast<ID3D11Resource*>(texture));
+    if (full_copy_needed_ || !updated_region)
+    {
+        device_.context()->CopyResource(static_cast<ID3D11Resource*>(stage_.Get()),
+                                        static_cast<ID3D11Resource*>(texture));
+        full_copy_needed_ = false;
+    }
+    else
+    {
+        // The stage is read back through the bus (PCIe for a discrete GPU), only the changed part
+        // of the desktop is transferred.
+        const Rect texture_rect = Rect::makeSize(desktopSize());
+
+        for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+        {
+            Rect rect = it.rect();
+            rect.intersectWith(texture_rect);
+            if (rect.isEmpty())
+                continue;
+
+            D3D11_BOX box;
+            box.left = rect.left();
+            box.top = rect.top();
+            box.right = rect.right();
+            box.bottom = rect.bottom();
+            box.front = 0;
+            box.back = 1;
+
+            device_.context()->CopySubresourceRegion(static_cast<ID3D11Resource*>(stage_.Get()),
+                                                     0, rect.left(), rect.top(), 0,
+                                                     static_cast<ID3D11Resource*>(texture),
+                                                     0, &box);
+        }
+    }
 
     *rect() = { 0 };
 
@@ -140,6 +173,7 @@ bool DxgiTextureStaging::doRelease()
     {
         stage_.Reset();
         surface_.Reset();
+        full_copy_needed_ = true;
     }
 
     // If using staging mode, we only need to recreate ID3D11Texture2D instance.
@@ -43,10 +43,12 @@ public:
     ~DxgiTextureStaging() override;
 
 protected:
-    // Copies selected regions of a frame represented by frame_info and texture.
-    // Returns false if anything wrong.
+    // Copies selected regions of a frame represented by frame_info and texture. The stage keeps
+    // the image between the calls, so only |updated_region| is copied from the GPU unless the stage
+    // is new. Returns false if anything wrong.
     bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                         ID3D11Texture2D* texture) override;
+                         ID3D11Texture2D* texture,
+                         const Region* updated_region) override;
 
     bool doRelease() override;
 
@@ -63,6 +65,9 @@ private:
     const D3dDevice device_;
     Microsoft::WRL::ComPtr<ID3D11Texture2D> stage_;
     Microsoft::WRL::ComPtr<IDXGISurface> surface_;
+
+    // Set if |stage_| does not contain the previous frame.
+    bool full_copy_needed_ = true;
 };
 
 } // namespace base
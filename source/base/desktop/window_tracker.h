@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__WINDOW_TRACKER_H
+#define BASE__DESKTOP__WINDOW_TRACKER_H
+
+#include "base/desktop/screen_capturer.h"
+
+#include <vector>
+
+namespace base {
+
+// Enumerates the top-level windows of the applications and tracks their position, so that a single
+// window can be shared instead of a whole screen. The window ids are the native window handles.
+class WindowTracker
+{
+public:
+    WindowTracker();
+    ~WindowTracker();
+
+    // Gets the visible top-level windows which have a title, in the Z-order from the topmost one.
+    // Returns false if the windows can not be enumerated on this system.
+    bool windowList(ScreenCapturer::ScreenList* windows);
+
+    // Gets the rectangle of the window in the coordinates of the virtual screen. The rectangle is
+    // empty while the window is minimized. Returns false if the window no longer exists.
+    bool windowRect(ScreenCapturer::ScreenId window_id, Rect* rect);
+
+    // Gets the rectangles of the visible windows above the window in the Z-order (including the
+    // menus and the notifications) in the coordinates of the virtual screen. Returns false if they
+    // can not be determined.
+    bool occludingRects(ScreenCapturer::ScreenId window_id, std::vector<Rect>* rects);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+
+    DISALLOW_COPY_AND_ASSIGN(WindowTracker);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__WINDOW_TRACKER_H
@@ -0,0 +1,214 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/window_tracker.h"
+
+#include "base/logging.h"
+
+#include <CoreGraphics/CoreGraphics.h>
+
+#include <cmath>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace base {
+
+namespace {
+
+// Returns the value of the |key| of the window description as a string.
+std::string stringValue(CFDictionaryRef window, CFStringRef key)
+{
+    CFStringRef value = reinterpret_cast<CFStringRef>(CFDictionaryGetValue(window, key));
+    if (!value || CFGetTypeID(value) != CFStringGetTypeID())
+        return std::string();
+
+    const CFIndex length = CFStringGetMaximumSizeForEncoding(
+        CFStringGetLength(value), kCFStringEncodingUTF8) + 1;
+
+    std::string result(static_cast<size_t>(length), '\0');
+    if (!CFStringGetCString(value, result.data(), length, kCFStringEncodingUTF8))
+        return std::string();
+
+    result.resize(strlen(result.c_str()));
+    return result;
+}
+
+int64_t numberValue(CFDictionaryRef window, CFStringRef key)
+{
+    CFNumberRef value = reinterpret_cast<CFNumberRef>(CFDictionaryGetValue(window, key));
+    if (!value || CFGetTypeID(value) != CFNumberGetTypeID())
+        return 0;
+
+    int64_t result = 0;
+    CFNumberGetValue(value, kCFNumberSInt64Type, &result);
+    return result;
+}
+
+// The screen capturer captures the main display as the full desktop. The window bounds are in
+// points and are converted to the pixels of the main display.
+double mainDisplayScale()
+{
+    const CGDirectDisplayID display_id = CGMainDisplayID();
+    const CGRect bounds = CGDisplayBounds(display_id);
+    if (bounds.size.width <= 0)
+        return 1.0;
+
+    double pixel_width = static_cast<double>(CGDisplayPixelsWide(display_id));
+
+    CGDisplayModeRef mode = CGDisplayCopyDisplayMode(display_id);
+    if (mode)
+    {
+        pixel_width = static_cast<double>(CGDisplayModeGetPixelWidth(mode));
+        CGDisplayModeRelease(mode);
+    }
+
+    return pixel_width / bounds.size.width;
+}
+
+Rect scaledBounds(const CGRect& bounds, double scale)
+{
+    return Rect::makeLTRB(static_cast<int32_t>(std::floor(CGRectGetMinX(bounds) * scale)),
+                          static_cast<int32_t>(std::floor(CGRectGetMinY(bounds) * scale)),
+                          static_cast<int32_t>(std::ceil(CGRectGetMaxX(bounds) * scale)),
+                          static_cast<int32_t>(std::ceil(CGRectGetMaxY(bounds) * scale)));
+}
+
+} // namespace
+
+class WindowTracker::Impl
+{
+public:
+    Impl() = default;
+};
+
+WindowTracker::WindowTracker() = default;
+
+WindowTracker::~WindowTracker() = default;
+
+bool WindowTracker::windowList(ScreenCapturer::ScreenList* windows)
+{
+    DCHECK(windows);
+
+    // The windows are returned in the Z-order from the topmost one.
+    CFArrayRef window_array = CGWindowListCopyWindowInfo(
+        kCGWindowListOptionOnScreenOnly | kCGWindowListExcludeDesktopElements, kCGNullWindowID);
+    if (!window_array)
+    {
+        LOG(LS_WARNING) << "CGWindowListCopyWindowInfo failed";
+        return false;
+    }
+
+    const pid_t current_pid = getpid();
+
+    for (CFIndex i = 0; i < CFArrayGetCount(window_array); ++i)
+    {
+        CFDictionaryRef window =
+            reinterpret_cast<CFDictionaryRef>(CFArrayGetValueAtIndex(window_array, i));
+
+        // Only the normal application windows are offered, not the menu bar or the dock.
+        if (numberValue(window, kCGWindowLayer) != 0)
+            continue;
+
+        if (numberValue(window, kCGWindowOwnerPID) == current_pid)
+            continue;
+
+        // The name of the window is available only with the screen recording permission.
+        std::string title = stringValue(window, kCGWindowName);
+        if (title.empty())
+            title = stringValue(window, kCGWindowOwnerName);
+        if (title.empty())
+            continue;
+
+        windows->push_back({ static_cast<ScreenCapturer::ScreenId>(
+                                 numberValue(window, kCGWindowNumber)),
+                             std::move(title), false });
+    }
+
+    CFRelease(window_array);
+    return true;
+}
+
+bool WindowTracker::windowRect(ScreenCapturer::ScreenId window_id, Rect* rect)
+{
+    DCHECK(rect);
+
+    CFArrayRef window_array = CGWindowListCopyWindowInfo(
+        kCGWindowListOptionIncludingWindow, static_cast<CGWindowID>(window_id));
+    if (!window_array)
+        return false;
+
+    if (CFArrayGetCount(window_array) == 0)
+    {
+        CFRelease(window_array);
+        return false;
+    }
+
+    CFDictionaryRef window =
+        reinterpret_cast<CFDictionaryRef>(CFArrayGetValueAtIndex(window_array, 0));
+
+    CFBooleanRef on_screen =
+        reinterpret_cast<CFBooleanRef>(CFDictionaryGetValue(window, kCGWindowIsOnscreen));
+    CFDictionaryRef bounds_value =
+        reinterpret_cast<CFDictionaryRef>(CFDictionaryGetValue(window, kCGWindowBounds));
+
+    CGRect bounds;
+    if (!on_screen || !CFBooleanGetValue(on_screen) || !bounds_value ||
+        !CGRectMakeWithDictionaryRepresentation(bounds_value, &bounds))
+    {
+        // The window is minimized or hidden.
+        *rect = Rect();
+    }
+    else
+    {
+        *rect = scaledBounds(bounds, mainDisplayScale());
+    }
+
+    CFRelease(window_array);
+    return true;
+}
+
+bool WindowTracker::occludingRects(ScreenCapturer::ScreenId window_id, std::vector<Rect>* rects)
+{
+    DCHECK(rects);
+
+    // All the windows above the window, including the menu bar, the dock and the menus.
+    CFArrayRef window_array = CGWindowListCopyWindowInfo(
+        kCGWindowListOptionOnScreenAboveWindow, static_cast<CGWindowID>(window_id));
+    if (!window_array)
+        return false;
+
+    const double scale = mainDisplayScale();
+
+    for (CFIndex i = 0; i < CFArrayGetCount(window_array); ++i)
+    {
+        CFDictionaryRef window =
+            reinterpret_cast<CFDictionaryRef>(CFArrayGetValueAtIndex(window_array, i));
+        CFDictionaryRef bounds_value =
+            reinterpret_cast<CFDictionaryRef>(CFDictionaryGetValue(window, kCGWindowBounds));
+
+        CGRect bounds;
+        if (bounds_value && CGRectMakeWithDictionaryRepresentation(bounds_value, &bounds))
+            rects->push_back(scaledBounds(bounds, scale));
+    }
+
+    CFRelease(window_array);
+    return true;
+}
+
+} // namespace base
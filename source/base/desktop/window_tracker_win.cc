@@ -0,0 +1,188 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/window_tracker.h"
+
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+
+#include <iterator>
+
+#include <Windows.h>
+#include <dwmapi.h>
+
+namespace base {
+
+namespace {
+
+bool isCapturableWindow(HWND window)
+{
+    if (!IsWindowVisible(window))
+        return false;
+
+    // The owned windows (dialogs, tool palettes) are shown together with their owner.
+    if (GetWindow(window, GW_OWNER))
+        return false;
+
+    const LONG ex_style = GetWindowLongW(window, GWL_EXSTYLE);
+    if (ex_style & WS_EX_TOOLWINDOW)
+        return false;
+
+    // The windows of the host itself are not offered.
+    DWORD process_id = 0;
+    GetWindowThreadProcessId(window, &process_id);
+    if (process_id == GetCurrentProcessId())
+        return false;
+
+    // The windows of the other virtual desktops and the suspended UWP applications are cloaked.
+    DWORD cloaked = 0;
+    if (SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) &&
+        cloaked)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+BOOL CALLBACK enumWindowsProc(HWND window, LPARAM lparam)
+{
+    if (!isCapturableWindow(window))
+        return TRUE;
+
+    wchar_t title[256];
+    int length = GetWindowTextW(window, title, static_cast<int>(std::size(title)));
+    if (length <= 0)
+        return TRUE;
+
+    ScreenCapturer::ScreenList* windows = reinterpret_cast<ScreenCapturer::ScreenList*>(lparam);
+    windows->push_back({ reinterpret_cast<ScreenCapturer::ScreenId>(window),
+                         utf8FromWide(std::wstring_view(title, static_cast<size_t>(length))),
+                         false });
+    return TRUE;
+}
+
+// GetWindowRect includes the invisible resize borders of Windows 10, the extended frame bounds are
+// the visible area of the window.
+bool visibleBounds(HWND window, Rect* rect)
+{
+    RECT window_rect;
+    if (FAILED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS,
+                                     &window_rect, sizeof(window_rect))))
+    {
+        if (!GetWindowRect(window, &window_rect))
+            return false;
+    }
+
+    *rect = Rect::makeLTRB(
+        window_rect.left, window_rect.top, window_rect.right, window_rect.bottom);
+    return true;
+}
+
+struct OccludingWindows
+{
+    HWND window;
+    std::vector<Rect>* rects;
+    bool found;
+};
+
+BOOL CALLBACK enumOccludingWindowsProc(HWND window, LPARAM lparam)
+{
+    OccludingWindows* occluding = reinterpret_cast<OccludingWindows*>(lparam);
+
+    if (window == occluding->window)
+    {
+        occluding->found = true;
+        return FALSE;
+    }
+
+    // Unlike the shared windows, the owned windows and the tool windows are included, they cover
+    // the window as well.
+    if (!IsWindowVisible(window) || IsIconic(window))
+        return TRUE;
+
+    DWORD cloaked = 0;
+    if (SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) &&
+        cloaked)
+    {
+        return TRUE;
+    }
+
+    Rect rect;
+    if (visibleBounds(window, &rect) && !rect.isEmpty())
+        occluding->rects->push_back(rect);
+
+    return TRUE;
+}
+
+} // namespace
+
+class WindowTracker::Impl
+{
+public:
+    Impl() = default;
+};
+
+WindowTracker::WindowTracker() = default;
+
+WindowTracker::~WindowTracker() = default;
+
+bool WindowTracker::windowList(ScreenCapturer::ScreenList* windows)
+{
+    DCHECK(windows);
+
+    // EnumWindows goes through the top-level windows in the Z-order.
+    if (!EnumWindows(enumWindowsProc, reinterpret_cast<LPARAM>(windows)))
+    {
+        PLOG(LS_WARNING) << "EnumWindows failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool WindowTracker::windowRect(ScreenCapturer::ScreenId window_id, Rect* rect)
+{
+    DCHECK(rect);
+
+    HWND window = reinterpret_cast<HWND>(window_id);
+    if (!IsWindow(window))
+        return false;
+
+    if (IsIconic(window))
+    {
+        *rect = Rect();
+        return true;
+    }
+
+    return visibleBounds(window, rect);
+}
+
+bool WindowTracker::occludingRects(ScreenCapturer::ScreenId window_id, std::vector<Rect>* rects)
+{
+    DCHECK(rects);
+
+    OccludingWindows occluding = { reinterpret_cast<HWND>(window_id), rects, false };
+
+    // EnumWindows goes through the top-level windows in the Z-order from the topmost one and
+    // stops at the window.
+    EnumWindows(enumOccludingWindowsProc, reinterpret_cast<LPARAM>(&occluding));
+    return occluding.found;
+}
+
+} // namespace base
@@ -0,0 +1,335 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/window_tracker.h"
+
+#include "base/logging.h"
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+namespace base {
+
+namespace {
+
+int last_error_code = Success;
+
+// A window may be destroyed at any moment. The requests for it must not terminate the process.
+int errorHandler(Display* /* display */, XErrorEvent* error_event)
+{
+    last_error_code = error_event->error_code;
+    return 0;
+}
+
+} // namespace
+
+class WindowTracker::Impl
+{
+public:
+    Impl();
+    ~Impl();
+
+    bool windowList(ScreenCapturer::ScreenList* windows);
+    bool windowRect(Window window, Rect* rect);
+    bool occludingRects(Window window, std::vector<Rect>* rects);
+
+private:
+    Window topLevelWindow(Window window);
+    bool property(Window window, Atom property, Atom type, std::vector<uint8_t>* data,
+                  unsigned long* count);
+    std::string windowTitle(Window window);
+    bool isHidden(Window window);
+
+    Display* display_ = nullptr;
+    Window root_window_ = 0;
+
+    Atom client_list_atom_ = None;
+    Atom wm_name_atom_ = None;
+    Atom wm_state_atom_ = None;
+    Atom wm_state_hidden_atom_ = None;
+    Atom utf8_string_atom_ = None;
+
+    DISALLOW_COPY_AND_ASSIGN(Impl);
+};
+
+WindowTracker::Impl::Impl()
+{
+    display_ = XOpenDisplay(nullptr);
+    if (!display_)
+    {
+        LOG(LS_WARNING) << "Unable to open display";
+        return;
+    }
+
+    root_window_ = RootWindow(display_, DefaultScreen(display_));
+
+    client_list_atom_ = XInternAtom(display_, "_NET_CLIENT_LIST_STACKING", False);
+    wm_name_atom_ = XInternAtom(display_, "_NET_WM_NAME", False);
+    wm_state_atom_ = XInternAtom(display_, "_NET_WM_STATE", False);
+    wm_state_hidden_atom_ = XInternAtom(display_, "_NET_WM_STATE_HIDDEN", False);
+    utf8_string_atom_ = XInternAtom(display_, "UTF8_STRING", False);
+}
+
+WindowTracker::Impl::~Impl()
+{
+    if (display_)
+        XCloseDisplay(display_);
+}
+
+bool WindowTracker::Impl::windowList(ScreenCapturer::ScreenList* windows)
+{
+    if (!display_)
+        return false;
+
+    std::vector<uint8_t> data;
+    unsigned long count = 0;
+
+    // The list is maintained by the window manager in the stacking order from the bottommost
+    // window.
+    if (!property(root_window_, client_list_atom_, XA_WINDOW, &data, &count))
+    {
+        LOG(LS_WARNING) << "The window manager does not support _NET_CLIENT_LIST_STACKING";
+        return false;
+    }
+
+    const Window* client_list = reinterpret_cast<const Window*>(data.data());
+
+    for (unsigned long i = count; i > 0; --i)
+    {
+        const Window window = client_list[i - 1];
+
+        std::string title = windowTitle(window);
+        if (title.empty())
+            continue;
+
+        windows->push_back({ static_cast<ScreenCapturer::ScreenId>(window), std::move(title),
+                             false });
+    }
+
+    return true;
+}
+
+bool WindowTracker::Impl::windowRect(Window window, Rect* rect)
+{
+    if (!display_)
+        return false;
+
+    last_error_code = Success;
+    XErrorHandler original_handler = XSetErrorHandler(errorHandler);
+
+    XWindowAttributes attributes;
+    bool result = XGetWindowAttributes(display_, window, &attributes) != 0;
+
+    Window child;
+    int x = 0;
+    int y = 0;
+
+    if (result)
+    {
+        result = XTranslateCoordinates(
+            display_, window, root_window_, 0, 0, &x, &y, &child) != 0;
+    }
+
+    XSync(display_, False);
+    XSetErrorHandler(original_handler);
+
+    if (!result || last_error_code != Success)
+        return false;
+
+    if (attributes.map_state != IsViewable || isHidden(window))
+    {
+        *rect = Rect();
+        return true;
+    }
+
+    *rect = Rect::makeXYWH(x, y, attributes.width, attributes.height);
+    return true;
+}
+
+bool WindowTracker::Impl::occludingRects(Window window, std::vector<Rect>* rects)
+{
+    if (!display_)
+        return false;
+
+    last_error_code = Success;
+    XErrorHandler original_handler = XSetErrorHandler(errorHandler);
+
+    const Window top_level = topLevelWindow(window);
+
+    Window root = 0;
+    Window parent = 0;
+    Window* children = nullptr;
+    unsigned int count = 0;
+
+    // The children of the root window are in the stacking order from the bottommost one. Unlike
+    // the list of the window manager, they also include the menus and the tooltips.
+    bool found = false;
+
+    if (top_level && XQueryTree(display_, root_window_, &root, &parent, &children, &count))
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            if (children[i] == top_level)
+            {
+                found = true;
+                continue;
+            }
+
+            if (!found)
+                continue;
+
+            // The window may be destroyed meanwhile.
+            XWindowAttributes attributes;
+            if (!XGetWindowAttributes(display_, children[i], &attributes))
+                continue;
+
+            if (attributes.map_state != IsViewable || attributes.c_class != InputOutput)
+                continue;
+
+            rects->push_back(Rect::makeXYWH(attributes.x, attributes.y,
+                                            attributes.width + 2 * attributes.border_width,
+                                            attributes.height + 2 * attributes.border_width));
+        }
+    }
+
+    if (children)
+        XFree(children);
+
+    XSync(display_, False);
+    XSetErrorHandler(original_handler);
+
+    return found;
+}
+
+Window WindowTracker::Impl::topLevelWindow(Window window)
+{
+    // The window manager reparents the client windows into its frames.
+    while (true)
+    {
+        Window root = 0;
+        Window parent = 0;
+        Window* children = nullptr;
+        unsigned int count = 0;
+
+        if (!XQueryTree(display_, window, &root, &parent, &children, &count))
+            return 0;
+
+        if (children)
+            XFree(children);
+
+        if (!parent || parent == root_window_)
+            return window;
+
+        window = parent;
+    }
+}
+
+bool WindowTracker::Impl::property(Window window, Atom property, Atom type,
+                                   std::vector<uint8_t>* data, unsigned long* count)
+{
+    last_error_code = Success;
+    XErrorHandler original_handler = XSetErrorHandler(errorHandler);
+
+    Atom actual_type = None;
+    int actual_format = 0;
+    unsigned long bytes_after = 0;
+    unsigned char* value = nullptr;
+
+    int status = XGetWindowProperty(display_, window, property, 0, ~0L, False, type,
+                                    &actual_type, &actual_format, count, &bytes_after, &value);
+
+    XSync(display_, False);
+    XSetErrorHandler(original_handler);
+
+    if (status != Success || last_error_code != Success || actual_type != type || !value)
+    {
+        if (value)
+            XFree(value);
+        return false;
+    }
+
+    // The items of 32-bit properties are stored as longs on the client side.
+    const size_t item_size = (actual_format == 32) ? sizeof(long) : (actual_format / 8);
+
+    data->assign(value, value + *count * item_size);
+    XFree(value);
+    return true;
+}
+
+std::string WindowTracker::Impl::windowTitle(Window window)
+{
+    std::vector<uint8_t> data;
+    unsigned long count = 0;
+
+    if (property(window, wm_name_atom_, utf8_string_atom_, &data, &count))
+        return std::string(data.begin(), data.end());
+
+    // The windows which do not follow EWMH have only the legacy name.
+    if (property(window, XA_WM_NAME, XA_STRING, &data, &count))
+        return std::string(data.begin(), data.end());
+
+    return std::string();
+}
+
+bool WindowTracker::Impl::isHidden(Window window)
+{
+    std::vector<uint8_t> data;
+    unsigned long count = 0;
+
+    if (!property(window, wm_state_atom_, XA_ATOM, &data, &count))
+        return false;
+
+    const Atom* states = reinterpret_cast<const Atom*>(data.data());
+
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        if (states[i] == wm_state_hidden_atom_)
+            return true;
+    }
+
+    return false;
+}
+
+WindowTracker::WindowTracker()
+    : impl_(std::make_unique<Impl>())
+{
+    // Nothing
+}
+
+WindowTracker::~WindowTracker() = default;
+
+bool WindowTracker::windowList(ScreenCapturer::ScreenList* windows)
+{
+    DCHECK(windows);
+    return impl_->windowList(windows);
+}
+
+bool WindowTracker::windowRect(ScreenCapturer::ScreenId window_id, Rect* rect)
+{
+    DCHECK(rect);
+    return impl_->windowRect(static_cast<Window>(window_id), rect);
+}
+
+bool WindowTracker::occludingRects(ScreenCapturer::ScreenId window_id, std::vector<Rect>* rects)
+{
+    DCHECK(rects);
+    return impl_->occludingRects(static_cast<Window>(window_id), rects);
+}
+
+} // namespace base
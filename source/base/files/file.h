@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__FILES__FILE_H
+#define BASE__FILES__FILE_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include "base/win/scoped_object.h"
+#endif // defined(OS_WIN)
+
+#include <filesystem>
+#include <memory>
+
+namespace base {
+
+// Platform file with positional reads and writes. Every call takes the file offset explicitly,
+// so a sequential transfer does not need a seek before each call. The methods are also a single
+// place to pass access pattern hints to the OS, which reads ahead or reserves disk space in the
+// background while the caller is busy with the network.
+class File
+{
+public:
+    ~File();
+
+    enum class Mode
+    {
+        // Opens an existing file for reading. The OS is told that it will be read sequentially.
+        READ,
+
+        // Creates a new file for writing. Fails if the file already exists.
+        CREATE,
+
+        // Creates a new file or truncates an existing one and opens it for writing.
+        CREATE_ALWAYS,
+
+        // Opens an existing file for reading and writing without truncating it or creates a new
+        // one. Used to update only the changed parts of a file.
+        OPEN_ALWAYS
+    };
+
+    enum class StorageType
+    {
+        UNKNOWN,
+
+        // SSD or other storage without a seek penalty.
+        SOLID_STATE,
+
+        // Spinning disk. Reads in different places of the disk wait for the head to move.
+        ROTATIONAL,
+
+        // Remote file system (NFS, SMB). Each read is a round trip to the server.
+        NETWORK
+    };
+
+    static std::unique_ptr<File> open(const std::filesystem::path& file_path, Mode mode);
+
+    // Returns the size of the file or -1 on error.
+    int64_t size() const;
+
+    // Reads exactly |size| bytes at |offset|. Returns false on an error or the end of the file.
+    bool read(uint64_t offset, void* buffer, size_t size);
+
+    // Writes |size| bytes at |offset|.
+    bool write(uint64_t offset, const void* data, size_t size);
+
+    // Truncates or extends the file to |size| bytes.
+    bool setSize(uint64_t size);
+
+    // Asks the OS to read the range into the cache in the background. It is only a hint.
+    void prefetch(uint64_t offset, uint64_t size);
+
+    // Reserves disk space for a file of |size| bytes. The file size does not change. It is only a
+    // hint that keeps the file from fragmenting; the result is ignored when unsupported.
+    void preallocate(uint64_t size);
+
+    // Returns the type of the storage where the file is located.
+    StorageType storageType() const;
+
+    // Gets the position of the first part of the file on the disk. The unit depends on the
+    // platform, only the order of the positions of files on the same volume is meaningful: reading
+    // the files in this order moves the head of a spinning disk in one direction. Returns false if
+    // the file system does not report it (network file systems, files stored inside the metadata
+    // of the file system, empty files).
+    bool physicalOffset(uint64_t* offset) const;
+
+private:
+#if defined(OS_WIN)
+    explicit File(win::ScopedHandle&& file);
+
+    win::ScopedHandle file_;
+#elif defined(OS_POSIX)
+    explicit File(int file);
+
+    int file_;
+#endif
+
+    DISALLOW_COPY_AND_ASSIGN(File);
+};
+
+} // namespace base
+
+#endif // BASE__FILES__FILE_H
@@ -0,0 +1,350 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file.h"
+
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(OS_LINUX)
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <sys/vfs.h>
+#elif defined(OS_MAC)
+#include <sys/mount.h>
+#endif
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX)
+
+// Magic numbers of the network file systems from linux/magic.h and the CIFS sources.
+const uint32_t kNfsSuperMagic = 0x6969;
+const uint32_t kSmbSuperMagic = 0x517B;
+const uint32_t kCifsSuperMagic = 0xFF534D42;
+const uint32_t kSmb2SuperMagic = 0xFE534D42;
+
+// Reads the flag of the block device |device| from sysfs. Partitions do not have the queue
+// parameters, they are read from the parent disk.
+bool readDeviceFlag(dev_t device, const char* name, bool* value)
+{
+    std::error_code error_code;
+
+    std::filesystem::path path = std::filesystem::canonical(
+        "/sys/dev/block/" + numberToString(major(device)) + ':' + numberToString(minor(device)),
+        error_code);
+    if (error_code)
+        return false;
+
+    if (!std::filesystem::exists(path / "queue", error_code))
+        path = path.parent_path();
+
+    int file = ::open((path / "queue" / name).c_str(), O_RDONLY | O_CLOEXEC);
+    if (file == -1)
+        return false;
+
+    char flag = 0;
+    const ssize_t ret = ::read(file, &flag, sizeof(flag));
+    close(file);
+
+    if (ret != sizeof(flag) || (flag != '0' && flag != '1'))
+        return false;
+
+    *value = flag == '1';
+    return true;
+}
+
+#endif // defined(OS_LINUX)
+
+} // namespace
+
+File::File(int file)
+    : file_(file)
+{
+    // Nothing
+}
+
+File::~File()
+{
+    close(file_);
+}
+
+// static
+std::unique_ptr<File> File::open(const std::filesystem::path& file_path, Mode mode)
+{
+    int flags = O_CLOEXEC;
+
+    switch (mode)
+    {
+        case Mode::READ:
+            flags |= O_RDONLY;
+            break;
+
+        case Mode::CREATE:
+            flags |= O_WRONLY | O_CREAT | O_EXCL;
+            break;
+
+        case Mode::CREATE_ALWAYS:
+            flags |= O_WRONLY | O_CREAT | O_TRUNC;
+            break;
+
+        case Mode::OPEN_ALWAYS:
+            flags |= O_RDWR | O_CREAT;
+            break;
+    }
+
+    int file;
+
+    do
+    {
+        file = ::open(file_path.c_str(), flags, 0666);
+    }
+    while (file == -1 && errno == EINTR);
+
+    if (file == -1)
+    {
+        PLOG(LS_WARNING) << "open failed: " << file_path;
+        return nullptr;
+    }
+
+    if (mode == Mode::READ)
+    {
+#if defined(OS_LINUX)
+        // Doubles the read-ahead window of the kernel for this file.
+        posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(OS_MAC)
+        fcntl(file, F_RDAHEAD, 1);
+#endif
+    }
+
+    return std::unique_ptr<File>(new File(file));
+}
+
+int64_t File::size() const
+{
+    struct stat file_stat;
+
+    if (fstat(file_, &file_stat) != 0)
+    {
+        PLOG(LS_WARNING) << "fstat failed";
+        return -1;
+    }
+
+    return static_cast<int64_t>(file_stat.st_size);
+}
+
+bool File::read(uint64_t offset, void* buffer, size_t size)
+{
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+
+    while (size)
+    {
+        ssize_t ret = pread(file_, out, size, static_cast<off_t>(offset));
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "pread failed";
+            return false;
+        }
+
+        if (!ret)
+        {
+            LOG(LS_WARNING) << "Unexpected end of file";
+            return false;
+        }
+
+        out += ret;
+        offset += static_cast<uint64_t>(ret);
+        size -= static_cast<size_t>(ret);
+    }
+
+    return true;
+}
+
+bool File::write(uint64_t offset, const void* data, size_t size)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+
+    while (size)
+    {
+        ssize_t ret = pwrite(file_, in, size, static_cast<off_t>(offset));
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "pwrite failed";
+            return false;
+        }
+
+        in += ret;
+        offset += static_cast<uint64_t>(ret);
+        size -= static_cast<size_t>(ret);
+    }
+
+    return true;
+}
+
+bool File::setSize(uint64_t size)
+{
+    int ret;
+
+    do
+    {
+        ret = ftruncate(file_, static_cast<off_t>(size));
+    }
+    while (ret == -1 && errno == EINTR);
+
+    if (ret == -1)
+    {
+        PLOG(LS_WARNING) << "ftruncate failed";
+        return false;
+    }
+
+    return true;
+}
+
+void File::prefetch(uint64_t offset, uint64_t size)
+{
+#if defined(OS_LINUX)
+    // Starts an asynchronous read of the range into the page cache.
+    posix_fadvise(file_, static_cast<off_t>(offset), static_cast<off_t>(size),
+                  POSIX_FADV_WILLNEED);
+#elif defined(OS_MAC)
+    struct radvisory advisory;
+    advisory.ra_offset = static_cast<off_t>(offset);
+    advisory.ra_count = static_cast<int>(size);
+
+    fcntl(file_, F_RDADVISE, &advisory);
+#endif
+}
+
+void File::preallocate(uint64_t size)
+{
+    if (!size)
+        return;
+
+#if defined(OS_LINUX)
+    fallocate(file_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#elif defined(OS_MAC)
+    fstore_t store;
+    store.fst_flags = F_ALLOCATECONTIG;
+    store.fst_posmode = F_PEOFPOSMODE;
+    store.fst_offset = 0;
+    store.fst_length = static_cast<off_t>(size);
+    store.fst_bytesalloc = 0;
+
+    if (fcntl(file_, F_PREALLOCATE, &store) == -1)
+    {
+        // There is no contiguous space. Try to allocate it in several parts.
+        store.fst_flags = F_ALLOCATEALL;
+        fcntl(file_, F_PREALLOCATE, &store);
+    }
+#endif
+}
+
+File::StorageType File::storageType() const
+{
+#if defined(OS_LINUX)
+    struct statfs fs_stat;
+    if (fstatfs(file_, &fs_stat) == 0)
+    {
+        switch (static_cast<uint32_t>(fs_stat.f_type))
+        {
+            case kNfsSuperMagic:
+            case kSmbSuperMagic:
+            case kCifsSuperMagic:
+            case kSmb2SuperMagic:
+                return StorageType::NETWORK;
+
+            default:
+                break;
+        }
+    }
+
+    struct stat file_stat;
+    if (fstat(file_, &file_stat) != 0)
+        return StorageType::UNKNOWN;
+
+    bool rotational;
+    if (!readDeviceFlag(file_stat.st_dev, "rotational", &rotational))
+        return StorageType::UNKNOWN;
+
+    return rotational ? StorageType::ROTATIONAL : StorageType::SOLID_STATE;
+#elif defined(OS_MAC)
+    struct statfs fs_stat;
+    if (fstatfs(file_, &fs_stat) == 0 && !(fs_stat.f_flags & MNT_LOCAL))
+        return StorageType::NETWORK;
+
+    return StorageType::UNKNOWN;
+#else
+    return StorageType::UNKNOWN;
+#endif
+}
+
+bool File::physicalOffset(uint64_t* offset) const
+{
+    DCHECK(offset);
+
+#if defined(OS_LINUX)
+    // Only the first extent is requested. The file is not synced, so the extents that are not
+    // allocated yet are reported with the UNKNOWN flag.
+    alignas(struct fiemap) uint8_t buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+    memset(buffer, 0, sizeof(buffer));
+
+    struct fiemap* map = reinterpret_cast<struct fiemap*>(buffer);
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    if (ioctl(file_, FS_IOC_FIEMAP, map) == -1 || !map->fm_mapped_extents)
+        return false;
+
+    const struct fiemap_extent& extent = map->fm_extents[0];
+    if (extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE))
+        return false;
+
+    *offset = extent.fe_physical;
+    return true;
+#elif defined(OS_MAC)
+    struct log2phys log_to_phys;
+    memset(&log_to_phys, 0, sizeof(log_to_phys));
+    log_to_phys.l2p_contigbytes = 1;
+
+    if (fcntl(file_, F_LOG2PHYS_EXT, &log_to_phys) == -1)
+        return false;
+
+    *offset = static_cast<uint64_t>(log_to_phys.l2p_devoffset);
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace base
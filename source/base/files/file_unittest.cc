@@ -0,0 +1,148 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+class FileTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::error_code error_code;
+        path_ = std::filesystem::temp_directory_path(error_code) / "aspia_file_test.bin";
+        std::filesystem::remove(path_, error_code);
+    }
+
+    void TearDown() override
+    {
+        std::error_code error_code;
+        std::filesystem::remove(path_, error_code);
+    }
+
+    std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST_F(FileTest, WriteAndRead)
+{
+    std::vector<uint8_t> data(100000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 31);
+
+    {
+        std::unique_ptr<File> file = File::open(path_, File::Mode::CREATE);
+        ASSERT_TRUE(file);
+
+        file->preallocate(data.size());
+
+        // The parts are written out of order.
+        EXPECT_TRUE(file->write(60000, data.data() + 60000, data.size() - 60000));
+        EXPECT_TRUE(file->write(0, data.data(), 60000));
+        EXPECT_EQ(file->size(), static_cast<int64_t>(data.size()));
+    }
+
+    std::unique_ptr<File> file = File::open(path_, File::Mode::READ);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->size(), static_cast<int64_t>(data.size()));
+
+    file->prefetch(0, data.size());
+
+    std::vector<uint8_t> buffer(data.size());
+    EXPECT_TRUE(file->read(50000, buffer.data() + 50000, data.size() - 50000));
+    EXPECT_TRUE(file->read(0, buffer.data(), 50000));
+    EXPECT_EQ(buffer, data);
+
+    // Reading past the end of the file fails.
+    EXPECT_FALSE(file->read(data.size() - 10, buffer.data(), 20));
+}
+
+TEST_F(FileTest, CreateModes)
+{
+    EXPECT_FALSE(File::open(path_, File::Mode::READ));
+
+    {
+        std::unique_ptr<File> file = File::open(path_, File::Mode::CREATE);
+        ASSERT_TRUE(file);
+
+        const char data[] = "data";
+        EXPECT_TRUE(file->write(0, data, sizeof(data)));
+    }
+
+    // The existing file is not overwritten.
+    EXPECT_FALSE(File::open(path_, File::Mode::CREATE));
+
+    std::unique_ptr<File> file = File::open(path_, File::Mode::CREATE_ALWAYS);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->size(), 0);
+}
+
+TEST_F(FileTest, UpdateInPlace)
+{
+    {
+        std::unique_ptr<File> file = File::open(path_, File::Mode::OPEN_ALWAYS);
+        ASSERT_TRUE(file);
+
+        const char data[] = "0123456789";
+        EXPECT_TRUE(file->write(0, data, 10));
+    }
+
+    std::unique_ptr<File> file = File::open(path_, File::Mode::OPEN_ALWAYS);
+    ASSERT_TRUE(file);
+
+    // The content of the existing file is kept.
+    EXPECT_EQ(file->size(), 10);
+    EXPECT_TRUE(file->write(2, "ab", 2));
+
+    char buffer[10];
+    EXPECT_TRUE(file->read(0, buffer, 10));
+    EXPECT_EQ(std::string(buffer, 10), "01ab456789");
+
+    EXPECT_TRUE(file->setSize(4));
+    EXPECT_EQ(file->size(), 4);
+    EXPECT_FALSE(file->read(0, buffer, 5));
+}
+
+TEST_F(FileTest, Location)
+{
+    {
+        std::unique_ptr<File> file = File::open(path_, File::Mode::CREATE);
+        ASSERT_TRUE(file);
+
+        // An empty file does not occupy the disk.
+        uint64_t offset;
+        EXPECT_FALSE(file->physicalOffset(&offset));
+    }
+
+    std::unique_ptr<File> file = File::open(path_, File::Mode::READ);
+    ASSERT_TRUE(file);
+
+    // The temporary directory may be on any storage. The type of one file is the same each time.
+    EXPECT_EQ(file->storageType(), file->storageType());
+}
+
+} // namespace base
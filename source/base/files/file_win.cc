@@ -0,0 +1,286 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <string>
+
+#include <winioctl.h>
+
+namespace base {
+
+namespace {
+
+OVERLAPPED overlappedForOffset(uint64_t offset)
+{
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+
+    overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    return overlapped;
+}
+
+} // namespace
+
+File::File(win::ScopedHandle&& file)
+    : file_(std::move(file))
+{
+    // Nothing
+}
+
+File::~File() = default;
+
+// static
+std::unique_ptr<File> File::open(const std::filesystem::path& file_path, Mode mode)
+{
+    DWORD desired_access;
+    DWORD share_mode;
+    DWORD creation_disposition;
+    DWORD flags;
+
+    if (mode == Mode::READ)
+    {
+        desired_access = GENERIC_READ;
+        share_mode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+        creation_disposition = OPEN_EXISTING;
+
+        // The cache manager reads ahead of the current position in the background.
+        flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    else if (mode == Mode::OPEN_ALWAYS)
+    {
+        desired_access = GENERIC_READ | GENERIC_WRITE;
+        share_mode = FILE_SHARE_READ;
+        creation_disposition = OPEN_ALWAYS;
+        flags = FILE_ATTRIBUTE_NORMAL;
+    }
+    else
+    {
+        desired_access = GENERIC_WRITE;
+        share_mode = FILE_SHARE_READ;
+        creation_disposition = (mode == Mode::CREATE) ? CREATE_NEW : CREATE_ALWAYS;
+        flags = FILE_ATTRIBUTE_NORMAL;
+    }
+
+    win::ScopedHandle file(CreateFileW(file_path.c_str(), desired_access, share_mode, nullptr,
+                                       creation_disposition, flags, nullptr));
+    if (!file.isValid())
+    {
+        PLOG(LS_WARNING) << "CreateFileW failed: " << file_path;
+        return nullptr;
+    }
+
+    return std::unique_ptr<File>(new File(std::move(file)));
+}
+
+int64_t File::size() const
+{
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(file_.get(), &file_size))
+    {
+        PLOG(LS_WARNING) << "GetFileSizeEx failed";
+        return -1;
+    }
+
+    return file_size.QuadPart;
+}
+
+bool File::read(uint64_t offset, void* buffer, size_t size)
+{
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+
+    while (size)
+    {
+        // The handle is opened for synchronous I/O. The offset in OVERLAPPED replaces a seek.
+        OVERLAPPED overlapped = overlappedForOffset(offset);
+        const DWORD to_read = static_cast<DWORD>(std::min(size, static_cast<size_t>(MAXDWORD)));
+        DWORD read = 0;
+
+        if (!ReadFile(file_.get(), out, to_read, &read, &overlapped))
+        {
+            PLOG(LS_WARNING) << "ReadFile failed";
+            return false;
+        }
+
+        if (!read)
+        {
+            LOG(LS_WARNING) << "Unexpected end of file";
+            return false;
+        }
+
+        out += read;
+        offset += read;
+        size -= read;
+    }
+
+    return true;
+}
+
+bool File::write(uint64_t offset, const void* data, size_t size)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+
+    while (size)
+    {
+        OVERLAPPED overlapped = overlappedForOffset(offset);
+        const DWORD to_write = static_cast<DWORD>(std::min(size, static_cast<size_t>(MAXDWORD)));
+        DWORD written = 0;
+
+        if (!WriteFile(file_.get(), in, to_write, &written, &overlapped))
+        {
+            PLOG(LS_WARNING) << "WriteFile failed";
+            return false;
+        }
+
+        in += written;
+        offset += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+bool File::setSize(uint64_t size)
+{
+    FILE_END_OF_FILE_INFO end_of_file_info;
+    end_of_file_info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFileInformationByHandle(
+            file_.get(), FileEndOfFileInfo, &end_of_file_info, sizeof(end_of_file_info)))
+    {
+        PLOG(LS_WARNING) << "SetFileInformationByHandle failed";
+        return false;
+    }
+
+    return true;
+}
+
+void File::prefetch(uint64_t /* offset */, uint64_t /* size */)
+{
+    // The read-ahead of the cache manager is enabled by FILE_FLAG_SEQUENTIAL_SCAN.
+}
+
+void File::preallocate(uint64_t size)
+{
+    if (!size)
+        return;
+
+    FILE_ALLOCATION_INFO allocation_info;
+    allocation_info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFileInformationByHandle(
+            file_.get(), FileAllocationInfo, &allocation_info, sizeof(allocation_info)))
+    {
+        PLOG(LS_WARNING) << "SetFileInformationByHandle failed";
+    }
+}
+
+File::StorageType File::storageType() const
+{
+    // The information about the remote protocol is available only for files on network shares.
+    FILE_REMOTE_PROTOCOL_INFO protocol_info;
+    if (GetFileInformationByHandleEx(
+            file_.get(), FileRemoteProtocolInfo, &protocol_info, sizeof(protocol_info)))
+    {
+        return StorageType::NETWORK;
+    }
+
+    // The path in the form "\\?\Volume{GUID}\directory\file".
+    std::wstring path;
+    path.resize(MAX_PATH);
+
+    DWORD length = GetFinalPathNameByHandleW(
+        file_.get(), path.data(), static_cast<DWORD>(path.size()), VOLUME_NAME_GUID);
+    if (length >= path.size())
+    {
+        path.resize(length);
+        length = GetFinalPathNameByHandleW(
+            file_.get(), path.data(), static_cast<DWORD>(path.size()), VOLUME_NAME_GUID);
+    }
+
+    if (!length || length >= path.size())
+        return StorageType::UNKNOWN;
+
+    path.resize(length);
+
+    // The volume device is opened without access rights, it is enough for the query.
+    const size_t volume_end = path.find(L'\\', 4);
+    if (volume_end == std::wstring::npos)
+        return StorageType::UNKNOWN;
+
+    win::ScopedHandle volume(CreateFileW(path.substr(0, volume_end).c_str(), 0,
+                                         FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                         OPEN_EXISTING, 0, nullptr));
+    if (!volume.isValid())
+        return StorageType::UNKNOWN;
+
+    STORAGE_PROPERTY_QUERY query;
+    memset(&query, 0, sizeof(query));
+    query.PropertyId = StorageDeviceSeekPenaltyProperty;
+    query.QueryType = PropertyStandardQuery;
+
+    DEVICE_SEEK_PENALTY_DESCRIPTOR seek_penalty;
+    memset(&seek_penalty, 0, sizeof(seek_penalty));
+
+    DWORD bytes_returned = 0;
+    if (!DeviceIoControl(volume.get(), IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+                         &seek_penalty, sizeof(seek_penalty), &bytes_returned, nullptr) ||
+        bytes_returned < sizeof(seek_penalty))
+    {
+        return StorageType::UNKNOWN;
+    }
+
+    return seek_penalty.IncursSeekPenalty ? StorageType::ROTATIONAL : StorageType::SOLID_STATE;
+}
+
+bool File::physicalOffset(uint64_t* offset) const
+{
+    DCHECK(offset);
+
+    STARTING_VCN_INPUT_BUFFER input;
+    input.StartingVcn.QuadPart = 0;
+
+    // Only the first extent is needed. The small files stored inside the MFT do not have extents
+    // and the request fails with ERROR_HANDLE_EOF.
+    RETRIEVAL_POINTERS_BUFFER output;
+    memset(&output, 0, sizeof(output));
+
+    DWORD bytes_returned = 0;
+    if (!DeviceIoControl(file_.get(), FSCTL_GET_RETRIEVAL_POINTERS, &input, sizeof(input),
+                         &output, sizeof(output), &bytes_returned, nullptr) &&
+        GetLastError() != ERROR_MORE_DATA)
+    {
+        return false;
+    }
+
+    // LCN -1 is a hole of a sparse file.
+    if (!output.ExtentCount || output.Extents[0].Lcn.QuadPart < 0)
+        return false;
+
+    // The position is in clusters of the volume.
+    *offset = static_cast<uint64_t>(output.Extents[0].Lcn.QuadPart);
+    return true;
+}
+
+} // namespace base
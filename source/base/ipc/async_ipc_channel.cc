@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/async_ipc_channel.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+
+namespace base {
+
+namespace {
+
+// When the queue is full, the channel stops reading and the peer blocks on the full pipe.
+const size_t kMaxReadQueueSize = 64;
+
+} // namespace
+
+AsyncIpcChannel::AsyncIpcChannel(std::unique_ptr<IpcChannel> channel)
+    : channel_(std::move(channel)),
+      read_event_(MessageLoop::current()->pumpAsio()->ioContext())
+{
+    DCHECK(channel_);
+    DCHECK(channel_->isConnected());
+
+    channel_->setListener(this);
+    channel_->resume();
+}
+
+AsyncIpcChannel::~AsyncIpcChannel()
+{
+    channel_->setListener(nullptr);
+}
+
+asio::awaitable<std::optional<ByteArray>> AsyncIpcChannel::read()
+{
+    while (read_queue_.empty() && connected_)
+        co_await read_event_.wait();
+
+    if (read_queue_.empty())
+        co_return std::nullopt;
+
+    ByteArray buffer = std::move(read_queue_.front());
+    read_queue_.pop_front();
+
+    if (connected_ && read_queue_.size() == kMaxReadQueueSize - 1)
+        channel_->resume();
+
+    co_return buffer;
+}
+
+void AsyncIpcChannel::send(ByteArray&& buffer)
+{
+    if (!connected_)
+        return;
+
+    channel_->send(std::move(buffer));
+}
+
+void AsyncIpcChannel::onDisconnected()
+{
+    LOG(LS_INFO) << "IPC channel disconnected";
+
+    connected_ = false;
+    read_event_.notify();
+}
+
+void AsyncIpcChannel::onMessageReceived(const ByteArray& buffer)
+{
+    read_queue_.emplace_back(buffer);
+
+    if (read_queue_.size() == kMaxReadQueueSize)
+        channel_->pause();
+
+    read_event_.notify();
+}
+
+} // namespace base
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__IPC__ASYNC_IPC_CHANNEL_H
+#define BASE__IPC__ASYNC_IPC_CHANNEL_H
+
+#include "base/ipc/ipc_channel.h"
+#include "base/message_loop/async_event.h"
+
+#include <deque>
+#include <optional>
+
+namespace base {
+
+// Coroutine interface of a connected IpcChannel. See AsyncNetworkChannel for the usage. The IPC
+// channel does not report written messages, so the messages are only queued for sending.
+class AsyncIpcChannel : public IpcChannel::Listener
+{
+public:
+    explicit AsyncIpcChannel(std::unique_ptr<IpcChannel> channel);
+    ~AsyncIpcChannel() override;
+
+    IpcChannel* channel() const { return channel_.get(); }
+
+    bool isConnected() const { return connected_; }
+
+    // Waits for the next message. The messages received before the disconnection are returned
+    // first, then std::nullopt is returned.
+    asio::awaitable<std::optional<ByteArray>> read();
+
+    // Adds the message to the send queue.
+    void send(ByteArray&& buffer);
+
+protected:
+    // IpcChannel::Listener implementation.
+    void onDisconnected() override;
+    void onMessageReceived(const ByteArray& buffer) override;
+
+private:
+    std::unique_ptr<IpcChannel> channel_;
+    bool connected_ = true;
+
+    std::deque<ByteArray> read_queue_;
+    AsyncEvent read_event_;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncIpcChannel);
+};
+
+} // namespace base
+
+#endif // BASE__IPC__ASYNC_IPC_CHANNEL_H
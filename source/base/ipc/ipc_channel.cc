@@ -20,9 +20,13 @@
 
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/ipc/ipc_channel_proxy.h"
+#include "base/ipc/shared_memory.h"
+#include "base/ipc/shared_memory_ring.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/unicode.h"
 
 #include <asio/read.hpp>
@@ -32,6 +36,7 @@
 
 #if defined(OS_WIN)
 #include "base/win/scoped_object.h"
+#include <AclAPI.h>
 #include <psapi.h>
 #endif // defined(OS_WIN)
 
@@ -41,6 +46,13 @@ namespace {
 
 const uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
 
+// The frame header which has this flag instead of the message size passes the shared memory id of
+// the peer's outgoing ring.
+const uint32_t kRingAttachFlag = 0x80000000;
+
+const uint32_t kRingCapacity = 256 * 1024; // 256kB
+const uint32_t kMaxRingMessageSize = 16 * 1024; // 16kB
+
 #if defined(OS_WIN)
 
 const char16_t kPipeNamePrefix[] = u"\\\\.\\pipe\\aspia.";
@@ -85,6 +97,38 @@ SessionId clientSessionIdImpl(HANDLE pipe_handle)
     return session_id;
 }
 
+std::u16string doorbellName(int id)
+{
+    static const char16_t kPrefix[] = u"Global\\aspia_ring_";
+    return kPrefix + numberToString16(id);
+}
+
+win::ScopedHandle createDoorbell(int id)
+{
+    win::ScopedHandle event(CreateEventW(nullptr, FALSE, FALSE, asWide(doorbellName(id))));
+    if (!event.isValid())
+    {
+        PLOG(LS_WARNING) << "CreateEventW failed";
+        return win::ScopedHandle();
+    }
+
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        LOG(LS_WARNING) << "Already exists doorbell: " << id;
+        return win::ScopedHandle();
+    }
+
+    DWORD error_code = SetSecurityInfo(
+        event, SE_KERNEL_OBJECT, DACL_SECURITY_INFORMATION, nullptr, nullptr, nullptr, nullptr);
+    if (error_code != ERROR_SUCCESS)
+    {
+        LOG(LS_WARNING) << "SetSecurityInfo failed: " << SystemError::toString(error_code);
+        return win::ScopedHandle();
+    }
+
+    return event;
+}
+
 SessionId serverSessionIdImpl(HANDLE pipe_handle)
 {
     ULONG session_id = kInvalidSessionId;
@@ -105,6 +149,9 @@ SessionId serverSessionIdImpl(HANDLE pipe_handle)
 IpcChannel::IpcChannel()
     : stream_(MessageLoop::current()->pumpAsio()->ioContext()),
       proxy_(new IpcChannelProxy(MessageLoop::current()->taskRunner(), this))
+#if defined(OS_WIN)
+      , in_doorbell_(MessageLoop::current()->pumpAsio()->ioContext())
+#endif // defined(OS_WIN)
 {
     // Nothing
 }
@@ -114,6 +161,9 @@ IpcChannel::IpcChannel(std::u16string_view channel_name, Stream&& stream)
       stream_(std::move(stream)),
       proxy_(new IpcChannelProxy(MessageLoop::current()->taskRunner(), this)),
       is_connected_(true)
+#if defined(OS_WIN)
+      , in_doorbell_(MessageLoop::current()->pumpAsio()->ioContext())
+#endif // defined(OS_WIN)
 {
 #if defined(OS_WIN)
     peer_process_id_ = clientProcessIdImpl(stream_.native_handle());
@@ -211,6 +261,11 @@ void IpcChannel::disconnect()
 
     stream_.cancel(ignored_code);
     stream_.close(ignored_code);
+
+#if defined(OS_WIN)
+    in_doorbell_.cancel(ignored_code);
+    in_doorbell_.close(ignored_code);
+#endif // defined(OS_WIN)
 }
 
 bool IpcChannel::isConnected() const
@@ -240,10 +295,27 @@ void IpcChannel::resume()
 
     is_paused_ = false;
 
+    // Messages from the ring were written before the message received from the pipe.
+    if (!readRing())
+        return;
+
+    if (in_ring_ && !is_ring_waiting_)
+        doWaitRing();
+
+    // The read started before the pause command is still in progress.
+    if (is_reading_)
+        return;
+
     // If we have a message that was received before the pause command.
     if (read_size_)
+    {
         onMessageReceived();
 
+        // The messages after the marker of the message in the ring.
+        if (!readRing())
+            return;
+    }
+
     DCHECK_EQ(read_size_, 0);
 
     doReadMessage();
@@ -252,9 +324,27 @@ void IpcChannel::resume()
 void IpcChannel::send(ByteArray&& buffer)
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+    TRACE_EVENT("ipc", "IpcChannel::send");
 
     const bool schedule_write = write_queue_.empty();
 
+    // The messages queued for the pipe get their markers when they are written, so the ring is
+    // used only if the queue is empty.
+    if (out_ring_ && is_connected_ && schedule_write && !buffer.empty() &&
+        buffer.size() <= kMaxRingMessageSize)
+    {
+        if (writeRingMarkers() &&
+            out_ring_->write(buffer.data(), static_cast<uint32_t>(buffer.size())))
+        {
+            if (out_ring_->takeDoorbell())
+                ringDoorbell();
+            return;
+        }
+
+        // The ring is full. The message is sent through the pipe and its marker is written before
+        // the next message in the ring.
+    }
+
     // Add the buffer to the queue for sending.
     write_queue_.emplace(std::move(buffer));
 
@@ -262,6 +352,61 @@ void IpcChannel::send(ByteArray&& buffer)
         doWrite();
 }
 
+bool IpcChannel::enableSharedMemoryRing()
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+#if defined(OS_WIN)
+    if (out_ring_)
+        return true;
+
+    if (!is_connected_)
+        return false;
+
+    std::unique_ptr<SharedMemory> memory = SharedMemory::create(
+        SharedMemory::Mode::READ_WRITE, SharedMemoryRing::memorySize(kRingCapacity));
+    if (!memory)
+    {
+        LOG(LS_WARNING) << "Unable to create shared memory for the ring";
+        return false;
+    }
+
+    const int id = memory->id();
+    if (id < 0)
+    {
+        LOG(LS_WARNING) << "Invalid shared memory id: " << id;
+        return false;
+    }
+
+    win::ScopedHandle doorbell = createDoorbell(id);
+    if (!doorbell.isValid())
+        return false;
+
+    std::unique_ptr<SharedMemoryRing> ring =
+        std::make_unique<SharedMemoryRing>(memory->data(), kRingCapacity);
+    ring->reset();
+
+    out_memory_ = std::move(memory);
+    out_ring_ = std::move(ring);
+    out_doorbell_ = std::move(doorbell);
+
+    // The empty buffer in the queue is replaced by the attach frame.
+    const bool schedule_write = write_queue_.empty();
+
+    out_ring_attach_pending_ = true;
+    write_queue_.emplace();
+
+    if (schedule_write)
+        doWrite();
+
+    LOG(LS_INFO) << "Shared memory ring enabled for IPC channel '" << channel_name_ << "'";
+    return true;
+#else
+    NOTIMPLEMENTED();
+    return false;
+#endif
+}
+
 std::filesystem::path IpcChannel::peerFilePath() const
 {
 #if defined(OS_WIN)
@@ -322,6 +467,28 @@ void IpcChannel::onErrorOccurred(const Location& location, const std::error_code
 
 void IpcChannel::doWrite()
 {
+    if (out_ring_attach_pending_ && write_queue_.front().empty())
+    {
+        out_ring_attach_pending_ = false;
+        out_ring_attached_ = true;
+
+        write_size_ = kRingAttachFlag | static_cast<uint32_t>(out_memory_->id());
+
+        asio::async_write(stream_, asio::buffer(&write_size_, sizeof(write_size_)),
+            [this](const std::error_code& error_code, size_t bytes_transferred)
+        {
+            if (error_code)
+            {
+                onErrorOccurred(FROM_HERE, error_code);
+                return;
+            }
+
+            DCHECK_EQ(bytes_transferred, sizeof(write_size_));
+            onWriteComplete();
+        });
+        return;
+    }
+
     write_size_ = write_queue_.front().size();
 
     if (!write_size_ || write_size_ > kMaxMessageSize)
@@ -330,6 +497,10 @@ void IpcChannel::doWrite()
         return;
     }
 
+    // The peer reads the messages from the pipe in this order after the ring is attached.
+    if (out_ring_attached_)
+        ++unmarked_pipe_messages_;
+
     asio::async_write(stream_, asio::buffer(&write_size_, sizeof(write_size_)),
         [this](const std::error_code& error_code, size_t bytes_transferred)
     {
@@ -355,25 +526,34 @@ void IpcChannel::doWrite()
             }
 
             DCHECK_EQ(bytes_transferred, write_size_);
-            DCHECK(!write_queue_.empty());
+            onWriteComplete();
+        });
+    });
+}
 
-            // Delete the sent message from the queue.
-            write_queue_.pop();
+void IpcChannel::onWriteComplete()
+{
+    DCHECK(!write_queue_.empty());
 
-            // If the queue is not empty, then we send the following message.
-            if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
-                return;
+    // Delete the sent message from the queue.
+    write_queue_.pop();
 
-            doWrite();
-        });
-    });
+    // If the queue is not empty, then we send the following message.
+    if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
+        return;
+
+    doWrite();
 }
 
 void IpcChannel::doReadMessage()
 {
+    is_reading_ = true;
+
     asio::async_read(stream_, asio::buffer(&read_size_, sizeof(read_size_)),
         [this](const std::error_code& error_code, size_t bytes_transferred)
     {
+        is_reading_ = false;
+
         if (error_code)
         {
             onErrorOccurred(FROM_HERE, error_code);
@@ -382,6 +562,18 @@ void IpcChannel::doReadMessage()
 
         DCHECK_EQ(bytes_transferred, sizeof(read_size_));
 
+        if (read_size_ & kRingAttachFlag)
+        {
+            const int id = static_cast<int>(read_size_ & ~kRingAttachFlag);
+            read_size_ = 0;
+
+            if (!onRingAttach(id))
+                return;
+
+            doReadMessage();
+            return;
+        }
+
         if (!read_size_ || read_size_ > kMaxMessageSize)
         {
             onErrorOccurred(FROM_HERE, asio::error::message_size);
@@ -395,10 +587,13 @@ void IpcChannel::doReadMessage()
         }
 
         read_buffer_.resize(read_size_);
+        is_reading_ = true;
 
         asio::async_read(stream_, asio::buffer(read_buffer_.data(), read_buffer_.size()),
             [this](const std::error_code& error_code, size_t bytes_transferred)
         {
+            is_reading_ = false;
+
             if (error_code)
             {
                 onErrorOccurred(FROM_HERE, error_code);
@@ -410,9 +605,14 @@ void IpcChannel::doReadMessage()
             if (is_paused_)
                 return;
 
+            // Messages from the ring were written before the message received from the pipe.
+            if (!readRing())
+                return;
+
             onMessageReceived();
 
-            if (is_paused_)
+            // The messages after the marker of the message in the ring.
+            if (!readRing() || is_paused_)
                 return;
 
             DCHECK_EQ(read_size_, 0);
@@ -424,10 +624,162 @@ void IpcChannel::doReadMessage()
 
 void IpcChannel::onMessageReceived()
 {
+    TRACE_EVENT("ipc", "IpcChannel::onMessageReceived");
+
+    // The marker of the message is read from the ring before or will be read later.
+    if (in_ring_)
+        --in_ring_markers_;
+
     if (listener_)
         listener_->onMessageReceived(read_buffer_);
 
     read_size_ = 0;
 }
 
+bool IpcChannel::onRingAttach(int id)
+{
+#if defined(OS_WIN)
+    if (in_ring_)
+    {
+        LOG(LS_WARNING) << "Ring is already attached";
+        onErrorOccurred(FROM_HERE, asio::error::already_open);
+        return false;
+    }
+
+    std::unique_ptr<SharedMemory> memory = SharedMemory::open(SharedMemory::Mode::READ_WRITE, id);
+    if (!memory)
+    {
+        LOG(LS_WARNING) << "Unable to open shared memory for the ring: " << id;
+        onErrorOccurred(FROM_HERE, asio::error::not_found);
+        return false;
+    }
+
+    win::ScopedHandle doorbell(OpenEventW(SYNCHRONIZE, FALSE, asWide(doorbellName(id))));
+    if (!doorbell.isValid())
+    {
+        PLOG(LS_WARNING) << "OpenEventW failed";
+        onErrorOccurred(FROM_HERE, asio::error::not_found);
+        return false;
+    }
+
+    std::error_code error_code;
+    in_doorbell_.assign(doorbell.release(), error_code);
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return false;
+    }
+
+    in_ring_ = std::make_unique<SharedMemoryRing>(memory->data(), kRingCapacity);
+    in_memory_ = std::move(memory);
+
+    LOG(LS_INFO) << "Shared memory ring attached for IPC channel '" << channel_name_ << "'";
+
+    // The peer could write messages before the ring was attached.
+    if (!readRing())
+        return false;
+
+    doWaitRing();
+    return true;
+#else
+    NOTIMPLEMENTED();
+    onErrorOccurred(FROM_HERE, asio::error::operation_not_supported);
+    return false;
+#endif
+}
+
+void IpcChannel::doWaitRing()
+{
+#if defined(OS_WIN)
+    is_ring_waiting_ = true;
+
+    in_doorbell_.async_wait([this](const std::error_code& error_code)
+    {
+        is_ring_waiting_ = false;
+
+        if (error_code)
+        {
+            onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        if (!readRing())
+            return;
+
+        doWaitRing();
+    });
+#endif // defined(OS_WIN)
+}
+
+bool IpcChannel::writeRingMarkers()
+{
+    // An empty message in the ring marks the place of a message which is sent through the pipe
+    // after the ring is attached. The peer does not read the ring after a marker until it receives
+    // the message from the pipe, so a small message sent after a large one is not received first.
+    while (unmarked_pipe_messages_)
+    {
+        if (!out_ring_->write(nullptr, 0))
+            return false;
+
+        --unmarked_pipe_messages_;
+    }
+
+    return true;
+}
+
+void IpcChannel::ringDoorbell()
+{
+#if defined(OS_WIN)
+    if (!SetEvent(out_doorbell_.get()))
+        PLOG(LS_WARNING) << "SetEvent failed";
+#endif // defined(OS_WIN)
+}
+
+bool IpcChannel::readRing()
+{
+    if (!in_ring_)
+        return true;
+
+    while (true)
+    {
+        while (is_connected_ && !is_paused_)
+        {
+            // The messages after the marker are read when the message is received from the pipe.
+            if (in_ring_markers_ > 0)
+                return true;
+
+            SharedMemoryRing::Status status = in_ring_->read(&ring_buffer_);
+            if (status == SharedMemoryRing::Status::EMPTY)
+                break;
+
+            if (status == SharedMemoryRing::Status::CORRUPTED)
+            {
+                onErrorOccurred(FROM_HERE, asio::error::message_size);
+                return false;
+            }
+
+            if (ring_buffer_.empty())
+            {
+                ++in_ring_markers_;
+                continue;
+            }
+
+            if (listener_)
+            {
+                TRACE_EVENT("ipc", "IpcChannel::onRingMessageReceived");
+                listener_->onMessageReceived(ring_buffer_);
+            }
+        }
+
+        if (!is_connected_ || is_paused_)
+            return false;
+
+        // The doorbell is armed before the last check, so a message written after it wakes us up.
+        in_ring_->armDoorbell();
+
+        if (in_ring_->isEmpty())
+            return true;
+    }
+}
+
 } // namespace base
@@ -25,12 +25,16 @@
 #include "base/threading/thread_checker.h"
 
 #if defined(OS_WIN)
+#include "base/win/scoped_object.h"
+
+#include <asio/windows/object_handle.hpp>
 #include <asio/windows/stream_handle.hpp>
 #elif defined(OS_POSIX)
 #include <asio/posix/stream_descriptor.hpp>
 #endif
 
 #include <filesystem>
+#include <memory>
 #include <queue>
 
 namespace base {
@@ -38,6 +42,8 @@ namespace base {
 class IpcChannelProxy;
 class IpcServer;
 class Location;
+class SharedMemory;
+class SharedMemoryRing;
 
 class IpcChannel
 {
@@ -73,6 +79,13 @@ public:
 
     void send(ByteArray&& buffer);
 
+    // Creates a ring in shared memory for the messages sent by this side and passes it to the
+    // peer. After that small messages are written into the ring instead of the pipe and the peer
+    // is woken up only if it waits for them. Large messages are still sent through the pipe, the
+    // peer receives all messages in the order they are sent.
+    // Returns false if the ring is not supported on the platform or could not be created.
+    bool enableSharedMemoryRing();
+
     ProcessId peerProcessId() const { return peer_process_id_; }
     SessionId peerSessionId() const { return peer_session_id_; }
     std::filesystem::path peerFilePath() const;
@@ -94,6 +107,19 @@ private:
     void doWrite();
     void doReadMessage();
     void onMessageReceived();
+    void onWriteComplete();
+
+    bool onRingAttach(int id);
+    void doWaitRing();
+    void ringDoorbell();
+
+    // Writes the markers of the messages sent through the pipe into the outgoing ring. Returns
+    // false if the ring is full.
+    bool writeRingMarkers();
+
+    // Reads all messages from the incoming ring. Returns false if the channel was paused or
+    // disconnected while reading.
+    bool readRing();
 
     std::u16string channel_name_;
     Stream stream_;
@@ -103,6 +129,7 @@ private:
 
     bool is_connected_ = false;
     bool is_paused_ = true;
+    bool is_reading_ = false;
 
     std::queue<ByteArray> write_queue_;
     uint32_t write_size_ = 0;
@@ -110,6 +137,31 @@ private:
     uint32_t read_size_ = 0;
     ByteArray read_buffer_;
 
+    // The outgoing ring is created by this side, the incoming ring is opened by the request of the
+    // peer.
+    std::unique_ptr<SharedMemory> out_memory_;
+    std::unique_ptr<SharedMemoryRing> out_ring_;
+    bool out_ring_attach_pending_ = false;
+    bool out_ring_attached_ = false;
+
+    // The messages written to the pipe after the attach frame which have no marker in the ring
+    // yet.
+    uint32_t unmarked_pipe_messages_ = 0;
+
+    std::unique_ptr<SharedMemory> in_memory_;
+    std::unique_ptr<SharedMemoryRing> in_ring_;
+    ByteArray ring_buffer_;
+    bool is_ring_waiting_ = false;
+
+    // The markers read from the incoming ring minus the messages received from the pipe after the
+    // ring was attached. The ring is not read while it is positive.
+    int in_ring_markers_ = 0;
+
+#if defined(OS_WIN)
+    win::ScopedHandle out_doorbell_;
+    asio::windows::object_handle in_doorbell_;
+#endif // defined(OS_WIN)
+
     ProcessId peer_process_id_ = kNullProcessId;
     SessionId peer_session_id_ = kInvalidSessionId;
 
@@ -0,0 +1,161 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/ipc_channel.h"
+
+#include "base/task_runner.h"
+#include "base/ipc/ipc_server.h"
+#include "base/message_loop/message_loop.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// The test fails if the messages are not received in this time.
+constexpr std::chrono::seconds kTimeout(30);
+
+class TestListener : public IpcChannel::Listener
+{
+public:
+    std::function<void()> on_disconnected;
+    std::function<void(const ByteArray&)> on_message;
+
+    // IpcChannel::Listener implementation.
+    void onDisconnected() override
+    {
+        if (on_disconnected)
+            on_disconnected();
+    }
+
+    void onMessageReceived(const ByteArray& buffer) override
+    {
+        if (on_message)
+            on_message(buffer);
+    }
+};
+
+class TestServerDelegate : public IpcServer::Delegate
+{
+public:
+    std::function<void(std::unique_ptr<IpcChannel>)> on_new_connection;
+
+    // IpcServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<IpcChannel> channel) override
+    {
+        on_new_connection(std::move(channel));
+    }
+
+    void onErrorOccurred() override
+    {
+        ADD_FAILURE() << "IPC server error";
+    }
+};
+
+ByteArray numberedMessage(uint32_t number, size_t size)
+{
+    ByteArray buffer(size, static_cast<uint8_t>(number));
+    memcpy(buffer.data(), &number, sizeof(number));
+    return buffer;
+}
+
+uint32_t messageNumber(const ByteArray& buffer)
+{
+    uint32_t number = 0;
+    if (buffer.size() >= sizeof(number))
+        memcpy(&number, buffer.data(), sizeof(number));
+    return number;
+}
+
+} // namespace
+
+TEST(IpcChannelTest, RingAndPipeOrder)
+{
+    // Large messages are sent through the pipe. The bursts of small messages fill the ring, so
+    // some of them are sent through the pipe too.
+    static const uint32_t kMessageCount = 2000;
+    static const size_t kLargeSize = 64 * 1024;
+    static const size_t kSmallSize = 8 * 1024;
+
+    MessageLoop message_loop(MessageLoop::Type::ASIO);
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    std::vector<uint32_t> received;
+    bool disconnected = false;
+
+    TestListener server_listener;
+    TestServerDelegate server_delegate;
+
+    std::unique_ptr<IpcChannel> server_channel;
+    IpcServer server;
+
+    server_listener.on_disconnected = [&]()
+    {
+        disconnected = true;
+        task_runner->postQuit();
+    };
+    server_listener.on_message = [&](const ByteArray& buffer)
+    {
+        received.emplace_back(messageNumber(buffer));
+        if (received.size() == kMessageCount)
+            task_runner->postQuit();
+    };
+
+    server_delegate.on_new_connection = [&](std::unique_ptr<IpcChannel> channel)
+    {
+        server_channel = std::move(channel);
+        server_channel->setListener(&server_listener);
+        server_channel->resume();
+    };
+
+    const std::u16string channel_id = IpcServer::createUniqueId();
+    ASSERT_TRUE(server.start(channel_id, &server_delegate));
+
+    IpcChannel client_channel;
+    ASSERT_TRUE(client_channel.connect(channel_id));
+    ASSERT_TRUE(client_channel.enableSharedMemoryRing());
+
+    // Each message is sent by its own task, so the writes to the pipe are completed between them
+    // and the small messages after a large one are written into the ring.
+    uint32_t sent = 0;
+    std::function<void()> send_next = [&]()
+    {
+        const size_t size = (sent % 40 == 0) ? kLargeSize : kSmallSize;
+        client_channel.send(numberedMessage(sent, size));
+
+        if (++sent < kMessageCount)
+            task_runner->postTask(send_next);
+    };
+    task_runner->postTask(send_next);
+
+    task_runner->postDelayedTask([&]() { task_runner->postQuit(); }, kTimeout);
+    message_loop.run();
+
+    EXPECT_FALSE(disconnected);
+    ASSERT_EQ(received.size(), kMessageCount);
+
+    for (uint32_t i = 0; i < kMessageCount; ++i)
+        ASSERT_EQ(received[i], i);
+}
+
+} // namespace base
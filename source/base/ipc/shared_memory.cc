@@ -29,6 +29,13 @@
 #include <AclAPI.h>
 #endif // defined(OS_WIN)
 
+#if defined(OS_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // defined(OS_POSIX)
+
 namespace base {
 
 namespace {
@@ -48,14 +55,14 @@ int createUniqueId()
     return last_id++;
 }
 
+#if defined(OS_WIN)
+
 std::u16string createFilePath(int id)
 {
     static const char16_t kPrefix[] = u"Global\\aspia_";
     return kPrefix + numberToString16(id);
 }
 
-#if defined(OS_WIN)
-
 bool modeToDesiredAccess(SharedMemory::Mode mode, DWORD* desired_access)
 {
     switch (mode)
@@ -159,21 +166,82 @@ bool mapViewOfFile(SharedMemory::Mode mode, HANDLE file, void** memory)
 
 #endif // defined(OS_WIN)
 
+#if defined(OS_POSIX)
+
+#if defined(OS_LINUX)
+const size_t kHugePageSize = 2 * 1024 * 1024;
+#endif // defined(OS_LINUX)
+
+std::string createObjectName(int id)
+{
+    static const char kPrefix[] = "/aspia_";
+    return kPrefix + numberToString(id);
+}
+
+bool mapObject(SharedMemory::Mode mode, int file, size_t size, void** memory)
+{
+    int protection;
+
+    switch (mode)
+    {
+        case SharedMemory::Mode::READ_ONLY:
+            protection = PROT_READ;
+            break;
+
+        case SharedMemory::Mode::READ_WRITE:
+            protection = PROT_READ | PROT_WRITE;
+            break;
+
+        default:
+            NOTREACHED();
+            return false;
+    }
+
+    *memory = mmap(nullptr, size, protection, MAP_SHARED, file, 0);
+    if (*memory == MAP_FAILED)
+    {
+        PLOG(LS_WARNING) << "mmap failed";
+        *memory = nullptr;
+        return false;
+    }
+
+#if defined(OS_LINUX)
+    // The shared frames are passed over as a whole. The kernel places the shared memory in the
+    // huge pages if they are enabled for it (shmem_enabled), otherwise the advice is ignored.
+    if (size >= kHugePageSize)
+        madvise(*memory, size, MADV_HUGEPAGE);
+#endif // defined(OS_LINUX)
+
+    return true;
+}
+
+#endif // defined(OS_POSIX)
+
 } // namespace
 
 #if defined(OS_WIN)
-const SharedMemory::PlatformHandle kInvalidHandle = nullptr;
+const SharedMemory::PlatformHandle SharedMemoryBase::kInvalidHandle = nullptr;
 #else
-const SharedMemory::PlatformHandle kInvalidHandle = -1;
+const SharedMemory::PlatformHandle SharedMemoryBase::kInvalidHandle = -1;
+
+void SharedMemoryBase::ScopedPlatformHandle::reset(PlatformHandle handle)
+{
+    if (handle_ != -1 && close(handle_) == -1)
+        PLOG(LS_WARNING) << "close failed";
+
+    handle_ = handle;
+}
 #endif
 
 SharedMemory::SharedMemory(int id,
                            ScopedPlatformHandle&& handle,
                            void* data,
+                           size_t size,
                            std::shared_ptr<SharedMemoryFactoryProxy> factory_proxy)
     : factory_proxy_(std::move(factory_proxy)),
       handle_(std::move(handle)),
       data_(data),
+      size_(size),
       id_(id)
 {
     if (factory_proxy_)
@@ -187,7 +255,13 @@ SharedMemory::~SharedMemory()
 
 #if defined(OS_WIN)
     UnmapViewOfFile(data_);
-#endif // defined(OS_WIN)
+#elif defined(OS_POSIX)
+    if (munmap(data_, size_) == -1)
+        PLOG(LS_WARNING) << "munmap failed";
+
+    if (owner_ && shm_unlink(createObjectName(id_).c_str()) == -1)
+        PLOG(LS_WARNING) << "shm_unlink failed";
+#endif
 }
 
 // static
@@ -217,7 +291,47 @@ std::unique_ptr<SharedMemory> SharedMemory::create(
     memset(memory, 0, size);
 
     return std::unique_ptr<SharedMemory>(
-        new SharedMemory(id, std::move(file), memory, std::move(factory_proxy)));
+        new SharedMemory(id, std::move(file), memory, size, std::move(factory_proxy)));
+#elif defined(OS_POSIX)
+    static const int kRetryCount = 10;
+
+    ScopedPlatformHandle file;
+    int id = -1;
+
+    for (int i = 0; i < kRetryCount; ++i)
+    {
+        id = createUniqueId();
+
+        // The memory is available only to the processes of the same user (and to root).
+        file.reset(shm_open(createObjectName(id).c_str(), O_CREAT | O_EXCL | O_RDWR,
+                            S_IRUSR | S_IWUSR));
+        if (file.isValid())
+            break;
+
+        if (errno != EEXIST)
+        {
+            PLOG(LS_WARNING) << "shm_open failed";
+            return nullptr;
+        }
+    }
+
+    if (!file.isValid())
+        return nullptr;
+
+    // The new pages are filled with zeros.
+    void* memory = nullptr;
+    if (ftruncate(file.get(), static_cast<off_t>(size)) == -1 ||
+        !mapObject(mode, file.get(), size, &memory))
+    {
+        PLOG(LS_WARNING) << "Unable to allocate shared memory";
+        shm_unlink(createObjectName(id).c_str());
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> shared_memory(
+        new SharedMemory(id, std::move(file), memory, size, std::move(factory_proxy)));
+    shared_memory->owner_ = true;
+    return shared_memory;
 #else
     NOTIMPLEMENTED();
     return nullptr;
@@ -237,8 +351,40 @@ std::unique_ptr<SharedMemory> SharedMemory::open(
     if (!mapViewOfFile(mode, file, &memory))
         return nullptr;
 
+    // The view is mapped entirely, its size is rounded up to the page size.
+    MEMORY_BASIC_INFORMATION info;
+    memset(&info, 0, sizeof(info));
+
+    if (!VirtualQuery(memory, &info, sizeof(info)))
+        PLOG(LS_WARNING) << "VirtualQuery failed";
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(
+        id, std::move(file), memory, info.RegionSize, std::move(factory_proxy)));
+#elif defined(OS_POSIX)
+    const int flags = (mode == Mode::READ_ONLY) ? O_RDONLY : O_RDWR;
+
+    ScopedPlatformHandle file(shm_open(createObjectName(id).c_str(), flags, 0));
+    if (!file.isValid())
+    {
+        PLOG(LS_WARNING) << "shm_open failed";
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(file.get(), &info) == -1 || info.st_size <= 0)
+    {
+        PLOG(LS_WARNING) << "Unable to get size of shared memory";
+        return nullptr;
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+
+    void* memory = nullptr;
+    if (!mapObject(mode, file.get(), size, &memory))
+        return nullptr;
+
     return std::unique_ptr<SharedMemory>(
-        new SharedMemory(id, std::move(file), memory, std::move(factory_proxy)));
+        new SharedMemory(id, std::move(file), memory, size, std::move(factory_proxy)));
 #else
     NOTIMPLEMENTED();
     return nullptr;
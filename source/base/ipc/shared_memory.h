@@ -51,24 +51,48 @@ public:
 #else
     using PlatformHandle = int;
 
+    // Owns the file descriptor of the shared memory object.
     class ScopedPlatformHandle
     {
     public:
-        ScopedPlatformHandle(PlatformHandle handle)
+        ScopedPlatformHandle() = default;
+
+        explicit ScopedPlatformHandle(PlatformHandle handle)
             : handle_(handle)
         {
-            NOTIMPLEMENTED();
+            // Nothing
+        }
+
+        ScopedPlatformHandle(ScopedPlatformHandle&& other) noexcept
+            : handle_(other.release())
+        {
+            // Nothing
         }
 
-        ~ScopedPlatformHandle()
+        ScopedPlatformHandle& operator=(ScopedPlatformHandle&& other) noexcept
         {
-            NOTIMPLEMENTED();
+            reset(other.release());
+            return *this;
         }
 
+        ~ScopedPlatformHandle() { reset(); }
+
         PlatformHandle get() const { return handle_; }
+        bool isValid() const { return handle_ != -1; }
+
+        void reset(PlatformHandle handle = -1);
+
+        PlatformHandle release()
+        {
+            PlatformHandle handle = handle_;
+            handle_ = -1;
+            return handle;
+        }
 
     private:
-        PlatformHandle handle_;
+        PlatformHandle handle_ = -1;
+
+        DISALLOW_COPY_AND_ASSIGN(ScopedPlatformHandle);
     };
 
 #endif
@@ -95,17 +119,28 @@ public:
     PlatformHandle handle() const override { return handle_.get(); }
     int id() const override { return id_; }
 
+    // Size of the mapped memory. It can be greater than requested in create().
+    size_t size() const { return size_; }
+
 private:
     SharedMemory(int id,
                  ScopedPlatformHandle&& handle,
                  void* data,
+                 size_t size,
                  std::shared_ptr<SharedMemoryFactoryProxy> factory_proxy);
 
     std::shared_ptr<SharedMemoryFactoryProxy> factory_proxy_;
     ScopedPlatformHandle handle_;
     void* data_;
+    size_t size_;
     int id_;
 
+#if defined(OS_POSIX)
+    // The name of the object is removed by its creator, the processes which have opened it keep
+    // the memory until they close it.
+    bool owner_ = false;
+#endif // defined(OS_POSIX)
+
     DISALLOW_COPY_AND_ASSIGN(SharedMemory);
 };
 
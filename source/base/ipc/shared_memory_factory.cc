@@ -23,6 +23,35 @@
 
 namespace base {
 
+// Returns the memory to the pool of the factory when it is destroyed.
+class SharedMemoryFactory::PooledMemory : public SharedMemoryBase
+{
+public:
+    PooledMemory(std::unique_ptr<SharedMemory> shared_memory,
+                 std::shared_ptr<SharedMemoryFactoryProxy> factory_proxy)
+        : shared_memory_(std::move(shared_memory)),
+          factory_proxy_(std::move(factory_proxy))
+    {
+        DCHECK(shared_memory_ && factory_proxy_);
+    }
+
+    ~PooledMemory() override
+    {
+        factory_proxy_->onSharedMemoryRelease(std::move(shared_memory_));
+    }
+
+    // SharedMemoryBase implementation.
+    void* data() override { return shared_memory_->data(); }
+    PlatformHandle handle() const override { return shared_memory_->handle(); }
+    int id() const override { return shared_memory_->id(); }
+
+private:
+    std::unique_ptr<SharedMemory> shared_memory_;
+    std::shared_ptr<SharedMemoryFactoryProxy> factory_proxy_;
+
+    DISALLOW_COPY_AND_ASSIGN(PooledMemory);
+};
+
 SharedMemoryFactory::SharedMemoryFactory(Delegate* delegate)
     : factory_proxy_(std::make_shared<SharedMemoryFactoryProxy>(this)),
       delegate_(delegate)
@@ -32,12 +61,47 @@ SharedMemoryFactory::SharedMemoryFactory(Delegate* delegate)
 
 SharedMemoryFactory::~SharedMemoryFactory()
 {
+    // The delegate is notified about destruction of the pooled memory.
+    pool_.clear();
     factory_proxy_->dettach();
 }
 
-std::unique_ptr<SharedMemory> SharedMemoryFactory::create(size_t size)
+void SharedMemoryFactory::setPoolSize(size_t count)
 {
-    return SharedMemory::create(SharedMemory::Mode::READ_WRITE, size, factory_proxy_);
+    pool_size_ = count;
+
+    if (pool_.size() > pool_size_)
+        pool_.resize(pool_size_);
+}
+
+std::unique_ptr<SharedMemoryBase> SharedMemoryFactory::create(size_t size)
+{
+    if (!pool_size_)
+        return SharedMemory::create(SharedMemory::Mode::READ_WRITE, size, factory_proxy_);
+
+    std::unique_ptr<SharedMemory> shared_memory;
+
+    for (auto it = pool_.begin(); it != pool_.end(); ++it)
+    {
+        if ((*it)->size() >= size)
+        {
+            shared_memory = std::move(*it);
+            pool_.erase(it);
+            break;
+        }
+    }
+
+    if (!shared_memory)
+    {
+        // The memory which is less than requested was used for the previous screen resolution.
+        pool_.clear();
+
+        shared_memory = SharedMemory::create(SharedMemory::Mode::READ_WRITE, size, factory_proxy_);
+        if (!shared_memory)
+            return nullptr;
+    }
+
+    return std::make_unique<PooledMemory>(std::move(shared_memory), factory_proxy_);
 }
 
 std::unique_ptr<SharedMemory> SharedMemoryFactory::open(int id)
@@ -55,4 +119,12 @@ void SharedMemoryFactory::onSharedMemoryDestroy(int id)
     delegate_->onSharedMemoryDestroy(id);
 }
 
+void SharedMemoryFactory::onSharedMemoryRelease(std::unique_ptr<SharedMemory> shared_memory)
+{
+    if (pool_.size() >= pool_size_)
+        return;
+
+    pool_.emplace_back(std::move(shared_memory));
+}
+
 } // namespace base
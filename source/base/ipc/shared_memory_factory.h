@@ -22,10 +22,12 @@
 #include "base/macros_magic.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 
 class SharedMemory;
+class SharedMemoryBase;
 class SharedMemoryFactoryProxy;
 
 class SharedMemoryFactory
@@ -46,8 +48,14 @@ public:
     explicit SharedMemoryFactory(Delegate* delegate);
     ~SharedMemoryFactory();
 
-    // Creates a new shared memory. If an error occurs, nullptr is returned.
-    std::unique_ptr<SharedMemory> create(size_t size);
+    // Keeps up to |count| released shared memories mapped. They are returned by create() for
+    // the requests which fit into them, and the delegate is not notified about their destruction
+    // and creation again. By default the pool is disabled.
+    void setPoolSize(size_t count);
+
+    // Creates a new shared memory or takes it from the pool. If an error occurs, nullptr is
+    // returned.
+    std::unique_ptr<SharedMemoryBase> create(size_t size);
 
     // Opens an existing shared memory.
     // If shared memory does not exist, nullptr is returned.
@@ -55,13 +63,19 @@ public:
     std::unique_ptr<SharedMemory> open(int id);
 
 private:
+    class PooledMemory;
+
     friend class SharedMemoryFactoryProxy;
     void onSharedMemoryCreate(int id);
     void onSharedMemoryDestroy(int id);
+    void onSharedMemoryRelease(std::unique_ptr<SharedMemory> shared_memory);
 
     std::shared_ptr<SharedMemoryFactoryProxy> factory_proxy_;
     Delegate* delegate_;
 
+    std::vector<std::unique_ptr<SharedMemory>> pool_;
+    size_t pool_size_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(SharedMemoryFactory);
 };
 
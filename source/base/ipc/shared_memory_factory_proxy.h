@@ -21,8 +21,11 @@
 
 #include "base/macros_magic.h"
 
+#include <memory>
+
 namespace base {
 
+class SharedMemory;
 class SharedMemoryFactory;
 
 class SharedMemoryFactoryProxy
@@ -35,6 +38,7 @@ public:
 
     void onSharedMemoryCreate(int id);
     void onSharedMemoryDestroy(int id);
+    void onSharedMemoryRelease(std::unique_ptr<SharedMemory> shared_memory);
 
 private:
     SharedMemoryFactory* factory_;
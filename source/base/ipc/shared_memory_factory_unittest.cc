@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/shared_memory_factory.h"
+
+#include "base/ipc/shared_memory.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+class FactoryDelegate : public SharedMemoryFactory::Delegate
+{
+public:
+    void onSharedMemoryCreate(int /* id */) override { ++created; }
+    void onSharedMemoryDestroy(int /* id */) override { ++destroyed; }
+
+    int created = 0;
+    int destroyed = 0;
+};
+
+} // namespace
+
+TEST(SharedMemoryFactory, WithoutPool)
+{
+    FactoryDelegate delegate;
+    SharedMemoryFactory factory(&delegate);
+
+    std::unique_ptr<SharedMemoryBase> memory = factory.create(4096);
+    ASSERT_TRUE(memory);
+    EXPECT_EQ(delegate.created, 1);
+
+    memory.reset();
+    EXPECT_EQ(delegate.destroyed, 1);
+}
+
+TEST(SharedMemoryFactory, Pool)
+{
+    FactoryDelegate delegate;
+
+    {
+        SharedMemoryFactory factory(&delegate);
+        factory.setPoolSize(1);
+
+        std::unique_ptr<SharedMemoryBase> memory = factory.create(8192);
+        ASSERT_TRUE(memory);
+        const int id = memory->id();
+
+        // The released memory is kept mapped and reused for the request which fits into it.
+        memory.reset();
+        EXPECT_EQ(delegate.destroyed, 0);
+
+        memory = factory.create(4096);
+        ASSERT_TRUE(memory);
+        EXPECT_EQ(memory->id(), id);
+        EXPECT_EQ(delegate.created, 1);
+
+        // The pool is full, the second memory is destroyed when released.
+        std::unique_ptr<SharedMemoryBase> second = factory.create(4096);
+        ASSERT_TRUE(second);
+        EXPECT_EQ(delegate.created, 2);
+
+        memory.reset();
+        second.reset();
+        EXPECT_EQ(delegate.destroyed, 1);
+
+        // The pooled memory is less than requested and it is destroyed.
+        memory = factory.create(16384);
+        ASSERT_TRUE(memory);
+        EXPECT_EQ(delegate.created, 3);
+        EXPECT_EQ(delegate.destroyed, 2);
+
+        memory.reset();
+        EXPECT_EQ(delegate.destroyed, 2);
+    }
+
+    // The pooled memory is destroyed with the factory.
+    EXPECT_EQ(delegate.destroyed, 3);
+}
+
+} // namespace base
@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/shared_memory_ring.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const size_t kCacheLineSize = 64;
+
+} // namespace
+
+// The positions are free-running counters, the offset in the ring is the position modulo the
+// capacity. The producer and the consumer positions are placed in different cache lines.
+struct SharedMemoryRing::Header
+{
+    std::atomic<uint32_t> write_position;
+    uint8_t reserved1[kCacheLineSize - sizeof(std::atomic<uint32_t>)];
+
+    std::atomic<uint32_t> read_position;
+    uint8_t reserved2[kCacheLineSize - sizeof(std::atomic<uint32_t>)];
+
+    std::atomic<uint32_t> doorbell;
+    uint8_t reserved3[kCacheLineSize - sizeof(std::atomic<uint32_t>)];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+SharedMemoryRing::SharedMemoryRing(void* memory, uint32_t capacity)
+    : header_(reinterpret_cast<Header*>(memory)),
+      data_(reinterpret_cast<uint8_t*>(memory) + sizeof(Header)),
+      capacity_(capacity)
+{
+    DCHECK(memory);
+    DCHECK(capacity_ && !(capacity_ & (capacity_ - 1)));
+}
+
+SharedMemoryRing::~SharedMemoryRing() = default;
+
+// static
+size_t SharedMemoryRing::memorySize(uint32_t capacity)
+{
+    return sizeof(Header) + capacity;
+}
+
+void SharedMemoryRing::reset()
+{
+    header_->write_position.store(0, std::memory_order_relaxed);
+    header_->read_position.store(0, std::memory_order_relaxed);
+    header_->doorbell.store(0, std::memory_order_release);
+}
+
+bool SharedMemoryRing::write(const uint8_t* data, uint32_t size)
+{
+    DCHECK(data || !size);
+
+    const uint32_t write_position = header_->write_position.load(std::memory_order_relaxed);
+    const uint32_t read_position = header_->read_position.load(std::memory_order_acquire);
+
+    const uint32_t used = write_position - read_position;
+    if (used > capacity_)
+        return false;
+
+    const uint32_t free_space = capacity_ - used;
+    if (size > free_space || free_space - size < sizeof(uint32_t))
+        return false;
+
+    copyTo(write_position, reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+    if (size)
+        copyTo(write_position + sizeof(size), data, size);
+
+    // The consumer checks the doorbell after the write position, so both are sequentially
+    // consistent.
+    header_->write_position.store(write_position + sizeof(size) + size, std::memory_order_seq_cst);
+    return true;
+}
+
+SharedMemoryRing::Status SharedMemoryRing::read(ByteArray* buffer)
+{
+    DCHECK(buffer);
+
+    const uint32_t read_position = header_->read_position.load(std::memory_order_relaxed);
+    const uint32_t write_position = header_->write_position.load(std::memory_order_acquire);
+
+    const uint32_t used = write_position - read_position;
+    if (!used)
+        return Status::EMPTY;
+
+    // The producer publishes only the whole messages.
+    if (used > capacity_ || used < sizeof(uint32_t))
+        return Status::CORRUPTED;
+
+    uint32_t size = 0;
+    copyFrom(read_position, reinterpret_cast<uint8_t*>(&size), sizeof(size));
+
+    if (size > used - sizeof(size))
+        return Status::CORRUPTED;
+
+    buffer->resize(size);
+    if (size)
+        copyFrom(read_position + sizeof(size), buffer->data(), size);
+
+    header_->read_position.store(read_position + sizeof(size) + size, std::memory_order_release);
+    return Status::SUCCESS;
+}
+
+bool SharedMemoryRing::isEmpty() const
+{
+    return header_->write_position.load(std::memory_order_seq_cst) ==
+           header_->read_position.load(std::memory_order_relaxed);
+}
+
+void SharedMemoryRing::armDoorbell()
+{
+    header_->doorbell.store(1, std::memory_order_seq_cst);
+}
+
+bool SharedMemoryRing::takeDoorbell()
+{
+    return header_->doorbell.exchange(0, std::memory_order_seq_cst) != 0;
+}
+
+void SharedMemoryRing::copyFrom(uint32_t position, uint8_t* data, uint32_t size) const
+{
+    const uint32_t offset = position & (capacity_ - 1);
+    const uint32_t first = std::min(size, capacity_ - offset);
+
+    memcpy(data, data_ + offset, first);
+    memcpy(data + first, data_, size - first);
+}
+
+void SharedMemoryRing::copyTo(uint32_t position, const uint8_t* data, uint32_t size)
+{
+    const uint32_t offset = position & (capacity_ - 1);
+    const uint32_t first = std::min(size, capacity_ - offset);
+
+    memcpy(data_ + offset, data, first);
+    memcpy(data_, data + first, size - first);
+}
+
+} // namespace base
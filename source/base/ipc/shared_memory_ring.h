@@ -0,0 +1,88 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__IPC__SHARED_MEMORY_RING_H
+#define BASE__IPC__SHARED_MEMORY_RING_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <atomic>
+
+namespace base {
+
+// Lock-free ring buffer with a single producer and a single consumer which is placed in a memory
+// shared by two processes. Messages are stored as a 32-bit size followed by the data. A message can
+// be empty (e.g. a marker of the user of the ring). The ring does not own the memory.
+// The consumer arms the doorbell before it goes to sleep. The producer checks it after each write
+// and wakes up the consumer only if it is armed, so a busy consumer gets messages without any
+// system calls.
+class SharedMemoryRing
+{
+public:
+    enum class Status
+    {
+        SUCCESS,
+        EMPTY,
+        CORRUPTED
+    };
+
+    // |memory| must have at least memorySize(|capacity|) bytes. |capacity| must be a power of two.
+    SharedMemoryRing(void* memory, uint32_t capacity);
+    ~SharedMemoryRing();
+
+    // Returns the size of the memory required for the ring with |capacity|.
+    static size_t memorySize(uint32_t capacity);
+
+    // Resets the ring to the empty state. It is called by the creator of the memory.
+    void reset();
+
+    uint32_t capacity() const { return capacity_; }
+
+    // Adds a message to the ring. |data| can be nullptr if |size| is 0. If there is not enough free
+    // space, false is returned.
+    bool write(const uint8_t* data, uint32_t size);
+
+    // Reads the next message. The memory is written by other process and the positions are checked
+    // before usage. If they are invalid, CORRUPTED is returned.
+    Status read(ByteArray* buffer);
+
+    bool isEmpty() const;
+
+    // Called by the consumer before it waits for the doorbell.
+    void armDoorbell();
+
+    // Called by the producer after write. Returns true if the consumer is waiting for the doorbell.
+    bool takeDoorbell();
+
+private:
+    struct Header;
+
+    void copyFrom(uint32_t position, uint8_t* data, uint32_t size) const;
+    void copyTo(uint32_t position, const uint8_t* data, uint32_t size);
+
+    Header* header_;
+    uint8_t* data_;
+    const uint32_t capacity_;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedMemoryRing);
+};
+
+} // namespace base
+
+#endif // BASE__IPC__SHARED_MEMORY_RING_H
@@ -0,0 +1,178 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/shared_memory_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+
+namespace base {
+
+namespace {
+
+const uint32_t kCapacity = 64;
+
+class SharedMemoryRingTest : public testing::Test
+{
+protected:
+    SharedMemoryRingTest()
+        : memory_(SharedMemoryRing::memorySize(kCapacity)),
+          ring_(memory_.data(), kCapacity)
+    {
+        ring_.reset();
+    }
+
+    ByteArray message(uint8_t value, uint32_t size)
+    {
+        return ByteArray(size, value);
+    }
+
+    std::vector<uint32_t> memory_;
+    SharedMemoryRing ring_;
+};
+
+} // namespace
+
+TEST_F(SharedMemoryRingTest, WriteRead)
+{
+    ByteArray buffer;
+    EXPECT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::EMPTY);
+    EXPECT_TRUE(ring_.isEmpty());
+
+    // The messages wrap around the end of the ring.
+    for (uint8_t i = 1; i < 32; ++i)
+    {
+        ByteArray first = message(i, 10);
+        ByteArray second = message(i + 100, 15);
+
+        ASSERT_TRUE(ring_.write(first.data(), first.size()));
+        ASSERT_TRUE(ring_.write(second.data(), second.size()));
+
+        ASSERT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::SUCCESS);
+        EXPECT_EQ(buffer, first);
+
+        ASSERT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::SUCCESS);
+        EXPECT_EQ(buffer, second);
+
+        EXPECT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::EMPTY);
+    }
+}
+
+TEST_F(SharedMemoryRingTest, Full)
+{
+    ByteArray first = message(1, kCapacity / 2);
+    ByteArray second = message(2, kCapacity / 2 - sizeof(uint32_t) * 2);
+
+    EXPECT_TRUE(ring_.write(first.data(), first.size()));
+    EXPECT_FALSE(ring_.write(first.data(), first.size()));
+    EXPECT_TRUE(ring_.write(second.data(), second.size()));
+    EXPECT_FALSE(ring_.write(second.data(), 1));
+
+    ByteArray buffer;
+    ASSERT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::SUCCESS);
+    EXPECT_EQ(buffer, first);
+
+    EXPECT_TRUE(ring_.write(first.data(), first.size() - sizeof(uint32_t)));
+}
+
+TEST_F(SharedMemoryRingTest, Empty)
+{
+    ByteArray first = message(1, 8);
+
+    ASSERT_TRUE(ring_.write(nullptr, 0));
+    ASSERT_TRUE(ring_.write(first.data(), first.size()));
+    EXPECT_FALSE(ring_.isEmpty());
+
+    ByteArray buffer = message(2, 4);
+    ASSERT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::SUCCESS);
+    EXPECT_TRUE(buffer.empty());
+
+    ASSERT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::SUCCESS);
+    EXPECT_EQ(buffer, first);
+
+    EXPECT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::EMPTY);
+    EXPECT_TRUE(ring_.isEmpty());
+}
+
+TEST_F(SharedMemoryRingTest, Corrupted)
+{
+    ByteArray first = message(1, 8);
+    ASSERT_TRUE(ring_.write(first.data(), first.size()));
+
+    // The size of the message is greater than the written data.
+    memory_[SharedMemoryRing::memorySize(0) / sizeof(uint32_t)] = kCapacity;
+
+    ByteArray buffer;
+    EXPECT_EQ(ring_.read(&buffer), SharedMemoryRing::Status::CORRUPTED);
+}
+
+TEST_F(SharedMemoryRingTest, Doorbell)
+{
+    EXPECT_FALSE(ring_.takeDoorbell());
+
+    ring_.armDoorbell();
+
+    ByteArray first = message(1, 8);
+    ASSERT_TRUE(ring_.write(first.data(), first.size()));
+
+    EXPECT_TRUE(ring_.takeDoorbell());
+    EXPECT_FALSE(ring_.takeDoorbell());
+}
+
+TEST_F(SharedMemoryRingTest, Threads)
+{
+    const uint32_t kCount = 10000;
+
+    std::thread producer([this]()
+    {
+        for (uint32_t i = 0; i < kCount;)
+        {
+            if (ring_.write(reinterpret_cast<const uint8_t*>(&i), sizeof(i)))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    ByteArray buffer;
+
+    for (uint32_t i = 0; i < kCount;)
+    {
+        SharedMemoryRing::Status status = ring_.read(&buffer);
+        ASSERT_NE(status, SharedMemoryRing::Status::CORRUPTED);
+
+        if (status == SharedMemoryRing::Status::EMPTY)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint32_t value = 0;
+        ASSERT_EQ(buffer.size(), sizeof(value));
+        memcpy(&value, buffer.data(), sizeof(value));
+
+        EXPECT_EQ(value, i);
+        ++i;
+    }
+
+    producer.join();
+}
+
+} // namespace base
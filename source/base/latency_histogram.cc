@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/latency_histogram.h"
+
+#include <iterator>
+
+namespace base {
+
+namespace {
+
+// The upper bounds of the buckets in milliseconds.
+const int64_t kBucketBounds[] = { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+{
+    static_assert(std::size(kBucketBounds) == kBucketCount);
+
+    for (auto& bucket : buckets_)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::~LatencyHistogram() = default;
+
+void LatencyHistogram::add(const Duration& duration)
+{
+    const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+    size_t index = 0;
+    while (index < kBucketCount && us > kBucketBounds[index] * 1000)
+        ++index;
+
+    buckets_[index].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.buckets.reserve(kBucketCount);
+
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        count += buckets_[i].load(std::memory_order_relaxed);
+        snapshot.buckets.push_back({ static_cast<double>(kBucketBounds[i]) / 1000, count });
+    }
+
+    snapshot.count = count + buckets_[kBucketCount].load(std::memory_order_relaxed);
+    snapshot.sum = static_cast<double>(sum_us_.load(std::memory_order_relaxed)) / 1000000;
+    return snapshot;
+}
+
+} // namespace base
@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__LATENCY_HISTOGRAM_H
+#define BASE__LATENCY_HISTOGRAM_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace base {
+
+// Counts the durations of an operation in fixed buckets from 1 ms to 10 s. The values can be added
+// from any thread without locks.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    ~LatencyHistogram();
+
+    using Duration = std::chrono::steady_clock::duration;
+
+    void add(const Duration& duration);
+
+    struct Bucket
+    {
+        // The upper bound of the bucket in seconds.
+        double upper_bound;
+
+        // The number of values less than or equal to the upper bound.
+        uint64_t count;
+    };
+
+    struct Snapshot
+    {
+        std::vector<Bucket> buckets;
+        uint64_t count = 0;
+
+        // The sum of all values in seconds.
+        double sum = 0;
+    };
+
+    Snapshot snapshot() const;
+
+private:
+    static const size_t kBucketCount = 13;
+
+    // The buckets are not cumulative, the last one counts the values over all bounds.
+    std::array<std::atomic<uint64_t>, kBucketCount + 1> buckets_;
+    std::atomic<int64_t> sum_us_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+} // namespace base
+
+#endif // BASE__LATENCY_HISTOGRAM_H
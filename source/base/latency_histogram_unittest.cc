@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(LatencyHistogramTest, Empty)
+{
+    LatencyHistogram histogram;
+    LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+
+    EXPECT_EQ(snapshot.count, 0u);
+    EXPECT_EQ(snapshot.sum, 0);
+    ASSERT_FALSE(snapshot.buckets.empty());
+
+    for (const auto& bucket : snapshot.buckets)
+        EXPECT_EQ(bucket.count, 0u);
+}
+
+TEST(LatencyHistogramTest, CumulativeBuckets)
+{
+    LatencyHistogram histogram;
+
+    histogram.add(std::chrono::microseconds(500));
+    histogram.add(std::chrono::milliseconds(1));
+    histogram.add(std::chrono::milliseconds(7));
+    histogram.add(std::chrono::seconds(60));
+
+    LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+
+    EXPECT_EQ(snapshot.count, 4u);
+    EXPECT_DOUBLE_EQ(snapshot.sum, 60.0085);
+
+    // The bound is inclusive.
+    EXPECT_DOUBLE_EQ(snapshot.buckets[0].upper_bound, 0.001);
+    EXPECT_EQ(snapshot.buckets[0].count, 2u);
+
+    EXPECT_DOUBLE_EQ(snapshot.buckets[2].upper_bound, 0.005);
+    EXPECT_EQ(snapshot.buckets[2].count, 2u);
+
+    EXPECT_DOUBLE_EQ(snapshot.buckets[3].upper_bound, 0.01);
+    EXPECT_EQ(snapshot.buckets[3].count, 3u);
+
+    // The value over all bounds is counted only in the total.
+    EXPECT_DOUBLE_EQ(snapshot.buckets.back().upper_bound, 10);
+    EXPECT_EQ(snapshot.buckets.back().count, 3u);
+}
+
+} // namespace base
@@ -20,14 +20,19 @@
 
 #include "base/debug.h"
 #include "base/endian_util.h"
+#include "base/macros_magic.h"
 #include "base/system_time.h"
 #include "base/strings/unicode.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <iomanip>
 #include <mutex>
 #include <ostream>
 #include <thread>
+#include <vector>
 
 #if defined(OS_WIN)
 #include <Windows.h>
@@ -51,9 +56,14 @@ namespace {
 LoggingSeverity g_min_log_level = LOG_LS_INFO;
 LoggingDestination g_logging_destination = LOG_DEFAULT;
 
-std::filesystem::path g_log_file_path;
-std::ofstream g_log_file;
-std::mutex g_log_file_lock;
+const int64_t kDefaultMaxLogFileSize = 64 * 1024 * 1024; // 64 MB
+
+// If the messages are produced faster than they are written, the messages below LS_ERROR are
+// dropped after the pending messages reach this size.
+const size_t kMaxPendingSize = 8 * 1024 * 1024; // 8 MB
+
+// The same message repeated within this interval is counted instead of written again.
+const std::chrono::seconds kRepeatInterval{ 10 };
 
 const char* severityName(LoggingSeverity severity)
 {
@@ -82,37 +92,223 @@ std::filesystem::path defaultLogFileDir()
     return path;
 }
 
-bool initLoggingImpl(const LoggingSettings& settings, const std::filesystem::path& file_name)
+// Writes the log messages into the file on a separate thread. The logging threads only move the
+// formatted message into the pending batch under the lock, the disk is accessed and flushed by the
+// writer once per batch. The writer must not use LOG itself.
+class LogFileWriter
 {
-    std::scoped_lock lock(g_log_file_lock);
-    g_log_file.close();
+public:
+    LogFileWriter() = default;
+    ~LogFileWriter() { close(); }
 
-    g_logging_destination = settings.destination;
+    bool open(const std::filesystem::path& file_dir,
+              const std::filesystem::path& file_name,
+              int64_t max_file_size);
+    void close();
 
-    if (!(g_logging_destination & LOG_TO_FILE))
-        return true;
+    void write(std::string&& message, size_t body_start, LoggingSeverity severity);
+    void flush();
 
-    std::filesystem::path file_dir = settings.log_dir;
-    if (file_dir.empty())
-        file_dir = defaultLogFileDir();
+    std::filesystem::path filePath();
 
-    if (file_dir.empty())
+private:
+    struct Message
+    {
+        std::string text;
+        size_t body_start;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Methods called on the writer thread (or before it is started).
+    void run();
+    bool openFile();
+    void writeMessage(const Message& message);
+    void writeRepeatCount();
+    void writeLine(std::string_view line);
+
+    std::mutex lock_;
+    std::condition_variable pending_event_;
+    std::condition_variable written_event_;
+
+    // The fields below are guarded by |lock_|.
+    bool running_ = false;
+    bool stopping_ = false;
+    std::vector<Message> pending_;
+    size_t pending_size_ = 0;
+    uint64_t dropped_count_ = 0;
+    uint64_t queued_count_ = 0;
+    uint64_t written_count_ = 0;
+    std::filesystem::path file_path_;
+
+    std::thread thread_;
+
+    // The fields below are used only by the writer thread.
+    std::filesystem::path file_dir_;
+    std::filesystem::path file_name_;
+    int64_t max_file_size_ = 0;
+    std::ofstream file_;
+    int64_t file_size_ = 0;
+    std::string last_body_;
+    Clock::time_point last_body_time_;
+    uint64_t repeat_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(LogFileWriter);
+};
+
+bool LogFileWriter::open(const std::filesystem::path& file_dir,
+                         const std::filesystem::path& file_name,
+                         int64_t max_file_size)
+{
+    close();
+
+    file_dir_ = file_dir;
+    file_name_ = file_name;
+    max_file_size_ = max_file_size;
+
+    // The first file is opened before the thread starts, so the error is returned to the caller.
+    if (!openFile())
         return false;
 
+    std::scoped_lock lock(lock_);
+    running_ = true;
+    thread_ = std::thread(&LogFileWriter::run, this);
+    return true;
+}
+
+void LogFileWriter::close()
+{
+    {
+        std::scoped_lock lock(lock_);
+        if (!running_)
+            return;
+
+        // The pending messages are written before the thread exits.
+        running_ = false;
+        stopping_ = true;
+        pending_event_.notify_one();
+    }
+
+    thread_.join();
+
+    std::scoped_lock lock(lock_);
+    stopping_ = false;
+    written_event_.notify_all();
+}
+
+void LogFileWriter::write(std::string&& message, size_t body_start, LoggingSeverity severity)
+{
+    std::scoped_lock lock(lock_);
+
+    if (!running_)
+        return;
+
+    if (pending_size_ + message.size() > kMaxPendingSize && severity < LOG_LS_ERROR)
+    {
+        ++dropped_count_;
+        return;
+    }
+
+    pending_size_ += message.size();
+    pending_.push_back({ std::move(message), body_start });
+    ++queued_count_;
+
+    // The writer is woken up only for the first message of a batch.
+    if (pending_.size() == 1)
+        pending_event_.notify_one();
+}
+
+void LogFileWriter::flush()
+{
+    std::unique_lock lock(lock_);
+
+    const uint64_t target_count = queued_count_;
+    written_event_.wait(lock, [&]()
+    {
+        return written_count_ >= target_count || (!running_ && !stopping_);
+    });
+}
+
+std::filesystem::path LogFileWriter::filePath()
+{
+    std::scoped_lock lock(lock_);
+    return file_path_;
+}
+
+void LogFileWriter::run()
+{
+    std::vector<Message> batch;
+    std::unique_lock lock(lock_);
+
+    while (true)
+    {
+        pending_event_.wait(lock, [this]()
+        {
+            return !pending_.empty() || dropped_count_ || stopping_;
+        });
+
+        if (pending_.empty() && !dropped_count_)
+            break;
+
+        // The vectors are swapped, so the memory of both batches is reused.
+        batch.swap(pending_);
+        pending_size_ = 0;
+
+        const uint64_t dropped_count = dropped_count_;
+        dropped_count_ = 0;
+
+        lock.unlock();
+
+        if (dropped_count)
+        {
+            writeRepeatCount();
+
+            std::ostringstream stream;
+            stream << dropped_count << " log messages dropped" << std::endl;
+            writeLine(stream.str());
+        }
+
+        for (const auto& message : batch)
+            writeMessage(message);
+
+        file_.flush();
+
+        const size_t count = batch.size();
+        batch.clear();
+
+        lock.lock();
+        written_count_ += count;
+        written_event_.notify_all();
+    }
+
+    lock.unlock();
+
+    writeRepeatCount();
+    file_.close();
+    last_body_.clear();
+    repeat_count_ = 0;
+}
+
+bool LogFileWriter::openFile()
+{
+    file_.close();
+    file_.clear();
+    file_size_ = 0;
+
     std::error_code error_code;
-    if (!std::filesystem::exists(file_dir, error_code))
+    if (!std::filesystem::exists(file_dir_, error_code))
     {
         if (error_code)
             return false;
 
-        if (!std::filesystem::create_directories(file_dir, error_code))
+        if (!std::filesystem::create_directories(file_dir_, error_code))
             return false;
     }
 
     SystemTime time = SystemTime::now();
 
     std::ostringstream file_name_stream;
-    file_name_stream << file_name.c_str() << '-'
+    file_name_stream << file_name_.c_str() << '-'
                      << std::setfill('0')
                      << std::setw(4) << time.year()
                      << std::setw(2) << time.month()
@@ -125,17 +321,101 @@ bool initLoggingImpl(const LoggingSettings& settings, const std::filesystem::pat
                      << std::setw(3) << time.millisecond()
                      << ".log";
 
-    std::filesystem::path file_path(file_dir);
+    std::filesystem::path file_path(file_dir_);
     file_path.append(file_name_stream.str());
 
-    g_log_file.open(file_path);
-    if (!g_log_file.is_open())
+    file_.open(file_path);
+    if (!file_.is_open())
         return false;
 
-    g_log_file_path = std::move(file_path);
+    std::scoped_lock lock(lock_);
+    file_path_ = std::move(file_path);
     return true;
 }
 
+void LogFileWriter::writeMessage(const Message& message)
+{
+    // The header with the time and the thread is not compared.
+    std::string_view body(message.text);
+    body.remove_prefix(std::min(message.body_start, body.size()));
+
+    const Clock::time_point now = Clock::now();
+
+    if (body == last_body_ && now - last_body_time_ < kRepeatInterval)
+    {
+        ++repeat_count_;
+        return;
+    }
+
+    writeRepeatCount();
+    writeLine(message.text);
+
+    last_body_.assign(body);
+    last_body_time_ = now;
+}
+
+void LogFileWriter::writeRepeatCount()
+{
+    if (!repeat_count_)
+        return;
+
+    std::ostringstream stream;
+    stream << "Last message repeated " << repeat_count_ << " times" << std::endl;
+    repeat_count_ = 0;
+
+    writeLine(stream.str());
+}
+
+void LogFileWriter::writeLine(std::string_view line)
+{
+    if (file_size_ >= max_file_size_)
+    {
+        const std::filesystem::path old_file_path = filePath();
+
+        // If the new file cannot be opened, the logging continues in the current one.
+        std::ofstream old_file(std::move(file_));
+        if (openFile())
+        {
+            old_file << "Logging continues in file: " << filePath() << std::endl;
+            file_ << "Logging continued from file: " << old_file_path << std::endl;
+        }
+        else
+        {
+            file_ = std::move(old_file);
+            file_.clear();
+            file_size_ = 0;
+        }
+    }
+
+    file_.write(line.data(), static_cast<std::streamsize>(line.size()));
+    file_size_ += static_cast<int64_t>(line.size());
+}
+
+LogFileWriter& logFileWriter()
+{
+    static LogFileWriter writer;
+    return writer;
+}
+
+bool initLoggingImpl(const LoggingSettings& settings, const std::filesystem::path& file_name)
+{
+    logFileWriter().close();
+
+    g_logging_destination = settings.destination;
+
+    if (!(g_logging_destination & LOG_TO_FILE))
+        return true;
+
+    std::filesystem::path file_dir = settings.log_dir;
+    if (file_dir.empty())
+        file_dir = defaultLogFileDir();
+
+    if (file_dir.empty())
+        return false;
+
+    return logFileWriter().open(file_dir, file_name, settings.max_log_file_size);
+}
+
 } // namespace
 
 // This is never instantiated, it's just used for EAT_STREAM_PARAMETERS to have
@@ -145,7 +425,8 @@ std::ostream* g_swallow_stream;
 
 LoggingSettings::LoggingSettings()
     : destination(LOG_DEFAULT),
-      min_log_level(LOG_LS_INFO)
+      min_log_level(LOG_LS_INFO),
+      max_log_file_size(kDefaultMaxLogFileSize)
 {
     // Nothing
 }
@@ -180,7 +461,7 @@ bool initLogging(const LoggingSettings& settings)
     if (g_logging_destination & LOG_TO_FILE)
     {
         // If log output is enabled, then we output information about the file.
-        LOG(LS_INFO) << "Logging file: " << g_log_file_path;
+        LOG(LS_INFO) << "Logging file: " << logFileWriter().filePath();
     }
     LOG(LS_INFO) << "Debugger present: " << (isDebuggerPresent() ? "Yes" : "No");
 
@@ -195,12 +476,15 @@ bool initLogging(const LoggingSettings& settings)
     return true;
 }
 
+void flushLogging()
+{
+    logFileWriter().flush();
+}
+
 void shutdownLogging()
 {
     LOG(LS_INFO) << "Logging finished";
-
-    std::scoped_lock lock(g_log_file_lock);
-    g_log_file.close();
+    logFileWriter().close();
 }
 
 bool shouldCreateLogMessage(LoggingSeverity severity)
@@ -313,9 +597,11 @@ LogMessage::~LogMessage()
     // Write to log file.
     if ((g_logging_destination & LOG_TO_FILE) != 0)
     {
-        std::scoped_lock lock(g_log_file_lock);
-        g_log_file.write(message.c_str(), message.size());
-        g_log_file.flush();
+        logFileWriter().write(std::move(message), message_start_, severity_);
+
+        // The process is crashed below, so the message must reach the disk before.
+        if (severity_ == LOG_LS_FATAL)
+            logFileWriter().flush();
     }
 
     if (severity_ == LOG_LS_FATAL)
@@ -121,12 +121,16 @@ struct LoggingSettings
     //
     //  destination: LOG_DEFAULT
     //  min_log_level: LOG_LS_INFO
+    //  max_log_file_size: 64 MB
     LoggingSettings();
 
     LoggingDestination destination;
     LoggingSeverity min_log_level;
 
     std::filesystem::path log_dir;
+
+    // When the log file reaches this size, the logging continues in a new file.
+    int64_t max_log_file_size;
 };
 
 // Sets the log file name and other global logging state. Calling this function is recommended,
@@ -134,6 +138,10 @@ struct LoggingSettings
 // See the definition of the enums above for descriptions and default values.
 bool initLogging(const LoggingSettings& settings = LoggingSettings());
 
+// Writes all the log messages which are not written yet into the log file. The messages are
+// written to the file on a separate thread and this function waits for it.
+void flushLogging();
+
 // Closes the log file explicitly if open.
 // NOTE: Since the log file is opened as necessary by the action of logging statements, there's no
 //       guarantee that it will stay closed after this call.
@@ -24,8 +24,101 @@
 #include <malloc.h>
 #endif
 
+#if defined(OS_WIN)
+#include "base/win/scoped_object.h"
+
+#include <Windows.h>
+#endif
+
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+#endif
+
 namespace base {
 
+namespace {
+
+// The alignment of the memory returned by the OS for the large buffers.
+const size_t kPageSize = 4096;
+
+#if defined(OS_LINUX) || defined(OS_WIN)
+size_t roundUp(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+#endif
+
+#if defined(OS_LINUX)
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+bool isLargeAllocation(size_t size)
+{
+    return size >= kHugePageSize;
+}
+
+#elif defined(OS_WIN)
+
+// Returns the size of a large page if the process is allowed to allocate them, otherwise zero.
+size_t largePageSize()
+{
+    static const size_t large_page_size = []() -> size_t
+    {
+        const size_t minimum = GetLargePageMinimum();
+        if (!minimum)
+            return 0;
+
+        win::ScopedHandle token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY,
+                              token.recieve()))
+        {
+            PLOG(LS_WARNING) << "OpenProcessToken failed";
+            return 0;
+        }
+
+        TOKEN_PRIVILEGES state;
+        state.PrivilegeCount = 1;
+        state.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+        if (!LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &state.Privileges[0].Luid))
+        {
+            PLOG(LS_WARNING) << "LookupPrivilegeValueW failed";
+            return 0;
+        }
+
+        // AdjustTokenPrivileges() succeeds even if the token does not have the privilege.
+        if (!AdjustTokenPrivileges(token, FALSE, &state, 0, nullptr, nullptr) ||
+            GetLastError() != ERROR_SUCCESS)
+        {
+            LOG(LS_INFO) << "Large pages are not available";
+            return 0;
+        }
+
+        LOG(LS_INFO) << "Large pages are available (size: " << minimum << ")";
+        return minimum;
+    }();
+
+    return large_page_size;
+}
+
+bool isLargeAllocation(size_t size)
+{
+    // The buffers which are not placed in the large pages are still allocated by VirtualAlloc(),
+    // so largeFree() does not depend on the result of the allocation.
+    return size >= kPageSize;
+}
+
+#else
+
+bool isLargeAllocation(size_t /* size */)
+{
+    return false;
+}
+
+#endif
+
+} // namespace
+
 void* alignedAlloc(size_t size, size_t alignment)
 {
     DCHECK_GT(size, 0U);
@@ -50,4 +143,83 @@ void* alignedAlloc(size_t size, size_t alignment)
     return ptr;
 }
 
+void* largeAlloc(size_t size, size_t alignment)
+{
+    DCHECK_GT(size, 0U);
+
+    if (!isLargeAllocation(size))
+        return alignedAlloc(size, alignment);
+
+    DCHECK_LE(alignment, kPageSize);
+
+#if defined(OS_LINUX)
+    const size_t rounded_size = roundUp(size, kHugePageSize);
+
+    // The reserved huge pages exist only if the administrator has configured them.
+    void* ptr = mmap(nullptr, rounded_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED)
+        return ptr;
+
+    ptr = mmap(nullptr, rounded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(ptr != MAP_FAILED);
+
+    // The kernel may ignore it, then the buffer remains in the normal pages.
+    madvise(ptr, rounded_size, MADV_HUGEPAGE);
+    return ptr;
+#elif defined(OS_WIN)
+    const size_t large_page_size = largePageSize();
+    if (large_page_size && size >= large_page_size)
+    {
+        // The large pages cannot be paged out and are committed at once. They are taken from the
+        // memory of the node where the caller runs.
+        PROCESSOR_NUMBER processor;
+        GetCurrentProcessorNumberEx(&processor);
+
+        DWORD node = NUMA_NO_PREFERRED_NODE;
+
+        USHORT processor_node;
+        if (GetNumaProcessorNodeEx(&processor, &processor_node))
+            node = processor_node;
+
+        void* ptr = VirtualAllocExNuma(GetCurrentProcess(), nullptr,
+                                       roundUp(size, large_page_size),
+                                       MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                       PAGE_READWRITE, node);
+        if (ptr)
+            return ptr;
+
+        // The physical memory may be too fragmented for the large pages.
+        PLOG(LS_WARNING) << "VirtualAllocExNuma failed";
+    }
+
+    void* ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    CHECK(ptr);
+    return ptr;
+#else
+    NOTREACHED();
+    return nullptr;
+#endif
+}
+
+void largeFree(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    if (!isLargeAllocation(size))
+    {
+        alignedFree(ptr);
+        return;
+    }
+
+#if defined(OS_LINUX)
+    if (munmap(ptr, roundUp(size, kHugePageSize)) == -1)
+        PLOG(LS_WARNING) << "munmap failed";
+#elif defined(OS_WIN)
+    if (!VirtualFree(ptr, 0, MEM_RELEASE))
+        PLOG(LS_WARNING) << "VirtualFree failed";
+#endif
+}
+
 } // namespace base
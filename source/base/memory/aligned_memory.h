@@ -44,6 +44,14 @@
 //
 //   std::unique_ptr<float, AlignedFreeDeleter> my_array(
 //       static_cast<float*>(alignedAlloc(size, alignment)));
+//
+// The large buffers which are passed over as a whole (the frames of the screen) are allocated
+// with the large pages, which take fewer TLB misses:
+//
+//   uint8_t* frame = static_cast<uint8_t*>(largeAlloc(size, alignment));
+//
+//   // ... later, to release the memory:
+//   largeFree(frame, size);
 
 #ifndef BASE__MEMORY__ALIGNED_MEMORY_H
 #define BASE__MEMORY__ALIGNED_MEMORY_H
@@ -71,6 +79,16 @@ inline void alignedFree(void* ptr)
 #endif
 }
 
+// Allocates |size| bytes aligned at least to |alignment|. The buffers of at least a large page
+// are placed in the large pages: on Linux in the huge pages (from the reserved pool if there is
+// one, otherwise the transparent ones), on Windows if the process is allowed to lock the memory
+// (SeLockMemoryPrivilege). The memory is not initialized. On Linux the pages are placed on the
+// NUMA node of the thread which writes them first. On Windows the large pages are allocated at
+// once on the node of the calling thread.
+// The memory must be released by largeFree() with the same size.
+void* largeAlloc(size_t size, size_t alignment);
+void largeFree(void* ptr, size_t size);
+
 // Deleter for use with unique_ptr. E.g., use as std::unique_ptr<Foo, AlignedFreeDeleter> foo;
 struct AlignedFreeDeleter
 {
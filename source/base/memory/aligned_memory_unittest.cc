@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 namespace base {
 
 #define EXPECT_ALIGNED(ptr, align) \
@@ -55,4 +57,23 @@ TEST(aligned_memory_test, scoped_dynamic_allocation)
     EXPECT_ALIGNED(p.get(), 8);
 }
 
+TEST(aligned_memory_test, large_allocation)
+{
+    // A small buffer and a buffer of a 4K frame.
+    const size_t sizes[] = { 64, 3840 * 2160 * 4 };
+
+    for (size_t size : sizes)
+    {
+        uint8_t* p = static_cast<uint8_t*>(largeAlloc(size, 32));
+        ASSERT_TRUE(p);
+        EXPECT_ALIGNED(p, 32);
+
+        // The whole buffer is writable.
+        memset(p, 0xAB, size);
+        EXPECT_EQ(p[size - 1], 0xAB);
+
+        largeFree(p, size);
+    }
+}
+
 } // namespace base
@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MEMORY__ARENA_MESSAGE_H
+#define BASE__MEMORY__ARENA_MESSAGE_H
+
+#include "base/macros_magic.h"
+
+#include <google/protobuf/arena.h>
+
+#include <memory>
+
+namespace base {
+
+// Protobuf message of type T allocated on its own arena. A message reused with Clear() still
+// deletes its nested messages (proto3 fields have no presence bits) and allocates them again for
+// the next message. clear() drops the whole message at once and creates a new one in the same
+// memory, so the messages which fit into the initial block of |kInitialBlockSize| do not allocate
+// on the heap, except for the buffers of the string and bytes fields.
+// The nested messages must not be released from the message: a released message is a copy.
+template <typename T>
+class ArenaMessage
+{
+public:
+    static const size_t kInitialBlockSize = 16 * 1024;
+
+    ArenaMessage()
+        : initial_block_(std::make_unique<char[]>(kInitialBlockSize)),
+          arena_(arenaOptions(initial_block_.get())),
+          message_(google::protobuf::Arena::CreateMessage<T>(&arena_))
+    {
+        // Nothing
+    }
+
+    ~ArenaMessage() = default;
+
+    T* get() const { return message_; }
+    T* operator->() const { return message_; }
+    T& operator*() const { return *message_; }
+
+    // Frees the previous message with all the nested messages and creates an empty message.
+    void clear()
+    {
+        arena_.Reset();
+        message_ = google::protobuf::Arena::CreateMessage<T>(&arena_);
+    }
+
+private:
+    static google::protobuf::ArenaOptions arenaOptions(char* initial_block)
+    {
+        google::protobuf::ArenaOptions options;
+        options.initial_block = initial_block;
+        options.initial_block_size = kInitialBlockSize;
+        return options;
+    }
+
+    // The arena keeps the initial block on reset. It is freed after the arena.
+    std::unique_ptr<char[]> initial_block_;
+    google::protobuf::Arena arena_;
+    T* message_;
+
+    DISALLOW_COPY_AND_ASSIGN(ArenaMessage);
+};
+
+} // namespace base
+
+#endif // BASE__MEMORY__ARENA_MESSAGE_H
@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+Buffer::Buffer(size_t size)
+{
+    resize(size);
+}
+
+Buffer::Buffer(const void* data, size_t size)
+    : Buffer(size)
+{
+    if (size)
+        memcpy(data_.get(), data, size);
+}
+
+Buffer::Buffer(const ByteArray& array)
+    : Buffer(array.data(), array.size())
+{
+    // Nothing
+}
+
+Buffer::Buffer(Buffer&& other) noexcept
+{
+    swap(other);
+}
+
+Buffer& Buffer::operator=(Buffer&& other) noexcept
+{
+    swap(other);
+    return *this;
+}
+
+void Buffer::resize(size_t size)
+{
+    // The buffers which grow step by step are not reallocated for each step.
+    if (size > capacity_)
+        reserve(std::max(size, capacity_ + capacity_ / 2));
+
+    size_ = size;
+}
+
+void Buffer::reserve(size_t capacity)
+{
+    if (capacity <= capacity_)
+        return;
+
+    std::unique_ptr<uint8_t, AlignedFreeDeleter> data(
+        static_cast<uint8_t*>(alignedAlloc(capacity, kAlignment)));
+
+    if (size_)
+        memcpy(data.get(), data_.get(), size_);
+
+    data_ = std::move(data);
+    capacity_ = capacity;
+}
+
+void Buffer::swap(Buffer& other) noexcept
+{
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+}
+
+ByteArray Buffer::toByteArray() const
+{
+    return ByteArray(begin(), end());
+}
+
+} // namespace base
@@ -0,0 +1,88 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MEMORY__BUFFER_H
+#define BASE__MEMORY__BUFFER_H
+
+#include "base/macros_magic.h"
+#include "base/memory/aligned_memory.h"
+#include "base/memory/byte_array.h"
+
+#include <memory>
+
+namespace base {
+
+// Byte buffer for the data which is written right after the allocation: the planes of the images,
+// the encrypted messages. Unlike ByteArray, resize() does not fill the new bytes with zeros, it
+// leaves them uninitialized. The memory is aligned to kAlignment, so the SIMD code may use the
+// aligned loads. The buffer can be moved, but not copied.
+class Buffer
+{
+public:
+    static const size_t kAlignment = 64;
+
+    Buffer() = default;
+
+    // Creates a buffer of |size| uninitialized bytes.
+    explicit Buffer(size_t size);
+
+    Buffer(const void* data, size_t size);
+    explicit Buffer(const ByteArray& array);
+
+    Buffer(Buffer&& other) noexcept;
+    Buffer& operator=(Buffer&& other) noexcept;
+
+    ~Buffer() = default;
+
+    uint8_t* data() { return data_.get(); }
+    const uint8_t* data() const { return data_.get(); }
+
+    uint8_t* begin() { return data(); }
+    uint8_t* end() { return data() + size_; }
+    const uint8_t* begin() const { return data(); }
+    const uint8_t* end() const { return data() + size_; }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    // Changes the size of the buffer. The data up to the new size is kept, the new bytes are left
+    // uninitialized. The memory is reallocated only if the capacity is less than |size|.
+    void resize(size_t size);
+
+    // Makes the capacity at least |capacity| bytes. The data is kept.
+    void reserve(size_t capacity);
+
+    // Sets the size to zero. The memory is kept for the next resize().
+    void clear() { size_ = 0; }
+
+    void swap(Buffer& other) noexcept;
+
+    ByteArray toByteArray() const;
+
+private:
+    std::unique_ptr<uint8_t, AlignedFreeDeleter> data_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(Buffer);
+};
+
+} // namespace base
+
+#endif // BASE__MEMORY__BUFFER_H
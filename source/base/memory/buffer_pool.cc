@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/buffer_pool.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+using BufferList = std::vector<std::unique_ptr<Buffer>>;
+
+BufferList::iterator smallestBuffer(BufferList* list)
+{
+    return std::min_element(list->begin(), list->end(),
+        [](const std::unique_ptr<Buffer>& first, const std::unique_ptr<Buffer>& second)
+    {
+        return first->capacity() < second->capacity();
+    });
+}
+
+} // namespace
+
+BufferPool::BufferPool(size_t max_free_count)
+    : max_free_count_(max_free_count)
+{
+    // Nothing
+}
+
+BufferPool::~BufferPool() = default;
+
+Buffer* BufferPool::acquire(size_t size)
+{
+    // The smallest free buffer that fits leaves the larger ones for the larger requests.
+    auto best = free_.end();
+
+    for (auto it = free_.begin(); it != free_.end(); ++it)
+    {
+        if ((*it)->capacity() < size)
+            continue;
+
+        if (best == free_.end() || (*it)->capacity() < (*best)->capacity())
+            best = it;
+    }
+
+    std::unique_ptr<Buffer> buffer;
+
+    if (best != free_.end())
+    {
+        buffer = std::move(*best);
+        free_.erase(best);
+        buffer->resize(size);
+    }
+    else
+    {
+        // The free buffers are too small (e.g. the resolution has grown). The smallest of them is
+        // not needed anymore.
+        if (!free_.empty())
+            free_.erase(smallestBuffer(&free_));
+
+        buffer = std::make_unique<Buffer>(size);
+        if (size)
+            memset(buffer->data(), 0, size);
+    }
+
+    used_.emplace_back(std::move(buffer));
+    return used_.back().get();
+}
+
+void BufferPool::release(Buffer* buffer)
+{
+    auto it = std::find_if(used_.begin(), used_.end(),
+                           [buffer](const std::unique_ptr<Buffer>& used)
+    {
+        return used.get() == buffer;
+    });
+
+    if (it == used_.end())
+    {
+        DCHECK(!buffer) << "The buffer does not belong to the pool";
+        return;
+    }
+
+    free_.emplace_back(std::move(*it));
+    used_.erase(it);
+
+    if (free_.size() > max_free_count_)
+        free_.erase(smallestBuffer(&free_));
+}
+
+size_t BufferPool::memoryUsage() const
+{
+    size_t usage = 0;
+
+    for (const auto& buffer : used_)
+        usage += buffer->capacity();
+
+    for (const auto& buffer : free_)
+        usage += buffer->capacity();
+
+    return usage;
+}
+
+} // namespace base
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MEMORY__BUFFER_POOL_H
+#define BASE__MEMORY__BUFFER_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/memory/buffer.h"
+
+#include <memory>
+#include <vector>
+
+namespace base {
+
+// Pool of aligned buffers for the libraries which take the memory for their images from the
+// application (e.g. the frame buffers of libvpx). A released buffer keeps its memory and is given
+// out again for a request of the same or a smaller size, so the frames are not allocated again for
+// each decoded picture. A new buffer is filled with zeros.
+// The pool is used from one thread.
+class BufferPool
+{
+public:
+    // The pool keeps up to |max_free_count| buffers which are not in use.
+    explicit BufferPool(size_t max_free_count);
+    ~BufferPool();
+
+    // Returns a buffer of |size| bytes. The buffer belongs to the pool and is valid until it is
+    // released or the pool is destroyed.
+    Buffer* acquire(size_t size);
+
+    // Returns the buffer to the pool.
+    void release(Buffer* buffer);
+
+    size_t usedCount() const { return used_.size(); }
+    size_t freeCount() const { return free_.size(); }
+
+    // Returns the capacity of all buffers of the pool.
+    size_t memoryUsage() const;
+
+private:
+    const size_t max_free_count_;
+
+    std::vector<std::unique_ptr<Buffer>> used_;
+    std::vector<std::unique_ptr<Buffer>> free_;
+
+    DISALLOW_COPY_AND_ASSIGN(BufferPool);
+};
+
+} // namespace base
+
+#endif // BASE__MEMORY__BUFFER_POOL_H
@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/buffer_pool.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(BufferPool, ReuseReleased)
+{
+    BufferPool pool(2);
+
+    Buffer* first = pool.acquire(1000);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->size(), 1000u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first->data()) % Buffer::kAlignment, 0u);
+
+    // A new buffer is filled with zeros.
+    for (size_t i = 0; i < first->size(); ++i)
+        ASSERT_EQ(first->data()[i], 0);
+
+    Buffer* second = pool.acquire(1000);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(pool.usedCount(), 2u);
+
+    const uint8_t* data = first->data();
+    pool.release(first);
+    EXPECT_EQ(pool.usedCount(), 1u);
+    EXPECT_EQ(pool.freeCount(), 1u);
+
+    // A smaller request gets the memory of the released buffer.
+    Buffer* third = pool.acquire(500);
+    EXPECT_EQ(third->data(), data);
+    EXPECT_EQ(third->size(), 500u);
+    EXPECT_EQ(pool.freeCount(), 0u);
+}
+
+TEST(BufferPool, BestFit)
+{
+    BufferPool pool(4);
+
+    Buffer* small = pool.acquire(100);
+    Buffer* large = pool.acquire(10000);
+    const uint8_t* small_data = small->data();
+    const uint8_t* large_data = large->data();
+
+    pool.release(large);
+    pool.release(small);
+
+    EXPECT_EQ(pool.acquire(50)->data(), small_data);
+    EXPECT_EQ(pool.acquire(5000)->data(), large_data);
+}
+
+TEST(BufferPool, GrowAndLimit)
+{
+    BufferPool pool(1);
+
+    Buffer* first = pool.acquire(100);
+    Buffer* second = pool.acquire(200);
+
+    pool.release(first);
+    pool.release(second);
+
+    // Only one free buffer is kept, the larger one.
+    EXPECT_EQ(pool.freeCount(), 1u);
+    EXPECT_GE(pool.memoryUsage(), 200u);
+
+    // The free buffer is too small, it is replaced.
+    Buffer* large = pool.acquire(1000);
+    EXPECT_EQ(pool.freeCount(), 0u);
+    EXPECT_EQ(pool.usedCount(), 1u);
+    EXPECT_EQ(pool.memoryUsage(), large->capacity());
+}
+
+} // namespace base
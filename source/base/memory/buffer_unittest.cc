@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/buffer.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(Buffer, Resize)
+{
+    Buffer buffer;
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.data(), nullptr);
+
+    buffer.resize(100);
+    EXPECT_EQ(buffer.size(), 100u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % Buffer::kAlignment, 0u);
+
+    for (size_t i = 0; i < buffer.size(); ++i)
+        buffer.data()[i] = static_cast<uint8_t>(i);
+
+    // The data is kept when the buffer grows.
+    buffer.resize(1000);
+    EXPECT_EQ(buffer.size(), 1000u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % Buffer::kAlignment, 0u);
+
+    for (size_t i = 0; i < 100; ++i)
+        EXPECT_EQ(buffer.data()[i], static_cast<uint8_t>(i));
+
+    // The memory is not reallocated when the buffer shrinks.
+    const uint8_t* data = buffer.data();
+    buffer.resize(10);
+    EXPECT_EQ(buffer.data(), data);
+    EXPECT_EQ(buffer.capacity(), 1000u);
+
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+
+    buffer.resize(500);
+    EXPECT_EQ(buffer.data(), data);
+}
+
+TEST(Buffer, Move)
+{
+    Buffer first(16);
+    const uint8_t* data = first.data();
+
+    Buffer second(std::move(first));
+    EXPECT_EQ(second.data(), data);
+    EXPECT_EQ(second.size(), 16u);
+    EXPECT_TRUE(first.empty());
+
+    Buffer third;
+    third = std::move(second);
+    EXPECT_EQ(third.data(), data);
+    EXPECT_EQ(third.size(), 16u);
+}
+
+TEST(Buffer, ByteArrayConvert)
+{
+    const ByteArray array = { 1, 2, 3, 4, 5 };
+
+    Buffer buffer(array);
+    ASSERT_EQ(buffer.size(), array.size());
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), array.cbegin()));
+    EXPECT_EQ(buffer.toByteArray(), array);
+
+    EXPECT_TRUE(Buffer(ByteArray()).toByteArray().empty());
+}
+
+} // namespace base
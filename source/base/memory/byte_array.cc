@@ -124,15 +124,22 @@ std::string toHex(const ByteArray& in)
 
 base::ByteArray serialize(const google::protobuf::MessageLite& message)
 {
+    base::ByteArray buffer;
+    serialize(message, &buffer);
+    return buffer;
+}
+
+void serialize(const google::protobuf::MessageLite& message, base::ByteArray* buffer)
+{
+    DCHECK(buffer);
+
     const size_t size = message.ByteSizeLong();
-    if (!size)
-        return base::ByteArray();
 
-    base::ByteArray buffer;
-    buffer.resize(size);
+    buffer->resize(size);
+    if (!size)
+        return;
 
-    message.SerializeWithCachedSizesToArray(buffer.data());
-    return buffer;
+    message.SerializeWithCachedSizesToArray(buffer->data());
 }
 
 int compare(const base::ByteArray& first, const base::ByteArray& second)
@@ -39,6 +39,9 @@ std::string toHex(const ByteArray& in);
 
 base::ByteArray serialize(const google::protobuf::MessageLite& message);
 
+// Serializes |message| into |buffer|. The memory of |buffer| is reused if its capacity is enough.
+void serialize(const google::protobuf::MessageLite& message, base::ByteArray* buffer);
+
 template <class T>
 bool parse(const base::ByteArray& buffer, T* message)
 {
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace base {
+
+ByteArrayPool::ByteArrayPool(size_t max_count)
+    : max_count_(max_count)
+{
+    // Nothing
+}
+
+ByteArrayPool::~ByteArrayPool() = default;
+
+std::shared_ptr<ByteArray> ByteArrayPool::acquire()
+{
+    for (const auto& buffer : buffers_)
+    {
+        // Only the pool can give out new references to the buffer, so if the pool is the only
+        // owner, nobody else can start using it.
+        if (buffer.use_count() == 1)
+        {
+            // The last owner may have released the buffer on another thread. Its reads must be
+            // completed before the buffer is changed.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return buffer;
+        }
+    }
+
+    std::shared_ptr<ByteArray> buffer = std::make_shared<ByteArray>();
+
+    if (buffers_.size() < max_count_)
+        buffers_.emplace_back(buffer);
+
+    return buffer;
+}
+
+size_t ByteArrayPool::memoryUsage() const
+{
+    size_t usage = 0;
+
+    // The capacity of a buffer is changed only by the pool, before the buffer is given out.
+    for (const auto& buffer : buffers_)
+        usage += buffer->capacity();
+
+    return usage;
+}
+
+void ByteArrayPool::trim(size_t max_capacity)
+{
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                  [max_capacity](const std::shared_ptr<ByteArray>& buffer)
+    {
+        return buffer.use_count() == 1 && buffer->capacity() > max_capacity;
+    }), buffers_.end());
+}
+
+} // namespace base
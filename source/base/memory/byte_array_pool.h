@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MEMORY__BYTE_ARRAY_POOL_H
+#define BASE__MEMORY__BYTE_ARRAY_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <memory>
+#include <vector>
+
+namespace base {
+
+// Pool of byte arrays for the messages that are sent to several channels or sent often. A buffer
+// returned by acquire() is shared with the channels without copying. When all of them have sent
+// it, the pool is its only owner again and the buffer is reused with its capacity, so the large
+// messages are not allocated for each frame.
+// The pool is used from one thread. The buffers given out may be released on any thread.
+class ByteArrayPool
+{
+public:
+    explicit ByteArrayPool(size_t max_count);
+    ~ByteArrayPool();
+
+    // Returns a buffer which is not used by anyone. If all buffers of the pool are in use and the
+    // pool is full, a new buffer which does not belong to the pool is returned.
+    std::shared_ptr<ByteArray> acquire();
+
+    size_t count() const { return buffers_.size(); }
+
+    // Returns the capacity of the buffers of the pool, including the ones in use.
+    size_t memoryUsage() const;
+
+    // Releases the buffers which are not in use and hold more than |max_capacity| bytes. The
+    // buffers in use are released to the pool and reused as before.
+    void trim(size_t max_capacity = 0);
+
+private:
+    const size_t max_count_;
+    std::vector<std::shared_ptr<ByteArray>> buffers_;
+
+    DISALLOW_COPY_AND_ASSIGN(ByteArrayPool);
+};
+
+} // namespace base
+
+#endif // BASE__MEMORY__BYTE_ARRAY_POOL_H
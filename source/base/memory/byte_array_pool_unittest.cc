@@ -0,0 +1,109 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array_pool.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(ByteArrayPool, ReuseReleased)
+{
+    ByteArrayPool pool(2);
+
+    std::shared_ptr<ByteArray> buffer = pool.acquire();
+    buffer->resize(1024);
+
+    ByteArray* data = buffer.get();
+    buffer.reset();
+
+    // The released buffer is reused with its capacity.
+    std::shared_ptr<ByteArray> reused = pool.acquire();
+    EXPECT_EQ(reused.get(), data);
+    EXPECT_GE(reused->capacity(), 1024U);
+    EXPECT_EQ(pool.count(), 1U);
+}
+
+TEST(ByteArrayPool, SkipUsed)
+{
+    ByteArrayPool pool(2);
+
+    std::shared_ptr<ByteArray> first = pool.acquire();
+    std::shared_ptr<ByteArray> copy = first;
+    std::shared_ptr<ByteArray> second = pool.acquire();
+
+    EXPECT_NE(first.get(), second.get());
+    EXPECT_EQ(pool.count(), 2U);
+
+    // The pool is full and all its buffers are in use.
+    std::shared_ptr<ByteArray> third = pool.acquire();
+    EXPECT_NE(third.get(), first.get());
+    EXPECT_NE(third.get(), second.get());
+    EXPECT_EQ(pool.count(), 2U);
+
+    // The first buffer is still used by |copy|, so the second one is reused.
+    ByteArray* second_data = second.get();
+    first.reset();
+    second.reset();
+    EXPECT_EQ(pool.acquire().get(), second_data);
+}
+
+TEST(ByteArrayPool, Trim)
+{
+    ByteArrayPool pool(2);
+
+    std::shared_ptr<ByteArray> used = pool.acquire();
+    used->resize(1024);
+    pool.acquire()->resize(4096);
+
+    EXPECT_EQ(pool.count(), 2U);
+    EXPECT_GE(pool.memoryUsage(), 5120U);
+
+    // Only the released buffer is removed.
+    pool.trim();
+    EXPECT_EQ(pool.count(), 1U);
+    EXPECT_GE(pool.memoryUsage(), 1024U);
+    EXPECT_LT(pool.memoryUsage(), 4096U);
+
+    used.reset();
+    EXPECT_EQ(pool.acquire()->capacity(), pool.memoryUsage());
+}
+
+TEST(ByteArrayPool, TrimLargeBuffers)
+{
+    ByteArrayPool pool(3);
+
+    std::shared_ptr<ByteArray> used = pool.acquire();
+    std::shared_ptr<ByteArray> small = pool.acquire();
+    std::shared_ptr<ByteArray> large = pool.acquire();
+
+    used->resize(8192);
+    small->resize(1024);
+    large->resize(8192);
+
+    small.reset();
+    large.reset();
+
+    // The small buffer and the buffer in use are kept.
+    pool.trim(4096);
+    EXPECT_EQ(pool.count(), 2U);
+    EXPECT_GE(pool.memoryUsage(), 9216U);
+    EXPECT_LT(pool.memoryUsage(), 16384U);
+}
+
+} // namespace base
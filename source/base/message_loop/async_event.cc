@@ -0,0 +1,47 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/async_event.h"
+
+#include <asio/redirect_error.hpp>
+#include <asio/use_awaitable.hpp>
+
+namespace base {
+
+AsyncEvent::AsyncEvent(asio::io_context& io_context)
+    : timer_(io_context)
+{
+    // The timer never expires, it is only cancelled. Cancelling does not change the expiry time, so
+    // it is set once and the waiters do not cancel each other.
+    timer_.expires_at(asio::steady_timer::time_point::max());
+}
+
+AsyncEvent::~AsyncEvent() = default;
+
+asio::awaitable<void> AsyncEvent::wait()
+{
+    std::error_code error_code;
+    co_await timer_.async_wait(asio::redirect_error(asio::use_awaitable, error_code));
+}
+
+void AsyncEvent::notify()
+{
+    timer_.cancel();
+}
+
+} // namespace base
@@ -0,0 +1,52 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__ASYNC_EVENT_H
+#define BASE__MESSAGE_LOOP__ASYNC_EVENT_H
+
+#include "base/macros_magic.h"
+
+#include <asio/awaitable.hpp>
+#include <asio/steady_timer.hpp>
+
+namespace base {
+
+// Event for coroutines running on the io_context of MessagePumpForAsio. wait() suspends the
+// coroutine until notify() is called. The waiter must check its condition again after waking up,
+// it can be woken up without a reason. All methods must be called on the thread of the io_context,
+// so the condition cannot change between the check and the start of waiting.
+class AsyncEvent
+{
+public:
+    explicit AsyncEvent(asio::io_context& io_context);
+    ~AsyncEvent();
+
+    asio::awaitable<void> wait();
+
+    // Wakes up all waiting coroutines. Does nothing if there are none.
+    void notify();
+
+private:
+    asio::steady_timer timer_;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncEvent);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__ASYNC_EVENT_H
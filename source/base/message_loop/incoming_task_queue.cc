@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/incoming_task_queue.h"
+
+namespace base {
+
+IncomingTaskQueue::IncomingTaskQueue() = default;
+
+IncomingTaskQueue::~IncomingTaskQueue()
+{
+    releaseList(head_.exchange(nullptr, std::memory_order_acquire));
+}
+
+bool IncomingTaskQueue::push(PendingTask&& pending_task)
+{
+    PendingTaskNode* node = PendingTaskPool::allocate();
+    node->pending_task.emplace(std::move(pending_task));
+
+    PendingTaskNode* head = head_.load(std::memory_order_relaxed);
+
+    // The release order publishes the task to the thread that takes it. After that the node
+    // belongs to the consumer and must not be accessed.
+    do
+    {
+        node->next = head;
+    }
+    while (!head_.compare_exchange_weak(
+        head, node, std::memory_order_release, std::memory_order_relaxed));
+
+    return head == nullptr;
+}
+
+bool IncomingTaskQueue::takeAll(TaskQueue* queue)
+{
+    PendingTaskNode* node = head_.exchange(nullptr, std::memory_order_acquire);
+    if (!node)
+        return false;
+
+    // The stack holds the tasks from the last to the first.
+    PendingTaskNode* reversed = nullptr;
+    while (node)
+    {
+        PendingTaskNode* next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+
+    while (reversed)
+    {
+        PendingTaskNode* next = reversed->next;
+        queue->emplace(std::move(*reversed->pending_task));
+        PendingTaskPool::release(reversed);
+        reversed = next;
+    }
+
+    return true;
+}
+
+// static
+void IncomingTaskQueue::releaseList(PendingTaskNode* node)
+{
+    while (node)
+    {
+        PendingTaskNode* next = node->next;
+        PendingTaskPool::release(node);
+        node = next;
+    }
+}
+
+} // namespace base
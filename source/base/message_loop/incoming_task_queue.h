@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__INCOMING_TASK_QUEUE_H
+#define BASE__MESSAGE_LOOP__INCOMING_TASK_QUEUE_H
+
+#include "base/macros_magic.h"
+#include "base/message_loop/pending_task_pool.h"
+
+#include <atomic>
+
+namespace base {
+
+// A lock-free queue of the tasks posted to a message loop from any thread. The tasks are pushed
+// onto a linked stack with compare-and-swap. The thread of the loop takes the whole stack at once
+// with an exchange and restores the order of the tasks, so the producers never wait for each
+// other or for the consumer. The nodes of the tasks are taken from PendingTaskPool.
+class IncomingTaskQueue
+{
+public:
+    IncomingTaskQueue();
+    ~IncomingTaskQueue();
+
+    // Can be called from any thread. Returns true if the queue was empty before the call, only
+    // in this case the message pump needs to be woken up.
+    bool push(PendingTask&& pending_task);
+
+    // Moves all tasks to the end of |queue| in the order in which they were pushed. Must be called
+    // only on the thread of the loop. Returns false if the queue is empty.
+    bool takeAll(TaskQueue* queue);
+
+private:
+    static void releaseList(PendingTaskNode* node);
+
+    // The last pushed task.
+    std::atomic<PendingTaskNode*> head_ { nullptr };
+
+    DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__INCOMING_TASK_QUEUE_H
@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/incoming_task_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+PendingTask makeTask(int sequence_num)
+{
+    return PendingTask([]() {}, PendingTask::TimePoint(), true, sequence_num);
+}
+
+} // namespace
+
+TEST(IncomingTaskQueueTest, Order)
+{
+    IncomingTaskQueue incoming_queue;
+    TaskQueue queue;
+
+    EXPECT_FALSE(incoming_queue.takeAll(&queue));
+
+    // Only the first task wakes up the pump.
+    EXPECT_TRUE(incoming_queue.push(makeTask(0)));
+    EXPECT_FALSE(incoming_queue.push(makeTask(1)));
+    EXPECT_FALSE(incoming_queue.push(makeTask(2)));
+
+    EXPECT_TRUE(incoming_queue.takeAll(&queue));
+    EXPECT_FALSE(incoming_queue.takeAll(&queue));
+
+    ASSERT_EQ(queue.size(), 3u);
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(queue.front().sequence_num, i);
+        queue.pop();
+    }
+
+    // The queue is empty again after the tasks are taken.
+    EXPECT_TRUE(incoming_queue.push(makeTask(3)));
+}
+
+TEST(IncomingTaskQueueTest, ConcurrentProducers)
+{
+    const int kThreadCount = 4;
+    const int kTaskCount = 10000;
+
+    IncomingTaskQueue incoming_queue;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        threads.emplace_back([&incoming_queue, i]()
+        {
+            for (int j = 0; j < kTaskCount; ++j)
+                incoming_queue.push(makeTask(i * kTaskCount + j));
+        });
+    }
+
+    TaskQueue queue;
+    std::vector<int> last(kThreadCount, -1);
+    int count = 0;
+
+    // The tasks are taken while the producers are still running.
+    while (count < kThreadCount * kTaskCount)
+    {
+        incoming_queue.takeAll(&queue);
+
+        while (!queue.empty())
+        {
+            const int thread_index = queue.front().sequence_num / kTaskCount;
+            const int task_index = queue.front().sequence_num % kTaskCount;
+            queue.pop();
+
+            // The tasks of each producer keep their order.
+            EXPECT_EQ(task_index, last[thread_index] + 1);
+            last[thread_index] = task_index;
+            ++count;
+        }
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_FALSE(incoming_queue.takeAll(&queue));
+}
+
+} // namespace base
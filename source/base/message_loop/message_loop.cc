@@ -177,7 +177,7 @@ void MessageLoop::runTask(const PendingTask& pending_task)
     nestable_tasks_allowed_ = true;
 }
 
-bool MessageLoop::deferOrRunPendingTask(const PendingTask& pending_task)
+bool MessageLoop::deferOrRunPendingTask(PendingTask&& pending_task)
 {
     if (pending_task.nestable)
     {
@@ -189,7 +189,7 @@ bool MessageLoop::deferOrRunPendingTask(const PendingTask& pending_task)
 
     // We couldn't run the task now because we're in a nested message loop
     // and the task isn't nestable.
-    deferred_non_nestable_work_queue_.emplace(pending_task);
+    deferred_non_nestable_work_queue_.emplace(std::move(pending_task));
     return false;
 }
 
@@ -207,20 +207,14 @@ void MessageLoop::addToDelayedWorkQueue(PendingTask* pending_task)
 void MessageLoop::addToIncomingQueue(
     PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable)
 {
-    bool empty;
-
+    // The pump is woken up only when the queue becomes non-empty. The next tasks are taken
+    // together with the first one.
+    if (!incoming_queue_.push(PendingTask(std::move(callback),
+                                          calculateDelayedRuntime(delay),
+                                          nestable)))
     {
-        std::scoped_lock lock(incoming_queue_lock_);
-
-        empty = incoming_queue_.empty();
-
-        incoming_queue_.emplace(std::move(callback),
-                                calculateDelayedRuntime(delay),
-                                nestable);
-    }
-
-    if (!empty)
         return;
+    }
 
     std::shared_ptr<MessagePump> pump(pump_);
     pump->scheduleWork();
@@ -231,13 +225,7 @@ void MessageLoop::reloadWorkQueue()
     if (!work_queue_.empty())
         return;
 
-    std::scoped_lock lock(incoming_queue_lock_);
-
-    if (incoming_queue_.empty())
-        return;
-
-    incoming_queue_.Swap(&work_queue_);
-    DCHECK(incoming_queue_.empty());
+    incoming_queue_.takeAll(&work_queue_);
 }
 
 bool MessageLoop::deletePendingTasks()
@@ -246,7 +234,7 @@ bool MessageLoop::deletePendingTasks()
 
     while (!work_queue_.empty())
     {
-        PendingTask pending_task = work_queue_.front();
+        PendingTask pending_task = std::move(work_queue_.front());
         work_queue_.pop();
 
         if (pending_task.delayed_run_time != TimePoint())
@@ -299,7 +287,7 @@ bool MessageLoop::doWork()
         // Execute oldest task.
         do
         {
-            PendingTask pending_task = work_queue_.front();
+            PendingTask pending_task = std::move(work_queue_.front());
             work_queue_.pop();
 
             if (pending_task.delayed_run_time != TimePoint())
@@ -314,7 +302,7 @@ bool MessageLoop::doWork()
             }
             else
             {
-                if (deferOrRunPendingTask(pending_task))
+                if (deferOrRunPendingTask(std::move(pending_task)))
                     return true;
             }
         }
@@ -351,13 +339,12 @@ bool MessageLoop::doDelayedWork(TimePoint* next_delayed_work_time)
         }
     }
 
-    PendingTask pending_task = delayed_work_queue_.top();
-    delayed_work_queue_.pop();
+    PendingTask pending_task = delayed_work_queue_.takeTop();
 
     if (!delayed_work_queue_.empty())
         *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
 
-    return deferOrRunPendingTask(pending_task);
+    return deferOrRunPendingTask(std::move(pending_task));
 }
 
 bool MessageLoop::doIdleWork()
@@ -365,7 +352,7 @@ bool MessageLoop::doIdleWork()
     if (deferred_non_nestable_work_queue_.empty())
         return false;
 
-    PendingTask pending_task = deferred_non_nestable_work_queue_.front();
+    PendingTask pending_task = std::move(deferred_non_nestable_work_queue_.front());
     deferred_non_nestable_work_queue_.pop();
 
     runTask(pending_task);
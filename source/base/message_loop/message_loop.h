@@ -21,6 +21,7 @@
 
 #include "base/macros_magic.h"
 #include "base/task_runner.h"
+#include "base/message_loop/incoming_task_queue.h"
 #include "base/message_loop/message_pump.h"
 #include "base/message_loop/message_pump_dispatcher.h"
 #include "base/message_loop/pending_task.h"
@@ -87,7 +88,7 @@ protected:
 
     // Calls RunTask or queues the pending_task on the deferred task list if it cannot be run right
     // now. Returns true if the task was run.
-    bool deferOrRunPendingTask(const PendingTask& pending_task);
+    bool deferOrRunPendingTask(PendingTask&& pending_task);
 
     // Adds the pending task to delayed_work_queue_.
     void addToDelayedWorkQueue(PendingTask* pending_task);
@@ -99,8 +100,8 @@ protected:
     // pending_task->task beyond this function call.
     void addToIncomingQueue(PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable);
 
-    // Load tasks from the incoming_queue_ into work_queue_ if the latter is empty. The former
-    // requires a lock to access, while the latter is directly accessible on this thread.
+    // Load tasks from the incoming_queue_ into work_queue_ if the latter is empty. The former is
+    // filled by any thread without locks, while the latter is directly accessible on this thread.
     void reloadWorkQueue();
 
     bool deletePendingTasks();
@@ -135,8 +136,7 @@ protected:
 
     std::shared_ptr<MessagePump> pump_;
 
-    TaskQueue incoming_queue_;
-    std::mutex incoming_queue_lock_;
+    IncomingTaskQueue incoming_queue_;
 
     // The next sequence number to use for delayed tasks.
     int next_sequence_num_ = 0;
@@ -22,8 +22,22 @@
 
 #include <asio/post.hpp>
 
+#if defined(OS_WIN)
+#include <Windows.h>
+#endif // defined(OS_WIN)
+
 namespace base {
 
+#if defined(OS_WIN)
+// Window messages wait at most for this time while the pump sleeps in asio. The clipboard and the
+// other windows of the thread do not need a lower latency.
+// static
+const MessagePump::Milliseconds MessagePumpForAsio::kWindowMessageInterval(20);
+
+// The number of window messages processed at once, so they do not starve the I/O.
+static const int kMaxWindowMessages = 16;
+#endif // defined(OS_WIN)
+
 void MessagePumpForAsio::run(Delegate* delegate)
 {
     DCHECK(keep_running_) << "Quit must have been called outside of run!";
@@ -40,6 +54,10 @@ void MessagePumpForAsio::run(Delegate* delegate)
         if (!keep_running_)
             break;
 
+        did_work |= timer_service_.runExpired(Clock::now());
+        if (!keep_running_)
+            break;
+
         // Restart the io_context in preparation for a subsequent pull() invocation.
         io_context_.restart();
 
@@ -48,6 +66,15 @@ void MessagePumpForAsio::run(Delegate* delegate)
         if (!keep_running_)
             break;
 
+#if defined(OS_WIN)
+        if (window_messages_ > 0)
+        {
+            did_work |= processWindowMessages();
+            if (!keep_running_)
+                break;
+        }
+#endif // defined(OS_WIN)
+
         if (did_work)
             continue;
 
@@ -58,7 +85,27 @@ void MessagePumpForAsio::run(Delegate* delegate)
         if (did_work)
             continue;
 
-        if (delayed_work_time_ == TimePoint())
+        // The pump sleeps until the nearest delayed task or the nearest coalesced timer.
+        TimePoint wakeup_time = delayed_work_time_;
+
+        const TimePoint timer_deadline = timer_service_.nextDeadline();
+        if (timer_deadline != TimePoint() &&
+            (wakeup_time == TimePoint() || timer_deadline < wakeup_time))
+        {
+            wakeup_time = timer_deadline;
+        }
+
+#if defined(OS_WIN)
+        if (window_messages_ > 0)
+        {
+            // The window messages are not seen by asio, the queue is checked again later.
+            const TimePoint latest_wakeup_time = Clock::now() + kWindowMessageInterval;
+            if (wakeup_time == TimePoint() || latest_wakeup_time < wakeup_time)
+                wakeup_time = latest_wakeup_time;
+        }
+#endif // defined(OS_WIN)
+
+        if (wakeup_time == TimePoint())
         {
             // Restart the io_context in preparation for a subsequent run_one() invocation.
             io_context_.restart();
@@ -68,8 +115,9 @@ void MessagePumpForAsio::run(Delegate* delegate)
         }
         else
         {
-            Milliseconds delay = std::chrono::duration_cast<Milliseconds>(
-                delayed_work_time_ - Clock::now());
+            // Rounded up, otherwise the pump spins during the last millisecond before the
+            // deadline.
+            Milliseconds delay = std::chrono::ceil<Milliseconds>(wakeup_time - Clock::now());
 
             if (delay > Milliseconds::zero())
             {
@@ -79,7 +127,7 @@ void MessagePumpForAsio::run(Delegate* delegate)
                 // Run the io_context object's event processing loop to execute at most one handler.
                 io_context_.run_one_for(delay);
             }
-            else
+            else if (wakeup_time == delayed_work_time_)
             {
                 // It looks like delayed_work_time_ indicates a time in the past, so we need to
                 // call doDelayedWork now.
@@ -91,6 +139,56 @@ void MessagePumpForAsio::run(Delegate* delegate)
     keep_running_ = true;
 }
 
+// static
+const char* MessagePumpForAsio::ioBackendName()
+{
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+    return "io_uring";
+#elif defined(ASIO_HAS_IOCP)
+    return "iocp";
+#elif defined(ASIO_HAS_EPOLL)
+    return "epoll";
+#elif defined(ASIO_HAS_KQUEUE)
+    return "kqueue";
+#else
+    return "select";
+#endif
+}
+
+#if defined(OS_WIN)
+void MessagePumpForAsio::setWindowMessagesEnabled(bool enable)
+{
+    window_messages_ += enable ? 1 : -1;
+    DCHECK_GE(window_messages_, 0);
+}
+
+bool MessagePumpForAsio::processWindowMessages()
+{
+    bool did_work = false;
+
+    // PeekMessage() also calls the window procedures for the messages sent by other threads.
+    for (int i = 0; i < kMaxWindowMessages; ++i)
+    {
+        MSG msg;
+        if (!PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+            break;
+
+        did_work = true;
+
+        if (msg.message == WM_QUIT)
+        {
+            keep_running_ = false;
+            break;
+        }
+
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+
+    return did_work;
+}
+#endif // defined(OS_WIN)
+
 void MessagePumpForAsio::quit()
 {
     keep_running_ = false;
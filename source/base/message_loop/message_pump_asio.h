@@ -21,6 +21,8 @@
 
 #include "base/macros_magic.h"
 #include "base/message_loop/message_pump.h"
+#include "base/message_loop/timer_service.h"
+#include "build/build_config.h"
 
 #include <asio/io_context.hpp>
 
@@ -39,13 +41,38 @@ public:
     void scheduleDelayedWork(const TimePoint& delayed_work_time) override;
 
     asio::io_context& ioContext() { return io_context_; }
+    TimerService* timerService() { return &timer_service_; }
+
+#if defined(OS_WIN)
+    // Enables the processing of the window messages of the thread, so the windows (e.g. the
+    // clipboard monitor) work on the same thread as the I/O and the tasks. The calls are counted,
+    // the messages are processed until each enable call is followed by a disable call.
+    // The completion port of asio cannot be waited together with the message queue. While the
+    // messages are enabled, the pump checks the queue on each pass of its loop and wakes up at
+    // least every |kWindowMessageInterval| when it sleeps.
+    void setWindowMessagesEnabled(bool enable);
+
+    static const Milliseconds kWindowMessageInterval;
+#endif // defined(OS_WIN)
+
+    // Returns the name of the mechanism used by asio for the asynchronous I/O (io_uring, epoll,
+    // kqueue, iocp or select). It is selected at build time (see USE_IO_URING).
+    static const char* ioBackendName();
 
 private:
+#if defined(OS_WIN)
+    bool processWindowMessages();
+    int window_messages_ = 0;
+#endif // defined(OS_WIN)
+
     // This flag is set to false when run() should return.
     bool keep_running_ = true;
 
     asio::io_context io_context_;
 
+    // Deadlines of the coalesced timers. The pump wakes up for the nearest one.
+    TimerService timer_service_;
+
     // The time at which we should call doDelayedWork.
     TimePoint delayed_work_time_;
 
@@ -19,6 +19,9 @@
 #ifndef BASE__MESSAGE_LOOP__PENDING_TASK_H
 #define BASE__MESSAGE_LOOP__PENDING_TASK_H
 
+#include "base/message_loop/task_callback.h"
+
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <queue>
@@ -30,7 +33,7 @@ namespace base {
 class PendingTask
 {
 public:
-    using Callback = std::function<void()>;
+    using Callback = TaskCallback;
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
 
@@ -40,6 +43,10 @@ public:
                 int sequence_num = 0);
     ~PendingTask() = default;
 
+    // The tasks are only moved, their callbacks are not copyable.
+    PendingTask(PendingTask&& other) noexcept = default;
+    PendingTask& operator=(PendingTask&& other) noexcept = default;
+
     // Used to support sorting.
     bool operator<(const PendingTask& other) const;
 
@@ -65,8 +72,20 @@ public:
     }
 };
 
-// PendingTasks are sorted by their |delayed_run_time| property.
-using DelayedTaskQueue = std::priority_queue<PendingTask>;
+// PendingTasks are sorted by their |delayed_run_time| property. Adds a takeTop helper method,
+// because top() does not allow to move the task out of the queue.
+class DelayedTaskQueue : public std::priority_queue<PendingTask>
+{
+public:
+    PendingTask takeTop()
+    {
+        std::pop_heap(c.begin(), c.end(), comp);
+
+        PendingTask pending_task = std::move(c.back());
+        c.pop_back();
+        return pending_task;
+    }
+};
 
 } // namespace base
 
@@ -0,0 +1,174 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/pending_task_pool.h"
+
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// The number of nodes that the threads pass to each other at once.
+const size_t kBatchSize = 64;
+
+// The shared list keeps up to kMaxBatchCount * kBatchSize nodes, the rest are deleted.
+const size_t kMaxBatchCount = 1024;
+
+void deleteList(PendingTaskNode* node)
+{
+    while (node)
+    {
+        PendingTaskNode* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+// The batches of nodes released by all threads. The lock is taken once per batch, so the threads
+// rarely wait for it.
+class SharedList
+{
+public:
+    SharedList() = default;
+
+    void push(PendingTaskNode* batch)
+    {
+        {
+            std::scoped_lock lock(lock_);
+
+            if (batches_.size() < kMaxBatchCount)
+            {
+                batches_.emplace_back(batch);
+                return;
+            }
+        }
+
+        deleteList(batch);
+    }
+
+    PendingTaskNode* pop()
+    {
+        std::scoped_lock lock(lock_);
+
+        if (batches_.empty())
+            return nullptr;
+
+        PendingTaskNode* batch = batches_.back();
+        batches_.pop_back();
+        return batch;
+    }
+
+private:
+    std::mutex lock_;
+    std::vector<PendingTaskNode*> batches_;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedList);
+};
+
+// The list is never destroyed, because the threads can return their nodes to it after the
+// static objects are destroyed.
+SharedList& sharedList()
+{
+    static SharedList* list = new SharedList();
+    return *list;
+}
+
+class ThreadCache
+{
+public:
+    ThreadCache() = default;
+
+    ~ThreadCache()
+    {
+        // The incomplete batches are not worth keeping.
+        deleteList(released_);
+        deleteList(taken_);
+    }
+
+    PendingTaskNode* allocate()
+    {
+        // The nodes released by this thread are preferred, they are probably still in the cache
+        // of the processor.
+        if (released_)
+        {
+            --released_count_;
+            return pop(&released_);
+        }
+
+        if (!taken_)
+            taken_ = sharedList().pop();
+
+        if (taken_)
+            return pop(&taken_);
+
+        return new PendingTaskNode();
+    }
+
+    void release(PendingTaskNode* node)
+    {
+        node->next = released_;
+        released_ = node;
+
+        if (++released_count_ < kBatchSize)
+            return;
+
+        sharedList().push(released_);
+
+        released_ = nullptr;
+        released_count_ = 0;
+    }
+
+private:
+    static PendingTaskNode* pop(PendingTaskNode** list)
+    {
+        PendingTaskNode* node = *list;
+        *list = node->next;
+        node->next = nullptr;
+        return node;
+    }
+
+    PendingTaskNode* released_ = nullptr;
+    size_t released_count_ = 0;
+
+    PendingTaskNode* taken_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadCache);
+};
+
+thread_local ThreadCache thread_cache;
+
+} // namespace
+
+// static
+PendingTaskNode* PendingTaskPool::allocate()
+{
+    return thread_cache.allocate();
+}
+
+// static
+void PendingTaskPool::release(PendingTaskNode* node)
+{
+    // The destructor of the task can post new tasks, so the task is destroyed before the node
+    // is put in the cache.
+    node->pending_task.reset();
+    thread_cache.release(node);
+}
+
+} // namespace base
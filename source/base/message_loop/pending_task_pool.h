@@ -0,0 +1,55 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__PENDING_TASK_POOL_H
+#define BASE__MESSAGE_LOOP__PENDING_TASK_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/message_loop/pending_task.h"
+
+#include <optional>
+
+namespace base {
+
+// Carries a pending task through IncomingTaskQueue.
+struct PendingTaskNode
+{
+    std::optional<PendingTask> pending_task;
+    PendingTaskNode* next = nullptr;
+};
+
+// Keeps the released nodes for the next tasks, so in the steady state posting a task does not
+// allocate memory. Each thread caches the nodes it released. The nodes are passed in batches to
+// the threads that post the tasks through a shared list.
+class PendingTaskPool
+{
+public:
+    // Can be called from any thread. The returned node has no task.
+    static PendingTaskNode* allocate();
+
+    // Destroys the task of the node and keeps the node for the next allocations. Can be called
+    // from any thread.
+    static void release(PendingTaskNode* node);
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(PendingTaskPool);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__PENDING_TASK_POOL_H
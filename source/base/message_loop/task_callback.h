@@ -0,0 +1,191 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__TASK_CALLBACK_H
+#define BASE__MESSAGE_LOOP__TASK_CALLBACK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace base {
+
+// A move-only callable without arguments, used for the tasks of the task runners. Unlike
+// std::function, it keeps the callables up to kInlineSize bytes (for example, a lambda that
+// captures a pointer, a ByteArray and a shared_ptr) inside itself, so posting such a task does
+// not allocate memory. The larger callables are allocated on the heap. The callables do not need
+// to be copyable.
+class TaskCallback
+{
+public:
+    static const size_t kInlineSize = 6 * sizeof(void*);
+
+    TaskCallback() = default;
+
+    TaskCallback(std::nullptr_t)
+    {
+        // Nothing
+    }
+
+    template <class Functor,
+              class Type = std::decay_t<Functor>,
+              class = std::enable_if_t<!std::is_same_v<Type, TaskCallback> &&
+                                       std::is_invocable_v<Type&>>>
+    TaskCallback(Functor&& functor)
+    {
+        // An empty std::function or a null pointer to a function makes an empty callback.
+        if constexpr (std::is_constructible_v<bool, const Type&>)
+        {
+            if (!static_cast<bool>(functor))
+                return;
+        }
+
+        if constexpr (isInline<Type>())
+        {
+            new (storage_) Type(std::forward<Functor>(functor));
+            ops_ = &InlineOps<Type>::kOps;
+        }
+        else
+        {
+            *reinterpret_cast<Type**>(storage_) = new Type(std::forward<Functor>(functor));
+            ops_ = &HeapOps<Type>::kOps;
+        }
+    }
+
+    TaskCallback(TaskCallback&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    TaskCallback& operator=(TaskCallback&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+
+        return *this;
+    }
+
+    TaskCallback& operator=(std::nullptr_t)
+    {
+        reset();
+        return *this;
+    }
+
+    ~TaskCallback()
+    {
+        reset();
+    }
+
+    void operator()() const
+    {
+        ops_->invoke(storage_);
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    friend bool operator==(const TaskCallback& callback, std::nullptr_t) { return !callback; }
+    friend bool operator!=(const TaskCallback& callback, std::nullptr_t) { return !!callback; }
+    friend bool operator==(std::nullptr_t, const TaskCallback& callback) { return !callback; }
+    friend bool operator!=(std::nullptr_t, const TaskCallback& callback) { return !!callback; }
+
+    void reset()
+    {
+        if (!ops_)
+            return;
+
+        const Ops* ops = ops_;
+        ops_ = nullptr;
+        ops->destroy(storage_);
+    }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+
+        // Moves the callable from |from| to |to| and destroys it in |from|.
+        void (*move)(void* from, void* to);
+        void (*destroy)(void* storage);
+    };
+
+    template <class Type>
+    static constexpr bool isInline()
+    {
+        return sizeof(Type) <= kInlineSize &&
+               alignof(Type) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Type>;
+    }
+
+    template <class Type>
+    struct InlineOps
+    {
+        static Type* get(void* storage) { return std::launder(reinterpret_cast<Type*>(storage)); }
+
+        static void invoke(void* storage) { (*get(storage))(); }
+
+        static void move(void* from, void* to)
+        {
+            new (to) Type(std::move(*get(from)));
+            get(from)->~Type();
+        }
+
+        static void destroy(void* storage) { get(storage)->~Type(); }
+
+        static constexpr Ops kOps = { &invoke, &move, &destroy };
+    };
+
+    template <class Type>
+    struct HeapOps
+    {
+        static Type*& get(void* storage) { return *reinterpret_cast<Type**>(storage); }
+
+        static void invoke(void* storage) { (*get(storage))(); }
+
+        static void move(void* from, void* to)
+        {
+            get(to) = get(from);
+            get(from) = nullptr;
+        }
+
+        static void destroy(void* storage) { delete get(storage); }
+
+        static constexpr Ops kOps = { &invoke, &move, &destroy };
+    };
+
+    void moveFrom(TaskCallback& other)
+    {
+        if (!other.ops_)
+            return;
+
+        other.ops_->move(other.storage_, storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+    }
+
+    // The callable is called through a const object, like std::function.
+    alignas(std::max_align_t) mutable unsigned char storage_[kInlineSize];
+    const Ops* ops_ = nullptr;
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__TASK_CALLBACK_H
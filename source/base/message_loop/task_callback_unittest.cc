@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/task_callback.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+
+namespace base {
+
+TEST(TaskCallbackTest, Empty)
+{
+    TaskCallback callback;
+    EXPECT_TRUE(callback == nullptr);
+    EXPECT_FALSE(callback);
+
+    std::function<void()> function;
+    TaskCallback from_empty_function(function);
+    EXPECT_TRUE(from_empty_function == nullptr);
+
+    void (*pointer)() = nullptr;
+    TaskCallback from_null_pointer(pointer);
+    EXPECT_TRUE(from_null_pointer == nullptr);
+}
+
+TEST(TaskCallbackTest, MoveOnlyCapture)
+{
+    int result = 0;
+    std::unique_ptr<int> value = std::make_unique<int>(42);
+
+    TaskCallback callback([&result, value = std::move(value)]() { result = *value; });
+    EXPECT_TRUE(callback != nullptr);
+
+    TaskCallback moved(std::move(callback));
+    EXPECT_TRUE(callback == nullptr);
+
+    moved();
+    EXPECT_EQ(result, 42);
+}
+
+TEST(TaskCallbackTest, LargeCapture)
+{
+    std::array<char, TaskCallback::kInlineSize * 2> data;
+    data.fill('a');
+
+    char result = 0;
+    TaskCallback callback([&result, data]() { result = data.back(); });
+
+    TaskCallback moved;
+    moved = std::move(callback);
+    EXPECT_TRUE(callback == nullptr);
+
+    moved();
+    EXPECT_EQ(result, 'a');
+}
+
+TEST(TaskCallbackTest, Destruction)
+{
+    std::shared_ptr<int> value = std::make_shared<int>(0);
+
+    {
+        TaskCallback small([value]() {});
+        EXPECT_EQ(value.use_count(), 2);
+
+        std::array<char, TaskCallback::kInlineSize> data {};
+        TaskCallback large([value, data]() {});
+        EXPECT_EQ(value.use_count(), 3);
+
+        TaskCallback moved(std::move(large));
+        EXPECT_EQ(value.use_count(), 3);
+
+        small = std::move(moved);
+        EXPECT_EQ(value.use_count(), 2);
+
+        small.reset();
+        EXPECT_EQ(value.use_count(), 1);
+    }
+
+    EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(TaskCallbackTest, FromFunction)
+{
+    int count = 0;
+    std::function<void()> function = [&count]() { ++count; };
+
+    // The function is copied.
+    TaskCallback callback(function);
+    callback();
+    function();
+
+    EXPECT_EQ(count, 2);
+}
+
+} // namespace base
@@ -0,0 +1,136 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/timer_service.h"
+
+#include "base/coalesced_timer.h"
+#include "base/logging.h"
+
+namespace base {
+
+TimerService::TimerService() = default;
+
+TimerService::~TimerService()
+{
+    // The timers that outlive the service become inactive and do not touch it anymore.
+    for (auto& bucket : buckets_)
+    {
+        CoalescedTimer* timer = bucket.second.first;
+
+        while (timer)
+        {
+            CoalescedTimer* next = timer->next_;
+
+            timer->active_ = false;
+            timer->prev_ = nullptr;
+            timer->next_ = nullptr;
+
+            timer = next;
+        }
+    }
+}
+
+bool TimerService::runExpired(const TimePoint& now)
+{
+    bool did_work = false;
+
+    while (!buckets_.empty())
+    {
+        auto bucket = buckets_.begin();
+        if (bucket->first > now)
+            break;
+
+        // The timers are taken one by one, a callback can stop or start any other timer.
+        CoalescedTimer* timer = bucket->second.first;
+        remove(timer);
+
+        // The callback is moved out because it can restart or destroy the timer.
+        CoalescedTimer::Callback callback = std::move(timer->callback_);
+        callback();
+
+        did_work = true;
+    }
+
+    return did_work;
+}
+
+TimerService::TimePoint TimerService::nextDeadline() const
+{
+    if (buckets_.empty())
+        return TimePoint();
+
+    return buckets_.begin()->first;
+}
+
+void TimerService::add(CoalescedTimer* timer)
+{
+    DCHECK(!timer->active_);
+
+    auto result = buckets_.try_emplace(timer->bucket_time_, Bucket{ timer, timer });
+    if (!result.second)
+    {
+        // Added to the end of the existing bucket.
+        Bucket& bucket = result.first->second;
+
+        bucket.last->next_ = timer;
+        timer->prev_ = bucket.last;
+        bucket.last = timer;
+    }
+
+    timer->active_ = true;
+    ++active_timers_;
+}
+
+void TimerService::remove(CoalescedTimer* timer)
+{
+    DCHECK(timer->active_);
+
+    if (!timer->prev_ || !timer->next_)
+    {
+        // The first or the last timer of the bucket.
+        auto bucket = buckets_.find(timer->bucket_time_);
+        DCHECK(bucket != buckets_.end());
+
+        if (!timer->prev_ && !timer->next_)
+        {
+            buckets_.erase(bucket);
+        }
+        else if (!timer->prev_)
+        {
+            DCHECK(bucket->second.first == timer);
+            bucket->second.first = timer->next_;
+        }
+        else
+        {
+            DCHECK(bucket->second.last == timer);
+            bucket->second.last = timer->prev_;
+        }
+    }
+
+    if (timer->prev_)
+        timer->prev_->next_ = timer->next_;
+    if (timer->next_)
+        timer->next_->prev_ = timer->prev_;
+
+    timer->prev_ = nullptr;
+    timer->next_ = nullptr;
+    timer->active_ = false;
+    --active_timers_;
+}
+
+} // namespace base
@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__TIMER_SERVICE_H
+#define BASE__MESSAGE_LOOP__TIMER_SERVICE_H
+
+#include "base/macros_magic.h"
+#include "base/message_loop/message_pump.h"
+
+#include <map>
+
+namespace base {
+
+class CoalescedTimer;
+
+// Deadlines of the CoalescedTimer objects of one thread. The deadline of a timer is rounded up to
+// a multiple of its slack, so the timers of one class (for example, the keep alive timers of the
+// network channels) that expire close to each other share a bucket and fire together. Nothing is
+// armed in the kernel: MessagePumpForAsio sleeps until the nearest bucket and runs the expired
+// buckets itself. Starting and stopping a timer costs a lookup among the buckets, not the timers.
+// Not thread-safe, used only on the thread of the pump.
+class TimerService
+{
+public:
+    using Clock = MessagePump::Clock;
+    using TimePoint = MessagePump::TimePoint;
+
+    TimerService();
+    ~TimerService();
+
+    // Runs the callbacks of the timers whose deadlines have come. Returns true if any callback was
+    // called.
+    bool runExpired(const TimePoint& now);
+
+    // Returns the nearest deadline or a null TimePoint if there are no active timers.
+    TimePoint nextDeadline() const;
+
+    size_t activeTimers() const { return active_timers_; }
+
+private:
+    friend class CoalescedTimer;
+
+    void add(CoalescedTimer* timer);
+    void remove(CoalescedTimer* timer);
+
+    // The timers of a bucket form a doubly linked list and fire in the order they were started.
+    struct Bucket
+    {
+        CoalescedTimer* first;
+        CoalescedTimer* last;
+    };
+
+    std::map<TimePoint, Bucket> buckets_;
+    size_t active_timers_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TimerService);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__TIMER_SERVICE_H
@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/timer_service.h"
+
+#include "base/coalesced_timer.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+using Milliseconds = std::chrono::milliseconds;
+
+} // namespace
+
+TEST(TimerServiceTest, Coalescing)
+{
+    TimerService service;
+    EXPECT_EQ(service.nextDeadline(), TimerService::TimePoint());
+
+    const TimerService::TimePoint start = TimerService::Clock::now();
+
+    std::vector<std::unique_ptr<CoalescedTimer>> timers;
+    int fired = 0;
+
+    // The deadlines within one second are rounded up to one bucket.
+    for (int i = 0; i < 100; ++i)
+    {
+        timers.emplace_back(std::make_unique<CoalescedTimer>(&service, Milliseconds(1000)));
+        timers.back()->start(Milliseconds(10000 + i), [&]() { ++fired; });
+    }
+
+    EXPECT_EQ(service.activeTimers(), 100u);
+
+    const TimerService::TimePoint deadline = service.nextDeadline();
+    EXPECT_GE(deadline, start + Milliseconds(10099));
+    EXPECT_LE(deadline - start, Milliseconds(12000));
+
+    // Never earlier than requested.
+    EXPECT_FALSE(service.runExpired(deadline - Milliseconds(1)));
+    EXPECT_EQ(fired, 0);
+
+    EXPECT_TRUE(service.runExpired(deadline));
+    EXPECT_EQ(fired, 100);
+    EXPECT_EQ(service.activeTimers(), 0u);
+    EXPECT_EQ(service.nextDeadline(), TimerService::TimePoint());
+
+    for (const auto& timer : timers)
+        EXPECT_FALSE(timer->isActive());
+}
+
+TEST(TimerServiceTest, StopAndRestart)
+{
+    TimerService service;
+
+    CoalescedTimer first(&service, Milliseconds(100));
+    CoalescedTimer second(&service, Milliseconds(100));
+    CoalescedTimer third(&service, Milliseconds(100));
+
+    std::vector<int> fired;
+
+    first.start(Milliseconds(1000), [&]() { fired.push_back(1); });
+    second.start(Milliseconds(1000), [&]()
+    {
+        fired.push_back(2);
+
+        // A callback stops a timer of the same bucket and restarts its own timer.
+        third.stop();
+        second.start(Milliseconds(5000), [&]() { fired.push_back(20); });
+    });
+    third.start(Milliseconds(1000), [&]() { fired.push_back(3); });
+
+    // The timer in the middle of the bucket is removed and added again.
+    first.stop();
+    EXPECT_FALSE(first.isActive());
+    first.start(Milliseconds(1000), [&]() { fired.push_back(1); });
+
+    const TimerService::TimePoint now = TimerService::Clock::now();
+
+    service.runExpired(now + Milliseconds(2000));
+    ASSERT_EQ(fired.size(), 2u);
+    EXPECT_FALSE(third.isActive());
+    EXPECT_TRUE(second.isActive());
+
+    service.runExpired(now + Milliseconds(10000));
+    ASSERT_EQ(fired.size(), 3u);
+    EXPECT_EQ(fired.back(), 20);
+}
+
+TEST(TimerServiceTest, DestroyInCallback)
+{
+    TimerService service;
+
+    auto timer = std::make_unique<CoalescedTimer>(&service, Milliseconds(0));
+    timer->start(Milliseconds(0), [&]() { timer.reset(); });
+
+    EXPECT_TRUE(service.runExpired(TimerService::Clock::now() + Milliseconds(1)));
+    EXPECT_FALSE(timer);
+    EXPECT_EQ(service.activeTimers(), 0u);
+}
+
+TEST(TimerServiceTest, ServiceDestroyedFirst)
+{
+    auto service = std::make_unique<TimerService>();
+
+    CoalescedTimer timer(service.get(), Milliseconds(100));
+    timer.start(Milliseconds(1000), []() {});
+
+    // The timer becomes inactive and does not touch the destroyed service.
+    service.reset();
+    EXPECT_FALSE(timer.isActive());
+}
+
+} // namespace base
@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/metrics_writer.h"
+
+#include "base/logging.h"
+
+#include <cstdio>
+
+namespace base {
+
+namespace {
+
+std::string doubleToString(double value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+const char* typeToString(MetricsWriter::Type type)
+{
+    switch (type)
+    {
+        case MetricsWriter::Type::COUNTER:
+            return "counter";
+
+        case MetricsWriter::Type::GAUGE:
+            return "gauge";
+
+        case MetricsWriter::Type::HISTOGRAM:
+            return "histogram";
+
+        default:
+            NOTREACHED();
+            return "untyped";
+    }
+}
+
+} // namespace
+
+MetricsWriter::MetricsWriter() = default;
+
+MetricsWriter::~MetricsWriter() = default;
+
+void MetricsWriter::addMetric(std::string_view name, Type type, std::string_view help)
+{
+    text_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    text_.append("# TYPE ").append(name).append(" ").append(typeToString(type)).append("\n");
+}
+
+void MetricsWriter::addSample(std::string_view name, double value, std::string_view labels)
+{
+    addSampleText(name, labels, doubleToString(value));
+}
+
+void MetricsWriter::addSample(std::string_view name, int64_t value, std::string_view labels)
+{
+    addSampleText(name, labels, std::to_string(value));
+}
+
+void MetricsWriter::addHistogram(std::string_view name, std::string_view help,
+                                 const LatencyHistogram& histogram)
+{
+    LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+
+    addMetric(name, Type::HISTOGRAM, help);
+
+    std::string bucket_name = std::string(name) + "_bucket";
+
+    for (const auto& bucket : snapshot.buckets)
+    {
+        std::string labels = "le=\"" + doubleToString(bucket.upper_bound) + "\"";
+        addSampleText(bucket_name, labels, std::to_string(bucket.count));
+    }
+
+    addSampleText(bucket_name, "le=\"+Inf\"", std::to_string(snapshot.count));
+    addSampleText(std::string(name) + "_sum", {}, doubleToString(snapshot.sum));
+    addSampleText(std::string(name) + "_count", {}, std::to_string(snapshot.count));
+}
+
+void MetricsWriter::addSampleText(
+    std::string_view name, std::string_view labels, const std::string& value)
+{
+    text_.append(name);
+
+    if (!labels.empty())
+        text_.append("{").append(labels).append("}");
+
+    text_.append(" ").append(value).append("\n");
+}
+
+} // namespace base
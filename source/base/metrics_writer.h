@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__METRICS_WRITER_H
+#define BASE__METRICS_WRITER_H
+
+#include "base/latency_histogram.h"
+
+#include <string>
+#include <string_view>
+
+namespace base {
+
+// Formats metrics in the text exposition format of Prometheus. Each metric is started with
+// addMetric() and followed by its samples. |labels| are written as is, for example
+// "type=\"host\"".
+class MetricsWriter
+{
+public:
+    MetricsWriter();
+    ~MetricsWriter();
+
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    void addMetric(std::string_view name, Type type, std::string_view help);
+
+    void addSample(std::string_view name, double value, std::string_view labels = {});
+    void addSample(std::string_view name, int64_t value, std::string_view labels = {});
+
+    // Adds a metric with the buckets, the sum and the count of |histogram|.
+    void addHistogram(std::string_view name, std::string_view help,
+                      const LatencyHistogram& histogram);
+
+    const std::string& text() const { return text_; }
+
+private:
+    void addSampleText(std::string_view name, std::string_view labels, const std::string& value);
+
+    std::string text_;
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsWriter);
+};
+
+} // namespace base
+
+#endif // BASE__METRICS_WRITER_H
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/metrics_writer.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(MetricsWriterTest, Samples)
+{
+    MetricsWriter writer;
+
+    writer.addMetric("aspia_sessions", MetricsWriter::Type::GAUGE, "Active sessions.");
+    writer.addSample("aspia_sessions", int64_t(3), "type=\"host\"");
+    writer.addSample("aspia_sessions", int64_t(0), "type=\"client\"");
+    writer.addMetric("aspia_lag_seconds", MetricsWriter::Type::GAUGE, "Lag.");
+    writer.addSample("aspia_lag_seconds", 0.25);
+
+    EXPECT_EQ(writer.text(),
+              "# HELP aspia_sessions Active sessions.\n"
+              "# TYPE aspia_sessions gauge\n"
+              "aspia_sessions{type=\"host\"} 3\n"
+              "aspia_sessions{type=\"client\"} 0\n"
+              "# HELP aspia_lag_seconds Lag.\n"
+              "# TYPE aspia_lag_seconds gauge\n"
+              "aspia_lag_seconds 0.25\n");
+}
+
+TEST(MetricsWriterTest, Histogram)
+{
+    LatencyHistogram histogram;
+    histogram.add(std::chrono::milliseconds(2));
+    histogram.add(std::chrono::seconds(20));
+
+    MetricsWriter writer;
+    writer.addHistogram("aspia_auth_seconds", "Authentication time.", histogram);
+
+    const std::string& text = writer.text();
+
+    EXPECT_EQ(text.find("# HELP aspia_auth_seconds Authentication time.\n"
+                        "# TYPE aspia_auth_seconds histogram\n"
+                        "aspia_auth_seconds_bucket{le=\"0.001\"} 0\n"
+                        "aspia_auth_seconds_bucket{le=\"0.002\"} 1\n"), 0u);
+    EXPECT_NE(text.find("aspia_auth_seconds_bucket{le=\"10\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("aspia_auth_seconds_bucket{le=\"+Inf\"} 2\n"
+                        "aspia_auth_seconds_sum 20.002\n"
+                        "aspia_auth_seconds_count 2\n"), std::string::npos);
+}
+
+} // namespace base
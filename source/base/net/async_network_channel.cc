@@ -0,0 +1,134 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/async_network_channel.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+
+namespace base {
+
+namespace {
+
+// When the coroutine does not keep up with the peer, the channel stops reading from the socket and
+// the peer is slowed down by TCP flow control instead of the queue growing without bound.
+const size_t kMaxReadQueueSize = 64;
+
+asio::io_context& currentIoContext()
+{
+    return MessageLoop::current()->pumpAsio()->ioContext();
+}
+
+} // namespace
+
+AsyncNetworkChannel::AsyncNetworkChannel(std::unique_ptr<NetworkChannel> channel)
+    : channel_(std::move(channel)),
+      read_event_(currentIoContext()),
+      write_event_(currentIoContext())
+{
+    DCHECK(channel_);
+    DCHECK(channel_->isConnected());
+
+    channel_->setListener(this);
+    channel_->resume();
+}
+
+AsyncNetworkChannel::~AsyncNetworkChannel()
+{
+    channel_->setListener(nullptr);
+}
+
+asio::awaitable<std::shared_ptr<ByteArray>> AsyncNetworkChannel::read()
+{
+    while (read_queue_.empty() && connected_)
+        co_await read_event_.wait();
+
+    if (read_queue_.empty())
+        co_return nullptr;
+
+    std::shared_ptr<ByteArray> buffer = std::move(read_queue_.front());
+    read_queue_.pop_front();
+
+    if (connected_ && read_queue_.size() == kMaxReadQueueSize - 1)
+        channel_->resume();
+
+    co_return buffer;
+}
+
+void AsyncNetworkChannel::send(ByteArray&& buffer)
+{
+    if (!connected_)
+        return;
+
+    channel_->send(std::move(buffer));
+}
+
+asio::awaitable<bool> AsyncNetworkChannel::write(ByteArray&& buffer)
+{
+    send(std::move(buffer));
+    co_return co_await flush();
+}
+
+asio::awaitable<bool> AsyncNetworkChannel::flush()
+{
+    while (connected_ && channel_->pendingMessages() != 0)
+        co_await write_event_.wait();
+
+    co_return connected_;
+}
+
+void AsyncNetworkChannel::onConnected()
+{
+    // The channel is connected before it is passed to the object.
+    NOTREACHED();
+}
+
+void AsyncNetworkChannel::onDisconnected(NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_INFO) << "Channel disconnected: " << NetworkChannel::errorToString(error_code);
+
+    connected_ = false;
+    error_code_ = error_code;
+
+    read_event_.notify();
+    write_event_.notify();
+}
+
+void AsyncNetworkChannel::onMessageReceived(const ByteArray& buffer)
+{
+    onSharedMessageReceived(std::make_shared<ByteArray>(buffer));
+}
+
+void AsyncNetworkChannel::onSharedMessageReceived(const std::shared_ptr<ByteArray>& buffer)
+{
+    read_queue_.emplace_back(buffer);
+
+    if (read_queue_.size() == kMaxReadQueueSize)
+        channel_->pause();
+
+    read_event_.notify();
+}
+
+void AsyncNetworkChannel::onMessageWritten(size_t pending)
+{
+    if (!pending)
+        write_event_.notify();
+}
+
+} // namespace base
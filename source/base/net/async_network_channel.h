@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__ASYNC_NETWORK_CHANNEL_H
+#define BASE__NET__ASYNC_NETWORK_CHANNEL_H
+
+#include "base/message_loop/async_event.h"
+#include "base/net/network_channel.h"
+
+#include <deque>
+#include <memory>
+
+namespace base {
+
+// Coroutine interface of a connected NetworkChannel. The channel is owned by the object and
+// reports to it, the code that uses it is written as a single coroutine instead of a chain of
+// listener callbacks:
+//
+//     asio::co_spawn(MessageLoop::current()->pumpAsio()->ioContext(), [channel]()
+//         -> asio::awaitable<void>
+//     {
+//         while (std::shared_ptr<ByteArray> message = co_await channel->read())
+//             co_await channel->write(handle(*message));
+//     }, asio::detached);
+//
+// The coroutine must run on the thread of the channel and the object must outlive the coroutine.
+class AsyncNetworkChannel : public NetworkChannel::Listener
+{
+public:
+    explicit AsyncNetworkChannel(std::unique_ptr<NetworkChannel> channel);
+    ~AsyncNetworkChannel() override;
+
+    NetworkChannel* channel() const { return channel_.get(); }
+
+    bool isConnected() const { return connected_; }
+
+    // Returns the reason of the disconnection. Valid only after the channel is disconnected.
+    NetworkChannel::ErrorCode errorCode() const { return error_code_; }
+
+    // Waits for the next message. The messages received before the disconnection are returned
+    // first, then nullptr is returned. The message is the buffer the channel received it into and
+    // must not be changed.
+    asio::awaitable<std::shared_ptr<ByteArray>> read();
+
+    // Adds the message to the send queue without waiting. Lets the protocols keep several messages
+    // in flight.
+    void send(ByteArray&& buffer);
+
+    // Sends the message and waits until it and all the messages queued before it are written.
+    // Returns false if the channel is disconnected.
+    asio::awaitable<bool> write(ByteArray&& buffer);
+
+    // Waits until the send queue is empty. Returns false if the channel is disconnected.
+    asio::awaitable<bool> flush();
+
+protected:
+    // NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const ByteArray& buffer) override;
+    void onSharedMessageReceived(const std::shared_ptr<ByteArray>& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    std::unique_ptr<NetworkChannel> channel_;
+
+    bool connected_ = true;
+    NetworkChannel::ErrorCode error_code_ = NetworkChannel::ErrorCode::SUCCESS;
+
+    std::deque<std::shared_ptr<ByteArray>> read_queue_;
+    AsyncEvent read_event_;
+    AsyncEvent write_event_;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncNetworkChannel);
+};
+
+} // namespace base
+
+#endif // BASE__NET__ASYNC_NETWORK_CHANNEL_H
@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/link_quality_estimator.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace base {
+
+namespace {
+
+// Weight of a new sample in the moving averages of the throughput and the loss.
+const double kAlpha = 0.25;
+
+double movingAverage(double last_value, double value)
+{
+    return kAlpha * value + (1.0 - kAlpha) * last_value;
+}
+
+} // namespace
+
+void LinkQualityEstimator::addRoundTripTime(const std::chrono::microseconds& rtt)
+{
+    // The values of the kernel are more precise.
+    if (has_tcp_info_)
+        return;
+
+    const int64_t sample = rtt.count();
+
+    if (!quality_.rtt_us)
+    {
+        quality_.rtt_us = sample;
+        quality_.jitter_us = sample / 2;
+        return;
+    }
+
+    quality_.jitter_us = (3 * quality_.jitter_us + std::abs(quality_.rtt_us - sample)) / 4;
+    quality_.rtt_us = (7 * quality_.rtt_us + sample) / 8;
+}
+
+void LinkQualityEstimator::addInterval(const std::chrono::milliseconds& duration,
+                                       int64_t bytes_rx,
+                                       int64_t bytes_tx,
+                                       const std::optional<TcpInfo>& tcp_info)
+{
+    if (duration.count() <= 0)
+        return;
+
+    const double seconds = static_cast<double>(duration.count()) / 1000.0;
+
+    quality_.speed_rx = static_cast<int64_t>(
+        movingAverage(static_cast<double>(quality_.speed_rx), bytes_rx / seconds));
+    quality_.speed_tx = static_cast<int64_t>(
+        movingAverage(static_cast<double>(quality_.speed_tx), bytes_tx / seconds));
+
+    if (!tcp_info.has_value())
+        return;
+
+    quality_.rtt_us = tcp_info->rtt_us;
+    quality_.jitter_us = tcp_info->rtt_var_us;
+
+    if (has_tcp_info_)
+    {
+        const int64_t retransmitted_bytes =
+            std::max(tcp_info->retransmitted_bytes - last_retransmitted_bytes_, int64_t(0));
+
+        // Intervals without sending say nothing about the loss.
+        if (bytes_tx > 0)
+        {
+            const double loss = std::min(static_cast<double>(retransmitted_bytes) /
+                                         static_cast<double>(bytes_tx), 1.0);
+            quality_.loss = movingAverage(quality_.loss, loss);
+        }
+    }
+
+    has_tcp_info_ = true;
+    last_retransmitted_bytes_ = tcp_info->retransmitted_bytes;
+}
+
+} // namespace base
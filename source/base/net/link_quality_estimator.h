@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__LINK_QUALITY_ESTIMATOR_H
+#define BASE__NET__LINK_QUALITY_ESTIMATOR_H
+
+#include "base/macros_magic.h"
+#include "base/net/tcp_info.h"
+
+#include <chrono>
+#include <optional>
+
+namespace base {
+
+struct LinkQuality
+{
+    // Smoothed round trip time and its variation (jitter) in microseconds. 0 if not measured yet.
+    int64_t rtt_us = 0;
+    int64_t jitter_us = 0;
+
+    // Throughput of the channel in bytes per second.
+    int64_t speed_rx = 0;
+    int64_t speed_tx = 0;
+
+    // Share of the sent data which has been retransmitted, from 0 to 1. Stays 0 if the platform
+    // does not report the retransmissions.
+    double loss = 0;
+};
+
+// Estimates the quality of the link of a channel. The kernel knows the round trip time of a TCP
+// connection better than the application, so its values are used when the platform reports them.
+// Otherwise the round trip times of the keep alive exchange are smoothed as in RFC 6298.
+class LinkQualityEstimator
+{
+public:
+    LinkQualityEstimator() = default;
+    ~LinkQualityEstimator() = default;
+
+    // Adds the round trip time measured by the application.
+    void addRoundTripTime(const std::chrono::microseconds& rtt);
+
+    // Adds the traffic of the channel for |duration| and the state of the connection at its end.
+    void addInterval(const std::chrono::milliseconds& duration,
+                     int64_t bytes_rx,
+                     int64_t bytes_tx,
+                     const std::optional<TcpInfo>& tcp_info);
+
+    const LinkQuality& quality() const { return quality_; }
+
+private:
+    LinkQuality quality_;
+
+    bool has_tcp_info_ = false;
+    int64_t last_retransmitted_bytes_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(LinkQualityEstimator);
+};
+
+} // namespace base
+
+#endif // BASE__NET__LINK_QUALITY_ESTIMATOR_H
@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/link_quality_estimator.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+using namespace std::chrono_literals;
+
+TEST(LinkQualityEstimatorTest, keep_alive_rtt)
+{
+    LinkQualityEstimator estimator;
+    EXPECT_EQ(estimator.quality().rtt_us, 0);
+
+    estimator.addRoundTripTime(80000us);
+    EXPECT_EQ(estimator.quality().rtt_us, 80000);
+    EXPECT_EQ(estimator.quality().jitter_us, 40000);
+
+    estimator.addRoundTripTime(160000us);
+    EXPECT_EQ(estimator.quality().rtt_us, 90000);
+    EXPECT_EQ(estimator.quality().jitter_us, 50000);
+}
+
+TEST(LinkQualityEstimatorTest, throughput)
+{
+    LinkQualityEstimator estimator;
+
+    for (int i = 0; i < 50; ++i)
+        estimator.addInterval(500ms, 1000, 50000, std::nullopt);
+
+    EXPECT_NEAR(static_cast<double>(estimator.quality().speed_rx), 2000.0, 10.0);
+    EXPECT_NEAR(static_cast<double>(estimator.quality().speed_tx), 100000.0, 100.0);
+    EXPECT_EQ(estimator.quality().loss, 0);
+}
+
+TEST(LinkQualityEstimatorTest, tcp_info)
+{
+    LinkQualityEstimator estimator;
+
+    TcpInfo info;
+    info.rtt_us = 30000;
+    info.rtt_var_us = 5000;
+    info.retransmitted_bytes = 100000;
+
+    // The retransmissions before the first report are not counted.
+    estimator.addInterval(1000ms, 0, 100000, info);
+    EXPECT_EQ(estimator.quality().rtt_us, 30000);
+    EXPECT_EQ(estimator.quality().jitter_us, 5000);
+    EXPECT_EQ(estimator.quality().loss, 0);
+
+    // The kernel values take precedence over the keep alive.
+    estimator.addRoundTripTime(200000us);
+    EXPECT_EQ(estimator.quality().rtt_us, 30000);
+
+    for (int i = 0; i < 50; ++i)
+    {
+        info.retransmitted_bytes += 10000;
+        estimator.addInterval(1000ms, 0, 100000, info);
+    }
+
+    EXPECT_NEAR(estimator.quality().loss, 0.1, 0.001);
+}
+
+} // namespace base
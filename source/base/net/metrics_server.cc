@@ -0,0 +1,312 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/metrics_server.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/write.hpp>
+
+#include <array>
+
+namespace base {
+
+namespace {
+
+// The request must be received completely within this time.
+constexpr std::chrono::seconds kRequestTimeout { 10 };
+
+// Only the request line is used. The requests with large headers are rejected.
+const size_t kMaxRequestSize = 8192;
+
+std::string makeResponse(std::string_view status, std::string_view body)
+{
+    std::string response;
+
+    response.append("HTTP/1.1 ").append(status).append("\r\n");
+    response.append("Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+    response.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
+
+    return response;
+}
+
+} // namespace
+
+class MetricsServer::Impl : public std::enable_shared_from_this<Impl>
+{
+public:
+    Impl(asio::io_context& io_context, Callback callback);
+    ~Impl();
+
+    bool start(std::u16string_view address, uint16_t port);
+    void stop();
+
+    // Returns the response for the request line |request_line|.
+    std::string response(std::string_view request_line) const;
+
+private:
+    void doAccept();
+    void onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket);
+
+    asio::io_context& io_context_;
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
+    Callback callback_;
+
+    DISALLOW_COPY_AND_ASSIGN(Impl);
+};
+
+class MetricsServer::Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    Connection(std::shared_ptr<Impl> server, asio::ip::tcp::socket socket);
+    ~Connection();
+
+    void start();
+
+private:
+    void doRead();
+    void onRead(const std::error_code& error_code, size_t bytes_transferred);
+    void onWrite(const std::error_code& error_code, size_t bytes_transferred);
+    void close();
+
+    std::shared_ptr<Impl> server_;
+    asio::ip::tcp::socket socket_;
+    asio::high_resolution_timer timer_;
+
+    std::array<char, 1024> buffer_;
+    std::string request_;
+    std::string response_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+MetricsServer::Impl::Impl(asio::io_context& io_context, Callback callback)
+    : io_context_(io_context),
+      callback_(std::move(callback))
+{
+    DCHECK(callback_);
+}
+
+MetricsServer::Impl::~Impl()
+{
+    DCHECK(!acceptor_);
+}
+
+bool MetricsServer::Impl::start(std::u16string_view address, uint16_t port)
+{
+    std::error_code error_code;
+
+    asio::ip::address ip_address = asio::ip::make_address(utf8FromUtf16(address), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Invalid address of the metrics server: " << std::u16string(address);
+        return false;
+    }
+
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor =
+        std::make_unique<asio::ip::tcp::acceptor>(io_context_);
+
+    asio::ip::tcp::endpoint endpoint(ip_address, port);
+
+    acceptor->open(endpoint.protocol(), error_code);
+    if (!error_code)
+        acceptor->set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (!error_code)
+        acceptor->bind(endpoint, error_code);
+    if (!error_code)
+        acceptor->listen(asio::socket_base::max_listen_connections, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Failed to start the metrics server: "
+                      << utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    acceptor_ = std::move(acceptor);
+    doAccept();
+
+    LOG(LS_INFO) << "Metrics server started on " << std::u16string(address) << ":" << port;
+    return true;
+}
+
+void MetricsServer::Impl::stop()
+{
+    callback_ = nullptr;
+    acceptor_.reset();
+}
+
+std::string MetricsServer::Impl::response(std::string_view request_line) const
+{
+    if (!callback_)
+        return makeResponse("503 Service Unavailable", "");
+
+    size_t method_end = request_line.find(' ');
+    if (method_end == std::string_view::npos)
+        return makeResponse("400 Bad Request", "");
+
+    std::string_view method = request_line.substr(0, method_end);
+    std::string_view target = request_line.substr(method_end + 1);
+    target = target.substr(0, target.find_first_of(" ?"));
+
+    if (method != "GET")
+        return makeResponse("405 Method Not Allowed", "");
+
+    if (target != "/metrics")
+        return makeResponse("404 Not Found", "");
+
+    return makeResponse("200 OK", callback_());
+}
+
+void MetricsServer::Impl::doAccept()
+{
+    acceptor_->async_accept(std::bind(&Impl::onAccept, shared_from_this(),
+                                      std::placeholders::_1, std::placeholders::_2));
+}
+
+void MetricsServer::Impl::onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket)
+{
+    if (!acceptor_)
+        return;
+
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Error while accepting metrics connection: "
+                        << utf16FromLocal8Bit(error_code.message());
+    }
+    else
+    {
+        std::make_shared<Connection>(shared_from_this(), std::move(socket))->start();
+    }
+
+    // Accept next connection.
+    doAccept();
+}
+
+MetricsServer::Connection::Connection(std::shared_ptr<Impl> server, asio::ip::tcp::socket socket)
+    : server_(std::move(server)),
+      socket_(std::move(socket)),
+      timer_(socket_.get_executor())
+{
+    // Nothing
+}
+
+MetricsServer::Connection::~Connection() = default;
+
+void MetricsServer::Connection::start()
+{
+    std::weak_ptr<Connection> connection = weak_from_this();
+
+    timer_.expires_after(kRequestTimeout);
+    timer_.async_wait([connection](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        std::shared_ptr<Connection> self = connection.lock();
+        if (self)
+            self->close();
+    });
+
+    doRead();
+}
+
+void MetricsServer::Connection::doRead()
+{
+    socket_.async_read_some(asio::buffer(buffer_),
+                            std::bind(&Connection::onRead, shared_from_this(),
+                                      std::placeholders::_1, std::placeholders::_2));
+}
+
+void MetricsServer::Connection::onRead(const std::error_code& error_code, size_t bytes_transferred)
+{
+    if (error_code)
+    {
+        close();
+        return;
+    }
+
+    request_.append(buffer_.data(), bytes_transferred);
+
+    if (request_.find("\r\n\r\n") == std::string::npos)
+    {
+        if (request_.size() > kMaxRequestSize)
+        {
+            close();
+            return;
+        }
+
+        doRead();
+        return;
+    }
+
+    std::string_view request_line(request_);
+    request_line = request_line.substr(0, request_line.find("\r\n"));
+
+    response_ = server_->response(request_line);
+
+    asio::async_write(socket_, asio::buffer(response_),
+                      std::bind(&Connection::onWrite, shared_from_this(),
+                                std::placeholders::_1, std::placeholders::_2));
+}
+
+void MetricsServer::Connection::onWrite(
+    const std::error_code& /* error_code */, size_t /* bytes_transferred */)
+{
+    close();
+}
+
+void MetricsServer::Connection::close()
+{
+    std::error_code ignored_code;
+
+    timer_.cancel();
+    socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ignored_code);
+    socket_.close(ignored_code);
+}
+
+MetricsServer::MetricsServer(Callback callback)
+    : impl_(std::make_shared<Impl>(MessageLoop::current()->pumpAsio()->ioContext(),
+                                   std::move(callback)))
+{
+    // Nothing
+}
+
+MetricsServer::~MetricsServer()
+{
+    impl_->stop();
+}
+
+bool MetricsServer::start(std::u16string_view address, uint16_t port)
+{
+    return impl_->start(address, port);
+}
+
+void MetricsServer::stop()
+{
+    impl_->stop();
+}
+
+} // namespace base
@@ -0,0 +1,57 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__METRICS_SERVER_H
+#define BASE__NET__METRICS_SERVER_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace base {
+
+// A minimal HTTP server that answers "GET /metrics" with the metrics in the text format of
+// Prometheus. Every connection serves one request and is closed. The server runs on the asio
+// message loop of the thread where it is created.
+class MetricsServer
+{
+public:
+    // Returns the text of the metrics. Called on the thread of the server for each request.
+    using Callback = std::function<std::string()>;
+
+    explicit MetricsServer(Callback callback);
+    ~MetricsServer();
+
+    bool start(std::u16string_view address, uint16_t port);
+    void stop();
+
+private:
+    class Connection;
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsServer);
+};
+
+} // namespace base
+
+#endif // BASE__NET__METRICS_SERVER_H
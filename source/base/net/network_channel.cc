@@ -18,28 +18,81 @@
 
 #include "base/net/network_channel.h"
 
+#include "base/coalesced_timer.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/endian_util.h"
+#include "base/system_time.h"
+#include "base/trace_event.h"
 #include "base/crypto/large_number_increment.h"
 #include "base/crypto/message_encryptor_fake.h"
 #include "base/crypto/message_decryptor_fake.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/net/network_channel_proxy.h"
+#include "base/net/tcp_info.h"
 #include "base/net/tcp_keep_alive.h"
+#include "base/net/tcp_reuse_address.h"
+#include "base/net/tcp_send_queue.h"
 #include "base/strings/string_printf.h"
 #include "base/strings/unicode.h"
+#include "build/build_config.h"
+
+#include <algorithm>
+#include <iterator>
 
 #include <asio/connect.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#if defined(OS_POSIX)
+#include <unistd.h>
+#endif // defined(OS_POSIX)
+
 namespace base {
 
 namespace {
 
 static const size_t kMaxMessageSize = 16 * 1024 * 1024; // 16 MB
 
+// Limits of the messages which are written with one vectored write. A larger message is written
+// alone.
+static const size_t kMaxWriteBatchCount = 16;
+static const size_t kMaxWriteBatchSize = 1024 * 1024; // 1 MB
+
+// Maximum size of the variable-length size of a message.
+static const size_t kMaxVariableSizeLength = 4;
+
+// Larger messages are written in fragments of this size. A batch ends with a fragment, so a message
+// of a higher priority waits at most for the batch and one fragment.
+static const size_t kMaxFragmentSize = 32 * 1024; // 32 kB
+
+// The messages up to this size are packed into BATCH messages.
+static const size_t kMaxBatchedMessageSize = 1024;
+static const size_t kMaxBatchCount = 32;
+static const size_t kMaxBatchSize = 8 * 1024; // 8 kB
+
+// The keep alive timers of all channels of a thread that expire within this interval fire
+// together. The intervals and timeouts are counted in seconds, the precision is not needed.
+static const std::chrono::milliseconds kKeepAliveTimerSlack(1000);
+
+// How often the link quality is estimated while there are listeners.
+static const std::chrono::milliseconds kLinkQualityInterval(1000);
+static const std::chrono::milliseconds kLinkQualityTimerSlack(100);
+
+// The clock offset is estimated from this number of the last keep alive exchanges.
+static const size_t kMaxClockSamples = 8;
+
+// The buffers larger than the largest message of this interval are released. The buffers up to
+// |kMinCompactCapacity| are always kept.
+static const std::chrono::milliseconds kCompactInterval(30000);
+static const std::chrono::milliseconds kCompactTimerSlack(5000);
+static const size_t kMinCompactCapacity = 64 * 1024; // 64 kB
+
+// The number of received messages that the listeners can keep before the channel starts to
+// allocate new read buffers.
+static const size_t kMaxReadBuffers = 4;
+
 int calculateSpeed(int last_speed, const std::chrono::milliseconds& duration, int64_t bytes)
 {
     static const double kAlpha = 0.1;
@@ -48,6 +101,12 @@ int calculateSpeed(int last_speed, const std::chrono::milliseconds& duration, in
         ((1.0 - kAlpha) * static_cast<double>(last_speed)));
 }
 
+bool isBatchable(const WriteTask& task)
+{
+    return task.type() == WriteTask::Type::USER_DATA && !task.stream() && !task.writtenSize() &&
+           !task.data().empty() && task.data().size() <= kMaxBatchedMessageSize;
+}
+
 void resizeBuffer(ByteArray* buffer, size_t new_size)
 {
     // If the reserved buffer size is less, then increase it.
@@ -61,6 +120,13 @@ void resizeBuffer(ByteArray* buffer, size_t new_size)
     buffer->resize(new_size);
 }
 
+void resizeBuffer(Buffer* buffer, size_t new_size)
+{
+    // The previous data is not needed, so it is not copied if the buffer grows.
+    buffer->clear();
+    buffer->resize(new_size);
+}
+
 } // namespace
 
 NetworkChannel::NetworkChannel()
@@ -69,7 +135,9 @@ NetworkChannel::NetworkChannel()
       socket_(io_context_),
       resolver_(std::make_unique<asio::ip::tcp::resolver>(io_context_)),
       encryptor_(std::make_unique<MessageEncryptorFake>()),
-      decryptor_(std::make_unique<MessageDecryptorFake>())
+      decryptor_(std::make_unique<MessageDecryptorFake>()),
+      coalescing_timer_(io_context_),
+      read_pool_(kMaxReadBuffers)
 {
     // Nothing
 }
@@ -80,7 +148,9 @@ NetworkChannel::NetworkChannel(asio::ip::tcp::socket&& socket)
       socket_(std::move(socket)),
       connected_(true),
       encryptor_(std::make_unique<MessageEncryptorFake>()),
-      decryptor_(std::make_unique<MessageDecryptorFake>())
+      decryptor_(std::make_unique<MessageDecryptorFake>()),
+      coalescing_timer_(io_context_),
+      read_pool_(kMaxReadBuffers)
 {
     DCHECK(socket_.is_open());
 }
@@ -123,6 +193,37 @@ std::u16string NetworkChannel::peerAddress() const
     return utf16FromLocal8Bit(socket_.remote_endpoint().address().to_string());
 }
 
+uint16_t NetworkChannel::peerPort() const
+{
+    if (!socket_.is_open())
+        return 0;
+
+    std::error_code error_code;
+    asio::ip::tcp::endpoint endpoint = socket_.remote_endpoint(error_code);
+    if (error_code)
+        return 0;
+
+    return endpoint.port();
+}
+
+asio::ip::tcp::endpoint NetworkChannel::localEndpoint() const
+{
+    if (!socket_.is_open())
+        return asio::ip::tcp::endpoint();
+
+    std::error_code error_code;
+    asio::ip::tcp::endpoint endpoint = socket_.local_endpoint(error_code);
+    if (error_code)
+        return asio::ip::tcp::endpoint();
+
+    return endpoint;
+}
+
+void NetworkChannel::setReuseAddress(bool enable)
+{
+    reuse_address_ = enable;
+}
+
 void NetworkChannel::connect(std::u16string_view address, uint16_t port)
 {
     if (connected_ || !resolver_)
@@ -138,9 +239,7 @@ void NetworkChannel::connect(std::u16string_view address, uint16_t port)
             return;
         }
 
-        asio::async_connect(socket_, endpoints,
-            [this](const std::error_code& error_code,
-                   const asio::ip::tcp::endpoint& /* endpoint */)
+        auto on_connected = [this](const std::error_code& error_code)
         {
             if (error_code)
             {
@@ -152,7 +251,38 @@ void NetworkChannel::connect(std::u16string_view address, uint16_t port)
 
             if (listener_)
                 listener_->onConnected();
-        });
+        };
+
+        if (!reuse_address_)
+        {
+            asio::async_connect(socket_, endpoints,
+                [on_connected](const std::error_code& error_code,
+                               const asio::ip::tcp::endpoint& /* endpoint */)
+            {
+                on_connected(error_code);
+            });
+            return;
+        }
+
+        // The socket options must be set before the socket is bound, so the socket is opened
+        // here and not by async_connect().
+        const asio::ip::tcp::endpoint endpoint = *endpoints.begin();
+        std::error_code open_error_code;
+
+        socket_.open(endpoint.protocol(), open_error_code);
+        if (open_error_code)
+        {
+            onErrorOccurred(FROM_HERE, open_error_code);
+            return;
+        }
+
+        if (!setTcpReuseAddress(socket_.native_handle(), true))
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::UNKNOWN);
+            return;
+        }
+
+        socket_.async_connect(endpoint, on_connected);
     });
 }
 
@@ -178,6 +308,8 @@ void NetworkChannel::resume()
 
     paused_ = false;
 
+    announceFeatures();
+
     switch (state_)
     {
         // We already have an incomplete read operation.
@@ -193,14 +325,94 @@ void NetworkChannel::resume()
 
     // If we have a message that was received before the pause command.
     if (state_ == ReadState::PENDING)
+    {
         onMessageReceived();
 
+        if (paused_)
+        {
+            // The channel is paused again before the whole batch is delivered.
+            state_ = read_batch_.empty() ? ReadState::IDLE : ReadState::PENDING;
+            return;
+        }
+    }
+
     doReadSize();
 }
 
-void NetworkChannel::send(ByteArray&& buffer)
+void NetworkChannel::send(ByteArray&& buffer, Priority priority)
+{
+    proxy_->pending_bytes_ += buffer.size();
+    addWriteTask(WriteTask::Type::USER_DATA, priority, std::move(buffer));
+}
+
+void NetworkChannel::sendToStream(uint8_t stream_id, ByteArray&& buffer, Priority priority)
+{
+    if (!stream_id)
+    {
+        send(std::move(buffer), priority);
+        return;
+    }
+
+    if (!peer_accepts_streams_)
+    {
+        LOG(LS_WARNING) << "The peer does not support streams (stream: "
+                        << static_cast<int>(stream_id) << ")";
+        return;
+    }
+
+    proxy_->pending_bytes_ += buffer.size();
+    addWriteTask(WriteTask::Type::USER_DATA, priority, std::move(buffer), stream_id);
+}
+
+void NetworkChannel::setStreamListener(uint8_t stream_id, StreamListener* listener)
+{
+    DCHECK(stream_id);
+
+    if (listener)
+    {
+        stream_listeners_.insert_or_assign(stream_id, listener);
+        announceStreams();
+    }
+    else
+    {
+        stream_listeners_.erase(stream_id);
+    }
+}
+
+void NetworkChannel::setStreamAcceptor(StreamListener* acceptor)
 {
-    addWriteTask(WriteTask::Type::USER_DATA, std::move(buffer));
+    stream_acceptor_ = acceptor;
+
+    if (acceptor)
+        announceStreams();
+}
+
+void NetworkChannel::closeStream(uint8_t stream_id)
+{
+    DCHECK(stream_id);
+
+    stream_listeners_.erase(stream_id);
+
+    if (!peer_accepts_streams_ || !connected_)
+        return;
+
+    ServiceHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.type      = STREAM_CLOSE;
+    header.reserved2 = stream_id;
+    header.length    = sizeof(uint8_t);
+
+    ByteArray buffer;
+    buffer.resize(sizeof(uint8_t) + sizeof(header) + sizeof(uint8_t));
+
+    // The first byte set to 0 indicates that this is a service message. The data is one zero byte.
+    buffer[0] = 0;
+    memcpy(buffer.data() + sizeof(uint8_t), &header, sizeof(header));
+    buffer.back() = 0;
+
+    // The messages of the stream in the other lanes are written before the lowest lane.
+    addWriteTask(WriteTask::Type::SERVICE_DATA, Priority::BULK, std::move(buffer));
 }
 
 bool NetworkChannel::setNoDelay(bool enable)
@@ -220,6 +432,11 @@ bool NetworkChannel::setNoDelay(bool enable)
     return true;
 }
 
+void NetworkChannel::setCoalescingWindow(const std::chrono::microseconds& window)
+{
+    coalescing_window_ = window;
+}
+
 bool NetworkChannel::setTcpKeepAlive(bool enable,
                                      const Milliseconds& time,
                                      const Milliseconds& interval)
@@ -250,12 +467,9 @@ bool NetworkChannel::setOwnKeepAlive(bool enable, const Seconds& interval, const
     if (!enable)
     {
         keep_alive_counter_.clear();
+        clock_samples_.clear();
 
-        if (keep_alive_timer_)
-        {
-            keep_alive_timer_->cancel();
-            keep_alive_timer_.reset();
-        }
+        keep_alive_timer_.reset();
     }
     else
     {
@@ -264,16 +478,60 @@ bool NetworkChannel::setOwnKeepAlive(bool enable, const Seconds& interval, const
 
         keep_alive_counter_.resize(sizeof(uint32_t));
         memset(keep_alive_counter_.data(), 0, keep_alive_counter_.size());
+        keep_alive_rx_ = total_rx_;
 
-        keep_alive_timer_ = std::make_unique<asio::high_resolution_timer>(io_context_);
-        keep_alive_timer_->expires_after(keep_alive_interval_);
-        keep_alive_timer_->async_wait(
-            std::bind(&NetworkChannel::onKeepAliveInterval, this, std::placeholders::_1));
+        keep_alive_timer_ = std::make_unique<CoalescedTimer>(kKeepAliveTimerSlack);
+        keep_alive_timer_->start(keep_alive_interval_, [this]() { onKeepAliveInterval(); });
     }
 
     return true;
 }
 
+void NetworkChannel::setPresenceMode(bool enable)
+{
+    presence_mode_ = enable;
+    keep_alive_rx_ = total_rx_;
+
+    if (!presence_mode_)
+        return;
+
+    if (state_ == ReadState::READ_SIZE || state_ == ReadState::IDLE)
+        releaseReadBuffers();
+
+    if (write_queue_.empty())
+        releaseWriteBuffers();
+}
+
+size_t NetworkChannel::memoryUsage() const
+{
+    size_t usage = read_pool_.memoryUsage() + read_tag_.capacity() + write_buffer_.capacity() +
+                   write_headers_.capacity() + write_batch_.capacity();
+
+    for (const auto& fragment : read_fragments_)
+        usage += fragment.capacity();
+
+    usage += write_gather_.capacity() * sizeof(MessageEncryptor::Buffer);
+    usage += write_buffers_.capacity() * sizeof(asio::const_buffer);
+    usage += write_parts_.capacity() * sizeof(WritePart);
+
+    return usage;
+}
+
+std::optional<int64_t> NetworkChannel::clockOffset() const
+{
+    if (clock_samples_.empty())
+        return std::nullopt;
+
+    // The error of the estimation is not greater than half of the round trip time.
+    auto best = std::min_element(clock_samples_.cbegin(), clock_samples_.cend(),
+                                 [](const ClockSample& first, const ClockSample& second)
+    {
+        return first.round_trip_time < second.round_trip_time;
+    });
+
+    return best->offset;
+}
+
 bool NetworkChannel::setReadBufferSize(size_t size)
 {
     asio::socket_base::receive_buffer_size option(size);
@@ -308,6 +566,47 @@ bool NetworkChannel::setWriteBufferSize(size_t size)
     return true;
 }
 
+bool NetworkChannel::setNotSentLowWatermark(size_t bytes)
+{
+    return base::setTcpNotSentLowWatermark(socket_.native_handle(), bytes);
+}
+
+size_t NetworkChannel::socketPendingBytes()
+{
+    return base::tcpUnsentBytes(socket_.native_handle()).value_or(0);
+}
+
+void NetworkChannel::addLinkQualityListener(LinkQualityListener* listener)
+{
+    DCHECK(listener);
+
+    link_quality_listeners_.emplace_back(listener);
+    if (link_quality_timer_)
+        return;
+
+    link_quality_time_ = Clock::now();
+    link_quality_rx_ = total_rx_;
+    link_quality_tx_ = total_tx_;
+
+    link_quality_timer_ = std::make_unique<CoalescedTimer>(kLinkQualityTimerSlack);
+    link_quality_timer_->start(kLinkQualityInterval, [this]() { onLinkQualityInterval(); });
+}
+
+void NetworkChannel::removeLinkQualityListener(LinkQualityListener* listener)
+{
+    link_quality_listeners_.erase(
+        std::remove(link_quality_listeners_.begin(), link_quality_listeners_.end(), listener),
+        link_quality_listeners_.end());
+
+    if (link_quality_listeners_.empty())
+        link_quality_timer_.reset();
+}
+
+size_t NetworkChannel::pendingBytes() const
+{
+    return proxy_->pendingBytes();
+}
+
 int NetworkChannel::speedRx()
 {
     TimePoint current_time = Clock::now();
@@ -389,6 +688,50 @@ std::string NetworkChannel::errorToString(ErrorCode error_code)
     return stringPrintf("%s (%d)", str, static_cast<int>(error_code));
 }
 
+bool NetworkChannel::releaseSocket(NativeHandle* handle)
+{
+    DCHECK(handle);
+    DCHECK(state_ == ReadState::IDLE);
+    DCHECK(write_queue_.empty());
+
+    std::error_code error_code;
+    NativeHandle native_handle = socket_.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    connected_ = false;
+    *handle = native_handle;
+    return true;
+}
+
+// static
+std::unique_ptr<NetworkChannel> NetworkChannel::fromNativeHandle(NativeHandle handle)
+{
+    asio::ip::tcp::socket socket(MessageLoop::current()->pumpAsio()->ioContext());
+
+    // NetworkServer accepts only IPv4 connections.
+    std::error_code error_code;
+    socket.assign(asio::ip::tcp::v4(), handle, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to assign socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+
+#if defined(OS_WIN)
+        closesocket(handle);
+#else
+        close(handle);
+#endif // defined(OS_WIN)
+        return nullptr;
+    }
+
+    return std::unique_ptr<NetworkChannel>(new NetworkChannel(std::move(socket)));
+}
+
 void NetworkChannel::disconnect()
 {
     if (!connected_)
@@ -451,132 +794,526 @@ void NetworkChannel::onMessageWritten()
 
 void NetworkChannel::onMessageReceived()
 {
-    resizeBuffer(&decrypt_buffer_, decryptor_->decryptedDataSize(read_buffer_.size()));
+    TRACE_EVENT("net", "NetworkChannel::onMessageReceived");
+
+    if (!read_batch_.empty())
+    {
+        // The messages of a batch are decrypted when it is received.
+        std::vector<std::shared_ptr<ByteArray>> batch;
+        batch.swap(read_batch_);
+
+        for (auto it = batch.begin(); it != batch.end(); ++it)
+        {
+            if (listener_)
+                listener_->onSharedMessageReceived(*it);
+
+            if (paused_)
+            {
+                // The rest of the batch is delivered after the channel is resumed.
+                read_batch_.assign(std::next(it), batch.end());
+                break;
+            }
+        }
+        return;
+    }
 
-    if (!decryptor_->decrypt(read_buffer_.data(), read_buffer_.size(), decrypt_buffer_.data()))
+    // The fragments are decrypted when they are received.
+    if (!read_decrypted_ &&
+        !decryptor_->decryptInPlace(read_tag_.data(), read_buffer_->data(), read_buffer_->size()))
     {
         onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
         return;
     }
 
+    read_decrypted_ = false;
+
+    read_high_water_ = std::max(read_high_water_, read_buffer_->size());
+    if (read_buffer_->capacity() > kMinCompactCapacity)
+        startCompactTimer();
+
+    const uint8_t stream_id = read_stream_;
+    read_stream_ = 0;
+
+    if (stream_id)
+    {
+        StreamListener* stream_listener = stream_acceptor_;
+
+        auto it = stream_listeners_.find(stream_id);
+        if (it != stream_listeners_.end())
+            stream_listener = it->second;
+
+        if (!stream_listener)
+        {
+            LOG(LS_WARNING) << "Message for unknown stream " << static_cast<int>(stream_id)
+                            << " is ignored";
+            return;
+        }
+
+        stream_listener->onStreamMessageReceived(stream_id, *read_buffer_);
+        return;
+    }
+
     if (listener_)
-        listener_->onMessageReceived(decrypt_buffer_);
+        listener_->onSharedMessageReceived(read_buffer_);
 }
 
-void NetworkChannel::addWriteTask(WriteTask::Type type, ByteArray&& data)
+void NetworkChannel::addWriteTask(WriteTask::Type type, Priority priority, ByteArray&& data,
+                                  uint8_t stream_id)
 {
-    const bool schedule_write = write_queue_.empty();
+    if (type == WriteTask::Type::USER_DATA)
+        announceFeatures();
+
+    const bool schedule_write = write_queue_.empty() || coalescing_;
 
     // Add the buffer to the queue for sending.
-    write_queue_.emplace(type, std::move(data));
+    write_queue_.push(WriteTask(type, priority, std::move(data), stream_id));
 
     if (schedule_write)
-        doWrite();
+        startWrite();
 }
 
-void NetworkChannel::doWrite()
+void NetworkChannel::announceFeatures()
 {
-    const ByteArray& source_buffer = write_queue_.front().data();
-    if (source_buffer.empty())
-    {
-        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+    if (features_announced_ || !connected_)
         return;
-    }
 
-    if (write_queue_.front().type() == WriteTask::Type::USER_DATA)
-    {
-        // Calculate the size of the encrypted message.
-        const size_t target_data_size = encryptor_->encryptedDataSize(source_buffer.size());
-
-        if (target_data_size > kMaxMessageSize)
-        {
-            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
-            return;
-        }
+    features_announced_ = true;
+    sendFeatures();
+}
 
-        asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+void NetworkChannel::announceStreams()
+{
+    // If the features are not announced yet, the streams are announced together with them.
+    if (!features_announced_ || streams_announced_ || !connected_)
+        return;
 
-        resizeBuffer(&write_buffer_, variable_size.size() + target_data_size);
+    sendFeatures();
+}
 
-        // Copy the size of the message to the buffer.
-        memcpy(write_buffer_.data(), variable_size.data(), variable_size.size());
+void NetworkChannel::sendFeatures()
+{
+    uint8_t flags = KEEP_ALIVE_PING | KEEP_ALIVE_FRAGMENTS | KEEP_ALIVE_BATCHES;
 
-        // Encrypt the message.
-        if (!encryptor_->encrypt(source_buffer.data(),
-                                 source_buffer.size(),
-                                 write_buffer_.data() + variable_size.size()))
-        {
-            onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
-            return;
-        }
-    }
-    else
+    // The streams are announced only if the channel has a consumer for them.
+    if (stream_acceptor_ || !stream_listeners_.empty())
     {
-        DCHECK_EQ(write_queue_.front().type(), WriteTask::Type::SERVICE_DATA);
-
-        resizeBuffer(&write_buffer_, source_buffer.size());
-
-        // Service data does not need encryption. Copy the source buffer.
-        memcpy(write_buffer_.data(), source_buffer.data(), source_buffer.size());
+        flags |= KEEP_ALIVE_STREAMS;
+        streams_announced_ = true;
     }
 
-    // Send the buffer to the recipient.
-    asio::async_write(socket_,
-                      asio::buffer(write_buffer_.data(), write_buffer_.size()),
-                      std::bind(&NetworkChannel::onWrite,
-                                this,
-                                std::placeholders::_1,
-                                std::placeholders::_2));
+    // A keep alive packet must contain data.
+    const uint8_t data = 0;
+    sendKeepAlive(flags, &data, sizeof(data));
 }
 
-void NetworkChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
+void NetworkChannel::startWrite()
 {
-    if (error_code)
+    DCHECK(!write_queue_.empty());
+
+    if (coalescing_window_.count() > 0 && canCoalesce())
     {
-        onErrorOccurred(FROM_HERE, error_code);
+        if (coalescing_)
+            return;
+
+        coalescing_ = true;
+        coalescing_timer_.expires_after(coalescing_window_);
+        coalescing_timer_.async_wait(
+            std::bind(&NetworkChannel::onCoalescingTimeout, this, std::placeholders::_1));
         return;
     }
 
-    DCHECK(!write_queue_.empty());
-
-    // Update TX statistics.
-    addTxBytes(bytes_transferred);
+    if (coalescing_)
+    {
+        coalescing_ = false;
+        coalescing_timer_.cancel();
+    }
 
-    WriteTask::Type task_type = write_queue_.front().type();
+    doWrite();
+}
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+bool NetworkChannel::canCoalesce() const
+{
+    size_t count = 0;
+    size_t size = 0;
 
-    // If the queue is not empty, then we send the following message.
-    bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
+    for (size_t lane = 0; lane < WriteTask::kPriorityCount; ++lane)
+    {
+        for (const WriteTask& task : write_queue_.lane(lane))
+        {
+            if (!isBatchable(task))
+                return false;
 
-    if (task_type == WriteTask::Type::USER_DATA)
-        onMessageWritten();
+            ++count;
+            size += sizeof(uint16_t) + task.data().size();
+        }
+    }
 
-    if (schedule_write)
-        doWrite();
+    // A full batch is written at once.
+    return count < kMaxBatchCount && size < kMaxBatchSize;
 }
 
-void NetworkChannel::doReadSize()
+void NetworkChannel::onCoalescingTimeout(const std::error_code& error_code)
 {
-    state_ = ReadState::READ_SIZE;
-    asio::async_read(socket_,
-                     variable_size_reader_.buffer(),
-                     std::bind(&NetworkChannel::onReadSize,
-                               this,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
+    if (error_code || !coalescing_)
+        return;
+
+    coalescing_ = false;
+    doWrite();
 }
 
-void NetworkChannel::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
+void NetworkChannel::doWrite()
 {
-    if (error_code)
-    {
-        onErrorOccurred(FROM_HERE, error_code);
-        return;
-    }
+    TRACE_EVENT("net", "NetworkChannel::doWrite");
 
-    // Update RX statistics.
+    DCHECK(!write_queue_.empty());
+    DCHECK(write_parts_.empty());
+
+    // The messages that are queued together (e.g. cursor, audio and video) are written with one
+    // vectored write. The lanes are taken in the order of priority. Plan the parts of the batch
+    // and calculate the size of the buffers.
+    std::array<size_t, WriteTask::kPriorityCount> next_task;
+    next_task.fill(0);
+
+    size_t batch_size = 0;
+    size_t headers_size = 0;
+    size_t shared_size = 0;
+
+    while (write_parts_.size() < kMaxWriteBatchCount)
+    {
+        size_t lane = 0;
+        while (lane < next_task.size() && next_task[lane] == write_queue_.lane(lane).size())
+            ++lane;
+
+        if (lane == next_task.size())
+            break;
+
+        const WriteTask& task = write_queue_.lane(lane)[next_task[lane]];
+        const ByteArray& source_buffer = task.data();
+        if (source_buffer.empty())
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        if (task.type() == WriteTask::Type::SERVICE_DATA)
+        {
+            write_parts_.push_back({ lane, 0, source_buffer.size(), false, true });
+            ++next_task[lane];
+            continue;
+        }
+
+        if (task.stream() && !peer_accepts_streams_)
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        if (peer_accepts_batches_ && isBatchable(task))
+        {
+            // The following small messages of the lane are packed together with this one.
+            const std::deque<WriteTask>& tasks = write_queue_.lane(lane);
+            size_t count = 0;
+            size_t size = 0;
+
+            while (next_task[lane] + count < tasks.size() && count < kMaxBatchCount)
+            {
+                const WriteTask& candidate = tasks[next_task[lane] + count];
+                if (!isBatchable(candidate))
+                    break;
+
+                const size_t next_size = sizeof(uint16_t) + candidate.data().size();
+                if (size + next_size > kMaxBatchSize)
+                    break;
+
+                size += next_size;
+                ++count;
+            }
+
+            if (count > 1)
+            {
+                const size_t target_data_size = encryptor_->encryptedDataSize(size);
+
+                if (!write_parts_.empty() && batch_size + target_data_size > kMaxWriteBatchSize)
+                    break;
+
+                batch_size += target_data_size;
+                headers_size += sizeof(uint8_t) + sizeof(ServiceHeader);
+                shared_size += target_data_size;
+
+                write_parts_.push_back({ lane, 0, size, false, true, count });
+                next_task[lane] += count;
+                continue;
+            }
+        }
+
+        const bool fragment = task.writtenSize() != 0 || task.stream() != 0 ||
+            (peer_accepts_fragments_ && source_buffer.size() > kMaxFragmentSize);
+
+        const size_t offset = task.writtenSize();
+        const size_t size = fragment ?
+            std::min(source_buffer.size() - offset, kMaxFragmentSize) : source_buffer.size();
+
+        // Calculate the size of the encrypted message.
+        const size_t target_data_size = encryptor_->encryptedDataSize(size);
+
+        if (source_buffer.size() > kMaxMessageSize || target_data_size > kMaxMessageSize)
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        if (!write_parts_.empty() && batch_size + target_data_size > kMaxWriteBatchSize)
+            break;
+
+        batch_size += target_data_size;
+        headers_size += target_data_size - size;
+        headers_size += fragment ? sizeof(uint8_t) + sizeof(ServiceHeader) : kMaxVariableSizeLength;
+
+        // Shared buffers are sent to several channels and cannot be encrypted in place.
+        if (task.isShared())
+            shared_size += target_data_size;
+
+        const bool last = offset + size == source_buffer.size();
+        write_parts_.push_back({ lane, offset, size, fragment, last });
+
+        // The fragment ends the batch, the messages queued while it is written can have a higher
+        // priority.
+        if (fragment)
+            break;
+
+        ++next_task[lane];
+    }
+
+    resizeBuffer(&write_buffer_, shared_size);
+    resizeBuffer(&write_headers_, headers_size);
+
+    write_high_water_ = std::max(write_high_water_, shared_size);
+    if (write_buffer_.capacity() > kMinCompactCapacity)
+        startCompactTimer();
+    write_buffers_.clear();
+
+    uint8_t* encrypted_data = write_buffer_.data();
+    uint8_t* header = write_headers_.data();
+
+    next_task.fill(0);
+
+    for (const WritePart& part : write_parts_)
+    {
+        const size_t task_index = next_task[part.lane];
+        WriteTask& task = write_queue_.lane(part.lane)[task_index];
+        if (part.last)
+            next_task[part.lane] += part.count;
+
+        if (part.count > 1)
+        {
+            // The messages are encrypted together with their sizes as one message. Only the sizes
+            // are written into a buffer, the messages are read by the encryptor from the queue.
+            resizeBuffer(&write_batch_, part.count * sizeof(uint16_t));
+            uint8_t* batch = write_batch_.data();
+            write_gather_.clear();
+
+            for (size_t i = 0; i < part.count; ++i)
+            {
+                const ByteArray& message = write_queue_.lane(part.lane)[task_index + i].data();
+                const uint16_t message_size =
+                    EndianUtil::toLittle(static_cast<uint16_t>(message.size()));
+
+                memcpy(batch, &message_size, sizeof(message_size));
+                write_gather_.push_back({ batch, sizeof(message_size) });
+                batch += sizeof(message_size);
+
+                write_gather_.push_back({ message.data(), message.size() });
+            }
+
+            const size_t target_data_size = encryptor_->encryptedDataSize(part.size);
+
+            ServiceHeader service_header;
+            memset(&service_header, 0, sizeof(service_header));
+
+            service_header.type   = BATCH;
+            service_header.length = static_cast<uint32_t>(target_data_size);
+
+            // The first byte set to 0 indicates that this is a service message.
+            header[0] = 0;
+            memcpy(header + sizeof(uint8_t), &service_header, sizeof(service_header));
+
+            write_buffers_.emplace_back(header, sizeof(uint8_t) + sizeof(service_header));
+            header += sizeof(uint8_t) + sizeof(service_header);
+
+            if (!encryptor_->encryptGather(
+                    write_gather_.data(), write_gather_.size(), encrypted_data))
+            {
+                onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+                return;
+            }
+
+            write_buffers_.emplace_back(encrypted_data, target_data_size);
+            encrypted_data += target_data_size;
+            continue;
+        }
+
+        const ByteArray& source_buffer = task.data();
+
+        if (task.type() == WriteTask::Type::SERVICE_DATA)
+        {
+            // Service data does not need encryption. The task stays in the queue until it is
+            // written, so its buffer is written directly.
+            write_buffers_.emplace_back(source_buffer.data(), source_buffer.size());
+            continue;
+        }
+
+        const size_t target_data_size = encryptor_->encryptedDataSize(part.size);
+
+        if (part.fragment)
+        {
+            ServiceHeader service_header;
+            memset(&service_header, 0, sizeof(service_header));
+
+            service_header.type      = FRAGMENT;
+            service_header.flags     = part.last ? FRAGMENT_LAST : 0;
+            service_header.reserved1 = static_cast<uint8_t>(part.lane);
+            service_header.reserved2 = task.stream();
+            service_header.length    = static_cast<uint32_t>(target_data_size);
+
+            // The first byte set to 0 indicates that this is a service message.
+            header[0] = 0;
+            memcpy(header + sizeof(uint8_t), &service_header, sizeof(service_header));
+
+            write_buffers_.emplace_back(header, sizeof(uint8_t) + sizeof(service_header));
+            header += sizeof(uint8_t) + sizeof(service_header);
+
+            task.setWrittenSize(part.offset + part.size);
+        }
+        else
+        {
+            // The writer keeps only the last size, so the sizes of the batch are copied.
+            asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+            memcpy(header, variable_size.data(), variable_size.size());
+
+            write_buffers_.emplace_back(header, variable_size.size());
+            header += variable_size.size();
+        }
+
+        ByteArray* owned_buffer = task.mutableData();
+        if (owned_buffer)
+        {
+            // The tag is written after the size of the message and the data is encrypted in place.
+            const size_t tag_size = target_data_size - part.size;
+            uint8_t* data = owned_buffer->data() + part.offset;
+
+            if (!encryptor_->encryptInPlace(data, part.size, header))
+            {
+                onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+                return;
+            }
+
+            write_buffers_.back() = asio::const_buffer(
+                write_buffers_.back().data(), write_buffers_.back().size() + tag_size);
+            header += tag_size;
+
+            write_buffers_.emplace_back(data, part.size);
+        }
+        else
+        {
+            if (!encryptor_->encrypt(source_buffer.data() + part.offset, part.size, encrypted_data))
+            {
+                onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+                return;
+            }
+
+            write_buffers_.emplace_back(encrypted_data, target_data_size);
+            encrypted_data += target_data_size;
+        }
+    }
+
+    // Send the buffers to the recipient.
+    asio::async_write(socket_,
+                      write_buffers_,
+                      std::bind(&NetworkChannel::onWrite,
+                                this,
+                                std::placeholders::_1,
+                                std::placeholders::_2));
+}
+
+void NetworkChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
+{
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return;
+    }
+
+    // Update TX statistics.
+    addTxBytes(bytes_transferred);
+
+    size_t user_data_count = 0;
+
+    // Delete the sent messages from the queue. The fragmented message stays in the queue until its
+    // last part is written.
+    for (const WritePart& part : write_parts_)
+    {
+        if (!part.last)
+            continue;
+
+        for (size_t i = 0; i < part.count; ++i)
+        {
+            const WriteTask& task = write_queue_.lane(part.lane).front();
+
+            if (task.type() == WriteTask::Type::USER_DATA)
+            {
+                proxy_->pending_bytes_ -= task.data().size();
+
+                // The listener of the channel is notified only about the messages of stream 0.
+                if (!task.stream())
+                    ++user_data_count;
+            }
+
+            write_queue_.pop(part.lane);
+        }
+    }
+
+    write_parts_.clear();
+
+    // The messages sent through the proxy join the lanes, so they are not blocked by the messages
+    // of a lower priority.
+    proxy_->reloadWriteQueue(&write_queue_);
+
+    // If the queue is not empty, then we send the following messages.
+    bool schedule_write = !write_queue_.empty();
+
+    for (size_t i = 0; i < user_data_count; ++i)
+        onMessageWritten();
+
+    if (schedule_write)
+        doWrite();
+    else if (presence_mode_ && write_queue_.empty())
+        releaseWriteBuffers();
+}
+
+void NetworkChannel::doReadSize()
+{
+    // The previous message has been given to the listener.
+    if (presence_mode_)
+        releaseReadBuffers();
+
+    state_ = ReadState::READ_SIZE;
+    asio::async_read(socket_,
+                     variable_size_reader_.buffer(),
+                     std::bind(&NetworkChannel::onReadSize,
+                               this,
+                               std::placeholders::_1,
+                               std::placeholders::_2));
+}
+
+void NetworkChannel::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
+{
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return;
+    }
+
+    // Update RX statistics.
     addRxBytes(bytes_transferred);
 
     std::optional<size_t> size = variable_size_reader_.messageSize();
@@ -584,6 +1321,11 @@ void NetworkChannel::onReadSize(const std::error_code& error_code, size_t bytes_
     {
         size_t message_size = size.value();
 
+        // The listener may have kept the previous message. The pool returns a buffer which is
+        // not used by anyone and keeps its capacity, so the message is not reallocated.
+        read_buffer_.reset();
+        read_buffer_ = read_pool_.acquire();
+
         if (message_size > kMaxMessageSize)
         {
             onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
@@ -608,11 +1350,24 @@ void NetworkChannel::onReadSize(const std::error_code& error_code, size_t bytes_
 
 void NetworkChannel::doReadUserData(size_t length)
 {
-    resizeBuffer(&read_buffer_, length);
+    const size_t data_size = decryptor_->decryptedDataSize(length);
+    if (!data_size || data_size > length)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    // The authentication tag and the encrypted data are read into separate buffers, so the data
+    // is decrypted in place.
+    resizeBuffer(&read_tag_, length - data_size);
+    resizeBuffer(read_buffer_.get(), data_size);
+
+    read_buffers_[0] = asio::buffer(read_tag_.data(), read_tag_.size());
+    read_buffers_[1] = asio::buffer(read_buffer_->data(), read_buffer_->size());
 
     state_ = ReadState::READ_USER_DATA;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     read_buffers_,
                      std::bind(&NetworkChannel::onReadUserData,
                                this,
                                std::placeholders::_1,
@@ -632,7 +1387,7 @@ void NetworkChannel::onReadUserData(const std::error_code& error_code, size_t by
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    DCHECK_EQ(bytes_transferred, read_tag_.size() + read_buffer_->size());
 
     if (paused_)
     {
@@ -653,11 +1408,11 @@ void NetworkChannel::onReadUserData(const std::error_code& error_code, size_t by
 
 void NetworkChannel::doReadServiceHeader()
 {
-    resizeBuffer(&read_buffer_, sizeof(ServiceHeader));
+    resizeBuffer(read_buffer_.get(), sizeof(ServiceHeader));
 
     state_ = ReadState::READ_SERVICE_HEADER;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     asio::buffer(read_buffer_->data(), read_buffer_->size()),
                      std::bind(&NetworkChannel::onReadServiceHeader,
                                this,
                                std::placeholders::_1,
@@ -667,7 +1422,7 @@ void NetworkChannel::doReadServiceHeader()
 void NetworkChannel::onReadServiceHeader(const std::error_code& error_code, size_t bytes_transferred)
 {
     DCHECK_EQ(state_, ReadState::READ_SERVICE_HEADER);
-    DCHECK_EQ(read_buffer_.size(), sizeof(ServiceHeader));
+    DCHECK_EQ(read_buffer_->size(), sizeof(ServiceHeader));
 
     if (error_code)
     {
@@ -675,21 +1430,22 @@ void NetworkChannel::onReadServiceHeader(const std::error_code& error_code, size
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    DCHECK_EQ(bytes_transferred, read_buffer_->size());
 
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
-    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_.data());
+    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_->data());
     if (header->length > kMaxMessageSize)
     {
         onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
         return;
     }
 
-    if (header->type == KEEP_ALIVE)
+    if (header->type == KEEP_ALIVE || header->type == FRAGMENT || header->type == BATCH ||
+        header->type == STREAM_CLOSE)
     {
-        // Keep alive packet must always contain data.
+        // All service messages must contain data.
         if (!header->length)
         {
             onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
@@ -707,17 +1463,17 @@ void NetworkChannel::onReadServiceHeader(const std::error_code& error_code, size
 
 void NetworkChannel::doReadServiceData(size_t length)
 {
-    DCHECK_EQ(read_buffer_.size(), sizeof(ServiceHeader));
+    DCHECK_EQ(read_buffer_->size(), sizeof(ServiceHeader));
     DCHECK_EQ(state_, ReadState::READ_SERVICE_HEADER);
     DCHECK_GT(length, 0u);
 
-    read_buffer_.resize(read_buffer_.size() + length);
+    read_buffer_->resize(read_buffer_->size() + length);
 
     // Now we read the data after the header.
     state_ = ReadState::READ_SERVICE_DATA;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data() + sizeof(ServiceHeader),
-                                  read_buffer_.size() - sizeof(ServiceHeader)),
+                     asio::buffer(read_buffer_->data() + sizeof(ServiceHeader),
+                                  read_buffer_->size() - sizeof(ServiceHeader)),
                      std::bind(&NetworkChannel::onReadServiceData,
                                this,
                                std::placeholders::_1,
@@ -727,7 +1483,7 @@ void NetworkChannel::doReadServiceData(size_t length)
 void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t bytes_transferred)
 {
     DCHECK_EQ(state_, ReadState::READ_SERVICE_DATA);
-    DCHECK_GT(read_buffer_.size(), sizeof(ServiceHeader));
+    DCHECK_GT(read_buffer_->size(), sizeof(ServiceHeader));
 
     if (error_code)
     {
@@ -739,36 +1495,126 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
     addRxBytes(bytes_transferred);
 
     // Incoming buffer contains a service header.
-    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_.data());
+    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_->data());
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size() - sizeof(ServiceHeader));
+    DCHECK_EQ(bytes_transferred, read_buffer_->size() - sizeof(ServiceHeader));
     DCHECK_LE(header->length, kMaxMessageSize);
 
-    if (header->type == KEEP_ALIVE)
+    if (header->type == FRAGMENT)
     {
-        if (header->flags & KEEP_ALIVE_PING)
+        // The buffer contains the complete message after the last fragment is received.
+        const bool last = (header->flags & FRAGMENT_LAST) != 0;
+
+        if (!onFragmentReceived(*header))
+            return;
+
+        if (!last)
         {
-            // Send pong.
-            sendKeepAlive(KEEP_ALIVE_PONG,
-                          read_buffer_.data() + sizeof(ServiceHeader),
-                          read_buffer_.size() - sizeof(ServiceHeader));
+            doReadSize();
+            return;
+        }
+
+        // The message is complete. The same as for a message which is not fragmented.
+        if (paused_)
+        {
+            state_ = ReadState::PENDING;
+            return;
+        }
+
+        onMessageReceived();
+
+        if (paused_)
+        {
+            state_ = ReadState::IDLE;
+            return;
+        }
+    }
+    else if (header->type == BATCH)
+    {
+        if (!onBatchReceived(*header))
+            return;
+
+        if (paused_)
+        {
+            state_ = ReadState::PENDING;
+            return;
+        }
+
+        onMessageReceived();
+
+        if (paused_)
+        {
+            // The listener can pause the channel in the middle of the batch.
+            state_ = read_batch_.empty() ? ReadState::IDLE : ReadState::PENDING;
+            return;
+        }
+    }
+    else if (header->type == STREAM_CLOSE)
+    {
+        // Stream 0 is the channel itself.
+        if (!header->reserved2)
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        onStreamCloseReceived(header->reserved2);
+    }
+    else if (header->type == KEEP_ALIVE)
+    {
+        if ((header->flags & KEEP_ALIVE_PING) && (header->flags & KEEP_ALIVE_FRAGMENTS))
+        {
+            // The peer announces its features, the announcement is not answered.
+            peer_accepts_fragments_ = true;
+            peer_accepts_streams_ = (header->flags & KEEP_ALIVE_STREAMS) != 0;
+            peer_accepts_batches_ = (header->flags & KEEP_ALIVE_BATCHES) != 0;
+        }
+        else if (!(header->flags & KEEP_ALIVE_PING) && header->length == sizeof(uint8_t))
+        {
+            // An old peer answers the announcement of the features, the answer is ignored.
+        }
+        else if (header->flags & KEEP_ALIVE_PING)
+        {
+            if (header->flags & KEEP_ALIVE_TIME)
+            {
+                // The current time is added after the data of the ping.
+                const uint64_t time = EndianUtil::toLittle(
+                    static_cast<uint64_t>(SystemTime::microsecondsSinceEpoch()));
+
+                ByteArray data(read_buffer_->cbegin() + sizeof(ServiceHeader),
+                               read_buffer_->cend());
+                data.resize(data.size() + sizeof(time));
+                memcpy(data.data() + data.size() - sizeof(time), &time, sizeof(time));
+
+                sendKeepAlive(KEEP_ALIVE_PONG | KEEP_ALIVE_TIME, data.data(), data.size());
+            }
+            else
+            {
+                // Send pong.
+                sendKeepAlive(KEEP_ALIVE_PONG,
+                              read_buffer_->data() + sizeof(ServiceHeader),
+                              read_buffer_->size() - sizeof(ServiceHeader));
+            }
         }
         else
         {
-            if (read_buffer_.size() < (sizeof(ServiceHeader) + header->length))
+            if (read_buffer_->size() < (sizeof(ServiceHeader) + header->length))
             {
                 onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
                 return;
             }
 
-            if (header->length != keep_alive_counter_.size())
+            const bool has_time = (header->flags & KEEP_ALIVE_TIME) != 0;
+            const size_t time_size = has_time ? sizeof(uint64_t) : 0;
+
+            if (header->length != keep_alive_counter_.size() + time_size)
             {
                 onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
                 return;
             }
 
             // Pong must contain the same data as ping.
-            if (memcmp(read_buffer_.data() + sizeof(ServiceHeader),
+            if (memcmp(read_buffer_->data() + sizeof(ServiceHeader),
                        keep_alive_counter_.data(),
                        keep_alive_counter_.size()) != 0)
             {
@@ -785,6 +1631,16 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
                               << keep_alive_counter_.size() << " bytes)";
             }
 
+            if (has_time)
+            {
+                uint64_t peer_time;
+                memcpy(&peer_time,
+                       read_buffer_->data() + sizeof(ServiceHeader) + keep_alive_counter_.size(),
+                       sizeof(peer_time));
+
+                addClockSample(static_cast<int64_t>(EndianUtil::fromLittle(peer_time)));
+            }
+
             // The user can disable keep alive. Restart the timer only if keep alive is enabled.
             if (keep_alive_timer_)
             {
@@ -793,10 +1649,9 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
                 // Increase the counter of sent packets.
                 largeNumberIncrement(&keep_alive_counter_);
 
-                // Restart keep alive timer.
-                keep_alive_timer_->expires_after(keep_alive_interval_);
-                keep_alive_timer_->async_wait(
-                    std::bind(&NetworkChannel::onKeepAliveInterval, this, std::placeholders::_1));
+                // Restart keep alive timer. The pong itself does not postpone the next ping.
+                keep_alive_rx_ = total_rx_;
+                keep_alive_timer_->start(keep_alive_interval_, [this]() { onKeepAliveInterval(); });
             }
         }
     }
@@ -809,48 +1664,240 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
     doReadSize();
 }
 
-void NetworkChannel::onKeepAliveInterval(const std::error_code& error_code)
+void NetworkChannel::onStreamCloseReceived(uint8_t stream_id)
 {
-    if (error_code == asio::error::operation_aborted)
+    auto it = stream_listeners_.find(stream_id);
+    if (it == stream_listeners_.end())
+    {
+        // The stream is already closed on this side or was never accepted.
         return;
+    }
 
-    DCHECK(keep_alive_timer_);
+    StreamListener* listener = it->second;
+    stream_listeners_.erase(it);
 
-    if (error_code)
+    listener->onStreamClosed(stream_id);
+}
+
+bool NetworkChannel::onFragmentReceived(const ServiceHeader& header)
+{
+    const size_t lane = header.reserved1;
+    if (lane >= read_fragments_.size())
     {
-        LOG(LS_ERROR) << "Keep alive timer error: " << utf16FromLocal8Bit(error_code.message());
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return false;
+    }
 
-        // Restarting the timer.
-        keep_alive_timer_->expires_after(keep_alive_interval_);
-        keep_alive_timer_->async_wait(
-            std::bind(&NetworkChannel::onKeepAliveInterval, this, std::placeholders::_1));
+    const size_t length = header.length;
+    const size_t data_size = decryptor_->decryptedDataSize(length);
+    if (!data_size || data_size > length)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return false;
     }
-    else
+
+    // The fragments are encrypted separately and are decrypted in the order they arrive. The
+    // authentication tag is followed by the encrypted data.
+    uint8_t* tag = read_buffer_->data() + sizeof(ServiceHeader);
+    uint8_t* data = tag + (length - data_size);
+
+    if (!decryptor_->decryptInPlace(tag, data, data_size))
     {
-        // Save sending time.
-        keep_alive_timestamp_ = Clock::now();
+        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+        return false;
+    }
 
-        // Send ping.
-        sendKeepAlive(KEEP_ALIVE_PING, keep_alive_counter_.data(), keep_alive_counter_.size());
+    ByteArray* message = &read_fragments_[lane];
+    if (message->size() + data_size > kMaxMessageSize)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return false;
+    }
+
+    // The fragments of a message belong to one stream.
+    if (message->empty())
+    {
+        read_fragment_streams_[lane] = header.reserved2;
+    }
+    else if (read_fragment_streams_[lane] != header.reserved2)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return false;
+    }
+
+    message->insert(message->end(), data, data + data_size);
 
-        // If a response is not received within the specified interval, the connection will be
-        // terminated.
-        keep_alive_timer_->expires_after(keep_alive_timeout_);
-        keep_alive_timer_->async_wait(
-            std::bind(&NetworkChannel::onKeepAliveTimeout, this, std::placeholders::_1));
+    if (header.flags & FRAGMENT_LAST)
+    {
+        read_buffer_->swap(*message);
+        message->clear();
+
+        read_decrypted_ = true;
+        read_stream_ = read_fragment_streams_[lane];
     }
+
+    return true;
 }
 
-void NetworkChannel::onKeepAliveTimeout(const std::error_code& error_code)
+bool NetworkChannel::onBatchReceived(const ServiceHeader& header)
 {
-    if (error_code == asio::error::operation_aborted)
+    const size_t length = header.length;
+    const size_t data_size = decryptor_->decryptedDataSize(length);
+    if (!data_size || data_size > length)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return false;
+    }
+
+    // The authentication tag is followed by the encrypted messages.
+    uint8_t* tag = read_buffer_->data() + sizeof(ServiceHeader);
+    uint8_t* data = tag + (length - data_size);
+
+    if (!decryptor_->decryptInPlace(tag, data, data_size))
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+        return false;
+    }
+
+    DCHECK(read_batch_.empty());
+
+    const uint8_t* end = data + data_size;
+
+    while (data != end)
+    {
+        uint16_t message_size;
+
+        if (static_cast<size_t>(end - data) < sizeof(message_size))
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return false;
+        }
+
+        memcpy(&message_size, data, sizeof(message_size));
+        message_size = EndianUtil::fromLittle(message_size);
+        data += sizeof(message_size);
+
+        if (!message_size || static_cast<size_t>(end - data) < message_size)
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return false;
+        }
+
+        std::shared_ptr<ByteArray> message = read_pool_.acquire();
+        message->assign(data, data + message_size);
+        data += message_size;
+
+        read_batch_.emplace_back(std::move(message));
+    }
+
+    return true;
+}
+
+void NetworkChannel::releaseReadBuffers()
+{
+    read_buffer_.reset();
+    read_pool_.trim();
+    read_tag_ = Buffer();
+
+    // A message which is being assembled from the fragments is kept.
+    for (auto& fragment : read_fragments_)
+    {
+        if (fragment.empty())
+            ByteArray().swap(fragment);
+    }
+}
+
+void NetworkChannel::releaseWriteBuffers()
+{
+    DCHECK(write_queue_.empty());
+
+    write_buffer_ = Buffer();
+    write_headers_ = Buffer();
+    write_batch_ = Buffer();
+
+    std::vector<MessageEncryptor::Buffer>().swap(write_gather_);
+    std::vector<asio::const_buffer>().swap(write_buffers_);
+    std::vector<WritePart>().swap(write_parts_);
+}
+
+void NetworkChannel::startCompactTimer()
+{
+    if (!compact_timer_)
+        compact_timer_ = std::make_unique<CoalescedTimer>(kCompactTimerSlack);
+    else if (compact_timer_->isActive())
         return;
 
-    if (error_code)
+    compact_timer_->start(kCompactInterval, [this]() { onCompactTimeout(); });
+}
+
+void NetworkChannel::onCompactTimeout()
+{
+    const size_t read_limit = std::max(read_high_water_, kMinCompactCapacity);
+    const size_t write_limit = std::max(write_high_water_, kMinCompactCapacity);
+
+    read_high_water_ = 0;
+    write_high_water_ = 0;
+
+    // The read buffer and the fragments are not needed between the messages.
+    if (state_ == ReadState::READ_SIZE)
+    {
+        if (read_buffer_ && read_buffer_->capacity() > read_limit)
+            read_buffer_.reset();
+
+        read_pool_.trim(read_limit);
+
+        for (auto& fragment : read_fragments_)
+        {
+            if (fragment.empty() && fragment.capacity() > read_limit)
+                ByteArray().swap(fragment);
+        }
+    }
+
+    // The write buffers are in use until the queue is written.
+    if (write_queue_.empty())
+    {
+        if (write_buffer_.capacity() > write_limit)
+            write_buffer_ = Buffer();
+        if (write_headers_.capacity() > write_limit)
+            write_headers_ = Buffer();
+    }
+
+    // The buffers which were kept for the recent messages are checked again later.
+    if (read_pool_.memoryUsage() > kMinCompactCapacity ||
+        write_buffer_.capacity() > kMinCompactCapacity)
     {
-        LOG(LS_ERROR) << "Keep alive timer error: " << utf16FromLocal8Bit(error_code.message());
+        startCompactTimer();
     }
+}
+
+void NetworkChannel::onKeepAliveInterval()
+{
+    DCHECK(keep_alive_timer_);
 
+    if (presence_mode_ && total_rx_ != keep_alive_rx_)
+    {
+        // The peer has sent something since the previous interval, so it is alive. The ping is
+        // not needed.
+        keep_alive_rx_ = total_rx_;
+        keep_alive_timer_->start(keep_alive_interval_, [this]() { onKeepAliveInterval(); });
+        return;
+    }
+
+    // Save sending time.
+    keep_alive_timestamp_ = Clock::now();
+    keep_alive_send_time_ = SystemTime::microsecondsSinceEpoch();
+
+    // Send ping. The peer is asked for its time to estimate the clock offset.
+    sendKeepAlive(KEEP_ALIVE_PING | KEEP_ALIVE_TIME,
+                  keep_alive_counter_.data(), keep_alive_counter_.size());
+
+    // If a response is not received within the specified interval, the connection will be
+    // terminated.
+    keep_alive_timer_->start(keep_alive_timeout_, [this]() { onKeepAliveTimeout(); });
+}
+
+void NetworkChannel::onKeepAliveTimeout()
+{
     // No response came within the specified period of time. We forcibly terminate the connection.
     onErrorOccurred(FROM_HERE, ErrorCode::SOCKET_TIMEOUT);
 }
@@ -875,7 +1922,67 @@ void NetworkChannel::sendKeepAlive(uint8_t flags, const void* data, size_t size)
     memcpy(buffer.data() + sizeof(uint8_t) + sizeof(header), data, size);
 
     // Add a task to the queue.
-    addWriteTask(WriteTask::Type::SERVICE_DATA, std::move(buffer));
+    addWriteTask(WriteTask::Type::SERVICE_DATA, Priority::CONTROL, std::move(buffer));
+}
+
+void NetworkChannel::addClockSample(int64_t peer_time)
+{
+    const int64_t receive_time = SystemTime::microsecondsSinceEpoch();
+    const int64_t round_trip_time = receive_time - keep_alive_send_time_;
+
+    if (round_trip_time < 0)
+    {
+        // The local clock has been changed.
+        clock_samples_.clear();
+        return;
+    }
+
+    // The peer is considered to have answered in the middle of the round trip.
+    const int64_t offset = peer_time - (keep_alive_send_time_ + round_trip_time / 2);
+
+    clock_samples_.push_back({ round_trip_time, offset });
+    link_quality_estimator_.addRoundTripTime(std::chrono::microseconds(round_trip_time));
+    if (clock_samples_.size() > kMaxClockSamples)
+        clock_samples_.pop_front();
+}
+
+void NetworkChannel::onLinkQualityInterval()
+{
+    const TimePoint current_time = Clock::now();
+    const Milliseconds duration =
+        std::chrono::duration_cast<Milliseconds>(current_time - link_quality_time_);
+
+    std::optional<TcpInfo> tcp_info;
+
+    if (connected_ && tcp_info_supported_)
+    {
+        TcpInfo info;
+
+        // If the platform does not report the state of the connection, it is not asked again.
+        tcp_info_supported_ = readTcpInfo(socket_.native_handle(), &info);
+        if (tcp_info_supported_)
+            tcp_info = info;
+    }
+
+    link_quality_estimator_.addInterval(
+        duration, total_rx_ - link_quality_rx_, total_tx_ - link_quality_tx_, tcp_info);
+
+    link_quality_time_ = current_time;
+    link_quality_rx_ = total_rx_;
+    link_quality_tx_ = total_tx_;
+
+    link_quality_timer_->start(kLinkQualityInterval, [this]() { onLinkQualityInterval(); });
+
+    // The listeners can remove themselves when they are notified.
+    const std::vector<LinkQualityListener*> listeners = link_quality_listeners_;
+    for (LinkQualityListener* listener : listeners)
+    {
+        if (std::find(link_quality_listeners_.cbegin(), link_quality_listeners_.cend(),
+                      listener) != link_quality_listeners_.cend())
+        {
+            listener->onLinkQualityChanged(linkQuality());
+        }
+    }
 }
 
 void NetworkChannel::addTxBytes(size_t bytes_count)
@@ -19,20 +19,28 @@
 #ifndef BASE__NET__NETWORK_CHANNEL_H
 #define BASE__NET__NETWORK_CHANNEL_H
 
+#include "base/crypto/message_encryptor.h"
+#include "base/memory/buffer.h"
 #include "base/memory/byte_array.h"
+#include "base/memory/byte_array_pool.h"
+#include "base/net/link_quality_estimator.h"
 #include "base/net/variable_size.h"
-#include "base/net/write_task.h"
+#include "base/net/write_queue.h"
 
-#include <asio/ip/tcp.hpp>
 #include <asio/high_resolution_timer.hpp>
+#include <asio/ip/tcp.hpp>
 
-#include <queue>
+#include <array>
+#include <deque>
+#include <map>
+#include <optional>
+#include <vector>
 
 namespace base {
 
+class CoalescedTimer;
 class NetworkChannelProxy;
 class Location;
-class MessageEncryptor;
 class MessageDecryptor;
 class NetworkServer;
 
@@ -47,6 +55,7 @@ public:
     using TimePoint = std::chrono::time_point<Clock>;
     using Milliseconds = std::chrono::milliseconds;
     using Seconds = std::chrono::seconds;
+    using Priority = WriteTask::Priority;
 
     enum class ErrorCode
     {
@@ -93,6 +102,38 @@ public:
         virtual void onDisconnected(ErrorCode error_code) = 0;
         virtual void onMessageReceived(const ByteArray& buffer) = 0;
         virtual void onMessageWritten(size_t pending) = 0;
+
+        // Called with the buffer of the received message. The listener may keep the buffer instead
+        // of copying the message, the channel reads the next messages into other buffers. The
+        // buffer must not be changed. By default, onMessageReceived() is called.
+        virtual void onSharedMessageReceived(const std::shared_ptr<ByteArray>& buffer)
+        {
+            onMessageReceived(*buffer);
+        }
+    };
+
+    // Receives the messages of a stream (see sendToStream()).
+    class StreamListener
+    {
+    public:
+        virtual ~StreamListener() = default;
+
+        virtual void onStreamMessageReceived(uint8_t stream_id, const ByteArray& buffer) = 0;
+
+        // Called when the peer closes the stream (see closeStream()).
+        virtual void onStreamClosed(uint8_t /* stream_id */)
+        {
+            // Nothing
+        }
+    };
+
+    // Receives the estimates of the link quality (see addLinkQualityListener()).
+    class LinkQualityListener
+    {
+    public:
+        virtual ~LinkQualityListener() = default;
+
+        virtual void onLinkQualityChanged(const LinkQuality& quality) = 0;
     };
 
     std::shared_ptr<NetworkChannelProxy> channelProxy();
@@ -110,6 +151,17 @@ public:
     // Gets the address of the remote host as a string.
     std::u16string peerAddress() const;
 
+    // Gets the port of the remote host.
+    uint16_t peerPort() const;
+
+    // Gets the local address and port of the connection.
+    asio::ip::tcp::endpoint localEndpoint() const;
+
+    // Allows other sockets to bind to the local port of the connection. A hole puncher uses it to
+    // connect from the port that the router sees. Must be called before connect(). Only the first
+    // resolved address is tried.
+    void setReuseAddress(bool enable);
+
     // Connects to a host at the specified address and port.
     void connect(std::u16string_view address, uint16_t port);
 
@@ -128,13 +180,44 @@ public:
     // After calling the method, reading new messages will continue.
     void resume();
 
-    // Sending a message. The method call is thread safe. After the call, the message will be added
-    // to the queue to be sent.
-    void send(ByteArray&& buffer);
+    // Sending a message. After the call, the message will be added to the queue to be sent. The
+    // messages of a higher |priority| are sent first. If the peer supports it, a large message is
+    // sent in fragments and the messages of a higher priority are sent between them, so a video
+    // frame or a file chunk does not delay the input events and the audio.
+    void send(ByteArray&& buffer, Priority priority = Priority::CONTROL);
+
+    // Several sessions can share one connection. The messages sent by send() belong to stream 0
+    // and are delivered to the listener of the channel. The other streams share the connection,
+    // the encryption and the priorities with stream 0, so an additional session (e.g. the file
+    // transfer next to the desktop) does not need a connection and an authentication of its own.
+    // A message of a stream is delivered to the listener of the stream. If the stream has no
+    // listener (the first message of a new stream), it is delivered to the stream acceptor. The
+    // streams are opened by the client, the host answers in the same stream. A stream is closed
+    // by closeStream(), the listener of the stream on the other side is notified. The streams are
+    // also closed together with the channel, then only the listener of the channel is notified.
+    // The streams can be used only if the peer supports them (see peerSupportsStreams()). The
+    // support is announced when the channel gets its first stream listener or stream acceptor.
+    void sendToStream(uint8_t stream_id, ByteArray&& buffer, Priority priority = Priority::CONTROL);
+    void setStreamListener(uint8_t stream_id, StreamListener* listener);
+    void setStreamAcceptor(StreamListener* acceptor);
+
+    // Removes the listener of the stream and notifies the peer. The messages sent to the stream
+    // before are delivered first.
+    void closeStream(uint8_t stream_id);
+
+    // Returns true if the peer has announced the support of the streams. The announcement is sent
+    // before the first message or when the peer gets a consumer of the streams later, so it is
+    // known before the first message of the peer to a stream is received.
+    bool peerSupportsStreams() const { return peer_accepts_streams_; }
 
     // Disable or enable the algorithm of Nagle.
     bool setNoDelay(bool enable);
 
+    // Sets the time for which the small messages are held before they are written, so that a burst
+    // of them (e.g. input events) is written and encrypted together. Messages which are not small
+    // are written at once together with the held ones. Zero (the default) disables the delay.
+    void setCoalescingWindow(const std::chrono::microseconds& window);
+
     // Enables or disables sending keep alive packets.
     // If the |enable| is set to true, TCP keep-alive is enabled. If |enable| is false, then
     // disabled and |time| and |interval| are ignored.
@@ -149,19 +232,72 @@ public:
                          const Seconds& interval = Seconds(45),
                          const Seconds& timeout = Seconds(15));
 
+    // Tunes the channel for a connection which stays open for a long time and carries a few small
+    // messages (e.g. a host registered on the router). The buffers are released as soon as a
+    // message is read or written, and own keep alive does not send a ping if something has been
+    // received since the previous interval. Disabled by default.
+    void setPresenceMode(bool enable);
+
+    // Returns the capacity of the read and write buffers of the channel.
+    size_t memoryUsage() const;
+
+    // Returns the difference between the clock of the peer and the local clock in microseconds
+    // (the time of the peer is the local time plus the offset). It is estimated from the recent
+    // keep alive exchange with the smallest round trip time. Returns an empty value if own keep
+    // alive is disabled, no exchange is completed yet or the peer does not report its time.
+    std::optional<int64_t> clockOffset() const;
+
     bool setReadBufferSize(size_t size);
     bool setWriteBufferSize(size_t size);
 
+    // Limits the data which is written to the socket but not sent yet by the kernel. Without the
+    // limit megabytes of video may wait in the send buffer, where the priorities of the channel and
+    // the pending counters do not see them. See base::setTcpNotSentLowWatermark().
+    bool setNotSentLowWatermark(size_t bytes);
+
+    // Returns the number of bytes in the send queue of the socket which the kernel has not sent
+    // yet. The bytes in flight are not counted. Returns 0 if the platform does not report it.
+    size_t socketPendingBytes();
+
+    // Returns the number of messages in the queue for sending.
+    size_t pendingMessages() const { return write_queue_.size(); }
+
+    // Returns the size of the user data in the queue for sending (including the messages sent
+    // through the proxy).
+    size_t pendingBytes() const;
+
+    // Subscribes |listener| to the estimates of the round trip time, throughput and loss of the
+    // link. While there are listeners, the estimate is updated every second and the listeners are
+    // notified. A listener must be removed before it is destroyed.
+    void addLinkQualityListener(LinkQualityListener* listener);
+    void removeLinkQualityListener(LinkQualityListener* listener);
+
+    // Returns the last estimate of the link quality.
+    const LinkQuality& linkQuality() const { return link_quality_estimator_.quality(); }
+
     int64_t totalRx() const { return total_rx_; }
     int64_t totalTx() const { return total_tx_; }
     int speedRx();
     int speedTx();
 
+    using NativeHandle = asio::ip::tcp::socket::native_handle_type;
+
+    // Releases the socket of a channel accepted by NetworkServer, so the connection can be moved
+    // to the io_context of another thread. No operations must have been started on the channel.
+    // Returns false if the socket cannot be released, the channel is left unchanged in this case.
+    bool releaseSocket(NativeHandle* handle);
+
+    // Creates a channel for a socket released by releaseSocket(). The channel works on the
+    // io_context of the current thread. If the socket cannot be assigned, it is closed and nullptr
+    // is returned.
+    static std::unique_ptr<NetworkChannel> fromNativeHandle(NativeHandle handle);
+
     // Converts an error code to a human readable string.
     // Does not support localization. Used for logs.
     static std::string errorToString(ErrorCode error_code);
 
 protected:
+    friend class HolePuncher;
     friend class NetworkServer;
     friend class RelayPeer;
 
@@ -187,13 +323,72 @@ private:
 
     enum ServiceMessageType
     {
-        KEEP_ALIVE = 1
+        KEEP_ALIVE = 1,
+
+        // A part of a large user message. The data is encrypted separately from the other parts.
+        // The |reserved1| field of the header contains the priority of the message, the parts of a
+        // message arrive in order, but the parts of the messages of different priorities can be
+        // mixed. The |reserved2| field contains the stream of the message. The messages of the
+        // streams other than 0 are always sent as fragments, even if they fit into one.
+        FRAGMENT = 2,
+
+        // Several small user messages of stream 0 encrypted together. The data is the
+        // authentication tag followed by the encrypted messages, each of them is preceded by its
+        // size (uint16, little endian). Sent only to the peers which announced
+        // KEEP_ALIVE_BATCHES.
+        BATCH = 3,
+
+        // The stream in the |reserved2| field is closed by the sender. Carries one byte of data.
+        // Sent only to the peers which announced KEEP_ALIVE_STREAMS.
+        STREAM_CLOSE = 4
+    };
+
+    enum FragmentFlags
+    {
+        // The last part of the message.
+        FRAGMENT_LAST = 1
     };
 
     enum KeepAliveFlags
     {
         KEEP_ALIVE_PONG = 0,
-        KEEP_ALIVE_PING = 1
+        KEEP_ALIVE_PING = 1,
+
+        // In a ping, asks the peer to add its time to the pong. In a pong, the data is followed by
+        // the time of the peer (int64, microseconds since the Unix epoch, little endian). Old
+        // peers ignore the flag and send the data back unchanged.
+        KEEP_ALIVE_TIME = 2,
+
+        // In a ping, announces that the sender accepts fragmented messages. It is sent before the
+        // first message and carries one byte of data. New peers do not answer it, old peers
+        // ignore the flag and answer with a pong of the same single byte, which is ignored.
+        KEEP_ALIVE_FRAGMENTS = 4,
+
+        // In a ping, announces that the sender supports the streams. Sent in the same ping as
+        // KEEP_ALIVE_FRAGMENTS if the sender has a consumer for the streams. If the consumer
+        // appears after the first message, the ping is sent once more with this flag.
+        KEEP_ALIVE_STREAMS = 8,
+
+        // In a ping, announces that the sender accepts BATCH messages. Sent in the same ping as
+        // KEEP_ALIVE_FRAGMENTS.
+        KEEP_ALIVE_BATCHES = 16
+    };
+
+    struct ClockSample
+    {
+        int64_t round_trip_time;
+        int64_t offset;
+    };
+
+    // A message or a fragment of a message in the batch which is being written.
+    struct WritePart
+    {
+        size_t lane;
+        size_t offset; // Offset of the data in the message.
+        size_t size;   // Size of the data.
+        bool fragment;
+        bool last;     // The message is written completely with this part.
+        size_t count = 1; // The number of messages in the part (more than one for BATCH).
     };
 
     struct ServiceHeader
@@ -210,8 +405,18 @@ private:
     void onMessageWritten();
     void onMessageReceived();
 
-    void addWriteTask(WriteTask::Type type, ByteArray&& data);
-
+    void addWriteTask(WriteTask::Type type, Priority priority, ByteArray&& data,
+                      uint8_t stream_id = 0);
+    void announceFeatures();
+    void announceStreams();
+    void sendFeatures();
+    void onStreamCloseReceived(uint8_t stream_id);
+    bool onFragmentReceived(const ServiceHeader& header);
+    bool onBatchReceived(const ServiceHeader& header);
+
+    void startWrite();
+    bool canCoalesce() const;
+    void onCoalescingTimeout(const std::error_code& error_code);
     void doWrite();
     void onWrite(const std::error_code& error_code, size_t bytes_transferred);
 
@@ -227,9 +432,16 @@ private:
     void doReadServiceData(size_t length);
     void onReadServiceData(const std::error_code& error_code, size_t bytes_transferred);
 
-    void onKeepAliveInterval(const std::error_code& error_code);
-    void onKeepAliveTimeout(const std::error_code& error_code);
+    void releaseReadBuffers();
+    void releaseWriteBuffers();
+    void startCompactTimer();
+    void onCompactTimeout();
+
+    void onKeepAliveInterval();
+    void onKeepAliveTimeout();
     void sendKeepAlive(uint8_t flags, const void* data, size_t size);
+    void addClockSample(int64_t peer_time);
+    void onLinkQualityInterval();
 
     void addTxBytes(size_t bytes_count);
     void addRxBytes(size_t bytes_count);
@@ -239,27 +451,89 @@ private:
     asio::ip::tcp::socket socket_;
     std::unique_ptr<asio::ip::tcp::resolver> resolver_;
 
-    std::unique_ptr<asio::high_resolution_timer> keep_alive_timer_;
+    std::unique_ptr<CoalescedTimer> keep_alive_timer_;
     Seconds keep_alive_interval_;
     Seconds keep_alive_timeout_;
     ByteArray keep_alive_counter_;
     TimePoint keep_alive_timestamp_;
+    int64_t keep_alive_send_time_ = 0;
+    int64_t keep_alive_rx_ = 0;
+    bool presence_mode_ = false;
+
+    // The buffers keep the capacity of the largest message (e.g. a key frame). If they are larger
+    // than the largest message of the last interval of |compact_timer_|, they are released.
+    std::unique_ptr<CoalescedTimer> compact_timer_;
+    size_t read_high_water_ = 0;
+    size_t write_high_water_ = 0;
+    std::deque<ClockSample> clock_samples_;
+
+    std::vector<LinkQualityListener*> link_quality_listeners_;
+    std::unique_ptr<CoalescedTimer> link_quality_timer_;
+    LinkQualityEstimator link_quality_estimator_;
+    TimePoint link_quality_time_;
+    int64_t link_quality_rx_ = 0;
+    int64_t link_quality_tx_ = 0;
+    bool tcp_info_supported_ = true;
 
     Listener* listener_ = nullptr;
     bool connected_ = false;
     bool paused_ = true;
+    bool reuse_address_ = false;
 
     std::unique_ptr<MessageEncryptor> encryptor_;
     std::unique_ptr<MessageDecryptor> decryptor_;
 
-    std::queue<WriteTask> write_queue_;
+    WriteQueue write_queue_;
     VariableSizeWriter variable_size_writer_;
-    ByteArray write_buffer_;
+
+    bool features_announced_ = false;
+    bool streams_announced_ = false;
+    bool peer_accepts_fragments_ = false;
+    bool peer_accepts_streams_ = false;
+    bool peer_accepts_batches_ = false;
+
+    std::map<uint8_t, StreamListener*> stream_listeners_;
+    StreamListener* stream_acceptor_ = nullptr;
+
+    // The small messages are held in the queue for |coalescing_window_| (see
+    // setCoalescingWindow()). |coalescing_| is set while they are held.
+    std::chrono::microseconds coalescing_window_ { 0 };
+    asio::high_resolution_timer coalescing_timer_;
+    bool coalescing_ = false;
+
+    // The messages which are being written: the encrypted data of shared messages, the sizes and
+    // authentication tags of the messages and the buffers for the vectored write. Messages owned by
+    // the channel are encrypted in place. |write_parts_| are taken from the fronts of the lanes and
+    // written together. A batch of small messages is encrypted from |write_gather_|, which refers
+    // to the messages in the queue and to their sizes in |write_batch_|.
+    // They are overwritten right after the resize, so they are not filled with zeros.
+    Buffer write_buffer_;
+    Buffer write_headers_;
+    Buffer write_batch_;
+    std::vector<MessageEncryptor::Buffer> write_gather_;
+    std::vector<asio::const_buffer> write_buffers_;
+    std::vector<WritePart> write_parts_;
 
     ReadState state_ = ReadState::IDLE;
     VariableSizeReader variable_size_reader_;
-    ByteArray read_buffer_;
-    ByteArray decrypt_buffer_;
+    Buffer read_tag_;
+
+    // The messages are decrypted in place in the buffers of the pool and given to the listener.
+    ByteArrayPool read_pool_;
+    std::shared_ptr<ByteArray> read_buffer_;
+
+    // The messages of the received BATCH which are not given to the listener yet.
+    std::vector<std::shared_ptr<ByteArray>> read_batch_;
+    std::array<asio::mutable_buffer, 2> read_buffers_;
+
+    // Set if |read_buffer_| contains a message assembled from the fragments, which are decrypted
+    // when they are received.
+    bool read_decrypted_ = false;
+    std::array<ByteArray, WriteTask::kPriorityCount> read_fragments_;
+    std::array<uint8_t, WriteTask::kPriorityCount> read_fragment_streams_ {};
+
+    // The stream of the message in |read_buffer_|.
+    uint8_t read_stream_ = 0;
 
     int64_t total_tx_ = 0;
     int64_t total_rx_ = 0;
@@ -31,13 +31,38 @@ NetworkChannelProxy::NetworkChannelProxy(
     // Nothing
 }
 
-void NetworkChannelProxy::send(ByteArray&& buffer)
+void NetworkChannelProxy::send(ByteArray&& buffer, Priority priority)
 {
+    addTask(WriteTask(WriteTask::Type::USER_DATA, priority, std::move(buffer)));
+}
+
+void NetworkChannelProxy::send(std::shared_ptr<const ByteArray> buffer, Priority priority)
+{
+    DCHECK(buffer);
+    addTask(WriteTask(WriteTask::Type::USER_DATA, priority, std::move(buffer)));
+}
+
+void NetworkChannelProxy::sendToStream(uint8_t stream_id, ByteArray&& buffer, Priority priority)
+{
+    // The support of the streams by the peer is checked by the channel when the message is
+    // written.
+    addTask(WriteTask(WriteTask::Type::USER_DATA, priority, std::move(buffer), stream_id));
+}
+
+void NetworkChannelProxy::willDestroyCurrentChannel()
+{
+    channel_ = nullptr;
+}
+
+void NetworkChannelProxy::addTask(WriteTask&& task)
+{
+    pending_bytes_ += task.data().size();
+
     std::scoped_lock lock(incoming_queue_lock_);
 
     bool schedule_write = incoming_queue_.empty();
 
-    incoming_queue_.emplace(WriteTask::Type::USER_DATA, std::move(buffer));
+    incoming_queue_.emplace_back(std::move(task));
 
     if (!schedule_write)
         return;
@@ -45,35 +70,37 @@ void NetworkChannelProxy::send(ByteArray&& buffer)
     task_runner_->postTask(std::bind(&NetworkChannelProxy::scheduleWrite, shared_from_this()));
 }
 
-void NetworkChannelProxy::willDestroyCurrentChannel()
-{
-    channel_ = nullptr;
-}
-
 void NetworkChannelProxy::scheduleWrite()
 {
     if (!channel_)
         return;
 
+    // A write is in progress. The tasks are taken when it is completed. The messages held by the
+    // coalescing window are not being written yet.
+    if (!channel_->write_queue_.empty() && !channel_->coalescing_)
+        return;
+
     if (!reloadWriteQueue(&channel_->write_queue_))
         return;
 
-    channel_->doWrite();
+    channel_->startWrite();
 }
 
-bool NetworkChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue)
+bool NetworkChannelProxy::reloadWriteQueue(WriteQueue* work_queue)
 {
-    if (!work_queue->empty())
-        return false;
+    std::deque<WriteTask> tasks;
 
-    std::scoped_lock lock(incoming_queue_lock_);
+    {
+        std::scoped_lock lock(incoming_queue_lock_);
 
-    if (incoming_queue_.empty())
-        return false;
+        if (incoming_queue_.empty())
+            return false;
 
-    incoming_queue_.swap(*work_queue);
-    DCHECK(incoming_queue_.empty());
+        incoming_queue_.swap(tasks);
+    }
 
+    // The tasks are distributed to the lanes without the lock.
+    work_queue->pushAll(&tasks);
     return true;
 }
 
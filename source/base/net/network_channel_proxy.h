@@ -21,6 +21,7 @@
 
 #include "base/net/network_channel.h"
 
+#include <atomic>
 #include <shared_mutex>
 
 namespace base {
@@ -30,7 +31,20 @@ class TaskRunner;
 class NetworkChannelProxy : public std::enable_shared_from_this<NetworkChannelProxy>
 {
 public:
-    void send(ByteArray&& buffer);
+    using Priority = NetworkChannel::Priority;
+
+    void send(ByteArray&& buffer, Priority priority = Priority::CONTROL);
+
+    // Sends |buffer| without copying it. The same buffer can be sent to several channels. It must
+    // not be changed until all of them release it.
+    void send(std::shared_ptr<const ByteArray> buffer, Priority priority = Priority::CONTROL);
+
+    // Sends |buffer| to the stream |stream_id| (see NetworkChannel::sendToStream()).
+    void sendToStream(uint8_t stream_id, ByteArray&& buffer, Priority priority = Priority::CONTROL);
+
+    // Returns the size of the user data which has been queued for sending but not sent yet. Can be
+    // called from any thread.
+    size_t pendingBytes() const { return pending_bytes_; }
 
 private:
     friend class NetworkChannel;
@@ -39,14 +53,18 @@ private:
     // Called directly by NetworkChannel::~NetworkChannel.
     void willDestroyCurrentChannel();
 
+    void addTask(WriteTask&& task);
     void scheduleWrite();
-    bool reloadWriteQueue(std::queue<WriteTask>* work_queue);
+    bool reloadWriteQueue(WriteQueue* work_queue);
 
     std::shared_ptr<TaskRunner> task_runner_;
 
     NetworkChannel* channel_;
 
-    std::queue<WriteTask> incoming_queue_;
+    // Updated by NetworkChannel and by send().
+    std::atomic<size_t> pending_bytes_ { 0 };
+
+    std::deque<WriteTask> incoming_queue_;
     std::mutex incoming_queue_lock_;
 
     DISALLOW_COPY_AND_ASSIGN(NetworkChannelProxy);
@@ -0,0 +1,275 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/network_channel.h"
+
+#include "base/task_runner.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/network_server.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// The test fails if the peers do not exchange the messages in this time.
+constexpr std::chrono::seconds kTimeout(10);
+
+class TestListener : public NetworkChannel::Listener
+{
+public:
+    std::function<void()> on_connected;
+    std::function<void(NetworkChannel::ErrorCode)> on_disconnected;
+    std::function<void(const ByteArray&)> on_message;
+
+    // NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        if (on_connected)
+            on_connected();
+    }
+
+    void onDisconnected(NetworkChannel::ErrorCode error_code) override
+    {
+        if (on_disconnected)
+            on_disconnected(error_code);
+    }
+
+    void onMessageReceived(const ByteArray& buffer) override
+    {
+        if (on_message)
+            on_message(buffer);
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+};
+
+class TestStreamListener : public NetworkChannel::StreamListener
+{
+public:
+    std::function<void(uint8_t, const ByteArray&)> on_message;
+    std::function<void(uint8_t)> on_closed;
+
+    // NetworkChannel::StreamListener implementation.
+    void onStreamMessageReceived(uint8_t stream_id, const ByteArray& buffer) override
+    {
+        if (on_message)
+            on_message(stream_id, buffer);
+    }
+
+    void onStreamClosed(uint8_t stream_id) override
+    {
+        if (on_closed)
+            on_closed(stream_id);
+    }
+};
+
+class TestServerDelegate : public NetworkServer::Delegate
+{
+public:
+    std::function<void(std::unique_ptr<NetworkChannel>)> on_new_connection;
+
+    // NetworkServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<NetworkChannel> channel) override
+    {
+        on_new_connection(std::move(channel));
+    }
+};
+
+} // namespace
+
+TEST(NetworkChannelTest, Batch)
+{
+    static const size_t kMessageCount = 16;
+
+    MessageLoop message_loop(MessageLoop::Type::ASIO);
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    std::vector<ByteArray> received;
+    std::vector<NetworkChannel::ErrorCode> errors;
+
+    TestListener host_listener;
+    TestListener client_listener;
+    TestServerDelegate server_delegate;
+
+    std::unique_ptr<NetworkChannel> host_channel;
+    NetworkChannel client_channel;
+    NetworkServer server;
+
+    auto on_disconnected = [&](NetworkChannel::ErrorCode error_code)
+    {
+        errors.push_back(error_code);
+        task_runner->postQuit();
+    };
+
+    host_listener.on_disconnected = on_disconnected;
+    host_listener.on_message = [&](const ByteArray& buffer)
+    {
+        received.push_back(buffer);
+        if (received.size() == kMessageCount)
+            task_runner->postQuit();
+    };
+
+    server_delegate.on_new_connection = [&](std::unique_ptr<NetworkChannel> channel)
+    {
+        host_channel = std::move(channel);
+        host_channel->setListener(&host_listener);
+        host_channel->resume();
+
+        // The features of the host are announced before its first message.
+        host_channel->send(ByteArray(1, 0));
+    };
+
+    client_listener.on_connected = [&]() { client_channel.resume(); };
+    client_listener.on_disconnected = on_disconnected;
+    client_listener.on_message = [&](const ByteArray& /* buffer */)
+    {
+        // The small messages are held by the coalescing window and written together, the host
+        // accepts the batches.
+        client_channel.setCoalescingWindow(std::chrono::milliseconds(50));
+
+        for (size_t i = 0; i < kMessageCount; ++i)
+            client_channel.send(ByteArray(i + 1, static_cast<uint8_t>(i)));
+    };
+
+    server.start(0, &server_delegate);
+    ASSERT_NE(server.port(), 0);
+
+    client_channel.setListener(&client_listener);
+    client_channel.connect(u"127.0.0.1", server.port());
+
+    task_runner->postDelayedTask([&]() { task_runner->postQuit(); }, kTimeout);
+    message_loop.run();
+
+    EXPECT_TRUE(errors.empty());
+    ASSERT_EQ(received.size(), kMessageCount);
+
+    for (size_t i = 0; i < kMessageCount; ++i)
+        EXPECT_EQ(received[i], ByteArray(i + 1, static_cast<uint8_t>(i)));
+}
+
+TEST(NetworkChannelTest, Stream)
+{
+    static const uint8_t kStreamId = 3;
+
+    MessageLoop message_loop(MessageLoop::Type::ASIO);
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    std::vector<ByteArray> host_messages;
+    std::vector<ByteArray> stream_replies;
+    std::vector<NetworkChannel::ErrorCode> errors;
+    bool stream_closed = false;
+
+    TestListener host_listener;
+    TestListener client_listener;
+    TestStreamListener host_acceptor;
+    TestStreamListener client_stream;
+    TestServerDelegate server_delegate;
+
+    std::unique_ptr<NetworkChannel> host_channel;
+    NetworkChannel client_channel;
+    NetworkServer server;
+
+    auto on_disconnected = [&](NetworkChannel::ErrorCode error_code)
+    {
+        errors.push_back(error_code);
+        task_runner->postQuit();
+    };
+
+    host_listener.on_disconnected = on_disconnected;
+    host_listener.on_message = [&](const ByteArray& buffer) { host_messages.push_back(buffer); };
+
+    host_acceptor.on_message = [&](uint8_t stream_id, const ByteArray& buffer)
+    {
+        EXPECT_EQ(stream_id, kStreamId);
+
+        // The host answers in the same stream and closes it.
+        host_channel->sendToStream(stream_id, ByteArray(buffer.rbegin(), buffer.rend()));
+        host_channel->closeStream(stream_id);
+    };
+
+    server_delegate.on_new_connection = [&](std::unique_ptr<NetworkChannel> channel)
+    {
+        host_channel = std::move(channel);
+        host_channel->setListener(&host_listener);
+        host_channel->resume();
+
+        // The features are announced with the first message, the acceptor is set later and the
+        // streams are announced once more.
+        host_channel->send(ByteArray(1, 0));
+        host_channel->setStreamAcceptor(&host_acceptor);
+        host_channel->send(ByteArray(1, 1));
+    };
+
+    client_listener.on_connected = [&]() { client_channel.resume(); };
+    client_listener.on_disconnected = on_disconnected;
+    client_listener.on_message = [&](const ByteArray& buffer)
+    {
+        if (buffer != ByteArray(1, 1))
+            return;
+
+        EXPECT_TRUE(client_channel.peerSupportsStreams());
+
+        // Both messages are in the same lane, the host receives the message of the channel before
+        // the message of the stream.
+        client_channel.send(ByteArray(1, 2));
+        client_channel.setStreamListener(kStreamId, &client_stream);
+        client_channel.sendToStream(kStreamId, { 1, 2, 3 });
+    };
+
+    client_stream.on_message = [&](uint8_t stream_id, const ByteArray& buffer)
+    {
+        EXPECT_EQ(stream_id, kStreamId);
+        stream_replies.push_back(buffer);
+    };
+    client_stream.on_closed = [&](uint8_t stream_id)
+    {
+        EXPECT_EQ(stream_id, kStreamId);
+        stream_closed = true;
+        task_runner->postQuit();
+    };
+
+    server.start(0, &server_delegate);
+    ASSERT_NE(server.port(), 0);
+
+    client_channel.setListener(&client_listener);
+    client_channel.connect(u"127.0.0.1", server.port());
+
+    task_runner->postDelayedTask([&]() { task_runner->postQuit(); }, kTimeout);
+    message_loop.run();
+
+    EXPECT_TRUE(errors.empty());
+    EXPECT_TRUE(stream_closed);
+
+    // The reply is delivered before the stream is closed.
+    ASSERT_EQ(stream_replies.size(), 1u);
+    EXPECT_EQ(stream_replies[0], ByteArray({ 3, 2, 1 }));
+
+    // The message of the stream is not given to the listener of the channel.
+    ASSERT_EQ(host_messages.size(), 1u);
+    EXPECT_EQ(host_messages[0], ByteArray(1, 2));
+}
+
+} // namespace base
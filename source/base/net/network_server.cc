@@ -23,6 +23,11 @@
 #include "base/message_loop/message_pump_asio.h"
 #include "base/net/network_channel.h"
 #include "base/strings/unicode.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX)
+#include <sys/socket.h>
+#endif // defined(OS_LINUX)
 
 namespace base {
 
@@ -32,6 +37,7 @@ public:
     explicit Impl(asio::io_context& io_context);
     ~Impl();
 
+    void setReusePort(bool enable) { reuse_port_ = enable; }
     void start(uint16_t port, Delegate* delegate);
     void stop();
     uint16_t port() const;
@@ -44,6 +50,7 @@ private:
     std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
     Delegate* delegate_ = nullptr;
     uint16_t port_ = 0;
+    bool reuse_port_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
@@ -67,9 +74,60 @@ void NetworkServer::Impl::start(uint16_t port, Delegate* delegate)
     DCHECK(delegate_);
 
     asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
-    acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_, endpoint);
+
+#if !defined(OS_LINUX)
+    if (reuse_port_)
+    {
+        LOG(LS_WARNING) << "Port reuse is supported only on Linux";
+        reuse_port_ = false;
+    }
+#endif // !defined(OS_LINUX)
+
+    if (!reuse_port_)
+    {
+        acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_, endpoint);
+        doAccept();
+        return;
+    }
+
+#if defined(OS_LINUX)
+    acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_);
+
+    std::error_code error_code;
+
+    acceptor_->open(endpoint.protocol(), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to open acceptor: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        acceptor_.reset();
+        return;
+    }
+
+    int yes = 1;
+    if (setsockopt(acceptor_->native_handle(), SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1)
+    {
+        PLOG(LS_ERROR) << "setsockopt(SO_REUSEPORT) failed";
+        acceptor_.reset();
+        return;
+    }
+
+    acceptor_->set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (!error_code)
+        acceptor_->bind(endpoint, error_code);
+    if (!error_code)
+        acceptor_->listen(asio::socket_base::max_listen_connections, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to listen on port " << port << ": "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        acceptor_.reset();
+        return;
+    }
 
     doAccept();
+#endif // defined(OS_LINUX)
 }
 
 void NetworkServer::Impl::stop()
@@ -80,6 +138,15 @@ void NetworkServer::Impl::stop()
 
 uint16_t NetworkServer::Impl::port() const
 {
+    // If the server was started with port 0, the system has chosen the port.
+    if (!port_ && acceptor_)
+    {
+        std::error_code error_code;
+        asio::ip::tcp::endpoint endpoint = acceptor_->local_endpoint(error_code);
+        if (!error_code)
+            return endpoint.port();
+    }
+
     return port_;
 }
 
@@ -123,6 +190,21 @@ NetworkServer::~NetworkServer()
     impl_->stop();
 }
 
+void NetworkServer::setReusePort(bool enable)
+{
+    impl_->setReusePort(enable);
+}
+
+// static
+bool NetworkServer::isReusePortSupported()
+{
+#if defined(OS_LINUX)
+    return true;
+#else
+    return false;
+#endif // defined(OS_LINUX)
+}
+
 void NetworkServer::start(uint16_t port, Delegate* delegate)
 {
     impl_->start(port, delegate);
@@ -42,6 +42,16 @@ public:
         virtual void onNewConnection(std::unique_ptr<NetworkChannel> channel) = 0;
     };
 
+    // Allows several servers to listen on the same port, usually one on each thread. The kernel
+    // spreads the incoming connections between them, so the connections of each server are
+    // accepted and served on its own thread. Supported only on Linux (see isReusePortSupported()),
+    // must be called before start().
+    void setReusePort(bool enable);
+
+    // Returns true if several servers can listen on the same port.
+    static bool isReusePortSupported();
+
+    // If |port| is 0, the system chooses a free port. port() returns it after the start.
     void start(uint16_t port, Delegate* delegate);
     void stop();
     uint16_t port() const;
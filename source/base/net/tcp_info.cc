@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/tcp_info.h"
+
+#include "base/logging.h"
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#include <mstcpip.h>
+#endif // defined(OS_WIN)
+
+#if defined(OS_POSIX)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif // defined(OS_POSIX)
+
+namespace base {
+
+bool readTcpInfo(NativeSocket socket, TcpInfo* info)
+{
+    DCHECK(info);
+
+#if defined(OS_WIN)
+    DWORD version = 0;
+    TCP_INFO_v0 tcp_info;
+    DWORD bytes_returned = 0;
+
+    if (WSAIoctl(socket, SIO_TCP_INFO, &version, sizeof(version),
+                 &tcp_info, sizeof(tcp_info), &bytes_returned,
+                 nullptr, nullptr) == SOCKET_ERROR)
+    {
+        PLOG(LS_WARNING) << "WSAIoctl(SIO_TCP_INFO) failed";
+        return false;
+    }
+
+    // Windows does not report the variation of the round trip time.
+    info->rtt_us = static_cast<int64_t>(tcp_info.RttUs);
+    info->rtt_var_us = 0;
+    info->retransmitted_bytes = static_cast<int64_t>(tcp_info.BytesRetrans);
+    return true;
+#elif defined(OS_LINUX)
+    struct tcp_info tcp_info;
+    socklen_t length = sizeof(tcp_info);
+
+    if (getsockopt(socket, IPPROTO_TCP, TCP_INFO, &tcp_info, &length) == -1)
+    {
+        PLOG(LS_WARNING) << "getsockopt(TCP_INFO) failed";
+        return false;
+    }
+
+    // The kernel counts the retransmitted segments. Most of them have the full size.
+    info->rtt_us = static_cast<int64_t>(tcp_info.tcpi_rtt);
+    info->rtt_var_us = static_cast<int64_t>(tcp_info.tcpi_rttvar);
+    info->retransmitted_bytes =
+        static_cast<int64_t>(tcp_info.tcpi_total_retrans) * tcp_info.tcpi_snd_mss;
+    return true;
+#elif defined(OS_MAC)
+    struct tcp_connection_info tcp_info;
+    socklen_t length = sizeof(tcp_info);
+
+    if (getsockopt(socket, IPPROTO_TCP, TCP_CONNECTION_INFO, &tcp_info, &length) == -1)
+    {
+        PLOG(LS_WARNING) << "getsockopt(TCP_CONNECTION_INFO) failed";
+        return false;
+    }
+
+    // The times are reported in milliseconds.
+    info->rtt_us = static_cast<int64_t>(tcp_info.tcpi_srtt) * 1000;
+    info->rtt_var_us = static_cast<int64_t>(tcp_info.tcpi_rttvar) * 1000;
+    info->retransmitted_bytes = static_cast<int64_t>(tcp_info.tcpi_txretransmitbytes);
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace base
@@ -0,0 +1,42 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__TCP_INFO_H
+#define BASE__NET__TCP_INFO_H
+
+#include "base/net/tcp_keep_alive.h"
+
+namespace base {
+
+// The state of a TCP connection reported by the kernel.
+struct TcpInfo
+{
+    // Smoothed round trip time and its variation in microseconds.
+    int64_t rtt_us = 0;
+    int64_t rtt_var_us = 0;
+
+    // The number of retransmitted bytes since the connection was established.
+    int64_t retransmitted_bytes = 0;
+};
+
+// Reads the state of the connection. Returns false if the platform does not report it.
+bool readTcpInfo(NativeSocket socket, TcpInfo* info);
+
+} // namespace base
+
+#endif // BASE__NET__TCP_INFO_H
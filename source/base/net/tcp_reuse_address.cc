@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/tcp_reuse_address.h"
+
+#include "base/logging.h"
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#endif // defined(OS_WIN)
+
+#if defined(OS_POSIX)
+#include <sys/types.h>
+#include <sys/socket.h>
+#endif // defined(OS_POSIX)
+
+namespace base {
+
+bool setTcpReuseAddress(NativeSocket socket, bool enable)
+{
+#if defined(OS_WIN)
+    BOOL yes = enable ? TRUE : FALSE;
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR,
+                   reinterpret_cast<const char*>(&yes), sizeof(yes)) == SOCKET_ERROR)
+    {
+        PLOG(LS_WARNING) << "setsockopt(SO_REUSEADDR) failed";
+        return false;
+    }
+
+    return true;
+#elif defined(OS_POSIX)
+    int yes = enable ? 1 : 0;
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) == -1)
+    {
+        PLOG(LS_WARNING) << "setsockopt(SO_REUSEADDR) failed";
+        return false;
+    }
+
+    // macOS allows to bind a port in use only with SO_REUSEPORT.
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1)
+    {
+        PLOG(LS_WARNING) << "setsockopt(SO_REUSEPORT) failed";
+        return false;
+    }
+
+    return true;
+#else
+#error Not implemented
+#endif
+}
+
+} // namespace base
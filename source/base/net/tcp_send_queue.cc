@@ -0,0 +1,117 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/tcp_send_queue.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif // defined(OS_WIN)
+
+#if defined(OS_POSIX)
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif // defined(OS_POSIX)
+
+#if defined(OS_LINUX)
+#include <linux/sockios.h>
+#endif // defined(OS_LINUX)
+
+namespace base {
+
+bool setTcpNotSentLowWatermark(NativeSocket socket, size_t bytes)
+{
+#if defined(OS_WIN)
+    ULONG ideal_backlog = 0;
+    DWORD bytes_returned = 0;
+
+    if (WSAIoctl(socket, SIO_IDEAL_SEND_BACKLOG_QUERY, nullptr, 0,
+                 &ideal_backlog, sizeof(ideal_backlog), &bytes_returned,
+                 nullptr, nullptr) == SOCKET_ERROR)
+    {
+        PLOG(LS_WARNING) << "WSAIoctl(SIO_IDEAL_SEND_BACKLOG_QUERY) failed";
+        return false;
+    }
+
+    int size = static_cast<int>(std::max(static_cast<size_t>(ideal_backlog), bytes));
+    if (setsockopt(socket, SOL_SOCKET, SO_SNDBUF,
+                   reinterpret_cast<const char*>(&size), sizeof(size)) == SOCKET_ERROR)
+    {
+        PLOG(LS_WARNING) << "setsockopt(SO_SNDBUF) failed";
+        return false;
+    }
+
+    return true;
+#elif defined(OS_POSIX)
+    int value = static_cast<int>(bytes);
+    if (setsockopt(socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value, sizeof(value)) == -1)
+    {
+        PLOG(LS_WARNING) << "setsockopt(TCP_NOTSENT_LOWAT) failed";
+        return false;
+    }
+
+    return true;
+#else
+    #warning Not implemented
+    return false;
+#endif
+}
+
+std::optional<size_t> tcpUnsentBytes(NativeSocket socket)
+{
+#if defined(OS_LINUX)
+    // SIOCOUTQ would also count the bytes in flight, which are about the speed multiplied by the
+    // round trip time on a healthy link.
+    int bytes = 0;
+    if (ioctl(socket, SIOCOUTQNSD, &bytes) == -1)
+    {
+        PLOG(LS_WARNING) << "ioctl(SIOCOUTQNSD) failed";
+        return std::nullopt;
+    }
+
+    return static_cast<size_t>(bytes);
+#elif defined(OS_MAC)
+    struct tcp_connection_info tcp_info;
+    socklen_t length = sizeof(tcp_info);
+
+    if (getsockopt(socket, IPPROTO_TCP, TCP_CONNECTION_INFO, &tcp_info, &length) == -1)
+    {
+        PLOG(LS_WARNING) << "getsockopt(TCP_CONNECTION_INFO) failed";
+        return std::nullopt;
+    }
+
+    // The send buffer also holds the bytes in flight. No more than the congestion and the send
+    // windows can be in flight, the rest of the buffer is not sent yet.
+    const size_t buffered = tcp_info.tcpi_snd_sbbytes;
+    const size_t window = std::min(tcp_info.tcpi_snd_cwnd, tcp_info.tcpi_snd_wnd);
+
+    return buffered - std::min(buffered, window);
+#else
+    // Windows does not report the size of the send queue of a TCP socket.
+    return std::nullopt;
+#endif
+}
+
+} // namespace base
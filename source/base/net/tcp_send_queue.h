@@ -0,0 +1,41 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__TCP_SEND_QUEUE_H
+#define BASE__NET__TCP_SEND_QUEUE_H
+
+#include "base/net/tcp_keep_alive.h"
+
+#include <optional>
+
+namespace base {
+
+// Limits the amount of the written data which the kernel keeps in the send buffer of the socket
+// before sending it. The data above the limit stays in the queue of the application, where it can
+// be reprioritized or dropped. On Windows there is no such option and the send buffer is set to
+// the ideal send backlog of the connection (but not less than |bytes|).
+bool setTcpNotSentLowWatermark(NativeSocket socket, size_t bytes);
+
+// Returns the number of bytes in the send queue of the socket which are not yet sent. The bytes
+// in flight are not counted, so the value does not grow with the round trip time. Returns an
+// empty value if the platform does not report it.
+std::optional<size_t> tcpUnsentBytes(NativeSocket socket);
+
+} // namespace base
+
+#endif // BASE__NET__TCP_SEND_QUEUE_H
@@ -0,0 +1,50 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/write_queue.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+void WriteQueue::push(WriteTask&& task)
+{
+    const size_t index = static_cast<size_t>(task.priority());
+    DCHECK_LT(index, lanes_.size());
+
+    lanes_[index].emplace_back(std::move(task));
+    ++count_;
+}
+
+void WriteQueue::pushAll(std::deque<WriteTask>* tasks)
+{
+    for (auto& task : *tasks)
+        push(std::move(task));
+
+    tasks->clear();
+}
+
+void WriteQueue::pop(size_t lane)
+{
+    DCHECK(!lanes_[lane].empty());
+
+    lanes_[lane].pop_front();
+    --count_;
+}
+
+} // namespace base
@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__WRITE_QUEUE_H
+#define BASE__NET__WRITE_QUEUE_H
+
+#include "base/macros_magic.h"
+#include "base/net/write_task.h"
+
+#include <array>
+#include <deque>
+
+namespace base {
+
+// Messages waiting for sending. Each priority has its own lane, the tasks of a lane are kept in
+// the order they are added.
+class WriteQueue
+{
+public:
+    WriteQueue() = default;
+    ~WriteQueue() = default;
+
+    void push(WriteTask&& task);
+
+    // Moves all tasks from |tasks| to the lanes of their priorities.
+    void pushAll(std::deque<WriteTask>* tasks);
+
+    // Removes the first task of the lane.
+    void pop(size_t lane);
+
+    std::deque<WriteTask>& lane(size_t index) { return lanes_[index]; }
+    const std::deque<WriteTask>& lane(size_t index) const { return lanes_[index]; }
+
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+
+private:
+    std::array<std::deque<WriteTask>, WriteTask::kPriorityCount> lanes_;
+    size_t count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(WriteQueue);
+};
+
+} // namespace base
+
+#endif // BASE__NET__WRITE_QUEUE_H
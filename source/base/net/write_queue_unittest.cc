@@ -0,0 +1,92 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/write_queue.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Priority = WriteTask::Priority;
+
+WriteTask makeTask(Priority priority, uint8_t value)
+{
+    return WriteTask(WriteTask::Type::USER_DATA, priority, ByteArray(1, value));
+}
+
+} // namespace
+
+TEST(WriteQueueTest, Lanes)
+{
+    WriteQueue queue;
+    EXPECT_TRUE(queue.empty());
+
+    queue.push(makeTask(Priority::VIDEO, 1));
+    queue.push(makeTask(Priority::CONTROL, 2));
+    queue.push(makeTask(Priority::VIDEO, 3));
+    queue.push(makeTask(Priority::BULK, 4));
+
+    EXPECT_EQ(queue.size(), 4u);
+
+    const size_t control = static_cast<size_t>(Priority::CONTROL);
+    const size_t video = static_cast<size_t>(Priority::VIDEO);
+    const size_t bulk = static_cast<size_t>(Priority::BULK);
+
+    ASSERT_EQ(queue.lane(control).size(), 1u);
+    EXPECT_EQ(queue.lane(control).front().data()[0], 2);
+
+    // The order of a lane is kept.
+    ASSERT_EQ(queue.lane(video).size(), 2u);
+    EXPECT_EQ(queue.lane(video)[0].data()[0], 1);
+    EXPECT_EQ(queue.lane(video)[1].data()[0], 3);
+
+    EXPECT_TRUE(queue.lane(static_cast<size_t>(Priority::AUDIO)).empty());
+
+    queue.pop(video);
+    EXPECT_EQ(queue.lane(video).front().data()[0], 3);
+    EXPECT_EQ(queue.size(), 3u);
+
+    queue.pop(video);
+    queue.pop(control);
+    queue.pop(bulk);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(WriteQueueTest, PushAll)
+{
+    std::deque<WriteTask> tasks;
+    tasks.emplace_back(makeTask(Priority::AUDIO, 1));
+    tasks.emplace_back(makeTask(Priority::CURSOR, 2));
+    tasks.emplace_back(makeTask(Priority::AUDIO, 3));
+
+    WriteQueue queue;
+    queue.pushAll(&tasks);
+
+    EXPECT_TRUE(tasks.empty());
+    EXPECT_EQ(queue.size(), 3u);
+
+    const std::deque<WriteTask>& audio = queue.lane(static_cast<size_t>(Priority::AUDIO));
+    ASSERT_EQ(audio.size(), 2u);
+    EXPECT_EQ(audio[0].data()[0], 1);
+    EXPECT_EQ(audio[1].data()[0], 3);
+    EXPECT_EQ(queue.lane(static_cast<size_t>(Priority::CURSOR)).size(), 1u);
+}
+
+} // namespace base
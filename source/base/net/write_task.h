@@ -21,6 +21,8 @@
 
 #include "base/memory/byte_array.h"
 
+#include <memory>
+
 namespace base {
 
 class WriteTask
@@ -28,19 +30,63 @@ class WriteTask
 public:
     enum class Type { SERVICE_DATA, USER_DATA };
 
-    WriteTask(Type type, ByteArray&& data)
+    // The messages of a higher priority are written before the messages of a lower priority that
+    // were queued earlier. The messages of one priority are written in the order they are queued.
+    enum class Priority
+    {
+        CONTROL, // Input events, replies and the other small messages (default).
+        AUDIO,   // Audio packets.
+        CURSOR,  // Cursor shapes and positions.
+        VIDEO,   // Video packets.
+        BULK     // File data and clipboard.
+    };
+
+    static const size_t kPriorityCount = 5;
+
+    // |stream| is the stream of the channel the message belongs to (see
+    // NetworkChannel::sendToStream()).
+    WriteTask(Type type, Priority priority, ByteArray&& data, uint8_t stream = 0)
         : type_(type),
+          priority_(priority),
+          stream_(stream),
           data_(std::move(data))
     {
         // Nothing
     }
 
+    // The buffer is shared with other tasks and must not be changed while the task exists.
+    WriteTask(Type type, Priority priority, std::shared_ptr<const ByteArray> shared_data,
+              uint8_t stream = 0)
+        : type_(type),
+          priority_(priority),
+          stream_(stream),
+          shared_data_(std::move(shared_data))
+    {
+        // Nothing
+    }
+
     Type type() const { return type_; }
-    const ByteArray& data() const { return data_; }
+    Priority priority() const { return priority_; }
+    uint8_t stream() const { return stream_; }
+    const ByteArray& data() const { return shared_data_ ? *shared_data_ : data_; }
+
+    bool isShared() const { return shared_data_ != nullptr; }
+
+    // Returns the buffer owned by the task or nullptr if the buffer is shared.
+    ByteArray* mutableData() { return shared_data_ ? nullptr : &data_; }
+
+    // The size of the data already written in fragments. A large message is written in fragments
+    // so the messages of a higher priority can be written between them.
+    size_t writtenSize() const { return written_size_; }
+    void setWrittenSize(size_t size) { written_size_ = size; }
 
 private:
-    const Type type_;
-    const ByteArray data_;
+    Type type_;
+    Priority priority_;
+    uint8_t stream_;
+    size_t written_size_ = 0;
+    ByteArray data_;
+    std::shared_ptr<const ByteArray> shared_data_;
 };
 
 } // namespace base
@@ -18,10 +18,10 @@
 
 #include "base/peer/client_authenticator.h"
 
-#include "base/cpuid_util.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/sys_info.h"
+#include "base/crypto/cipher_benchmark.h"
 #include "base/crypto/generic_hash.h"
 #include "base/crypto/key_pair.h"
 #include "base/crypto/random.h"
@@ -104,6 +104,11 @@ void ClientAuthenticator::setSessionType(uint32_t session_type)
     session_type_ = session_type;
 }
 
+void ClientAuthenticator::setTicket(const proto::ResumptionTicket& ticket)
+{
+    ticket_ = ticket;
+}
+
 bool ClientAuthenticator::onStarted()
 {
     internal_state_ = InternalState::SEND_CLIENT_HELLO;
@@ -119,7 +124,7 @@ void ClientAuthenticator::onReceived(const ByteArray& buffer)
         {
             if (readServerHello(buffer))
             {
-                if (identify_ == proto::IDENTIFY_ANONYMOUS)
+                if (identify_ == proto::IDENTIFY_ANONYMOUS || resumed_)
                 {
                     internal_state_ = InternalState::READ_SESSION_CHALLENGE;
                 }
@@ -213,14 +218,17 @@ void ClientAuthenticator::sendClientHello()
 
     std::unique_ptr<proto::ClientHello> client_hello = std::make_unique<proto::ClientHello>();
 
-    uint32_t encryption = proto::ENCRYPTION_CHACHA20_POLY1305;
+    const CipherBenchmark::Result& cipher_speed = CipherBenchmark::result();
 
-#if defined(ARCH_CPU_X86_FAMILY)
-    if (CpuidUtil::hasAesNi())
+    // The new servers choose the cipher by the speed. The old servers use AES256 GCM if it is in
+    // the offered ciphers and they have AES-NI, so it is offered only if it is faster here.
+    uint32_t encryption = proto::ENCRYPTION_CHACHA20_POLY1305;
+    if (cipher_speed.aes256_gcm >= cipher_speed.chacha20_poly1305)
         encryption |= proto::ENCRYPTION_AES256_GCM;
-#endif
 
     client_hello->set_encryption(encryption);
+    client_hello->set_aes256_gcm_speed(cipher_speed.aes256_gcm);
+    client_hello->set_chacha20_poly1305_speed(cipher_speed.chacha20_poly1305);
     client_hello->set_identify(identify_);
 
     if (!peer_public_key_.empty())
@@ -264,6 +272,23 @@ void ClientAuthenticator::sendClientHello()
         client_hello->set_iv(toStdString(encrypt_iv_));
     }
 
+    if (identify_ == proto::IDENTIFY_SRP && !ticket_.data().empty())
+    {
+        // The key of the resumed session is derived from the initialization vectors.
+        if (encrypt_iv_.empty())
+        {
+            encrypt_iv_ = Random::byteArray(kIvSize);
+            if (encrypt_iv_.empty())
+            {
+                finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
+                return;
+            }
+        }
+
+        client_hello->set_iv(toStdString(encrypt_iv_));
+        client_hello->set_ticket(ticket_.data());
+    }
+
     LOG(LS_INFO) << "Sending: ClientHello";
     sendMessage(*client_hello);
 }
@@ -295,6 +320,34 @@ bool ClientAuthenticator::readServerHello(const ByteArray& buffer)
 
     decrypt_iv_ = fromStdString(server_hello->iv());
 
+    if (server_hello->resumed())
+    {
+        // The server cannot resume a session without a ticket.
+        if (identify_ != proto::IDENTIFY_SRP || ticket_.data().empty() || decrypt_iv_.empty())
+        {
+            finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+            return false;
+        }
+
+        LOG(LS_INFO) << "Session resumed by ticket";
+
+        GenericHash hash(GenericHash::BLAKE2s256);
+
+        if (!session_key_.empty())
+            hash.addData(session_key_);
+        hash.addData(ticket_.secret());
+        hash.addData(encrypt_iv_);
+        hash.addData(decrypt_iv_);
+
+        session_key_ = hash.result();
+        resumed_ = true;
+    }
+    else
+    {
+        // The ticket is not accepted by the server.
+        ticket_.Clear();
+    }
+
     if (session_key_.empty() != decrypt_iv_.empty())
     {
         finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
@@ -420,6 +473,9 @@ bool ClientAuthenticator::readSessionChallenge(const ByteArray& buffer)
     LOG(LS_INFO) << "Server OS: " << challenge->os_name();
     LOG(LS_INFO) << "Server CPU Cores: " << challenge->cpu_cores();
 
+    if (challenge->has_ticket())
+        ticket_.Swap(challenge->mutable_ticket());
+
     return true;
 }
 
@@ -36,6 +36,14 @@ public:
     void setPassword(std::u16string_view password);
     void setSessionType(uint32_t session_type);
 
+    // Sets the ticket received from the same server for the same user in the previous session.
+    // If the server accepts it, SRP is skipped. Otherwise, the user name and password are used.
+    void setTicket(const proto::ResumptionTicket& ticket);
+
+    // After successful authentication, returns the ticket for the next connection. The ticket is
+    // empty if the server does not issue tickets.
+    const proto::ResumptionTicket& ticket() const { return ticket_; }
+
 protected:
     // Authenticator implementation.
     bool onStarted() override;
@@ -68,6 +76,9 @@ private:
     std::u16string username_;
     std::u16string password_;
 
+    proto::ResumptionTicket ticket_;
+    bool resumed_ = false;
+
     BigNum N_;
     BigNum g_;
     BigNum s_;
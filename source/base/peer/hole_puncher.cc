@@ -0,0 +1,226 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/peer/hole_puncher.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/net/network_channel.h"
+#include "base/net/tcp_reuse_address.h"
+#include "base/strings/unicode.h"
+
+namespace base {
+
+namespace {
+
+// The opposite peer may be late. Until its SYN opens the mapping in its NAT, the attempts are
+// rejected or dropped, so they are repeated until this time is out. After that, the peers use
+// the relay.
+const std::chrono::seconds kPunchTimeout { 3 };
+
+// A dropped SYN is sent again by the system only after a second, an attempt is restarted earlier.
+const std::chrono::milliseconds kAttemptTimeout { 500 };
+
+// The pause after a rejected attempt.
+const std::chrono::milliseconds kRetryInterval { 100 };
+
+} // namespace
+
+HolePuncher::HolePuncher()
+    : io_context_(MessageLoop::current()->pumpAsio()->ioContext()),
+      socket_(io_context_),
+      timer_(io_context_)
+{
+    // Nothing
+}
+
+HolePuncher::~HolePuncher()
+{
+    delegate_ = nullptr;
+
+    std::error_code ignored_code;
+    timer_.cancel(ignored_code);
+    socket_.cancel(ignored_code);
+    socket_.close(ignored_code);
+}
+
+void HolePuncher::start(const asio::ip::tcp::endpoint& local_endpoint,
+                        const asio::ip::tcp::endpoint& peer_endpoint,
+                        Delegate* delegate)
+{
+    local_endpoint_ = local_endpoint;
+    peer_endpoint_ = peer_endpoint;
+    delegate_ = delegate;
+
+    DCHECK(delegate_);
+
+    LOG(LS_INFO) << "Start hole punching from port " << local_endpoint_.port() << " to "
+                 << utf16FromLocal8Bit(peer_endpoint_.address().to_string()) << ":"
+                 << peer_endpoint_.port();
+
+    deadline_ = Clock::now() + kPunchTimeout;
+    doConnect();
+}
+
+// static
+std::optional<asio::ip::tcp::endpoint> HolePuncher::peerEndpoint(
+    const std::string& address, uint32_t port, const asio::ip::tcp::endpoint& local_endpoint)
+{
+    if (address.empty() || !port || port > 65535 || !local_endpoint.port())
+        return std::nullopt;
+
+    std::error_code error_code;
+    asio::ip::address peer_address = asio::ip::make_address(address, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Invalid peer address: " << address;
+        return std::nullopt;
+    }
+
+    // A router listening on both address families sees the IPv4 peers as mapped addresses.
+    if (peer_address.is_v6() && peer_address.to_v6().is_v4_mapped() &&
+        local_endpoint.address().is_v4())
+    {
+        peer_address = asio::ip::make_address_v4(asio::ip::v4_mapped, peer_address.to_v6());
+    }
+
+    if (peer_address.is_v4() != local_endpoint.address().is_v4())
+    {
+        LOG(LS_INFO) << "Address family of peer does not match: " << address;
+        return std::nullopt;
+    }
+
+    return asio::ip::tcp::endpoint(peer_address, static_cast<uint16_t>(port));
+}
+
+void HolePuncher::doConnect()
+{
+    if (Clock::now() >= deadline_)
+    {
+        LOG(LS_INFO) << "Hole punching timeout (attempts: " << attempt_count_ << ")";
+        onFailed();
+        return;
+    }
+
+    ++attempt_count_;
+
+    // The previous attempt is abandoned. Its handler is called with operation_aborted.
+    std::error_code error_code;
+    socket_.close(error_code);
+
+    socket_.open(local_endpoint_.protocol(), error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to open socket: " << utf16FromLocal8Bit(error_code.message());
+        onFailed();
+        return;
+    }
+
+    if (!setTcpReuseAddress(socket_.native_handle(), true))
+    {
+        onFailed();
+        return;
+    }
+
+    socket_.bind(local_endpoint_, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to bind socket: " << utf16FromLocal8Bit(error_code.message());
+        onFailed();
+        return;
+    }
+
+    socket_.async_connect(peer_endpoint_, [this](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        onConnected(error_code);
+    });
+
+    timer_.expires_after(kAttemptTimeout);
+    timer_.async_wait([this](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        onTimeout(error_code);
+    });
+}
+
+void HolePuncher::onConnected(const std::error_code& error_code)
+{
+    if (is_finished_)
+        return;
+
+    if (error_code)
+    {
+        // The SYN of this peer was rejected before the opposite peer opened its mapping.
+        timer_.expires_after(kRetryInterval);
+        timer_.async_wait([this](const std::error_code& error_code)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            onTimeout(error_code);
+        });
+        return;
+    }
+
+    LOG(LS_INFO) << "Hole punched (attempts: " << attempt_count_ << ")";
+
+    std::error_code ignored_code;
+    timer_.cancel(ignored_code);
+
+    is_finished_ = true;
+    if (delegate_)
+    {
+        delegate_->onHolePunched(
+            std::unique_ptr<NetworkChannel>(new NetworkChannel(std::move(socket_))));
+    }
+}
+
+void HolePuncher::onTimeout(const std::error_code& error_code)
+{
+    // The connection may be established at the same time as the timer expires.
+    if (is_finished_)
+        return;
+
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Error in timer: " << utf16FromLocal8Bit(error_code.message());
+        onFailed();
+        return;
+    }
+
+    doConnect();
+}
+
+void HolePuncher::onFailed()
+{
+    std::error_code ignored_code;
+    timer_.cancel(ignored_code);
+    socket_.close(ignored_code);
+
+    is_finished_ = true;
+    if (delegate_)
+        delegate_->onHolePunchFailed();
+}
+
+} // namespace base
@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__PEER__HOLE_PUNCHER_H
+#define BASE__PEER__HOLE_PUNCHER_H
+
+#include "base/macros_magic.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/ip/tcp.hpp>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace base {
+
+class NetworkChannel;
+
+// Makes a direct TCP connection between two peers behind NAT. The router tells each peer the
+// public endpoint of the opposite peer. Both peers connect to it at the same time from the local
+// port of their connection to the router, so that the NAT uses the public port seen by the router.
+// The first SYN of each peer opens a mapping in its own NAT, the SYN of the opposite peer passes
+// through it and the connection is established by the simultaneous open.
+class HolePuncher
+{
+public:
+    HolePuncher();
+    ~HolePuncher();
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onHolePunched(std::unique_ptr<NetworkChannel> channel) = 0;
+        virtual void onHolePunchFailed() = 0;
+    };
+
+    // |local_endpoint| is the local endpoint of the connection to the router. The connection to
+    // the router must allow the reuse of its address (see NetworkChannel::setReuseAddress).
+    void start(const asio::ip::tcp::endpoint& local_endpoint,
+               const asio::ip::tcp::endpoint& peer_endpoint,
+               Delegate* delegate);
+    bool isFinished() const { return is_finished_; }
+
+    // Makes the endpoint of the opposite peer from the address and the port sent by the router.
+    // Returns std::nullopt if the endpoint is invalid or has another address family than
+    // |local_endpoint|.
+    static std::optional<asio::ip::tcp::endpoint> peerEndpoint(
+        const std::string& address, uint32_t port, const asio::ip::tcp::endpoint& local_endpoint);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void doConnect();
+    void onConnected(const std::error_code& error_code);
+    void onTimeout(const std::error_code& error_code);
+    void onFailed();
+
+    Delegate* delegate_ = nullptr;
+    bool is_finished_ = false;
+
+    asio::ip::tcp::endpoint local_endpoint_;
+    asio::ip::tcp::endpoint peer_endpoint_;
+    Clock::time_point deadline_;
+    int attempt_count_ = 0;
+
+    asio::io_context& io_context_;
+    asio::ip::tcp::socket socket_;
+    asio::high_resolution_timer timer_;
+
+    DISALLOW_COPY_AND_ASSIGN(HolePuncher);
+};
+
+} // namespace base
+
+#endif // BASE__PEER__HOLE_PUNCHER_H
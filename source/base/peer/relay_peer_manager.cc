@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/net/network_channel.h"
+#include "proto/router_common.pb.h"
 
 namespace base {
 
@@ -42,6 +43,19 @@ void RelayPeerManager::addConnectionOffer(const proto::RelayCredentials& credent
     pending_.back()->start(credentials, this);
 }
 
+void RelayPeerManager::addConnectionOffer(const proto::RelayCredentials& credentials,
+                                          const asio::ip::tcp::endpoint& local_endpoint,
+                                          const asio::ip::tcp::endpoint& peer_endpoint)
+{
+    PendingPunch punch;
+    punch.puncher = std::make_unique<HolePuncher>();
+    punch.credentials = std::make_unique<proto::RelayCredentials>(credentials);
+
+    HolePuncher* puncher = punch.puncher.get();
+    pending_punches_.emplace_back(std::move(punch));
+    puncher->start(local_endpoint, peer_endpoint, this);
+}
+
 void RelayPeerManager::onRelayConnectionReady(std::unique_ptr<NetworkChannel> channel)
 {
     if (delegate_)
@@ -55,6 +69,30 @@ void RelayPeerManager::onRelayConnectionError()
     cleanup();
 }
 
+void RelayPeerManager::onHolePunched(std::unique_ptr<NetworkChannel> channel)
+{
+    if (delegate_)
+        delegate_->onNewPeerConnected(std::move(channel));
+
+    cleanup();
+}
+
+void RelayPeerManager::onHolePunchFailed()
+{
+    // The failed puncher is the only finished one, the others are removed when they finish.
+    for (auto& punch : pending_punches_)
+    {
+        if (!punch.puncher->isFinished() || !punch.credentials)
+            continue;
+
+        LOG(LS_INFO) << "Hole punching failed, connecting through the relay";
+        addConnectionOffer(*punch.credentials);
+        punch.credentials.reset();
+    }
+
+    cleanup();
+}
+
 void RelayPeerManager::cleanup()
 {
     auto it = pending_.begin();
@@ -70,6 +108,20 @@ void RelayPeerManager::cleanup()
             ++it;
         }
     }
+
+    auto punch = pending_punches_.begin();
+    while (punch != pending_punches_.end())
+    {
+        if (punch->puncher->isFinished())
+        {
+            task_runner_->deleteSoon(std::move(punch->puncher));
+            punch = pending_punches_.erase(punch);
+        }
+        else
+        {
+            ++punch;
+        }
+    }
 }
 
 } // namespace base
@@ -20,6 +20,7 @@
 #define BASE__PEER__RELAY_PEER_MANAGER_H
 
 #include "base/macros_magic.h"
+#include "base/peer/hole_puncher.h"
 #include "base/peer/relay_peer.h"
 
 #include <memory>
@@ -33,7 +34,9 @@ namespace base {
 class NetworkChannel;
 class TaskRunner;
 
-class RelayPeerManager : public RelayPeer::Delegate
+class RelayPeerManager
+    : public RelayPeer::Delegate,
+      public HolePuncher::Delegate
 {
 public:
     class Delegate
@@ -49,18 +52,35 @@ public:
 
     void addConnectionOffer(const proto::RelayCredentials& credentials);
 
+    // Punches a hole from |local_endpoint| to |peer_endpoint| first. The relay is used only if the
+    // direct connection is not established.
+    void addConnectionOffer(const proto::RelayCredentials& credentials,
+                            const asio::ip::tcp::endpoint& local_endpoint,
+                            const asio::ip::tcp::endpoint& peer_endpoint);
+
 protected:
     // RelayPeer::Delegate implementation.
     void onRelayConnectionReady(std::unique_ptr<NetworkChannel> channel) override;
     void onRelayConnectionError() override;
 
+    // HolePuncher::Delegate implementation.
+    void onHolePunched(std::unique_ptr<NetworkChannel> channel) override;
+    void onHolePunchFailed() override;
+
 private:
+    struct PendingPunch
+    {
+        std::unique_ptr<HolePuncher> puncher;
+        std::unique_ptr<proto::RelayCredentials> credentials;
+    };
+
     void cleanup();
 
     std::shared_ptr<TaskRunner> task_runner_;
     Delegate* delegate_;
 
     std::vector<std::unique_ptr<RelayPeer>> pending_;
+    std::vector<PendingPunch> pending_punches_;
 
     DISALLOW_COPY_AND_ASSIGN(RelayPeerManager);
 };
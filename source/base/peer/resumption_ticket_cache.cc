@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/peer/resumption_ticket_cache.h"
+
+namespace base {
+
+namespace {
+
+const size_t kMaxTicketCount = 64;
+
+} // namespace
+
+// static
+ResumptionTicketCache* ResumptionTicketCache::instance()
+{
+    static ResumptionTicketCache cache;
+    return &cache;
+}
+
+std::optional<proto::ResumptionTicket> ResumptionTicketCache::ticket(const std::string& key)
+{
+    std::scoped_lock lock(lock_);
+
+    for (auto it = tickets_.begin(); it != tickets_.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            tickets_.splice(tickets_.begin(), tickets_, it);
+            return tickets_.front().second;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void ResumptionTicketCache::setTicket(const std::string& key, const proto::ResumptionTicket& ticket)
+{
+    if (ticket.data().empty())
+    {
+        removeTicket(key);
+        return;
+    }
+
+    std::scoped_lock lock(lock_);
+
+    tickets_.remove_if([&key](const Entry& entry) { return entry.first == key; });
+    tickets_.emplace_front(key, ticket);
+
+    if (tickets_.size() > kMaxTicketCount)
+        tickets_.pop_back();
+}
+
+void ResumptionTicketCache::removeTicket(const std::string& key)
+{
+    std::scoped_lock lock(lock_);
+    tickets_.remove_if([&key](const Entry& entry) { return entry.first == key; });
+}
+
+} // namespace base
@@ -0,0 +1,59 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__PEER__RESUMPTION_TICKET_CACHE_H
+#define BASE__PEER__RESUMPTION_TICKET_CACHE_H
+
+#include "base/macros_magic.h"
+#include "proto/key_exchange.pb.h"
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace base {
+
+// Keeps the resumption tickets received by the clients of the process, so reconnects to the same
+// server can skip SRP. The key identifies the server and the user. Only the most recently used
+// tickets are kept. Can be used from any thread.
+class ResumptionTicketCache
+{
+public:
+    static ResumptionTicketCache* instance();
+
+    std::optional<proto::ResumptionTicket> ticket(const std::string& key);
+    void setTicket(const std::string& key, const proto::ResumptionTicket& ticket);
+    void removeTicket(const std::string& key);
+
+private:
+    ResumptionTicketCache() = default;
+
+    using Entry = std::pair<std::string, proto::ResumptionTicket>;
+
+    std::mutex lock_;
+
+    // The most recently used tickets are at the front.
+    std::list<Entry> tickets_;
+
+    DISALLOW_COPY_AND_ASSIGN(ResumptionTicketCache);
+};
+
+} // namespace base
+
+#endif // BASE__PEER__RESUMPTION_TICKET_CACHE_H
@@ -23,29 +23,70 @@
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/sys_info.h"
+#include "base/task_runner.h"
+#include "base/crypto/cipher_benchmark.h"
+#include "base/crypto/data_cryptor_chacha20_poly1305.h"
 #include "base/crypto/generic_hash.h"
 #include "base/crypto/random.h"
 #include "base/crypto/srp_constants.h"
+#include "base/crypto/srp_ephemeral_pool.h"
 #include "base/crypto/srp_math.h"
 #include "base/peer/user_list.h"
 #include "base/strings/unicode.h"
+#include "base/threading/worker_pool.h"
 #include "build/version.h"
 
+#include <algorithm>
+#include <ctime>
+
 namespace base {
 
 namespace {
 
 constexpr size_t kIvSize = 12;
+constexpr size_t kTicketSecretSize = 32;
+constexpr std::chrono::hours kTicketLifetime{ 24 };
 
 } // namespace
 
+// The SRP numbers are moved to the job while it runs on the worker pool and moved back when it
+// is completed, so the job and the authenticator never share them.
+struct ServerAuthenticator::CryptoJob
+{
+    // Reset when the authenticator is destroyed. Used only on the thread of the authenticator.
+    ServerAuthenticator* owner = nullptr;
+
+    // If not empty, the verifier is calculated for a user that does not exist.
+    std::u16string user_name;
+    ByteArray seed_key;
+
+    // If the pool is set, the server ephemeral of |group| is taken from it.
+    std::shared_ptr<SrpEphemeralPool> ephemeral_pool;
+    SrpNgPair group;
+
+    BigNum N;
+    BigNum g;
+    BigNum v;
+    BigNum s;
+    BigNum b;
+    BigNum B;
+    BigNum A;
+
+    ByteArray srp_key;
+};
+
 ServerAuthenticator::ServerAuthenticator(std::shared_ptr<TaskRunner> task_runner)
-    : Authenticator(std::move(task_runner))
+    : Authenticator(task_runner),
+      task_runner_(std::move(task_runner))
 {
     // Nothing
 }
 
-ServerAuthenticator::~ServerAuthenticator() = default;
+ServerAuthenticator::~ServerAuthenticator()
+{
+    if (crypto_job_)
+        crypto_job_->owner = nullptr;
+}
 
 void ServerAuthenticator::setUserList(std::shared_ptr<UserListBase> user_list)
 {
@@ -115,6 +156,21 @@ bool ServerAuthenticator::setAnonymousAccess(
     return true;
 }
 
+void ServerAuthenticator::setWorkerPool(std::shared_ptr<WorkerPool> worker_pool)
+{
+    worker_pool_ = std::move(worker_pool);
+}
+
+void ServerAuthenticator::setEphemeralPool(std::shared_ptr<SrpEphemeralPool> ephemeral_pool)
+{
+    ephemeral_pool_ = std::move(ephemeral_pool);
+}
+
+void ServerAuthenticator::setTicketKey(const ByteArray& ticket_key)
+{
+    ticket_key_ = ticket_key;
+}
+
 bool ServerAuthenticator::onStarted()
 {
     internal_state_ = InternalState::READ_CLIENT_HELLO;
@@ -157,6 +213,13 @@ bool ServerAuthenticator::onStarted()
 
 void ServerAuthenticator::onReceived(const ByteArray& buffer)
 {
+    // The peer must wait for the response to the previous message.
+    if (crypto_job_)
+    {
+        finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+        return;
+    }
+
     switch (internal_state_)
     {
         case InternalState::READ_CLIENT_HELLO:
@@ -199,7 +262,15 @@ void ServerAuthenticator::onWritten()
             {
                 case proto::IDENTIFY_SRP:
                 {
-                    internal_state_ = InternalState::READ_IDENTIFY;
+                    if (resumed_)
+                    {
+                        internal_state_ = InternalState::SEND_SESSION_CHALLENGE;
+                        doSessionChallenge();
+                    }
+                    else
+                    {
+                        internal_state_ = InternalState::READ_IDENTIFY;
+                    }
                 }
                 break;
 
@@ -319,16 +390,46 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
         }
     }
 
-    bool has_aes_ni = false;
+    if (identify_ == proto::IDENTIFY_SRP && !client_hello->ticket().empty())
+    {
+        resumed_ = resumeSession(*client_hello);
+        if (resumed_)
+        {
+            LOG(LS_INFO) << "Session resumed by ticket (user: " << user_name_ << ")";
+
+            server_hello->set_resumed(true);
+            server_hello->set_iv(toStdString(encrypt_iv_));
+        }
+    }
+
+    bool use_aes = false;
 
+    if (client_hello->aes256_gcm_speed() && client_hello->chacha20_poly1305_speed())
+    {
+        const CipherBenchmark::Result& cipher_speed = CipherBenchmark::result();
+
+        // The connection is limited by the side which is slower with the cipher.
+        const uint32_t aes_speed =
+            std::min(client_hello->aes256_gcm_speed(), cipher_speed.aes256_gcm);
+        const uint32_t chacha_speed =
+            std::min(client_hello->chacha20_poly1305_speed(), cipher_speed.chacha20_poly1305);
+
+        LOG(LS_INFO) << "Cipher speed (AES256 GCM: " << aes_speed
+                     << " MB/s, ChaCha20+Poly1305: " << chacha_speed << " MB/s)";
+        use_aes = aes_speed > chacha_speed;
+    }
+    else if (client_hello->encryption() & proto::ENCRYPTION_AES256_GCM)
+    {
+        // The old clients offer AES256 GCM only if they have hardware support for it.
 #if defined(ARCH_CPU_X86_FAMILY)
-    has_aes_ni = CpuidUtil::hasAesNi();
+        use_aes = CpuidUtil::hasAesNi();
 #endif
+    }
 
-    if ((client_hello->encryption() & proto::ENCRYPTION_AES256_GCM) && has_aes_ni)
+    if (use_aes)
     {
-        LOG(LS_INFO) << "Both sides have hardware support AES. Using AES256 GCM";
-        // If both sides of the connection support AES, then method AES256 GCM is the fastest option.
+        LOG(LS_INFO) << "Using AES256 GCM";
+        // AES256 GCM is faster for this connection.
         server_hello->set_encryption(proto::ENCRYPTION_AES256_GCM);
     }
     else
@@ -347,6 +448,94 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
     sendMessage(*server_hello);
 }
 
+bool ServerAuthenticator::resumeSession(const proto::ClientHello& client_hello)
+{
+    ByteArray client_iv = fromStdString(client_hello.iv());
+    if (ticket_key_.empty() || !user_list_ || client_iv.empty())
+        return false;
+
+    DataCryptorChaCha20Poly1305 cryptor(toStdString(ticket_key_));
+
+    std::string data;
+    proto::ResumptionTicketData ticket;
+
+    if (!cryptor.decrypt(client_hello.ticket(), &data) || !ticket.ParseFromString(data))
+    {
+        LOG(LS_INFO) << "Invalid ticket";
+        return false;
+    }
+
+    if (ticket.expire_time() < static_cast<int64_t>(std::time(nullptr)))
+    {
+        LOG(LS_INFO) << "Ticket expired";
+        return false;
+    }
+
+    User user = user_list_->find(utf16FromUtf8(ticket.username()));
+    if (!user.isValid() || !(user.flags & User::ENABLED))
+    {
+        LOG(LS_INFO) << "User '" << ticket.username() << "' NOT found or disabled";
+        return false;
+    }
+
+    // The tickets of the user become invalid when the password is changed.
+    ByteArray verifier_hash = GenericHash::hash(GenericHash::Type::BLAKE2s256, user.verifier);
+    if (verifier_hash != fromStdString(ticket.verifier_hash()))
+    {
+        LOG(LS_INFO) << "Ticket of user '" << ticket.username() << "' is outdated";
+        return false;
+    }
+
+    decrypt_iv_ = std::move(client_iv);
+    encrypt_iv_ = Random::byteArray(kIvSize);
+    if (encrypt_iv_.empty())
+        return false;
+
+    // The key is unique for each connection because the initialization vectors are random.
+    GenericHash hash(GenericHash::BLAKE2s256);
+
+    if (!session_key_.empty())
+        hash.addData(session_key_);
+    hash.addData(ticket.secret());
+    hash.addData(decrypt_iv_);
+    hash.addData(encrypt_iv_);
+
+    session_key_ = hash.result();
+    user_name_ = ticket.username();
+    session_types_ = user.sessions;
+    verifier_hash_ = std::move(verifier_hash);
+    return true;
+}
+
+bool ServerAuthenticator::createTicket(proto::ResumptionTicket* ticket)
+{
+    std::string secret = toStdString(Random::byteArray(kTicketSecretSize));
+    if (secret.empty())
+        return false;
+
+    const int64_t expire_time = static_cast<int64_t>(std::time(nullptr)) +
+        std::chrono::duration_cast<std::chrono::seconds>(kTicketLifetime).count();
+
+    proto::ResumptionTicketData ticket_data;
+    ticket_data.set_username(user_name_);
+    ticket_data.set_secret(secret);
+    ticket_data.set_expire_time(expire_time);
+    ticket_data.set_verifier_hash(toStdString(verifier_hash_));
+
+    DataCryptorChaCha20Poly1305 cryptor(toStdString(ticket_key_));
+
+    std::string data;
+    if (!cryptor.encrypt(ticket_data.SerializeAsString(), &data))
+    {
+        LOG(LS_ERROR) << "Unable to encrypt ticket";
+        return false;
+    }
+
+    ticket->set_data(std::move(data));
+    ticket->set_secret(std::move(secret));
+    return true;
+}
+
 void ServerAuthenticator::onIdentify(const ByteArray& buffer)
 {
     LOG(LS_INFO) << "Received: Identify";
@@ -367,6 +556,8 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
 
     LOG(LS_INFO) << "Username: " << user_name_;
 
+    std::shared_ptr<CryptoJob> job = std::make_shared<CryptoJob>();
+
     do
     {
         std::u16string user_name_utf16 = base::utf16FromUtf8(user_name_);
@@ -403,10 +594,13 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
             std::optional<SrpNgPair> Ng_pair = pairByGroup(user.group);
             if (Ng_pair.has_value())
             {
-                N_ = BigNum::fromStdString(Ng_pair->first);
-                g_ = BigNum::fromStdString(Ng_pair->second);
-                s_ = BigNum::fromByteArray(user.salt);
-                v_ = BigNum::fromByteArray(user.verifier);
+                verifier_hash_ = GenericHash::hash(GenericHash::Type::BLAKE2s256, user.verifier);
+
+                job->group = *Ng_pair;
+                job->N = BigNum::fromStdString(Ng_pair->first);
+                job->g = BigNum::fromStdString(Ng_pair->second);
+                job->s = BigNum::fromByteArray(user.salt);
+                job->v = BigNum::fromByteArray(user.verifier);
                 break;
             }
             else
@@ -421,15 +615,30 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
         hash.addData(seed_key);
         hash.addData(user_name_);
 
-        N_ = BigNum::fromStdString(kSrpNgPair_8192.first);
-        g_ = BigNum::fromStdString(kSrpNgPair_8192.second);
-        s_ = BigNum::fromByteArray(hash.result());
-        v_ = SrpMath::calc_v(user_name_utf16, seed_key, s_, N_, g_);
+        job->group = kSrpNgPair_8192;
+        job->N = BigNum::fromStdString(kSrpNgPair_8192.first);
+        job->g = BigNum::fromStdString(kSrpNgPair_8192.second);
+        job->s = BigNum::fromByteArray(hash.result());
+        job->user_name = std::move(user_name_utf16);
+        job->seed_key = std::move(seed_key);
     }
     while (false);
 
-    b_ = BigNum::fromByteArray(Random::byteArray(128)); // 1024 bits.
-    B_ = SrpMath::calc_B(b_, N_, g_, v_);
+    job->ephemeral_pool = ephemeral_pool_;
+
+    runCryptoJob(std::move(job),
+                 &ServerAuthenticator::calcServerKeyExchange,
+                 &ServerAuthenticator::onServerKeyExchangeReady);
+}
+
+void ServerAuthenticator::onServerKeyExchangeReady(CryptoJob* job)
+{
+    N_ = std::move(job->N);
+    g_ = std::move(job->g);
+    v_ = std::move(job->v);
+    s_ = std::move(job->s);
+    b_ = std::move(job->b);
+    B_ = std::move(job->B);
 
     if (!N_.isValid() || !g_.isValid() || !s_.isValid() || !B_.isValid())
     {
@@ -474,7 +683,28 @@ void ServerAuthenticator::onClientKeyExchange(const ByteArray& buffer)
         return;
     }
 
-    ByteArray srp_key = createSrpKey();
+    std::shared_ptr<CryptoJob> job = std::make_shared<CryptoJob>();
+
+    job->N = std::move(N_);
+    job->v = std::move(v_);
+    job->b = std::move(b_);
+    job->B = std::move(B_);
+    job->A = std::move(A_);
+
+    runCryptoJob(std::move(job),
+                 &ServerAuthenticator::calcSrpKey,
+                 &ServerAuthenticator::onSrpKeyReady);
+}
+
+void ServerAuthenticator::onSrpKeyReady(CryptoJob* job)
+{
+    N_ = std::move(job->N);
+    v_ = std::move(job->v);
+    b_ = std::move(job->b);
+    B_ = std::move(job->B);
+    A_ = std::move(job->A);
+
+    const ByteArray& srp_key = job->srp_key;
     if (srp_key.empty())
     {
         finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
@@ -526,6 +756,14 @@ void ServerAuthenticator::doSessionChallenge()
     session_challenge->set_computer_name(SysInfo::computerName());
     session_challenge->set_cpu_cores(SysInfo::processorThreads());
 
+    // The ticket is issued only to known users. It is sent encrypted with the session key.
+    if (!verifier_hash_.empty() && !ticket_key_.empty())
+    {
+        proto::ResumptionTicket ticket;
+        if (createTicket(&ticket))
+            session_challenge->mutable_ticket()->Swap(&ticket);
+    }
+
     LOG(LS_INFO) << "Sending: SessionChallenge";
     sendMessage(*session_challenge);
 }
@@ -570,18 +808,73 @@ void ServerAuthenticator::onSessionResponse(const ByteArray& buffer)
     finish(FROM_HERE, ErrorCode::SUCCESS);
 }
 
-ByteArray ServerAuthenticator::createSrpKey()
+void ServerAuthenticator::runCryptoJob(
+    std::shared_ptr<CryptoJob> job, CryptoWork work, CryptoReply reply)
 {
-    if (!SrpMath::verify_A_mod_N(A_, N_))
+    if (!worker_pool_)
+    {
+        work(job.get());
+        (this->*reply)(job.get());
+        return;
+    }
+
+    DCHECK(!crypto_job_);
+
+    job->owner = this;
+    crypto_job_ = job;
+
+    worker_pool_->postTask([job, work, reply, task_runner = task_runner_]()
+    {
+        work(job.get());
+
+        task_runner->postTask([job, reply]()
+        {
+            // The authenticator can be destroyed or finished by timeout while the job is running.
+            ServerAuthenticator* self = job->owner;
+            if (!self)
+                return;
+
+            self->crypto_job_.reset();
+
+            if (self->state() == State::PENDING)
+                (self->*reply)(job.get());
+        });
+    });
+}
+
+// static
+void ServerAuthenticator::calcServerKeyExchange(CryptoJob* job)
+{
+    if (!job->seed_key.empty())
+        job->v = SrpMath::calc_v(job->user_name, job->seed_key, job->s, job->N, job->g);
+
+    if (job->ephemeral_pool)
+    {
+        // Only the part of the user is calculated during the authentication.
+        SrpEphemeralPool::Ephemeral ephemeral = job->ephemeral_pool->take(job->group);
+
+        job->b = std::move(ephemeral.b);
+        job->B = SrpMath::calc_B_from_gb(ephemeral.gb, job->N, job->g, job->v);
+        return;
+    }
+
+    job->b = BigNum::fromByteArray(Random::byteArray(128)); // 1024 bits.
+    job->B = SrpMath::calc_B(job->b, job->N, job->g, job->v);
+}
+
+// static
+void ServerAuthenticator::calcSrpKey(CryptoJob* job)
+{
+    if (!SrpMath::verify_A_mod_N(job->A, job->N))
     {
         LOG(LS_ERROR) << "SrpMath::verify_A_mod_N failed";
-        return ByteArray();
+        return;
     }
 
-    BigNum u = SrpMath::calc_u(A_, B_, N_);
-    BigNum server_key = SrpMath::calcServerKey(A_, v_, u, b_, N_);
+    BigNum u = SrpMath::calc_u(job->A, job->B, job->N);
+    BigNum server_key = SrpMath::calcServerKey(job->A, job->v, u, job->b, job->N);
 
-    return server_key.toByteArray();
+    job->srp_key = server_key.toByteArray();
 }
 
 } // namespace base
@@ -26,7 +26,9 @@
 
 namespace base {
 
+class SrpEphemeralPool;
 class UserListBase;
+class WorkerPool;
 
 class ServerAuthenticator : public Authenticator
 {
@@ -52,6 +54,21 @@ public:
     // By default, anonymous access is disabled.
     [[nodiscard]] bool setAnonymousAccess(AnonymousAccess anonymous_access, uint32_t session_types);
 
+    // Sets the pool that runs the SRP math. The results are returned to the thread of the
+    // authenticator. If the pool is not set, the math runs on the thread of the authenticator.
+    void setWorkerPool(std::shared_ptr<WorkerPool> worker_pool);
+
+    // Sets the pool of the server ephemerals calculated in advance. If the pool is not set, the
+    // ephemeral is calculated for each authentication.
+    void setEphemeralPool(std::shared_ptr<SrpEphemeralPool> ephemeral_pool);
+
+    // Sets the key that encrypts the resumption tickets. If the key is not set, the tickets are
+    // not issued and not accepted.
+    void setTicketKey(const ByteArray& ticket_key);
+
+    // Returns the session types which are allowed for the authenticated user.
+    [[nodiscard]] uint32_t sessionTypes() const { return session_types_; }
+
 protected:
     // Authenticator implementation.
     bool onStarted() override;
@@ -59,14 +76,38 @@ protected:
     void onWritten() override;
 
 private:
+    struct CryptoJob;
+
+    using CryptoWork = void (*)(CryptoJob* job);
+    using CryptoReply = void (ServerAuthenticator::*)(CryptoJob* job);
+
     void onClientHello(const ByteArray& buffer);
+    bool resumeSession(const proto::ClientHello& client_hello);
+    bool createTicket(proto::ResumptionTicket* ticket);
     void onIdentify(const ByteArray& buffer);
+    void onServerKeyExchangeReady(CryptoJob* job);
     void onClientKeyExchange(const ByteArray& buffer);
+    void onSrpKeyReady(CryptoJob* job);
     void doSessionChallenge();
     void onSessionResponse(const ByteArray& buffer);
-    [[nodiscard]] ByteArray createSrpKey();
 
+    void runCryptoJob(std::shared_ptr<CryptoJob> job, CryptoWork work, CryptoReply reply);
+    static void calcServerKeyExchange(CryptoJob* job);
+    static void calcSrpKey(CryptoJob* job);
+
+    std::shared_ptr<TaskRunner> task_runner_;
     std::shared_ptr<UserListBase> user_list_;
+    std::shared_ptr<WorkerPool> worker_pool_;
+    std::shared_ptr<SrpEphemeralPool> ephemeral_pool_;
+
+    // The job that is running on the worker pool.
+    std::shared_ptr<CryptoJob> crypto_job_;
+
+    ByteArray ticket_key_;
+
+    // Hash of the verifier of the authenticated user. The ticket is invalid when it is changed.
+    ByteArray verifier_hash_;
+    bool resumed_ = false;
 
     enum class InternalState
     {
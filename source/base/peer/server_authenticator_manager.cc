@@ -18,18 +18,33 @@
 
 #include "base/peer/server_authenticator_manager.h"
 
+#include "base/latency_histogram.h"
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/crypto/generic_hash.h"
+#include "base/crypto/random.h"
 #include "base/peer/user_list_base.h"
 
 namespace base {
 
+namespace {
+
+const size_t kDefaultMaxPending = 64;
+const size_t kDefaultMaxWaiting = 4096;
+const size_t kTicketKeySize = 32;
+
+} // namespace
+
 ServerAuthenticatorManager::ServerAuthenticatorManager(
     std::shared_ptr<TaskRunner> task_runner, Delegate* delegate)
     : task_runner_(std::move(task_runner)),
+      max_pending_(kDefaultMaxPending),
+      max_waiting_(kDefaultMaxWaiting),
       delegate_(delegate)
 {
     DCHECK(task_runner_ && delegate_);
+
+    ticket_key_ = Random::byteArray(kTicketKeySize);
 }
 
 ServerAuthenticatorManager::~ServerAuthenticatorManager() = default;
@@ -43,6 +58,15 @@ void ServerAuthenticatorManager::setUserList(std::unique_ptr<UserListBase> user_
 void ServerAuthenticatorManager::setPrivateKey(const ByteArray& private_key)
 {
     private_key_ = private_key;
+
+    if (!private_key_.empty())
+    {
+        GenericHash hash(GenericHash::BLAKE2s256);
+        hash.addData(private_key_);
+        hash.addData("aspia_resumption_ticket");
+
+        ticket_key_ = hash.result();
+    }
 }
 
 void ServerAuthenticatorManager::setAnonymousAccess(
@@ -52,13 +76,58 @@ void ServerAuthenticatorManager::setAnonymousAccess(
     anonymous_session_types_ = session_types;
 }
 
+void ServerAuthenticatorManager::setWorkerPool(std::shared_ptr<WorkerPool> worker_pool)
+{
+    worker_pool_ = std::move(worker_pool);
+}
+
+void ServerAuthenticatorManager::setEphemeralPool(std::shared_ptr<SrpEphemeralPool> ephemeral_pool)
+{
+    ephemeral_pool_ = std::move(ephemeral_pool);
+}
+
+void ServerAuthenticatorManager::setAdmissionLimits(size_t max_pending, size_t max_waiting)
+{
+    DCHECK_GT(max_pending, 0u);
+
+    max_pending_ = max_pending;
+    max_waiting_ = max_waiting;
+}
+
+void ServerAuthenticatorManager::setLatencyHistogram(
+    std::shared_ptr<LatencyHistogram> histogram)
+{
+    latency_histogram_ = std::move(histogram);
+}
+
 void ServerAuthenticatorManager::addNewChannel(std::unique_ptr<NetworkChannel> channel)
 {
     DCHECK(channel);
 
+    if (pending_.size() < max_pending_)
+    {
+        startAuthenticator(std::move(channel));
+        return;
+    }
+
+    if (waiting_.size() >= max_waiting_)
+    {
+        LOG(LS_WARNING) << "Too many connections waiting for authentication. Connection "
+                        << channel->peerAddress() << " rejected";
+        return;
+    }
+
+    waiting_.emplace_back(std::move(channel));
+}
+
+void ServerAuthenticatorManager::startAuthenticator(std::unique_ptr<NetworkChannel> channel)
+{
     std::unique_ptr<ServerAuthenticator> authenticator =
         std::make_unique<ServerAuthenticator>(task_runner_);
     authenticator->setUserList(user_list_);
+    authenticator->setWorkerPool(worker_pool_);
+    authenticator->setEphemeralPool(ephemeral_pool_);
+    authenticator->setTicketKey(ticket_key_);
 
     if (!private_key_.empty())
     {
@@ -76,10 +145,10 @@ void ServerAuthenticatorManager::addNewChannel(std::unique_ptr<NetworkChannel> c
     }
 
     // Create a new authenticator for the connection and put it on the list.
-    pending_.emplace_back(std::move(authenticator));
+    pending_.push_back({ std::move(authenticator), std::chrono::steady_clock::now() });
 
     // Start the authentication process.
-    pending_.back()->start(
+    pending_.back().authenticator->start(
         std::move(channel), std::bind(&ServerAuthenticatorManager::onComplete, this));
 }
 
@@ -87,7 +156,7 @@ void ServerAuthenticatorManager::onComplete()
 {
     for (auto it = pending_.begin(); it != pending_.end();)
     {
-        ServerAuthenticator* current = it->get();
+        ServerAuthenticator* current = it->authenticator.get();
 
         switch (current->state())
         {
@@ -104,12 +173,16 @@ void ServerAuthenticatorManager::onComplete()
                     session_info.computer_name = current->peerComputerName();
                     session_info.user_name     = current->userName();
                     session_info.session_type  = current->sessionType();
+                    session_info.session_types = current->sessionTypes();
 
                     delegate_->onNewSession(std::move(session_info));
                 }
 
+                if (latency_histogram_)
+                    latency_histogram_->add(std::chrono::steady_clock::now() - it->start_time);
+
                 // Authenticator not needed anymore.
-                task_runner_->deleteSoon(std::move(*it));
+                task_runner_->deleteSoon(std::move(it->authenticator));
                 it = pending_.erase(it);
             }
             break;
@@ -124,6 +197,15 @@ void ServerAuthenticatorManager::onComplete()
                 return;
         }
     }
+
+    // The completed authenticators free places for the waiting channels.
+    while (!waiting_.empty() && pending_.size() < max_pending_)
+    {
+        std::unique_ptr<NetworkChannel> channel = std::move(waiting_.front());
+        waiting_.pop_front();
+
+        startAuthenticator(std::move(channel));
+    }
 }
 
 } // namespace base
@@ -21,8 +21,13 @@
 
 #include "base/peer/server_authenticator.h"
 
+#include <chrono>
+#include <deque>
+
 namespace base {
 
+class LatencyHistogram;
+
 class ServerAuthenticatorManager
 {
 public:
@@ -42,6 +47,9 @@ public:
         std::string computer_name;
         std::string user_name;
         uint32_t session_type = 0;
+
+        // The session types which are allowed for the user.
+        uint32_t session_types = 0;
     };
 
     class Delegate
@@ -63,20 +71,56 @@ public:
     void setAnonymousAccess(
         ServerAuthenticator::AnonymousAccess anonymous_access, uint32_t session_types);
 
+    // Sets the pool that runs the SRP math of the authenticators. The pool can be shared by
+    // several managers.
+    void setWorkerPool(std::shared_ptr<WorkerPool> worker_pool);
+
+    // Sets the pool of the server ephemerals of SRP. The pool can be shared by several managers.
+    void setEphemeralPool(std::shared_ptr<SrpEphemeralPool> ephemeral_pool);
+
+    // Limits the number of channels that are authenticated at the same time. The other channels
+    // wait in the queue (up to |max_waiting| channels), the channels over the queue are closed.
+    // It smooths the load when a large number of peers connect at once.
+    void setAdmissionLimits(size_t max_pending, size_t max_waiting);
+
+    // The duration of each completed authentication is added to |histogram|. The histogram can
+    // be shared by several managers.
+    void setLatencyHistogram(std::shared_ptr<LatencyHistogram> histogram);
+
     // Adds a channel to the authentication queue. After success completion, a session will be
     // created (in a stopped state) and method Delegate::onNewSession will be called.
     // If authentication fails, the channel will be automatically deleted.
     void addNewChannel(std::unique_ptr<NetworkChannel> channel);
 
 private:
+    void startAuthenticator(std::unique_ptr<NetworkChannel> channel);
     void onComplete();
 
     std::shared_ptr<TaskRunner> task_runner_;
     std::shared_ptr<UserListBase> user_list_;
-    std::vector<std::unique_ptr<ServerAuthenticator>> pending_;
+    std::shared_ptr<WorkerPool> worker_pool_;
+    std::shared_ptr<SrpEphemeralPool> ephemeral_pool_;
+    std::shared_ptr<LatencyHistogram> latency_histogram_;
+
+    struct PendingAuthenticator
+    {
+        std::unique_ptr<ServerAuthenticator> authenticator;
+        std::chrono::steady_clock::time_point start_time;
+    };
+
+    std::vector<PendingAuthenticator> pending_;
+
+    // The channels that wait until the number of pending authenticators falls below the limit.
+    std::deque<std::unique_ptr<NetworkChannel>> waiting_;
+    size_t max_pending_;
+    size_t max_waiting_;
 
     ByteArray private_key_;
 
+    // Encrypts the resumption tickets. Derived from the private key if it is set, so the tickets
+    // remain valid after restart.
+    ByteArray ticket_key_;
+
     ServerAuthenticator::AnonymousAccess anonymous_access_ =
         ServerAuthenticator::AnonymousAccess::DISABLE;
 
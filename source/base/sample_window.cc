@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/sample_window.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+SampleWindow::SampleWindow(size_t capacity)
+    : capacity_(capacity)
+{
+    DCHECK_GT(capacity_, 0u);
+    samples_.reserve(capacity_);
+}
+
+SampleWindow::~SampleWindow() = default;
+
+void SampleWindow::add(int64_t value)
+{
+    if (samples_.size() < capacity_)
+    {
+        samples_.push_back(value);
+        return;
+    }
+
+    samples_[next_] = value;
+    next_ = (next_ + 1) % capacity_;
+}
+
+void SampleWindow::clear()
+{
+    samples_.clear();
+    next_ = 0;
+}
+
+int64_t SampleWindow::percentile(int percent) const
+{
+    DCHECK_GE(percent, 0);
+    DCHECK_LE(percent, 100);
+
+    if (samples_.empty())
+        return 0;
+
+    // Nearest-rank method: the smallest value that is greater than or equal to |percent| percent
+    // of the samples.
+    size_t rank = (samples_.size() * static_cast<size_t>(percent) + 99) / 100;
+    if (rank > 0)
+        --rank;
+
+    sorted_ = samples_;
+    std::nth_element(sorted_.begin(), sorted_.begin() + rank, sorted_.end());
+    return sorted_[rank];
+}
+
+} // namespace base
@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__SAMPLE_WINDOW_H
+#define BASE__SAMPLE_WINDOW_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace base {
+
+// Keeps the last |capacity| values of a measurement and calculates their percentiles. When the
+// window is full, a new value replaces the oldest one.
+class SampleWindow
+{
+public:
+    explicit SampleWindow(size_t capacity);
+    ~SampleWindow();
+
+    void add(int64_t value);
+    void clear();
+
+    size_t count() const { return samples_.size(); }
+    bool isEmpty() const { return samples_.empty(); }
+
+    // Returns the value below which |percent| percent of the samples fall (nearest rank). Returns
+    // 0 if the window is empty.
+    int64_t percentile(int percent) const;
+
+private:
+    const size_t capacity_;
+    std::vector<int64_t> samples_;
+    size_t next_ = 0;
+
+    // Used by percentile() to avoid an allocation for each call.
+    mutable std::vector<int64_t> sorted_;
+
+    DISALLOW_COPY_AND_ASSIGN(SampleWindow);
+};
+
+} // namespace base
+
+#endif // BASE__SAMPLE_WINDOW_H
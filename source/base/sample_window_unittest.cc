@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/sample_window.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(SampleWindowTest, Empty)
+{
+    SampleWindow window(10);
+
+    EXPECT_TRUE(window.isEmpty());
+    EXPECT_EQ(window.count(), 0u);
+    EXPECT_EQ(window.percentile(50), 0);
+}
+
+TEST(SampleWindowTest, Percentiles)
+{
+    SampleWindow window(100);
+
+    // Added in reverse order to check that the values are sorted.
+    for (int i = 100; i >= 1; --i)
+        window.add(i);
+
+    EXPECT_EQ(window.count(), 100u);
+    EXPECT_EQ(window.percentile(0), 1);
+    EXPECT_EQ(window.percentile(50), 50);
+    EXPECT_EQ(window.percentile(95), 95);
+    EXPECT_EQ(window.percentile(99), 99);
+    EXPECT_EQ(window.percentile(100), 100);
+}
+
+TEST(SampleWindowTest, SingleSample)
+{
+    SampleWindow window(4);
+    window.add(7);
+
+    EXPECT_EQ(window.percentile(0), 7);
+    EXPECT_EQ(window.percentile(50), 7);
+    EXPECT_EQ(window.percentile(100), 7);
+}
+
+TEST(SampleWindowTest, OldestReplaced)
+{
+    SampleWindow window(3);
+
+    window.add(100);
+    window.add(200);
+    window.add(300);
+
+    // Replace 100 and 200.
+    window.add(1);
+    window.add(2);
+
+    EXPECT_EQ(window.count(), 3u);
+    EXPECT_EQ(window.percentile(0), 1);
+    EXPECT_EQ(window.percentile(100), 300);
+
+    window.clear();
+    EXPECT_TRUE(window.isEmpty());
+
+    window.add(5);
+    EXPECT_EQ(window.percentile(100), 5);
+}
+
+} // namespace base
@@ -20,6 +20,7 @@
 
 #include "build/build_config.h"
 
+#include <chrono>
 #include <cstring>
 
 #if defined(OS_WIN)
@@ -76,4 +77,11 @@ SystemTime SystemTime::now()
     return SystemTime(data);
 }
 
+// static
+int64_t SystemTime::microsecondsSinceEpoch()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 } // namespace base
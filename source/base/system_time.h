@@ -19,6 +19,8 @@
 #ifndef BASE__SYSTEM_TIME_H
 #define BASE__SYSTEM_TIME_H
 
+#include <cstdint>
+
 namespace base {
 
 class SystemTime
@@ -32,6 +34,11 @@ public:
     // Returns current system time.
     static SystemTime now();
 
+    // Returns the number of microseconds since the Unix epoch. Unlike now(), the value does not
+    // depend on the time zone, so it can be compared between the processes and (after correcting
+    // the clock offset) between the computers.
+    static int64_t microsecondsSinceEpoch();
+
     // Four digit year "2019".
     int year() const { return data_.year; }
 
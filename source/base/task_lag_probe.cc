@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/task_lag_probe.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+int64_t currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+TaskLagProbe::TaskLagProbe(std::shared_ptr<TaskRunner> task_runner)
+    : task_runner_(std::move(task_runner)),
+      state_(std::make_shared<State>())
+{
+    DCHECK(task_runner_);
+}
+
+TaskLagProbe::~TaskLagProbe() = default;
+
+void TaskLagProbe::probe()
+{
+    const int64_t posted_time = currentTime();
+
+    int64_t expected = 0;
+    if (!state_->posted_time.compare_exchange_strong(expected, posted_time))
+    {
+        // The previous task is still in the queue.
+        return;
+    }
+
+    // The state is shared with the task, so the task can run after the probe is destroyed.
+    task_runner_->postTask([state = state_, posted_time]()
+    {
+        state->last_lag.store(currentTime() - posted_time, std::memory_order_relaxed);
+        state->posted_time.store(0);
+    });
+}
+
+std::chrono::microseconds TaskLagProbe::lag() const
+{
+    int64_t lag = state_->last_lag.load(std::memory_order_relaxed);
+
+    const int64_t posted_time = state_->posted_time.load();
+    if (posted_time)
+        lag = std::max(lag, currentTime() - posted_time);
+
+    return std::chrono::microseconds(lag);
+}
+
+} // namespace base
@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__TASK_LAG_PROBE_H
+#define BASE__TASK_LAG_PROBE_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace base {
+
+class TaskRunner;
+
+// Measures how long the tasks wait in the queue of a task runner. Each call of probe() posts a
+// task and the delay before it runs is kept until the next probe. If the task has not run yet,
+// the time elapsed since it was posted is reported.
+class TaskLagProbe
+{
+public:
+    explicit TaskLagProbe(std::shared_ptr<TaskRunner> task_runner);
+    ~TaskLagProbe();
+
+    // Can be called from any thread.
+    void probe();
+    std::chrono::microseconds lag() const;
+
+private:
+    struct State
+    {
+        // The time in microseconds, 0 if no task is waiting.
+        std::atomic<int64_t> posted_time { 0 };
+        std::atomic<int64_t> last_lag { 0 };
+    };
+
+    std::shared_ptr<TaskRunner> task_runner_;
+    std::shared_ptr<State> state_;
+
+    DISALLOW_COPY_AND_ASSIGN(TaskLagProbe);
+};
+
+} // namespace base
+
+#endif // BASE__TASK_LAG_PROBE_H
@@ -19,6 +19,8 @@
 #ifndef BASE__TASK_RUNNER_H
 #define BASE__TASK_RUNNER_H
 
+#include "base/message_loop/task_callback.h"
+
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -30,7 +32,8 @@ class TaskRunner : public std::enable_shared_from_this<TaskRunner>
 public:
     virtual ~TaskRunner() = default;
 
-    using Callback = std::function<void()>;
+    // Move-only. Any callable without arguments can be passed, small ones do not allocate memory.
+    using Callback = TaskCallback;
     using Milliseconds = std::chrono::milliseconds;
 
     virtual bool belongsToCurrentThread() const = 0;
@@ -0,0 +1,230 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/scoped_thread_priority.h"
+
+#include "base/logging.h"
+
+#if defined(OS_WIN)
+#include "base/audio/win/scoped_mmcss_registration.h"
+#include <Windows.h>
+#elif defined(OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(OS_MAC)
+#include <pthread.h>
+#include <pthread/qos.h>
+#endif
+
+#include <cerrno>
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX)
+// The nice values of the threads. The setpriority() with the ID of a thread changes only this
+// thread on Linux.
+const int kBackgroundNice = 10;
+const int kDisplayCriticalNice = -8;
+
+// The priority of SCHED_RR for the audio. The low values do not preempt the kernel threads.
+const int kRealtimeAudioPriority = 8;
+
+pid_t currentThreadId()
+{
+    return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+bool setCurrentThreadNice(int nice_value)
+{
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()), nice_value) != 0)
+    {
+        PLOG(LS_WARNING) << "setpriority(" << nice_value << ") failed";
+        return false;
+    }
+
+    return true;
+}
+#endif // defined(OS_LINUX)
+
+} // namespace
+
+const char* threadPriorityToString(ThreadPriority priority)
+{
+    switch (priority)
+    {
+        case ThreadPriority::BACKGROUND:
+            return "BACKGROUND";
+        case ThreadPriority::NORMAL:
+            return "NORMAL";
+        case ThreadPriority::DISPLAY_CRITICAL:
+            return "DISPLAY_CRITICAL";
+        case ThreadPriority::REALTIME_AUDIO:
+            return "REALTIME_AUDIO";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+ScopedThreadPriority::ScopedThreadPriority(ThreadPriority priority)
+    : priority_(priority)
+{
+    if (priority_ == ThreadPriority::NORMAL)
+    {
+        succeeded_ = true;
+        return;
+    }
+
+#if defined(OS_WIN)
+    HANDLE thread = GetCurrentThread();
+
+    switch (priority_)
+    {
+        case ThreadPriority::BACKGROUND:
+            succeeded_ = SetThreadPriority(thread, THREAD_MODE_BACKGROUND_BEGIN) != FALSE;
+            break;
+
+        case ThreadPriority::DISPLAY_CRITICAL:
+            // MMCSS is not used, a thread which encodes continuously would take most of the CPU
+            // from the user workload.
+            succeeded_ = SetThreadPriority(thread, THREAD_PRIORITY_ABOVE_NORMAL) != FALSE;
+            break;
+
+        case ThreadPriority::REALTIME_AUDIO:
+            mmcss_registration_ = std::make_unique<ScopedMMCSSRegistration>(L"Pro Audio");
+            if (mmcss_registration_->isSucceeded())
+            {
+                succeeded_ = true;
+                break;
+            }
+
+            mmcss_registration_.reset();
+            succeeded_ = SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST) != FALSE;
+            break;
+
+        default:
+            break;
+    }
+#elif defined(OS_LINUX)
+    errno = 0;
+    previous_nice_ = getpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()));
+    if (errno != 0)
+        previous_nice_ = 0;
+
+    switch (priority_)
+    {
+        case ThreadPriority::BACKGROUND:
+            succeeded_ = setCurrentThreadNice(kBackgroundNice);
+            break;
+
+        case ThreadPriority::DISPLAY_CRITICAL:
+            succeeded_ = setCurrentThreadNice(kDisplayCriticalNice);
+            break;
+
+        case ThreadPriority::REALTIME_AUDIO:
+        {
+            sched_param param;
+            param.sched_priority = kRealtimeAudioPriority;
+
+            int ret = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+            if (ret == 0)
+            {
+                succeeded_ = true;
+                break;
+            }
+
+            LOG(LS_WARNING) << "pthread_setschedparam failed: " << ret;
+            succeeded_ = setCurrentThreadNice(kDisplayCriticalNice);
+        }
+        break;
+
+        default:
+            break;
+    }
+#elif defined(OS_MAC)
+    qos_class_t qos_class = QOS_CLASS_DEFAULT;
+
+    switch (priority_)
+    {
+        case ThreadPriority::BACKGROUND:
+            qos_class = QOS_CLASS_BACKGROUND;
+            break;
+
+        case ThreadPriority::DISPLAY_CRITICAL:
+        case ThreadPriority::REALTIME_AUDIO:
+            qos_class = QOS_CLASS_USER_INTERACTIVE;
+            break;
+
+        default:
+            break;
+    }
+
+    int ret = pthread_set_qos_class_self_np(qos_class, 0);
+    if (ret != 0)
+        LOG(LS_WARNING) << "pthread_set_qos_class_self_np failed: " << ret;
+
+    succeeded_ = ret == 0;
+#endif
+
+    if (!succeeded_)
+    {
+        LOG(LS_WARNING) << "Unable to set the thread priority " << threadPriorityToString(priority_)
+                        << ", the normal priority is used";
+    }
+}
+
+ScopedThreadPriority::~ScopedThreadPriority()
+{
+    if (priority_ == ThreadPriority::NORMAL || !succeeded_)
+        return;
+
+#if defined(OS_WIN)
+    if (mmcss_registration_)
+    {
+        mmcss_registration_.reset();
+        return;
+    }
+
+    if (priority_ == ThreadPriority::BACKGROUND)
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+    else
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+#elif defined(OS_LINUX)
+    sched_param param;
+    param.sched_priority = 0;
+
+    int policy = SCHED_OTHER;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy != SCHED_OTHER)
+    {
+        param.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        return;
+    }
+
+    // Lowering the nice value back needs the same privileges as raising the priority.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()), previous_nice_);
+#elif defined(OS_MAC)
+    pthread_set_qos_class_self_np(QOS_CLASS_DEFAULT, 0);
+#endif
+}
+
+} // namespace base
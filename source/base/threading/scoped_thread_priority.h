@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__SCOPED_THREAD_PRIORITY_H
+#define BASE__THREADING__SCOPED_THREAD_PRIORITY_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#include <memory>
+
+namespace base {
+
+#if defined(OS_WIN)
+class ScopedMMCSSRegistration;
+#endif // defined(OS_WIN)
+
+// The scheduling class of a thread.
+enum class ThreadPriority
+{
+    // Work which may wait for the user workload (file transfer, system information). The thread
+    // also gets a lower I/O priority where the platform supports it.
+    BACKGROUND,
+
+    NORMAL,
+
+    // Work which delays the frames if it is preempted (capture, encode, decode).
+    DISPLAY_CRITICAL,
+
+    // Work with a hard deadline of a few milliseconds (audio capture and playback).
+    REALTIME_AUDIO
+};
+
+const char* threadPriorityToString(ThreadPriority priority);
+
+// Applies |priority| to the current thread and restores the normal priority in the destructor.
+// The priority is mapped to:
+// Windows: MMCSS for REALTIME_AUDIO, SetThreadPriority() for the others; BACKGROUND uses the
+//          background mode, which also lowers the I/O and the memory priority.
+// Linux: SCHED_RR for REALTIME_AUDIO, the nice value of the thread for the others.
+// macOS: the QoS classes.
+// The raised priorities may need privileges (e.g. CAP_SYS_NICE on Linux). If they cannot be set,
+// the thread keeps running with the normal priority.
+class ScopedThreadPriority
+{
+public:
+    explicit ScopedThreadPriority(ThreadPriority priority);
+    ~ScopedThreadPriority();
+
+    bool isSucceeded() const { return succeeded_; }
+
+private:
+    const ThreadPriority priority_;
+    bool succeeded_ = false;
+
+#if defined(OS_WIN)
+    std::unique_ptr<ScopedMMCSSRegistration> mmcss_registration_;
+#elif defined(OS_LINUX)
+    int previous_nice_ = 0;
+#endif
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedThreadPriority);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__SCOPED_THREAD_PRIORITY_H
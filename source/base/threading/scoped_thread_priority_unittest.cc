@@ -0,0 +1,54 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/scoped_thread_priority.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace base {
+
+TEST(ScopedThreadPriority, Normal)
+{
+    ScopedThreadPriority priority(ThreadPriority::NORMAL);
+    EXPECT_TRUE(priority.isSucceeded());
+}
+
+TEST(ScopedThreadPriority, Background)
+{
+    // Lowering the priority does not need any privileges.
+    bool succeeded = false;
+
+    std::thread thread([&succeeded]()
+    {
+        ScopedThreadPriority priority(ThreadPriority::BACKGROUND);
+        succeeded = priority.isSucceeded();
+    });
+    thread.join();
+
+    EXPECT_TRUE(succeeded);
+}
+
+TEST(ScopedThreadPriority, ToString)
+{
+    EXPECT_STREQ(threadPriorityToString(ThreadPriority::DISPLAY_CRITICAL), "DISPLAY_CRITICAL");
+    EXPECT_STREQ(threadPriorityToString(ThreadPriority::REALTIME_AUDIO), "REALTIME_AUDIO");
+}
+
+} // namespace base
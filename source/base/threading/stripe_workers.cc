@@ -0,0 +1,109 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/threading/stripe_workers.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+StripeWorkers::StripeWorkers(int thread_count)
+{
+    DCHECK_GT(thread_count, 0);
+
+    for (int i = 0; i < thread_count; ++i)
+        threads_.emplace_back(&StripeWorkers::threadMain, this, i + 1);
+}
+
+StripeWorkers::~StripeWorkers()
+{
+    {
+        std::scoped_lock lock(lock_);
+        terminating_ = true;
+    }
+
+    start_event_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void StripeWorkers::run(int row_count, const Task& task)
+{
+    {
+        std::scoped_lock lock(lock_);
+
+        task_ = &task;
+        row_count_ = row_count;
+        pending_ = static_cast<int>(threads_.size());
+        ++generation_;
+    }
+
+    start_event_.notify_all();
+
+    runStripe(0);
+
+    std::unique_lock lock(lock_);
+    while (pending_ != 0)
+        done_event_.wait(lock);
+
+    task_ = nullptr;
+}
+
+void StripeWorkers::threadMain(int stripe)
+{
+    uint64_t generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(lock_);
+
+            while (!terminating_ && generation_ == generation)
+                start_event_.wait(lock);
+
+            if (terminating_)
+                return;
+
+            generation = generation_;
+        }
+
+        runStripe(stripe);
+
+        bool done;
+
+        {
+            std::scoped_lock lock(lock_);
+            done = (--pending_ == 0);
+        }
+
+        if (done)
+            done_event_.notify_one();
+    }
+}
+
+void StripeWorkers::runStripe(int stripe)
+{
+    // |task_| and |row_count_| are not changed until all stripes are completed.
+    const int first_row = row_count_ * stripe / stripeCount();
+    const int last_row = row_count_ * (stripe + 1) / stripeCount();
+
+    if (first_row < last_row)
+        (*task_)(first_row, last_row);
+}
+
+} // namespace base
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__THREADING__STRIPE_WORKERS_H
+#define BASE__THREADING__STRIPE_WORKERS_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// Small pool of threads that process a range of rows split into stripes. The calling thread
+// always processes the first stripe itself and waits for the workers to finish the other ones.
+// The stripes do not overlap, so the task does not need any synchronization if it writes only to
+// its own rows.
+class StripeWorkers
+{
+public:
+    using Task = std::function<void(int first_row, int last_row)>;
+
+    // |thread_count| is the number of worker threads, not including the calling thread.
+    explicit StripeWorkers(int thread_count);
+    ~StripeWorkers();
+
+    int stripeCount() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // Runs |task| for the rows [0, row_count) and returns after all stripes are completed.
+    void run(int row_count, const Task& task);
+
+private:
+    void threadMain(int stripe);
+    void runStripe(int stripe);
+
+    std::vector<std::thread> threads_;
+
+    std::mutex lock_;
+    std::condition_variable start_event_;
+    std::condition_variable done_event_;
+
+    const Task* task_ = nullptr;
+    int row_count_ = 0;
+    uint64_t generation_ = 0;
+    int pending_ = 0;
+    bool terminating_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(StripeWorkers);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__STRIPE_WORKERS_H
@@ -112,6 +112,8 @@ void Thread::threadMain(MessageLoop::Type message_loop_type)
     thread_id_ = GetCurrentThreadId();
 #endif // defined(OS_WIN)
 
+    ScopedThreadPriority thread_priority(thread_priority_);
+
     // Let the thread do extra initialization.
     // Let's do this before signaling we are started.
     if (delegate_)
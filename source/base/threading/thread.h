@@ -20,6 +20,7 @@
 #define BASE__THREADING__THREAD_H
 
 #include "base/message_loop/message_loop.h"
+#include "base/threading/scoped_thread_priority.h"
 #include "build/build_config.h"
 
 #include <atomic>
@@ -54,6 +55,10 @@ public:
         }
     };
 
+    // Sets the scheduling class of the thread (see ScopedThreadPriority). It is applied when the
+    // thread starts, so it must be set before start().
+    void setThreadPriority(ThreadPriority priority) { thread_priority_ = priority; }
+
     // Starts the thread.
     void start(MessageLoop::Type message_loop_type, Delegate* delegate = nullptr);
 
@@ -98,6 +103,7 @@ private:
     void threadMain(MessageLoop::Type message_loop_type);
 
     Delegate* delegate_ = nullptr;
+    ThreadPriority thread_priority_ = ThreadPriority::NORMAL;
 
     enum class State { STARTING, STARTED, STOPPING, STOPPED };
 
@@ -0,0 +1,534 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/thread_pool.h"
+
+#include "base/logging.h"
+#include "base/message_loop/pending_task.h"
+
+#if defined(OS_WIN)
+#include "base/win/scoped_com_initializer.h"
+#endif // defined(OS_WIN)
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// The number of tasks of a sequence that run in a row before the sequence gives the thread to
+// other work. Bigger values reduce the scheduling overhead, smaller ones improve the fairness.
+const int kMaxTasksPerRun = 16;
+
+} // namespace
+
+class ThreadPool::Core
+{
+public:
+    Core(int thread_count, ThreadPriority thread_priority);
+    ~Core();
+
+    int threadCount() const { return static_cast<int>(workers_.size()); }
+
+    void start();
+    void stop();
+
+    void postTask(TaskRunner::Callback task, Priority priority = Priority::NORMAL);
+    void postDelayedTask(TaskRunner::Callback task, const TaskRunner::Milliseconds& delay);
+
+private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<TaskRunner::Callback> tasks;
+        std::thread thread;
+    };
+
+    void workerMain(size_t index);
+    void delayedMain();
+
+    // Adds a normal task to one of the worker queues.
+    void pushTask(TaskRunner::Callback task);
+    TaskRunner::Callback takeTask(size_t index);
+
+    const ThreadPriority thread_priority_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic_size_t next_worker_ { 0 };
+
+    // The background tasks are not distributed over the threads, they are taken by the threads
+    // which have nothing else to do.
+    std::mutex background_lock_;
+    std::deque<TaskRunner::Callback> background_tasks_;
+
+    // The number of tasks in all worker queues and in the background queue.
+    std::atomic_size_t pending_tasks_ { 0 };
+
+    std::mutex sleep_lock_;
+    std::condition_variable sleep_event_;
+    std::atomic_int sleeping_workers_ { 0 };
+    std::atomic_bool terminating_ { false };
+
+    std::thread delayed_thread_;
+    std::mutex delayed_lock_;
+    std::condition_variable delayed_event_;
+    DelayedTaskQueue delayed_tasks_;
+    int next_sequence_num_ = 0;
+
+    // The pool that owns the current thread and the index of the thread in the pool.
+    static thread_local Core* current_core_;
+    static thread_local size_t current_index_;
+
+    DISALLOW_COPY_AND_ASSIGN(Core);
+};
+
+// static
+thread_local ThreadPool::Core* ThreadPool::Core::current_core_ = nullptr;
+// static
+thread_local size_t ThreadPool::Core::current_index_ = 0;
+
+ThreadPool::Core::Core(int thread_count, ThreadPriority thread_priority)
+    : thread_priority_(thread_priority)
+{
+    DCHECK_GT(thread_count, 0);
+
+    for (int i = 0; i < thread_count; ++i)
+        workers_.emplace_back(std::make_unique<Worker>());
+}
+
+ThreadPool::Core::~Core()
+{
+    DCHECK(terminating_);
+}
+
+void ThreadPool::Core::start()
+{
+    for (size_t i = 0; i < workers_.size(); ++i)
+        workers_[i]->thread = std::thread(&Core::workerMain, this, i);
+
+    delayed_thread_ = std::thread(&Core::delayedMain, this);
+}
+
+void ThreadPool::Core::stop()
+{
+    {
+        std::scoped_lock lock(sleep_lock_, delayed_lock_);
+        terminating_.store(true, std::memory_order_release);
+    }
+
+    sleep_event_.notify_all();
+    delayed_event_.notify_all();
+
+    for (auto& worker : workers_)
+        worker->thread.join();
+    delayed_thread_.join();
+
+    // The remaining tasks are destroyed without the locks, they can own objects that post tasks.
+    // Such tasks are discarded because the pool is already terminating.
+    for (auto& worker : workers_)
+    {
+        std::deque<TaskRunner::Callback> tasks;
+
+        {
+            std::scoped_lock lock(worker->lock);
+            tasks.swap(worker->tasks);
+        }
+    }
+
+    std::deque<TaskRunner::Callback> background_tasks;
+
+    {
+        std::scoped_lock lock(background_lock_);
+        background_tasks.swap(background_tasks_);
+    }
+
+    DelayedTaskQueue delayed_tasks;
+
+    {
+        std::scoped_lock lock(delayed_lock_);
+        delayed_tasks.swap(delayed_tasks_);
+    }
+}
+
+void ThreadPool::Core::postTask(TaskRunner::Callback task, Priority priority)
+{
+    DCHECK(task);
+
+    // The tasks posted while the pool is destroyed are discarded.
+    if (terminating_.load(std::memory_order_acquire))
+        return;
+
+    if (priority == Priority::BACKGROUND)
+    {
+        std::scoped_lock lock(background_lock_);
+        background_tasks_.emplace_back(std::move(task));
+    }
+    else
+    {
+        pushTask(std::move(task));
+    }
+
+    // Either the poster sees the sleeping worker or the worker sees the new task before it starts
+    // waiting. The lock is taken only when there is a worker to wake up, so it is rarely contended.
+    pending_tasks_.fetch_add(1, std::memory_order_seq_cst);
+
+    if (sleeping_workers_.load(std::memory_order_seq_cst) == 0)
+        return;
+
+    {
+        // The worker that has increased the counter is already waiting when the lock is free.
+        std::scoped_lock lock(sleep_lock_);
+    }
+
+    sleep_event_.notify_one();
+}
+
+void ThreadPool::Core::pushTask(TaskRunner::Callback task)
+{
+    // A task posted from a thread of the pool goes to the queue of that thread, its data is most
+    // likely still in the cache. The other tasks are distributed over all queues.
+    size_t index;
+    if (current_core_ == this)
+        index = current_index_;
+    else
+        index = next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+    Worker* worker = workers_[index].get();
+
+    std::scoped_lock lock(worker->lock);
+    worker->tasks.emplace_back(std::move(task));
+}
+
+void ThreadPool::Core::postDelayedTask(
+    TaskRunner::Callback task, const TaskRunner::Milliseconds& delay)
+{
+    DCHECK(task);
+
+    PendingTask::TimePoint run_time = PendingTask::Clock::now() + delay;
+    bool wakeup;
+
+    {
+        std::scoped_lock lock(delayed_lock_);
+
+        if (terminating_)
+            return;
+
+        // The event is needed only if the new task is the first to run.
+        wakeup = delayed_tasks_.empty() || run_time < delayed_tasks_.top().delayed_run_time;
+        delayed_tasks_.emplace(std::move(task), run_time, true, next_sequence_num_++);
+    }
+
+    if (wakeup)
+        delayed_event_.notify_one();
+}
+
+TaskRunner::Callback ThreadPool::Core::takeTask(size_t index)
+{
+    const size_t count = workers_.size();
+
+    // The own queue first, the oldest task first. Then the newest tasks of the other queues. The
+    // owner and the thieves take from the different ends, so they rarely touch the same tasks.
+    for (size_t i = 0; i < count; ++i)
+    {
+        Worker* worker = workers_[(index + i) % count].get();
+        TaskRunner::Callback task;
+
+        {
+            std::scoped_lock lock(worker->lock);
+
+            if (worker->tasks.empty())
+                continue;
+
+            if (i == 0)
+            {
+                task = std::move(worker->tasks.front());
+                worker->tasks.pop_front();
+            }
+            else
+            {
+                task = std::move(worker->tasks.back());
+                worker->tasks.pop_back();
+            }
+        }
+
+        pending_tasks_.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+    }
+
+    TaskRunner::Callback task;
+
+    {
+        std::scoped_lock lock(background_lock_);
+
+        if (background_tasks_.empty())
+            return nullptr;
+
+        task = std::move(background_tasks_.front());
+        background_tasks_.pop_front();
+    }
+
+    pending_tasks_.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+void ThreadPool::Core::workerMain(size_t index)
+{
+#if defined(OS_WIN)
+    win::ScopedCOMInitializer com_initializer;
+    CHECK(com_initializer.isSucceeded());
+#endif // defined(OS_WIN)
+
+    ScopedThreadPriority thread_priority(thread_priority_);
+
+    current_core_ = this;
+    current_index_ = index;
+
+    while (true)
+    {
+        TaskRunner::Callback task = takeTask(index);
+        if (task)
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock lock(sleep_lock_);
+
+        if (terminating_)
+            break;
+
+        sleeping_workers_.fetch_add(1, std::memory_order_seq_cst);
+
+        // A task could be posted after the queues were checked.
+        if (pending_tasks_.load(std::memory_order_seq_cst) == 0)
+            sleep_event_.wait(lock);
+
+        sleeping_workers_.fetch_sub(1, std::memory_order_relaxed);
+
+        if (terminating_)
+            break;
+    }
+
+    current_core_ = nullptr;
+}
+
+void ThreadPool::Core::delayedMain()
+{
+    std::unique_lock lock(delayed_lock_);
+
+    while (!terminating_)
+    {
+        if (delayed_tasks_.empty())
+        {
+            delayed_event_.wait(lock);
+            continue;
+        }
+
+        PendingTask::TimePoint run_time = delayed_tasks_.top().delayed_run_time;
+        if (run_time > PendingTask::Clock::now())
+        {
+            delayed_event_.wait_until(lock, run_time);
+            continue;
+        }
+
+        PendingTask pending_task = delayed_tasks_.takeTop();
+
+        lock.unlock();
+        postTask(std::move(pending_task.callback));
+        lock.lock();
+    }
+}
+
+class ThreadPool::Sequence : public TaskRunner
+{
+public:
+    explicit Sequence(std::shared_ptr<Core> core)
+        : core_(std::move(core))
+    {
+        // Nothing
+    }
+
+    ~Sequence() override = default;
+
+    // TaskRunner implementation.
+    bool belongsToCurrentThread() const override;
+    void postTask(Callback task) override;
+    void postDelayedTask(Callback callback, const Milliseconds& delay) override;
+    void postNonNestableTask(Callback callback) override;
+    void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) override;
+    void postQuit() override;
+
+private:
+    void schedule();
+    void runTasks();
+
+    std::shared_ptr<Core> core_;
+
+    std::mutex lock_;
+    std::deque<Callback> tasks_;
+
+    // True while the sequence is in a queue of the pool or its tasks are running.
+    bool scheduled_ = false;
+
+    // The sequence whose tasks are running on the current thread.
+    static thread_local const Sequence* current_;
+
+    DISALLOW_COPY_AND_ASSIGN(Sequence);
+};
+
+// static
+thread_local const ThreadPool::Sequence* ThreadPool::Sequence::current_ = nullptr;
+
+bool ThreadPool::Sequence::belongsToCurrentThread() const
+{
+    return current_ == this;
+}
+
+void ThreadPool::Sequence::postTask(Callback task)
+{
+    DCHECK(task);
+
+    {
+        std::scoped_lock lock(lock_);
+
+        tasks_.emplace_back(std::move(task));
+
+        if (scheduled_)
+            return;
+
+        scheduled_ = true;
+    }
+
+    schedule();
+}
+
+void ThreadPool::Sequence::postDelayedTask(Callback callback, const Milliseconds& delay)
+{
+    DCHECK(callback);
+
+    // The order of the delayed tasks is kept by the delayed queue of the pool, which takes tasks
+    // with the same run time in the posting order.
+    std::shared_ptr<Sequence> self = std::static_pointer_cast<Sequence>(shared_from_this());
+
+    core_->postDelayedTask([self, callback = std::move(callback)]() mutable
+    {
+        self->postTask(std::move(callback));
+    }, delay);
+}
+
+void ThreadPool::Sequence::postNonNestableTask(Callback callback)
+{
+    // The tasks of the pool never run nested.
+    postTask(std::move(callback));
+}
+
+void ThreadPool::Sequence::postNonNestableDelayedTask(Callback callback, const Milliseconds& delay)
+{
+    postDelayedTask(std::move(callback), delay);
+}
+
+void ThreadPool::Sequence::postQuit()
+{
+    NOTIMPLEMENTED();
+}
+
+void ThreadPool::Sequence::schedule()
+{
+    std::shared_ptr<Sequence> self = std::static_pointer_cast<Sequence>(shared_from_this());
+    core_->postTask([self]() { self->runTasks(); });
+}
+
+void ThreadPool::Sequence::runTasks()
+{
+    DCHECK(!current_);
+    current_ = this;
+
+    for (int i = 0; i < kMaxTasksPerRun; ++i)
+    {
+        Callback task;
+
+        {
+            std::scoped_lock lock(lock_);
+
+            if (tasks_.empty())
+            {
+                scheduled_ = false;
+                current_ = nullptr;
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+    }
+
+    current_ = nullptr;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        if (tasks_.empty())
+        {
+            scheduled_ = false;
+            return;
+        }
+    }
+
+    // The sequence is still scheduled, it goes to the end of the queue of the current thread and
+    // the other work has a chance to run.
+    schedule();
+}
+
+ThreadPool::ThreadPool(int thread_count, ThreadPriority thread_priority)
+{
+    if (thread_count <= 0)
+        thread_count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    core_ = std::make_shared<Core>(thread_count, thread_priority);
+    core_->start();
+}
+
+ThreadPool::~ThreadPool()
+{
+    core_->stop();
+}
+
+int ThreadPool::threadCount() const
+{
+    return core_->threadCount();
+}
+
+void ThreadPool::postTask(TaskRunner::Callback task, Priority priority)
+{
+    core_->postTask(std::move(task), priority);
+}
+
+std::shared_ptr<TaskRunner> ThreadPool::createSequencedTaskRunner()
+{
+    return std::make_shared<Sequence>(core_);
+}
+
+} // namespace base
@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__THREAD_POOL_H
+#define BASE__THREADING__THREAD_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/task_runner.h"
+#include "base/threading/scoped_thread_priority.h"
+
+#include <memory>
+
+namespace base {
+
+// Threads shared by many independent users. Each thread has its own queue of tasks, an idle
+// thread takes the tasks from the queues of the other threads, so the load is spread over all
+// threads without a single contended queue.
+//
+// The users that need their tasks to run one after another (for example, the tasks of a session)
+// get a sequenced task runner. The tasks of one sequence never run concurrently and run in the
+// order in which they are posted, but they can run on different threads. The different sequences
+// run in parallel.
+//
+// The tasks that are not started before the pool is destroyed are discarded. The task runners can
+// outlive the pool, the tasks posted after the pool is destroyed are discarded.
+class ThreadPool
+{
+public:
+    enum class Priority
+    {
+        NORMAL,
+
+        // The task runs only when there are no normal tasks in the queues. The background tasks
+        // run in the order in which they are posted.
+        BACKGROUND
+    };
+
+    // If |thread_count| is 0, it matches the number of processor cores. All threads of the pool
+    // run with |thread_priority|.
+    explicit ThreadPool(int thread_count = 0,
+                        ThreadPriority thread_priority = ThreadPriority::NORMAL);
+    ~ThreadPool();
+
+    int threadCount() const;
+
+    // Posts a task that can run in parallel with any other task. Can be called from any thread.
+    void postTask(TaskRunner::Callback task, Priority priority = Priority::NORMAL);
+
+    // Creates a new sequence of tasks. belongsToCurrentThread() of the runner returns true only
+    // inside the tasks of the sequence. postQuit() is not supported.
+    std::shared_ptr<TaskRunner> createSequencedTaskRunner();
+
+private:
+    class Core;
+    class Sequence;
+
+    std::shared_ptr<Core> core_;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__THREAD_POOL_H
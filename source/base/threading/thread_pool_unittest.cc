@@ -0,0 +1,211 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// Waits until the expected number of tasks is done.
+class Counter
+{
+public:
+    explicit Counter(int expected)
+        : expected_(expected)
+    {
+        // Nothing
+    }
+
+    void done()
+    {
+        std::scoped_lock lock(lock_);
+        if (++count_ == expected_)
+            event_.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock lock(lock_);
+        event_.wait(lock, [this]() { return count_ >= expected_; });
+    }
+
+private:
+    std::mutex lock_;
+    std::condition_variable event_;
+    const int expected_;
+    int count_ = 0;
+};
+
+} // namespace
+
+TEST(ThreadPoolTest, Tasks)
+{
+    const int kTaskCount = 10000;
+
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.threadCount(), 4);
+
+    std::atomic_int sum { 0 };
+    Counter counter(kTaskCount);
+
+    for (int i = 0; i < kTaskCount; ++i)
+    {
+        pool.postTask([&, i]()
+        {
+            sum += i;
+            counter.done();
+        });
+    }
+
+    counter.wait();
+    EXPECT_EQ(sum, kTaskCount * (kTaskCount - 1) / 2);
+}
+
+TEST(ThreadPoolTest, SequenceOrder)
+{
+    const int kSequenceCount = 8;
+    const int kTaskCount = 2000;
+
+    ThreadPool pool(4);
+    Counter counter(kSequenceCount * kTaskCount);
+
+    std::vector<std::shared_ptr<TaskRunner>> runners;
+    std::vector<std::vector<int>> results(kSequenceCount);
+    std::vector<std::atomic_int> running(kSequenceCount);
+
+    for (int i = 0; i < kSequenceCount; ++i)
+        runners.emplace_back(pool.createSequencedTaskRunner());
+
+    for (int j = 0; j < kTaskCount; ++j)
+    {
+        for (int i = 0; i < kSequenceCount; ++i)
+        {
+            runners[i]->postTask([&, i, j]()
+            {
+                // The tasks of one sequence never run at the same time.
+                EXPECT_EQ(running[i].fetch_add(1), 0);
+                EXPECT_TRUE(runners[i]->belongsToCurrentThread());
+                EXPECT_FALSE(runners[(i + 1) % kSequenceCount]->belongsToCurrentThread());
+
+                results[i].push_back(j);
+
+                running[i].fetch_sub(1);
+                counter.done();
+            });
+        }
+    }
+
+    counter.wait();
+
+    for (int i = 0; i < kSequenceCount; ++i)
+    {
+        EXPECT_FALSE(runners[i]->belongsToCurrentThread());
+
+        ASSERT_EQ(results[i].size(), static_cast<size_t>(kTaskCount));
+        for (int j = 0; j < kTaskCount; ++j)
+            EXPECT_EQ(results[i][j], j);
+    }
+}
+
+TEST(ThreadPoolTest, DelayedTasks)
+{
+    ThreadPool pool(2);
+    std::shared_ptr<TaskRunner> runner = pool.createSequencedTaskRunner();
+
+    Counter counter(3);
+    std::vector<int> results;
+
+    runner->postDelayedTask([&]() { results.push_back(2); counter.done(); },
+                            std::chrono::milliseconds(50));
+    runner->postDelayedTask([&]() { results.push_back(1); counter.done(); },
+                            std::chrono::milliseconds(10));
+    runner->postTask([&]() { results.push_back(0); counter.done(); });
+
+    counter.wait();
+    EXPECT_EQ(results, std::vector<int>({ 0, 1, 2 }));
+}
+
+TEST(ThreadPoolTest, RunnerOutlivesPool)
+{
+    std::shared_ptr<TaskRunner> runner;
+
+    {
+        ThreadPool pool(2);
+        runner = pool.createSequencedTaskRunner();
+        runner->postDelayedTask([]() {}, std::chrono::hours(1));
+    }
+
+    // The pool is destroyed, the task is discarded.
+    bool called = false;
+    runner->postTask([&]() { called = true; });
+    EXPECT_FALSE(called);
+}
+
+TEST(ThreadPoolTest, BackgroundTasks)
+{
+    ThreadPool pool(1);
+
+    std::mutex lock;
+    std::condition_variable event;
+    bool released = false;
+
+    // The only thread is busy while the tasks are posted.
+    pool.postTask([&]()
+    {
+        std::unique_lock task_lock(lock);
+        event.wait(task_lock, [&]() { return released; });
+    });
+
+    std::vector<int> order;
+    Counter counter(4);
+
+    auto task = [&](int id)
+    {
+        return [&, id]()
+        {
+            order.push_back(id);
+            counter.done();
+        };
+    };
+
+    pool.postTask(task(1), ThreadPool::Priority::BACKGROUND);
+    pool.postTask(task(2), ThreadPool::Priority::BACKGROUND);
+    pool.postTask(task(3));
+    pool.postTask(task(4));
+
+    {
+        std::scoped_lock task_lock(lock);
+        released = true;
+    }
+
+    event.notify_one();
+    counter.wait();
+
+    // The normal tasks go first, the background ones keep their order.
+    EXPECT_EQ(order, std::vector<int>({ 3, 4, 1, 2 }));
+}
+
+} // namespace base
@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/worker_pool.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+WorkerPool::WorkerPool(int thread_count)
+{
+    DCHECK_GT(thread_count, 0);
+
+    for (int i = 0; i < thread_count; ++i)
+        threads_.emplace_back(&WorkerPool::threadMain, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::scoped_lock lock(lock_);
+        terminating_ = true;
+    }
+
+    event_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+
+    // The remaining tasks are destroyed without the lock, they can own objects that post tasks.
+    std::deque<Task> tasks;
+    tasks.swap(tasks_);
+}
+
+void WorkerPool::postTask(Task task)
+{
+    DCHECK(task);
+
+    {
+        std::scoped_lock lock(lock_);
+        tasks_.emplace_back(std::move(task));
+    }
+
+    event_.notify_one();
+}
+
+size_t WorkerPool::pendingTasks() const
+{
+    std::scoped_lock lock(lock_);
+    return tasks_.size();
+}
+
+void WorkerPool::threadMain()
+{
+    while (true)
+    {
+        Task task;
+
+        {
+            std::unique_lock lock(lock_);
+
+            while (!terminating_ && tasks_.empty())
+                event_.wait(lock);
+
+            if (terminating_)
+                return;
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+    }
+}
+
+} // namespace base
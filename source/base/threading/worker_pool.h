@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__WORKER_POOL_H
+#define BASE__THREADING__WORKER_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// Fixed set of threads that run independent tasks in the order they are posted. Used to move CPU
+// intensive work (for example, the math of the key exchange) off the threads that serve the
+// network channels. Tasks that are not started before the pool is destroyed are discarded.
+class WorkerPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkerPool(int thread_count);
+    ~WorkerPool();
+
+    int threadCount() const { return static_cast<int>(threads_.size()); }
+
+    // Can be called from any thread.
+    void postTask(Task task);
+
+    // Returns the number of tasks that wait for a free thread.
+    size_t pendingTasks() const;
+
+private:
+    void threadMain();
+
+    std::vector<std::thread> threads_;
+
+    mutable std::mutex lock_;
+    std::condition_variable event_;
+    std::deque<Task> tasks_;
+    bool terminating_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__WORKER_POOL_H
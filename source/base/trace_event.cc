@@ -0,0 +1,279 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/trace_event.h"
+
+#include "base/environment.h"
+#include "base/logging.h"
+#include "base/process_handle.h"
+#include "base/strings/string_number_conversions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const char kTraceDirVariable[] = "ASPIA_TRACE_DIR";
+
+struct Event
+{
+    const char* category;
+    const char* name;
+    int64_t begin;
+    int64_t duration;
+};
+
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(int thread_id)
+        : thread_id(thread_id),
+          events(TraceLog::kEventsPerThread)
+    {
+        // Nothing
+    }
+
+    // The lock is taken by the owning thread for each event and is contended only while the
+    // events are written out.
+    std::mutex lock;
+
+    const int thread_id;
+    std::vector<Event> events;
+    size_t next = 0;
+    size_t count = 0;
+};
+
+struct Registry
+{
+    std::mutex lock;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    int next_thread_id = 1;
+
+    std::string process_name;
+    std::filesystem::path file_path;
+};
+
+Registry& registry()
+{
+    // The registry is never destroyed, the threads may add the events until the process exits.
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+ThreadBuffer* currentBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+
+    if (!buffer)
+    {
+        Registry& instance = registry();
+        std::scoped_lock lock(instance.lock);
+
+        buffer = std::make_shared<ThreadBuffer>(instance.next_thread_id++);
+        instance.buffers.emplace_back(buffer);
+    }
+
+    return buffer.get();
+}
+
+void appendEscaped(std::string_view value, std::string* out)
+{
+    for (char ch : value)
+    {
+        if (ch == '"' || ch == '\\')
+            out->push_back('\\');
+
+        if (static_cast<unsigned char>(ch) < 0x20)
+            out->push_back(' ');
+        else
+            out->push_back(ch);
+    }
+}
+
+} // namespace
+
+// static
+std::atomic<bool> TraceLog::enabled_ { false };
+
+// static
+void TraceLog::setEnabled(bool enable)
+{
+    enabled_.store(enable, std::memory_order_relaxed);
+}
+
+// static
+bool TraceLog::startFromEnvironment(std::string_view process_name)
+{
+    std::string trace_dir;
+    if (!Environment::get(kTraceDirVariable, &trace_dir) || trace_dir.empty())
+        return false;
+
+    std::string file_name(process_name);
+    file_name += '-';
+    file_name += numberToString(currentProcessId());
+    file_name += ".json";
+
+    {
+        Registry& instance = registry();
+        std::scoped_lock lock(instance.lock);
+
+        instance.process_name = process_name;
+        instance.file_path = std::filesystem::u8path(trace_dir) / file_name;
+
+        LOG(LS_INFO) << "Tracing started (file: " << instance.file_path << ")";
+    }
+
+    setEnabled(true);
+    return true;
+}
+
+// static
+void TraceLog::finish()
+{
+    std::filesystem::path file_path;
+
+    {
+        Registry& instance = registry();
+        std::scoped_lock lock(instance.lock);
+
+        if (instance.file_path.empty())
+            return;
+
+        file_path.swap(instance.file_path);
+    }
+
+    setEnabled(false);
+    writeToFile(file_path);
+}
+
+// static
+int64_t TraceLog::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// static
+void TraceLog::addEvent(const char* category, const char* name, int64_t begin, int64_t duration)
+{
+    ThreadBuffer* buffer = currentBuffer();
+    std::scoped_lock lock(buffer->lock);
+
+    buffer->events[buffer->next] = { category, name, begin, duration };
+    buffer->next = (buffer->next + 1) % buffer->events.size();
+    buffer->count = std::min(buffer->count + 1, buffer->events.size());
+}
+
+// static
+void TraceLog::clear()
+{
+    Registry& instance = registry();
+    std::scoped_lock lock(instance.lock);
+
+    for (const auto& buffer : instance.buffers)
+    {
+        std::scoped_lock buffer_lock(buffer->lock);
+        buffer->next = 0;
+        buffer->count = 0;
+    }
+}
+
+// static
+std::string TraceLog::toJson()
+{
+    const std::string pid = numberToString(currentProcessId());
+
+    std::string json = "{\"traceEvents\":[";
+    bool first = true;
+
+    Registry& instance = registry();
+    std::scoped_lock lock(instance.lock);
+
+    if (!instance.process_name.empty())
+    {
+        json += "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid +
+                ",\"tid\":0,\"args\":{\"name\":\"";
+        appendEscaped(instance.process_name, &json);
+        json += "\"}}";
+        first = false;
+    }
+
+    for (const auto& buffer : instance.buffers)
+    {
+        // The events are copied to keep the owning thread blocked as short as possible.
+        std::vector<Event> events;
+
+        {
+            std::scoped_lock buffer_lock(buffer->lock);
+
+            const size_t size = buffer->events.size();
+            const size_t start = (buffer->next + size - buffer->count) % size;
+
+            events.reserve(buffer->count);
+            for (size_t i = 0; i < buffer->count; ++i)
+                events.emplace_back(buffer->events[(start + i) % size]);
+        }
+
+        const std::string tid = numberToString(buffer->thread_id);
+
+        for (const auto& event : events)
+        {
+            if (!first)
+                json += ',';
+            first = false;
+
+            json += "\n{\"cat\":\"";
+            appendEscaped(event.category, &json);
+            json += "\",\"name\":\"";
+            appendEscaped(event.name, &json);
+            json += "\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + tid;
+            json += ",\"ts\":" + numberToString(event.begin);
+            json += ",\"dur\":" + numberToString(event.duration) + '}';
+        }
+    }
+
+    json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return json;
+}
+
+// static
+bool TraceLog::writeToFile(const std::filesystem::path& file_path)
+{
+    std::ofstream stream(file_path, std::ofstream::out | std::ofstream::trunc);
+    if (!stream.is_open())
+    {
+        LOG(LS_WARNING) << "Unable to open file: " << file_path;
+        return false;
+    }
+
+    stream << toJson();
+    if (stream.fail())
+    {
+        LOG(LS_WARNING) << "Unable to write file: " << file_path;
+        return false;
+    }
+
+    LOG(LS_INFO) << "Trace written to " << file_path;
+    return true;
+}
+
+} // namespace base
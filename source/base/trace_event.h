@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__TRACE_EVENT_H
+#define BASE__TRACE_EVENT_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace base {
+
+// Collects the durations of the scopes marked with TRACE_EVENT(). Each thread writes the events
+// into its own ring buffer, so the oldest events are overwritten when the buffer is full. When
+// tracing is disabled, a trace event costs one relaxed atomic load.
+// The collected events are written in the JSON format of Chrome trace events, which can be opened
+// in chrome://tracing and in Perfetto.
+class TraceLog
+{
+public:
+    // The maximum number of events stored for each thread.
+    static const size_t kEventsPerThread = 8192;
+
+    static void setEnabled(bool enable);
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Starts tracing if the environment variable ASPIA_TRACE_DIR is set. finish() writes the events
+    // to the file "<process_name>-<pid>.json" in this directory.
+    static bool startFromEnvironment(std::string_view process_name);
+    static void finish();
+
+    // Microseconds of the monotonic clock. The clock is the same for all processes, so the traces
+    // of the host processes can be merged.
+    static int64_t now();
+
+    static void addEvent(const char* category, const char* name, int64_t begin, int64_t duration);
+
+    // Removes the collected events of all threads.
+    static void clear();
+
+    static std::string toJson();
+    static bool writeToFile(const std::filesystem::path& file_path);
+
+private:
+    static std::atomic<bool> enabled_;
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(TraceLog);
+};
+
+class ScopedTraceEvent
+{
+public:
+    // |category| and |name| must be string literals.
+    ScopedTraceEvent(const char* category, const char* name)
+        : category_(category),
+          name_(name)
+    {
+        if (TraceLog::isEnabled())
+            begin_ = TraceLog::now();
+    }
+
+    ~ScopedTraceEvent()
+    {
+        if (begin_ >= 0)
+            TraceLog::addEvent(category_, name_, begin_, TraceLog::now() - begin_);
+    }
+
+private:
+    const char* category_;
+    const char* name_;
+    int64_t begin_ = -1;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+} // namespace base
+
+#define TRACE_EVENT_CONCAT_INTERNAL(a, b) a##b
+#define TRACE_EVENT_CONCAT(a, b) TRACE_EVENT_CONCAT_INTERNAL(a, b)
+
+// Records the duration of the current scope.
+#define TRACE_EVENT(category, name) \
+    base::ScopedTraceEvent TRACE_EVENT_CONCAT(trace_event_, __LINE__)(category, name)
+
+#endif // BASE__TRACE_EVENT_H
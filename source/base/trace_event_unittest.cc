@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/trace_event.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace base {
+
+namespace {
+
+size_t countOf(const std::string& text, std::string_view pattern)
+{
+    size_t count = 0;
+
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + pattern.size()))
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+class TraceEventTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        TraceLog::clear();
+    }
+
+    void TearDown() override
+    {
+        TraceLog::setEnabled(false);
+        TraceLog::clear();
+    }
+};
+
+} // namespace
+
+TEST_F(TraceEventTest, disabled)
+{
+    TraceLog::setEnabled(false);
+
+    {
+        TRACE_EVENT("test", "disabled_event");
+    }
+
+    EXPECT_EQ(countOf(TraceLog::toJson(), "disabled_event"), 0u);
+}
+
+TEST_F(TraceEventTest, scoped_event)
+{
+    TraceLog::setEnabled(true);
+
+    {
+        TRACE_EVENT("test", "outer_event");
+        TRACE_EVENT("test", "inner_event");
+    }
+
+    TraceLog::setEnabled(false);
+
+    const std::string json = TraceLog::toJson();
+
+    EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+    EXPECT_EQ(countOf(json, "\"name\":\"outer_event\""), 1u);
+    EXPECT_EQ(countOf(json, "\"name\":\"inner_event\""), 1u);
+    EXPECT_EQ(countOf(json, "\"ph\":\"X\""), 2u);
+}
+
+TEST_F(TraceEventTest, ring_buffer_overwrites_oldest)
+{
+    const size_t kEventCount = TraceLog::kEventsPerThread;
+
+    TraceLog::setEnabled(true);
+
+    TraceLog::addEvent("test", "old_event", 0, 1);
+    for (size_t i = 0; i < kEventCount; ++i)
+        TraceLog::addEvent("test", "new_event", 1, 1);
+
+    const std::string json = TraceLog::toJson();
+
+    EXPECT_EQ(countOf(json, "old_event"), 0u);
+    EXPECT_EQ(countOf(json, "new_event"), kEventCount);
+}
+
+TEST_F(TraceEventTest, threads)
+{
+    TraceLog::setEnabled(true);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([]()
+        {
+            for (int j = 0; j < 100; ++j)
+            {
+                TRACE_EVENT("test", "thread_event");
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(countOf(TraceLog::toJson(), "thread_event"), 400u);
+}
+
+} // namespace base
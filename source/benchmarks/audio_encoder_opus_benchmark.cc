@@ -0,0 +1,107 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_encoder_opus.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+const int kChannels = 2;
+const int kPacketMs = 10;
+const int kPacketCount = 100;
+
+// Generates |kPacketCount| packets of |kPacketMs| of stereo audio: a chord with a bit of noise,
+// which is harder for the encoder than silence or a pure tone.
+std::vector<proto::AudioPacket> createPackets(proto::AudioPacket::SamplingRate sampling_rate)
+{
+    static const double kPi = 3.14159265358979323846;
+
+    const int samples_per_packet = sampling_rate * kPacketMs / 1000;
+    std::vector<proto::AudioPacket> packets(kPacketCount);
+    std::mt19937 random(sampling_rate);
+    std::uniform_int_distribution<int> noise(-512, 512);
+    int sample_index = 0;
+
+    for (auto& packet : packets)
+    {
+        packet.set_encoding(proto::AUDIO_ENCODING_RAW);
+        packet.set_sampling_rate(sampling_rate);
+        packet.set_bytes_per_sample(proto::AudioPacket::BYTES_PER_SAMPLE_2);
+        packet.set_channels(proto::AudioPacket::CHANNELS_STEREO);
+
+        std::string* data = packet.add_data();
+        data->resize(samples_per_packet * kChannels * sizeof(int16_t));
+        int16_t* samples = reinterpret_cast<int16_t*>(data->data());
+
+        for (int i = 0; i < samples_per_packet; ++i, ++sample_index)
+        {
+            const double time = static_cast<double>(sample_index) / sampling_rate;
+            const double value = 6000.0 * std::sin(2 * kPi * 440.0 * time) +
+                                 4000.0 * std::sin(2 * kPi * 554.37 * time) +
+                                 3000.0 * std::sin(2 * kPi * 659.25 * time);
+
+            samples[i * kChannels] = static_cast<int16_t>(value + noise(random));
+            samples[i * kChannels + 1] = static_cast<int16_t>(value * 0.8 + noise(random));
+        }
+    }
+
+    return packets;
+}
+
+// Encodes the packets with the sampling rate |state.range(0)|. 44100 also measures the resampler.
+void BM_AudioEncoderOpus(benchmark::State& state)
+{
+    const std::vector<proto::AudioPacket> packets =
+        createPackets(static_cast<proto::AudioPacket::SamplingRate>(state.range(0)));
+
+    base::AudioEncoderOpus encoder;
+    proto::AudioPacket output;
+    size_t index = 0;
+
+    for (auto _ : state)
+    {
+        output.Clear();
+
+        if (!encoder.encode(packets[index], &output))
+        {
+            state.SkipWithError("Encoding failed");
+            break;
+        }
+
+        index = (index + 1) % packets.size();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["realtime"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * kPacketMs / 1000, benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+BENCHMARK(BM_AudioEncoderOpus)
+    ->Arg(proto::AudioPacket::SAMPLING_RATE_48000)
+    ->Arg(proto::AudioPacket::SAMPLING_RATE_44100);
+
+} // namespace benchmarks
@@ -0,0 +1,131 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_bus.h"
+#include "base/codec/multi_channel_resampler.h"
+#include "base/codec/sinc_resampler.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+// 10 ms at 48 kHz.
+const int kFrames = 480;
+
+void fillBus(base::AudioBus* bus)
+{
+    for (int ch = 0; ch < bus->channels(); ++ch)
+    {
+        float* data = bus->channel(ch);
+
+        for (int i = 0; i < bus->frames(); ++i)
+            data[i] = 0.5f * std::sin(static_cast<float>(i * (ch + 1)) * 0.01f);
+    }
+}
+
+// One output sample of the resampler with the given implementation of the convolution.
+void BM_SincConvolve(benchmark::State& state, base::SincResampler::ConvolveFunc convolve)
+{
+    const int kSize = base::SincResampler::kKernelSize;
+
+    std::unique_ptr<float[], base::AlignedFreeDeleter> input(
+        static_cast<float*>(base::alignedAlloc(sizeof(float) * (kSize + 1), 16)));
+    std::unique_ptr<float[], base::AlignedFreeDeleter> kernel(
+        static_cast<float*>(base::alignedAlloc(sizeof(float) * kSize * 2, 16)));
+
+    for (int i = 0; i < kSize + 1; ++i)
+        input[i] = std::sin(static_cast<float>(i));
+    for (int i = 0; i < kSize * 2; ++i)
+        kernel[i] = std::cos(static_cast<float>(i)) / kSize;
+
+    // The input is usually unaligned.
+    const float* input_ptr = input.get() + 1;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(convolve(input_ptr, kernel.get(), kernel.get() + kSize, 0.3));
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Resamples 10 ms of audio from 44.1 kHz to 48 kHz for |state.range(0)| channels.
+void BM_MultiChannelResampler(benchmark::State& state)
+{
+    const int channels = static_cast<int>(state.range(0));
+
+    std::unique_ptr<base::AudioBus> input = base::AudioBus::Create(
+        channels, base::SincResampler::kDefaultRequestSize);
+    fillBus(input.get());
+
+    base::MultiChannelResampler resampler(
+        channels, 44100.0 / 48000.0, base::SincResampler::kDefaultRequestSize,
+        [&input](int /* frame_delay */, base::AudioBus* audio_bus)
+    {
+        input->CopyTo(audio_bus);
+    });
+
+    std::unique_ptr<base::AudioBus> output = base::AudioBus::Create(channels, kFrames);
+
+    for (auto _ : state)
+    {
+        resampler.Resample(kFrames, output.get());
+        benchmark::DoNotOptimize(output->channel(0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * kFrames * channels);
+}
+
+// Converts 10 ms of 16-bit interleaved audio to the bus and back, as the Opus encoder does with
+// the resampled audio.
+void BM_AudioBusInterleave(benchmark::State& state)
+{
+    const int channels = static_cast<int>(state.range(0));
+
+    std::unique_ptr<base::AudioBus> bus = base::AudioBus::Create(channels, kFrames);
+    fillBus(bus.get());
+
+    std::vector<int16_t> samples(kFrames * channels);
+
+    for (auto _ : state)
+    {
+        bus->ToInterleaved<base::SignedInt16SampleTypeTraits>(kFrames, samples.data());
+        bus->FromInterleaved<base::SignedInt16SampleTypeTraits>(samples.data(), kFrames);
+        benchmark::DoNotOptimize(bus->channel(0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * kFrames * channels);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_SincConvolve, c, base::SincResampler::Convolve_C);
+#if defined(ARCH_CPU_X86_FAMILY)
+BENCHMARK_CAPTURE(BM_SincConvolve, sse, base::SincResampler::Convolve_SSE);
+BENCHMARK_CAPTURE(BM_SincConvolve, selected, base::SincResampler::convolveFunction());
+#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+BENCHMARK_CAPTURE(BM_SincConvolve, neon, base::SincResampler::Convolve_NEON);
+#endif // defined(ARCH_CPU_*)
+
+BENCHMARK(BM_MultiChannelResampler)->Arg(2)->Arg(6)->Arg(8);
+BENCHMARK(BM_AudioBusInterleave)->Arg(2)->Arg(6)->Arg(8);
+
+} // namespace benchmarks
@@ -0,0 +1,107 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/strings/string_number_conversions.h"
+#include "benchmarks/frame_sequence.h"
+
+#include <benchmark/benchmark.h>
+
+#include <iostream>
+
+namespace {
+
+const int kDefaultRecordFrames = 30;
+const int kDefaultRecordIntervalMs = 33;
+
+void showHelp()
+{
+    std::cout << "aspia_benchmarks [switch] [benchmark options]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--frames=<file>" << '\t' << "Use the frames of a trace" << std::endl
+        << '\t' << "--record=<file>" << '\t' << "Record a frame sequence from the screen"
+        << std::endl
+        << '\t' << "--record_frames=<count>" << '\t' << "Number of frames to record" << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+int recordFrames(const base::CommandLine& command_line)
+{
+    int frame_count = kDefaultRecordFrames;
+
+    if (command_line.hasSwitch(u"record_frames"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"record_frames"), &frame_count) ||
+            frame_count <= 0)
+        {
+            std::cout << "Invalid number of frames." << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Recording " << frame_count << " frames. Use the desktop as usual." << std::endl;
+
+    std::unique_ptr<benchmarks::FrameSequence> sequence =
+        benchmarks::FrameSequence::record(frame_count, kDefaultRecordIntervalMs);
+    if (!sequence || !sequence->save(command_line.switchValuePath(u"record")))
+    {
+        std::cout << "Failed to record the frame sequence." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Recorded " << sequence->count() << " frames." << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    base::LoggingSettings logging_settings;
+    logging_settings.min_log_level = base::LOG_LS_WARNING;
+    base::initLogging(logging_settings);
+
+    base::ScopedCryptoInitializer crypto_initializer;
+
+    // The switches of the benchmark library are removed from the arguments.
+    benchmark::Initialize(&argc, argv);
+
+    base::CommandLine command_line(argc, argv);
+    int result = 0;
+
+    if (command_line.hasSwitch(u"help"))
+    {
+        showHelp();
+    }
+    else if (command_line.hasSwitch(u"record"))
+    {
+        result = recordFrames(command_line);
+    }
+    else
+    {
+        if (command_line.hasSwitch(u"frames"))
+            benchmarks::FrameSequence::setCurrentPath(command_line.switchValuePath(u"frames"));
+
+        benchmark::RunSpecifiedBenchmarks();
+    }
+
+    base::shutdownLogging();
+    return result;
+}
@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/buffer.h"
+#include "base/memory/byte_array.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+
+namespace benchmarks {
+
+namespace {
+
+// A buffer of the frame size is allocated and then filled, as the encoders do with the planes of
+// the image after a size change. The byte array is filled with zeros by resize() first.
+void BM_ByteArrayResizeAndFill(benchmark::State& state)
+{
+    const size_t size = static_cast<size_t>(state.range(0)) * state.range(1) * 4;
+
+    for (auto _ : state)
+    {
+        base::ByteArray buffer;
+        buffer.resize(size);
+        memset(buffer.data(), 128, buffer.size());
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void BM_BufferResizeAndFill(benchmark::State& state)
+{
+    const size_t size = static_cast<size_t>(state.range(0)) * state.range(1) * 4;
+
+    for (auto _ : state)
+    {
+        base::Buffer buffer;
+        buffer.resize(size);
+        memset(buffer.data(), 128, buffer.size());
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+} // namespace
+
+BENCHMARK(BM_ByteArrayResizeAndFill)
+    ->Args({ 1920, 1080 })
+    ->Args({ 3840, 2160 })
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_BufferResizeAndFill)
+    ->Args({ 1920, 1080 })
+    ->Args({ 3840, 2160 })
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace benchmarks
@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/logging.h"
+#include "client/config_factory.h"
+#include "client/ui/application.h"
+#include "client/ui/qt_desktop_window.h"
+#include "client/ui/qt_file_manager_window.h"
+
+#include <benchmark/benchmark.h>
+
+#include <QCoreApplication>
+
+// Measures the work done by the client on the UI thread from the start of the process up to the
+// moment the session window can be shown. The windows are not shown, so the benchmark also works
+// with the "offscreen" platform plugin.
+
+namespace benchmarks {
+
+namespace {
+
+void installTranslators(benchmark::State& state, const char* locale)
+{
+    client::Application* application = client::Application::instance();
+
+    for (auto _ : state)
+    {
+        application->setLocale(QString::fromLatin1(locale));
+        application->setLocale(QStringLiteral("en"));
+    }
+}
+
+void createDesktopWindow(benchmark::State& state)
+{
+    const proto::DesktopConfig config = client::ConfigFactory::defaultDesktopManageConfig();
+
+    for (auto _ : state)
+    {
+        std::unique_ptr<client::QtDesktopWindow> window =
+            std::make_unique<client::QtDesktopWindow>(proto::SESSION_TYPE_DESKTOP_MANAGE, config);
+        benchmark::DoNotOptimize(window.get());
+    }
+}
+
+// The window itself is created before the connection is started. Its panels are created later,
+// when the connection is already in progress.
+void createFileManagerWindow(benchmark::State& state)
+{
+    const bool create_ui = state.range(0) != 0;
+
+    for (auto _ : state)
+    {
+        std::unique_ptr<client::QtFileManagerWindow> window =
+            std::make_unique<client::QtFileManagerWindow>();
+
+        if (create_ui)
+            QCoreApplication::processEvents();
+
+        benchmark::DoNotOptimize(window.get());
+    }
+
+    state.SetLabel(create_ui ? "with panels" : "window only");
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(installTranslators, ru, "ru")->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(installTranslators, de, "de")->Unit(benchmark::kMicrosecond);
+BENCHMARK(createDesktopWindow)->Unit(benchmark::kMicrosecond);
+BENCHMARK(createFileManagerWindow)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+} // namespace benchmarks
+
+int main(int argc, char** argv)
+{
+    // The windows are never shown. A display is not required.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    Q_INIT_RESOURCE(qt_translations);
+    Q_INIT_RESOURCE(client);
+    Q_INIT_RESOURCE(client_translations);
+    Q_INIT_RESOURCE(common);
+    Q_INIT_RESOURCE(common_translations);
+
+    client::Application application(argc, argv);
+
+    // The switches of the benchmark library are removed from the arguments.
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
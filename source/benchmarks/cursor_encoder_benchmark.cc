@@ -0,0 +1,109 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/cursor_encoder.h"
+#include "base/desktop/mouse_cursor.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+const int kShapeCount = 8;
+
+// More than the size of the encoder cache. With FIFO eviction none of the cursors is found in
+// the cache when they are encoded in turn.
+const int kUniqueShapeCount = 40;
+
+// Generates |count| different cursors of |size| x |size| pixels with a transparent area around an
+// arrow-like opaque shape.
+std::vector<base::MouseCursor> createCursors(int size, int count)
+{
+    std::vector<base::MouseCursor> cursors;
+
+    for (int i = 0; i < count; ++i)
+    {
+        base::ByteArray image(size * size * sizeof(uint32_t));
+        uint32_t* pixels = reinterpret_cast<uint32_t*>(image.data());
+
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x <= y && x < size; ++x)
+            {
+                const bool border = (x == 0 || x == y || y == size - 1);
+                pixels[y * size + x] = border ? 0xFF000000 : (0xFFFFFFFF - i * 0x00030303);
+            }
+        }
+
+        cursors.emplace_back(std::move(image), base::Size(size, size), base::Point(0, 0));
+    }
+
+    return cursors;
+}
+
+// Encodes the same few cursors again and again. After the first round all of them are sent as
+// the references of the cache.
+void BM_CursorEncoderCached(benchmark::State& state)
+{
+    const std::vector<base::MouseCursor> cursors =
+        createCursors(static_cast<int>(state.range(0)), kShapeCount);
+
+    base::CursorEncoder encoder;
+    proto::CursorShape shape;
+    size_t index = 0;
+
+    for (auto _ : state)
+    {
+        shape.Clear();
+        benchmark::DoNotOptimize(encoder.encode(cursors[index], &shape));
+        index = (index + 1) % cursors.size();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Every cursor is missing in the cache of the encoder, so every one of them is compressed.
+void BM_CursorEncoderCompress(benchmark::State& state)
+{
+    const std::vector<base::MouseCursor> cursors =
+        createCursors(static_cast<int>(state.range(0)), kUniqueShapeCount);
+
+    base::CursorEncoder encoder;
+    proto::CursorShape shape;
+    size_t index = 0;
+
+    for (auto _ : state)
+    {
+        shape.Clear();
+        benchmark::DoNotOptimize(encoder.encode(cursors[index], &shape));
+        index = (index + 1) % cursors.size();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_CursorEncoderCached)->Arg(32)->Arg(64)->Arg(128);
+BENCHMARK(BM_CursorEncoderCompress)->Arg(32)->Arg(64)->Arg(128);
+
+} // namespace benchmarks
@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/differ.h"
+#include "benchmarks/frame_sequence.h"
+
+#include <benchmark/benchmark.h>
+
+namespace benchmarks {
+
+namespace {
+
+// Compares every pair of the neighbouring frames of the sequence in full.
+void BM_DifferFull(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+    base::Differ differ(sequence.size(), static_cast<int>(state.range(0)));
+    base::Region region;
+    int index = 1;
+
+    for (auto _ : state)
+    {
+        region.clear();
+        differ.calcDirtyRegion(sequence.frame(index - 1)->frameData(),
+                               sequence.frame(index)->frameData(),
+                               &region);
+        benchmark::DoNotOptimize(region);
+
+        if (++index >= sequence.count())
+            index = 1;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * sequence.size().width() *
+                            sequence.size().height() * base::Frame::kBytesPerPixel);
+}
+
+// Compares only the blocks of the region reported by the capturer, as the capturers with the
+// dirty rects from the OS do.
+void BM_DifferHint(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+    base::Differ differ(sequence.size(), static_cast<int>(state.range(0)));
+    base::Region region;
+    int index = 1;
+
+    for (auto _ : state)
+    {
+        const base::Frame* frame = sequence.frame(index);
+
+        region.clear();
+        differ.calcDirtyRegion(sequence.frame(index - 1)->frameData(),
+                               frame->frameData(),
+                               frame->constUpdatedRegion(),
+                               &region);
+        benchmark::DoNotOptimize(region);
+
+        if (++index >= sequence.count())
+            index = 1;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_DifferFull)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_DifferHint)->Arg(1)->Arg(4)->UseRealTime();
+
+} // namespace benchmarks
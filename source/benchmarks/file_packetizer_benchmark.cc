@@ -0,0 +1,111 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_packetizer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+// Creates a temporary file of |size| bytes of random data that is removed on destruction.
+class TemporaryFile
+{
+public:
+    explicit TemporaryFile(int64_t size)
+    {
+        std::error_code error_code;
+        path_ = std::filesystem::temp_directory_path(error_code);
+        path_ /= "aspia_benchmark_" + std::to_string(size) + ".bin";
+
+        std::ofstream stream(path_, std::ofstream::binary | std::ofstream::trunc);
+        std::mt19937 random(static_cast<uint32_t>(size));
+        std::vector<uint32_t> block(64 * 1024);
+
+        for (int64_t written = 0; written < size;)
+        {
+            for (auto& value : block)
+                value = random();
+
+            const int64_t block_size = std::min(
+                size - written, static_cast<int64_t>(block.size() * sizeof(uint32_t)));
+
+            stream.write(reinterpret_cast<const char*>(block.data()), block_size);
+            written += block_size;
+        }
+    }
+
+    ~TemporaryFile()
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove(path_, ignored_code);
+    }
+
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+
+    DISALLOW_COPY_AND_ASSIGN(TemporaryFile);
+};
+
+// Reads the whole file of |state.range(0)| bytes packet by packet, as the file transfer does.
+// |state.range(1)| is the requested packet size (0 for the default size).
+void BM_FilePacketizer(benchmark::State& state)
+{
+    TemporaryFile file(state.range(0));
+    proto::FilePacketRequest request;
+    request.set_flags(proto::FilePacketRequest::NO_FLAGS);
+    request.set_packet_size(static_cast<uint32_t>(state.range(1)));
+
+    for (auto _ : state)
+    {
+        std::unique_ptr<common::FilePacketizer> packetizer =
+            common::FilePacketizer::create(file.path());
+        if (!packetizer)
+        {
+            state.SkipWithError("Unable to open file");
+            break;
+        }
+
+        while (true)
+        {
+            std::unique_ptr<proto::FilePacket> packet = packetizer->readNextPacket(request);
+            if (!packet || (packet->flags() & proto::FilePacket::LAST_PACKET))
+                break;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_FilePacketizer)
+    ->Args({ 64 * 1024, 0 })
+    ->Args({ 16 * 1024 * 1024, 0 })
+    ->Args({ 16 * 1024 * 1024, 1024 * 1024 })
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace benchmarks
@@ -0,0 +1,406 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "benchmarks/frame_sequence.h"
+
+#include "base/logging.h"
+#include "base/system_time.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/desktop/frame_trace_reader.h"
+#include "base/desktop/frame_trace_writer.h"
+#include "base/desktop/mouse_cursor.h"
+#include "base/desktop/screen_capturer_wrapper.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+namespace benchmarks {
+
+namespace {
+
+const size_t kAlignment = 32;
+const int kMaxFrameCount = 1000;
+
+const int kDefaultSyntheticFrameCount = 60;
+const base::Size kDefaultSyntheticSize(1920, 1080);
+
+std::filesystem::path g_current_path;
+
+void fillRect(base::Frame* frame, const base::Rect& rect, uint32_t color)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+        std::fill(row, row + rect.width(), color);
+    }
+}
+
+// Draws the rows of pseudo text in |rect|. |first_line| is the index of the top line of text, so
+// that the contents of a scrolled page is shifted without changing.
+void drawText(base::Frame* frame, const base::Rect& rect, int first_line)
+{
+    static const int kLineHeight = 16;
+    static const int kGlyphWidth = 8;
+
+    fillRect(frame, rect, 0xFFFFFFFF);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const int line = first_line + (y - rect.top()) / kLineHeight;
+        const int line_y = (y - rect.top()) % kLineHeight;
+
+        if (line_y < 3 || line_y > 12)
+            continue;
+
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const uint32_t glyph = static_cast<uint32_t>(line * 131 + (x / kGlyphWidth) * 17);
+            const int glyph_x = x % kGlyphWidth;
+
+            // Spaces between the words and a bit of the antialiasing at the glyph edges.
+            if (glyph % 7 == 0 || glyph_x == 0)
+                continue;
+
+            if (((glyph >> (glyph_x + line_y)) & 1) != 0)
+                row[x] = (glyph_x == 1 || glyph_x == kGlyphWidth - 1) ? 0xFF808080 : 0xFF202020;
+        }
+    }
+}
+
+class Recorder : public base::ScreenCapturerWrapper::Delegate
+{
+public:
+    Recorder() = default;
+
+    // ScreenCapturerWrapper::Delegate implementation.
+    void onScreenListChanged(const base::ScreenCapturer::ScreenList& /* screens */,
+                             base::ScreenCapturer::ScreenId /* current_screen */,
+                             const base::ScreenCapturer::ScreenList& /* windows */,
+                             base::ScreenCapturer::ScreenId /* current_window */) override
+    {
+        // Nothing
+    }
+
+    void onScreenCaptured(const base::Frame* frame,
+                          const base::MouseCursor* /* mouse_cursor */) override
+    {
+        frame_ = frame;
+    }
+
+    const base::Frame* takeFrame()
+    {
+        const base::Frame* frame = frame_;
+        frame_ = nullptr;
+        return frame;
+    }
+
+private:
+    const base::Frame* frame_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(Recorder);
+};
+
+} // namespace
+
+FrameSequence::FrameSequence(const base::Size& size)
+    : size_(size)
+{
+    // Nothing
+}
+
+FrameSequence::~FrameSequence() = default;
+
+// static
+std::unique_ptr<FrameSequence> FrameSequence::load(const std::filesystem::path& file_path)
+{
+    std::unique_ptr<base::FrameTraceReader> reader = base::FrameTraceReader::open(file_path);
+    if (!reader)
+        return nullptr;
+
+    std::unique_ptr<FrameSequence> sequence;
+
+    while (const base::Frame* frame = reader->readFrame())
+    {
+        if (!sequence)
+        {
+            sequence.reset(new FrameSequence(frame->size()));
+        }
+        else if (frame->size() != sequence->size())
+        {
+            LOG(LS_WARNING) << "Frame size changed. Only the first " << sequence->count()
+                            << " frames are used";
+            break;
+        }
+
+        if (sequence->count() >= kMaxFrameCount)
+        {
+            LOG(LS_WARNING) << "Only the first " << kMaxFrameCount << " frames are used";
+            break;
+        }
+
+        sequence->addFrame(*frame, frame->constUpdatedRegion());
+    }
+
+    if (reader->hasError() || !sequence)
+    {
+        LOG(LS_WARNING) << "Unable to load frames from " << file_path;
+        return nullptr;
+    }
+
+    LOG(LS_INFO) << "Loaded " << sequence->count() << " frames (" << sequence->size() << ") from "
+                 << file_path;
+    return sequence;
+}
+
+// static
+std::unique_ptr<FrameSequence> FrameSequence::createSynthetic(
+    const base::Size& size, int frame_count)
+{
+    DCHECK(!size.isEmpty());
+    DCHECK_GT(frame_count, 0);
+
+    std::unique_ptr<FrameSequence> sequence(new FrameSequence(size));
+    std::unique_ptr<base::Frame> source = base::FrameAligned::create(size, kAlignment);
+
+    const base::Rect frame_rect = base::Rect::makeSize(size);
+
+    // Desktop background with a smooth gradient.
+    for (int y = 0; y < size.height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(source->frameDataAtPos(0, y));
+        for (int x = 0; x < size.width(); ++x)
+        {
+            const uint32_t blue = static_cast<uint32_t>(96 + (x * 64) / size.width());
+            const uint32_t green = static_cast<uint32_t>(64 + (y * 64) / size.height());
+            row[x] = 0xFF000000 | (32 << 16) | (green << 8) | blue;
+        }
+    }
+
+    const base::Rect editor_rect =
+        base::Rect::makeLTRB(0, 0, size.width() / 2, size.height() * 3 / 4);
+    const base::Rect page_rect =
+        base::Rect::makeLTRB(size.width() / 2, 0, size.width(), size.height());
+
+    drawText(source.get(), editor_rect, 0);
+    drawText(source.get(), page_rect, 1000);
+
+    sequence->addFrame(*source, base::Region(frame_rect));
+
+    std::mt19937 random(frame_count);
+    base::Rect window_rect = base::Rect::makeXYWH(32, size.height() * 3 / 4 - 64, 400, 240);
+    base::Point cursor(editor_rect.left() + 8, editor_rect.top() + 16);
+    int page_line = 1000;
+
+    for (int i = 1; i < frame_count; ++i)
+    {
+        base::Region region;
+
+        switch (i % 3)
+        {
+            case 0:
+            {
+                // Typing: a few glyphs appear at the cursor.
+                const int glyphs = 1 + static_cast<int>(random() % 3);
+                base::Rect rect = base::Rect::makeXYWH(cursor.x(), cursor.y(), glyphs * 8, 16);
+                rect.intersectWith(editor_rect);
+
+                if (!rect.isEmpty())
+                {
+                    fillRect(source.get(), rect, 0xFFFFFFFF);
+                    fillRect(source.get(), base::Rect::makeXYWH(
+                        rect.left() + 1, rect.top() + 4, rect.width() - 2, 8), 0xFF202020);
+                    region.addRect(rect);
+                }
+
+                cursor.translate(glyphs * 8, 0);
+                if (cursor.x() + 24 >= editor_rect.right())
+                {
+                    cursor = base::Point(editor_rect.left() + 8, cursor.y() + 16);
+                    if (cursor.y() + 16 >= editor_rect.bottom())
+                        cursor = base::Point(cursor.x(), editor_rect.top() + 16);
+                }
+            }
+            break;
+
+            case 1:
+            {
+                // Scrolling of the page by three lines.
+                page_line += 3;
+                drawText(source.get(), page_rect, page_line);
+                region.addRect(page_rect);
+            }
+            break;
+
+            default:
+            {
+                // Dragging of a window.
+                base::Rect new_rect = window_rect;
+                new_rect.translate(12, (i % 2) ? 4 : -4);
+
+                if (!frame_rect.containsRect(new_rect))
+                    new_rect = base::Rect::makeXYWH(32, window_rect.top(), 400, 240);
+
+                fillRect(source.get(), window_rect, 0xFF406080);
+                fillRect(source.get(), new_rect, 0xFFE0E0E0);
+                fillRect(source.get(), base::Rect::makeXYWH(
+                    new_rect.left(), new_rect.top(), new_rect.width(), 24), 0xFF3070C0);
+
+                region.addRect(window_rect);
+                region.addRect(new_rect);
+                window_rect = new_rect;
+            }
+            break;
+        }
+
+        region.intersectWith(frame_rect);
+        sequence->addFrame(*source, region);
+    }
+
+    return sequence;
+}
+
+// static
+std::unique_ptr<FrameSequence> FrameSequence::record(int frame_count, int interval_ms)
+{
+    DCHECK_GT(frame_count, 0);
+
+    std::unique_ptr<FrameSequence> sequence;
+    Recorder recorder;
+    base::ScreenCapturerWrapper capturer(base::ScreenCapturer::Type::DEFAULT, &recorder);
+
+    while (!sequence || sequence->count() < frame_count)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+
+        const int64_t capture_time = base::SystemTime::microsecondsSinceEpoch();
+        capturer.captureFrame();
+        const int64_t diff_time = base::SystemTime::microsecondsSinceEpoch();
+
+        const base::Frame* frame = recorder.takeFrame();
+        if (!frame)
+            continue;
+
+        if (!sequence)
+        {
+            sequence.reset(new FrameSequence(frame->size()));
+            sequence->addFrame(*frame, base::Region(base::Rect::makeSize(frame->size())));
+            sequence->frames_.back()->setCaptureTime(capture_time);
+            sequence->frames_.back()->setDiffTime(diff_time);
+            continue;
+        }
+
+        if (frame->size() != sequence->size())
+        {
+            LOG(LS_WARNING) << "Screen size changed. Recording stopped";
+            break;
+        }
+
+        if (frame->constUpdatedRegion().isEmpty())
+            continue;
+
+        sequence->addFrame(*frame, frame->constUpdatedRegion());
+        sequence->frames_.back()->setCaptureTime(capture_time);
+        sequence->frames_.back()->setDiffTime(diff_time);
+    }
+
+    return sequence;
+}
+
+bool FrameSequence::save(const std::filesystem::path& file_path) const
+{
+    std::unique_ptr<base::FrameTraceWriter> writer = base::FrameTraceWriter::create(file_path);
+    if (!writer)
+        return false;
+
+    for (const auto& frame : frames_)
+    {
+        if (!writer->writeFrame(*frame))
+            return false;
+    }
+
+    return true;
+}
+
+// static
+const FrameSequence& FrameSequence::current()
+{
+    static std::unique_ptr<FrameSequence> sequence = []()
+    {
+        std::unique_ptr<FrameSequence> result;
+
+        if (!g_current_path.empty())
+            result = load(g_current_path);
+
+        if (!result)
+            result = createSynthetic(kDefaultSyntheticSize, kDefaultSyntheticFrameCount);
+
+        return result;
+    }();
+
+    return *sequence;
+}
+
+// static
+void FrameSequence::setCurrentPath(const std::filesystem::path& file_path)
+{
+    g_current_path = file_path;
+}
+
+int64_t FrameSequence::updatedArea() const
+{
+    int64_t area = 0;
+
+    for (size_t i = 1; i < frames_.size(); ++i)
+    {
+        for (base::Region::Iterator it(frames_[i]->constUpdatedRegion()); !it.isAtEnd();
+             it.advance())
+        {
+            area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+        }
+    }
+
+    return area;
+}
+
+void FrameSequence::addFrame(const base::Frame& source, const base::Region& region)
+{
+    std::unique_ptr<base::Frame> frame = base::FrameAligned::create(size_, kAlignment);
+
+    if (frames_.empty())
+    {
+        frame->copyPixelsFrom(source, base::Point(0, 0), base::Rect::makeSize(size_));
+    }
+    else
+    {
+        const base::Frame* last = frames_.back().get();
+        frame->copyPixelsFrom(*last, base::Point(0, 0), base::Rect::makeSize(size_));
+
+        for (base::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            frame->copyPixelsFrom(source, it.rect().topLeft(), it.rect());
+    }
+
+    frame->setCaptureTime(source.captureTime());
+    frame->setDiffTime(source.diffTime());
+    *frame->updatedRegion() = region;
+    frames_.emplace_back(std::move(frame));
+}
+
+} // namespace benchmarks
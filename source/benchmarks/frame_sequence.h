@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BENCHMARKS__FRAME_SEQUENCE_H
+#define BENCHMARKS__FRAME_SEQUENCE_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/frame.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace benchmarks {
+
+// Sequence of desktop frames used as the input of the capture and encode benchmarks. Every frame
+// holds the full image of the screen and the region that was changed since the previous frame.
+// On disk the sequence is stored as a frame trace (see base::FrameTraceWriter), so the traces
+// recorded by the host can be used as well.
+class FrameSequence
+{
+public:
+    ~FrameSequence();
+
+    // Loads the sequence from the trace |file_path|. Only the frames before the first change of
+    // the screen size are used. Returns nullptr if the trace cannot be read.
+    static std::unique_ptr<FrameSequence> load(const std::filesystem::path& file_path);
+
+    // Generates |frame_count| frames that imitate typing in a text editor, scrolling of a page
+    // and moving of a window. Used when no recorded sequence is given.
+    static std::unique_ptr<FrameSequence> createSynthetic(const base::Size& size, int frame_count);
+
+    // Records |frame_count| frames from the screen with an interval of |interval_ms| between them.
+    // Frames without changes are skipped.
+    static std::unique_ptr<FrameSequence> record(int frame_count, int interval_ms);
+
+    bool save(const std::filesystem::path& file_path) const;
+
+    // The sequence used by the benchmarks. See setCurrentPath().
+    static const FrameSequence& current();
+
+    // Sets the file from which current() loads the sequence. If the path is empty or the file
+    // cannot be loaded, a synthetic sequence is used.
+    static void setCurrentPath(const std::filesystem::path& file_path);
+
+    const base::Size& size() const { return size_; }
+    int count() const { return static_cast<int>(frames_.size()); }
+    const base::Frame* frame(int index) const { return frames_[index].get(); }
+
+    // Total area in pixels of the updated regions of all frames except the first one.
+    int64_t updatedArea() const;
+
+private:
+    explicit FrameSequence(const base::Size& size);
+
+    // Appends a frame that is a copy of the last frame with |region| copied from |source|.
+    void addFrame(const base::Frame& source, const base::Region& region);
+
+    base::Size size_;
+    std::vector<std::unique_ptr<base::Frame>> frames_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameSequence);
+};
+
+} // namespace benchmarks
+
+#endif // BENCHMARKS__FRAME_SEQUENCE_H
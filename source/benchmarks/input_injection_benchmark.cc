@@ -0,0 +1,188 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array.h"
+#include "common/keycode_converter.h"
+#include "host/input_injector.h"
+#include "proto/desktop.pb.h"
+#include "proto/desktop_internal.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+// Letters, digits, space, enter and both shifts, as in typing.
+std::vector<uint32_t> typingKeycodes()
+{
+    std::vector<uint32_t> keycodes;
+
+    for (uint32_t keycode = 0x070004; keycode <= 0x070027; ++keycode)
+        keycodes.push_back(keycode);
+
+    keycodes.push_back(0x070028); // Enter.
+    keycodes.push_back(0x07002c); // Space.
+    keycodes.push_back(0x0700e1); // ShiftLeft.
+    keycodes.push_back(0x0700e5); // ShiftRight.
+
+    return keycodes;
+}
+
+// Converts the keycodes like the injector of the host, without injecting them into the system.
+class ConvertingInjector : public host::InputInjector
+{
+public:
+    ConvertingInjector() = default;
+
+    // host::InputInjector implementation.
+    void setScreenOffset(const base::Point& /* offset */) override
+    {
+        // Nothing
+    }
+
+    void setBlockInput(bool /* enable */) override
+    {
+        // Nothing
+    }
+
+    void injectKeyEvent(const proto::KeyEvent& event) override
+    {
+        int native_keycode =
+            common::KeycodeConverter::usbKeycodeToNativeKeycode(event.usb_keycode());
+        if (native_keycode != common::KeycodeConverter::invalidNativeKeycode())
+            pending_.push_back(native_keycode);
+    }
+
+    void injectMouseEvent(const proto::MouseEvent& /* event */) override
+    {
+        // Nothing
+    }
+
+    void flush() override
+    {
+        injected_ += pending_.size();
+        pending_.clear();
+    }
+
+    size_t injected() const { return injected_; }
+
+private:
+    std::vector<int> pending_;
+    size_t injected_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ConvertingInjector);
+};
+
+// Converts the USB keycodes to the native ones (the host side) and the native keycodes back to
+// the USB ones (the client side).
+void BM_KeycodeConversion(benchmark::State& state)
+{
+    const std::vector<uint32_t> keycodes = typingKeycodes();
+
+    std::vector<int> native_keycodes;
+    for (const auto& keycode : keycodes)
+        native_keycodes.push_back(common::KeycodeConverter::usbKeycodeToNativeKeycode(keycode));
+
+    for (auto _ : state)
+    {
+        uint32_t sum = 0;
+
+        for (const auto& keycode : keycodes)
+            sum += static_cast<uint32_t>(
+                common::KeycodeConverter::usbKeycodeToNativeKeycode(keycode));
+
+        for (const auto& native_keycode : native_keycodes)
+            sum += common::KeycodeConverter::nativeKeycodeToUsbKeycode(native_keycode);
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(keycodes.size()) * 2);
+}
+
+// The path of |range(0)| key events through the host: the message of the client is parsed, the
+// event is forwarded to the desktop agent over the IPC, the agent parses it and injects it. The
+// injector is flushed once for all the events, as the agent does for the events of one read.
+void BM_KeyInjectionPath(benchmark::State& state)
+{
+    const std::vector<uint32_t> keycodes = typingKeycodes();
+    const size_t event_count = static_cast<size_t>(state.range(0));
+
+    std::vector<base::ByteArray> client_messages;
+    client_messages.reserve(event_count);
+
+    for (size_t i = 0; i < event_count; ++i)
+    {
+        proto::ClientToHost message;
+        proto::KeyEvent* event = message.mutable_key_event();
+
+        event->set_usb_keycode(keycodes[(i / 2) % keycodes.size()]);
+        event->set_flags(((i % 2) == 0) ? proto::KeyEvent::PRESSED : 0);
+
+        client_messages.emplace_back(base::serialize(message));
+    }
+
+    proto::ClientToHost incoming_message;
+    proto::internal::ServiceToDesktop outgoing_message;
+    proto::internal::ServiceToDesktop agent_message;
+    base::ByteArray ipc_buffer;
+    ConvertingInjector injector;
+
+    for (auto _ : state)
+    {
+        for (const auto& client_message : client_messages)
+        {
+            if (!base::parse(client_message, &incoming_message))
+            {
+                state.SkipWithError("Unable to parse the message of the client");
+                return;
+            }
+
+            outgoing_message.Clear();
+            outgoing_message.mutable_key_event()->CopyFrom(incoming_message.key_event());
+            base::serialize(outgoing_message, &ipc_buffer);
+
+            if (!base::parse(ipc_buffer, &agent_message))
+            {
+                state.SkipWithError("Unable to parse the message of the service");
+                return;
+            }
+
+            injector.injectKeyEvent(agent_message.key_event());
+        }
+
+        injector.flush();
+    }
+
+    benchmark::DoNotOptimize(injector.injected());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(event_count));
+}
+
+} // namespace
+
+BENCHMARK(BM_KeycodeConversion);
+
+BENCHMARK(BM_KeyInjectionPath)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256);
+
+} // namespace benchmarks
@@ -0,0 +1,112 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crypto/message_encryptor_openssl.h"
+
+#include <benchmark/benchmark.h>
+
+namespace benchmarks {
+
+namespace {
+
+enum Cipher
+{
+    AES256_GCM = 0,
+    CHACHA20_POLY1305 = 1
+};
+
+std::unique_ptr<base::MessageEncryptor> createEncryptor(int cipher)
+{
+    const base::ByteArray key(32, 0x5c);
+    const base::ByteArray iv(12, 0xee);
+
+    if (cipher == AES256_GCM)
+        return base::MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+
+    return base::MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+}
+
+// Encrypts messages of |state.range(1)| bytes into a separate buffer.
+void BM_MessageEncryptor(benchmark::State& state)
+{
+    std::unique_ptr<base::MessageEncryptor> encryptor =
+        createEncryptor(static_cast<int>(state.range(0)));
+    if (!encryptor)
+    {
+        state.SkipWithError("Unable to create encryptor");
+        return;
+    }
+
+    const base::ByteArray message(static_cast<size_t>(state.range(1)), 0xa5);
+    base::ByteArray encrypted(encryptor->encryptedDataSize(message.size()));
+
+    for (auto _ : state)
+    {
+        if (!encryptor->encrypt(message.data(), message.size(), encrypted.data()))
+        {
+            state.SkipWithError("Encryption failed");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(1));
+}
+
+// Encrypts messages of |state.range(1)| bytes in place, as the network channel does.
+void BM_MessageEncryptorInPlace(benchmark::State& state)
+{
+    std::unique_ptr<base::MessageEncryptor> encryptor =
+        createEncryptor(static_cast<int>(state.range(0)));
+    if (!encryptor)
+    {
+        state.SkipWithError("Unable to create encryptor");
+        return;
+    }
+
+    base::ByteArray message(static_cast<size_t>(state.range(1)), 0xa5);
+    base::ByteArray tag(encryptor->encryptedDataSize(message.size()) - message.size());
+
+    for (auto _ : state)
+    {
+        if (!encryptor->encryptInPlace(message.data(), message.size(), tag.data()))
+        {
+            state.SkipWithError("Encryption failed");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(1));
+}
+
+void cipherArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "cipher", "size" });
+
+    for (int cipher : { AES256_GCM, CHACHA20_POLY1305 })
+    {
+        for (int size : { 64, 1024, 16 * 1024, 256 * 1024 })
+            benchmark->Args({ cipher, size });
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_MessageEncryptor)->Apply(cipherArguments);
+BENCHMARK(BM_MessageEncryptorInPlace)->Apply(cipherArguments);
+
+} // namespace benchmarks
@@ -0,0 +1,210 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/task_runner.h"
+#include "base/message_loop/incoming_task_queue.h"
+#include "base/threading/thread.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+const int kTasksPerProducer = 10000;
+
+// The queue of the message loop before IncomingTaskQueue, kept for comparison.
+class LockedTaskQueue
+{
+public:
+    bool push(base::PendingTask&& pending_task)
+    {
+        std::scoped_lock lock(lock_);
+
+        const bool empty = queue_.empty();
+        queue_.emplace(std::move(pending_task));
+        return empty;
+    }
+
+    bool takeAll(base::TaskQueue* queue)
+    {
+        std::scoped_lock lock(lock_);
+
+        if (queue_.empty())
+            return false;
+
+        queue_.Swap(queue);
+        return true;
+    }
+
+private:
+    std::mutex lock_;
+    base::TaskQueue queue_;
+};
+
+// The producers post the tasks while the benchmark thread takes and runs them, as the thread of
+// a message loop does.
+template <class Queue>
+void postAndRun(benchmark::State& state)
+{
+    const int producer_count = static_cast<int>(state.range(0));
+    const int total_count = producer_count * kTasksPerProducer;
+
+    for (auto _ : state)
+    {
+        Queue incoming_queue;
+        int executed = 0;
+
+        std::vector<std::thread> producers;
+        for (int i = 0; i < producer_count; ++i)
+        {
+            producers.emplace_back([&incoming_queue, &executed]()
+            {
+                for (int j = 0; j < kTasksPerProducer; ++j)
+                {
+                    incoming_queue.push(base::PendingTask(
+                        [&executed]() { ++executed; }, base::PendingTask::TimePoint(), true));
+                }
+            });
+        }
+
+        base::TaskQueue work_queue;
+
+        while (executed < total_count)
+        {
+            if (!incoming_queue.takeAll(&work_queue))
+                continue;
+
+            while (!work_queue.empty())
+            {
+                work_queue.front().callback();
+                work_queue.pop();
+            }
+        }
+
+        for (auto& producer : producers)
+            producer.join();
+    }
+
+    state.SetItemsProcessed(state.iterations() * total_count);
+}
+
+void BM_LockedTaskQueue(benchmark::State& state)
+{
+    postAndRun<LockedTaskQueue>(state);
+}
+
+void BM_IncomingTaskQueue(benchmark::State& state)
+{
+    postAndRun<base::IncomingTaskQueue>(state);
+}
+
+// Posts the tasks to a running message loop, including the wake-ups of its pump.
+void BM_MessageLoopPostTask(benchmark::State& state)
+{
+    const int producer_count = static_cast<int>(state.range(0));
+    const int total_count = producer_count * kTasksPerProducer;
+
+    base::Thread thread;
+    thread.start(base::MessageLoop::Type::ASIO);
+
+    std::shared_ptr<base::TaskRunner> task_runner = thread.taskRunner();
+
+    for (auto _ : state)
+    {
+        std::atomic<int> executed { 0 };
+
+        std::vector<std::thread> producers;
+        for (int i = 0; i < producer_count; ++i)
+        {
+            producers.emplace_back([&task_runner, &executed]()
+            {
+                for (int j = 0; j < kTasksPerProducer; ++j)
+                {
+                    task_runner->postTask([&executed]()
+                    {
+                        executed.fetch_add(1, std::memory_order_relaxed);
+                    });
+                }
+            });
+        }
+
+        for (auto& producer : producers)
+            producer.join();
+
+        while (executed.load(std::memory_order_relaxed) < total_count)
+            std::this_thread::yield();
+    }
+
+    thread.stop();
+
+    state.SetItemsProcessed(state.iterations() * total_count);
+}
+
+// Wraps a task as the sessions do it for each message: the lambda captures a pointer, a
+// shared_ptr and a value, which does not fit into the small buffer of std::function. The task is
+// moved on the way through the message loop.
+template <class Callback>
+void wrapTask(benchmark::State& state)
+{
+    std::shared_ptr<int> owner = std::make_shared<int>(0);
+    int64_t total = 0;
+    int64_t sequence_num = 0;
+
+    for (auto _ : state)
+    {
+        Callback callback = [total = &total, owner, sequence_num]()
+        {
+            *total += sequence_num;
+        };
+
+        Callback moved = std::move(callback);
+        moved();
+
+        ++sequence_num;
+    }
+
+    benchmark::DoNotOptimize(total);
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_StdFunctionTask(benchmark::State& state)
+{
+    wrapTask<std::function<void()>>(state);
+}
+
+void BM_TaskCallbackTask(benchmark::State& state)
+{
+    wrapTask<base::TaskCallback>(state);
+}
+
+} // namespace
+
+BENCHMARK(BM_StdFunctionTask);
+BENCHMARK(BM_TaskCallbackTask);
+BENCHMARK(BM_LockedTaskQueue)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_IncomingTaskQueue)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_MessageLoopPostTask)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+} // namespace benchmarks
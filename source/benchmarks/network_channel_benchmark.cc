@@ -0,0 +1,346 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/sample_window.h"
+#include "base/crypto/message_decryptor_fake.h"
+#include "base/crypto/message_decryptor_openssl.h"
+#include "base/crypto/message_encryptor_fake.h"
+#include "base/crypto/message_encryptor_openssl.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/network_channel.h"
+#include "base/net/network_server.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace benchmarks {
+
+namespace {
+
+enum Cipher
+{
+    AES256_GCM = 0,
+    CHACHA20_POLY1305 = 1,
+    NONE = 2 // Only the framing, as before the key exchange.
+};
+
+// A batch of the throughput benchmark holds about this much data.
+const size_t kBatchBytes = 16 * 1024 * 1024;
+const size_t kMaxBatchMessages = 1024;
+
+const size_t kMaxLatencySamples = 100000;
+
+using Clock = std::chrono::steady_clock;
+
+std::unique_ptr<base::MessageEncryptor> createEncryptor(int cipher, uint8_t fill)
+{
+    const base::ByteArray key(32, fill);
+    const base::ByteArray iv(12, 0xee);
+
+    if (cipher == AES256_GCM)
+        return base::MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+
+    if (cipher == CHACHA20_POLY1305)
+        return base::MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+
+    return std::make_unique<base::MessageEncryptorFake>();
+}
+
+std::unique_ptr<base::MessageDecryptor> createDecryptor(int cipher, uint8_t fill)
+{
+    const base::ByteArray key(32, fill);
+    const base::ByteArray iv(12, 0xee);
+
+    if (cipher == AES256_GCM)
+        return base::MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+
+    if (cipher == CHACHA20_POLY1305)
+        return base::MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+
+    return std::make_unique<base::MessageDecryptorFake>();
+}
+
+// Forwards the events of a channel to the callbacks of the benchmark.
+class Endpoint : public base::NetworkChannel::Listener
+{
+public:
+    std::function<void()> on_connected;
+    std::function<void()> on_disconnected;
+    std::function<void(const base::ByteArray&)> on_message;
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        if (on_connected)
+            on_connected();
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode /* error_code */) override
+    {
+        if (on_disconnected)
+            on_disconnected();
+    }
+
+    void onMessageReceived(const base::ByteArray& buffer) override
+    {
+        if (on_message)
+            on_message(buffer);
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+};
+
+// Two channels connected over the loopback interface. Both are served by the message loop of the
+// benchmark thread, which runs until a benchmark callback quits it.
+class LoopbackPair : public base::NetworkServer::Delegate
+{
+public:
+    LoopbackPair() = default;
+    ~LoopbackPair() = default;
+
+    bool connect(int cipher, bool keep_alive)
+    {
+        bool failed = false;
+        int ready = 0;
+
+        auto on_ready = [this, &ready]()
+        {
+            if (++ready == 2)
+                loop_.taskRunner()->postQuit();
+        };
+
+        client_endpoint_.on_connected = on_ready;
+        client_endpoint_.on_disconnected = [this, &failed]()
+        {
+            failed = true;
+            loop_.taskRunner()->postQuit();
+        };
+        server_ready_ = on_ready;
+
+        server_.start(0, this);
+
+        client_ = std::make_unique<base::NetworkChannel>();
+        client_->setListener(&client_endpoint_);
+        client_->connect(u"127.0.0.1", server_.port());
+
+        loop_.run();
+
+        client_endpoint_.on_connected = nullptr;
+        client_endpoint_.on_disconnected = nullptr;
+        server_ready_ = nullptr;
+
+        if (failed || !server_channel_)
+            return false;
+
+        // Each direction has its own key.
+        client_->setEncryptor(createEncryptor(cipher, 0x5c));
+        client_->setDecryptor(createDecryptor(cipher, 0x3a));
+        server_channel_->setEncryptor(createEncryptor(cipher, 0x3a));
+        server_channel_->setDecryptor(createDecryptor(cipher, 0x5c));
+
+        for (base::NetworkChannel* channel : { client_.get(), server_channel_.get() })
+        {
+            channel->setNoDelay(true);
+
+            // The timer of the keep alive is much shorter than the default one to show its cost.
+            if (keep_alive)
+                channel->setOwnKeepAlive(true, std::chrono::seconds(1));
+
+            channel->resume();
+        }
+
+        return true;
+    }
+
+    void run() { loop_.run(); }
+    void quit() { loop_.taskRunner()->postQuit(); }
+
+    base::NetworkChannel* client() { return client_.get(); }
+    base::NetworkChannel* server() { return server_channel_.get(); }
+
+    Endpoint* clientEndpoint() { return &client_endpoint_; }
+    Endpoint* serverEndpoint() { return &server_endpoint_; }
+
+protected:
+    // base::NetworkServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::NetworkChannel> channel) override
+    {
+        if (server_channel_)
+            return;
+
+        server_channel_ = std::move(channel);
+        server_channel_->setListener(&server_endpoint_);
+
+        if (server_ready_)
+            server_ready_();
+    }
+
+private:
+    base::MessageLoop loop_{ base::MessageLoop::Type::ASIO };
+    base::NetworkServer server_;
+
+    Endpoint client_endpoint_;
+    Endpoint server_endpoint_;
+    std::unique_ptr<base::NetworkChannel> client_;
+    std::unique_ptr<base::NetworkChannel> server_channel_;
+    std::function<void()> server_ready_;
+
+    DISALLOW_COPY_AND_ASSIGN(LoopbackPair);
+};
+
+// The client sends a batch of messages of |state.range(1)| bytes, the iteration ends when the
+// server has received all of them.
+void BM_NetworkChannelThroughput(benchmark::State& state)
+{
+    LoopbackPair pair;
+    if (!pair.connect(static_cast<int>(state.range(0)), false))
+    {
+        state.SkipWithError("Unable to connect");
+        return;
+    }
+
+    const size_t message_size = static_cast<size_t>(state.range(1));
+    const size_t batch = std::clamp(kBatchBytes / message_size, size_t(1), kMaxBatchMessages);
+    const base::ByteArray message(message_size, 0xa5);
+
+    size_t received = 0;
+    bool failed = false;
+
+    pair.serverEndpoint()->on_message = [&](const base::ByteArray& /* buffer */)
+    {
+        if (++received == batch)
+            pair.quit();
+    };
+    pair.serverEndpoint()->on_disconnected = [&]()
+    {
+        failed = true;
+        pair.quit();
+    };
+
+    for (auto _ : state)
+    {
+        received = 0;
+
+        for (size_t i = 0; i < batch; ++i)
+            pair.client()->send(base::ByteArray(message), base::NetworkChannel::Priority::VIDEO);
+
+        pair.run();
+
+        if (failed)
+        {
+            state.SkipWithError("Connection lost");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(batch * message_size));
+}
+
+// The client sends a message of |state.range(1)| bytes and the server returns it. The round trip
+// times are reported as the counters.
+void BM_NetworkChannelLatency(benchmark::State& state)
+{
+    LoopbackPair pair;
+    if (!pair.connect(static_cast<int>(state.range(0)), state.range(2) != 0))
+    {
+        state.SkipWithError("Unable to connect");
+        return;
+    }
+
+    const base::ByteArray message(static_cast<size_t>(state.range(1)), 0xa5);
+    base::SampleWindow round_trip(kMaxLatencySamples);
+    bool failed = false;
+
+    pair.serverEndpoint()->on_message = [&](const base::ByteArray& buffer)
+    {
+        pair.server()->send(base::ByteArray(buffer));
+    };
+    pair.clientEndpoint()->on_message = [&](const base::ByteArray& /* buffer */)
+    {
+        pair.quit();
+    };
+    pair.clientEndpoint()->on_disconnected = [&]()
+    {
+        failed = true;
+        pair.quit();
+    };
+
+    for (auto _ : state)
+    {
+        const Clock::time_point start_time = Clock::now();
+
+        pair.client()->send(base::ByteArray(message));
+        pair.run();
+
+        if (failed)
+        {
+            state.SkipWithError("Connection lost");
+            break;
+        }
+
+        round_trip.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start_time).count());
+    }
+
+    if (!round_trip.isEmpty())
+    {
+        state.counters["p50_us"] = static_cast<double>(round_trip.percentile(50));
+        state.counters["p99_us"] = static_cast<double>(round_trip.percentile(99));
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(1) * 2);
+}
+
+void throughputArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "cipher", "size" });
+
+    for (int cipher : { AES256_GCM, CHACHA20_POLY1305, NONE })
+    {
+        for (int size : { 64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024 })
+            benchmark->Args({ cipher, size });
+    }
+}
+
+void latencyArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "cipher", "size", "keep_alive" });
+
+    for (int cipher : { AES256_GCM, CHACHA20_POLY1305, NONE })
+    {
+        for (int size : { 64, 16 * 1024, 4 * 1024 * 1024 })
+        {
+            for (int keep_alive : { 0, 1 })
+                benchmark->Args({ cipher, size, keep_alive });
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_NetworkChannelThroughput)->Apply(throughputArguments)->UseRealTime();
+BENCHMARK(BM_NetworkChannelLatency)->Apply(latencyArguments)->UseRealTime();
+
+} // namespace benchmarks
@@ -0,0 +1,104 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/pending_session_index.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+const size_t kSecretSize = 32;
+
+struct Peer
+{
+    uint32_t key_id;
+    base::ByteArray secret;
+};
+
+// Both peers of a pair use the same key and the same secret.
+std::vector<Peer> makePeers(int64_t pair_count)
+{
+    std::vector<Peer> peers;
+    peers.reserve(static_cast<size_t>(pair_count));
+
+    for (int64_t i = 0; i < pair_count; ++i)
+    {
+        base::ByteArray secret(kSecretSize);
+        for (size_t j = 0; j < kSecretSize; ++j)
+            secret[j] = static_cast<uint8_t>((i * 31 + static_cast<int64_t>(j) * 17) >> (j % 8));
+
+        peers.push_back({ static_cast<uint32_t>(i), std::move(secret) });
+    }
+
+    return peers;
+}
+
+// A connection storm: the first peers of all pairs connect, then their partners connect in the
+// reverse order. Every eighth first peer times out before its partner comes.
+void BM_PendingSessionMatching(benchmark::State& state)
+{
+    const int64_t pair_count = state.range(0);
+    const std::vector<Peer> peers = makePeers(pair_count);
+
+    // The sessions are never dereferenced by the index, only distinct addresses are needed.
+    std::vector<char> storage(static_cast<size_t>(pair_count) * 2);
+    auto session = [&storage](size_t index)
+    {
+        return reinterpret_cast<relay::PendingSession*>(&storage[index]);
+    };
+
+    for (auto _ : state)
+    {
+        relay::PendingSessionIndex index;
+        int64_t matched = 0;
+
+        for (size_t i = 0; i < peers.size(); ++i)
+            index.takePeer(session(i * 2), peers[i].key_id, peers[i].secret);
+
+        for (size_t i = 0; i < peers.size(); i += 8)
+            index.remove(session(i * 2));
+
+        for (size_t i = peers.size(); i-- > 0;)
+        {
+            const Peer& peer = peers[i];
+            relay::PendingSession* other =
+                index.takePeer(session(i * 2 + 1), peer.key_id, peer.secret);
+            if (other)
+                ++matched;
+            else
+                index.remove(session(i * 2 + 1));
+        }
+
+        benchmark::DoNotOptimize(matched);
+    }
+
+    state.SetItemsProcessed(state.iterations() * pair_count * 2);
+}
+
+} // namespace
+
+BENCHMARK(BM_PendingSessionMatching)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000);
+
+} // namespace benchmarks
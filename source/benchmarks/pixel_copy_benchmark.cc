@@ -0,0 +1,116 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/pixel_copy.h"
+
+#include <benchmark/benchmark.h>
+
+#include <numeric>
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+// The working set of the differ and the encoder, which should stay in the cache after the copy.
+const size_t kWorkingSetSize = 2 * 1024 * 1024;
+
+using CopyFunction = void(*)(const uint8_t*, int, uint8_t*, int, int, int);
+
+CopyFunction copyFunction(int64_t mode)
+{
+    switch (mode)
+    {
+        case 0:
+            return base::copyPixelsTemporal;
+
+        case 1:
+            return base::copyPixelsNonTemporal;
+
+        default:
+            return base::copyPixels;
+    }
+}
+
+// Copies the full frame of the size |range(0)| x |range(1)| with the path |range(2)| (0 is the
+// plain copy, 1 the non-temporal stores, 2 the non-temporal stores in parallel).
+void BM_PixelCopy(benchmark::State& state)
+{
+    const int row_size = static_cast<int>(state.range(0)) * 4;
+    const int row_count = static_cast<int>(state.range(1));
+    const CopyFunction copy = copyFunction(state.range(2));
+
+    const size_t size = static_cast<size_t>(row_size) * row_count;
+    std::vector<uint8_t> src(size, 0x5A);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state)
+    {
+        copy(src.data(), row_size, dst.data(), row_size, row_size, row_count);
+        benchmark::DoNotOptimize(dst.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+// Measures only the reading of the working set after each copy of the frame. The reading is
+// slower if the copy has evicted the working set from the cache.
+void BM_PixelCopyWorkingSet(benchmark::State& state)
+{
+    const int row_size = static_cast<int>(state.range(0)) * 4;
+    const int row_count = static_cast<int>(state.range(1));
+    const CopyFunction copy = copyFunction(state.range(2));
+
+    const size_t size = static_cast<size_t>(row_size) * row_count;
+    std::vector<uint8_t> src(size, 0x5A);
+    std::vector<uint8_t> dst(size);
+    std::vector<uint64_t> working_set(kWorkingSetSize / sizeof(uint64_t), 1);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        benchmark::DoNotOptimize(std::accumulate(working_set.begin(), working_set.end(), 0ULL));
+        copy(src.data(), row_size, dst.data(), row_size, row_size, row_count);
+        benchmark::ClobberMemory();
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(std::accumulate(working_set.begin(), working_set.end(), 0ULL));
+    }
+
+    state.SetBytesProcessed(state.iterations() * kWorkingSetSize);
+}
+
+} // namespace
+
+BENCHMARK(BM_PixelCopy)
+    ->Args({ 1920, 1080, 0 })
+    ->Args({ 3840, 2160, 0 })
+    ->Args({ 3840, 2160, 1 })
+    ->Args({ 3840, 2160, 2 })
+    ->Args({ 7680, 4320, 0 })
+    ->Args({ 7680, 4320, 1 })
+    ->Args({ 7680, 4320, 2 })
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_PixelCopyWorkingSet)
+    ->Args({ 3840, 2160, 0 })
+    ->Args({ 3840, 2160, 1 })
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace benchmarks
@@ -0,0 +1,146 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/region.h"
+#include "benchmarks/frame_sequence.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace benchmarks {
+
+namespace {
+
+// Returns the rects of the updated regions of the frames of the sequence.
+std::vector<base::Rect> updatedRects(const FrameSequence& sequence)
+{
+    std::vector<base::Rect> rects;
+
+    for (int i = 1; i < sequence.count(); ++i)
+    {
+        for (base::Region::Iterator it(sequence.frame(i)->constUpdatedRegion()); !it.isAtEnd();
+             it.advance())
+        {
+            rects.emplace_back(it.rect());
+        }
+    }
+
+    return rects;
+}
+
+// Accumulates the updated regions of the frames, as the encoder does when it merges the frames
+// that have not been sent yet.
+void BM_RegionAddRegion(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+
+    for (auto _ : state)
+    {
+        base::Region region;
+
+        for (int i = 1; i < sequence.count(); ++i)
+            region.addRegion(sequence.frame(i)->constUpdatedRegion());
+
+        benchmark::DoNotOptimize(region);
+    }
+
+    state.SetItemsProcessed(state.iterations() * (sequence.count() - 1));
+}
+
+// Builds a region from the separate rects, as the capturers do with the rects from the OS.
+void BM_RegionAddRect(benchmark::State& state)
+{
+    const std::vector<base::Rect> rects = updatedRects(FrameSequence::current());
+
+    for (auto _ : state)
+    {
+        base::Region region;
+
+        for (const auto& rect : rects)
+            region.addRect(rect);
+
+        benchmark::DoNotOptimize(region);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(rects.size()));
+}
+
+void BM_RegionIntersect(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+
+    for (auto _ : state)
+    {
+        for (int i = 1; i < sequence.count(); ++i)
+        {
+            base::Region region;
+            region.intersect(sequence.frame(i - 1)->constUpdatedRegion(),
+                             sequence.frame(i)->constUpdatedRegion());
+            benchmark::DoNotOptimize(region);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * (sequence.count() - 1));
+}
+
+void BM_RegionSubtract(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+
+    for (auto _ : state)
+    {
+        for (int i = 1; i < sequence.count(); ++i)
+        {
+            base::Region region(base::Rect::makeSize(sequence.size()));
+            region.subtract(sequence.frame(i)->constUpdatedRegion());
+            benchmark::DoNotOptimize(region);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * (sequence.count() - 1));
+}
+
+void BM_RegionIterate(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+
+    base::Region region;
+    for (int i = 1; i < sequence.count(); ++i)
+        region.addRegion(sequence.frame(i)->constUpdatedRegion());
+
+    for (auto _ : state)
+    {
+        int64_t area = 0;
+
+        for (base::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+        benchmark::DoNotOptimize(area);
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_RegionAddRegion);
+BENCHMARK(BM_RegionAddRect);
+BENCHMARK(BM_RegionIntersect);
+BENCHMARK(BM_RegionSubtract);
+BENCHMARK(BM_RegionIterate);
+
+} // namespace benchmarks
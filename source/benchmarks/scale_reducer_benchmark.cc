@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/scale_reducer.h"
+#include "base/desktop/frame.h"
+#include "benchmarks/frame_sequence.h"
+
+#include <benchmark/benchmark.h>
+
+namespace benchmarks {
+
+namespace {
+
+// Scales the frames of the sequence to |state.range(0)| percent of the source size. 50 and 25
+// use the exact path of the reducer, the other values use the generic one.
+void BM_ScaleReducer(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+    const int percent = static_cast<int>(state.range(0));
+    const base::Size target_size(sequence.size().width() * percent / 100,
+                                 sequence.size().height() * percent / 100);
+
+    base::ScaleReducer reducer;
+
+    // The first call scales the whole frame.
+    reducer.scaleFrame(sequence.frame(0), target_size);
+
+    int index = 1;
+
+    for (auto _ : state)
+    {
+        const base::Frame* frame = reducer.scaleFrame(sequence.frame(index), target_size);
+        benchmark::DoNotOptimize(frame);
+
+        if (++index >= sequence.count())
+            index = 1;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_ScaleReducer)->Arg(50)->Arg(25)->Arg(75)->Arg(60);
+
+} // namespace benchmarks
@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_vpx.h"
+#include "benchmarks/frame_sequence.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+namespace benchmarks {
+
+namespace {
+
+enum VpxCodec
+{
+    VP8 = 0,
+    VP9 = 1,
+    VP9_I444 = 2
+};
+
+std::unique_ptr<base::VideoEncoderVPX> createEncoder(int codec)
+{
+    switch (codec)
+    {
+        case VP8:
+            return base::VideoEncoderVPX::createVP8();
+
+        case VP9:
+            return base::VideoEncoderVPX::createVP9();
+
+        default:
+            return base::VideoEncoderVPX::createVP9I444();
+    }
+}
+
+// Encodes the frames of the sequence one after another. The key frame is encoded before the
+// measurement, so only the delta frames are measured. The average size of an encoded frame is
+// reported in the "bytes" counter.
+void BM_VideoEncoderVPX(benchmark::State& state)
+{
+    const FrameSequence& sequence = FrameSequence::current();
+    std::unique_ptr<base::VideoEncoderVPX> encoder =
+        createEncoder(static_cast<int>(state.range(0)));
+
+    proto::VideoPacket packet;
+    encoder->encode(sequence.frame(0), &packet);
+
+    int64_t encoded_bytes = 0;
+    int index = 1;
+
+    for (auto _ : state)
+    {
+        packet.Clear();
+        encoder->encode(sequence.frame(index), &packet);
+        encoded_bytes += static_cast<int64_t>(packet.data().size());
+
+        if (++index >= sequence.count())
+            index = 1;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes"] = benchmark::Counter(
+        static_cast<double>(encoded_bytes), benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+BENCHMARK(BM_VideoEncoderVPX)
+    ->ArgName("codec")->Arg(VP8)->Arg(VP9)->Arg(VP9_I444)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace benchmarks
@@ -76,6 +76,11 @@
 #error Unknown architecture
 #endif
 
+// NEON is a mandatory part of ARM64. On 32-bit ARM it is available only if the compiler targets it.
+#if defined(ARCH_CPU_ARM64) || (defined(ARCH_CPU_ARMEL) && defined(__ARM_NEON))
+#define USE_NEON 1
+#endif
+
 #if defined(OS_WIN)
 #define WCHAR_T_IS_UTF16
 #elif defined(OS_POSIX) && defined(CC_GCC) && defined(__WCHAR_MAX__) && \
@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/audio_video_sync.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace client {
+
+namespace {
+
+// The latencies are smoothed the same way as the jitter in RFC 3550.
+const double kLatencyGain = 1.0 / 16.0;
+
+// The difference is not noticed by a viewer (ITU-R BT.1359 detects the audio 45 ms ahead of the
+// video). A smaller change of the delay would only add the gaps into the audio.
+const std::chrono::milliseconds kTolerance { 30 };
+
+// The audio is not delayed more than this even if the video is much slower.
+const std::chrono::milliseconds kMaxDelay { 300 };
+
+// The number of the audio packets after a change of the delay before the next change.
+const int kMinAudioSamples = 32;
+
+// A latency out of this range is a pause or a wrong time, not a delay of the stream.
+const int64_t kMaxLatencyUs = 5000000;
+
+void addLatency(double* latency, int64_t sample)
+{
+    if (sample < 0 || sample > kMaxLatencyUs)
+        return;
+
+    if (*latency < 0)
+        *latency = static_cast<double>(sample);
+    else
+        *latency += (static_cast<double>(sample) - *latency) * kLatencyGain;
+}
+
+} // namespace
+
+void AudioVideoSync::addAudio(int64_t capture_time, int64_t play_time)
+{
+    addLatency(&audio_latency_, play_time - capture_time);
+    ++audio_samples_;
+    update();
+}
+
+void AudioVideoSync::addVideo(int64_t capture_time, int64_t paint_time)
+{
+    addLatency(&video_latency_, paint_time - capture_time);
+    update();
+}
+
+void AudioVideoSync::update()
+{
+    if (audio_latency_ < 0 || video_latency_ < 0 || audio_samples_ < kMinAudioSamples)
+        return;
+
+    // The measured latency of the audio includes the current delay.
+    const std::chrono::milliseconds difference(
+        static_cast<int64_t>(std::round((video_latency_ - audio_latency_) / 1000)));
+
+    if (std::chrono::abs(difference) < kTolerance)
+        return;
+
+    std::chrono::milliseconds delay =
+        std::clamp(audio_delay_ + difference, std::chrono::milliseconds(0), kMaxDelay);
+    if (delay == audio_delay_)
+        return;
+
+    audio_delay_ = delay;
+
+    // The latency of the audio changes when the new delay is applied.
+    audio_latency_ = -1;
+    audio_samples_ = 0;
+}
+
+} // namespace client
@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__AUDIO_VIDEO_SYNC_H
+#define CLIENT__AUDIO_VIDEO_SYNC_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace client {
+
+// Estimates the delay of the audio which plays it in sync with the video. The audio and the video
+// packets carry the capture times by the same clock of the host, so the latencies of both streams
+// from the capture to the playback can be compared without the clock offset. The video usually
+// has the higher latency (encoding and decoding of the frames), then the audio is delayed by the
+// difference. The video is never delayed: it would delay the input feedback of the session.
+class AudioVideoSync
+{
+public:
+    AudioVideoSync() = default;
+    ~AudioVideoSync() = default;
+
+    // Adds the audio packet captured at |capture_time| which will be played at |play_time|. The
+    // times are in microseconds by the clock of the client.
+    void addAudio(int64_t capture_time, int64_t play_time);
+
+    // Adds the video frame captured at |capture_time| and painted at |paint_time|.
+    void addVideo(int64_t capture_time, int64_t paint_time);
+
+    // Returns the current delay of the audio (including the delay which is not yet applied).
+    std::chrono::milliseconds audioDelay() const { return audio_delay_; }
+
+private:
+    void update();
+
+    // Smoothed latencies in microseconds. Negative if not measured yet.
+    double audio_latency_ = -1;
+    double video_latency_ = -1;
+
+    // The number of the audio packets since the last change of the delay. The latency of the audio
+    // is measured again after each change.
+    int audio_samples_ = 0;
+
+    std::chrono::milliseconds audio_delay_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(AudioVideoSync);
+};
+
+} // namespace client
+
+#endif // CLIENT__AUDIO_VIDEO_SYNC_H
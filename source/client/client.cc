@@ -20,11 +20,17 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/peer/resumption_ticket_cache.h"
 #include "base/strings/strcat.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
 #include "build/build_config.h"
 #include "build/version.h"
 #include "client/status_window_proxy.h"
+#include "proto/key_exchange.pb.h"
+
+#include <algorithm>
+#include <limits>
 
 #if defined(OS_MAC)
 #include "base/mac/app_nap_blocker.h"
@@ -32,6 +38,24 @@
 
 namespace client {
 
+namespace {
+
+// The authorized sessions of the process whose connections can carry other sessions. All clients
+// work on the I/O thread.
+std::vector<Client*>& hostClients()
+{
+    static std::vector<Client*> clients;
+    return clients;
+}
+
+void removeHostClient(Client* client)
+{
+    std::vector<Client*>& clients = hostClients();
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+}
+
+} // namespace
+
 Client::Client(std::shared_ptr<base::TaskRunner> io_task_runner)
     : io_task_runner_(std::move(io_task_runner))
 {
@@ -66,6 +90,11 @@ void Client::start(const Config& config)
     config_ = config;
     state_ = State::STARTED;
 
+    // The file manager which is opened next to a desktop session does not need a connection and
+    // an authentication of its own.
+    if (config_.session_type == proto::SESSION_TYPE_FILE_TRANSFER && startInStream())
+        return;
+
     if (base::isHostId(config_.address_or_id))
     {
         LOG(LS_INFO) << "Starting RELAY connection";
@@ -105,6 +134,16 @@ void Client::stop()
         LOG(LS_INFO) << "Stopping client...";
         state_ = State::STOPPPED;
 
+        if (host_client_)
+        {
+            // The other sessions in the connection continue to work.
+            host_client_->channel_->closeStream(stream_id_);
+            detachFromHostClient();
+        }
+
+        removeHostClient(this);
+        disconnectStreamClients(base::NetworkChannel::ErrorCode::REMOTE_HOST_CLOSED);
+
         router_controller_.reset();
         authenticator_.reset();
         channel_.reset();
@@ -136,59 +175,78 @@ proto::SessionType Client::sessionType() const
     return config_.session_type;
 }
 
-void Client::sendMessage(const google::protobuf::MessageLite& message)
+void Client::sendMessage(const google::protobuf::MessageLite& message,
+                         base::NetworkChannel::Priority priority)
 {
-    if (!channel_)
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
     {
         LOG(LS_WARNING) << "sendMessage called but channel not initialized";
         return;
     }
 
-    channel_->send(base::serialize(message));
+    // Stream 0 is the connection itself.
+    network_channel->sendToStream(stream_id_, base::serialize(message), priority);
 }
 
 int64_t Client::totalRx() const
 {
-    if (!channel_)
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
     {
         LOG(LS_WARNING) << "totalRx called but channel not initialized";
         return 0;
     }
 
-    return channel_->totalRx();
+    return network_channel->totalRx();
 }
 
 int64_t Client::totalTx() const
 {
-    if (!channel_)
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
     {
         LOG(LS_WARNING) << "totalTx called but channel not initialized";
         return 0;
     }
 
-    return channel_->totalTx();
+    return network_channel->totalTx();
 }
 
 int Client::speedRx()
 {
-    if (!channel_)
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
     {
         LOG(LS_WARNING) << "speedRx called but channel not initialized";
         return 0;
     }
 
-    return channel_->speedRx();
+    return network_channel->speedRx();
 }
 
 int Client::speedTx()
 {
-    if (!channel_)
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
     {
         LOG(LS_WARNING) << "speedTx called but channel not initialized";
         return 0;
     }
 
-    return channel_->speedTx();
+    return network_channel->speedTx();
+}
+
+std::optional<int64_t> Client::clockOffset() const
+{
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
+    {
+        LOG(LS_WARNING) << "clockOffset called but channel not initialized";
+        return std::nullopt;
+    }
+
+    return network_channel->clockOffset();
 }
 
 void Client::onConnected()
@@ -198,10 +256,62 @@ void Client::onConnected()
 
 void Client::onDisconnected(base::NetworkChannel::ErrorCode error_code)
 {
+    removeHostClient(this);
+    disconnectStreamClients(error_code);
+
     // Show an error to the user.
     status_window_proxy_->onDisconnected(error_code);
 }
 
+void Client::onStreamMessageReceived(uint8_t stream_id, const base::ByteArray& buffer)
+{
+    DCHECK_EQ(stream_id, stream_id_);
+
+    if (stream_accepted_)
+    {
+        onMessageReceived(buffer);
+        return;
+    }
+
+    // The first message of the stream is the answer of the host to the request.
+    proto::StreamResponse response;
+    if (!base::parse(buffer, &response))
+    {
+        LOG(LS_ERROR) << "Invalid stream response";
+
+        host_client_->channel_->closeStream(stream_id_);
+        detachFromHostClient();
+        status_window_proxy_->onDisconnected(base::NetworkChannel::ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    if (!response.accepted())
+    {
+        LOG(LS_WARNING) << "Session is not accepted in stream " << static_cast<int>(stream_id);
+
+        // The host closes the stream itself.
+        host_client_->channel_->setStreamListener(stream_id_, nullptr);
+        detachFromHostClient();
+        status_window_proxy_->onAccessDenied(base::ClientAuthenticator::ErrorCode::SESSION_DENIED);
+        return;
+    }
+
+    LOG(LS_INFO) << "Session is accepted in stream " << static_cast<int>(stream_id);
+    stream_accepted_ = true;
+
+    status_window_proxy_->onConnected();
+    onSessionStarted(host_client_->peer_version_);
+}
+
+void Client::onStreamClosed(uint8_t stream_id)
+{
+    DCHECK_EQ(stream_id, stream_id_);
+    LOG(LS_INFO) << "Stream " << static_cast<int>(stream_id) << " closed by the host";
+
+    detachFromHostClient();
+    status_window_proxy_->onDisconnected(base::NetworkChannel::ErrorCode::REMOTE_HOST_CLOSED);
+}
+
 void Client::onHostConnected(std::unique_ptr<base::NetworkChannel> channel)
 {
     DCHECK(channel);
@@ -227,6 +337,13 @@ void Client::startAuthentication()
     channel_->setReadBufferSize(kReadBufferSize);
     channel_->setNoDelay(true);
 
+    if (config_.session_type == proto::SESSION_TYPE_DESKTOP_MANAGE)
+    {
+        // The mouse and keyboard events of a burst are written and encrypted together.
+        static const std::chrono::microseconds kCoalescingWindow(500);
+        channel_->setCoalescingWindow(kCoalescingWindow);
+    }
+
     authenticator_ = std::make_unique<base::ClientAuthenticator>(io_task_runner_);
 
     authenticator_->setIdentify(proto::IDENTIFY_SRP);
@@ -234,15 +351,31 @@ void Client::startAuthentication()
     authenticator_->setPassword(config_.password);
     authenticator_->setSessionType(config_.session_type);
 
+    // Reconnects to the same host with the same user skip SRP.
+    std::string ticket_key = base::utf8FromUtf16(base::strCat(
+        { config_.username, u"@", config_.address_or_id, u":",
+          base::numberToString16(config_.port) }));
+
+    base::ResumptionTicketCache* ticket_cache = base::ResumptionTicketCache::instance();
+
+    std::optional<proto::ResumptionTicket> ticket = ticket_cache->ticket(ticket_key);
+    if (ticket.has_value())
+        authenticator_->setTicket(*ticket);
+
     authenticator_->start(std::move(channel_),
-                          [this](base::ClientAuthenticator::ErrorCode error_code)
+                          [this, ticket_key](base::ClientAuthenticator::ErrorCode error_code)
     {
+        base::ResumptionTicketCache* ticket_cache = base::ResumptionTicketCache::instance();
+
         if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
         {
+            ticket_cache->setTicket(ticket_key, authenticator_->ticket());
+
             // The authenticator takes the listener on itself, we return the receipt of
             // notifications.
             channel_ = authenticator_->takeChannel();
             channel_->setListener(this);
+            peer_version_ = authenticator_->peerVersion();
 
             if (authenticator_->peerVersion() >= base::Version(2, 0, 0))
             {
@@ -263,9 +396,14 @@ void Client::startAuthentication()
 
             // Now the session will receive incoming messages.
             channel_->resume();
+
+            // The file transfer sessions to the same host can be opened in the streams of the
+            // connection.
+            hostClients().emplace_back(this);
         }
         else
         {
+            ticket_cache->removeTicket(ticket_key);
             status_window_proxy_->onAccessDenied(error_code);
         }
 
@@ -274,4 +412,110 @@ void Client::startAuthentication()
     });
 }
 
+bool Client::startInStream()
+{
+    Client* host_client = nullptr;
+
+    for (Client* client : hostClients())
+    {
+        const Config& config = client->config_;
+
+        if (config.address_or_id == config_.address_or_id && config.port == config_.port &&
+            config.username == config_.username && client->channel_ &&
+            client->channel_->isConnected() && client->channel_->peerSupportsStreams())
+        {
+            host_client = client;
+            break;
+        }
+    }
+
+    if (!host_client)
+        return false;
+
+    const uint8_t stream_id = host_client->allocateStreamId();
+    if (!stream_id)
+    {
+        LOG(LS_WARNING) << "No free streams in the connection";
+        return false;
+    }
+
+    LOG(LS_INFO) << "Starting session in stream " << static_cast<int>(stream_id);
+
+    // Show the status window.
+    if (base::isHostId(config_.address_or_id))
+    {
+        status_window_proxy_->onStarted(config_.address_or_id);
+    }
+    else
+    {
+        status_window_proxy_->onStarted(
+            base::strCat({ config_.address_or_id, u":", base::numberToString16(config_.port) }));
+    }
+
+    host_client_ = host_client;
+    stream_id_ = stream_id;
+
+    host_client_->stream_clients_.emplace_back(this);
+    host_client_->channel_->setStreamListener(stream_id_, this);
+
+    proto::StreamRequest request;
+    request.set_session_type(config_.session_type);
+    host_client_->channel_->sendToStream(stream_id_, base::serialize(request));
+    return true;
+}
+
+uint8_t Client::allocateStreamId()
+{
+    static const int kMaxStreamId = std::numeric_limits<uint8_t>::max();
+
+    // The identifiers are not reused at once, so the messages of a new session do not reach the
+    // closed one on the host.
+    for (int i = 0; i < kMaxStreamId; ++i)
+    {
+        const uint8_t stream_id = next_stream_id_;
+        next_stream_id_ = (next_stream_id_ == kMaxStreamId) ? 1 : next_stream_id_ + 1;
+
+        auto it = std::find_if(stream_clients_.begin(), stream_clients_.end(),
+                               [stream_id](const Client* client)
+        {
+            return client->stream_id_ == stream_id;
+        });
+
+        if (it == stream_clients_.end())
+            return stream_id;
+    }
+
+    return 0;
+}
+
+void Client::detachFromHostClient()
+{
+    std::vector<Client*>& list = host_client_->stream_clients_;
+    list.erase(std::remove(list.begin(), list.end(), this), list.end());
+    host_client_ = nullptr;
+}
+
+void Client::disconnectStreamClients(base::NetworkChannel::ErrorCode error_code)
+{
+    std::vector<Client*> stream_clients;
+    stream_clients.swap(stream_clients_);
+
+    for (Client* stream_client : stream_clients)
+    {
+        if (channel_)
+            channel_->setStreamListener(stream_client->stream_id_, nullptr);
+
+        stream_client->host_client_ = nullptr;
+        stream_client->status_window_proxy_->onDisconnected(error_code);
+    }
+}
+
+base::NetworkChannel* Client::channel() const
+{
+    if (host_client_)
+        return host_client_->channel_.get();
+
+    return channel_.get();
+}
+
 } // namespace client
@@ -24,6 +24,8 @@
 #include "client/router_controller.h"
 #include "base/net/network_channel.h"
 
+#include <vector>
+
 namespace base {
 class ClientAuthenticator;
 class TaskRunner;
@@ -36,13 +38,17 @@ class StatusWindowProxy;
 
 class Client
     : public RouterController::Delegate,
-      public base::NetworkChannel::Listener
+      public base::NetworkChannel::Listener,
+      public base::NetworkChannel::StreamListener
 {
 public:
     explicit Client(std::shared_ptr<base::TaskRunner> io_task_runner);
     virtual ~Client();
 
-    // Starts a session.
+    // Starts a session. The file transfer session is opened in a stream of the connection of an
+    // authorized session to the same host with the same user if there is one and the host
+    // supports it (see base::NetworkChannel::sendToStream()). Such a session is stopped together
+    // with the session which owns the connection.
     void start(const Config& config);
 
     // Stops a session.
@@ -68,7 +74,9 @@ protected:
     virtual void onSessionStarted(const base::Version& peer_version) = 0;
 
     // Sends outgoing message.
-    void sendMessage(const google::protobuf::MessageLite& message);
+    void sendMessage(
+        const google::protobuf::MessageLite& message,
+        base::NetworkChannel::Priority priority = base::NetworkChannel::Priority::CONTROL);
 
     // Methods for obtaining network metrics.
     int64_t totalRx() const;
@@ -76,10 +84,17 @@ protected:
     int speedRx();
     int speedTx();
 
+    // Returns the offset of the clock of the host (see NetworkChannel::clockOffset()).
+    std::optional<int64_t> clockOffset() const;
+
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
     void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
 
+    // base::NetworkChannel::StreamListener implementation.
+    void onStreamMessageReceived(uint8_t stream_id, const base::ByteArray& buffer) override;
+    void onStreamClosed(uint8_t stream_id) override;
+
     // RouterController::Delegate implementation.
     void onHostConnected(std::unique_ptr<base::NetworkChannel> channel) override;
     void onErrorOccurred(const RouterController::Error& error) override;
@@ -87,6 +102,19 @@ protected:
 private:
     void startAuthentication();
 
+    // Returns false if there is no authorized session to share the connection with.
+    bool startInStream();
+    uint8_t allocateStreamId();
+
+    // Removes the session in a stream from the list of the session which owns the connection.
+    void detachFromHostClient();
+
+    // Notifies the sessions in the streams that the connection is closed and detaches them.
+    void disconnectStreamClients(base::NetworkChannel::ErrorCode error_code);
+
+    // Returns the channel of the session or the channel of the session which owns the connection.
+    base::NetworkChannel* channel() const;
+
     std::shared_ptr<base::TaskRunner> io_task_runner_;
     std::unique_ptr<RouterController> router_controller_;
     std::unique_ptr<base::NetworkChannel> channel_;
@@ -94,9 +122,19 @@ private:
     std::shared_ptr<StatusWindowProxy> status_window_proxy_;
 
     Config config_;
+    base::Version peer_version_;
 
     enum class State { CREATED, STARTED, STOPPPED };
     State state_ = State::CREATED;
+
+    // The session which owns the connection if the session works in a stream.
+    Client* host_client_ = nullptr;
+    uint8_t stream_id_ = 0;
+    bool stream_accepted_ = false;
+
+    // The sessions which work in the streams of the connection.
+    std::vector<Client*> stream_clients_;
+    uint8_t next_stream_id_ = 1;
 };
 
 } // namespace client
@@ -19,16 +19,22 @@
 #include "client/client_desktop.h"
 
 #include "base/logging.h"
+#include "base/system_time.h"
+#include "base/stl_util.h"
 #include "base/task_runner.h"
 #include "base/audio/audio_player.h"
 #include "base/codec/audio_decoder_opus.h"
 #include "base/codec/cursor_decoder.h"
-#include "base/codec/video_decoder.h"
+#include "base/codec/webm_file_writer.h"
 #include "base/desktop/mouse_cursor.h"
+#include "base/strings/string_split.h"
+#include "base/strings/unicode.h"
 #include "client/desktop_control_proxy.h"
 #include "client/desktop_window.h"
 #include "client/desktop_window_proxy.h"
 #include "client/config_factory.h"
+#include "client/frame_timestamps.h"
+#include "client/video_decoder_thread.h"
 #include "common/desktop_session_constants.h"
 
 namespace client {
@@ -51,14 +57,38 @@ size_t calculateAvgSize(size_t last_avg_size, size_t bytes)
         ((1.0 - kAlpha) * static_cast<double>(last_avg_size)));
 }
 
+// The latency percentiles are calculated over this number of the last frames.
+const size_t kMaxLatencySamples = 512;
+
+// The mouse moves are sent with this rate until the window reports the refresh rate of its screen.
+const int kDefaultMouseMoveRate = 60;
+
+DesktopWindow::Latency latencyPercentiles(const base::SampleWindow& samples)
+{
+    DesktopWindow::Latency latency;
+
+    latency.count = samples.count();
+    latency.p50 = samples.percentile(50);
+    latency.p95 = samples.percentile(95);
+    latency.p99 = samples.percentile(99);
+
+    return latency;
+}
+
 } // namespace
 
 ClientDesktop::ClientDesktop(std::shared_ptr<base::TaskRunner> io_task_runner)
     : Client(io_task_runner),
       desktop_control_proxy_(std::make_shared<DesktopControlProxy>(io_task_runner, this)),
       incoming_message_(std::make_unique<proto::HostToClient>()),
-      outgoing_message_(std::make_unique<proto::ClientToHost>()),
-      audio_player_(base::AudioPlayer::create())
+      audio_player_(base::AudioPlayer::create()),
+      mouse_move_timer_(base::WaitableTimer::Type::SINGLE_SHOT, io_task_runner),
+      capture_latency_(kMaxLatencySamples),
+      encode_latency_(kMaxLatencySamples),
+      network_latency_(kMaxLatencySamples),
+      decode_latency_(kMaxLatencySamples),
+      paint_latency_(kMaxLatencySamples),
+      total_latency_(kMaxLatencySamples)
 {
     // Nothing
 }
@@ -81,6 +111,8 @@ void ClientDesktop::onSessionStarted(const base::Version& peer_version)
     started_ = true;
 
     input_event_filter_.setSessionType(sessionType());
+    input_event_filter_.setMouseMoveRate(kDefaultMouseMoveRate);
+    video_decoder_thread_ = std::make_unique<VideoDecoderThread>(desktop_window_proxy_);
     desktop_window_proxy_->showWindow(desktop_control_proxy_, peer_version);
 
     clipboard_monitor_ = std::make_unique<common::ClipboardMonitor>();
@@ -100,11 +132,18 @@ void ClientDesktop::onMessageReceived(const base::ByteArray& buffer)
     if (incoming_message_->has_video_packet() || incoming_message_->has_cursor_shape())
     {
         if (incoming_message_->has_video_packet())
-            readVideoPacket(incoming_message_->video_packet());
+        {
+            readVideoPacket(
+                std::unique_ptr<proto::VideoPacket>(incoming_message_->release_video_packet()));
+        }
 
         if (incoming_message_->has_cursor_shape())
             readCursorShape(incoming_message_->cursor_shape());
     }
+    else if (incoming_message_->has_cursor_position())
+    {
+        readCursorPosition(incoming_message_->cursor_position());
+    }
     else if (incoming_message_->has_audio_packet())
     {
         readAudioPacket(incoming_message_->audio_packet());
@@ -139,9 +178,12 @@ void ClientDesktop::onClipboardEvent(const proto::ClipboardEvent& event)
     if (!out_event.has_value())
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_clipboard_event()->CopyFrom(out_event.value());
-    sendMessage(*outgoing_message_);
+
+    // All clipboard events go in one lane, so a small clipboard does not overtake the chunks of a
+    // previous large one.
+    sendMessage(*outgoing_message_, base::NetworkChannel::Priority::BULK);
 }
 
 void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
@@ -166,8 +208,18 @@ void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
 
     input_event_filter_.setClipboardEnabled(desktop_config_.flags() & proto::ENABLE_CLIPBOARD);
 
-    outgoing_message_->Clear();
-    outgoing_message_->mutable_config()->CopyFrom(desktop_config_);
+    outgoing_message_.clear();
+    proto::DesktopConfig* outgoing_config = outgoing_message_->mutable_config();
+    outgoing_config->CopyFrom(desktop_config_);
+    outgoing_config->set_zstd_dictionaries(zstd_dictionaries_);
+
+    // The recording contains only the encoded video. The tiles painted from the cache and the
+    // copied areas would be missing in it.
+    if (webm_file_writer_)
+    {
+        outgoing_config->set_flags(
+            outgoing_config->flags() & ~(proto::ENABLE_TILE_CACHE | proto::ENABLE_COPY_RECT));
+    }
 
     LOG(LS_INFO) << "Send new config to host";
     sendMessage(*outgoing_message_);
@@ -177,7 +229,7 @@ void ClientDesktop::setCurrentScreen(const proto::Screen& screen)
 {
     LOG(LS_INFO) << "Current screen changed: " << screen.id();
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
 
     extension->set_name(common::kSelectScreenExtension);
@@ -190,7 +242,7 @@ void ClientDesktop::setPreferredSize(int width, int height)
 {
     LOG(LS_INFO) << "Preferred size changed: " << width << "x" << height;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::PreferredSize preferred_size;
     preferred_size.set_width(width);
@@ -210,24 +262,84 @@ void ClientDesktop::onKeyEvent(const proto::KeyEvent& event)
     if (!out_event.has_value())
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_key_event()->CopyFrom(out_event.value());
 
     sendMessage(*outgoing_message_);
 }
 
+void ClientDesktop::setMouseMoveRate(int rate)
+{
+    input_event_filter_.setMouseMoveRate(rate);
+}
+
+void ClientDesktop::setWindowActive(bool active)
+{
+    if (video_decoder_thread_)
+        video_decoder_thread_->setBackground(!active);
+}
+
+void ClientDesktop::setWindowVisible(bool visible)
+{
+    window_visible_ = visible;
+    sendVisibility();
+}
+
 void ClientDesktop::onMouseEvent(const proto::MouseEvent& event)
 {
     std::optional<proto::MouseEvent> out_event = input_event_filter_.mouseEvent(event);
-    if (!out_event.has_value())
+    if (out_event.has_value())
+    {
+        sendMouseEvent(*out_event);
+        return;
+    }
+
+    // The move is held by the filter until the interval passes.
+    std::optional<InputEventFilter::TimePoint> pending_time =
+        input_event_filter_.pendingMouseTime();
+    if (!pending_time.has_value() || mouse_move_timer_.isActive())
         return;
 
-    outgoing_message_->Clear();
-    outgoing_message_->mutable_mouse_event()->CopyFrom(out_event.value());
+    // The timer is rounded up to milliseconds, so the move is never sent too early.
+    const InputEventFilter::TimePoint now = InputEventFilter::Clock::now();
+    std::chrono::milliseconds delay(0);
+
+    if (*pending_time > now)
+        delay = std::chrono::ceil<std::chrono::milliseconds>(*pending_time - now);
+
+    mouse_move_timer_.start(delay, std::bind(&ClientDesktop::sendPendingMouseEvent, this));
+}
+
+void ClientDesktop::sendMouseEvent(const proto::MouseEvent& event)
+{
+    outgoing_message_.clear();
+    outgoing_message_->mutable_mouse_event()->CopyFrom(event);
 
     sendMessage(*outgoing_message_);
 }
 
+void ClientDesktop::sendVisibility()
+{
+    const bool visible = window_visible_ || webm_file_writer_ != nullptr;
+    if (!started_ || visible == visibility_sent_)
+        return;
+
+    LOG(LS_INFO) << "Video visible: " << visible;
+    visibility_sent_ = visible;
+
+    // The old hosts ignore the message and keep sending the video.
+    outgoing_message_.clear();
+    outgoing_message_->mutable_visibility_event()->set_visible(visible);
+    sendMessage(*outgoing_message_);
+}
+
+void ClientDesktop::sendPendingMouseEvent()
+{
+    std::optional<proto::MouseEvent> event = input_event_filter_.takePendingMouseEvent();
+    if (event.has_value())
+        sendMouseEvent(*event);
+}
+
 void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
 {
     if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -236,7 +348,7 @@ void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
         return;
     }
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
 
@@ -251,22 +363,51 @@ void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
 
 void ClientDesktop::onRemoteUpdate()
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_extension()->set_name(common::kRemoteUpdateExtension);
     sendMessage(*outgoing_message_);
 }
 
-void ClientDesktop::onSystemInfoRequest()
+void ClientDesktop::onSystemInfoRequest(bool refresh)
 {
-    outgoing_message_->Clear();
-    outgoing_message_->mutable_extension()->set_name(common::kSystemInfoExtension);
-    sendMessage(*outgoing_message_);
+    // The host replies to the requests in order. Old hosts send all categories to each request.
+    static const uint32_t kFastCategories =
+        proto::SystemInfoRequest::CATEGORY_SUMMARY | proto::SystemInfoRequest::CATEGORY_HARDWARE;
+    static const uint32_t kSlowCategories =
+        proto::SystemInfoRequest::CATEGORY_DRIVES | proto::SystemInfoRequest::CATEGORY_PRINTERS |
+        proto::SystemInfoRequest::CATEGORY_NETWORK;
+
+    for (uint32_t categories : { kFastCategories, kSlowCategories })
+    {
+        proto::SystemInfoRequest request;
+        request.set_categories(categories);
+        request.set_refresh(refresh);
+
+        outgoing_message_.clear();
+
+        proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
+        extension->set_name(common::kSystemInfoExtension);
+        extension->set_data(request.SerializeAsString());
+
+        sendMessage(*outgoing_message_);
+    }
 }
 
 void ClientDesktop::onMetricsRequest()
 {
     TimePoint current_time = Clock::now();
 
+    // The reply of the host is shown with the next update.
+    if (host_statistics_supported_)
+    {
+        outgoing_message_.clear();
+        outgoing_message_->mutable_extension()->set_name(common::kHostStatisticsExtension);
+        sendMessage(*outgoing_message_);
+    }
+
+    if (video_decoder_thread_)
+        fps_frame_count_ += video_decoder_thread_->takeDecodedFrameCount();
+
     if (fps_time_ != TimePoint())
     {
         std::chrono::milliseconds fps_duration =
@@ -317,9 +458,104 @@ void ClientDesktop::onMetricsRequest()
     metrics.read_clipboard = input_event_filter_.readClipboardCount();
     metrics.send_clipboard = input_event_filter_.sendClipboardCount();
 
+    metrics.capture_latency = latencyPercentiles(capture_latency_);
+    metrics.encode_latency = latencyPercentiles(encode_latency_);
+    metrics.network_latency = latencyPercentiles(network_latency_);
+    metrics.decode_latency = latencyPercentiles(decode_latency_);
+    metrics.paint_latency = latencyPercentiles(paint_latency_);
+    metrics.total_latency = latencyPercentiles(total_latency_);
+
+    if (audio_player_)
+    {
+        metrics.audio_buffer = audio_player_->bufferedTime();
+        metrics.audio_jitter = audio_player_->jitter();
+    }
+
+    if (has_host_statistics_)
+    {
+        DesktopWindow::HostStatistics& host = metrics.host_statistics;
+
+        host.capture_fps = static_cast<int>(host_statistics_.capture_fps());
+        host.encode_fps = static_cast<int>(host_statistics_.encode_fps());
+        host.drop_fps = static_cast<int>(host_statistics_.drop_fps());
+        host.capture_time = std::chrono::microseconds(host_statistics_.capture_time());
+        host.encode_time = std::chrono::microseconds(host_statistics_.encode_time());
+        host.bitrate = host_statistics_.bitrate();
+        host.quantizer = host_statistics_.quantizer();
+        host.pending_bytes = host_statistics_.pending_bytes();
+        host.pending_messages = host_statistics_.pending_messages();
+        host.memory_usage = host_statistics_.memory_usage();
+
+        metrics.has_host_statistics = true;
+    }
+
     desktop_window_proxy_->setMetrics(metrics);
 }
 
+void ClientDesktop::setVideoRecording(bool enable, const std::filesystem::path& file_path)
+{
+    if (!enable)
+    {
+        if (webm_file_writer_)
+        {
+            LOG(LS_INFO) << "Video recording stopped";
+            webm_file_writer_.reset();
+            sendVisibility();
+        }
+        return;
+    }
+
+    if (webm_file_writer_)
+        return;
+
+    std::u16string name = computerName();
+    if (name.empty())
+        name = config().address_or_id;
+
+    // The name is a part of the file names.
+    const std::u16string_view invalid_chars(u"\\/:*?\"<>|");
+    for (auto& ch : name)
+    {
+        if (ch < 0x20 || invalid_chars.find(ch) != std::u16string_view::npos)
+            ch = u'_';
+    }
+
+    LOG(LS_INFO) << "Video recording started (path: " << file_path << ")";
+    webm_file_writer_ =
+        std::make_unique<base::WebmFileWriter>(file_path, base::utf8FromUtf16(name));
+
+    // The files start with a key frame. The host sends it after each configuration.
+    if (started_)
+        setDesktopConfig(desktop_config_);
+
+    sendVisibility();
+}
+
+void ClientDesktop::onFramePainted(const FrameTimestamps& timestamps)
+{
+    // The old hosts do not send the times of the stages.
+    if (timestamps.capture && timestamps.diff && timestamps.encode)
+    {
+        capture_latency_.add(timestamps.diff - timestamps.capture);
+        encode_latency_.add(timestamps.encode - timestamps.diff);
+    }
+
+    decode_latency_.add(timestamps.decode - timestamps.receive);
+    paint_latency_.add(timestamps.paint - timestamps.decode);
+
+    // The offset of the clocks is the same for the audio and the video, so they are compared even
+    // if it is not known.
+    if (timestamps.capture && timestamps.paint)
+        audio_video_sync_.addVideo(timestamps.capture, timestamps.paint);
+
+    // The time between the host and the client can be compared only with the known clock offset.
+    if (timestamps.synchronized && timestamps.capture && timestamps.send)
+    {
+        network_latency_.add(timestamps.receive - timestamps.send);
+        total_latency_.add(timestamps.paint - timestamps.capture);
+    }
+}
+
 void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_request)
 {
     LOG(LS_INFO) << "Config request received";
@@ -329,6 +565,21 @@ void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_
     desktop_window_proxy_->setCapabilities(
         config_request.extensions(), config_request.video_encodings());
 
+    std::vector<std::string_view> extensions = base::splitStringView(
+        config_request.extensions(), ";", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    host_statistics_supported_ = base::contains(extensions, common::kHostStatisticsExtension);
+
+    // The old hosts do not send the dictionaries and do not decode the data compressed with them.
+    zstd_dictionaries_ = config_request.zstd_dictionaries() & common::kSupportedZstdDictionaries;
+    if (clipboard_monitor_)
+    {
+        clipboard_monitor_->setTextDictionaryEnabled(
+            zstd_dictionaries_ & proto::ZSTD_DICTIONARY_TEXT);
+
+        // The old hosts accept only a clipboard in one event.
+        clipboard_monitor_->setChunksEnabled(config_request.clipboard_chunks());
+    }
+
     // If current video encoding not supported.
     if (!(config_request.video_encodings() & desktop_config_.video_encoding()))
     {
@@ -344,85 +595,85 @@ void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_
     }
 }
 
-void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
+void ClientDesktop::readVideoPacket(std::unique_ptr<proto::VideoPacket> packet)
 {
-    if (video_encoding_ != packet.encoding())
+    if (!video_decoder_thread_)
     {
-        video_decoder_ = base::VideoDecoder::create(packet.encoding());
-        video_encoding_ = packet.encoding();
-
-        LOG(LS_INFO) << "Video encoding changed to: " << video_encoding_;
+        LOG(LS_ERROR) << "Video decoder thread not initialized";
+        return;
     }
 
-    if (!video_decoder_)
+    if (packet->has_format())
     {
-        LOG(LS_ERROR) << "Video decoder not initialized";
-        return;
+        video_capturer_type_ = packet->format().capturer_type();
+        video_recovery_ = packet->format().video_recovery();
     }
 
-    if (packet.has_format())
+    // The recording contains a single video stream, the streams of separate screens are not
+    // recorded.
+    if (webm_file_writer_ && !packet->stream_id())
+        webm_file_writer_->addVideoPacket(*packet);
+
+    if (packet->encoding() != proto::VIDEO_ENCODING_ZSTD)
     {
-        const proto::VideoPacketFormat& format = packet.format();
-        base::Size video_size(format.video_rect().width(), format.video_rect().height());
-        base::Size screen_size = video_size;
+        ++video_packet_count_;
 
-        static const int kMaxValue = std::numeric_limits<uint16_t>::max();
+        size_t packet_size = packet->ByteSizeLong();
 
-        if (video_size.width()  <= 0 || video_size.width()  >= kMaxValue ||
-            video_size.height() <= 0 || video_size.height() >= kMaxValue)
-        {
-            LOG(LS_ERROR) << "Wrong video frame size";
-            return;
-        }
+        avg_video_packet_ = calculateAvgSize(avg_video_packet_, packet_size);
+        min_video_packet_ = std::min(min_video_packet_, packet_size);
+        max_video_packet_ = std::max(max_video_packet_, packet_size);
+    }
 
-        if (format.has_screen_size())
-        {
-            screen_size = base::Size(
-                format.screen_size().width(), format.screen_size().height());
-
-            if (screen_size.width() <= 0 || screen_size.width() >= kMaxValue ||
-                screen_size.height() <= 0 || screen_size.height() >= kMaxValue)
-            {
-                LOG(LS_ERROR) << "Wrong screen size";
-                return;
-            }
-        }
+    FrameTimestamps timestamps;
+    timestamps.receive = base::SystemTime::microsecondsSinceEpoch();
 
-        video_capturer_type_ = format.capturer_type();
+    if (packet->has_timestamps())
+    {
+        const proto::VideoPacketTimestamps& host_timestamps = packet->timestamps();
 
-        LOG(LS_INFO) << "New video size: " << video_size.width() << "x" << video_size.height();
-        LOG(LS_INFO) << "New screen size: " << screen_size.width() << "x" << screen_size.height();
+        // The times of the host are converted to the clock of the client.
+        const std::optional<int64_t> clock_offset = clockOffset();
+        const int64_t offset = clock_offset.value_or(0);
 
-        desktop_frame_ = desktop_window_proxy_->allocateFrame(video_size);
-        desktop_window_proxy_->setFrame(screen_size, desktop_frame_);
+        auto to_local_time = [offset](int64_t host_time)
+        {
+            return host_time ? host_time - offset : 0;
+        };
+
+        timestamps.capture = to_local_time(host_timestamps.capture_time());
+        timestamps.diff = to_local_time(host_timestamps.diff_time());
+        timestamps.encode = to_local_time(host_timestamps.encode_time());
+        timestamps.send = to_local_time(host_timestamps.send_time());
+        timestamps.synchronized = clock_offset.has_value();
     }
 
-    if (!desktop_frame_)
-    {
-        LOG(LS_ERROR) << "The desktop frame is not initialized";
-        return;
-    }
+    // The packet is decoded on the decoder thread. If a packet is lost, the video can be continued
+    // only from a new key frame. The old hosts send it only after each configuration.
+    const uint32_t stream_id = packet->stream_id();
 
-    if (!video_decoder_->decode(packet, desktop_frame_.get()))
+    if (!video_decoder_thread_->decode(std::move(packet), timestamps))
     {
-        LOG(LS_ERROR) << "The video packet could not be decoded";
-        return;
-    }
-
-    ++video_packet_count_;
-    ++fps_frame_count_;
-
-    size_t packet_size = packet.ByteSizeLong();
-
-    avg_video_packet_ = calculateAvgSize(avg_video_packet_, packet_size);
-    min_video_packet_ = std::min(min_video_packet_, packet_size);
-    max_video_packet_ = std::max(max_video_packet_, packet_size);
+        LOG(LS_INFO) << "Key frame required";
 
-    desktop_window_proxy_->drawFrame();
+        if (video_recovery_)
+        {
+            outgoing_message_.clear();
+            outgoing_message_->mutable_video_recovery_request()->set_stream_id(stream_id);
+            sendMessage(*outgoing_message_);
+        }
+        else
+        {
+            setDesktopConfig(desktop_config_);
+        }
+    }
 }
 
 void ClientDesktop::readAudioPacket(const proto::AudioPacket& packet)
 {
+    if (webm_file_writer_)
+        webm_file_writer_->addAudioPacket(packet);
+
     if (!audio_player_)
         return;
 
@@ -446,8 +697,23 @@ void ClientDesktop::readAudioPacket(const proto::AudioPacket& packet)
     ++audio_packet_count_;
 
     std::unique_ptr<proto::AudioPacket> decoded_packet = audio_decoder_->decode(packet);
-    if (decoded_packet)
-        audio_player_->addPacket(std::move(decoded_packet));
+    if (!decoded_packet)
+        return;
+
+    // The old hosts do not send the capture time.
+    if (packet.capture_time())
+    {
+        const int64_t capture_time = packet.capture_time() - clockOffset().value_or(0);
+
+        // The packet is played after the audio which is already buffered.
+        const int64_t play_time = base::SystemTime::microsecondsSinceEpoch() +
+            std::chrono::microseconds(audio_player_->bufferedTime()).count();
+
+        audio_video_sync_.addAudio(capture_time, play_time);
+        audio_player_->setSyncDelay(audio_video_sync_.audioDelay());
+    }
+
+    audio_player_->addPacket(std::move(decoded_packet));
 }
 
 void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
@@ -477,6 +743,18 @@ void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
     desktop_window_proxy_->setMouseCursor(mouse_cursor);
 }
 
+void ClientDesktop::readCursorPosition(const proto::CursorPosition& cursor_position)
+{
+    if (!(desktop_config_.flags() & proto::ENABLE_CURSOR_POSITION))
+    {
+        LOG(LS_WARNING) << "Cursor position received but disabled in client";
+        return;
+    }
+
+    desktop_window_proxy_->setCursorPosition(
+        base::Point(cursor_position.x(), cursor_position.y()));
+}
+
 void ClientDesktop::readClipboardEvent(const proto::ClipboardEvent& event)
 {
     if (!clipboard_monitor_)
@@ -528,6 +806,17 @@ void ClientDesktop::readExtension(const proto::DesktopExtension& extension)
 
         desktop_window_proxy_->setSystemInfo(system_info);
     }
+    else if (extension.name() == common::kHostStatisticsExtension)
+    {
+        if (!host_statistics_.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse host statistics extension data";
+            has_host_statistics_ = false;
+            return;
+        }
+
+        has_host_statistics_ = true;
+    }
     else
     {
         LOG(LS_WARNING) << "Unknown extension: " << extension.name();
@@ -20,6 +20,10 @@
 #define CLIENT__CLIENT_DESKTOP_H
 
 #include "base/macros_magic.h"
+#include "base/memory/arena_message.h"
+#include "base/sample_window.h"
+#include "base/waitable_timer.h"
+#include "client/audio_video_sync.h"
 #include "client/client.h"
 #include "client/desktop_control.h"
 #include "client/input_event_filter.h"
@@ -29,8 +33,7 @@ namespace base {
 class AudioDecoder;
 class AudioPlayer;
 class CursorDecoder;
-class Frame;
-class VideoDecoder;
+class WebmFileWriter;
 } // namespace base
 
 namespace client {
@@ -39,6 +42,7 @@ class AudioRenderer;
 class DesktopControlProxy;
 class DesktopWindow;
 class DesktopWindowProxy;
+class VideoDecoderThread;
 
 class ClientDesktop
     : public Client,
@@ -55,12 +59,17 @@ public:
     void setDesktopConfig(const proto::DesktopConfig& config) override;
     void setCurrentScreen(const proto::Screen& screen) override;
     void setPreferredSize(int width, int height) override;
+    void setMouseMoveRate(int rate) override;
+    void setWindowActive(bool active) override;
+    void setWindowVisible(bool visible) override;
     void onKeyEvent(const proto::KeyEvent& event) override;
     void onMouseEvent(const proto::MouseEvent& event) override;
     void onPowerControl(proto::PowerControl::Action action) override;
     void onRemoteUpdate() override;
-    void onSystemInfoRequest() override;
+    void onSystemInfoRequest(bool refresh) override;
     void onMetricsRequest() override;
+    void setVideoRecording(bool enable, const std::filesystem::path& file_path) override;
+    void onFramePainted(const FrameTimestamps& timestamps) override;
 
 protected:
     // Client implementation.
@@ -75,32 +84,42 @@ protected:
 
 private:
     void readConfigRequest(const proto::DesktopConfigRequest& config_request);
-    void readVideoPacket(const proto::VideoPacket& packet);
+    void readVideoPacket(std::unique_ptr<proto::VideoPacket> packet);
     void readAudioPacket(const proto::AudioPacket& packet);
     void readCursorShape(const proto::CursorShape& cursor_shape);
+    void readCursorPosition(const proto::CursorPosition& cursor_position);
     void readClipboardEvent(const proto::ClipboardEvent& event);
     void readExtension(const proto::DesktopExtension& extension);
+    void sendMouseEvent(const proto::MouseEvent& event);
+    void sendPendingMouseEvent();
+
+    // Tells the host whether the video is needed. It is needed while the window is visible or the
+    // video is recorded.
+    void sendVisibility();
 
     bool started_ = false;
+    bool window_visible_ = true;
+    bool visibility_sent_ = true;
 
     std::shared_ptr<DesktopControlProxy> desktop_control_proxy_;
     std::shared_ptr<DesktopWindowProxy> desktop_window_proxy_;
-    std::shared_ptr<base::Frame> desktop_frame_;
     proto::DesktopConfig desktop_config_;
 
     std::unique_ptr<proto::HostToClient> incoming_message_;
-    std::unique_ptr<proto::ClientToHost> outgoing_message_;
+    base::ArenaMessage<proto::ClientToHost> outgoing_message_;
 
-    proto::VideoEncoding video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
     proto::AudioEncoding audio_encoding_ = proto::AUDIO_ENCODING_UNKNOWN;
 
-    std::unique_ptr<base::VideoDecoder> video_decoder_;
+    std::unique_ptr<VideoDecoderThread> video_decoder_thread_;
     std::unique_ptr<base::CursorDecoder> cursor_decoder_;
     std::unique_ptr<base::AudioDecoder> audio_decoder_;
     std::unique_ptr<base::AudioPlayer> audio_player_;
+    AudioVideoSync audio_video_sync_;
     std::unique_ptr<common::ClipboardMonitor> clipboard_monitor_;
+    std::unique_ptr<base::WebmFileWriter> webm_file_writer_;
 
     InputEventFilter input_event_filter_;
+    base::WaitableTimer mouse_move_timer_;
 
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
@@ -108,6 +127,7 @@ private:
     int64_t video_packet_count_ = 0;
     int64_t audio_packet_count_ = 0;
     uint32_t video_capturer_type_ = 0;
+    bool video_recovery_ = false;
     TimePoint start_time_;
     TimePoint fps_time_;
     int64_t fps_frame_count_ = 0;
@@ -119,6 +139,22 @@ private:
     size_t avg_audio_packet_ = 0;
     int fps_ = 0;
 
+    // The last statistics of the host. They are requested with each update of the metrics.
+    bool host_statistics_supported_ = false;
+    bool has_host_statistics_ = false;
+    proto::HostStatistics host_statistics_;
+
+    // Bitmask of the built-in Zstd dictionaries supported by the host and the client.
+    uint32_t zstd_dictionaries_ = 0;
+
+    // Latency of the video frames by stages.
+    base::SampleWindow capture_latency_;
+    base::SampleWindow encode_latency_;
+    base::SampleWindow network_latency_;
+    base::SampleWindow decode_latency_;
+    base::SampleWindow paint_latency_;
+    base::SampleWindow total_latency_;
+
     DISALLOW_COPY_AND_ASSIGN(ClientDesktop);
 };
 
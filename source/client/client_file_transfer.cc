@@ -84,14 +84,29 @@ void ClientFileTransfer::onMessageReceived(const base::ByteArray& buffer)
     }
     else if (!remote_task_queue_.empty())
     {
-        // Move the reply to the request and notify the sender.
-        remote_task_queue_.front()->setReply(std::move(reply));
-
-        // Remove the request from the queue.
-        remote_task_queue_.pop();
+        // The host that does not support request identifiers replies to the requests in the order
+        // in which they were sent. Otherwise the replies of different lanes can come in any order.
+        auto it = remote_task_queue_.begin();
+        if (reply->request_id())
+        {
+            while (it != remote_task_queue_.end() &&
+                   (*it)->request().request_id() != reply->request_id())
+            {
+                ++it;
+            }
+
+            if (it == remote_task_queue_.end())
+            {
+                LOG(LS_ERROR) << "Reply to an unknown request: " << reply->request_id();
+                return;
+            }
+        }
+
+        std::shared_ptr<common::FileTask> task = std::move(*it);
+        remote_task_queue_.erase(it);
 
-        // Execute the next request.
-        doNextRemoteTask();
+        // Move the reply to the request and notify the sender.
+        task->setReply(std::move(reply));
     }
     else
     {
@@ -141,26 +156,18 @@ void ClientFileTransfer::doTask(std::shared_ptr<common::FileTask> task)
     }
     else
     {
-        const bool schedule = remote_task_queue_.empty();
+        // The request is sent without waiting for replies to the previous ones. This allows the
+        // file transfer to keep several packets in flight.
+        if (++next_request_id_ == 0)
+            ++next_request_id_;
 
-        // Add the request to the queue.
-        remote_task_queue_.emplace(std::move(task));
+        task->setRequestId(next_request_id_);
 
-        // If the request queue was empty, then run execution.
-        if (schedule)
-            doNextRemoteTask();
+        sendMessage(task->request());
+        remote_task_queue_.emplace_back(std::move(task));
     }
 }
 
-void ClientFileTransfer::doNextRemoteTask()
-{
-    if (remote_task_queue_.empty())
-        return;
-
-    // Send a request to the remote computer.
-    sendMessage(remote_task_queue_.front()->request());
-}
-
 common::FileTaskFactory* ClientFileTransfer::taskFactory(common::FileTask::Target target)
 {
     common::FileTaskFactory* task_factory;
@@ -184,9 +191,11 @@ void ClientFileTransfer::driveList(common::FileTask::Target target)
     task_consumer_proxy_->doTask(taskFactory(target)->driveList());
 }
 
-void ClientFileTransfer::fileList(common::FileTask::Target target, const std::string& path)
+void ClientFileTransfer::fileList(common::FileTask::Target target,
+                                  const std::string& path,
+                                  bool next_page)
 {
-    task_consumer_proxy_->doTask(taskFactory(target)->fileList(path));
+    task_consumer_proxy_->doTask(taskFactory(target)->fileListPage(path, next_page));
 }
 
 void ClientFileTransfer::createDirectory(common::FileTask::Target target, const std::string& path)
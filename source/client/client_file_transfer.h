@@ -24,6 +24,8 @@
 #include "common/file_task_consumer.h"
 #include "common/file_task_producer.h"
 
+#include <deque>
+
 namespace common {
 class FileTaskConsumerProxy;
 class FileTaskProducerProxy;
@@ -67,13 +69,13 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void doNextRemoteTask();
-
     common::FileTaskFactory* taskFactory(common::FileTask::Target target);
 
     // FileControl implementation.
     void driveList(common::FileTask::Target target) override;
-    void fileList(common::FileTask::Target target, const std::string& path) override;
+    void fileList(common::FileTask::Target target,
+                  const std::string& path,
+                  bool next_page) override;
     void createDirectory(common::FileTask::Target target, const std::string& path) override;
     void rename(common::FileTask::Target target,
                 const std::string& old_path,
@@ -93,7 +95,8 @@ private:
     std::unique_ptr<common::FileTaskFactory> local_task_factory_;
     std::unique_ptr<common::FileTaskFactory> remote_task_factory_;
 
-    std::queue<std::shared_ptr<common::FileTask>> remote_task_queue_;
+    std::deque<std::shared_ptr<common::FileTask>> remote_task_queue_;
+    uint32_t next_request_id_ = 0;
     std::unique_ptr<common::FileWorker> local_worker_;
 
     std::shared_ptr<FileControlProxy> file_control_proxy_;
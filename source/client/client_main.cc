@@ -19,6 +19,7 @@
 #include "client/client_main.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "build/version.h"
 #include "client/config_factory.h"
 #include "client/ui/application.h"
@@ -42,6 +43,7 @@ int clientMain(int argc, char* argv[])
     client::Application::setAttribute(Qt::AA_UseHighDpiPixmaps, true);
 
     client::Application application(argc, argv);
+    base::TraceLog::startFromEnvironment("client");
 
     QCommandLineOption address_option("address",
         QApplication::translate("Client", "Remote computer address."), "address");
@@ -142,5 +144,7 @@ int clientMain(int argc, char* argv[])
         client_window->activateWindow();
     }
 
-    return application.exec();
+    int result = application.exec();
+    base::TraceLog::finish();
+    return result;
 }
@@ -19,6 +19,7 @@
 #include "client/config_factory.h"
 
 #include "base/logging.h"
+#include "base/codec/audio_encoder_opus.h"
 
 namespace client {
 
@@ -26,6 +27,7 @@ namespace {
 
 const proto::VideoEncoding kDefaultVideoEncoding = proto::VIDEO_ENCODING_VP8;
 const proto::AudioEncoding kDefaultAudioEncoding = proto::AUDIO_ENCODING_OPUS;
+const uint32_t kDefaultAudioFrameDuration = 10; // In milliseconds.
 
 } // namespace
 
@@ -45,6 +47,19 @@ proto::DesktopConfig ConfigFactory::defaultDesktopViewConfig()
     return config;
 }
 
+// static
+proto::DesktopConfig ConfigFactory::thumbnailConfig()
+{
+    proto::DesktopConfig config;
+
+    config.set_flags(proto::ENABLE_THUMBNAIL_MODE);
+    config.set_video_encoding(proto::VIDEO_ENCODING_VP8);
+    config.set_audio_encoding(proto::AUDIO_ENCODING_UNKNOWN);
+
+    fixupDesktopConfig(&config);
+    return config;
+}
+
 // static
 void ConfigFactory::setDefaultDesktopManageConfig(proto::DesktopConfig* config)
 {
@@ -89,6 +104,20 @@ void ConfigFactory::fixupDesktopConfig(proto::DesktopConfig* config)
 
     if (config->audio_encoding() == proto::AUDIO_ENCODING_DEFAULT)
         config->set_audio_encoding(kDefaultAudioEncoding);
+
+    // Short audio frames are used to keep the audio latency low.
+    if (!base::AudioEncoderOpus::isValidFrameDuration(
+            std::chrono::milliseconds(config->audio_frame_duration())))
+    {
+        config->set_audio_frame_duration(kDefaultAudioFrameDuration);
+    }
+
+    // The client always supports the keyed cursor cache, the tile cache, the copy rects, the
+    // cursor positions, the packed dirty rects and the clipboard chunks.
+    config->set_flags(config->flags() | proto::ENABLE_KEYED_CURSOR_CACHE |
+                      proto::ENABLE_TILE_CACHE | proto::ENABLE_COPY_RECT |
+                      proto::ENABLE_CURSOR_POSITION | proto::ENABLE_PACKED_DIRTY_RECTS |
+                      proto::ENABLE_CLIPBOARD_CHUNKS);
 }
 
 } // namespace client
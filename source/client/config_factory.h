@@ -30,6 +30,10 @@ public:
     static proto::DesktopConfig defaultDesktopManageConfig();
     static proto::DesktopConfig defaultDesktopViewConfig();
 
+    // The configuration of a view session for a thumbnail of the monitoring wall: a small video at
+    // 1 fps with the cheapest encoding and without the audio and the cursor.
+    static proto::DesktopConfig thumbnailConfig();
+
     static void setDefaultDesktopManageConfig(proto::DesktopConfig* config);
     static void setDefaultDesktopViewConfig(proto::DesktopConfig* config);
 
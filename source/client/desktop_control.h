@@ -22,8 +22,12 @@
 #include "proto/desktop.pb.h"
 #include "proto/desktop_extensions.pb.h"
 
+#include <filesystem>
+
 namespace client {
 
+struct FrameTimestamps;
+
 class DesktopControl
 {
 public:
@@ -33,12 +37,37 @@ public:
     virtual void setCurrentScreen(const proto::Screen& screen) = 0;
     virtual void setPreferredSize(int width, int height) = 0;
 
+    // Sets how many times per second the mouse moves are sent (see
+    // InputEventFilter::setMouseMoveRate()).
+    virtual void setMouseMoveRate(int rate) = 0;
+
+    // Called when the window of the session is activated or deactivated. The video of the inactive
+    // windows is decoded with a lower priority.
+    virtual void setWindowActive(bool active) = 0;
+
+    // Called when the window of the session is minimized, hidden or shown again. The host does not
+    // send the video while the window is not visible.
+    virtual void setWindowVisible(bool visible) = 0;
+
     virtual void onKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void onMouseEvent(const proto::MouseEvent& event) = 0;
     virtual void onPowerControl(proto::PowerControl::Action action) = 0;
     virtual void onRemoteUpdate() = 0;
-    virtual void onSystemInfoRequest() = 0;
+
+    // Requests the system information of the host. The fast categories are requested first, so
+    // they are shown without waiting for the enumeration of the drives, printers and adapters. If
+    // |refresh| is true, the host collects the information again instead of using its cache.
+    virtual void onSystemInfoRequest(bool refresh) = 0;
+
     virtual void onMetricsRequest() = 0;
+
+    // Starts or stops writing the encoded video and audio of the session into WebM files in the
+    // directory |file_path|.
+    virtual void setVideoRecording(bool enable, const std::filesystem::path& file_path) = 0;
+
+    // Called when the frame is on the screen of the client. |timestamps| contain all stages of the
+    // frame.
+    virtual void onFramePainted(const FrameTimestamps& timestamps) = 0;
 };
 
 } // namespace client
@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "client/desktop_control.h"
+#include "client/frame_timestamps.h"
 
 namespace client {
 
@@ -83,6 +84,45 @@ void DesktopControlProxy::setPreferredSize(int width, int height)
         desktop_control_->setPreferredSize(width, height);
 }
 
+void DesktopControlProxy::setMouseMoveRate(int rate)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setMouseMoveRate, shared_from_this(), rate));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setMouseMoveRate(rate);
+}
+
+void DesktopControlProxy::setWindowActive(bool active)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setWindowActive, shared_from_this(), active));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setWindowActive(active);
+}
+
+void DesktopControlProxy::setWindowVisible(bool visible)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setWindowVisible, shared_from_this(), visible));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setWindowVisible(visible);
+}
+
 void DesktopControlProxy::onKeyEvent(const proto::KeyEvent& event)
 {
     if (!io_task_runner_->belongsToCurrentThread())
@@ -135,17 +175,17 @@ void DesktopControlProxy::onRemoteUpdate()
         desktop_control_->onRemoteUpdate();
 }
 
-void DesktopControlProxy::onSystemInfoRequest()
+void DesktopControlProxy::onSystemInfoRequest(bool refresh)
 {
     if (!io_task_runner_->belongsToCurrentThread())
     {
         io_task_runner_->postTask(
-            std::bind(&DesktopControlProxy::onSystemInfoRequest, shared_from_this()));
+            std::bind(&DesktopControlProxy::onSystemInfoRequest, shared_from_this(), refresh));
         return;
     }
 
     if (desktop_control_)
-        desktop_control_->onSystemInfoRequest();
+        desktop_control_->onSystemInfoRequest(refresh);
 }
 
 void DesktopControlProxy::onMetricsRequest()
@@ -161,4 +201,30 @@ void DesktopControlProxy::onMetricsRequest()
         desktop_control_->onMetricsRequest();
 }
 
+void DesktopControlProxy::setVideoRecording(bool enable, const std::filesystem::path& file_path)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(std::bind(
+            &DesktopControlProxy::setVideoRecording, shared_from_this(), enable, file_path));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setVideoRecording(enable, file_path);
+}
+
+void DesktopControlProxy::onFramePainted(const FrameTimestamps& timestamps)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::onFramePainted, shared_from_this(), timestamps));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->onFramePainted(timestamps);
+}
+
 } // namespace client
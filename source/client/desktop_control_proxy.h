@@ -23,6 +23,8 @@
 #include "proto/desktop.pb.h"
 #include "proto/desktop_extensions.pb.h"
 
+#include <filesystem>
+
 namespace base {
 class TaskRunner;
 } // namespace base
@@ -30,6 +32,7 @@ class TaskRunner;
 namespace client {
 
 class DesktopControl;
+struct FrameTimestamps;
 
 class DesktopControlProxy : public std::enable_shared_from_this<DesktopControlProxy>
 {
@@ -43,12 +46,17 @@ public:
     void setDesktopConfig(const proto::DesktopConfig& desktop_config);
     void setCurrentScreen(const proto::Screen& screen);
     void setPreferredSize(int width, int height);
+    void setMouseMoveRate(int rate);
+    void setWindowActive(bool active);
+    void setWindowVisible(bool visible);
     void onKeyEvent(const proto::KeyEvent& event);
     void onMouseEvent(const proto::MouseEvent& event);
     void onPowerControl(proto::PowerControl::Action action);
     void onRemoteUpdate();
-    void onSystemInfoRequest();
+    void onSystemInfoRequest(bool refresh);
     void onMetricsRequest();
+    void setVideoRecording(bool enable, const std::filesystem::path& file_path);
+    void onFramePainted(const FrameTimestamps& timestamps);
 
 private:
     std::shared_ptr<base::TaskRunner> io_task_runner_;
@@ -26,6 +26,8 @@
 namespace base {
 class Frame;
 class MouseCursor;
+class Point;
+class Region;
 class Size;
 class Version;
 } // namespace base
@@ -39,13 +41,42 @@ class SystemInfo;
 namespace client {
 
 class DesktopControlProxy;
+class DoubleBufferedFrame;
 class FrameFactory;
+struct FrameTimestamps;
 
 class DesktopWindow
 {
 public:
     virtual ~DesktopWindow() = default;
 
+    // Percentiles of the latency of a stage of the video (microseconds).
+    struct Latency
+    {
+        size_t count = 0;
+        int64_t p50 = 0;
+        int64_t p95 = 0;
+        int64_t p99 = 0;
+    };
+
+    // The performance of the host for the video of this client.
+    struct HostStatistics
+    {
+        int capture_fps = 0;
+        int encode_fps = 0;
+        int drop_fps = 0;
+        std::chrono::microseconds capture_time { 0 };
+        std::chrono::microseconds encode_time { 0 };
+        uint32_t bitrate = 0;
+
+        // -1 if the encoder of the host does not report it.
+        int quantizer = -1;
+
+        size_t pending_bytes = 0;
+        size_t pending_messages = 0;
+        uint64_t memory_usage = 0;
+    };
+
     struct Metrics
     {
         std::chrono::seconds duration;
@@ -68,6 +99,23 @@ public:
         int send_key = 0;
         int read_clipboard = 0;
         int send_clipboard = 0;
+
+        // The network and total latency are known only when the clock offset of the host is
+        // estimated.
+        Latency capture_latency;
+        Latency encode_latency;
+        Latency network_latency;
+        Latency decode_latency;
+        Latency paint_latency;
+        Latency total_latency;
+
+        // The audio held by the jitter buffer of the client and the arrival jitter of the audio.
+        std::chrono::milliseconds audio_buffer { 0 };
+        std::chrono::milliseconds audio_jitter { 0 };
+
+        // The statistics are received only from the hosts which support them.
+        bool has_host_statistics = false;
+        HostStatistics host_statistics;
     };
 
     virtual void showWindow(std::shared_ptr<DesktopControlProxy> desktop_control_proxy,
@@ -82,9 +130,17 @@ public:
 
     virtual std::unique_ptr<FrameFactory> frameFactory() = 0;
     virtual void setFrame(const base::Size& screen_size,
-                          std::shared_ptr<base::Frame> frame) = 0;
-    virtual void drawFrame() = 0;
+                          std::shared_ptr<DoubleBufferedFrame> frame) = 0;
+    // Draws the frame again. |updated_region| is the area of the frame changed since the previous
+    // call. |timestamps| are completed with the paint time and returned through
+    // DesktopControlProxy::onFramePainted(). They are empty for the frames that are not measured.
+    virtual void drawFrame(const base::Region& updated_region,
+                           const FrameTimestamps& timestamps) = 0;
     virtual void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) = 0;
+
+    // The cursor has been moved on the host by something else than the input of the client.
+    // |position| of the hotspot is in the coordinates of the frame.
+    virtual void setCursorPosition(const base::Point& position) = 0;
 };
 
 } // namespace client
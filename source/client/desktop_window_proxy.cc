@@ -22,9 +22,11 @@
 #include "base/task_runner.h"
 #include "base/version.h"
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
 #include "client/desktop_control_proxy.h"
 #include "client/desktop_window.h"
 #include "client/frame_factory.h"
+#include "client/frame_timestamps.h"
 #include "proto/desktop.pb.h"
 #include "proto/desktop_extensions.pb.h"
 
@@ -139,7 +141,7 @@ void DesktopWindowProxy::showWindow(
 }
 
 void DesktopWindowProxy::setFrame(
-    const base::Size& screen_size, std::shared_ptr<base::Frame> frame)
+    const base::Size& screen_size, std::shared_ptr<DoubleBufferedFrame> frame)
 {
     if (!ui_task_runner_->belongsToCurrentThread())
     {
@@ -152,16 +154,20 @@ void DesktopWindowProxy::setFrame(
         desktop_window_->setFrame(screen_size, frame);
 }
 
-void DesktopWindowProxy::drawFrame()
+void DesktopWindowProxy::drawFrame(
+    const base::Region& updated_region, const FrameTimestamps& timestamps)
 {
     if (!ui_task_runner_->belongsToCurrentThread())
     {
-        ui_task_runner_->postTask(std::bind(&DesktopWindowProxy::drawFrame, shared_from_this()));
+        ui_task_runner_->postTask(std::bind(&DesktopWindowProxy::drawFrame,
+                                            shared_from_this(),
+                                            updated_region,
+                                            timestamps));
         return;
     }
 
     if (desktop_window_)
-        desktop_window_->drawFrame();
+        desktop_window_->drawFrame(updated_region, timestamps);
 }
 
 void DesktopWindowProxy::setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor)
@@ -177,4 +183,17 @@ void DesktopWindowProxy::setMouseCursor(std::shared_ptr<base::MouseCursor> mouse
         desktop_window_->setMouseCursor(mouse_cursor);
 }
 
+void DesktopWindowProxy::setCursorPosition(const base::Point& position)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(
+            std::bind(&DesktopWindowProxy::setCursorPosition, shared_from_this(), position));
+        return;
+    }
+
+    if (desktop_window_)
+        desktop_window_->setCursorPosition(position);
+}
+
 } // namespace client
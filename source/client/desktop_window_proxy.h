@@ -52,9 +52,10 @@ public:
     void setMetrics(const DesktopWindow::Metrics& metrics);
 
     std::shared_ptr<base::Frame> allocateFrame(const base::Size& size);
-    void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame);
-    void drawFrame();
+    void setFrame(const base::Size& screen_size, std::shared_ptr<DoubleBufferedFrame> frame);
+    void drawFrame(const base::Region& updated_region, const FrameTimestamps& timestamps);
     void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor);
+    void setCursorPosition(const base::Point& position);
 
 private:
     std::shared_ptr<base::TaskRunner> ui_task_runner_;
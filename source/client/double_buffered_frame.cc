@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/double_buffered_frame.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+namespace client {
+
+DoubleBufferedFrame::DoubleBufferedFrame(
+    std::shared_ptr<base::Frame> front, std::shared_ptr<base::Frame> back)
+    : front_(std::move(front)),
+      back_(std::move(back))
+{
+    DCHECK(front_ && back_);
+    DCHECK(front_->size() == back_->size());
+}
+
+DoubleBufferedFrame::~DoubleBufferedFrame() = default;
+
+const base::Size& DoubleBufferedFrame::size() const
+{
+    // The frames have the same size, and |back_| is never replaced, so the lock is not needed.
+    return back_->size();
+}
+
+base::Frame* DoubleBufferedFrame::backFrame()
+{
+    // The front frame is changed only by swap() on this thread. The UI thread can read it at the
+    // same time, which is safe.
+    for (base::Region::Iterator it(outdated_region_); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+        back_->copyPixelsFrom(*front_, rect.topLeft(), rect);
+    }
+
+    outdated_region_.clear();
+    return back_.get();
+}
+
+void DoubleBufferedFrame::swap(const base::Region& updated_region)
+{
+    {
+        std::scoped_lock lock(lock_);
+        front_.swap(back_);
+    }
+
+    // The previous front frame does not contain the changes yet.
+    outdated_region_.addRegion(updated_region);
+}
+
+DoubleBufferedFrame::ScopedFront::ScopedFront(DoubleBufferedFrame* frame)
+    : lock_(frame->lock_),
+      frame_(frame->front_.get())
+{
+    // Nothing
+}
+
+DoubleBufferedFrame::ScopedFront::~ScopedFront() = default;
+
+} // namespace client
@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__DOUBLE_BUFFERED_FRAME_H
+#define CLIENT__DOUBLE_BUFFERED_FRAME_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <memory>
+#include <mutex>
+
+namespace base {
+class Frame;
+} // namespace base
+
+namespace client {
+
+// Pair of frames shared between the decoder thread and the UI thread. The decoder writes into the
+// back frame while the UI thread reads the front frame, so they never touch the same pixels. When
+// a packet is decoded, the frames are swapped. Only the swap and the reading of the front frame
+// take the lock, the decoding itself does not block the UI thread.
+class DoubleBufferedFrame
+{
+public:
+    DoubleBufferedFrame(std::shared_ptr<base::Frame> front, std::shared_ptr<base::Frame> back);
+    ~DoubleBufferedFrame();
+
+    const base::Size& size() const;
+
+    // Called on the decoder thread. Returns the back frame with the content of the front frame.
+    // Only the area changed by the previous swap is copied.
+    base::Frame* backFrame();
+
+    // Called on the decoder thread. Makes the back frame visible. |updated_region| is the area of
+    // the back frame changed since the call of backFrame().
+    void swap(const base::Region& updated_region);
+
+    // Gives access to the front frame on the UI thread. The frames are not swapped while the
+    // object exists, so it must not be kept longer than needed to read the pixels.
+    class ScopedFront
+    {
+    public:
+        explicit ScopedFront(DoubleBufferedFrame* frame);
+        ~ScopedFront();
+
+        const base::Frame* frame() const { return frame_; }
+
+    private:
+        std::scoped_lock<std::mutex> lock_;
+        const base::Frame* frame_;
+
+        DISALLOW_COPY_AND_ASSIGN(ScopedFront);
+    };
+
+private:
+    std::mutex lock_;
+    std::shared_ptr<base::Frame> front_;
+
+    // Accessed only on the decoder thread.
+    std::shared_ptr<base::Frame> back_;
+
+    // The area in which the back frame differs from the front frame.
+    base::Region outdated_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(DoubleBufferedFrame);
+};
+
+} // namespace client
+
+#endif // CLIENT__DOUBLE_BUFFERED_FRAME_H
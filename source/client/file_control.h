@@ -30,7 +30,10 @@ public:
     virtual ~FileControl() = default;
 
     virtual void driveList(common::FileTask::Target target) = 0;
-    virtual void fileList(common::FileTask::Target target, const std::string& path) = 0;
+    // The list is received by pages. If |next_page| is true, the next page of |path| is requested.
+    virtual void fileList(common::FileTask::Target target,
+                          const std::string& path,
+                          bool next_page) = 0;
     virtual void createDirectory(common::FileTask::Target target, const std::string& path) = 0;
 
     virtual void rename(common::FileTask::Target target,
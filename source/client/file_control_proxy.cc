@@ -56,17 +56,18 @@ void FileControlProxy::driveList(common::FileTask::Target target)
         file_control_->driveList(target);
 }
 
-void FileControlProxy::fileList(common::FileTask::Target target, const std::string& path)
+void FileControlProxy::fileList(
+    common::FileTask::Target target, const std::string& path, bool next_page)
 {
     if (!io_task_runner_->belongsToCurrentThread())
     {
         io_task_runner_->postTask(
-            std::bind(&FileControlProxy::fileList, shared_from_this(), target, path));
+            std::bind(&FileControlProxy::fileList, shared_from_this(), target, path, next_page));
         return;
     }
 
     if (file_control_)
-        file_control_->fileList(target, path);
+        file_control_->fileList(target, path, next_page);
 }
 
 void FileControlProxy::createDirectory(common::FileTask::Target target, const std::string& path)
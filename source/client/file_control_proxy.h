@@ -36,7 +36,7 @@ public:
     void dettach();
 
     void driveList(common::FileTask::Target target);
-    void fileList(common::FileTask::Target target, const std::string& path);
+    void fileList(common::FileTask::Target target, const std::string& path, bool next_page);
     void createDirectory(common::FileTask::Target target, const std::string& path);
 
     void rename(common::FileTask::Target target,
@@ -56,6 +56,18 @@ void FileRemover::start(const TaskList& items, const FinishCallback& callback)
     // Asynchronously start UI.
     remove_window_proxy_->start(remover_proxy_);
 
+    // The peer removes the contents of directories itself. It is much faster than a request for
+    // each item when the peer is far away.
+    tasks_ = items;
+    tasks_count_ = tasks_.size();
+
+    doCurrentTask();
+}
+
+void FileRemover::buildQueue(const TaskList& items)
+{
+    remove_tree_ = false;
+
     queue_builder_ = std::make_unique<FileRemoveQueueBuilder>(
         task_consumer_proxy_, task_factory_->target());
 
@@ -82,6 +94,7 @@ void FileRemover::stop()
 {
     queue_builder_.reset();
     tasks_.clear();
+    failures_.clear();
 
     onFinished();
 }
@@ -91,13 +104,29 @@ void FileRemover::setAction(Action action)
     switch (action)
     {
         case ACTION_SKIP:
-            doNextTask();
-            break;
+        {
+            if (failures_.empty())
+            {
+                doNextTask();
+            }
+            else
+            {
+                failures_.pop_front();
+                doFailures();
+            }
+        }
+        break;
 
         case ACTION_SKIP_ALL:
+        {
             failure_action_ = action;
-            doNextTask();
-            break;
+
+            if (failures_.empty())
+                doNextTask();
+            else
+                doFailures();
+        }
+        break;
 
         case ACTION_ABORT:
             onFinished();
@@ -121,6 +150,26 @@ void FileRemover::onTaskDone(std::shared_ptr<common::FileTask> task)
         return;
     }
 
+    if (request.remove_request().recursive())
+    {
+        if (reply.has_remove_result())
+        {
+            if (reply.error_code() == proto::FILE_ERROR_SUCCESS)
+            {
+                onRemoveTreeDone(reply);
+                return;
+            }
+        }
+        else if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            // The peer does not support recursive removal. It could not remove a non-empty
+            // directory. The remaining items are listed and removed one by one.
+            LOG(LS_INFO) << "Recursive removal is not supported by the peer";
+            buildQueue(tasks_);
+            return;
+        }
+    }
+
     if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
     {
         uint32_t actions;
@@ -153,6 +202,49 @@ void FileRemover::onTaskDone(std::shared_ptr<common::FileTask> task)
     doNextTask();
 }
 
+void FileRemover::onRemoveTreeDone(const proto::FileReply& reply)
+{
+    const proto::RemoveResult& result = reply.remove_result();
+
+    has_more_ = result.has_more();
+
+    for (int i = 0; i < result.failure_size(); ++i)
+        failures_.emplace_back(result.failure(i).path(), result.failure(i).error_code());
+
+    if (!result.last_path().empty())
+    {
+        DCHECK_NE(tasks_count_, 0u);
+
+        const size_t percentage = (tasks_count_ - tasks_.size()) * 100 / tasks_count_;
+        remove_window_proxy_->setCurrentProgress(result.last_path(), percentage);
+    }
+
+    doFailures();
+}
+
+void FileRemover::doFailures()
+{
+    if (failure_action_ != ACTION_ASK)
+        failures_.clear();
+
+    if (!failures_.empty())
+    {
+        const auto& failure = failures_.front();
+        remove_window_proxy_->errorOccurred(
+            failure.first, failure.second, ACTION_ABORT | ACTION_SKIP | ACTION_SKIP_ALL);
+        return;
+    }
+
+    if (has_more_)
+    {
+        // Continue the removal of the current item.
+        task_consumer_proxy_->doTask(task_factory_->removeTree(tasks_.front().path(), true));
+        return;
+    }
+
+    doNextTask();
+}
+
 void FileRemover::doNextTask()
 {
     // The task is completed. We delete it.
@@ -170,7 +262,7 @@ void FileRemover::doCurrentTask()
         return;
     }
 
-    DCHECK_NE(tasks_count_, 0);
+    DCHECK_NE(tasks_count_, 0u);
 
     const size_t percentage = (tasks_count_ - tasks_.size()) * 100 / tasks_count_;
     const std::string& path = tasks_.front().path();
@@ -178,8 +270,13 @@ void FileRemover::doCurrentTask()
     // Updating progress in UI.
     remove_window_proxy_->setCurrentProgress(path, percentage);
 
+    has_more_ = false;
+
     // Send a request to delete the next item.
-    task_consumer_proxy_->doTask(task_factory_->remove(path));
+    if (remove_tree_)
+        task_consumer_proxy_->doTask(task_factory_->removeTree(path, false));
+    else
+        task_consumer_proxy_->doTask(task_factory_->remove(path));
 }
 
 void FileRemover::onFinished()
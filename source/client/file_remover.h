@@ -21,10 +21,12 @@
 
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
+#include "proto/file_transfer.pb.h"
 
 #include <functional>
 #include <deque>
 #include <string>
+#include <utility>
 
 namespace base {
 class TaskRunner;
@@ -93,6 +95,9 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
+    void onRemoveTreeDone(const proto::FileReply& reply);
+    void doFailures();
+    void buildQueue(const TaskList& items);
     void doNextTask();
     void doCurrentTask();
     void onFinished();
@@ -108,6 +113,14 @@ private:
     TaskList tasks_;
     FinishCallback finish_callback_;
 
+    // While true, each item is removed by the peer together with its contents. Old peers do not
+    // support it and the items are listed by the queue builder.
+    bool remove_tree_ = true;
+    // The peer has not finished the removal of the current item.
+    bool has_more_ = false;
+    // Items inside the current item that the peer could not remove.
+    std::deque<std::pair<std::string, proto::FileError>> failures_;
+
     Action failure_action_ = ACTION_ASK;
     size_t tasks_count_ = 0;
 
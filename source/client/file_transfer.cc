@@ -27,10 +27,20 @@
 #include "common/file_task_producer_proxy.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+
 namespace client {
 
 namespace {
 
+// If the packet is written by the target faster than this, the size of the packets is doubled.
+const std::chrono::milliseconds kMinPacketTime(250);
+
+// If the packet is written by the target slower than this, the size of the packets is halved. This
+// limits the amount of data in flight on slow connections, so progress and cancellation stay
+// responsive.
+const std::chrono::milliseconds kMaxPacketTime(1000);
+
 struct ActionsMap
 {
     FileTransfer::Error::Type type;
@@ -82,6 +92,26 @@ struct ActionsMap
     }
 };
 
+// Returns the size of the blocks in which an existing file is compared with the new one or 0 if
+// the file is too small or too large for it.
+uint32_t deltaBlockSize(int64_t file_size)
+{
+    if (file_size <= static_cast<int64_t>(common::kMinDeltaBlockSize))
+        return 0;
+
+    int64_t block_size = common::kMinDeltaBlockSize;
+
+    while ((file_size + block_size - 1) / block_size > common::kMaxDeltaBlocks)
+    {
+        block_size *= 2;
+
+        if (block_size > static_cast<int64_t>(common::kMaxFileChunkSize))
+            return 0;
+    }
+
+    return static_cast<uint32_t>(block_size);
+}
+
 } // namespace
 
 FileTransfer::FileTransfer(std::shared_ptr<base::TaskRunner> io_task_runner,
@@ -94,7 +124,8 @@ FileTransfer::FileTransfer(std::shared_ptr<base::TaskRunner> io_task_runner,
       task_consumer_proxy_(std::move(task_consumer_proxy)),
       task_producer_proxy_(std::make_shared<common::FileTaskProducerProxy>(this)),
       cancel_timer_(base::WaitableTimer::Type::SINGLE_SHOT, io_task_runner),
-      type_(type)
+      type_(type),
+      packet_size_(common::kMaxFilePacketSize)
 {
     // Nothing
 }
@@ -112,64 +143,62 @@ void FileTransfer::start(const std::string& source_path,
 {
     finish_callback_ = finish_callback;
 
-    std::unique_ptr<common::FileTaskFactory> task_factory_local =
-        std::make_unique<common::FileTaskFactory>(
-            task_producer_proxy_, common::FileTask::Target::LOCAL);
-
-    std::unique_ptr<common::FileTaskFactory> task_factory_remote =
-        std::make_unique<common::FileTaskFactory>(
-            task_producer_proxy_, common::FileTask::Target::REMOTE);
+    const common::FileTask::Target source_target = (type_ == Type::DOWNLOADER) ?
+        common::FileTask::Target::REMOTE : common::FileTask::Target::LOCAL;
+    const common::FileTask::Target target_target = (type_ == Type::DOWNLOADER) ?
+        common::FileTask::Target::LOCAL : common::FileTask::Target::REMOTE;
 
-    if (type_ == Type::DOWNLOADER)
+    for (uint32_t i = 0; i < common::kMaxFileLanes; ++i)
     {
-        task_factory_source_ = std::move(task_factory_remote);
-        task_factory_target_ = std::move(task_factory_local);
-    }
-    else
-    {
-        DCHECK_EQ(type_, Type::UPLOADER);
+        std::unique_ptr<Lane> lane = std::make_unique<Lane>(i);
+
+        lane->task_factory_source = std::make_unique<common::FileTaskFactory>(
+            task_producer_proxy_, source_target, i);
+        lane->task_factory_target = std::make_unique<common::FileTaskFactory>(
+            task_producer_proxy_, target_target, i);
 
-        task_factory_source_ = std::move(task_factory_local);
-        task_factory_target_ = std::move(task_factory_remote);
+        lanes_.emplace_back(std::move(lane));
     }
 
     // Asynchronously start UI.
     transfer_window_proxy_->start(transfer_proxy_);
 
-    queue_builder_ = std::make_unique<FileTransferQueueBuilder>(
-        task_consumer_proxy_, task_factory_source_->target());
+    queue_builder_ =
+        std::make_unique<FileTransferQueueBuilder>(task_consumer_proxy_, source_target);
 
-    // Start building a list of objects for transfer.
-    queue_builder_->start(source_path, target_path, items, [this](proto::FileError error_code)
+    // Start building a list of objects for transfer. The transfer starts with the first tasks while
+    // the rest of the list is being built.
+    queue_builder_->start(source_path, target_path, items,
+                          std::bind(&FileTransfer::onTasksAdded, this, std::placeholders::_1),
+                          [this](proto::FileError error_code)
     {
-        if (error_code == proto::FILE_ERROR_SUCCESS)
-        {
-            tasks_ = queue_builder_->takeQueue();
-            total_size_ = queue_builder_->totalSize();
+        queue_builder_.reset();
 
-            if (tasks_.empty())
-            {
-                onFinished();
-            }
-            else
-            {
-                doFrontTask(false);
-            }
+        if (error_code != proto::FILE_ERROR_SUCCESS)
+        {
+            onError(nullptr, Error::Type::QUEUE, proto::FILE_ERROR_UNKNOWN);
         }
         else
         {
-            onError(Error::Type::QUEUE, proto::FILE_ERROR_UNKNOWN);
+            // If all tasks are already done or the list is empty, the transfer is finished.
+            doTasks();
         }
-
-        queue_builder_.reset();
     });
 }
 
 void FileTransfer::stop()
 {
-    if (queue_builder_)
+    queue_builder_.reset();
+
+    bool is_idle = tasks_.empty();
+    for (const auto& lane : lanes_)
+    {
+        if (!lane->tasks.empty())
+            is_idle = false;
+    }
+
+    if (is_idle)
     {
-        queue_builder_.reset();
         onFinished();
     }
     else
@@ -179,6 +208,35 @@ void FileTransfer::stop()
     }
 }
 
+void FileTransfer::setAction(Error::Type error_type, Error::Action action)
+{
+    if (errors_.empty())
+        return;
+
+    Lane* lane = errors_.front().first;
+    errors_.pop_front();
+
+    doAction(lane, error_type, action);
+
+    // The action could apply to the next errors too.
+    while (!errors_.empty())
+    {
+        const Error& error = errors_.front().second;
+
+        auto default_action = actions_.find(error.type());
+        if (default_action == actions_.end())
+        {
+            transfer_window_proxy_->errorOccurred(error);
+            return;
+        }
+
+        lane = errors_.front().first;
+        errors_.pop_front();
+
+        doAction(lane, default_action->first, default_action->second);
+    }
+}
+
 void FileTransfer::setActionForErrorType(Error::Type error_type, Error::Action action)
 {
     actions_.insert_or_assign(error_type, action);
@@ -186,17 +244,25 @@ void FileTransfer::setActionForErrorType(Error::Type error_type, Error::Action a
 
 void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
+    const uint32_t lane_id = task->request().lane();
+    if (lane_id >= lanes_.size())
+        return;
+
+    Lane& lane = *lanes_[lane_id];
+    if (lane.tasks.empty())
+        return;
+
     if (type_ == Type::DOWNLOADER)
     {
         if (task->target() == common::FileTask::Target::LOCAL)
         {
-            targetReply(task->request(), task->reply());
+            targetReply(lane, task->request(), task->reply());
         }
         else
         {
             DCHECK_EQ(task->target(), common::FileTask::Target::REMOTE);
 
-            sourceReply(task->request(), task->reply());
+            sourceReply(lane, task->request(), task->reply());
         }
     }
     else
@@ -205,37 +271,55 @@ void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
 
         if (task->target() == common::FileTask::Target::LOCAL)
         {
-            sourceReply(task->request(), task->reply());
+            sourceReply(lane, task->request(), task->reply());
         }
         else
         {
             DCHECK_EQ(task->target(), common::FileTask::Target::REMOTE);
 
-            targetReply(task->request(), task->reply());
+            targetReply(lane, task->request(), task->reply());
         }
     }
 }
 
-FileTransfer::Task& FileTransfer::frontTask()
+FileTransfer::Lane::Lane(uint32_t id)
+    : id(id)
 {
-    return tasks_.front();
+    // Nothing
 }
 
-void FileTransfer::targetReply(const proto::FileRequest& request, const proto::FileReply& reply)
+FileTransfer::Lane::~Lane() = default;
+
+void FileTransfer::Lane::resetFile()
 {
-    if (tasks_.empty())
-        return;
+    task_percentage = 0;
+    task_transfered_size = 0;
+
+    source_packet_window = 0;
+    packet_window = 0;
+    packet_compression = false;
+    delta_block_size = 0;
+    block_hashes.reset();
+    file_size = -1;
+    requested_size = 0;
+    pending_packets.clear();
+    packet_error.reset();
+}
 
+void FileTransfer::targetReply(
+    Lane& lane, const proto::FileRequest& request, const proto::FileReply& reply)
+{
     if (request.has_create_directory_request())
     {
         if (reply.error_code() == proto::FILE_ERROR_SUCCESS ||
             reply.error_code() == proto::FILE_ERROR_PATH_ALREADY_EXISTS)
         {
-            doNextTask();
+            doNextTask(lane);
             return;
         }
 
-        onError(Error::Type::CREATE_DIRECTORY, reply.error_code(), frontTask().targetPath());
+        onError(&lane, Error::Type::CREATE_DIRECTORY, reply.error_code(),
+                lane.frontTask().targetPath());
     }
     else if (request.has_upload_request())
     {
@@ -246,107 +330,151 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
             if (reply.error_code() == proto::FILE_ERROR_PATH_ALREADY_EXISTS)
                 error_type = Error::Type::ALREADY_EXISTS;
 
-            onError(error_type, reply.error_code(), frontTask().targetPath());
+            onError(&lane, error_type, reply.error_code(), lane.frontTask().targetPath());
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_source_->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+        lane.packet_window = std::min(lane.source_packet_window, reply.packet_window());
+        lane.packet_compression = reply.packet_compression();
+
+        const proto::BlockHashes& block_hashes = reply.block_hashes();
+        if (lane.packet_window && block_hashes.hash_size() && block_hashes.block_size())
+        {
+            lane.delta_block_size = block_hashes.block_size();
+            lane.block_hashes = std::make_unique<proto::BlockHashes>(block_hashes);
+        }
+
+        requestPackets(lane);
+
+        if (lane.id == 0 && reply.lanes())
+        {
+            // The idle lanes start when both peers support them.
+            target_lanes_ = reply.lanes();
+            doTasks();
+        }
+    }
+    else if (request.has_batch_upload_request())
+    {
+        onBatchUpload(lane, request, reply);
     }
     else if (request.has_packet())
     {
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
+            onPacketError(lane, Error::Type::WRITE_FILE, reply.error_code(),
+                          lane.frontTask().targetPath());
             return;
         }
 
-        const int64_t full_task_size = frontTask().size();
-        if (full_task_size && total_size_)
-        {
-            int64_t packet_size = common::kMaxFilePacketSize;
+        if (dropPacket(lane))
+            return;
 
-            task_transfered_size_ += packet_size;
+        DCHECK(!lane.pending_packets.empty());
 
-            if (task_transfered_size_ > full_task_size)
-            {
-                packet_size = task_transfered_size_ - full_task_size;
-                task_transfered_size_ = full_task_size;
-            }
+        updatePacketSize(lane, std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - lane.pending_packets.front()));
+        lane.pending_packets.pop_front();
 
-            total_transfered_size_ += packet_size;
+        const proto::FilePacket& packet = request.packet();
 
-            const int task_percentage =
-                static_cast<int>(task_transfered_size_ * 100 / full_task_size);
-            const int total_percentage =
-                static_cast<int>(total_transfered_size_ * 100 / total_size_);
+        int64_t packet_size = static_cast<int64_t>(packet.data().size());
+        if (packet.flags() & (proto::FilePacket::COMPRESSED | proto::FilePacket::UNCHANGED))
+            packet_size = static_cast<int64_t>(packet.data_size());
 
-            if (task_percentage != task_percentage_ || total_percentage != total_percentage_)
-            {
-                task_percentage_ = task_percentage;
-                total_percentage_ = total_percentage;
-
-                transfer_window_proxy_->setCurrentProgress(total_percentage_, task_percentage_);
-            }
-        }
+        addProgress(lane, packet_size);
 
-        if (request.packet().flags() & proto::FilePacket::LAST_PACKET)
+        if (packet.flags() & proto::FilePacket::LAST_PACKET)
         {
-            doNextTask();
+            doNextTask(lane);
             return;
         }
 
-        uint32_t flags = proto::FilePacketRequest::NO_FLAGS;
-        if (is_canceled_)
-            flags = proto::FilePacketRequest::CANCEL;
-
-        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(flags));
+        requestPackets(lane);
     }
     else
     {
-        onError(Error::Type::OTHER, proto::FILE_ERROR_UNKNOWN);
+        onError(&lane, Error::Type::OTHER, proto::FILE_ERROR_UNKNOWN);
     }
 }
 
-void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::FileReply& reply)
+void FileTransfer::sourceReply(
+    Lane& lane, const proto::FileRequest& request, const proto::FileReply& reply)
 {
-    if (tasks_.empty())
-        return;
-
     if (request.has_download_request())
     {
-        Task& front_task = frontTask();
+        Task& front_task = lane.frontTask();
 
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::OPEN_FILE, reply.error_code(), front_task.sourcePath());
+            onError(&lane, Error::Type::OPEN_FILE, reply.error_code(), front_task.sourcePath());
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_target_->upload(front_task.targetPath(), front_task.overwrite()));
+        lane.source_packet_window = reply.packet_window();
+
+        if (lane.id == 0 && reply.lanes())
+            source_lanes_ = reply.lanes();
+
+        // Only the sources that support the packet window accept the hashes of the blocks.
+        uint32_t block_size = 0;
+        if (lane.source_packet_window && front_task.overwrite())
+            block_size = deltaBlockSize(front_task.size());
+
+        task_consumer_proxy_->doTask(lane.task_factory_target->upload(
+            front_task.targetPath(), front_task.overwrite(), block_size));
+    }
+    else if (request.has_batch_download_request())
+    {
+        onBatchDownload(lane, reply);
     }
     else if (request.has_packet_request())
     {
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
+            onPacketError(lane, Error::Type::READ_FILE, reply.error_code(),
+                          lane.frontTask().sourcePath());
             return;
         }
 
-        task_consumer_proxy_->doTask(task_factory_target_->packet(reply.packet()));
+        if (lane.packet_error)
+        {
+            // The target no longer accepts packets of the current file.
+            dropPacket(lane);
+            return;
+        }
+
+        const proto::FilePacket& packet = reply.packet();
+        if (packet.flags() & proto::FilePacket::FIRST_PACKET)
+        {
+            lane.file_size = static_cast<int64_t>(packet.file_size());
+            lane.requested_size = std::min(lane.requested_size, lane.file_size);
+        }
+
+        task_consumer_proxy_->doTask(lane.task_factory_target->packet(packet));
+
+        // After the first packet the file size is known and the rest of the window can be used.
+        if (packet.flags() & proto::FilePacket::FIRST_PACKET)
+            requestPackets(lane);
     }
     else
     {
-        onError(Error::Type::OTHER, proto::FILE_ERROR_UNKNOWN);
+        onError(&lane, Error::Type::OTHER, proto::FILE_ERROR_UNKNOWN);
     }
 }
 
-void FileTransfer::setAction(Error::Type error_type, Error::Action action)
+void FileTransfer::doAction(Lane* lane, Error::Type error_type, Error::Action action)
 {
+    if (!lane)
+    {
+        // The errors that are not related to a file only allow to abort the transfer.
+        onFinished();
+        return;
+    }
+
     switch (action)
     {
         case Error::ACTION_ABORT:
+            errors_.clear();
             onFinished();
             break;
 
@@ -356,7 +484,7 @@ void FileTransfer::setAction(Error::Type error_type, Error::Action action)
             if (action == Error::ACTION_REPLACE_ALL)
                 setActionForErrorType(error_type, action);
 
-            doFrontTask(true);
+            doFrontTask(*lane, true);
         }
         break;
 
@@ -366,7 +494,7 @@ void FileTransfer::setAction(Error::Type error_type, Error::Action action)
             if (action == Error::ACTION_SKIP_ALL)
                 setActionForErrorType(error_type, action);
 
-            doNextTask();
+            doNextTask(*lane);
         }
         break;
 
@@ -376,64 +504,480 @@ void FileTransfer::setAction(Error::Type error_type, Error::Action action)
     }
 }
 
-void FileTransfer::doFrontTask(bool overwrite)
+void FileTransfer::onTasksAdded(TaskList&& tasks)
 {
-    task_percentage_ = 0;
-    task_transfered_size_ = 0;
+    for (auto& task : tasks)
+    {
+        total_size_ += task.size();
+        tasks_.emplace_back(std::move(task));
+    }
+
+    // If the lanes were waiting for the tasks, they are continued.
+    doTasks();
+}
+
+size_t FileTransfer::laneCount() const
+{
+    const size_t count = std::min(source_lanes_, target_lanes_);
+    return std::min(std::max(count, static_cast<size_t>(1)), lanes_.size());
+}
+
+void FileTransfer::doTasks()
+{
+    const size_t lane_count = laneCount();
+
+    auto is_busy = [](const std::unique_ptr<Lane>& lane) { return !lane->tasks.empty(); };
+
+    for (size_t i = 0; i < lane_count && !tasks_.empty() && !is_canceled_; ++i)
+    {
+        Lane& lane = *lanes_[i];
+
+        if (!lane.tasks.empty())
+            continue;
+
+        // The peer creates directories and writes files on different threads. A directory is
+        // created only when no other lane is busy and the files inside it are sent after it.
+        const bool is_directory = tasks_.front().isDirectory();
+        if (is_directory && std::any_of(lanes_.begin(), lanes_.end(), is_busy))
+            break;
+
+        takeTasks(lane);
+        doFrontTask(lane, false);
+
+        if (is_directory)
+            break;
+    }
+
+    // The next tasks are still being listed.
+    if (!tasks_.empty() || queue_builder_)
+        return;
+
+    for (const auto& lane : lanes_)
+    {
+        if (!lane->tasks.empty())
+            return;
+    }
+
+    if (cancel_timer_.isActive())
+        cancel_timer_.stop();
+
+    onFinished();
+}
+
+void FileTransfer::takeTasks(Lane& lane)
+{
+    DCHECK(lane.tasks.empty());
+    DCHECK(!tasks_.empty());
+
+    int64_t batch_size = 0;
+
+    do
+    {
+        const Task& task = tasks_.front();
 
-    Task& front_task = frontTask();
+        if (!lane.tasks.empty())
+        {
+            if (task.isDirectory() || task.size() > common::kMaxBatchFileSize)
+                break;
+
+            if (lane.tasks.size() >= static_cast<size_t>(common::kMaxBatchFiles) ||
+                batch_size + task.size() > common::kMaxBatchSize)
+            {
+                break;
+            }
+        }
+
+        batch_size += task.size();
+
+        lane.tasks.emplace_back(std::move(tasks_.front()));
+        tasks_.pop_front();
+
+        // Only small files are collected in a batch.
+        const Task& front_task = lane.tasks.front();
+        if (!batch_supported_ || front_task.isDirectory() ||
+            front_task.size() > common::kMaxBatchFileSize)
+        {
+            break;
+        }
+    }
+    while (!tasks_.empty());
+
+    lane.batch_skip_front = false;
+}
+
+void FileTransfer::doFrontTask(Lane& lane, bool overwrite)
+{
+    lane.resetFile();
+
+    Task& front_task = lane.frontTask();
     front_task.setOverwrite(overwrite);
 
+    current_lane_ = &lane;
+    task_percentage_ = 0;
+
     transfer_window_proxy_->setCurrentItem(front_task.sourcePath(), front_task.targetPath());
 
     if (front_task.isDirectory())
     {
         task_consumer_proxy_->doTask(
-            task_factory_target_->createDirectory(front_task.targetPath()));
+            lane.task_factory_target->createDirectory(front_task.targetPath()));
     }
-    else
+    else if (!doBatch(lane))
     {
         task_consumer_proxy_->doTask(
-            task_factory_source_->download(front_task.sourcePath()));
+            lane.task_factory_source->download(front_task.sourcePath()));
     }
 }
 
-void FileTransfer::doNextTask()
+void FileTransfer::doNextTask(Lane& lane)
 {
     if (is_canceled_)
     {
-        while (!tasks_.empty())
-            tasks_.pop_front();
+        lane.tasks.clear();
+        tasks_.clear();
     }
 
-    if (!tasks_.empty())
+    if (!lane.tasks.empty())
     {
         // Delete the task only after confirmation of its successful execution.
-        tasks_.pop_front();
+        lane.tasks.pop_front();
     }
 
-    if (tasks_.empty())
+    if (!lane.tasks.empty())
     {
-        if (cancel_timer_.isActive())
-            cancel_timer_.stop();
+        // The rest of a batch that was not transferred.
+        doFrontTask(lane, false);
+        return;
+    }
 
-        onFinished();
+    doTasks();
+}
+
+bool FileTransfer::doBatch(Lane& lane)
+{
+    const bool skip_front = lane.batch_skip_front;
+    lane.batch_skip_front = false;
+
+    if (!batch_supported_ || skip_front)
+        return false;
+
+    std::unique_ptr<proto::BatchDownloadRequest> request =
+        std::make_unique<proto::BatchDownloadRequest>();
+
+    for (const auto& task : lane.tasks)
+    {
+        if (task.isDirectory() || task.size() > common::kMaxBatchFileSize)
+            break;
+
+        request->add_path(task.sourcePath());
+    }
+
+    if (!request->path_size())
+        return false;
+
+    task_consumer_proxy_->doTask(lane.task_factory_source->batchDownload(std::move(request)));
+    return true;
+}
+
+void FileTransfer::onBatchDownload(Lane& lane, const proto::FileReply& reply)
+{
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST)
+    {
+        LOG(LS_INFO) << "Batch requests are not supported by the source";
+
+        batch_supported_ = false;
+        doFrontTask(lane, lane.frontTask().overwrite());
+        return;
+    }
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+    {
+        onError(&lane, Error::Type::READ_FILE, reply.error_code(), lane.frontTask().sourcePath());
+        return;
+    }
+
+    const proto::FileBatch& batch = reply.batch();
+
+    std::unique_ptr<proto::BatchUploadRequest> request =
+        std::make_unique<proto::BatchUploadRequest>();
+
+    for (int i = 0; i < batch.entry_size() && static_cast<size_t>(i) < lane.tasks.size(); ++i)
+    {
+        const proto::FileBatch::Entry& entry = batch.entry(i);
+        const Task& task = lane.tasks[static_cast<size_t>(i)];
+
+        if (entry.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            Error::Type error_type = Error::Type::READ_FILE;
+
+            if (entry.error_code() == proto::FILE_ERROR_FILE_OPEN_ERROR)
+                error_type = Error::Type::OPEN_FILE;
+
+            lane.batch_error =
+                std::make_unique<Error>(error_type, entry.error_code(), task.sourcePath());
+            break;
+        }
+
+        proto::BatchUploadRequest::Entry* request_entry = request->add_entry();
+        request_entry->set_path(task.targetPath());
+        request_entry->set_overwrite(task.overwrite());
+        request_entry->set_data(entry.data());
+    }
+
+    if (!request->entry_size())
+    {
+        if (lane.batch_error)
+        {
+            std::unique_ptr<Error> error = std::move(lane.batch_error);
+            onError(&lane, error->type(), error->code(), error->path());
+        }
+        else
+        {
+            // The source stops before a file that has grown since it was listed. The file is
+            // transferred with packets.
+            lane.batch_skip_front = true;
+            doFrontTask(lane, lane.frontTask().overwrite());
+        }
         return;
     }
 
-    doFrontTask(false);
+    task_consumer_proxy_->doTask(lane.task_factory_target->batchUpload(std::move(request)));
 }
 
-void FileTransfer::onError(Error::Type type, proto::FileError code, const std::string& path)
+void FileTransfer::onBatchUpload(
+    Lane& lane, const proto::FileRequest& request, const proto::FileReply& reply)
+{
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST)
+    {
+        LOG(LS_INFO) << "Batch requests are not supported by the target";
+
+        batch_supported_ = false;
+        lane.batch_error.reset();
+
+        doFrontTask(lane, lane.frontTask().overwrite());
+        return;
+    }
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+    {
+        lane.batch_error.reset();
+
+        onError(&lane, Error::Type::CREATE_FILE, reply.error_code(),
+                lane.frontTask().targetPath());
+        return;
+    }
+
+    const proto::FileBatch& batch = reply.batch();
+    const int sent_count = request.batch_upload_request().entry_size();
+
+    int done_count = 0;
+    while (done_count < batch.entry_size() && done_count < sent_count &&
+           batch.entry(done_count).error_code() == proto::FILE_ERROR_SUCCESS)
+    {
+        total_transfered_size_ += lane.tasks[static_cast<size_t>(done_count)].size();
+        ++done_count;
+    }
+
+    updateProgress((current_lane_ == &lane) ? 100 : task_percentage_);
+
+    if (done_count < sent_count)
+    {
+        lane.batch_error.reset();
+        lane.tasks.erase(lane.tasks.begin(), lane.tasks.begin() + done_count);
+
+        if (done_count >= batch.entry_size())
+        {
+            // The target did not process the rest of the batch.
+            doFrontTask(lane, lane.frontTask().overwrite());
+            return;
+        }
+
+        const proto::FileError error_code = batch.entry(done_count).error_code();
+        Error::Type error_type = Error::Type::CREATE_FILE;
+
+        if (error_code == proto::FILE_ERROR_PATH_ALREADY_EXISTS)
+            error_type = Error::Type::ALREADY_EXISTS;
+        else if (error_code == proto::FILE_ERROR_FILE_WRITE_ERROR)
+            error_type = Error::Type::WRITE_FILE;
+
+        onError(&lane, error_type, error_code, lane.frontTask().targetPath());
+        return;
+    }
+
+    if (lane.batch_error)
+    {
+        lane.tasks.erase(lane.tasks.begin(), lane.tasks.begin() + done_count);
+
+        std::unique_ptr<Error> error = std::move(lane.batch_error);
+        onError(&lane, error->type(), error->code(), error->path());
+        return;
+    }
+
+    // The last task of the batch is removed by doNextTask(). If the source did not put all files
+    // into the batch, the rest are transferred with packets.
+    lane.tasks.erase(lane.tasks.begin(), lane.tasks.begin() + (done_count - 1));
+    lane.batch_skip_front = lane.tasks.size() > 1;
+
+    doNextTask(lane);
+}
+
+void FileTransfer::requestPackets(Lane& lane)
+{
+    if (is_canceled_)
+    {
+        // If the source has not yet read the whole file, it is asked to stop after the replies for
+        // all requested packets are received. The reply to the cancel request is the last packet.
+        if (lane.pending_packets.empty() &&
+            (lane.file_size < 0 || lane.requested_size < lane.file_size))
+        {
+            lane.pending_packets.emplace_back(Clock::now());
+            task_consumer_proxy_->doTask(
+                lane.task_factory_source->packetRequest(proto::FilePacketRequest::CANCEL, 0));
+        }
+        return;
+    }
+
+    // Sources that do not support compression ignore the flag.
+    uint32_t flags = proto::FilePacketRequest::NO_FLAGS;
+    if (lane.packet_compression)
+        flags |= proto::FilePacketRequest::ALLOW_COMPRESSION;
+
+    if (!lane.packet_window)
+    {
+        // The peer does not support the packet window. The next packet is requested only after
+        // the previous one is written by the target.
+        if (lane.pending_packets.empty())
+        {
+            lane.pending_packets.emplace_back(Clock::now());
+            task_consumer_proxy_->doTask(lane.task_factory_source->packetRequest(flags, 0));
+        }
+        return;
+    }
+
+    // Until the first packet is received, the file size is unknown and only one packet is
+    // requested. The source never receives requests for data past the end of the file.
+    const size_t window = (lane.file_size < 0) ? 1 : lane.packet_window;
+
+    while (lane.pending_packets.size() < window &&
+           (lane.file_size < 0 || lane.requested_size < lane.file_size))
+    {
+        // The source compares the blocks only if every packet starts at the start of a block.
+        uint32_t packet_size = lane.delta_block_size ? lane.delta_block_size : packet_size_;
+        if (lane.file_size >= 0)
+        {
+            packet_size = static_cast<uint32_t>(std::min(
+                static_cast<int64_t>(packet_size), lane.file_size - lane.requested_size));
+        }
+
+        lane.requested_size += packet_size;
+        lane.pending_packets.emplace_back(Clock::now());
+
+        if (lane.block_hashes)
+        {
+            task_consumer_proxy_->doTask(lane.task_factory_source->packetRequest(
+                flags, packet_size, std::move(lane.block_hashes)));
+        }
+        else
+        {
+            task_consumer_proxy_->doTask(
+                lane.task_factory_source->packetRequest(flags, packet_size));
+        }
+    }
+}
+
+void FileTransfer::onPacketError(
+    Lane& lane, Error::Type type, proto::FileError code, const std::string& path)
+{
+    if (!lane.packet_error)
+        lane.packet_error = std::make_unique<Error>(type, code, path);
+
+    dropPacket(lane);
+}
+
+bool FileTransfer::dropPacket(Lane& lane)
+{
+    if (!lane.packet_error)
+        return false;
+
+    if (!lane.pending_packets.empty())
+        lane.pending_packets.pop_front();
+
+    if (lane.pending_packets.empty())
+    {
+        std::unique_ptr<Error> error = std::move(lane.packet_error);
+        onError(&lane, error->type(), error->code(), error->path());
+    }
+
+    return true;
+}
+
+void FileTransfer::updatePacketSize(
+    const Lane& lane, const std::chrono::milliseconds& packet_time)
+{
+    // The size of the packets is fixed while the blocks are compared.
+    if (!lane.packet_window || lane.delta_block_size)
+        return;
+
+    static const uint32_t kMinPacketSize = static_cast<uint32_t>(common::kMaxFilePacketSize);
+    static const uint32_t kMaxPacketSize = static_cast<uint32_t>(common::kMaxFileChunkSize);
+
+    if (packet_time < kMinPacketTime)
+        packet_size_ = std::min(packet_size_ * 2, kMaxPacketSize);
+    else if (packet_time > kMaxPacketTime)
+        packet_size_ = std::max(packet_size_ / 2, kMinPacketSize);
+}
+
+void FileTransfer::addProgress(Lane& lane, int64_t size)
+{
+    const int64_t full_task_size = lane.frontTask().size();
+    if (!full_task_size)
+        return;
+
+    lane.task_transfered_size += size;
+
+    if (lane.task_transfered_size > full_task_size)
+    {
+        size -= lane.task_transfered_size - full_task_size;
+        lane.task_transfered_size = full_task_size;
+    }
+
+    total_transfered_size_ += size;
+
+    lane.task_percentage = static_cast<int>(lane.task_transfered_size * 100 / full_task_size);
+
+    updateProgress((current_lane_ == &lane) ? lane.task_percentage : task_percentage_);
+}
+
+void FileTransfer::updateProgress(int task_percentage)
+{
+    if (!total_size_)
+        return;
+
+    const int total_percentage = static_cast<int>(total_transfered_size_ * 100 / total_size_);
+    if (total_percentage == total_percentage_ && task_percentage == task_percentage_)
+        return;
+
+    total_percentage_ = total_percentage;
+    task_percentage_ = task_percentage;
+
+    transfer_window_proxy_->setCurrentProgress(total_percentage_, task_percentage_);
+}
+
+void FileTransfer::onError(
+    Lane* lane, Error::Type type, proto::FileError code, const std::string& path)
 {
     auto default_action = actions_.find(type);
     if (default_action != actions_.end())
     {
-        setAction(type, default_action->second);
+        doAction(lane, type, default_action->second);
         return;
     }
 
-    transfer_window_proxy_->errorOccurred(Error(type, code, path));
+    errors_.emplace_back(lane, Error(type, code, path));
+
+    // Only one error is shown at a time. The other lanes continue while the user decides.
+    if (errors_.size() == 1)
+        transfer_window_proxy_->errorOccurred(errors_.front().second);
 }
 
 void FileTransfer::onFinished()
@@ -24,7 +24,9 @@
 #include "common/file_task_producer.h"
 #include "proto/file_transfer.pb.h"
 
+#include <chrono>
 #include <deque>
+#include <vector>
 
 namespace base {
 class TaskRunner;
@@ -174,12 +176,119 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    Task& frontTask();
-    void targetReply(const proto::FileRequest& request, const proto::FileReply& reply);
-    void sourceReply(const proto::FileRequest& request, const proto::FileReply& reply);
-    void doFrontTask(bool overwrite);
-    void doNextTask();
-    void onError(Error::Type type, proto::FileError code, const std::string& path = std::string());
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
+    // Each lane transfers one file (or one batch of small files) at a time and has its own file
+    // being read by the source and file being written by the target. If both peers support several
+    // lanes, the next files are opened and created while the packets of the previous ones are in
+    // flight.
+    struct Lane
+    {
+        explicit Lane(uint32_t id);
+        ~Lane();
+
+        // Resets the state of the transfer of the front task.
+        void resetFile();
+
+        Task& frontTask() { return tasks.front(); }
+
+        const uint32_t id;
+
+        std::unique_ptr<common::FileTaskFactory> task_factory_source;
+        std::unique_ptr<common::FileTaskFactory> task_factory_target;
+
+        // The tasks taken from the queue. A lane takes several tasks only for a batch.
+        TaskList tasks;
+
+        int64_t task_transfered_size = 0;
+        int task_percentage = 0;
+
+        // The number of packets that source and target accept without waiting for replies. If 0,
+        // one of them does not support the packet window and the packets are transferred one by
+        // one.
+        uint32_t source_packet_window = 0;
+        uint32_t packet_window = 0;
+
+        // If true, the target accepts compressed packets and the source is allowed to compress
+        // them.
+        bool packet_compression = false;
+
+        // If not 0, the target has an older version of the file and only the changed blocks of
+        // this size are sent. The hashes of the blocks are sent to the source with the first
+        // packet request.
+        uint32_t delta_block_size = 0;
+        std::unique_ptr<proto::BlockHashes> block_hashes;
+
+        // The size of the current file. Unknown (-1) until the first packet is received.
+        int64_t file_size = -1;
+        int64_t requested_size = 0;
+
+        // The time of the request for each packet that is not yet written by the target.
+        std::deque<TimePoint> pending_packets;
+        std::unique_ptr<Error> packet_error;
+
+        // If true, the front task is transferred with packets even if it is small.
+        bool batch_skip_front = false;
+
+        // The error of the source for the file that follows the files sent to the target. It is
+        // reported when the target has written them.
+        std::unique_ptr<Error> batch_error;
+    };
+
+    void targetReply(Lane& lane, const proto::FileRequest& request, const proto::FileReply& reply);
+    void sourceReply(Lane& lane, const proto::FileRequest& request, const proto::FileReply& reply);
+    void onTasksAdded(TaskList&& tasks);
+
+    // Returns the number of lanes supported by both peers.
+    size_t laneCount() const;
+
+    // Gives the next tasks from the queue to the idle lanes. Finishes the transfer if all tasks
+    // are done.
+    void doTasks();
+
+    // Moves the front task from the queue to |lane|. If it is a small file, the small files that
+    // follow it are moved too, so that they are sent in one batch.
+    void takeTasks(Lane& lane);
+    void doFrontTask(Lane& lane, bool overwrite);
+    void doNextTask(Lane& lane);
+
+    // Requests the tasks of the lane in one batch. Returns false if the front task cannot be sent
+    // in a batch.
+    bool doBatch(Lane& lane);
+    void onBatchDownload(Lane& lane, const proto::FileReply& reply);
+    void onBatchUpload(Lane& lane,
+                       const proto::FileRequest& request,
+                       const proto::FileReply& reply);
+
+    // Requests packets from the source until the packet window is full.
+    void requestPackets(Lane& lane);
+
+    // Aborts the transfer of the current file. The error is reported after the replies for all
+    // requested packets are received.
+    void onPacketError(Lane& lane,
+                       Error::Type type,
+                       proto::FileError code,
+                       const std::string& path);
+
+    // Returns true if the transfer of the current file is aborted and the packet must be dropped.
+    bool dropPacket(Lane& lane);
+
+    // Adjusts the size of the requested packets to the time of passing of the packet from the
+    // request to the source to the reply from the target.
+    void updatePacketSize(const Lane& lane, const std::chrono::milliseconds& packet_time);
+
+    // Adds |size| bytes of the front task of |lane| to the progress.
+    void addProgress(Lane& lane, int64_t size);
+
+    // Sends the progress to the window if it has changed. |task_percentage| is the progress of the
+    // item shown in the window.
+    void updateProgress(int task_percentage);
+
+    // |lane| is nullptr for the errors that are not related to a file.
+    void onError(Lane* lane, Error::Type type, proto::FileError code,
+                 const std::string& path = std::string());
+    void doAction(Lane* lane, Error::Type error_type, Error::Action action);
     void setActionForErrorType(Error::Type error_type, Error::Action action);
     void onFinished();
 
@@ -188,28 +297,45 @@ private:
     std::shared_ptr<FileTransferWindowProxy> transfer_window_proxy_;
     std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy_;
     std::shared_ptr<common::FileTaskProducerProxy> task_producer_proxy_;
-    std::unique_ptr<common::FileTaskFactory> task_factory_source_;
-    std::unique_ptr<common::FileTaskFactory> task_factory_target_;
 
     base::WaitableTimer cancel_timer_;
 
     // The map contains available actions for the error and the current action.
     std::map<Error::Type, Error::Action> actions_;
+
+    // The errors waiting for the action of the user. The front error is shown.
+    std::deque<std::pair<Lane*, Error>> errors_;
+
     std::unique_ptr<FileTransferQueueBuilder> queue_builder_;
     TaskList tasks_;
     const Type type_;
 
+    std::vector<std::unique_ptr<Lane>> lanes_;
+
+    // The number of lanes supported by the source and the target. Until the replies of the peers
+    // are received, only one lane is used.
+    uint32_t source_lanes_ = 1;
+    uint32_t target_lanes_ = 1;
+
+    // The lane of the item shown in the window.
+    const Lane* current_lane_ = nullptr;
+
     FinishCallback finish_callback_;
 
     int64_t total_size_ = 0;
     int64_t total_transfered_size_ = 0;
-    int64_t task_transfered_size_ = 0;
 
     int total_percentage_ = 0;
     int task_percentage_ = 0;
 
     bool is_canceled_ = false;
 
+    // The size of the requested packets. It is adjusted during the transfer.
+    uint32_t packet_size_;
+
+    // Set to false if the source or the target does not support batch requests.
+    bool batch_supported_ = true;
+
     DISALLOW_COPY_AND_ASSIGN(FileTransfer);
 };
 
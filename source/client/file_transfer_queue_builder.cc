@@ -44,10 +44,14 @@ FileTransferQueueBuilder::~FileTransferQueueBuilder()
 void FileTransferQueueBuilder::start(const std::string& source_path,
                                      const std::string& target_path,
                                      const std::vector<FileTransfer::Item>& items,
-                                     const FinishCallback& callback)
+                                     const TasksCallback& tasks_callback,
+                                     const FinishCallback& finish_callback)
 {
-    callback_ = callback;
-    DCHECK(callback_);
+    tasks_callback_ = tasks_callback;
+    finish_callback_ = finish_callback;
+
+    DCHECK(tasks_callback_);
+    DCHECK(finish_callback_);
 
     for (const auto& item : items)
         addPendingTask(source_path, target_path, item.name, item.is_directory, item.size);
@@ -55,51 +59,47 @@ void FileTransferQueueBuilder::start(const std::string& source_path,
     doPendingTasks();
 }
 
-FileTransfer::TaskList FileTransferQueueBuilder::takeQueue()
-{
-    return std::move(tasks_);
-}
-
-int64_t FileTransferQueueBuilder::totalSize() const
-{
-    return total_size_;
-}
-
 void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
-    DCHECK(!tasks_.empty());
+    DCHECK(directory_);
 
     const proto::FileRequest& request = task->request();
     const proto::FileReply& reply = task->reply();
 
-    if (!request.has_file_list_request())
+    if (request.has_manifest_request())
     {
-        onAborted(proto::FILE_ERROR_UNKNOWN);
-        return;
-    }
+        if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST &&
+            !request.manifest_request().path().empty())
+        {
+            LOG(LS_INFO) << "Manifest is not supported by the source";
 
-    if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
-    {
-        onAborted(reply.error_code());
-        return;
-    }
+            use_manifest_ = false;
+            requestDirectory();
+            return;
+        }
 
-    // If we get a list of files, then the last task is a directory.
-    const FileTransfer::Task& last_task = tasks_.back();
-    DCHECK(last_task.isDirectory());
+        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            onFinished(reply.error_code());
+            return;
+        }
 
-    for (int i = 0; i < reply.file_list().item_size(); ++i)
+        onManifest(reply.manifest());
+    }
+    else if (request.has_file_list_request())
     {
-        const proto::FileList::Item& item = reply.file_list().item(i);
+        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            onFinished(reply.error_code());
+            return;
+        }
 
-        addPendingTask(last_task.sourcePath(),
-                       last_task.targetPath(),
-                       item.name(),
-                       item.is_directory(),
-                       item.size());
+        onFileList(reply.file_list());
+    }
+    else
+    {
+        onFinished(proto::FILE_ERROR_UNKNOWN);
     }
-
-    doPendingTasks();
 }
 
 void FileTransferQueueBuilder::addPendingTask(const std::string& source_dir,
@@ -108,8 +108,6 @@ void FileTransferQueueBuilder::addPendingTask(const std::string& source_dir,
                                               bool is_directory,
                                               int64_t size)
 {
-    total_size_ += size;
-
     std::string source_path = source_dir + '/' + item_name;
     std::string target_path = target_dir + '/' + item_name;
 
@@ -118,28 +116,92 @@ void FileTransferQueueBuilder::addPendingTask(const std::string& source_dir,
 
 void FileTransferQueueBuilder::doPendingTasks()
 {
+    FileTransfer::TaskList tasks;
+
     while (!pending_tasks_.empty())
     {
-        tasks_.emplace_back(std::move(pending_tasks_.front()));
+        tasks.emplace_back(std::move(pending_tasks_.front()));
         pending_tasks_.pop_front();
 
-        if (tasks_.back().isDirectory())
+        if (tasks.back().isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.back().sourcePath()));
+            directory_ = std::make_unique<FileTransfer::Task>(tasks.back());
+
+            // The directory itself is created before its contents are known.
+            tasks_callback_(std::move(tasks));
+            requestDirectory();
             return;
         }
     }
 
-    callback_(proto::FILE_ERROR_SUCCESS);
+    if (!tasks.empty())
+        tasks_callback_(std::move(tasks));
+
+    onFinished(proto::FILE_ERROR_SUCCESS);
+}
+
+void FileTransferQueueBuilder::requestDirectory()
+{
+    DCHECK(directory_);
+
+    if (use_manifest_)
+        task_consumer_proxy_->doTask(task_factory_->manifest(directory_->sourcePath()));
+    else
+        task_consumer_proxy_->doTask(task_factory_->fileList(directory_->sourcePath()));
+}
+
+void FileTransferQueueBuilder::onFileList(const proto::FileList& file_list)
+{
+    for (int i = 0; i < file_list.item_size(); ++i)
+    {
+        const proto::FileList::Item& item = file_list.item(i);
+
+        addPendingTask(directory_->sourcePath(),
+                       directory_->targetPath(),
+                       item.name(),
+                       item.is_directory(),
+                       item.size());
+    }
+
+    doPendingTasks();
+}
+
+void FileTransferQueueBuilder::onManifest(const proto::Manifest& manifest)
+{
+    // The manifest contains the whole tree of the directory in the order of creation.
+    FileTransfer::TaskList tasks;
+
+    for (int i = 0; i < manifest.item_size(); ++i)
+    {
+        const proto::Manifest::Item& item = manifest.item(i);
+
+        tasks.emplace_back(directory_->sourcePath() + '/' + item.path(),
+                           directory_->targetPath() + '/' + item.path(),
+                           item.is_directory(),
+                           item.size());
+    }
+
+    if (!tasks.empty())
+        tasks_callback_(std::move(tasks));
+
+    if (manifest.has_more())
+    {
+        // Request the next page of the current walk.
+        task_consumer_proxy_->doTask(task_factory_->manifest(std::string()));
+        return;
+    }
+
+    doPendingTasks();
 }
 
-void FileTransferQueueBuilder::onAborted(proto::FileError error_code)
+void FileTransferQueueBuilder::onFinished(proto::FileError error_code)
 {
     pending_tasks_.clear();
-    tasks_.clear();
-    total_size_ = 0;
+    directory_.reset();
 
-    callback_(error_code);
+    // The callback can destroy the instance.
+    FinishCallback callback = finish_callback_;
+    callback(error_code);
 }
 
 } // namespace client
@@ -24,6 +24,8 @@
 namespace client {
 
 // The class prepares the task queue to perform the downloading/uploading.
+// The contents of directories are requested as a manifest of the whole tree, which the source
+// streams in pages. If the source does not support manifests, each directory is listed separately.
 class FileTransferQueueBuilder : public common::FileTaskProducer
 {
 public:
@@ -32,16 +34,18 @@ public:
         common::FileTask::Target target);
     ~FileTransferQueueBuilder();
 
+    using TasksCallback = std::function<void(FileTransfer::TaskList&& tasks)>;
     using FinishCallback = std::function<void(proto::FileError)>;
 
-    // Starts building of the task queue.
+    // Starts building of the task queue. The tasks are passed to |tasks_callback| in the order of
+    // execution as soon as they are known, so the transfer can start before the whole tree is
+    // listed. |finish_callback| is called when the queue is complete or on an error. The instance
+    // can be destroyed in |finish_callback|.
     void start(const std::string& source_path,
                const std::string& target_path,
                const std::vector<FileTransfer::Item>& items,
-               const FinishCallback& callback);
-
-    FileTransfer::TaskList takeQueue();
-    int64_t totalSize() const;
+               const TasksCallback& tasks_callback,
+               const FinishCallback& finish_callback);
 
 protected:
     // FileTaskProducer implementation.
@@ -54,17 +58,25 @@ private:
                         bool is_directory,
                         int64_t size);
     void doPendingTasks();
-    void onAborted(proto::FileError error_code);
+    void requestDirectory();
+    void onFileList(const proto::FileList& file_list);
+    void onManifest(const proto::Manifest& manifest);
+    void onFinished(proto::FileError error_code);
 
     std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy_;
     std::shared_ptr<common::FileTaskProducerProxy> task_producer_proxy_;
     std::unique_ptr<common::FileTaskFactory> task_factory_;
 
-    FinishCallback callback_;
+    TasksCallback tasks_callback_;
+    FinishCallback finish_callback_;
 
     FileTransfer::TaskList pending_tasks_;
-    FileTransfer::TaskList tasks_;
-    int64_t total_size_ = 0;
+
+    // The directory whose contents are being requested.
+    std::unique_ptr<FileTransfer::Task> directory_;
+
+    // Set to false if the source does not support manifest requests.
+    bool use_manifest_ = true;
 
     DISALLOW_COPY_AND_ASSIGN(FileTransferQueueBuilder);
 };
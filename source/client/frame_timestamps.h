@@ -0,0 +1,46 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef CLIENT__FRAME_TIMESTAMPS_H
+#define CLIENT__FRAME_TIMESTAMPS_H
+
+#include <cstdint>
+
+namespace client {
+
+// Times of the stages of a video frame on its way from the screen of the host to the screen of the
+// client (microseconds since the Unix epoch by the clock of the client). A field is zero if the
+// time is unknown.
+struct FrameTimestamps
+{
+    // The stages on the host. The times are converted to the clock of the client only if
+    // |synchronized| is true. Otherwise only the differences between them are valid.
+    int64_t capture = 0;
+    int64_t diff = 0;
+    int64_t encode = 0;
+    int64_t send = 0;
+    bool synchronized = false;
+
+    // The stages on the client.
+    int64_t receive = 0;
+    int64_t decode = 0;
+    int64_t paint = 0;
+};
+
+} // namespace client
+
+#endif // CLIENT__FRAME_TIMESTAMPS_H
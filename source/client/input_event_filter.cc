@@ -41,7 +41,22 @@ void InputEventFilter::setClipboardEnabled(bool enable)
     clipboard_enabled_ = enable;
 }
 
-std::optional<proto::MouseEvent> InputEventFilter::mouseEvent(const proto::MouseEvent& event)
+void InputEventFilter::setMouseMoveRate(int rate)
+{
+    LOG(LS_INFO) << "Mouse move rate changed: " << rate;
+
+    if (rate <= 0)
+    {
+        mouse_move_interval_ = Clock::duration::zero();
+        return;
+    }
+
+    mouse_move_interval_ = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::microseconds(1000000 / rate));
+}
+
+std::optional<proto::MouseEvent> InputEventFilter::mouseEvent(
+    const proto::MouseEvent& event, const TimePoint& now)
 {
     if (session_type_ != proto::SESSION_TYPE_DESKTOP_MANAGE)
         return std::nullopt;
@@ -54,9 +69,30 @@ std::optional<proto::MouseEvent> InputEventFilter::mouseEvent(const proto::Mouse
         static const uint32_t kWheelMask =
             proto::MouseEvent::WHEEL_DOWN | proto::MouseEvent::WHEEL_UP;
 
+        // The wheel bits are not kept in |last_mask_|, so the same mask means a move.
+        const bool move = event.mask() == last_mask_;
+
+        if (move && now - last_mouse_time_ < mouse_move_interval_)
+        {
+            // The held move is replaced, the host gets only the last position.
+            if (pending_mouse_event_.has_value())
+                ++drop_mouse_count_;
+
+            pending_mouse_event_ = event;
+            return std::nullopt;
+        }
+
+        // The event has the current position, the held move is not needed anymore.
+        if (pending_mouse_event_.has_value())
+        {
+            pending_mouse_event_.reset();
+            ++drop_mouse_count_;
+        }
+
         last_pos_x_ = event.x();
         last_pos_y_ = event.y();
         last_mask_ = event.mask() & ~kWheelMask;
+        last_mouse_time_ = now;
 
         ++send_mouse_count_;
         return event;
@@ -69,6 +105,30 @@ std::optional<proto::MouseEvent> InputEventFilter::mouseEvent(const proto::Mouse
     return std::nullopt;
 }
 
+std::optional<InputEventFilter::TimePoint> InputEventFilter::pendingMouseTime() const
+{
+    if (!pending_mouse_event_.has_value())
+        return std::nullopt;
+
+    return last_mouse_time_ + mouse_move_interval_;
+}
+
+std::optional<proto::MouseEvent> InputEventFilter::takePendingMouseEvent(const TimePoint& now)
+{
+    if (!pending_mouse_event_.has_value())
+        return std::nullopt;
+
+    proto::MouseEvent event = std::move(*pending_mouse_event_);
+    pending_mouse_event_.reset();
+
+    last_pos_x_ = event.x();
+    last_pos_y_ = event.y();
+    last_mouse_time_ = now;
+
+    ++send_mouse_count_;
+    return event;
+}
+
 std::optional<proto::KeyEvent> InputEventFilter::keyEvent(const proto::KeyEvent& event)
 {
     if (session_type_ != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -87,7 +147,10 @@ std::optional<proto::ClipboardEvent> InputEventFilter::readClipboardEvent(
     if (!clipboard_enabled_)
         return std::nullopt;
 
-    ++read_clipboard_count_;
+    // A clipboard that is sent in chunks is counted once.
+    if (!(event.flags() & proto::ClipboardEvent::CHUNK) ||
+        (event.flags() & proto::ClipboardEvent::CHUNK_FIRST))
+        ++read_clipboard_count_;
     return event;
 }
 
@@ -100,7 +163,10 @@ std::optional<proto::ClipboardEvent> InputEventFilter::sendClipboardEvent(
     if (!clipboard_enabled_)
         return std::nullopt;
 
-    ++send_clipboard_count_;
+    // A clipboard that is sent in chunks is counted once.
+    if (!(event.flags() & proto::ClipboardEvent::CHUNK) ||
+        (event.flags() & proto::ClipboardEvent::CHUNK_FIRST))
+        ++send_clipboard_count_;
     return event;
 }
 
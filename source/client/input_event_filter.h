@@ -22,6 +22,7 @@
 #include "proto/common.pb.h"
 #include "proto/desktop.pb.h"
 
+#include <chrono>
 #include <optional>
 
 namespace client {
@@ -32,10 +33,27 @@ public:
     InputEventFilter();
     ~InputEventFilter();
 
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
     void setSessionType(proto::SessionType session_type);
     void setClipboardEnabled(bool enable);
 
-    std::optional<proto::MouseEvent> mouseEvent(const proto::MouseEvent& event);
+    // The mouse moves are sent at most |rate| times per second (the refresh rate of the display is
+    // enough). A move which comes earlier is held and replaced by the following moves, it is sent
+    // by takePendingMouseEvent(). The events with buttons or wheel are sent at once. If |rate| is
+    // 0, every move is sent.
+    void setMouseMoveRate(int rate);
+
+    std::optional<proto::MouseEvent> mouseEvent(const proto::MouseEvent& event,
+                                                const TimePoint& now = Clock::now());
+
+    // Returns the time when the held mouse move should be sent or an empty value if there is no
+    // held move.
+    std::optional<TimePoint> pendingMouseTime() const;
+
+    // Returns the held mouse move and sends it.
+    std::optional<proto::MouseEvent> takePendingMouseEvent(const TimePoint& now = Clock::now());
     std::optional<proto::KeyEvent> keyEvent(const proto::KeyEvent& event);
 
     std::optional<proto::ClipboardEvent> readClipboardEvent(const proto::ClipboardEvent& event);
@@ -55,6 +73,10 @@ private:
     int32_t last_pos_y_ = 0;
     uint32_t last_mask_ = 0;
 
+    Clock::duration mouse_move_interval_ = Clock::duration::zero();
+    TimePoint last_mouse_time_;
+    std::optional<proto::MouseEvent> pending_mouse_event_;
+
     int send_mouse_count_ = 0;
     int drop_mouse_count_ = 0;
     int send_key_count_ = 0;
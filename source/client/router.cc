@@ -25,6 +25,12 @@
 
 namespace client {
 
+namespace {
+
+const uint32_t kSessionListPageSize = 500;
+
+} // namespace
+
 Router::Router(std::shared_ptr<RouterWindowProxy> window_proxy,
                std::shared_ptr<base::TaskRunner> io_task_runner)
     : io_task_runner_(io_task_runner),
@@ -57,10 +63,7 @@ void Router::connectToRouter(std::u16string_view address, uint16_t port)
 void Router::refreshSessionList()
 {
     LOG(LS_INFO) << "Sending session list request";
-
-    proto::AdminToRouter message;
-    message.mutable_session_list_request()->set_dummy(1);
-    channel_->send(base::serialize(message));
+    sendSessionListRequest(0);
 }
 
 void Router::stopSession(int64_t session_id)
@@ -126,6 +129,20 @@ void Router::deleteUser(int64_t entry_id)
     channel_->send(base::serialize(message));
 }
 
+void Router::sendSessionListRequest(int64_t after_session_id)
+{
+    proto::AdminToRouter message;
+
+    // The list is received in pages. After the first page the router sends only the changes.
+    proto::SessionListRequest* request = message.mutable_session_list_request();
+    request->set_dummy(1);
+    request->set_after_session_id(after_session_id);
+    request->set_max_count(kSessionListPageSize);
+    request->set_subscribe(true);
+
+    channel_->send(base::serialize(message));
+}
+
 void Router::onConnected()
 {
     channel_->setOwnKeepAlive(true);
@@ -173,11 +190,24 @@ void Router::onMessageReceived(const base::ByteArray& buffer)
 
     if (message.has_session_list())
     {
-        LOG(LS_INFO) << "Session list received";
+        const proto::SessionList& session_list = message.session_list();
+
+        LOG(LS_INFO) << "Session list received (" << session_list.session_size() << " sessions)";
+
+        if (session_list.has_more() && session_list.session_size() > 0)
+        {
+            sendSessionListRequest(
+                session_list.session(session_list.session_size() - 1).session_id());
+        }
 
         window_proxy_->onSessionList(
             std::shared_ptr<proto::SessionList>(message.release_session_list()));
     }
+    else if (message.has_session_list_update())
+    {
+        window_proxy_->onSessionListUpdate(
+            std::shared_ptr<proto::SessionListUpdate>(message.release_session_list_update()));
+    }
     else if (message.has_session_result())
     {
         LOG(LS_INFO) << "Session result received with code: "
@@ -60,6 +60,8 @@ protected:
     void onMessageWritten(size_t pending) override;
 
 private:
+    void sendSessionListRequest(int64_t after_session_id);
+
     std::shared_ptr<base::TaskRunner> io_task_runner_;
     std::unique_ptr<base::NetworkChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
@@ -21,10 +21,85 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/peer/client_authenticator.h"
+#include "base/peer/resumption_ticket_cache.h"
+#include "base/strings/strcat.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
 #include "proto/router_peer.pb.h"
 
 namespace client {
 
+namespace {
+
+// If the host is not reachable directly, the connection attempt usually fails quickly. Without
+// an answer it is abandoned after this time, so that an error of the relay is not delayed.
+const std::chrono::seconds kDirectConnectTimeout{ 5 };
+
+} // namespace
+
+class RouterController::DirectConnection : public base::NetworkChannel::Listener
+{
+public:
+    DirectConnection(RouterController* controller, std::shared_ptr<base::TaskRunner> task_runner)
+        : controller_(controller),
+          channel_(std::make_unique<base::NetworkChannel>()),
+          timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner))
+    {
+        channel_->setListener(this);
+    }
+
+    ~DirectConnection() = default;
+
+    void start(const std::u16string& address, uint16_t port)
+    {
+        timer_.start(kDirectConnectTimeout, [this]()
+        {
+            LOG(LS_INFO) << "Direct connection timeout";
+            controller_->onDirectConnectionError();
+        });
+
+        channel_->connect(address, port);
+    }
+
+    std::unique_ptr<base::NetworkChannel> takeChannel()
+    {
+        timer_.stop();
+        channel_->setListener(nullptr);
+        return std::move(channel_);
+    }
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        controller_->onDirectConnected();
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override
+    {
+        LOG(LS_INFO) << "Direct connection failed ("
+                     << base::NetworkChannel::errorToString(error_code) << ")";
+        controller_->onDirectConnectionError();
+    }
+
+    void onMessageReceived(const base::ByteArray& /* buffer */) override
+    {
+        // Nothing
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+
+private:
+    RouterController* controller_;
+    std::unique_ptr<base::NetworkChannel> channel_;
+    base::WaitableTimer timer_;
+
+    DISALLOW_COPY_AND_ASSIGN(DirectConnection);
+};
+
 RouterController::RouterController(const RouterConfig& router_config,
                                    std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(std::move(task_runner)),
@@ -47,6 +122,9 @@ void RouterController::connectTo(base::HostId host_id, Delegate* delegate)
 
     channel_ = std::make_unique<base::NetworkChannel>();
     channel_->setListener(this);
+
+    // The local port of the connection is used for the hole punching.
+    channel_->setReuseAddress(true);
     channel_->connect(router_config_.address, router_config_.port);
 }
 
@@ -64,11 +142,26 @@ void RouterController::onConnected()
     authenticator_->setPassword(router_config_.password);
     authenticator_->setSessionType(proto::ROUTER_SESSION_CLIENT);
 
+    // Reconnects to the same router with the same user skip SRP.
+    std::string ticket_key = base::utf8FromUtf16(base::strCat(
+        { router_config_.username, u"@", router_config_.address, u":",
+          base::numberToString16(router_config_.port) }));
+
+    base::ResumptionTicketCache* ticket_cache = base::ResumptionTicketCache::instance();
+
+    std::optional<proto::ResumptionTicket> ticket = ticket_cache->ticket(ticket_key);
+    if (ticket.has_value())
+        authenticator_->setTicket(*ticket);
+
     authenticator_->start(std::move(channel_),
-                          [this](base::ClientAuthenticator::ErrorCode error_code)
+                          [this, ticket_key](base::ClientAuthenticator::ErrorCode error_code)
     {
+        base::ResumptionTicketCache* ticket_cache = base::ResumptionTicketCache::instance();
+
         if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
         {
+            ticket_cache->setTicket(ticket_key, authenticator_->ticket());
+
             // The authenticator takes the listener on itself, we return the receipt of
             // notifications.
             channel_ = authenticator_->takeChannel();
@@ -82,6 +175,7 @@ void RouterController::onConnected()
             // Send connection request.
             proto::PeerToRouter message;
             message.mutable_connection_request()->set_host_id(host_id_);
+            message.mutable_connection_request()->set_hole_punching(true);
             channel_->send(base::serialize(message));
         }
         else
@@ -89,6 +183,8 @@ void RouterController::onConnected()
             LOG(LS_WARNING) << "Authentication failed: "
                             << base::ClientAuthenticator::errorToString(error_code);
 
+            ticket_cache->removeTicket(ticket_key);
+
             if (delegate_)
             {
                 Error error;
@@ -130,7 +226,7 @@ void RouterController::onMessageReceived(const base::ByteArray& buffer)
 
     if (message.has_connection_offer())
     {
-        if (relay_peer_)
+        if (relay_peer_ || hole_puncher_)
         {
             LOG(LS_ERROR) << "Re-offer connection detected";
             return;
@@ -170,8 +266,14 @@ void RouterController::onMessageReceived(const base::ByteArray& buffer)
         }
         else
         {
-            relay_peer_ = std::make_unique<base::RelayPeer>();
-            relay_peer_->start(connection_offer.relay(), this);
+            relay_credentials_ =
+                std::make_unique<proto::RelayCredentials>(connection_offer.relay());
+
+            // The relay is used only if the hole punching fails.
+            if (!startHolePunching(connection_offer))
+                startRelayConnection();
+
+            startDirectConnection(connection_offer);
         }
     }
     else
@@ -187,11 +289,120 @@ void RouterController::onMessageWritten(size_t /* pending */)
 
 void RouterController::onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel)
 {
+    if (direct_connection_)
+    {
+        LOG(LS_INFO) << "Relay connection is established first";
+        task_runner_->deleteSoon(std::move(direct_connection_));
+    }
+
     if (delegate_)
         delegate_->onHostConnected(std::move(channel));
 }
 
 void RouterController::onRelayConnectionError()
+{
+    relay_failed_ = true;
+
+    // The direct connection may still succeed.
+    if (direct_connection_)
+        return;
+
+    relayConnectionError();
+}
+
+void RouterController::onHolePunched(std::unique_ptr<base::NetworkChannel> channel)
+{
+    LOG(LS_INFO) << "Hole punching connection is established";
+
+    // This method is called by the hole puncher itself.
+    task_runner_->deleteSoon(std::move(hole_puncher_));
+
+    if (direct_connection_)
+        task_runner_->deleteSoon(std::move(direct_connection_));
+
+    if (delegate_)
+        delegate_->onHostConnected(std::move(channel));
+}
+
+void RouterController::onHolePunchFailed()
+{
+    LOG(LS_INFO) << "Hole punching failed, connecting through the relay";
+
+    // This method is called by the hole puncher itself.
+    task_runner_->deleteSoon(std::move(hole_puncher_));
+    startRelayConnection();
+}
+
+bool RouterController::startHolePunching(const proto::ConnectionOffer& offer)
+{
+    if (!channel_)
+        return false;
+
+    const asio::ip::tcp::endpoint local_endpoint = channel_->localEndpoint();
+
+    std::optional<asio::ip::tcp::endpoint> peer_endpoint =
+        base::HolePuncher::peerEndpoint(offer.peer_address(), offer.peer_port(), local_endpoint);
+    if (!peer_endpoint.has_value())
+        return false;
+
+    hole_puncher_ = std::make_unique<base::HolePuncher>();
+    hole_puncher_->start(local_endpoint, *peer_endpoint, this);
+    return true;
+}
+
+void RouterController::startRelayConnection()
+{
+    DCHECK(relay_credentials_);
+
+    relay_peer_ = std::make_unique<base::RelayPeer>();
+    relay_peer_->start(*relay_credentials_, this);
+}
+
+void RouterController::startDirectConnection(const proto::ConnectionOffer& offer)
+{
+    if (offer.host_address().empty() || !offer.host_port())
+        return;
+
+    std::u16string address = base::utf16FromUtf8(offer.host_address());
+    uint16_t port = static_cast<uint16_t>(offer.host_port());
+
+    LOG(LS_INFO) << "Trying direct connection to " << address << ":" << port;
+
+    direct_connection_ = std::make_unique<DirectConnection>(this, task_runner_);
+    direct_connection_->start(address, port);
+}
+
+void RouterController::onDirectConnected()
+{
+    if (!direct_connection_)
+        return;
+
+    LOG(LS_INFO) << "Direct connection is established first";
+
+    std::unique_ptr<base::NetworkChannel> channel = direct_connection_->takeChannel();
+
+    // This method is called by the direct connection itself.
+    task_runner_->deleteSoon(std::move(direct_connection_));
+    hole_puncher_.reset();
+    relay_peer_.reset();
+
+    if (delegate_)
+        delegate_->onHostConnected(std::move(channel));
+}
+
+void RouterController::onDirectConnectionError()
+{
+    if (!direct_connection_)
+        return;
+
+    // This method is called by the direct connection itself.
+    task_runner_->deleteSoon(std::move(direct_connection_));
+
+    if (relay_failed_)
+        relayConnectionError();
+}
+
+void RouterController::relayConnectionError()
 {
     if (!delegate_)
         return;
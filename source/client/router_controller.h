@@ -22,6 +22,7 @@
 #include "base/waitable_timer.h"
 #include "base/net/network_channel.h"
 #include "base/peer/authenticator.h"
+#include "base/peer/hole_puncher.h"
 #include "base/peer/host_id.h"
 #include "base/peer/relay_peer.h"
 #include "client/router_config.h"
@@ -30,11 +31,17 @@ namespace base {
 class ClientAuthenticator;
 } // namespace base
 
+namespace proto {
+class ConnectionOffer;
+class RelayCredentials;
+} // namespace proto
+
 namespace client {
 
 class RouterController
     : public base::NetworkChannel::Listener,
-      public base::RelayPeer::Delegate
+      public base::RelayPeer::Delegate,
+      public base::HolePuncher::Delegate
 {
 public:
     enum class ErrorType
@@ -92,11 +99,35 @@ protected:
     void onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel) override;
     void onRelayConnectionError() override;
 
+    // base::HolePuncher::Delegate implementation.
+    void onHolePunched(std::unique_ptr<base::NetworkChannel> channel) override;
+    void onHolePunchFailed() override;
+
 private:
+    class DirectConnection;
+
+    // The router sends the address of the host with the offer. A direct connection to it is tried
+    // at the same time as the relay connection. The first connection that is established is used
+    // and the other one is dropped.
+    void startDirectConnection(const proto::ConnectionOffer& offer);
+
+    // If the router sends the endpoint of the host, a hole is punched to it before the relay is
+    // used. Returns false if the hole punching is not possible.
+    bool startHolePunching(const proto::ConnectionOffer& offer);
+    void startRelayConnection();
+
+    void onDirectConnected();
+    void onDirectConnectionError();
+    void relayConnectionError();
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::NetworkChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<base::RelayPeer> relay_peer_;
+    std::unique_ptr<proto::RelayCredentials> relay_credentials_;
+    std::unique_ptr<base::HolePuncher> hole_puncher_;
+    std::unique_ptr<DirectConnection> direct_connection_;
+    bool relay_failed_ = false;
     RouterConfig router_config_;
 
     base::HostId host_id_ = base::kInvalidHostId;
@@ -18,6 +18,7 @@
 
 #include "client/ui/desktop_config_dialog.h"
 
+#include "build/build_config.h"
 #include "client/config_factory.h"
 #include "ui_desktop_config_dialog.h"
 
@@ -37,21 +38,62 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
 
     QComboBox* combo_codec = ui->combo_codec;
 
+#if defined(USE_AV1)
+    if (video_encodings & proto::VIDEO_ENCODING_AV1)
+        combo_codec->addItem(QStringLiteral("AV1"), proto::VIDEO_ENCODING_AV1);
+#endif // defined(USE_AV1)
+
     if (video_encodings & proto::VIDEO_ENCODING_VP9)
         combo_codec->addItem(QStringLiteral("VP9"), proto::VIDEO_ENCODING_VP9);
 
     if (video_encodings & proto::VIDEO_ENCODING_VP8)
         combo_codec->addItem(QStringLiteral("VP8"), proto::VIDEO_ENCODING_VP8);
 
+#if defined(OS_WIN) || defined(OS_MAC)
+    // The client has H.264 decoders only for these systems.
+    if (video_encodings & proto::VIDEO_ENCODING_H264)
+        combo_codec->addItem(QStringLiteral("H.264"), proto::VIDEO_ENCODING_H264);
+#endif // defined(OS_WIN) || defined(OS_MAC)
+
     int current_codec = combo_codec->findData(config_.video_encoding());
     if (current_codec == -1)
         current_codec = 0;
 
     combo_codec->setCurrentIndex(current_codec);
 
+    if (config_.flags() & proto::ENABLE_FULL_CHROMA)
+        ui->checkbox_full_chroma->setChecked(true);
+
+    if (config_.flags() & proto::ENABLE_LOSSLESS_REFINEMENT)
+        ui->checkbox_lossless_refinement->setChecked(true);
+
+    if (config_.flags() & proto::ENABLE_MULTI_STREAM)
+        ui->checkbox_multi_stream->setChecked(true);
+
+    auto update_codec_options = [this]()
+    {
+        const int video_encoding = ui->combo_codec->currentData().toInt();
+
+        // Only VP9 supports the encoding without chroma subsampling.
+        ui->checkbox_full_chroma->setEnabled(video_encoding == proto::VIDEO_ENCODING_VP9);
+
+        // The lossless refinement is supported only for VPX and AV1 codecs.
+        ui->checkbox_lossless_refinement->setEnabled(
+            video_encoding == proto::VIDEO_ENCODING_VP8 ||
+            video_encoding == proto::VIDEO_ENCODING_VP9 ||
+            video_encoding == proto::VIDEO_ENCODING_AV1);
+    };
+
+    connect(combo_codec, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, update_codec_options);
+    update_codec_options();
+
     if (config_.audio_encoding() != proto::AUDIO_ENCODING_UNKNOWN)
         ui->checkbox_audio->setChecked(true);
 
+    if (config_.flags() & proto::ALLOW_SESSION_RECORDING)
+        ui->checkbox_allow_recording->setChecked(true);
+
     if (session_type == proto::SESSION_TYPE_DESKTOP_MANAGE)
     {
         if (config_.flags() & proto::LOCK_AT_DISCONNECT)
@@ -106,12 +148,27 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
 
         uint32_t flags = 0;
 
+        if (ui->checkbox_full_chroma->isChecked() && ui->checkbox_full_chroma->isEnabled())
+            flags |= proto::ENABLE_FULL_CHROMA;
+
+        if (ui->checkbox_lossless_refinement->isChecked() &&
+            ui->checkbox_lossless_refinement->isEnabled())
+        {
+            flags |= proto::ENABLE_LOSSLESS_REFINEMENT;
+        }
+
+        if (ui->checkbox_multi_stream->isChecked())
+            flags |= proto::ENABLE_MULTI_STREAM;
+
         if (ui->checkbox_cursor_shape->isChecked() && ui->checkbox_cursor_shape->isEnabled())
             flags |= proto::ENABLE_CURSOR_SHAPE;
 
         if (ui->checkbox_clipboard->isChecked() && ui->checkbox_clipboard->isEnabled())
             flags |= proto::ENABLE_CLIPBOARD;
 
+        if (ui->checkbox_allow_recording->isChecked())
+            flags |= proto::ALLOW_SESSION_RECORDING;
+
         if (ui->checkbox_desktop_effects->isChecked())
             flags |= proto::DISABLE_DESKTOP_EFFECTS;
 
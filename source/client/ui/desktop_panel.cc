@@ -22,6 +22,7 @@
 #include "client/ui/desktop_settings.h"
 #include "client/ui/select_screen_action.h"
 
+#include <QFontMetrics>
 #include <QMenu>
 #include <QMessageBox>
 #include <QPropertyAnimation>
@@ -43,6 +44,8 @@ DesktopPanel::DesktopPanel(proto::SessionType session_type, QWidget* parent)
     screens_group_ = new QActionGroup(screens_menu_);
     ui.action_monitors->setMenu(screens_menu_);
 
+    windows_menu_ = new QMenu(tr("Application Window"), screens_menu_);
+
     connect(screens_menu_, &QMenu::aboutToShow, [this]() { allow_hide_ = false; });
     connect(screens_menu_, &QMenu::aboutToHide, [this]()
     {
@@ -178,10 +181,16 @@ void DesktopPanel::setScreenList(const proto::ScreenList& screen_list)
 {
     LOG(LS_INFO) << "Setting up a new list of screens";
 
+    // The list of windows is updated often, the previous actions are not kept.
+    qDeleteAll(screens_group_->actions());
     screens_menu_->clear();
+    windows_menu_->clear();
+
+    const bool has_screens = screen_list.screen_size() > 1;
+    const bool has_windows = screen_list.window_size() > 0;
 
     // If it has only one screen or an empty list is received.
-    if (screen_list.screen_size() <= 1)
+    if (!has_screens && !has_windows)
     {
         LOG(LS_INFO) << "List of screens less than or equal to 1";
 
@@ -201,7 +210,7 @@ void DesktopPanel::setScreenList(const proto::ScreenList& screen_list)
         ui.toolbar->widgetForAction(ui.action_monitors));
     button->setPopupMode(QToolButton::InstantPopup);
 
-    for (int i = 0; i < screen_list.screen_size(); ++i)
+    for (int i = 0; has_screens && i < screen_list.screen_size(); ++i)
     {
         const proto::Screen& screen = screen_list.screen(i);
 
@@ -220,6 +229,31 @@ void DesktopPanel::setScreenList(const proto::ScreenList& screen_list)
         screens_menu_->addAction(action);
     }
 
+    if (has_windows)
+    {
+        static const int kMaxWindowTitleWidth = 320;
+
+        const QFontMetrics metrics(windows_menu_->font());
+
+        for (int i = 0; i < screen_list.window_size(); ++i)
+        {
+            const proto::Screen& window = screen_list.window(i);
+
+            QString title = metrics.elidedText(
+                QString::fromStdString(window.title()), Qt::ElideRight, kMaxWindowTitleWidth);
+
+            SelectScreenAction* action = new SelectScreenAction(window, title, screens_group_);
+            if (screen_list.current_window() == window.id())
+                action->setChecked(true);
+
+            screens_group_->addAction(action);
+            windows_menu_->addAction(action);
+        }
+
+        screens_menu_->addSeparator();
+        screens_menu_->addMenu(windows_menu_);
+    }
+
     ui.action_monitors->setVisible(true);
     ui.action_monitors->setEnabled(true);
 
@@ -387,6 +421,7 @@ void DesktopPanel::createAdditionalMenu(proto::SessionType session_type)
 
     additional_menu_->addSeparator();
     additional_menu_->addAction(ui.action_screenshot);
+    additional_menu_->addAction(ui.action_recording);
     additional_menu_->addAction(ui.action_statistics);
 
     // Set the menu for the button on the toolbar.
@@ -451,6 +486,7 @@ void DesktopPanel::createAdditionalMenu(proto::SessionType session_type)
     });
 
     connect(ui.action_screenshot, &QAction::triggered, this, &DesktopPanel::takeScreenshot);
+    connect(ui.action_recording, &QAction::triggered, this, &DesktopPanel::recordingStateChanged);
     connect(additional_menu_, &QMenu::aboutToShow, [this]() { allow_hide_ = false; });
     connect(additional_menu_, &QMenu::aboutToHide, [this]()
     {
@@ -58,6 +58,7 @@ signals:
     void autoScrollChanged(bool enabled);
     void keyCombinationsChanged(bool enabled);
     void takeScreenshot();
+    void recordingStateChanged(bool enable);
     void startSession(proto::SessionType session_type);
     void powerControl(proto::PowerControl::Action action);
     void startRemoteUpdate();
@@ -99,6 +100,7 @@ private:
     QActionGroup* scale_group_ = nullptr;
 
     QMenu* screens_menu_ = nullptr;
+    QMenu* windows_menu_ = nullptr;
     QActionGroup* screens_group_ = nullptr;
 
     QTimer* hide_timer_ = nullptr;
@@ -18,6 +18,9 @@
 
 #include "client/ui/desktop_settings.h"
 
+#include <QDir>
+#include <QStandardPaths>
+
 namespace client {
 
 namespace {
@@ -25,6 +28,7 @@ namespace {
 const QString kScaleParam = QStringLiteral("Desktop/Scale");
 const QString kAutoScrollingParam = QStringLiteral("Desktop/AutoScrolling");
 const QString kSendKeyCombinationsParam = QStringLiteral("Desktop/SendKeyCombinations");
+const QString kRecordingPathParam = QStringLiteral("Desktop/RecordingPath");
 
 } // namespace
 
@@ -82,4 +86,17 @@ void DesktopSettings::setSendKeyCombinations(bool enable)
     settings_.setValue(kSendKeyCombinationsParam, enable);
 }
 
+QString DesktopSettings::recordingPath() const
+{
+    QString default_path =
+        QStandardPaths::writableLocation(QStandardPaths::MoviesLocation) + QStringLiteral("/Aspia");
+
+    return settings_.value(kRecordingPathParam, QDir::toNativeSeparators(default_path)).toString();
+}
+
+void DesktopSettings::setRecordingPath(const QString& path)
+{
+    settings_.setValue(kRecordingPathParam, path);
+}
+
 } // namespace client
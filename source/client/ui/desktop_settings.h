@@ -39,6 +39,10 @@ public:
     bool sendKeyCombinations() const;
     void setSendKeyCombinations(bool enable);
 
+    // Directory for the recordings of the sessions.
+    QString recordingPath() const;
+    void setRecordingPath(const QString& path);
+
 private:
     QSettings settings_;
 
@@ -19,10 +19,18 @@
 #include "client/ui/desktop_widget.h"
 
 #include "base/logging.h"
+#include "base/system_time.h"
+#include "base/trace_event.h"
+#include "base/desktop/frame.h"
 #include "common/keycode_converter.h"
-#include "client/ui/frame_qimage.h"
 
 #include <QApplication>
+#include <QOpenGLContext>
+#include <QOpenGLPixelTransferOptions>
+#include <QOpenGLTexture>
+#include <QPainter>
+#include <QScreen>
+#include <QWindow>
 #include <QWheelEvent>
 
 #if defined(OS_LINUX)
@@ -42,6 +50,13 @@ namespace {
 
 constexpr uint32_t kWheelMask = proto::MouseEvent::WHEEL_DOWN | proto::MouseEvent::WHEEL_UP;
 
+// If the widget is not painted (e.g. the window is minimized), the oldest measured frames are
+// dropped.
+const size_t kMaxUnpaintedFrames = 64;
+
+// Used if the refresh rate of the screen is unknown.
+constexpr int64_t kDefaultRefreshInterval = 1000000 / 60;
+
 bool isNumLockActivated()
 {
 #if defined(OS_WIN)
@@ -103,23 +118,66 @@ bool isModifierKey(int key)
 } // namespace
 
 DesktopWidget::DesktopWidget(QWidget* parent)
-    : QWidget(parent)
+    : QOpenGLWidget(parent)
 {
     setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     setFocusPolicy(Qt::StrongFocus);
     setAttribute(Qt::WA_OpaquePaintEvent);
     setAttribute(Qt::WA_NoSystemBackground);
     setMouseTracking(true);
+
+    // The swap of the buffers waits for the vsync. Without it the frames are torn and the paints
+    // are not paced by the screen.
+    QSurfaceFormat surface_format = format();
+    surface_format.setSwapInterval(1);
+    setFormat(surface_format);
+
+    present_timer_ = new QTimer(this);
+    present_timer_->setSingleShot(true);
+    present_timer_->setTimerType(Qt::PreciseTimer);
+
+    connect(present_timer_, &QTimer::timeout, this, &DesktopWidget::present);
+    connect(this, &QOpenGLWidget::frameSwapped, this, &DesktopWidget::onFrameSwapped);
+}
+
+DesktopWidget::~DesktopWidget()
+{
+    makeCurrent();
+    cleanupGL();
+    doneCurrent();
 }
 
-base::Frame* DesktopWidget::desktopFrame()
+DoubleBufferedFrame* DesktopWidget::desktopFrame()
 {
     return frame_.get();
 }
 
-void DesktopWidget::setDesktopFrame(std::shared_ptr<base::Frame>& frame)
+void DesktopWidget::setDesktopFrame(std::shared_ptr<DoubleBufferedFrame>& frame)
 {
     frame_ = std::move(frame);
+
+    // The new frame is uploaded completely.
+    dirty_region_.clear();
+    if (frame_)
+        dirty_region_.addRect(base::Rect::makeSize(frame_->size()));
+}
+
+void DesktopWidget::updateDesktopFrame(
+    const base::Region& region, const FrameTimestamps& timestamps)
+{
+    dirty_region_.addRegion(region);
+
+    // The refinement of the frame is not measured.
+    if (timestamps.receive)
+    {
+        if (unpainted_frames_.size() >= kMaxUnpaintedFrames)
+            unpainted_frames_.erase(unpainted_frames_.begin());
+
+        unpainted_frames_.push_back(timestamps);
+    }
+
+    frame_pending_ = true;
+    schedulePresent();
 }
 
 void DesktopWidget::doMouseEvent(QEvent::Type event_type,
@@ -169,6 +227,10 @@ void DesktopWidget::doMouseEvent(QEvent::Type event_type,
             wheel_steps = 1;
     }
 
+    // The remote cursor follows the local mouse again.
+    if (prev_pos_ != pos)
+        hideRemoteCursor();
+
     if (prev_pos_ != pos || prev_mask_ != mask)
     {
         prev_pos_ = pos;
@@ -311,22 +373,63 @@ void DesktopWidget::enableKeyCombinations(bool enable)
 #endif // defined(OS_WIN)
 }
 
-void DesktopWidget::paintEvent(QPaintEvent* /* event */)
+void DesktopWidget::initializeGL()
 {
-    FrameQImage* frame = reinterpret_cast<FrameQImage*>(frame_.get());
-    if (frame)
+    initializeOpenGLFunctions();
+
+    if (!blitter_.create())
+        LOG(LS_ERROR) << "Unable to create the texture blitter";
+
+    // The context is destroyed when the widget is moved to another window (e.g. in the full
+    // screen mode). A new context gets a new texture with the whole frame.
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, [this]()
     {
-        painter_.begin(this);
+        makeCurrent();
+        cleanupGL();
+        doneCurrent();
+    });
 
+    if (frame_)
+        dirty_region_.setRect(base::Rect::makeSize(frame_->size()));
+}
 
-#if !defined(OS_MAC)
-        // SmoothPixmapTransform causes too much CPU load in MacOSX.
-        painter_.setRenderHint(QPainter::SmoothPixmapTransform);
-#endif
+void DesktopWidget::paintGL()
+{
+    TRACE_EVENT("paint", "DesktopWidget::paintGL");
 
-        painter_.drawImage(rect(), frame->constImage());
-        painter_.end();
-    }
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!frame_ || !blitter_.isCreated())
+        return;
+
+    uploadFrame();
+    if (!texture_)
+        return;
+
+    // The frames are on the screen after the next swap of the buffers.
+    painted_frames_.insert(painted_frames_.end(), unpainted_frames_.cbegin(),
+                           unpainted_frames_.cend());
+    unpainted_frames_.clear();
+
+    // The frame has no alpha channel, the widget stays opaque.
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+
+    blitter_.bind();
+
+    // The texture contains the frame in BGRA order.
+    blitter_.setRedBlueSwizzle(true);
+
+    // The widget has the aspect ratio of the frame, so the texture fills the whole widget. The
+    // viewport is in the physical pixels on HiDPI screens.
+    blitter_.blit(texture_->textureId(),
+                  QOpenGLTextureBlitter::targetTransform(QRectF(rect()), rect()),
+                  QOpenGLTextureBlitter::OriginTopLeft);
+    blitter_.release();
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    paintRemoteCursor();
 }
 
 void DesktopWidget::mouseMoveEvent(QMouseEvent* event)
@@ -471,4 +574,184 @@ LRESULT CALLBACK DesktopWidget::keyboardHookProc(INT code, WPARAM wparam, LPARAM
 }
 #endif // defined(OS_WIN)
 
+void DesktopWidget::uploadFrame()
+{
+    const base::Size& size = frame_->size();
+
+    if (!texture_ || texture_->width() != size.width() || texture_->height() != size.height())
+    {
+        texture_ = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
+        texture_->setSize(size.width(), size.height());
+        texture_->setFormat(QOpenGLTexture::RGBA8_UNorm);
+        texture_->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+        texture_->setWrapMode(QOpenGLTexture::ClampToEdge);
+        texture_->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+
+        if (!texture_->isStorageAllocated())
+        {
+            LOG(LS_ERROR) << "Unable to allocate the texture: " << size;
+            texture_.reset();
+            return;
+        }
+
+        dirty_region_.setRect(base::Rect::makeSize(size));
+    }
+
+    dirty_region_.intersectWith(base::Rect::makeSize(size));
+    if (dirty_region_.isEmpty())
+        return;
+
+    // The decoder does not swap the frames while the front frame is being uploaded.
+    DoubleBufferedFrame::ScopedFront front(frame_.get());
+    const base::Frame* frame = front.frame();
+
+    // The rectangles are read directly from the frame memory.
+    QOpenGLPixelTransferOptions options;
+    options.setRowLength(frame->stride() / base::Frame::kBytesPerPixel);
+    options.setAlignment(4);
+
+    for (base::Region::Iterator it(dirty_region_); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        texture_->setData(rect.x(), rect.y(), 0, rect.width(), rect.height(), 1,
+                          QOpenGLTexture::RGBA, QOpenGLTexture::UInt8,
+                          frame->frameDataAtPos(rect.topLeft()), &options);
+    }
+
+    dirty_region_.clear();
+}
+
+void DesktopWidget::onFrameSwapped()
+{
+    const int64_t paint_time = base::SystemTime::microsecondsSinceEpoch();
+
+    last_present_time_ = paint_time;
+    present_pending_ = false;
+
+    // The frames which arrived during the paint are presented at the next vsync.
+    if (frame_pending_)
+        schedulePresent();
+
+    if (painted_frames_.empty())
+        return;
+
+    for (auto& timestamps : painted_frames_)
+    {
+        timestamps.paint = paint_time;
+        emit sig_framePainted(timestamps);
+    }
+
+    painted_frames_.clear();
+}
+
+void DesktopWidget::schedulePresent()
+{
+    // The latest state of the frame is taken at the time of the paint.
+    if (present_pending_ || present_timer_->isActive())
+        return;
+
+    const int64_t now = base::SystemTime::microsecondsSinceEpoch();
+    const int64_t next_vsync = last_present_time_ + refreshInterval();
+
+    if (next_vsync <= now)
+    {
+        present();
+        return;
+    }
+
+    // The swap interval is not respected by all platforms (e.g. the widget is composed into the
+    // backing store of the window). The timer keeps the paints not more often than the screen
+    // is refreshed.
+    present_timer_->start(static_cast<int>((next_vsync - now + 999) / 1000));
+}
+
+void DesktopWidget::present()
+{
+    if (!frame_pending_)
+        return;
+
+    frame_pending_ = false;
+    present_pending_ = true;
+    update();
+}
+
+int64_t DesktopWidget::refreshInterval() const
+{
+    QWindow* window_handle = window()->windowHandle();
+    if (!window_handle)
+        return kDefaultRefreshInterval;
+
+    QScreen* current_screen = window_handle->screen();
+    if (!current_screen)
+        return kDefaultRefreshInterval;
+
+    const qreal refresh_rate = current_screen->refreshRate();
+    if (refresh_rate < 1.0)
+        return kDefaultRefreshInterval;
+
+    return static_cast<int64_t>(1000000.0 / refresh_rate);
+}
+
+void DesktopWidget::setRemoteCursor(const QPixmap& pixmap, const QPoint& hotspot)
+{
+    remote_cursor_ = pixmap;
+    remote_cursor_hotspot_ = hotspot;
+
+    if (remote_cursor_visible_)
+    {
+        frame_pending_ = true;
+        schedulePresent();
+    }
+}
+
+void DesktopWidget::setRemoteCursorPosition(const QPoint& position)
+{
+    if (remote_cursor_visible_ && remote_cursor_pos_ == position)
+        return;
+
+    remote_cursor_pos_ = position;
+    remote_cursor_visible_ = true;
+
+    // The cursor is painted with the next frame, at the latest at the next vsync.
+    frame_pending_ = true;
+    schedulePresent();
+}
+
+void DesktopWidget::paintRemoteCursor()
+{
+    if (!remote_cursor_visible_ || remote_cursor_.isNull() || !frame_)
+        return;
+
+    const base::Size& frame_size = frame_->size();
+    if (frame_size.isEmpty())
+        return;
+
+    // The frame is scaled to the size of the widget, the cursor keeps its size.
+    const QPoint pos(remote_cursor_pos_.x() * width() / frame_size.width(),
+                     remote_cursor_pos_.y() * height() / frame_size.height());
+
+    QPainter painter(this);
+    painter.drawPixmap(pos - remote_cursor_hotspot_, remote_cursor_);
+}
+
+void DesktopWidget::hideRemoteCursor()
+{
+    if (!remote_cursor_visible_)
+        return;
+
+    remote_cursor_visible_ = false;
+
+    frame_pending_ = true;
+    schedulePresent();
+}
+
+void DesktopWidget::cleanupGL()
+{
+    texture_.reset();
+
+    if (blitter_.isCreated())
+        blitter_.destroy();
+}
+
 } // namespace client
@@ -19,7 +19,9 @@
 #ifndef CLIENT__UI__DESKTOP_WIDGET_H
 #define CLIENT__UI__DESKTOP_WIDGET_H
 
-#include "base/desktop/frame.h"
+#include "base/desktop/region.h"
+#include "client/double_buffered_frame.h"
+#include "client/frame_timestamps.h"
 #include "build/build_config.h"
 #include "proto/desktop.pb.h"
 
@@ -28,24 +30,40 @@
 #endif // defined(OS_WIN)
 
 #include <QEvent>
-#include <QPainter>
-#include <QWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLTextureBlitter>
+#include <QOpenGLWidget>
+#include <QPixmap>
+#include <QTimer>
 
 #include <memory>
 #include <set>
+#include <vector>
+
+class QOpenGLTexture;
 
 namespace client {
 
-class DesktopWidget : public QWidget
+// Shows the remote desktop. The frame is kept in a texture and only the changed areas of the
+// frame are uploaded to it. The texture is scaled to the size of the widget on the GPU.
+class DesktopWidget
+    : public QOpenGLWidget,
+      protected QOpenGLFunctions
 {
     Q_OBJECT
 
 public:
     explicit DesktopWidget(QWidget* parent);
-    ~DesktopWidget() = default;
+    ~DesktopWidget();
+
+    DoubleBufferedFrame* desktopFrame();
+    void setDesktopFrame(std::shared_ptr<DoubleBufferedFrame>& frame);
 
-    base::Frame* desktopFrame();
-    void setDesktopFrame(std::shared_ptr<base::Frame>& frame);
+    // Marks |region| of the frame as changed. It is uploaded to the texture at the next paint.
+    // When the frame is on the screen, sig_framePainted() is emitted with |timestamps|.
+    // The paints are paced by the refresh of the screen: frames which arrive before the next
+    // vsync are merged and only the latest state of the frame is presented.
+    void updateDesktopFrame(const base::Region& region, const FrameTimestamps& timestamps);
 
     void doMouseEvent(QEvent::Type event_type,
                       const Qt::MouseButtons& buttons,
@@ -53,6 +71,12 @@ public:
                       const QPoint& delta = QPoint());
     void doKeyEvent(QKeyEvent* event);
 
+    // The cursor of the remote desktop is drawn over the frame at |position| (in the coordinates
+    // of the frame) until the local mouse is moved in the widget. The local cursor has the same
+    // shape, so the drawn cursor shows the moves made on the host by someone else.
+    void setRemoteCursor(const QPixmap& pixmap, const QPoint& hotspot);
+    void setRemoteCursorPosition(const QPoint& position);
+
 public slots:
     void executeKeyCombination(int key_sequence);
 
@@ -63,10 +87,14 @@ public slots:
 signals:
     void sig_mouseEvent(const proto::MouseEvent& event);
     void sig_keyEvent(const proto::KeyEvent& event);
+    void sig_framePainted(const client::FrameTimestamps& timestamps);
 
 protected:
+    // QOpenGLWidget implementation.
+    void initializeGL() override;
+    void paintGL() override;
+
     // QWidget implementation.
-    void paintEvent(QPaintEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
     void mousePressEvent(QMouseEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* event) override;
@@ -79,20 +107,53 @@ protected:
 
 private:
     void executeKeyEvent(uint32_t usb_keycode, uint32_t flags);
+    void uploadFrame();
+    void cleanupGL();
+    void onFrameSwapped();
+    void schedulePresent();
+    void present();
+    int64_t refreshInterval() const;
+    void paintRemoteCursor();
+    void hideRemoteCursor();
+
+    std::unique_ptr<QOpenGLTexture> texture_;
+    QOpenGLTextureBlitter blitter_;
+
+    // The area of the frame which is not uploaded to the texture yet.
+    base::Region dirty_region_;
 
-    QPainter painter_;
+    // Frames which are not uploaded to the texture yet and frames which are uploaded but not on
+    // the screen yet.
+    std::vector<FrameTimestamps> unpainted_frames_;
+    std::vector<FrameTimestamps> painted_frames_;
+
+    // The frame is updated after the last paint was requested.
+    bool frame_pending_ = false;
+
+    // The paint is requested and its buffers are not swapped yet.
+    bool present_pending_ = false;
+
+    // Time of the last swap of the buffers (in microseconds).
+    int64_t last_present_time_ = 0;
+
+    QTimer* present_timer_;
 
 #if defined(OS_WIN)
     static LRESULT CALLBACK keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam);
     base::win::ScopedHHOOK keyboard_hook_;
 #endif // defined(OS_WIN)
 
-    std::shared_ptr<base::Frame> frame_;
+    std::shared_ptr<DoubleBufferedFrame> frame_;
     bool enable_key_sequenses_ = true;
 
     QPoint prev_pos_;
     uint32_t prev_mask_ = 0;
 
+    QPixmap remote_cursor_;
+    QPoint remote_cursor_hotspot_;
+    QPoint remote_cursor_pos_;
+    bool remote_cursor_visible_ = false;
+
     std::set<uint32_t> pressed_keys_;
 
     DISALLOW_COPY_AND_ASSIGN(DesktopWidget);
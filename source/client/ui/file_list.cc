@@ -76,6 +76,7 @@ FileList::FileList(QWidget* parent)
     connect(model_, &FileListModel::nameChangeRequest, this, &FileList::nameChangeRequest);
     connect(model_, &FileListModel::createFolderRequest, this, &FileList::createFolderRequest);
     connect(model_, &FileListModel::fileListDropped, this, &FileList::fileListDropped);
+    connect(model_, &FileListModel::fetchMoreRequest, this, &FileList::fetchMoreRequest);
 }
 
 void FileList::showDriveList(AddressBarModel* model)
@@ -105,6 +106,11 @@ void FileList::showFileList(const proto::FileList& file_list)
     model_->setFileList(file_list);
 }
 
+void FileList::addFileList(const proto::FileList& file_list)
+{
+    model_->addFileList(file_list);
+}
+
 void FileList::setMimeType(const QString& mime_type)
 {
     model_->setMimeType(mime_type);
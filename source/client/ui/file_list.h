@@ -39,6 +39,7 @@ public:
 
     void showDriveList(AddressBarModel* model);
     void showFileList(const proto::FileList& file_list);
+    void addFileList(const proto::FileList& file_list);
     void setMimeType(const QString& mime_type);
     bool isDriveListShown() const;
     bool isFileListShown() const;
@@ -51,6 +52,7 @@ signals:
     void nameChangeRequest(const QString& old_name, const QString& new_name);
     void createFolderRequest(const QString& name);
     void fileListDropped(const QString& folder_name, const std::vector<FileTransfer::Item>& files);
+    void fetchMoreRequest();
 
 protected:
     // QTreeView implemenation.
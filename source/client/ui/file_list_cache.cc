@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/ui/file_list_cache.h"
+
+#include "base/logging.h"
+
+namespace client {
+
+FileListCache::FileListCache(size_t capacity)
+    : capacity_(capacity)
+{
+    DCHECK_GT(capacity_, 0u);
+}
+
+FileListCache::~FileListCache() = default;
+
+const proto::FileList* FileListCache::find(const QString& path, int64_t modification_time)
+{
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if (it->path != path)
+            continue;
+
+        if (it->modification_time != modification_time)
+        {
+            // The directory has changed since the listing was received.
+            entries_.erase(it);
+            return nullptr;
+        }
+
+        entries_.splice(entries_.begin(), entries_, it);
+        return &entries_.front().file_list;
+    }
+
+    return nullptr;
+}
+
+void FileListCache::add(
+    const QString& path, int64_t modification_time, const proto::FileList& file_list)
+{
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if (it->path == path)
+        {
+            entries_.erase(it);
+            break;
+        }
+    }
+
+    if (entries_.size() >= capacity_)
+        entries_.pop_back();
+
+    entries_.push_front({ path, modification_time, file_list });
+}
+
+void FileListCache::clear()
+{
+    entries_.clear();
+}
+
+} // namespace client
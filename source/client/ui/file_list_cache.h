@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__UI__FILE_LIST_CACHE_H
+#define CLIENT__UI__FILE_LIST_CACHE_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <QString>
+
+#include <list>
+
+namespace client {
+
+// Keeps the recently received listings of directories. A listing is valid while the modification
+// time of its directory (as reported in the listing of the parent directory) is the same. The
+// modification time of a directory changes when items are added, removed or renamed in it, but
+// not when the contents of its files change, so the sizes of the files in a cached listing may be
+// out of date until the panel is refreshed.
+class FileListCache
+{
+public:
+    static const size_t kDefaultCapacity = 32;
+
+    explicit FileListCache(size_t capacity = kDefaultCapacity);
+    ~FileListCache();
+
+    // Returns the listing of |path| if it was received when |path| had |modification_time|, or
+    // nullptr. The returned pointer is valid until the next call of add() or clear().
+    const proto::FileList* find(const QString& path, int64_t modification_time);
+
+    // Adds the complete listing of |path|. The least recently used listing is removed if the
+    // cache is full.
+    void add(const QString& path, int64_t modification_time, const proto::FileList& file_list);
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        QString path;
+        int64_t modification_time;
+        proto::FileList file_list;
+    };
+
+    const size_t capacity_;
+
+    // The most recently used entry is the first.
+    std::list<Entry> entries_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileListCache);
+};
+
+} // namespace client
+
+#endif // CLIENT__UI__FILE_LIST_CACHE_H
@@ -109,11 +109,20 @@ void FileListModel::setMimeType(const QString& mime_type)
 void FileListModel::setFileList(const proto::FileList& list)
 {
     clear();
+    addFileList(list);
+}
+
+void FileListModel::addFileList(const proto::FileList& list)
+{
+    has_more_ = list.has_more();
 
     if (!list.item_size())
         return;
 
-    beginInsertRows(QModelIndex(), 0, list.item_size() - 1);
+    const int first_row = folder_items_.count() + file_items_.count();
+    const int last_row = first_row + list.item_size() - 1;
+
+    beginInsertRows(QModelIndex(), first_row, last_row);
 
     for (int i = 0; i < list.item_size(); ++i)
     {
@@ -145,6 +154,13 @@ void FileListModel::setFileList(const proto::FileList& list)
     sortItems(current_column_, current_order_);
 
     endInsertRows();
+
+    // The new items are sorted together with the rows that are already shown.
+    if (first_row)
+    {
+        emit dataChanged(index(0, 0, QModelIndex()),
+                         index(last_row, COLUMN_COUNT - 1, QModelIndex()));
+    }
 }
 
 void FileListModel::setSortOrder(int column, Qt::SortOrder order)
@@ -155,6 +171,8 @@ void FileListModel::setSortOrder(int column, Qt::SortOrder order)
 
 void FileListModel::clear()
 {
+    has_more_ = false;
+
     if (folder_items_.isEmpty() && file_items_.isEmpty())
         return;
 
@@ -374,6 +392,21 @@ QVariant FileListModel::headerData(int section, Qt::Orientation orientation, int
     }
 }
 
+bool FileListModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && has_more_;
+}
+
+void FileListModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    // The flag is set again when the page is received. Until then the view does not ask for more.
+    has_more_ = false;
+    emit fetchMoreRequest();
+}
+
 QStringList FileListModel::mimeTypes() const
 {
     return QStringList() << mime_type_;
@@ -36,6 +36,8 @@ public:
     void setMimeType(const QString& mime_type);
     QString mimeType() const { return mime_type_; }
     void setFileList(const proto::FileList& file_list);
+    // Adds the next page of the list.
+    void addFileList(const proto::FileList& file_list);
     void setSortOrder(int column, Qt::SortOrder order);
     void clear();
     bool isFolder(const QModelIndex& index) const;
@@ -51,6 +53,8 @@ public:
     QVariant data(const QModelIndex& index, int role) const override;
     bool setData(const QModelIndex& index, const QVariant& value, int role) override;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
     QStringList mimeTypes() const override;
     QMimeData* mimeData(const QModelIndexList& indexes) const override;
     bool canDropMimeData(const QMimeData* data, Qt::DropAction action,
@@ -66,6 +70,7 @@ signals:
     void nameChangeRequest(const QString& old_name, const QString& new_name);
     void createFolderRequest(const QString& name);
     void fileListDropped(const QString& folder_name, const std::vector<FileTransfer::Item>& files);
+    void fetchMoreRequest();
 
 protected:
     void sortItems(int column, Qt::SortOrder order);
@@ -94,6 +99,9 @@ private:
     const QIcon dir_icon_;
     const QString dir_type_;
 
+    // The peer has more items than received so far.
+    bool has_more_ = false;
+
     Qt::SortOrder current_order_ = Qt::AscendingOrder;
     int current_column_ = 0;
 
@@ -36,6 +36,12 @@ namespace client {
 
 namespace {
 
+// The listings of the child folders are requested when the panel is idle for this time.
+const int kPrefetchDelayMs = 500;
+
+// The number of the child folders requested in advance for one listing.
+const int kMaxPrefetchCount = 4;
+
 QString parentPath(const QString& path)
 {
     int from = -1;
@@ -56,6 +62,10 @@ FilePanel::FilePanel(QWidget* parent)
 {
     ui.setupUi(this);
 
+    prefetch_timer_.setSingleShot(true);
+    prefetch_timer_.setInterval(kPrefetchDelayMs);
+    connect(&prefetch_timer_, &QTimer::timeout, this, &FilePanel::onPrefetchTimeout);
+
     FileItemDelegate* delegate = static_cast<FileItemDelegate*>(ui.list->itemDelegate());
     connect(delegate, &FileItemDelegate::editFinished, this, &FilePanel::refresh);
 
@@ -65,6 +75,7 @@ FilePanel::FilePanel(QWidget* parent)
     connect(ui.list, &FileList::customContextMenuRequested, this, &FilePanel::onListContextMenu);
     connect(ui.list, &FileList::nameChangeRequest, this, &FilePanel::onNameChangeRequest);
     connect(ui.list, &FileList::createFolderRequest, this, &FilePanel::onCreateFolderRequest);
+    connect(ui.list, &FileList::fetchMoreRequest, this, &FilePanel::onFetchMoreRequest);
 
     connect(ui.action_up, &QAction::triggered, this, &FilePanel::toParentFolder);
     connect(ui.action_refresh, &QAction::triggered, this, &FilePanel::refresh);
@@ -102,6 +113,44 @@ void FilePanel::onDriveList(proto::FileError error_code, const proto::DriveList&
 
 void FilePanel::onFileList(proto::FileError error_code, const proto::FileList& file_list)
 {
+    if (!prefetching_.empty())
+    {
+        Prefetch prefetch = std::move(prefetching_.front());
+        prefetching_.pop_front();
+
+        // Only the complete listings are kept.
+        if (error_code == proto::FILE_ERROR_SUCCESS && !file_list.has_more())
+            cache_.add(prefetch.path, prefetch.modification_time, file_list);
+        return;
+    }
+
+    if (stale_pages_)
+    {
+        --stale_pages_;
+        return;
+    }
+
+    if (fetching_more_)
+    {
+        fetching_more_ = false;
+
+        if (error_code != proto::FILE_ERROR_SUCCESS)
+        {
+            showError(tr("Failed to get list of files: %1").arg(fileErrorToString(error_code)));
+        }
+        else
+        {
+            ui.list->addFileList(file_list);
+            addFolderTimes(file_list);
+
+            if (!file_list.has_more())
+                prefetch_timer_.start();
+        }
+        return;
+    }
+
+    list_pending_ = false;
+
     if (error_code != proto::FILE_ERROR_SUCCESS)
     {
         showError(tr("Failed to get list of files: %1").arg(fileErrorToString(error_code)));
@@ -109,15 +158,10 @@ void FilePanel::onFileList(proto::FileError error_code, const proto::FileList& f
     }
     else
     {
-        ui.action_up->setEnabled(true);
-        ui.action_add_folder->setEnabled(true);
-
-        ui.list->showFileList(file_list);
+        if (current_time_ != -1 && !file_list.has_more())
+            cache_.add(currentPath(), current_time_, file_list);
 
-        QItemSelectionModel* selection_model = ui.list->selectionModel();
-
-        connect(selection_model, &QItemSelectionModel::selectionChanged,
-                this, &FilePanel::onListSelectionChanged);
+        showFileList(file_list);
     }
 
     // Request completed. Turn on the panel.
@@ -148,6 +192,18 @@ void FilePanel::onRename(proto::FileError error_code)
 
 void FilePanel::onPathChanged(const QString& path)
 {
+    if (fetching_more_)
+    {
+        fetching_more_ = false;
+        ++stale_pages_;
+    }
+
+    prefetch_timer_.stop();
+    folder_times_.clear();
+
+    current_time_ = next_time_;
+    next_time_ = -1;
+
     emit pathChanged(this, ui.address_bar->currentPath());
 
     ui.action_up->setEnabled(false);
@@ -165,7 +221,19 @@ void FilePanel::onPathChanged(const QString& path)
     }
     else
     {
-        emit fileList(path);
+        const proto::FileList* file_list = nullptr;
+        if (current_time_ != -1)
+            file_list = cache_.find(path, current_time_);
+
+        if (file_list)
+        {
+            showFileList(*file_list);
+        }
+        else
+        {
+            list_pending_ = true;
+            emit fileList(path, false);
+        }
     }
 }
 
@@ -203,6 +271,8 @@ void FilePanel::restoreState(const QByteArray& state)
 
 void FilePanel::refresh()
 {
+    // The listings could be changed by the operations of this panel or by the other programs.
+    cache_.clear();
     emit driveList();
 }
 
@@ -306,6 +376,15 @@ void FilePanel::onCreateFolderRequest(const QString& name)
     }
 }
 
+void FilePanel::onFetchMoreRequest()
+{
+    if (fetching_more_)
+        return;
+
+    fetching_more_ = true;
+    emit fileList(currentPath(), true);
+}
+
 void FilePanel::onListContextMenu(const QPoint& point)
 {
     if (!ui.address_bar->hasCurrentPath())
@@ -347,11 +426,57 @@ void FilePanel::onListContextMenu(const QPoint& point)
         addFolder();
 }
 
+void FilePanel::onPrefetchTimeout()
+{
+    // The requests in advance must not delay the requests of the user.
+    if (list_pending_ || fetching_more_ || stale_pages_ || !prefetching_.empty())
+        return;
+
+    if (!ui.list->isFileListShown())
+        return;
+
+    FileListModel* model = static_cast<FileListModel*>(ui.list->model());
+
+    // A request of a listing with pages ends the paged listing of the current path on the peer.
+    if (model->canFetchMore(QModelIndex()))
+        return;
+
+    const QString current_path = currentPath();
+    int count = 0;
+
+    // The folders are requested in the order in which they are shown.
+    for (int row = 0; row < model->rowCount(QModelIndex()) && count < kMaxPrefetchCount; ++row)
+    {
+        QModelIndex index = model->index(row, 0, QModelIndex());
+        if (!model->isFolder(index))
+            continue;
+
+        QString name = model->nameAt(index);
+
+        auto folder = folder_times_.constFind(name);
+        if (folder == folder_times_.cend())
+            continue;
+
+        QString path = current_path + name + QLatin1Char('/');
+        if (cache_.find(path, folder.value()))
+            continue;
+
+        prefetching_.push_back({ path, folder.value() });
+        emit fileList(path, false);
+        ++count;
+    }
+}
+
 void FilePanel::toChildFolder(const QString& child_name)
 {
     LOG(LS_INFO) << "toChildFolder called: " << child_name.toStdString();
 
+    auto folder = folder_times_.constFind(child_name);
+    if (folder != folder_times_.cend())
+        next_time_ = folder.value();
+
     ui.address_bar->setCurrentPath(ui.address_bar->currentPath() + child_name);
+    next_time_ = -1;
     ui.action_up->setEnabled(true);
 }
 
@@ -424,6 +549,32 @@ void FilePanel::sendSelected()
     emit sendItems(this, items);
 }
 
+void FilePanel::showFileList(const proto::FileList& file_list)
+{
+    ui.action_up->setEnabled(true);
+    ui.action_add_folder->setEnabled(true);
+
+    ui.list->showFileList(file_list);
+    addFolderTimes(file_list);
+
+    QItemSelectionModel* selection_model = ui.list->selectionModel();
+
+    connect(selection_model, &QItemSelectionModel::selectionChanged,
+            this, &FilePanel::onListSelectionChanged);
+
+    if (!file_list.has_more())
+        prefetch_timer_.start();
+}
+
+void FilePanel::addFolderTimes(const proto::FileList& file_list)
+{
+    for (const auto& item : file_list.item())
+    {
+        if (item.is_directory())
+            folder_times_.insert(QString::fromStdString(item.name()), item.modification_time());
+    }
+}
+
 void FilePanel::showError(const QString& message)
 {
     QMessageBox::warning(this, tr("Warning"), message, QMessageBox::Ok);
@@ -21,9 +21,15 @@
 
 #include "client/file_remover.h"
 #include "client/file_transfer.h"
+#include "client/ui/file_list_cache.h"
 #include "proto/file_transfer.pb.h"
 #include "ui_file_panel.h"
 
+#include <QHash>
+#include <QTimer>
+
+#include <deque>
+
 namespace client {
 
 class FilePanel : public QWidget
@@ -51,7 +57,7 @@ public:
 
 signals:
     void driveList();
-    void fileList(const QString& path);
+    void fileList(const QString& path, bool next_page);
     void rename(const QString& old_name, const QString& new_name);
     void createDirectory(const QString& path);
     void removeItems(FilePanel* sender, const FileRemover::TaskList& items);
@@ -75,6 +81,9 @@ private slots:
     void onListContextMenu(const QPoint& point);
     void onNameChangeRequest(const QString& old_name, const QString& new_name);
     void onCreateFolderRequest(const QString& name);
+    void onFetchMoreRequest();
+
+    void onPrefetchTimeout();
 
     void toChildFolder(const QString& child_name);
     void toParentFolder();
@@ -83,10 +92,38 @@ private slots:
     void sendSelected();
 
 private:
+    void showFileList(const proto::FileList& file_list);
+    void addFolderTimes(const proto::FileList& file_list);
     void showError(const QString& message);
 
     Ui::FilePanel ui;
 
+    // The next page of the list is requested.
+    bool fetching_more_ = false;
+    // Pages requested for a previous path. Their replies are dropped.
+    int stale_pages_ = 0;
+
+    // The first page of the list of the current path is requested.
+    bool list_pending_ = false;
+    // The modification time of the current path or -1 if it is unknown.
+    int64_t current_time_ = -1;
+    // The modification time of the path being opened, if it is opened from the current listing.
+    int64_t next_time_ = -1;
+    // The modification times of the folders of the current listing.
+    QHash<QString, int64_t> folder_times_;
+
+    FileListCache cache_;
+
+    // The listings of the child folders requested in advance in the order of the requests. All
+    // of them are requested when there are no other requests, so their replies come first.
+    struct Prefetch
+    {
+        QString path;
+        int64_t modification_time;
+    };
+    std::deque<Prefetch> prefetching_;
+    QTimer prefetch_timer_;
+
     bool transfer_allowed_ = false;
     bool transfer_enabled_ = false;
 
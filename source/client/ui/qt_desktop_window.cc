@@ -25,8 +25,10 @@
 #include "client/client_desktop.h"
 #include "client/desktop_control_proxy.h"
 #include "client/desktop_window_proxy.h"
+#include "client/double_buffered_frame.h"
 #include "client/ui/desktop_config_dialog.h"
 #include "client/ui/desktop_panel.h"
+#include "client/ui/desktop_settings.h"
 #include "client/ui/frame_factory_qimage.h"
 #include "client/ui/frame_qimage.h"
 #include "client/ui/qt_file_manager_window.h"
@@ -40,12 +42,14 @@
 #include <QDesktopWidget>
 #include <QFileDialog>
 #include <QHBoxLayout>
+#include <QHideEvent>
 #include <QMessageBox>
 #include <QPalette>
 #include <QResizeEvent>
 #include <QScreen>
 #include <QScrollArea>
 #include <QScrollBar>
+#include <QShowEvent>
 #include <QTimer>
 #include <QWindow>
 
@@ -126,16 +130,19 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
         desktop_control_proxy_->onRemoteUpdate();
     });
 
-    connect(panel_, &DesktopPanel::startSystemInfo, [this]()
-    {
-        desktop_control_proxy_->onSystemInfoRequest();
-    });
+    connect(panel_, &DesktopPanel::startSystemInfo, this, &QtDesktopWindow::showSystemInfo);
 
     connect(panel_, &DesktopPanel::startStatistics, [this]()
     {
         desktop_control_proxy_->onMetricsRequest();
     });
 
+    connect(panel_, &DesktopPanel::recordingStateChanged, [this](bool enable)
+    {
+        std::filesystem::path file_path(DesktopSettings().recordingPath().toStdU16String());
+        desktop_control_proxy_->setVideoRecording(enable, file_path);
+    });
+
     connect(panel_, &DesktopPanel::switchToFullscreen, [this](bool fullscreen)
     {
         if (fullscreen)
@@ -186,6 +193,12 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
 
     connect(desktop_, &DesktopWidget::sig_mouseEvent, this, &QtDesktopWindow::onMouseEvent);
     connect(desktop_, &DesktopWidget::sig_keyEvent, this, &QtDesktopWindow::onKeyEvent);
+
+    connect(desktop_, &DesktopWidget::sig_framePainted, [this](const FrameTimestamps& timestamps)
+    {
+        if (desktop_control_proxy_)
+            desktop_control_proxy_->onFramePainted(timestamps);
+    });
 }
 
 QtDesktopWindow::~QtDesktopWindow()
@@ -273,6 +286,14 @@ void QtDesktopWindow::setScreenList(const proto::ScreenList& screen_list)
 
 void QtDesktopWindow::setSystemInfo(const proto::SystemInfo& system_info)
 {
+    // The window may have been closed before the reply was received.
+    if (system_info_)
+        system_info_->setSystemInfo(system_info);
+}
+
+void QtDesktopWindow::showSystemInfo()
+{
+    // The window is shown at once and is filled in as the replies of the host are received.
     if (!system_info_)
     {
         system_info_ = new SystemInfoWindow(this);
@@ -280,11 +301,12 @@ void QtDesktopWindow::setSystemInfo(const proto::SystemInfo& system_info)
 
         connect(system_info_, &SystemInfoWindow::systemInfoRequired, [this]()
         {
-            desktop_control_proxy_->onSystemInfoRequest();
+            desktop_control_proxy_->onSystemInfoRequest(true);
         });
+
+        desktop_control_proxy_->onSystemInfoRequest(false);
     }
 
-    system_info_->setSystemInfo(system_info);
     system_info_->show();
     system_info_->activateWindow();
 }
@@ -314,7 +336,7 @@ std::unique_ptr<FrameFactory> QtDesktopWindow::frameFactory()
 }
 
 void QtDesktopWindow::setFrame(
-    const base::Size& screen_size, std::shared_ptr<base::Frame> frame)
+    const base::Size& screen_size, std::shared_ptr<DoubleBufferedFrame> frame)
 {
     screen_size_ = QSize(screen_size.width(), screen_size.height());
 
@@ -330,9 +352,11 @@ void QtDesktopWindow::setFrame(
     }
 }
 
-void QtDesktopWindow::drawFrame()
+void QtDesktopWindow::drawFrame(
+    const base::Region& updated_region, const FrameTimestamps& timestamps)
 {
-    desktop_->update();
+    // The desktop widget schedules its paint itself at the next vsync.
+    desktop_->updateDesktopFrame(updated_region, timestamps);
     panel_->update();
 }
 
@@ -344,8 +368,16 @@ void QtDesktopWindow::setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cu
                  mouse_cursor->stride(),
                  QImage::Format::Format_ARGB32);
 
-    desktop_->setCursor(QCursor(
-        QPixmap::fromImage(std::move(image)), mouse_cursor->hotSpotX(), mouse_cursor->hotSpotY()));
+    const QPixmap pixmap = QPixmap::fromImage(std::move(image));
+    const QPoint hotspot(mouse_cursor->hotSpotX(), mouse_cursor->hotSpotY());
+
+    desktop_->setCursor(QCursor(pixmap, hotspot.x(), hotspot.y()));
+    desktop_->setRemoteCursor(pixmap, hotspot);
+}
+
+void QtDesktopWindow::setCursorPosition(const base::Point& position)
+{
+    desktop_->setRemoteCursorPosition(QPoint(position.x(), position.y()));
 }
 
 void QtDesktopWindow::resizeEvent(QResizeEvent* event)
@@ -363,6 +395,36 @@ void QtDesktopWindow::leaveEvent(QEvent* event)
     QWidget::leaveEvent(event);
 }
 
+void QtDesktopWindow::changeEvent(QEvent* event)
+{
+    if (desktop_control_proxy_ &&
+        (event->type() == QEvent::ActivationChange || event->type() == QEvent::WindowStateChange))
+    {
+        desktop_control_proxy_->setWindowActive(isActiveWindow() && !isMinimized());
+
+        if (event->type() == QEvent::WindowStateChange)
+            desktop_control_proxy_->setWindowVisible(!isMinimized() && isVisible());
+    }
+
+    QWidget::changeEvent(event);
+}
+
+void QtDesktopWindow::showEvent(QShowEvent* event)
+{
+    if (desktop_control_proxy_)
+        desktop_control_proxy_->setWindowVisible(!isMinimized());
+
+    QWidget::showEvent(event);
+}
+
+void QtDesktopWindow::hideEvent(QHideEvent* event)
+{
+    if (desktop_control_proxy_)
+        desktop_control_proxy_->setWindowVisible(false);
+
+    QWidget::hideEvent(event);
+}
+
 bool QtDesktopWindow::eventFilter(QObject* object, QEvent* event)
 {
     if (object == desktop_)
@@ -457,7 +519,7 @@ void QtDesktopWindow::onMouseEvent(const proto::MouseEvent& event)
         scroll_timer_->stop();
     }
 
-    base::Frame* current_frame = desktop_->desktopFrame();
+    DoubleBufferedFrame* current_frame = desktop_->desktopFrame();
     if (current_frame)
     {
         const base::Size& source_size = current_frame->size();
@@ -543,8 +605,8 @@ void QtDesktopWindow::takeScreenshot()
     if (file_path.isEmpty() || selected_filter.isEmpty())
         return;
 
-    FrameQImage* frame = static_cast<FrameQImage*>(desktop_->desktopFrame());
-    if (!frame)
+    DoubleBufferedFrame* desktop_frame = desktop_->desktopFrame();
+    if (!desktop_frame)
         return;
 
     const char* format = nullptr;
@@ -557,7 +619,14 @@ void QtDesktopWindow::takeScreenshot()
     if (!format)
         return;
 
-    if (!frame->constImage().save(file_path, format))
+    QImage image;
+
+    {
+        DoubleBufferedFrame::ScopedFront front(desktop_frame);
+        image = static_cast<const FrameQImage*>(front.frame())->constImage().copy();
+    }
+
+    if (!image.save(file_path, format))
         QMessageBox::warning(this, tr("Warning"), tr("Could not save image"), QMessageBox::Ok);
 }
 
@@ -591,8 +660,15 @@ void QtDesktopWindow::onResizeTimer()
 
     QScreen* current_screen = window()->windowHandle()->screen();
     if (current_screen)
+    {
         desktop_size *= current_screen->devicePixelRatio();
 
+        // The mouse moves are not sent more often than the screen is refreshed.
+        const int refresh_rate = static_cast<int>(current_screen->refreshRate());
+        if (refresh_rate > 0)
+            desktop_control_proxy_->setMouseMoveRate(refresh_rate);
+    }
+
     LOG(LS_INFO) << "Resize timer: " << desktop_size.width() << "x" << desktop_size.height();
 
     desktop_control_proxy_->setPreferredSize(desktop_size.width(), desktop_size.height());
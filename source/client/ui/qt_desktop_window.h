@@ -66,14 +66,20 @@ public:
     void setSystemInfo(const proto::SystemInfo& system_info) override;
     void setMetrics(const DesktopWindow::Metrics& metrics) override;
     std::unique_ptr<FrameFactory> frameFactory() override;
-    void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame) override;
-    void drawFrame() override;
+    void setFrame(const base::Size& screen_size,
+                  std::shared_ptr<DoubleBufferedFrame> frame) override;
+    void drawFrame(const base::Region& updated_region,
+                   const FrameTimestamps& timestamps) override;
     void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) override;
+    void setCursorPosition(const base::Point& position) override;
 
 protected:
     // QWidget implementation.
     void resizeEvent(QResizeEvent* event) override;
     void leaveEvent(QEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
     bool eventFilter(QObject* object, QEvent* event) override;
 
 private slots:
@@ -83,6 +89,7 @@ private slots:
     void onConfigChanged(const proto::DesktopConfig& config);
     void autosizeWindow();
     void takeScreenshot();
+    void showSystemInfo();
     void scaleDesktop();
     void onResizeTimer();
     void onScrollTimer();
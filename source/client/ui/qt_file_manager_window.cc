@@ -32,6 +32,7 @@
 #include "qt_base/application.h"
 
 #include <QMessageBox>
+#include <QTimer>
 
 namespace client {
 
@@ -41,18 +42,9 @@ QtFileManagerWindow::QtFileManagerWindow(QWidget* parent)
       file_manager_window_proxy_(
           std::make_shared<FileManagerWindowProxy>(qt_base::Application::uiTaskRunner(), this))
 {
-    ui->setupUi(this);
-
-    FileManagerSettings settings;
-    restoreGeometry(settings.windowGeometry());
-    restoreState(settings.windowState());
-
-    QString mime_type = FileMimeData::createMimeType();
-
-    initPanel(common::FileTask::Target::LOCAL, tr("Local Computer"), mime_type, ui->local_panel);
-    initPanel(common::FileTask::Target::REMOTE, tr("Remote Computer"), mime_type, ui->remote_panel);
-
-    ui->local_panel->setFocus();
+    // The panels are created when the event loop is running. While the connection is established
+    // and authenticated on the IO thread, the UI thread is not idle.
+    QTimer::singleShot(0, this, &QtFileManagerWindow::createUi);
 }
 
 QtFileManagerWindow::~QtFileManagerWindow()
@@ -75,6 +67,8 @@ void QtFileManagerWindow::start(std::shared_ptr<FileControlProxy> file_control_p
     file_control_proxy_ = std::move(file_control_proxy);
     DCHECK(file_control_proxy_);
 
+    createUi();
+
     show();
     activateWindow();
     refresh();
@@ -190,10 +184,13 @@ void QtFileManagerWindow::closeEvent(QCloseEvent* event)
     if (remove_dialog_)
         remove_dialog_->stop();
 
-    FileManagerSettings settings;
+    if (is_ui_created_)
+    {
+        FileManagerSettings settings;
 
-    settings.setWindowGeometry(saveGeometry());
-    settings.setWindowState(saveState());
+        settings.setWindowGeometry(saveGeometry());
+        settings.setWindowState(saveState());
+    }
 
     SessionWindow::closeEvent(event);
 }
@@ -306,6 +303,30 @@ void QtFileManagerWindow::onPathChanged(FilePanel* sender, const QString& path)
     }
 }
 
+void QtFileManagerWindow::createUi()
+{
+    if (is_ui_created_)
+        return;
+
+    is_ui_created_ = true;
+
+    // The title is set by the session window before the UI is created.
+    const QString title = windowTitle();
+    ui->setupUi(this);
+    setWindowTitle(title);
+
+    FileManagerSettings settings;
+    restoreGeometry(settings.windowGeometry());
+    restoreState(settings.windowState());
+
+    QString mime_type = FileMimeData::createMimeType();
+
+    initPanel(common::FileTask::Target::LOCAL, tr("Local Computer"), mime_type, ui->local_panel);
+    initPanel(common::FileTask::Target::REMOTE, tr("Remote Computer"), mime_type, ui->remote_panel);
+
+    ui->local_panel->setFocus();
+}
+
 void QtFileManagerWindow::initPanel(
     common::FileTask::Target target, const QString& title, const QString& mime_type, FilePanel* panel)
 {
@@ -317,9 +338,9 @@ void QtFileManagerWindow::initPanel(
         file_control_proxy_->driveList(target);
     });
 
-    connect(panel, &FilePanel::fileList, [this, target](const QString& path)
+    connect(panel, &FilePanel::fileList, [this, target](const QString& path, bool next_page)
     {
-        file_control_proxy_->fileList(target, path.toStdString());
+        file_control_proxy_->fileList(target, path.toStdString(), next_page);
     });
 
     connect(panel, &FilePanel::rename,
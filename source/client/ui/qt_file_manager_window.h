@@ -81,6 +81,7 @@ private slots:
     void onPathChanged(FilePanel* sender, const QString& path);
 
 private:
+    void createUi();
     void transferItems(FileTransfer::Type type,
                        const QString& source_path,
                        const QString& target_path,
@@ -92,6 +93,7 @@ private:
                    FilePanel* panel);
 
     std::unique_ptr<Ui::FileManagerWindow> ui;
+    bool is_ui_created_ = false;
     std::shared_ptr<FileManagerWindowProxy> file_manager_window_proxy_;
     std::shared_ptr<FileControlProxy> file_control_proxy_;
 
@@ -0,0 +1,230 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/ui/qt_thumbnail_window.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+#include "client/client_desktop.h"
+#include "client/config_factory.h"
+#include "client/desktop_control_proxy.h"
+#include "client/desktop_window_proxy.h"
+#include "client/double_buffered_frame.h"
+#include "client/ui/frame_factory_qimage.h"
+#include "qt_base/application.h"
+
+#include <QImage>
+#include <QMouseEvent>
+#include <QPainter>
+
+namespace client {
+
+namespace {
+
+// The tiles are sized by the grid of the wall. The hint is the size of the thumbnail of a wide
+// screen plus the caption.
+const int kCaptionHeight = 20;
+const QSize kMinimumSize(160, 90 + kCaptionHeight);
+
+} // namespace
+
+QtThumbnailWindow::QtThumbnailWindow(const QString& computer_name, QWidget* parent)
+    : SessionWindow(parent),
+      computer_name_(computer_name),
+      desktop_window_proxy_(std::make_shared<DesktopWindowProxy>(
+          qt_base::Application::uiTaskRunner(), this))
+{
+    setMinimumSize(kMinimumSize);
+    setToolTip(computer_name_);
+}
+
+QtThumbnailWindow::~QtThumbnailWindow()
+{
+    desktop_window_proxy_->dettach();
+}
+
+void QtThumbnailWindow::setStatus(const QString& message)
+{
+    status_ = message;
+    update();
+}
+
+std::unique_ptr<Client> QtThumbnailWindow::createClient()
+{
+    std::unique_ptr<ClientDesktop> client = std::make_unique<ClientDesktop>(
+        qt_base::Application::ioTaskRunner());
+
+    client->setDesktopConfig(ConfigFactory::thumbnailConfig());
+    client->setDesktopWindow(desktop_window_proxy_);
+
+    return client;
+}
+
+void QtThumbnailWindow::showWindow(
+    std::shared_ptr<DesktopControlProxy> desktop_control_proxy,
+    const base::Version& /* peer_version */)
+{
+    desktop_control_proxy_ = std::move(desktop_control_proxy);
+
+    // The thumbnails of the wall are decoded after the desktop windows.
+    desktop_control_proxy_->setWindowActive(false);
+}
+
+void QtThumbnailWindow::configRequired()
+{
+    onErrorOccurred(tr("There are no supported video encodings."));
+}
+
+void QtThumbnailWindow::setCapabilities(
+    const std::string& /* extensions */, uint32_t /* video_encodings */)
+{
+    // Nothing
+}
+
+void QtThumbnailWindow::setScreenList(const proto::ScreenList& /* screen_list */)
+{
+    // Nothing
+}
+
+void QtThumbnailWindow::setSystemInfo(const proto::SystemInfo& /* system_info */)
+{
+    // Nothing
+}
+
+void QtThumbnailWindow::setMetrics(const DesktopWindow::Metrics& /* metrics */)
+{
+    // Nothing
+}
+
+std::unique_ptr<FrameFactory> QtThumbnailWindow::frameFactory()
+{
+    return std::make_unique<FrameFactoryQImage>();
+}
+
+void QtThumbnailWindow::setFrame(
+    const base::Size& /* screen_size */, std::shared_ptr<DoubleBufferedFrame> frame)
+{
+    frame_ = std::move(frame);
+    update();
+}
+
+void QtThumbnailWindow::drawFrame(
+    const base::Region& /* updated_region */, const FrameTimestamps& /* timestamps */)
+{
+    // The whole thumbnail is scaled into the tile, so it is painted again as a whole.
+    update();
+}
+
+void QtThumbnailWindow::setMouseCursor(std::shared_ptr<base::MouseCursor> /* mouse_cursor */)
+{
+    // Nothing
+}
+
+void QtThumbnailWindow::setCursorPosition(const base::Point& /* position */)
+{
+    // Nothing
+}
+
+void QtThumbnailWindow::paintEvent(QPaintEvent* /* event */)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(25, 25, 25));
+
+    const QRect video_rect(0, 0, width(), height() - kCaptionHeight);
+
+    if (frame_ && status_.isEmpty())
+    {
+        // The decoder does not swap the frames while the front frame is being painted.
+        DoubleBufferedFrame::ScopedFront front(frame_.get());
+        const base::Frame* frame = front.frame();
+
+        const QImage image(frame->frameData(), frame->size().width(), frame->size().height(),
+                           frame->stride(), QImage::Format_RGB32);
+
+        QSize target_size = image.size();
+        target_size.scale(video_rect.size(), Qt::KeepAspectRatio);
+
+        QRect target_rect(QPoint(), target_size);
+        target_rect.moveCenter(video_rect.center());
+
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.drawImage(target_rect, image);
+    }
+    else
+    {
+        painter.setPen(Qt::lightGray);
+        painter.drawText(video_rect.adjusted(4, 4, -4, -4),
+                         Qt::AlignCenter | Qt::TextWordWrap, status_);
+    }
+
+    const QRect caption_rect(0, video_rect.bottom() + 1, width(), kCaptionHeight);
+
+    painter.fillRect(caption_rect, QColor(45, 45, 45));
+    painter.setPen(Qt::white);
+    painter.drawText(caption_rect.adjusted(4, 0, -4, 0), Qt::AlignLeft | Qt::AlignVCenter,
+                     fontMetrics().elidedText(computer_name_, Qt::ElideRight,
+                                              caption_rect.width() - 8));
+}
+
+void QtThumbnailWindow::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton)
+        emit fullSessionRequested();
+}
+
+void QtThumbnailWindow::onStarted(const std::u16string& address_or_id)
+{
+    setStatus(tr("Attempt to connect to %1.").arg(address_or_id));
+}
+
+void QtThumbnailWindow::onStopped()
+{
+    // Nothing
+}
+
+void QtThumbnailWindow::onConnected()
+{
+    setStatus(QString());
+}
+
+void QtThumbnailWindow::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    onErrorOccurred(netErrorToString(error_code));
+}
+
+void QtThumbnailWindow::onAccessDenied(base::ClientAuthenticator::ErrorCode error_code)
+{
+    onErrorOccurred(authErrorToString(error_code));
+}
+
+void QtThumbnailWindow::onRouterError(const RouterController::Error& error)
+{
+    onErrorOccurred(routerErrorToString(error));
+}
+
+void QtThumbnailWindow::onErrorOccurred(const QString& message)
+{
+    LOG(LS_INFO) << "Thumbnail session finished: " << message.toStdString();
+
+    frame_.reset();
+    setStatus(message);
+
+    emit sessionFinished();
+}
+
+} // namespace client
@@ -0,0 +1,99 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__UI__QT_THUMBNAIL_WINDOW_H
+#define CLIENT__UI__QT_THUMBNAIL_WINDOW_H
+
+#include "client/desktop_window.h"
+#include "client/ui/session_window.h"
+
+namespace client {
+
+class DesktopWindowProxy;
+
+// A tile of the monitoring wall. It connects to the host in the thumbnail mode (see
+// ConfigFactory::thumbnailConfig()) and shows the small video which the host sends once a second.
+// The tile does not send input. The connection errors are shown in the tile instead of dialogs.
+class QtThumbnailWindow :
+    public SessionWindow,
+    public DesktopWindow
+{
+    Q_OBJECT
+
+public:
+    explicit QtThumbnailWindow(const QString& computer_name, QWidget* parent = nullptr);
+    ~QtThumbnailWindow();
+
+    // Shows |message| instead of the video, e.g. when the tile is not connected.
+    void setStatus(const QString& message);
+
+    // SessionWindow implementation.
+    std::unique_ptr<Client> createClient() override;
+
+    // DesktopWindow implementation.
+    void showWindow(std::shared_ptr<DesktopControlProxy> desktop_control_proxy,
+                    const base::Version& peer_version) override;
+    void configRequired() override;
+    void setCapabilities(const std::string& extensions, uint32_t video_encodings) override;
+    void setScreenList(const proto::ScreenList& screen_list) override;
+    void setSystemInfo(const proto::SystemInfo& system_info) override;
+    void setMetrics(const DesktopWindow::Metrics& metrics) override;
+    std::unique_ptr<FrameFactory> frameFactory() override;
+    void setFrame(const base::Size& screen_size,
+                  std::shared_ptr<DoubleBufferedFrame> frame) override;
+    void drawFrame(const base::Region& updated_region,
+                   const FrameTimestamps& timestamps) override;
+    void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) override;
+    void setCursorPosition(const base::Point& position) override;
+
+signals:
+    // The user has double-clicked the tile to open a full session with the host.
+    void fullSessionRequested();
+
+    // The connection has failed or has been closed by the host.
+    void sessionFinished();
+
+protected:
+    // QWidget implementation.
+    void paintEvent(QPaintEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+    // StatusWindow implementation.
+    void onStarted(const std::u16string& address_or_id) override;
+    void onStopped() override;
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onAccessDenied(base::ClientAuthenticator::ErrorCode error_code) override;
+    void onRouterError(const RouterController::Error& error) override;
+
+private:
+    void onErrorOccurred(const QString& message);
+
+    const QString computer_name_;
+    QString status_;
+
+    std::shared_ptr<DesktopWindowProxy> desktop_window_proxy_;
+    std::shared_ptr<DesktopControlProxy> desktop_control_proxy_;
+    std::shared_ptr<DoubleBufferedFrame> frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(QtThumbnailWindow);
+};
+
+} // namespace client
+
+#endif // CLIENT__UI__QT_THUMBNAIL_WINDOW_H
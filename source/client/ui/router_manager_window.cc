@@ -297,39 +297,21 @@ void RouterManagerWindow::onSessionList(std::shared_ptr<proto::SessionList> sess
     QTreeWidget* tree_hosts = ui->tree_hosts;
     QTreeWidget* tree_relay = ui->tree_relay;
 
-    tree_hosts->clear();
-    tree_relay->clear();
-
-    int host_count = 0;
-    int relay_count = 0;
-
-    for (int i = 0; i < session_list->session_size(); ++i)
+    // The list comes in pages. The first page replaces the previous content.
+    if (session_list->after_session_id() == 0)
     {
-        const proto::Session& session = session_list->session(i);
-
-        switch (session.session_type())
-        {
-            case proto::ROUTER_SESSION_HOST:
-            {
-                tree_hosts->addTopLevelItem(new HostTreeItem(session_list->session(i)));
-                ++host_count;
-            }
-            break;
+        tree_hosts->clear();
+        tree_relay->clear();
+        session_items_.clear();
+    }
 
-            case proto::ROUTER_SESSION_RELAY:
-            {
-                tree_relay->addTopLevelItem(new RelayTreeItem(session_list->session(i)));
-                ++relay_count;
-            }
-            break;
+    for (int i = 0; i < session_list->session_size(); ++i)
+        addSessionItem(session_list->session(i));
 
-            default:
-                break;
-        }
-    }
+    updateSessionCount();
 
-    ui->label_hosts_conn_count->setText(QString::number(host_count));
-    ui->label_relay_conn_count->setText(QString::number(relay_count));
+    if (session_list->has_more())
+        return;
 
     for (int i = 0; i < tree_hosts->columnCount(); ++i)
         tree_hosts->resizeColumnToContents(i);
@@ -340,6 +322,17 @@ void RouterManagerWindow::onSessionList(std::shared_ptr<proto::SessionList> sess
     afterRequest();
 }
 
+void RouterManagerWindow::onSessionListUpdate(std::shared_ptr<proto::SessionListUpdate> update)
+{
+    for (int i = 0; i < update->removed_size(); ++i)
+        removeSessionItem(update->removed(i));
+
+    for (int i = 0; i < update->updated_size(); ++i)
+        addSessionItem(update->updated(i));
+
+    updateSessionCount();
+}
+
 void RouterManagerWindow::onSessionResult(std::shared_ptr<proto::SessionResult> session_result)
 {
     if (session_result->error_code() != proto::SessionResult::SUCCESS)
@@ -627,6 +620,53 @@ void RouterManagerWindow::onCurrentHostChanged(QTreeWidgetItem* current,
     }
 }
 
+void RouterManagerWindow::addSessionItem(const proto::Session& session)
+{
+    // The session can be received again in an update or in the next page.
+    removeSessionItem(session.session_id());
+
+    QTreeWidgetItem* item;
+
+    switch (session.session_type())
+    {
+        case proto::ROUTER_SESSION_HOST:
+        {
+            item = new HostTreeItem(session);
+            ui->tree_hosts->addTopLevelItem(item);
+        }
+        break;
+
+        case proto::ROUTER_SESSION_RELAY:
+        {
+            item = new RelayTreeItem(session);
+            ui->tree_relay->addTopLevelItem(item);
+        }
+        break;
+
+        default:
+            return;
+    }
+
+    session_items_.emplace(session.session_id(), item);
+}
+
+void RouterManagerWindow::removeSessionItem(int64_t session_id)
+{
+    auto result = session_items_.find(session_id);
+    if (result == session_items_.end())
+        return;
+
+    // The item is removed from the tree when deleted.
+    delete result->second;
+    session_items_.erase(result);
+}
+
+void RouterManagerWindow::updateSessionCount()
+{
+    ui->label_hosts_conn_count->setText(QString::number(ui->tree_hosts->topLevelItemCount()));
+    ui->label_relay_conn_count->setText(QString::number(ui->tree_relay->topLevelItemCount()));
+}
+
 void RouterManagerWindow::beforeRequest()
 {
     ui->tab->setEnabled(false);
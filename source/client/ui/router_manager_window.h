@@ -25,6 +25,8 @@
 #include <QMainWindow>
 #include <QPointer>
 
+#include <unordered_map>
+
 namespace Ui {
 class RouterManagerWindow;
 } // namespace Ui
@@ -54,6 +56,7 @@ public:
     void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
     void onAccessDenied(base::ClientAuthenticator::ErrorCode error_code) override;
     void onSessionList(std::shared_ptr<proto::SessionList> session_list) override;
+    void onSessionListUpdate(std::shared_ptr<proto::SessionListUpdate> update) override;
     void onSessionResult(std::shared_ptr<proto::SessionResult> session_result) override;
     void onUserList(std::shared_ptr<proto::UserList> user_list) override;
     void onUserResult(std::shared_ptr<proto::UserResult> user_result) override;
@@ -73,6 +76,10 @@ private:
     void onCurrentUserChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous);
     void onCurrentHostChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous);
 
+    void addSessionItem(const proto::Session& session);
+    void removeSessionItem(int64_t session_id);
+    void updateSessionCount();
+
     void beforeRequest();
     void afterRequest();
 
@@ -86,6 +93,9 @@ private:
     std::shared_ptr<RouterWindowProxy> window_proxy_;
     std::unique_ptr<RouterProxy> router_proxy_;
 
+    // Items of the hosts and relays by their session IDs. The items are owned by the trees.
+    std::unordered_map<int64_t, QTreeWidgetItem*> session_items_;
+
     DISALLOW_COPY_AND_ASSIGN(RouterManagerWindow);
 };
 
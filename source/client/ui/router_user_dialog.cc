@@ -76,6 +76,7 @@ RouterUserDialog::RouterUserDialog(const base::User& user,
 
     add_session(proto::ROUTER_SESSION_CLIENT);
     add_session(proto::ROUTER_SESSION_ADMIN);
+    add_session(proto::ROUTER_SESSION_ROUTER);
 
     connect(ui.buttonbox, &QDialogButtonBox::clicked, this, &RouterUserDialog::onButtonBoxClicked);
     connect(ui.edit_username, &QLineEdit::textEdited, [this]()
@@ -294,6 +295,10 @@ QString RouterUserDialog::sessionTypeToString(proto::RouterSession session_type)
             str = QT_TR_NOOP("Client");
             break;
 
+        case proto::ROUTER_SESSION_ROUTER:
+            str = QT_TR_NOOP("Router");
+            break;
+
         default:
             break;
     }
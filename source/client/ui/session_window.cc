@@ -134,32 +134,7 @@ void SessionWindow::onAccessDenied(base::ClientAuthenticator::ErrorCode error_co
 
 void SessionWindow::onRouterError(const RouterController::Error& error)
 {
-    switch (error.type)
-    {
-        case RouterController::ErrorType::NETWORK:
-        {
-            onErrorOccurred(tr("Network error when connecting to the router: %1")
-                            .arg(netErrorToString(error.code.network)));
-        }
-        break;
-
-        case RouterController::ErrorType::AUTHENTICATION:
-        {
-            onErrorOccurred(tr("Authentication error when connecting to the router: %1")
-                            .arg(authErrorToString(error.code.authentication)));
-        }
-        break;
-
-        case RouterController::ErrorType::ROUTER:
-        {
-            onErrorOccurred(routerErrorToString(error.code.router));
-        }
-        break;
-
-        default:
-            NOTREACHED();
-            break;
-    }
+    onErrorOccurred(routerErrorToString(error));
 }
 
 void SessionWindow::setClientTitle(const Config& config)
@@ -335,4 +310,26 @@ QString SessionWindow::routerErrorToString(RouterController::ErrorCode error_cod
     return tr(message);
 }
 
+// static
+QString SessionWindow::routerErrorToString(const RouterController::Error& error)
+{
+    switch (error.type)
+    {
+        case RouterController::ErrorType::NETWORK:
+            return tr("Network error when connecting to the router: %1")
+                .arg(netErrorToString(error.code.network));
+
+        case RouterController::ErrorType::AUTHENTICATION:
+            return tr("Authentication error when connecting to the router: %1")
+                .arg(authErrorToString(error.code.authentication));
+
+        case RouterController::ErrorType::ROUTER:
+            return routerErrorToString(error.code.router);
+
+        default:
+            NOTREACHED();
+            return QString();
+    }
+}
+
 } // namespace client
@@ -126,6 +126,69 @@ void StatisticsDialog::setMetrics(const DesktopWindow::Metrics& metrics)
             case 19:
                 item->setText(1, QString::number(metrics.send_clipboard));
                 break;
+
+            case 20:
+                item->setText(1, latencyToString(metrics.capture_latency));
+                break;
+
+            case 21:
+                item->setText(1, latencyToString(metrics.encode_latency));
+                break;
+
+            case 22:
+                item->setText(1, latencyToString(metrics.network_latency));
+                break;
+
+            case 23:
+                item->setText(1, latencyToString(metrics.decode_latency));
+                break;
+
+            case 24:
+                item->setText(1, latencyToString(metrics.paint_latency));
+                break;
+
+            case 25:
+                item->setText(1, latencyToString(metrics.total_latency));
+                break;
+
+            case 26:
+                item->setText(1, QString("%1 / %2 ms")
+                    .arg(metrics.audio_buffer.count()).arg(metrics.audio_jitter.count()));
+                break;
+
+            case 27:
+                item->setText(1, hostText(metrics, QString("%1 / %2 / %3")
+                    .arg(metrics.host_statistics.capture_fps)
+                    .arg(metrics.host_statistics.encode_fps)
+                    .arg(metrics.host_statistics.drop_fps)));
+                break;
+
+            case 28:
+                item->setText(1, hostText(metrics, QString("%1 / %2 ms")
+                    .arg(timeToString(metrics.host_statistics.capture_time),
+                         timeToString(metrics.host_statistics.encode_time))));
+                break;
+
+            case 29:
+            {
+                const int quantizer = metrics.host_statistics.quantizer;
+
+                item->setText(1, hostText(metrics, QString("%1 kbps / %2")
+                    .arg(metrics.host_statistics.bitrate)
+                    .arg(quantizer >= 0 ? QString::number(quantizer) : QStringLiteral("-"))));
+            }
+            break;
+
+            case 30:
+                item->setText(1, hostText(metrics, QString("%1 / %2")
+                    .arg(sizeToString(static_cast<int64_t>(metrics.host_statistics.pending_bytes)))
+                    .arg(metrics.host_statistics.pending_messages)));
+                break;
+
+            case 31:
+                item->setText(1, hostText(metrics, sizeToString(
+                    static_cast<int64_t>(metrics.host_statistics.memory_usage))));
+                break;
         }
     }
 }
@@ -214,4 +277,33 @@ QString StatisticsDialog::speedToString(int64_t speed)
         .arg(units);
 }
 
+// static
+QString StatisticsDialog::timeToString(std::chrono::microseconds time)
+{
+    return QString::number(static_cast<double>(time.count()) / 1000.0, 'f', 1);
+}
+
+// static
+QString StatisticsDialog::hostText(const DesktopWindow::Metrics& metrics, const QString& text)
+{
+    // Old hosts do not send the statistics.
+    return metrics.has_host_statistics ? text : QStringLiteral("-");
+}
+
+// static
+QString StatisticsDialog::latencyToString(const DesktopWindow::Latency& latency)
+{
+    if (!latency.count)
+        return QStringLiteral("-");
+
+    auto to_ms = [](int64_t us)
+    {
+        return QString::number(static_cast<double>(us) / 1000.0, 'f', 1);
+    };
+
+    // Median, 95th and 99th percentiles.
+    return QString("%1 / %2 / %3 ms")
+        .arg(to_ms(latency.p50), to_ms(latency.p95), to_ms(latency.p99));
+}
+
 } // namespace client
@@ -43,6 +43,9 @@ signals:
 private:
     static QString sizeToString(int64_t size);
     static QString speedToString(int64_t speed);
+    static QString latencyToString(const DesktopWindow::Latency& latency);
+    static QString timeToString(std::chrono::microseconds time);
+    static QString hostText(const DesktopWindow::Metrics& metrics, const QString& text);
 
     Ui::StatisticsDialog ui;
     QTimer* update_timer_ = nullptr;
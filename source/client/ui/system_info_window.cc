@@ -168,6 +168,42 @@ SystemInfoWindow::~SystemInfoWindow() = default;
 
 void SystemInfoWindow::setSystemInfo(const proto::SystemInfo& system_info)
 {
+    // The host sends the categories in several replies. Each reply replaces only the categories
+    // which it contains.
+    if (system_info.has_computer())
+        *system_info_.mutable_computer() = system_info.computer();
+
+    if (system_info.has_operating_system())
+        *system_info_.mutable_operating_system() = system_info.operating_system();
+
+    if (system_info.has_motherboard())
+        *system_info_.mutable_motherboard() = system_info.motherboard();
+
+    if (system_info.has_bios())
+        *system_info_.mutable_bios() = system_info.bios();
+
+    if (system_info.has_processor())
+        *system_info_.mutable_processor() = system_info.processor();
+
+    if (system_info.has_memory())
+        *system_info_.mutable_memory() = system_info.memory();
+
+    if (system_info.has_logical_drives())
+        *system_info_.mutable_logical_drives() = system_info.logical_drives();
+
+    if (system_info.has_printers())
+        *system_info_.mutable_printers() = system_info.printers();
+
+    if (system_info.has_network_adapters())
+        *system_info_.mutable_network_adapters() = system_info.network_adapters();
+
+    updateTree();
+}
+
+void SystemInfoWindow::updateTree()
+{
+    const proto::SystemInfo& system_info = system_info_;
+
     ui.tree->clear();
 
     if (system_info.has_computer())
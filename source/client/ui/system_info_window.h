@@ -42,6 +42,7 @@ private slots:
     void onContextMenu(const QPoint& point);
 
 private:
+    void updateTree();
     void copyRow(QTreeWidgetItem* item);
     void copyColumn(QTreeWidgetItem* item, int column);
 
@@ -51,6 +52,9 @@ private:
 
     Ui::SystemInfoWindow ui;
 
+    // The categories received from the host.
+    proto::SystemInfo system_info_;
+
     DISALLOW_COPY_AND_ASSIGN(SystemInfoWindow);
 };
 
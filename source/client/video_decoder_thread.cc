@@ -0,0 +1,499 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/video_decoder_thread.h"
+
+#include "base/logging.h"
+#include "base/system_time.h"
+#include "base/trace_event.h"
+#include "base/codec/dirty_rects.h"
+#include "base/codec/video_decoder.h"
+#include "base/codec/video_tile_cache.h"
+#include "base/desktop/frame_simple.h"
+#include "client/desktop_window_proxy.h"
+#include "client/double_buffered_frame.h"
+
+#include <limits>
+
+namespace client {
+
+namespace {
+
+// About a quarter of a second of video at 30 fps. A longer queue only adds latency.
+const size_t kMaxPendingPackets = 8;
+
+base::Rect toRect(const proto::Rect& rect)
+{
+    return base::Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height());
+}
+
+// The decoders of all desktop sessions of the process share the threads. Separate threads of many
+// sessions would compete for the cores.
+base::ThreadPool* decoderPool()
+{
+    // The pool is never destroyed, otherwise its threads would be joined after main() returns.
+    static base::ThreadPool* pool =
+        new base::ThreadPool(0, base::ThreadPriority::DISPLAY_CRITICAL);
+    return pool;
+}
+
+base::Region updatedRegion(const proto::VideoPacket& packet)
+{
+    base::Region region;
+
+    // The decoder fails on the malformed rects.
+    std::vector<base::Rect> dirty_rects;
+    if (base::dirtyRects(packet, &dirty_rects))
+        region.addRects(dirty_rects.data(), static_cast<int>(dirty_rects.size()));
+
+    // The tiles painted from the cache are not in the dirty rects.
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+        region.addRect(toRect(packet.cached_tile(i).rect()));
+
+    // Neither is the copied area.
+    if (packet.has_copy_rect())
+        region.addRect(toRect(packet.copy_rect().rect()));
+
+    return region;
+}
+
+} // namespace
+
+VideoDecoderThread::VideoDecoderThread(std::shared_ptr<DesktopWindowProxy> desktop_window_proxy)
+    : desktop_window_proxy_(std::move(desktop_window_proxy))
+{
+    DCHECK(desktop_window_proxy_);
+}
+
+VideoDecoderThread::~VideoDecoderThread()
+{
+    // The decoders are destroyed after the packet that is being decoded.
+    std::unique_lock lock(pending_lock_);
+    pending_packets_.clear();
+
+    idle_event_.wait(lock, [this]() { return !decode_scheduled_; });
+}
+
+bool VideoDecoderThread::decode(
+    std::unique_ptr<proto::VideoPacket> packet, const FrameTimestamps& timestamps)
+{
+    DCHECK(packet);
+
+    std::scoped_lock lock(pending_lock_);
+
+    // The key frame always contains the format. A frame of the new size may also be an inter frame.
+    const bool is_key_frame = packet->has_format() && !packet->format().inter_frame();
+
+    if (waiting_key_frame_)
+    {
+        if (!is_key_frame)
+        {
+            // The decoder has failed to decode a packet. The key frame is requested once.
+            if (key_frame_request_pending_)
+            {
+                key_frame_request_pending_ = false;
+                return false;
+            }
+
+            return true;
+        }
+
+        waiting_key_frame_ = false;
+        key_frame_request_pending_ = false;
+    }
+
+    if (pending_packets_.size() >= kMaxPendingPackets)
+    {
+        LOG(LS_WARNING) << "Video decoder is too slow, " << pending_packets_.size()
+                        << " packets dropped";
+        pending_packets_.clear();
+
+        if (!is_key_frame)
+        {
+            waiting_key_frame_ = true;
+            return false;
+        }
+    }
+
+    pending_packets_.push_back({ std::move(packet), timestamps });
+
+    if (!decode_scheduled_)
+    {
+        decode_scheduled_ = true;
+        decoderPool()->postTask(
+            std::bind(&VideoDecoderThread::decodePendingPacket, this), priority_);
+    }
+
+    return true;
+}
+
+int64_t VideoDecoderThread::takeDecodedFrameCount()
+{
+    return decoded_frame_count_.exchange(0);
+}
+
+void VideoDecoderThread::setBackground(bool background)
+{
+    std::scoped_lock lock(pending_lock_);
+
+    // The next task of the session is posted with the new priority.
+    priority_ = background ? base::ThreadPool::Priority::BACKGROUND
+                           : base::ThreadPool::Priority::NORMAL;
+}
+
+void VideoDecoderThread::decodePendingPacket()
+{
+    PendingPacket pending;
+
+    {
+        std::scoped_lock lock(pending_lock_);
+
+        if (pending_packets_.empty())
+        {
+            decode_scheduled_ = false;
+            idle_event_.notify_all();
+            return;
+        }
+
+        pending = std::move(pending_packets_.front());
+        pending_packets_.pop_front();
+    }
+
+    // The lossless packets refine the frame of the main decoder and do not replace it.
+    if (pending.packet->encoding() == proto::VIDEO_ENCODING_ZSTD)
+        decodeRefinementPacket(*pending.packet);
+    else
+        decodeVideoPacket(*pending.packet, pending.timestamps);
+
+    std::scoped_lock lock(pending_lock_);
+
+    if (pending_packets_.empty())
+    {
+        decode_scheduled_ = false;
+        idle_event_.notify_all();
+        return;
+    }
+
+    // The next packet waits behind the packets of the sessions with a higher priority.
+    decoderPool()->postTask(
+        std::bind(&VideoDecoderThread::decodePendingPacket, this), priority_);
+}
+
+void VideoDecoderThread::decodeVideoPacket(
+    const proto::VideoPacket& packet, FrameTimestamps timestamps)
+{
+    TRACE_EVENT("decode", "VideoDecoderThread::decodeVideoPacket");
+
+    Stream& stream = streams_[packet.stream_id()];
+
+    if (stream.video_encoding != packet.encoding())
+    {
+        stream.video_decoder = base::VideoDecoder::create(packet.encoding());
+        stream.video_encoding = packet.encoding();
+
+        LOG(LS_INFO) << "Video encoding changed to: " << stream.video_encoding << " (stream: "
+                     << packet.stream_id() << ")";
+    }
+
+    if (!stream.video_decoder)
+    {
+        LOG(LS_ERROR) << "Video decoder not initialized";
+        return;
+    }
+
+    if (packet.has_format() && !setFormat(packet.stream_id(), packet.format(), &stream))
+        return;
+
+    if (!desktop_frame_ || (packet.stream_id() && !stream.frame))
+    {
+        LOG(LS_ERROR) << "The desktop frame is not initialized";
+        return;
+    }
+
+    // The decoder writes only the dirty rects, the differences from the copied pixels.
+    applyCopyRect(packet, stream);
+
+    if (!stream.video_decoder->decode(packet, decoderFrame(stream)))
+    {
+        LOG(LS_ERROR) << "The video packet could not be decoded";
+        requestKeyFrame();
+        return;
+    }
+
+    updateTileCache(packet, &stream);
+
+    const base::Region updated_region = swapDesktopFrame(stream, packet);
+
+    if (timestamps.receive)
+        timestamps.decode = base::SystemTime::microsecondsSinceEpoch();
+
+    ++decoded_frame_count_;
+    desktop_window_proxy_->drawFrame(updated_region, timestamps);
+}
+
+void VideoDecoderThread::requestKeyFrame()
+{
+    // The next packets refer to the lost one and are not decoded until the key frame.
+    std::scoped_lock lock(pending_lock_);
+
+    if (waiting_key_frame_)
+        return;
+
+    pending_packets_.clear();
+    waiting_key_frame_ = true;
+    key_frame_request_pending_ = true;
+}
+
+void VideoDecoderThread::decodeRefinementPacket(const proto::VideoPacket& packet)
+{
+    auto result = streams_.find(packet.stream_id());
+    if (!desktop_frame_ || result == streams_.end() ||
+        (packet.stream_id() && !result->second.frame))
+    {
+        LOG(LS_ERROR) << "The desktop frame is not initialized";
+        return;
+    }
+
+    Stream& stream = result->second;
+
+    if (!stream.refinement_decoder)
+        stream.refinement_decoder = base::VideoDecoder::create(proto::VIDEO_ENCODING_ZSTD);
+
+    if (!stream.refinement_decoder->decode(packet, decoderFrame(stream)))
+    {
+        LOG(LS_ERROR) << "The refinement packet could not be decoded";
+
+        // The host has added the tiles to its cache anyway. The cache stays the same on both sides,
+        // only with the unrefined pixels.
+        updateTileCache(packet, &stream);
+        return;
+    }
+
+    updateTileCache(packet, &stream);
+
+    const base::Region updated_region = swapDesktopFrame(stream, packet);
+
+    // The refinement is not measured.
+    desktop_window_proxy_->drawFrame(updated_region, FrameTimestamps());
+}
+
+bool VideoDecoderThread::setFormat(
+    uint32_t stream_id, const proto::VideoPacketFormat& format, Stream* stream)
+{
+    base::Size video_size(format.video_rect().width(), format.video_rect().height());
+    base::Size screen_size = video_size;
+
+    static const int kMaxValue = std::numeric_limits<uint16_t>::max();
+
+    if (video_size.width()  <= 0 || video_size.width()  >= kMaxValue ||
+        video_size.height() <= 0 || video_size.height() >= kMaxValue)
+    {
+        LOG(LS_ERROR) << "Wrong video frame size";
+        return false;
+    }
+
+    if (format.has_screen_size())
+    {
+        screen_size = base::Size(
+            format.screen_size().width(), format.screen_size().height());
+
+        if (screen_size.width() <= 0 || screen_size.width() >= kMaxValue ||
+            screen_size.height() <= 0 || screen_size.height() >= kMaxValue)
+        {
+            LOG(LS_ERROR) << "Wrong screen size";
+            return false;
+        }
+    }
+
+    // Each format starts a new cache (the host does the same).
+    stream->tile_cache.reset();
+
+    const size_t tile_cache_size = format.tile_cache_size();
+    if (tile_cache_size)
+    {
+        if (tile_cache_size > base::VideoTileCache::kMaxCapacity)
+        {
+            LOG(LS_ERROR) << "Wrong tile cache size: " << tile_cache_size;
+            return false;
+        }
+
+        stream->tile_cache = std::make_unique<base::VideoTileCache>(tile_cache_size, true);
+    }
+
+    if (!stream_id)
+    {
+        LOG(LS_INFO) << "New video size: " << video_size.width() << "x" << video_size.height();
+        LOG(LS_INFO) << "New screen size: " << screen_size.width() << "x" << screen_size.height();
+
+        // The host has switched to the single stream.
+        for (auto it = streams_.begin(); it != streams_.end();)
+        {
+            if (it->first)
+                it = streams_.erase(it);
+            else
+                ++it;
+        }
+
+        multi_stream_ = false;
+        stream->frame.reset();
+
+        desktop_frame_ = std::make_shared<DoubleBufferedFrame>(
+            desktop_window_proxy_->allocateFrame(video_size),
+            desktop_window_proxy_->allocateFrame(video_size));
+        desktop_window_proxy_->setFrame(screen_size, desktop_frame_);
+        return true;
+    }
+
+    const base::Size desktop_size(
+        format.desktop_video_size().width(), format.desktop_video_size().height());
+
+    if (desktop_size.width()  <= 0 || desktop_size.width()  >= kMaxValue ||
+        desktop_size.height() <= 0 || desktop_size.height() >= kMaxValue)
+    {
+        LOG(LS_ERROR) << "Wrong desktop video size";
+        return false;
+    }
+
+    const base::Rect stream_rect = base::Rect::makeXYWH(
+        format.video_rect().x(), format.video_rect().y(), video_size.width(), video_size.height());
+
+    if (!base::Rect::makeSize(desktop_size).containsRect(stream_rect))
+    {
+        LOG(LS_ERROR) << "Wrong position of the video stream";
+        return false;
+    }
+
+    LOG(LS_INFO) << "New video stream " << stream_id << ": " << stream_rect
+                 << " (desktop video size: " << desktop_size << ")";
+
+    // The streams of all screens are composed into one frame of the whole desktop.
+    if (!multi_stream_ || !desktop_frame_ || desktop_frame_->size() != desktop_size)
+    {
+        LOG(LS_INFO) << "New screen size: " << screen_size.width() << "x" << screen_size.height();
+
+        streams_.erase(0);
+        multi_stream_ = true;
+
+        desktop_frame_ = std::make_shared<DoubleBufferedFrame>(
+            desktop_window_proxy_->allocateFrame(desktop_size),
+            desktop_window_proxy_->allocateFrame(desktop_size));
+        desktop_window_proxy_->setFrame(screen_size, desktop_frame_);
+    }
+
+    if (!stream->frame || stream->frame->size() != video_size)
+        stream->frame = base::FrameSimple::create(video_size);
+
+    stream->position = stream_rect.topLeft();
+    return true;
+}
+
+void VideoDecoderThread::applyCopyRect(const proto::VideoPacket& packet, const Stream& stream)
+{
+    if (!packet.has_copy_rect())
+        return;
+
+    base::Frame* frame = decoderFrame(stream);
+    const base::Rect frame_rect = base::Rect::makeSize(frame->size());
+
+    const proto::VideoCopyRect& copy_rect = packet.copy_rect();
+    const base::Rect rect = toRect(copy_rect.rect());
+    const base::Rect source_rect = base::Rect::makeXYWH(
+        copy_rect.source_x(), copy_rect.source_y(), rect.width(), rect.height());
+
+    if (rect.isEmpty() || !frame_rect.containsRect(rect) || !frame_rect.containsRect(source_rect))
+    {
+        LOG(LS_ERROR) << "Wrong copy rect: " << rect << " (source: " << source_rect << ")";
+        return;
+    }
+
+    frame->movePixels(source_rect.topLeft(), rect);
+}
+
+void VideoDecoderThread::updateTileCache(const proto::VideoPacket& packet, Stream* stream)
+{
+    if (!packet.cached_tile_size() && !packet.stored_tile_size())
+        return;
+
+    if (!stream->tile_cache)
+    {
+        LOG(LS_ERROR) << "The tile cache is not initialized";
+        return;
+    }
+
+    base::Frame* frame = decoderFrame(*stream);
+    const base::Rect frame_rect = base::Rect::makeSize(frame->size());
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::VideoTile& tile = packet.cached_tile(i);
+
+        if (!stream->tile_cache->paint(tile.key(), toRect(tile.rect()), frame))
+            LOG(LS_WARNING) << "Tile not found in the cache: " << tile.key();
+    }
+
+    for (int i = 0; i < packet.stored_tile_size(); ++i)
+    {
+        const proto::VideoTile& tile = packet.stored_tile(i);
+        const base::Rect rect = toRect(tile.rect());
+
+        if (rect.isEmpty() || rect.width() > base::VideoTileCache::kTileSize ||
+            rect.height() > base::VideoTileCache::kTileSize || !frame_rect.containsRect(rect))
+        {
+            LOG(LS_ERROR) << "Wrong rectangle of the stored tile: " << rect;
+            continue;
+        }
+
+        stream->tile_cache->add(tile.key(), *frame, rect);
+    }
+}
+
+base::Frame* VideoDecoderThread::decoderFrame(const Stream& stream)
+{
+    // The single stream is decoded directly into the desktop frame.
+    if (!stream.frame)
+        return desktop_frame_->backFrame();
+
+    return stream.frame.get();
+}
+
+base::Region VideoDecoderThread::swapDesktopFrame(
+    const Stream& stream, const proto::VideoPacket& packet)
+{
+    base::Region updated_region = updatedRegion(packet);
+
+    if (stream.frame)
+    {
+        updated_region.intersectWith(base::Rect::makeSize(stream.frame->size()));
+
+        base::Frame* back_frame = desktop_frame_->backFrame();
+
+        for (base::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+        {
+            const base::Rect& rect = it.rect();
+            back_frame->copyPixelsFrom(*stream.frame, rect.topLeft(),
+                                       rect.translated(stream.position));
+        }
+
+        updated_region.translate(stream.position.x(), stream.position.y());
+    }
+
+    desktop_frame_->swap(updated_region);
+    return updated_region;
+}
+
+} // namespace client
@@ -0,0 +1,136 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__VIDEO_DECODER_THREAD_H
+#define CLIENT__VIDEO_DECODER_THREAD_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+#include "base/threading/thread_pool.h"
+#include "client/frame_timestamps.h"
+#include "proto/desktop.pb.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace base {
+class Frame;
+class VideoDecoder;
+class VideoTileCache;
+} // namespace base
+
+namespace client {
+
+class DesktopWindowProxy;
+class DoubleBufferedFrame;
+
+// Decodes the video packets off the network thread, so it keeps reading the socket while a large
+// frame is being decoded. The packets of all desktop sessions of the process are decoded on one
+// pool of threads, which has as many threads as there are cores. The packets of a session are
+// decoded one after another, each packet is a separate task of the pool. The sessions in the
+// background (see setBackground()) are decoded only when the pool has no packets of the other
+// sessions. The packets wait in a bounded queue. If the decoder cannot
+// keep up and the queue is full, the queued packets are dropped. The next packets are dropped too
+// until a key frame arrives, because the other frames cannot be decoded without the previous
+// ones.
+// The packets are decoded into the back buffer of the desktop frame and the buffers are swapped
+// after each packet, so the UI thread does not wait for the decoder.
+// In the multi-stream mode the host encodes each screen into its own stream. Each stream has its
+// own decoders and frame, the updated areas are copied into the desktop frame at the position of
+// the screen.
+// If the host uses the tile cache, each stream keeps the refined tiles which the host tells it to
+// store, and paints them again when the host refers to them instead of encoding the tile.
+class VideoDecoderThread
+{
+public:
+    explicit VideoDecoderThread(std::shared_ptr<DesktopWindowProxy> desktop_window_proxy);
+    ~VideoDecoderThread();
+
+    // Adds |packet| to the queue and returns immediately. Returns false if the packets have been
+    // dropped or a packet could not be decoded, and a key frame must be requested from the host.
+    // |timestamps| are passed to the window with the decoded frame.
+    bool decode(std::unique_ptr<proto::VideoPacket> packet, const FrameTimestamps& timestamps);
+
+    // Returns the number of frames decoded since the previous call.
+    int64_t takeDecodedFrameCount();
+
+    // Marks the session whose window is not active. Its packets are decoded with the remaining
+    // capacity of the pool. If it is not enough, the queue overflows and the session gets fewer
+    // frames.
+    void setBackground(bool background);
+
+private:
+    struct PendingPacket
+    {
+        std::unique_ptr<proto::VideoPacket> packet;
+        FrameTimestamps timestamps;
+    };
+
+    struct Stream
+    {
+        proto::VideoEncoding video_encoding = proto::VIDEO_ENCODING_UNKNOWN;
+        std::unique_ptr<base::VideoDecoder> video_decoder;
+        std::unique_ptr<base::VideoDecoder> refinement_decoder;
+        std::unique_ptr<base::VideoTileCache> tile_cache;
+
+        // Not set for the single stream, which is decoded directly into the desktop frame.
+        std::unique_ptr<base::Frame> frame;
+        base::Point position;
+    };
+
+    // Called on the threads of the pool.
+    void decodePendingPacket();
+    void decodeVideoPacket(const proto::VideoPacket& packet, FrameTimestamps timestamps);
+    void decodeRefinementPacket(const proto::VideoPacket& packet);
+    void requestKeyFrame();
+    bool setFormat(uint32_t stream_id, const proto::VideoPacketFormat& format, Stream* stream);
+    void applyCopyRect(const proto::VideoPacket& packet, const Stream& stream);
+    void updateTileCache(const proto::VideoPacket& packet, Stream* stream);
+    base::Frame* decoderFrame(const Stream& stream);
+    base::Region swapDesktopFrame(const Stream& stream, const proto::VideoPacket& packet);
+
+    std::shared_ptr<DesktopWindowProxy> desktop_window_proxy_;
+
+    // Access is guarded by |pending_lock_|.
+    std::mutex pending_lock_;
+    std::deque<PendingPacket> pending_packets_;
+    bool waiting_key_frame_ = false;
+    bool key_frame_request_pending_ = false;
+    base::ThreadPool::Priority priority_ = base::ThreadPool::Priority::NORMAL;
+
+    // True while a task of the pool decodes the packets. The destructor waits for |idle_event_|.
+    bool decode_scheduled_ = false;
+    std::condition_variable idle_event_;
+
+    std::atomic<int64_t> decoded_frame_count_ = 0;
+
+    // Accessed only by the task that decodes the packets.
+    std::map<uint32_t, Stream> streams_;
+    std::shared_ptr<DoubleBufferedFrame> desktop_frame_;
+    bool multi_stream_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderThread);
+};
+
+} // namespace client
+
+#endif // CLIENT__VIDEO_DECODER_THREAD_H
@@ -19,6 +19,9 @@
 #include "common/clipboard.h"
 
 #include "base/logging.h"
+#include "base/codec/scoped_zstd_stream.h"
+
+#include <algorithm>
 
 #include <zstd.h>
 
@@ -28,6 +31,8 @@ namespace {
 
 const char kMimeTypeTextUtf8[] = "text/plain; charset=UTF-8";
 const char kMimeTypeCompressedTextUtf8[] = "text/plain; charset=UTF-8; compression=ZSTD";
+const char kMimeTypeDictionaryTextUtf8[] =
+    "text/plain; charset=UTF-8; compression=ZSTD; dictionary=text";
 
 // The compression ratio can be in the range of 1 to 22.
 const int kCompressionRatio = 8;
@@ -35,13 +40,67 @@ const int kCompressionRatio = 8;
 // Smaller data will not be compressed.
 const size_t kMinSizeToCompress = 512;
 
+// With the dictionary of the texts even short data is compressed well.
+const size_t kMinSizeToCompressWithDictionary = 64;
+
+// Larger clipboard is neither sent nor received. The limit applies to the uncompressed data.
+const size_t kMaxDataSize = 32 * 1024 * 1024; // 32 MB
+
+// Larger data is sent in chunks of this size, so no message reaches the limits of the channels and
+// one transfer does not hold up the other messages of the session for long.
+const size_t kMaxChunkSize = 256 * 1024; // 256 kB
+
+// Common words, separators and fragments of addresses and paths. Zstd uses the content as the
+// history for the matches, so the more frequent fragments are closer to the end (the offsets are
+// shorter). The dictionary must not be changed: the peers of other versions have the same one.
+const char kTextDictionary[] =
+    "#include <stdio.h>\n#define const static void int char unsigned struct class public: "
+    "private: return nullptr; true false null undefined function(var let = new this. "
+    "SELECT * FROM WHERE AND OR ORDER BY GROUP INSERT INTO VALUES UPDATE SET DELETE "
+    "C:\\Users\\Program Files\\Windows\\System32\\AppData\\Local\\Documents\\Desktop\\"
+    "/home/usr/bin/etc/var/log/tmp/.exe .dll .txt .pdf .docx .xlsx .png .jpg .zip "
+    "ERROR Error: Warning: Exception failed not found denied access password login user "
+    "192.168.0.1 127.0.0.1 localhost :8080 :443 ?id=&page=&q=#utm_source= "
+    "mailto:@gmail.com @outlook.com @yahoo.com .org/ .net/ .ru/ .de/ .html .php "
+    "Monday Tuesday Wednesday Thursday Friday Saturday Sunday January February March April "
+    "May June July August September October November December "
+    "Hello Hi Thanks Thank you Please Regards Best regards Dear Sir Madam. "
+    "which their there about would could should other after first also because into "
+    "been have from they will with what when this that were your more some time "
+    "The the of and to in is for on it as at by be an or are not you was "
+    "\r\n\r\n\t\t    \"\": \",\n{\n}\n[]();\r\n"
+    "https://www.google.com/search?q= https://github.com/ https://www.youtube.com/watch?v= "
+    "https://www. http://www. .com/ the and ";
+
+struct TextDictionary
+{
+    TextDictionary()
+        : cdict(ZSTD_createCDict(kTextDictionary, sizeof(kTextDictionary) - 1, kCompressionRatio)),
+          ddict(ZSTD_createDDict(kTextDictionary, sizeof(kTextDictionary) - 1))
+    {
+        DCHECK(cdict);
+        DCHECK(ddict);
+    }
+
+    base::ScopedZstdCDict cdict;
+    base::ScopedZstdDDict ddict;
+};
+
+// The dictionary is created at the first use. The clipboards of the host and the client work on
+// different threads, the initialization of the static variable is thread-safe.
+const TextDictionary& textDictionary()
+{
+    static const TextDictionary dictionary;
+    return dictionary;
+}
+
 uint8_t* outputBuffer(std::string* out, size_t size)
 {
     out->resize(size);
     return reinterpret_cast<uint8_t*>(out->data());
 }
 
-bool compress(const std::string& in, std::string* out)
+bool compress(const std::string& in, const ZSTD_CDict* dictionary, std::string* out)
 {
     if (in.empty())
         return false;
@@ -52,8 +111,19 @@ bool compress(const std::string& in, std::string* out)
     size_t output_size = ZSTD_compressBound(in.size());
     uint8_t* output_data = outputBuffer(out, output_size);
 
-    size_t ret = ZSTD_compress(
-        output_data, output_size, input_data, input_size, kCompressionRatio);
+    size_t ret;
+
+    if (dictionary)
+    {
+        base::ScopedZstdCStream context(ZSTD_createCCtx());
+        ret = ZSTD_compress_usingCDict(
+            context.get(), output_data, output_size, input_data, input_size, dictionary);
+    }
+    else
+    {
+        ret = ZSTD_compress(output_data, output_size, input_data, input_size, kCompressionRatio);
+    }
+
     if (ZSTD_isError(ret))
     {
         LOG(LS_ERROR) << "ZSTD_compress failed: " << ZSTD_getErrorName(ret);
@@ -64,7 +134,7 @@ bool compress(const std::string& in, std::string* out)
     return true;
 }
 
-bool decompress(const std::string& in, std::string* out)
+bool decompress(const std::string& in, const ZSTD_DDict* dictionary, std::string* out)
 {
     if (in.empty())
         return false;
@@ -85,10 +155,27 @@ bool decompress(const std::string& in, std::string* out)
     if (!output_size)
         return false;
 
+    if (output_size > kMaxDataSize)
+    {
+        LOG(LS_ERROR) << "Too large clipboard: " << output_size;
+        return false;
+    }
+
     uint8_t* output_data = outputBuffer(out, static_cast<size_t>(output_size));
 
-    size_t ret = ZSTD_decompress(
-        output_data, static_cast<size_t>(output_size), in.data(), in.size());
+    size_t ret;
+
+    if (dictionary)
+    {
+        base::ScopedZstdDStream context(ZSTD_createDCtx());
+        ret = ZSTD_decompress_usingDDict(context.get(), output_data,
+            static_cast<size_t>(output_size), in.data(), in.size(), dictionary);
+    }
+    else
+    {
+        ret = ZSTD_decompress(output_data, static_cast<size_t>(output_size), in.data(), in.size());
+    }
+
     if (ZSTD_isError(ret))
     {
         LOG(LS_ERROR) << "ZSTD_decompress failed: " << ZSTD_getErrorName(ret);
@@ -107,29 +194,66 @@ void Clipboard::start(Delegate* delegate)
     init();
 }
 
+void Clipboard::setTextDictionaryEnabled(bool enable)
+{
+    text_dictionary_enabled_ = enable;
+}
+
+void Clipboard::setChunksEnabled(bool enable)
+{
+    chunks_enabled_ = enable;
+}
+
 void Clipboard::injectClipboardEvent(const proto::ClipboardEvent& event)
 {
-    if (event.mime_type() == kMimeTypeCompressedTextUtf8)
+    const uint32_t flags = event.flags();
+    if (!(flags & proto::ClipboardEvent::CHUNK))
     {
-        std::string decompressed_data;
-        if (!decompress(event.data(), &decompressed_data))
-            return;
-
-        // Store last injected data.
-        last_data_ = std::move(decompressed_data);
+        injectData(event.mime_type(), event.data());
+        return;
     }
-    else if (event.mime_type() == kMimeTypeTextUtf8)
+
+    if (flags & proto::ClipboardEvent::CHUNK_FIRST)
     {
-        // Store last injected data.
-        last_data_ = event.data();
+        if (event.total_size() > kMaxDataSize)
+        {
+            LOG(LS_WARNING) << "Too large clipboard: " << event.total_size();
+            incoming_mime_type_.clear();
+            incoming_data_.clear();
+            return;
+        }
+
+        incoming_mime_type_ = event.mime_type();
+        incoming_size_ = static_cast<size_t>(event.total_size());
+
+        incoming_data_.clear();
+        incoming_data_.reserve(incoming_size_);
     }
-    else
+
+    // The first chunk was rejected or lost.
+    if (incoming_mime_type_.empty())
+        return;
+
+    if (incoming_data_.size() + event.data().size() > incoming_size_)
     {
-        LOG(LS_WARNING) << "Unsupported mime type: " << event.mime_type();
+        LOG(LS_WARNING) << "Clipboard chunks exceed the total size: " << incoming_size_;
+        incoming_mime_type_.clear();
+        incoming_data_.clear();
         return;
     }
 
-    setData(last_data_);
+    incoming_data_.append(event.data());
+
+    if (!(flags & proto::ClipboardEvent::CHUNK_LAST))
+        return;
+
+    std::string mime_type = std::move(incoming_mime_type_);
+    std::string data = std::move(incoming_data_);
+
+    incoming_mime_type_.clear();
+    incoming_data_.clear();
+
+    injectData(mime_type, data);
 }
 
 void Clipboard::onData(const std::string& data)
@@ -137,12 +261,27 @@ void Clipboard::onData(const std::string& data)
     if (last_data_ == data)
         return;
 
+    if (data.size() > kMaxDataSize)
+    {
+        LOG(LS_WARNING) << "Too large clipboard is not sent: " << data.size();
+        return;
+    }
+
     proto::ClipboardEvent event;
 
-    if (data.size() > kMinSizeToCompress)
+    if (text_dictionary_enabled_ && data.size() > kMinSizeToCompressWithDictionary)
     {
         std::string compressed_data;
-        if (!compress(data, &compressed_data))
+        if (!compress(data, textDictionary().cdict.get(), &compressed_data))
+            return;
+
+        event.set_mime_type(kMimeTypeDictionaryTextUtf8);
+        event.set_data(std::move(compressed_data));
+    }
+    else if (data.size() > kMinSizeToCompress)
+    {
+        std::string compressed_data;
+        if (!compress(data, nullptr, &compressed_data))
             return;
 
         event.set_mime_type(kMimeTypeCompressedTextUtf8);
@@ -151,11 +290,79 @@ void Clipboard::onData(const std::string& data)
     else
     {
         event.set_mime_type(kMimeTypeTextUtf8);
-        event.set_data(std::move(data));
+        event.set_data(data);
+    }
+
+    if (!delegate_)
+        return;
+
+    if (!chunks_enabled_ || event.data().size() <= kMaxChunkSize)
+    {
+        delegate_->onClipboardEvent(event);
+        return;
     }
 
-    if (delegate_)
+    const std::string event_data = std::move(*event.mutable_data());
+    const size_t total_size = event_data.size();
+
+    for (size_t offset = 0; offset < total_size; offset += kMaxChunkSize)
+    {
+        const size_t size = std::min(kMaxChunkSize, total_size - offset);
+
+        uint32_t flags = proto::ClipboardEvent::CHUNK;
+        if (!offset)
+        {
+            flags |= proto::ClipboardEvent::CHUNK_FIRST;
+            event.set_total_size(total_size);
+        }
+        else
+        {
+            event.clear_total_size();
+        }
+
+        if (offset + size == total_size)
+            flags |= proto::ClipboardEvent::CHUNK_LAST;
+
+        event.set_flags(flags);
+        event.set_data(event_data.data() + offset, size);
+
         delegate_->onClipboardEvent(event);
+    }
+}
+
+void Clipboard::injectData(const std::string& mime_type, const std::string& data)
+{
+    if (mime_type == kMimeTypeCompressedTextUtf8 || mime_type == kMimeTypeDictionaryTextUtf8)
+    {
+        const ZSTD_DDict* dictionary = nullptr;
+        if (mime_type == kMimeTypeDictionaryTextUtf8)
+            dictionary = textDictionary().ddict.get();
+
+        std::string decompressed_data;
+        if (!decompress(data, dictionary, &decompressed_data))
+            return;
+
+        // Store last injected data.
+        last_data_ = std::move(decompressed_data);
+    }
+    else if (mime_type == kMimeTypeTextUtf8)
+    {
+        if (data.size() > kMaxDataSize)
+        {
+            LOG(LS_WARNING) << "Too large clipboard: " << data.size();
+            return;
+        }
+
+        // Store last injected data.
+        last_data_ = data;
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unsupported mime type: " << mime_type;
+        return;
+    }
+
+    setData(last_data_);
 }
 
 } // namespace common
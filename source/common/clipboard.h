@@ -40,6 +40,16 @@ public:
 
     void start(Delegate* delegate);
 
+    // If enabled, the outgoing texts are compressed with the built-in dictionary of the texts. It
+    // must be enabled only if the peer supports proto::ZSTD_DICTIONARY_TEXT. The incoming texts are
+    // always accepted in any compression.
+    void setTextDictionaryEnabled(bool enable);
+
+    // If enabled, a large outgoing clipboard is sent in chunks. It must be enabled only if the peer
+    // supports them, otherwise the clipboard is sent in one event. The incoming chunks are always
+    // accepted.
+    void setChunksEnabled(bool enable);
+
     // Receiving the incoming clipboard.
     void injectClipboardEvent(const proto::ClipboardEvent& event);
 
@@ -49,8 +59,17 @@ protected:
     void onData(const std::string& data);
 
 private:
+    void injectData(const std::string& mime_type, const std::string& data);
+
     Delegate* delegate_ = nullptr;
     std::string last_data_;
+    bool text_dictionary_enabled_ = false;
+    bool chunks_enabled_ = false;
+
+    // The clipboard that is being received in chunks.
+    std::string incoming_mime_type_;
+    std::string incoming_data_;
+    size_t incoming_size_ = 0;
 };
 
 } // namespace common
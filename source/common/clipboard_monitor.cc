@@ -19,6 +19,8 @@
 #include "common/clipboard_monitor.h"
 
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -42,6 +44,16 @@ ClipboardMonitor::ClipboardMonitor()
 ClipboardMonitor::~ClipboardMonitor()
 {
     thread_->stop();
+
+#if defined(OS_WIN)
+    if (on_caller_thread_)
+    {
+        DCHECK(caller_task_runner_->belongsToCurrentThread());
+
+        clipboard_.reset();
+        base::MessageLoop::current()->pumpAsio()->setWindowMessagesEnabled(false);
+    }
+#endif // defined(OS_WIN)
 }
 
 void ClipboardMonitor::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
@@ -56,6 +68,20 @@ void ClipboardMonitor::start(std::shared_ptr<base::TaskRunner> caller_task_runne
     base::MessageLoop::Type message_loop_type;
 
 #if defined(OS_WIN)
+    base::MessageLoop* message_loop = base::MessageLoop::current();
+    if (message_loop && message_loop->type() == base::MessageLoop::Type::ASIO &&
+        caller_task_runner_->belongsToCurrentThread())
+    {
+        // The window of the clipboard is served by the loop of the caller, so the clipboard events
+        // are not passed between threads.
+        message_loop->pumpAsio()->setWindowMessagesEnabled(true);
+        on_caller_thread_ = true;
+
+        self_task_runner_ = caller_task_runner_;
+        createClipboard();
+        return;
+    }
+
     message_loop_type = base::MessageLoop::Type::WIN;
 #elif defined(OS_LINUX)
     message_loop_type = base::MessageLoop::Type::ASIO;
@@ -84,11 +110,53 @@ void ClipboardMonitor::injectClipboardEvent(const proto::ClipboardEvent& event)
         clipboard_->injectClipboardEvent(event);
 }
 
+void ClipboardMonitor::setTextDictionaryEnabled(bool enable)
+{
+    if (!self_task_runner_)
+        return;
+
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(
+            std::bind(&ClipboardMonitor::setTextDictionaryEnabled, this, enable));
+        return;
+    }
+
+    if (clipboard_)
+        clipboard_->setTextDictionaryEnabled(enable);
+}
+
+void ClipboardMonitor::setChunksEnabled(bool enable)
+{
+    if (!self_task_runner_)
+        return;
+
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(
+            std::bind(&ClipboardMonitor::setChunksEnabled, this, enable));
+        return;
+    }
+
+    if (clipboard_)
+        clipboard_->setChunksEnabled(enable);
+}
+
 void ClipboardMonitor::onBeforeThreadRunning()
 {
     self_task_runner_ = thread_->taskRunner();
     DCHECK(self_task_runner_);
 
+    createClipboard();
+}
+
+void ClipboardMonitor::onAfterThreadRunning()
+{
+    clipboard_.reset();
+}
+
+void ClipboardMonitor::createClipboard()
+{
 #if defined(OS_WIN)
     clipboard_ = std::make_unique<common::ClipboardWin>();
 #elif defined(OS_LINUX)
@@ -101,11 +169,6 @@ void ClipboardMonitor::onBeforeThreadRunning()
     clipboard_->start(this);
 }
 
-void ClipboardMonitor::onAfterThreadRunning()
-{
-    clipboard_.reset();
-}
-
 void ClipboardMonitor::onClipboardEvent(const proto::ClipboardEvent& event)
 {
     if (!caller_task_runner_->belongsToCurrentThread())
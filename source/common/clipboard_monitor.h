@@ -32,11 +32,20 @@ public:
     ClipboardMonitor();
     ~ClipboardMonitor();
 
+    // On Windows, if the caller runs an asio message loop, the clipboard works on the thread of
+    // the caller (see base::MessagePumpForAsio::setWindowMessagesEnabled()). Otherwise a thread
+    // with a message loop suitable for the clipboard is started.
     void start(std::shared_ptr<base::TaskRunner> caller_task_runner,
                common::Clipboard::Delegate* delegate);
 
     void injectClipboardEvent(const proto::ClipboardEvent& event);
 
+    // See common::Clipboard::setTextDictionaryEnabled().
+    void setTextDictionaryEnabled(bool enable);
+
+    // See common::Clipboard::setChunksEnabled().
+    void setChunksEnabled(bool enable);
+
 protected:
     // base::Thread::Delegate implementation.
     void onBeforeThreadRunning() override;
@@ -46,8 +55,13 @@ protected:
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
 
 private:
+    void createClipboard();
+
     common::Clipboard::Delegate* delegate_ = nullptr;
 
+    // Set if the clipboard works on the thread of the caller.
+    bool on_caller_thread_ = false;
+
     std::unique_ptr<base::Thread> thread_;
     std::shared_ptr<base::TaskRunner> caller_task_runner_;
     std::shared_ptr<base::TaskRunner> self_task_runner_;
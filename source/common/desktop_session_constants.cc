@@ -18,23 +18,44 @@
 
 #include "common/desktop_session_constants.h"
 
+#include "build/build_config.h"
 #include "proto/desktop.pb.h"
 
 namespace common {
 
+namespace {
+
+#if defined(USE_AV1)
+const uint32_t kAV1VideoEncoding = proto::VIDEO_ENCODING_AV1;
+#else
+const uint32_t kAV1VideoEncoding = 0;
+#endif // defined(USE_AV1)
+
+} // namespace
+
 const char kSelectScreenExtension[] = "select_screen";
 const char kPreferredSizeExtension[] = "preferred_size";
 const char kPowerControlExtension[] = "power_control";
 const char kRemoteUpdateExtension[] = "remote_update";
 const char kSystemInfoExtension[] = "system_info";
+const char kHostStatisticsExtension[] = "host_statistics";
 
 const char kSupportedExtensionsForManage[] =
-    "select_screen;preferred_size;power_control;remote_update;system_info";
+    "select_screen;preferred_size;power_control;remote_update;system_info;host_statistics";
 
 const char kSupportedExtensionsForView[] =
-    "select_screen;preferred_size;system_info";
-
-const uint32_t kSupportedVideoEncodings = proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9;
+    "select_screen;preferred_size;system_info;host_statistics";
+
+#if defined(OS_WIN)
+const uint32_t kSupportedVideoEncodings =
+    proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_H264 |
+    kAV1VideoEncoding;
+#else
+const uint32_t kSupportedVideoEncodings =
+    proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | kAV1VideoEncoding;
+#endif // defined(OS_WIN)
 const uint32_t kSupportedAudioEncodings = proto::AUDIO_ENCODING_OPUS;
+const uint32_t kSupportedZstdDictionaries =
+    proto::ZSTD_DICTIONARY_CURSOR | proto::ZSTD_DICTIONARY_TEXT;
 
 } // namespace common
@@ -28,12 +28,14 @@ extern const char kPreferredSizeExtension[];
 extern const char kPowerControlExtension[];
 extern const char kRemoteUpdateExtension[];
 extern const char kSystemInfoExtension[];
+extern const char kHostStatisticsExtension[];
 
 extern const char kSupportedExtensionsForManage[];
 extern const char kSupportedExtensionsForView[];
 
 extern const uint32_t kSupportedVideoEncodings;
 extern const uint32_t kSupportedAudioEncodings;
+extern const uint32_t kSupportedZstdDictionaries;
 
 } // namespace common
 
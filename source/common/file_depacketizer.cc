@@ -18,14 +18,21 @@
 
 #include "common/file_depacketizer.h"
 
+#include "base/crc32.h"
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
+
+#include <zstd.h>
 
 namespace common {
 
 FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
-                                   std::ofstream&& file_stream)
+                                   std::unique_ptr<base::File> file)
     : file_path_(file_path),
-      file_stream_(std::move(file_stream))
+      file_(std::move(file))
 {
     // Nothing
 }
@@ -33,9 +40,9 @@ FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
 FileDepacketizer::~FileDepacketizer()
 {
     // If the file is opened, it was not completely written.
-    if (file_stream_.is_open())
+    if (file_ && !keep_partial_file_)
     {
-        file_stream_.close();
+        file_.reset();
 
         // The transfer of files was canceled. Delete the file.
         std::error_code ignored_error;
@@ -47,27 +54,61 @@ FileDepacketizer::~FileDepacketizer()
 std::unique_ptr<FileDepacketizer> FileDepacketizer::create(
     const std::filesystem::path& file_path, bool overwrite)
 {
-    std::ofstream::openmode mode = std::ofstream::binary;
+    std::unique_ptr<base::File> file = base::File::open(
+        file_path, overwrite ? base::File::Mode::CREATE_ALWAYS : base::File::Mode::CREATE);
+    if (!file)
+        return nullptr;
 
-    if (overwrite)
-        mode |= std::ofstream::trunc;
+    return std::unique_ptr<FileDepacketizer>(new FileDepacketizer(file_path, std::move(file)));
+}
 
-    std::ofstream file_stream;
+// static
+std::unique_ptr<FileDepacketizer> FileDepacketizer::createForUpdate(
+    const std::filesystem::path& file_path,
+    uint32_t block_size,
+    proto::BlockHashes* block_hashes)
+{
+    DCHECK(block_hashes);
 
-    file_stream.open(file_path, mode);
-    if (!file_stream.is_open())
+    std::unique_ptr<base::File> file = base::File::open(file_path, base::File::Mode::OPEN_ALWAYS);
+    if (!file)
         return nullptr;
 
-    return std::unique_ptr<FileDepacketizer>(
-        new FileDepacketizer(file_path, std::move(file_stream)));
+    const int64_t file_size = file->size();
+    if (file_size < 0)
+        return nullptr;
+
+    std::unique_ptr<FileDepacketizer> depacketizer(
+        new FileDepacketizer(file_path, std::move(file)));
+    depacketizer->update_ = true;
+
+    if (block_size < kMinDeltaBlockSize || block_size > kMaxFileChunkSize)
+    {
+        LOG(LS_WARNING) << "Invalid block size: " << block_size;
+        return depacketizer;
+    }
+
+    const int64_t block_count = (file_size + block_size - 1) / block_size;
+    if (block_count > kMaxDeltaBlocks)
+        return depacketizer;
+
+    if (!depacketizer->calculateBlockHashes(
+            static_cast<uint64_t>(file_size), block_size, block_hashes))
+    {
+        // The file is written in full.
+        block_hashes->Clear();
+        depacketizer->block_crcs_.clear();
+    }
+
+    return depacketizer;
 }
 
 bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(file_);
 
     const size_t packet_size = packet.data().size();
-    if (!packet_size)
+    if (!packet_size && !(packet.flags() & proto::FilePacket::UNCHANGED))
     {
         // If an empty data packet with the last packet flag set is received, the transfer
         // is canceled.
@@ -83,22 +124,192 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
     {
         file_size_ = packet.file_size();
         left_size_ = file_size_;
+
+        // Reserving the space at once keeps the file from fragmenting while it grows.
+        file_->preallocate(file_size_);
     }
 
-    file_stream_.seekp(file_size_ - left_size_);
-    file_stream_.write(packet.data().data(), packet_size);
-    if (file_stream_.fail())
+    const bool has_checksum = (packet.flags() & proto::FilePacket::CHECKSUM) != 0;
+    const uint64_t offset = file_size_ - left_size_;
+
+    packet_crc_ = 0;
+
+    if (packet.flags() & proto::FilePacket::UNCHANGED)
+    {
+        if (!update_ || packet.data_size() > left_size_)
+        {
+            LOG(LS_WARNING) << "Unexpected unchanged packet";
+            return false;
+        }
+
+        if (has_checksum && !checkUnchangedBlock(packet, offset))
+            return false;
+
+        left_size_ -= packet.data_size();
+    }
+    else if (packet.flags() & proto::FilePacket::COMPRESSED)
+    {
+        // The stream starts with the first packet that has data. The previous packets of the file
+        // could be unchanged.
+        if (!stream_)
+        {
+            stream_.reset(ZSTD_createDStream());
+
+            size_t ret = ZSTD_initDStream(stream_.get());
+            if (ZSTD_isError(ret))
+            {
+                LOG(LS_WARNING) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
+                return false;
+            }
+        }
+
+        if (!decompress(packet))
+            return false;
+    }
+    else if (!writeData(packet.data().data(), packet_size))
     {
-        LOG(LS_WARNING) << "Unable to write file";
         return false;
     }
 
-    left_size_ -= packet_size;
+    if (has_checksum)
+    {
+        if (!(packet.flags() & proto::FilePacket::UNCHANGED) && packet_crc_ != packet.crc32c())
+        {
+            LOG(LS_WARNING) << "Wrong checksum of packet at offset " << offset;
+            return false;
+        }
+
+        file_crc_ = base::crc32cCombine(
+            file_crc_, packet.crc32c(), file_size_ - left_size_ - offset);
+    }
 
     if (packet.flags() & proto::FilePacket::LAST_PACKET)
     {
+        if (has_checksum && file_crc_ != packet.file_crc32c())
+        {
+            LOG(LS_WARNING) << "Wrong checksum of file";
+            return false;
+        }
+
+        // The existing file could be larger than the new one.
+        if (update_ && !file_->setSize(file_size_))
+            return false;
+
         file_size_ = 0;
-        file_stream_.close();
+        stream_.reset();
+        file_.reset();
+    }
+
+    return true;
+}
+
+bool FileDepacketizer::calculateBlockHashes(
+    uint64_t file_size, uint32_t block_size, proto::BlockHashes* block_hashes)
+{
+    std::string buffer;
+    buffer.resize(block_size);
+
+    block_hashes->set_block_size(block_size);
+
+    block_size_ = block_size;
+    block_crcs_.clear();
+
+    for (uint64_t offset = 0; offset < file_size; offset += block_size)
+    {
+        const size_t size =
+            static_cast<size_t>(std::min(static_cast<uint64_t>(block_size), file_size - offset));
+
+        if (!file_->read(offset, buffer.data(), size))
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            return false;
+        }
+
+        base::ByteArray hash =
+            base::GenericHash::hash(base::GenericHash::BLAKE2s256, buffer.data(), size);
+        block_hashes->add_hash(hash.data(), hash.size());
+
+        // The unchanged blocks are not sent, their checksums are taken from the existing file.
+        block_crcs_.emplace_back(base::crc32c(0, buffer.data(), size));
+    }
+
+    return true;
+}
+
+bool FileDepacketizer::checkUnchangedBlock(const proto::FilePacket& packet, uint64_t offset)
+{
+    if (!block_size_ || offset % block_size_)
+        return true;
+
+    const uint64_t block_index = offset / block_size_;
+    if (block_index >= block_crcs_.size())
+        return true;
+
+    // The hashes of the blocks match, but the data read from one of the files is different.
+    if (block_crcs_[static_cast<size_t>(block_index)] != packet.crc32c())
+    {
+        LOG(LS_WARNING) << "Wrong checksum of unchanged block at offset " << offset;
+        return false;
+    }
+
+    return true;
+}
+
+bool FileDepacketizer::writeData(const char* data, size_t size)
+{
+    if (size > left_size_)
+    {
+        LOG(LS_WARNING) << "Packet exceeds the file size";
+        return false;
+    }
+
+    // The OS keeps the written data in the cache and writes it to the disk in the background.
+    if (!file_->write(file_size_ - left_size_, data, size))
+    {
+        LOG(LS_WARNING) << "Unable to write file";
+        return false;
+    }
+
+    packet_crc_ = base::crc32c(packet_crc_, data, size);
+    left_size_ -= size;
+    return true;
+}
+
+bool FileDepacketizer::decompress(const proto::FilePacket& packet)
+{
+    DCHECK(stream_);
+
+    if (decompress_buffer_.empty())
+        decompress_buffer_.resize(ZSTD_DStreamOutSize());
+
+    ZSTD_inBuffer in = { packet.data().data(), packet.data().size(), 0 };
+    size_t data_size = 0;
+    bool output_full;
+
+    do
+    {
+        ZSTD_outBuffer out = { decompress_buffer_.data(), decompress_buffer_.size(), 0 };
+
+        size_t ret = ZSTD_decompressStream(stream_.get(), &out, &in);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (!writeData(decompress_buffer_.data(), out.pos))
+            return false;
+
+        data_size += out.pos;
+        output_full = out.pos == out.size;
+    }
+    while (in.pos < in.size || output_full);
+
+    if (data_size != packet.data_size())
+    {
+        LOG(LS_WARNING) << "Wrong size of decompressed data: " << data_size
+                        << " (expected: " << packet.data_size() << ")";
+        return false;
     }
 
     return true;
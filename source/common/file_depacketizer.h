@@ -20,11 +20,13 @@
 #define COMMON__FILE_DEPACKETIZER_H
 
 #include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/files/file.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
+#include <vector>
 
 namespace common {
 
@@ -36,18 +38,52 @@ public:
     static std::unique_ptr<FileDepacketizer> create(const std::filesystem::path& file_path,
                                                     bool overwrite);
 
-    // Reads the packet and writes its contents to a file.
+    // Opens the file without truncating it, so that only the changed parts are written. The hashes
+    // of the blocks of the existing file are added to |block_hashes|. If there is no file or it has
+    // too many blocks, |block_hashes| stays empty and the file is written in full.
+    static std::unique_ptr<FileDepacketizer> createForUpdate(
+        const std::filesystem::path& file_path,
+        uint32_t block_size,
+        proto::BlockHashes* block_hashes);
+
+    // Reads the packet and writes its contents to a file. Packets with the COMPRESSED flag are
+    // decompressed. Packets with the UNCHANGED flag skip a part of the file being updated. If the
+    // packets have the CHECKSUM flag, the CRC-32C of each packet and of the whole file is checked.
     bool writeNextPacket(const proto::FilePacket& packet);
 
+    // If the transfer is interrupted, the written part of the file is kept instead of being
+    // deleted. The next transfer of the file sends only the missing blocks.
+    void keepPartialFile() { keep_partial_file_ = true; }
+
 private:
-    FileDepacketizer(const std::filesystem::path& file_path, std::ofstream&& file_stream);
+    FileDepacketizer(const std::filesystem::path& file_path, std::unique_ptr<base::File> file);
+
+    bool calculateBlockHashes(uint64_t file_size, uint32_t block_size,
+                              proto::BlockHashes* block_hashes);
+    bool writeData(const char* data, size_t size);
+    bool checkUnchangedBlock(const proto::FilePacket& packet, uint64_t offset);
+    bool decompress(const proto::FilePacket& packet);
 
     std::filesystem::path file_path_;
-    std::ofstream file_stream_;
+    std::unique_ptr<base::File> file_;
+
+    base::ScopedZstdDStream stream_;
+    std::string decompress_buffer_;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
 
+    // CRC-32C of the data written for the current packet and of the part of the file before it.
+    uint32_t packet_crc_ = 0;
+    uint32_t file_crc_ = 0;
+
+    // CRC-32C of the blocks of the file being updated. They are calculated with the hashes.
+    uint32_t block_size_ = 0;
+    std::vector<uint32_t> block_crcs_;
+
+    bool update_ = false;
+    bool keep_partial_file_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(FileDepacketizer);
 };
 
@@ -24,6 +24,7 @@
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
+#include <memory>
 
 #if defined(OS_WIN)
 #include <Windows.h>
@@ -49,7 +50,8 @@ public:
     private:
         friend class FileEnumerator;
 #if defined(OS_WIN)
-        WIN32_FIND_DATA find_data_;
+        // Points into the buffer of the enumerator and is valid until the next call of advance().
+        const FILE_ID_BOTH_DIR_INFO* info_ = nullptr;
 #endif // defined(OS_WIN)
 
 #if defined(OS_POSIX)
@@ -71,7 +73,10 @@ private:
     FileInfo file_info_;
 
 #if defined(OS_WIN)
-    HANDLE find_handle_ = INVALID_HANDLE_VALUE;
+    bool fetch(FILE_INFO_BY_HANDLE_CLASS info_class);
+
+    HANDLE directory_ = INVALID_HANDLE_VALUE;
+    std::unique_ptr<uint8_t[]> buffer_;
 #endif // defined(OS_WIN)
 
     DISALLOW_COPY_AND_ASSIGN(FileEnumerator);
@@ -25,14 +25,18 @@ namespace common {
 
 namespace {
 
-time_t fileTimeToUnixTime(const FILETIME& file_time)
-{
-    ULARGE_INTEGER ull;
+// The size of the buffer for one request of the directory entries. A network redirector may not
+// accept larger buffers for one SMB request.
+const DWORD kBufferSize = 64 * 1024;
 
-    ull.LowPart = file_time.dwLowDateTime;
-    ull.HighPart = file_time.dwHighDateTime;
+time_t fileTimeToUnixTime(const LARGE_INTEGER& file_time)
+{
+    return static_cast<uint64_t>(file_time.QuadPart) / 10000000ULL - 11644473600ULL;
+}
 
-    return ull.QuadPart / 10000000ULL - 11644473600ULL;
+std::wstring_view fileName(const FILE_ID_BOTH_DIR_INFO* info)
+{
+    return std::wstring_view(info->FileName, info->FileNameLength / sizeof(wchar_t));
 }
 
 bool shouldSkip(std::wstring_view file_name)
@@ -40,118 +44,144 @@ bool shouldSkip(std::wstring_view file_name)
     return file_name == L"." || file_name == L"..";
 }
 
+proto::FileError fileErrorFromSystem(DWORD error_code)
+{
+    switch (error_code)
+    {
+        case ERROR_ACCESS_DENIED:
+            return proto::FILE_ERROR_ACCESS_DENIED;
+
+        case ERROR_NOT_READY:
+            return proto::FILE_ERROR_DISK_NOT_READY;
+
+        default:
+            LOG(LS_WARNING) << "Unhandled error code: " << base::SystemError::toString(error_code);
+            return proto::FILE_ERROR_SUCCESS;
+    }
+}
+
 } // namespace
 
 // FileEnumerator::FileInfo ----------------------------------------------------------------------
 
-FileEnumerator::FileInfo::FileInfo()
-{
-    memset(&find_data_, 0, sizeof(find_data_));
-}
+FileEnumerator::FileInfo::FileInfo() = default;
 
 bool FileEnumerator::FileInfo::isDirectory() const
 {
-    return (find_data_.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    return (info_->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 }
 
 std::filesystem::path FileEnumerator::FileInfo::name() const
 {
-    return std::filesystem::path(find_data_.cFileName);
+    return std::filesystem::path(fileName(info_));
 }
 
 std::string FileEnumerator::FileInfo::u8name() const
 {
-    return base::utf8FromWide(find_data_.cFileName);
+    return base::utf8FromWide(fileName(info_));
 }
 
 int64_t FileEnumerator::FileInfo::size() const
 {
-    ULARGE_INTEGER size;
-    size.HighPart = find_data_.nFileSizeHigh;
-    size.LowPart = find_data_.nFileSizeLow;
-    return static_cast<int64_t>(size.QuadPart);
+    return info_->EndOfFile.QuadPart;
 }
 
 time_t FileEnumerator::FileInfo::lastWriteTime() const
 {
-    return fileTimeToUnixTime(find_data_.ftLastWriteTime);
+    return fileTimeToUnixTime(info_->LastWriteTime);
 }
 
 // FileEnumerator --------------------------------------------------------------
 
 FileEnumerator::FileEnumerator(const std::filesystem::path& root_path)
 {
-    std::filesystem::path filter(root_path);
-    filter.append(L"*");
-
-    // Start a new find operation.
-    find_handle_ = FindFirstFileExW(filter.c_str(),
-                                    FindExInfoBasic, // Omit short name.
-                                    &file_info_.find_data_,
-                                    FindExSearchNameMatch,
-                                    nullptr,
-                                    FIND_FIRST_EX_LARGE_FETCH);
-    if (find_handle_ == INVALID_HANDLE_VALUE)
+    // Unlike FindFirstFileEx, the directory handle allows to get many entries with one request and
+    // without the short names.
+    directory_ = CreateFileW(root_path.c_str(),
+                             FILE_LIST_DIRECTORY,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_FLAG_BACKUP_SEMANTICS, // Required to open a directory.
+                             nullptr);
+    if (directory_ == INVALID_HANDLE_VALUE)
     {
-        DWORD error_code = GetLastError();
-
-        switch (error_code)
-        {
-            case ERROR_ACCESS_DENIED:
-                error_code_ = proto::FILE_ERROR_ACCESS_DENIED;
-                break;
-
-            case ERROR_NOT_READY:
-                error_code_ = proto::FILE_ERROR_DISK_NOT_READY;
-                break;
-
-            default:
-                LOG(LS_WARNING) << "Unhandled error code: "
-                                << base::SystemError::toString(error_code);
-                break;
-        }
+        error_code_ = fileErrorFromSystem(GetLastError());
+        return;
     }
 
-    while (find_handle_ != INVALID_HANDLE_VALUE)
-    {
-        if (!shouldSkip(file_info_.find_data_.cFileName))
-            break;
+    buffer_ = std::make_unique<uint8_t[]>(kBufferSize);
 
-        if (!FindNextFileW(find_handle_, &file_info_.find_data_))
-        {
-            FindClose(find_handle_);
-            find_handle_ = INVALID_HANDLE_VALUE;
-        }
-    }
+    if (!fetch(FileIdBothDirectoryRestartInfo))
+        return;
+
+    if (shouldSkip(fileName(file_info_.info_)))
+        advance();
 }
 
 FileEnumerator::~FileEnumerator()
 {
-    if (find_handle_ != INVALID_HANDLE_VALUE)
-        FindClose(find_handle_);
+    if (directory_ != INVALID_HANDLE_VALUE)
+        CloseHandle(directory_);
 }
 
 bool FileEnumerator::isAtEnd() const
 {
-    return find_handle_ == INVALID_HANDLE_VALUE;
+    return directory_ == INVALID_HANDLE_VALUE;
 }
 
 void FileEnumerator::advance()
 {
-    while (find_handle_ != INVALID_HANDLE_VALUE)
+    while (directory_ != INVALID_HANDLE_VALUE)
     {
-        // Search for the next file/directory.
-        if (!FindNextFileW(find_handle_, &file_info_.find_data_))
+        const FILE_ID_BOTH_DIR_INFO* info = file_info_.info_;
+
+        if (info->NextEntryOffset)
         {
-            FindClose(find_handle_);
-            find_handle_ = INVALID_HANDLE_VALUE;
+            // The next entry of the current batch.
+            file_info_.info_ = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(
+                reinterpret_cast<const uint8_t*>(info) + info->NextEntryOffset);
         }
-        else
+        else if (!fetch(FileIdBothDirectoryInfo))
         {
-            if (!shouldSkip(file_info_.find_data_.cFileName))
-                break;
+            break;
         }
+
+        if (!shouldSkip(fileName(file_info_.info_)))
+            break;
     }
 }
 
+bool FileEnumerator::fetch(FILE_INFO_BY_HANDLE_CLASS info_class)
+{
+    file_info_.info_ = nullptr;
+
+    if (!GetFileInformationByHandleEx(directory_, info_class, buffer_.get(), kBufferSize))
+    {
+        DWORD error_code = GetLastError();
+
+        if (error_code != ERROR_NO_MORE_FILES)
+        {
+            // The errors in the middle of the listing are not reported as the received items are
+            // still valid.
+            if (info_class == FileIdBothDirectoryRestartInfo)
+            {
+                error_code_ = fileErrorFromSystem(error_code);
+            }
+            else
+            {
+                LOG(LS_WARNING) << "GetFileInformationByHandleEx failed: "
+                                << base::SystemError::toString(error_code);
+            }
+        }
+
+        CloseHandle(directory_);
+        directory_ = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    file_info_.info_ = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(buffer_.get());
+    return true;
+}
+
 } // namespace common
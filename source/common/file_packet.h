@@ -19,12 +19,38 @@
 #ifndef COMMON__FILE_PACKET_H
 #define COMMON__FILE_PACKET_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace common {
 
 // When transferring a file is divided into parts and each part is transmitted separately.
-// This parameter specifies the size of the part.
+// This parameter specifies the default size of the part. Peers that do not report the packet
+// window always use it.
 static const size_t kMaxFilePacketSize = 16 * 1024; // 16 kB
 
+// The maximum size of the part that can be requested from peers that report the packet window.
+static const size_t kMaxFileChunkSize = 1024 * 1024; // 1 MB
+
+// The number of packets that can be requested without waiting for replies to the previous ones.
+static const uint32_t kFilePacketWindow = 8;
+
+// The number of files that can be transferred at once. While the packets of one file are in
+// flight, the next file is opened by the source and created by the target.
+static const uint32_t kMaxFileLanes = 4;
+
+// Files up to this size are transferred in batches of several files per request instead of
+// packets. A batch contains up to |kMaxBatchFiles| files with up to |kMaxBatchSize| bytes of data.
+static const int64_t kMaxBatchFileSize = 64 * 1024; // 64 kB
+static const int64_t kMaxBatchSize = 1024 * 1024; // 1 MB
+static const int kMaxBatchFiles = 1024;
+
+// When an existing file is overwritten, it is compared with the source in blocks and only the
+// changed blocks are sent. The block size grows with the file size up to |kMaxFileChunkSize|, so
+// that the number of blocks does not exceed |kMaxDeltaBlocks|. Larger files are sent in full.
+static const uint32_t kMinDeltaBlockSize = 64 * 1024; // 64 kB
+static const int kMaxDeltaBlocks = 32768;
+
 } // namespace common
 
 #endif // COMMON__FILE_PACKET_H
@@ -18,13 +18,49 @@
 
 #include "common/file_packetizer.h"
 
+#include "base/crc32.h"
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include <zstd.h>
+
 namespace common {
 
 namespace {
 
+// Fast compression level. The transfer is usually limited by the network, but the host should not
+// spend much CPU time on large files.
+const int kCompressionLevel = 1;
+
+// The file is compressed only if the compressed sample is less than 7/8 of the original size.
+const size_t kCompressionRatioNumerator = 7;
+const size_t kCompressionRatioDenominator = 8;
+
+// The OS reads this much of the file ahead of the current packet while the previous packets are
+// sent. It covers the full packet window with the largest packets.
+const uint64_t kReadAheadSize = 8 * 1024 * 1024; // 8 MB
+
+// On a spinning disk or a network share the files of the parallel lanes are read in turns. Each
+// turn costs a seek or a round trip, so the turns are made longer.
+const uint64_t kSlowStorageReadAheadSize = 32 * 1024 * 1024; // 32 MB
+
+uint64_t readAheadSize(base::File::StorageType storage_type)
+{
+    switch (storage_type)
+    {
+        case base::File::StorageType::ROTATIONAL:
+        case base::File::StorageType::NETWORK:
+            return kSlowStorageReadAheadSize;
+
+        default:
+            return kReadAheadSize;
+    }
+}
+
 char* outputBuffer(proto::FilePacket* packet, size_t size)
 {
     packet->mutable_data()->resize(size);
@@ -33,30 +69,34 @@ char* outputBuffer(proto::FilePacket* packet, size_t size)
 
 } // namespace
 
-FilePacketizer::FilePacketizer(std::ifstream&& file_stream)
-    : file_stream_(std::move(file_stream))
+FilePacketizer::FilePacketizer(std::unique_ptr<base::File> file, uint64_t file_size)
+    : file_(std::move(file)),
+      file_size_(file_size),
+      left_size_(file_size),
+      read_ahead_size_(file_size > kReadAheadSize ? readAheadSize(file_->storageType())
+                                                  : kReadAheadSize)
 {
-    file_stream_.seekg(0, file_stream_.end);
-    file_size_ = file_stream_.tellg();
-    file_stream_.seekg(0);
-    left_size_ = file_size_;
+    // Nothing
 }
 
 std::unique_ptr<FilePacketizer> FilePacketizer::create(const std::filesystem::path& file_path)
 {
-    std::ifstream file_stream;
+    std::unique_ptr<base::File> file = base::File::open(file_path, base::File::Mode::READ);
+    if (!file)
+        return nullptr;
 
-    file_stream.open(file_path, std::ifstream::binary);
-    if (!file_stream.is_open())
+    const int64_t file_size = file->size();
+    if (file_size < 0)
         return nullptr;
 
-    return std::unique_ptr<FilePacketizer>(new FilePacketizer(std::move(file_stream)));
+    return std::unique_ptr<FilePacketizer>(
+        new FilePacketizer(std::move(file), static_cast<uint64_t>(file_size)));
 }
 
 std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
     const proto::FilePacketRequest& request)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(file_);
 
     // Create a new file packet.
     std::unique_ptr<proto::FilePacket> packet = std::make_unique<proto::FilePacket>();
@@ -69,40 +109,189 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
 
     size_t packet_buffer_size = kMaxFilePacketSize;
 
-    if (left_size_ < kMaxFilePacketSize)
+    if (request.packet_size())
+    {
+        packet_buffer_size =
+            std::min(static_cast<size_t>(request.packet_size()), kMaxFileChunkSize);
+    }
+
+    if (left_size_ < packet_buffer_size)
         packet_buffer_size = static_cast<size_t>(left_size_);
 
     char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
+    const uint64_t offset = file_size_ - left_size_;
 
-    // Moving to a new position in file.
-    file_stream_.seekg(file_size_ - left_size_);
-
-    file_stream_.read(packet_buffer, packet_buffer_size);
-    if (file_stream_.fail())
+    if (!file_->read(offset, packet_buffer, packet_buffer_size))
     {
         LOG(LS_WARNING) << "Unable to read file";
         return nullptr;
     }
 
-    if (left_size_ == file_size_)
+    // When half of the read-ahead part is consumed, the next part is requested. The OS reads it
+    // while this packet is compressed and sent.
+    const uint64_t read_end = offset + packet_buffer_size;
+    if (read_end + read_ahead_size_ / 2 > prefetch_offset_ && prefetch_offset_ < file_size_)
+    {
+        const uint64_t prefetch_begin = std::max(prefetch_offset_, read_end);
+
+        prefetch_offset_ = std::min(prefetch_begin + read_ahead_size_, file_size_);
+        file_->prefetch(prefetch_begin, prefetch_offset_ - prefetch_begin);
+    }
+
+    if (packet_buffer_size)
+    {
+        // The checksum is calculated from the data that is already in memory, the file is not
+        // read a second time.
+        const uint32_t packet_crc = base::crc32c(0, packet_buffer, packet_buffer_size);
+        file_crc_ = base::crc32cCombine(file_crc_, packet_crc, packet_buffer_size);
+
+        packet->set_flags(packet->flags() | proto::FilePacket::CHECKSUM);
+        packet->set_crc32c(packet_crc);
+    }
+
+    const bool first_packet = left_size_ == file_size_;
+    if (first_packet)
     {
         packet->set_flags(packet->flags() | proto::FilePacket::FIRST_PACKET);
 
         // Set file path and size in first packet.
         packet->set_file_size(file_size_);
+
+        if (request.has_block_hashes())
+        {
+            const uint32_t block_size = request.block_hashes().block_size();
+
+            if (block_size >= kMinDeltaBlockSize && block_size <= kMaxFileChunkSize)
+                block_hashes_ = std::make_unique<proto::BlockHashes>(request.block_hashes());
+            else
+                LOG(LS_WARNING) << "Invalid block size: " << block_size;
+        }
     }
 
     left_size_ -= packet_buffer_size;
 
-    if (!left_size_)
+    const bool last_packet = !left_size_;
+    if (last_packet)
     {
         file_size_ = 0;
-        file_stream_.close();
+        file_.reset();
 
         packet->set_flags(packet->flags() | proto::FilePacket::LAST_PACKET);
+
+        if (packet->flags() & proto::FilePacket::CHECKSUM)
+            packet->set_file_crc32c(file_crc_);
+    }
+
+    if (isUnchangedBlock(offset, packet->data()))
+    {
+        packet->set_flags(packet->flags() | proto::FilePacket::UNCHANGED);
+        packet->set_data_size(static_cast<uint32_t>(packet_buffer_size));
+        packet->clear_data();
+    }
+    else if (!compression_checked_ && packet_buffer_size)
+    {
+        // The first part of the file that is actually sent is used as a sample.
+        compression_checked_ = true;
+
+        if (request.flags() & proto::FilePacketRequest::ALLOW_COMPRESSION)
+        {
+            stream_.reset(ZSTD_createCStream());
+
+            size_t ret = ZSTD_initCStream(stream_.get(), kCompressionLevel);
+            if (ZSTD_isError(ret))
+            {
+                LOG(LS_WARNING) << "ZSTD_initCStream failed: " << ZSTD_getErrorName(ret);
+                stream_.reset();
+            }
+            else if (!compress(packet->data(), last_packet) ||
+                     compress_buffer_.size() * kCompressionRatioDenominator >=
+                         packet_buffer_size * kCompressionRatioNumerator)
+            {
+                // The sample does not compress well. The file is sent without compression.
+                stream_.reset();
+            }
+        }
+    }
+    else if (stream_ && !compress(packet->data(), last_packet))
+    {
+        return nullptr;
+    }
+
+    if (stream_ && !(packet->flags() & proto::FilePacket::UNCHANGED))
+    {
+        packet->set_flags(packet->flags() | proto::FilePacket::COMPRESSED);
+        packet->set_data_size(static_cast<uint32_t>(packet_buffer_size));
+
+        // The buffer with the original data is reused for the next packet.
+        packet->mutable_data()->swap(compress_buffer_);
+    }
+
+    if (last_packet)
+    {
+        stream_.reset();
+        block_hashes_.reset();
     }
 
     return packet;
 }
 
+bool FilePacketizer::isUnchangedBlock(uint64_t offset, const std::string& data) const
+{
+    if (!block_hashes_ || data.empty())
+        return false;
+
+    // The requests have the size of the block, so every packet starts at the start of a block.
+    const uint64_t block_size = block_hashes_->block_size();
+    if (offset % block_size)
+        return false;
+
+    const uint64_t block_index = offset / block_size;
+    if (block_index >= static_cast<uint64_t>(block_hashes_->hash_size()))
+        return false;
+
+    // The hash also covers the size of the data. The last block of one file matches the block of
+    // the other file only if both have the same size.
+    const std::string& target_hash = block_hashes_->hash(static_cast<int>(block_index));
+    base::ByteArray hash =
+        base::GenericHash::hash(base::GenericHash::BLAKE2s256, data.data(), data.size());
+
+    return hash.size() == target_hash.size() &&
+           memcmp(hash.data(), target_hash.data(), hash.size()) == 0;
+}
+
+bool FilePacketizer::compress(const std::string& input, bool last_packet)
+{
+    DCHECK(stream_);
+
+    const ZSTD_EndDirective directive = last_packet ? ZSTD_e_end : ZSTD_e_flush;
+
+    ZSTD_inBuffer in = { input.data(), input.size(), 0 };
+    size_t out_pos = 0;
+
+    compress_buffer_.resize(ZSTD_compressBound(input.size()));
+
+    while (true)
+    {
+        ZSTD_outBuffer out = { compress_buffer_.data(), compress_buffer_.size(), out_pos };
+
+        size_t ret = ZSTD_compressStream2(stream_.get(), &out, &in, directive);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        out_pos = out.pos;
+
+        // The input is consumed and the stream is flushed.
+        if (!ret)
+            break;
+
+        compress_buffer_.resize(compress_buffer_.size() + ZSTD_CStreamOutSize());
+    }
+
+    compress_buffer_.resize(out_pos);
+    return true;
+}
+
 } // namespace common
@@ -20,10 +20,11 @@
 #define COMMON__FILE_PACKETIZER_H
 
 #include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/files/file.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
 
 namespace common {
@@ -39,16 +40,43 @@ public:
     static std::unique_ptr<FilePacketizer> create(const std::filesystem::path& file_path);
 
     // Creates a packet for transferring.
+    // If the first request has the ALLOW_COMPRESSION flag, the first part of the file is compressed
+    // as a sample. If it compresses well, all packets of the file are compressed with a single zstd
+    // stream. Otherwise (media, archives and other already compressed data) the file is sent as is.
+    // If the first request has the hashes of the blocks of the file on the target, the blocks with
+    // the same hash are replaced with packets with the UNCHANGED flag.
+    // The packets carry the CRC-32C of their data and the last packet the CRC-32C of the file.
     std::unique_ptr<proto::FilePacket> readNextPacket(const proto::FilePacketRequest& request);
 
 private:
-    explicit FilePacketizer(std::ifstream&& file_stream);
+    FilePacketizer(std::unique_ptr<base::File> file, uint64_t file_size);
 
-    std::ifstream file_stream_;
+    // Returns true if |data| at |offset| has the same hash as the block of the file on the target.
+    bool isUnchangedBlock(uint64_t offset, const std::string& data) const;
+
+    // Compresses |input| to |compress_buffer_|. If |last_packet| is true, the stream is ended.
+    bool compress(const std::string& input, bool last_packet);
+
+    std::unique_ptr<base::File> file_;
+
+    std::unique_ptr<proto::BlockHashes> block_hashes_;
+
+    base::ScopedZstdCStream stream_;
+    std::string compress_buffer_;
+    bool compression_checked_ = false;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
 
+    // CRC-32C of the part of the file that is already read.
+    uint32_t file_crc_ = 0;
+
+    // The end of the part of the file that the OS was asked to read ahead.
+    uint64_t prefetch_offset_ = 0;
+
+    // Depends on the type of the storage of the file.
+    const uint64_t read_ahead_size_;
+
     DISALLOW_COPY_AND_ASSIGN(FilePacketizer);
 };
 
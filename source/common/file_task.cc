@@ -43,6 +43,11 @@ const proto::FileRequest& FileTask::request() const
     return *request_;
 }
 
+void FileTask::setRequestId(uint32_t request_id)
+{
+    request_->set_request_id(request_id);
+}
+
 const proto::FileReply& FileTask::reply() const
 {
     static const proto::FileReply kEmptyReply;
@@ -21,6 +21,7 @@
 
 #include "base/macros_magic.h"
 
+#include <cstdint>
 #include <memory>
 
 namespace proto {
@@ -53,6 +54,9 @@ public:
     // Returns the data of the current request.
     const proto::FileRequest& request() const;
 
+    // Sets the identifier by which the reply from the remote computer is matched to the request.
+    void setRequestId(uint32_t request_id);
+
     // Returns reply data for the current request.
     // If method setReply has not been called and data has not been set, an empty reply will be
     // returned.
@@ -23,10 +23,27 @@
 
 namespace common {
 
+namespace {
+
+// A page contains enough items to fill a view. The listing of a huge directory does not have to
+// be kept in memory at once.
+const uint32_t kFileListPageSize = 1000;
+
+} // namespace
+
 FileTaskFactory::FileTaskFactory(
     std::shared_ptr<FileTaskProducerProxy> producer_proxy, FileTask::Target target)
+    : FileTaskFactory(std::move(producer_proxy), target, 0)
+{
+    // Nothing
+}
+
+FileTaskFactory::FileTaskFactory(std::shared_ptr<FileTaskProducerProxy> producer_proxy,
+                                 FileTask::Target target,
+                                 uint32_t lane)
     : producer_proxy_(std::move(producer_proxy)),
-      target_(target)
+      target_(target),
+      lane_(lane)
 {
     DCHECK(producer_proxy_);
     DCHECK(target_ == FileTask::Target::LOCAL || target_ == FileTask::Target::REMOTE);
@@ -48,6 +65,16 @@ std::shared_ptr<FileTask> FileTaskFactory::fileList(const std::string& path)
     return makeTask(std::move(request));
 }
 
+std::shared_ptr<FileTask> FileTaskFactory::fileListPage(const std::string& path, bool next_page)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    proto::FileListRequest* file_list_request = request->mutable_file_list_request();
+    file_list_request->set_path(path);
+    file_list_request->set_max_items(kFileListPageSize);
+    file_list_request->set_next_page(next_page);
+    return makeTask(std::move(request));
+}
+
 std::shared_ptr<FileTask> FileTaskFactory::createDirectory(const std::string& path)
 {
     auto request = std::make_unique<proto::FileRequest>();
@@ -74,6 +101,16 @@ std::shared_ptr<FileTask> FileTaskFactory::remove(const std::string& path)
     return makeTask(std::move(request));
 }
 
+std::shared_ptr<FileTask> FileTaskFactory::removeTree(const std::string& path, bool next_page)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    proto::RemoveRequest* remove_request = request->mutable_remove_request();
+    remove_request->set_path(path);
+    remove_request->set_recursive(true);
+    remove_request->set_next_page(next_page);
+    return makeTask(std::move(request));
+}
+
 std::shared_ptr<FileTask> FileTaskFactory::download(const std::string& file_path)
 {
     auto request = std::make_unique<proto::FileRequest>();
@@ -81,21 +118,57 @@ std::shared_ptr<FileTask> FileTaskFactory::download(const std::string& file_path
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::upload(const std::string& file_path, bool overwrite)
+std::shared_ptr<FileTask> FileTaskFactory::upload(
+    const std::string& file_path, bool overwrite, uint32_t block_size)
 {
     auto request = std::make_unique<proto::FileRequest>();
 
     proto::UploadRequest* upload_request = request->mutable_upload_request();
     upload_request->set_path(file_path);
     upload_request->set_overwrite(overwrite);
+    upload_request->set_block_size(block_size);
+
+    return makeTask(std::move(request));
+}
 
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags, uint32_t packet_size)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags)
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(
+    uint32_t flags, uint32_t packet_size, std::unique_ptr<proto::BlockHashes> block_hashes)
 {
     auto request = std::make_unique<proto::FileRequest>();
     request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
+    request->mutable_packet_request()->set_allocated_block_hashes(block_hashes.release());
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::manifest(const std::string& path)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_manifest_request()->set_path(path);
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::batchDownload(
+    std::unique_ptr<proto::BatchDownloadRequest> batch)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_batch_download_request(batch.release());
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::batchUpload(
+    std::unique_ptr<proto::BatchUploadRequest> batch)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_batch_upload_request(batch.release());
     return makeTask(std::move(request));
 }
 
@@ -115,6 +188,9 @@ std::shared_ptr<FileTask> FileTaskFactory::packet(std::unique_ptr<proto::FilePac
 
 std::shared_ptr<FileTask> FileTaskFactory::makeTask(std::unique_ptr<proto::FileRequest> request)
 {
+    if (lane_)
+        request->set_lane(lane_);
+
     return std::make_shared<FileTask>(producer_proxy_, std::move(request), target_);
 }
 
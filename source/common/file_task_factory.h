@@ -24,6 +24,9 @@
 #include <string>
 
 namespace proto {
+class BatchDownloadRequest;
+class BatchUploadRequest;
+class BlockHashes;
 class FilePacket;
 } // namespace proto
 
@@ -33,18 +36,33 @@ class FileTaskFactory
 {
 public:
     FileTaskFactory(std::shared_ptr<FileTaskProducerProxy> producer_proxy, FileTask::Target target);
+
+    // All requests of the factory are sent in the transfer lane |lane|.
+    FileTaskFactory(std::shared_ptr<FileTaskProducerProxy> producer_proxy,
+                    FileTask::Target target,
+                    uint32_t lane);
     ~FileTaskFactory();
 
     FileTask::Target target() const { return target_; }
 
     std::shared_ptr<FileTask> driveList();
     std::shared_ptr<FileTask> fileList(const std::string& path);
+    // Requests the list of |path| by pages. If |next_page| is false, the listing starts over.
+    std::shared_ptr<FileTask> fileListPage(const std::string& path, bool next_page);
     std::shared_ptr<FileTask> createDirectory(const std::string& path);
     std::shared_ptr<FileTask> rename(const std::string& old_name, const std::string& new_name);
     std::shared_ptr<FileTask> remove(const std::string& path);
+    // Removes |path| with its contents by pages. If |next_page| is false, the removal starts over.
+    std::shared_ptr<FileTask> removeTree(const std::string& path, bool next_page);
     std::shared_ptr<FileTask> download(const std::string& file_path);
-    std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite);
-    std::shared_ptr<FileTask> packetRequest(uint32_t flags);
+    std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite,
+                                     uint32_t block_size);
+    std::shared_ptr<FileTask> packetRequest(uint32_t flags, uint32_t packet_size);
+    std::shared_ptr<FileTask> packetRequest(uint32_t flags, uint32_t packet_size,
+                                            std::unique_ptr<proto::BlockHashes> block_hashes);
+    std::shared_ptr<FileTask> manifest(const std::string& path);
+    std::shared_ptr<FileTask> batchDownload(std::unique_ptr<proto::BatchDownloadRequest> batch);
+    std::shared_ptr<FileTask> batchUpload(std::unique_ptr<proto::BatchUploadRequest> batch);
     std::shared_ptr<FileTask> packet(const proto::FilePacket& packet);
     std::shared_ptr<FileTask> packet(std::unique_ptr<proto::FilePacket> packet);
 
@@ -53,6 +71,7 @@ private:
 
     std::shared_ptr<FileTaskProducerProxy> producer_proxy_;
     const FileTask::Target target_;
+    const uint32_t lane_;
 
     DISALLOW_COPY_AND_ASSIGN(FileTaskFactory);
 };
@@ -0,0 +1,172 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_tree_remover.h"
+
+#include "base/logging.h"
+#include "common/file_enumerator.h"
+
+namespace common {
+
+namespace {
+
+void addFailure(const std::filesystem::path& path,
+                proto::FileError error_code,
+                proto::RemoveResult* result)
+{
+    proto::RemoveResult::Failure* failure = result->add_failure();
+    failure->set_path(path.u8string());
+    failure->set_error_code(error_code);
+}
+
+} // namespace
+
+FileTreeRemover::Level::Level(const std::filesystem::path& path)
+    : path(path),
+      enumerator(std::make_unique<FileEnumerator>(path))
+{
+    // Nothing
+}
+
+FileTreeRemover::Level::~Level() = default;
+
+FileTreeRemover::Level::Level(Level&& other) noexcept = default;
+
+FileTreeRemover::Level& FileTreeRemover::Level::operator=(Level&& other) noexcept = default;
+
+FileTreeRemover::~FileTreeRemover() = default;
+
+// static
+std::unique_ptr<FileTreeRemover> FileTreeRemover::create(
+    const std::filesystem::path& path, proto::FileError* error_code)
+{
+    DCHECK(error_code);
+
+    std::error_code status_code;
+    std::filesystem::file_status status = std::filesystem::symlink_status(path, status_code);
+
+    if (!std::filesystem::exists(status))
+    {
+        if (status_code && status_code != std::errc::no_such_file_or_directory)
+            *error_code = proto::FILE_ERROR_ACCESS_DENIED;
+        else
+            *error_code = proto::FILE_ERROR_PATH_NOT_FOUND;
+
+        return nullptr;
+    }
+
+    std::unique_ptr<FileTreeRemover> remover(new FileTreeRemover());
+
+    if (std::filesystem::is_directory(status))
+        remover->levels_.emplace_back(path);
+    else
+        remover->file_path_ = path;
+
+    *error_code = proto::FILE_ERROR_SUCCESS;
+    return remover;
+}
+
+void FileTreeRemover::nextPage(int max_items, proto::RemoveResult* result)
+{
+    DCHECK(result);
+
+    int count = 0;
+
+    if (!file_path_.empty())
+    {
+        if (!removeItem(file_path_, result))
+            addFailure(file_path_, proto::FILE_ERROR_ACCESS_DENIED, result);
+
+        file_path_.clear();
+        ++count;
+    }
+
+    while (!levels_.empty() && count < max_items)
+    {
+        Level& level = levels_.back();
+        FileEnumerator* enumerator = level.enumerator.get();
+
+        if (enumerator->isAtEnd())
+        {
+            const std::filesystem::path path = level.path;
+            bool has_failures = level.has_failures;
+
+            if (enumerator->errorCode() != proto::FILE_ERROR_SUCCESS)
+            {
+                addFailure(path, enumerator->errorCode(), result);
+                has_failures = true;
+            }
+
+            // The directory is closed before it is removed.
+            levels_.pop_back();
+
+            if (!has_failures && !removeItem(path, result))
+            {
+                addFailure(path, proto::FILE_ERROR_ACCESS_DENIED, result);
+                has_failures = true;
+            }
+
+            if (has_failures && !levels_.empty())
+                levels_.back().has_failures = true;
+
+            ++count;
+            continue;
+        }
+
+        const std::filesystem::path path = level.path / enumerator->fileInfo().name();
+        enumerator->advance();
+
+        std::error_code ignored_code;
+        if (std::filesystem::is_directory(std::filesystem::symlink_status(path, ignored_code)))
+        {
+            // The contents of the directory are removed first.
+            levels_.emplace_back(path);
+            continue;
+        }
+
+        if (!removeItem(path, result))
+        {
+            addFailure(path, proto::FILE_ERROR_ACCESS_DENIED, result);
+            level.has_failures = true;
+        }
+
+        ++count;
+    }
+
+    result->set_has_more(!isAtEnd());
+}
+
+// static
+bool FileTreeRemover::removeItem(const std::filesystem::path& path, proto::RemoveResult* result)
+{
+    std::error_code ignored_code;
+    std::filesystem::permissions(
+        path,
+        std::filesystem::perms::owner_all | std::filesystem::perms::group_all,
+        std::filesystem::perm_options::add | std::filesystem::perm_options::nofollow,
+        ignored_code);
+
+    if (!std::filesystem::remove(path, ignored_code))
+        return false;
+
+    result->set_removed_count(result->removed_count() + 1);
+    result->set_last_path(path.u8string());
+    return true;
+}
+
+} // namespace common
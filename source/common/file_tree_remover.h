@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__FILE_TREE_REMOVER_H
+#define COMMON__FILE_TREE_REMOVER_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace common {
+
+class FileEnumerator;
+
+// Removes a directory tree, the contents of each directory before the directory itself. The
+// removal is split into pages like the walk of FileTreeWalker, so the peer can report progress
+// and errors while a large tree is being removed. Symbolic links are removed, not followed.
+class FileTreeRemover
+{
+public:
+    ~FileTreeRemover();
+
+    // Returns nullptr and sets |error_code| if |path| does not exist. |path| can also be a file.
+    static std::unique_ptr<FileTreeRemover> create(const std::filesystem::path& path,
+                                                   proto::FileError* error_code);
+
+    // Removes up to |max_items| items. Adds the items that could not be removed to |result| and
+    // sets its |has_more| field.
+    void nextPage(int max_items, proto::RemoveResult* result);
+
+    bool isAtEnd() const { return levels_.empty() && file_path_.empty(); }
+
+private:
+    FileTreeRemover() = default;
+
+    struct Level
+    {
+        explicit Level(const std::filesystem::path& path);
+        ~Level();
+
+        Level(Level&& other) noexcept;
+        Level& operator=(Level&& other) noexcept;
+
+        std::filesystem::path path;
+        std::unique_ptr<FileEnumerator> enumerator;
+
+        // Some items inside the directory were not removed, so the directory itself is kept.
+        bool has_failures = false;
+    };
+
+    static bool removeItem(const std::filesystem::path& path, proto::RemoveResult* result);
+
+    std::vector<Level> levels_;
+
+    // Set if the root of the removal is not a directory.
+    std::filesystem::path file_path_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileTreeRemover);
+};
+
+} // namespace common
+
+#endif // COMMON__FILE_TREE_REMOVER_H
@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_tree_walker.h"
+
+#include "base/logging.h"
+#include "common/file_enumerator.h"
+
+namespace common {
+
+namespace {
+
+// Directories nested deeper are listed but not entered. This stops the walk on symbolic link loops.
+const size_t kMaxDepth = 128;
+
+} // namespace
+
+FileTreeWalker::Level::Level(const std::filesystem::path& path, std::string&& prefix)
+    : path(path),
+      prefix(std::move(prefix)),
+      enumerator(std::make_unique<FileEnumerator>(path))
+{
+    // Nothing
+}
+
+FileTreeWalker::Level::~Level() = default;
+
+FileTreeWalker::Level::Level(Level&& other) noexcept = default;
+
+FileTreeWalker::Level& FileTreeWalker::Level::operator=(Level&& other) noexcept = default;
+
+FileTreeWalker::FileTreeWalker(const std::filesystem::path& root_path)
+{
+    levels_.emplace_back(root_path, std::string());
+}
+
+FileTreeWalker::~FileTreeWalker() = default;
+
+// static
+std::unique_ptr<FileTreeWalker> FileTreeWalker::create(
+    const std::filesystem::path& root_path, proto::FileError* error_code)
+{
+    DCHECK(error_code);
+
+    std::error_code ignored_code;
+    std::filesystem::file_status status = std::filesystem::status(root_path, ignored_code);
+
+    if (!std::filesystem::exists(status))
+    {
+        *error_code = proto::FILE_ERROR_PATH_NOT_FOUND;
+        return nullptr;
+    }
+
+    if (!std::filesystem::is_directory(status))
+    {
+        *error_code = proto::FILE_ERROR_INVALID_PATH_NAME;
+        return nullptr;
+    }
+
+    *error_code = proto::FILE_ERROR_SUCCESS;
+    return std::unique_ptr<FileTreeWalker>(new FileTreeWalker(root_path));
+}
+
+proto::FileError FileTreeWalker::nextPage(int max_items, proto::Manifest* manifest)
+{
+    DCHECK(manifest);
+
+    while (!levels_.empty() && manifest->item_size() < max_items)
+    {
+        Level& level = levels_.back();
+        FileEnumerator* enumerator = level.enumerator.get();
+
+        if (enumerator->isAtEnd())
+        {
+            if (enumerator->errorCode() != proto::FILE_ERROR_SUCCESS)
+            {
+                levels_.clear();
+                return enumerator->errorCode();
+            }
+
+            levels_.pop_back();
+            continue;
+        }
+
+        const FileEnumerator::FileInfo& file_info = enumerator->fileInfo();
+
+        const bool is_directory = file_info.isDirectory();
+
+        proto::Manifest::Item* item = manifest->add_item();
+        item->set_path(level.prefix + file_info.u8name());
+        item->set_size(is_directory ? 0 : file_info.size());
+        item->set_modification_time(file_info.lastWriteTime());
+        item->set_is_directory(is_directory);
+
+        std::filesystem::path child_path;
+        if (is_directory && levels_.size() < kMaxDepth)
+            child_path = level.path / file_info.name();
+
+        enumerator->advance();
+
+        // The contents of the directory follow it in the manifest.
+        if (!child_path.empty())
+            levels_.emplace_back(child_path, item->path() + '/');
+    }
+
+    manifest->set_has_more(!levels_.empty());
+    return proto::FILE_ERROR_SUCCESS;
+}
+
+} // namespace common
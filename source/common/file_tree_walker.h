@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__FILE_TREE_WALKER_H
+#define COMMON__FILE_TREE_WALKER_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace common {
+
+class FileEnumerator;
+
+// Walks a directory tree in depth-first order, so each directory is listed before its contents.
+// The walk is split into pages. The state of the enumerators is kept between pages, so the peer
+// can start working with the first page while the rest of the tree is being listed.
+class FileTreeWalker
+{
+public:
+    ~FileTreeWalker();
+
+    // Returns nullptr and sets |error_code| if |root_path| is not an existing directory.
+    static std::unique_ptr<FileTreeWalker> create(const std::filesystem::path& root_path,
+                                                  proto::FileError* error_code);
+
+    // Adds up to |max_items| items to |manifest| and sets its |has_more| field.
+    proto::FileError nextPage(int max_items, proto::Manifest* manifest);
+
+    bool isAtEnd() const { return levels_.empty(); }
+
+private:
+    explicit FileTreeWalker(const std::filesystem::path& root_path);
+
+    struct Level
+    {
+        Level(const std::filesystem::path& path, std::string&& prefix);
+        ~Level();
+
+        Level(Level&& other) noexcept;
+        Level& operator=(Level&& other) noexcept;
+
+        std::filesystem::path path;
+        std::string prefix;
+        std::unique_ptr<FileEnumerator> enumerator;
+    };
+
+    std::vector<Level> levels_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileTreeWalker);
+};
+
+} // namespace common
+
+#endif // COMMON__FILE_TREE_WALKER_H
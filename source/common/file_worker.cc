@@ -21,12 +21,19 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/files/base_paths.h"
+#include "base/files/file.h"
 #include "build/build_config.h"
 #include "common/file_depacketizer.h"
 #include "common/file_packetizer.h"
 #include "common/file_enumerator.h"
+#include "common/file_packet.h"
 #include "common/file_platform_util.h"
 #include "common/file_task.h"
+#include "common/file_tree_remover.h"
+#include "common/file_tree_walker.h"
+
+#include <algorithm>
+#include <array>
 
 #if defined(OS_WIN)
 #include "base/win/drive_enumerator.h"
@@ -34,10 +41,94 @@
 
 namespace common {
 
+namespace {
+
+// The number of items in one page of the manifest. The page of typical paths is about 100 kB.
+const int kMaxManifestItems = 2048;
+
+// The number of items removed by one recursive remove request. The client shows the progress
+// between the requests.
+const int kMaxRemoveItems = 512;
+
+// Adds to |reply| at most |max_items| items from |enumerator| (all the items if |max_items| is 0).
+void fillFileList(FileEnumerator* enumerator, uint32_t max_items, proto::FileReply* reply)
+{
+    proto::FileList* file_list = reply->mutable_file_list();
+
+    while (!enumerator->isAtEnd())
+    {
+        if (max_items && static_cast<uint32_t>(file_list->item_size()) >= max_items)
+        {
+            file_list->set_has_more(true);
+            break;
+        }
+
+        const FileEnumerator::FileInfo& file_info = enumerator->fileInfo();
+
+        proto::FileList::Item* item = file_list->add_item();
+        item->set_name(file_info.u8name());
+        item->set_size(file_info.size());
+        item->set_modification_time(file_info.lastWriteTime());
+        item->set_is_directory(file_info.isDirectory());
+
+        enumerator->advance();
+    }
+
+    reply->set_error_code(enumerator->errorCode());
+}
+
+// The number of files of a batch download that are open at the same time. The files of this
+// window are read in the order of their positions on the disk.
+const size_t kMaxOpenBatchFiles = 64;
+
+// A file of a batch download that is opened and waits to be read.
+struct BatchFile
+{
+    int index;
+    int64_t size;
+    std::unique_ptr<base::File> file;
+};
+
+// Sorts |files| by their positions on the disk if the disk is slow to seek. The files without a
+// known position are read first, in the order of the request.
+void sortByPhysicalOffset(std::vector<BatchFile>* files)
+{
+    if (files->size() < 2)
+        return;
+
+    if (files->front().file->storageType() != base::File::StorageType::ROTATIONAL)
+        return;
+
+    std::vector<std::pair<uint64_t, size_t>> order;
+    order.reserve(files->size());
+
+    for (size_t i = 0; i < files->size(); ++i)
+    {
+        uint64_t offset;
+        if (!(*files)[i].file->physicalOffset(&offset))
+            offset = 0;
+
+        order.emplace_back(offset, i);
+    }
+
+    std::sort(order.begin(), order.end());
+
+    std::vector<BatchFile> sorted;
+    sorted.reserve(files->size());
+
+    for (const auto& item : order)
+        sorted.emplace_back(std::move((*files)[item.second]));
+
+    files->swap(sorted);
+}
+
+} // namespace
+
 class FileWorker::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
-    explicit Impl(std::shared_ptr<base::TaskRunner> task_runner);
+    Impl(std::shared_ptr<base::TaskRunner> task_runner,
+         std::vector<std::shared_ptr<base::TaskRunner>> io_task_runners);
     ~Impl();
 
     void doTask(std::shared_ptr<FileTask> task);
@@ -45,41 +136,93 @@ public:
     std::shared_ptr<base::TaskRunner> taskRunner() { return task_runner_; }
 
 private:
+    base::TaskRunner* requestTaskRunner(const proto::FileRequest& request) const;
     std::unique_ptr<proto::FileReply> doRequest(const proto::FileRequest& request);
     std::unique_ptr<proto::FileReply> doDriveListRequest();
     std::unique_ptr<proto::FileReply> doFileListRequest(const proto::FileListRequest& request);
     std::unique_ptr<proto::FileReply> doCreateDirectoryRequest(const proto::CreateDirectoryRequest& request);
     std::unique_ptr<proto::FileReply> doRenameRequest(const proto::RenameRequest& request);
     std::unique_ptr<proto::FileReply> doRemoveRequest(const proto::RemoveRequest& request);
-    std::unique_ptr<proto::FileReply> doDownloadRequest(const proto::DownloadRequest& request);
-    std::unique_ptr<proto::FileReply> doUploadRequest(const proto::UploadRequest& request);
-    std::unique_ptr<proto::FileReply> doPacketRequest(const proto::FilePacketRequest& request);
-    std::unique_ptr<proto::FileReply> doPacket(const proto::FilePacket& packet);
+    std::unique_ptr<proto::FileReply> doDownloadRequest(
+        uint32_t lane, const proto::DownloadRequest& request);
+    std::unique_ptr<proto::FileReply> doUploadRequest(
+        uint32_t lane, const proto::UploadRequest& request);
+    std::unique_ptr<proto::FileReply> doPacketRequest(
+        uint32_t lane, const proto::FilePacketRequest& request);
+    std::unique_ptr<proto::FileReply> doPacket(uint32_t lane, const proto::FilePacket& packet);
+    std::unique_ptr<proto::FileReply> doManifestRequest(const proto::ManifestRequest& request);
+    std::unique_ptr<proto::FileReply> doBatchDownloadRequest(
+        const proto::BatchDownloadRequest& request);
+    std::unique_ptr<proto::FileReply> doBatchUploadRequest(
+        const proto::BatchUploadRequest& request);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
-    std::unique_ptr<FileDepacketizer> depacketizer_;
-    std::unique_ptr<FilePacketizer> packetizer_;
+    std::vector<std::shared_ptr<base::TaskRunner>> io_task_runners_;
+
+    // Each transfer lane has its own file being read and file being written.
+    std::array<std::unique_ptr<FileDepacketizer>, kMaxFileLanes> depacketizers_;
+    std::array<std::unique_ptr<FilePacketizer>, kMaxFileLanes> packetizers_;
+    std::unique_ptr<FileTreeWalker> tree_walker_;
+
+    // The current recursive removal.
+    std::unique_ptr<FileTreeRemover> tree_remover_;
+    std::string remove_path_;
+
+    // The current paged listing of a directory.
+    std::unique_ptr<FileEnumerator> list_enumerator_;
+    std::string list_path_;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
 
-FileWorker::Impl::Impl(std::shared_ptr<base::TaskRunner> task_runner)
-    : task_runner_(std::move(task_runner))
+FileWorker::Impl::Impl(std::shared_ptr<base::TaskRunner> task_runner,
+                       std::vector<std::shared_ptr<base::TaskRunner>> io_task_runners)
+    : task_runner_(std::move(task_runner)),
+      io_task_runners_(std::move(io_task_runners))
 {
     DCHECK(task_runner_);
 }
 
-FileWorker::Impl::~Impl() = default;
+FileWorker::Impl::~Impl()
+{
+    // The session is closed in the middle of the transfer. The received part of the file is kept
+    // so that the transfer can be resumed.
+    for (auto& depacketizer : depacketizers_)
+    {
+        if (depacketizer)
+            depacketizer->keepPartialFile();
+    }
+}
 
 void FileWorker::Impl::doTask(std::shared_ptr<FileTask> task)
 {
     auto self = shared_from_this();
-    task_runner_->postTask([self, task]()
+    requestTaskRunner(task->request())->postTask([self, task]()
     {
-        task->setReply(self->doRequest(task->request()));
+        std::unique_ptr<proto::FileReply> reply = self->doRequest(task->request());
+        reply->set_request_id(task->request().request_id());
+        task->setReply(std::move(reply));
     });
 }
 
+base::TaskRunner* FileWorker::Impl::requestTaskRunner(const proto::FileRequest& request) const
+{
+    // Without an identifier the sender matches the replies to the requests by their order, so all
+    // such requests are done one after another.
+    if (io_task_runners_.empty() || !request.request_id())
+        return task_runner_.get();
+
+    // Packetizers and depacketizers of a lane are used only on the thread of the lane.
+    if (request.has_download_request() || request.has_upload_request() ||
+        request.has_packet_request() || request.has_packet() ||
+        request.has_batch_download_request() || request.has_batch_upload_request())
+    {
+        return io_task_runners_[request.lane() % io_task_runners_.size()].get();
+    }
+
+    return task_runner_.get();
+}
+
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileRequest& request)
 {
 #if defined(OS_WIN)
@@ -88,6 +231,15 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     SetThreadExecutionState(ES_SYSTEM_REQUIRED);
 #endif
 
+    if (request.lane() >= kMaxFileLanes)
+    {
+        LOG(LS_WARNING) << "Invalid lane: " << request.lane();
+
+        std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+        reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+        return reply;
+    }
+
     if (request.has_drive_list_request())
     {
         return doDriveListRequest();
@@ -110,19 +262,31 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     }
     else if (request.has_download_request())
     {
-        return doDownloadRequest(request.download_request());
+        return doDownloadRequest(request.lane(), request.download_request());
     }
     else if (request.has_upload_request())
     {
-        return doUploadRequest(request.upload_request());
+        return doUploadRequest(request.lane(), request.upload_request());
     }
     else if (request.has_packet_request())
     {
-        return doPacketRequest(request.packet_request());
+        return doPacketRequest(request.lane(), request.packet_request());
     }
     else if (request.has_packet())
     {
-        return doPacket(request.packet());
+        return doPacket(request.lane(), request.packet());
+    }
+    else if (request.has_manifest_request())
+    {
+        return doManifestRequest(request.manifest_request());
+    }
+    else if (request.has_batch_download_request())
+    {
+        return doBatchDownloadRequest(request.batch_download_request());
+    }
+    else if (request.has_batch_upload_request())
+    {
+        return doBatchUploadRequest(request.batch_upload_request());
     }
     else
     {
@@ -218,40 +382,54 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
-    std::filesystem::path path = std::filesystem::u8path(request.path());
-
-    std::error_code ignored_code;
-    std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
-
-    if (!std::filesystem::exists(status))
+    if (request.next_page())
     {
-        reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
-        return reply;
+        if (!list_enumerator_ || list_path_ != request.path())
+        {
+            reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
+            LOG(LS_WARNING) << "Unexpected file list page request";
+            return reply;
+        }
     }
-
-    if (!std::filesystem::is_directory(status))
+    else
     {
-        reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
-        return reply;
-    }
+        std::filesystem::path path = std::filesystem::u8path(request.path());
 
-    proto::FileList* file_list = reply->mutable_file_list();
-    FileEnumerator enumerator(path);
+        std::error_code ignored_code;
+        std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
 
-    while (!enumerator.isAtEnd())
-    {
-        const FileEnumerator::FileInfo& file_info = enumerator.fileInfo();
+        if (!std::filesystem::exists(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
+            return reply;
+        }
 
-        proto::FileList::Item* item = file_list->add_item();
-        item->set_name(file_info.u8name());
-        item->set_size(file_info.size());
-        item->set_modification_time(file_info.lastWriteTime());
-        item->set_is_directory(file_info.isDirectory());
+        if (!std::filesystem::is_directory(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
+            return reply;
+        }
+
+        std::unique_ptr<FileEnumerator> enumerator = std::make_unique<FileEnumerator>(path);
+
+        // A listing without pages does not replace the current paged listing.
+        if (!request.max_items())
+        {
+            fillFileList(enumerator.get(), 0, reply.get());
+            return reply;
+        }
 
-        enumerator.advance();
+        list_enumerator_ = std::move(enumerator);
+        list_path_ = request.path();
     }
 
-    reply->set_error_code(enumerator.errorCode());
+    fillFileList(list_enumerator_.get(), request.max_items(), reply.get());
+
+    if (reply->file_list().has_more())
+        return reply;
+
+    list_enumerator_.reset();
+    list_path_.clear();
     return reply;
 }
 
@@ -336,6 +514,45 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRemoveRequest(
 
     std::filesystem::path path = std::filesystem::u8path(request.path());
 
+    if (request.recursive())
+    {
+        // The result is set even on error. By its absence the client detects old peers.
+        proto::RemoveResult* result = reply->mutable_remove_result();
+
+        if (request.next_page())
+        {
+            if (!tree_remover_ || remove_path_ != request.path())
+            {
+                reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
+                LOG(LS_WARNING) << "Unexpected remove request";
+                return reply;
+            }
+        }
+        else
+        {
+            proto::FileError error_code;
+            tree_remover_ = FileTreeRemover::create(path, &error_code);
+            if (!tree_remover_)
+            {
+                reply->set_error_code(error_code);
+                return reply;
+            }
+
+            remove_path_ = request.path();
+        }
+
+        tree_remover_->nextPage(kMaxRemoveItems, result);
+
+        if (tree_remover_->isAtEnd())
+        {
+            tree_remover_.reset();
+            remove_path_.clear();
+        }
+
+        reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+        return reply;
+    }
+
     std::error_code error_code;
     if (!std::filesystem::exists(path, error_code))
     {
@@ -365,23 +582,29 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRemoveRequest(
 }
 
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doDownloadRequest(
-    const proto::DownloadRequest& request)
+    uint32_t lane, const proto::DownloadRequest& request)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
-    packetizer_ = FilePacketizer::create(std::filesystem::u8path(request.path()));
-    if (!packetizer_)
+    std::unique_ptr<FilePacketizer>& packetizer = packetizers_[lane];
+
+    packetizer = FilePacketizer::create(std::filesystem::u8path(request.path()));
+    if (!packetizer)
         reply->set_error_code(proto::FILE_ERROR_FILE_OPEN_ERROR);
     else
         reply->set_error_code(proto::FILE_ERROR_SUCCESS);
 
+    reply->set_packet_window(kFilePacketWindow);
+    reply->set_lanes(kMaxFileLanes);
+
     return reply;
 }
 
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
-    const proto::UploadRequest& request)
+    uint32_t lane, const proto::UploadRequest& request)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    std::unique_ptr<FileDepacketizer>& depacketizer = depacketizers_[lane];
 
     std::filesystem::path file_path = std::filesystem::u8path(request.path());
 
@@ -397,14 +620,26 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
             }
         }
 
-        depacketizer_ = FileDepacketizer::create(file_path, request.overwrite());
-        if (!depacketizer_)
+        if (request.overwrite() && request.block_size())
+        {
+            depacketizer = FileDepacketizer::createForUpdate(
+                file_path, request.block_size(), reply->mutable_block_hashes());
+        }
+        else
+        {
+            depacketizer = FileDepacketizer::create(file_path, request.overwrite());
+        }
+
+        if (!depacketizer)
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_CREATE_ERROR);
             break;
         }
 
         reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+        reply->set_packet_window(kFilePacketWindow);
+        reply->set_packet_compression(true);
+        reply->set_lanes(kMaxFileLanes);
     }
     while (false);
 
@@ -412,11 +647,12 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
 }
 
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
-    const proto::FilePacketRequest& request)
+    uint32_t lane, const proto::FilePacketRequest& request)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    std::unique_ptr<FilePacketizer>& packetizer = packetizers_[lane];
 
-    if (!packetizer_)
+    if (!packetizer)
     {
         // Set the unknown status of the request. The connection will be closed.
         reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
@@ -424,16 +660,16 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
     }
     else
     {
-        std::unique_ptr<proto::FilePacket> packet = packetizer_->readNextPacket(request);
+        std::unique_ptr<proto::FilePacket> packet = packetizer->readNextPacket(request);
         if (!packet)
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
-            packetizer_.reset();
+            packetizer.reset();
         }
         else
         {
             if (packet->flags() & proto::FilePacket::LAST_PACKET)
-                packetizer_.reset();
+                packetizer.reset();
 
             reply->set_error_code(proto::FILE_ERROR_SUCCESS);
             reply->set_allocated_packet(packet.release());
@@ -443,11 +679,13 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
     return reply;
 }
 
-std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePacket& packet)
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(
+    uint32_t lane, const proto::FilePacket& packet)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    std::unique_ptr<FileDepacketizer>& depacketizer = depacketizers_[lane];
 
-    if (!depacketizer_)
+    if (!depacketizer)
     {
         // Set the unknown status of the request. The connection will be closed.
         reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
@@ -455,10 +693,10 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePa
     }
     else
     {
-        if (!depacketizer_->writeNextPacket(packet))
+        if (!depacketizer->writeNextPacket(packet))
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_WRITE_ERROR);
-            depacketizer_.reset();
+            depacketizer.reset();
         }
         else
         {
@@ -466,14 +704,190 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePa
         }
 
         if (packet.flags() & proto::FilePacket::LAST_PACKET)
-            depacketizer_.reset();
+            depacketizer.reset();
+    }
+
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doManifestRequest(
+    const proto::ManifestRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    if (!request.path().empty())
+    {
+        // A new walk replaces the current one.
+        proto::FileError error_code;
+        tree_walker_ = FileTreeWalker::create(std::filesystem::u8path(request.path()), &error_code);
+        if (!tree_walker_)
+        {
+            reply->set_error_code(error_code);
+            return reply;
+        }
+    }
+    else if (!tree_walker_)
+    {
+        // Set the unknown status of the request. The connection will be closed.
+        reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
+        LOG(LS_WARNING) << "Unexpected manifest request";
+        return reply;
+    }
+
+    reply->set_error_code(tree_walker_->nextPage(kMaxManifestItems, reply->mutable_manifest()));
+
+    if (reply->error_code() != proto::FILE_ERROR_SUCCESS || tree_walker_->isAtEnd())
+        tree_walker_.reset();
+
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doBatchDownloadRequest(
+    const proto::BatchDownloadRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::FileBatch* batch = reply->mutable_batch();
+
+    const int count = std::min(request.path_size(), kMaxBatchFiles);
+    int64_t batch_size = 0;
+    bool batch_end = false;
+
+    std::vector<BatchFile> files;
+    files.reserve(kMaxOpenBatchFiles);
+
+    while (!batch_end && batch->entry_size() < count)
+    {
+        // The files of the window are opened in the order of the request. The batch ends at the
+        // first file that can not be opened or does not fit.
+        while (files.size() < kMaxOpenBatchFiles && batch->entry_size() < count)
+        {
+            const int index = batch->entry_size();
+
+            std::unique_ptr<base::File> file = base::File::open(
+                std::filesystem::u8path(request.path(index)), base::File::Mode::READ);
+            if (!file)
+            {
+                batch->add_entry()->set_error_code(proto::FILE_ERROR_FILE_OPEN_ERROR);
+                batch_end = true;
+                break;
+            }
+
+            const int64_t file_size = file->size();
+            if (file_size < 0)
+            {
+                batch->add_entry()->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+                batch_end = true;
+                break;
+            }
+
+            // The file has grown since it was listed. It is transferred with packets.
+            if (file_size > kMaxBatchFileSize || batch_size + file_size > kMaxBatchSize)
+            {
+                batch_end = true;
+                break;
+            }
+
+            batch->add_entry()->set_error_code(proto::FILE_ERROR_SUCCESS);
+            files.push_back({ index, file_size, std::move(file) });
+            batch_size += file_size;
+        }
+
+        sortByPhysicalOffset(&files);
+
+        // The entries of the reply stay in the order of the request.
+        int read_error_index = batch->entry_size();
+
+        for (const BatchFile& file : files)
+        {
+            proto::FileBatch::Entry* entry = batch->mutable_entry(file.index);
+            std::string* data = entry->mutable_data();
+
+            data->resize(static_cast<size_t>(file.size));
+            if (!file.file->read(0, data->data(), data->size()))
+            {
+                entry->clear_data();
+                entry->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+                read_error_index = std::min(read_error_index, file.index);
+            }
+        }
+
+        files.clear();
+
+        // As in the order of the request, the batch ends at the first error.
+        if (read_error_index < batch->entry_size())
+        {
+            while (batch->entry_size() > read_error_index + 1)
+                batch->mutable_entry()->RemoveLast();
+
+            batch_end = true;
+        }
     }
 
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doBatchUploadRequest(
+    const proto::BatchUploadRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::FileBatch* batch = reply->mutable_batch();
+
+    const int count = std::min(request.entry_size(), kMaxBatchFiles);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const proto::BatchUploadRequest::Entry& request_entry = request.entry(i);
+        proto::FileBatch::Entry* entry = batch->add_entry();
+
+        std::unique_ptr<base::File> file = base::File::open(
+            std::filesystem::u8path(request_entry.path()),
+            request_entry.overwrite() ? base::File::Mode::CREATE_ALWAYS : base::File::Mode::CREATE);
+        if (!file)
+        {
+            std::error_code ignored_code;
+            if (!request_entry.overwrite() &&
+                std::filesystem::exists(std::filesystem::u8path(request_entry.path()),
+                                        ignored_code))
+            {
+                entry->set_error_code(proto::FILE_ERROR_PATH_ALREADY_EXISTS);
+            }
+            else
+            {
+                entry->set_error_code(proto::FILE_ERROR_FILE_CREATE_ERROR);
+            }
+            break;
+        }
+
+        const std::string& data = request_entry.data();
+        if (!file->write(0, data.data(), data.size()))
+        {
+            // The file was not completely written. Delete the file.
+            file.reset();
+
+            std::error_code ignored_code;
+            std::filesystem::remove(std::filesystem::u8path(request_entry.path()), ignored_code);
+
+            entry->set_error_code(proto::FILE_ERROR_FILE_WRITE_ERROR);
+            break;
+        }
+
+        entry->set_error_code(proto::FILE_ERROR_SUCCESS);
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
     return reply;
 }
 
 FileWorker::FileWorker(std::shared_ptr<base::TaskRunner> task_runner)
-    : impl_(std::make_shared<Impl>(std::move(task_runner)))
+    : FileWorker(std::move(task_runner), std::vector<std::shared_ptr<base::TaskRunner>>())
+{
+    // Nothing
+}
+
+FileWorker::FileWorker(std::shared_ptr<base::TaskRunner> task_runner,
+                       std::vector<std::shared_ptr<base::TaskRunner>> io_task_runners)
+    : impl_(std::make_shared<Impl>(std::move(task_runner), std::move(io_task_runners)))
 {
     // Nothing
 }
@@ -22,6 +22,7 @@
 #include "base/macros_magic.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 class TaskRunner;
@@ -35,6 +36,12 @@ class FileWorker
 {
 public:
     explicit FileWorker(std::shared_ptr<base::TaskRunner> task_runner);
+
+    // File reads and writes of lane N are done on |io_task_runners|[N % size], so that the lanes
+    // and the directory listings do not wait for each other. Other requests and requests without
+    // an identifier (whose sender expects the replies in order) are done on |task_runner|.
+    FileWorker(std::shared_ptr<base::TaskRunner> task_runner,
+               std::vector<std::shared_ptr<base::TaskRunner>> io_task_runners);
     ~FileWorker();
 
     void doTask(std::shared_ptr<FileTask> task);
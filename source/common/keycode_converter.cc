@@ -19,6 +19,9 @@
 #include "common/keycode_converter.h"
 #include "build/build_config.h"
 
+#include <array>
+#include <iterator>
+
 #include <QtCore>
 
 namespace common {
@@ -36,12 +39,96 @@ namespace {
 #else
 #define USB_KEYMAP(usb, evdev, xkb, win, mac, qt) {usb, 0, qt}
 #endif
-#define USB_KEYMAP_DECLARATION const KeycodeMapEntry usb_keycode_map[] =
+#define USB_KEYMAP_DECLARATION constexpr KeycodeMapEntry usb_keycode_map[] =
 #include "common/keycode_converter_data.inc"
 #undef USB_KEYMAP
 #undef USB_KEYMAP_DECLARATION
 
-const size_t kKeycodeMapEntries = std::size(usb_keycode_map);
+constexpr size_t kKeycodeMapEntries = std::size(usb_keycode_map);
+
+// The keycodes are looked up in open addressing hash tables which are built by the compiler. Each
+// slot contains the index of an entry of |usb_keycode_map|. The tables are more than twice as
+// large as the map, so a lookup usually reads one or two slots.
+constexpr int kTableBits = 9;
+constexpr size_t kTableSize = size_t(1) << kTableBits;
+constexpr size_t kTableMask = kTableSize - 1;
+constexpr uint16_t kEmptySlot = 0xFFFF;
+
+static_assert(kTableSize >= kKeycodeMapEntries * 2, "Keycode table is too small");
+
+using KeycodeTable = std::array<uint16_t, kTableSize>;
+
+constexpr uint32_t usbKey(const KeycodeMapEntry& entry)
+{
+    return entry.usb_keycode;
+}
+
+constexpr uint32_t nativeKey(const KeycodeMapEntry& entry)
+{
+    return static_cast<uint32_t>(entry.native_keycode);
+}
+
+constexpr uint32_t qtKey(const KeycodeMapEntry& entry)
+{
+    return static_cast<uint32_t>(entry.qt_keycode);
+}
+
+// Fibonacci hashing spreads the keycodes which differ only in the low bits over the table.
+constexpr size_t hashKeycode(uint32_t keycode)
+{
+    return static_cast<size_t>((keycode * 2654435769u) >> (32 - kTableBits));
+}
+
+template <uint32_t (*Key)(const KeycodeMapEntry&)>
+constexpr KeycodeTable makeTable()
+{
+    KeycodeTable table{};
+    for (size_t i = 0; i < kTableSize; ++i)
+        table[i] = kEmptySlot;
+
+    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
+    {
+        const uint32_t keycode = Key(usb_keycode_map[i]);
+        size_t slot = hashKeycode(keycode);
+        bool duplicate = false;
+
+        while (table[slot] != kEmptySlot)
+        {
+            if (Key(usb_keycode_map[table[slot]]) == keycode)
+            {
+                duplicate = true;
+                break;
+            }
+
+            slot = (slot + 1) & kTableMask;
+        }
+
+        // As with the scan of the map, the first of the entries with the same keycode is used.
+        if (!duplicate)
+            table[slot] = static_cast<uint16_t>(i);
+    }
+
+    return table;
+}
+
+constexpr KeycodeTable kUsbKeycodeTable = makeTable<usbKey>();
+constexpr KeycodeTable kNativeKeycodeTable = makeTable<nativeKey>();
+constexpr KeycodeTable kQtKeycodeTable = makeTable<qtKey>();
+
+// Returns the entry with |keycode| or the invalid entry if there is no such keycode.
+template <uint32_t (*Key)(const KeycodeMapEntry&)>
+const KeycodeMapEntry& findEntry(const KeycodeTable& table, uint32_t keycode)
+{
+    for (size_t slot = hashKeycode(keycode);; slot = (slot + 1) & kTableMask)
+    {
+        const uint16_t index = table[slot];
+        if (index == kEmptySlot)
+            return usb_keycode_map[0];
+
+        if (Key(usb_keycode_map[index]) == keycode)
+            return usb_keycode_map[index];
+    }
+}
 
 } // namespace
 
@@ -69,42 +156,25 @@ int KeycodeConverter::usbKeycodeToNativeKeycode(uint32_t usb_keycode)
     // Deal with some special-cases that don't fit the 1:1 mapping.
     if (usb_keycode == 0x070032) // non-US hash.
         usb_keycode = 0x070031; // US backslash.
-#if defined(OS_MACOS)
+#if defined(OS_MAC)
     if (usb_keycode == 0x070046) // PrintScreen.
         usb_keycode = 0x070068; // F13.
 #endif
 
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].usb_keycode == usb_keycode)
-            return usb_keycode_map[i].native_keycode;
-    }
-
-    return invalidNativeKeycode();
+    return findEntry<usbKey>(kUsbKeycodeTable, usb_keycode).native_keycode;
 }
 
 // static
 uint32_t KeycodeConverter::nativeKeycodeToUsbKeycode(int native_keycode)
 {
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].native_keycode == native_keycode)
-            return usb_keycode_map[i].usb_keycode;
-    }
-
-    return invalidUsbKeycode();
+    return findEntry<nativeKey>(
+        kNativeKeycodeTable, static_cast<uint32_t>(native_keycode)).usb_keycode;
 }
 
 // static
 uint32_t KeycodeConverter::qtKeycodeToUsbKeycode(int qt_keycode)
 {
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].qt_keycode == qt_keycode)
-            return usb_keycode_map[i].usb_keycode;
-    }
-
-    return invalidUsbKeycode();
+    return findEntry<qtKey>(kQtKeycodeTable, static_cast<uint32_t>(qt_keycode)).usb_keycode;
 }
 
 } // namespace common
@@ -34,6 +34,7 @@
 #include <QFileDialog>
 #include <QMenu>
 #include <QMessageBox>
+#include <QSaveFile>
 
 namespace console {
 
@@ -788,11 +789,26 @@ void AddressBookTab::updateComputerList(ComputerGroupItem* computer_group)
         std::unique_ptr<QTreeWidgetItem> item_deleter(ui.tree_computer->takeTopLevelItem(i));
 
     ui.tree_computer->addTopLevelItems(computer_group->ComputerList());
+    ui.tree_computer->probeComputerStatus();
 }
 
 bool AddressBookTab::saveToFile(const QString& file_path)
 {
-    std::string serialized_data = data_.SerializeAsString();
+    QString path = file_path;
+    if (path.isEmpty())
+    {
+        Settings settings;
+
+        path = QFileDialog::getSaveFileName(this,
+                                            tr("Save Address Book"),
+                                            settings.lastDirectory(),
+                                            tr("Aspia Address Book (*.aab)"));
+        if (path.isEmpty())
+            return false;
+
+        settings.setLastDirectory(QFileInfo(path).absolutePath());
+    }
+
     std::unique_ptr<base::DataCryptor> cryptor;
 
     switch (file_.encryption_type())
@@ -810,28 +826,17 @@ bool AddressBookTab::saveToFile(const QString& file_path)
             return false;
     }
 
+    std::string serialized_data = data_.SerializeAsString();
+
     std::string encrypted_data;
     CHECK(cryptor->encrypt(serialized_data, &encrypted_data));
     base::memZero(&serialized_data);
 
     file_.set_data(std::move(encrypted_data));
 
-    QString path = file_path;
-    if (path.isEmpty())
-    {
-        Settings settings;
-
-        path = QFileDialog::getSaveFileName(this,
-                                            tr("Save Address Book"),
-                                            settings.lastDirectory(),
-                                            tr("Aspia Address Book (*.aab)"));
-        if (path.isEmpty())
-            return false;
-
-        settings.setLastDirectory(QFileInfo(path).absolutePath());
-    }
-
-    QFile file(path);
+    // The new contents are written to a temporary file which replaces the address book only when
+    // it is completely written. A failed or interrupted save does not damage the existing book.
+    QSaveFile file(path);
     if (!file.open(QIODevice::WriteOnly))
     {
         showSaveError(this, tr("Unable to create or open address book file."));
@@ -845,7 +850,7 @@ bool AddressBookTab::saveToFile(const QString& file_path)
 
     base::memZero(buffer.data(), buffer.size());
 
-    if (bytes_written != static_cast<int64_t>(buffer.size()))
+    if (bytes_written != static_cast<int64_t>(buffer.size()) || !file.commit())
     {
         showSaveError(this, tr("Unable to write address book file."));
         return false;
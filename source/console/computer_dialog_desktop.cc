@@ -30,6 +30,9 @@ void ComputerDialogDesktop::restoreSettings(
     proto::SessionType session_type, const proto::DesktopConfig& config)
 {
     QComboBox* combo_codec = ui.combo_codec;
+#if defined(USE_AV1)
+    combo_codec->addItem(QStringLiteral("AV1"), proto::VIDEO_ENCODING_AV1);
+#endif // defined(USE_AV1)
     combo_codec->addItem(QStringLiteral("VP9"), proto::VIDEO_ENCODING_VP9);
     combo_codec->addItem(QStringLiteral("VP8"), proto::VIDEO_ENCODING_VP8);
 
@@ -21,6 +21,7 @@
 #include "base/net/address.h"
 #include "base/strings/unicode.h"
 #include "console/computer_group_item.h"
+#include "console/computer_tree.h"
 
 #include <QDateTime>
 
@@ -32,45 +33,90 @@ ComputerItem::ComputerItem(proto::address_book::Computer* computer,
       parent_group_item_(parent_group_item)
 {
     setIcon(0, QIcon(":/img/computer.png"));
-    updateItem();
 }
 
 void ComputerItem::updateItem()
 {
-    QString address_title = QString::fromStdString(computer_->address());
-    bool host_id_entered = true;
+    ready_columns_ = 0;
+    emitDataChanged();
+}
 
-    for (int i = 0; i < address_title.length(); ++i)
+QVariant ComputerItem::data(int column, int role) const
+{
+    if (role == Qt::DecorationRole || role == Qt::ForegroundRole)
     {
-        if (!address_title[i].isDigit())
+        ComputerTree* tree = dynamic_cast<ComputerTree*>(treeWidget());
+        if (tree && tree->computerStatus(*computer_) == ComputerTree::ComputerStatus::OFFLINE)
         {
-            host_id_entered = false;
-            break;
+            if (role == Qt::ForegroundRole)
+                return tree->palette().brush(QPalette::Disabled, QPalette::Text);
+
+            if (column == COLUMN_INDEX_NAME)
+            {
+                static const QIcon offline_icon(":/img/plug-disconnect.png");
+                return offline_icon;
+            }
         }
     }
 
-    if (!host_id_entered)
-    {
-        base::Address address(DEFAULT_HOST_TCP_PORT);
-        address.setHost(base::utf16FromUtf8(computer_->address()));
-        address.setPort(computer_->port());
+    if (role != Qt::DisplayRole || column < 0 || column >= COLUMN_COUNT)
+        return QTreeWidgetItem::data(column, role);
 
-        address_title = QString::fromStdU16String(address.toString());
+    const uint32_t column_bit = 1U << column;
+    if (!(ready_columns_ & column_bit))
+    {
+        texts_[column] = columnText(column);
+        ready_columns_ |= column_bit;
     }
 
-    setText(COLUMN_INDEX_NAME, QString::fromStdString(computer_->name()));
-    setText(COLUMN_INDEX_ADDRESS, address_title);
-    setText(COLUMN_INDEX_COMMENT, QString::fromStdString(computer_->comment()).replace('\n', ' '));
+    return texts_[column];
+}
 
-    QLocale system_locale = QLocale::system();
+QString ComputerItem::columnText(int column) const
+{
+    switch (column)
+    {
+        case COLUMN_INDEX_NAME:
+            return QString::fromStdString(computer_->name());
 
-    QString create_time = system_locale.toString(
-        QDateTime::fromSecsSinceEpoch(computer_->create_time()), QLocale::ShortFormat);
-    setText(COLUMN_INDEX_CREATED, create_time);
+        case COLUMN_INDEX_ADDRESS:
+        {
+            QString address_title = QString::fromStdString(computer_->address());
+            bool host_id_entered = true;
+
+            for (int i = 0; i < address_title.length(); ++i)
+            {
+                if (!address_title[i].isDigit())
+                {
+                    host_id_entered = false;
+                    break;
+                }
+            }
+
+            if (host_id_entered)
+                return address_title;
+
+            base::Address address(DEFAULT_HOST_TCP_PORT);
+            address.setHost(base::utf16FromUtf8(computer_->address()));
+            address.setPort(computer_->port());
+
+            return QString::fromStdU16String(address.toString());
+        }
+
+        case COLUMN_INDEX_COMMENT:
+            return QString::fromStdString(computer_->comment()).replace('\n', ' ');
+
+        case COLUMN_INDEX_CREATED:
+            return QLocale::system().toString(
+                QDateTime::fromSecsSinceEpoch(computer_->create_time()), QLocale::ShortFormat);
 
-    QString modify_time = system_locale.toString(
-        QDateTime::fromSecsSinceEpoch(computer_->modify_time()), QLocale::ShortFormat);
-    setText(COLUMN_INDEX_MODIFIED, modify_time);
+        case COLUMN_INDEX_MODIFIED:
+            return QLocale::system().toString(
+                QDateTime::fromSecsSinceEpoch(computer_->modify_time()), QLocale::ShortFormat);
+
+        default:
+            return QString();
+    }
 }
 
 ComputerGroupItem* ComputerItem::parentComputerGroupItem()
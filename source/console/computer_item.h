@@ -34,6 +34,7 @@ public:
     ComputerItem(proto::address_book::Computer* computer, ComputerGroupItem* parent_group_item);
     ~ComputerItem() = default;
 
+    // Must be called after the computer has been changed.
     void updateItem();
 
     enum ColumnIndex
@@ -42,7 +43,8 @@ public:
         COLUMN_INDEX_ADDRESS   = 1,
         COLUMN_INDEX_COMMENT   = 2,
         COLUMN_INDEX_CREATED   = 3,
-        COLUMN_INDEX_MODIFIED  = 4
+        COLUMN_INDEX_MODIFIED  = 4,
+        COLUMN_COUNT           = 5
     };
 
     proto::address_book::Computer* computer() { return computer_; }
@@ -50,13 +52,21 @@ public:
 
     // QTreeWidgetItem implementation.
     bool operator<(const QTreeWidgetItem &other) const override;
+    QVariant data(int column, int role) const override;
 
 private:
     friend class ComputerGroupItem;
 
+    QString columnText(int column) const;
+
     proto::address_book::Computer* computer_;
     ComputerGroupItem* parent_group_item_;
 
+    // A group may contain tens of thousands of computers. The text of a column is formatted only
+    // when the view needs it (for a visible row or for sorting by the column).
+    mutable QString texts_[COLUMN_COUNT];
+    mutable uint32_t ready_columns_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(ComputerItem);
 };
 
@@ -0,0 +1,242 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "console/computer_status_prober.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+
+#include <asio/connect.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/steady_timer.hpp>
+
+namespace console {
+
+namespace {
+
+// The number of connections opened at the same time. A large address book is still checked in
+// seconds, and the console does not flood the network (or the firewall) with connection attempts.
+const size_t kMaxConcurrentProbes = 32;
+
+// A host that did not accept the connection during this time is considered offline.
+const std::chrono::seconds kProbeTimeout{ 5 };
+
+} // namespace
+
+class ComputerStatusProber::Probe : public std::enable_shared_from_this<Probe>
+{
+public:
+    Probe(asio::io_context& io_context,
+          std::weak_ptr<ComputerStatusProber> prober,
+          uint64_t generation,
+          const Target& target)
+        : prober_(std::move(prober)),
+          generation_(generation),
+          target_(target),
+          resolver_(io_context),
+          socket_(io_context),
+          timer_(io_context)
+    {
+        // Nothing
+    }
+
+    ~Probe() = default;
+
+    uint64_t generation() const { return generation_; }
+    const Target& target() const { return target_; }
+
+    void start()
+    {
+        // Each handler keeps the probe alive. The resolver may complete the operation after it
+        // was canceled.
+        timer_.expires_after(kProbeTimeout);
+        timer_.async_wait([self = shared_from_this()](const std::error_code& error_code)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            self->finish(false);
+        });
+
+        resolver_.async_resolve(base::local8BitFromUtf16(target_.address),
+                                std::to_string(target_.port),
+            [self = shared_from_this()](const std::error_code& error_code,
+                                        const asio::ip::tcp::resolver::results_type& endpoints)
+        {
+            if (self->finished_)
+                return;
+
+            if (error_code)
+            {
+                self->finish(false);
+                return;
+            }
+
+            asio::async_connect(self->socket_, endpoints,
+                [self](const std::error_code& error_code,
+                       const asio::ip::tcp::endpoint& /* endpoint */)
+            {
+                self->finish(!error_code);
+            });
+        });
+    }
+
+private:
+    void finish(bool online)
+    {
+        if (finished_)
+            return;
+
+        finished_ = true;
+
+        timer_.cancel();
+        resolver_.cancel();
+
+        std::error_code ignored_code;
+        socket_.close(ignored_code);
+
+        std::shared_ptr<ComputerStatusProber> prober = prober_.lock();
+        if (prober)
+            prober->onProbeFinished(this, online);
+    }
+
+    std::weak_ptr<ComputerStatusProber> prober_;
+    const uint64_t generation_;
+    const Target target_;
+
+    asio::ip::tcp::resolver resolver_;
+    asio::ip::tcp::socket socket_;
+    asio::steady_timer timer_;
+    bool finished_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(Probe);
+};
+
+ComputerStatusProber::ComputerStatusProber(std::shared_ptr<base::TaskRunner> io_task_runner,
+                                           std::shared_ptr<base::TaskRunner> ui_task_runner,
+                                           Delegate* delegate)
+    : io_task_runner_(std::move(io_task_runner)),
+      ui_task_runner_(std::move(ui_task_runner)),
+      delegate_(delegate)
+{
+    DCHECK(io_task_runner_ && ui_task_runner_ && delegate_);
+}
+
+ComputerStatusProber::~ComputerStatusProber()
+{
+    DCHECK(!delegate_);
+}
+
+void ComputerStatusProber::dettach()
+{
+    DCHECK(ui_task_runner_->belongsToCurrentThread());
+
+    delegate_ = nullptr;
+    stop();
+}
+
+void ComputerStatusProber::start(std::vector<Target>&& targets)
+{
+    DCHECK(ui_task_runner_->belongsToCurrentThread());
+
+    const uint64_t generation = ++ui_generation_;
+
+    io_task_runner_->postTask(std::bind(&ComputerStatusProber::startOnIoThread,
+                                        shared_from_this(),
+                                        generation,
+                                        std::move(targets)));
+}
+
+void ComputerStatusProber::stop()
+{
+    start(std::vector<Target>());
+}
+
+void ComputerStatusProber::startOnIoThread(uint64_t generation, std::vector<Target> targets)
+{
+    DCHECK(io_task_runner_->belongsToCurrentThread());
+
+    if (generation <= io_generation_)
+        return;
+
+    io_generation_ = generation;
+
+    // Probes in progress are left to finish, but their results are dropped by the UI thread.
+    pending_ = std::move(targets);
+    next_target_ = 0;
+
+    if (!pending_.empty())
+        LOG(LS_INFO) << "Probing status of " << pending_.size() << " computers";
+
+    startNextProbes();
+}
+
+void ComputerStatusProber::startNextProbes()
+{
+    asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+    while (probes_.size() < kMaxConcurrentProbes && next_target_ < pending_.size())
+    {
+        std::shared_ptr<Probe> probe = std::make_shared<Probe>(
+            io_context, weak_from_this(), io_generation_, pending_[next_target_]);
+        ++next_target_;
+
+        probes_.emplace_back(probe);
+        probe->start();
+    }
+
+    if (next_target_ >= pending_.size())
+    {
+        pending_.clear();
+        next_target_ = 0;
+    }
+}
+
+void ComputerStatusProber::onProbeFinished(Probe* probe, bool online)
+{
+    DCHECK(io_task_runner_->belongsToCurrentThread());
+
+    for (auto it = probes_.begin(); it != probes_.end(); ++it)
+    {
+        if (it->get() != probe)
+            continue;
+
+        notifyStatus(probe->generation(), probe->target(), online);
+        probes_.erase(it);
+        break;
+    }
+
+    startNextProbes();
+}
+
+void ComputerStatusProber::notifyStatus(uint64_t generation, const Target& target, bool online)
+{
+    ui_task_runner_->postTask(
+        [self = shared_from_this(), generation, target, online]()
+    {
+        if (!self->delegate_ || generation != self->ui_generation_)
+            return;
+
+        self->delegate_->onComputerStatus(target.address, target.port, online);
+    });
+}
+
+} // namespace console
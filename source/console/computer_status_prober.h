@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSOLE__COMPUTER_STATUS_PROBER_H
+#define CONSOLE__COMPUTER_STATUS_PROBER_H
+
+#include "base/macros_magic.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace console {
+
+// Checks which computers are reachable. For each computer a TCP connection to its address is
+// opened and closed at once, no data is sent. Probes run on the IO thread, at most
+// |kMaxConcurrentProbes| at a time, and each result is delivered to the UI thread as soon as it
+// is known.
+class ComputerStatusProber : public std::enable_shared_from_this<ComputerStatusProber>
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onComputerStatus(const std::u16string& address, uint16_t port,
+                                      bool online) = 0;
+    };
+
+    struct Target
+    {
+        std::u16string address;
+        uint16_t port;
+    };
+
+    ComputerStatusProber(std::shared_ptr<base::TaskRunner> io_task_runner,
+                         std::shared_ptr<base::TaskRunner> ui_task_runner,
+                         Delegate* delegate);
+    ~ComputerStatusProber();
+
+    // Must be called on the UI thread before the delegate is destroyed.
+    void dettach();
+
+    // Cancels the previous probing and starts probing of |targets|. Must be called on the UI
+    // thread.
+    void start(std::vector<Target>&& targets);
+
+    // Cancels the probing. Results that are not yet delivered are dropped.
+    void stop();
+
+private:
+    class Probe;
+
+    void startOnIoThread(uint64_t generation, std::vector<Target> targets);
+    void startNextProbes();
+    void onProbeFinished(Probe* probe, bool online);
+    void notifyStatus(uint64_t generation, const Target& target, bool online);
+
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    std::shared_ptr<base::TaskRunner> ui_task_runner_;
+
+    // Accessed only on the UI thread.
+    Delegate* delegate_;
+    uint64_t ui_generation_ = 0;
+
+    // Accessed only on the IO thread.
+    uint64_t io_generation_ = 0;
+    std::vector<Target> pending_;
+    size_t next_target_ = 0;
+    std::vector<std::shared_ptr<Probe>> probes_;
+
+    DISALLOW_COPY_AND_ASSIGN(ComputerStatusProber);
+};
+
+} // namespace console
+
+#endif // CONSOLE__COMPUTER_STATUS_PROBER_H
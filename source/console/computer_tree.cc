@@ -20,10 +20,16 @@
 #include "console/computer_drag.h"
 #include "console/computer_item.h"
 
+#include "base/peer/host_id.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+#include "qt_base/application.h"
+
 #include <QApplication>
 #include <QHeaderView>
 #include <QMenu>
 #include <QMouseEvent>
+#include <QTimer>
 #include <QUuid>
 
 namespace console {
@@ -53,10 +59,89 @@ ComputerTree::ComputerTree(QWidget* parent)
     : QTreeWidget(parent),
       mime_type_(QString("application/%1").arg(QUuid::createUuid().toString()))
 {
+    // All rows have one line of text. The view does not have to measure each of the (possibly tens
+    // of thousands) rows to lay them out.
+    setUniformRowHeights(true);
+
     header()->setContextMenuPolicy(Qt::CustomContextMenu);
 
     connect(header(), &QHeaderView::customContextMenuRequested,
             this, &ComputerTree::onHeaderContextMenu);
+
+    status_update_timer_ = new QTimer(this);
+    status_update_timer_->setSingleShot(true);
+    status_update_timer_->setInterval(250);
+
+    connect(status_update_timer_, &QTimer::timeout, this, [this]()
+    {
+        viewport()->update();
+    });
+
+    std::shared_ptr<base::TaskRunner> io_task_runner = qt_base::Application::ioTaskRunner();
+    std::shared_ptr<base::TaskRunner> ui_task_runner = qt_base::Application::uiTaskRunner();
+
+    if (io_task_runner && ui_task_runner)
+    {
+        status_prober_ = std::make_shared<ComputerStatusProber>(
+            std::move(io_task_runner), std::move(ui_task_runner), this);
+    }
+}
+
+ComputerTree::~ComputerTree()
+{
+    if (status_prober_)
+        status_prober_->dettach();
+}
+
+void ComputerTree::probeComputerStatus()
+{
+    if (!status_prober_)
+        return;
+
+    std::vector<ComputerStatusProber::Target> targets;
+    targets.reserve(topLevelItemCount());
+
+    for (int i = 0; i < topLevelItemCount(); ++i)
+    {
+        ComputerItem* item = static_cast<ComputerItem*>(topLevelItem(i));
+        const proto::address_book::Computer* computer = item->computer();
+
+        if (computer->address().empty() || base::isHostId(computer->address()))
+            continue;
+
+        uint16_t port = static_cast<uint16_t>(computer->port());
+        if (!port)
+            port = DEFAULT_HOST_TCP_PORT;
+
+        targets.push_back({ base::utf16FromUtf8(computer->address()), port });
+    }
+
+    status_prober_->start(std::move(targets));
+}
+
+ComputerTree::ComputerStatus ComputerTree::computerStatus(
+    const proto::address_book::Computer& computer) const
+{
+    if (statuses_.isEmpty())
+        return ComputerStatus::UNKNOWN;
+
+    uint16_t port = static_cast<uint16_t>(computer.port());
+    if (!port)
+        port = DEFAULT_HOST_TCP_PORT;
+
+    auto result = statuses_.constFind(statusKey(base::utf16FromUtf8(computer.address()), port));
+    if (result == statuses_.constEnd())
+        return ComputerStatus::UNKNOWN;
+
+    return result.value() ? ComputerStatus::ONLINE : ComputerStatus::OFFLINE;
+}
+
+void ComputerTree::onComputerStatus(const std::u16string& address, uint16_t port, bool online)
+{
+    statuses_.insert(statusKey(address, port), online);
+
+    if (!status_update_timer_->isActive())
+        status_update_timer_->start();
 }
 
 void ComputerTree::mousePressEvent(QMouseEvent* event)
@@ -134,4 +219,10 @@ void ComputerTree::onHeaderContextMenu(const QPoint& pos)
     header()->setSectionHidden(action->columnIndex(), !action->isChecked());
 }
 
+// static
+QString ComputerTree::statusKey(const std::u16string& address, uint16_t port)
+{
+    return QString("%1:%2").arg(QString::fromStdU16String(address)).arg(port);
+}
+
 } // namespace console
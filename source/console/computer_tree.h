@@ -20,21 +20,37 @@
 #define CONSOLE__COMPUTER_TREE_H
 
 #include "base/macros_magic.h"
+#include "console/computer_status_prober.h"
+#include "proto/address_book.pb.h"
 
+#include <QHash>
 #include <QTreeWidget>
 
+class QTimer;
+
 namespace console {
 
-class ComputerTree : public QTreeWidget
+class ComputerTree
+    : public QTreeWidget,
+      public ComputerStatusProber::Delegate
 {
     Q_OBJECT
 
 public:
     explicit ComputerTree(QWidget* parent = nullptr);
-    ~ComputerTree() = default;
+    ~ComputerTree();
 
     QString mimeType() const { return mime_type_; }
 
+    enum class ComputerStatus { UNKNOWN, ONLINE, OFFLINE };
+
+    // Starts checking which of the computers in the list are reachable. The rows are updated as
+    // the results arrive. Computers connected through a router are not checked.
+    void probeComputerStatus();
+
+    // Returns the last known status of the computer.
+    ComputerStatus computerStatus(const proto::address_book::Computer& computer) const;
+
 protected:
     // QTreeWidget implementation.
     void mousePressEvent(QMouseEvent* event) override;
@@ -44,13 +60,27 @@ protected:
     void dropEvent(QDropEvent* event) override;
     void startDrag(Qt::DropActions supported_actions) override;
 
+    // ComputerStatusProber::Delegate implementation.
+    void onComputerStatus(const std::u16string& address, uint16_t port, bool online) override;
+
 private slots:
     void onHeaderContextMenu(const QPoint& pos);
 
 private:
+    static QString statusKey(const std::u16string& address, uint16_t port);
+
     QPoint start_pos_;
     QString mime_type_;
 
+    std::shared_ptr<ComputerStatusProber> status_prober_;
+
+    // The statuses are kept by address for all groups. When a group is selected again, the
+    // previous results are shown until the new ones arrive.
+    QHash<QString, bool> statuses_;
+
+    // Many results may arrive at once. The view is repainted once for all of them.
+    QTimer* status_update_timer_;
+
     DISALLOW_COPY_AND_ASSIGN(ComputerTree);
 };
 
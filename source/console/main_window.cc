@@ -29,6 +29,7 @@
 #include "console/address_book_tab.h"
 #include "console/application.h"
 #include "console/fast_connect_dialog.h"
+#include "console/monitoring_wall_window.h"
 #include "console/mru_action.h"
 #include "console/update_settings_dialog.h"
 #include "common/ui/update_dialog.h"
@@ -110,6 +111,7 @@ MainWindow::MainWindow(const QString& file_path)
     connect(ui.action_exit, &QAction::triggered, this, &MainWindow::close);
     connect(ui.action_fast_connect, &QAction::triggered, this, &MainWindow::onFastConnect);
     connect(ui.action_router_manage, &QAction::triggered, this, &MainWindow::connectToRouter);
+    connect(ui.action_monitoring_wall, &QAction::triggered, this, &MainWindow::onMonitoringWall);
 
     connect(ui.action_desktop_manage_connect, &QAction::triggered,
             this, &MainWindow::onDesktopManageConnect);
@@ -481,6 +483,44 @@ void MainWindow::onFileTransferConnect()
     }
 }
 
+void MainWindow::onMonitoringWall()
+{
+    AddressBookTab* tab = currentAddressBookTab();
+    if (!tab)
+        return;
+
+    proto::address_book::ComputerGroup* computer_group = tab->currentComputerGroup();
+    if (!computer_group)
+        return;
+
+    if (computer_group->computer_size() == 0)
+    {
+        QMessageBox::information(this,
+                                 tr("Monitoring Wall"),
+                                 tr("There are no computers in the selected group."),
+                                 QMessageBox::Ok);
+        return;
+    }
+
+    MonitoringWallWindow* wall = new MonitoringWallWindow(*computer_group, tab->routerConfig());
+    wall->setAttribute(Qt::WA_DeleteOnClose);
+
+    connect(wall, &MonitoringWallWindow::fullSessionRequested, this,
+            [this](const proto::address_book::Computer& computer,
+                   const std::optional<client::RouterConfig>& router_config)
+    {
+        // A tile of the wall always opens a desktop session.
+        proto::address_book::Computer desktop_computer = computer;
+        if (desktop_computer.session_type() != proto::SESSION_TYPE_DESKTOP_VIEW)
+            desktop_computer.set_session_type(proto::SESSION_TYPE_DESKTOP_MANAGE);
+
+        connectToComputer(desktop_computer, router_config);
+    });
+
+    wall->show();
+    wall->activateWindow();
+}
+
 void MainWindow::onCurrentTabChanged(int index)
 {
     if (index == -1)
@@ -490,6 +530,7 @@ void MainWindow::onCurrentTabChanged(int index)
         ui.action_add_computer->setEnabled(false);
         ui.action_fast_connect->setEnabled(false);
         ui.action_router_manage->setEnabled(false);
+        ui.action_monitoring_wall->setEnabled(false);
         return;
     }
 
@@ -589,6 +630,7 @@ void MainWindow::onComputerGroupActivated(bool activated, bool is_root)
 {
     ui.action_add_computer_group->setEnabled(activated);
     ui.action_add_computer->setEnabled(activated);
+    ui.action_monitoring_wall->setEnabled(activated);
 
     ui.action_copy_computer->setEnabled(false);
     ui.action_modify_computer->setEnabled(false);
@@ -75,6 +75,7 @@ private slots:
     void onDesktopManageConnect();
     void onDesktopViewConnect();
     void onFileTransferConnect();
+    void onMonitoringWall();
 
     void onCurrentTabChanged(int index);
     void onCloseTab(int index);
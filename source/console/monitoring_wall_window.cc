@@ -0,0 +1,168 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "console/monitoring_wall_window.h"
+
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+#include "client/ui/qt_thumbnail_window.h"
+
+#include <QCloseEvent>
+#include <QGridLayout>
+#include <QTimer>
+
+#include <cmath>
+
+namespace console {
+
+namespace {
+
+// A tile whose session has finished connects again after this time (in milliseconds).
+const int kReconnectInterval = 30000;
+
+// The initial size of a tile: a thumbnail of a wide screen with the caption.
+const QSize kTileSize(320, 200);
+const int kMaxInitialColumns = 4;
+
+bool isHostId(const std::string& address)
+{
+    if (address.empty())
+        return false;
+
+    for (char ch : address)
+    {
+        if (ch < '0' || ch > '9')
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+MonitoringWallWindow::MonitoringWallWindow(
+    const proto::address_book::ComputerGroup& computer_group,
+    const std::optional<client::RouterConfig>& router_config,
+    QWidget* parent)
+    : QWidget(parent),
+      computers_(computer_group.computer().begin(), computer_group.computer().end()),
+      router_config_(router_config)
+{
+    setWindowTitle(tr("Monitoring Wall - %1")
+                   .arg(QString::fromStdString(computer_group.name())));
+
+    layout_ = new QGridLayout(this);
+    layout_->setContentsMargins(2, 2, 2, 2);
+    layout_->setSpacing(2);
+
+    columns_ = std::max(
+        static_cast<int>(std::ceil(std::sqrt(static_cast<double>(computers_.size())))), 1);
+    const int rows = std::max((static_cast<int>(computers_.size()) + columns_ - 1) / columns_, 1);
+
+    LOG(LS_INFO) << "Monitoring wall of " << computers_.size() << " computers ("
+                 << columns_ << "x" << rows << ")";
+
+    tiles_.resize(computers_.size(), nullptr);
+    for (size_t i = 0; i < computers_.size(); ++i)
+        startTile(i);
+
+    resize(kTileSize.width() * std::min(columns_, kMaxInitialColumns),
+           kTileSize.height() * std::min(rows, kMaxInitialColumns));
+}
+
+MonitoringWallWindow::~MonitoringWallWindow() = default;
+
+void MonitoringWallWindow::closeEvent(QCloseEvent* event)
+{
+    // The sessions of the tiles are stopped when the tiles are closed.
+    for (const auto& tile : tiles_)
+    {
+        if (tile)
+            tile->close();
+    }
+
+    QWidget::closeEvent(event);
+}
+
+void MonitoringWallWindow::startTile(size_t index)
+{
+    DCHECK_LT(index, computers_.size());
+
+    const proto::address_book::Computer& computer = computers_[index];
+
+    client::QtThumbnailWindow* tile =
+        new client::QtThumbnailWindow(QString::fromStdString(computer.name()), this);
+
+    client::QtThumbnailWindow* previous_tile = tiles_[index];
+    if (previous_tile)
+    {
+        layout_->removeWidget(previous_tile);
+        previous_tile->close();
+        previous_tile->deleteLater();
+    }
+
+    tiles_[index] = tile;
+    layout_->addWidget(
+        tile, static_cast<int>(index) / columns_, static_cast<int>(index) % columns_);
+
+    connect(tile, &client::QtThumbnailWindow::fullSessionRequested, this, [this, index]()
+    {
+        emit fullSessionRequested(computers_[index], router_config_);
+    });
+
+    connect(tile, &client::QtThumbnailWindow::sessionFinished, this, [this, index]()
+    {
+        onSessionFinished(index);
+    });
+
+    // The wall does not ask for the credentials of each computer.
+    if (computer.username().empty() || computer.password().empty())
+    {
+        tile->setStatus(tr("The user name or password is not specified."));
+        return;
+    }
+
+    if (isHostId(computer.address()) && !router_config_.has_value())
+    {
+        tile->setStatus(tr("Connection by ID is specified, but the router is not configured."));
+        return;
+    }
+
+    client::Config config;
+    config.router_config = router_config_;
+    config.computer_name = base::utf16FromUtf8(computer.name());
+    config.address_or_id = base::utf16FromUtf8(computer.address());
+    config.port          = computer.port();
+    config.username      = base::utf16FromUtf8(computer.username());
+    config.password      = base::utf16FromUtf8(computer.password());
+    config.session_type  = proto::SESSION_TYPE_DESKTOP_VIEW;
+
+    if (!tile->connectToHost(config))
+        tile->setStatus(tr("Unable to connect."));
+}
+
+void MonitoringWallWindow::onSessionFinished(size_t index)
+{
+    // The timer is cancelled if the tile is destroyed before.
+    QTimer::singleShot(kReconnectInterval, tiles_[index], [this, index]()
+    {
+        startTile(index);
+    });
+}
+
+} // namespace console
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSOLE__MONITORING_WALL_WINDOW_H
+#define CONSOLE__MONITORING_WALL_WINDOW_H
+
+#include "base/macros_magic.h"
+#include "client/client_config.h"
+#include "proto/address_book.pb.h"
+
+#include <QWidget>
+
+#include <optional>
+#include <vector>
+
+class QGridLayout;
+
+namespace client {
+class QtThumbnailWindow;
+} // namespace client
+
+namespace console {
+
+// Shows the desktops of the computers of a group in a grid. Each tile is a thumbnail session (see
+// client::QtThumbnailWindow), so a wall of many hosts costs only small videos at 1 fps on both
+// sides. A tile whose connection is lost reconnects after a while. A double click on a tile opens
+// the full session with the computer.
+class MonitoringWallWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    MonitoringWallWindow(const proto::address_book::ComputerGroup& computer_group,
+                         const std::optional<client::RouterConfig>& router_config,
+                         QWidget* parent = nullptr);
+    ~MonitoringWallWindow();
+
+signals:
+    void fullSessionRequested(const proto::address_book::Computer& computer,
+                              const std::optional<client::RouterConfig>& router_config);
+
+protected:
+    // QWidget implementation.
+    void closeEvent(QCloseEvent* event) override;
+
+private:
+    void startTile(size_t index);
+    void onSessionFinished(size_t index);
+
+    std::vector<proto::address_book::Computer> computers_;
+    std::optional<client::RouterConfig> router_config_;
+
+    QGridLayout* layout_;
+    int columns_ = 1;
+    std::vector<client::QtThumbnailWindow*> tiles_;
+
+    DISALLOW_COPY_AND_ASSIGN(MonitoringWallWindow);
+};
+
+} // namespace console
+
+#endif // CONSOLE__MONITORING_WALL_WINDOW_H
@@ -22,20 +22,56 @@
 #include "base/net/network_channel_proxy.h"
 #include "host/client_session_desktop.h"
 #include "host/client_session_file_transfer.h"
+#include "proto/key_exchange.pb.h"
+
+#include <algorithm>
 
 namespace host {
 
+namespace {
+
+uint32_t nextSessionId()
+{
+    // All sessions are executed in one thread. We can safely use a global counter to get session IDs.
+    // Session IDs must start with 1.
+    static uint32_t id_counter = 0;
+    return ++id_counter;
+}
+
+} // namespace
+
 ClientSession::ClientSession(
     proto::SessionType session_type, std::unique_ptr<base::NetworkChannel> channel)
-    : session_type_(session_type),
+    : id_(nextSessionId()),
+      session_type_(session_type),
       channel_(std::move(channel))
 {
     DCHECK(channel_);
+}
 
-    // All sessions are executed in one thread. We can safely use a global counter to get session IDs.
-    // Session IDs must start with 1.
-    static uint32_t id_counter = 0;
-    id_ = ++id_counter;
+ClientSession::ClientSession(
+    proto::SessionType session_type, ClientSession* parent, uint8_t stream_id)
+    : id_(nextSessionId()),
+      session_type_(session_type),
+      parent_(parent),
+      stream_id_(stream_id)
+{
+    DCHECK(parent_);
+    DCHECK(stream_id_);
+
+    parent_->stream_sessions_.emplace_back(this);
+}
+
+ClientSession::~ClientSession()
+{
+    if (parent_)
+    {
+        parent_->channel_->closeStream(stream_id_);
+        detachFromParent();
+    }
+
+    for (ClientSession* stream_session : stream_sessions_)
+        stream_session->parent_ = nullptr;
 }
 
 // static
@@ -73,8 +109,20 @@ void ClientSession::start(Delegate* delegate)
     delegate_ = delegate;
     DCHECK(delegate_);
 
+    if (parent_)
+    {
+        // The channel of the parent is already set up, the session only gets the messages of its
+        // stream.
+        parent_->channel_->setStreamListener(stream_id_, this);
+        onStarted();
+        return;
+    }
+
     channel_->setListener(this);
 
+    // The client can open other sessions in the streams of the channel.
+    channel_->setStreamAcceptor(this);
+
     if (version_ >= base::Version(2, 0, 0))
     {
         // Versions 2.0.0+ support their own implementation keep alive.
@@ -92,7 +140,15 @@ void ClientSession::start(Delegate* delegate)
 
 void ClientSession::stop()
 {
+    if (parent_)
+    {
+        // The other sessions in the channel continue to work.
+        parent_->channel_->closeStream(stream_id_);
+        detachFromParent();
+    }
+
     state_ = State::FINISHED;
+    finishStreamSessions();
     delegate_->onClientSessionFinished();
 }
 
@@ -121,14 +177,60 @@ void ClientSession::setSessionId(base::SessionId session_id)
     session_id_ = session_id;
 }
 
+void ClientSession::setSessionTypes(uint32_t session_types)
+{
+    session_types_ = session_types;
+}
+
+size_t ClientSession::pendingMessages() const
+{
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
+        return 0;
+
+    return network_channel->pendingMessages();
+}
+
+size_t ClientSession::socketPendingBytes()
+{
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
+        return 0;
+
+    return network_channel->socketPendingBytes();
+}
+
+int ClientSession::speedTx()
+{
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
+        return 0;
+
+    return network_channel->speedTx();
+}
+
 std::shared_ptr<base::NetworkChannelProxy> ClientSession::channelProxy()
 {
-    return channel_->channelProxy();
+    base::NetworkChannel* network_channel = channel();
+    if (!network_channel)
+        return nullptr;
+
+    return network_channel->channelProxy();
+}
+
+void ClientSession::setNotSentLowWatermark(size_t bytes)
+{
+    base::NetworkChannel* network_channel = channel();
+    if (network_channel)
+        network_channel->setNotSentLowWatermark(bytes);
 }
 
-void ClientSession::sendMessage(base::ByteArray&& buffer)
+void ClientSession::sendMessage(base::ByteArray&& buffer,
+                                base::NetworkChannel::Priority priority)
 {
-    channel_->send(std::move(buffer));
+    base::NetworkChannel* network_channel = channel();
+    if (network_channel)
+        network_channel->sendToStream(stream_id_, std::move(buffer), priority);
 }
 
 void ClientSession::onConnected()
@@ -142,7 +244,111 @@ void ClientSession::onDisconnected(base::NetworkChannel::ErrorCode error_code)
                     << base::NetworkChannel::errorToString(error_code);
 
     state_ = State::FINISHED;
+    finishStreamSessions();
     delegate_->onClientSessionFinished();
 }
 
+void ClientSession::onStreamMessageReceived(uint8_t stream_id, const base::ByteArray& buffer)
+{
+    if (parent_)
+    {
+        // The session works in the stream, the message belongs to it.
+        DCHECK_EQ(stream_id, stream_id_);
+        onMessageReceived(buffer);
+        return;
+    }
+
+    // The first message of a new stream.
+    acceptStream(stream_id, buffer);
+}
+
+void ClientSession::onStreamClosed(uint8_t stream_id)
+{
+    if (!parent_)
+        return;
+
+    DCHECK_EQ(stream_id, stream_id_);
+    LOG(LS_INFO) << "Stream " << static_cast<int>(stream_id) << " closed by the client";
+
+    detachFromParent();
+
+    state_ = State::FINISHED;
+    delegate_->onClientSessionFinished();
+}
+
+base::NetworkChannel* ClientSession::channel() const
+{
+    if (parent_)
+        return parent_->channel_.get();
+
+    return channel_.get();
+}
+
+void ClientSession::acceptStream(uint8_t stream_id, const base::ByteArray& buffer)
+{
+    proto::StreamRequest request;
+    if (!base::parse(buffer, &request))
+    {
+        LOG(LS_ERROR) << "Invalid stream request (stream: " << static_cast<int>(stream_id) << ")";
+        channel_->closeStream(stream_id);
+        return;
+    }
+
+    const uint32_t session_type = request.session_type();
+    proto::StreamResponse response;
+
+    // Only the file transfer is opened next to another session for now. The session types are
+    // checked like at the authorization.
+    if (state_ != State::STARTED || session_type != proto::SESSION_TYPE_FILE_TRANSFER ||
+        !(session_types_ & session_type))
+    {
+        LOG(LS_WARNING) << "Session type " << session_type << " is not allowed in stream "
+                        << static_cast<int>(stream_id);
+
+        response.set_accepted(false);
+        channel_->sendToStream(stream_id, base::serialize(response));
+        channel_->closeStream(stream_id);
+        return;
+    }
+
+    LOG(LS_INFO) << "Session type " << session_type << " is opened in stream "
+                 << static_cast<int>(stream_id);
+
+    // The response is sent before the first message of the new session.
+    response.set_accepted(true);
+    channel_->sendToStream(stream_id, base::serialize(response));
+
+    std::unique_ptr<ClientSession> stream_session(
+        new ClientSessionFileTransfer(this, stream_id));
+
+    stream_session->setVersion(version_);
+    stream_session->setUserName(username_);
+    stream_session->setComputerName(computer_name_);
+    stream_session->setSessionTypes(session_types_);
+
+    delegate_->onClientSessionOpened(std::move(stream_session));
+}
+
+void ClientSession::detachFromParent()
+{
+    std::vector<ClientSession*>& list = parent_->stream_sessions_;
+    list.erase(std::remove(list.begin(), list.end(), this), list.end());
+    parent_ = nullptr;
+}
+
+void ClientSession::finishStreamSessions()
+{
+    // The sessions are destroyed by the delegate together with the session. The channel does not
+    // deliver the messages to them anymore.
+    for (ClientSession* stream_session : stream_sessions_)
+    {
+        channel_->setStreamListener(stream_session->stream_id_, nullptr);
+
+        stream_session->state_ = State::FINISHED;
+        stream_session->parent_ = nullptr;
+    }
+
+    stream_sessions_.clear();
+}
+
 } // namespace host
@@ -24,6 +24,8 @@
 #include "base/net/network_channel.h"
 #include "proto/common.pb.h"
 
+#include <vector>
+
 namespace base {
 class NetworkChannelProxy;
 } // namespace base
@@ -32,10 +34,12 @@ namespace host {
 
 class DesktopSessionProxy;
 
-class ClientSession : public base::NetworkChannel::Listener
+class ClientSession
+    : public base::NetworkChannel::Listener,
+      public base::NetworkChannel::StreamListener
 {
 public:
-    virtual ~ClientSession() = default;
+    virtual ~ClientSession();
 
     class Delegate
     {
@@ -44,6 +48,11 @@ public:
 
         virtual void onClientSessionConfigured() = 0;
         virtual void onClientSessionFinished() = 0;
+        virtual void onClientSessionVisibilityChanged() = 0;
+
+        // Called when the client opens one more session in a stream of the channel of the
+        // session (see base::NetworkChannel::sendToStream()). The new session is not started.
+        virtual void onClientSessionOpened(std::unique_ptr<ClientSession> client_session) = 0;
     };
 
     enum class State
@@ -76,23 +85,70 @@ public:
     void setSessionId(base::SessionId session_id);
     base::SessionId sessionId() const { return session_id_; }
 
+    // Sets the session types which are allowed for the user. The client can open the sessions of
+    // these types in the streams of the channel.
+    void setSessionTypes(uint32_t session_types);
+
+    // Returns the stream of the channel of the parent session in which the session works or 0 if
+    // the session has its own channel.
+    uint8_t streamId() const { return stream_id_; }
+
+    // Returns the number of messages waiting to be sent to the client.
+    size_t pendingMessages() const;
+
+    // Returns the number of bytes in the send queue of the socket which are not sent yet.
+    size_t socketPendingBytes();
+
+    // Returns the outgoing speed of the channel in bytes per second. The speed is averaged between
+    // the calls, so the method should not be called too often.
+    int speedTx();
+
+    // The proxy allows to send messages to the client from any thread.
+    std::shared_ptr<base::NetworkChannelProxy> channelProxy();
+
 protected:
     ClientSession(proto::SessionType session_type, std::unique_ptr<base::NetworkChannel> channel);
 
+    // Creates a session which works in the stream |stream_id| of the channel of |parent|. The
+    // session is finished together with the parent.
+    ClientSession(proto::SessionType session_type, ClientSession* parent, uint8_t stream_id);
+
     // Called when the session is ready to send and receive data. When this method is called, the
     // session should start initializing (for example, making a configuration request).
     virtual void onStarted() = 0;
 
-    std::shared_ptr<base::NetworkChannelProxy> channelProxy();
-    void sendMessage(base::ByteArray&& buffer);
+    // Limits the data written to the socket but not sent yet (see
+    // base::NetworkChannel::setNotSentLowWatermark()).
+    void setNotSentLowWatermark(size_t bytes);
+
+    void sendMessage(
+        base::ByteArray&& buffer,
+        base::NetworkChannel::Priority priority = base::NetworkChannel::Priority::CONTROL);
 
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
     void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
 
+    // base::NetworkChannel::StreamListener implementation.
+    void onStreamMessageReceived(uint8_t stream_id, const base::ByteArray& buffer) override;
+    void onStreamClosed(uint8_t stream_id) override;
+
     Delegate* delegate_ = nullptr;
 
 private:
+    // Returns the channel of the session or the channel of the parent for a session in a stream.
+    // Returns nullptr if the parent is already destroyed.
+    base::NetworkChannel* channel() const;
+
+    void acceptStream(uint8_t stream_id, const base::ByteArray& buffer);
+
+    // Removes the session in a stream from the list of the parent.
+    void detachFromParent();
+
+    // Marks the sessions in the streams of the channel as finished and detaches them from the
+    // session.
+    void finishStreamSessions();
+
     base::SessionId session_id_ = base::kInvalidSessionId;
     State state_ = State::CREATED;
     uint32_t id_;
@@ -100,8 +156,16 @@ private:
     base::Version version_;
     std::string username_;
     std::string computer_name_;
+    uint32_t session_types_ = 0;
 
     std::unique_ptr<base::NetworkChannel> channel_;
+
+    // The session which owns the channel if the session works in a stream.
+    ClientSession* parent_ = nullptr;
+    const uint8_t stream_id_ = 0;
+
+    // The sessions which work in the streams of the channel.
+    std::vector<ClientSession*> stream_sessions_;
 };
 
 } // namespace host
@@ -22,23 +22,53 @@
 #include "base/power_controller.h"
 #include "base/codec/audio_encoder_opus.h"
 #include "base/codec/cursor_encoder.h"
-#include "base/codec/scale_reducer.h"
-#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_bitrate_controller.h"
+#include "base/codec/webm_file_writer.h"
 #include "base/desktop/frame.h"
 #include "base/desktop/screen_capturer.h"
+#include "base/net/network_channel_proxy.h"
+#include "base/strings/string_printf.h"
 #include "common/desktop_session_constants.h"
 #include "host/desktop_session_proxy.h"
-#include "host/system_info.h"
+#include "host/system_info_cache.h"
+#include "host/system_settings.h"
 #include "host/win/updater_launcher.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <cmath>
+
 namespace host {
 
+namespace {
+
+// How often the target bitrate of the video encoder is updated.
+const std::chrono::milliseconds kBitrateUpdateInterval{ 500 };
+
+// The input of the user marks the region of interest for this time.
+const std::chrono::seconds kMouseActivityTimeout{ 3 };
+const std::chrono::seconds kTypingActivityTimeout{ 2 };
+
+// Size of the square around the mouse cursor which is the region of interest.
+const int kCursorAreaSize = 256;
+
+// The cursor follows the mouse of the client, so its positions are not sent back to the client
+// while the client moves the mouse.
+const std::chrono::milliseconds kOwnCursorTimeout{ 500 };
+
+// In the thumbnail mode the video fits into this size and is sent once a second.
+const int kThumbnailWidth = 320;
+const int kThumbnailHeight = 180;
+const std::chrono::milliseconds kThumbnailFrameInterval{ 1000 };
+
+// The data written to the socket but not sent yet by the kernel is limited to this size.
+const size_t kNotSentLowWatermark = 16 * 1024;
+
+} // namespace
+
 ClientSessionDesktop::ClientSessionDesktop(
     proto::SessionType session_type, std::unique_ptr<base::NetworkChannel> channel)
     : ClientSession(session_type, std::move(channel)),
-      incoming_message_(std::make_unique<proto::ClientToHost>()),
-      outgoing_message_(std::make_unique<proto::HostToClient>())
+      bitrate_controller_(std::make_unique<base::VideoBitrateController>())
 {
     // Nothing
 }
@@ -54,7 +84,7 @@ void ClientSessionDesktop::setDesktopSessionProxy(
 
 void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
 {
-    incoming_message_->Clear();
+    incoming_message_.clear();
 
     if (!base::parse(buffer, incoming_message_.get()))
     {
@@ -67,27 +97,37 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
         if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
             return;
 
-        if (!scale_reducer_)
+        if (!has_video_encoder_key_)
             return;
 
         const proto::MouseEvent& mouse_event = incoming_message_->mouse_event();
 
         int pos_x = static_cast<int>(
-            static_cast<double>(mouse_event.x() * 100) / scale_reducer_->scaleFactorX());
+            static_cast<double>(mouse_event.x() * 100) / scale_factor_x_);
         int pos_y = static_cast<int>(
-            static_cast<double>(mouse_event.y() * 100) / scale_reducer_->scaleFactorY());
+            static_cast<double>(mouse_event.y() * 100) / scale_factor_y_);
 
         proto::MouseEvent out_mouse_event;
         out_mouse_event.set_mask(mouse_event.mask());
         out_mouse_event.set_x(pos_x);
         out_mouse_event.set_y(pos_y);
 
+        const base::Point mouse_pos(pos_x, pos_y);
+        if (mouse_pos != last_mouse_pos_)
+        {
+            last_mouse_pos_ = mouse_pos;
+            last_mouse_time_ = std::chrono::steady_clock::now();
+        }
+
         desktop_session_proxy_->injectMouseEvent(out_mouse_event);
     }
     else if (incoming_message_->has_key_event())
     {
         if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
+        {
+            last_key_time_ = std::chrono::steady_clock::now();
             desktop_session_proxy_->injectKeyEvent(incoming_message_->key_event());
+        }
     }
     else if (incoming_message_->has_clipboard_event())
     {
@@ -102,6 +142,14 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
     {
         readConfig(incoming_message_->config());
     }
+    else if (incoming_message_->has_video_recovery_request())
+    {
+        readVideoRecoveryRequest(incoming_message_->video_recovery_request());
+    }
+    else if (incoming_message_->has_visibility_event())
+    {
+        readVisibilityEvent(incoming_message_->visibility_event());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from client";
@@ -116,6 +164,10 @@ void ClientSessionDesktop::onMessageWritten(size_t /* pending */)
 
 void ClientSessionDesktop::onStarted()
 {
+    // The video waits in the queue of the channel, where the bitrate controller sees it, instead
+    // of the send buffer of the socket.
+    setNotSentLowWatermark(kNotSentLowWatermark);
+
     const char* extensions;
 
     // Supported extensions are different for managing and viewing the desktop.
@@ -134,78 +186,152 @@ void ClientSessionDesktop::onStarted()
 
     // Add supported extensions and video encodings.
     request->set_extensions(extensions);
-    request->set_video_encodings(common::kSupportedVideoEncodings);
+    uint32_t video_encodings = common::kSupportedVideoEncodings;
+
+    // H.264 is offered only if the encoding can be done by the video card.
+    if (!VideoEncoderGroup::isSupported(proto::VIDEO_ENCODING_H264))
+        video_encodings &= ~proto::VIDEO_ENCODING_H264;
+
+    request->set_video_encodings(video_encodings);
     request->set_audio_encodings(common::kSupportedAudioEncodings);
+    request->set_zstd_dictionaries(common::kSupportedZstdDictionaries);
+    request->set_clipboard_chunks(true);
 
     LOG(LS_INFO) << "Sending config request";
     LOG(LS_INFO) << "Supported extensions: " << request->extensions();
     LOG(LS_INFO) << "Supported video encodings: " << request->video_encodings();
     LOG(LS_INFO) << "Supported audio encodings: " << request->audio_encodings();
+    LOG(LS_INFO) << "Supported Zstd dictionaries: " << request->zstd_dictionaries();
 
     // Send the request.
     sendMessage(base::serialize(*outgoing_message_));
 }
 
-void ClientSessionDesktop::encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor)
+bool ClientSessionDesktop::videoEncoderKey(
+    const base::Size& source_size, VideoEncoderGroup::Key* key) const
 {
-    outgoing_message_->Clear();
+    if (video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN || !isVideoWanted())
+        return false;
 
-    if (frame && video_encoder_ && scale_reducer_)
+    if (thumbnail_)
     {
-        const base::Size& source_size = frame->size();
-        base::Size current_size = preferred_size_;
+        // The thumbnail keeps the aspect ratio of the screen. It needs none of the tools which
+        // keep a large video sharp.
+        const double scale = std::min(
+            std::min(static_cast<double>(kThumbnailWidth) / source_size.width(),
+                     static_cast<double>(kThumbnailHeight) / source_size.height()), 1.0);
+
+        *key = VideoEncoderGroup::Key();
+        key->encoding = video_encoding_;
+        key->size = base::Size(
+            std::max(static_cast<int32_t>(source_size.width() * scale) & ~1, 2),
+            std::max(static_cast<int32_t>(source_size.height() * scale) & ~1, 2));
+        key->frame_interval = kThumbnailFrameInterval;
+        return true;
+    }
 
-        if (current_size.width() > source_size.width() ||
-            current_size.height() > source_size.height())
-        {
-            current_size = source_size;
-        }
+    base::Size current_size = preferred_size_;
 
-        if (current_size.isEmpty())
-            current_size = source_size;
+    if (current_size.width() > source_size.width() ||
+        current_size.height() > source_size.height())
+    {
+        current_size = source_size;
+    }
 
-        const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, current_size);
-        if (!scaled_frame)
-        {
-            LOG(LS_ERROR) << "No scaled frame";
-            return;
-        }
+    if (current_size.isEmpty())
+        current_size = source_size;
+
+    key->encoding = video_encoding_;
+    key->full_chroma = full_chroma_;
+    key->lossless_refinement = lossless_refinement_;
+    key->tile_cache = tile_cache_;
+    key->copy_rect = copy_rect_;
+    key->packed_dirty_rects = packed_dirty_rects_;
+    key->multi_stream = multi_stream_;
+    key->size = current_size;
+    return true;
+}
 
-        proto::VideoPacket* packet = outgoing_message_->mutable_video_packet();
+bool ClientSessionDesktop::setVideoEncoderKey(
+    const VideoEncoderGroup::Key& key, const base::Size& source_size)
+{
+    scale_factor_x_ = static_cast<double>(key.size.width() * 100.0) /
+        static_cast<double>(source_size.width());
+    scale_factor_y_ = static_cast<double>(key.size.height() * 100.0) /
+        static_cast<double>(source_size.height());
 
-        // Encode the frame into a video packet.
-        video_encoder_->encode(scaled_frame, packet);
+    if (has_video_encoder_key_ && video_encoder_key_ == key)
+        return false;
 
-        if (packet->has_format())
-        {
-            proto::VideoPacketFormat* format = packet->mutable_format();
-
-            // In video packets that contain the format, we pass the screen capture type.
-            format->set_capturer_type(frame->capturerType());
-
-            // Real screen size.
-            proto::Size* screen_size = format->mutable_screen_size();
-            screen_size->set_width(frame->size().width());
-            screen_size->set_height(frame->size().height());
-
-            LOG(LS_INFO) << "Video packet has format";
-            LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
-                static_cast<base::ScreenCapturer::Type>(frame->capturerType()));
-            LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
-                         << screen_size->height();
-            LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
-                         << format->video_rect().height();
-        }
+    video_encoder_key_ = key;
+    has_video_encoder_key_ = true;
+    return true;
+}
+
+uint32_t ClientSessionDesktop::targetBitrate()
+{
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    if (current_time - last_bitrate_update_ >= kBitrateUpdateInterval)
+    {
+        last_bitrate_update_ = current_time;
+        bitrate_controller_->update(speedTx(), pendingMessages(), socketPendingBytes());
     }
 
-    if (cursor && cursor_encoder_)
+    return bitrate_controller_->targetBitrate();
+}
+
+void ClientSessionDesktop::addRegionOfInterest(
+    const base::Rect& active_window_rect, base::Region* region) const
+{
+    DCHECK(region);
+
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+
+    if (current_time - last_mouse_time_ < kMouseActivityTimeout)
     {
-        if (!cursor_encoder_->encode(*cursor, outgoing_message_->mutable_cursor_shape()))
-            outgoing_message_->clear_cursor_shape();
+        region->addRect(base::Rect::makeXYWH(last_mouse_pos_.x() - kCursorAreaSize / 2,
+                                             last_mouse_pos_.y() - kCursorAreaSize / 2,
+                                             kCursorAreaSize,
+                                             kCursorAreaSize));
     }
 
-    if (outgoing_message_->has_video_packet() || outgoing_message_->has_cursor_shape())
-        sendMessage(base::serialize(*outgoing_message_));
+    if (current_time - last_key_time_ < kTypingActivityTimeout && !active_window_rect.isEmpty())
+        region->addRect(active_window_rect);
+}
+
+void ClientSessionDesktop::encodeCursor(const base::MouseCursor* cursor)
+{
+    if (!cursor || !cursor_encoder_)
+        return;
+
+    outgoing_message_.clear();
+
+    if (!cursor_encoder_->encode(*cursor, outgoing_message_->mutable_cursor_shape()))
+        return;
+
+    sendMessage(base::serialize(*outgoing_message_), base::NetworkChannel::Priority::CURSOR);
+}
+
+void ClientSessionDesktop::encodeCursorPosition(const base::Point& position)
+{
+    if (!cursor_position_ || !has_video_encoder_key_)
+        return;
+
+    if (std::chrono::steady_clock::now() - last_mouse_time_ < kOwnCursorTimeout)
+        return;
+
+    // The position is sent in the coordinates of the video.
+    const base::Point video_position(
+        static_cast<int32_t>(position.x() * scale_factor_x_ / 100.0),
+        static_cast<int32_t>(position.y() * scale_factor_y_ / 100.0));
+
+    outgoing_message_.clear();
+
+    proto::CursorPosition* cursor_position = outgoing_message_->mutable_cursor_position();
+    cursor_position->set_x(video_position.x());
+    cursor_position->set_y(video_position.y());
+
+    sendMessage(base::serialize(*outgoing_message_), base::NetworkChannel::Priority::CURSOR);
 }
 
 void ClientSessionDesktop::encodeAudio(const proto::AudioPacket& audio_packet)
@@ -213,17 +339,70 @@ void ClientSessionDesktop::encodeAudio(const proto::AudioPacket& audio_packet)
     if (!audio_encoder_)
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     if (!audio_encoder_->encode(audio_packet, outgoing_message_->mutable_audio_packet()))
         return;
 
+    if (recorder_)
+        recorder_->addAudioPacket(outgoing_message_->audio_packet());
+
+    sendMessage(base::serialize(*outgoing_message_), base::NetworkChannel::Priority::AUDIO);
+}
+
+void ClientSessionDesktop::sendStatistics(
+    const VideoEncoderGroup::Statistics& statistics, size_t memory_usage)
+{
+    statistics_requested_ = false;
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(now - last_statistics_time_).count();
+
+    // The counters start again when the client moves to a new group.
+    const bool restarted = statistics.captured_frames < last_statistics_.captured_frames ||
+        statistics.encoded_frames < last_statistics_.encoded_frames;
+
+    auto rate = [&](uint64_t current, uint64_t last) -> uint32_t
+    {
+        if (restarted || last_statistics_time_ == std::chrono::steady_clock::time_point() ||
+            seconds <= 0)
+        {
+            return 0;
+        }
+
+        return static_cast<uint32_t>(std::lround(static_cast<double>(current - last) / seconds));
+    };
+
+    proto::HostStatistics host_statistics;
+    host_statistics.set_capture_fps(
+        rate(statistics.captured_frames, last_statistics_.captured_frames));
+    host_statistics.set_encode_fps(
+        rate(statistics.encoded_frames, last_statistics_.encoded_frames));
+    host_statistics.set_drop_fps(
+        rate(statistics.dropped_frames, last_statistics_.dropped_frames));
+    host_statistics.set_capture_time(static_cast<uint32_t>(statistics.capture_time));
+    host_statistics.set_encode_time(static_cast<uint32_t>(statistics.encode_time));
+    host_statistics.set_bitrate(statistics.bitrate);
+    host_statistics.set_quantizer(statistics.quantizer);
+    host_statistics.set_pending_bytes(static_cast<uint32_t>(channelProxy()->pendingBytes()));
+    host_statistics.set_pending_messages(static_cast<uint32_t>(pendingMessages()));
+    host_statistics.set_memory_usage(memory_usage);
+
+    last_statistics_ = statistics;
+    last_statistics_time_ = now;
+
+    outgoing_message_.clear();
+
+    proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
+    extension->set_name(common::kHostStatisticsExtension);
+    extension->set_data(host_statistics.SerializeAsString());
+
     sendMessage(base::serialize(*outgoing_message_));
 }
 
 void ClientSessionDesktop::setScreenList(const proto::ScreenList& list)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
     extension->set_name(common::kSelectScreenExtension);
@@ -236,10 +415,38 @@ void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& eve
 {
     if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
     {
-        outgoing_message_->Clear();
+        outgoing_message_.clear();
 
-        outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
-        sendMessage(base::serialize(*outgoing_message_));
+        const uint32_t flags = event.flags();
+        if ((flags & proto::ClipboardEvent::CHUNK) && !clipboard_chunks_)
+        {
+            // The old clients accept only a clipboard in one event. The chunks are joined here.
+            if (flags & proto::ClipboardEvent::CHUNK_FIRST)
+            {
+                incoming_clipboard_.set_mime_type(event.mime_type());
+                incoming_clipboard_.clear_data();
+            }
+            else if (incoming_clipboard_.mime_type().empty())
+            {
+                return;
+            }
+
+            incoming_clipboard_.mutable_data()->append(event.data());
+
+            if (!(flags & proto::ClipboardEvent::CHUNK_LAST))
+                return;
+
+            outgoing_message_->mutable_clipboard_event()->Swap(&incoming_clipboard_);
+            incoming_clipboard_.Clear();
+        }
+        else
+        {
+            outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
+        }
+
+        // All clipboard events go in one lane, so a small clipboard does not overtake the chunks
+        // of a previous large one.
+        sendMessage(base::serialize(*outgoing_message_), base::NetworkChannel::Priority::BULK);
     }
 }
 
@@ -336,16 +543,44 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
     }
     else if (extension.name() == common::kSystemInfoExtension)
     {
-        proto::SystemInfo system_info;
-        createSystemInfo(&system_info);
+        // Old clients send the request without data.
+        proto::SystemInfoRequest request;
+        if (!extension.data().empty() && !request.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse system info request";
+            return;
+        }
 
-        outgoing_message_->Clear();
+        // The enumeration of the drives, printers and adapters may take seconds. It is done on a
+        // separate thread, so the input and the video of the session are not delayed. Requests are
+        // processed in order, and the client gets a reply to each of them.
+        if (!system_info_thread_.isRunning())
+        {
+            system_info_thread_.setThreadPriority(base::ThreadPriority::BACKGROUND);
+            system_info_thread_.start(base::MessageLoop::Type::DEFAULT);
+        }
+
+        system_info_thread_.taskRunner()->postTask(
+            [channel_proxy = channelProxy(), request]()
+        {
+            proto::SystemInfo system_info;
+            SystemInfoCache::instance()->systemInfo(
+                request.categories(), request.refresh(), &system_info);
 
-        proto::DesktopExtension* desktop_extension = outgoing_message_->mutable_extension();
-        desktop_extension->set_name(common::kSystemInfoExtension);
-        desktop_extension->set_data(system_info.SerializeAsString());
+            proto::HostToClient message;
 
-        sendMessage(base::serialize(*outgoing_message_));
+            proto::DesktopExtension* desktop_extension = message.mutable_extension();
+            desktop_extension->set_name(common::kSystemInfoExtension);
+            desktop_extension->set_data(system_info.SerializeAsString());
+
+            channel_proxy->send(base::serialize(message));
+        });
+    }
+    else if (extension.name() == common::kHostStatisticsExtension)
+    {
+        // The statistics are sent with the next captured frame, when the state of the video
+        // encoder is known.
+        statistics_requested_ = true;
     }
     else
     {
@@ -355,35 +590,40 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
 
 void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 {
-    switch (config.video_encoding())
+    if (VideoEncoderGroup::isSupported(config.video_encoding()))
     {
-        case proto::VIDEO_ENCODING_VP8:
-            video_encoder_ = base::VideoEncoderVPX::createVP8();
-            break;
-
-        case proto::VIDEO_ENCODING_VP9:
-            video_encoder_ = base::VideoEncoderVPX::createVP9();
-            break;
-
-        default:
-        {
-            // No supported video encoding.
-            LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
-        }
-        break;
+        video_encoding_ = config.video_encoding();
+        full_chroma_ = (config.flags() & proto::ENABLE_FULL_CHROMA);
+        lossless_refinement_ = (config.flags() & proto::ENABLE_LOSSLESS_REFINEMENT);
+        tile_cache_ = (config.flags() & proto::ENABLE_TILE_CACHE);
+        copy_rect_ = (config.flags() & proto::ENABLE_COPY_RECT);
+        packed_dirty_rects_ = (config.flags() & proto::ENABLE_PACKED_DIRTY_RECTS);
+        multi_stream_ = (config.flags() & proto::ENABLE_MULTI_STREAM);
+        thumbnail_ = (config.flags() & proto::ENABLE_THUMBNAIL_MODE);
+
+        // The client gets a key frame after each configuration.
+        has_video_encoder_key_ = false;
     }
-
-    if (!video_encoder_)
+    else
     {
-        LOG(LS_ERROR) << "Video encoder not initialized!";
+        // No supported video encoding.
+        LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
+        video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
         return;
     }
 
     switch (config.audio_encoding())
     {
         case proto::AUDIO_ENCODING_OPUS:
-            audio_encoder_ = std::make_unique<base::AudioEncoderOpus>();
-            break;
+        {
+            // The old clients do not send the frame duration.
+            std::chrono::milliseconds frame_duration(config.audio_frame_duration());
+            if (!frame_duration.count())
+                frame_duration = base::AudioEncoderOpus::kDefaultFrameDuration;
+
+            audio_encoder_ = std::make_unique<base::AudioEncoderOpus>(frame_duration);
+        }
+        break;
 
         default:
         {
@@ -393,11 +633,28 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         break;
     }
 
+    if (config.flags() & proto::ALLOW_SESSION_RECORDING)
+    {
+        if (!recorder_)
+            startRecording();
+    }
+    else if (recorder_)
+    {
+        LOG(LS_INFO) << "Session recording stopped";
+        recorder_.reset();
+    }
+
+    cursor_position_ = (config.flags() & proto::ENABLE_CURSOR_POSITION);
+    clipboard_chunks_ = (config.flags() & proto::ENABLE_CLIPBOARD_CHUNKS);
+
     cursor_encoder_.reset();
     if (config.flags() & proto::ENABLE_CURSOR_SHAPE)
-        cursor_encoder_ = std::make_unique<base::CursorEncoder>();
-
-    scale_reducer_ = std::make_unique<base::ScaleReducer>();
+    {
+        cursor_encoder_ = std::make_unique<base::CursorEncoder>(
+            (config.flags() & proto::ENABLE_KEYED_CURSOR_CACHE) ?
+                base::CursorEncoder::CacheType::KEYED : base::CursorEncoder::CacheType::INDEXED,
+            config.zstd_dictionaries() & proto::ZSTD_DICTIONARY_CURSOR);
+    }
 
     desktop_session_config_.disable_font_smoothing =
         (config.flags() & proto::DISABLE_FONT_SMOOTHING);
@@ -412,14 +669,61 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 
     LOG(LS_INFO) << "Client configuration changed";
     LOG(LS_INFO) << "Video encoding: " << config.video_encoding();
+    LOG(LS_INFO) << "Thumbnail mode: " << thumbnail_;
     LOG(LS_INFO) << "Enable cursor shape: " << (cursor_encoder_ != nullptr);
     LOG(LS_INFO) << "Disable font smoothing: " << desktop_session_config_.disable_font_smoothing;
     LOG(LS_INFO) << "Disable desktop effects: " << desktop_session_config_.disable_effects;
     LOG(LS_INFO) << "Disable desktop wallpaper: " << desktop_session_config_.disable_wallpaper;
     LOG(LS_INFO) << "Block input: " << desktop_session_config_.block_input;
     LOG(LS_INFO) << "Lock at disconnect: " << desktop_session_config_.lock_at_disconnect;
+    LOG(LS_INFO) << "Session recording: " << (recorder_ != nullptr);
 
     delegate_->onClientSessionConfigured();
 }
 
+void ClientSessionDesktop::readVideoRecoveryRequest(const proto::VideoRecoveryRequest& request)
+{
+    if (video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN)
+        return;
+
+    LOG(LS_INFO) << "Video recovery requested (stream: " << request.stream_id() << ")";
+
+    // The groups of the client send a key frame with the next frame, which is sent right away.
+    has_video_encoder_key_ = false;
+    desktop_session_proxy_->captureScreen();
+}
+
+void ClientSessionDesktop::readVisibilityEvent(const proto::VisibilityEvent& event)
+{
+    if (event.visible() == visible_)
+        return;
+
+    LOG(LS_INFO) << "Client window visible: " << event.visible();
+    visible_ = event.visible();
+
+    delegate_->onClientSessionVisibilityChanged();
+
+    if (!visible_)
+        return;
+
+    // The client has skipped the frames while it was hidden and needs a key frame. The last frame
+    // is sent at once, the client does not wait for the next change of the screen.
+    has_video_encoder_key_ = false;
+    desktop_session_proxy_->captureScreen();
+}
+
+void ClientSessionDesktop::startRecording()
+{
+    std::filesystem::path directory(SystemSettings().sessionRecordingDirectory());
+    if (directory.empty())
+        return;
+
+    // The packets are copied to the writer thread and dropped if the disk is too slow, so the
+    // recording never delays the packets sent to the client.
+    recorder_ = std::make_shared<base::WebmFileWriter>(
+        directory, base::stringPrintf("session-%u", id()));
+
+    LOG(LS_INFO) << "Session recording started (path: " << directory << ")";
+}
+
 } // namespace host
@@ -21,16 +21,22 @@
 
 #include "base/macros_magic.h"
 #include "base/desktop/geometry.h"
+#include "base/memory/arena_message.h"
+#include "base/threading/thread.h"
 #include "host/client_session.h"
 #include "host/desktop_session.h"
+#include "host/video_encoder_group.h"
+
+#include <algorithm>
+#include <chrono>
 
 namespace base {
 class AudioEncoder;
 class CursorEncoder;
 class Frame;
 class MouseCursor;
-class ScaleReducer;
-class VideoEncoder;
+class VideoBitrateController;
+class WebmFileWriter;
 } // namespace base
 
 namespace host {
@@ -46,13 +52,65 @@ public:
 
     void setDesktopSessionProxy(std::shared_ptr<DesktopSessionProxy> desktop_session_proxy);
 
-    void encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor);
+    // Returns false if the client has not configured the video yet. Otherwise |key| is set to the
+    // video parameters for the source frame of |source_size|.
+    bool videoEncoderKey(const base::Size& source_size, VideoEncoderGroup::Key* key) const;
+
+    // Sets the parameters of the video which is sent to the client. Returns true if they have
+    // changed and the client needs a key frame.
+    bool setVideoEncoderKey(const VideoEncoderGroup::Key& key, const base::Size& source_size);
+
+    // Returns false if the client neither shows the video (its window is minimized or hidden) nor
+    // records it. Such a client is not sent the video.
+    bool isVideoWanted() const { return visible_ || recorder_ != nullptr; }
+
+    // Returns the parameters set by the last call of setVideoEncoderKey() or nullptr.
+    const VideoEncoderGroup::Key* lastVideoEncoderKey() const
+    {
+        return has_video_encoder_key_ ? &video_encoder_key_ : nullptr;
+    }
+
+    // Returns the target bitrate (in kbps) for the video. It is periodically updated from the state
+    // of the network channel.
+    uint32_t targetBitrate();
+
+    // Adds the area where the user of this client works now to |region| (in the coordinates of the
+    // source frame): the neighbourhood of the mouse cursor after a recent mouse movement and the
+    // |active_window_rect| while the user is typing.
+    void addRegionOfInterest(const base::Rect& active_window_rect, base::Region* region) const;
+
+    // Returns the time of the last mouse or keyboard event from the client.
+    std::chrono::steady_clock::time_point lastInputTime() const
+    {
+        return std::max(last_mouse_time_, last_key_time_);
+    }
+
+    // The video is sent by VideoEncoderGroup. The cursor shape is encoded for each client.
+    void encodeCursor(const base::MouseCursor* cursor);
+
+    // Sends the position of the cursor (in the coordinates of the source frame) if it has not
+    // been moved by this client. It is sent at once, independently of the video.
+    void encodeCursorPosition(const base::Point& position);
+
     void encodeAudio(const proto::AudioPacket& audio_packet);
+
+    // Returns true if the client waits for the statistics of the host.
+    bool isStatisticsRequested() const { return statistics_requested_; }
+
+    // Sends |statistics| of the video of the client with the state of its send queue and the
+    // |memory_usage| of its user session. The rates are calculated since the previous call.
+    void sendStatistics(const VideoEncoderGroup::Statistics& statistics, size_t memory_usage);
+
     void setScreenList(const proto::ScreenList& list);
     void injectClipboardEvent(const proto::ClipboardEvent& event);
 
     const DesktopSession::Config& desktopSessionConfig() const { return desktop_session_config_; }
 
+    // Returns the writer of the session recording or nullptr if the session is not recorded. The
+    // recording is started only if the client allows it and a directory is set in the settings
+    // of the host.
+    std::shared_ptr<base::WebmFileWriter> recorder() const { return recorder_; }
+
 protected:
     // net::Listener implementation.
     void onMessageReceived(const base::ByteArray& buffer) override;
@@ -64,17 +122,50 @@ protected:
 private:
     void readExtension(const proto::DesktopExtension& extension);
     void readConfig(const proto::DesktopConfig& config);
+    void readVideoRecoveryRequest(const proto::VideoRecoveryRequest& request);
+    void readVisibilityEvent(const proto::VisibilityEvent& event);
+    void startRecording();
 
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
-    std::unique_ptr<base::ScaleReducer> scale_reducer_;
-    std::unique_ptr<base::VideoEncoder> video_encoder_;
+    proto::VideoEncoding video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
+    bool full_chroma_ = false;
+    bool lossless_refinement_ = false;
+    bool tile_cache_ = false;
+    bool copy_rect_ = false;
+    bool packed_dirty_rects_ = false;
+    bool multi_stream_ = false;
+    bool thumbnail_ = false;
+    bool visible_ = true;
+    VideoEncoderGroup::Key video_encoder_key_;
+    bool has_video_encoder_key_ = false;
+    double scale_factor_x_ = 0;
+    double scale_factor_y_ = 0;
+    base::Point last_mouse_pos_;
+    std::chrono::steady_clock::time_point last_mouse_time_;
+    std::chrono::steady_clock::time_point last_key_time_;
+    std::unique_ptr<base::VideoBitrateController> bitrate_controller_;
+    std::chrono::steady_clock::time_point last_bitrate_update_;
     std::unique_ptr<base::CursorEncoder> cursor_encoder_;
+    bool cursor_position_ = false;
+
+    // The client accepts the clipboard in chunks. Otherwise the chunks from the desktop session
+    // are joined in |incoming_clipboard_|.
+    bool clipboard_chunks_ = false;
+    proto::ClipboardEvent incoming_clipboard_;
     std::unique_ptr<base::AudioEncoder> audio_encoder_;
+    std::shared_ptr<base::WebmFileWriter> recorder_;
     DesktopSession::Config desktop_session_config_;
     base::Size preferred_size_;
 
-    std::unique_ptr<proto::ClientToHost> incoming_message_;
-    std::unique_ptr<proto::HostToClient> outgoing_message_;
+    bool statistics_requested_ = false;
+    VideoEncoderGroup::Statistics last_statistics_;
+    std::chrono::steady_clock::time_point last_statistics_time_;
+
+    // Collects the system information requested by the client.
+    base::Thread system_info_thread_;
+
+    base::ArenaMessage<proto::ClientToHost> incoming_message_;
+    base::ArenaMessage<proto::HostToClient> outgoing_message_;
 
     DISALLOW_COPY_AND_ASSIGN(ClientSessionDesktop);
 };
@@ -23,12 +23,15 @@
 #include "base/threading/thread.h"
 #include "base/win/scoped_impersonator.h"
 #include "base/win/scoped_object.h"
+#include "common/file_packet.h"
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
 #include "common/file_task_producer_proxy.h"
 #include "common/file_worker.h"
 #include "proto/file_transfer.pb.h"
 
+#include <vector>
+
 #include <wtsapi32.h>
 
 namespace host {
@@ -90,6 +93,50 @@ bool createLoggedOnUserToken(DWORD session_id, base::win::ScopedHandle* token_ou
     return true;
 }
 
+// The thread on which the files of one transfer lane are read and written. Like the main thread of
+// the worker, it works on behalf of the logged on user.
+class ImpersonatedThread : public base::Thread::Delegate
+{
+public:
+    ImpersonatedThread() = default;
+    ~ImpersonatedThread() { thread_.stop(); }
+
+    // Returns false if the thread could not impersonate the user.
+    bool start(HANDLE user_token)
+    {
+        user_token_ = user_token;
+        thread_.setThreadPriority(base::ThreadPriority::BACKGROUND);
+        thread_.start(base::MessageLoop::Type::DEFAULT, this);
+        user_token_ = nullptr;
+
+        return impersonator_ != nullptr;
+    }
+
+    std::shared_ptr<base::TaskRunner> taskRunner() const { return thread_.taskRunner(); }
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override
+    {
+        std::unique_ptr<base::win::ScopedImpersonator> impersonator =
+            std::make_unique<base::win::ScopedImpersonator>();
+        if (impersonator->loggedOnUser(user_token_))
+            impersonator_ = std::move(impersonator);
+    }
+
+    void onAfterThreadRunning() override
+    {
+        impersonator_.reset();
+    }
+
+private:
+    base::Thread thread_;
+    HANDLE user_token_ = nullptr;
+    std::unique_ptr<base::win::ScopedImpersonator> impersonator_;
+
+    DISALLOW_COPY_AND_ASSIGN(ImpersonatedThread);
+};
+
 } // namespace
 
 class ClientSessionFileTransfer::Worker
@@ -97,7 +144,9 @@ class ClientSessionFileTransfer::Worker
       public common::FileTaskProducer
 {
 public:
-    Worker(base::SessionId session_id, std::shared_ptr<base::NetworkChannelProxy> channel_proxy);
+    Worker(base::SessionId session_id,
+           std::shared_ptr<base::NetworkChannelProxy> channel_proxy,
+           uint8_t stream_id);
     ~Worker();
 
     void start();
@@ -116,16 +165,21 @@ private:
     const base::SessionId session_id_;
     std::unique_ptr<base::win::ScopedImpersonator> impersonator_;
     std::shared_ptr<base::NetworkChannelProxy> channel_proxy_;
+    const uint8_t stream_id_;
     std::shared_ptr<common::FileTaskProducerProxy> producer_proxy_;
+    std::vector<std::unique_ptr<ImpersonatedThread>> io_threads_;
     std::unique_ptr<common::FileWorker> impl_;
 
     DISALLOW_COPY_AND_ASSIGN(Worker);
 };
 
 ClientSessionFileTransfer::Worker::Worker(
-    base::SessionId session_id, std::shared_ptr<base::NetworkChannelProxy> channel_proxy)
+    base::SessionId session_id,
+    std::shared_ptr<base::NetworkChannelProxy> channel_proxy,
+    uint8_t stream_id)
     : session_id_(session_id),
-      channel_proxy_(std::move(channel_proxy))
+      channel_proxy_(std::move(channel_proxy)),
+      stream_id_(stream_id)
 {
     // Nothing
 }
@@ -137,6 +191,8 @@ ClientSessionFileTransfer::Worker::~Worker()
 
 void ClientSessionFileTransfer::Worker::start()
 {
+    // The file transfer must not take the disk and the CPU from the user.
+    thread_.setThreadPriority(base::ThreadPriority::BACKGROUND);
     thread_.start(base::MessageLoop::Type::DEFAULT, this);
 }
 
@@ -153,7 +209,7 @@ void ClientSessionFileTransfer::Worker::postRequest(std::unique_ptr<proto::FileR
     {
         proto::FileReply reply;
         reply.set_error_code(proto::FILE_ERROR_NO_LOGGED_ON_USER);
-        channel_proxy_->send(base::serialize(reply));
+        channel_proxy_->sendToStream(stream_id_, base::serialize(reply));
     }
 }
 
@@ -167,12 +223,33 @@ void ClientSessionFileTransfer::Worker::onBeforeThreadRunning()
     if (!impersonator_->loggedOnUser(user_token))
         return;
 
+    // Files of different lanes are read and written in parallel.
+    std::vector<std::shared_ptr<base::TaskRunner>> io_task_runners;
+
+    for (uint32_t i = 0; i < common::kMaxFileLanes; ++i)
+    {
+        std::unique_ptr<ImpersonatedThread> io_thread = std::make_unique<ImpersonatedThread>();
+        if (!io_thread->start(user_token))
+        {
+            LOG(LS_WARNING) << "Unable to start I/O thread. Files are transferred serially";
+            io_task_runners.clear();
+            io_threads_.clear();
+            break;
+        }
+
+        io_task_runners.emplace_back(io_thread->taskRunner());
+        io_threads_.emplace_back(std::move(io_thread));
+    }
+
     producer_proxy_ = std::make_shared<common::FileTaskProducerProxy>(this);
-    impl_ = std::make_unique<common::FileWorker>(thread_.taskRunner());
+    impl_ = std::make_unique<common::FileWorker>(thread_.taskRunner(), std::move(io_task_runners));
 }
 
 void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
 {
+    // The I/O threads are stopped first so that they no longer report the done tasks.
+    io_threads_.clear();
+
     if (producer_proxy_)
     {
         producer_proxy_->dettach();
@@ -185,7 +262,7 @@ void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
 
 void ClientSessionFileTransfer::Worker::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
-    channel_proxy_->send(base::serialize(task->reply()));
+    channel_proxy_->sendToStream(stream_id_, base::serialize(task->reply()));
 }
 
 ClientSessionFileTransfer::ClientSessionFileTransfer(std::unique_ptr<base::NetworkChannel> channel)
@@ -194,6 +271,12 @@ ClientSessionFileTransfer::ClientSessionFileTransfer(std::unique_ptr<base::Netwo
     // Nothing
 }
 
+ClientSessionFileTransfer::ClientSessionFileTransfer(ClientSession* parent, uint8_t stream_id)
+    : ClientSession(proto::SESSION_TYPE_FILE_TRANSFER, parent, stream_id)
+{
+    // Nothing
+}
+
 ClientSessionFileTransfer::~ClientSessionFileTransfer() = default;
 
 void ClientSessionFileTransfer::onMessageReceived(const base::ByteArray& buffer)
@@ -208,7 +291,14 @@ void ClientSessionFileTransfer::onMessageReceived(const base::ByteArray& buffer)
 
     if (!worker_)
     {
-        worker_ = std::make_unique<Worker>(sessionId(), channelProxy());
+        std::shared_ptr<base::NetworkChannelProxy> channel_proxy = channelProxy();
+        if (!channel_proxy)
+        {
+            LOG(LS_WARNING) << "The channel of the session is already closed";
+            return;
+        }
+
+        worker_ = std::make_unique<Worker>(sessionId(), std::move(channel_proxy), streamId());
         worker_->start();
     }
 
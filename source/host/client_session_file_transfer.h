@@ -28,6 +28,10 @@ class ClientSessionFileTransfer : public ClientSession
 {
 public:
     explicit ClientSessionFileTransfer(std::unique_ptr<base::NetworkChannel> channel);
+
+    // Creates a session in the stream |stream_id| of the channel of |parent| (e.g. the file
+    // manager which is opened from a desktop session).
+    ClientSessionFileTransfer(ClientSession* parent, uint8_t stream_id);
     ~ClientSessionFileTransfer();
 
 protected:
@@ -20,18 +20,24 @@
 
 #include "base/command_line.h"
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/message_loop/message_loop.h"
+#include "base/threading/scoped_thread_priority.h"
 #include "host/desktop_session_agent.h"
 
 void desktopAgentMain(int argc, const char* const* argv)
 {
     base::initLogging();
+    base::TraceLog::startFromEnvironment("desktop_agent");
 
     base::CommandLine::init(argc, argv);
     base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
 
     if (command_line->hasSwitch(u"channel_id"))
     {
+        // The screen is captured on the main thread of the agent.
+        base::ScopedThreadPriority thread_priority(base::ThreadPriority::DISPLAY_CRITICAL);
+
         std::unique_ptr<base::MessageLoop> message_loop =
             std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
 
@@ -46,5 +52,6 @@ void desktopAgentMain(int argc, const char* const* argv)
         LOG(LS_ERROR) << "Parameter channel_id is not specified";
     }
 
+    base::TraceLog::finish();
     base::shutdownLogging();
 }
@@ -24,6 +24,7 @@
 namespace base {
 class Frame;
 class MouseCursor;
+class Point;
 } // namespace base
 
 namespace host {
@@ -41,6 +42,9 @@ public:
         virtual void onDesktopSessionStarted() = 0;
         virtual void onDesktopSessionStopped() = 0;
         virtual void onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor) = 0;
+
+        // The cursor has been moved. |position| is in the coordinates of the captured frame.
+        virtual void onCursorPositionChanged(const base::Point& position) = 0;
         virtual void onAudioCaptured(const proto::AudioPacket& audio_packet) = 0;
         virtual void onScreenListChanged(const proto::ScreenList& list) = 0;
         virtual void onClipboardEvent(const proto::ClipboardEvent& event) = 0;
@@ -72,6 +76,10 @@ public:
     virtual void selectScreen(const proto::Screen& screen) = 0;
     virtual void captureScreen() = 0;
 
+    // Sets the number of messages waiting to be sent to the slowest client. The desktop agent
+    // reduces the capture rate when the messages are queued faster than they are sent.
+    virtual void setPendingMessages(uint32_t pending_messages) = 0;
+
     virtual void injectKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void injectMouseEvent(const proto::MouseEvent& event) = 0;
     virtual void injectClipboardEvent(const proto::ClipboardEvent& event) = 0;
@@ -20,20 +20,47 @@
 
 #include "base/logging.h"
 #include "base/power_controller.h"
+#include "base/process_handle.h"
+#include "base/system_time.h"
 #include "base/audio/audio_capturer_wrapper.h"
 #include "base/desktop/capture_scheduler.h"
+#include "base/desktop/frame_trace_writer.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/screen_capturer_wrapper.h"
 #include "base/desktop/shared_frame.h"
 #include "base/ipc/shared_memory.h"
+#include "base/strings/string_printf.h"
 #include "base/threading/thread.h"
+#include "build/build_config.h"
 #include "host/input_injector_win.h"
 #include "host/system_settings.h"
 
+#if defined(OS_WIN)
+#include "base/desktop/win/screen_capture_utils.h"
+
+#include <Windows.h>
+#endif // defined(OS_WIN)
+
 namespace host {
 
 namespace {
 
+// The recording stops when the trace file reaches this size.
+const int64_t kMaxFrameTraceSize = 2LL * 1024 * 1024 * 1024;
+
+// The capturers use three frames. The other frames are kept when the capturer is recreated or
+// the screen resolution is decreased.
+const size_t kFramePoolSize = 4;
+
+// The next capture overwrites the oldest frame of the queue. The service keeps the last received
+// frame while it is encoded, so all frames except the current and the last received one can be
+// in flight.
+const int kMaxFramesInFlight = base::ScreenCapturer::kFrameQueueLength - 2;
+
+// The cursor position is checked at about the refresh rate of the screen, independently of the
+// capture and the encoding of the frames.
+const std::chrono::milliseconds kCursorPositionInterval(16);
+
 const char* controlActionToString(proto::internal::Control::Action action)
 {
     switch (action)
@@ -47,6 +74,12 @@ const char* controlActionToString(proto::internal::Control::Action action)
         case proto::internal::Control::LOCK:
             return "LOCK";
 
+        case proto::internal::Control::PAUSE_CAPTURE:
+            return "PAUSE_CAPTURE";
+
+        case proto::internal::Control::RESUME_CAPTURE:
+            return "RESUME_CAPTURE";
+
         case proto::internal::Control::LOGOFF:
             return "LOGOFF";
 
@@ -55,12 +88,54 @@ const char* controlActionToString(proto::internal::Control::Action action)
     }
 }
 
+// Returns the rectangle of the foreground window in the coordinates of |frame|.
+base::Rect activeWindowRect(const base::Frame* frame)
+{
+#if defined(OS_WIN)
+    HWND window = GetForegroundWindow();
+    if (!window || IsIconic(window))
+        return base::Rect();
+
+    RECT window_rect;
+    if (!GetWindowRect(window, &window_rect))
+        return base::Rect();
+
+    base::Rect rect = base::Rect::makeLTRB(
+        window_rect.left, window_rect.top, window_rect.right, window_rect.bottom);
+
+    rect.translate(-frame->topLeft().x(), -frame->topLeft().y());
+    rect.intersectWith(base::Rect::makeSize(frame->size()));
+    return rect;
+#else
+    return base::Rect();
+#endif // defined(OS_WIN)
+}
+
+// Returns the rectangles of the screens of |list| in the coordinates of the virtual screen.
+std::vector<base::Rect> screenRects(const base::ScreenCapturer::ScreenList& list)
+{
+    std::vector<base::Rect> rects;
+
+#if defined(OS_WIN)
+    for (const auto& screen : list)
+    {
+        std::wstring device_key;
+        if (!base::ScreenCaptureUtils::isScreenValid(screen.id, &device_key))
+            continue;
+
+        base::Rect rect = base::ScreenCaptureUtils::screenRect(screen.id, device_key);
+        if (!rect.isEmpty())
+            rects.emplace_back(rect);
+    }
+#endif // defined(OS_WIN)
+
+    return rects;
+}
+
 } // namespace
 
 DesktopSessionAgent::DesktopSessionAgent(std::shared_ptr<base::TaskRunner> task_runner)
-    : task_runner_(std::move(task_runner)),
-      incoming_message_(std::make_unique<proto::internal::ServiceToDesktop>()),
-      outgoing_message_(std::make_unique<proto::internal::DesktopToService>())
+    : task_runner_(std::move(task_runner))
 {
     // At the end of the user's session, the program ends later than the others.
     SetProcessShutdownParameters(0, SHUTDOWN_NORETRY);
@@ -69,6 +144,8 @@ DesktopSessionAgent::DesktopSessionAgent(std::shared_ptr<base::TaskRunner> task_
     SystemSettings settings;
     preferred_video_capturer_ =
         static_cast<base::ScreenCapturer::Type>(settings.preferredVideoCapturer());
+    frame_trace_directory_ = settings.frameTraceDirectory();
+    warm_capturer_ = settings.isWarmCapturerEnabled();
 }
 
 DesktopSessionAgent::~DesktopSessionAgent() = default;
@@ -84,17 +161,22 @@ void DesktopSessionAgent::start(std::u16string_view channel_id)
 
     channel_->setListener(this);
     channel_->resume();
+
+    // Frequent small messages (screen updates, cursor shapes, input events) go through the ring.
+    channel_->enableSharedMemoryRing();
 }
 
 void DesktopSessionAgent::onDisconnected()
 {
+    // The process is ending. The capturer is no longer kept.
+    warm_capturer_ = false;
     setEnabled(false);
     task_runner_->postQuit();
 }
 
 void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 {
-    incoming_message_->Clear();
+    incoming_message_.clear();
 
     if (!base::parse(buffer, incoming_message_.get()))
     {
@@ -104,18 +186,50 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
     if (incoming_message_->has_next_screen_capture())
     {
-        captureEnd(std::chrono::milliseconds(
-            incoming_message_->next_screen_capture().update_interval()));
+        const proto::internal::NextScreenCapture& next_screen_capture =
+            incoming_message_->next_screen_capture();
+
+        const std::chrono::milliseconds update_interval(next_screen_capture.update_interval());
+
+        if (capture_scheduler_)
+            capture_scheduler_->setPendingMessages(next_screen_capture.pending_messages());
+
+        // A zero interval is sent when the service has no frame yet, it is not an answer to a
+        // frame. In this case the next capture is already scheduled or a frame is in flight.
+        if (update_interval != std::chrono::milliseconds::zero())
+        {
+            if (frames_in_flight_ > 0)
+                --frames_in_flight_;
+
+            if (capture_stalled_)
+            {
+                capture_stalled_ = false;
+                captureEnd(update_interval);
+            }
+            else if (capture_scheduler_)
+            {
+                // The next capture is already scheduled.
+                capture_scheduler_->setUpdateInterval(update_interval);
+            }
+        }
     }
     else if (incoming_message_->has_mouse_event())
     {
         if (input_injector_)
+        {
             input_injector_->injectMouseEvent(incoming_message_->mouse_event());
+            scheduleInputFlush();
+            wakeUpCapture();
+        }
     }
     else if (incoming_message_->has_key_event())
     {
         if (input_injector_)
+        {
             input_injector_->injectKeyEvent(incoming_message_->key_event());
+            scheduleInputFlush();
+            wakeUpCapture();
+        }
     }
     else if (incoming_message_->has_clipboard_event())
     {
@@ -128,8 +242,14 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
         if (screen_capturer_)
         {
-            screen_capturer_->selectScreen(static_cast<base::ScreenCapturer::ScreenId>(
-                incoming_message_->select_source().screen().id()));
+            const proto::Screen& screen = incoming_message_->select_source().screen();
+            const base::ScreenCapturer::ScreenId id =
+                static_cast<base::ScreenCapturer::ScreenId>(screen.id());
+
+            if (screen.window())
+                screen_capturer_->selectWindow(id);
+            else
+                screen_capturer_->selectScreen(id);
         }
         else
         {
@@ -181,8 +301,18 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
                 break;
 
             case proto::internal::Control::DISABLE:
+            {
                 setEnabled(false);
-                break;
+
+                // The service disables the session when the agent connects without clients. The
+                // capturer is created now, so the first client does not wait for it.
+                if (warm_capturer_ && !screen_capturer_)
+                {
+                    createScreenCapturer();
+                    screen_capturer_->setActive(false);
+                }
+            }
+            break;
 
             case proto::internal::Control::LOGOFF:
                 base::PowerController::logoff();
@@ -192,6 +322,14 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
                 base::PowerController::lock();
                 break;
 
+            case proto::internal::Control::PAUSE_CAPTURE:
+                setCapturePaused(true);
+                break;
+
+            case proto::internal::Control::RESUME_CAPTURE:
+                setCapturePaused(false);
+                break;
+
             default:
                 NOTREACHED();
                 break;
@@ -208,7 +346,7 @@ void DesktopSessionAgent::onSharedMemoryCreate(int id)
 {
     LOG(LS_INFO) << "Shared memory created: " << id;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::SharedBuffer* shared_buffer = outgoing_message_->mutable_shared_buffer();
     shared_buffer->set_type(proto::internal::SharedBuffer::CREATE);
@@ -221,7 +359,7 @@ void DesktopSessionAgent::onSharedMemoryDestroy(int id)
 {
     LOG(LS_INFO) << "Shared memory destroyed: " << id;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::SharedBuffer* shared_buffer = outgoing_message_->mutable_shared_buffer();
     shared_buffer->set_type(proto::internal::SharedBuffer::RELEASE);
@@ -230,15 +368,18 @@ void DesktopSessionAgent::onSharedMemoryDestroy(int id)
     channel_->send(base::serialize(*outgoing_message_));
 }
 
-void DesktopSessionAgent::onScreenListChanged(
-    const base::ScreenCapturer::ScreenList& list, base::ScreenCapturer::ScreenId current)
+void DesktopSessionAgent::onScreenListChanged(const base::ScreenCapturer::ScreenList& screens,
+                                              base::ScreenCapturer::ScreenId current_screen,
+                                              const base::ScreenCapturer::ScreenList& windows,
+                                              base::ScreenCapturer::ScreenId current_window)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::ScreenList* screen_list = outgoing_message_->mutable_screen_list();
-    screen_list->set_current_screen(current);
+    screen_list->set_current_screen(current_screen);
+    screen_list->set_current_window(current_window);
 
-    for (const auto& list_item : list)
+    for (const auto& list_item : screens)
     {
         proto::Screen* screen = screen_list->add_screen();
         screen->set_id(list_item.id);
@@ -248,6 +389,19 @@ void DesktopSessionAgent::onScreenListChanged(
             screen_list->set_primary_screen(list_item.id);
     }
 
+    for (const auto& list_item : windows)
+    {
+        proto::Screen* window = screen_list->add_window();
+        window->set_id(list_item.id);
+        window->set_title(list_item.title);
+        window->set_window(true);
+    }
+
+    // The service can encode each screen of the full desktop separately.
+    screen_rects_.clear();
+    if (current_screen == base::ScreenCapturer::kFullDesktopScreenId && screens.size() > 1)
+        screen_rects_ = screenRects(screens);
+
     LOG(LS_INFO) << "Sending screen list to service";
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -255,7 +409,14 @@ void DesktopSessionAgent::onScreenListChanged(
 void DesktopSessionAgent::onScreenCaptured(
     const base::Frame* frame, const base::MouseCursor* mouse_cursor)
 {
-    outgoing_message_->Clear();
+    if (frame)
+        frame_rect_ = base::Rect::makeXYWH(frame->topLeft(), frame->size());
+
+    // The position is sent in its own message, so the service forwards it without waiting for
+    // the encoding of the frame.
+    const bool cursor_moved = sendCursorPosition();
+
+    outgoing_message_.clear();
 
     proto::internal::ScreenCaptured* screen_captured = outgoing_message_->mutable_screen_captured();
 
@@ -272,6 +433,13 @@ void DesktopSessionAgent::onScreenCaptured(
         serialized_frame->set_height(frame->size().height());
         serialized_frame->set_dpi_x(frame->dpi().x());
         serialized_frame->set_dpi_y(frame->dpi().y());
+        const int64_t diff_time = base::SystemTime::microsecondsSinceEpoch();
+
+        serialized_frame->set_capture_time(capture_time_);
+        serialized_frame->set_diff_time(diff_time);
+
+        if (frame_trace_writer_)
+            writeFrameTrace(*frame, diff_time);
 
         for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
         {
@@ -283,6 +451,34 @@ void DesktopSessionAgent::onScreenCaptured(
             dirty_rect->set_width(rect.width());
             dirty_rect->set_height(rect.height());
         }
+
+        const base::Rect active_window_rect = activeWindowRect(frame);
+        if (!active_window_rect.isEmpty())
+        {
+            proto::Rect* serialized_rect = serialized_frame->mutable_active_window_rect();
+
+            serialized_rect->set_x(active_window_rect.x());
+            serialized_rect->set_y(active_window_rect.y());
+            serialized_rect->set_width(active_window_rect.width());
+            serialized_rect->set_height(active_window_rect.height());
+        }
+
+        const base::Rect& copy_rect = frame->copyRect();
+        if (!copy_rect.isEmpty())
+        {
+            proto::VideoCopyRect* serialized_copy_rect = serialized_frame->mutable_copy_rect();
+            proto::Rect* serialized_rect = serialized_copy_rect->mutable_rect();
+
+            serialized_rect->set_x(copy_rect.x());
+            serialized_rect->set_y(copy_rect.y());
+            serialized_rect->set_width(copy_rect.width());
+            serialized_rect->set_height(copy_rect.height());
+
+            serialized_copy_rect->set_source_x(frame->copySource().x());
+            serialized_copy_rect->set_source_y(frame->copySource().y());
+        }
+
+        addScreenRects(*frame, serialized_frame);
     }
 
     if (mouse_cursor)
@@ -297,9 +493,21 @@ void DesktopSessionAgent::onScreenCaptured(
         serialized_mouse_cursor->set_data(base::toStdString(mouse_cursor->constImage()));
     }
 
+    // A static screen is captured less often. The encoders still get the frames at the full rate
+    // when something changes.
+    capture_scheduler_->setScreenChanged(
+        screen_captured->has_frame() || screen_captured->has_mouse_cursor() || cursor_moved);
+
     if (screen_captured->has_frame() || screen_captured->has_mouse_cursor())
     {
         channel_->send(base::serialize(*outgoing_message_));
+
+        // The service answers with NextScreenCapture to each message. While the queue of the
+        // capturer has free frames, the next frame is captured without waiting for the answer.
+        if (++frames_in_flight_ <= kMaxFramesInFlight)
+            captureEnd(capture_scheduler_->updateInterval());
+        else
+            capture_stalled_ = true;
     }
     else
     {
@@ -307,9 +515,35 @@ void DesktopSessionAgent::onScreenCaptured(
     }
 }
 
+void DesktopSessionAgent::addScreenRects(
+    const base::Frame& frame, proto::internal::DesktopFrame* serialized_frame) const
+{
+    if (screen_rects_.size() < 2)
+        return;
+
+    const base::Rect frame_rect = base::Rect::makeSize(frame.size());
+
+    for (const auto& screen_rect : screen_rects_)
+    {
+        base::Rect rect = screen_rect;
+        rect.translate(-frame.topLeft().x(), -frame.topLeft().y());
+        rect.intersectWith(frame_rect);
+
+        if (rect.isEmpty())
+            continue;
+
+        proto::Rect* serialized_rect = serialized_frame->add_screen_rect();
+
+        serialized_rect->set_x(rect.x());
+        serialized_rect->set_y(rect.y());
+        serialized_rect->set_width(rect.width());
+        serialized_rect->set_height(rect.height());
+    }
+}
+
 void DesktopSessionAgent::onClipboardEvent(const proto::ClipboardEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -328,35 +562,48 @@ void DesktopSessionAgent::setEnabled(bool enable)
 
         input_injector_ = std::make_unique<InputInjectorWin>();
 
-        // A window is created to monitor the clipboard. We cannot create windows in the current
-        // thread. Create a separate thread.
+        // A window is created to monitor the clipboard. The asio loop of the agent serves its
+        // messages, so the clipboard works on the same thread as the capture and the input.
         clipboard_monitor_ = std::make_unique<common::ClipboardMonitor>();
         clipboard_monitor_->start(task_runner_, this);
 
-        // Create a shared memory factory.
-        // We will receive notifications of all creations and destruction of shared memory.
-        shared_memory_factory_ = std::make_unique<base::SharedMemoryFactory>(this);
+        // The service joins the chunks for the clients which do not support them.
+        clipboard_monitor_->setChunksEnabled(true);
 
         capture_scheduler_ = std::make_unique<base::CaptureScheduler>(
-            std::chrono::milliseconds(40));
+            std::chrono::milliseconds(40), base::CaptureScheduler::Mode::ADAPTIVE);
 
-        screen_capturer_ = std::make_unique<base::ScreenCapturerWrapper>(
-            preferred_video_capturer_, this);
-        screen_capturer_->setSharedMemoryFactory(shared_memory_factory_.get());
+        if (screen_capturer_)
+            screen_capturer_->setActive(true);
+        else
+            createScreenCapturer();
 
         audio_capturer_ = std::make_unique<base::AudioCapturerWrapper>(channel_->channelProxy());
         audio_capturer_->start();
 
-        LOG(LS_INFO) << "Session successfully enabled";
+        if (!frame_trace_directory_.empty())
+            startFrameTrace();
 
-        task_runner_->postTask(std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()));
+        LOG(LS_INFO) << "Session successfully enabled";
+        startCapture();
     }
     else
     {
         input_injector_.reset();
+        frame_trace_writer_.reset();
         capture_scheduler_.reset();
-        screen_capturer_.reset();
-        shared_memory_factory_.reset();
+
+        if (warm_capturer_ && screen_capturer_)
+        {
+            // The capturer and its frames are kept for the next client.
+            screen_capturer_->setActive(false);
+        }
+        else
+        {
+            screen_capturer_.reset();
+            shared_memory_factory_.reset();
+        }
+
         clipboard_monitor_.reset();
         audio_capturer_.reset();
 
@@ -372,12 +619,83 @@ void DesktopSessionAgent::setEnabled(bool enable)
     }
 }
 
+void DesktopSessionAgent::setCapturePaused(bool paused)
+{
+    if (capture_paused_ == paused)
+        return;
+
+    LOG(LS_INFO) << "Capture paused: " << paused;
+    capture_paused_ = paused;
+
+    if (paused || !capture_stopped_)
+        return;
+
+    capture_stopped_ = false;
+
+    if (capture_scheduler_)
+        startCapture();
+}
+
+void DesktopSessionAgent::startCapture()
+{
+    // The answers to the frames sent before are not waited for.
+    frames_in_flight_ = 0;
+    capture_stalled_ = false;
+    capture_delayed_ = false;
+    capture_waiting_ = false;
+    ++capture_timer_id_;
+    has_cursor_position_ = false;
+
+    task_runner_->postTask(std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()));
+}
+
+void DesktopSessionAgent::createScreenCapturer()
+{
+    // Create a shared memory factory.
+    // We will receive notifications of all creations and destruction of shared memory.
+    shared_memory_factory_ = std::make_unique<base::SharedMemoryFactory>(this);
+    shared_memory_factory_->setPoolSize(kFramePoolSize);
+
+    screen_capturer_ = std::make_unique<base::ScreenCapturerWrapper>(
+        preferred_video_capturer_, this);
+    screen_capturer_->setSharedMemoryFactory(shared_memory_factory_.get());
+}
+
+void DesktopSessionAgent::scheduleInputFlush()
+{
+    if (input_flush_pending_)
+        return;
+
+    input_flush_pending_ = true;
+
+    // The messages which are already in the shared memory ring are read before the posted task is
+    // run. The events which have arrived together are injected together.
+    task_runner_->postTask(std::bind(&DesktopSessionAgent::flushInput, shared_from_this()));
+}
+
+void DesktopSessionAgent::flushInput()
+{
+    input_flush_pending_ = false;
+
+    if (input_injector_)
+        input_injector_->flush();
+}
+
 void DesktopSessionAgent::captureBegin()
 {
     if (!capture_scheduler_ || !screen_capturer_)
         return;
 
+    if (capture_paused_)
+    {
+        capture_stopped_ = true;
+        return;
+    }
+
     capture_scheduler_->beginCapture();
+
+    frame_ready_ = false;
+    capture_time_ = base::SystemTime::microsecondsSinceEpoch();
     screen_capturer_->captureFrame();
 }
 
@@ -388,6 +706,10 @@ void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_int
 
     capture_scheduler_->endCapture();
 
+    // While the screen is idle, the cursor position is checked only with the captures.
+    if (!capture_scheduler_->isIdle())
+        scheduleCursorPosition();
+
     if (update_interval == std::chrono::milliseconds::zero())
     {
         // Capture immediately.
@@ -397,10 +719,169 @@ void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_int
     {
         capture_scheduler_->setUpdateInterval(update_interval);
 
+        capture_delayed_ = true;
+
         task_runner_->postDelayedTask(
-            std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()),
+            std::bind(&DesktopSessionAgent::onCaptureTimer, shared_from_this(),
+                      capture_timer_id_),
             capture_scheduler_->nextCaptureDelay());
     }
 }
 
+void DesktopSessionAgent::onCaptureTimer(uint32_t capture_timer_id)
+{
+    if (capture_timer_id != capture_timer_id_)
+        return;
+
+    capture_delayed_ = false;
+
+    if (screen_capturer_ && screen_capturer_->isFrameDriven() && !frame_ready_)
+    {
+        capture_waiting_ = true;
+        return;
+    }
+
+    captureBegin();
+}
+
+void DesktopSessionAgent::onFrameAvailable()
+{
+    // Called on the thread of the capturer.
+    std::weak_ptr<DesktopSessionAgent> weak_self = weak_from_this();
+
+    task_runner_->postTask([weak_self]()
+    {
+        if (std::shared_ptr<DesktopSessionAgent> self = weak_self.lock())
+            self->onFrameReady();
+    });
+}
+
+void DesktopSessionAgent::onFrameReady()
+{
+    frame_ready_ = true;
+
+    if (capture_waiting_)
+    {
+        capture_waiting_ = false;
+        captureBegin();
+        return;
+    }
+
+    // The first change of an idle screen is captured without waiting for the idle interval.
+    wakeUpCapture();
+}
+
+void DesktopSessionAgent::wakeUpCapture()
+{
+    if (!capture_scheduler_ || !capture_scheduler_->isIdle())
+        return;
+
+    capture_scheduler_->resetIdle();
+
+    // The capture is in progress or waits for the service. It is scheduled at the normal rate
+    // after that.
+    if (!capture_delayed_ && !capture_waiting_)
+        return;
+
+    // The timer of the idle capture is dropped.
+    capture_delayed_ = false;
+    capture_waiting_ = false;
+    ++capture_timer_id_;
+
+    task_runner_->postTask(std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()));
+}
+
+void DesktopSessionAgent::scheduleCursorPosition()
+{
+    if (cursor_position_scheduled_)
+        return;
+
+    cursor_position_scheduled_ = true;
+
+    task_runner_->postDelayedTask(
+        std::bind(&DesktopSessionAgent::onCursorPositionTimer, shared_from_this()),
+        kCursorPositionInterval);
+}
+
+void DesktopSessionAgent::onCursorPositionTimer()
+{
+    cursor_position_scheduled_ = false;
+
+    if (!capture_scheduler_ || !screen_capturer_ || capture_paused_)
+        return;
+
+    sendCursorPosition();
+
+    if (!capture_scheduler_->isIdle())
+        scheduleCursorPosition();
+}
+
+bool DesktopSessionAgent::sendCursorPosition()
+{
+    base::Point position;
+    if (!screen_capturer_ || !screen_capturer_->cursorPosition(&position))
+        return false;
+
+    if (!frame_rect_.contains(position.x(), position.y()))
+        return false;
+
+    position = position.subtract(frame_rect_.topLeft());
+    if (has_cursor_position_ && position == last_cursor_position_)
+        return false;
+
+    last_cursor_position_ = position;
+    has_cursor_position_ = true;
+
+    outgoing_message_.clear();
+
+    proto::CursorPosition* cursor_position = outgoing_message_->mutable_cursor_position();
+    cursor_position->set_x(position.x());
+    cursor_position->set_y(position.y());
+
+    channel_->send(base::serialize(*outgoing_message_));
+    return true;
+}
+
+void DesktopSessionAgent::startFrameTrace()
+{
+    const base::SystemTime time = base::SystemTime::now();
+
+    const std::string file_name = base::stringPrintf("frames-%04d%02d%02d-%02d%02d%02d-%u.trace",
+        time.year(), time.month(), time.day(), time.hour(), time.minute(), time.second(),
+        static_cast<unsigned int>(base::currentProcessId()));
+
+    std::error_code error_code;
+    std::filesystem::create_directories(frame_trace_directory_, error_code);
+
+    const std::filesystem::path file_path = frame_trace_directory_ / file_name;
+
+    frame_trace_writer_ = base::FrameTraceWriter::create(file_path);
+    if (!frame_trace_writer_)
+    {
+        LOG(LS_ERROR) << "Unable to start the frame trace: " << file_path;
+        return;
+    }
+
+    LOG(LS_INFO) << "Frame trace started: " << file_path;
+}
+
+void DesktopSessionAgent::writeFrameTrace(const base::Frame& frame, int64_t diff_time)
+{
+    DCHECK(frame_trace_writer_);
+
+    if (!frame_trace_writer_->writeFrame(frame, capture_time_, diff_time))
+    {
+        LOG(LS_ERROR) << "Unable to write the frame trace. Recording stopped";
+        frame_trace_writer_.reset();
+        return;
+    }
+
+    if (frame_trace_writer_->fileSize() >= kMaxFrameTraceSize)
+    {
+        LOG(LS_INFO) << "Frame trace reached the maximum size ("
+                     << frame_trace_writer_->frameCount() << " frames). Recording stopped";
+        frame_trace_writer_.reset();
+    }
+}
+
 } // namespace host
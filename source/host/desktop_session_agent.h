@@ -22,12 +22,16 @@
 #include "base/desktop/screen_capturer_wrapper.h"
 #include "base/ipc/ipc_channel.h"
 #include "base/ipc/shared_memory_factory.h"
+#include "base/memory/arena_message.h"
 #include "common/clipboard_monitor.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <filesystem>
+
 namespace base {
 class AudioCapturerWrapper;
 class CaptureScheduler;
+class FrameTraceWriter;
 class TaskRunner;
 class Thread;
 class SharedFrame;
@@ -60,36 +64,100 @@ protected:
     void onSharedMemoryDestroy(int id) override;
 
     // base::ScreenCapturerWrapper::Delegate implementation.
-    void onScreenListChanged(const base::ScreenCapturer::ScreenList& list,
-                             base::ScreenCapturer::ScreenId current) override;
+    void onScreenListChanged(const base::ScreenCapturer::ScreenList& screens,
+                             base::ScreenCapturer::ScreenId current_screen,
+                             const base::ScreenCapturer::ScreenList& windows,
+                             base::ScreenCapturer::ScreenId current_window) override;
     void onScreenCaptured(const base::Frame* frame,
                           const base::MouseCursor* mouse_cursor) override;
+    void onFrameAvailable() override;
 
     // common::Clipboard::Delegate implementation.
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
 
 private:
     void setEnabled(bool enable);
+    void setCapturePaused(bool paused);
+    void startCapture();
+    void createScreenCapturer();
+    void scheduleInputFlush();
+    void flushInput();
     void captureBegin();
     void captureEnd(const std::chrono::milliseconds& update_interval);
+    void onCaptureTimer(uint32_t capture_timer_id);
+    void onFrameReady();
+    void wakeUpCapture();
+    void scheduleCursorPosition();
+    void onCursorPositionTimer();
+    bool sendCursorPosition();
+    void startFrameTrace();
+    void writeFrameTrace(const base::Frame& frame, int64_t diff_time);
+    void addScreenRects(const base::Frame& frame,
+                        proto::internal::DesktopFrame* serialized_frame) const;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
 
     std::unique_ptr<base::IpcChannel> channel_;
-    std::unique_ptr<proto::internal::ServiceToDesktop> incoming_message_;
-    std::unique_ptr<proto::internal::DesktopToService> outgoing_message_;
+    base::ArenaMessage<proto::internal::ServiceToDesktop> incoming_message_;
+    base::ArenaMessage<proto::internal::DesktopToService> outgoing_message_;
 
     std::unique_ptr<common::ClipboardMonitor> clipboard_monitor_;
     std::unique_ptr<InputInjector> input_injector_;
 
+    // The input events received in one pass of the IPC channel are injected together.
+    bool input_flush_pending_ = false;
+
     std::unique_ptr<base::SharedMemoryFactory> shared_memory_factory_;
     std::unique_ptr<base::CaptureScheduler> capture_scheduler_;
     std::unique_ptr<base::ScreenCapturerWrapper> screen_capturer_;
     std::unique_ptr<base::AudioCapturerWrapper> audio_capturer_;
 
+    // Time when the current capture was started (microseconds since the Unix epoch).
+    int64_t capture_time_ = 0;
+
+    // Screens of the full desktop in the coordinates of the virtual screen. Empty if a single
+    // screen is captured.
+    std::vector<base::Rect> screen_rects_;
+
+    // No client shows the video. The capture loop stops at the next capture and is started again
+    // when the capture is resumed. If it is resumed before the loop has stopped, the loop simply
+    // goes on.
+    bool capture_paused_ = false;
+    bool capture_stopped_ = false;
+
+    // Captured frames which are not yet received by the service.
+    int frames_in_flight_ = 0;
+
+    // The next capture waits until the service receives one of the frames in flight.
+    bool capture_stalled_ = false;
+
+    // The next capture waits for the timer. A timer is ignored if its id is not the current one,
+    // so the capture can be started before it when the user input wakes up an idle capture.
+    bool capture_delayed_ = false;
+    uint32_t capture_timer_id_ = 0;
+
+    // If the capturer is frame driven, the timer does not capture an unchanged screen. The capture
+    // waits until the capturer has a new frame.
+    bool frame_ready_ = false;
+    bool capture_waiting_ = false;
+
+    // The last captured frame in the coordinates of the virtual screen and the last cursor
+    // position sent to the service (in the coordinates of the frame).
+    base::Rect frame_rect_;
+    base::Point last_cursor_position_;
+    bool has_cursor_position_ = false;
+    bool cursor_position_scheduled_ = false;
+
+    std::filesystem::path frame_trace_directory_;
+    std::unique_ptr<base::FrameTraceWriter> frame_trace_writer_;
+
     base::ScreenCapturer::Type preferred_video_capturer_ = base::ScreenCapturer::Type::DEFAULT;
     bool lock_at_disconnect_ = false;
 
+    // The screen capturer is kept initialized while the session is disabled (see
+    // SystemSettings::isWarmCapturerEnabled()).
+    bool warm_capturer_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionAgent);
 };
 
@@ -19,10 +19,14 @@
 #include "host/desktop_session_fake.h"
 
 #include "base/logging.h"
+#include "base/system_time.h"
 #include "base/task_runner.h"
 #include "base/desktop/frame_simple.h"
+#include "base/desktop/frame_trace_reader.h"
 #include "base/desktop/screen_capturer.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
@@ -30,12 +34,18 @@ namespace {
 const int kFrameWidth = 800;
 const int kFrameHeight = 600;
 
+// The longer pauses of the trace are shortened, so the loop does not stop for minutes.
+const std::chrono::milliseconds kMaxReplayInterval(1000);
+
 } // namespace
 
 class DesktopSessionFake::FrameGenerator : public std::enable_shared_from_this<FrameGenerator>
 {
 public:
-    explicit FrameGenerator(std::shared_ptr<base::TaskRunner> task_runner);
+    FrameGenerator(std::shared_ptr<base::TaskRunner> task_runner,
+                   std::unique_ptr<base::Frame> last_frame);
+    FrameGenerator(std::shared_ptr<base::TaskRunner> task_runner,
+                   const std::filesystem::path& trace_path);
     ~FrameGenerator() = default;
 
     void start(Delegate* delegate);
@@ -43,22 +53,43 @@ public:
     void generateFrame();
 
 private:
+    void replayFrame();
+
+    // Returns the next frame of the trace. At the end of the trace, it starts again.
+    const base::Frame* readTraceFrame();
 
     Delegate* delegate_ = nullptr;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::Frame> frame_;
 
+    // The frame is the last picture of the previous session. It is sent without changes.
+    bool is_last_frame_ = false;
+
+    std::filesystem::path trace_path_;
+    std::unique_ptr<base::FrameTraceReader> trace_reader_;
+
+    // The frame of the trace which is shown by the next call of replayFrame().
+    const base::Frame* next_trace_frame_ = nullptr;
+    bool replay_scheduled_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(FrameGenerator);
 };
 
-DesktopSessionFake::FrameGenerator::FrameGenerator(std::shared_ptr<base::TaskRunner> task_runner)
+DesktopSessionFake::FrameGenerator::FrameGenerator(
+    std::shared_ptr<base::TaskRunner> task_runner, std::unique_ptr<base::Frame> last_frame)
     : task_runner_(std::move(task_runner)),
-      frame_(base::FrameSimple::create(base::Size(kFrameWidth, kFrameHeight)))
-
+      frame_(std::move(last_frame))
 {
     DCHECK(task_runner_);
 
+    if (frame_)
+    {
+        is_last_frame_ = true;
+        return;
+    }
+
+    frame_ = base::FrameSimple::create(base::Size(kFrameWidth, kFrameHeight));
     if (!frame_)
     {
         LOG(LS_ERROR) << "Frame not created";
@@ -71,12 +102,29 @@ DesktopSessionFake::FrameGenerator::FrameGenerator(std::shared_ptr<base::TaskRun
     frame_->setDpi(base::Point(96, 96));
 }
 
+DesktopSessionFake::FrameGenerator::FrameGenerator(
+    std::shared_ptr<base::TaskRunner> task_runner, const std::filesystem::path& trace_path)
+    : task_runner_(std::move(task_runner)),
+      trace_path_(trace_path)
+{
+    DCHECK(task_runner_);
+    DCHECK(!trace_path_.empty());
+}
+
 void DesktopSessionFake::FrameGenerator::start(Delegate* delegate)
 {
     delegate_ = delegate;
     DCHECK(delegate);
 
-    generateFrame();
+    if (trace_path_.empty())
+    {
+        generateFrame();
+        return;
+    }
+
+    // The replay is continued if it was only paused.
+    if (!replay_scheduled_)
+        replayFrame();
 }
 
 void DesktopSessionFake::FrameGenerator::stop()
@@ -86,6 +134,11 @@ void DesktopSessionFake::FrameGenerator::stop()
 
 void DesktopSessionFake::FrameGenerator::generateFrame()
 {
+    // The frames of the trace are sent by their own schedule. The clients get the complete picture
+    // with the next key frame of their encoders.
+    if (!trace_path_.empty())
+        return;
+
     if (!frame_)
     {
         LOG(LS_ERROR) << "No frame generated";
@@ -94,7 +147,11 @@ void DesktopSessionFake::FrameGenerator::generateFrame()
 
     base::Region* updated_region = frame_->updatedRegion();
     updated_region->clear();
-    updated_region->addRect(base::Rect::makeWH(kFrameWidth, kFrameHeight));
+
+    // The clients already have the last frame, so nothing is encoded. A client which connects now
+    // gets it as a key frame.
+    if (!is_last_frame_)
+        updated_region->addRect(base::Rect::makeWH(kFrameWidth, kFrameHeight));
 
     if (delegate_)
     {
@@ -110,9 +167,111 @@ void DesktopSessionFake::FrameGenerator::generateFrame()
     }
 }
 
-DesktopSessionFake::DesktopSessionFake(
-    std::shared_ptr<base::TaskRunner> task_runner, Delegate* delegate)
-    : frame_generator_(std::make_shared<FrameGenerator>(std::move(task_runner))),
+void DesktopSessionFake::FrameGenerator::replayFrame()
+{
+    replay_scheduled_ = false;
+
+    if (!delegate_)
+        return;
+
+    if (!next_trace_frame_)
+        next_trace_frame_ = readTraceFrame();
+
+    const base::Frame* trace_frame = next_trace_frame_;
+    if (!trace_frame)
+        return;
+
+    if (!frame_ || frame_->size() != trace_frame->size())
+    {
+        frame_ = base::FrameSimple::create(trace_frame->size());
+        if (!frame_)
+        {
+            LOG(LS_ERROR) << "Frame not created";
+            return;
+        }
+
+        frame_->setDpi(base::Point(96, 96));
+    }
+
+    // The first frame of each size in the trace is complete, the next ones contain only the
+    // changed pixels.
+    const base::Region& trace_region = trace_frame->constUpdatedRegion();
+    for (base::Region::Iterator it(trace_region); !it.isAtEnd(); it.advance())
+        frame_->copyPixelsFrom(*trace_frame, it.rect().topLeft(), it.rect());
+
+    *frame_->updatedRegion() = trace_region;
+    frame_->setCapturerType(trace_frame->capturerType());
+
+    // The recorded duration of the capture is kept, so the latency of the host matches the
+    // recorded one.
+    const int64_t recorded_capture_time = trace_frame->captureTime();
+    const int64_t capture_duration = std::max(
+        trace_frame->diffTime() - recorded_capture_time, static_cast<int64_t>(0));
+    const int64_t now = base::SystemTime::microsecondsSinceEpoch();
+
+    frame_->setCaptureTime(now - capture_duration);
+    frame_->setDiffTime(now);
+
+    delegate_->onScreenCaptured(frame_.get(), nullptr);
+
+    // The reader updates the pixels of its frame in place, so the next frame is read only after
+    // the current one is copied.
+    next_trace_frame_ = readTraceFrame();
+    if (!next_trace_frame_)
+        return;
+
+    std::chrono::milliseconds interval((next_trace_frame_->captureTime() - recorded_capture_time) /
+                                       1000);
+    interval = std::clamp(interval, std::chrono::milliseconds(0), kMaxReplayInterval);
+
+    replay_scheduled_ = true;
+    task_runner_->postDelayedTask(
+        std::bind(&FrameGenerator::replayFrame, shared_from_this()), interval);
+}
+
+const base::Frame* DesktopSessionFake::FrameGenerator::readTraceFrame()
+{
+    // Two attempts: the current pass of the trace can end, then the trace is opened again.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        if (!trace_reader_)
+        {
+            trace_reader_ = base::FrameTraceReader::open(trace_path_);
+            if (!trace_reader_)
+            {
+                LOG(LS_ERROR) << "Unable to open frame trace: " << trace_path_;
+                return nullptr;
+            }
+        }
+
+        const base::Frame* frame = trace_reader_->readFrame();
+        if (frame)
+            return frame;
+
+        if (trace_reader_->hasError())
+            LOG(LS_WARNING) << "Frame trace is corrupted: " << trace_path_;
+
+        trace_reader_.reset();
+    }
+
+    LOG(LS_ERROR) << "Frame trace has no frames: " << trace_path_;
+    return nullptr;
+}
+
+DesktopSessionFake::DesktopSessionFake(std::shared_ptr<base::TaskRunner> task_runner,
+                                       Delegate* delegate,
+                                       std::unique_ptr<base::Frame> last_frame)
+    : frame_generator_(
+          std::make_shared<FrameGenerator>(std::move(task_runner), std::move(last_frame))),
+      delegate_(delegate)
+{
+    DCHECK(delegate_);
+}
+
+DesktopSessionFake::DesktopSessionFake(std::shared_ptr<base::TaskRunner> task_runner,
+                                       Delegate* delegate,
+                                       const std::filesystem::path& trace_path)
+    : frame_generator_(std::make_shared<FrameGenerator>(std::move(task_runner), trace_path)),
       delegate_(delegate)
 {
     DCHECK(delegate_);
@@ -140,10 +299,12 @@ void DesktopSessionFake::control(proto::internal::Control::Action action)
     switch (action)
     {
         case proto::internal::Control::ENABLE:
+        case proto::internal::Control::RESUME_CAPTURE:
             frame_generator_->start(delegate_);
             break;
 
         case proto::internal::Control::DISABLE:
+        case proto::internal::Control::PAUSE_CAPTURE:
             frame_generator_->stop();
             break;
 
@@ -167,6 +328,11 @@ void DesktopSessionFake::captureScreen()
     frame_generator_->generateFrame();
 }
 
+void DesktopSessionFake::setPendingMessages(uint32_t /* pending_messages */)
+{
+    // Nothing
+}
+
 void DesktopSessionFake::injectKeyEvent(const proto::KeyEvent& /* event */)
 {
     // Nothing
@@ -22,7 +22,10 @@
 #include "base/macros_magic.h"
 #include "host/desktop_session.h"
 
+#include <filesystem>
+
 namespace base {
+class Frame;
 class TaskRunner;
 } // namespace base
 
@@ -31,7 +34,18 @@ namespace host {
 class DesktopSessionFake : public DesktopSession
 {
 public:
-    DesktopSessionFake(std::shared_ptr<base::TaskRunner> task_runner, Delegate* delegate);
+    // If |last_frame| is set, it is shown instead of a black screen. A frame of the previous
+    // session keeps the size of the video, so the clients keep their encoders and do not need a
+    // key frame when the next session starts.
+    DesktopSessionFake(std::shared_ptr<base::TaskRunner> task_runner,
+                       Delegate* delegate,
+                       std::unique_ptr<base::Frame> last_frame = nullptr);
+
+    // The frames of the trace |trace_path| are shown in a loop with the recorded intervals between
+    // them. The capture times of the frames are shifted to the current time.
+    DesktopSessionFake(std::shared_ptr<base::TaskRunner> task_runner,
+                       Delegate* delegate,
+                       const std::filesystem::path& trace_path);
     ~DesktopSessionFake();
 
     // DesktopSession implementation.
@@ -41,6 +55,7 @@ public:
     void configure(const Config& config) override;
     void selectScreen(const proto::Screen& screen) override;
     void captureScreen() override;
+    void setPendingMessages(uint32_t pending_messages) override;
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
     void injectClipboardEvent(const proto::ClipboardEvent& event) override;
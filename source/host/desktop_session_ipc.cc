@@ -19,6 +19,7 @@
 #include "host/desktop_session_ipc.h"
 
 #include "base/logging.h"
+#include "base/desktop/frame_simple.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/shared_memory_frame.h"
 #include "base/ipc/shared_memory.h"
@@ -70,8 +71,6 @@ private:
 
 DesktopSessionIpc::DesktopSessionIpc(std::unique_ptr<base::IpcChannel> channel, Delegate* delegate)
     : channel_(std::move(channel)),
-      outgoing_message_(std::make_unique<proto::internal::ServiceToDesktop>()),
-      incoming_message_(std::make_unique<proto::internal::DesktopToService>()),
       delegate_(delegate)
 {
     DCHECK(channel_);
@@ -88,6 +87,9 @@ void DesktopSessionIpc::start()
     channel_->setListener(this);
     channel_->resume();
 
+    // Frequent small messages (screen updates, cursor shapes, input events) go through the ring.
+    channel_->enableSharedMemoryRing();
+
     delegate_->onDesktopSessionStarted();
 }
 
@@ -98,14 +100,14 @@ void DesktopSessionIpc::stop()
 
 void DesktopSessionIpc::control(proto::internal::Control::Action action)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_control()->set_action(action);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionIpc::configure(const Config& config)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::Configure* configure = outgoing_message_->mutable_configure();
     configure->set_disable_font_smoothing(config.disable_font_smoothing);
@@ -119,7 +121,7 @@ void DesktopSessionIpc::configure(const Config& config)
 
 void DesktopSessionIpc::selectScreen(const proto::Screen& screen)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_select_source()->mutable_screen()->CopyFrom(screen);
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -128,7 +130,9 @@ void DesktopSessionIpc::captureScreen()
 {
     if (last_frame_)
     {
+        // The whole frame is sent again, there is no previous frame to copy from.
         last_frame_->updatedRegion()->addRect(base::Rect::makeSize(last_frame_->size()));
+        last_frame_->setCopyRect(base::Rect(), base::Point());
 
         if (last_screen_list_)
             delegate_->onScreenListChanged(*last_screen_list_);
@@ -137,33 +141,52 @@ void DesktopSessionIpc::captureScreen()
     }
     else
     {
-        outgoing_message_->Clear();
+        outgoing_message_.clear();
         outgoing_message_->mutable_next_screen_capture()->set_update_interval(0);
         channel_->send(base::serialize(*outgoing_message_));
     }
 }
 
+void DesktopSessionIpc::setPendingMessages(uint32_t pending_messages)
+{
+    pending_messages_ = pending_messages;
+}
+
 void DesktopSessionIpc::injectKeyEvent(const proto::KeyEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_key_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionIpc::injectMouseEvent(const proto::MouseEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_mouse_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionIpc::injectClipboardEvent(const proto::ClipboardEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
+std::unique_ptr<base::Frame> DesktopSessionIpc::copyLastFrame() const
+{
+    if (!last_frame_)
+        return nullptr;
+
+    std::unique_ptr<base::Frame> frame = base::FrameSimple::create(last_frame_->size());
+    if (!frame)
+        return nullptr;
+
+    frame->copyPixelsFrom(*last_frame_, base::Point(0, 0), base::Rect::makeSize(frame->size()));
+    frame->copyFrameInfoFrom(*last_frame_);
+    return frame;
+}
+
 void DesktopSessionIpc::onDisconnected()
 {
     if (delegate_)
@@ -175,7 +198,7 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
     if (!delegate_)
         return;
 
-    incoming_message_->Clear();
+    incoming_message_.clear();
 
     if (!base::parse(buffer, incoming_message_.get()))
     {
@@ -187,6 +210,11 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
     {
         onScreenCaptured(incoming_message_->screen_captured());
     }
+    else if (incoming_message_->has_cursor_position())
+    {
+        const proto::CursorPosition& cursor_position = incoming_message_->cursor_position();
+        delegate_->onCursorPositionChanged(base::Point(cursor_position.x(), cursor_position.y()));
+    }
     else if (incoming_message_->has_audio_packet())
     {
         onAudioCaptured(incoming_message_->audio_packet());
@@ -244,6 +272,41 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
             last_frame_->setCapturerType(serialized_frame.capturer_type());
             last_frame_->setDpi(base::Point(
                 serialized_frame.dpi_x(), serialized_frame.dpi_y()));
+            last_frame_->setCaptureTime(serialized_frame.capture_time());
+            last_frame_->setDiffTime(serialized_frame.diff_time());
+
+            if (serialized_frame.has_active_window_rect())
+            {
+                const proto::Rect& rect = serialized_frame.active_window_rect();
+                last_frame_->setActiveWindowRect(
+                    base::Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height()));
+            }
+            else
+            {
+                last_frame_->setActiveWindowRect(base::Rect());
+            }
+
+            std::vector<base::Rect> screen_rects;
+            screen_rects.reserve(serialized_frame.screen_rect_size());
+
+            for (int i = 0; i < serialized_frame.screen_rect_size(); ++i)
+            {
+                const proto::Rect& rect = serialized_frame.screen_rect(i);
+                screen_rects.emplace_back(
+                    base::Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height()));
+            }
+
+            last_frame_->setScreenRects(screen_rects);
+
+            if (serialized_frame.has_copy_rect())
+            {
+                const proto::VideoCopyRect& copy_rect = serialized_frame.copy_rect();
+                const proto::Rect& rect = copy_rect.rect();
+
+                last_frame_->setCopyRect(
+                    base::Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height()),
+                    base::Point(copy_rect.source_x(), copy_rect.source_y()));
+            }
 
             base::Region* updated_region = last_frame_->updatedRegion();
 
@@ -274,11 +337,19 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
         mouse_cursor = last_mouse_cursor_.get();
     }
 
-    delegate_->onScreenCaptured(frame, mouse_cursor);
+    // The agent captures the next frame into another buffer of its frame queue. The buffer of
+    // this frame is not written until the next frame is received, so the next capture is started
+    // before this frame is encoded.
+    outgoing_message_.clear();
+
+    proto::internal::NextScreenCapture* next_screen_capture =
+        outgoing_message_->mutable_next_screen_capture();
+    next_screen_capture->set_update_interval(40);
+    next_screen_capture->set_pending_messages(pending_messages_);
 
-    outgoing_message_->Clear();
-    outgoing_message_->mutable_next_screen_capture()->set_update_interval(40);
     channel_->send(base::serialize(*outgoing_message_));
+
+    delegate_->onScreenCaptured(frame, mouse_cursor);
 }
 
 void DesktopSessionIpc::onAudioCaptured(const proto::AudioPacket& audio_packet)
@@ -20,6 +20,7 @@
 #define HOST__DESKTOP_SESSION_IPC_H
 
 #include "base/ipc/ipc_channel.h"
+#include "base/memory/arena_message.h"
 #include "host/desktop_session.h"
 
 namespace host {
@@ -39,10 +40,15 @@ public:
     void configure(const Config& config) override;
     void selectScreen(const proto::Screen& screen) override;
     void captureScreen() override;
+    void setPendingMessages(uint32_t pending_messages) override;
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
     void injectClipboardEvent(const proto::ClipboardEvent& event) override;
 
+    // Returns a copy of the last frame received from the session process or nullptr if there is
+    // no frame.
+    std::unique_ptr<base::Frame> copyLastFrame() const;
+
 protected:
     // base::IpcChannel::Listener implementation.
     void onDisconnected() override;
@@ -64,10 +70,12 @@ private:
     std::unique_ptr<base::MouseCursor> last_mouse_cursor_;
     std::unique_ptr<proto::ScreenList> last_screen_list_;
 
-    std::unique_ptr<proto::internal::ServiceToDesktop> outgoing_message_;
-    std::unique_ptr<proto::internal::DesktopToService> incoming_message_;
+    base::ArenaMessage<proto::internal::ServiceToDesktop> outgoing_message_;
+    base::ArenaMessage<proto::internal::DesktopToService> incoming_message_;
     Delegate* delegate_;
 
+    uint32_t pending_messages_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionIpc);
 };
 
@@ -27,6 +27,7 @@
 #include "host/desktop_session_ipc.h"
 #include "host/desktop_session_process.h"
 #include "host/desktop_session_proxy.h"
+#include "host/system_settings.h"
 
 namespace host {
 
@@ -66,6 +67,21 @@ void DesktopSessionManager::attachSession(
 
     state_ = State::STARTING;
 
+    const std::filesystem::path replay_trace(SystemSettings().replayFrameTrace());
+    if (!replay_trace.empty())
+    {
+        LOG(LS_INFO) << "Frame trace is replayed instead of the session: " << replay_trace;
+
+        session_attach_timer_.stop();
+        is_replay_ = true;
+
+        session_ = std::make_unique<DesktopSessionFake>(task_runner_, this, replay_trace);
+
+        state_ = State::ATTACHED;
+        session_proxy_->attachAndStart(session_.get());
+        return;
+    }
+
     std::u16string channel_id = base::IpcServer::createUniqueId();
 
     server_ = std::make_unique<base::IpcServer>();
@@ -95,6 +111,15 @@ void DesktopSessionManager::dettachSession(const base::Location& location)
 
     LOG(LS_INFO) << "Dettach session (from: " << location.toString() << ")";
 
+    // While the next session process starts, the clients see the last picture of the session
+    // instead of a black screen of another size.
+    std::unique_ptr<base::Frame> last_frame;
+    const bool is_replay = is_replay_;
+    is_replay_ = false;
+
+    if (state_ == State::ATTACHED && session_ && !is_replay)
+        last_frame = static_cast<DesktopSessionIpc*>(session_.get())->copyLastFrame();
+
     if (state_ != State::STOPPING)
         state_ = State::DETACHED;
 
@@ -107,6 +132,11 @@ void DesktopSessionManager::dettachSession(const base::Location& location)
     if (state_ == State::STOPPING)
         return;
 
+    // The replay does not depend on the sessions of the system, it is started again at the next
+    // attach.
+    if (is_replay)
+        return;
+
     session_attach_timer_.start(std::chrono::minutes(1), [this]()
     {
         LOG(LS_ERROR) << "Timeout while waiting for session";
@@ -114,7 +144,7 @@ void DesktopSessionManager::dettachSession(const base::Location& location)
     });
 
     // The real session process has ended. We create a temporary fake session.
-    session_ = std::make_unique<DesktopSessionFake>(task_runner_, this);
+    session_ = std::make_unique<DesktopSessionFake>(task_runner_, this, std::move(last_frame));
     session_proxy_->attachAndStart(session_.get());
 }
 
@@ -173,6 +203,11 @@ void DesktopSessionManager::onScreenCaptured(
     delegate_->onScreenCaptured(frame, mouse_cursor);
 }
 
+void DesktopSessionManager::onCursorPositionChanged(const base::Point& position)
+{
+    delegate_->onCursorPositionChanged(position);
+}
+
 void DesktopSessionManager::onAudioCaptured(const proto::AudioPacket& audio_packet)
 {
     delegate_->onAudioCaptured(audio_packet);
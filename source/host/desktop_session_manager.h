@@ -59,6 +59,7 @@ protected:
     void onDesktopSessionStarted() override;
     void onDesktopSessionStopped() override;
     void onScreenCaptured(const base::Frame* frame, const base::MouseCursor* mouse_cursor) override;
+    void onCursorPositionChanged(const base::Point& position) override;
     void onAudioCaptured(const proto::AudioPacket& audio_packet) override;
     void onScreenListChanged(const proto::ScreenList& list) override;
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
@@ -75,6 +76,9 @@ private:
     State state_ = State::STOPPED;
     DesktopSession::Delegate* delegate_;
 
+    // The session is a replay of a frame trace (see SystemSettings::replayFrameTrace()).
+    bool is_replay_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionManager);
 };
 
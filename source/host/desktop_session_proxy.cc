@@ -53,6 +53,12 @@ void DesktopSessionProxy::captureScreen()
         desktop_session_->captureScreen();
 }
 
+void DesktopSessionProxy::setPendingMessages(uint32_t pending_messages)
+{
+    if (desktop_session_)
+        desktop_session_->setPendingMessages(pending_messages);
+}
+
 void DesktopSessionProxy::injectKeyEvent(const proto::KeyEvent& event)
 {
     if (desktop_session_)
@@ -36,6 +36,7 @@ public:
     void configure(const DesktopSession::Config& config);
     void selectScreen(const proto::Screen& screen);
     void captureScreen();
+    void setPendingMessages(uint32_t pending_messages);
     void injectKeyEvent(const proto::KeyEvent& event);
     void injectMouseEvent(const proto::MouseEvent& event);
     void injectClipboardEvent(const proto::ClipboardEvent& event);
@@ -32,6 +32,13 @@ std::string sessionKey(std::string_view session_name)
     return base::strCat({ "session/", base::toHex(session_hash) });
 }
 
+std::string hostIdKey(std::string_view router, std::string_view session_name)
+{
+    base::ByteArray hash = base::GenericHash::hash(
+        base::GenericHash::Type::BLAKE2s256, base::strCat({ router, "/", session_name }));
+    return base::strCat({ "host_id/", base::toHex(hash) });
+}
+
 } // namespace
 
 HostKeyStorage::HostKeyStorage()
@@ -60,4 +67,17 @@ void HostKeyStorage::setKey(std::string_view session_name, const base::ByteArray
     impl_.flush();
 }
 
+base::HostId HostKeyStorage::lastHostId(
+    std::string_view router, std::string_view session_name) const
+{
+    return impl_.get<base::HostId>(hostIdKey(router, session_name), base::kInvalidHostId);
+}
+
+void HostKeyStorage::setLastHostId(
+    std::string_view router, std::string_view session_name, base::HostId host_id)
+{
+    impl_.set<base::HostId>(hostIdKey(router, session_name), host_id);
+    impl_.flush();
+}
+
 } // namespace host
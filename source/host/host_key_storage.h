@@ -20,6 +20,7 @@
 #define HOST__HOST_KEY_STORAGE_H
 
 #include "base/macros_magic.h"
+#include "base/peer/host_id.h"
 #include "base/settings/json_settings.h"
 
 namespace host {
@@ -33,6 +34,13 @@ public:
     base::ByteArray key(std::string_view session_name) const;
     void setKey(std::string_view session_name, const base::ByteArray& key);
 
+    // The ID last assigned to the session by router |router|. Lets the host show its ID before
+    // the router confirms it.
+    base::HostId lastHostId(std::string_view router, std::string_view session_name) const;
+    void setLastHostId(std::string_view router,
+                       std::string_view session_name,
+                       base::HostId host_id);
+
 private:
     base::JsonSettings impl_;
 
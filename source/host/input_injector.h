@@ -34,6 +34,13 @@ public:
     virtual void setBlockInput(bool enable) = 0;
     virtual void injectKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void injectMouseEvent(const proto::MouseEvent& event) = 0;
+
+    // Injectors may queue the events and inject them together. The queued events are injected when
+    // flush() is called. By default the events are injected at once.
+    virtual void flush()
+    {
+        // Nothing
+    }
 };
 
 } // namespace host
@@ -31,8 +31,10 @@ const uint32_t kUsbCodeLeftCtrl = 0x0700e0;
 const uint32_t kUsbCodeRightCtrl = 0x0700e4;
 const uint32_t kUsbCodeLeftAlt = 0x0700e2;
 const uint32_t kUsbCodeRightAlt = 0x0700e6;
+const uint32_t kUsbCodeCapsLock = 0x070039;
+const uint32_t kUsbCodeNumLock = 0x070053;
 
-void sendKeyboardScancode(WORD scancode, DWORD flags)
+void addKeyboardScancode(std::vector<INPUT>* inputs, WORD scancode, DWORD flags)
 {
     INPUT input;
     memset(&input, 0, sizeof(input));
@@ -49,14 +51,10 @@ void sendKeyboardScancode(WORD scancode, DWORD flags)
             input.ki.dwFlags |= KEYEVENTF_EXTENDEDKEY;
     }
 
-    // Do the keyboard event.
-    if (!SendInput(1, &input, sizeof(input)))
-    {
-        PLOG(LS_WARNING) << "SendInput failed";
-    }
+    inputs->emplace_back(input);
 }
 
-void sendKeyboardVirtualKey(WORD key_code, DWORD flags)
+void addKeyboardVirtualKey(std::vector<INPUT>* inputs, WORD key_code, DWORD flags)
 {
     INPUT input;
     memset(&input, 0, sizeof(input));
@@ -66,11 +64,7 @@ void sendKeyboardVirtualKey(WORD key_code, DWORD flags)
     input.ki.dwFlags = flags;
     input.ki.wScan   = static_cast<WORD>(MapVirtualKeyW(key_code, MAPVK_VK_TO_VSC));
 
-    // Do the keyboard event.
-    if (!SendInput(1, &input, sizeof(input)))
-    {
-        PLOG(LS_WARNING) << "SendInput failed";
-    }
+    inputs->emplace_back(input);
 }
 
 } // namespace
@@ -84,10 +78,12 @@ InputInjectorWin::~InputInjectorWin()
         int scancode = common::KeycodeConverter::usbKeycodeToNativeKeycode(key);
         if (scancode != common::KeycodeConverter::invalidNativeKeycode())
         {
-            sendKeyboardScancode(
-                static_cast<WORD>(scancode), KEYEVENTF_SCANCODE | KEYEVENTF_KEYUP);
+            addKeyboardScancode(
+                &pending_input_, static_cast<WORD>(scancode), KEYEVENTF_SCANCODE | KEYEVENTF_KEYUP);
         }
     }
+
+    flush();
 }
 
 void InputInjectorWin::setScreenOffset(const base::Point& offset)
@@ -110,6 +106,8 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
 
         if (event.usb_keycode() == kUsbCodeDelete && isCtrlAndAltPressed())
         {
+            // The keys pressed before are injected first.
+            flush();
             injectSAS();
             return;
         }
@@ -123,15 +121,18 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
     if (scancode == common::KeycodeConverter::invalidNativeKeycode())
         return;
 
-    switchToInputDesktop();
+    // The state of the lock keys is read from the system. Events which change it are injected at
+    // once, so the state is never behind the queued events.
+    bool lock_changed = false;
 
     bool prev_state = GetKeyState(VK_CAPITAL) != 0;
     bool curr_state = (event.flags() & proto::KeyEvent::CAPSLOCK) != 0;
 
     if (prev_state != curr_state)
     {
-        sendKeyboardVirtualKey(VK_CAPITAL, 0);
-        sendKeyboardVirtualKey(VK_CAPITAL, KEYEVENTF_KEYUP);
+        addKeyboardVirtualKey(&pending_input_, VK_CAPITAL, 0);
+        addKeyboardVirtualKey(&pending_input_, VK_CAPITAL, KEYEVENTF_KEYUP);
+        lock_changed = true;
     }
 
     prev_state = GetKeyState(VK_NUMLOCK) != 0;
@@ -139,8 +140,9 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
 
     if (prev_state != curr_state)
     {
-        sendKeyboardVirtualKey(VK_NUMLOCK, 0);
-        sendKeyboardVirtualKey(VK_NUMLOCK, KEYEVENTF_KEYUP);
+        addKeyboardVirtualKey(&pending_input_, VK_NUMLOCK, 0);
+        addKeyboardVirtualKey(&pending_input_, VK_NUMLOCK, KEYEVENTF_KEYUP);
+        lock_changed = true;
     }
 
     DWORD flags = KEYEVENTF_SCANCODE;
@@ -148,13 +150,17 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
     if (!(event.flags() & proto::KeyEvent::PRESSED))
         flags |= KEYEVENTF_KEYUP;
 
-    sendKeyboardScancode(static_cast<WORD>(scancode), flags);
+    addKeyboardScancode(&pending_input_, static_cast<WORD>(scancode), flags);
+
+    if (lock_changed ||
+        event.usb_keycode() == kUsbCodeCapsLock || event.usb_keycode() == kUsbCodeNumLock)
+    {
+        flush();
+    }
 }
 
 void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
 {
-    switchToInputDesktop();
-
     base::Size full_size(GetSystemMetrics(SM_CXVIRTUALSCREEN),
                          GetSystemMetrics(SM_CYVIRTUALSCREEN));
     if (full_size.width() <= 1 || full_size.height() <= 1)
@@ -225,13 +231,27 @@ void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
     input.mi.mouseData = wheel_movement;
     input.mi.dwFlags = flags;
 
-    // Do the mouse event.
-    if (!SendInput(1, &input, sizeof(input)))
+    pending_input_.emplace_back(input);
+    last_mouse_mask_ = mask;
+}
+
+void InputInjectorWin::flush()
+{
+    if (pending_input_.empty())
+        return;
+
+    switchToInputDesktop();
+
+    // All queued events are injected with one call. The system does not interleave them with the
+    // events of other sources.
+    const UINT count = static_cast<UINT>(pending_input_.size());
+    const UINT sent = SendInput(count, pending_input_.data(), sizeof(INPUT));
+    if (sent != count)
     {
-        PLOG(LS_WARNING) << "SendInput failed";
+        PLOG(LS_WARNING) << "SendInput failed (" << sent << " of " << count << " events sent)";
     }
 
-    last_mouse_mask_ = mask;
+    pending_input_.clear();
 }
 
 void InputInjectorWin::switchToInputDesktop()
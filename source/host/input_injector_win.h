@@ -22,6 +22,8 @@
 #include "base/win/scoped_thread_desktop.h"
 #include "host/input_injector.h"
 
+#include <vector>
+
 namespace host {
 
 class InputInjectorWin : public InputInjector
@@ -35,6 +37,7 @@ public:
     void setBlockInput(bool enable) override;
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
+    void flush() override;
 
 private:
     void switchToInputDesktop();
@@ -42,6 +45,9 @@ private:
 
     base::ScopedThreadDesktop desktop_;
 
+    // Events which are injected by the next call of flush().
+    std::vector<INPUT> pending_input_;
+
     bool block_input_ = false;
     std::set<uint32_t> pressed_keys_;
 
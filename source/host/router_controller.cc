@@ -20,16 +20,23 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/crypto/random.h"
 #include "base/peer/client_authenticator.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/strcat.h"
 #include "base/strings/unicode.h"
 #include "host/host_key_storage.h"
 #include "proto/router_peer.pb.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
 
-const std::chrono::seconds kReconnectTimeout{ 10 };
+const std::chrono::milliseconds kMinReconnectTimeout{ 2000 };
+const std::chrono::milliseconds kMaxReconnectTimeout{ 60000 };
+const int kMaxReconnectDoublings = 5;
 
 } // namespace
 
@@ -67,10 +74,31 @@ void RouterController::hostIdRequest(const std::string& session_name)
     HostKeyStorage host_key_storage;
     base::ByteArray host_key = host_key_storage.key(session_name);
 
+    if (!host_key.empty())
+    {
+        // The router assigns the same ID for the same key. The ID is shown at once and the
+        // request only confirms it.
+        base::HostId host_id = host_key_storage.lastHostId(routerKey(), session_name);
+        if (host_id != base::kInvalidHostId && delegate_)
+        {
+            LOG(LS_INFO) << "Last known host ID: " << host_id;
+            delegate_->onHostIdAssigned(session_name, host_id);
+        }
+    }
+
+    if (!is_connected_)
+    {
+        // The session requests the ID again when the router becomes connected.
+        LOG(LS_INFO) << "Router is not connected yet. ID request postponed";
+        return;
+    }
+
     pending_id_requests_.emplace(session_name);
 
     proto::PeerToRouter message;
     proto::HostIdRequest* host_id_request = message.mutable_host_id_request();
+    host_id_request->set_direct_port(router_info_.direct_port);
+    host_id_request->set_hole_punching(true);
 
     if (host_key.empty())
     {
@@ -91,6 +119,10 @@ void RouterController::hostIdRequest(const std::string& session_name)
 
 void RouterController::resetHostId(base::HostId host_id)
 {
+    // The router forgets the IDs of the host when the connection is lost.
+    if (!is_connected_)
+        return;
+
     proto::PeerToRouter message;
     message.mutable_reset_host_id()->set_host_id(host_id);
 
@@ -121,6 +153,9 @@ void RouterController::onConnected()
             channel_ = authenticator_->takeChannel();
             channel_->setListener(this);
 
+            is_connected_ = true;
+            reconnect_attempts_ = 0;
+
             LOG(LS_INFO) << "Router connected";
             routerStateChanged(proto::internal::RouterState::CONNECTED);
 
@@ -144,6 +179,11 @@ void RouterController::onDisconnected(base::NetworkChannel::ErrorCode error_code
     LOG(LS_INFO) << "Connection to the router is lost ("
                  << base::NetworkChannel::errorToString(error_code) << ")";
 
+    is_connected_ = false;
+
+    // The ID requests sent before are not answered.
+    pending_id_requests_ = std::queue<std::string>();
+
     routerStateChanged(proto::internal::RouterState::FAILED);
     delayedConnectToRouter();
 }
@@ -172,15 +212,19 @@ void RouterController::onMessageReceived(const base::ByteArray& buffer)
             return;
         }
 
+        const std::string& session_name = pending_id_requests_.front();
+        HostKeyStorage host_key_storage;
+
         base::ByteArray host_key = base::fromStdString(host_id_response.key());
         if (!host_key.empty())
         {
             LOG(LS_INFO) << "New host key received";
-
-            HostKeyStorage host_key_storage;
-            host_key_storage.setKey(pending_id_requests_.front(), host_key);
+            host_key_storage.setKey(session_name, host_key);
         }
 
+        if (host_key_storage.lastHostId(routerKey(), session_name) != host_id_response.host_id())
+            host_key_storage.setLastHostId(routerKey(), session_name, host_id_response.host_id());
+
         LOG(LS_INFO) << "Host ID received: " << host_id_response.host_id();
 
         delegate_->onHostIdAssigned(pending_id_requests_.front(), host_id_response.host_id());
@@ -195,7 +239,21 @@ void RouterController::onMessageReceived(const base::ByteArray& buffer)
         if (connection_offer.error_code() == proto::ConnectionOffer::SUCCESS &&
             connection_offer.peer_role() == proto::ConnectionOffer::HOST)
         {
-            peer_manager_->addConnectionOffer(connection_offer.relay());
+            const asio::ip::tcp::endpoint local_endpoint = channel_->localEndpoint();
+
+            std::optional<asio::ip::tcp::endpoint> peer_endpoint =
+                base::HolePuncher::peerEndpoint(
+                    connection_offer.peer_address(), connection_offer.peer_port(), local_endpoint);
+
+            if (peer_endpoint.has_value())
+            {
+                peer_manager_->addConnectionOffer(
+                    connection_offer.relay(), local_endpoint, *peer_endpoint);
+            }
+            else
+            {
+                peer_manager_->addConnectionOffer(connection_offer.relay());
+            }
         }
     }
     else
@@ -219,17 +277,37 @@ void RouterController::connectToRouter()
 {
     LOG(LS_INFO) << "Connecting to router...";
 
+    is_connected_ = false;
     routerStateChanged(proto::internal::RouterState::CONNECTING);
 
     channel_ = std::make_unique<base::NetworkChannel>();
     channel_->setListener(this);
+
+    // The local port of the connection is used for the hole punching.
+    channel_->setReuseAddress(true);
     channel_->connect(router_info_.address, router_info_.port);
 }
 
 void RouterController::delayedConnectToRouter()
 {
-    LOG(LS_INFO) << "Reconnect after " << kReconnectTimeout.count() << " seconds";
-    reconnect_timer_.start(kReconnectTimeout, std::bind(&RouterController::connectToRouter, this));
+    // After a network failure or a restart of the router all its hosts lose the connection at the
+    // same time. The delay grows with each failed attempt and has a random part, so the router
+    // does not get all the handshakes at once.
+    std::chrono::milliseconds timeout =
+        kMinReconnectTimeout * (1 << std::min(reconnect_attempts_, kMaxReconnectDoublings));
+    timeout = std::min(timeout, kMaxReconnectTimeout);
+    timeout += std::chrono::milliseconds(base::Random::number32() % (timeout.count() / 2 + 1));
+
+    ++reconnect_attempts_;
+
+    LOG(LS_INFO) << "Reconnect after " << timeout.count() << " ms";
+    reconnect_timer_.start(timeout, std::bind(&RouterController::connectToRouter, this));
+}
+
+std::string RouterController::routerKey() const
+{
+    return base::utf8FromUtf16(base::strCat(
+        { router_info_.address, u":", base::numberToString16(router_info_.port) }));
 }
 
 void RouterController::routerStateChanged(proto::internal::RouterState::State state)
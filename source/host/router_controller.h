@@ -25,6 +25,8 @@
 #include "base/peer/relay_peer_manager.h"
 #include "proto/host_internal.pb.h"
 
+#include <queue>
+
 namespace base {
 class ClientAuthenticator;
 } // namespace base
@@ -44,6 +46,10 @@ public:
         std::u16string address;
         uint16_t port = 0;
         base::ByteArray public_key;
+
+        // The port of the direct connections to the host. Clients may try it while the relay
+        // connection is being established.
+        uint16_t direct_port = 0;
     };
 
     class Delegate
@@ -80,6 +86,9 @@ private:
     void delayedConnectToRouter();
     void routerStateChanged(proto::internal::RouterState::State state);
 
+    // Identifies the router in the host key storage.
+    std::string routerKey() const;
+
     Delegate* delegate_ = nullptr;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
@@ -88,6 +97,8 @@ private:
     std::unique_ptr<base::RelayPeerManager> peer_manager_;
     base::WaitableTimer reconnect_timer_;
     RouterInfo router_info_;
+    bool is_connected_ = false;
+    int reconnect_attempts_ = 0;
 
     std::queue<std::string> pending_id_requests_;
 
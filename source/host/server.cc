@@ -20,6 +20,8 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/crypto/srp_constants.h"
+#include "base/crypto/srp_ephemeral_pool.h"
 #include "base/files/base_paths.h"
 #include "base/files/file_path_watcher.h"
 #include "base/net/network_channel.h"
@@ -69,7 +71,14 @@ void Server::start()
     settings_watcher_->watch(settings_.filePath(), false,
         std::bind(&Server::updateConfiguration, this, std::placeholders::_1, std::placeholders::_2));
 
+    // The ephemerals of the default group of the users and of the group of the unknown users are
+    // calculated while the host waits for the connections.
+    srp_ephemeral_pool_ = std::make_shared<base::SrpEphemeralPool>();
+    srp_ephemeral_pool_->prepare(base::kSrpNgPair_4096);
+    srp_ephemeral_pool_->prepare(base::kSrpNgPair_8192);
+
     authenticator_manager_ = std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
+    authenticator_manager_->setEphemeralPool(srp_ephemeral_pool_);
 
     user_session_manager_ = std::make_unique<UserSessionManager>(task_runner_);
     user_session_manager_->start(this);
@@ -148,6 +157,7 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
         session->setVersion(session_info.version);
         session->setComputerName(session_info.computer_name);
         session->setUserName(session_info.user_name);
+        session->setSessionTypes(session_info.session_types);
     }
 
     if (user_session_manager_)
@@ -287,6 +297,7 @@ void Server::connectToRouter()
     router_info.address = settings_.routerAddress();
     router_info.port = settings_.routerPort();
     router_info.public_key = settings_.routerPublicKey();
+    router_info.direct_port = settings_.tcpPort();
 
     // Connect to the router.
     router_controller_ = std::make_unique<RouterController>(task_runner_);
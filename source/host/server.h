@@ -27,6 +27,7 @@
 
 namespace base {
 class FilePathWatcher;
+class SrpEphemeralPool;
 class TaskRunner;
 } // namespace base
 
@@ -80,6 +81,7 @@ private:
     // Accepts incoming network connections.
     std::unique_ptr<base::NetworkServer> server_;
     std::unique_ptr<RouterController> router_controller_;
+    std::shared_ptr<base::SrpEphemeralPool> srp_ephemeral_pool_;
     std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
     std::unique_ptr<UserSessionManager> user_session_manager_;
 
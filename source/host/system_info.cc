@@ -27,7 +27,9 @@
 
 namespace host {
 
-void createSystemInfo(proto::SystemInfo* system_info)
+namespace {
+
+void addSummary(proto::SystemInfo* system_info)
 {
     proto::system_info::Computer* computer = system_info->mutable_computer();
     computer->set_name(base::SysInfo::computerName());
@@ -46,6 +48,14 @@ void createSystemInfo(proto::SystemInfo* system_info)
     processor->set_packages(base::SysInfo::processorPackages());
     processor->set_cores(base::SysInfo::processorCores());
     processor->set_threads(base::SysInfo::processorThreads());
+}
+
+void addHardware(proto::SystemInfo* system_info)
+{
+    // The categories are present in the reply even if the SMBIOS has no tables for them.
+    system_info->mutable_bios();
+    system_info->mutable_motherboard();
+    system_info->mutable_memory();
 
     for (base::SmbiosTableEnumerator enumerator(base::readSmbiosDump());
          !enumerator.isAtEnd(); enumerator.advance())
@@ -105,24 +115,33 @@ void createSystemInfo(proto::SystemInfo* system_info)
                 break;
         }
     }
+}
+
+void addDrives(proto::SystemInfo* system_info)
+{
+    // The category is present in the reply even if there are no drives.
+    proto::system_info::LogicalDrives* drives = system_info->mutable_logical_drives();
 
     for (base::win::DriveEnumerator enumerator; !enumerator.isAtEnd(); enumerator.advance())
     {
         const base::win::DriveEnumerator::DriveInfo& drive_info = enumerator.driveInfo();
 
-        proto::system_info::LogicalDrives::Drive* drive =
-            system_info->mutable_logical_drives()->add_drive();
+        proto::system_info::LogicalDrives::Drive* drive = drives->add_drive();
 
         drive->set_path(drive_info.path().u8string());
         drive->set_file_system(drive_info.fileSystem());
         drive->set_total_size(drive_info.totalSpace());
         drive->set_free_size(drive_info.freeSpace());
     }
+}
+
+void addPrinters(proto::SystemInfo* system_info)
+{
+    proto::system_info::Printers* printers = system_info->mutable_printers();
 
     for (base::win::PrinterEnumerator enumerator; !enumerator.isAtEnd(); enumerator.advance())
     {
-        proto::system_info::Printers::Printer* printer =
-            system_info->mutable_printers()->add_printer();
+        proto::system_info::Printers::Printer* printer = printers->add_printer();
 
         printer->set_name(enumerator.name());
         printer->set_default_(enumerator.isDefault());
@@ -132,11 +151,15 @@ void createSystemInfo(proto::SystemInfo* system_info)
         printer->set_jobs_count(enumerator.jobsCount());
         printer->set_share_name(enumerator.shareName());
     }
+}
+
+void addNetworkAdapters(proto::SystemInfo* system_info)
+{
+    proto::system_info::NetworkAdapters* adapters = system_info->mutable_network_adapters();
 
     for (base::AdapterEnumerator enumerator; !enumerator.isAtEnd(); enumerator.advance())
     {
-        proto::system_info::NetworkAdapters::Adapter* adapter =
-            system_info->mutable_network_adapters()->add_adapter();
+        proto::system_info::NetworkAdapters::Adapter* adapter = adapters->add_adapter();
 
         adapter->set_adapter_name(enumerator.adapterName());
         adapter->set_connection_name(enumerator.connectionName());
@@ -175,4 +198,27 @@ void createSystemInfo(proto::SystemInfo* system_info)
     }
 }
 
+} // namespace
+
+void createSystemInfo(uint32_t categories, proto::SystemInfo* system_info)
+{
+    if (!categories)
+        categories = kAllSystemInfoCategories;
+
+    if (categories & proto::SystemInfoRequest::CATEGORY_SUMMARY)
+        addSummary(system_info);
+
+    if (categories & proto::SystemInfoRequest::CATEGORY_HARDWARE)
+        addHardware(system_info);
+
+    if (categories & proto::SystemInfoRequest::CATEGORY_DRIVES)
+        addDrives(system_info);
+
+    if (categories & proto::SystemInfoRequest::CATEGORY_PRINTERS)
+        addPrinters(system_info);
+
+    if (categories & proto::SystemInfoRequest::CATEGORY_NETWORK)
+        addNetworkAdapters(system_info);
+}
+
 } // namespace host
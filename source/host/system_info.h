@@ -23,7 +23,14 @@
 
 namespace host {
 
-void createSystemInfo(proto::SystemInfo* system_info);
+const uint32_t kAllSystemInfoCategories =
+    proto::SystemInfoRequest::CATEGORY_SUMMARY | proto::SystemInfoRequest::CATEGORY_HARDWARE |
+    proto::SystemInfoRequest::CATEGORY_DRIVES | proto::SystemInfoRequest::CATEGORY_PRINTERS |
+    proto::SystemInfoRequest::CATEGORY_NETWORK;
+
+// Collects the |categories| (flags of proto::SystemInfoRequest::Category) of the information
+// about the computer into |system_info|. If |categories| is 0, all categories are collected.
+void createSystemInfo(uint32_t categories, proto::SystemInfo* system_info);
 
 } // namespace host
 
@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/system_info_cache.h"
+
+#include "base/sys_info.h"
+#include "host/system_info.h"
+
+#include <iterator>
+
+namespace host {
+
+namespace {
+
+struct CategoryInfo
+{
+    uint32_t category;
+
+    // The cached information is collected again when it becomes older. Zero means that the
+    // information does not change while the host is running.
+    std::chrono::seconds lifetime;
+};
+
+const CategoryInfo kCategories[] =
+{
+    { proto::SystemInfoRequest::CATEGORY_SUMMARY,  std::chrono::seconds(0) },
+    { proto::SystemInfoRequest::CATEGORY_HARDWARE, std::chrono::seconds(0) },
+    { proto::SystemInfoRequest::CATEGORY_DRIVES,   std::chrono::seconds(15) },
+    { proto::SystemInfoRequest::CATEGORY_PRINTERS, std::chrono::seconds(30) },
+    { proto::SystemInfoRequest::CATEGORY_NETWORK,  std::chrono::seconds(15) }
+};
+
+} // namespace
+
+// static
+SystemInfoCache* SystemInfoCache::instance()
+{
+    static SystemInfoCache cache;
+    return &cache;
+}
+
+void SystemInfoCache::systemInfo(
+    uint32_t categories, bool refresh, proto::SystemInfo* system_info)
+{
+    static_assert(std::size(kCategories) == kCategoryCount);
+
+    if (!categories)
+        categories = kAllSystemInfoCategories;
+
+    const Clock::time_point now = Clock::now();
+
+    for (int i = 0; i < kCategoryCount; ++i)
+    {
+        const CategoryInfo& info = kCategories[i];
+        if (!(categories & info.category))
+            continue;
+
+        Entry& entry = entries_[i];
+
+        // If another thread is collecting the category now, its result is used.
+        std::scoped_lock lock(entry.lock);
+
+        const bool expired = info.lifetime.count() && now - entry.time > info.lifetime;
+
+        if (!entry.valid || expired || (refresh && entry.time < now))
+        {
+            entry.system_info.Clear();
+            createSystemInfo(info.category, &entry.system_info);
+
+            entry.time = Clock::now();
+            entry.valid = true;
+        }
+
+        system_info->MergeFrom(entry.system_info);
+    }
+
+    // The only value of the summary which changes all the time.
+    if (system_info->has_computer())
+        system_info->mutable_computer()->set_uptime(base::SysInfo::uptime());
+}
+
+} // namespace host
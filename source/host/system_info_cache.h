@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__SYSTEM_INFO_CACHE_H
+#define HOST__SYSTEM_INFO_CACHE_H
+
+#include "base/macros_magic.h"
+#include "proto/desktop_extensions.pb.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace host {
+
+// Keeps the system information collected by the host process, so repeated requests of the clients
+// do not enumerate the hardware, drives, printers and network adapters again. Each category has
+// its own lifetime: the hardware does not change while the host is running, the drives, printers
+// and adapters are collected again when their information becomes older than a few seconds. Can
+// be used from any thread. A slow category does not delay the requests of other categories.
+class SystemInfoCache
+{
+public:
+    static SystemInfoCache* instance();
+
+    // Adds the |categories| (flags of proto::SystemInfoRequest::Category, 0 means all) to
+    // |system_info|. If |refresh| is true, the categories are collected again.
+    void systemInfo(uint32_t categories, bool refresh, proto::SystemInfo* system_info);
+
+private:
+    SystemInfoCache() = default;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        std::mutex lock;
+        proto::SystemInfo system_info;
+        Clock::time_point time;
+        bool valid = false;
+    };
+
+    static const int kCategoryCount = 5;
+
+    Entry entries_[kCategoryCount];
+
+    DISALLOW_COPY_AND_ASSIGN(SystemInfoCache);
+};
+
+} // namespace host
+
+#endif // HOST__SYSTEM_INFO_CACHE_H
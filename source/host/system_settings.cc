@@ -24,6 +24,8 @@
 #include "base/peer/user_list.h"
 #include "base/settings/xml_settings.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
@@ -233,4 +235,64 @@ void SystemSettings::setPreferredVideoCapturer(uint32_t type)
     settings_.set("PreferredVideoCapturer", type);
 }
 
+std::u16string SystemSettings::frameTraceDirectory() const
+{
+    return settings_.get<std::u16string>("FrameTraceDirectory");
+}
+
+void SystemSettings::setFrameTraceDirectory(const std::u16string& directory)
+{
+    settings_.set("FrameTraceDirectory", directory);
+}
+
+std::u16string SystemSettings::replayFrameTrace() const
+{
+    return settings_.get<std::u16string>("ReplayFrameTrace");
+}
+
+void SystemSettings::setReplayFrameTrace(const std::u16string& file_path)
+{
+    settings_.set("ReplayFrameTrace", file_path);
+}
+
+std::u16string SystemSettings::sessionRecordingDirectory() const
+{
+    return settings_.get<std::u16string>("SessionRecordingDirectory");
+}
+
+void SystemSettings::setSessionRecordingDirectory(const std::u16string& directory)
+{
+    settings_.set("SessionRecordingDirectory", directory);
+}
+
+bool SystemSettings::isWarmCapturerEnabled() const
+{
+    return settings_.get<bool>("WarmCapturerEnabled", false);
+}
+
+void SystemSettings::setWarmCapturerEnabled(bool enable)
+{
+    settings_.set<bool>("WarmCapturerEnabled", enable);
+}
+
+uint32_t SystemSettings::videoEncoderCpuBudget() const
+{
+    return std::clamp(settings_.get<uint32_t>("VideoEncoderCpuBudget", 50), 1U, 100U);
+}
+
+void SystemSettings::setVideoEncoderCpuBudget(uint32_t percent)
+{
+    settings_.set<uint32_t>("VideoEncoderCpuBudget", percent);
+}
+
+uint32_t SystemSettings::sessionMemoryLimit() const
+{
+    return settings_.get<uint32_t>("SessionMemoryLimit", 0);
+}
+
+void SystemSettings::setSessionMemoryLimit(uint32_t megabytes)
+{
+    settings_.set<uint32_t>("SessionMemoryLimit", megabytes);
+}
+
 } // namespace host
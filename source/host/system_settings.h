@@ -64,6 +64,39 @@ public:
     uint32_t preferredVideoCapturer() const;
     void setPreferredVideoCapturer(uint32_t type);
 
+    // Directory to which the desktop sessions write the traces of the captured frames. The traces
+    // are used to reproduce the performance problems offline. Empty if the recording is disabled.
+    std::u16string frameTraceDirectory() const;
+    void setFrameTraceDirectory(const std::u16string& directory);
+
+    // Frame trace which is replayed instead of the screen of the desktop sessions. Used to load the
+    // host with a known video (see aspia_load_client). Empty if the real sessions are used.
+    std::u16string replayFrameTrace() const;
+    void setReplayFrameTrace(const std::u16string& file_path);
+
+    // Directory to which the desktop sessions are recorded as WebM files. A session is recorded
+    // only if its client allows it. Empty if the recording is disabled.
+    std::u16string sessionRecordingDirectory() const;
+    void setSessionRecordingDirectory(const std::u16string& directory);
+
+    // If enabled, the desktop sessions keep the screen capturer initialized while no client is
+    // connected, so a connecting client gets the first frame without waiting for the capturer.
+    // Disabled by default because the idle capturer still holds the resources of the video driver.
+    bool isWarmCapturerEnabled() const;
+    void setWarmCapturerEnabled(bool enable);
+
+    // Percentage of the CPU time of all the processor cores which the video encoders of all the
+    // user sessions may use together. The sessions with recent input get a larger share. The
+    // encoders choose faster speed presets and then lower the frame rate to stay within it.
+    uint32_t videoEncoderCpuBudget() const;
+    void setVideoEncoderCpuBudget(uint32_t percent);
+
+    // Memory (in megabytes) which the screen, the video encoders and the send queues of a user
+    // session may use. A session over it gets a smaller video and does not keep the spare buffers.
+    // Zero disables the limit.
+    uint32_t sessionMemoryLimit() const;
+    void setSessionMemoryLimit(uint32_t megabytes);
+
 private:
     base::JsonSettings settings_;
 
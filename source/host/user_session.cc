@@ -29,18 +29,52 @@
 #include "base/win/session_info.h"
 #include "host/client_session_desktop.h"
 #include "host/desktop_session_proxy.h"
+#include "host/system_settings.h"
+
+#include <cmath>
 
 namespace host {
 
+namespace {
+
+// A session is interactive while its clients have sent input during this time.
+constexpr std::chrono::seconds kInteractiveTimeout{ 5 };
+
+// Each level of the memory pressure reduces the width and the height of the video by a quarter,
+// so the frames and the encoders of the session use about half of the memory.
+const double kMemoryPressureScale = 0.75;
+const int kMaxMemoryPressureLevel = 3;
+
+// The level is raised not more often than this, so the previous reduction takes effect first.
+// It is lowered after a longer time and only when the session uses less than half of the limit,
+// because the next level up doubles the memory again.
+constexpr std::chrono::seconds kMemoryPressureRaiseInterval{ 2 };
+constexpr std::chrono::seconds kMemoryPressureLowerInterval{ 30 };
+
+base::Size reducedVideoSize(const base::Size& size, int memory_pressure_level)
+{
+    const double factor = std::pow(kMemoryPressureScale, memory_pressure_level);
+
+    // The encoders of the subsampled formats need even sizes.
+    return base::Size(std::max(static_cast<int32_t>(size.width() * factor) & ~1, 2),
+                      std::max(static_cast<int32_t>(size.height() * factor) & ~1, 2));
+}
+
+} // namespace
+
 UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
                          base::SessionId session_id,
-                         std::unique_ptr<base::IpcChannel> channel)
+                         std::unique_ptr<base::IpcChannel> channel,
+                         std::shared_ptr<VideoEncoderScheduler> encoder_scheduler)
     : task_runner_(task_runner),
       channel_(std::move(channel)),
       attach_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
-      session_id_(session_id)
+      session_id_(session_id),
+      encoder_scheduler_(std::move(encoder_scheduler)),
+      memory_limit_(static_cast<size_t>(SystemSettings().sessionMemoryLimit()) * 1024 * 1024)
 {
     DCHECK(task_runner_);
+    DCHECK(encoder_scheduler_);
 
     type_ = UserSession::Type::CONSOLE;
 
@@ -50,7 +84,10 @@ UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
     router_state_.set_state(proto::internal::RouterState::DISABLED);
 }
 
-UserSession::~UserSession() = default;
+UserSession::~UserSession()
+{
+    encoder_scheduler_->remove(this);
+}
 
 void UserSession::start(Delegate* delegate)
 {
@@ -160,6 +197,9 @@ void UserSession::addNewSession(std::unique_ptr<ClientSession> client_session)
 
             desktop_client_session->setDesktopSessionProxy(desktop_session_proxy_);
             desktop_session_proxy_->control(proto::internal::Control::ENABLE);
+
+            // The window of the new client is visible.
+            updateCapturePause();
         }
         break;
 
@@ -240,10 +280,13 @@ void UserSession::setRouterState(const proto::internal::RouterState& router_stat
         if (delegate_)
             delegate_->onUserSessionHostIdRequest(sessionName());
     }
-    else
+    else if (router_state.state() == proto::internal::RouterState::DISABLED)
     {
         host_id_ = base::kInvalidHostId;
     }
+
+    // While the router is reconnected the ID remains shown. The router assigns it again when the
+    // connection is restored.
 }
 
 void UserSession::setHostId(base::HostId host_id)
@@ -302,6 +345,11 @@ void UserSession::onDesktopSessionStarted()
         action = proto::internal::Control::DISABLE;
 
     desktop_session_proxy_->control(action);
+
+    // The new desktop session starts with the capture running.
+    capture_paused_ = false;
+    updateCapturePause();
+
     onClientSessionConfigured();
 }
 
@@ -320,8 +368,194 @@ void UserSession::onDesktopSessionStopped()
 
 void UserSession::onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor)
 {
+    if (frame)
+    {
+        // The store is updated with every frame, so it stays complete while there are no groups.
+        frame_store_.update(*frame);
+        updateMemoryPressure();
+
+        std::map<VideoEncoderGroup::Key, std::unique_ptr<VideoEncoderGroup>> groups;
+        std::map<VideoEncoderGroup::Key, base::Region> regions_of_interest;
+
+        const std::chrono::steady_clock::time_point current_time =
+            std::chrono::steady_clock::now();
+        bool interactive = false;
+
+        for (const auto& client : desktop_clients_)
+        {
+            ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+
+            if (current_time - desktop_client->lastInputTime() < kInteractiveTimeout)
+                interactive = true;
+
+            VideoEncoderGroup::Key key;
+            if (!desktop_client->videoEncoderKey(frame->size(), &key))
+                continue;
+
+            if (memory_pressure_level_)
+                key.size = reducedVideoSize(key.size, memory_pressure_level_);
+
+            const std::vector<VideoEncoderGroup::Key> stream_keys =
+                VideoEncoderGroup::streamKeys(key, frame->size(), frame->screenRects());
+
+            // If only the size of the single stream has changed, the group of the client is
+            // resized, unless the other clients still use it or there is a group of the new size.
+            const VideoEncoderGroup::Key* last_key = desktop_client->lastVideoEncoderKey();
+            bool resized = false;
+
+            if (last_key && stream_keys.size() == 1 && key.isResizeOf(*last_key) &&
+                groups.find(key) == groups.end() &&
+                encoder_groups_.find(key) == encoder_groups_.end() &&
+                !isVideoEncoderKeyShared(*last_key, desktop_client))
+            {
+                auto existing_group = encoder_groups_.find(*last_key);
+                if (existing_group != encoder_groups_.end() && existing_group->second)
+                {
+                    existing_group->second->resize(key.size);
+                    groups[key] = std::move(existing_group->second);
+                    resized = true;
+                }
+            }
+
+            // A client that joins the group needs the key frame to start decoding.
+            const bool key_changed =
+                desktop_client->setVideoEncoderKey(key, frame->size()) && !resized;
+            const uint32_t bitrate = desktop_client->targetBitrate();
+
+            for (const auto& stream_key : stream_keys)
+            {
+                std::unique_ptr<VideoEncoderGroup>& group = groups[stream_key];
+                if (!group)
+                {
+                    auto existing_group = encoder_groups_.find(stream_key);
+                    if (existing_group != encoder_groups_.end())
+                        group = std::move(existing_group->second);
+                    else
+                        group = std::make_unique<VideoEncoderGroup>(stream_key);
+                }
+
+                // The bitrate of the client is shared by the streams in proportion to their area.
+                uint32_t stream_bitrate = bitrate;
+                if (stream_key.stream_id)
+                {
+                    const double share = static_cast<double>(stream_key.size.width()) *
+                        stream_key.size.height() /
+                        (static_cast<double>(key.size.width()) * key.size.height());
+
+                    stream_bitrate = std::max(static_cast<uint32_t>(bitrate * share), 1U);
+                }
+
+                // The recording contains a single video stream.
+                group->addMember(desktop_client->channelProxy(),
+                                 stream_bitrate,
+                                 stream_key.stream_id ? nullptr : desktop_client->recorder(),
+                                 key_changed);
+                desktop_client->addRegionOfInterest(
+                    frame->activeWindowRect(), &regions_of_interest[stream_key]);
+            }
+        }
+
+        // Groups without members are destroyed.
+        encoder_groups_.swap(groups);
+
+        // Each group encodes the frame once for all its members on its own thread. In the
+        // multi-stream mode the screens are encoded in parallel.
+        std::shared_ptr<const base::FrameTileStore::Snapshot> snapshot = frame_store_.snapshot();
+
+        // The sessions where the users work now get a larger share of the budget of the host.
+        const double cpu_budget =
+            encoder_scheduler_->update(this, encoder_groups_.size(), interactive);
+
+        for (const auto& group : encoder_groups_)
+        {
+            group.second->setCpuBudget(cpu_budget);
+            group.second->setMemoryPressure(memory_pressure_level_ > 0);
+            group.second->setRegionOfInterest(regions_of_interest[group.first]);
+            group.second->encode(frame, snapshot);
+        }
+    }
+
+    size_t pending_messages = 0;
+
     for (const auto& client : desktop_clients_)
-        static_cast<ClientSessionDesktop*>(client.get())->encodeScreen(frame, cursor);
+    {
+        ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+
+        desktop_client->encodeCursor(cursor);
+        pending_messages = std::max(pending_messages, client->pendingMessages());
+
+        if (desktop_client->isStatisticsRequested())
+            desktop_client->sendStatistics(videoEncoderStatistics(*desktop_client), memory_usage_);
+    }
+
+    // The capture rate is adjusted to the slowest client.
+    desktop_session_proxy_->setPendingMessages(static_cast<uint32_t>(pending_messages));
+}
+
+VideoEncoderGroup::Statistics UserSession::videoEncoderStatistics(
+    const ClientSessionDesktop& client) const
+{
+    const VideoEncoderGroup::Key* key = client.lastVideoEncoderKey();
+    if (!key)
+        return VideoEncoderGroup::Statistics();
+
+    // In the multi-stream mode the statistics of the first stream are sent.
+    for (const auto& group : encoder_groups_)
+    {
+        if (group.second && group.first.desktopKey() == *key)
+            return group.second->statistics();
+    }
+
+    return VideoEncoderGroup::Statistics();
+}
+
+void UserSession::updateMemoryPressure()
+{
+    // The statistics of the groups are updated by the previous frames.
+    size_t memory_usage = frame_store_.memoryUsage();
+
+    for (const auto& group : encoder_groups_)
+        memory_usage += group.second->statistics().memory_usage;
+
+    for (const auto& client : desktop_clients_)
+        memory_usage += client->channelProxy()->pendingBytes();
+
+    for (const auto& client : file_transfer_clients_)
+        memory_usage += client->channelProxy()->pendingBytes();
+
+    memory_usage_ = memory_usage;
+
+    if (!memory_limit_)
+        return;
+
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::duration elapsed = current_time - memory_pressure_time_;
+
+    if (memory_usage > memory_limit_ && memory_pressure_level_ < kMaxMemoryPressureLevel &&
+        elapsed >= kMemoryPressureRaiseInterval)
+    {
+        ++memory_pressure_level_;
+        memory_pressure_time_ = current_time;
+
+        LOG(LS_WARNING) << "Session " << session_id_ << " uses " << memory_usage
+                        << " bytes of memory (limit: " << memory_limit_
+                        << "). Memory pressure level: " << memory_pressure_level_;
+    }
+    else if (memory_pressure_level_ > 0 && memory_usage < memory_limit_ / 2 &&
+             elapsed >= kMemoryPressureLowerInterval)
+    {
+        --memory_pressure_level_;
+        memory_pressure_time_ = current_time;
+
+        LOG(LS_INFO) << "Session " << session_id_ << " uses " << memory_usage
+                     << " bytes of memory. Memory pressure level: " << memory_pressure_level_;
+    }
+}
+
+void UserSession::onCursorPositionChanged(const base::Point& position)
+{
+    for (const auto& client : desktop_clients_)
+        static_cast<ClientSessionDesktop*>(client.get())->encodeCursorPosition(position);
 }
 
 void UserSession::onAudioCaptured(const proto::AudioPacket& audio_packet)
@@ -342,6 +576,9 @@ void UserSession::onScreenListChanged(const proto::ScreenList& list)
         LOG(LS_INFO) << "Screen #" << i << ": id=" << screen.id() << ", title=" << screen.title();
     }
 
+    LOG(LS_INFO) << "Current window: " << list.current_window()
+                 << " (windows: " << list.window_size() << ")";
+
     for (const auto& client : desktop_clients_)
         static_cast<ClientSessionDesktop*>(client.get())->setScreenList(list);
 }
@@ -423,6 +660,42 @@ void UserSession::onClientSessionFinished()
 
     if (desktop_clients_.empty())
         desktop_session_proxy_->control(proto::internal::Control::DISABLE);
+    else
+        updateCapturePause();
+}
+
+void UserSession::onClientSessionVisibilityChanged()
+{
+    updateCapturePause();
+}
+
+void UserSession::onClientSessionOpened(std::unique_ptr<ClientSession> client_session)
+{
+    // The session in a stream is shown in the UI and can be killed like any other session.
+    addNewSession(std::move(client_session));
+}
+
+void UserSession::updateCapturePause()
+{
+    bool paused = !desktop_clients_.empty();
+
+    for (const auto& client : desktop_clients_)
+    {
+        if (static_cast<ClientSessionDesktop*>(client.get())->isVideoWanted())
+        {
+            paused = false;
+            break;
+        }
+    }
+
+    if (paused == capture_paused_)
+        return;
+
+    LOG(LS_INFO) << "Capture paused: " << paused;
+    capture_paused_ = paused;
+
+    desktop_session_proxy_->control(paused ? proto::internal::Control::PAUSE_CAPTURE :
+                                             proto::internal::Control::RESUME_CAPTURE);
 }
 
 void UserSession::onSessionDettached(const base::Location& location)
@@ -556,4 +829,21 @@ void UserSession::sendRouterState()
     channel_->send(base::serialize(outgoing_message_));
 }
 
+bool UserSession::isVideoEncoderKeyShared(
+    const VideoEncoderGroup::Key& key, const ClientSession* client) const
+{
+    for (const auto& other : desktop_clients_)
+    {
+        if (other.get() == client)
+            continue;
+
+        const VideoEncoderGroup::Key* other_key =
+            static_cast<const ClientSessionDesktop*>(other.get())->lastVideoEncoderKey();
+        if (other_key && *other_key == key)
+            return true;
+    }
+
+    return false;
+}
+
 } // namespace host
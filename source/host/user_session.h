@@ -27,10 +27,17 @@
 #include "base/win/session_status.h"
 #include "host/client_session.h"
 #include "host/desktop_session_manager.h"
+#include "host/video_encoder_group.h"
+#include "host/video_encoder_scheduler.h"
 #include "proto/host_internal.pb.h"
 
+#include <chrono>
+#include <map>
+
 namespace host {
 
+class ClientSessionDesktop;
+
 class UserSession
     : public base::IpcChannel::Listener,
       public DesktopSession::Delegate,
@@ -62,7 +69,8 @@ public:
 
     UserSession(std::shared_ptr<base::TaskRunner> task_runner,
                 base::SessionId session_id,
-                std::unique_ptr<base::IpcChannel> channel);
+                std::unique_ptr<base::IpcChannel> channel,
+                std::shared_ptr<VideoEncoderScheduler> encoder_scheduler);
     ~UserSession();
 
     void start(Delegate* delegate);
@@ -89,6 +97,7 @@ protected:
     void onDesktopSessionStarted() override;
     void onDesktopSessionStopped() override;
     void onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor) override;
+    void onCursorPositionChanged(const base::Point& position) override;
     void onAudioCaptured(const proto::AudioPacket& audio_packet) override;
     void onScreenListChanged(const proto::ScreenList& list) override;
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
@@ -96,6 +105,8 @@ protected:
     // ClientSession::Delegate implementation.
     void onClientSessionConfigured() override;
     void onClientSessionFinished() override;
+    void onClientSessionVisibilityChanged() override;
+    void onClientSessionOpened(std::unique_ptr<ClientSession> client_session) override;
 
 private:
     void onSessionDettached(const base::Location& location);
@@ -106,6 +117,22 @@ private:
     void killClientSession(uint32_t id);
     void sendRouterState();
 
+    // Pauses the capture if no desktop client shows or records the video and resumes it when
+    // one does again.
+    void updateCapturePause();
+
+    // Returns true if a desktop client other than |client| receives the video of |key|.
+    bool isVideoEncoderKeyShared(
+        const VideoEncoderGroup::Key& key, const ClientSession* client) const;
+
+    // Sums the memory used by the screen, the groups and the send queues of the clients. If the
+    // sum is over the limit, the video of the clients is reduced and the groups release their
+    // spare buffers. Once the memory is well below the limit, the reduction is removed in steps.
+    void updateMemoryPressure();
+
+    // Returns the statistics of the group which encodes the video of |client|.
+    VideoEncoderGroup::Statistics videoEncoderStatistics(const ClientSessionDesktop& client) const;
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::IpcChannel> channel_;
 
@@ -124,8 +151,26 @@ private:
     ClientSessionList desktop_clients_;
     ClientSessionList file_transfer_clients_;
 
+    // Clients with the same video parameters share one encoder.
+    std::map<VideoEncoderGroup::Key, std::unique_ptr<VideoEncoderGroup>> encoder_groups_;
+
+    // The captured screen shared by the groups. Each group keeps only the snapshot of the frame it
+    // has not encoded yet.
+    base::FrameTileStore frame_store_;
+
+    // Gives the groups their share of the CPU time of the host. Shared by all the user sessions.
+    std::shared_ptr<VideoEncoderScheduler> encoder_scheduler_;
+
+    // The memory limit of the session in bytes (zero if disabled), the last sum of its memory and
+    // the number of the reductions of the video caused by it.
+    const size_t memory_limit_;
+    size_t memory_usage_ = 0;
+    int memory_pressure_level_ = 0;
+    std::chrono::steady_clock::time_point memory_pressure_time_;
+
     std::unique_ptr<DesktopSessionManager> desktop_session_;
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+    bool capture_paused_ = false;
 
     proto::internal::UiToService incoming_message_;
     proto::internal::ServiceToUi outgoing_message_;
@@ -30,6 +30,7 @@
 #include "base/win/session_enumerator.h"
 #include "base/win/session_info.h"
 #include "host/client_session.h"
+#include "host/system_settings.h"
 #include "host/user_session.h"
 #include "host/user_session_constants.h"
 
@@ -166,7 +167,9 @@ bool createProcessWithToken(HANDLE token, const base::CommandLine& command_line)
 } // namespace
 
 UserSessionManager::UserSessionManager(std::shared_ptr<base::TaskRunner> task_runner)
-    : task_runner_(std::move(task_runner))
+    : task_runner_(std::move(task_runner)),
+      encoder_scheduler_(std::make_shared<VideoEncoderScheduler>(
+          SystemSettings().videoEncoderCpuBudget() / 100.0))
 {
     DCHECK(task_runner_);
     router_state_.set_state(proto::internal::RouterState::DISABLED);
@@ -429,7 +432,7 @@ void UserSessionManager::addUserSession(
     }
 
     std::unique_ptr<UserSession> user_session = std::make_unique<UserSession>(
-        task_runner_, session_id, std::move(channel));
+        task_runner_, session_id, std::move(channel), encoder_scheduler_);
     user_session->setRouterState(router_state_);
 
     sessions_.emplace_back(std::move(user_session));
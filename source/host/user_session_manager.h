@@ -70,6 +70,9 @@ private:
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::IpcServer> ipc_server_;
     std::vector<std::unique_ptr<UserSession>> sessions_;
+
+    // Shares the CPU budget for the video encoding between the sessions.
+    std::shared_ptr<VideoEncoderScheduler> encoder_scheduler_;
     Delegate* delegate_ = nullptr;
 
     proto::internal::RouterState router_state_;
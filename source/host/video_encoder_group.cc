@@ -0,0 +1,1311 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/video_encoder_group.h"
+
+#include "base/logging.h"
+#include "base/sample_window.h"
+#include "base/system_time.h"
+#include "base/trace_event.h"
+#include "base/codec/scale_reducer.h"
+#include "base/codec/video_encoder_mf.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/codec/video_region_detector.h"
+#include "base/codec/video_tile_cache.h"
+#include "base/codec/webm_file_writer.h"
+#include "base/desktop/frame_simple.h"
+#include "base/desktop/screen_capturer.h"
+#include "base/memory/byte_array_pool.h"
+#include "base/net/network_channel_proxy.h"
+#include "base/strings/string_printf.h"
+
+#if defined(USE_AV1)
+#include "base/codec/video_encoder_aom.h"
+#endif // defined(USE_AV1)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+
+namespace host {
+
+namespace {
+
+// Unsent video must not exceed the amount the link transmits in this time at the target bitrate.
+const std::chrono::milliseconds kMaxVideoLatency{ 250 };
+const size_t kMinPendingBytesLimit = 64 * 1024;
+
+// How often the congestion is checked while the encoding is paused.
+const std::chrono::milliseconds kCongestionCheckInterval{ 20 };
+
+// The serialized messages wait in the queues of the members until they are sent. The pool keeps
+// enough buffers for the queues of a few frames.
+const size_t kMaxPooledBuffers = 16;
+
+// The messages since the last key frame are kept for the joining members while they are smaller
+// than this number of key frames. A larger replay costs the channel of the new member more than a
+// new key frame.
+const size_t kMaxReplayKeyFrames = 3;
+const size_t kMaxReplaySize = 16 * 1024 * 1024;
+
+// A tile is refined without loss when it has not changed for this time.
+const std::chrono::milliseconds kRefinementDelay{ 1000 };
+
+// How often the static tiles are checked while some of them are not refined yet.
+const std::chrono::milliseconds kRefinementCheckInterval{ 250 };
+
+// The static areas are tracked in square tiles of this size (in pixels of the encoded frame). The
+// refined tiles are cached with the same size.
+const int kRefinementTileSize = base::VideoTileCache::kTileSize;
+
+// Limits the size of one refinement packet (1 MB before compression). The rest of the static
+// tiles is sent with the next packets.
+const size_t kMaxRefinedTilesPerPacket = 64;
+
+// The areas of the screen which play a video are encoded at most with this interval (about 15 fps).
+// The rest of the screen is encoded at the full frame rate.
+const std::chrono::milliseconds kVideoRegionInterval{ 66 };
+
+// A key frame is limited in size, so it does not stall the channel. After it the whole frame is
+// encoded once more in this number of stripes, one stripe per frame, which raises the quality of
+// the static areas without a burst.
+const int kRefreshStripes = 8;
+const std::chrono::milliseconds kRefreshInterval{ 50 };
+
+// The latency percentiles are calculated over this number of the last frames and written to the
+// log with this interval.
+const size_t kMaxLatencySamples = 512;
+const std::chrono::seconds kLatencyLogInterval{ 60 };
+
+// The medians of the statistics are calculated with this interval.
+const std::chrono::seconds kStatisticsInterval{ 1 };
+
+std::string percentilesToString(const base::SampleWindow& samples)
+{
+    return base::stringPrintf("p50 %.1f ms, p95 %.1f ms, p99 %.1f ms",
+                              static_cast<double>(samples.percentile(50)) / 1000.0,
+                              static_cast<double>(samples.percentile(95)) / 1000.0,
+                              static_cast<double>(samples.percentile(99)) / 1000.0);
+}
+
+size_t pendingBytesLimit(uint32_t bitrate)
+{
+    // Bitrate in kbps to bytes per the latency budget.
+    const size_t limit = static_cast<size_t>(bitrate) * 1000 / 8 * kMaxVideoLatency.count() / 1000;
+    return std::max(limit, kMinPendingBytesLimit);
+}
+
+// VP8, VP9 and AV1 encoders update only the active blocks of the frame, and their decoders convert
+// only the dirty rects.
+bool hasActiveMap(proto::VideoEncoding encoding)
+{
+    return encoding == proto::VIDEO_ENCODING_VP8 || encoding == proto::VIDEO_ENCODING_VP9 ||
+           encoding == proto::VIDEO_ENCODING_AV1;
+}
+
+std::unique_ptr<base::VideoEncoder> createVideoEncoder(
+    proto::VideoEncoding encoding, bool full_chroma)
+{
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_VP8:
+            return base::VideoEncoderVPX::createVP8();
+
+        case proto::VIDEO_ENCODING_VP9:
+        {
+            if (full_chroma)
+                return base::VideoEncoderVPX::createVP9I444();
+
+            return base::VideoEncoderVPX::createVP9();
+        }
+
+        case proto::VIDEO_ENCODING_H264:
+            return base::VideoEncoderMF::createH264();
+
+#if defined(USE_AV1)
+        case proto::VIDEO_ENCODING_AV1:
+            return base::VideoEncoderAOM::createAV1();
+#endif // defined(USE_AV1)
+
+        default:
+            LOG(LS_WARNING) << "Unsupported video encoding: " << encoding;
+            return nullptr;
+    }
+}
+
+} // namespace
+
+bool VideoEncoderGroup::Key::operator<(const Key& other) const
+{
+    auto tie = [](const Key& key)
+    {
+        return std::make_tuple(key.encoding, key.full_chroma, key.lossless_refinement,
+                               key.tile_cache, key.copy_rect, key.multi_stream,
+                               key.packed_dirty_rects, key.size.width(), key.size.height(),
+                               key.frame_interval,
+                               key.stream_id, key.source_rect.left(), key.source_rect.top(),
+                               key.source_rect.right(), key.source_rect.bottom(),
+                               key.position.x(), key.position.y(),
+                               key.desktop_size.width(), key.desktop_size.height());
+    };
+
+    return tie(*this) < tie(other);
+}
+
+bool VideoEncoderGroup::Key::isResizeOf(const Key& other) const
+{
+    Key resized = other;
+    resized.size = size;
+    return !stream_id && size != other.size && resized == *this;
+}
+
+VideoEncoderGroup::Key VideoEncoderGroup::Key::desktopKey() const
+{
+    if (!stream_id)
+        return *this;
+
+    Key key = *this;
+    key.size = desktop_size;
+    key.stream_id = 0;
+    key.source_rect = base::Rect();
+    key.position = base::Point();
+    key.desktop_size = base::Size();
+    return key;
+}
+
+bool VideoEncoderGroup::Key::operator==(const Key& other) const
+{
+    return encoding == other.encoding && full_chroma == other.full_chroma &&
+           lossless_refinement == other.lossless_refinement && tile_cache == other.tile_cache &&
+           copy_rect == other.copy_rect && multi_stream == other.multi_stream &&
+           packed_dirty_rects == other.packed_dirty_rects && size == other.size &&
+           frame_interval == other.frame_interval &&
+           stream_id == other.stream_id && source_rect == other.source_rect &&
+           position == other.position && desktop_size == other.desktop_size;
+}
+
+VideoEncoderGroup::VideoEncoderGroup(const Key& key)
+    : key_(key),
+      video_region_detector_(std::make_unique<base::VideoRegionDetector>())
+{
+    LOG(LS_INFO) << "Video encoder group created (encoding: " << key_.encoding
+                 << ", full chroma: " << key_.full_chroma << ", lossless refinement: "
+                 << key_.lossless_refinement << ", tile cache: " << key_.tile_cache
+                 << ", copy rect: " << key_.copy_rect << ", size: " << key_.size
+                 << ", stream: " << key_.stream_id << ")";
+
+    thread_.setThreadPriority(base::ThreadPriority::DISPLAY_CRITICAL);
+    thread_.start(base::MessageLoop::Type::DEFAULT, this);
+}
+
+VideoEncoderGroup::~VideoEncoderGroup()
+{
+    thread_.stop();
+
+    LOG(LS_INFO) << "Video encoder group destroyed (encoding: " << key_.encoding
+                 << ", size: " << key_.size << ")";
+}
+
+// static
+bool VideoEncoderGroup::isSupported(proto::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_VP8:
+        case proto::VIDEO_ENCODING_VP9:
+            return true;
+
+#if defined(USE_AV1)
+        case proto::VIDEO_ENCODING_AV1:
+            return true;
+#endif // defined(USE_AV1)
+
+        case proto::VIDEO_ENCODING_H264:
+            return base::VideoEncoderMF::isH264Supported();
+
+        default:
+            return false;
+    }
+}
+
+// static
+std::vector<VideoEncoderGroup::Key> VideoEncoderGroup::streamKeys(
+    const Key& key, const base::Size& source_size, const std::vector<base::Rect>& screen_rects)
+{
+    if (!key.multi_stream || screen_rects.size() < 2 || source_size.isEmpty())
+        return { key };
+
+    const double scale_x = static_cast<double>(key.size.width()) / source_size.width();
+    const double scale_y = static_cast<double>(key.size.height()) / source_size.height();
+
+    // The edges are rounded in the same way for all screens, so the adjacent streams neither
+    // overlap nor leave gaps between them.
+    auto scale = [](int32_t value, double factor)
+    {
+        return static_cast<int32_t>(std::lround(value * factor));
+    };
+
+    const base::Rect source_frame_rect = base::Rect::makeSize(source_size);
+    std::vector<Key> keys;
+
+    for (const auto& screen_rect : screen_rects)
+    {
+        base::Rect source_rect = screen_rect;
+        source_rect.intersectWith(source_frame_rect);
+
+        const base::Rect stream_rect = base::Rect::makeLTRB(scale(source_rect.left(), scale_x),
+                                                            scale(source_rect.top(), scale_y),
+                                                            scale(source_rect.right(), scale_x),
+                                                            scale(source_rect.bottom(), scale_y));
+        if (source_rect.isEmpty() || stream_rect.isEmpty())
+            continue;
+
+        Key stream_key = key;
+        stream_key.size = stream_rect.size();
+        stream_key.stream_id = static_cast<uint32_t>(keys.size() + 1);
+        stream_key.source_rect = source_rect;
+        stream_key.position = stream_rect.topLeft();
+        stream_key.desktop_size = key.size;
+
+        keys.emplace_back(stream_key);
+    }
+
+    if (keys.size() < 2)
+        return { key };
+
+    return keys;
+}
+
+void VideoEncoderGroup::resize(const base::Size& size)
+{
+    DCHECK(!key_.stream_id);
+
+    LOG(LS_INFO) << "Video encoder group resized (encoding: " << key_.encoding << ", size: "
+                 << key_.size << " -> " << size << ")";
+    key_.size = size;
+}
+
+void VideoEncoderGroup::addMember(std::shared_ptr<base::NetworkChannelProxy> channel_proxy,
+                                  uint32_t bitrate,
+                                  std::shared_ptr<base::WebmFileWriter> recorder,
+                                  bool joining)
+{
+    next_members_.push_back({ std::move(channel_proxy), bitrate, std::move(recorder), joining });
+}
+
+void VideoEncoderGroup::setCpuBudget(double share)
+{
+    std::scoped_lock lock(pending_lock_);
+    pending_cpu_budget_ = share;
+}
+
+void VideoEncoderGroup::setMemoryPressure(bool pressure)
+{
+    std::scoped_lock lock(pending_lock_);
+    pending_memory_pressure_ = pressure;
+}
+
+void VideoEncoderGroup::setRegionOfInterest(const base::Region& region)
+{
+    next_roi_ = region;
+
+    if (key_.stream_id)
+    {
+        next_roi_.intersectWith(key_.source_rect);
+        next_roi_.translate(-key_.source_rect.x(), -key_.source_rect.y());
+    }
+}
+
+void VideoEncoderGroup::encode(const base::Frame* frame,
+                               std::shared_ptr<const base::FrameTileStore::Snapshot> snapshot)
+{
+    DCHECK(frame);
+    DCHECK(snapshot);
+    DCHECK_EQ(snapshot->size(), frame->size());
+
+    // The group of a stream encodes only the area of its screen.
+    const base::Rect source_rect =
+        key_.stream_id ? key_.source_rect : base::Rect::makeSize(frame->size());
+    DCHECK(base::Rect::makeSize(frame->size()).containsRect(source_rect));
+
+    base::Region updated_region = frame->constUpdatedRegion();
+    if (key_.stream_id)
+    {
+        updated_region.intersectWith(source_rect);
+        updated_region.translate(-source_rect.x(), -source_rect.y());
+    }
+
+    // The detector sees each captured frame. The merged pending frames would lower the rates.
+    const bool video_region_changed = video_region_detector_->addFrame(
+        source_rect.size(), updated_region, Clock::now());
+
+    std::scoped_lock lock(pending_lock_);
+
+    if (video_region_changed)
+    {
+        pending_video_region_ = video_region_detector_->videoRegion();
+        pending_video_region_changed_ = true;
+    }
+
+    bool full_update = false;
+
+    if (pending_frame_size_ != source_rect.size())
+    {
+        pending_frame_size_ = source_rect.size();
+        updated_region.setRect(base::Rect::makeSize(source_rect.size()));
+        full_update = true;
+    }
+    else if (updated_region.isEmpty())
+    {
+        auto is_joining = [](const Member& member) { return member.joining; };
+        const bool joining = std::any_of(next_members_.cbegin(), next_members_.cend(), is_joining);
+
+        // Only the other screens have changed. Nothing is encoded unless a key frame is required.
+        // The joining members get at least the replay.
+        if (!next_key_frame_ && !joining)
+        {
+            next_members_.clear();
+            next_roi_.clear();
+            return;
+        }
+
+        if (next_key_frame_)
+        {
+            updated_region.setRect(base::Rect::makeSize(source_rect.size()));
+            full_update = true;
+        }
+    }
+
+    // The copy is relative to the previous frame of the capturer. It is valid for the client only
+    // if that frame is the last one encoded. Otherwise the copy of the pending frame loses the
+    // areas changed by the frames merged into it.
+    if (key_.copy_rect && !key_.stream_id && !full_update && !next_key_frame_ &&
+        pending_region_.isEmpty() && pending_copy_rect_.isEmpty() &&
+        !frame->copyRect().isEmpty())
+    {
+        pending_copy_rect_ = frame->copyRect();
+        pending_copy_source_ = frame->copySource();
+        pending_copy_region_ = base::Region(pending_copy_rect_);
+        pending_copy_region_.intersectWith(updated_region);
+    }
+    else
+    {
+        pending_copy_region_.subtract(updated_region);
+    }
+
+    // The pixels are not copied here. The snapshot keeps the tiles of the screen unchanged until
+    // the encoder thread copies the pending region from it, and a newer snapshot contains the
+    // changes of the merged frames as well.
+    pending_snapshot_ = std::move(snapshot);
+    pending_source_offset_ = source_rect.topLeft();
+    pending_source_size_ = frame->size();
+    pending_size_ = key_.size;
+    pending_top_left_ = frame->topLeft();
+    pending_dpi_ = frame->dpi();
+    pending_capturer_type_ = frame->capturerType();
+
+    // The oldest of the merged changes waits the longest, so the times of the first frame are
+    // kept.
+    if (pending_region_.isEmpty())
+    {
+        pending_capture_time_ = frame->captureTime();
+        pending_diff_time_ = frame->diffTime();
+    }
+
+    {
+        std::scoped_lock statistics_lock(statistics_lock_);
+
+        ++statistics_.captured_frames;
+        if (!pending_region_.isEmpty())
+            ++statistics_.dropped_frames;
+    }
+
+    // If the previous pending frame has not been encoded yet, its region is merged with the new
+    // one.
+    pending_region_.addRegion(updated_region);
+
+    pending_members_ = std::move(next_members_);
+    next_members_.clear();
+
+    pending_roi_.swap(&next_roi_);
+    next_roi_.clear();
+
+    pending_key_frame_ = pending_key_frame_ || next_key_frame_;
+    next_key_frame_ = false;
+
+    if (encode_scheduled_)
+        return;
+
+    encode_scheduled_ = true;
+    thread_.taskRunner()->postTask(std::bind(&VideoEncoderGroup::encodePendingFrame, this));
+}
+
+VideoEncoderGroup::Statistics VideoEncoderGroup::statistics() const
+{
+    std::scoped_lock lock(statistics_lock_);
+    return statistics_;
+}
+
+void VideoEncoderGroup::onBeforeThreadRunning()
+{
+    // The encoder is created on the thread where it is used.
+    scale_reducer_ = std::make_unique<base::ScaleReducer>();
+    buffer_pool_ = std::make_unique<base::ByteArrayPool>(kMaxPooledBuffers);
+    video_encoder_ = createVideoEncoder(key_.encoding, key_.full_chroma);
+    if (video_encoder_)
+        video_encoder_->setPackedDirtyRects(key_.packed_dirty_rects);
+
+    capture_latency_ = std::make_unique<base::SampleWindow>(kMaxLatencySamples);
+    encode_latency_ = std::make_unique<base::SampleWindow>(kMaxLatencySamples);
+    host_latency_ = std::make_unique<base::SampleWindow>(kMaxLatencySamples);
+    latency_log_time_ = Clock::now();
+
+    // The refinement requires a decoder that updates only the dirty rects of the frame.
+    if (key_.lossless_refinement && hasActiveMap(key_.encoding))
+    {
+        refinement_encoder_ = base::VideoEncoderZstd::create();
+        refinement_encoder_->setPackedDirtyRects(key_.packed_dirty_rects);
+
+        // The tiles are cached when they are refined, so the cached pixels are exact.
+        if (key_.tile_cache)
+        {
+            tile_cache_ = std::make_unique<base::VideoTileCache>(
+                base::VideoTileCache::kDefaultCapacity, false);
+        }
+    }
+}
+
+void VideoEncoderGroup::onAfterThreadRunning()
+{
+    flush_members_.clear();
+    refinement_members_.clear();
+    last_encoded_frame_ = nullptr;
+    tile_cache_.reset();
+    refinement_encoder_.reset();
+    video_encoder_.reset();
+    buffer_pool_.reset();
+    scale_reducer_.reset();
+    work_frame_.reset();
+    host_latency_.reset();
+    encode_latency_.reset();
+    capture_latency_.reset();
+}
+
+void VideoEncoderGroup::encodePendingFrame()
+{
+    TRACE_EVENT("encode", "VideoEncoderGroup::encodePendingFrame");
+
+    Members members;
+    base::Region roi;
+    bool key_frame;
+    double cpu_budget;
+    base::Rect copy_rect;
+    base::Point copy_source;
+    base::Region copy_region;
+    std::shared_ptr<const base::FrameTileStore::Snapshot> snapshot;
+    base::Point source_offset;
+
+    {
+        std::scoped_lock lock(pending_lock_);
+
+        if (!pending_snapshot_)
+        {
+            encode_scheduled_ = false;
+            return;
+        }
+
+        // While a member has too much unsent video, nothing is encoded. The updated regions of
+        // the new frames are merged, and the encoding resumes with them when the queue drains.
+        for (const auto& member : pending_members_)
+        {
+            if (member.channel_proxy->pendingBytes() > pendingBytesLimit(member.bitrate))
+            {
+                thread_.taskRunner()->postDelayedTask(
+                    std::bind(&VideoEncoderGroup::encodePendingFrame, this),
+                    kCongestionCheckInterval);
+                return;
+            }
+        }
+
+        // The new changes are merged into the pending frame until the encoder is within the CPU
+        // budget again.
+        const TimePoint now = Clock::now();
+        if (now < next_encode_time_)
+        {
+            thread_.taskRunner()->postDelayedTask(
+                std::bind(&VideoEncoderGroup::encodePendingFrame, this),
+                std::chrono::duration_cast<std::chrono::milliseconds>(next_encode_time_ - now) +
+                    std::chrono::milliseconds(1));
+            return;
+        }
+
+        encode_scheduled_ = false;
+
+        if (!work_frame_ || work_frame_->size() != pending_frame_size_)
+        {
+            // The refinement may point to the previous frame.
+            last_encoded_frame_ = nullptr;
+
+            work_frame_ = base::FrameSimple::create(pending_frame_size_);
+            pending_region_.setRect(base::Rect::makeSize(pending_frame_size_));
+            pending_copy_region_.clear();
+        }
+
+        snapshot.swap(pending_snapshot_);
+        pending_snapshot_.reset();
+        source_offset = pending_source_offset_;
+
+        work_frame_->setTopLeft(pending_top_left_);
+        work_frame_->setDpi(pending_dpi_);
+        work_frame_->setCapturerType(pending_capturer_type_);
+        work_frame_->setCaptureTime(pending_capture_time_);
+        work_frame_->setDiffTime(pending_diff_time_);
+        work_source_size_ = pending_source_size_;
+        work_size_ = pending_size_;
+        work_frame_->updatedRegion()->swap(&pending_region_);
+        pending_region_.clear();
+
+        copy_rect = pending_copy_rect_;
+        copy_source = pending_copy_source_;
+        copy_region.swap(&pending_copy_region_);
+        pending_copy_rect_ = base::Rect();
+        pending_copy_region_.clear();
+
+        members.swap(pending_members_);
+        roi.swap(&pending_roi_);
+        key_frame = pending_key_frame_;
+        pending_key_frame_ = false;
+        cpu_budget = pending_cpu_budget_;
+        work_memory_pressure_ = pending_memory_pressure_;
+
+        if (pending_video_region_changed_)
+        {
+            video_region_.swap(&pending_video_region_);
+            pending_video_region_changed_ = false;
+
+            LOG(LS_INFO) << "Video region " << (video_region_.isEmpty() ? "cleared" : "found");
+        }
+    }
+
+    // The pixels are copied outside of the lock, so the caller thread is not blocked by it.
+    for (base::Region::Iterator it(work_frame_->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+        snapshot->copyTo(rect.translated(source_offset), work_frame_.get(), rect.topLeft());
+    }
+
+    snapshot.reset();
+
+    if (!video_encoder_ || members.empty())
+        return;
+
+    // The replay holds the buffers of many messages.
+    if (work_memory_pressure_)
+        clearReplay();
+
+    // The joining members get the replay before the new frame. If it is not available, the frame
+    // is encoded as a key frame for all members.
+    if (!sendReplay(&members) && !key_frame)
+    {
+        key_frame = true;
+        work_frame_->updatedRegion()->setRect(base::Rect::makeSize(work_frame_->size()));
+    }
+
+    if (cpu_budget != work_cpu_budget_)
+    {
+        video_encoder_->setCpuBudget(cpu_budget);
+        work_cpu_budget_ = cpu_budget;
+    }
+
+    if (key_frame)
+    {
+        // The number of layers can only be changed with a key frame.
+        layering_enabled_ = video_encoder_->setTemporalLayering(members.size() > 1);
+        video_encoder_->setKeyFrameRequired();
+    }
+
+    uint32_t min_bitrate = members.front().bitrate;
+    uint32_t max_bitrate = members.front().bitrate;
+
+    for (const auto& member : members)
+    {
+        min_bitrate = std::min(min_bitrate, member.bitrate);
+        max_bitrate = std::max(max_bitrate, member.bitrate);
+    }
+
+    const uint32_t bitrate = layering_enabled_ ? max_bitrate : min_bitrate;
+    if (bitrate && bitrate != last_bitrate_)
+    {
+        video_encoder_->setTargetBitrate(bitrate);
+        last_bitrate_ = bitrate;
+    }
+
+    // The changes of the video region wait until its interval has passed. A key frame contains
+    // the whole screen anyway.
+    base::Region* updated_region = work_frame_->updatedRegion();
+    const TimePoint now = Clock::now();
+
+    if (video_region_.isEmpty() || video_encoder_->isKeyFrameRequired(work_size_) ||
+        now - video_encode_time_ >= kVideoRegionInterval)
+    {
+        updated_region->addRegion(deferred_region_);
+        deferred_region_.clear();
+        video_encode_time_ = now;
+    }
+    else
+    {
+        base::Region deferred_region = *updated_region;
+        deferred_region.intersectWith(video_region_);
+
+        updated_region->subtract(deferred_region);
+        deferred_region_.addRegion(deferred_region);
+    }
+
+    if (refresh_row_ >= 0 && !video_encoder_->isKeyFrameRequired(work_size_))
+    {
+        const base::Size& size = work_frame_->size();
+        const int stripe_height = (size.height() + kRefreshStripes - 1) / kRefreshStripes;
+
+        base::Rect stripe = base::Rect::makeXYWH(0, refresh_row_, size.width(), stripe_height);
+        stripe.intersectWith(base::Rect::makeSize(size));
+        updated_region->addRect(stripe);
+
+        refresh_row_ += stripe_height;
+        if (refresh_row_ >= size.height())
+            refresh_row_ = -1;
+    }
+
+    if (!deferred_region_.isEmpty())
+    {
+        flush_members_ = members;
+        scheduleFlush(kVideoRegionInterval);
+    }
+
+    // Only the video region has changed.
+    if (updated_region->isEmpty())
+        return;
+
+    // The regions are set in the coordinates of the source frame.
+    const base::Size& source_size = work_frame_->size();
+    const base::Region scaled_video_region = scaledRegion(video_region_, source_size);
+
+    video_encoder_->setRegionOfInterest(scaledRegion(roi, source_size));
+    video_encoder_->setVideoRegion(scaled_video_region);
+
+    // The scaler may replace its output frame, which the refinement may point to. The pointer is
+    // set again after the frame is encoded.
+    last_encoded_frame_ = nullptr;
+
+    const base::Frame* scaled_frame = scale_reducer_->scaleFrame(work_frame_.get(), work_size_);
+    if (!scaled_frame)
+    {
+        LOG(LS_ERROR) << "No scaled frame";
+        return;
+    }
+
+    message_.clear();
+
+    proto::VideoPacket* packet = message_->mutable_video_packet();
+
+    // A key frame clears the cache of the client. With the temporal layers the slow members do not
+    // receive all packets, and the recordings contain only the encoded video, so in these cases
+    // neither the cache nor the copy rect is used.
+    auto has_recorder = [](const Member& member) { return member.recorder != nullptr; };
+    const bool recording = std::any_of(members.cbegin(), members.cend(), has_recorder);
+
+    const bool key_packet = video_encoder_->isKeyFrameRequired(scaled_frame->size());
+    const bool incremental = !layering_enabled_ && !key_packet && !recording;
+
+    // The copy of a scaled frame is not exact. The source of the copy may be in the deferred
+    // region, which the client does not have yet.
+    if (!copy_region.isEmpty() && incremental && scaled_frame == work_frame_.get() &&
+        deferred_region_.isEmpty())
+    {
+        addCopyRect(copy_rect, copy_source, copy_region, packet);
+    }
+    else
+    {
+        copy_region.clear();
+    }
+
+    base::Region cached_region;
+    if (tile_cache_ && incremental)
+        paintCachedTiles(scaled_frame, packet, &cached_region);
+
+    // A recording starts a new file with each format, and the file must start with a key frame.
+    video_encoder_->setInterFrameResize(!recording);
+
+    // Encode the frame into a video packet.
+    const TimePoint encode_start_time = Clock::now();
+    video_encoder_->encode(scaled_frame, packet);
+
+    if (video_encoder_->isFailed())
+    {
+        // The packet with the format contains neither the copy rect nor the cached tiles. The
+        // client creates the decoder for the encoding of the packet, so the video continues with
+        // VP8, which every client supports.
+        LOG(LS_WARNING) << "Video encoder failed, falling back to VP8";
+
+        video_encoder_ = createVideoEncoder(proto::VIDEO_ENCODING_VP8, false);
+        video_encoder_->setPackedDirtyRects(key_.packed_dirty_rects);
+        video_encoder_->setCpuBudget(work_cpu_budget_);
+        if (last_bitrate_)
+            video_encoder_->setTargetBitrate(last_bitrate_);
+        layering_enabled_ = video_encoder_->setTemporalLayering(members.size() > 1);
+        video_encoder_->setRegionOfInterest(scaledRegion(roi, source_size));
+        video_encoder_->setVideoRegion(scaled_video_region);
+        video_encoder_->setInterFrameResize(!recording);
+
+        packet->Clear();
+        video_encoder_->encode(scaled_frame, packet);
+    }
+
+    next_encode_time_ = encode_start_time +
+        std::max(video_encoder_->minFrameInterval(),
+                 std::chrono::duration_cast<std::chrono::microseconds>(key_.frame_interval));
+    packet->set_stream_id(key_.stream_id);
+
+    proto::VideoPacketTimestamps* timestamps = packet->mutable_timestamps();
+    timestamps->set_capture_time(work_frame_->captureTime());
+    timestamps->set_diff_time(work_frame_->diffTime());
+    timestamps->set_encode_time(base::SystemTime::microsecondsSinceEpoch());
+
+    if (packet->has_format())
+    {
+        proto::VideoPacketFormat* format = packet->mutable_format();
+
+        // In video packets that contain the format, we pass the screen capture type.
+        format->set_capturer_type(work_frame_->capturerType());
+
+        // Real screen size.
+        proto::Size* screen_size = format->mutable_screen_size();
+        screen_size->set_width(work_source_size_.width());
+        screen_size->set_height(work_source_size_.height());
+
+        if (key_.stream_id)
+        {
+            format->mutable_video_rect()->set_x(key_.position.x());
+            format->mutable_video_rect()->set_y(key_.position.y());
+
+            proto::Size* desktop_video_size = format->mutable_desktop_video_size();
+            desktop_video_size->set_width(key_.desktop_size.width());
+            desktop_video_size->set_height(key_.desktop_size.height());
+        }
+
+        format->set_video_recovery(true);
+
+        // The encoders with the active map update only the active blocks, the stripes make them
+        // active.
+        if (hasActiveMap(video_encoder_->encoding()))
+            refresh_row_ = 0;
+
+        if (tile_cache_)
+        {
+            tile_cache_->clear();
+
+            if (!layering_enabled_)
+                format->set_tile_cache_size(static_cast<uint32_t>(tile_cache_->capacity()));
+        }
+
+        LOG(LS_INFO) << "Video packet has format";
+        LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
+            static_cast<base::ScreenCapturer::Type>(work_frame_->capturerType()));
+        LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x" << screen_size->height();
+        LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
+                     << format->video_rect().height();
+    }
+
+    if (refinement_encoder_)
+    {
+        // After a packet with the format the client has a new frame, so all tiles are refined
+        // again.
+        const base::Size& size = scaled_frame->size();
+
+        if (packet->has_format())
+        {
+            markChangedTiles(size, base::Region(base::Rect::makeSize(size)), false);
+        }
+        else
+        {
+            markChangedTiles(size, scaled_frame->constUpdatedRegion(), false);
+
+            // The copied pixels of the client are lossy as the pixels of the source area.
+            markChangedTiles(size, copy_region, false);
+
+            // The playing video is not refined.
+            markChangedTiles(size, scaled_video_region, false);
+
+            // The tiles from the cache are refined already.
+            markChangedTiles(size, cached_region, true);
+        }
+
+        last_encoded_frame_ = scaled_frame;
+        refinement_members_ = members;
+        scheduleRefinement();
+    }
+
+    // The recording gets every frame of the base and the enhancement layers. The writer only
+    // copies the packet and returns, the file is written on its own thread.
+    for (const auto& member : members)
+    {
+        if (member.recorder)
+            member.recorder->addVideoPacket(*packet);
+    }
+
+    // The frames of the enhancement layer are not referenced by the base layer and may be skipped
+    // for the members that are much slower than the target bitrate.
+    if (layering_enabled_ && video_encoder_->temporalLayer() > 0)
+    {
+        auto is_slow = [bitrate](const Member& member)
+        {
+            return static_cast<uint64_t>(member.bitrate) * 4 < static_cast<uint64_t>(bitrate) * 3;
+        };
+
+        members.erase(std::remove_if(members.begin(), members.end(), is_slow), members.end());
+    }
+
+    timestamps->set_send_time(base::SystemTime::microsecondsSinceEpoch());
+    addLatencySample(*timestamps);
+
+    // The replay starts with the key frame.
+    if (key_packet)
+    {
+        clearReplay();
+        replay_active_ = !work_memory_pressure_;
+    }
+
+    sendMessage(members);
+
+    if (work_memory_pressure_)
+        buffer_pool_->trim();
+
+    updateStatistics();
+
+    if (refresh_row_ >= 0)
+    {
+        flush_members_ = members;
+        scheduleFlush(kRefreshInterval);
+    }
+}
+
+void VideoEncoderGroup::scheduleFlush(std::chrono::milliseconds delay)
+{
+    if (flush_scheduled_)
+        return;
+
+    flush_scheduled_ = true;
+    thread_.taskRunner()->postDelayedTask(
+        std::bind(&VideoEncoderGroup::flushPendingChanges, this), delay);
+}
+
+void VideoEncoderGroup::flushPendingChanges()
+{
+    flush_scheduled_ = false;
+
+    if ((deferred_region_.isEmpty() && refresh_row_ < 0) || flush_members_.empty())
+        return;
+
+    {
+        std::scoped_lock lock(pending_lock_);
+
+        // The next frame takes the deferred region and the refresh stripe with it.
+        if (encode_scheduled_)
+            return;
+
+        // There are no new frames, the last changes of the video and the refresh are encoded
+        // without them.
+        if (pending_members_.empty())
+            pending_members_ = flush_members_;
+
+        encode_scheduled_ = true;
+    }
+
+    encodePendingFrame();
+}
+
+base::Region VideoEncoderGroup::scaledRegion(
+    const base::Region& region, const base::Size& source_size) const
+{
+    if (region.isEmpty() || source_size == work_size_)
+        return region;
+
+    const double scale_x = static_cast<double>(work_size_.width()) / source_size.width();
+    const double scale_y = static_cast<double>(work_size_.height()) / source_size.height();
+
+    base::Region scaled_region;
+
+    for (base::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        scaled_region.addRect(base::Rect::makeLTRB(
+            static_cast<int32_t>(std::floor(rect.left() * scale_x)),
+            static_cast<int32_t>(std::floor(rect.top() * scale_y)),
+            static_cast<int32_t>(std::ceil(rect.right() * scale_x)),
+            static_cast<int32_t>(std::ceil(rect.bottom() * scale_y))));
+    }
+
+    return scaled_region;
+}
+
+void VideoEncoderGroup::sendMessage(const Members& members)
+{
+    // The message is serialized into a pooled buffer which is shared by all members, so it is not
+    // allocated for each frame and not copied for each member. The encryptor of each channel
+    // reads it directly.
+    std::shared_ptr<base::ByteArray> buffer = buffer_pool_->acquire();
+    base::serialize(*message_, buffer.get());
+
+    // NetworkChannelProxy::send() is thread-safe, so the packet is sent directly from the encoder
+    // thread. Large frames are sent in fragments, the cursor, audio and replies are sent between
+    // them.
+    for (const auto& member : members)
+    {
+        member.channel_proxy->send(std::shared_ptr<const base::ByteArray>(buffer),
+                                   base::NetworkChannel::Priority::VIDEO);
+    }
+
+    if (!replay_active_)
+        return;
+
+    // The first message of the replay is the key frame.
+    const size_t max_size = replay_.empty() ?
+        kMaxReplaySize : std::min(replay_.front()->size() * kMaxReplayKeyFrames, kMaxReplaySize);
+
+    replay_size_ += buffer->size();
+    if (replay_size_ > max_size)
+    {
+        LOG(LS_INFO) << "Video replay dropped (size: " << replay_size_ << ")";
+        clearReplay();
+        return;
+    }
+
+    replay_.emplace_back(std::move(buffer));
+}
+
+bool VideoEncoderGroup::sendReplay(Members* members)
+{
+    auto is_joining = [](const Member& member) { return member.joining; };
+    if (std::none_of(members->cbegin(), members->cend(), is_joining))
+        return true;
+
+    // A recording must start with a key frame, and the replay is not written into it.
+    auto needs_key_frame = [](const Member& member) { return member.joining && member.recorder; };
+
+    const bool available = !replay_.empty() &&
+        std::none_of(members->cbegin(), members->cend(), needs_key_frame);
+
+    for (auto& member : *members)
+    {
+        if (!member.joining)
+            continue;
+
+        member.joining = false;
+
+        if (!available)
+            continue;
+
+        // The member has missed nothing since the key frame, so it is in sync with the others
+        // after the replay.
+        for (const auto& message : replay_)
+            member.channel_proxy->send(message, base::NetworkChannel::Priority::VIDEO);
+    }
+
+    if (available)
+    {
+        LOG(LS_INFO) << "Video replay sent (messages: " << replay_.size() << ", size: "
+                     << replay_size_ << ")";
+    }
+
+    return available;
+}
+
+void VideoEncoderGroup::clearReplay()
+{
+    replay_.clear();
+    replay_size_ = 0;
+    replay_active_ = false;
+}
+
+void VideoEncoderGroup::markChangedTiles(
+    const base::Size& size, const base::Region& region, bool refined)
+{
+    const TimePoint now = Clock::now();
+    const base::Size grid_size((size.width() + kRefinementTileSize - 1) / kRefinementTileSize,
+                               (size.height() + kRefinementTileSize - 1) / kRefinementTileSize);
+
+    if (grid_size != tile_grid_size_)
+    {
+        tile_grid_size_ = grid_size;
+        tiles_.assign(static_cast<size_t>(grid_size.width()) * grid_size.height(), { now, false });
+        return;
+    }
+
+    for (base::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        for (int y = rect.top() / kRefinementTileSize;
+             y <= (rect.bottom() - 1) / kRefinementTileSize; ++y)
+        {
+            for (int x = rect.left() / kRefinementTileSize;
+                 x <= (rect.right() - 1) / kRefinementTileSize; ++x)
+            {
+                tiles_[y * grid_size.width() + x] = { now, refined };
+            }
+        }
+    }
+}
+
+void VideoEncoderGroup::paintCachedTiles(
+    const base::Frame* frame, proto::VideoPacket* packet, base::Region* cached_region)
+{
+    const base::Rect frame_rect = base::Rect::makeSize(frame->size());
+
+    // The changed tiles. The edges of the region are on the grid of the tiles, so each rectangle
+    // of it consists of whole tiles.
+    base::Region tile_region;
+
+    for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        tile_region.addRect(base::Rect::makeLTRB(
+            rect.left() / kRefinementTileSize * kRefinementTileSize,
+            rect.top() / kRefinementTileSize * kRefinementTileSize,
+            (rect.right() + kRefinementTileSize - 1) / kRefinementTileSize * kRefinementTileSize,
+            (rect.bottom() + kRefinementTileSize - 1) / kRefinementTileSize * kRefinementTileSize));
+    }
+
+    for (base::Region::Iterator it(tile_region); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        for (int y = rect.top(); y < rect.bottom(); y += kRefinementTileSize)
+        {
+            for (int x = rect.left(); x < rect.right(); x += kRefinementTileSize)
+            {
+                base::Rect tile_rect =
+                    base::Rect::makeXYWH(x, y, kRefinementTileSize, kRefinementTileSize);
+                tile_rect.intersectWith(frame_rect);
+
+                const uint64_t key = base::VideoTileCache::tileKey(*frame, tile_rect);
+                if (!tile_cache_->touch(key))
+                    continue;
+
+                proto::VideoTile* tile = packet->add_cached_tile();
+                tile->set_key(key);
+
+                proto::Rect* tile_proto_rect = tile->mutable_rect();
+                tile_proto_rect->set_x(tile_rect.x());
+                tile_proto_rect->set_y(tile_rect.y());
+                tile_proto_rect->set_width(tile_rect.width());
+                tile_proto_rect->set_height(tile_rect.height());
+
+                cached_region->addRect(tile_rect);
+            }
+        }
+    }
+
+    if (cached_region->isEmpty())
+        return;
+
+    // The encoder skips the cached tiles. The frame is owned by the scale reducer or by the group.
+    const_cast<base::Frame*>(frame)->updatedRegion()->subtract(*cached_region);
+}
+
+void VideoEncoderGroup::addCopyRect(const base::Rect& copy_rect, const base::Point& copy_source,
+                                    const base::Region& copy_region, proto::VideoPacket* packet)
+{
+    proto::VideoCopyRect* packet_copy_rect = packet->mutable_copy_rect();
+
+    proto::Rect* rect = packet_copy_rect->mutable_rect();
+    rect->set_x(copy_rect.x());
+    rect->set_y(copy_rect.y());
+    rect->set_width(copy_rect.width());
+    rect->set_height(copy_rect.height());
+
+    packet_copy_rect->set_source_x(copy_source.x());
+    packet_copy_rect->set_source_y(copy_source.y());
+
+    // The encoder skips the copied area. The parts changed after the copy remain in the updated
+    // region and overwrite the copied pixels when the client decodes the packet.
+    work_frame_->updatedRegion()->subtract(copy_region);
+}
+
+void VideoEncoderGroup::scheduleRefinement()
+{
+    if (refinement_scheduled_)
+        return;
+
+    refinement_scheduled_ = true;
+    thread_.taskRunner()->postDelayedTask(
+        std::bind(&VideoEncoderGroup::refineStaticTiles, this), kRefinementCheckInterval);
+}
+
+void VideoEncoderGroup::refineStaticTiles()
+{
+    refinement_scheduled_ = false;
+
+    if (!refinement_encoder_ || !last_encoded_frame_ || refinement_members_.empty())
+        return;
+
+    // The refinement has a lower priority than the video and waits until the queues drain.
+    for (const auto& member : refinement_members_)
+    {
+        if (member.channel_proxy->pendingBytes() > pendingBytesLimit(member.bitrate) / 2)
+        {
+            scheduleRefinement();
+            return;
+        }
+    }
+
+    const TimePoint now = Clock::now();
+    const base::Rect frame_rect = base::Rect::makeSize(last_encoded_frame_->size());
+
+    base::Region region;
+    size_t refined_count = 0;
+    bool has_unrefined = false;
+
+    message_.clear();
+
+    for (int y = 0; y < tile_grid_size_.height(); ++y)
+    {
+        for (int x = 0; x < tile_grid_size_.width(); ++x)
+        {
+            Tile& tile = tiles_[y * tile_grid_size_.width() + x];
+            if (tile.refined)
+                continue;
+
+            if (now - tile.changed_time < kRefinementDelay ||
+                refined_count >= kMaxRefinedTilesPerPacket)
+            {
+                has_unrefined = true;
+                continue;
+            }
+
+            base::Rect rect = base::Rect::makeXYWH(x * kRefinementTileSize,
+                                                   y * kRefinementTileSize,
+                                                   kRefinementTileSize,
+                                                   kRefinementTileSize);
+            rect.intersectWith(frame_rect);
+
+            region.addRect(rect);
+            tile.refined = true;
+            ++refined_count;
+
+            // The client adds the tile to the cache after it is refined.
+            if (tile_cache_ && !layering_enabled_)
+            {
+                const uint64_t key = base::VideoTileCache::tileKey(*last_encoded_frame_, rect);
+                tile_cache_->add(key, *last_encoded_frame_, rect);
+
+                proto::VideoTile* stored_tile = message_->mutable_video_packet()->add_stored_tile();
+                stored_tile->set_key(key);
+
+                proto::Rect* stored_rect = stored_tile->mutable_rect();
+                stored_rect->set_x(rect.x());
+                stored_rect->set_y(rect.y());
+                stored_rect->set_width(rect.width());
+                stored_rect->set_height(rect.height());
+            }
+        }
+    }
+
+    if (!region.isEmpty())
+    {
+        proto::VideoPacket* packet = message_->mutable_video_packet();
+        refinement_encoder_->encode(last_encoded_frame_, region, packet);
+
+        // The frame on the client side is created by the packets of the main encoder.
+        packet->clear_format();
+        packet->set_stream_id(key_.stream_id);
+
+        sendMessage(refinement_members_);
+    }
+
+    if (has_unrefined)
+        scheduleRefinement();
+}
+
+void VideoEncoderGroup::addLatencySample(const proto::VideoPacketTimestamps& timestamps)
+{
+    // The frames of the fake session have no capture times.
+    if (!timestamps.capture_time() || !timestamps.diff_time())
+        return;
+
+    capture_latency_->add(timestamps.diff_time() - timestamps.capture_time());
+    encode_latency_->add(timestamps.encode_time() - timestamps.diff_time());
+    host_latency_->add(timestamps.send_time() - timestamps.capture_time());
+
+    const TimePoint now = Clock::now();
+    if (now - latency_log_time_ < kLatencyLogInterval)
+        return;
+
+    latency_log_time_ = now;
+
+    LOG(LS_INFO) << "Video latency on host (encoding: " << key_.encoding << ", frames: "
+                 << host_latency_->count() << ")";
+    LOG(LS_INFO) << "Capture: " << percentilesToString(*capture_latency_);
+    LOG(LS_INFO) << "Queue and encode: " << percentilesToString(*encode_latency_);
+    LOG(LS_INFO) << "Total: " << percentilesToString(*host_latency_);
+}
+
+void VideoEncoderGroup::updateStatistics()
+{
+    const TimePoint now = Clock::now();
+    const bool update_medians = now - statistics_time_ >= kStatisticsInterval;
+
+    int64_t capture_time = 0;
+    int64_t encode_time = 0;
+
+    size_t memory_usage = scale_reducer_->memoryUsage() + video_encoder_->memoryUsage() +
+        buffer_pool_->memoryUsage();
+
+    if (work_frame_)
+        memory_usage += static_cast<size_t>(work_frame_->stride()) * work_frame_->size().height();
+
+    if (refinement_encoder_)
+        memory_usage += refinement_encoder_->memoryUsage();
+
+    memory_usage += replay_size_;
+
+    if (update_medians)
+    {
+        statistics_time_ = now;
+        capture_time = capture_latency_->percentile(50);
+        encode_time = encode_latency_->percentile(50);
+    }
+
+    std::scoped_lock lock(statistics_lock_);
+
+    ++statistics_.encoded_frames;
+    statistics_.bitrate = last_bitrate_;
+    statistics_.quantizer = video_encoder_->lastQuantizer();
+    statistics_.memory_usage = memory_usage;
+
+    if (update_medians)
+    {
+        statistics_.capture_time = capture_time;
+        statistics_.encode_time = encode_time;
+    }
+}
+
+} // namespace host
@@ -0,0 +1,337 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__VIDEO_ENCODER_GROUP_H
+#define HOST__VIDEO_ENCODER_GROUP_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/frame_tile_store.h"
+#include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
+#include "base/memory/arena_message.h"
+#include "base/memory/byte_array.h"
+#include "base/threading/thread.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+class ByteArrayPool;
+class Frame;
+class NetworkChannelProxy;
+class SampleWindow;
+class ScaleReducer;
+class VideoEncoder;
+class VideoEncoderZstd;
+class VideoRegionDetector;
+class VideoTileCache;
+class WebmFileWriter;
+} // namespace base
+
+namespace host {
+
+// Encodes the screen once for all clients with the same video parameters. The encoded video
+// packet is serialized once and the same message is sent to every member of the group.
+// The encoding is done on a separate thread, so the session thread is not blocked by it. Frames
+// are passed through a slot for one frame: if the encoder is busy, a new frame replaces the
+// pending one and their updated regions are merged. So a late frame is never encoded.
+// If the lossless refinement is enabled, the tiles of the screen that have not changed for a while
+// are sent once more with VideoEncoderZstd, so the static text becomes pixel-perfect without
+// raising the bitrate of the lossy video.
+// With the refinement the client may also keep the refined tiles in a cache (see
+// base::VideoTileCache). A changed tile which is found in the cache is painted from it by the
+// client and is not encoded.
+// If the capturer has found a scroll (see base::Frame::copyRect()), the client copies the scrolled
+// area in its previous frame and only the rest of the changes is encoded.
+// The areas which change in almost every frame (a video or a 3D viewport, see
+// base::VideoRegionDetector) are encoded with a higher quantizer and at a lower frame rate, so the
+// rest of the screen stays sharp and is updated at the full rate.
+// A key frame is limited in size. After it the whole frame is encoded once more in stripes over
+// the next frames, so a new client does not cause a burst on the channel.
+// The group keeps the messages sent since the last key frame. A client that joins the group
+// receives them at once and continues with the next frame, so the other members do not get a new
+// key frame for it.
+// The encoder chooses its speed preset to stay within the CPU budget of the group. If even the
+// fastest preset exceeds it, the frames are encoded at a lower rate.
+// Each video packet carries the times of the capture, diff, encoding and sending of its frame. The
+// percentiles of the time spent on the host are written to the log periodically.
+class VideoEncoderGroup : public base::Thread::Delegate
+{
+public:
+    struct Key
+    {
+        proto::VideoEncoding encoding = proto::VIDEO_ENCODING_UNKNOWN;
+        bool full_chroma = false;
+        bool lossless_refinement = false;
+        bool tile_cache = false;
+        bool copy_rect = false;
+        bool multi_stream = false;
+        bool packed_dirty_rects = false;
+        base::Size size;
+
+        // The minimum interval between the encoded frames. The changes in between are merged into
+        // the next frame. Zero for the full frame rate.
+        std::chrono::milliseconds frame_interval{ 0 };
+
+        // In the multi-stream mode each screen is encoded by its own group. A group encodes the
+        // area |source_rect| of the source frame into the stream |stream_id| of |size|, which is
+        // placed at |position| in the video of the whole desktop of |desktop_size|. The group of
+        // the stream 0 encodes the whole source frame.
+        uint32_t stream_id = 0;
+        base::Rect source_rect;
+        base::Point position;
+        base::Size desktop_size;
+
+        // Returns true if the key differs from |other| only by the size of a single stream.
+        bool isResizeOf(const Key& other) const;
+
+        // Returns the key of the whole video of the client. It is the key itself for the stream 0.
+        Key desktopKey() const;
+
+        bool operator<(const Key& other) const;
+        bool operator==(const Key& other) const;
+        bool operator!=(const Key& other) const { return !(*this == other); }
+    };
+
+    struct Statistics
+    {
+        // The numbers of frames since the group was created. The dropped frames are merged into
+        // the next frame because the encoder or the network was busy.
+        uint64_t captured_frames = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t encoded_frames = 0;
+
+        // The medians (in microseconds) of the time of the capture with the diff and of the time
+        // in the queue with the encoding.
+        int64_t capture_time = 0;
+        int64_t encode_time = 0;
+
+        uint32_t bitrate = 0;
+        int quantizer = -1;
+
+        // Estimate of the memory (in bytes) used by the group: its frames, the encoders and the
+        // buffers of the messages.
+        size_t memory_usage = 0;
+    };
+
+    explicit VideoEncoderGroup(const Key& key);
+    ~VideoEncoderGroup();
+
+    // Returns true if the host is able to encode the video with |encoding|.
+    static bool isSupported(proto::VideoEncoding encoding);
+
+    // Returns the keys of the streams for the video of |key|. If the multi-stream mode is enabled
+    // and the source frame of |source_size| contains several |screen_rects|, there is a stream
+    // for each screen. The streams are scaled with the same factor as the whole video, so the
+    // client composes the desktop of the size of |key|. Otherwise |key| is returned.
+    static std::vector<Key> streamKeys(const Key& key, const base::Size& source_size,
+                                       const std::vector<base::Rect>& screen_rects);
+
+    const Key& key() const { return key_; }
+
+    // Changes the size of the video of a single stream group. The next encoded packet contains
+    // the format. The encoders which scale the reference frames (VP9) do not send a key frame
+    // for it.
+    void resize(const base::Size& size);
+
+    // Adds a member which receives the next encoded frame. Must be called for each member before
+    // each call of encode().
+    // If |joining| is true, the member has no picture yet (it has just joined the group or has
+    // lost its picture). It is sent the last key frame and the messages after it. If they are
+    // not kept, the next frame is encoded as a key frame for all members.
+    // A group of one member is encoded with its bitrate. If the encoder supports temporal layers
+    // (VP9), a group of several members is encoded with the bitrate of the fastest member. The
+    // members that cannot keep up with it receive only the base layer, which is decodable on its
+    // own at about half of the frame rate. Without temporal layers the group is encoded with the
+    // bitrate of the slowest member.
+    void addMember(std::shared_ptr<base::NetworkChannelProxy> channel_proxy, uint32_t bitrate,
+                   std::shared_ptr<base::WebmFileWriter> recorder, bool joining);
+
+    // Limits the CPU time of the encoder to |share| (0..1] of all the processor cores.
+    void setCpuBudget(double share);
+
+    // While the session of the group is over its memory limit, the buffers of the messages which
+    // are not in use are released after each frame instead of being reused.
+    void setMemoryPressure(bool pressure);
+
+    // Sets the region (in the coordinates of the source frame) where the members work now. It gets
+    // more bits in the next encoded frames. The group of a stream uses the part in its screen.
+    void setRegionOfInterest(const base::Region& region);
+
+    // Schedules the encoding of the updated region of |frame| (or of the screen of the stream).
+    // The pixels are taken from |snapshot| of the frame on the encoder thread, so the group does
+    // not keep its own copy of the screen. Returns immediately.
+    void encode(const base::Frame* frame,
+                std::shared_ptr<const base::FrameTileStore::Snapshot> snapshot);
+
+    // May be called on any thread.
+    Statistics statistics() const;
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+private:
+    struct Member
+    {
+        std::shared_ptr<base::NetworkChannelProxy> channel_proxy;
+        uint32_t bitrate;
+
+        // If set, the frames sent to the member are also written into the session recording.
+        std::shared_ptr<base::WebmFileWriter> recorder;
+
+        bool joining;
+    };
+
+    using Members = std::vector<Member>;
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
+    struct Tile
+    {
+        TimePoint changed_time;
+        bool refined;
+    };
+
+    // Called on the encoder thread.
+    void encodePendingFrame();
+    void sendMessage(const Members& members);
+    bool sendReplay(Members* members);
+    void clearReplay();
+    void markChangedTiles(const base::Size& size, const base::Region& region, bool refined);
+    void paintCachedTiles(const base::Frame* frame, proto::VideoPacket* packet,
+                          base::Region* cached_region);
+    void addCopyRect(const base::Rect& copy_rect, const base::Point& copy_source,
+                     const base::Region& copy_region, proto::VideoPacket* packet);
+    void scheduleFlush(std::chrono::milliseconds delay);
+    void flushPendingChanges();
+    base::Region scaledRegion(const base::Region& region, const base::Size& source_size) const;
+    void scheduleRefinement();
+    void refineStaticTiles();
+    void addLatencySample(const proto::VideoPacketTimestamps& timestamps);
+    void updateStatistics();
+
+    // The size is changed by resize(), so the encoder thread uses |work_size_| instead.
+    Key key_;
+    base::Thread thread_;
+
+    // Members for the next call of encode(). Accessed only on the caller thread.
+    Members next_members_;
+    base::Region next_roi_;
+    bool next_key_frame_ = true;
+    std::unique_ptr<base::VideoRegionDetector> video_region_detector_;
+
+    // The pending frame and its parameters. Access is guarded by |pending_lock_|.
+    std::mutex pending_lock_;
+    std::shared_ptr<const base::FrameTileStore::Snapshot> pending_snapshot_;
+    base::Size pending_frame_size_;
+    base::Point pending_source_offset_;
+    base::Point pending_top_left_;
+    base::Point pending_dpi_;
+    uint32_t pending_capturer_type_ = 0;
+    int64_t pending_capture_time_ = 0;
+    int64_t pending_diff_time_ = 0;
+    base::Size pending_source_size_;
+    base::Size pending_size_;
+    base::Region pending_region_;
+    Members pending_members_;
+    base::Region pending_roi_;
+    bool pending_key_frame_ = false;
+    double pending_cpu_budget_ = 1.0;
+    bool pending_memory_pressure_ = false;
+    bool encode_scheduled_ = false;
+
+    // The copy rect of the pending frame and the part of it which has not changed since then.
+    // The copy is pending only if the pending frame follows the last encoded frame directly.
+    base::Rect pending_copy_rect_;
+    base::Point pending_copy_source_;
+    base::Region pending_copy_region_;
+
+    base::Region pending_video_region_;
+    bool pending_video_region_changed_ = false;
+
+    // Accessed only on the encoder thread.
+    std::unique_ptr<base::Frame> work_frame_;
+    base::Size work_source_size_;
+    base::Size work_size_;
+    uint32_t last_bitrate_ = 0;
+    double work_cpu_budget_ = 0;
+    bool work_memory_pressure_ = false;
+    bool layering_enabled_ = false;
+
+    // The encoder exceeds the CPU budget at its fastest preset, so the next frame is not encoded
+    // before this time.
+    TimePoint next_encode_time_;
+    std::unique_ptr<base::ScaleReducer> scale_reducer_;
+    std::unique_ptr<base::VideoEncoder> video_encoder_;
+    std::unique_ptr<base::ByteArrayPool> buffer_pool_;
+    base::ArenaMessage<proto::HostToClient> message_;
+
+    // Latency of the frames on the host. Accessed only on the encoder thread.
+    std::unique_ptr<base::SampleWindow> capture_latency_;
+    std::unique_ptr<base::SampleWindow> encode_latency_;
+    std::unique_ptr<base::SampleWindow> host_latency_;
+    TimePoint latency_log_time_;
+
+    // The frame counters are updated on both threads. The medians are updated on the encoder
+    // thread once in |kStatisticsInterval|.
+    mutable std::mutex statistics_lock_;
+    Statistics statistics_;
+    TimePoint statistics_time_;
+
+    // The lossless refinement. Accessed only on the encoder thread.
+    std::unique_ptr<base::VideoEncoderZstd> refinement_encoder_;
+    const base::Frame* last_encoded_frame_ = nullptr;
+    Members refinement_members_;
+    base::Size tile_grid_size_;
+    std::vector<Tile> tiles_;
+    bool refinement_scheduled_ = false;
+
+    // The video region and its changes which are not encoded yet. Accessed only on the encoder
+    // thread.
+    base::Region video_region_;
+    base::Region deferred_region_;
+    TimePoint video_encode_time_;
+
+    // The top of the next stripe of the refresh after a key frame, or -1 if the refresh is done.
+    // Accessed only on the encoder thread.
+    int refresh_row_ = -1;
+
+    // The last members get the deferred changes and the refresh if no new frames arrive.
+    Members flush_members_;
+    bool flush_scheduled_ = false;
+
+    // The keys of the tiles in the cache of the client. Accessed only on the encoder thread.
+    std::unique_ptr<base::VideoTileCache> tile_cache_;
+
+    // The serialized messages since the last key frame (starting with it) for the joining members.
+    // The replay is dropped when it grows too large. Accessed only on the encoder thread.
+    std::vector<std::shared_ptr<const base::ByteArray>> replay_;
+    size_t replay_size_ = 0;
+    bool replay_active_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderGroup);
+};
+
+} // namespace host
+
+#endif // HOST__VIDEO_ENCODER_GROUP_H
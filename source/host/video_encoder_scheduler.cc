@@ -0,0 +1,90 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/video_encoder_scheduler.h"
+
+#include "base/logging.h"
+
+namespace host {
+
+namespace {
+
+// A session which has not encoded a frame during this time does not use its share.
+constexpr std::chrono::milliseconds kIdleTimeout{ 1000 };
+
+// Weight of the encoder groups of the sessions with recent input relative to the other groups.
+const double kInteractiveWeight = 4.0;
+const double kNonInteractiveWeight = 1.0;
+
+double weight(bool interactive)
+{
+    return interactive ? kInteractiveWeight : kNonInteractiveWeight;
+}
+
+} // namespace
+
+VideoEncoderScheduler::VideoEncoderScheduler(double cpu_budget)
+    : cpu_budget_(cpu_budget)
+{
+    DCHECK_GT(cpu_budget_, 0);
+}
+
+VideoEncoderScheduler::~VideoEncoderScheduler() = default;
+
+double VideoEncoderScheduler::update(
+    const UserSession* session, size_t group_count, bool interactive)
+{
+    DCHECK(session);
+
+    if (!group_count)
+    {
+        remove(session);
+        return cpu_budget_;
+    }
+
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+
+    Demand& demand = demands_[session];
+    demand.group_count = group_count;
+    demand.interactive = interactive;
+    demand.time = current_time;
+
+    double total_weight = 0;
+
+    for (auto it = demands_.begin(); it != demands_.end();)
+    {
+        if (current_time - it->second.time > kIdleTimeout)
+        {
+            it = demands_.erase(it);
+            continue;
+        }
+
+        total_weight += weight(it->second.interactive) * it->second.group_count;
+        ++it;
+    }
+
+    // With a single session the groups divide the budget equally.
+    return cpu_budget_ * weight(interactive) / total_weight;
+}
+
+void VideoEncoderScheduler::remove(const UserSession* session)
+{
+    demands_.erase(session);
+}
+
+} // namespace host
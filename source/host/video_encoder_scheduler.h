@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__VIDEO_ENCODER_SCHEDULER_H
+#define HOST__VIDEO_ENCODER_SCHEDULER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <map>
+
+namespace host {
+
+class UserSession;
+
+// Divides the CPU budget of the host between the video encoders of all the user sessions. On a
+// terminal server each session captures and encodes its own screen, so the budget of one session
+// is no longer a limit for the host. Each encoder group gets a share of the budget in proportion
+// to its weight: the groups of the sessions where a user works now weigh more than the groups
+// which only show a picture. The speed controllers of the encoders which get a smaller share lower
+// the quality and then the frame rate first.
+// All the methods must be called on the thread of the user sessions.
+class VideoEncoderScheduler
+{
+public:
+    // |cpu_budget| is the share of the CPU time of all the processor cores (0..1].
+    explicit VideoEncoderScheduler(double cpu_budget);
+    ~VideoEncoderScheduler();
+
+    // Registers that |session| encodes a frame with |group_count| encoder groups. |interactive| is
+    // true if its clients have sent input recently. Returns the budget of each of its groups.
+    double update(const UserSession* session, size_t group_count, bool interactive);
+
+    // Removes |session| from the scheduler.
+    void remove(const UserSession* session);
+
+    double cpuBudget() const { return cpu_budget_; }
+
+private:
+    struct Demand
+    {
+        size_t group_count = 0;
+        bool interactive = false;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    const double cpu_budget_;
+
+    // The sessions which have encoded a frame recently. A session whose screen does not change
+    // does not encode and its share is given to the others.
+    std::map<const UserSession*, Demand> demands_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderScheduler);
+};
+
+} // namespace host
+
+#endif // HOST__VIDEO_ENCODER_SCHEDULER_H
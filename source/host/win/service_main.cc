@@ -19,6 +19,7 @@
 #include "host/win/service_main.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "host/integrity_check.h"
 #include "host/win/service.h"
 
@@ -27,6 +28,7 @@ namespace host {
 void hostServiceMain()
 {
     base::initLogging();
+    base::TraceLog::startFromEnvironment("service");
 
     if (!integrityCheck())
     {
@@ -37,6 +39,7 @@ void hostServiceMain()
         Service().exec();
     }
 
+    base::TraceLog::finish();
     base::shutdownLogging();
 }
 
@@ -31,36 +31,23 @@ namespace {
 
 const QString kTranslationsDir = QLatin1String(":/tr/");
 
-} // namespace
-
-LocaleLoader::LocaleLoader()
+QString localeFromFileName(const QString& qm_file)
 {
-    const QStringList qm_file_list =
-        QDir(kTranslationsDir).entryList(QStringList(QLatin1String("*.qm")), QDir::Files);
+    QString locale_name = qm_file.chopped(3); // Remove file extension (*.qm).
 
-    for (const auto& qm_file : qm_file_list)
+    if (locale_name.right(2).isUpper())
     {
-        QString locale_name = qm_file.chopped(3); // Remove file extension (*.qm).
+        // xx_XX (language / country).
+        return locale_name.right(5);
+    }
 
-        if (locale_name.right(2).isUpper())
-        {
-            // xx_XX (language / country).
-            locale_name = locale_name.right(5);
-        }
-        else
-        {
-            // xx (language only).
-            locale_name = locale_name.right(2);
-        }
+    // xx (language only).
+    return locale_name.right(2);
+}
 
-        LOG(LS_INFO) << "Translation file added: " << qm_file << " (" << locale_name << ")";
+} // namespace
 
-        if (locale_list_.contains(locale_name))
-            locale_list_[locale_name].push_back(qm_file);
-        else
-            locale_list_.insert(locale_name, QStringList(qm_file));
-    }
-}
+LocaleLoader::LocaleLoader() = default;
 
 LocaleLoader::~LocaleLoader()
 {
@@ -69,6 +56,8 @@ LocaleLoader::~LocaleLoader()
 
 LocaleLoader::LocaleList LocaleLoader::localeList() const
 {
+    loadLocaleList();
+
     LocaleList list;
 
     auto add_locale = [&](const QString& locale_code)
@@ -104,7 +93,7 @@ LocaleLoader::LocaleList LocaleLoader::localeList() const
 
 bool LocaleLoader::contains(const QString& locale) const
 {
-    return locale_list_.contains(locale);
+    return !fileList(locale).isEmpty();
 }
 
 void LocaleLoader::installTranslators(const QString& locale)
@@ -113,22 +102,64 @@ void LocaleLoader::installTranslators(const QString& locale)
 
     LOG(LS_INFO) << "Install translators for: " << locale;
 
-    auto file_list = locale_list_.constFind(locale);
-    if (file_list == locale_list_.constEnd())
-        return;
-
-    for (const auto& file : file_list.value())
+    for (const auto& file : fileList(locale))
     {
         QScopedPointer<QTranslator> translator(new QTranslator());
 
         if (translator->load(file, kTranslationsDir))
         {
             if (QCoreApplication::installTranslator(translator.get()))
+            {
+                LOG(LS_INFO) << "Translation file installed: " << file;
                 translator_list_.push_back(translator.take());
+            }
         }
     }
 }
 
+QStringList LocaleLoader::fileList(const QString& locale) const
+{
+    if (locale_list_loaded_)
+        return locale_list_.value(locale);
+
+    // Only the files of the locale are listed. The names of the files end with the locale.
+    const QStringList qm_file_list = QDir(kTranslationsDir).entryList(
+        QStringList(QLatin1String("*_") + locale + QLatin1String(".qm")), QDir::Files);
+
+    QStringList file_list;
+
+    for (const auto& qm_file : qm_file_list)
+    {
+        if (localeFromFileName(qm_file) == locale)
+            file_list.push_back(qm_file);
+    }
+
+    return file_list;
+}
+
+void LocaleLoader::loadLocaleList() const
+{
+    if (locale_list_loaded_)
+        return;
+
+    const QStringList qm_file_list =
+        QDir(kTranslationsDir).entryList(QStringList(QLatin1String("*.qm")), QDir::Files);
+
+    for (const auto& qm_file : qm_file_list)
+    {
+        QString locale_name = localeFromFileName(qm_file);
+
+        LOG(LS_INFO) << "Translation file added: " << qm_file << " (" << locale_name << ")";
+
+        if (locale_list_.contains(locale_name))
+            locale_list_[locale_name].push_back(qm_file);
+        else
+            locale_list_.insert(locale_name, QStringList(qm_file));
+    }
+
+    locale_list_loaded_ = true;
+}
+
 void LocaleLoader::removeTranslators()
 {
     LOG(LS_INFO) << "Cleanup translators";
@@ -43,9 +43,15 @@ public:
     void installTranslators(const QString& locale);
 
 private:
+    QStringList fileList(const QString& locale) const;
+    void loadLocaleList() const;
     void removeTranslators();
 
-    QHash<QString, QStringList> locale_list_;
+    // Only one locale is needed at startup. The full list of the translation files is built when
+    // the list of the locales is requested (in the settings dialogs).
+    mutable QHash<QString, QStringList> locale_list_;
+    mutable bool locale_list_loaded_ = false;
+
     QVector<QTranslator*> translator_list_;
 
     DISALLOW_COPY_AND_ASSIGN(LocaleLoader);
@@ -0,0 +1,211 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "relay/bandwidth_shaper.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+
+#include <algorithm>
+
+namespace relay {
+
+namespace {
+
+// How often the waiting flows are checked.
+const std::chrono::milliseconds kResumeInterval { 5 };
+
+// A bucket holds the data of a quarter of a second, but not less than a few reads.
+int64_t burstSize(int64_t rate)
+{
+    return std::max(rate / 4, static_cast<int64_t>(BandwidthShaper::kMaxReadSize * 2));
+}
+
+} // namespace
+
+// static
+const size_t BandwidthShaper::kMaxReadSize = 64 * 1024;
+
+BandwidthShaper::Tenants::Tenants(int64_t rate)
+    : rate_(rate)
+{
+    // Nothing
+}
+
+BandwidthShaper::Tenants::~Tenants() = default;
+
+BandwidthShaper::Tenants::Bucket::Bucket(int64_t rate)
+    : bucket(rate, burstSize(rate))
+{
+    // Nothing
+}
+
+std::shared_ptr<BandwidthShaper::Tenants::Bucket> BandwidthShaper::Tenants::bucket(
+    const std::string& tenant)
+{
+    if (rate_ <= 0)
+        return nullptr;
+
+    std::scoped_lock lock(lock_);
+
+    std::weak_ptr<Bucket>& entry = buckets_[tenant];
+    std::shared_ptr<Bucket> result = entry.lock();
+    if (result)
+        return result;
+
+    result = std::make_shared<Bucket>(rate_);
+    entry = result;
+
+    // The buckets of the tenants without sessions are removed when the table has doubled.
+    if (buckets_.size() > prune_size_ * 2)
+    {
+        for (auto it = buckets_.begin(); it != buckets_.end();)
+        {
+            if (it->second.expired())
+                it = buckets_.erase(it);
+            else
+                ++it;
+        }
+
+        prune_size_ = buckets_.size();
+    }
+
+    return result;
+}
+
+BandwidthShaper::Flow::Flow(BandwidthShaper* shaper, std::shared_ptr<Tenants::Bucket> tenant)
+    : shaper_(shaper),
+      tenant_bucket_(std::move(tenant))
+{
+    const int64_t rate = shaper_->limits_.session_rate;
+    if (rate > 0)
+        session_bucket_ = std::make_unique<TokenBucket>(rate, burstSize(rate));
+}
+
+BandwidthShaper::Flow::~Flow()
+{
+    if (!read_)
+        return;
+
+    std::deque<Flow*>& queue = shaper_->queue_;
+    queue.erase(std::remove(queue.begin(), queue.end(), this), queue.end());
+}
+
+bool BandwidthShaper::Flow::acquire(std::function<void()> read)
+{
+    DCHECK(!read_);
+
+    if (!isBlocked(TokenBucket::Clock::now()))
+        return true;
+
+    read_ = std::move(read);
+    shaper_->queue_.emplace_back(this);
+    shaper_->schedule();
+    return false;
+}
+
+void BandwidthShaper::Flow::consume(size_t bytes)
+{
+    const TokenBucket::TimePoint now = TokenBucket::Clock::now();
+
+    if (session_bucket_)
+        session_bucket_->consume(static_cast<int64_t>(bytes), now);
+
+    if (tenant_bucket_)
+    {
+        std::scoped_lock lock(tenant_bucket_->lock);
+        tenant_bucket_->bucket.consume(static_cast<int64_t>(bytes), now);
+    }
+}
+
+bool BandwidthShaper::Flow::isBlocked(const TokenBucket::TimePoint& now)
+{
+    if (session_bucket_ && session_bucket_->waitTime(now) > TokenBucket::Clock::duration::zero())
+        return true;
+
+    if (tenant_bucket_)
+    {
+        std::scoped_lock lock(tenant_bucket_->lock);
+        if (tenant_bucket_->bucket.waitTime(now) > TokenBucket::Clock::duration::zero())
+            return true;
+    }
+
+    return false;
+}
+
+BandwidthShaper::BandwidthShaper(const Limits& limits, std::shared_ptr<Tenants> tenants)
+    : limits_(limits),
+      tenants_(std::move(tenants)),
+      timer_(base::MessageLoop::current()->pumpAsio()->ioContext())
+{
+    DCHECK(tenants_);
+}
+
+BandwidthShaper::~BandwidthShaper()
+{
+    DCHECK(queue_.empty());
+    timer_.cancel();
+}
+
+std::unique_ptr<BandwidthShaper::Flow> BandwidthShaper::createFlow(const std::string& address)
+{
+    return std::unique_ptr<Flow>(new Flow(this, tenants_->bucket(address)));
+}
+
+void BandwidthShaper::schedule()
+{
+    if (timer_active_ || queue_.empty())
+        return;
+
+    timer_active_ = true;
+    timer_.expires_after(kResumeInterval);
+    timer_.async_wait(std::bind(&BandwidthShaper::doResume, this, std::placeholders::_1));
+}
+
+// static
+void BandwidthShaper::doResume(BandwidthShaper* self, const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    self->timer_active_ = false;
+
+    const TokenBucket::TimePoint now = TokenBucket::Clock::now();
+
+    // The flows are resumed in the order in which they started waiting. A resumed flow that goes
+    // into debt again waits behind the others.
+    std::deque<Flow*> queue;
+    queue.swap(self->queue_);
+
+    for (Flow* flow : queue)
+    {
+        if (flow->isBlocked(now))
+        {
+            self->queue_.emplace_back(flow);
+            continue;
+        }
+
+        std::function<void()> read;
+        read.swap(flow->read_);
+        read();
+    }
+
+    self->schedule();
+}
+
+} // namespace relay
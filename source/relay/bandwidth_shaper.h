@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef RELAY__BANDWIDTH_SHAPER_H
+#define RELAY__BANDWIDTH_SHAPER_H
+
+#include "relay/token_bucket.h"
+
+#include <asio/high_resolution_timer.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace relay {
+
+// Limits the rate at which the sessions of a worker read the data of their peers. Each direction
+// of a session has its own bucket, and all directions that are sent from the same address (the
+// tenant) share a bucket on all workers. A direction in debt waits in the queue of the shaper; the
+// queue is served in turn, so the sessions of a tenant share its rate fairly. A direction that is
+// not in debt is read without waiting, so the interactive sessions keep low latency while the bulk
+// transfers are throttled.
+class BandwidthShaper
+{
+public:
+    struct Limits
+    {
+        // In bytes per second. 0 means no limit.
+        int64_t session_rate = 0;
+        int64_t tenant_rate = 0;
+
+        bool isEnabled() const { return session_rate > 0 || tenant_rate > 0; }
+    };
+
+    // The buckets of the tenants. Shared by the shapers of all workers.
+    class Tenants
+    {
+    public:
+        explicit Tenants(int64_t rate);
+        ~Tenants();
+
+        struct Bucket
+        {
+            explicit Bucket(int64_t rate);
+
+            std::mutex lock;
+            TokenBucket bucket;
+        };
+
+        // Returns the bucket of |tenant| or nullptr if the rate of tenants is not limited.
+        std::shared_ptr<Bucket> bucket(const std::string& tenant);
+
+    private:
+        const int64_t rate_;
+
+        std::mutex lock_;
+        std::unordered_map<std::string, std::weak_ptr<Bucket>> buckets_;
+        size_t prune_size_ = 0;
+
+        DISALLOW_COPY_AND_ASSIGN(Tenants);
+    };
+
+    // One direction of a session.
+    class Flow
+    {
+    public:
+        ~Flow();
+
+        // Returns true if the peer can be read now. Otherwise |read| is called when the limits
+        // allow it.
+        bool acquire(std::function<void()> read);
+
+        // Counts the data read from the peer.
+        void consume(size_t bytes);
+
+        // Returns true if the flow waits for its buckets.
+        bool isWaiting() const { return static_cast<bool>(read_); }
+
+    private:
+        friend class BandwidthShaper;
+
+        Flow(BandwidthShaper* shaper, std::shared_ptr<Tenants::Bucket> tenant);
+        bool isBlocked(const TokenBucket::TimePoint& now);
+
+        BandwidthShaper* shaper_;
+        std::unique_ptr<TokenBucket> session_bucket_;
+        std::shared_ptr<Tenants::Bucket> tenant_bucket_;
+
+        std::function<void()> read_;
+
+        DISALLOW_COPY_AND_ASSIGN(Flow);
+    };
+
+    // A shaped read is limited, so one read does not take the rate of a tenant for long.
+    static const size_t kMaxReadSize;
+
+    // Must be created on the thread of the worker.
+    BandwidthShaper(const Limits& limits, std::shared_ptr<Tenants> tenants);
+    ~BandwidthShaper();
+
+    // Creates a flow for the data sent from |address|.
+    std::unique_ptr<Flow> createFlow(const std::string& address);
+
+private:
+    void schedule();
+    static void doResume(BandwidthShaper* self, const std::error_code& error_code);
+
+    const Limits limits_;
+    std::shared_ptr<Tenants> tenants_;
+
+    // The flows waiting for their buckets in the order of arrival.
+    std::deque<Flow*> queue_;
+
+    asio::high_resolution_timer timer_;
+    bool timer_active_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(BandwidthShaper);
+};
+
+} // namespace relay
+
+#endif // RELAY__BANDWIDTH_SHAPER_H
@@ -19,16 +19,40 @@
 #include "relay/controller.h"
 
 #include "base/logging.h"
+#include "base/metrics_writer.h"
+#include "base/task_lag_probe.h"
 #include "base/task_runner.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/net/metrics_server.h"
 #include "base/peer/client_authenticator.h"
 #include "proto/router_common.pb.h"
 #include "relay/settings.h"
 
+#if defined(OS_LINUX)
+#include "relay/kernel_forwarder.h"
+
+#include <unistd.h>
+#endif // defined(OS_LINUX)
+
 namespace relay {
 
 namespace {
 
 const std::chrono::seconds kReconnectTimeout{ 15 };
+const uint32_t kMaxPeerWorkerCount = 256;
+
+const std::chrono::milliseconds kKeyBatchDelay { 500 };
+const uint32_t kMaxKeyBatchSize = 32;
+
+const std::chrono::seconds kStatInterval { 10 };
+
+// How often the lag of the task queues is measured for the metrics.
+const std::chrono::seconds kLagProbeInterval { 5 };
+
+// The keys of the previous process may have been given to the peers already. They are kept as
+// long as the keys given by the router.
+const std::chrono::seconds kHandoffKeyTimeout { 30 };
 
 #if defined(OS_WIN)
 const wchar_t kFirewallRuleName[] = L"Aspia Relay Service";
@@ -64,7 +88,11 @@ private:
 Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(task_runner),
       reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
-      shared_pool_(std::make_unique<SharedPool>(this))
+      shared_pool_(std::make_unique<SharedPool>(this)),
+      key_batch_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      statistics_(std::make_shared<SessionStatistics>()),
+      stat_timer_(base::WaitableTimer::Type::REPEATED, task_runner),
+      lag_probe_timer_(base::WaitableTimer::Type::REPEATED, task_runner)
 {
     Settings settings;
 
@@ -82,11 +110,25 @@ Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     peer_port_ = settings.peerPort();
     peer_idle_timeout_ = settings.peerIdleTimeout();
     max_peer_count_ = settings.maxPeerCount();
+    peer_worker_count_ = settings.peerWorkerCount();
+    kernel_forwarding_ = settings.isKernelForwardingEnabled();
+    bandwidth_limits_.session_rate = static_cast<int64_t>(settings.sessionBandwidth()) * 1024;
+    bandwidth_limits_.tenant_rate = static_cast<int64_t>(settings.tenantBandwidth()) * 1024;
+    handoff_path_ = settings.handoffPath();
+
+    // Metrics settings.
+    metrics_address_ = settings.metricsAddress();
+    metrics_port_ = settings.metricsPort();
 
     LOG(LS_INFO) << "Peer address: " << peer_address_;
     LOG(LS_INFO) << "Peer port: " << peer_port_;
     LOG(LS_INFO) << "Peer idle timeout: " << peer_idle_timeout_.count();
     LOG(LS_INFO) << "Max peer count: " << max_peer_count_;
+    LOG(LS_INFO) << "Peer worker count: " << peer_worker_count_;
+    LOG(LS_INFO) << "Kernel forwarding: " << kernel_forwarding_;
+    LOG(LS_INFO) << "Session bandwidth: " << bandwidth_limits_.session_rate << " B/s";
+    LOG(LS_INFO) << "Tenant bandwidth: " << bandwidth_limits_.tenant_rate << " B/s";
+    LOG(LS_INFO) << "Handoff path: " << handoff_path_;
 }
 
 Controller::~Controller() = default;
@@ -94,6 +136,7 @@ Controller::~Controller() = default;
 bool Controller::start()
 {
     LOG(LS_INFO) << "Starting controller";
+    LOG(LS_INFO) << "I/O backend: " << base::MessagePumpForAsio::ioBackendName();
 
     if (router_address_.empty())
     {
@@ -131,10 +174,51 @@ bool Controller::start()
         return false;
     }
 
+    if (peer_worker_count_ > kMaxPeerWorkerCount)
+    {
+        LOG(LS_WARNING) << "Invalid peer worker count";
+        return false;
+    }
+
+    // All keys are sent to the router after connecting to it. Half of them is kept ready for the
+    // reconnection and for the keys released by the peers.
+    key_generator_ = std::make_unique<KeyGenerator>(max_peer_count_ / 2, max_peer_count_);
+    key_generator_->start();
+
+#if defined(OS_LINUX)
+    if (kernel_forwarding_ && !KernelForwarder::initialize(max_peer_count_))
+        LOG(LS_WARNING) << "Kernel forwarding is unavailable, splice is used";
+
+    // The running relay gives its peers to this process and exits.
+    std::optional<Handoff::State> handoff_state;
+    if (!handoff_path_.empty())
+        handoff_state = Handoff::receive(handoff_path_);
+#endif // defined(OS_LINUX)
+
     sessions_worker_ = std::make_unique<SessionsWorker>(
-        peer_port_, peer_idle_timeout_, shared_pool_->share());
+        peer_port_, peer_idle_timeout_, peer_worker_count_, bandwidth_limits_,
+        shared_pool_->share(), statistics_);
+
+#if defined(OS_LINUX)
+    if (handoff_state.has_value())
+        adoptHandoff(std::move(*handoff_state));
+#endif // defined(OS_LINUX)
+
     sessions_worker_->start(task_runner_, this);
 
+#if defined(OS_LINUX)
+    if (!handoff_path_.empty())
+    {
+        handoff_listener_ = std::make_unique<HandoffListener>(
+            base::MessageLoop::current()->pumpAsio()->ioContext(), this);
+        if (!handoff_listener_->start(handoff_path_))
+            handoff_listener_.reset();
+    }
+#endif // defined(OS_LINUX)
+
+    if (!startMetrics())
+        return false;
+
     connectToRouter();
     return true;
 }
@@ -168,6 +252,9 @@ void Controller::onConnected()
             channel_->resume();
 
             sendKeyPool(max_peer_count_);
+
+            sendStat();
+            stat_timer_.start(kStatInterval, std::bind(&Controller::sendStat, this));
         }
         else
         {
@@ -186,8 +273,11 @@ void Controller::onDisconnected(base::NetworkChannel::ErrorCode error_code)
     LOG(LS_INFO) << "The connection to the router has been lost: "
                  << base::NetworkChannel::errorToString(error_code);
 
-    // Clearing the key pool.
+    // Clearing the key pool. All keys will be sent again after connecting.
     shared_pool_->clear();
+    key_batch_timer_.stop();
+    pending_key_count_ = 0;
+    stat_timer_.stop();
 
     // Retrying a connection at a time interval.
     delayedConnectToRouter();
@@ -227,15 +317,35 @@ void Controller::onSessionFinished()
 {
     // After disconnecting the peer, one key is released.
     // Add a new key to the pool and send it to the router.
-    sendKeyPool(1);
+    sendKeyPoolSoon(1);
 }
 
 void Controller::onPoolKeyExpired(uint32_t /* key_id */)
 {
     // The key has expired and has been removed from the pool.
     // Add a new key to the pool and send it to the router.
-    sendKeyPool(1);
+    sendKeyPoolSoon(1);
+}
+
+#if defined(OS_LINUX)
+void Controller::onHandoffRequested(int socket)
+{
+    if (handoff_started_)
+    {
+        LOG(LS_WARNING) << "Handoff is already in progress";
+        close(socket);
+        return;
+    }
+
+    LOG(LS_INFO) << "Handoff requested";
+    handoff_started_ = true;
+
+    // The router may give the keys to the peers until this process exits. The keys are passed to
+    // the new process after the sessions are drained.
+    sessions_worker_->handoff(std::bind(&Controller::onHandoffReady, this, socket,
+                                        std::placeholders::_1, std::placeholders::_2));
 }
+#endif // defined(OS_LINUX)
 
 void Controller::connectToRouter()
 {
@@ -266,7 +376,7 @@ void Controller::sendKeyPool(uint32_t key_count)
     // Add the requested number of keys to the pool.
     for (uint32_t i = 0; i < key_count; ++i)
     {
-        SessionKey session_key = SessionKey::create();
+        SessionKey session_key = key_generator_->takeKey();
         if (!session_key.isValid())
             return;
 
@@ -286,4 +396,165 @@ void Controller::sendKeyPool(uint32_t key_count)
     channel_->send(base::serialize(*message));
 }
 
+void Controller::sendKeyPoolSoon(uint32_t key_count)
+{
+    pending_key_count_ += key_count;
+
+    // A large batch is sent at once, otherwise wait for other released keys.
+    if (pending_key_count_ >= kMaxKeyBatchSize)
+    {
+        key_batch_timer_.stop();
+        sendPendingKeys();
+        return;
+    }
+
+    key_batch_timer_.start(kKeyBatchDelay, std::bind(&Controller::sendPendingKeys, this));
+}
+
+void Controller::sendPendingKeys()
+{
+    uint32_t key_count = pending_key_count_;
+    pending_key_count_ = 0;
+
+    if (key_count)
+        sendKeyPool(key_count);
+}
+
+void Controller::sendStat()
+{
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    const int64_t bytes_transferred = statistics_->bytesTransferred();
+
+    uint64_t bytes_per_second = 0;
+
+    if (last_stat_time_ != std::chrono::steady_clock::time_point())
+    {
+        const int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            current_time - last_stat_time_).count();
+
+        if (elapsed_ms > 0 && bytes_transferred >= last_bytes_transferred_)
+        {
+            bytes_per_second = static_cast<uint64_t>(
+                (bytes_transferred - last_bytes_transferred_) * 1000 / elapsed_ms);
+        }
+    }
+
+    last_stat_time_ = current_time;
+    last_bytes_transferred_ = bytes_transferred;
+
+    std::unique_ptr<proto::RelayToRouter> message = std::make_unique<proto::RelayToRouter>();
+    proto::RelayStat* stat = message->mutable_stat();
+
+    stat->set_active_sessions(statistics_->activeSessions());
+    stat->set_bytes_per_second(bytes_per_second);
+    stat->set_cpu_load(processor_load_.update());
+
+    channel_->send(base::serialize(*message));
+}
+
+bool Controller::startMetrics()
+{
+    if (!metrics_port_)
+        return true;
+
+    metrics_server_ =
+        std::make_unique<base::MetricsServer>(std::bind(&Controller::metrics, this));
+    if (!metrics_server_->start(metrics_address_, metrics_port_))
+        return false;
+
+    controller_lag_probe_ = std::make_unique<base::TaskLagProbe>(task_runner_);
+    worker_lag_probe_ = std::make_unique<base::TaskLagProbe>(sessions_worker_->taskRunner());
+
+    lag_probe_timer_.start(kLagProbeInterval, [this]()
+    {
+        controller_lag_probe_->probe();
+        worker_lag_probe_->probe();
+    });
+
+    return true;
+}
+
+std::string Controller::metrics() const
+{
+    base::MetricsWriter writer;
+
+    writer.addMetric("aspia_relay_sessions", base::MetricsWriter::Type::GAUGE,
+                     "The number of active peer sessions.");
+    writer.addSample("aspia_relay_sessions", static_cast<int64_t>(statistics_->activeSessions()));
+
+    // The rate of the traffic is calculated by Prometheus from the counter.
+    writer.addMetric("aspia_relay_forwarded_bytes_total", base::MetricsWriter::Type::COUNTER,
+                     "The number of bytes forwarded between the peers.");
+    writer.addSample("aspia_relay_forwarded_bytes_total", statistics_->bytesTransferred());
+
+    writer.addMetric("aspia_relay_pool_keys", base::MetricsWriter::Type::GAUGE,
+                     "The number of keys in the pool.");
+    writer.addSample("aspia_relay_pool_keys", static_cast<int64_t>(shared_pool_->count()));
+
+    writer.addMetric("aspia_relay_task_lag_seconds", base::MetricsWriter::Type::GAUGE,
+                     "The time the last probe task waited in the queue of the thread.");
+    writer.addSample("aspia_relay_task_lag_seconds",
+                     std::chrono::duration<double>(controller_lag_probe_->lag()).count(),
+                     "thread=\"controller\"");
+    writer.addSample("aspia_relay_task_lag_seconds",
+                     std::chrono::duration<double>(worker_lag_probe_->lag()).count(),
+                     "thread=\"sessions\"");
+
+    return writer.text();
+}
+
+#if defined(OS_LINUX)
+void Controller::adoptHandoff(Handoff::State&& state)
+{
+    std::shared_ptr<SharedPool> pool = shared_pool_->share();
+
+    for (const auto& key : state.keys)
+    {
+        if (!shared_pool_->importKey(key))
+            continue;
+
+        // The router of the new process does not know these keys, they are not replaced.
+        task_runner_->postDelayedTask(
+            std::bind(&SharedPool::removeKey, pool, key.key_id), kHandoffKeyTimeout);
+    }
+
+    sessions_worker_->adopt(state.listener, std::move(state.sessions));
+}
+
+void Controller::onHandoffReady(int socket,
+                                SessionManager::NativeHandle listener,
+                                std::vector<Session::NativeHandles> sessions)
+{
+    if (listener == -1)
+    {
+        LOG(LS_ERROR) << "Handoff aborted";
+
+        // The sessions are left running.
+        close(socket);
+        handoff_started_ = false;
+        return;
+    }
+
+    Handoff::State state;
+    state.listener = listener;
+    state.sessions = std::move(sessions);
+    state.keys = shared_pool_->exportKeys();
+
+    if (!Handoff::send(socket, state))
+        LOG(LS_ERROR) << "Unable to send handoff. The peers are disconnected";
+
+    close(socket);
+    close(state.listener);
+
+    for (const auto& session : state.sessions)
+    {
+        close(session.first);
+        close(session.second);
+    }
+
+    handoff_listener_.reset();
+    task_runner_->postQuit();
+}
+#endif // defined(OS_LINUX)
+
 } // namespace relay
@@ -23,11 +23,19 @@
 #include "base/net/network_channel.h"
 #include "build/build_config.h"
 #include "proto/router_relay.pb.h"
+#include "relay/key_generator.h"
+#include "relay/processor_load.h"
 #include "relay/sessions_worker.h"
 #include "relay/shared_pool.h"
 
+#if defined(OS_LINUX)
+#include "relay/handoff.h"
+#endif // defined(OS_LINUX)
+
 namespace base {
 class ClientAuthenticator;
+class MetricsServer;
+class TaskLagProbe;
 } // namespace base
 
 namespace relay {
@@ -35,6 +43,9 @@ namespace relay {
 class Controller
     : public base::NetworkChannel::Listener,
       public SessionManager::Delegate,
+#if defined(OS_LINUX)
+      public HandoffListener::Delegate,
+#endif // defined(OS_LINUX)
       public SharedPool::Delegate
 {
 public:
@@ -56,10 +67,29 @@ protected:
     // SharedPool::Delegate implementation.
     void onPoolKeyExpired(uint32_t key_id) override;
 
+#if defined(OS_LINUX)
+    // HandoffListener::Delegate implementation.
+    void onHandoffRequested(int socket) override;
+#endif // defined(OS_LINUX)
+
 private:
     void connectToRouter();
     void delayedConnectToRouter();
     void sendKeyPool(uint32_t key_count);
+    void sendKeyPoolSoon(uint32_t key_count);
+    void sendPendingKeys();
+    void sendStat();
+    bool startMetrics();
+
+#if defined(OS_LINUX)
+    void adoptHandoff(Handoff::State&& state);
+    void onHandoffReady(int socket,
+                        SessionManager::NativeHandle listener,
+                        std::vector<Session::NativeHandles> sessions);
+#endif // defined(OS_LINUX)
+
+    // Returns the metrics in the text format of Prometheus.
+    std::string metrics() const;
 
     // Router settings.
     std::u16string router_address_;
@@ -71,14 +101,48 @@ private:
     uint16_t peer_port_ = 0;
     std::chrono::minutes peer_idle_timeout_;
     uint32_t max_peer_count_ = 0;
+    uint32_t peer_worker_count_ = 0;
+    bool kernel_forwarding_ = false;
+    BandwidthShaper::Limits bandwidth_limits_;
+    std::string handoff_path_;
+
+    // Metrics settings.
+    std::u16string metrics_address_;
+    uint16_t metrics_port_ = 0;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     base::WaitableTimer reconnect_timer_;
     std::unique_ptr<base::NetworkChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<SharedPool> shared_pool_;
+    std::unique_ptr<KeyGenerator> key_generator_;
+
+    // The released keys are replaced in batches.
+    base::WaitableTimer key_batch_timer_;
+    uint32_t pending_key_count_ = 0;
+
+    // The load of the relay is reported to the router periodically.
+    std::shared_ptr<SessionStatistics> statistics_;
+    base::WaitableTimer stat_timer_;
+    ProcessorLoad processor_load_;
+    int64_t last_bytes_transferred_ = 0;
+    std::chrono::steady_clock::time_point last_stat_time_;
+
     std::unique_ptr<SessionsWorker> sessions_worker_;
 
+#if defined(OS_LINUX)
+    // Waits for the process that replaces this one. Used only if the handoff path is set.
+    std::unique_ptr<HandoffListener> handoff_listener_;
+    bool handoff_started_ = false;
+#endif // defined(OS_LINUX)
+
+    // Used only if the metrics are enabled. The probes measure the lag of the thread of the
+    // controller and of the thread of the sessions worker.
+    std::unique_ptr<base::MetricsServer> metrics_server_;
+    std::unique_ptr<base::TaskLagProbe> controller_lag_probe_;
+    std::unique_ptr<base::TaskLagProbe> worker_lag_probe_;
+    base::WaitableTimer lag_probe_timer_;
+
     DISALLOW_COPY_AND_ASSIGN(Controller);
 };
 
@@ -0,0 +1,410 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "relay/handoff.h"
+
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+#include "proto/relay_handoff.pb.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace relay {
+
+namespace {
+
+// The draining of the sessions in the running relay is bounded by its own timeout.
+const int kReceiveTimeoutSeconds = 60;
+
+// SCM_RIGHTS can pass at most 253 descriptors in one message.
+const size_t kMaxDescriptorsPerMessage = 250;
+
+const uint32_t kMaxMessageSize = 64 * 1024 * 1024;
+
+bool makeAddress(const std::string& path, sockaddr_un* address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+
+    if (path.empty() || path.size() >= sizeof(address->sun_path))
+    {
+        LOG(LS_WARNING) << "Invalid handoff path: " << path;
+        return false;
+    }
+
+    memcpy(address->sun_path, path.data(), path.size());
+    return true;
+}
+
+bool writeAll(int socket, const void* data, size_t size)
+{
+    const uint8_t* current = static_cast<const uint8_t*>(data);
+
+    while (size)
+    {
+        ssize_t written = ::send(socket, current, size, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "send failed";
+            return false;
+        }
+
+        current += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+bool readAll(int socket, void* data, size_t size)
+{
+    uint8_t* current = static_cast<uint8_t*>(data);
+
+    while (size)
+    {
+        ssize_t read = recv(socket, current, size, 0);
+        if (read <= 0)
+        {
+            if (read < 0 && errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "recv failed";
+            return false;
+        }
+
+        current += read;
+        size -= static_cast<size_t>(read);
+    }
+
+    return true;
+}
+
+// Each batch of descriptors is sent with its count. The kernel does not merge the data of the
+// messages that carry descriptors, so a batch is received by one call.
+bool sendDescriptors(int socket, const int* fds, size_t count)
+{
+    const uint32_t header = static_cast<uint32_t>(count);
+
+    iovec iov;
+    iov.iov_base = const_cast<uint32_t*>(&header);
+    iov.iov_len = sizeof(header);
+
+    std::vector<uint8_t> control(CMSG_SPACE(sizeof(int) * count));
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+
+    while (sendmsg(socket, &message, MSG_NOSIGNAL) < 0)
+    {
+        if (errno != EINTR)
+        {
+            PLOG(LS_WARNING) << "sendmsg failed";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool receiveDescriptors(int socket, std::vector<int>* fds)
+{
+    uint32_t header = 0;
+
+    iovec iov;
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+
+    std::vector<uint8_t> control(CMSG_SPACE(sizeof(int) * kMaxDescriptorsPerMessage));
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    ssize_t size;
+    do
+    {
+        size = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    }
+    while (size < 0 && errno == EINTR);
+
+    if (size != sizeof(header))
+    {
+        PLOG(LS_WARNING) << "recvmsg failed";
+        return false;
+    }
+
+    size_t received = 0;
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+
+        fds->insert(fds->end(), data, data + count);
+        received += count;
+    }
+
+    if (received != header || (message.msg_flags & MSG_CTRUNC))
+    {
+        LOG(LS_WARNING) << "Unexpected number of descriptors: " << received << " (expected: "
+                        << header << ")";
+        return false;
+    }
+
+    return true;
+}
+
+void closeDescriptors(const std::vector<int>& fds)
+{
+    for (int fd : fds)
+        close(fd);
+}
+
+} // namespace
+
+// static
+std::optional<Handoff::State> Handoff::receive(const std::string& path)
+{
+    sockaddr_un address;
+    if (!makeAddress(path, &address))
+        return std::nullopt;
+
+    int socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket == -1)
+    {
+        PLOG(LS_WARNING) << "socket failed";
+        return std::nullopt;
+    }
+
+    if (connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        // There is no relay to replace.
+        close(socket);
+        return std::nullopt;
+    }
+
+    LOG(LS_INFO) << "Taking over the running relay";
+
+    timeval timeout = { kReceiveTimeoutSeconds, 0 };
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    proto::RelayHandoff message;
+    std::vector<int> fds;
+
+    uint32_t size = 0;
+    bool succeeded = readAll(socket, &size, sizeof(size)) && size <= kMaxMessageSize;
+
+    if (succeeded)
+    {
+        std::string buffer;
+        buffer.resize(size);
+
+        succeeded = readAll(socket, buffer.data(), buffer.size()) &&
+                    message.ParseFromString(buffer);
+    }
+
+    const size_t expected = 1 + static_cast<size_t>(message.session_count()) * 2;
+
+    while (succeeded && fds.size() < expected)
+        succeeded = receiveDescriptors(socket, &fds);
+
+    close(socket);
+
+    if (!succeeded || fds.size() != expected)
+    {
+        LOG(LS_WARNING) << "Handoff failed";
+        closeDescriptors(fds);
+        return std::nullopt;
+    }
+
+    State state;
+    state.listener = fds[0];
+
+    for (size_t i = 1; i < fds.size(); i += 2)
+        state.sessions.emplace_back(fds[i], fds[i + 1]);
+
+    for (const auto& key : message.key())
+    {
+        state.keys.push_back({ key.key_id(),
+                               base::fromStdString(key.private_key()),
+                               base::fromStdString(key.iv()) });
+    }
+
+    LOG(LS_INFO) << "Handoff received (sessions: " << state.sessions.size()
+                 << ", keys: " << state.keys.size() << ")";
+    return state;
+}
+
+// static
+bool Handoff::send(int socket, const State& state)
+{
+    proto::RelayHandoff message;
+    message.set_session_count(static_cast<uint32_t>(state.sessions.size()));
+
+    for (const auto& key : state.keys)
+    {
+        proto::RelayHandoffKey* item = message.add_key();
+        item->set_key_id(key.key_id);
+        item->set_private_key(base::toStdString(key.private_key));
+        item->set_iv(base::toStdString(key.iv));
+    }
+
+    const std::string buffer = message.SerializeAsString();
+    const uint32_t size = static_cast<uint32_t>(buffer.size());
+
+    if (!writeAll(socket, &size, sizeof(size)) || !writeAll(socket, buffer.data(), buffer.size()))
+        return false;
+
+    std::vector<int> fds;
+    fds.reserve(1 + state.sessions.size() * 2);
+    fds.emplace_back(state.listener);
+
+    for (const auto& session : state.sessions)
+    {
+        fds.emplace_back(session.first);
+        fds.emplace_back(session.second);
+    }
+
+    for (size_t offset = 0; offset < fds.size(); offset += kMaxDescriptorsPerMessage)
+    {
+        const size_t count = std::min(kMaxDescriptorsPerMessage, fds.size() - offset);
+        if (!sendDescriptors(socket, fds.data() + offset, count))
+            return false;
+    }
+
+    LOG(LS_INFO) << "Handoff sent (sessions: " << state.sessions.size()
+                 << ", keys: " << state.keys.size() << ")";
+    return true;
+}
+
+HandoffListener::HandoffListener(asio::io_context& io_context, Delegate* delegate)
+    : delegate_(delegate),
+      descriptor_(io_context)
+{
+    DCHECK(delegate_);
+}
+
+HandoffListener::~HandoffListener()
+{
+    std::error_code ignored_code;
+    descriptor_.close(ignored_code);
+}
+
+bool HandoffListener::start(const std::string& path)
+{
+    sockaddr_un address;
+    if (!makeAddress(path, &address))
+        return false;
+
+    int socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (socket == -1)
+    {
+        PLOG(LS_WARNING) << "socket failed";
+        return false;
+    }
+
+    // The file is left by the previous relay. It has already handed off or is not running.
+    unlink(path.c_str());
+
+    // The state of the relay includes the private keys, so the socket is available only to the
+    // owner of the process.
+    const mode_t mask = umask(S_IRWXG | S_IRWXO);
+    const bool bound =
+        bind(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    umask(mask);
+
+    if (!bound || listen(socket, 1) != 0)
+    {
+        PLOG(LS_WARNING) << "Unable to listen on " << path;
+        close(socket);
+        return false;
+    }
+
+    std::error_code error_code;
+    descriptor_.assign(socket, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to assign descriptor: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+        close(socket);
+        return false;
+    }
+
+    LOG(LS_INFO) << "Waiting for handoff on " << path;
+    doAccept(this);
+    return true;
+}
+
+// static
+void HandoffListener::doAccept(HandoffListener* self)
+{
+    self->descriptor_.async_wait(asio::posix::stream_descriptor::wait_read,
+                                 [self](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+            {
+                LOG(LS_WARNING) << "Error while waiting for handoff: "
+                                << base::utf16FromLocal8Bit(error_code.message());
+            }
+            return;
+        }
+
+        int socket = accept4(self->descriptor_.native_handle(), nullptr, nullptr, SOCK_CLOEXEC);
+        if (socket == -1)
+        {
+            PLOG(LS_WARNING) << "accept4 failed";
+            doAccept(self);
+            return;
+        }
+
+        // The state is handed off only once. The relay stops after it.
+        std::error_code ignored_code;
+        self->descriptor_.close(ignored_code);
+
+        self->delegate_->onHandoffRequested(socket);
+    });
+}
+
+} // namespace relay
@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef RELAY__HANDOFF_H
+#define RELAY__HANDOFF_H
+
+#include "relay/shared_pool.h"
+
+#include <asio/posix/stream_descriptor.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace relay {
+
+// Passes the state of a running relay to the relay that replaces it (Linux only). The new process
+// connects to the Unix socket of the running one and gets the listening socket, the sockets of
+// the established sessions and the key pool. The descriptors are passed with SCM_RIGHTS, so the
+// connections of the peers are not interrupted.
+class Handoff
+{
+public:
+    struct State
+    {
+        int listener = -1;
+        std::vector<std::pair<int, int>> sessions;
+        std::vector<SharedPool::ExportedKey> keys;
+    };
+
+    // Takes the state of the relay running at |path|. Returns std::nullopt if no relay is running
+    // there or the handoff failed.
+    static std::optional<State> receive(const std::string& path);
+
+    // Sends |state| to the relay connected to |socket|. The descriptors of |state| are not closed.
+    static bool send(int socket, const State& state);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Handoff);
+};
+
+// Waits for the relay that replaces this one.
+class HandoffListener
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Called when a new relay has connected. The delegate takes the ownership of |socket|.
+        virtual void onHandoffRequested(int socket) = 0;
+    };
+
+    HandoffListener(asio::io_context& io_context, Delegate* delegate);
+    ~HandoffListener();
+
+    // Replaces the socket file at |path|. Only the processes of the same user can connect.
+    bool start(const std::string& path);
+
+private:
+    static void doAccept(HandoffListener* self);
+
+    Delegate* delegate_;
+    asio::posix::stream_descriptor descriptor_;
+
+    DISALLOW_COPY_AND_ASSIGN(HandoffListener);
+};
+
+} // namespace relay
+
+#endif // RELAY__HANDOFF_H
@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/idle_wheel.h"
+
+#include "base/logging.h"
+
+namespace relay {
+
+// static
+const std::chrono::minutes IdleWheel::kTickInterval { 1 };
+
+IdleWheel::IdleWheel(const std::chrono::minutes& idle_timeout)
+    : idle_timeout_(idle_timeout),
+      start_time_(Session::Clock::now())
+{
+    // The deadline of a session is at most one idle timeout ahead of the current tick. Two more
+    // slots are needed for the rounding of the deadline and for the current tick.
+    slots_.resize(static_cast<size_t>(idle_timeout_ / kTickInterval) + 2);
+}
+
+IdleWheel::~IdleWheel() = default;
+
+void IdleWheel::add(Session* session)
+{
+    DCHECK(session);
+    DCHECK(positions_.find(session) == positions_.end());
+
+    insert(session, tickFor(session->lastActivityTime() + idle_timeout_));
+}
+
+void IdleWheel::remove(Session* session)
+{
+    auto it = positions_.find(session);
+    if (it == positions_.end())
+        return;
+
+    std::vector<Session*>& slot = slots_[it->second.slot];
+    const size_t index = it->second.index;
+
+    // The last session of the slot takes the place of the removed one.
+    if (index != slot.size() - 1)
+    {
+        slot[index] = slot.back();
+        positions_[slot[index]].index = index;
+    }
+
+    slot.pop_back();
+    positions_.erase(it);
+}
+
+std::vector<Session*> IdleWheel::advance(const Session::TimePoint& current_time)
+{
+    std::vector<Session*> expired;
+
+    const int64_t last_tick = (current_time - start_time_) / kTickInterval;
+    const int64_t slot_count = static_cast<int64_t>(slots_.size());
+
+    // If the timer was late by more than a full turn, each slot is checked once.
+    if (last_tick - current_tick_ > slot_count)
+        current_tick_ = last_tick - slot_count;
+
+    while (current_tick_ < last_tick)
+    {
+        ++current_tick_;
+
+        std::vector<Session*> sessions;
+        sessions.swap(slots_[static_cast<size_t>(current_tick_ % slot_count)]);
+
+        for (Session* session : sessions)
+        {
+            positions_.erase(session);
+            session->updateActivity();
+
+            const Session::TimePoint deadline = session->lastActivityTime() + idle_timeout_;
+            if (deadline <= current_time)
+                expired.emplace_back(session);
+            else
+                insert(session, tickFor(deadline));
+        }
+    }
+
+    return expired;
+}
+
+int64_t IdleWheel::tickFor(const Session::TimePoint& deadline) const
+{
+    // The deadline is rounded up to the next tick.
+    const Session::Clock::duration interval = kTickInterval;
+    return (deadline - start_time_ + interval - Session::Clock::duration(1)) / interval;
+}
+
+void IdleWheel::insert(Session* session, int64_t tick)
+{
+    const int64_t slot_count = static_cast<int64_t>(slots_.size());
+
+    // A session must not be placed into the slot that has just been checked or beyond the turn of
+    // the wheel.
+    if (tick <= current_tick_)
+        tick = current_tick_ + 1;
+    else if (tick >= current_tick_ + slot_count)
+        tick = current_tick_ + slot_count - 1;
+
+    const size_t slot = static_cast<size_t>(tick % slot_count);
+
+    positions_[session] = { slot, slots_[slot].size() };
+    slots_[slot].emplace_back(session);
+}
+
+} // namespace relay
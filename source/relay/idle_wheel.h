@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__IDLE_WHEEL_H
+#define RELAY__IDLE_WHEEL_H
+
+#include "relay/session.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace relay {
+
+// Timer wheel that finds the sessions without activity. A session is placed into the slot of the
+// tick at which its idle timeout would expire. The wheel checks only the sessions of the slots it
+// passes, so a tick costs time proportional to the number of expiring sessions and not to the
+// number of all sessions. A session with activity is moved to the slot of its new deadline.
+class IdleWheel
+{
+public:
+    explicit IdleWheel(const std::chrono::minutes& idle_timeout);
+    ~IdleWheel();
+
+    // The interval at which advance() is expected to be called.
+    static const std::chrono::minutes kTickInterval;
+
+    // Adds a started session to the wheel.
+    void add(Session* session);
+
+    // Removes a session from the wheel if it is there.
+    void remove(Session* session);
+
+    // Moves the wheel to |current_time|. Returns the sessions that had no activity during the idle
+    // timeout. The returned sessions are removed from the wheel.
+    std::vector<Session*> advance(const Session::TimePoint& current_time);
+
+private:
+    int64_t tickFor(const Session::TimePoint& deadline) const;
+    void insert(Session* session, int64_t tick);
+
+    const std::chrono::minutes idle_timeout_;
+    const Session::TimePoint start_time_;
+    int64_t current_tick_ = 0;
+
+    std::vector<std::vector<Session*>> slots_;
+
+    struct Position
+    {
+        size_t slot;
+        size_t index;
+    };
+
+    std::unordered_map<Session*, Position> positions_;
+
+    DISALLOW_COPY_AND_ASSIGN(IdleWheel);
+};
+
+} // namespace relay
+
+#endif // RELAY__IDLE_WHEEL_H
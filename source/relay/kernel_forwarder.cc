@@ -0,0 +1,444 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "relay/kernel_forwarder.h"
+
+#include "base/logging.h"
+
+#include <cstring>
+#include <memory>
+
+#include <linux/bpf.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace relay {
+
+namespace {
+
+// The value of the peer map. The key is the cookie of the socket that receives the data.
+struct PeerEntry
+{
+    // The index of the target socket in the sockmap.
+    uint32_t target_index;
+    uint32_t reserved;
+
+    // The number of bytes received from the socket. Updated by the verdict program.
+    uint64_t bytes;
+};
+
+// While the sockets are added, the received data must stay in the socket queues. With a large
+// low watermark the kernel does not notify the stream parser about the new data.
+const int kGateLowWatermark = 1024 * 1024 * 1024;
+
+KernelForwarder* g_forwarder = nullptr;
+
+int bpf(int command, bpf_attr* attr)
+{
+    return static_cast<int>(syscall(__NR_bpf, command, attr, sizeof(*attr)));
+}
+
+int createMap(bpf_map_type type, uint32_t key_size, uint32_t value_size, uint32_t max_entries)
+{
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.map_type = type;
+    attr.key_size = key_size;
+    attr.value_size = value_size;
+    attr.max_entries = max_entries;
+
+    return bpf(BPF_MAP_CREATE, &attr);
+}
+
+bool updateElement(int map, const void* key, const void* value)
+{
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.map_fd = static_cast<uint32_t>(map);
+    attr.key = reinterpret_cast<uint64_t>(key);
+    attr.value = reinterpret_cast<uint64_t>(value);
+    attr.flags = BPF_ANY;
+
+    return bpf(BPF_MAP_UPDATE_ELEM, &attr) == 0;
+}
+
+bool lookupElement(int map, const void* key, void* value)
+{
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.map_fd = static_cast<uint32_t>(map);
+    attr.key = reinterpret_cast<uint64_t>(key);
+    attr.value = reinterpret_cast<uint64_t>(value);
+
+    return bpf(BPF_MAP_LOOKUP_ELEM, &attr) == 0;
+}
+
+void deleteElement(int map, const void* key)
+{
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.map_fd = static_cast<uint32_t>(map);
+    attr.key = reinterpret_cast<uint64_t>(key);
+
+    bpf(BPF_MAP_DELETE_ELEM, &attr);
+}
+
+int loadProgram(const std::vector<bpf_insn>& instructions)
+{
+    static const char kLicense[] = "GPL";
+
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.prog_type = BPF_PROG_TYPE_SK_SKB;
+    attr.insn_cnt = static_cast<uint32_t>(instructions.size());
+    attr.insns = reinterpret_cast<uint64_t>(instructions.data());
+    attr.license = reinterpret_cast<uint64_t>(kLicense);
+
+    return bpf(BPF_PROG_LOAD, &attr);
+}
+
+bool attachProgram(int program, int map, bpf_attach_type type)
+{
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.target_fd = static_cast<uint32_t>(map);
+    attr.attach_bpf_fd = static_cast<uint32_t>(program);
+    attr.attach_type = type;
+
+    return bpf(BPF_PROG_ATTACH, &attr) == 0;
+}
+
+bpf_insn instruction(uint8_t code, uint8_t dst, uint8_t src, int16_t offset, int32_t imm)
+{
+    bpf_insn insn;
+    memset(&insn, 0, sizeof(insn));
+
+    insn.code = code;
+    insn.dst_reg = dst & 0xF;
+    insn.src_reg = src & 0xF;
+    insn.off = offset;
+    insn.imm = imm;
+
+    return insn;
+}
+
+void loadMap(std::vector<bpf_insn>* program, uint8_t dst, int map)
+{
+    // A 64-bit load takes two instructions. The loader replaces the descriptor of the map with
+    // its address.
+    program->emplace_back(instruction(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, map));
+    program->emplace_back(instruction(0, 0, 0, 0, 0));
+}
+
+// The whole received data is one message for the verdict program.
+std::vector<bpf_insn> parserProgram()
+{
+    return
+    {
+        // r0 = skb->len
+        instruction(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_0, BPF_REG_1,
+                    offsetof(__sk_buff, len), 0),
+        instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+    };
+}
+
+// Finds the peer of the socket which received the data, counts the data and redirects it to the
+// peer. The data of unknown sockets is passed to user space.
+std::vector<bpf_insn> verdictProgram(int peer_map, int sock_map)
+{
+    std::vector<bpf_insn> program;
+
+    // r6 = skb
+    program.emplace_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+
+    // *(u64*)(r10 - 8) = bpf_get_socket_cookie(skb)
+    program.emplace_back(instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_get_socket_cookie));
+    program.emplace_back(instruction(BPF_STX | BPF_MEM | BPF_DW, BPF_REG_10, BPF_REG_0, -8, 0));
+
+    // r0 = bpf_map_lookup_elem(peer_map, r10 - 8)
+    program.emplace_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0));
+    program.emplace_back(instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -8));
+    loadMap(&program, BPF_REG_1, peer_map);
+    program.emplace_back(instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem));
+
+    // if (!r0) goto pass
+    program.emplace_back(instruction(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 10, 0));
+
+    // entry->bytes += skb->len
+    program.emplace_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_7, BPF_REG_0, 0, 0));
+    program.emplace_back(instruction(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_1, BPF_REG_6,
+                                     offsetof(__sk_buff, len), 0));
+    program.emplace_back(instruction(BPF_STX | BPF_XADD | BPF_DW, BPF_REG_7, BPF_REG_1,
+                                     offsetof(PeerEntry, bytes), 0));
+
+    // return bpf_sk_redirect_map(skb, sock_map, entry->target_index, 0)
+    program.emplace_back(instruction(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_7,
+                                     offsetof(PeerEntry, target_index), 0));
+    program.emplace_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0));
+    loadMap(&program, BPF_REG_2, sock_map);
+    program.emplace_back(instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 0));
+    program.emplace_back(instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_sk_redirect_map));
+    program.emplace_back(instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    // pass: return SK_PASS
+    program.emplace_back(instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, SK_PASS));
+    program.emplace_back(instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    return program;
+}
+
+bool socketCookie(int socket, uint64_t* cookie)
+{
+    socklen_t length = sizeof(*cookie);
+    if (getsockopt(socket, SOL_SOCKET, SO_COOKIE, cookie, &length) != 0)
+    {
+        PLOG(LS_WARNING) << "getsockopt(SO_COOKIE) failed";
+        return false;
+    }
+
+    return true;
+}
+
+void setLowWatermark(int socket, int value)
+{
+    if (setsockopt(socket, SOL_SOCKET, SO_RCVLOWAT, &value, sizeof(value)) != 0)
+        PLOG(LS_WARNING) << "setsockopt(SO_RCVLOWAT) failed";
+}
+
+} // namespace
+
+KernelForwarder::KernelForwarder(uint32_t max_sessions)
+    : max_sessions_(max_sessions),
+      cookies_(max_sessions * 2)
+{
+    free_slots_.reserve(max_sessions);
+
+    // The lowest slots are taken first.
+    for (uint32_t i = max_sessions; i > 0; --i)
+        free_slots_.emplace_back(static_cast<int>(i - 1));
+}
+
+KernelForwarder::~KernelForwarder()
+{
+    for (int fd : { verdict_program_, parser_program_, peer_map_, sock_map_ })
+    {
+        if (fd != -1)
+            close(fd);
+    }
+}
+
+// static
+bool KernelForwarder::initialize(uint32_t max_sessions)
+{
+    DCHECK(!g_forwarder);
+
+    if (!max_sessions)
+        return false;
+
+    std::unique_ptr<KernelForwarder> forwarder(new KernelForwarder(max_sessions));
+    if (!forwarder->init())
+        return false;
+
+    // The sessions of all threads use the forwarder until the process exits.
+    g_forwarder = forwarder.release();
+    return true;
+}
+
+// static
+KernelForwarder* KernelForwarder::instance()
+{
+    return g_forwarder;
+}
+
+int KernelForwarder::add(int first_socket, int second_socket)
+{
+    const int sockets[2] = { first_socket, second_socket };
+    uint64_t cookies[2];
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!socketCookie(sockets[i], &cookies[i]))
+            return -1;
+    }
+
+    int slot;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        if (free_slots_.empty())
+            return -1;
+
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    for (int i = 0; i < 2; ++i)
+        setLowWatermark(sockets[i], kGateLowWatermark);
+
+    int added = 0;
+    bool succeeded = true;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const PeerEntry entry = { static_cast<uint32_t>(slot * 2 + (i + 1) % 2), 0, 0 };
+        if (!updateElement(peer_map_, &cookies[i], &entry))
+        {
+            PLOG(LS_WARNING) << "Unable to update the peer map";
+            succeeded = false;
+        }
+    }
+
+    for (; succeeded && added < 2; ++added)
+    {
+        const uint32_t index = static_cast<uint32_t>(slot * 2 + added);
+        const uint32_t fd = static_cast<uint32_t>(sockets[added]);
+
+        if (!updateElement(sock_map_, &index, &fd))
+        {
+            PLOG(LS_WARNING) << "Unable to add the socket to the sockmap";
+            succeeded = false;
+            break;
+        }
+    }
+
+    if (!succeeded)
+    {
+        for (int i = 0; i < added; ++i)
+        {
+            const uint32_t index = static_cast<uint32_t>(slot * 2 + i);
+            deleteElement(sock_map_, &index);
+        }
+
+        for (int i = 0; i < 2; ++i)
+            deleteElement(peer_map_, &cookies[i]);
+    }
+    else
+    {
+        std::scoped_lock lock(lock_);
+        cookies_[slot * 2] = cookies[0];
+        cookies_[slot * 2 + 1] = cookies[1];
+    }
+
+    // The data received so far is passed to the verdict program (or to user space if the sockets
+    // were not added) in the order of arrival.
+    for (int i = 0; i < 2; ++i)
+        setLowWatermark(sockets[i], 1);
+
+    if (!succeeded)
+    {
+        std::scoped_lock lock(lock_);
+        free_slots_.emplace_back(slot);
+        return -1;
+    }
+
+    return slot;
+}
+
+void KernelForwarder::remove(int slot)
+{
+    DCHECK(slot >= 0 && static_cast<uint32_t>(slot) < max_sessions_);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const uint32_t index = static_cast<uint32_t>(slot * 2 + i);
+        deleteElement(sock_map_, &index);
+    }
+
+    std::scoped_lock lock(lock_);
+
+    for (int i = 0; i < 2; ++i)
+        deleteElement(peer_map_, &cookies_[slot * 2 + i]);
+
+    free_slots_.emplace_back(slot);
+}
+
+int64_t KernelForwarder::bytesTransferred(int slot) const
+{
+    DCHECK(slot >= 0 && static_cast<uint32_t>(slot) < max_sessions_);
+
+    uint64_t cookies[2];
+
+    {
+        std::scoped_lock lock(lock_);
+        cookies[0] = cookies_[slot * 2];
+        cookies[1] = cookies_[slot * 2 + 1];
+    }
+
+    int64_t bytes = 0;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        PeerEntry entry;
+        if (lookupElement(peer_map_, &cookies[i], &entry))
+            bytes += static_cast<int64_t>(entry.bytes);
+    }
+
+    return bytes;
+}
+
+bool KernelForwarder::init()
+{
+    sock_map_ = createMap(BPF_MAP_TYPE_SOCKMAP, sizeof(uint32_t), sizeof(uint32_t),
+                          max_sessions_ * 2);
+    if (sock_map_ == -1)
+    {
+        PLOG(LS_WARNING) << "Unable to create the sockmap";
+        return false;
+    }
+
+    peer_map_ = createMap(BPF_MAP_TYPE_HASH, sizeof(uint64_t), sizeof(PeerEntry),
+                          max_sessions_ * 2);
+    if (peer_map_ == -1)
+    {
+        PLOG(LS_WARNING) << "Unable to create the peer map";
+        return false;
+    }
+
+    parser_program_ = loadProgram(parserProgram());
+    if (parser_program_ == -1)
+    {
+        PLOG(LS_WARNING) << "Unable to load the parser program";
+        return false;
+    }
+
+    verdict_program_ = loadProgram(verdictProgram(peer_map_, sock_map_));
+    if (verdict_program_ == -1)
+    {
+        PLOG(LS_WARNING) << "Unable to load the verdict program";
+        return false;
+    }
+
+    if (!attachProgram(parser_program_, sock_map_, BPF_SK_SKB_STREAM_PARSER) ||
+        !attachProgram(verdict_program_, sock_map_, BPF_SK_SKB_STREAM_VERDICT))
+    {
+        PLOG(LS_WARNING) << "Unable to attach the programs to the sockmap";
+        return false;
+    }
+
+    LOG(LS_INFO) << "Kernel forwarding is initialized (max sessions: " << max_sessions_ << ")";
+    return true;
+}
+
+} // namespace relay
@@ -0,0 +1,80 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef RELAY__KERNEL_FORWARDER_H
+#define RELAY__KERNEL_FORWARDER_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace relay {
+
+// Forwards the data of the paired sockets inside the kernel (Linux only). The sockets are put
+// into a BPF sockmap with a stream verdict program which redirects each received chunk to the
+// peer socket and counts its size. The relay process is not woken up by the data at all, it only
+// reads the counters from time to time and watches the sockets for closing.
+// Loading the programs requires CAP_BPF and CAP_NET_ADMIN (or root).
+class KernelForwarder
+{
+public:
+    ~KernelForwarder();
+
+    // Creates the maps for |max_sessions| sessions and loads the programs. Returns false if the
+    // kernel does not support it or the process has no rights. Must be called before the sessions
+    // are started.
+    static bool initialize(uint32_t max_sessions);
+
+    // Returns the forwarder or nullptr if it is not initialized.
+    static KernelForwarder* instance();
+
+    // Moves the forwarding between the sockets into the kernel. Returns the slot of the session or
+    // -1 if there is no free slot or the sockets cannot be added. In the last case the sockets and
+    // their received data are not changed.
+    int add(int first_socket, int second_socket);
+
+    // Returns the sockets of |slot| to user space. Must be called before the sockets are closed.
+    void remove(int slot);
+
+    // Returns the number of bytes received from both sockets of |slot|.
+    int64_t bytesTransferred(int slot) const;
+
+private:
+    explicit KernelForwarder(uint32_t max_sessions);
+    bool init();
+
+    const uint32_t max_sessions_;
+
+    int sock_map_ = -1;
+    int peer_map_ = -1;
+    int parser_program_ = -1;
+    int verdict_program_ = -1;
+
+    mutable std::mutex lock_;
+    std::vector<int> free_slots_;
+
+    // The cookies of the sockets of each slot. They are the keys of the peer map.
+    std::vector<uint64_t> cookies_;
+
+    DISALLOW_COPY_AND_ASSIGN(KernelForwarder);
+};
+
+} // namespace relay
+
+#endif // RELAY__KERNEL_FORWARDER_H
@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/key_generator.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+namespace relay {
+
+KeyGenerator::KeyGenerator(size_t low_water_mark, size_t capacity)
+    : low_water_mark_(low_water_mark),
+      capacity_(capacity)
+{
+    DCHECK_LE(low_water_mark_, capacity_);
+}
+
+KeyGenerator::~KeyGenerator()
+{
+    thread_.stop();
+}
+
+void KeyGenerator::start()
+{
+    thread_.start(base::MessageLoop::Type::DEFAULT);
+    refillIfNeeded();
+}
+
+SessionKey KeyGenerator::takeKey()
+{
+    SessionKey session_key;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        if (!keys_.empty())
+        {
+            session_key = std::move(keys_.front());
+            keys_.pop_front();
+        }
+    }
+
+    refillIfNeeded();
+
+    if (session_key.isValid())
+        return session_key;
+
+    LOG(LS_INFO) << "No pre-generated keys. Key is created on demand";
+    return SessionKey::create();
+}
+
+void KeyGenerator::refillIfNeeded()
+{
+    std::shared_ptr<base::TaskRunner> task_runner = thread_.taskRunner();
+    if (!task_runner)
+        return;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        if (refill_pending_ || keys_.size() >= low_water_mark_)
+            return;
+
+        refill_pending_ = true;
+    }
+
+    task_runner->postTask(std::bind(&KeyGenerator::doRefill, this));
+}
+
+void KeyGenerator::doRefill()
+{
+    size_t count = 0;
+
+    while (true)
+    {
+        {
+            std::scoped_lock lock(lock_);
+
+            if (keys_.size() >= capacity_)
+            {
+                refill_pending_ = false;
+                break;
+            }
+        }
+
+        // The key is created without the lock, the controller can take the ready keys meanwhile.
+        SessionKey session_key = SessionKey::create();
+        if (!session_key.isValid())
+        {
+            LOG(LS_ERROR) << "Unable to create session key";
+
+            std::scoped_lock lock(lock_);
+            refill_pending_ = false;
+            break;
+        }
+
+        std::scoped_lock lock(lock_);
+        keys_.emplace_back(std::move(session_key));
+        ++count;
+    }
+
+    LOG(LS_INFO) << "Pre-generated keys: " << count;
+}
+
+} // namespace relay
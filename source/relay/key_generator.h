@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__KEY_GENERATOR_H
+#define RELAY__KEY_GENERATOR_H
+
+#include "base/threading/thread.h"
+#include "relay/session_key.h"
+
+#include <deque>
+#include <mutex>
+
+namespace relay {
+
+// Generates session keys in advance on its own thread. When the number of the ready keys drops
+// below the low-water mark, the buffer is filled up to its capacity again, so a key is usually
+// ready at the moment it is needed.
+class KeyGenerator
+{
+public:
+    KeyGenerator(size_t low_water_mark, size_t capacity);
+    ~KeyGenerator();
+
+    // Starts the thread and fills the buffer.
+    void start();
+
+    // Returns a ready key. If the buffer is empty, the key is created on the calling thread.
+    SessionKey takeKey();
+
+private:
+    void refillIfNeeded();
+    void doRefill();
+
+    const size_t low_water_mark_;
+    const size_t capacity_;
+
+    base::Thread thread_;
+
+    std::mutex lock_;
+    std::deque<SessionKey> keys_;
+    bool refill_pending_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(KeyGenerator);
+};
+
+} // namespace relay
+
+#endif // RELAY__KEY_GENERATOR_H
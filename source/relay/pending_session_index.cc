@@ -0,0 +1,78 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/pending_session_index.h"
+
+#include "base/logging.h"
+
+namespace relay {
+
+namespace {
+
+std::string makeKey(uint32_t key_id, const base::ByteArray& secret)
+{
+    std::string key;
+    key.reserve(sizeof(key_id) + secret.size());
+    key.append(reinterpret_cast<const char*>(&key_id), sizeof(key_id));
+    key.append(reinterpret_cast<const char*>(secret.data()), secret.size());
+    return key;
+}
+
+} // namespace
+
+PendingSession* PendingSessionIndex::takePeer(
+    PendingSession* session, uint32_t key_id, const base::ByteArray& secret)
+{
+    DCHECK(session);
+    DCHECK(!secret.empty());
+
+    std::string key = makeKey(key_id, secret);
+
+    auto it = sessions_.find(key);
+    if (it != sessions_.end())
+    {
+        PendingSession* other_session = it->second;
+        if (other_session != session)
+        {
+            keys_.erase(other_session);
+            sessions_.erase(it);
+            return other_session;
+        }
+
+        return nullptr;
+    }
+
+    // The session can send its credentials only once.
+    DCHECK(keys_.find(session) == keys_.end());
+
+    keys_.emplace(session, key);
+    sessions_.emplace(std::move(key), session);
+    return nullptr;
+}
+
+void PendingSessionIndex::remove(PendingSession* session)
+{
+    auto it = keys_.find(session);
+    if (it == keys_.end())
+        return;
+
+    sessions_.erase(it->second);
+    keys_.erase(it);
+}
+
+} // namespace relay
@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__PENDING_SESSION_INDEX_H
+#define RELAY__PENDING_SESSION_INDEX_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace relay {
+
+class PendingSession;
+
+// Index of the pending sessions that have sent their credentials and are waiting for the opposite
+// peer. Peers are matched by the pair (key_id, secret) in constant time.
+class PendingSessionIndex
+{
+public:
+    PendingSessionIndex() = default;
+    ~PendingSessionIndex() = default;
+
+    // Returns the session waiting with the same credentials and removes it from the index. If there
+    // is no such session, |session| is added to the index and nullptr is returned.
+    PendingSession* takePeer(
+        PendingSession* session, uint32_t key_id, const base::ByteArray& secret);
+
+    // Removes |session| from the index if it is there.
+    void remove(PendingSession* session);
+
+    size_t size() const { return sessions_.size(); }
+
+private:
+    std::unordered_map<std::string, PendingSession*> sessions_;
+
+    // Keys of the sessions in the index, used to remove a session by pointer.
+    std::unordered_map<PendingSession*, std::string> keys_;
+
+    DISALLOW_COPY_AND_ASSIGN(PendingSessionIndex);
+};
+
+} // namespace relay
+
+#endif // RELAY__PENDING_SESSION_INDEX_H
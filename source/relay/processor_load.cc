@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/processor_load.h"
+
+#include "base/logging.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#elif defined(OS_LINUX)
+#include <fstream>
+#include <string>
+#endif // defined(OS_*)
+
+namespace relay {
+
+namespace {
+
+// Gets the time spent by the processors in total and without the idle time.
+bool processorTimes(uint64_t* busy_time, uint64_t* total_time)
+{
+#if defined(OS_WIN)
+    FILETIME idle_time;
+    FILETIME kernel_time;
+    FILETIME user_time;
+
+    if (!GetSystemTimes(&idle_time, &kernel_time, &user_time))
+    {
+        PLOG(LS_WARNING) << "GetSystemTimes failed";
+        return false;
+    }
+
+    auto toUInt64 = [](const FILETIME& time)
+    {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+
+    // The kernel time includes the idle time.
+    *total_time = toUInt64(kernel_time) + toUInt64(user_time);
+    *busy_time = *total_time - toUInt64(idle_time);
+    return true;
+#elif defined(OS_LINUX)
+    std::ifstream stream("/proc/stat");
+    std::string name;
+
+    uint64_t user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+
+    stream >> name >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
+    if (!stream || name != "cpu")
+    {
+        LOG(LS_WARNING) << "Unable to read /proc/stat";
+        return false;
+    }
+
+    *busy_time = user + nice + system + irq + softirq + steal;
+    *total_time = *busy_time + idle + iowait;
+    return true;
+#else
+    return false;
+#endif // defined(OS_*)
+}
+
+} // namespace
+
+uint32_t ProcessorLoad::update()
+{
+    uint64_t busy_time = 0;
+    uint64_t total_time = 0;
+
+    if (!processorTimes(&busy_time, &total_time))
+        return 0;
+
+    uint32_t load = 0;
+
+    if (last_total_time_ && total_time > last_total_time_ && busy_time >= last_busy_time_)
+    {
+        load = static_cast<uint32_t>(
+            (busy_time - last_busy_time_) * 100 / (total_time - last_total_time_));
+    }
+
+    last_busy_time_ = busy_time;
+    last_total_time_ = total_time;
+
+    return load;
+}
+
+} // namespace relay
@@ -0,0 +1,48 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__PROCESSOR_LOAD_H
+#define RELAY__PROCESSOR_LOAD_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+
+namespace relay {
+
+// Measures the load of all processors of the system.
+class ProcessorLoad
+{
+public:
+    ProcessorLoad() = default;
+    ~ProcessorLoad() = default;
+
+    // Returns the load in percent since the previous call. Returns 0 on the first call and if the
+    // load is not available on the platform.
+    uint32_t update();
+
+private:
+    uint64_t last_busy_time_ = 0;
+    uint64_t last_total_time_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ProcessorLoad);
+};
+
+} // namespace relay
+
+#endif // RELAY__PROCESSOR_LOAD_H
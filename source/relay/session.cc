@@ -22,31 +22,109 @@
 #include "base/logging.h"
 #include "base/strings/unicode.h"
 
+#if defined(OS_LINUX)
+#include "relay/kernel_forwarder.h"
+#endif // defined(OS_LINUX)
+
 #include <asio/write.hpp>
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif // defined(OS_LINUX)
+
 namespace relay {
 
+namespace {
+
+#if defined(OS_LINUX)
+// The requested size of the pipe. It bounds the data buffered for one direction.
+const size_t kPipeSize = 256 * 1024;
+
+// The interval of the checks of the send queues of a drained session which was forwarded by the
+// kernel.
+const std::chrono::milliseconds kSendQueuePollInterval(10);
+#endif // defined(OS_LINUX)
+
+} // namespace
+
 Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets)
     : socket_{ std::move(sockets.first), std::move(sockets.second) }
 {
-    for (size_t i = 0; i < kNumberOfSides; ++i)
-        std::fill(buffer_[i].begin(), buffer_[i].end(), 0);
+    // Nothing
 }
 
 Session::~Session()
 {
     stop();
+
+#if defined(OS_LINUX)
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        if (direction_[i].pipe_read_fd != -1)
+            close(direction_[i].pipe_read_fd);
+        if (direction_[i].pipe_write_fd != -1)
+            close(direction_[i].pipe_write_fd);
+    }
+#endif // defined(OS_LINUX)
 }
 
-void Session::start(Delegate* delegate)
+void Session::start(Delegate* delegate,
+                    SessionStatistics::Counters* counters,
+                    BandwidthShaper* shaper)
 {
+    DCHECK(delegate && counters);
+
     LOG(LS_INFO) << "Starting peers session";
 
     start_time_ = Clock::now();
+    last_activity_time_ = start_time_;
     delegate_ = delegate;
+    counters_ = counters;
+
+    counters_->active_sessions.fetch_add(1, std::memory_order_relaxed);
+
+    if (shaper)
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+        {
+            // The peers that send from the same address share the rate of the tenant.
+            std::error_code error_code;
+            asio::ip::tcp::endpoint endpoint = socket_[i].remote_endpoint(error_code);
+            flow_[i] = shaper->createFlow(
+                error_code ? std::string() : endpoint.address().to_string());
+        }
+    }
+
+#if defined(OS_LINUX)
+    if (startKernelForwarding())
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            Session::doWaitClose(this, i);
+        return;
+    }
+
+    if (startSplice())
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            Session::doSpliceRead(this, i);
+        return;
+    }
+#endif // defined(OS_LINUX)
 
     for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        for (int j = 0; j < kNumberOfBuffers; ++j)
+            direction_[i].buffer[j].data.resize(kMinBufferSize);
+
         Session::doReadSome(this, i);
+    }
 }
 
 void Session::stop()
@@ -54,28 +132,94 @@ void Session::stop()
     if (!delegate_)
         return;
 
+#if defined(OS_LINUX)
+    if (kernel_slot_ != -1)
+    {
+        updateActivity();
+
+        KernelForwarder::instance()->remove(kernel_slot_);
+        kernel_slot_ = -1;
+    }
+
+    if (drain_timer_)
+        drain_timer_->cancel();
+#endif // defined(OS_LINUX)
+
     delegate_ = nullptr;
+    counters_->active_sessions.fetch_sub(1, std::memory_order_relaxed);
 
     std::error_code ignored_code;
     for (int i = 0; i < kNumberOfSides; ++i)
     {
         socket_[i].cancel(ignored_code);
         socket_[i].close(ignored_code);
+        flow_[i].reset();
     }
 
     LOG(LS_INFO) << "Session stopped (duration: " << duration().count()
                  << " seconds, bytes transferred: " << bytesTransferred() << ")";
 }
 
-std::chrono::seconds Session::idleTime(const TimePoint& current_time) const
+void Session::drain(std::function<void()> callback)
+{
+    DCHECK(delegate_);
+    DCHECK(!draining_);
+
+    draining_ = true;
+    drain_callback_ = std::move(callback);
+
+#if defined(OS_LINUX)
+    // The data received after the removal from the sockmap stays in the sockets. The data which
+    // is already redirected to the other socket must leave its send queue before the sockets are
+    // released.
+    if (kernel_slot_ != -1)
+    {
+        updateActivity();
+
+        KernelForwarder::instance()->remove(kernel_slot_);
+        kernel_slot_ = -1;
+        drain_send_queues_ = true;
+    }
+#endif // defined(OS_LINUX)
+
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        // A read that waits for the shaper has not been started yet.
+        if (flow_[i] && flow_[i]->isWaiting())
+            direction_[i].is_reading = false;
+        flow_[i].reset();
+
+        // The cancelled reads are not continued. The cancelled writes are started again for the
+        // rest of their data.
+        std::error_code ignored_code;
+        socket_[i].cancel(ignored_code);
+    }
+
+    checkDrained();
+}
+
+Session::NativeHandles Session::release()
 {
-    if (start_idle_time_ == TimePoint())
+    DCHECK(draining_);
+
+    NativeHandle handles[kNumberOfSides];
+
+    for (int i = 0; i < kNumberOfSides; ++i)
     {
-        start_idle_time_ = current_time;
-        return std::chrono::seconds(0);
+        std::error_code error_code;
+        handles[i] = socket_[i].release(error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Unable to release socket: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+            handles[i] = static_cast<NativeHandle>(-1);
+        }
     }
 
-    return std::chrono::duration_cast<std::chrono::seconds>(current_time - start_idle_time_);
+    drain_callback_ = nullptr;
+    stop();
+
+    return std::make_pair(handles[0], handles[1]);
 }
 
 std::chrono::seconds Session::duration() const
@@ -88,42 +232,494 @@ int64_t Session::bytesTransferred() const
     return bytes_transferred_;
 }
 
+void Session::updateActivity()
+{
+#if defined(OS_LINUX)
+    if (kernel_slot_ == -1)
+        return;
+
+    const int64_t bytes_transferred = KernelForwarder::instance()->bytesTransferred(kernel_slot_);
+    if (bytes_transferred == bytes_transferred_)
+        return;
+
+    counters_->bytes_transferred.fetch_add(
+        bytes_transferred - bytes_transferred_, std::memory_order_relaxed);
+    bytes_transferred_ = bytes_transferred;
+    last_activity_time_ = Clock::now();
+#endif // defined(OS_LINUX)
+}
+
+bool Session::acquireRead(int source, std::function<void()> read)
+{
+    if (!flow_[source])
+        return true;
+
+    return flow_[source]->acquire(std::move(read));
+}
+
+void Session::consumeRead(int source, size_t bytes)
+{
+    if (flow_[source])
+        flow_[source]->consume(bytes);
+}
+
 // static
 void Session::doReadSome(Session* session, int source)
 {
+    if (session->draining_)
+        return;
+
+    Direction& direction = session->direction_[source];
+
+    DCHECK(!direction.is_reading);
+    DCHECK(!direction.buffer[direction.read_index].size);
+
+    direction.is_reading = true;
+
+    // The read waits while the peer is over its rate.
+    if (session->acquireRead(source, std::bind(&Session::readSome, session, source)))
+        readSome(session, source);
+}
+
+// static
+void Session::readSome(Session* session, int source)
+{
+    Direction& direction = session->direction_[source];
+    Direction::Buffer& buffer = direction.buffer[direction.read_index];
+
+    size_t size = buffer.data.size();
+    if (session->flow_[source])
+        size = std::min(size, BandwidthShaper::kMaxReadSize);
+
     session->socket_[source].async_read_some(
-        asio::buffer(session->buffer_[source].data(), session->buffer_[source].size()),
+        asio::buffer(buffer.data.data(), size),
         [session, source](const std::error_code& error_code, size_t bytes_transferred)
     {
         if (error_code)
         {
             if (error_code != asio::error::operation_aborted)
+            {
                 session->onErrorOccurred(FROM_HERE, error_code);
+            }
+            else if (session->draining_)
+            {
+                session->direction_[source].is_reading = false;
+                session->checkDrained();
+            }
+            return;
         }
-        else
+
+        Direction& direction = session->direction_[source];
+        const int index = direction.read_index;
+        Direction::Buffer& buffer = direction.buffer[index];
+
+        direction.is_reading = false;
+
+        session->consumeRead(source, bytes_transferred);
+        session->bytes_transferred_ += bytes_transferred;
+        session->counters_->bytes_transferred.fetch_add(
+            static_cast<int64_t>(bytes_transferred), std::memory_order_relaxed);
+        session->last_activity_time_ = Clock::now();
+
+        // The buffer is full, the peer probably sends more. The buffer can grow only when the
+        // write of its data is completed.
+        buffer.size = bytes_transferred;
+        buffer.grow = bytes_transferred == buffer.data.size() &&
+                      buffer.data.size() < kMaxBufferSize;
+
+        if (!direction.is_writing)
+            doWrite(session, source, index);
+
+        // The next chunk is read into the other buffer if it is free. Otherwise the read is
+        // continued when the write of the other buffer is completed.
+        const int next_index = (index + 1) % kNumberOfBuffers;
+        if (!direction.buffer[next_index].size)
         {
-            session->bytes_transferred_ += bytes_transferred;
-            session->start_idle_time_ = TimePoint();
+            direction.read_index = next_index;
+            doReadSome(session, source);
+        }
+    });
+}
+
+// static
+void Session::doWrite(Session* session, int source, int index)
+{
+    Direction& direction = session->direction_[source];
+    Direction::Buffer& buffer = direction.buffer[index];
 
-            asio::async_write(
-                session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
-                asio::const_buffer(session->buffer_[source].data(), bytes_transferred),
-                [session, source](const std::error_code& error_code, size_t bytes_transferred)
+    DCHECK(!direction.is_writing);
+    DCHECK(buffer.size);
+
+    direction.is_writing = true;
+
+    asio::async_write(
+        session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
+        asio::const_buffer(buffer.data.data(), buffer.size),
+        [session, source, index](const std::error_code& error_code, size_t bytes_transferred)
+    {
+        Direction& direction = session->direction_[source];
+        Direction::Buffer& buffer = direction.buffer[index];
+
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
             {
-                if (error_code)
-                {
-                    if (error_code != asio::error::operation_aborted)
-                        session->onErrorOccurred(FROM_HERE, error_code);
-                }
-                else
+                session->onErrorOccurred(FROM_HERE, error_code);
+                return;
+            }
+
+            if (!session->draining_)
+                return;
+
+            // The write was cancelled by drain(). The rest of the data is written again.
+            direction.is_writing = false;
+            if (bytes_transferred < buffer.size)
+            {
+                buffer.size -= bytes_transferred;
+                memmove(buffer.data.data(), buffer.data.data() + bytes_transferred, buffer.size);
+
+                doWrite(session, source, index);
+                return;
+            }
+        }
+
+        direction.is_writing = false;
+
+        buffer.size = 0;
+        if (buffer.grow)
+        {
+            buffer.data.resize(buffer.data.size() * 2);
+            buffer.grow = false;
+        }
+
+        // The other buffer was read while this one was being written.
+        const int next_index = (index + 1) % kNumberOfBuffers;
+        if (direction.buffer[next_index].size)
+            doWrite(session, source, next_index);
+
+        // Both buffers were full and the read was waiting for a free one.
+        if (!direction.is_reading)
+        {
+            direction.read_index = index;
+            doReadSome(session, source);
+        }
+
+        session->checkDrained();
+    });
+}
+
+#if defined(OS_LINUX)
+bool Session::startSplice()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        Direction& direction = direction_[i];
+
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            PLOG(LS_WARNING) << "pipe2 failed";
+            return false;
+        }
+
+        direction.pipe_read_fd = fds[0];
+        direction.pipe_write_fd = fds[1];
+
+        // A larger pipe moves more data per call. The default size is used if it fails.
+        fcntl(direction.pipe_write_fd, F_SETPIPE_SZ, static_cast<int>(kPipeSize));
+
+        int capacity = fcntl(direction.pipe_write_fd, F_GETPIPE_SZ);
+        if (capacity <= 0)
+        {
+            PLOG(LS_WARNING) << "fcntl(F_GETPIPE_SZ) failed";
+            return false;
+        }
+
+        direction.pipe_capacity = static_cast<size_t>(capacity);
+    }
+
+    std::error_code error_code;
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        socket_[i].non_blocking(true, error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Unable to set non-blocking mode: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// static
+void Session::doSpliceRead(Session* session, int source)
+{
+    if (session->draining_)
+        return;
+
+    Direction& direction = session->direction_[source];
+    DCHECK(!direction.is_reading);
+
+    direction.is_reading = true;
+
+    if (session->acquireRead(source, std::bind(&Session::waitSpliceRead, session, source)))
+        waitSpliceRead(session, source);
+}
+
+// static
+void Session::waitSpliceRead(Session* session, int source)
+{
+    session->socket_[source].async_wait(asio::ip::tcp::socket::wait_read,
+                                        [session, source](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+            {
+                session->onErrorOccurred(FROM_HERE, error_code);
+            }
+            else if (session->draining_)
+            {
+                session->direction_[source].is_reading = false;
+                session->checkDrained();
+            }
+            return;
+        }
+
+        Direction& direction = session->direction_[source];
+        direction.is_reading = false;
+
+        // The wait has completed before drain() was called. The data stays in the socket.
+        if (session->draining_)
+        {
+            session->checkDrained();
+            return;
+        }
+
+        // The pipe is a bounded buffer between the peers. More data is read while the previous
+        // data is being written.
+        size_t max_size = direction.pipe_capacity - direction.pipe_pending;
+        if (session->flow_[source])
+            max_size = std::min(max_size, BandwidthShaper::kMaxReadSize);
+
+        ssize_t size = splice(session->socket_[source].native_handle(), nullptr,
+                              direction.pipe_write_fd, nullptr, max_size,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (size < 0)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+            {
+                session->onErrorOccurred(
+                    FROM_HERE, std::error_code(errno, std::system_category()));
+                return;
+            }
+
+            // If the pipe is not empty, it may be full. The read is continued when the write
+            // frees it.
+            if (!direction.pipe_pending)
+                doSpliceRead(session, source);
+            return;
+        }
+
+        if (size == 0)
+        {
+            session->onErrorOccurred(FROM_HERE, asio::error::eof);
+            return;
+        }
+
+        direction.pipe_pending += static_cast<size_t>(size);
+        session->consumeRead(source, static_cast<size_t>(size));
+        session->bytes_transferred_ += size;
+        session->counters_->bytes_transferred.fetch_add(size, std::memory_order_relaxed);
+        session->last_activity_time_ = Clock::now();
+
+        if (!direction.is_writing)
+            doSpliceWrite(session, source);
+
+        if (!direction.is_reading && direction.pipe_pending < direction.pipe_capacity)
+            doSpliceRead(session, source);
+    });
+}
+
+// static
+void Session::doSpliceWrite(Session* session, int source)
+{
+    Direction& direction = session->direction_[source];
+    asio::ip::tcp::socket& target =
+        session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides];
+
+    while (direction.pipe_pending)
+    {
+        ssize_t size = splice(direction.pipe_read_fd, nullptr, target.native_handle(), nullptr,
+                              direction.pipe_pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (size < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN)
+            {
+                // The send buffer of the target is full. Wait until it can accept more.
+                direction.is_writing = true;
+
+                target.async_wait(asio::ip::tcp::socket::wait_write,
+                                  [session, source](const std::error_code& error_code)
                 {
-                    doReadSome(session, source);
-                }
-            });
+                    if (error_code)
+                    {
+                        if (error_code != asio::error::operation_aborted)
+                        {
+                            session->onErrorOccurred(FROM_HERE, error_code);
+                            return;
+                        }
+
+                        // The wait was cancelled by drain(). The pipe is written out.
+                        if (!session->draining_)
+                            return;
+                    }
+
+                    session->direction_[source].is_writing = false;
+                    doSpliceWrite(session, source);
+                });
+                break;
+            }
+
+            session->onErrorOccurred(FROM_HERE, std::error_code(errno, std::system_category()));
+            return;
+        }
+
+        direction.pipe_pending -= static_cast<size_t>(size);
+    }
+
+    if (!direction.is_reading && direction.pipe_pending < direction.pipe_capacity)
+        doSpliceRead(session, source);
+
+    session->checkDrained();
+}
+
+bool Session::startKernelForwarding()
+{
+    // The kernel forwards the data without the limits of the shaper.
+    KernelForwarder* forwarder = KernelForwarder::instance();
+    if (!forwarder || flow_[0] || flow_[1])
+        return false;
+
+    // If the sockets cannot be added, they are forwarded by splice.
+    kernel_slot_ = forwarder->add(socket_[0].native_handle(), socket_[1].native_handle());
+    return kernel_slot_ != -1;
+}
+
+// static
+void Session::doWaitClose(Session* session, int source)
+{
+    session->socket_[source].async_wait(asio::ip::tcp::socket::wait_read,
+                                        [session, source](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        if (session->draining_)
+            return;
+
+        // The data is redirected before it reaches the socket queue. The socket becomes readable
+        // when the peer closes the connection.
+        uint8_t byte;
+        ssize_t size = recv(session->socket_[source].native_handle(), &byte, sizeof(byte),
+                            MSG_PEEK | MSG_DONTWAIT);
+        if (size == 0)
+        {
+            session->onErrorOccurred(FROM_HERE, asio::error::eof);
+            return;
+        }
+
+        if (size < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            session->onErrorOccurred(FROM_HERE, std::error_code(errno, std::system_category()));
+            return;
         }
+
+        doWaitClose(session, source);
     });
 }
 
+bool Session::checkSendQueues()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        // The queue contains the data which is not sent yet or not acknowledged by the peer.
+        int bytes = 0;
+        if (ioctl(socket_[i].native_handle(), SIOCOUTQ, &bytes) == -1)
+        {
+            PLOG(LS_WARNING) << "ioctl(SIOCOUTQ) failed";
+            continue;
+        }
+
+        if (bytes > 0)
+        {
+            // If the peer does not receive the data, the session is finished by the timeout of
+            // the drain.
+            if (!drain_timer_)
+            {
+                drain_timer_ =
+                    std::make_unique<asio::high_resolution_timer>(socket_[i].get_executor());
+            }
+
+            drain_timer_->expires_after(kSendQueuePollInterval);
+            drain_timer_->async_wait([this](const std::error_code& error_code)
+            {
+                if (error_code)
+                    return;
+
+                checkDrained();
+            });
+            return false;
+        }
+    }
+
+    drain_send_queues_ = false;
+    return true;
+}
+#endif // defined(OS_LINUX)
+
+void Session::checkDrained()
+{
+    if (!drain_callback_)
+        return;
+
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        const Direction& direction = direction_[i];
+        if (direction.is_reading || direction.is_writing)
+            return;
+
+        for (int j = 0; j < kNumberOfBuffers; ++j)
+        {
+            if (direction.buffer[j].size)
+                return;
+        }
+
+#if defined(OS_LINUX)
+        if (direction.pipe_pending)
+            return;
+#endif // defined(OS_LINUX)
+    }
+
+#if defined(OS_LINUX)
+    if (drain_send_queues_ && !checkSendQueues())
+        return;
+#endif // defined(OS_LINUX)
+
+    std::function<void()> callback;
+    callback.swap(drain_callback_);
+    callback();
+}
+
 void Session::onErrorOccurred(const base::Location& location, const std::error_code& error_code)
 {
     LOG(LS_ERROR) << "Connection finished: " << base::utf16FromLocal8Bit(error_code.message())
@@ -20,9 +20,15 @@
 #define RELAY__SESSION_H
 
 #include "base/macros_magic.h"
+#include "build/build_config.h"
+#include "relay/bandwidth_shaper.h"
+#include "relay/session_statistics.h"
 
+#include <asio/high_resolution_timer.hpp>
 #include <asio/ip/tcp.hpp>
 
+#include <vector>
+
 namespace base {
 class Location;
 } // namespace base
@@ -37,6 +43,8 @@ public:
 
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
+    using NativeHandle = asio::ip::tcp::socket::native_handle_type;
+    using NativeHandles = std::pair<NativeHandle, NativeHandle>;
 
     class Delegate
     {
@@ -46,28 +54,124 @@ public:
         virtual void onSessionFinished(Session* session) = 0;
     };
 
-    void start(Delegate* delegate);
+    // Starts forwarding. The session counts itself and its traffic in |counters|. If |shaper| is
+    // not null, the reads from the peers are limited by it.
+    void start(Delegate* delegate,
+               SessionStatistics::Counters* counters,
+               BandwidthShaper* shaper = nullptr);
     void stop();
 
-    std::chrono::seconds idleTime(const TimePoint& current_time) const;
+    // Stops reading from the peers and calls |callback| when the data that is already read has
+    // been written to them. The session which is forwarded by the kernel is removed from the
+    // forwarder and |callback| is called when the send queues of both sockets are empty. The
+    // sockets of the session can then be passed to another process.
+    void drain(std::function<void()> callback);
+
+    // Stops a drained session without closing its sockets and returns them.
+    NativeHandles release();
+
+    // Returns the time of the last data received from the peers.
+    const TimePoint& lastActivityTime() const { return last_activity_time_; }
+
     std::chrono::seconds duration() const;
     int64_t bytesTransferred() const;
 
+    // Takes the traffic forwarded by the kernel into account. The kernel does not report it, so
+    // it is called before the activity of the session is checked.
+    void updateActivity();
+
 private:
+    // Returns true if the peer |source| can be read now. Otherwise |read| is called later.
+    bool acquireRead(int source, std::function<void()> read);
+    void consumeRead(int source, size_t bytes);
+
     static void doReadSome(Session* session, int source);
+    static void readSome(Session* session, int source);
+    static void doWrite(Session* session, int source, int index);
     void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
+    void checkDrained();
+
+#if defined(OS_LINUX)
+    // The data is moved from one socket to the other through a pipe in the kernel and is never
+    // copied to user space. The relay does not need to see the encrypted data of the peers.
+    bool startSplice();
+    static void doSpliceRead(Session* session, int source);
+    static void waitSpliceRead(Session* session, int source);
+    static void doSpliceWrite(Session* session, int source);
+
+    // The sockets are forwarded to each other by the kernel forwarder. The session only waits
+    // for the peers to close the connections.
+    bool startKernelForwarding();
+    static void doWaitClose(Session* session, int source);
+
+    // Returns true if the data redirected by the kernel forwarder is sent from both sockets.
+    // Otherwise checkDrained() is called again later.
+    bool checkSendQueues();
+#endif // defined(OS_LINUX)
 
     TimePoint start_time_;
-    mutable TimePoint start_idle_time_;
+    TimePoint last_activity_time_;
     int64_t bytes_transferred_ = 0;
 
     static const int kNumberOfSides = 2;
-    static const int kBufferSize = 8192;
+
+    static const int kNumberOfBuffers = 2;
+
+    // A buffer grows while the reads fill it completely.
+    static const size_t kMinBufferSize = 8 * 1024;
+    static const size_t kMaxBufferSize = 256 * 1024;
+
+    // Data sent by one peer to the other. The next chunk is read while the previous one is being
+    // written, so a slow write to one peer does not stop the reads from the other.
+    struct Direction
+    {
+        struct Buffer
+        {
+            std::vector<uint8_t> data;
+
+            // The number of bytes that are read and not yet written. 0 if the buffer is free.
+            size_t size = 0;
+
+            bool grow = false;
+        };
+
+        Buffer buffer[kNumberOfBuffers];
+
+        int read_index = 0;
+        bool is_reading = false;
+        bool is_writing = false;
+
+#if defined(OS_LINUX)
+        int pipe_read_fd = -1;
+        int pipe_write_fd = -1;
+        size_t pipe_capacity = 0;
+
+        // The number of bytes in the pipe that are not yet written to the target socket.
+        size_t pipe_pending = 0;
+#endif // defined(OS_LINUX)
+    };
 
     asio::ip::tcp::socket socket_[kNumberOfSides];
-    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
+    Direction direction_[kNumberOfSides];
+
+    // The rate limits of the data sent by each peer. Empty if the traffic is not shaped.
+    std::unique_ptr<BandwidthShaper::Flow> flow_[kNumberOfSides];
 
     Delegate* delegate_ = nullptr;
+    SessionStatistics::Counters* counters_ = nullptr;
+
+    bool draining_ = false;
+    std::function<void()> drain_callback_;
+
+#if defined(OS_LINUX)
+    // The slot of the session in the kernel forwarder or -1.
+    int kernel_slot_ = -1;
+
+    // The session was forwarded by the kernel before drain(). The redirected data is still in the
+    // send queues of the sockets.
+    bool drain_send_queues_ = false;
+    std::unique_ptr<asio::high_resolution_timer> drain_timer_;
+#endif // defined(OS_LINUX)
 
     DISALLOW_COPY_AND_ASSIGN(Session);
 };
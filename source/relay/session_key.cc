@@ -66,6 +66,17 @@ SessionKey SessionKey::create()
     return SessionKey(std::move(key_pair), std::move(iv));
 }
 
+// static
+SessionKey SessionKey::fromPrivateKey(const base::ByteArray& private_key,
+                                      const base::ByteArray& iv)
+{
+    base::KeyPair key_pair = base::KeyPair::fromPrivateKey(private_key);
+    if (!key_pair.isValid() || iv.empty())
+        return SessionKey();
+
+    return SessionKey(std::move(key_pair), base::ByteArray(iv));
+}
+
 bool SessionKey::isValid() const
 {
     return key_pair_.isValid() && !iv_.empty();
@@ -33,6 +33,9 @@ public:
 
     static SessionKey create();
 
+    // Restores a key passed from another process.
+    static SessionKey fromPrivateKey(const base::ByteArray& private_key, const base::ByteArray& iv);
+
     bool isValid() const;
 
     base::ByteArray privateKey() const;
@@ -25,13 +25,15 @@
 #include "base/crypto/message_decryptor_openssl.h"
 #include "base/peer/host_id.h"
 #include "base/strings/unicode.h"
+#include "relay/session_shard.h"
+
+#include <algorithm>
+#include <thread>
 
 namespace relay {
 
 namespace {
 
-const std::chrono::minutes kIdleTimerInterval { 1 };
-
 // Decrypts an encrypted pair of peer identifiers using key |session_key|.
 base::ByteArray decryptSecret(const proto::PeerToRelay& message, const SharedPool::Key& key)
 {
@@ -70,41 +72,43 @@ base::ByteArray decryptSecret(const proto::PeerToRelay& message, const SharedPoo
 
 // Removes a session from the list and returns a pointer to it.
 template<class T>
-std::unique_ptr<T> removeSessionT(std::vector<std::unique_ptr<T>>* session_list, T* session)
+std::unique_ptr<T> removeSessionT(std::unordered_map<T*, std::unique_ptr<T>>* session_list,
+                                  T* session)
 {
     session->stop();
 
-    auto it = session_list->begin();
-    while (it != session_list->end())
-    {
-        if (it->get() == session)
-            break;
-
-        ++it;
-    }
-
-    if (it != session_list->end())
-    {
-        std::unique_ptr<T> result = std::move(*it);
-        session_list->erase(it);
-        return result;
-    }
+    auto it = session_list->find(session);
+    if (it == session_list->end())
+        return nullptr;
 
-    return nullptr;
+    std::unique_ptr<T> result = std::move(it->second);
+    session_list->erase(it);
+    return result;
 }
 
 } // namespace
 
 SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                                uint16_t port,
-                               const std::chrono::minutes& idle_timeout)
+                               const std::chrono::minutes& idle_timeout,
+                               uint32_t worker_count,
+                               const BandwidthShaper::Limits& bandwidth_limits,
+                               std::shared_ptr<SessionStatistics> statistics)
     : task_runner_(std::move(task_runner)),
-      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext(),
-                asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)),
+      port_(port),
+      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      bandwidth_limits_(bandwidth_limits),
+      tenants_(std::make_shared<BandwidthShaper::Tenants>(bandwidth_limits.tenant_rate)),
       idle_timeout_(idle_timeout),
+      worker_count_(worker_count),
+      statistics_(std::move(statistics)),
+      idle_wheel_(idle_timeout),
       idle_timer_(base::MessageLoop::current()->pumpAsio()->ioContext())
 {
-    DCHECK(task_runner_);
+    DCHECK(task_runner_ && statistics_);
+
+    if (bandwidth_limits_.isEnabled())
+        shaper_ = std::make_unique<BandwidthShaper>(bandwidth_limits_, tenants_);
 
     LOG(LS_INFO) << "Session manager port: " << port;
 }
@@ -115,6 +119,24 @@ SessionManager::~SessionManager()
     acceptor_.cancel(ignored_code);
     acceptor_.close(ignored_code);
     idle_timer_.cancel();
+
+    // The shards stop their threads and the sessions on them.
+    shards_.clear();
+}
+
+void SessionManager::adopt(NativeHandle listener, std::vector<Session::NativeHandles> sessions)
+{
+    DCHECK(!acceptor_.is_open());
+
+    std::error_code error_code;
+    acceptor_.assign(asio::ip::tcp::v4(), listener, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to adopt listening socket: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+    }
+
+    adopted_sessions_ = std::move(sessions);
 }
 
 void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* delegate)
@@ -126,12 +148,107 @@ void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* de
 
     DCHECK(delegate_ && shared_pool_);
 
-    idle_timer_.expires_after(kIdleTimerInterval);
+    uint32_t worker_count = worker_count_;
+    if (!worker_count)
+        worker_count = std::max(std::thread::hardware_concurrency(), 1U);
+
+    LOG(LS_INFO) << "Number of session workers: " << worker_count;
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        // The first counters are used by the sessions of the manager.
+        shards_.emplace_back(std::make_unique<SessionShard>(
+            idle_timeout_, bandwidth_limits_, tenants_, statistics_->counters(i + 1), delegate_));
+        shards_.back()->start();
+    }
+
+    if (!acceptor_.is_open())
+    {
+        const asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port_);
+
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+    }
+
+    if (!adopted_sessions_.empty())
+    {
+        LOG(LS_INFO) << "Adopted sessions: " << adopted_sessions_.size();
+
+        asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+        for (const auto& handles : adopted_sessions_)
+        {
+            std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket> sockets(
+                asio::ip::tcp::socket(io_context, asio::ip::tcp::v4(), handles.first),
+                asio::ip::tcp::socket(io_context, asio::ip::tcp::v4(), handles.second));
+
+            startSession(std::move(sockets));
+        }
+
+        adopted_sessions_.clear();
+    }
+
+    idle_timer_.expires_after(IdleWheel::kTickInterval);
     idle_timer_.async_wait(std::bind(&SessionManager::doIdleTimeout, this, std::placeholders::_1));
 
     SessionManager::doAccept(this);
 }
 
+void SessionManager::handoff(HandoffCallback callback)
+{
+    DCHECK(!handoff_callback_);
+
+    // The pending accept is completed with operation_aborted.
+    std::error_code error_code;
+    handoff_listener_ = acceptor_.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to release listening socket: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        callback(static_cast<NativeHandle>(-1), std::vector<Session::NativeHandles>());
+        return;
+    }
+
+    handoff_callback_ = std::move(callback);
+
+    // The peers that are not paired yet connect again to the new process.
+    std::vector<PendingSession*> pending_sessions;
+    for (const auto& session : pending_sessions_)
+        pending_sessions.emplace_back(session.first);
+
+    for (PendingSession* session : pending_sessions)
+        removePendingSession(session);
+
+    // The sessions of the manager are rare and are not drained.
+    std::vector<Session*> active_sessions;
+    for (const auto& session : active_sessions_)
+        active_sessions.emplace_back(session.first);
+
+    for (Session* session : active_sessions)
+        removeSession(session);
+
+    LOG(LS_INFO) << "Handoff started (pending: " << pending_sessions.size()
+                 << ", closed: " << active_sessions.size() << ")";
+
+    handoff_shard_count_ = shards_.size();
+    if (!handoff_shard_count_)
+    {
+        onShardHandedOff(std::vector<Session::NativeHandles>());
+        return;
+    }
+
+    for (auto& shard : shards_)
+    {
+        shard->handoff([this](std::vector<Session::NativeHandles> sessions)
+        {
+            task_runner_->postTask(
+                std::bind(&SessionManager::onShardHandedOff, this, std::move(sessions)));
+        });
+    }
+}
+
 void SessionManager::onPendingSessionReady(
     PendingSession* session, const proto::PeerToRelay& message)
 {
@@ -149,25 +266,24 @@ void SessionManager::onPendingSessionReady(
             session->setIdentify(message.key_id(), secret);
 
             // Trying to find a peer that wants to be connected.
-            for (auto& other_session : pending_sessions_)
+            PendingSession* other_session =
+                waiting_sessions_.takePeer(session, message.key_id(), secret);
+            if (other_session)
             {
-                if (session->isPeerFor(*other_session))
-                {
-                    LOG(LS_INFO) << "Both peers are connected with key " << message.key_id();
-
-                    // Delete the key from the pool. It can no longer be used.
-                    shared_pool_->removeKey(message.key_id());
-
-                    // Now the opposite peer is found, start the data transfer between them.
-                    active_sessions_.emplace_back(std::make_unique<Session>(
-                        std::make_pair(session->takeSocket(), other_session->takeSocket())));
-                    active_sessions_.back()->start(this);
-
-                    // Pending sessions are no longer needed, remove them.
-                    removePendingSession(other_session.get());
-                    removePendingSession(session);
-                    return;
-                }
+                DCHECK(session->isPeerFor(*other_session));
+
+                LOG(LS_INFO) << "Both peers are connected with key " << message.key_id();
+
+                // Delete the key from the pool. It can no longer be used.
+                shared_pool_->removeKey(message.key_id());
+
+                // Now the opposite peer is found, start the data transfer between them.
+                startSession(std::make_pair(session->takeSocket(), other_session->takeSocket()));
+
+                // Pending sessions are no longer needed, remove them.
+                removePendingSession(other_session);
+                removePendingSession(session);
+                return;
             }
 
             LOG(LS_INFO) << "Second peer has not connected yet";
@@ -209,9 +325,12 @@ void SessionManager::doAccept(SessionManager* self)
                 socket.remote_endpoint().address().to_string());
 
             // A new peer is connected. Create and start the pending session.
-            self->pending_sessions_.emplace_back(std::make_unique<PendingSession>(
-                self->task_runner_, std::move(socket), self));
-            self->pending_sessions_.back()->start();
+            std::unique_ptr<PendingSession> session =
+                std::make_unique<PendingSession>(self->task_runner_, std::move(socket), self);
+            PendingSession* session_ptr = session.get();
+
+            self->pending_sessions_.emplace(session_ptr, std::move(session));
+            session_ptr->start();
         }
         else
         {
@@ -240,41 +359,76 @@ void SessionManager::doIdleTimeoutImpl(const std::error_code& error_code)
 {
     if (!error_code)
     {
-        auto current_time = Session::Clock::now();
-        auto it = active_sessions_.begin();
-        int count = 0;
+        std::vector<Session*> expired = idle_wheel_.advance(Session::Clock::now());
 
-        while (it != active_sessions_.end())
-        {
-            if ((*it)->idleTime(current_time) >= idle_timeout_)
-            {
-                it = active_sessions_.erase(it);
-                ++count;
-            }
-            else
-            {
-                ++it;
-            }
-        }
+        for (Session* session : expired)
+            active_sessions_.erase(session);
 
-        LOG(LS_INFO) << "Sessions ended by timeout: " << count;
+        LOG(LS_INFO) << "Sessions ended by timeout: " << expired.size();
     }
     else
     {
         LOG(LS_ERROR) << "Error in idle timer: " << base::utf16FromLocal8Bit(error_code.message());
     }
 
-    idle_timer_.expires_after(kIdleTimerInterval);
+    idle_timer_.expires_after(IdleWheel::kTickInterval);
     idle_timer_.async_wait(std::bind(&SessionManager::doIdleTimeout, this, std::placeholders::_1));
 }
 
 void SessionManager::removePendingSession(PendingSession* session)
 {
+    waiting_sessions_.remove(session);
     task_runner_->deleteSoon(removeSessionT(&pending_sessions_, session));
 }
 
+void SessionManager::startSession(
+    std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets)
+{
+    // The least loaded shard forwards the new session.
+    auto shard = std::min_element(shards_.begin(), shards_.end(),
+                                  [](const auto& first, const auto& second)
+    {
+        return first->sessionCount() < second->sessionCount();
+    });
+
+    if (shard != shards_.end() && (*shard)->addSession(&sockets))
+        return;
+
+    std::unique_ptr<Session> session = std::make_unique<Session>(std::move(sockets));
+    Session* session_ptr = session.get();
+
+    active_sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->start(this, statistics_->counters(0), shaper_.get());
+    idle_wheel_.add(session_ptr);
+}
+
+void SessionManager::onShardHandedOff(std::vector<Session::NativeHandles> sessions)
+{
+    handoff_sessions_.insert(handoff_sessions_.end(), sessions.begin(), sessions.end());
+
+    if (handoff_shard_count_ > 1)
+    {
+        --handoff_shard_count_;
+        return;
+    }
+
+    handoff_shard_count_ = 0;
+
+    HandoffCallback callback;
+    callback.swap(handoff_callback_);
+
+    std::vector<Session::NativeHandles> handoff_sessions;
+    handoff_sessions.swap(handoff_sessions_);
+
+    NativeHandle listener = handoff_listener_;
+    handoff_listener_ = static_cast<NativeHandle>(-1);
+
+    callback(listener, std::move(handoff_sessions));
+}
+
 void SessionManager::removeSession(Session* session)
 {
+    idle_wheel_.remove(session);
     task_runner_->deleteSoon(removeSessionT(&active_sessions_, session));
 
     if (delegate_)
@@ -20,18 +20,24 @@
 #define RELAY__SESSION_MANAGER_H
 
 #include "proto/relay_peer.pb.h"
+#include "relay/idle_wheel.h"
 #include "relay/pending_session.h"
+#include "relay/pending_session_index.h"
 #include "relay/session.h"
 #include "relay/shared_pool.h"
 
 #include <asio/high_resolution_timer.hpp>
 
+#include <unordered_map>
+
 namespace base {
 class TaskRunner;
 } // namespace base
 
 namespace relay {
 
+class SessionShard;
+
 class SessionManager
     : public PendingSession::Delegate,
       public Session::Delegate
@@ -45,13 +51,33 @@ public:
         virtual void onSessionFinished() = 0;
     };
 
+    // Sessions are forwarded by |worker_count| threads. If |worker_count| is 0, a thread is started
+    // for each processor core. The reads from the peers are limited by |bandwidth_limits|. The
+    // sessions and their traffic are counted in |statistics|.
     SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                    uint16_t port,
-                   const std::chrono::minutes& idle_timeout);
+                   const std::chrono::minutes& idle_timeout,
+                   uint32_t worker_count,
+                   const BandwidthShaper::Limits& bandwidth_limits,
+                   std::shared_ptr<SessionStatistics> statistics);
     ~SessionManager();
 
+    using NativeHandle = Session::NativeHandle;
+
+    // Takes the listening socket and the sessions of the previous process of the relay. Must be
+    // called before start().
+    void adopt(NativeHandle listener, std::vector<Session::NativeHandles> sessions);
+
     void start(std::unique_ptr<SharedPool> shared_pool, Delegate* delegate);
 
+    using HandoffCallback =
+        std::function<void(NativeHandle listener, std::vector<Session::NativeHandles> sessions)>;
+
+    // Stops accepting peers, drains the active sessions and releases the listening socket and the
+    // sockets of the sessions. Pending sessions are closed. If the listening socket cannot be
+    // released, |callback| is called with an invalid handle and the sessions are left running.
+    void handoff(HandoffCallback callback);
+
 protected:
     // PendingSession::Delegate implementation.
     void onPendingSessionReady(
@@ -68,19 +94,42 @@ private:
 
     void removePendingSession(PendingSession* sessions);
     void removeSession(Session* session);
+    void startSession(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets);
+    void onShardHandedOff(std::vector<Session::NativeHandles> sessions);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
 
+    const uint16_t port_;
     asio::ip::tcp::acceptor acceptor_;
-    std::vector<std::unique_ptr<PendingSession>> pending_sessions_;
-    std::vector<std::unique_ptr<Session>> active_sessions_;
+    std::unordered_map<PendingSession*, std::unique_ptr<PendingSession>> pending_sessions_;
+    // Pending sessions that are waiting for the opposite peer.
+    PendingSessionIndex waiting_sessions_;
+
+    const BandwidthShaper::Limits bandwidth_limits_;
+    std::shared_ptr<BandwidthShaper::Tenants> tenants_;
+    std::unique_ptr<BandwidthShaper> shaper_;
+
+    // Sessions that could not be moved to a shard are forwarded on the thread of the manager.
+    std::unordered_map<Session*, std::unique_ptr<Session>> active_sessions_;
 
     const std::chrono::minutes idle_timeout_;
+    const uint32_t worker_count_;
+    std::shared_ptr<SessionStatistics> statistics_;
+    std::vector<std::unique_ptr<SessionShard>> shards_;
+    IdleWheel idle_wheel_;
     asio::high_resolution_timer idle_timer_;
 
     std::unique_ptr<SharedPool> shared_pool_;
     Delegate* delegate_ = nullptr;
 
+    // Sessions of the previous process. Started in start().
+    std::vector<Session::NativeHandles> adopted_sessions_;
+
+    HandoffCallback handoff_callback_;
+    NativeHandle handoff_listener_ = static_cast<NativeHandle>(-1);
+    std::vector<Session::NativeHandles> handoff_sessions_;
+    size_t handoff_shard_count_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(SessionManager);
 };
 
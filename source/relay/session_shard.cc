@@ -0,0 +1,323 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/session_shard.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+
+#if defined(OS_POSIX)
+#include <unistd.h>
+#endif // defined(OS_POSIX)
+
+namespace relay {
+
+namespace {
+
+// The time given to the sessions to write the data they have already read.
+const std::chrono::seconds kDrainTimeout { 10 };
+
+// Closes a socket that is not owned by asio.
+void closeNativeHandle(asio::ip::tcp::socket::native_handle_type handle)
+{
+#if defined(OS_WIN)
+    closesocket(handle);
+#else
+    close(handle);
+#endif // defined(OS_WIN)
+}
+
+} // namespace
+
+SessionShard::SessionShard(const std::chrono::minutes& idle_timeout,
+                           const BandwidthShaper::Limits& bandwidth_limits,
+                           std::shared_ptr<BandwidthShaper::Tenants> tenants,
+                           SessionStatistics::Counters* counters,
+                           SessionManager::Delegate* delegate)
+    : bandwidth_limits_(bandwidth_limits),
+      tenants_(std::move(tenants)),
+      counters_(counters),
+      delegate_(delegate),
+      idle_wheel_(idle_timeout)
+{
+    DCHECK(tenants_ && counters_ && delegate_);
+}
+
+SessionShard::~SessionShard()
+{
+    thread_.stop();
+}
+
+void SessionShard::start()
+{
+    thread_.start(base::MessageLoop::Type::ASIO, this);
+}
+
+bool SessionShard::addSession(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>* sockets)
+{
+    DCHECK(sockets);
+
+    std::error_code error_code;
+    const asio::ip::tcp protocol = sockets->first.local_endpoint(error_code).protocol();
+    if (error_code)
+        return false;
+
+    // The sockets are detached from the io_context of the caller and attached to the io_context of
+    // the shard. Windows versions older than 8.1 do not support it.
+    NativeHandle first = sockets->first.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    NativeHandle second = sockets->second.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+
+        // Return the first socket to the caller.
+        std::error_code ignored_code;
+        sockets->first.assign(protocol, first, ignored_code);
+        return false;
+    }
+
+    session_count_.fetch_add(1, std::memory_order_relaxed);
+
+    task_runner_->postTask(std::bind(&SessionShard::startSession, this, protocol, first, second));
+    return true;
+}
+
+void SessionShard::handoff(HandoffCallback callback)
+{
+    task_runner_->postTask(std::bind(&SessionShard::startHandoff, this, std::move(callback)));
+}
+
+void SessionShard::onBeforeThreadRunning()
+{
+    task_runner_ = thread_.taskRunner();
+    DCHECK(task_runner_);
+
+    idle_timer_ = std::make_unique<asio::high_resolution_timer>(
+        base::MessageLoop::current()->pumpAsio()->ioContext());
+
+    if (bandwidth_limits_.isEnabled())
+        shaper_ = std::make_unique<BandwidthShaper>(bandwidth_limits_, tenants_);
+
+    idle_timer_->expires_after(IdleWheel::kTickInterval);
+    idle_timer_->async_wait(
+        std::bind(&SessionShard::doIdleTimeout, this, std::placeholders::_1));
+}
+
+void SessionShard::onAfterThreadRunning()
+{
+    sessions_.clear();
+    idle_timer_.reset();
+    handoff_timer_.reset();
+    shaper_.reset();
+}
+
+void SessionShard::onSessionFinished(Session* session)
+{
+    session->stop();
+
+    idle_wheel_.remove(session);
+
+    auto it = sessions_.find(session);
+    if (it != sessions_.end())
+    {
+        task_runner_->deleteSoon(std::move(it->second));
+        sessions_.erase(it);
+        session_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    delegate_->onSessionFinished();
+    checkHandoff();
+}
+
+void SessionShard::startSession(asio::ip::tcp protocol, NativeHandle first, NativeHandle second)
+{
+    asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+    asio::ip::tcp::socket first_socket(io_context);
+    asio::ip::tcp::socket second_socket(io_context);
+
+    std::error_code error_code;
+
+    first_socket.assign(protocol, first, error_code);
+    if (error_code)
+        closeNativeHandle(first);
+
+    if (!error_code)
+    {
+        second_socket.assign(protocol, second, error_code);
+        if (error_code)
+            closeNativeHandle(second);
+    }
+    else
+    {
+        closeNativeHandle(second);
+    }
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to assign socket: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+
+        session_count_.fetch_sub(1, std::memory_order_relaxed);
+        delegate_->onSessionFinished();
+        return;
+    }
+
+    std::unique_ptr<Session> session = std::make_unique<Session>(
+        std::make_pair(std::move(first_socket), std::move(second_socket)));
+    Session* session_ptr = session.get();
+
+    sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->start(this, counters_, shaper_.get());
+    idle_wheel_.add(session_ptr);
+}
+
+// static
+void SessionShard::doIdleTimeout(SessionShard* self, const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    if (!error_code)
+    {
+        std::vector<Session*> expired = self->idle_wheel_.advance(Session::Clock::now());
+
+        for (Session* session : expired)
+            self->sessions_.erase(session);
+
+        self->session_count_.fetch_sub(expired.size(), std::memory_order_relaxed);
+
+        if (!expired.empty())
+        {
+            LOG(LS_INFO) << "Sessions ended by timeout: " << expired.size();
+            self->checkHandoff();
+        }
+    }
+    else
+    {
+        LOG(LS_ERROR) << "Error in idle timer: " << base::utf16FromLocal8Bit(error_code.message());
+    }
+
+    self->idle_timer_->expires_after(IdleWheel::kTickInterval);
+    self->idle_timer_->async_wait(
+        std::bind(&SessionShard::doIdleTimeout, self, std::placeholders::_1));
+}
+
+void SessionShard::startHandoff(HandoffCallback callback)
+{
+    DCHECK(!handoff_callback_);
+    handoff_callback_ = std::move(callback);
+
+    handoff_timer_ = std::make_unique<asio::high_resolution_timer>(
+        base::MessageLoop::current()->pumpAsio()->ioContext());
+    handoff_timer_->expires_after(kDrainTimeout);
+    handoff_timer_->async_wait(
+        std::bind(&SessionShard::doHandoffTimeout, this, std::placeholders::_1));
+
+    // A session may be drained at once and removed from the list.
+    std::vector<Session*> sessions;
+    sessions.reserve(sessions_.size());
+
+    for (const auto& session : sessions_)
+        sessions.emplace_back(session.first);
+
+    LOG(LS_INFO) << "Draining sessions: " << sessions.size();
+
+    for (Session* session : sessions)
+        session->drain(std::bind(&SessionShard::onSessionDrained, this, session));
+
+    checkHandoff();
+}
+
+void SessionShard::onSessionDrained(Session* session)
+{
+    auto it = sessions_.find(session);
+    if (it == sessions_.end())
+        return;
+
+    const Session::NativeHandles handles = session->release();
+    const NativeHandle invalid_handle = static_cast<NativeHandle>(-1);
+
+    if (handles.first != invalid_handle && handles.second != invalid_handle)
+    {
+        handoff_sessions_.emplace_back(handles);
+    }
+    else
+    {
+        if (handles.first != invalid_handle)
+            closeNativeHandle(handles.first);
+        if (handles.second != invalid_handle)
+            closeNativeHandle(handles.second);
+    }
+
+    idle_wheel_.remove(session);
+    task_runner_->deleteSoon(std::move(it->second));
+    sessions_.erase(it);
+    session_count_.fetch_sub(1, std::memory_order_relaxed);
+
+    checkHandoff();
+}
+
+void SessionShard::checkHandoff()
+{
+    if (!handoff_callback_ || !sessions_.empty())
+        return;
+
+    handoff_timer_->cancel();
+
+    LOG(LS_INFO) << "Sessions drained: " << handoff_sessions_.size();
+
+    HandoffCallback callback;
+    callback.swap(handoff_callback_);
+
+    std::vector<Session::NativeHandles> sessions;
+    sessions.swap(handoff_sessions_);
+
+    callback(std::move(sessions));
+}
+
+// static
+void SessionShard::doHandoffTimeout(SessionShard* self, const std::error_code& error_code)
+{
+    if (error_code || !self->handoff_callback_)
+        return;
+
+    LOG(LS_WARNING) << "Sessions not drained in time: " << self->sessions_.size();
+
+    // The peers of these sessions connect again through the router.
+    std::vector<Session*> sessions;
+    for (const auto& session : self->sessions_)
+        sessions.emplace_back(session.first);
+
+    for (Session* session : sessions)
+        self->onSessionFinished(session);
+}
+
+} // namespace relay
@@ -0,0 +1,111 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__SESSION_SHARD_H
+#define RELAY__SESSION_SHARD_H
+
+#include "base/threading/thread.h"
+#include "relay/idle_wheel.h"
+#include "relay/session.h"
+#include "relay/session_manager.h"
+
+#include <asio/high_resolution_timer.hpp>
+
+#include <atomic>
+#include <unordered_map>
+
+namespace relay {
+
+// Data plane worker. Forwards the traffic of its sessions on its own thread with its own
+// io_context, so the relay can use all processor cores. The control plane (accepting connections,
+// pairing peers and the key pool) stays on the thread of SessionManager.
+class SessionShard
+    : public base::Thread::Delegate,
+      public Session::Delegate
+{
+public:
+    // The sessions of the shard are counted in |counters|. The tenants of |bandwidth_limits| are
+    // shared with the other shards.
+    SessionShard(const std::chrono::minutes& idle_timeout,
+                 const BandwidthShaper::Limits& bandwidth_limits,
+                 std::shared_ptr<BandwidthShaper::Tenants> tenants,
+                 SessionStatistics::Counters* counters,
+                 SessionManager::Delegate* delegate);
+    ~SessionShard();
+
+    void start();
+
+    // Moves the paired sockets to the thread of the shard and starts forwarding between them.
+    // Returns false if the sockets cannot be moved to another io_context. In this case the sockets
+    // are left to the caller.
+    bool addSession(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>* sockets);
+
+    // The number of active sessions. Used to select the least loaded shard.
+    size_t sessionCount() const { return session_count_.load(std::memory_order_relaxed); }
+
+    using HandoffCallback = std::function<void(std::vector<Session::NativeHandles> sessions)>;
+
+    // Drains the sessions of the shard and releases their sockets. |callback| is called on the
+    // thread of the shard. The sessions that are not drained in time are closed.
+    void handoff(HandoffCallback callback);
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+    // Session::Delegate implementation.
+    void onSessionFinished(Session* session) override;
+
+private:
+    using NativeHandle = asio::ip::tcp::socket::native_handle_type;
+
+    void startSession(asio::ip::tcp protocol, NativeHandle first, NativeHandle second);
+    static void doIdleTimeout(SessionShard* self, const std::error_code& error_code);
+
+    void startHandoff(HandoffCallback callback);
+    void onSessionDrained(Session* session);
+    void checkHandoff();
+    static void doHandoffTimeout(SessionShard* self, const std::error_code& error_code);
+
+    const BandwidthShaper::Limits bandwidth_limits_;
+    std::shared_ptr<BandwidthShaper::Tenants> tenants_;
+    SessionStatistics::Counters* counters_;
+    SessionManager::Delegate* delegate_;
+
+    base::Thread thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    // Used only on the thread of the shard.
+    std::unique_ptr<asio::high_resolution_timer> idle_timer_;
+    std::unique_ptr<BandwidthShaper> shaper_;
+    std::unordered_map<Session*, std::unique_ptr<Session>> sessions_;
+    IdleWheel idle_wheel_;
+
+    HandoffCallback handoff_callback_;
+    std::vector<Session::NativeHandles> handoff_sessions_;
+    std::unique_ptr<asio::high_resolution_timer> handoff_timer_;
+
+    std::atomic<size_t> session_count_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(SessionShard);
+};
+
+} // namespace relay
+
+#endif // RELAY__SESSION_SHARD_H
@@ -0,0 +1,43 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/session_statistics.h"
+
+namespace relay {
+
+uint32_t SessionStatistics::activeSessions() const
+{
+    uint32_t result = 0;
+
+    for (const auto& counters : counters_)
+        result += counters.active_sessions.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+int64_t SessionStatistics::bytesTransferred() const
+{
+    int64_t result = 0;
+
+    for (const auto& counters : counters_)
+        result += counters.bytes_transferred.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+} // namespace relay
@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__SESSION_STATISTICS_H
+#define RELAY__SESSION_STATISTICS_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace relay {
+
+// Counters of the sessions of the relay. They are updated by the forwarding threads and read by
+// the controller, which reports the load of the relay to the router.
+class SessionStatistics
+{
+public:
+    SessionStatistics() = default;
+    ~SessionStatistics() = default;
+
+    // Each set of counters takes its own cache line, so the forwarding threads that use different
+    // sets do not slow each other down.
+    struct alignas(64) Counters
+    {
+        std::atomic<uint32_t> active_sessions { 0 };
+        std::atomic<int64_t> bytes_transferred { 0 };
+    };
+
+    // Returns the counters for the forwarding thread with index |index|.
+    Counters* counters(size_t index) { return &counters_[index % counters_.size()]; }
+
+    uint32_t activeSessions() const;
+    int64_t bytesTransferred() const;
+
+private:
+    std::array<Counters, 16> counters_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionStatistics);
+};
+
+} // namespace relay
+
+#endif // RELAY__SESSION_STATISTICS_H
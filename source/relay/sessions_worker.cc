@@ -24,13 +24,19 @@ namespace relay {
 
 SessionsWorker::SessionsWorker(uint16_t peer_port,
                                const std::chrono::minutes& peer_idle_timeout,
-                               std::unique_ptr<SharedPool> shared_pool)
+                               uint32_t peer_worker_count,
+                               const BandwidthShaper::Limits& bandwidth_limits,
+                               std::unique_ptr<SharedPool> shared_pool,
+                               std::shared_ptr<SessionStatistics> statistics)
     : peer_port_(peer_port),
       peer_idle_timeout_(peer_idle_timeout),
+      peer_worker_count_(peer_worker_count),
+      bandwidth_limits_(bandwidth_limits),
       shared_pool_(std::move(shared_pool)),
+      statistics_(std::move(statistics)),
       thread_(std::make_unique<base::Thread>())
 {
-    DCHECK(peer_port_ && shared_pool_);
+    DCHECK(peer_port_ && shared_pool_ && statistics_);
 }
 
 SessionsWorker::~SessionsWorker()
@@ -38,6 +44,15 @@ SessionsWorker::~SessionsWorker()
     thread_->stop();
 }
 
+void SessionsWorker::adopt(SessionManager::NativeHandle listener,
+                           std::vector<Session::NativeHandles> sessions)
+{
+    DCHECK(!self_task_runner_);
+
+    adopted_listener_ = listener;
+    adopted_sessions_ = std::move(sessions);
+}
+
 void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
                            SessionManager::Delegate* delegate)
 {
@@ -56,7 +71,12 @@ void SessionsWorker::onBeforeThreadRunning()
     DCHECK(self_task_runner_);
 
     session_manager_ = std::make_unique<SessionManager>(
-        self_task_runner_, peer_port_, peer_idle_timeout_);
+        self_task_runner_, peer_port_, peer_idle_timeout_, peer_worker_count_, bandwidth_limits_,
+        statistics_);
+
+    if (adopted_listener_ != static_cast<SessionManager::NativeHandle>(-1))
+        session_manager_->adopt(adopted_listener_, std::move(adopted_sessions_));
+
     session_manager_->start(std::move(shared_pool_), this);
 }
 
@@ -65,6 +85,27 @@ void SessionsWorker::onAfterThreadRunning()
     session_manager_.reset();
 }
 
+void SessionsWorker::handoff(SessionManager::HandoffCallback callback)
+{
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(
+            std::bind(&SessionsWorker::handoff, this, std::move(callback)));
+        return;
+    }
+
+    session_manager_->handoff(std::bind(&SessionsWorker::onHandoffReady, this, std::move(callback),
+                                        std::placeholders::_1, std::placeholders::_2));
+}
+
+void SessionsWorker::onHandoffReady(SessionManager::HandoffCallback callback,
+                                    SessionManager::NativeHandle listener,
+                                    std::vector<Session::NativeHandles> sessions)
+{
+    caller_task_runner_->postTask(
+        std::bind(std::move(callback), listener, std::move(sessions)));
+}
+
 void SessionsWorker::onSessionFinished()
 {
     if (!caller_task_runner_->belongsToCurrentThread())
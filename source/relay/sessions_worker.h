@@ -33,12 +33,27 @@ class SessionsWorker
 public:
     SessionsWorker(uint16_t peer_port,
                    const std::chrono::minutes& peer_idle_timeout,
-                   std::unique_ptr<SharedPool> shared_pool);
+                   uint32_t peer_worker_count,
+                   const BandwidthShaper::Limits& bandwidth_limits,
+                   std::unique_ptr<SharedPool> shared_pool,
+                   std::shared_ptr<SessionStatistics> statistics);
     ~SessionsWorker();
 
+    // Takes the listening socket and the sessions of the previous process of the relay. Must be
+    // called before start().
+    void adopt(SessionManager::NativeHandle listener,
+               std::vector<Session::NativeHandles> sessions);
+
     void start(std::shared_ptr<base::TaskRunner> caller_task_runner,
                SessionManager::Delegate* delegate);
 
+    // Releases the listening socket and the sockets of the drained sessions. |callback| is called
+    // on the thread of the caller.
+    void handoff(SessionManager::HandoffCallback callback);
+
+    // The task runner of the thread of the worker. Valid after start().
+    std::shared_ptr<base::TaskRunner> taskRunner() const { return self_task_runner_; }
+
 protected:
     // base::Thread::Delegate implementation.
     void onBeforeThreadRunning() override;
@@ -48,10 +63,21 @@ protected:
     void onSessionFinished() override;
 
 private:
+    void onHandoffReady(SessionManager::HandoffCallback callback,
+                        SessionManager::NativeHandle listener,
+                        std::vector<Session::NativeHandles> sessions);
+
     const uint16_t peer_port_;
     const std::chrono::minutes peer_idle_timeout_;
+    const uint32_t peer_worker_count_;
+    const BandwidthShaper::Limits bandwidth_limits_;
 
     std::unique_ptr<SharedPool> shared_pool_;
+    std::shared_ptr<SessionStatistics> statistics_;
+
+    SessionManager::NativeHandle adopted_listener_ =
+        static_cast<SessionManager::NativeHandle>(-1);
+    std::vector<Session::NativeHandles> adopted_sessions_;
 
     std::unique_ptr<base::Thread> thread_;
     std::shared_ptr<base::TaskRunner> caller_task_runner_;
@@ -101,6 +101,76 @@ uint32_t Settings::maxPeerCount() const
     return impl_.get<uint32_t>("MaxPeerCount", 100);
 }
 
+void Settings::setPeerWorkerCount(uint32_t count)
+{
+    impl_.set<uint32_t>("PeerWorkerCount", count);
+}
+
+uint32_t Settings::peerWorkerCount() const
+{
+    return impl_.get<uint32_t>("PeerWorkerCount", 0);
+}
+
+void Settings::setKernelForwardingEnabled(bool enable)
+{
+    impl_.set<bool>("KernelForwarding", enable);
+}
+
+bool Settings::isKernelForwardingEnabled() const
+{
+    return impl_.get<bool>("KernelForwarding", false);
+}
+
+void Settings::setSessionBandwidth(uint32_t kbytes_per_second)
+{
+    impl_.set<uint32_t>("SessionBandwidth", kbytes_per_second);
+}
+
+uint32_t Settings::sessionBandwidth() const
+{
+    return impl_.get<uint32_t>("SessionBandwidth", 0);
+}
+
+void Settings::setTenantBandwidth(uint32_t kbytes_per_second)
+{
+    impl_.set<uint32_t>("TenantBandwidth", kbytes_per_second);
+}
+
+uint32_t Settings::tenantBandwidth() const
+{
+    return impl_.get<uint32_t>("TenantBandwidth", 0);
+}
+
+void Settings::setHandoffPath(const std::string& path)
+{
+    impl_.set<std::string>("HandoffPath", path);
+}
+
+std::string Settings::handoffPath() const
+{
+    return impl_.get<std::string>("HandoffPath");
+}
+
+void Settings::setMetricsAddress(const std::u16string& address)
+{
+    impl_.set<std::u16string>("MetricsAddress", address);
+}
+
+std::u16string Settings::metricsAddress() const
+{
+    return impl_.get<std::u16string>("MetricsAddress", u"127.0.0.1");
+}
+
+void Settings::setMetricsPort(uint16_t port)
+{
+    impl_.set<uint16_t>("MetricsPort", port);
+}
+
+uint16_t Settings::metricsPort() const
+{
+    return impl_.get<uint16_t>("MetricsPort", 0);
+}
+
 void Settings::setMinLogLevel(int level)
 {
     impl_.set<int>("MinLogLevel", level);
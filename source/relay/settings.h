@@ -52,6 +52,35 @@ public:
     void setMaxPeerCount(uint32_t count);
     uint32_t maxPeerCount() const;
 
+    // The number of threads that forward the traffic of peers. 0 means one per processor core.
+    void setPeerWorkerCount(uint32_t count);
+    uint32_t peerWorkerCount() const;
+
+    // Forwards the traffic of peers inside the kernel with a BPF sockmap (Linux only). Requires
+    // CAP_BPF and CAP_NET_ADMIN. If the kernel forwarding is unavailable, splice is used.
+    void setKernelForwardingEnabled(bool enable);
+    bool isKernelForwardingEnabled() const;
+
+    // The limits of the data sent by one peer of a session and by all peers from the same address,
+    // in kilobytes per second. 0 means no limit.
+    void setSessionBandwidth(uint32_t kbytes_per_second);
+    uint32_t sessionBandwidth() const;
+    void setTenantBandwidth(uint32_t kbytes_per_second);
+    uint32_t tenantBandwidth() const;
+
+    // The path of the Unix socket used to hand off the peers to a new process of the relay without
+    // dropping them (Linux only). The new process takes the sessions of the process that listens
+    // on the socket. If the path is empty, the handoff is disabled.
+    void setHandoffPath(const std::string& path);
+    std::string handoffPath() const;
+
+    // The address and the port of the HTTP listener that reports the metrics for Prometheus. If
+    // the port is 0, the listener is disabled.
+    void setMetricsAddress(const std::u16string& address);
+    std::u16string metricsAddress() const;
+    void setMetricsPort(uint16_t port);
+    uint16_t metricsPort() const;
+
     void setMinLogLevel(int level);
     int minLogLevel() const;
 
@@ -20,7 +20,10 @@
 
 #include "base/logging.h"
 
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 
 namespace relay {
 
@@ -37,13 +40,28 @@ public:
     void setKeyExpired(uint32_t key_id);
     std::optional<Key> key(uint32_t key_id, std::string_view peer_public_key) const;
     void clear();
+    std::vector<ExportedKey> exportKeys() const;
+    bool importKey(const ExportedKey& key);
+    size_t count() const;
 
 private:
+    // Keys are spread over several shards by their identifiers, so lookups of different keys
+    // from different threads do not wait for each other.
+    static const size_t kShardCount = 16;
+
+    struct Shard
+    {
+        mutable std::mutex lock;
+        std::unordered_map<uint32_t, std::shared_ptr<const SessionKey>> map;
+    };
+
+    Shard& shard(uint32_t key_id) { return shards_[key_id % kShardCount]; }
+    const Shard& shard(uint32_t key_id) const { return shards_[key_id % kShardCount]; }
+
     Delegate* delegate_;
 
-    mutable std::mutex pool_lock_;
-    std::map<uint32_t, SessionKey> map_;
-    uint32_t current_key_id_ = 0;
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<uint32_t> current_key_id_ { 0 };
 
     DISALLOW_COPY_AND_ASSIGN(Pool);
 };
@@ -61,10 +79,13 @@ void SharedPool::Pool::dettach()
 
 uint32_t SharedPool::Pool::addKey(SessionKey&& session_key)
 {
-    std::scoped_lock lock(pool_lock_);
+    uint32_t key_id = current_key_id_.fetch_add(1, std::memory_order_relaxed);
+    Shard& key_shard = shard(key_id);
 
-    uint32_t key_id = current_key_id_++;
-    map_.emplace(key_id, std::move(session_key));
+    {
+        std::scoped_lock lock(key_shard.lock);
+        key_shard.map.emplace(key_id, std::make_shared<const SessionKey>(std::move(session_key)));
+    }
 
     LOG(LS_INFO) << "Key with id " << key_id << " added to pool";
     return key_id;
@@ -72,18 +93,23 @@ uint32_t SharedPool::Pool::addKey(SessionKey&& session_key)
 
 bool SharedPool::Pool::removeKey(uint32_t key_id)
 {
-    std::scoped_lock lock(pool_lock_);
+    Shard& key_shard = shard(key_id);
+    std::shared_ptr<const SessionKey> session_key;
 
-    auto result = map_.find(key_id);
-    if (result != map_.end())
     {
-        map_.erase(result);
+        std::scoped_lock lock(key_shard.lock);
 
-        LOG(LS_INFO) << "Key with id " << key_id << " removed from pool";
-        return true;
+        auto result = key_shard.map.find(key_id);
+        if (result == key_shard.map.end())
+            return false;
+
+        // The key is destroyed outside the lock.
+        session_key = std::move(result->second);
+        key_shard.map.erase(result);
     }
 
-    return false;
+    LOG(LS_INFO) << "Key with id " << key_id << " removed from pool";
+    return true;
 }
 
 void SharedPool::Pool::setKeyExpired(uint32_t key_id)
@@ -100,22 +126,87 @@ void SharedPool::Pool::setKeyExpired(uint32_t key_id)
 std::optional<SharedPool::Key> SharedPool::Pool::key(
     uint32_t key_id, std::string_view peer_public_key) const
 {
-    std::scoped_lock lock(pool_lock_);
+    const Shard& key_shard = shard(key_id);
+    std::shared_ptr<const SessionKey> session_key;
+
+    {
+        std::scoped_lock lock(key_shard.lock);
 
-    auto result = map_.find(key_id);
-    if (result == map_.end())
-        return std::nullopt;
+        auto result = key_shard.map.find(key_id);
+        if (result == key_shard.map.end())
+            return std::nullopt;
 
-    const SessionKey& session_key = result->second;
-    return std::make_pair(session_key.sessionKey(peer_public_key), session_key.iv());
+        session_key = result->second;
+    }
+
+    // The key exchange is the expensive part of the lookup and does not need the lock. The key
+    // stays alive even if it is removed from the pool in the meantime.
+    return std::make_pair(session_key->sessionKey(peer_public_key), session_key->iv());
 }
 
 void SharedPool::Pool::clear()
 {
-    std::scoped_lock lock(pool_lock_);
-
     LOG(LS_INFO) << "Key pool cleared";
-    map_.clear();
+
+    for (auto& key_shard : shards_)
+    {
+        std::unordered_map<uint32_t, std::shared_ptr<const SessionKey>> map;
+
+        {
+            std::scoped_lock lock(key_shard.lock);
+            map.swap(key_shard.map);
+        }
+    }
+}
+
+std::vector<SharedPool::ExportedKey> SharedPool::Pool::exportKeys() const
+{
+    std::vector<ExportedKey> keys;
+
+    for (const auto& key_shard : shards_)
+    {
+        std::scoped_lock lock(key_shard.lock);
+
+        for (const auto& key : key_shard.map)
+            keys.push_back({ key.first, key.second->privateKey(), key.second->iv() });
+    }
+
+    return keys;
+}
+
+bool SharedPool::Pool::importKey(const ExportedKey& key)
+{
+    SessionKey session_key = SessionKey::fromPrivateKey(key.private_key, key.iv);
+    if (!session_key.isValid())
+        return false;
+
+    uint32_t current = current_key_id_.load(std::memory_order_relaxed);
+    while (current <= key.key_id &&
+           !current_key_id_.compare_exchange_weak(current, key.key_id + 1,
+                                                  std::memory_order_relaxed))
+    {
+        // Nothing
+    }
+
+    Shard& key_shard = shard(key.key_id);
+
+    std::scoped_lock lock(key_shard.lock);
+    key_shard.map.insert_or_assign(
+        key.key_id, std::make_shared<const SessionKey>(std::move(session_key)));
+    return true;
+}
+
+size_t SharedPool::Pool::count() const
+{
+    size_t count = 0;
+
+    for (const auto& key_shard : shards_)
+    {
+        std::scoped_lock lock(key_shard.lock);
+        count += key_shard.map.size();
+    }
+
+    return count;
 }
 
 SharedPool::SharedPool(Delegate* delegate)
@@ -169,4 +260,19 @@ void SharedPool::clear()
     pool_->clear();
 }
 
+size_t SharedPool::count() const
+{
+    return pool_->count();
+}
+
+std::vector<SharedPool::ExportedKey> SharedPool::exportKeys() const
+{
+    return pool_->exportKeys();
+}
+
+bool SharedPool::importKey(const ExportedKey& key)
+{
+    return pool_->importKey(key);
+}
+
 } // namespace relay
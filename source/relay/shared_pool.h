@@ -22,6 +22,7 @@
 #include "relay/session_key.h"
 
 #include <optional>
+#include <vector>
 
 namespace relay {
 
@@ -38,6 +39,14 @@ public:
 
     using Key = std::pair<base::ByteArray, base::ByteArray>;
 
+    // A key with its identifier. Used to pass the pool to the relay that replaces this one.
+    struct ExportedKey
+    {
+        uint32_t key_id;
+        base::ByteArray private_key;
+        base::ByteArray iv;
+    };
+
     explicit SharedPool(Delegate* delegate);
     ~SharedPool();
 
@@ -49,6 +58,15 @@ public:
     std::optional<Key> key(uint32_t key_id, std::string_view peer_public_key) const;
     void clear();
 
+    std::vector<ExportedKey> exportKeys() const;
+
+    // Adds a key with the identifier it had in the previous relay. The identifiers of the new keys
+    // are greater than it.
+    bool importKey(const ExportedKey& key);
+
+    // The number of keys in the pool.
+    size_t count() const;
+
 private:
     class Pool;
     explicit SharedPool(std::shared_ptr<Pool> pool);
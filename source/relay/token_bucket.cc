@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "relay/token_bucket.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace relay {
+
+TokenBucket::TokenBucket(int64_t rate, int64_t burst)
+    : rate_(static_cast<double>(rate)),
+      burst_(static_cast<double>(burst)),
+      tokens_(static_cast<double>(burst)),
+      last_time_(Clock::now())
+{
+    DCHECK_GT(rate, 0);
+    DCHECK_GT(burst, 0);
+}
+
+TokenBucket::~TokenBucket() = default;
+
+void TokenBucket::consume(int64_t bytes, const TimePoint& now)
+{
+    refill(now);
+    tokens_ -= static_cast<double>(bytes);
+}
+
+TokenBucket::Clock::duration TokenBucket::waitTime(const TimePoint& now)
+{
+    refill(now);
+
+    if (tokens_ >= 0)
+        return Clock::duration::zero();
+
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+void TokenBucket::refill(const TimePoint& now)
+{
+    if (now <= last_time_)
+        return;
+
+    const std::chrono::duration<double> elapsed = now - last_time_;
+    last_time_ = now;
+
+    tokens_ = std::min(tokens_ + elapsed.count() * rate_, burst_);
+}
+
+} // namespace relay
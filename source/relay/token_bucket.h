@@ -0,0 +1,59 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef RELAY__TOKEN_BUCKET_H
+#define RELAY__TOKEN_BUCKET_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace relay {
+
+// Limits the average rate of the traffic and allows short bursts. The data is counted after it
+// is read, so the bucket may go into debt. The next read waits until the debt is paid off.
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    // |rate| is in bytes per second. At most |burst| bytes can be read without waiting.
+    TokenBucket(int64_t rate, int64_t burst);
+    ~TokenBucket();
+
+    void consume(int64_t bytes, const TimePoint& now);
+
+    // Returns the time until the bucket is out of debt. Zero if it can be read now.
+    Clock::duration waitTime(const TimePoint& now);
+
+private:
+    void refill(const TimePoint& now);
+
+    const double rate_;
+    const double burst_;
+
+    double tokens_;
+    TimePoint last_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(TokenBucket);
+};
+
+} // namespace relay
+
+#endif // RELAY__TOKEN_BUCKET_H
@@ -22,6 +22,8 @@
 #include "base/peer/host_id.h"
 #include "base/peer/user_list.h"
 
+#include <optional>
+
 namespace router {
 
 class Database
@@ -29,6 +31,12 @@ class Database
 public:
     virtual ~Database() = default;
 
+    struct Host
+    {
+        base::ByteArray key_hash;
+        base::HostId host_id;
+    };
+
     virtual std::vector<base::User> userList() const = 0;
     virtual bool addUser(const base::User& user) = 0;
     virtual bool modifyUser(const base::User& user) = 0;
@@ -36,6 +44,9 @@ public:
     virtual base::User findUser(std::u16string_view username) = 0;
     virtual base::HostId hostId(const base::ByteArray& keyHash) const = 0;
     virtual bool addHost(const base::ByteArray& keyHash) = 0;
+
+    // Returns all the hosts or std::nullopt on error.
+    virtual std::optional<std::vector<Host>> hostList() const = 0;
 };
 
 } // namespace router
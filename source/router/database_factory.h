@@ -31,6 +31,9 @@ public:
     virtual ~DatabaseFactory() = default;
 
     virtual std::unique_ptr<Database> openDatabase() const = 0;
+
+    // Returns true if the database can be changed by other routers.
+    virtual bool isShared() const = 0;
 };
 
 } // namespace router
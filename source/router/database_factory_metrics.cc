@@ -0,0 +1,50 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_factory_metrics.h"
+
+#include "base/logging.h"
+#include "router/database_metrics.h"
+
+namespace router {
+
+DatabaseFactoryMetrics::DatabaseFactoryMetrics(std::shared_ptr<DatabaseFactory> factory,
+                                               std::shared_ptr<base::LatencyHistogram> histogram)
+    : factory_(std::move(factory)),
+      histogram_(std::move(histogram))
+{
+    DCHECK(factory_ && histogram_);
+}
+
+DatabaseFactoryMetrics::~DatabaseFactoryMetrics() = default;
+
+std::unique_ptr<Database> DatabaseFactoryMetrics::openDatabase() const
+{
+    std::unique_ptr<Database> database = factory_->openDatabase();
+    if (!database)
+        return nullptr;
+
+    return std::make_unique<DatabaseMetrics>(std::move(database), histogram_);
+}
+
+bool DatabaseFactoryMetrics::isShared() const
+{
+    return factory_->isShared();
+}
+
+} // namespace router
@@ -0,0 +1,42 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_factory_postgres.h"
+
+namespace router {
+
+DatabaseFactoryPostgres::DatabaseFactoryPostgres(
+    const std::string& connection_info, size_t max_connections)
+    : pool_(DatabasePostgres::createPool(connection_info, max_connections))
+{
+    // Nothing
+}
+
+DatabaseFactoryPostgres::~DatabaseFactoryPostgres() = default;
+
+std::unique_ptr<Database> DatabaseFactoryPostgres::openDatabase() const
+{
+    return DatabasePostgres::open(pool_);
+}
+
+bool DatabaseFactoryPostgres::isShared() const
+{
+    return true;
+}
+
+} // namespace router
@@ -0,0 +1,45 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__DATABASE_FACTORY_POSTGRES_H
+#define ROUTER__DATABASE_FACTORY_POSTGRES_H
+
+#include "base/macros_magic.h"
+#include "router/database_factory.h"
+#include "router/database_postgres.h"
+
+namespace router {
+
+class DatabaseFactoryPostgres : public DatabaseFactory
+{
+public:
+    DatabaseFactoryPostgres(const std::string& connection_info, size_t max_connections);
+    ~DatabaseFactoryPostgres();
+
+    std::unique_ptr<Database> openDatabase() const override;
+    bool isShared() const override;
+
+private:
+    std::shared_ptr<DatabasePostgres::ConnectionPool> pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseFactoryPostgres);
+};
+
+} // namespace router
+
+#endif // ROUTER__DATABASE_FACTORY_POSTGRES_H
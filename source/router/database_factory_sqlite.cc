@@ -31,4 +31,9 @@ std::unique_ptr<Database> DatabaseFactorySqlite::openDatabase() const
     return DatabaseSqlite::open();
 }
 
+bool DatabaseFactorySqlite::isShared() const
+{
+    return false;
+}
+
 } // namespace router
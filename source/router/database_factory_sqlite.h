@@ -31,6 +31,7 @@ public:
     ~DatabaseFactorySqlite();
 
     std::unique_ptr<Database> openDatabase() const override;
+    bool isShared() const override;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(DatabaseFactorySqlite);
@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_metrics.h"
+
+#include "base/latency_histogram.h"
+#include "base/logging.h"
+
+namespace router {
+
+DatabaseMetrics::DatabaseMetrics(std::unique_ptr<Database> database,
+                                 std::shared_ptr<base::LatencyHistogram> histogram)
+    : database_(std::move(database)),
+      histogram_(std::move(histogram))
+{
+    DCHECK(database_ && histogram_);
+}
+
+DatabaseMetrics::~DatabaseMetrics() = default;
+
+template <class Query>
+auto DatabaseMetrics::measure(Query query) const
+{
+    const auto start_time = std::chrono::steady_clock::now();
+    auto result = query();
+    histogram_->add(std::chrono::steady_clock::now() - start_time);
+    return result;
+}
+
+std::vector<base::User> DatabaseMetrics::userList() const
+{
+    return measure([this]() { return database_->userList(); });
+}
+
+bool DatabaseMetrics::addUser(const base::User& user)
+{
+    return measure([&]() { return database_->addUser(user); });
+}
+
+bool DatabaseMetrics::modifyUser(const base::User& user)
+{
+    return measure([&]() { return database_->modifyUser(user); });
+}
+
+bool DatabaseMetrics::removeUser(int64_t entry_id)
+{
+    return measure([&]() { return database_->removeUser(entry_id); });
+}
+
+base::User DatabaseMetrics::findUser(std::u16string_view username)
+{
+    return measure([&]() { return database_->findUser(username); });
+}
+
+base::HostId DatabaseMetrics::hostId(const base::ByteArray& keyHash) const
+{
+    return measure([&]() { return database_->hostId(keyHash); });
+}
+
+bool DatabaseMetrics::addHost(const base::ByteArray& keyHash)
+{
+    return measure([&]() { return database_->addHost(keyHash); });
+}
+
+std::optional<std::vector<Database::Host>> DatabaseMetrics::hostList() const
+{
+    return measure([this]() { return database_->hostList(); });
+}
+
+} // namespace router
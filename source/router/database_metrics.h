@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__DATABASE_METRICS_H
+#define ROUTER__DATABASE_METRICS_H
+
+#include "base/macros_magic.h"
+#include "router/database.h"
+
+#include <memory>
+
+namespace base {
+class LatencyHistogram;
+} // namespace base
+
+namespace router {
+
+// Passes the queries to another database and adds the duration of each query to the histogram.
+class DatabaseMetrics : public Database
+{
+public:
+    DatabaseMetrics(std::unique_ptr<Database> database,
+                    std::shared_ptr<base::LatencyHistogram> histogram);
+    ~DatabaseMetrics();
+
+    // Database implementation.
+    std::vector<base::User> userList() const override;
+    bool addUser(const base::User& user) override;
+    bool modifyUser(const base::User& user) override;
+    bool removeUser(int64_t entry_id) override;
+    base::User findUser(std::u16string_view username) override;
+    base::HostId hostId(const base::ByteArray& keyHash) const override;
+    bool addHost(const base::ByteArray& keyHash) override;
+    std::optional<std::vector<Host>> hostList() const override;
+
+private:
+    template <class Query>
+    auto measure(Query query) const;
+
+    std::unique_ptr<Database> database_;
+    std::shared_ptr<base::LatencyHistogram> histogram_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseMetrics);
+};
+
+} // namespace router
+
+#endif // ROUTER__DATABASE_METRICS_H
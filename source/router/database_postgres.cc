@@ -0,0 +1,576 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_postgres.h"
+
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace router {
+
+namespace {
+
+// How long a thread waits for a free connection when all connections of the pool are in use.
+constexpr std::chrono::seconds kAcquireTimeout { 10 };
+
+const char kCreateTablesQuery[] =
+    "CREATE TABLE IF NOT EXISTS users ("
+    "id BIGSERIAL PRIMARY KEY, "
+    "name TEXT NOT NULL UNIQUE, "
+    "\"group\" TEXT NOT NULL, "
+    "salt BYTEA NOT NULL, "
+    "verifier BYTEA NOT NULL, "
+    "sessions INTEGER DEFAULT 0, "
+    "flags INTEGER DEFAULT 0); "
+    "CREATE TABLE IF NOT EXISTS hosts ("
+    "id BIGSERIAL PRIMARY KEY, "
+    "key BYTEA NOT NULL UNIQUE)";
+
+const char kUserColumns[] = "id, name, \"group\", salt, verifier, sessions, flags";
+
+struct ResultDeleter
+{
+    void operator()(PGresult* result) const { PQclear(result); }
+};
+
+using ScopedResult = std::unique_ptr<PGresult, ResultDeleter>;
+
+// Parameters of a query. The text and the numbers are passed in text format, the blobs are
+// passed in binary format.
+class QueryParams
+{
+public:
+    QueryParams() = default;
+
+    void addText(const std::string& text)
+    {
+        add(text.data(), text.size(), 0);
+    }
+
+    void addBlob(const base::ByteArray& blob)
+    {
+        add(reinterpret_cast<const char*>(blob.data()), blob.size(), 1);
+    }
+
+    void addInt64(int64_t number)
+    {
+        storage_.emplace_back(std::to_string(number));
+        addText(storage_.back());
+    }
+
+    int count() const { return static_cast<int>(values_.size()); }
+    const char* const* values() const { return values_.data(); }
+    const int* lengths() const { return lengths_.data(); }
+    const int* formats() const { return formats_.data(); }
+
+private:
+    void add(const char* value, size_t length, int format)
+    {
+        values_.emplace_back(value);
+        lengths_.emplace_back(static_cast<int>(length));
+        formats_.emplace_back(format);
+    }
+
+    // Keeps the text of the numbers. A deque does not move its elements when it grows.
+    std::deque<std::string> storage_;
+
+    std::vector<const char*> values_;
+    std::vector<int> lengths_;
+    std::vector<int> formats_;
+
+    DISALLOW_COPY_AND_ASSIGN(QueryParams);
+};
+
+// Executes |query| and returns the results in binary format. Returns nullptr if the status of
+// the result is not |expected_status|.
+ScopedResult execute(PGconn* connection,
+                     const char* query,
+                     const QueryParams& params,
+                     ExecStatusType expected_status)
+{
+    ScopedResult result(PQexecParams(connection, query, params.count(), nullptr,
+                                     params.values(), params.lengths(), params.formats(), 1));
+    if (!result)
+    {
+        LOG(LS_ERROR) << "PQexecParams failed: " << PQerrorMessage(connection);
+        return nullptr;
+    }
+
+    if (PQresultStatus(result.get()) != expected_status)
+    {
+        LOG(LS_ERROR) << "Query failed: " << PQresultErrorMessage(result.get());
+        return nullptr;
+    }
+
+    return result;
+}
+
+std::optional<int64_t> readInteger(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+        return std::nullopt;
+
+    // Numbers in binary format are in network byte order.
+    const int length = PQgetlength(result, row, column);
+    if (length != 2 && length != 4 && length != 8)
+        return std::nullopt;
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(PQgetvalue(result, row, column));
+
+    uint64_t value = (data[0] & 0x80) ? ~0ULL : 0ULL;
+    for (int i = 0; i < length; ++i)
+        value = (value << 8) | data[i];
+
+    return static_cast<int64_t>(value);
+}
+
+std::optional<base::ByteArray> readBlob(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+        return std::nullopt;
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(PQgetvalue(result, row, column));
+    return base::ByteArray(data, data + PQgetlength(result, row, column));
+}
+
+std::optional<std::string> readText(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+        return std::nullopt;
+
+    return std::string(PQgetvalue(result, row, column), PQgetlength(result, row, column));
+}
+
+std::optional<base::User> readUser(const PGresult* result, int row)
+{
+    std::optional<int64_t> entry_id = readInteger(result, row, 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> name = readText(result, row, 1);
+    if (!name.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'name'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> group = readText(result, row, 2);
+    if (!group.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'group'";
+        return std::nullopt;
+    }
+
+    std::optional<base::ByteArray> salt = readBlob(result, row, 3);
+    if (!salt.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'salt'";
+        return std::nullopt;
+    }
+
+    std::optional<base::ByteArray> verifier = readBlob(result, row, 4);
+    if (!verifier.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'verifier'";
+        return std::nullopt;
+    }
+
+    std::optional<int64_t> sessions = readInteger(result, row, 5);
+    if (!sessions.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'sessions'";
+        return std::nullopt;
+    }
+
+    std::optional<int64_t> flags = readInteger(result, row, 6);
+    if (!flags.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'flags'";
+        return std::nullopt;
+    }
+
+    base::User user;
+
+    user.entry_id  = entry_id.value();
+    user.name      = base::utf16FromUtf8(name.value());
+    user.group     = std::move(group.value());
+    user.salt      = std::move(salt.value());
+    user.verifier  = std::move(verifier.value());
+    user.sessions  = static_cast<uint32_t>(sessions.value());
+    user.flags     = static_cast<uint32_t>(flags.value());
+
+    return user;
+}
+
+} // namespace
+
+// Connections shared by the threads of the router. A connection is used by one thread at a time.
+class DatabasePostgres::ConnectionPool
+{
+public:
+    ConnectionPool(const std::string& connection_info, size_t max_connections);
+    ~ConnectionPool();
+
+    PGconn* acquire();
+    void release(PGconn* connection);
+
+private:
+    PGconn* connect();
+
+    const std::string connection_info_;
+    const size_t max_connections_;
+
+    std::mutex lock_;
+    std::condition_variable free_condition_;
+    std::vector<PGconn*> free_;
+
+    // Number of the connections including those in use.
+    size_t count_ = 0;
+    bool tables_created_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ConnectionPool);
+};
+
+DatabasePostgres::ConnectionPool::ConnectionPool(
+    const std::string& connection_info, size_t max_connections)
+    : connection_info_(connection_info),
+      max_connections_(std::max(max_connections, size_t(1)))
+{
+    // Nothing
+}
+
+DatabasePostgres::ConnectionPool::~ConnectionPool()
+{
+    DCHECK_EQ(free_.size(), count_);
+
+    for (auto& connection : free_)
+        PQfinish(connection);
+}
+
+PGconn* DatabasePostgres::ConnectionPool::acquire()
+{
+    {
+        std::unique_lock lock(lock_);
+
+        bool has_free = free_condition_.wait_for(lock, kAcquireTimeout, [this]()
+        {
+            return !free_.empty() || count_ < max_connections_;
+        });
+
+        if (!has_free)
+        {
+            LOG(LS_ERROR) << "No free database connections (" << count_ << " in use)";
+            return nullptr;
+        }
+
+        if (!free_.empty())
+        {
+            PGconn* connection = free_.back();
+            free_.pop_back();
+            return connection;
+        }
+
+        // The place in the pool is reserved for the new connection.
+        ++count_;
+    }
+
+    PGconn* connection = connect();
+    if (!connection)
+    {
+        std::scoped_lock lock(lock_);
+        --count_;
+        free_condition_.notify_one();
+    }
+
+    return connection;
+}
+
+void DatabasePostgres::ConnectionPool::release(PGconn* connection)
+{
+    DCHECK(connection);
+
+    // A broken connection is closed, the next thread establishes a new one.
+    if (PQstatus(connection) != CONNECTION_OK ||
+        PQtransactionStatus(connection) != PQTRANS_IDLE)
+    {
+        PQfinish(connection);
+        connection = nullptr;
+    }
+
+    std::scoped_lock lock(lock_);
+
+    if (connection)
+        free_.emplace_back(connection);
+    else
+        --count_;
+
+    free_condition_.notify_one();
+}
+
+PGconn* DatabasePostgres::ConnectionPool::connect()
+{
+    PGconn* connection = PQconnectdb(connection_info_.c_str());
+    if (!connection)
+    {
+        LOG(LS_ERROR) << "PQconnectdb failed";
+        return nullptr;
+    }
+
+    if (PQstatus(connection) != CONNECTION_OK)
+    {
+        LOG(LS_ERROR) << "Failed to connect to database: " << PQerrorMessage(connection);
+        PQfinish(connection);
+        return nullptr;
+    }
+
+    std::scoped_lock lock(lock_);
+
+    if (!tables_created_)
+    {
+        ScopedResult result(PQexec(connection, kCreateTablesQuery));
+        if (PQresultStatus(result.get()) != PGRES_COMMAND_OK)
+        {
+            LOG(LS_ERROR) << "Failed to create tables: " << PQresultErrorMessage(result.get());
+            PQfinish(connection);
+            return nullptr;
+        }
+
+        tables_created_ = true;
+    }
+
+    return connection;
+}
+
+DatabasePostgres::DatabasePostgres(std::shared_ptr<ConnectionPool> pool, PGconn* connection)
+    : pool_(std::move(pool)),
+      connection_(connection)
+{
+    DCHECK(pool_ && connection_);
+}
+
+DatabasePostgres::~DatabasePostgres()
+{
+    pool_->release(connection_);
+}
+
+// static
+std::shared_ptr<DatabasePostgres::ConnectionPool> DatabasePostgres::createPool(
+    const std::string& connection_info, size_t max_connections)
+{
+    return std::make_shared<ConnectionPool>(connection_info, max_connections);
+}
+
+// static
+std::unique_ptr<DatabasePostgres> DatabasePostgres::open(std::shared_ptr<ConnectionPool> pool)
+{
+    DCHECK(pool);
+
+    PGconn* connection = pool->acquire();
+    if (!connection)
+        return nullptr;
+
+    return std::unique_ptr<DatabasePostgres>(new DatabasePostgres(std::move(pool), connection));
+}
+
+std::vector<base::User> DatabasePostgres::userList() const
+{
+    static const std::string kQuery = std::string("SELECT ") + kUserColumns + " FROM users";
+
+    ScopedResult result = execute(connection_, kQuery.c_str(), QueryParams(), PGRES_TUPLES_OK);
+    if (!result)
+        return std::vector<base::User>();
+
+    const int count = PQntuples(result.get());
+
+    std::vector<base::User> users;
+    users.reserve(static_cast<size_t>(count));
+
+    for (int row = 0; row < count; ++row)
+    {
+        std::optional<base::User> user = readUser(result.get(), row);
+        if (user.has_value())
+            users.emplace_back(std::move(user.value()));
+    }
+
+    return users;
+}
+
+bool DatabasePostgres::addUser(const base::User& user)
+{
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Not valid user";
+        return false;
+    }
+
+    static const char kQuery[] =
+        "INSERT INTO users (name, \"group\", salt, verifier, sessions, flags) "
+        "VALUES ($1, $2, $3, $4, $5, $6)";
+
+    std::string username = base::utf8FromUtf16(user.name);
+
+    QueryParams params;
+    params.addText(username);
+    params.addText(user.group);
+    params.addBlob(user.salt);
+    params.addBlob(user.verifier);
+    params.addInt64(static_cast<int>(user.sessions));
+    params.addInt64(static_cast<int>(user.flags));
+
+    return execute(connection_, kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+bool DatabasePostgres::modifyUser(const base::User& user)
+{
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Not valid user";
+        return false;
+    }
+
+    static const char kQuery[] =
+        "UPDATE users SET (name, \"group\", salt, verifier, sessions, flags) = "
+        "($1, $2, $3, $4, $5, $6) WHERE id=$7";
+
+    std::string username = base::utf8FromUtf16(user.name);
+
+    QueryParams params;
+    params.addText(username);
+    params.addText(user.group);
+    params.addBlob(user.salt);
+    params.addBlob(user.verifier);
+    params.addInt64(static_cast<int>(user.sessions));
+    params.addInt64(static_cast<int>(user.flags));
+    params.addInt64(user.entry_id);
+
+    return execute(connection_, kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+bool DatabasePostgres::removeUser(int64_t entry_id)
+{
+    static const char kQuery[] = "DELETE FROM users WHERE id=$1";
+
+    QueryParams params;
+    params.addInt64(entry_id);
+
+    return execute(connection_, kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+base::User DatabasePostgres::findUser(std::u16string_view username)
+{
+    static const std::string kQuery =
+        std::string("SELECT ") + kUserColumns + " FROM users WHERE name=$1";
+
+    std::string username_utf8 = base::utf8FromUtf16(username);
+
+    QueryParams params;
+    params.addText(username_utf8);
+
+    ScopedResult result = execute(connection_, kQuery.c_str(), params, PGRES_TUPLES_OK);
+    if (!result || PQntuples(result.get()) < 1)
+        return base::User::kInvalidUser;
+
+    return readUser(result.get(), 0).value_or(base::User::kInvalidUser);
+}
+
+base::HostId DatabasePostgres::hostId(const base::ByteArray& keyHash) const
+{
+    if (keyHash.empty())
+    {
+        LOG(LS_ERROR) << "Invalid parameters";
+        return base::kInvalidHostId;
+    }
+
+    static const char kQuery[] = "SELECT id FROM hosts WHERE key=$1";
+
+    QueryParams params;
+    params.addBlob(keyHash);
+
+    ScopedResult result = execute(connection_, kQuery, params, PGRES_TUPLES_OK);
+    if (!result || PQntuples(result.get()) < 1)
+        return base::kInvalidHostId;
+
+    std::optional<int64_t> entry_id = readInteger(result.get(), 0, 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return base::kInvalidHostId;
+    }
+
+    return entry_id.value();
+}
+
+bool DatabasePostgres::addHost(const base::ByteArray& keyHash)
+{
+    if (keyHash.empty())
+    {
+        LOG(LS_ERROR) << "Invalid parameters";
+        return false;
+    }
+
+    // Another router may add the same host at the same time. Then the host gets the ID added by
+    // it.
+    static const char kQuery[] = "INSERT INTO hosts (key) VALUES ($1) ON CONFLICT (key) DO NOTHING";
+
+    QueryParams params;
+    params.addBlob(keyHash);
+
+    return execute(connection_, kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+std::optional<std::vector<Database::Host>> DatabasePostgres::hostList() const
+{
+    static const char kQuery[] = "SELECT id, key FROM hosts";
+
+    ScopedResult result = execute(connection_, kQuery, QueryParams(), PGRES_TUPLES_OK);
+    if (!result)
+        return std::nullopt;
+
+    const int count = PQntuples(result.get());
+
+    std::vector<Host> hosts;
+    hosts.reserve(static_cast<size_t>(count));
+
+    for (int row = 0; row < count; ++row)
+    {
+        std::optional<int64_t> entry_id = readInteger(result.get(), row, 0);
+        std::optional<base::ByteArray> key_hash = readBlob(result.get(), row, 1);
+
+        if (!entry_id.has_value() || !key_hash.has_value())
+        {
+            LOG(LS_ERROR) << "Failed to get fields of the host";
+            continue;
+        }
+
+        hosts.push_back(
+            { std::move(key_hash.value()), static_cast<base::HostId>(entry_id.value()) });
+    }
+
+    return hosts;
+}
+
+} // namespace router
@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__DATABASE_POSTGRES_H
+#define ROUTER__DATABASE_POSTGRES_H
+
+#include "base/macros_magic.h"
+#include "router/database.h"
+
+#include <memory>
+
+#include <libpq-fe.h>
+
+namespace router {
+
+// Database on a PostgreSQL server. Several routers can use the same server and share the users
+// and the host IDs. The object holds a connection taken from the pool and returns it to the pool
+// when destroyed.
+class DatabasePostgres : public Database
+{
+public:
+    class ConnectionPool;
+
+    ~DatabasePostgres();
+
+    // Creates a pool of up to |max_connections| connections with the parameters |connection_info|
+    // (see the libpq documentation). The connections are established on demand.
+    static std::shared_ptr<ConnectionPool> createPool(const std::string& connection_info,
+                                                      size_t max_connections);
+
+    // Takes a connection from |pool|. Waits when all connections are in use. Returns nullptr if
+    // there is no free connection after the timeout or it is not possible to connect.
+    static std::unique_ptr<DatabasePostgres> open(std::shared_ptr<ConnectionPool> pool);
+
+    // Database implementation.
+    std::vector<base::User> userList() const override;
+    bool addUser(const base::User& user) override;
+    bool modifyUser(const base::User& user) override;
+    bool removeUser(int64_t entry_id) override;
+    base::User findUser(std::u16string_view username) override;
+    base::HostId hostId(const base::ByteArray& keyHash) const override;
+    bool addHost(const base::ByteArray& keyHash) override;
+    std::optional<std::vector<Host>> hostList() const override;
+
+private:
+    DatabasePostgres(std::shared_ptr<ConnectionPool> pool, PGconn* connection);
+
+    std::shared_ptr<ConnectionPool> pool_;
+    PGconn* connection_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabasePostgres);
+};
+
+} // namespace router
+
+#endif // ROUTER__DATABASE_POSTGRES_H
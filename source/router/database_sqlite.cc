@@ -24,6 +24,7 @@
 #include "build/build_config.h"
 
 #include <optional>
+#include <unordered_map>
 
 namespace router {
 
@@ -220,21 +221,89 @@ std::optional<base::User> readUser(sqlite3_stmt* statement)
     return user;
 }
 
+// Resets the cached statement when the query is completed. The statement does not hold the read
+// lock of the database after it and can be used by the next query.
+class ScopedStatement
+{
+public:
+    explicit ScopedStatement(sqlite3_stmt* statement)
+        : statement_(statement)
+    {
+        // Nothing
+    }
+
+    ~ScopedStatement()
+    {
+        if (!statement_)
+            return;
+
+        sqlite3_reset(statement_);
+        sqlite3_clear_bindings(statement_);
+    }
+
+    sqlite3_stmt* get() const { return statement_; }
+    explicit operator bool() const { return statement_ != nullptr; }
+
+private:
+    sqlite3_stmt* statement_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedStatement);
+};
+
+void executeQuery(sqlite3* db, const char* query)
+{
+    char* error_message = nullptr;
+
+    int error_code = sqlite3_exec(db, query, nullptr, nullptr, &error_message);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_WARNING) << "sqlite3_exec failed: " << sqlite3_errstr(error_code) << " ("
+                        << (error_message ? error_message : "") << ", query: " << query << ")";
+    }
+
+    sqlite3_free(error_message);
+}
+
 } // namespace
 
-DatabaseSqlite::DatabaseSqlite(sqlite3* db)
+// Connection of a thread to the database with the statements prepared on it. A connection is
+// never used by several threads at once.
+class DatabaseSqlite::Connection
+{
+public:
+    ~Connection();
+
+    static std::shared_ptr<Connection> open();
+
+    // Returns the statement for |query| prepared once per connection. |query| must be a string
+    // constant, its address is the key of the cache. Returns nullptr on error.
+    sqlite3_stmt* statement(const char* query);
+
+private:
+    explicit Connection(sqlite3* db);
+
+    sqlite3* db_;
+    std::unordered_map<const char*, sqlite3_stmt*> statements_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+DatabaseSqlite::Connection::Connection(sqlite3* db)
     : db_(db)
 {
     DCHECK(db_);
 }
 
-DatabaseSqlite::~DatabaseSqlite()
+DatabaseSqlite::Connection::~Connection()
 {
+    for (const auto& statement : statements_)
+        sqlite3_finalize(statement.second);
+
     sqlite3_close(db_);
 }
 
 // static
-std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open()
+std::shared_ptr<DatabaseSqlite::Connection> DatabaseSqlite::Connection::open()
 {
     std::filesystem::path file_path = filePath();
     if (file_path.empty())
@@ -252,10 +321,66 @@ std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open()
     if (error_code != SQLITE_OK)
     {
         LOG(LS_WARNING) << "sqlite3_open failed: " << sqlite3_errstr(error_code);
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // The threads of the router have their own connections. A writer waits for the others
+    // instead of failing with SQLITE_BUSY.
+    static const int kBusyTimeoutMs = 5000;
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+
+    // In WAL mode the readers do not block the writer. A commit appends to the log and does not
+    // wait for fsync, the log is synced at checkpoints.
+    executeQuery(db, "PRAGMA journal_mode=WAL");
+    executeQuery(db, "PRAGMA synchronous=NORMAL");
+
+    return std::shared_ptr<Connection>(new Connection(db));
+}
+
+sqlite3_stmt* DatabaseSqlite::Connection::statement(const char* query)
+{
+    auto result = statements_.find(query);
+    if (result != statements_.end())
+        return result->second;
+
+    sqlite3_stmt* statement = nullptr;
+
+    int error_code = sqlite3_prepare_v3(
+        db_, query, -1, SQLITE_PREPARE_PERSISTENT, &statement, nullptr);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code);
         return nullptr;
     }
 
-    return std::unique_ptr<DatabaseSqlite>(new DatabaseSqlite(db));
+    statements_.emplace(query, statement);
+    return statement;
+}
+
+DatabaseSqlite::DatabaseSqlite(std::shared_ptr<Connection> connection)
+    : connection_(std::move(connection))
+{
+    DCHECK(connection_);
+}
+
+DatabaseSqlite::~DatabaseSqlite() = default;
+
+// static
+std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open()
+{
+    // The connection of the thread is kept until the thread exits. The next calls on the thread
+    // reuse it together with its prepared statements.
+    thread_local std::shared_ptr<Connection> connection;
+
+    if (!connection)
+    {
+        connection = Connection::open();
+        if (!connection)
+            return nullptr;
+    }
+
+    return std::unique_ptr<DatabaseSqlite>(new DatabaseSqlite(connection));
 }
 
 // static
@@ -280,28 +405,23 @@ std::filesystem::path DatabaseSqlite::filePath()
 
 std::vector<base::User> DatabaseSqlite::userList() const
 {
-    const char kQuery[] = "SELECT * FROM users";
+    static const char kQuery[] = "SELECT * FROM users";
 
-    sqlite3_stmt* statement;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
-    {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
         return std::vector<base::User>();
-    }
 
     std::vector<base::User> users;
     for (;;)
     {
-        if (sqlite3_step(statement) != SQLITE_ROW)
+        if (sqlite3_step(statement.get()) != SQLITE_ROW)
             break;
 
-        std::optional<base::User> user = readUser(statement);
+        std::optional<base::User> user = readUser(statement.get());
         if (user.has_value())
             users.emplace_back(std::move(user.value()));
     }
 
-    sqlite3_finalize(statement);
     return users;
 }
 
@@ -317,50 +437,38 @@ bool DatabaseSqlite::addUser(const base::User& user)
         "INSERT INTO users ('id', 'name', 'group', 'salt', 'verifier', 'sessions', 'flags') "
         "VALUES (NULL, ?, ?, ?, ?, ?, ?)";
 
-    sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
-    {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
         return false;
-    }
 
     std::string username = base::utf8FromUtf16(user.name);
-    bool result = false;
 
-    do
-    {
-        if (!writeText(statement, username, 1))
-            break;
-
-        if (!writeText(statement, user.group, 2))
-            break;
+    if (!writeText(statement.get(), username, 1))
+        return false;
 
-        if (!writeBlob(statement, user.salt, 3))
-            break;
+    if (!writeText(statement.get(), user.group, 2))
+        return false;
 
-        if (!writeBlob(statement, user.verifier, 4))
-            break;
+    if (!writeBlob(statement.get(), user.salt, 3))
+        return false;
 
-        if (!writeInt(statement, static_cast<int>(user.sessions), 5))
-            break;
+    if (!writeBlob(statement.get(), user.verifier, 4))
+        return false;
 
-        if (!writeInt(statement, static_cast<int>(user.flags), 6))
-            break;
+    if (!writeInt(statement.get(), static_cast<int>(user.sessions), 5))
+        return false;
 
-        error_code = sqlite3_step(statement);
-        if (error_code != SQLITE_DONE)
-        {
-            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
-            break;
-        }
+    if (!writeInt(statement.get(), static_cast<int>(user.flags), 6))
+        return false;
 
-        result = true;
+    int error_code = sqlite3_step(statement.get());
+    if (error_code != SQLITE_DONE)
+    {
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
+        return false;
     }
-    while (false);
 
-    sqlite3_finalize(statement);
-    return result;
+    return true;
 }
 
 bool DatabaseSqlite::modifyUser(const base::User& user)
@@ -375,118 +483,81 @@ bool DatabaseSqlite::modifyUser(const base::User& user)
         "UPDATE users SET ('name', 'group', 'salt', 'verifier', 'sessions', 'flags') = "
         "(?, ?, ?, ?, ?, ?) WHERE id=?";
 
-    sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
-    {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
         return false;
-    }
 
     std::string username = base::utf8FromUtf16(user.name);
-    bool result = false;
 
-    do
-    {
-        if (!writeText(statement, username, 1))
-            break;
-
-        if (!writeText(statement, user.group, 2))
-            break;
+    if (!writeText(statement.get(), username, 1))
+        return false;
 
-        if (!writeBlob(statement, user.salt, 3))
-            break;
+    if (!writeText(statement.get(), user.group, 2))
+        return false;
 
-        if (!writeBlob(statement, user.verifier, 4))
-            break;
+    if (!writeBlob(statement.get(), user.salt, 3))
+        return false;
 
-        if (!writeInt(statement, static_cast<int>(user.sessions), 5))
-            break;
+    if (!writeBlob(statement.get(), user.verifier, 4))
+        return false;
 
-        if (!writeInt(statement, static_cast<int>(user.flags), 6))
-            break;
+    if (!writeInt(statement.get(), static_cast<int>(user.sessions), 5))
+        return false;
 
-        if (!writeInt64(statement, user.entry_id, 7))
-            break;
+    if (!writeInt(statement.get(), static_cast<int>(user.flags), 6))
+        return false;
 
-        error_code = sqlite3_step(statement);
-        if (error_code != SQLITE_DONE)
-        {
-            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
-            break;
-        }
+    if (!writeInt64(statement.get(), user.entry_id, 7))
+        return false;
 
-        result = true;
+    int error_code = sqlite3_step(statement.get());
+    if (error_code != SQLITE_DONE)
+    {
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
+        return false;
     }
-    while (false);
 
-    sqlite3_finalize(statement);
-    return result;
+    return true;
 }
 
 bool DatabaseSqlite::removeUser(int64_t entry_id)
 {
     static const char kQuery[] = "DELETE FROM users WHERE id=?";
 
-    sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
-    {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
         return false;
-    }
 
-    bool result = false;
+    if (!writeInt64(statement.get(), entry_id, 1))
+        return false;
 
-    do
+    int error_code = sqlite3_step(statement.get());
+    if (error_code != SQLITE_DONE)
     {
-        if (!writeInt64(statement, entry_id, 1))
-            break;
-
-        error_code = sqlite3_step(statement);
-        if (error_code != SQLITE_DONE)
-        {
-            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
-            break;
-        }
-
-        result = true;
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
+        return false;
     }
-    while (false);
 
-    sqlite3_finalize(statement);
-    return result;
+    return true;
 }
 
 base::User DatabaseSqlite::findUser(std::u16string_view username)
 {
-    const char kQuery[] = "SELECT * FROM users WHERE name=?";
+    static const char kQuery[] = "SELECT * FROM users WHERE name=?";
 
-    sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
-    {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
         return base::User::kInvalidUser;
-    }
 
     std::string username_utf8 = base::utf8FromUtf16(username);
-    std::optional<base::User> user;
-
-    do
-    {
-        if (!writeText(statement, username_utf8, 1))
-            break;
 
-        if (sqlite3_step(statement) != SQLITE_ROW)
-            break;
+    if (!writeText(statement.get(), username_utf8, 1))
+        return base::User::kInvalidUser;
 
-        user = readUser(statement);
-    }
-    while (false);
+    if (sqlite3_step(statement.get()) != SQLITE_ROW)
+        return base::User::kInvalidUser;
 
-    sqlite3_finalize(statement);
-    return user.value_or(base::User::kInvalidUser);
+    return readUser(statement.get()).value_or(base::User::kInvalidUser);
 }
 
 base::HostId DatabaseSqlite::hostId(const base::ByteArray& keyHash) const
@@ -497,42 +568,30 @@ base::HostId DatabaseSqlite::hostId(const base::ByteArray& keyHash) const
         return base::kInvalidHostId;
     }
 
-    const char kQuery[] = "SELECT * FROM hosts WHERE key=?";
+    static const char kQuery[] = "SELECT id FROM hosts WHERE key=?";
 
-    sqlite3_stmt* statement;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
-    {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
         return base::kInvalidHostId;
-    }
 
-    base::HostId result = base::kInvalidHostId;
+    if (!writeBlob(statement.get(), keyHash, 1))
+        return base::kInvalidHostId;
 
-    do
+    int error_code = sqlite3_step(statement.get());
+    if (error_code != SQLITE_ROW)
     {
-        if (!writeBlob(statement, keyHash, 1))
-            break;
-
-        if (sqlite3_step(statement) != SQLITE_ROW)
-        {
-            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
-            break;
-        }
-
-        std::optional<int64_t> entry_id = readInteger<int64_t>(statement, 0);
-        if (!entry_id.has_value())
-        {
-            LOG(LS_ERROR) << "Failed to get field 'id'";
-            break;
-        }
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
+        return base::kInvalidHostId;
+    }
 
-        result = entry_id.value();
+    std::optional<int64_t> entry_id = readInteger<int64_t>(statement.get(), 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return base::kInvalidHostId;
     }
-    while (false);
 
-    sqlite3_finalize(statement);
-    return result;
+    return entry_id.value();
 }
 
 bool DatabaseSqlite::addHost(const base::ByteArray& keyHash)
@@ -543,37 +602,61 @@ bool DatabaseSqlite::addHost(const base::ByteArray& keyHash)
         return false;
     }
 
-    const char kQuery[] = "INSERT INTO hosts ('id', 'key') VALUES (NULL, ?)";
+    static const char kQuery[] = "INSERT INTO hosts ('id', 'key') VALUES (NULL, ?)";
 
-    sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
-    if (error_code != SQLITE_OK)
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
+        return false;
+
+    if (!writeBlob(statement.get(), keyHash, 1))
+        return false;
+
+    int error_code = sqlite3_step(statement.get());
+    if (error_code != SQLITE_DONE)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
         return false;
     }
 
-    bool result = false;
+    return true;
+}
 
-    do
+std::optional<std::vector<Database::Host>> DatabaseSqlite::hostList() const
+{
+    static const char kQuery[] = "SELECT id, key FROM hosts";
+
+    ScopedStatement statement(connection_->statement(kQuery));
+    if (!statement)
+        return std::nullopt;
+
+    std::vector<Host> hosts;
+    for (;;)
     {
-        if (!writeBlob(statement, keyHash, 1))
+        int error_code = sqlite3_step(statement.get());
+        if (error_code == SQLITE_DONE)
             break;
 
-        error_code = sqlite3_step(statement);
-        if (error_code != SQLITE_DONE)
+        if (error_code != SQLITE_ROW)
         {
-            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
-                          << " (" << error_code << ")";
-            break;
+            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code);
+            return std::nullopt;
+        }
+
+        std::optional<int64_t> entry_id = readInteger<int64_t>(statement.get(), 0);
+        std::optional<base::ByteArray> key_hash = readBlob(statement.get(), 1);
+
+        if (!entry_id.has_value() || !key_hash.has_value())
+        {
+            LOG(LS_ERROR) << "Failed to get fields of the host";
+            continue;
         }
 
-        result = true;
+        hosts.push_back(
+            { std::move(key_hash.value()), static_cast<base::HostId>(entry_id.value()) });
     }
-    while (false);
 
-    sqlite3_finalize(statement);
-    return result;
+    return hosts;
 }
 
 } // namespace router
@@ -23,6 +23,7 @@
 #include "router/database.h"
 
 #include <filesystem>
+#include <memory>
 
 #include <sqlite3.h>
 
@@ -33,6 +34,9 @@ class DatabaseSqlite : public Database
 public:
     ~DatabaseSqlite();
 
+    // Opens the database for the current thread. The connection is kept by the thread and reused
+    // by the next calls together with the prepared statements, so the object must be used only on
+    // the thread that opened it.
     static std::unique_ptr<DatabaseSqlite> open();
     static std::filesystem::path filePath();
 
@@ -44,11 +48,14 @@ public:
     base::User findUser(std::u16string_view username) override;
     base::HostId hostId(const base::ByteArray& keyHash) const override;
     bool addHost(const base::ByteArray& keyHash) override;
+    std::optional<std::vector<Host>> hostList() const override;
 
 private:
-    explicit DatabaseSqlite(sqlite3* db);
+    class Connection;
 
-    sqlite3* db_;
+    explicit DatabaseSqlite(std::shared_ptr<Connection> connection);
+
+    std::shared_ptr<Connection> connection_;
 
     DISALLOW_COPY_AND_ASSIGN(DatabaseSqlite);
 };
@@ -0,0 +1,525 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/federation.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/net/network_channel_proxy.h"
+#include "proto/router_peer.pb.h"
+#include "router/hash_ring.h"
+#include "router/server.h"
+
+namespace router {
+
+namespace {
+
+// How long a client router uses the location of a host received from the home router.
+const std::chrono::minutes kLocationCacheTime { 5 };
+const size_t kMaxCachedLocations = 65536;
+
+// How long a request waits for the answer of another router.
+const std::chrono::seconds kRequestTimeout { 10 };
+const std::chrono::seconds kRequestCheckInterval { 5 };
+
+} // namespace
+
+Federation::Federation(std::shared_ptr<base::TaskRunner> task_runner, Server* server)
+    : task_runner_(task_runner),
+      server_(server),
+      requests_timer_(base::WaitableTimer::Type::REPEATED, task_runner)
+{
+    DCHECK(task_runner_ && server_);
+}
+
+Federation::~Federation() = default;
+
+void Federation::start(const std::vector<std::string>& peers,
+                       const FederationLink::Account& account)
+{
+    DCHECK(task_runner_->belongsToCurrentThread());
+
+    self_ = account.self;
+
+    std::vector<std::string> nodes = peers;
+    nodes.emplace_back(self_);
+    ring_ = std::make_unique<HashRing>(nodes);
+
+    for (const auto& peer : peers)
+    {
+        if (peer == self_ || links_.count(peer))
+            continue;
+
+        std::unique_ptr<FederationLink> link =
+            std::make_unique<FederationLink>(task_runner_, peer, account, this);
+        link->start();
+
+        links_.emplace(peer, std::move(link));
+    }
+
+    requests_timer_.start(kRequestCheckInterval,
+                          std::bind(&Federation::removeExpiredRequests, this));
+
+    LOG(LS_INFO) << "Federation started (self: " << self_ << ", peers: " << links_.size() << ")";
+}
+
+void Federation::onLocalHostsChanged(const std::vector<base::HostId>& host_ids, bool online)
+{
+    if (host_ids.empty())
+        return;
+
+    task_runner_->postTask([self = weak_from_this(), host_ids, online]()
+    {
+        std::shared_ptr<Federation> federation = self.lock();
+        if (federation)
+            federation->doLocalHostsChanged(host_ids, online);
+    });
+}
+
+void Federation::sendOffer(base::HostId host_id, const proto::ConnectionOffer& offer,
+                           OfferCallback callback)
+{
+    Request request;
+    request.host_id = host_id;
+    request.offer = offer;
+    request.callback = std::move(callback);
+
+    task_runner_->postTask([self = weak_from_this(), request = std::move(request)]() mutable
+    {
+        std::shared_ptr<Federation> federation = self.lock();
+        if (federation)
+            federation->doSendOffer(std::move(request), true);
+        else
+            request.callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+    });
+}
+
+void Federation::onRemoteMessage(Session::SessionId session_id,
+                                 std::shared_ptr<base::NetworkChannelProxy> channel,
+                                 const base::ByteArray& buffer)
+{
+    task_runner_->postTask([self = weak_from_this(), session_id, channel, buffer]()
+    {
+        std::shared_ptr<Federation> federation = self.lock();
+        if (federation)
+            federation->doRemoteMessage(session_id, channel, buffer);
+    });
+}
+
+void Federation::onRemoteFinished(Session::SessionId session_id)
+{
+    task_runner_->postTask([self = weak_from_this(), session_id]()
+    {
+        std::shared_ptr<Federation> federation = self.lock();
+        if (federation)
+            federation->doRemoteFinished(session_id);
+    });
+}
+
+void Federation::onLinkConnected(FederationLink* link)
+{
+    // The home router could lose the locations while the connection was absent.
+    std::vector<base::HostId> host_ids;
+
+    for (const auto& host_id : server_->localHostIds())
+    {
+        if (ring_->node(host_id) == link->router())
+            host_ids.emplace_back(host_id);
+    }
+
+    if (host_ids.empty())
+        return;
+
+    proto::FederationMessage message;
+    proto::FederationHostLocation* location = message.mutable_host_location();
+
+    for (const auto& host_id : host_ids)
+        location->add_host_id(host_id);
+    location->set_online(true);
+
+    link->send(message);
+}
+
+void Federation::onLinkDisconnected(FederationLink* link)
+{
+    for (auto it = requests_.begin(); it != requests_.end();)
+    {
+        if (it->second.router != link->router())
+        {
+            ++it;
+            continue;
+        }
+
+        OfferCallback callback = std::move(it->second.callback);
+        it = requests_.erase(it);
+
+        callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+    }
+
+    for (auto it = location_cache_.begin(); it != location_cache_.end();)
+    {
+        if (it->second.router == link->router())
+            it = location_cache_.erase(it);
+        else
+            ++it;
+    }
+}
+
+void Federation::onLinkMessage(FederationLink* link, const proto::FederationMessage& message)
+{
+    if (message.has_location_response())
+    {
+        const proto::FederationLocationResponse& response = message.location_response();
+
+        auto it = requests_.find(response.request_id());
+        if (it == requests_.end() || it->second.router != link->router())
+            return;
+
+        Request request = std::move(it->second);
+        requests_.erase(it);
+
+        if (response.router().empty())
+        {
+            LOG(LS_INFO) << "Host " << request.host_id << " is not connected to federation";
+            request.callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+            return;
+        }
+
+        if (location_cache_.size() >= kMaxCachedLocations)
+            location_cache_.clear();
+
+        location_cache_.insert_or_assign(request.host_id, CachedLocation {
+            response.router(), std::chrono::steady_clock::now() + kLocationCacheTime });
+
+        forwardOffer(response.router(), std::move(request), false);
+    }
+    else if (message.has_offer_result())
+    {
+        const proto::FederationOfferResult& result = message.offer_result();
+
+        auto it = requests_.find(result.request_id());
+        if (it == requests_.end() || it->second.router != link->router())
+            return;
+
+        Request request = std::move(it->second);
+        requests_.erase(it);
+
+        if (result.error_code() == proto::ConnectionOffer::PEER_NOT_FOUND && request.from_cache)
+        {
+            // The host has moved to another router. Ask the home router again.
+            location_cache_.erase(request.host_id);
+            doSendOffer(std::move(request), false);
+            return;
+        }
+
+        request.callback(result.error_code());
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unhandled message from router " << link->router();
+    }
+}
+
+void Federation::doLocalHostsChanged(const std::vector<base::HostId>& host_ids, bool online)
+{
+    std::unordered_map<std::string, proto::FederationMessage> messages;
+
+    for (const auto& host_id : host_ids)
+    {
+        const std::string& home = ring_->node(host_id);
+
+        if (home == self_)
+        {
+            if (online)
+            {
+                directory_.insert_or_assign(host_id, self_);
+            }
+            else
+            {
+                auto result = directory_.find(host_id);
+                if (result != directory_.end() && result->second == self_)
+                    directory_.erase(result);
+            }
+            continue;
+        }
+
+        proto::FederationHostLocation* location = messages[home].mutable_host_location();
+        location->add_host_id(host_id);
+        location->set_online(online);
+    }
+
+    // If the link is not connected, the hosts are sent after the connection is established.
+    for (const auto& message : messages)
+    {
+        FederationLink* link = connectedLink(message.first);
+        if (link)
+            link->send(message.second);
+    }
+}
+
+void Federation::doSendOffer(Request&& request, bool use_cache)
+{
+    if (use_cache)
+    {
+        auto cached = location_cache_.find(request.host_id);
+        if (cached != location_cache_.end())
+        {
+            if (cached->second.expire_time > std::chrono::steady_clock::now())
+            {
+                std::string router = cached->second.router;
+                forwardOffer(router, std::move(request), true);
+                return;
+            }
+
+            location_cache_.erase(cached);
+        }
+    }
+
+    const std::string& home = ring_->node(request.host_id);
+
+    if (home == self_)
+    {
+        auto location = directory_.find(request.host_id);
+        if (location == directory_.end())
+        {
+            request.callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+            return;
+        }
+
+        std::string router = location->second;
+        forwardOffer(router, std::move(request), false);
+        return;
+    }
+
+    FederationLink* link = connectedLink(home);
+    if (!link)
+    {
+        LOG(LS_WARNING) << "Home router " << home << " of host " << request.host_id
+                        << " is not connected";
+        request.callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+        return;
+    }
+
+    const uint32_t request_id = ++next_request_id_;
+
+    proto::FederationMessage message;
+    proto::FederationLocationRequest* location_request = message.mutable_location_request();
+    location_request->set_request_id(request_id);
+    location_request->set_host_id(request.host_id);
+
+    request.router = home;
+    request.deadline = std::chrono::steady_clock::now() + kRequestTimeout;
+    requests_.emplace(request_id, std::move(request));
+
+    link->send(message);
+}
+
+void Federation::forwardOffer(const std::string& router, Request&& request, bool from_cache)
+{
+    if (router == self_)
+    {
+        // The host was connected to this router, but it is not found by the client session.
+        request.callback(deliverOffer(request.host_id, request.offer) ?
+            proto::ConnectionOffer::SUCCESS : proto::ConnectionOffer::PEER_NOT_FOUND);
+        return;
+    }
+
+    FederationLink* link = connectedLink(router);
+    if (!link)
+    {
+        location_cache_.erase(request.host_id);
+        request.callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+        return;
+    }
+
+    const uint32_t request_id = ++next_request_id_;
+
+    proto::FederationMessage message;
+    proto::FederationOffer* offer = message.mutable_offer();
+    offer->set_request_id(request_id);
+    offer->set_host_id(request.host_id);
+    offer->mutable_offer()->CopyFrom(request.offer);
+
+    request.router = router;
+    request.from_cache = from_cache;
+    request.deadline = std::chrono::steady_clock::now() + kRequestTimeout;
+    requests_.emplace(request_id, std::move(request));
+
+    link->send(message);
+}
+
+void Federation::doRemoteMessage(Session::SessionId session_id,
+                                 std::shared_ptr<base::NetworkChannelProxy> channel,
+                                 const base::ByteArray& buffer)
+{
+    proto::FederationMessage message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Invalid message from router session " << session_id;
+        return;
+    }
+
+    if (message.has_hello())
+    {
+        const std::string& router = message.hello().router();
+
+        if (router == self_ || !links_.count(router))
+        {
+            LOG(LS_WARNING) << "Router " << router << " is not a member of federation";
+            return;
+        }
+
+        remote_routers_.insert_or_assign(session_id, router);
+        return;
+    }
+
+    auto remote_router = remote_routers_.find(session_id);
+    if (remote_router == remote_routers_.end())
+    {
+        LOG(LS_WARNING) << "Message from router session " << session_id << " before hello";
+        return;
+    }
+
+    const std::string& router = remote_router->second;
+
+    if (message.has_host_location())
+    {
+        const proto::FederationHostLocation& location = message.host_location();
+
+        for (int i = 0; i < location.host_id_size(); ++i)
+        {
+            const base::HostId host_id = location.host_id(i);
+
+            if (ring_->node(host_id) != self_)
+                continue;
+
+            if (location.online())
+            {
+                directory_.insert_or_assign(host_id, router);
+            }
+            else
+            {
+                auto result = directory_.find(host_id);
+                if (result != directory_.end() && result->second == router)
+                    directory_.erase(result);
+            }
+        }
+    }
+    else if (message.has_location_request())
+    {
+        const proto::FederationLocationRequest& request = message.location_request();
+
+        proto::FederationMessage answer;
+        proto::FederationLocationResponse* response = answer.mutable_location_response();
+        response->set_request_id(request.request_id());
+
+        auto location = directory_.find(request.host_id());
+        if (location != directory_.end())
+            response->set_router(location->second);
+
+        channel->send(base::serialize(answer));
+    }
+    else if (message.has_offer())
+    {
+        const proto::FederationOffer& offer = message.offer();
+
+        proto::FederationMessage answer;
+        proto::FederationOfferResult* result = answer.mutable_offer_result();
+        result->set_request_id(offer.request_id());
+        result->set_error_code(deliverOffer(offer.host_id(), offer.offer()) ?
+            proto::ConnectionOffer::SUCCESS : proto::ConnectionOffer::PEER_NOT_FOUND);
+
+        channel->send(base::serialize(answer));
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unhandled message from router " << router;
+    }
+}
+
+void Federation::doRemoteFinished(Session::SessionId session_id)
+{
+    auto remote_router = remote_routers_.find(session_id);
+    if (remote_router == remote_routers_.end())
+        return;
+
+    std::string router = std::move(remote_router->second);
+    remote_routers_.erase(remote_router);
+
+    // The router may have connected again before the previous session is finished.
+    for (const auto& other : remote_routers_)
+    {
+        if (other.second == router)
+            return;
+    }
+
+    // The locations are sent again when the router reconnects.
+    for (auto it = directory_.begin(); it != directory_.end();)
+    {
+        if (it->second == router)
+            it = directory_.erase(it);
+        else
+            ++it;
+    }
+}
+
+void Federation::removeExpiredRequests()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for (auto it = requests_.begin(); it != requests_.end();)
+    {
+        if (it->second.deadline > now)
+        {
+            ++it;
+            continue;
+        }
+
+        LOG(LS_WARNING) << "No answer from router " << it->second.router;
+
+        OfferCallback callback = std::move(it->second.callback);
+        it = requests_.erase(it);
+
+        callback(proto::ConnectionOffer::PEER_NOT_FOUND);
+    }
+}
+
+FederationLink* Federation::connectedLink(const std::string& router) const
+{
+    auto result = links_.find(router);
+    if (result == links_.end() || !result->second->isConnected())
+        return nullptr;
+
+    return result->second.get();
+}
+
+bool Federation::deliverOffer(base::HostId host_id, const proto::ConnectionOffer& offer) const
+{
+    std::shared_ptr<base::NetworkChannelProxy> host_channel = server_->hostChannel(host_id);
+    if (!host_channel)
+        return false;
+
+    proto::RouterToPeer message;
+    message.mutable_connection_offer()->CopyFrom(offer);
+    message.mutable_connection_offer()->set_peer_role(proto::ConnectionOffer::HOST);
+
+    host_channel->send(base::serialize(message));
+    return true;
+}
+
+} // namespace router
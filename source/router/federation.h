@@ -0,0 +1,140 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__FEDERATION_H
+#define ROUTER__FEDERATION_H
+
+#include "base/waitable_timer.h"
+#include "base/peer/host_id.h"
+#include "proto/router_federation.pb.h"
+#include "router/federation_link.h"
+#include "router/session.h"
+
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+namespace base {
+class NetworkChannelProxy;
+class TaskRunner;
+} // namespace base
+
+namespace router {
+
+class HashRing;
+class Server;
+
+// Makes the hosts of all routers of the federation reachable for the clients of every router.
+// Each router keeps the locations of the hosts for which it is the home router (see
+// router_federation.proto). A client router asks the home router where the host is, caches the
+// answer and forwards the connection offer to the router of the host.
+//
+// The public methods can be called from any thread. The work is done on the task runner of the
+// federation.
+class Federation
+    : public std::enable_shared_from_this<Federation>,
+      public FederationLink::Delegate
+{
+public:
+    Federation(std::shared_ptr<base::TaskRunner> task_runner, Server* server);
+    ~Federation();
+
+    using OfferCallback = std::function<void(proto::ConnectionOffer::ErrorCode error_code)>;
+
+    // Connects to |peers|. |account.self| is the address of this router.
+    void start(const std::vector<std::string>& peers, const FederationLink::Account& account);
+
+    // Called when the hosts connect to or disconnect from this router.
+    void onLocalHostsChanged(const std::vector<base::HostId>& host_ids, bool online);
+
+    // Sends |offer| to the host with |host_id|, which is connected to another router. |callback|
+    // receives the result on the thread of the federation.
+    void sendOffer(base::HostId host_id, const proto::ConnectionOffer& offer,
+                   OfferCallback callback);
+
+    // Called by the sessions of the other routers connected to this router. The answers are sent
+    // through |channel|.
+    void onRemoteMessage(Session::SessionId session_id,
+                         std::shared_ptr<base::NetworkChannelProxy> channel,
+                         const base::ByteArray& buffer);
+    void onRemoteFinished(Session::SessionId session_id);
+
+protected:
+    // FederationLink::Delegate implementation.
+    void onLinkConnected(FederationLink* link) override;
+    void onLinkDisconnected(FederationLink* link) override;
+    void onLinkMessage(FederationLink* link, const proto::FederationMessage& message) override;
+
+private:
+    struct Request
+    {
+        base::HostId host_id = base::kInvalidHostId;
+        proto::ConnectionOffer offer;
+        OfferCallback callback;
+
+        // Where the request was sent and whether the location was taken from the cache.
+        std::string router;
+        bool from_cache = false;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct CachedLocation
+    {
+        std::string router;
+        std::chrono::steady_clock::time_point expire_time;
+    };
+
+    void doLocalHostsChanged(const std::vector<base::HostId>& host_ids, bool online);
+    void doSendOffer(Request&& request, bool use_cache);
+    void forwardOffer(const std::string& router, Request&& request, bool from_cache);
+    void doRemoteMessage(Session::SessionId session_id,
+                         std::shared_ptr<base::NetworkChannelProxy> channel,
+                         const base::ByteArray& buffer);
+    void doRemoteFinished(Session::SessionId session_id);
+    void removeExpiredRequests();
+
+    FederationLink* connectedLink(const std::string& router) const;
+    bool deliverOffer(base::HostId host_id, const proto::ConnectionOffer& offer) const;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    Server* server_;
+
+    std::string self_;
+    std::unique_ptr<HashRing> ring_;
+    std::unordered_map<std::string, std::unique_ptr<FederationLink>> links_;
+
+    // Locations of the hosts for which this router is the home router.
+    std::unordered_map<base::HostId, std::string> directory_;
+
+    // Addresses of the routers connected to this router by their session IDs.
+    std::unordered_map<Session::SessionId, std::string> remote_routers_;
+
+    // Locations received from the home routers.
+    std::unordered_map<base::HostId, CachedLocation> location_cache_;
+
+    // Requests waiting for an answer from another router.
+    std::unordered_map<uint32_t, Request> requests_;
+    uint32_t next_request_id_ = 0;
+    base::WaitableTimer requests_timer_;
+
+    DISALLOW_COPY_AND_ASSIGN(Federation);
+};
+
+} // namespace router
+
+#endif // ROUTER__FEDERATION_H
@@ -0,0 +1,161 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/federation_link.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/peer/client_authenticator.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+
+namespace router {
+
+namespace {
+
+const std::chrono::seconds kReconnectTimeout { 15 };
+
+} // namespace
+
+FederationLink::FederationLink(std::shared_ptr<base::TaskRunner> task_runner,
+                               const std::string& router,
+                               const Account& account,
+                               Delegate* delegate)
+    : task_runner_(task_runner),
+      router_(router),
+      address_(base::Address::fromString(base::utf16FromUtf8(router), DEFAULT_ROUTER_TCP_PORT)),
+      account_(account),
+      delegate_(delegate),
+      reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner)
+{
+    DCHECK(task_runner_ && delegate_);
+}
+
+FederationLink::~FederationLink() = default;
+
+void FederationLink::start()
+{
+    if (!address_.isValid())
+    {
+        LOG(LS_ERROR) << "Invalid address of federation peer: " << router_;
+        return;
+    }
+
+    connect();
+}
+
+void FederationLink::send(const proto::FederationMessage& message)
+{
+    if (!connected_)
+        return;
+
+    channel_->send(base::serialize(message));
+}
+
+void FederationLink::onConnected()
+{
+    LOG(LS_INFO) << "Connection to router " << router_ << " is established";
+
+    channel_->setOwnKeepAlive(true);
+    channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_SRP);
+    authenticator_->setUserName(account_.username);
+    authenticator_->setPassword(account_.password);
+    authenticator_->setPeerPublicKey(account_.public_key);
+    authenticator_->setSessionType(proto::ROUTER_SESSION_ROUTER);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            channel_ = authenticator_->takeChannel();
+            channel_->setListener(this);
+            channel_->resume();
+
+            LOG(LS_INFO) << "Authentication with router " << router_ << " complete";
+
+            connected_ = true;
+
+            proto::FederationMessage message;
+            message.mutable_hello()->set_router(account_.self);
+            send(message);
+
+            delegate_->onLinkConnected(this);
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication with router " << router_ << " failed: "
+                            << base::ClientAuthenticator::errorToString(error_code);
+            delayedConnect();
+        }
+
+        // Authenticator is no longer needed.
+        task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void FederationLink::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_INFO) << "The connection to router " << router_ << " has been lost: "
+                 << base::NetworkChannel::errorToString(error_code);
+
+    const bool was_connected = connected_;
+    connected_ = false;
+
+    if (was_connected)
+        delegate_->onLinkDisconnected(this);
+
+    delayedConnect();
+}
+
+void FederationLink::onMessageReceived(const base::ByteArray& buffer)
+{
+    proto::FederationMessage message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Invalid message from router " << router_;
+        return;
+    }
+
+    delegate_->onLinkMessage(this, message);
+}
+
+void FederationLink::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void FederationLink::connect()
+{
+    LOG(LS_INFO) << "Connecting to router " << router_ << "...";
+
+    channel_ = std::make_unique<base::NetworkChannel>();
+    channel_->setListener(this);
+    channel_->connect(address_.host(), address_.port());
+}
+
+void FederationLink::delayedConnect()
+{
+    reconnect_timer_.start(kReconnectTimeout, std::bind(&FederationLink::connect, this));
+}
+
+} // namespace router
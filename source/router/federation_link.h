@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__FEDERATION_LINK_H
+#define ROUTER__FEDERATION_LINK_H
+
+#include "base/waitable_timer.h"
+#include "base/net/address.h"
+#include "base/net/network_channel.h"
+#include "proto/router_federation.pb.h"
+
+namespace base {
+class ClientAuthenticator;
+} // namespace base
+
+namespace router {
+
+// Outgoing connection to another router of the federation. The requests of this router are sent
+// through it and the answers come back through it. The connection is restored after a failure.
+class FederationLink : public base::NetworkChannel::Listener
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onLinkConnected(FederationLink* link) = 0;
+        virtual void onLinkDisconnected(FederationLink* link) = 0;
+        virtual void onLinkMessage(FederationLink* link,
+                                   const proto::FederationMessage& message) = 0;
+    };
+
+    struct Account
+    {
+        std::string self;
+        std::u16string username;
+        std::u16string password;
+        base::ByteArray public_key;
+    };
+
+    FederationLink(std::shared_ptr<base::TaskRunner> task_runner,
+                   const std::string& router,
+                   const Account& account,
+                   Delegate* delegate);
+    ~FederationLink();
+
+    void start();
+
+    // The address of the remote router as it is listed in the settings.
+    const std::string& router() const { return router_; }
+    bool isConnected() const { return connected_; }
+
+    void send(const proto::FederationMessage& message);
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void connect();
+    void delayedConnect();
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const std::string router_;
+    const base::Address address_;
+    const Account account_;
+    Delegate* delegate_;
+
+    std::unique_ptr<base::NetworkChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    base::WaitableTimer reconnect_timer_;
+    bool connected_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(FederationLink);
+};
+
+} // namespace router
+
+#endif // ROUTER__FEDERATION_LINK_H
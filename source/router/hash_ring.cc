@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/hash_ring.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace router {
+
+namespace {
+
+const size_t kPointsPerNode = 64;
+
+// The hashes must be the same on all routers, so std::hash is not used.
+uint64_t hashString(const std::string& str)
+{
+    // 64-bit FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const auto& ch : str)
+    {
+        hash ^= static_cast<uint8_t>(ch);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+uint64_t hashHostId(base::HostId host_id)
+{
+    // The host IDs are sequential, the finalizer of splitmix64 spreads them over the ring.
+    uint64_t hash = static_cast<uint64_t>(host_id);
+
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+} // namespace
+
+HashRing::HashRing(const std::vector<std::string>& nodes)
+    : nodes_(nodes)
+{
+    std::sort(nodes_.begin(), nodes_.end());
+    nodes_.erase(std::unique(nodes_.begin(), nodes_.end()), nodes_.end());
+
+    points_.reserve(nodes_.size() * kPointsPerNode);
+
+    for (size_t i = 0; i < nodes_.size(); ++i)
+    {
+        for (size_t point = 0; point < kPointsPerNode; ++point)
+            points_.emplace_back(hashString(nodes_[i] + '#' + std::to_string(point)), i);
+    }
+
+    std::sort(points_.begin(), points_.end());
+}
+
+HashRing::~HashRing() = default;
+
+const std::string& HashRing::node(base::HostId host_id) const
+{
+    DCHECK(!isEmpty());
+
+    const uint64_t hash = hashHostId(host_id);
+
+    auto result = std::lower_bound(points_.begin(), points_.end(), hash,
+                                   [](const std::pair<uint64_t, size_t>& point, uint64_t value)
+    {
+        return point.first < value;
+    });
+
+    // The ring wraps around.
+    if (result == points_.end())
+        result = points_.begin();
+
+    return nodes_[result->second];
+}
+
+} // namespace router
@@ -0,0 +1,56 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__HASH_RING_H
+#define ROUTER__HASH_RING_H
+
+#include "base/macros_magic.h"
+#include "base/peer/host_id.h"
+
+#include <string>
+#include <vector>
+
+namespace router {
+
+// Consistent hashing of the host IDs over the routers of a federation. Every router has several
+// points on the ring, so the hosts are spread evenly and a change of the router list moves only
+// the hosts of the added or removed router. All routers build the same ring from the same list
+// regardless of its order.
+class HashRing
+{
+public:
+    explicit HashRing(const std::vector<std::string>& nodes);
+    ~HashRing();
+
+    // Returns the node responsible for |host_id|. The ring must not be empty.
+    const std::string& node(base::HostId host_id) const;
+
+    bool isEmpty() const { return points_.empty(); }
+
+private:
+    std::vector<std::string> nodes_;
+
+    // Points of the nodes sorted by their hashes. The second value is the index in |nodes_|.
+    std::vector<std::pair<uint64_t, size_t>> points_;
+
+    DISALLOW_COPY_AND_ASSIGN(HashRing);
+};
+
+} // namespace router
+
+#endif // ROUTER__HASH_RING_H
@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/host_id_cache.h"
+
+#include "base/logging.h"
+#include "router/database.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace router {
+
+HostIdCache::HostIdCache() = default;
+
+HostIdCache::~HostIdCache() = default;
+
+bool HostIdCache::load(const Database& database, bool complete)
+{
+    std::optional<std::vector<Database::Host>> hosts = database.hostList();
+    if (!hosts.has_value())
+    {
+        LOG(LS_ERROR) << "Unable to load the hosts";
+        return false;
+    }
+
+    std::unique_lock lock(lock_);
+
+    hosts_.clear();
+    hosts_.reserve(hosts->size());
+
+    for (auto& host : *hosts)
+        hosts_.insert_or_assign(std::move(host.key_hash), host.host_id);
+
+    complete_ = complete;
+
+    LOG(LS_INFO) << "Hosts loaded: " << hosts_.size() << " (complete: " << complete_ << ")";
+    return true;
+}
+
+bool HostIdCache::isComplete() const
+{
+    std::shared_lock lock(lock_);
+    return complete_;
+}
+
+base::HostId HostIdCache::find(const base::ByteArray& key_hash) const
+{
+    std::shared_lock lock(lock_);
+
+    auto result = hosts_.find(key_hash);
+    if (result == hosts_.end())
+        return base::kInvalidHostId;
+
+    return result->second;
+}
+
+void HostIdCache::add(const base::ByteArray& key_hash, base::HostId host_id)
+{
+    DCHECK_NE(host_id, base::kInvalidHostId);
+
+    std::unique_lock lock(lock_);
+    hosts_.insert_or_assign(key_hash, host_id);
+}
+
+size_t HostIdCache::KeyHasher::operator()(const base::ByteArray& key_hash) const
+{
+    size_t hash = 0;
+    memcpy(&hash, key_hash.data(), std::min(key_hash.size(), sizeof(hash)));
+    return hash;
+}
+
+} // namespace router
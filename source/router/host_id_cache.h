@@ -0,0 +1,69 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__HOST_ID_CACHE_H
+#define ROUTER__HOST_ID_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "base/peer/host_id.h"
+
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace router {
+
+class Database;
+
+// In-memory index of the hosts table by the hashes of the host keys. It is loaded once when the
+// server starts and is updated after every host added by this router, so the registration of
+// the known hosts does not query the database. The methods can be called from any thread.
+class HostIdCache
+{
+public:
+    HostIdCache();
+    ~HostIdCache();
+
+    // Replaces the content of the cache with the hosts of |database|. If |complete| is true, no
+    // other process adds hosts to the database and the hosts missing in the cache do not exist.
+    bool load(const Database& database, bool complete);
+
+    // Returns true if a miss of find() means that the host does not exist.
+    bool isComplete() const;
+
+    // Returns base::kInvalidHostId if the key is not in the cache.
+    base::HostId find(const base::ByteArray& key_hash) const;
+    void add(const base::ByteArray& key_hash, base::HostId host_id);
+
+private:
+    // The keys are hashes themselves, their first bytes are used as the hash for the map.
+    struct KeyHasher
+    {
+        size_t operator()(const base::ByteArray& key_hash) const;
+    };
+
+    mutable std::shared_mutex lock_;
+    std::unordered_map<base::ByteArray, base::HostId, KeyHasher> hosts_;
+    bool complete_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(HostIdCache);
+};
+
+} // namespace router
+
+#endif // ROUTER__HOST_ID_CACHE_H
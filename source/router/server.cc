@@ -18,43 +18,95 @@
 
 #include "router/server.h"
 
+#include "base/latency_histogram.h"
 #include "base/logging.h"
+#include "base/metrics_writer.h"
+#include "base/task_lag_probe.h"
 #include "base/task_runner.h"
 #include "base/crypto/key_pair.h"
+#include "base/crypto/srp_constants.h"
+#include "base/crypto/srp_ephemeral_pool.h"
 #include "base/files/base_paths.h"
 #include "base/files/file_util.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "base/net/network_channel.h"
+#include "base/net/metrics_server.h"
+#include "base/net/network_channel_proxy.h"
+#include "base/threading/worker_pool.h"
+#include "proto/router_peer.pb.h"
+#include "router/database_factory_metrics.h"
 #include "router/database_factory_sqlite.h"
 #include "router/database_sqlite.h"
-#include "router/session_admin.h"
-#include "router/session_client.h"
+#include "router/federation.h"
+#include "router/host_id_cache.h"
+#include "router/server_shard.h"
 #include "router/session_host.h"
-#include "router/session_relay.h"
 #include "router/settings.h"
-#include "router/user_list_db.h"
+#include "router/user_cache.h"
+
+#if defined(USE_POSTGRESQL)
+#include "router/database_factory_postgres.h"
+#endif // defined(USE_POSTGRESQL)
+
+#include <algorithm>
+#include <map>
+#include <thread>
 
 namespace router {
 
 namespace {
 
+const uint32_t kMaxWorkerCount = 256;
+
+// How often the changes of the session list are sent to the subscribed admin sessions.
+constexpr std::chrono::seconds kSessionListUpdateInterval { 1 };
+
+// How often the users are reloaded when other routers can change them.
+constexpr std::chrono::seconds kUserCacheReloadInterval { 60 };
+
+// How often the lag of the task queues is measured for the metrics.
+constexpr std::chrono::seconds kLagProbeInterval { 5 };
+
+std::shared_ptr<DatabaseFactory> createDatabaseFactory(const Settings& settings)
+{
+    std::string type = settings.databaseType();
+
+    if (type == "sqlite")
+        return std::make_shared<DatabaseFactorySqlite>();
+
+#if defined(USE_POSTGRESQL)
+    if (type == "postgresql")
+    {
+        return std::make_shared<DatabaseFactoryPostgres>(
+            settings.databaseConnection(), settings.databasePoolSize());
+    }
+#endif // defined(USE_POSTGRESQL)
+
+    LOG(LS_ERROR) << "Unsupported database type: " << type;
+    return nullptr;
+}
+
 const char* sessionTypeToString(proto::RouterSession session_type)
 {
     switch (session_type)
     {
+        case proto::ROUTER_SESSION_ADMIN:
+            return "admin";
+
         case proto::ROUTER_SESSION_CLIENT:
-            return "ROUTER_SESSION_CLIENT";
+            return "client";
 
         case proto::ROUTER_SESSION_HOST:
-            return "ROUTER_SESSION_HOST";
-
-        case proto::ROUTER_SESSION_ADMIN:
-            return "ROUTER_SESSION_ADMIN";
+            return "host";
 
         case proto::ROUTER_SESSION_RELAY:
-            return "ROUTER_SESSION_RELAY";
+            return "relay";
+
+        case proto::ROUTER_SESSION_ROUTER:
+            return "router";
 
         default:
-            return "ROUTER_SESSION_UNKNOWN";
+            return "unknown";
     }
 }
 
@@ -62,18 +114,43 @@ const char* sessionTypeToString(proto::RouterSession session_type)
 
 Server::Server(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(std::move(task_runner)),
-      database_factory_(std::make_shared<DatabaseFactorySqlite>())
+      user_cache_(std::make_shared<UserCache>()),
+      user_cache_timer_(base::WaitableTimer::Type::REPEATED, task_runner_),
+      host_id_cache_(std::make_unique<HostIdCache>()),
+      session_list_timer_(base::WaitableTimer::Type::REPEATED, task_runner_),
+      lag_probe_timer_(base::WaitableTimer::Type::REPEATED, task_runner_)
 {
     DCHECK(task_runner_);
 }
 
-Server::~Server() = default;
+Server::~Server()
+{
+    // The shards stop their threads and the sessions on them. The finished sessions are removed
+    // from the list of the server, so it must outlive the shards.
+    shards_.clear();
+}
 
 bool Server::start()
 {
-    if (server_)
+    if (server_ || !shards_.empty())
         return false;
 
+    LOG(LS_INFO) << "I/O backend: " << base::MessagePumpForAsio::ioBackendName();
+
+    Settings settings;
+
+    database_factory_ = createDatabaseFactory(settings);
+    if (!database_factory_)
+        return false;
+
+    if (settings.metricsPort())
+    {
+        auth_latency_ = std::make_shared<base::LatencyHistogram>();
+        database_latency_ = std::make_shared<base::LatencyHistogram>();
+        database_factory_ =
+            std::make_shared<DatabaseFactoryMetrics>(database_factory_, database_latency_);
+    }
+
     std::unique_ptr<Database> database = database_factory_->openDatabase();
     if (!database)
     {
@@ -81,7 +158,24 @@ bool Server::start()
         return false;
     }
 
-    Settings settings;
+    user_cache_->load(*database);
+
+    // Other routers add hosts to a shared database. Then the hosts missing in the cache are looked
+    // up in the database. If the hosts are not loaded, all of them are looked up.
+    host_id_cache_->load(*database, !database_factory_->isShared());
+    database.reset();
+
+    // The admin sessions of this router update the cache. Changes made by other routers become
+    // visible after a reload.
+    if (database_factory_->isShared())
+    {
+        user_cache_timer_.start(kUserCacheReloadInterval, [this]()
+        {
+            std::unique_ptr<Database> database = database_factory_->openDatabase();
+            if (database)
+                user_cache_->load(*database);
+        });
+    }
 
     base::ByteArray private_key = settings.privateKey();
     if (private_key.empty())
@@ -143,224 +237,581 @@ bool Server::start()
         return false;
     }
 
-    std::unique_ptr<base::UserListBase> user_list = UserListDb::open(*database_factory_);
+    uint32_t worker_count = settings.workerCount();
+    if (!worker_count)
+        worker_count = std::max(std::thread::hardware_concurrency(), 1U);
+    worker_count = std::min(worker_count, kMaxWorkerCount);
 
-    authenticator_manager_ =
-        std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
-    authenticator_manager_->setPrivateKey(private_key);
-    authenticator_manager_->setUserList(std::move(user_list));
-    authenticator_manager_->setAnonymousAccess(
-        base::ServerAuthenticator::AnonymousAccess::ENABLE,
-        proto::ROUTER_SESSION_HOST | proto::ROUTER_SESSION_RELAY);
+    LOG(LS_INFO) << "Number of session workers: " << worker_count;
 
     relay_key_pool_ = std::make_unique<SharedKeyPool>(this);
+    auth_worker_pool_ = std::make_shared<base::WorkerPool>(static_cast<int>(worker_count));
 
-    server_ = std::make_unique<base::NetworkServer>();
-    server_->start(port, this);
+    // The default group of the users and the group of the unknown users are ready before the
+    // first connections.
+    srp_ephemeral_pool_ = std::make_shared<base::SrpEphemeralPool>();
+    srp_ephemeral_pool_->prepare(base::kSrpNgPair_4096);
+    srp_ephemeral_pool_->prepare(base::kSrpNgPair_8192);
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        shards_.emplace_back(std::make_unique<ServerShard>(
+            this, database_factory_, relay_key_pool_->share(), auth_worker_pool_, user_cache_,
+            private_key));
+        shards_.back()->start();
+    }
+
+    if (!startFederation(settings, private_key))
+        return false;
+
+    if (!startMetrics(settings))
+        return false;
+
+    bool reuse_port = settings.reusePort();
+    if (reuse_port && !base::NetworkServer::isReusePortSupported())
+    {
+        // Only one of the shards could bind the port.
+        LOG(LS_WARNING) << "Port reuse is not supported on this system";
+        reuse_port = false;
+    }
+
+    if (reuse_port)
+    {
+        // Each shard accepts its connections on its own thread.
+        LOG(LS_INFO) << "Connections are accepted by the workers";
+
+        for (const auto& shard : shards_)
+            shard->startListening(port);
+    }
+    else
+    {
+        server_ = std::make_unique<base::NetworkServer>();
+        server_->start(port, this);
+    }
 
     LOG(LS_INFO) << "Server started";
     return true;
 }
 
-std::unique_ptr<proto::SessionList> Server::sessionList() const
+void Server::addSession(Session* session, ServerShard* shard)
 {
-    std::unique_ptr<proto::SessionList> result = std::make_unique<proto::SessionList>();
+    DCHECK(session && shard);
+
+    SessionEntry entry;
+    entry.shard = shard;
+    entry.channel = session->channelProxy();
+
+    proto::Session* info = &entry.info;
+    info->set_session_id(session->sessionId());
+    info->set_session_type(session->sessionType());
+    info->set_timepoint(session->startTime());
+    info->set_ip_address(session->address());
+    entry.peer_port = session->port();
+    info->mutable_version()->CopyFrom(session->version().toProto());
+    info->set_os_name(session->osName());
+    info->set_computer_name(session->computerName());
+
+    std::scoped_lock lock(sessions_lock_);
+    sessions_.emplace(session->sessionId(), std::move(entry));
+    session_ids_.emplace(session->sessionId());
+    addSessionUpdate(session->sessionId());
+}
+
+void Server::removeSession(Session::SessionId session_id)
+{
+    std::vector<base::HostId> host_ids;
 
-    for (const auto& session : sessions_)
     {
-        proto::Session* item = result->add_session();
+        std::scoped_lock lock(sessions_lock_);
+
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end())
+            return;
 
-        item->set_session_id(session->sessionId());
-        item->set_session_type(session->sessionType());
-        item->set_timepoint(session->startTime());
-        item->set_ip_address(session->address());
-        item->mutable_version()->CopyFrom(session->version().toProto());
-        item->set_os_name(session->osName());
-        item->set_computer_name(session->computerName());
+        host_ids = removeHostIds(it);
+        sessions_.erase(it);
+        session_ids_.erase(session_id);
+        subscribers_.erase(session_id);
 
-        switch (session->sessionType())
+        if (!subscribers_.empty())
         {
-            case proto::ROUTER_SESSION_HOST:
-            {
-                proto::HostSessionData session_data;
+            updated_sessions_.erase(session_id);
+            removed_sessions_.emplace_back(session_id);
+        }
+        else
+        {
+            updated_sessions_.clear();
+            removed_sessions_.clear();
+        }
+    }
 
-                for (const auto& host_id : static_cast<SessionHost*>(session.get())->hostIdList())
-                    session_data.add_host_id(host_id);
+    if (federation_)
+        federation_->onLocalHostsChanged(host_ids, false);
+}
 
-                item->set_session_data(session_data.SerializeAsString());
-            }
-            break;
+std::unique_ptr<proto::SessionList> Server::sessionList(
+    Session::SessionId after_session_id, size_t max_count) const
+{
+    std::unique_ptr<proto::SessionList> result = std::make_unique<proto::SessionList>();
+    result->set_after_session_id(after_session_id);
 
-            case proto::ROUTER_SESSION_RELAY:
-            {
-                proto::RelaySessionData session_data;
-                session_data.set_pool_size(relay_key_pool_->countForRelay(session->sessionId()));
-                item->set_session_data(session_data.SerializeAsString());
-            }
-            break;
+    std::scoped_lock lock(sessions_lock_);
 
-            default:
-                break;
+    for (auto it = session_ids_.upper_bound(after_session_id); it != session_ids_.end(); ++it)
+    {
+        if (max_count && static_cast<size_t>(result->session_size()) >= max_count)
+        {
+            result->set_has_more(true);
+            break;
         }
+
+        auto session = sessions_.find(*it);
+        if (session != sessions_.end())
+            sessionInfo(session, result->add_session());
     }
 
     result->set_error_code(proto::SessionList::SUCCESS);
     return result;
 }
 
+void Server::subscribeSessionList(Session::SessionId session_id)
+{
+    {
+        std::scoped_lock lock(sessions_lock_);
+        if (!sessions_.count(session_id))
+            return;
+
+        subscribers_.emplace(session_id);
+    }
+
+    // The timer is used only on the thread of the server. It is not restarted if it is active,
+    // so new subscribers do not delay the next update.
+    task_runner_->postTask([this]()
+    {
+        if (session_list_timer_.isActive())
+            return;
+
+        session_list_timer_.start(kSessionListUpdateInterval,
+                                  std::bind(&Server::sendSessionListUpdates, this));
+    });
+}
+
 bool Server::stopSession(Session::SessionId session_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    ServerShard* shard;
+
     {
-        if (it->get()->sessionId() == session_id)
-        {
-            sessions_.erase(it);
-            return true;
-        }
+        std::scoped_lock lock(sessions_lock_);
+
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end())
+            return false;
+
+        shard = it->second.shard;
     }
 
-    return false;
+    // The session is stopped on the thread of its shard.
+    shard->stopSession(session_id);
+    return true;
 }
 
 void Server::onHostSessionWithId(SessionHost* session)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end();)
+    const Session::SessionId session_id = session->sessionId();
+    std::vector<std::pair<ServerShard*, Session::SessionId>> previous_sessions;
+    std::vector<base::HostId> removed_host_ids;
+    std::vector<base::HostId> host_ids = session->hostIdList();
+
     {
-        if (it->get()->sessionType() == proto::ROUTER_SESSION_HOST)
+        std::scoped_lock lock(sessions_lock_);
+
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end())
+            return;
+
+        // The host can reset its IDs during the session.
+        for (const auto& host_id : removeHostIds(it))
+        {
+            if (std::find(host_ids.begin(), host_ids.end(), host_id) == host_ids.end())
+                removed_host_ids.emplace_back(host_id);
+        }
+
+        it->second.host_id_list = host_ids;
+        it->second.direct_port = session->directPort();
+        it->second.hole_punching = session->isHolePunchingSupported();
+        addSessionUpdate(session_id);
+
+        for (const auto& host_id : it->second.host_id_list)
         {
-            SessionHost* other_session = reinterpret_cast<SessionHost*>(it->get());
-            if (other_session != session)
+            auto result = host_sessions_.emplace(host_id, session_id);
+            if (result.second || result.first->second == session_id)
+                continue;
+
+            auto other_session = sessions_.find(result.first->second);
+            if (other_session != sessions_.end())
             {
-                for (const auto& host_id : session->hostIdList())
-                {
-                    if (other_session->hasHostId(host_id))
-                    {
-                        LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
-
-                        it = sessions_.erase(it);
-                        continue;
-                    }
-                }
+                LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
+                previous_sessions.emplace_back(other_session->second.shard, other_session->first);
             }
+
+            result.first->second = session_id;
         }
+    }
+
+    // The previous sessions and all their host IDs are removed by their shards.
+    for (const auto& previous_session : previous_sessions)
+        previous_session.first->stopSession(previous_session.second);
 
-        ++it;
+    if (federation_)
+    {
+        federation_->onLocalHostsChanged(removed_host_ids, false);
+        federation_->onLocalHostsChanged(host_ids, true);
     }
 }
 
-SessionHost* Server::hostSessionById(base::HostId host_id)
+std::shared_ptr<base::NetworkChannelProxy> Server::hostChannel(base::HostId host_id) const
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
-    {
-        Session* entry = it->get();
+    std::scoped_lock lock(sessions_lock_);
 
-        if (entry->sessionType() == proto::ROUTER_SESSION_HOST &&
-            static_cast<SessionHost*>(entry)->hasHostId(host_id))
-        {
-            return static_cast<SessionHost*>(entry);
-        }
-    }
+    auto result = host_sessions_.find(host_id);
+    if (result == host_sessions_.end())
+        return nullptr;
 
-    return nullptr;
+    auto session = sessions_.find(result->second);
+    if (session == sessions_.end())
+        return nullptr;
+
+    return session->second.channel;
 }
 
-Session* Server::sessionById(Session::SessionId session_id)
+void Server::addHostDirectAddress(base::HostId host_id, proto::ConnectionOffer* offer) const
 {
-    for (auto& session : sessions_)
+    std::scoped_lock lock(sessions_lock_);
+
+    auto result = host_sessions_.find(host_id);
+    if (result == host_sessions_.end())
+        return;
+
+    auto session = sessions_.find(result->second);
+    if (session == sessions_.end() || !session->second.direct_port)
+        return;
+
+    offer->set_host_address(session->second.info.ip_address());
+    offer->set_host_port(session->second.direct_port);
+}
+
+std::optional<std::pair<std::string, uint16_t>> Server::hostPunchEndpoint(
+    base::HostId host_id) const
+{
+    std::scoped_lock lock(sessions_lock_);
+
+    auto result = host_sessions_.find(host_id);
+    if (result == host_sessions_.end())
+        return std::nullopt;
+
+    auto session = sessions_.find(result->second);
+    if (session == sessions_.end() || !session->second.hole_punching ||
+        !session->second.peer_port)
     {
-        if (session->sessionId() == session_id)
-            return session.get();
+        return std::nullopt;
     }
 
-    return nullptr;
+    return std::make_pair(session->second.info.ip_address(), session->second.peer_port);
+}
+
+std::vector<base::HostId> Server::localHostIds() const
+{
+    std::vector<base::HostId> host_ids;
+
+    std::scoped_lock lock(sessions_lock_);
+
+    host_ids.reserve(host_sessions_.size());
+    for (const auto& host_session : host_sessions_)
+        host_ids.emplace_back(host_session.first);
+
+    return host_ids;
+}
+
+void Server::setRelayPeerData(Session::SessionId session_id,
+                              const SessionRelay::PeerData& peer_data)
+{
+    std::scoped_lock lock(sessions_lock_);
+
+    auto result = sessions_.find(session_id);
+    if (result != sessions_.end())
+        result->second.peer_data.emplace(peer_data);
+}
+
+std::optional<SessionRelay::PeerData> Server::relayPeerData(Session::SessionId session_id) const
+{
+    std::scoped_lock lock(sessions_lock_);
+
+    auto result = sessions_.find(session_id);
+    if (result == sessions_.end())
+        return std::nullopt;
+
+    return result->second.peer_data;
 }
 
 void Server::onNewConnection(std::unique_ptr<base::NetworkChannel> channel)
 {
     LOG(LS_INFO) << "New connection: " << channel->peerAddress();
 
-    channel->setOwnKeepAlive(true);
-    channel->setNoDelay(true);
+    if (shards_.empty())
+        return;
+
+    // The least loaded shard authenticates the connection and runs its session. Among the shards
+    // with the same load, the connections are given in turn.
+    size_t selected = next_shard_ % shards_.size();
+
+    for (size_t i = 1; i < shards_.size(); ++i)
+    {
+        size_t index = (next_shard_ + i) % shards_.size();
+        if (shards_[index]->sessionCount() < shards_[selected]->sessionCount())
+            selected = index;
+    }
 
-    if (authenticator_manager_)
-        authenticator_manager_->addNewChannel(std::move(channel));
+    next_shard_ = selected + 1;
+    shards_[selected]->addConnection(std::move(channel));
 }
 
 void Server::onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id)
 {
-    for (const auto& session : sessions_)
+    std::shared_ptr<base::NetworkChannelProxy> channel;
+
     {
-        SessionRelay* relay_session = static_cast<SessionRelay*>(session.get());
-        if (relay_session->sessionId() == session_id)
-            relay_session->sendKeyUsed(key_id);
+        std::scoped_lock lock(sessions_lock_);
+
+        auto result = sessions_.find(session_id);
+        if (result == sessions_.end() ||
+            result->second.info.session_type() != proto::ROUTER_SESSION_RELAY)
+        {
+            return;
+        }
+
+        channel = result->second.channel;
     }
+
+    if (!channel)
+        return;
+
+    std::unique_ptr<proto::RouterToRelay> message = std::make_unique<proto::RouterToRelay>();
+    message->mutable_key_used()->set_key_id(key_id);
+    channel->send(base::serialize(*message));
 }
 
-void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
+void Server::sessionInfo(SessionList::const_iterator it, proto::Session* info) const
 {
-    std::string address = base::utf8FromUtf16(session_info.channel->peerAddress());
-    proto::RouterSession session_type =
-        static_cast<proto::RouterSession>(session_info.session_type);
-
-    LOG(LS_INFO) << "New session: " << sessionTypeToString(session_type) << " (" << address << ")";
+    const SessionEntry& entry = it->second;
 
-    std::unique_ptr<Session> session;
+    info->CopyFrom(entry.info);
 
-    switch (session_info.session_type)
+    switch (entry.info.session_type())
     {
-        case proto::ROUTER_SESSION_CLIENT:
-            session = std::make_unique<SessionClient>();
-            break;
-
         case proto::ROUTER_SESSION_HOST:
-            session = std::make_unique<SessionHost>();
-            break;
+        {
+            proto::HostSessionData session_data;
 
-        case proto::ROUTER_SESSION_ADMIN:
-            session = std::make_unique<SessionAdmin>();
-            break;
+            for (const auto& host_id : entry.host_id_list)
+                session_data.add_host_id(host_id);
+
+            info->set_session_data(session_data.SerializeAsString());
+        }
+        break;
 
         case proto::ROUTER_SESSION_RELAY:
-            session = std::make_unique<SessionRelay>();
-            break;
+        {
+            proto::RelaySessionData session_data;
+            session_data.set_pool_size(relay_key_pool_->countForRelay(it->first));
+            info->set_session_data(session_data.SerializeAsString());
+        }
+        break;
 
         default:
             break;
     }
+}
+
+void Server::addSessionUpdate(Session::SessionId session_id)
+{
+    // Changes are collected only while there are subscribers.
+    if (!subscribers_.empty())
+        updated_sessions_.emplace(session_id);
+}
+
+void Server::sendSessionListUpdates()
+{
+    std::vector<std::shared_ptr<base::NetworkChannelProxy>> channels;
+    proto::RouterToAdmin message;
 
-    if (!session)
     {
-        LOG(LS_ERROR) << "Unsupported session type: "
-                      << static_cast<int>(session_info.session_type);
-        return;
+        std::scoped_lock lock(sessions_lock_);
+
+        if (updated_sessions_.empty() && removed_sessions_.empty())
+            return;
+
+        proto::SessionListUpdate* update = message.mutable_session_list_update();
+
+        for (const auto& session_id : updated_sessions_)
+        {
+            auto session = sessions_.find(session_id);
+            if (session != sessions_.end())
+                sessionInfo(session, update->add_updated());
+        }
+
+        for (const auto& session_id : removed_sessions_)
+            update->add_removed(session_id);
+
+        updated_sessions_.clear();
+        removed_sessions_.clear();
+
+        for (const auto& subscriber : subscribers_)
+        {
+            auto session = sessions_.find(subscriber);
+            if (session != sessions_.end() && session->second.channel)
+                channels.emplace_back(session->second.channel);
+        }
     }
 
-    session->setChannel(std::move(session_info.channel));
-    session->setDatabaseFactory(database_factory_);
-    session->setServer(this);
-    session->setRelayKeyPool(relay_key_pool_->share());
-    session->setVersion(session_info.version);
-    session->setOsName(session_info.os_name);
-    session->setComputerName(session_info.computer_name);
+    if (channels.empty())
+        return;
+
+    base::ByteArray buffer = base::serialize(message);
 
-    sessions_.emplace_back(std::move(session));
-    sessions_.back()->start(this);
+    for (const auto& channel : channels)
+        channel->send(base::ByteArray(buffer));
 }
 
-void Server::onSessionFinished(Session::SessionId session_id, proto::RouterSession /* session_type */)
+std::vector<base::HostId> Server::removeHostIds(SessionList::const_iterator it)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    std::vector<base::HostId> removed;
+
+    for (const auto& host_id : it->second.host_id_list)
     {
-        if (it->get()->sessionId() == session_id)
+        auto result = host_sessions_.find(host_id);
+        if (result != host_sessions_.end() && result->second == it->first)
         {
-            // Session will be destroyed after completion of the current call.
-            task_runner_->deleteSoon(std::move(*it));
+            host_sessions_.erase(result);
+            removed.emplace_back(host_id);
+        }
+    }
 
-            // Delete a session from the list.
-            sessions_.erase(it);
-            break;
+    return removed;
+}
+
+bool Server::startFederation(const Settings& settings, const base::ByteArray& private_key)
+{
+    std::vector<std::string> peers = settings.federationPeers();
+    if (peers.empty())
+        return true;
+
+    FederationLink::Account account;
+    account.self = settings.federationAddress();
+    account.username = settings.federationUserName();
+    account.password = settings.federationPassword();
+
+    if (account.self.empty() || account.username.empty())
+    {
+        LOG(LS_ERROR) << "The address of the router and the account are required for federation";
+        return false;
+    }
+
+    // The routers of a federation are behind the same address for the clients, so they share
+    // the key pair.
+    base::KeyPair key_pair = base::KeyPair::fromPrivateKey(private_key);
+    if (!key_pair.isValid())
+    {
+        LOG(LS_ERROR) << "Invalid private key";
+        return false;
+    }
+
+    account.public_key = key_pair.publicKey();
+
+    federation_ = std::make_shared<Federation>(task_runner_, this);
+    federation_->start(peers, account);
+    return true;
+}
+
+bool Server::startMetrics(const Settings& settings)
+{
+    uint16_t port = settings.metricsPort();
+    if (!port)
+        return true;
+
+    metrics_server_ = std::make_unique<base::MetricsServer>(std::bind(&Server::metrics, this));
+    if (!metrics_server_->start(settings.metricsAddress(), port))
+        return false;
+
+    lag_probes_.emplace_back(std::make_unique<base::TaskLagProbe>(task_runner_));
+    for (const auto& shard : shards_)
+        lag_probes_.emplace_back(std::make_unique<base::TaskLagProbe>(shard->taskRunner()));
+
+    lag_probe_timer_.start(kLagProbeInterval, [this]()
+    {
+        for (const auto& lag_probe : lag_probes_)
+            lag_probe->probe();
+    });
+
+    return true;
+}
+
+std::string Server::metrics() const
+{
+    std::map<proto::RouterSession, int64_t> session_counts =
+    {
+        { proto::ROUTER_SESSION_ADMIN, 0 },
+        { proto::ROUTER_SESSION_CLIENT, 0 },
+        { proto::ROUTER_SESSION_HOST, 0 },
+        { proto::ROUTER_SESSION_RELAY, 0 },
+        { proto::ROUTER_SESSION_ROUTER, 0 }
+    };
+
+    {
+        std::scoped_lock lock(sessions_lock_);
+
+        for (const auto& session : sessions_)
+        {
+            proto::RouterSession session_type =
+                static_cast<proto::RouterSession>(session.second.info.session_type());
+            ++session_counts[session_type];
         }
     }
+
+    base::MetricsWriter writer;
+
+    writer.addMetric("aspia_router_sessions", base::MetricsWriter::Type::GAUGE,
+                     "The number of active sessions by type.");
+    for (const auto& session_count : session_counts)
+    {
+        std::string labels = "type=\"";
+        labels += sessionTypeToString(session_count.first);
+        labels += "\"";
+
+        writer.addSample("aspia_router_sessions", session_count.second, labels);
+    }
+
+    writer.addMetric("aspia_router_relay_keys", base::MetricsWriter::Type::GAUGE,
+                     "The number of relay keys in the pool.");
+    writer.addSample("aspia_router_relay_keys", static_cast<int64_t>(relay_key_pool_->count()));
+
+    writer.addHistogram("aspia_router_authentication_seconds",
+                        "The duration of the authentication of the connections.", *auth_latency_);
+    writer.addHistogram("aspia_router_database_query_seconds",
+                        "The duration of the database queries.", *database_latency_);
+
+    writer.addMetric("aspia_router_task_lag_seconds", base::MetricsWriter::Type::GAUGE,
+                     "The time the last probe task waited in the queue of the thread.");
+    for (size_t i = 0; i < lag_probes_.size(); ++i)
+    {
+        std::string labels = "thread=\"";
+        labels += (i == 0) ? "main" : "shard" + std::to_string(i - 1);
+        labels += "\"";
+
+        double lag = std::chrono::duration<double>(lag_probes_[i]->lag()).count();
+        writer.addSample("aspia_router_task_lag_seconds", lag, labels);
+    }
+
+    return writer.text();
 }
 
 } // namespace router
@@ -19,25 +19,50 @@
 #ifndef ROUTER__SERVER_H
 #define ROUTER__SERVER_H
 
+#include "base/waitable_timer.h"
 #include "base/net/network_server.h"
 #include "base/peer/host_id.h"
-#include "base/peer/server_authenticator_manager.h"
 #include "build/build_config.h"
 #include "proto/router_admin.pb.h"
 #include "router/session.h"
+#include "router/session_relay.h"
 #include "router/shared_key_pool.h"
 
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace base {
+class LatencyHistogram;
+class MetricsServer;
+class NetworkChannelProxy;
+class SrpEphemeralPool;
+class TaskLagProbe;
+class TaskRunner;
+class WorkerPool;
+} // namespace base
+
+namespace proto {
+class ConnectionOffer;
+} // namespace proto
+
 namespace router {
 
 class DatabaseFactory;
+class Federation;
+class ServerShard;
 class SessionHost;
-class SessionRelay;
+class Settings;
+class HostIdCache;
+class UserCache;
 
+// Accepts the connections and spreads them over the shards, which authenticate them and run the
+// sessions on their own threads. The server keeps the list of the sessions of all shards. Methods
+// used by the sessions can be called from any thread.
 class Server
     : public base::NetworkServer::Delegate,
-      public SharedKeyPool::Delegate,
-      public base::ServerAuthenticatorManager::Delegate,
-      public Session::Delegate
+      public SharedKeyPool::Delegate
 {
 public:
     explicit Server(std::shared_ptr<base::TaskRunner> task_runner);
@@ -45,12 +70,59 @@ public:
 
     bool start();
 
-    std::unique_ptr<proto::SessionList> sessionList() const;
+    // Called by the shards when a session is started and when it is finished.
+    void addSession(Session* session, ServerShard* shard);
+    void removeSession(Session::SessionId session_id);
+
+    // Returns up to |max_count| sessions with IDs greater than |after_session_id|. If |max_count|
+    // is 0, all sessions are returned.
+    std::unique_ptr<proto::SessionList> sessionList(
+        Session::SessionId after_session_id, size_t max_count) const;
+
+    // The admin session receives the changes of the session list until it is finished.
+    void subscribeSessionList(Session::SessionId session_id);
     bool stopSession(Session::SessionId session_id);
+
+    // Updates the host IDs of the session. Must be called on the thread of the session every time
+    // the list of its IDs changes.
     void onHostSessionWithId(SessionHost* session);
 
-    SessionHost* hostSessionById(base::HostId host_id);
-    Session* sessionById(Session::SessionId session_id);
+    // Returns the channel of the host session with |host_id| or nullptr if the host is not
+    // connected. The channel can be used from any thread.
+    std::shared_ptr<base::NetworkChannelProxy> hostChannel(base::HostId host_id) const;
+
+    // Adds the address for a direct connection to the host with |host_id| to the offer of the
+    // client. Nothing is added if the host is not connected or does not accept direct
+    // connections.
+    void addHostDirectAddress(base::HostId host_id, proto::ConnectionOffer* offer) const;
+
+    // Returns the public address and port of the connection of the host with |host_id| to the
+    // router. Returns std::nullopt if the host is not connected or cannot punch a hole.
+    std::optional<std::pair<std::string, uint16_t>> hostPunchEndpoint(base::HostId host_id) const;
+
+    // Returns the IDs of all hosts connected to this router.
+    std::vector<base::HostId> localHostIds() const;
+
+    // Returns nullptr if the router is not a member of a federation.
+    Federation* federation() const { return federation_.get(); }
+
+    void setRelayPeerData(Session::SessionId session_id, const SessionRelay::PeerData& peer_data);
+    std::optional<SessionRelay::PeerData> relayPeerData(Session::SessionId session_id) const;
+
+    // The users of the database. Must be updated after every change of the users table.
+    UserCache& userCache() { return *user_cache_; }
+
+    // The hosts of the database. Must be updated after every host added by this router.
+    HostIdCache& hostIdCache() { return *host_id_cache_; }
+
+    // The durations of the authentications of all shards.
+    std::shared_ptr<base::LatencyHistogram> authLatency() const { return auth_latency_; }
+
+    // The server ephemerals of SRP calculated in advance for all shards.
+    std::shared_ptr<base::SrpEphemeralPool> srpEphemeralPool() const
+    {
+        return srp_ephemeral_pool_;
+    }
 
 protected:
     // base::NetworkServer::Delegate implementation.
@@ -59,20 +131,78 @@ protected:
     // SharedKeyPool::Delegate implementation.
     void onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id) override;
 
-    // base::ServerAuthenticatorManager::Delegate implementation.
-    void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
+private:
+    struct SessionEntry
+    {
+        ServerShard* shard;
+        proto::Session info;
+        std::shared_ptr<base::NetworkChannelProxy> channel;
 
-    // Session::Delegate implementation.
-    void onSessionFinished(Session::SessionId session_id,
-                           proto::RouterSession session_type) override;
+        // Used only for host sessions.
+        std::vector<base::HostId> host_id_list;
+        uint16_t direct_port = 0;
+        uint16_t peer_port = 0;
+        bool hole_punching = false;
+
+        // Used only for relay sessions.
+        std::optional<SessionRelay::PeerData> peer_data;
+    };
+
+    using SessionList = std::unordered_map<Session::SessionId, SessionEntry>;
+
+    void sessionInfo(SessionList::const_iterator it, proto::Session* info) const;
+    void addSessionUpdate(Session::SessionId session_id);
+    void sendSessionListUpdates();
+
+    // Removes the host IDs of the session from the index and returns the removed IDs.
+    std::vector<base::HostId> removeHostIds(SessionList::const_iterator it);
+    bool startFederation(const Settings& settings, const base::ByteArray& private_key);
+    bool startMetrics(const Settings& settings);
+
+    // Returns the metrics in the text format of Prometheus.
+    std::string metrics() const;
 
-private:
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::shared_ptr<DatabaseFactory> database_factory_;
     std::unique_ptr<base::NetworkServer> server_;
-    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
     std::unique_ptr<SharedKeyPool> relay_key_pool_;
-    std::vector<std::unique_ptr<Session>> sessions_;
+    std::shared_ptr<UserCache> user_cache_;
+    base::WaitableTimer user_cache_timer_;
+    std::unique_ptr<HostIdCache> host_id_cache_;
+
+    // Runs the SRP math of the authentication for all shards.
+    std::shared_ptr<base::WorkerPool> auth_worker_pool_;
+    std::shared_ptr<base::SrpEphemeralPool> srp_ephemeral_pool_;
+    std::vector<std::unique_ptr<ServerShard>> shards_;
+    std::shared_ptr<Federation> federation_;
+    size_t next_shard_ = 0;
+
+    // Protects the sessions and the host index, they are changed by the threads of the shards.
+    mutable std::mutex sessions_lock_;
+    SessionList sessions_;
+
+    // Host sessions by the host IDs assigned to them.
+    std::unordered_map<base::HostId, Session::SessionId> host_sessions_;
+
+    // The IDs of all sessions in order for the pages of the session list.
+    std::set<Session::SessionId> session_ids_;
+
+    // Admin sessions subscribed to the changes of the session list and the changes collected
+    // since the last update. The updates are sent in batches by the timer.
+    std::unordered_set<Session::SessionId> subscribers_;
+    std::unordered_set<Session::SessionId> updated_sessions_;
+    std::vector<Session::SessionId> removed_sessions_;
+    base::WaitableTimer session_list_timer_;
+
+    // Used only if the metrics are enabled.
+    std::shared_ptr<base::LatencyHistogram> auth_latency_;
+    std::shared_ptr<base::LatencyHistogram> database_latency_;
+    std::unique_ptr<base::MetricsServer> metrics_server_;
+
+    // The first probe measures the lag of the thread of the server, the others measure the lag
+    // of the shards in the same order.
+    std::vector<std::unique_ptr<base::TaskLagProbe>> lag_probes_;
+    base::WaitableTimer lag_probe_timer_;
 
     DISALLOW_COPY_AND_ASSIGN(Server);
 };
@@ -0,0 +1,267 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/server_shard.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/strings/unicode.h"
+#include "router/database_factory.h"
+#include "router/server.h"
+#include "router/session_admin.h"
+#include "router/session_client.h"
+#include "router/session_host.h"
+#include "router/session_relay.h"
+#include "router/session_router.h"
+#include "router/shared_key_pool.h"
+#include "router/user_list_db.h"
+
+namespace router {
+
+namespace {
+
+const char* sessionTypeToString(proto::RouterSession session_type)
+{
+    switch (session_type)
+    {
+        case proto::ROUTER_SESSION_CLIENT:
+            return "ROUTER_SESSION_CLIENT";
+
+        case proto::ROUTER_SESSION_HOST:
+            return "ROUTER_SESSION_HOST";
+
+        case proto::ROUTER_SESSION_ADMIN:
+            return "ROUTER_SESSION_ADMIN";
+
+        case proto::ROUTER_SESSION_RELAY:
+            return "ROUTER_SESSION_RELAY";
+
+        case proto::ROUTER_SESSION_ROUTER:
+            return "ROUTER_SESSION_ROUTER";
+
+        default:
+            return "ROUTER_SESSION_UNKNOWN";
+    }
+}
+
+} // namespace
+
+ServerShard::ServerShard(Server* server,
+                         std::shared_ptr<DatabaseFactory> database_factory,
+                         std::unique_ptr<SharedKeyPool> relay_key_pool,
+                         std::shared_ptr<base::WorkerPool> auth_worker_pool,
+                         std::shared_ptr<UserCache> user_cache,
+                         const base::ByteArray& private_key)
+    : server_(server),
+      database_factory_(std::move(database_factory)),
+      relay_key_pool_(std::move(relay_key_pool)),
+      auth_worker_pool_(std::move(auth_worker_pool)),
+      user_cache_(std::move(user_cache)),
+      private_key_(private_key)
+{
+    DCHECK(server_ && database_factory_ && relay_key_pool_ && user_cache_);
+}
+
+ServerShard::~ServerShard()
+{
+    thread_.stop();
+}
+
+void ServerShard::start()
+{
+    thread_.start(base::MessageLoop::Type::ASIO, this);
+}
+
+void ServerShard::addConnection(std::unique_ptr<base::NetworkChannel> channel)
+{
+    DCHECK(channel);
+
+    // The socket is detached from the io_context of the caller and attached to the io_context of
+    // the shard. The channel is destroyed if it is not possible.
+    base::NetworkChannel::NativeHandle handle;
+    if (!channel->releaseSocket(&handle))
+        return;
+
+    task_runner_->postTask(std::bind(&ServerShard::startConnection, this, handle));
+}
+
+void ServerShard::startListening(uint16_t port)
+{
+    task_runner_->postTask(std::bind(&ServerShard::doStartListening, this, port));
+}
+
+void ServerShard::stopSession(Session::SessionId session_id)
+{
+    task_runner_->postTask(std::bind(&ServerShard::doStopSession, this, session_id));
+}
+
+void ServerShard::onNewConnection(std::unique_ptr<base::NetworkChannel> channel)
+{
+    LOG(LS_INFO) << "New connection: " << channel->peerAddress();
+    startChannel(std::move(channel));
+}
+
+void ServerShard::onBeforeThreadRunning()
+{
+    task_runner_ = thread_.taskRunner();
+    DCHECK(task_runner_);
+
+    authenticator_manager_ =
+        std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
+    authenticator_manager_->setPrivateKey(private_key_);
+    authenticator_manager_->setUserList(UserListDb::open(database_factory_, user_cache_));
+    authenticator_manager_->setWorkerPool(auth_worker_pool_);
+    authenticator_manager_->setEphemeralPool(server_->srpEphemeralPool());
+    authenticator_manager_->setLatencyHistogram(server_->authLatency());
+    authenticator_manager_->setAnonymousAccess(
+        base::ServerAuthenticator::AnonymousAccess::ENABLE,
+        proto::ROUTER_SESSION_HOST | proto::ROUTER_SESSION_RELAY);
+}
+
+void ServerShard::onAfterThreadRunning()
+{
+    network_server_.reset();
+    authenticator_manager_.reset();
+
+    for (const auto& session : sessions_)
+        server_->removeSession(session.first);
+
+    sessions_.clear();
+}
+
+void ServerShard::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
+{
+    std::string address = base::utf8FromUtf16(session_info.channel->peerAddress());
+    proto::RouterSession session_type =
+        static_cast<proto::RouterSession>(session_info.session_type);
+
+    LOG(LS_INFO) << "New session: " << sessionTypeToString(session_type) << " (" << address << ")";
+
+    std::unique_ptr<Session> session;
+
+    switch (session_info.session_type)
+    {
+        case proto::ROUTER_SESSION_CLIENT:
+            session = std::make_unique<SessionClient>();
+            break;
+
+        case proto::ROUTER_SESSION_HOST:
+            session = std::make_unique<SessionHost>();
+            break;
+
+        case proto::ROUTER_SESSION_ADMIN:
+            session = std::make_unique<SessionAdmin>();
+            break;
+
+        case proto::ROUTER_SESSION_RELAY:
+            session = std::make_unique<SessionRelay>();
+            break;
+
+        case proto::ROUTER_SESSION_ROUTER:
+        {
+            // The other routers can connect only if this router is a member of a federation.
+            if (server_->federation())
+                session = std::make_unique<SessionRouter>();
+        }
+        break;
+
+        default:
+            break;
+    }
+
+    if (!session)
+    {
+        LOG(LS_ERROR) << "Unsupported session type: "
+                      << static_cast<int>(session_info.session_type);
+        return;
+    }
+
+    session->setChannel(std::move(session_info.channel));
+    session->setDatabaseFactory(database_factory_);
+    session->setServer(server_);
+    session->setRelayKeyPool(relay_key_pool_->share());
+    session->setVersion(session_info.version);
+    session->setOsName(session_info.os_name);
+    session->setComputerName(session_info.computer_name);
+
+    Session* session_ptr = session.get();
+
+    sessions_.emplace(session_ptr->sessionId(), std::move(session));
+    session_count_.fetch_add(1, std::memory_order_relaxed);
+
+    session_ptr->start(this);
+    server_->addSession(session_ptr, this);
+}
+
+void ServerShard::onSessionFinished(Session::SessionId session_id,
+                                    proto::RouterSession /* session_type */)
+{
+    std::unique_ptr<Session> session = removeSession(session_id);
+    if (!session)
+        return;
+
+    // Session will be destroyed after completion of the current call.
+    task_runner_->deleteSoon(std::move(session));
+}
+
+void ServerShard::startConnection(base::NetworkChannel::NativeHandle handle)
+{
+    std::unique_ptr<base::NetworkChannel> channel = base::NetworkChannel::fromNativeHandle(handle);
+    if (!channel)
+        return;
+
+    startChannel(std::move(channel));
+}
+
+void ServerShard::startChannel(std::unique_ptr<base::NetworkChannel> channel)
+{
+    channel->setOwnKeepAlive(true);
+    channel->setNoDelay(true);
+
+    authenticator_manager_->addNewChannel(std::move(channel));
+}
+
+void ServerShard::doStartListening(uint16_t port)
+{
+    DCHECK(!network_server_);
+
+    network_server_ = std::make_unique<base::NetworkServer>();
+    network_server_->setReusePort(true);
+    network_server_->start(port, this);
+}
+
+void ServerShard::doStopSession(Session::SessionId session_id)
+{
+    removeSession(session_id);
+}
+
+std::unique_ptr<Session> ServerShard::removeSession(Session::SessionId session_id)
+{
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end())
+        return nullptr;
+
+    std::unique_ptr<Session> session = std::move(it->second);
+    sessions_.erase(it);
+    session_count_.fetch_sub(1, std::memory_order_relaxed);
+
+    server_->removeSession(session_id);
+    return session;
+}
+
+} // namespace router
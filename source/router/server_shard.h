@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__SERVER_SHARD_H
+#define ROUTER__SERVER_SHARD_H
+
+#include "base/net/network_channel.h"
+#include "base/net/network_server.h"
+#include "base/peer/server_authenticator_manager.h"
+#include "base/threading/thread.h"
+#include "router/session.h"
+
+#include <atomic>
+#include <unordered_map>
+
+namespace base {
+class WorkerPool;
+} // namespace base
+
+namespace router {
+
+class DatabaseFactory;
+class Server;
+class SharedKeyPool;
+class UserCache;
+
+// Authenticates the connections and runs the sessions on its own thread with its own io_context.
+// The server spreads the accepted connections over several shards. The sessions of different
+// shards communicate only through the server.
+class ServerShard
+    : public base::NetworkServer::Delegate,
+      public base::Thread::Delegate,
+      public base::ServerAuthenticatorManager::Delegate,
+      public Session::Delegate
+{
+public:
+    ServerShard(Server* server,
+                std::shared_ptr<DatabaseFactory> database_factory,
+                std::unique_ptr<SharedKeyPool> relay_key_pool,
+                std::shared_ptr<base::WorkerPool> auth_worker_pool,
+                std::shared_ptr<UserCache> user_cache,
+                const base::ByteArray& private_key);
+    ~ServerShard();
+
+    void start();
+
+    // Moves an accepted connection to the thread of the shard, where it is authenticated.
+    void addConnection(std::unique_ptr<base::NetworkChannel> channel);
+
+    // Accepts the connections on |port| on the thread of the shard. All the shards listen on the
+    // same port and the kernel spreads the connections between them (see
+    // base::NetworkServer::setReusePort()).
+    void startListening(uint16_t port);
+
+    // Stops the session of the shard. Can be called from any thread.
+    void stopSession(Session::SessionId session_id);
+
+    // The number of sessions. Used to select the least loaded shard.
+    size_t sessionCount() const { return session_count_.load(std::memory_order_relaxed); }
+
+    // The task runner of the thread of the shard. Valid after start().
+    std::shared_ptr<base::TaskRunner> taskRunner() const { return task_runner_; }
+
+protected:
+    // base::NetworkServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::NetworkChannel> channel) override;
+
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+    // base::ServerAuthenticatorManager::Delegate implementation.
+    void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
+
+    // Session::Delegate implementation.
+    void onSessionFinished(Session::SessionId session_id,
+                           proto::RouterSession session_type) override;
+
+private:
+    void startConnection(base::NetworkChannel::NativeHandle handle);
+    void startChannel(std::unique_ptr<base::NetworkChannel> channel);
+    void doStartListening(uint16_t port);
+    void doStopSession(Session::SessionId session_id);
+    std::unique_ptr<Session> removeSession(Session::SessionId session_id);
+
+    Server* server_;
+    std::shared_ptr<DatabaseFactory> database_factory_;
+    std::unique_ptr<SharedKeyPool> relay_key_pool_;
+    std::shared_ptr<base::WorkerPool> auth_worker_pool_;
+    std::shared_ptr<UserCache> user_cache_;
+    const base::ByteArray private_key_;
+
+    base::Thread thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    // Used only on the thread of the shard.
+    std::unique_ptr<base::NetworkServer> network_server_;
+    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
+    std::unordered_map<Session::SessionId, std::unique_ptr<Session>> sessions_;
+
+    std::atomic<size_t> session_count_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(ServerShard);
+};
+
+} // namespace router
+
+#endif // ROUTER__SERVER_SHARD_H
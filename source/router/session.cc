@@ -25,13 +25,15 @@
 #include "router/database_factory.h"
 #include "router/shared_key_pool.h"
 
+#include <atomic>
+
 namespace router {
 
 Session::SessionId createSessionId()
 {
-    static Session::SessionId last_session_id = 0;
-    ++last_session_id;
-    return last_session_id;
+    // Sessions are created on several threads.
+    static std::atomic<Session::SessionId> last_session_id { 0 };
+    return ++last_session_id;
 }
 
 Session::Session(proto::RouterSession session_type)
@@ -97,12 +99,21 @@ void Session::start(Delegate* delegate)
     start_time_ = std::chrono::system_clock::to_time_t(time_point);
 
     address_ = base::utf8FromUtf16(channel_->peerAddress());
+    port_ = channel_->peerPort();
     channel_->setListener(this);
     channel_->resume();
 
     onSessionReady();
 }
 
+std::shared_ptr<base::NetworkChannelProxy> Session::channelProxy() const
+{
+    if (!channel_)
+        return nullptr;
+
+    return channel_->channelProxy();
+}
+
 std::unique_ptr<Database> Session::openDatabase() const
 {
     return database_factory_->openDatabase();
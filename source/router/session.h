@@ -66,13 +66,19 @@ public:
     proto::RouterSession sessionType() const { return session_type_; }
     SessionId sessionId() const { return session_id_; }
     const std::string& address() const { return address_; }
+    uint16_t port() const { return port_; }
     time_t startTime() const { return start_time_; }
     std::chrono::seconds duration() const;
 
+    // Returns the proxy to send messages to the peer from other threads.
+    std::shared_ptr<base::NetworkChannelProxy> channelProxy() const;
+
 protected:
     void sendMessage(const google::protobuf::MessageLite& message);
     std::unique_ptr<Database> openDatabase() const;
 
+    base::NetworkChannel* channel() { return channel_.get(); }
+
     virtual void onSessionReady() = 0;
 
     // base::NetworkChannel::Listener implementation.
@@ -96,6 +102,7 @@ private:
     Server* server_ = nullptr;
 
     std::string address_;
+    uint16_t port_ = 0;
     std::string username_;
     base::Version version_;
     std::string os_name_;
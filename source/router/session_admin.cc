@@ -24,9 +24,20 @@
 #include "base/peer/user.h"
 #include "router/database.h"
 #include "router/server.h"
+#include "router/user_cache.h"
+
+#include <algorithm>
 
 namespace router {
 
+namespace {
+
+// The largest page of the session list given out at once. A request without a limit still gets
+// all sessions for compatibility with older clients.
+const uint32_t kMaxSessionListPage = 1000;
+
+} // namespace
+
 SessionAdmin::SessionAdmin()
     : Session(proto::ROUTER_SESSION_ADMIN)
 {
@@ -124,11 +135,18 @@ void SessionAdmin::doUserRequest(const proto::UserRequest& request)
     sendMessage(*message);
 }
 
-void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& /* request */)
+void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& request)
 {
+    // The subscription starts before the list is built, so no change is lost. The window replaces
+    // the sessions received twice.
+    if (request.subscribe())
+        server().subscribeSessionList(sessionId());
+
     std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
 
-    message->set_allocated_session_list(server().sessionList().release());
+    size_t max_count = std::min(request.max_count(), kMaxSessionListPage);
+    message->set_allocated_session_list(
+        server().sessionList(request.after_session_id(), max_count).release());
     if (!message->has_session_list())
         message->mutable_session_list()->set_error_code(proto::SessionList::UNKNOWN_ERROR);
 
@@ -186,6 +204,11 @@ proto::UserResult::ErrorCode SessionAdmin::addUser(const proto::User& user)
     if (!database->addUser(new_user))
         return proto::UserResult::INTERNAL_ERROR;
 
+    // The entry ID is assigned by the database.
+    base::User stored_user = database->findUser(new_user.name);
+    if (stored_user.isValid())
+        server().userCache().update(stored_user);
+
     return proto::UserResult::SUCCESS;
 }
 
@@ -216,6 +239,8 @@ proto::UserResult::ErrorCode SessionAdmin::modifyUser(const proto::User& user)
     if (!database->modifyUser(new_user))
         return proto::UserResult::INTERNAL_ERROR;
 
+    server().userCache().update(new_user);
+
     return proto::UserResult::SUCCESS;
 }
 
@@ -235,6 +260,8 @@ proto::UserResult::ErrorCode SessionAdmin::deleteUser(const proto::User& user)
     if (!database->removeUser(entry_id))
         return proto::UserResult::INTERNAL_ERROR;
 
+    server().userCache().remove(entry_id);
+
     return proto::UserResult::SUCCESS;
 }
 
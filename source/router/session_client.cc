@@ -20,9 +20,10 @@
 
 #include "base/logging.h"
 #include "base/crypto/random.h"
+#include "base/net/network_channel_proxy.h"
 #include "base/strings/unicode.h"
+#include "router/federation.h"
 #include "router/server.h"
-#include "router/session_host.h"
 #include "router/session_relay.h"
 
 namespace router {
@@ -71,15 +72,19 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
     proto::ConnectionOffer* offer = message->mutable_connection_offer();
 
-    SessionHost* host = server().hostSessionById(request.host_id());
-    if (!host)
+    std::shared_ptr<base::NetworkChannelProxy> host_channel =
+        server().hostChannel(request.host_id());
+    Federation* federation = server().federation();
+
+    if (!host_channel && !federation)
     {
         LOG(LS_WARNING) << "Host with id " << request.host_id() << " NOT found!";
         offer->set_error_code(proto::ConnectionOffer::PEER_NOT_FOUND);
     }
     else
     {
-        LOG(LS_INFO) << "Host with id " << request.host_id() << " found";
+        if (host_channel)
+            LOG(LS_INFO) << "Host with id " << request.host_id() << " found";
 
         std::optional<SharedKeyPool::Credentials> credentials = relayKeyPool().takeCredentials();
         if (!credentials.has_value())
@@ -89,36 +94,60 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
         }
         else
         {
-            SessionRelay* relay = static_cast<SessionRelay*>(
-                server().sessionById(credentials->session_id));
-            if (!relay)
+            std::optional<SessionRelay::PeerData> peer_data =
+                server().relayPeerData(credentials->session_id);
+            if (!peer_data.has_value())
             {
-                LOG(LS_ERROR) << "No relay with session id " << credentials->session_id;
+                LOG(LS_ERROR) << "No peer data for relay with session id "
+                              << credentials->session_id;
                 offer->set_error_code(proto::ConnectionOffer::KEY_POOL_EMPTY);
             }
             else
             {
-                const std::optional<SessionRelay::PeerData>& peer_data = relay->peerData();
-                if (!peer_data.has_value())
+                offer->set_error_code(proto::ConnectionOffer::SUCCESS);
+
+                proto::RelayCredentials* offer_credentials = offer->mutable_relay();
+
+                offer_credentials->set_host(peer_data->first);
+                offer_credentials->set_port(peer_data->second);
+                offer_credentials->mutable_key()->Swap(&credentials->key);
+                offer_credentials->set_secret(base::Random::string(16));
+
+                if (!host_channel)
                 {
-                    LOG(LS_ERROR) << "No peer data for relay with session id "
-                                  << credentials->session_id;
-                    offer->set_error_code(proto::ConnectionOffer::KEY_POOL_EMPTY);
+                    sendOfferToFederation(request.host_id(), std::move(message));
+                    return;
                 }
-                else
+
+                // The host session can work on another thread. The message is sent through the
+                // channel proxy of the host.
+                LOG(LS_INFO) << "Sending connection offer to host";
+                offer->set_peer_role(proto::ConnectionOffer::HOST);
+
+                // The peers get the endpoints of each other only if both can punch a hole.
+                std::optional<std::pair<std::string, uint16_t>> host_endpoint;
+                if (request.hole_punching() && port())
+                    host_endpoint = server().hostPunchEndpoint(request.host_id());
+
+                if (host_endpoint.has_value())
                 {
-                    offer->set_error_code(proto::ConnectionOffer::SUCCESS);
+                    offer->set_peer_address(address());
+                    offer->set_peer_port(port());
+                }
 
-                    proto::RelayCredentials* offer_credentials = offer->mutable_relay();
+                host_channel->send(base::serialize(*message));
 
-                    offer_credentials->set_host(relay->peerData()->first);
-                    offer_credentials->set_port(relay->peerData()->second);
-                    offer_credentials->mutable_key()->Swap(&credentials->key);
-                    offer_credentials->set_secret(base::Random::string(16));
+                // Only the client gets the address of the host.
+                server().addHostDirectAddress(request.host_id(), offer);
 
-                    LOG(LS_INFO) << "Sending connection offer to host";
-                    offer->set_peer_role(proto::ConnectionOffer::HOST);
-                    host->sendConnectionOffer(*offer);
+                if (host_endpoint.has_value())
+                {
+                    LOG(LS_INFO) << "Hole punching between " << address() << ":" << port()
+                                 << " and " << host_endpoint->first << ":"
+                                 << host_endpoint->second;
+
+                    offer->set_peer_address(host_endpoint->first);
+                    offer->set_peer_port(host_endpoint->second);
                 }
             }
         }
@@ -129,4 +158,34 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
     sendMessage(*message);
 }
 
+void SessionClient::sendOfferToFederation(
+    base::HostId host_id, std::unique_ptr<proto::RouterToPeer> message)
+{
+    LOG(LS_INFO) << "Host with id " << host_id << " is not connected to this router. "
+                 << "Sending connection offer to federation";
+
+    std::shared_ptr<proto::RouterToPeer> client_message(message.release());
+    client_message->mutable_connection_offer()->set_peer_role(proto::ConnectionOffer::CLIENT);
+
+    // The answer comes on the thread of the federation after the session may be finished, so the
+    // message is sent to the client through the channel proxy.
+    std::shared_ptr<base::NetworkChannelProxy> client_channel = channelProxy();
+
+    server().federation()->sendOffer(host_id, client_message->connection_offer(),
+        [host_id, client_message, client_channel](proto::ConnectionOffer::ErrorCode error_code)
+    {
+        proto::ConnectionOffer* offer = client_message->mutable_connection_offer();
+
+        if (error_code != proto::ConnectionOffer::SUCCESS)
+        {
+            LOG(LS_WARNING) << "Host with id " << host_id << " NOT found in federation";
+            offer->clear_relay();
+            offer->set_error_code(error_code);
+        }
+
+        LOG(LS_INFO) << "Sending connection offer to client";
+        client_channel->send(base::serialize(*client_message));
+    });
+}
+
 } // namespace router
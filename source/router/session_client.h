@@ -19,6 +19,7 @@
 #ifndef ROUTER__SESSION_CLIENT_H
 #define ROUTER__SESSION_CLIENT_H
 
+#include "base/peer/host_id.h"
 #include "proto/router_peer.pb.h"
 #include "router/session.h"
 
@@ -44,6 +45,9 @@ protected:
 private:
     void readConnectionRequest(const proto::ConnectionRequest& request);
 
+    // Sends the offer to the host connected to another router of the federation.
+    void sendOfferToFederation(base::HostId host_id, std::unique_ptr<proto::RouterToPeer> message);
+
     DISALLOW_COPY_AND_ASSIGN(SessionClient);
 };
 
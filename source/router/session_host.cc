@@ -24,6 +24,7 @@
 #include "base/crypto/random.h"
 #include "base/net/network_channel.h"
 #include "router/database.h"
+#include "router/host_id_cache.h"
 #include "router/server.h"
 
 namespace router {
@@ -32,6 +33,10 @@ namespace {
 
 const size_t kHostKeySize = 512;
 
+// The host sends its own keep alive every 45 seconds. It shows that the connection is alive, so
+// the router checks the connection by itself only if the host has been silent for this interval.
+const std::chrono::seconds kKeepAliveInterval(300);
+
 } // namespace
 
 SessionHost::SessionHost()
@@ -47,16 +52,14 @@ bool SessionHost::hasHostId(base::HostId host_id) const
     return base::contains(host_id_list_, host_id);
 }
 
-void SessionHost::sendConnectionOffer(const proto::ConnectionOffer& offer)
-{
-    std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
-    message->mutable_connection_offer()->CopyFrom(offer);
-    sendMessage(*message);
-}
-
 void SessionHost::onSessionReady()
 {
-    // Nothing
+    // Most of the registered hosts are idle. They send a few small messages, so the channel does
+    // not keep the buffers between them.
+    base::NetworkChannel* channel = this->channel();
+    channel->setOwnKeepAlive(false);
+    channel->setOwnKeepAlive(true, kKeepAliveInterval);
+    channel->setPresenceMode(true);
 }
 
 void SessionHost::onMessageReceived(const base::ByteArray& buffer)
@@ -89,15 +92,10 @@ void SessionHost::onMessageWritten(size_t /* pending */)
 
 void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
 {
-    std::unique_ptr<Database> database = openDatabase();
-    if (!database)
-    {
-        LOG(LS_ERROR) << "Failed to connect to database";
-        return;
-    }
-
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
     proto::HostIdResponse* host_id_response = message->mutable_host_id_response();
+    HostIdCache& host_id_cache = server().hostIdCache();
+    std::unique_ptr<Database> database;
     base::ByteArray key_hash;
 
     if (host_id_request.type() == proto::HostIdRequest::NEW_ID)
@@ -108,6 +106,13 @@ void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
         // Calculate hash for key.
         key_hash = base::GenericHash::hash(base::GenericHash::Type::BLAKE2b512, key);
 
+        database = openDatabase();
+        if (!database)
+        {
+            LOG(LS_ERROR) << "Failed to connect to database";
+            return;
+        }
+
         if (!database->addHost(key_hash))
         {
             LOG(LS_ERROR) << "Unable to add host";
@@ -128,7 +133,25 @@ void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
         return;
     }
 
-    base::HostId host_id = database->hostId(key_hash);
+    // The known hosts are found in the cache. A new host and the hosts missing in an incomplete
+    // cache are looked up in the database.
+    base::HostId host_id = host_id_cache.find(key_hash);
+    if (host_id == base::kInvalidHostId && (database || !host_id_cache.isComplete()))
+    {
+        if (!database)
+            database = openDatabase();
+
+        if (!database)
+        {
+            LOG(LS_ERROR) << "Failed to connect to database";
+            return;
+        }
+
+        host_id = database->hostId(key_hash);
+        if (host_id != base::kInvalidHostId)
+            host_id_cache.add(key_hash, host_id);
+    }
+
     if (host_id == base::kInvalidHostId)
     {
         LOG(LS_ERROR) << "Failed to get host ID";
@@ -136,6 +159,8 @@ void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
     }
 
     host_id_list_.emplace_back(host_id);
+    direct_port_ = static_cast<uint16_t>(host_id_request.direct_port());
+    hole_punching_ = host_id_request.hole_punching();
 
     // Notify the server that the ID has been assigned.
     server().onHostSessionWithId(this);
@@ -165,6 +190,9 @@ void SessionHost::readResetHostId(const proto::ResetHostId& reset_host_id)
         {
             LOG(LS_INFO) << "Host ID " << host_id << " remove from list";
             host_id_list_.erase(it);
+
+            // Notify the server that the ID has been removed.
+            server().onHostSessionWithId(this);
             return;
         }
     }
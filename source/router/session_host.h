@@ -38,7 +38,11 @@ public:
     const HostIdList& hostIdList() const { return host_id_list_; }
     bool hasHostId(base::HostId host_id) const;
 
-    void sendConnectionOffer(const proto::ConnectionOffer& offer);
+    // The port at which the host accepts direct connections or 0.
+    uint16_t directPort() const { return direct_port_; }
+
+    // True if the host can make a direct connection by the hole punching.
+    bool isHolePunchingSupported() const { return hole_punching_; }
 
 protected:
     // Session implementation.
@@ -53,6 +57,8 @@ private:
     void readResetHostId(const proto::ResetHostId& reset_host_id);
 
     HostIdList host_id_list_;
+    uint16_t direct_port_ = 0;
+    bool hole_punching_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(SessionHost);
 };
@@ -19,6 +19,7 @@
 #include "router/session_relay.h"
 
 #include "base/logging.h"
+#include "router/server.h"
 #include "router/shared_key_pool.h"
 
 namespace router {
@@ -34,13 +35,6 @@ SessionRelay::~SessionRelay()
     relayKeyPool().removeKeysForRelay(sessionId());
 }
 
-void SessionRelay::sendKeyUsed(uint32_t key_id)
-{
-    std::unique_ptr<proto::RouterToRelay> message = std::make_unique<proto::RouterToRelay>();
-    message->mutable_key_used()->set_key_id(key_id);
-    sendMessage(*message);
-}
-
 void SessionRelay::onSessionReady()
 {
     // Nothing
@@ -60,6 +54,10 @@ void SessionRelay::onMessageReceived(const base::ByteArray& buffer)
     {
         readKeyPool(message->key_pool());
     }
+    else if (message->has_stat())
+    {
+        relayKeyPool().setRelayStat(sessionId(), message->stat());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from relay server";
@@ -77,7 +75,7 @@ void SessionRelay::readKeyPool(const proto::RelayKeyPool& key_pool)
 
     LOG(LS_INFO) << "Received key pool: " << key_pool.key_size() << " (" << address() << ")";
 
-    peer_data_.emplace(std::make_pair(
+    server().setRelayPeerData(sessionId(), std::make_pair(
         key_pool.peer_host(), static_cast<uint16_t>(key_pool.peer_port())));
 
     for (int i = 0; i < key_pool.key_size(); ++i)
@@ -33,9 +33,6 @@ public:
 
     using PeerData = std::pair<std::string, uint16_t>;
 
-    const std::optional<PeerData>& peerData() const { return peer_data_; }
-    void sendKeyUsed(uint32_t key_id);
-
 protected:
     // Session implementation.
     void onSessionReady() override;
@@ -47,8 +44,6 @@ protected:
 private:
     void readKeyPool(const proto::RelayKeyPool& key_pool);
 
-    std::optional<PeerData> peer_data_;
-
     DISALLOW_COPY_AND_ASSIGN(SessionRelay);
 };
 
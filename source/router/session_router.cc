@@ -0,0 +1,62 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/session_router.h"
+
+#include "base/logging.h"
+#include "router/federation.h"
+#include "router/server.h"
+
+namespace router {
+
+SessionRouter::SessionRouter()
+    : Session(proto::ROUTER_SESSION_ROUTER)
+{
+    // Nothing
+}
+
+SessionRouter::~SessionRouter()
+{
+    Federation* federation = server().federation();
+    if (federation)
+        federation->onRemoteFinished(sessionId());
+}
+
+void SessionRouter::onSessionReady()
+{
+    // Nothing
+}
+
+void SessionRouter::onMessageReceived(const base::ByteArray& buffer)
+{
+    Federation* federation = server().federation();
+    if (!federation)
+    {
+        LOG(LS_WARNING) << "Message from router while federation is disabled";
+        return;
+    }
+
+    federation->onRemoteMessage(sessionId(), channelProxy(), buffer);
+}
+
+void SessionRouter::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+} // namespace router
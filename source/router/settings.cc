@@ -18,6 +18,8 @@
 
 #include "router/settings.h"
 
+#include "base/strings/string_split.h"
+
 namespace router {
 
 Settings::Settings()
@@ -63,4 +65,124 @@ int Settings::minLogLevel() const
     return impl_.get<int>("MinLogLevel", 1);
 }
 
+void Settings::setWorkerCount(uint32_t count)
+{
+    impl_.set<uint32_t>("WorkerCount", count);
+}
+
+uint32_t Settings::workerCount() const
+{
+    return impl_.get<uint32_t>("WorkerCount", 0);
+}
+
+void Settings::setReusePort(bool enable)
+{
+    impl_.set<bool>("ReusePort", enable);
+}
+
+bool Settings::reusePort() const
+{
+    return impl_.get<bool>("ReusePort", false);
+}
+
+void Settings::setDatabaseType(const std::string& type)
+{
+    impl_.set<std::string>("DatabaseType", type);
+}
+
+std::string Settings::databaseType() const
+{
+    return impl_.get<std::string>("DatabaseType", "sqlite");
+}
+
+void Settings::setDatabaseConnection(const std::string& connection_info)
+{
+    impl_.set<std::string>("DatabaseConnection", connection_info);
+}
+
+std::string Settings::databaseConnection() const
+{
+    return impl_.get<std::string>("DatabaseConnection");
+}
+
+void Settings::setDatabasePoolSize(uint32_t size)
+{
+    impl_.set<uint32_t>("DatabasePoolSize", size);
+}
+
+uint32_t Settings::databasePoolSize() const
+{
+    return impl_.get<uint32_t>("DatabasePoolSize", 16);
+}
+
+void Settings::setFederationAddress(const std::string& address)
+{
+    impl_.set<std::string>("FederationAddress", address);
+}
+
+std::string Settings::federationAddress() const
+{
+    return impl_.get<std::string>("FederationAddress");
+}
+
+void Settings::setFederationPeers(const std::vector<std::string>& peers)
+{
+    std::string value;
+
+    for (const auto& peer : peers)
+    {
+        if (!value.empty())
+            value += ';';
+        value += peer;
+    }
+
+    impl_.set<std::string>("FederationPeers", value);
+}
+
+std::vector<std::string> Settings::federationPeers() const
+{
+    return base::splitString(impl_.get<std::string>("FederationPeers"), ";",
+                             base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+}
+
+void Settings::setFederationUserName(const std::u16string& username)
+{
+    impl_.set<std::u16string>("FederationUserName", username);
+}
+
+std::u16string Settings::federationUserName() const
+{
+    return impl_.get<std::u16string>("FederationUserName");
+}
+
+void Settings::setFederationPassword(const std::u16string& password)
+{
+    impl_.set<std::u16string>("FederationPassword", password);
+}
+
+std::u16string Settings::federationPassword() const
+{
+    return impl_.get<std::u16string>("FederationPassword");
+}
+
+void Settings::setMetricsAddress(const std::u16string& address)
+{
+    impl_.set<std::u16string>("MetricsAddress", address);
+}
+
+std::u16string Settings::metricsAddress() const
+{
+    return impl_.get<std::u16string>("MetricsAddress", u"127.0.0.1");
+}
+
+void Settings::setMetricsPort(uint16_t port)
+{
+    impl_.set<uint16_t>("MetricsPort", port);
+}
+
+uint16_t Settings::metricsPort() const
+{
+    return impl_.get<uint16_t>("MetricsPort", 0);
+}
+
 } // namespace router
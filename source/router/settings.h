@@ -40,6 +40,53 @@ public:
     void setMinLogLevel(int level);
     int minLogLevel() const;
 
+    // The number of threads that run the sessions. If 0, it matches the number of processor cores.
+    void setWorkerCount(uint32_t count);
+    uint32_t workerCount() const;
+
+    // If enabled, each worker thread listens on the port by itself and the kernel spreads the
+    // connections between them. Otherwise, the connections are accepted on the main thread and
+    // passed to the workers. Supported only on Linux.
+    void setReusePort(bool enable);
+    bool reusePort() const;
+
+    // The database backend: "sqlite" (default) or "postgresql". PostgreSQL is available only if
+    // the router is built with it.
+    void setDatabaseType(const std::string& type);
+    std::string databaseType() const;
+
+    // The connection string of the PostgreSQL database (see the libpq documentation).
+    void setDatabaseConnection(const std::string& connection_info);
+    std::string databaseConnection() const;
+
+    // The maximum number of connections to the PostgreSQL database.
+    void setDatabasePoolSize(uint32_t size);
+    uint32_t databasePoolSize() const;
+
+    // The address under which the other routers of the federation connect to this router. It must
+    // be written the same way as in the peer list of the other routers.
+    void setFederationAddress(const std::string& address);
+    std::string federationAddress() const;
+
+    // The addresses of the other routers of the federation separated by ';'. If the list is
+    // empty, the federation is disabled.
+    void setFederationPeers(const std::vector<std::string>& peers);
+    std::vector<std::string> federationPeers() const;
+
+    // The account used to connect to the other routers. It must have the session type
+    // ROUTER_SESSION_ROUTER on all of them.
+    void setFederationUserName(const std::u16string& username);
+    std::u16string federationUserName() const;
+    void setFederationPassword(const std::u16string& password);
+    std::u16string federationPassword() const;
+
+    // The address and the port of the HTTP listener that reports the metrics for Prometheus. If
+    // the port is 0, the listener is disabled.
+    void setMetricsAddress(const std::u16string& address);
+    std::u16string metricsAddress() const;
+    void setMetricsPort(uint16_t port);
+    uint16_t metricsPort() const;
+
 private:
     base::JsonSettings impl_;
 };
@@ -20,10 +20,21 @@
 
 #include "base/logging.h"
 
+#include <algorithm>
 #include <map>
+#include <mutex>
 
 namespace router {
 
+namespace {
+
+// Weights of the parts of the load of a relay.
+const double kSessionsWeight = 0.5;
+const double kTrafficWeight = 0.3;
+const double kProcessorWeight = 0.2;
+
+} // namespace
+
 class SharedKeyPool::Impl
 {
 public:
@@ -33,6 +44,7 @@ public:
     void dettach();
 
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
+    void setRelayStat(Session::SessionId session_id, const proto::RelayStat& stat);
     std::optional<Credentials> takeCredentials();
     void removeKeysForRelay(Session::SessionId session_id);
     void clear();
@@ -43,7 +55,23 @@ public:
 private:
     using Keys = std::vector<proto::RelayKey>;
 
+    struct Load
+    {
+        proto::RelayStat stat;
+
+        // Keys taken since the last report. Each of them is likely a new session.
+        uint32_t taken_keys = 0;
+    };
+
+    std::optional<Credentials> takeKey();
+    double loadFactor(Session::SessionId session_id, size_t key_count,
+                      uint64_t max_bytes_per_second) const;
+
+    // The pool is shared by the sessions on all threads of the router.
+    mutable std::mutex lock_;
+
     std::map<Session::SessionId, Keys> pool_;
+    std::map<Session::SessionId, Load> loads_;
     Delegate* delegate_;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
@@ -57,11 +85,14 @@ SharedKeyPool::Impl::Impl(Delegate* delegate)
 
 void SharedKeyPool::Impl::dettach()
 {
+    std::scoped_lock lock(lock_);
     delegate_ = nullptr;
 }
 
 void SharedKeyPool::Impl::addKey(Session::SessionId session_id, const proto::RelayKey& key)
 {
+    std::scoped_lock lock(lock_);
+
     auto relay = pool_.find(session_id);
     if (relay == pool_.end())
     {
@@ -74,6 +105,82 @@ void SharedKeyPool::Impl::addKey(Session::SessionId session_id, const proto::Rel
 }
 
 std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
+{
+    std::optional<Credentials> credentials;
+    Delegate* delegate;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        credentials = takeKey();
+        delegate = delegate_;
+    }
+
+    // The delegate is notified without the lock, it can use the pool too.
+    if (credentials.has_value() && delegate)
+        delegate->onPoolKeyUsed(credentials->session_id, credentials->key.key_id());
+
+    return credentials;
+}
+
+void SharedKeyPool::Impl::setRelayStat(Session::SessionId session_id, const proto::RelayStat& stat)
+{
+    std::scoped_lock lock(lock_);
+
+    Load& load = loads_[session_id];
+
+    load.stat = stat;
+    load.taken_keys = 0;
+}
+
+void SharedKeyPool::Impl::removeKeysForRelay(Session::SessionId session_id)
+{
+    std::scoped_lock lock(lock_);
+
+    LOG(LS_INFO) << "All keys for relay '" << session_id << "' removed";
+    pool_.erase(session_id);
+    loads_.erase(session_id);
+}
+
+void SharedKeyPool::Impl::clear()
+{
+    std::scoped_lock lock(lock_);
+
+    LOG(LS_INFO) << "Key pool cleared";
+    pool_.clear();
+    loads_.clear();
+}
+
+size_t SharedKeyPool::Impl::countForRelay(Session::SessionId session_id) const
+{
+    std::scoped_lock lock(lock_);
+
+    auto result = pool_.find(session_id);
+    if (result == pool_.end())
+        return 0;
+
+    return result->second.size();
+}
+
+size_t SharedKeyPool::Impl::count() const
+{
+    std::scoped_lock lock(lock_);
+
+    size_t result = 0;
+
+    for (const auto& relay : pool_)
+        result += relay.second.size();
+
+    return result;
+}
+
+bool SharedKeyPool::Impl::isEmpty() const
+{
+    std::scoped_lock lock(lock_);
+    return pool_.empty();
+}
+
+std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeKey()
 {
     if (pool_.empty())
     {
@@ -81,16 +188,27 @@ std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
         return std::nullopt;
     }
 
+    uint64_t max_bytes_per_second = 0;
+    for (const auto& load : loads_)
+        max_bytes_per_second = std::max(max_bytes_per_second, load.second.stat.bytes_per_second());
+
     auto preffered_relay = pool_.end();
-    size_t max_count = 0;
+    double min_load = 0;
 
+    // The least loaded relay is preferred. With equal load the relay with more keys is preferred.
     for (auto it = pool_.begin(); it != pool_.end(); ++it)
     {
         size_t count = it->second.size();
-        if (count > max_count)
+        if (!count)
+            continue;
+
+        double load = loadFactor(it->first, count, max_bytes_per_second);
+
+        if (preffered_relay == pool_.end() || load < min_load ||
+            (load == min_load && count > preffered_relay->second.size()))
         {
             preffered_relay = it;
-            max_count = count;
+            min_load = load;
         }
     }
 
@@ -115,52 +233,45 @@ std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
     // Removing the key from the pool.
     preffered_relay->second.pop_back();
 
+    auto load = loads_.find(credentials.session_id);
+    if (load != loads_.end())
+        ++load->second.taken_keys;
+
     if (preffered_relay->second.empty())
     {
         LOG(LS_INFO) << "Last key in the pool for relay. The relay will be removed from the pool";
         pool_.erase(preffered_relay->first);
     }
 
-    if (delegate_)
-        delegate_->onPoolKeyUsed(credentials.session_id, credentials.key.key_id());
-
     return credentials;
 }
 
-void SharedKeyPool::Impl::removeKeysForRelay(Session::SessionId session_id)
-{
-    LOG(LS_INFO) << "All keys for relay '" << session_id << "' removed";
-    pool_.erase(session_id);
-}
-
-void SharedKeyPool::Impl::clear()
-{
-    LOG(LS_INFO) << "Key pool cleared";
-    pool_.clear();
-}
-
-size_t SharedKeyPool::Impl::countForRelay(Session::SessionId session_id) const
+double SharedKeyPool::Impl::loadFactor(
+    Session::SessionId session_id, size_t key_count, uint64_t max_bytes_per_second) const
 {
-    auto result = pool_.find(session_id);
-    if (result == pool_.end())
+    auto result = loads_.find(session_id);
+    if (result == loads_.end())
         return 0;
 
-    return result->second.size();
-}
+    const Load& load = result->second;
 
-size_t SharedKeyPool::Impl::count() const
-{
-    size_t result = 0;
+    // The relay has a key for each session it can accept, so the used part of its capacity is
+    // the share of the sessions.
+    const double sessions = static_cast<double>(load.stat.active_sessions() + load.taken_keys);
+    const double sessions_load = sessions / (sessions + static_cast<double>(key_count));
 
-    for (const auto& relay : pool_)
-        result += relay.second.size();
+    double traffic_load = 0;
+    if (max_bytes_per_second)
+    {
+        traffic_load = static_cast<double>(load.stat.bytes_per_second()) /
+            static_cast<double>(max_bytes_per_second);
+    }
 
-    return result;
-}
+    const double processor_load = std::min(load.stat.cpu_load(), 100U) / 100.0;
 
-bool SharedKeyPool::Impl::isEmpty() const
-{
-    return pool_.empty();
+    return kSessionsWeight * sessions_load +
+           kTrafficWeight * traffic_load +
+           kProcessorWeight * processor_load;
 }
 
 SharedKeyPool::SharedKeyPool(Delegate* delegate)
@@ -193,6 +304,11 @@ void SharedKeyPool::addKey(Session::SessionId session_id, const proto::RelayKey&
     impl_->addKey(session_id, key);
 }
 
+void SharedKeyPool::setRelayStat(Session::SessionId session_id, const proto::RelayStat& stat)
+{
+    impl_->setRelayStat(session_id, stat);
+}
+
 std::optional<SharedKeyPool::Credentials> SharedKeyPool::takeCredentials()
 {
     return impl_->takeCredentials();
@@ -21,6 +21,7 @@
 
 #include "base/macros_magic.h"
 #include "proto/router_common.pb.h"
+#include "proto/router_relay.pb.h"
 #include "router/session.h"
 
 #include <cstdint>
@@ -52,6 +53,10 @@ public:
     };
 
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
+
+    // Updates the load of the relay. The keys are taken from the least loaded relays.
+    void setRelayStat(Session::SessionId session_id, const proto::RelayStat& stat);
+
     std::optional<Credentials> takeCredentials();
     void removeKeysForRelay(Session::SessionId session_id);
     void clear();
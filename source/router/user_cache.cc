@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/user_cache.h"
+
+#include "base/logging.h"
+#include "base/strings/string_util.h"
+#include "router/database.h"
+
+#include <mutex>
+
+namespace router {
+
+UserCache::UserCache() = default;
+
+UserCache::~UserCache() = default;
+
+void UserCache::load(const Database& database)
+{
+    std::vector<base::User> users = database.userList();
+
+    std::unique_lock lock(lock_);
+
+    users_.clear();
+    names_.clear();
+
+    for (const auto& user : users)
+    {
+        std::u16string name = base::toLower(user.name);
+
+        auto result = users_.emplace(name, user);
+        if (!result.second)
+        {
+            LOG(LS_WARNING) << "Duplicate user name: " << user.name;
+            continue;
+        }
+
+        names_.emplace(user.entry_id, std::move(name));
+    }
+
+    LOG(LS_INFO) << "Users loaded: " << users_.size();
+}
+
+std::optional<base::User> UserCache::find(std::u16string_view username) const
+{
+    std::u16string name = base::toLower(username);
+
+    std::shared_lock lock(lock_);
+
+    auto result = users_.find(name);
+    if (result == users_.end())
+        return std::nullopt;
+
+    return result->second;
+}
+
+std::vector<base::User> UserCache::list() const
+{
+    std::shared_lock lock(lock_);
+
+    std::vector<base::User> users;
+    users.reserve(users_.size());
+
+    for (const auto& user : users_)
+        users.emplace_back(user.second);
+
+    return users;
+}
+
+void UserCache::update(const base::User& user)
+{
+    std::u16string name = base::toLower(user.name);
+
+    std::unique_lock lock(lock_);
+
+    // The user may have been renamed.
+    removeLocked(user.entry_id);
+
+    auto previous = users_.find(name);
+    if (previous != users_.end())
+        names_.erase(previous->second.entry_id);
+
+    users_.insert_or_assign(name, user);
+    names_.insert_or_assign(user.entry_id, std::move(name));
+}
+
+void UserCache::remove(int64_t entry_id)
+{
+    std::unique_lock lock(lock_);
+    removeLocked(entry_id);
+}
+
+void UserCache::removeLocked(int64_t entry_id)
+{
+    auto result = names_.find(entry_id);
+    if (result == names_.end())
+        return;
+
+    users_.erase(result->second);
+    names_.erase(result);
+}
+
+} // namespace router
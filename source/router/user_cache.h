@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__USER_CACHE_H
+#define ROUTER__USER_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/peer/user.h"
+
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace router {
+
+class Database;
+
+// In-memory copy of the users table. It is loaded once when the server starts and is updated by
+// the admin sessions after every successful change of the table, so the authentication does not
+// query the database. The methods can be called from any thread.
+class UserCache
+{
+public:
+    UserCache();
+    ~UserCache();
+
+    // Replaces the content of the cache with the users of |database|.
+    void load(const Database& database);
+
+    std::optional<base::User> find(std::u16string_view username) const;
+    std::vector<base::User> list() const;
+
+    // Adds |user| or replaces the user with the same entry ID.
+    void update(const base::User& user);
+    void remove(int64_t entry_id);
+
+private:
+    void removeLocked(int64_t entry_id);
+
+    mutable std::shared_mutex lock_;
+
+    // Users by their names converted to lower case.
+    std::unordered_map<std::u16string, base::User> users_;
+
+    // Names of the users (the keys of |users_|) by their entry IDs.
+    std::unordered_map<int64_t, std::u16string> names_;
+
+    DISALLOW_COPY_AND_ASSIGN(UserCache);
+};
+
+} // namespace router
+
+#endif // ROUTER__USER_CACHE_H
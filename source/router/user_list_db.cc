@@ -18,37 +18,51 @@
 
 #include "router/user_list_db.h"
 
+#include "base/logging.h"
 #include "router/database.h"
 #include "router/database_factory.h"
+#include "router/user_cache.h"
 
 namespace router {
 
-UserListDb::UserListDb(std::unique_ptr<Database> db)
-    : db_(std::move(db))
+UserListDb::UserListDb(std::shared_ptr<DatabaseFactory> factory,
+                       std::shared_ptr<UserCache> cache)
+    : factory_(std::move(factory)),
+      cache_(std::move(cache))
 {
-    // Nothing
+    DCHECK(factory_ && cache_);
 }
 
 UserListDb::~UserListDb() = default;
 
 // static
-std::unique_ptr<UserListDb> UserListDb::open(const DatabaseFactory& factory)
+std::unique_ptr<UserListDb> UserListDb::open(std::shared_ptr<DatabaseFactory> factory,
+                                             std::shared_ptr<UserCache> cache)
 {
-    std::unique_ptr<Database> db = factory.openDatabase();
-    if (!db)
-        return nullptr;
-
-    return std::unique_ptr<UserListDb>(new UserListDb(std::move(db)));
+    return std::unique_ptr<UserListDb>(new UserListDb(std::move(factory), std::move(cache)));
 }
 
 void UserListDb::add(const base::User& user)
 {
-    db_->addUser(user);
+    std::unique_ptr<Database> db = factory_->openDatabase();
+    if (!db)
+    {
+        LOG(LS_ERROR) << "Failed to connect to database";
+        return;
+    }
+
+    if (!db->addUser(user))
+        return;
+
+    // The entry ID is assigned by the database.
+    base::User stored_user = db->findUser(user.name);
+    if (stored_user.isValid())
+        cache_->update(stored_user);
 }
 
 base::User UserListDb::find(std::u16string_view username) const
 {
-    return db_->findUser(username);
+    return cache_->find(username).value_or(base::User::kInvalidUser);
 }
 
 const base::ByteArray& UserListDb::seedKey() const
@@ -63,7 +77,7 @@ void UserListDb::setSeedKey(const base::ByteArray& seed_key)
 
 std::vector<base::User> UserListDb::list() const
 {
-    return db_->userList();
+    return cache_->list();
 }
 
 } // namespace router
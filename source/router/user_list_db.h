@@ -24,15 +24,17 @@
 
 namespace router {
 
-class Database;
 class DatabaseFactory;
+class UserCache;
 
+// Looks up the users in the cache shared by all shards. New users are written to the database.
 class UserListDb : public base::UserListBase
 {
 public:
     ~UserListDb();
 
-    static std::unique_ptr<UserListDb> open(const DatabaseFactory& factory);
+    static std::unique_ptr<UserListDb> open(std::shared_ptr<DatabaseFactory> factory,
+                                            std::shared_ptr<UserCache> cache);
 
     // base::UserListBase implementation.
     void add(const base::User& user) override;
@@ -42,9 +44,11 @@ public:
     std::vector<base::User> list() const override;
 
 private:
-    explicit UserListDb(std::unique_ptr<Database> db);
+    UserListDb(std::shared_ptr<DatabaseFactory> factory, std::shared_ptr<UserCache> cache);
 
-    std::unique_ptr<Database> db_;
+    // The database is opened only to add users, so the list does not hold a connection.
+    std::shared_ptr<DatabaseFactory> factory_;
+    std::shared_ptr<UserCache> cache_;
     base::ByteArray seed_key_;
 
     DISALLOW_COPY_AND_ASSIGN(UserListDb);
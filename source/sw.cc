@@ -103,6 +103,7 @@ void build(Solution &s)
     base.Public += "org.sw.demo.google.protobuf.protobuf_lite"_dep;
     base.Public += "org.sw.demo.chromium.libyuv-master"_dep;
     base.Public += "org.sw.demo.webmproject.vpx"_dep;
+    base.Public += "org.sw.demo.webmproject.webm"_dep;
     if (base.getBuildSettings().TargetOS.Type == OSType::Windows)
     {
         base -= "x11/.*"_rr;
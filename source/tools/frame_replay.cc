@@ -0,0 +1,410 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/sample_window.h"
+#include "base/codec/scale_reducer.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/desktop/differ.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/desktop/frame_trace_reader.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_printf.h"
+#include "base/strings/unicode.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+enum class DifferMode
+{
+    // All blocks of the frame are compared, as the capturers without the dirty rects do.
+    FULL,
+
+    // Only the blocks of the recorded updated region are compared.
+    HINT,
+
+    // The recorded updated region is used as is.
+    NONE
+};
+
+struct Options
+{
+    std::filesystem::path trace_path;
+    std::string codec = "vp8";
+    DifferMode differ_mode = DifferMode::HINT;
+    int scale = 100;
+    int loops = 1;
+};
+
+const size_t kFrameAlignment = 32;
+const size_t kMaxSamples = 1000000;
+
+using Clock = std::chrono::steady_clock;
+
+void showHelp()
+{
+    std::cout << "aspia_frame_replay --trace=<file> [switches]" << std::endl
+        << "Replays a frame trace recorded by the host through the differ, the scale reducer and"
+        << " the video encoder at maximum speed." << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--trace=<file>" << '\t' << "Frame trace to replay" << std::endl
+        << '\t' << "--codec=<vp8|vp9|vp9_i444|zstd>" << '\t' << "Video encoder (vp8)" << std::endl
+        << '\t' << "--differ=<full|hint|none>" << '\t' << "Differ mode (hint)" << std::endl
+        << '\t' << "--scale=<percent>" << '\t' << "Target size of the scale reducer (100)"
+        << std::endl
+        << '\t' << "--loops=<count>" << '\t' << "Number of passes over the trace (1)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool parseOptions(const base::CommandLine& command_line, Options* options)
+{
+    if (!command_line.hasSwitch(u"trace"))
+    {
+        std::cout << "The trace file is not specified." << std::endl;
+        return false;
+    }
+
+    options->trace_path = command_line.switchValuePath(u"trace");
+
+    if (command_line.hasSwitch(u"codec"))
+        options->codec = base::utf8FromUtf16(command_line.switchValue(u"codec"));
+
+    if (command_line.hasSwitch(u"differ"))
+    {
+        const std::u16string& mode = command_line.switchValue(u"differ");
+
+        if (mode == u"full")
+        {
+            options->differ_mode = DifferMode::FULL;
+        }
+        else if (mode == u"hint")
+        {
+            options->differ_mode = DifferMode::HINT;
+        }
+        else if (mode == u"none")
+        {
+            options->differ_mode = DifferMode::NONE;
+        }
+        else
+        {
+            std::cout << "Invalid differ mode." << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"scale"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"scale"), &options->scale) ||
+            options->scale <= 0 || options->scale > 100)
+        {
+            std::cout << "Invalid scale." << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"loops"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"loops"), &options->loops) ||
+            options->loops <= 0)
+        {
+            std::cout << "Invalid number of loops." << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr<base::VideoEncoder> createEncoder(const std::string& codec)
+{
+    if (codec == "vp8")
+        return base::VideoEncoderVPX::createVP8();
+
+    if (codec == "vp9")
+        return base::VideoEncoderVPX::createVP9();
+
+    if (codec == "vp9_i444")
+        return base::VideoEncoderVPX::createVP9I444();
+
+    if (codec == "zstd")
+        return base::VideoEncoderZstd::create();
+
+    return nullptr;
+}
+
+int64_t elapsedUs(const Clock::time_point& start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+std::string percentilesToString(const base::SampleWindow& samples)
+{
+    if (samples.isEmpty())
+        return "-";
+
+    return base::stringPrintf("p50 %.2f ms, p95 %.2f ms, p99 %.2f ms",
+                              static_cast<double>(samples.percentile(50)) / 1000.0,
+                              static_cast<double>(samples.percentile(95)) / 1000.0,
+                              static_cast<double>(samples.percentile(99)) / 1000.0);
+}
+
+class Replay
+{
+public:
+    explicit Replay(const Options& options)
+        : options_(options),
+          capture_time_(kMaxSamples),
+          differ_time_(kMaxSamples),
+          scale_time_(kMaxSamples),
+          encode_time_(kMaxSamples)
+    {
+        // Nothing
+    }
+
+    bool run();
+    void printResults() const;
+
+private:
+    void processFrame(const base::Frame* frame);
+    void resetForSize(const base::Size& size);
+
+    const Options options_;
+
+    std::unique_ptr<base::Frame> work_frame_;
+    std::unique_ptr<base::Differ> differ_;
+    std::unique_ptr<base::ScaleReducer> scale_reducer_;
+    std::unique_ptr<base::VideoEncoder> encoder_;
+    proto::VideoPacket packet_;
+
+    base::SampleWindow capture_time_;
+    base::SampleWindow differ_time_;
+    base::SampleWindow scale_time_;
+    base::SampleWindow encode_time_;
+
+    int64_t frame_count_ = 0;
+    int64_t encoded_bytes_ = 0;
+    int64_t replay_time_ = 0;
+    int64_t first_capture_time_ = 0;
+    int64_t last_capture_time_ = 0;
+    base::Size size_;
+
+    DISALLOW_COPY_AND_ASSIGN(Replay);
+};
+
+bool Replay::run()
+{
+    encoder_ = createEncoder(options_.codec);
+    if (!encoder_)
+    {
+        std::cout << "Unsupported codec: " << options_.codec << std::endl;
+        return false;
+    }
+
+    const Clock::time_point start_time = Clock::now();
+
+    for (int loop = 0; loop < options_.loops; ++loop)
+    {
+        std::unique_ptr<base::FrameTraceReader> reader =
+            base::FrameTraceReader::open(options_.trace_path);
+        if (!reader)
+        {
+            std::cout << "Unable to open the trace." << std::endl;
+            return false;
+        }
+
+        // Each pass starts with a key frame.
+        work_frame_.reset();
+
+        while (const base::Frame* frame = reader->readFrame())
+        {
+            if (loop == 0)
+            {
+                // The recorded times are the same for every pass.
+                if (frame->captureTime() && frame->diffTime() >= frame->captureTime())
+                    capture_time_.add(frame->diffTime() - frame->captureTime());
+
+                if (!first_capture_time_)
+                    first_capture_time_ = frame->captureTime();
+                last_capture_time_ = frame->captureTime();
+            }
+
+            processFrame(frame);
+        }
+
+        if (reader->hasError())
+        {
+            std::cout << "The trace is corrupted. Only the frames before the error are used."
+                      << std::endl;
+        }
+    }
+
+    replay_time_ = elapsedUs(start_time);
+    return frame_count_ != 0;
+}
+
+void Replay::processFrame(const base::Frame* frame)
+{
+    base::Region updated_region;
+
+    if (!work_frame_ || work_frame_->size() != frame->size())
+    {
+        resetForSize(frame->size());
+        updated_region.setRect(base::Rect::makeSize(frame->size()));
+    }
+    else if (options_.differ_mode == DifferMode::NONE)
+    {
+        updated_region = frame->constUpdatedRegion();
+    }
+    else
+    {
+        // |work_frame_| still contains the previous frame.
+        const Clock::time_point start_time = Clock::now();
+
+        if (options_.differ_mode == DifferMode::FULL)
+        {
+            differ_->calcDirtyRegion(
+                work_frame_->frameData(), frame->frameData(), &updated_region);
+        }
+        else
+        {
+            differ_->calcDirtyRegion(work_frame_->frameData(), frame->frameData(),
+                                            frame->constUpdatedRegion(), &updated_region);
+        }
+
+        differ_time_.add(elapsedUs(start_time));
+    }
+
+    // The pixels of the trace frame can differ from the previous one only in the recorded region.
+    for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        work_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+
+    *work_frame_->updatedRegion() = updated_region;
+    ++frame_count_;
+
+    if (updated_region.isEmpty())
+        return;
+
+    const base::Frame* encode_frame = work_frame_.get();
+
+    if (scale_reducer_)
+    {
+        const base::Size target_size(frame->size().width() * options_.scale / 100,
+                                     frame->size().height() * options_.scale / 100);
+
+        const Clock::time_point start_time = Clock::now();
+        encode_frame = scale_reducer_->scaleFrame(work_frame_.get(), target_size);
+        scale_time_.add(elapsedUs(start_time));
+
+        if (!encode_frame)
+            return;
+    }
+
+    packet_.Clear();
+
+    const Clock::time_point start_time = Clock::now();
+    encoder_->encode(encode_frame, &packet_);
+    encode_time_.add(elapsedUs(start_time));
+
+    encoded_bytes_ += static_cast<int64_t>(packet_.ByteSizeLong());
+}
+
+void Replay::resetForSize(const base::Size& size)
+{
+    size_ = size;
+    work_frame_ = base::FrameAligned::create(size, kFrameAlignment);
+    differ_ = std::make_unique<base::Differ>(size);
+
+    if (options_.scale != 100)
+        scale_reducer_ = std::make_unique<base::ScaleReducer>();
+
+    encoder_->setKeyFrameRequired();
+}
+
+void Replay::printResults() const
+{
+    const double replay_seconds = static_cast<double>(replay_time_) / 1000000.0;
+    const double recorded_seconds =
+        static_cast<double>(last_capture_time_ - first_capture_time_) / 1000000.0;
+
+    std::cout << "Trace: " << options_.trace_path.u8string() << std::endl
+              << "Frames: " << frame_count_ << " (" << options_.loops << " loops), last size: "
+              << size_ << std::endl
+              << "Codec: " << options_.codec << ", scale: " << options_.scale << '%' << std::endl
+              << std::endl
+              << "Capture (recorded): " << percentilesToString(capture_time_) << std::endl
+              << "Differ: " << percentilesToString(differ_time_) << std::endl
+              << "Scale: " << percentilesToString(scale_time_) << std::endl
+              << "Encode: " << percentilesToString(encode_time_) << std::endl
+              << std::endl
+              << base::stringPrintf("Replay: %.2f s, %.1f fps", replay_seconds,
+                                    static_cast<double>(frame_count_) / replay_seconds)
+              << std::endl;
+
+    if (recorded_seconds > 0)
+    {
+        // The bitrate the encoded video would have at the recorded frame rate.
+        const double bitrate = static_cast<double>(encoded_bytes_) * 8 / options_.loops /
+                               recorded_seconds / 1000;
+
+        std::cout << base::stringPrintf("Recorded: %.2f s, encoded bitrate: %.0f kbps",
+                                        recorded_seconds, bitrate) << std::endl;
+    }
+
+    std::cout << "Encoded: " << encoded_bytes_ << " bytes" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::LoggingSettings logging_settings;
+    logging_settings.min_log_level = base::LOG_LS_WARNING;
+    base::initLogging(logging_settings);
+
+    base::CommandLine command_line(argc, argv);
+    int result = 0;
+    Options options;
+
+    if (command_line.hasSwitch(u"help"))
+    {
+        showHelp();
+    }
+    else if (!parseOptions(command_line, &options))
+    {
+        showHelp();
+        result = 1;
+    }
+    else
+    {
+        Replay replay(options);
+
+        if (replay.run())
+            replay.printResults();
+        else
+            result = 1;
+    }
+
+    base::shutdownLogging();
+    return result;
+}
@@ -0,0 +1,430 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/sample_window.h"
+#include "base/system_time.h"
+#include "base/task_runner.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/memory/byte_array.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_printf.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    std::u16string address;
+    uint16_t port = DEFAULT_HOST_TCP_PORT;
+    std::u16string username;
+    std::u16string password;
+    proto::SessionType session_type = proto::SESSION_TYPE_DESKTOP_VIEW;
+    proto::VideoEncoding video_encoding = proto::VIDEO_ENCODING_VP8;
+    int clients = 1;
+    int duration = 60;
+};
+
+const size_t kMaxSamples = 100000;
+
+// The clock offset of the host is estimated from the keep alive exchange.
+const std::chrono::seconds kKeepAliveInterval(5);
+
+// The connections are started one after another, so the host does not get all handshakes at once.
+const std::chrono::milliseconds kConnectInterval(100);
+
+void showHelp()
+{
+    std::cout << "aspia_load_client --address=<host> --user=<name> --password=<password> [switches]"
+              << std::endl
+        << "Connects several clients to the host and reports the latency and the throughput of the"
+        << " video of each client. The video is not decoded." << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--address=<host>" << '\t' << "Address of the host" << std::endl
+        << '\t' << "--port=<port>" << '\t' << "TCP port of the host (" << DEFAULT_HOST_TCP_PORT
+        << ")" << std::endl
+        << '\t' << "--user=<name>" << '\t' << "User name" << std::endl
+        << '\t' << "--password=<password>" << '\t' << "Password" << std::endl
+        << '\t' << "--clients=<count>" << '\t' << "Number of clients (1)" << std::endl
+        << '\t' << "--duration=<seconds>" << '\t' << "Duration of the test (60)" << std::endl
+        << '\t' << "--codec=<vp8|vp9>" << '\t' << "Video encoding (vp8)" << std::endl
+        << '\t' << "--manage" << '\t' << "Use the desktop manage sessions instead of view"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool parseOptions(const base::CommandLine& command_line, Options* options)
+{
+    if (!command_line.hasSwitch(u"address") || !command_line.hasSwitch(u"user"))
+    {
+        std::cout << "The address of the host or the user name is not specified." << std::endl;
+        return false;
+    }
+
+    options->address = command_line.switchValue(u"address");
+    options->username = command_line.switchValue(u"user");
+    options->password = command_line.switchValue(u"password");
+
+    if (command_line.hasSwitch(u"port"))
+    {
+        int port = 0;
+        if (!base::stringToInt(command_line.switchValue(u"port"), &port) ||
+            port <= 0 || port > 65535)
+        {
+            std::cout << "Invalid port." << std::endl;
+            return false;
+        }
+
+        options->port = static_cast<uint16_t>(port);
+    }
+
+    if (command_line.hasSwitch(u"clients"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"clients"), &options->clients) ||
+            options->clients <= 0)
+        {
+            std::cout << "Invalid number of clients." << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"duration"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"duration"), &options->duration) ||
+            options->duration <= 0)
+        {
+            std::cout << "Invalid duration." << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"codec"))
+    {
+        const std::u16string& codec = command_line.switchValue(u"codec");
+
+        if (codec == u"vp8")
+        {
+            options->video_encoding = proto::VIDEO_ENCODING_VP8;
+        }
+        else if (codec == u"vp9")
+        {
+            options->video_encoding = proto::VIDEO_ENCODING_VP9;
+        }
+        else
+        {
+            std::cout << "Invalid codec." << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"manage"))
+        options->session_type = proto::SESSION_TYPE_DESKTOP_MANAGE;
+
+    return true;
+}
+
+std::string percentilesToString(const base::SampleWindow& samples)
+{
+    if (samples.isEmpty())
+        return "-";
+
+    return base::stringPrintf("p50 %.1f ms, p95 %.1f ms, p99 %.1f ms",
+                              static_cast<double>(samples.percentile(50)) / 1000.0,
+                              static_cast<double>(samples.percentile(95)) / 1000.0,
+                              static_cast<double>(samples.percentile(99)) / 1000.0);
+}
+
+// Headless client of a desktop session. It authenticates as the real client does, answers the
+// configuration requests of the host and only counts the received video packets.
+class LoadClient : public base::NetworkChannel::Listener
+{
+public:
+    LoadClient(int index, const Options& options, std::shared_ptr<base::TaskRunner> task_runner)
+        : index_(index),
+          options_(options),
+          task_runner_(std::move(task_runner)),
+          host_latency_(kMaxSamples),
+          network_latency_(kMaxSamples),
+          total_latency_(kMaxSamples)
+    {
+        // Nothing
+    }
+
+    void start();
+    void finish();
+    void printResults() const;
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void onAuthenticated();
+    void readConfigRequest();
+    void readVideoPacket(const proto::VideoPacket& packet);
+
+    const int index_;
+    const Options& options_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    std::unique_ptr<base::NetworkChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+
+    proto::HostToClient incoming_message_;
+    proto::ClientToHost outgoing_message_;
+
+    std::string status_ = "Connecting";
+    int64_t connect_time_ = 0;
+    int64_t start_time_ = 0;
+    int64_t finish_time_ = 0;
+
+    int64_t video_packets_ = 0;
+    int64_t video_bytes_ = 0;
+    int64_t total_rx_ = 0;
+
+    base::SampleWindow host_latency_;    // From the capture to the sending on the host.
+    base::SampleWindow network_latency_; // From the sending on the host to the receiving.
+    base::SampleWindow total_latency_;   // From the capture to the receiving.
+
+    DISALLOW_COPY_AND_ASSIGN(LoadClient);
+};
+
+void LoadClient::start()
+{
+    connect_time_ = base::SystemTime::microsecondsSinceEpoch();
+
+    channel_ = std::make_unique<base::NetworkChannel>();
+    channel_->setListener(this);
+    channel_->connect(options_.address, options_.port);
+}
+
+void LoadClient::finish()
+{
+    if (channel_)
+        total_rx_ = channel_->totalRx();
+
+    if (start_time_ && !finish_time_)
+        finish_time_ = base::SystemTime::microsecondsSinceEpoch();
+
+    authenticator_.reset();
+    channel_.reset();
+}
+
+void LoadClient::printResults() const
+{
+    std::cout << "Client " << index_ << ": " << status_ << std::endl;
+
+    if (!start_time_)
+        return;
+
+    const double seconds = static_cast<double>(finish_time_ - start_time_) / 1000000.0;
+    if (seconds <= 0)
+        return;
+
+    std::cout << base::stringPrintf(
+        "  Connect: %.1f ms, video: %.1f fps, %.0f kbps, received: %.0f kbps",
+        static_cast<double>(start_time_ - connect_time_) / 1000.0,
+        static_cast<double>(video_packets_) / seconds,
+        static_cast<double>(video_bytes_) * 8 / seconds / 1000,
+        static_cast<double>(total_rx_) * 8 / seconds / 1000) << std::endl
+              << "  Host latency: " << percentilesToString(host_latency_) << std::endl
+              << "  Network latency: " << percentilesToString(network_latency_) << std::endl
+              << "  Total latency: " << percentilesToString(total_latency_) << std::endl;
+}
+
+void LoadClient::onConnected()
+{
+    static const size_t kReadBufferSize = 2 * 1024 * 1024; // 2 Mb.
+
+    channel_->setReadBufferSize(kReadBufferSize);
+    channel_->setNoDelay(true);
+
+    status_ = "Authenticating";
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_SRP);
+    authenticator_->setUserName(options_.username);
+    authenticator_->setPassword(options_.password);
+    authenticator_->setSessionType(options_.session_type);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            onAuthenticated();
+        }
+        else
+        {
+            status_ = base::stringPrintf(
+                "Authentication failed: %s", base::Authenticator::errorToString(error_code));
+        }
+
+        // Authenticator is no longer needed.
+        task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void LoadClient::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    status_ = "Disconnected: " + base::NetworkChannel::errorToString(error_code);
+    finish();
+}
+
+void LoadClient::onMessageReceived(const base::ByteArray& buffer)
+{
+    incoming_message_.Clear();
+
+    if (!base::parse(buffer, &incoming_message_))
+    {
+        LOG(LS_ERROR) << "Invalid message from host";
+        return;
+    }
+
+    if (incoming_message_.has_video_packet())
+        readVideoPacket(incoming_message_.video_packet());
+    else if (incoming_message_.has_config_request())
+        readConfigRequest();
+}
+
+void LoadClient::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void LoadClient::onAuthenticated()
+{
+    status_ = "Connected";
+    start_time_ = base::SystemTime::microsecondsSinceEpoch();
+
+    channel_ = authenticator_->takeChannel();
+    channel_->setListener(this);
+    channel_->setOwnKeepAlive(true, kKeepAliveInterval);
+    channel_->resume();
+}
+
+void LoadClient::readConfigRequest()
+{
+    outgoing_message_.Clear();
+
+    proto::DesktopConfig* config = outgoing_message_.mutable_config();
+    config->set_video_encoding(options_.video_encoding);
+    config->set_update_interval(30);
+    config->set_scale_factor(100);
+
+    channel_->send(base::serialize(outgoing_message_));
+}
+
+void LoadClient::readVideoPacket(const proto::VideoPacket& packet)
+{
+    const int64_t receive_time = base::SystemTime::microsecondsSinceEpoch();
+
+    ++video_packets_;
+    video_bytes_ += static_cast<int64_t>(packet.data().size());
+
+    if (!packet.has_timestamps())
+        return;
+
+    const proto::VideoPacketTimestamps& timestamps = packet.timestamps();
+    if (!timestamps.capture_time() || !timestamps.send_time())
+        return;
+
+    host_latency_.add(timestamps.send_time() - timestamps.capture_time());
+
+    // The times of the host are converted to the local clock.
+    const std::optional<int64_t> clock_offset = channel_->clockOffset();
+    if (!clock_offset.has_value())
+        return;
+
+    network_latency_.add(receive_time - (timestamps.send_time() - *clock_offset));
+    total_latency_.add(receive_time - (timestamps.capture_time() - *clock_offset));
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::LoggingSettings logging_settings;
+    logging_settings.min_log_level = base::LOG_LS_WARNING;
+    base::initLogging(logging_settings);
+
+    base::CommandLine command_line(argc, argv);
+    int result = 0;
+    Options options;
+
+    if (command_line.hasSwitch(u"help"))
+    {
+        showHelp();
+    }
+    else if (!parseOptions(command_line, &options))
+    {
+        showHelp();
+        result = 1;
+    }
+    else
+    {
+        std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+            std::make_unique<base::ScopedCryptoInitializer>();
+
+        std::unique_ptr<base::MessageLoop> message_loop =
+            std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+        std::shared_ptr<base::TaskRunner> task_runner = message_loop->taskRunner();
+
+        std::vector<std::unique_ptr<LoadClient>> clients;
+        for (int i = 0; i < options.clients; ++i)
+        {
+            clients.emplace_back(std::make_unique<LoadClient>(i + 1, options, task_runner));
+
+            task_runner->postDelayedTask(
+                std::bind(&LoadClient::start, clients.back().get()), kConnectInterval * i);
+        }
+
+        task_runner->postDelayedTask([&clients, task_runner]()
+        {
+            for (auto& client : clients)
+                client->finish();
+
+            task_runner->postQuit();
+        }, kConnectInterval * options.clients + std::chrono::seconds(options.duration));
+
+        message_loop->run();
+
+        for (const auto& client : clients)
+            client->printResults();
+
+        clients.clear();
+        message_loop.reset();
+        crypto_initializer.reset();
+    }
+
+    base::shutdownLogging();
+    return result;
+}
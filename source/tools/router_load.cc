@@ -0,0 +1,991 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/sample_window.h"
+#include "base/system_time.h"
+#include "base/task_runner.h"
+#include "base/waitable_timer.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/memory/byte_array.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
+#include "base/peer/host_id.h"
+#include "base/peer/relay_peer.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_printf.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+#include "proto/router_peer.pb.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+    std::u16string address;
+    uint16_t port = DEFAULT_ROUTER_TCP_PORT;
+    base::ByteArray public_key;
+    std::u16string username;
+    std::u16string password;
+
+    int hosts = 1000;
+    int pairs = 100;
+    int rate = 500;
+    int message_size = 16 * 1024;
+    int duration = 30;
+    int timeout = 60;
+    int keep_alive = 45;
+
+    int router_pid = 0;
+    int relay_pid = 0;
+
+    // Thresholds of the regression gate. Zero if not checked.
+    int min_accept_rate = 0; // Hosts per second.
+    int max_auth_p99 = 0;    // Milliseconds.
+    int min_mbps = 0;
+};
+
+const size_t kMaxSamples = 1000000;
+
+// Number of the messages which the host of a pair keeps in the queue of the relay channel.
+const size_t kStreamWindow = 16;
+
+void showHelp()
+{
+    std::cout << "aspia_router_load --address=<router> --key=<hex> --user=<name> --password=<pass>"
+              << " [switches]" << std::endl
+        << "Registers many hosts on the router, connects clients to some of them through the relay"
+        << " and streams data between the peers of each pair." << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--address=<router>" << '\t' << "Address of the router" << std::endl
+        << '\t' << "--port=<port>" << '\t' << "TCP port of the router (" << DEFAULT_ROUTER_TCP_PORT
+        << ")" << std::endl
+        << '\t' << "--key=<hex>" << '\t' << "Public key of the router" << std::endl
+        << '\t' << "--user=<name>" << '\t' << "User of the router for the clients" << std::endl
+        << '\t' << "--password=<pass>" << '\t' << "Password of the user" << std::endl
+        << '\t' << "--hosts=<count>" << '\t' << "Number of hosts (1000)" << std::endl
+        << '\t' << "--pairs=<count>" << '\t' << "Number of relayed sessions (100)" << std::endl
+        << '\t' << "--rate=<count>" << '\t' << "New connections per second (500)" << std::endl
+        << '\t' << "--message-size=<bytes>" << '\t' << "Size of the streamed messages (16384)"
+        << std::endl
+        << '\t' << "--duration=<seconds>" << '\t' << "Duration of the streaming (30)" << std::endl
+        << '\t' << "--timeout=<seconds>" << '\t' << "Timeout of the registration and the pairing"
+        << " (60)" << std::endl
+        << '\t' << "--keep-alive=<seconds>" << '\t' << "Keep alive interval of the peers (45)"
+        << std::endl
+        << '\t' << "--router-pid=<pid>" << '\t' << "Process of the router for the memory usage"
+        << std::endl
+        << '\t' << "--relay-pid=<pid>" << '\t' << "Process of the relay for the memory usage"
+        << std::endl
+        << '\t' << "--min-accept-rate=<count>" << '\t' << "Fail if fewer hosts per second are"
+        << " registered" << std::endl
+        << '\t' << "--max-auth-p99=<ms>" << '\t' << "Fail if the 99th percentile of the"
+        << " authentication is longer" << std::endl
+        << '\t' << "--min-mbps=<value>" << '\t' << "Fail if the forwarding is slower (Mbit/s)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool parseInt(const base::CommandLine& command_line, std::u16string_view name, int min_value,
+              int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    if (!base::stringToInt(command_line.switchValue(name), value) || *value < min_value)
+    {
+        std::cout << "Invalid value of --" << base::utf8FromUtf16(name) << '.' << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool parseOptions(const base::CommandLine& command_line, Options* options)
+{
+    if (!command_line.hasSwitch(u"address") || !command_line.hasSwitch(u"key") ||
+        !command_line.hasSwitch(u"user"))
+    {
+        std::cout << "The address, the key or the user of the router is not specified."
+                  << std::endl;
+        return false;
+    }
+
+    options->address = command_line.switchValue(u"address");
+    options->public_key = base::fromHex(base::utf8FromUtf16(command_line.switchValue(u"key")));
+    options->username = command_line.switchValue(u"user");
+    options->password = command_line.switchValue(u"password");
+
+    if (options->public_key.empty())
+    {
+        std::cout << "Invalid public key." << std::endl;
+        return false;
+    }
+
+    int port = options->port;
+    if (!parseInt(command_line, u"port", 1, &port) || port > 65535)
+        return false;
+    options->port = static_cast<uint16_t>(port);
+
+    if (!parseInt(command_line, u"hosts", 1, &options->hosts) ||
+        !parseInt(command_line, u"pairs", 0, &options->pairs) ||
+        !parseInt(command_line, u"rate", 1, &options->rate) ||
+        !parseInt(command_line, u"message-size", 1, &options->message_size) ||
+        !parseInt(command_line, u"duration", 1, &options->duration) ||
+        !parseInt(command_line, u"timeout", 1, &options->timeout) ||
+        !parseInt(command_line, u"keep-alive", 1, &options->keep_alive) ||
+        !parseInt(command_line, u"router-pid", 0, &options->router_pid) ||
+        !parseInt(command_line, u"relay-pid", 0, &options->relay_pid) ||
+        !parseInt(command_line, u"min-accept-rate", 0, &options->min_accept_rate) ||
+        !parseInt(command_line, u"max-auth-p99", 0, &options->max_auth_p99) ||
+        !parseInt(command_line, u"min-mbps", 0, &options->min_mbps))
+    {
+        return false;
+    }
+
+    if (options->pairs > options->hosts)
+    {
+        std::cout << "The number of pairs is greater than the number of hosts." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::string percentilesToString(const base::SampleWindow& samples)
+{
+    if (samples.isEmpty())
+        return "-";
+
+    return base::stringPrintf("p50 %.1f ms, p95 %.1f ms, p99 %.1f ms (%zu)",
+                              static_cast<double>(samples.percentile(50)) / 1000.0,
+                              static_cast<double>(samples.percentile(95)) / 1000.0,
+                              static_cast<double>(samples.percentile(99)) / 1000.0,
+                              samples.count());
+}
+
+// Returns the resident memory of the process |pid| in bytes or 0 if it is unknown.
+int64_t residentMemory(int pid)
+{
+#if defined(OS_LINUX)
+    if (!pid)
+        return 0;
+
+    static const std::string kPrefix = "VmRSS:";
+
+    std::ifstream stream("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+
+    while (std::getline(stream, line))
+    {
+        if (line.compare(0, kPrefix.size(), kPrefix) != 0)
+            continue;
+
+        // The value is in kilobytes.
+        int64_t kilobytes = 0;
+        std::istringstream(line.substr(kPrefix.size())) >> kilobytes;
+        return kilobytes * 1024;
+    }
+#endif // defined(OS_LINUX)
+
+    return 0;
+}
+
+int64_t now()
+{
+    return base::SystemTime::microsecondsSinceEpoch();
+}
+
+class Harness;
+
+// Connection of a peer to the router. The hosts are authenticated anonymously, the clients with
+// the user of the router, as the real peers are.
+class RouterPeer : public base::NetworkChannel::Listener
+{
+public:
+    RouterPeer(Harness* harness, proto::RouterSession session_type);
+    virtual ~RouterPeer() = default;
+
+    void connect();
+    void send(const google::protobuf::MessageLite& message);
+
+protected:
+    virtual void onAuthenticated() = 0;
+    virtual void onRouterMessage(const proto::RouterToPeer& message) = 0;
+    virtual void onFailed() = 0;
+
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+    Harness* harness_;
+
+private:
+    const proto::RouterSession session_type_;
+
+    std::unique_ptr<base::NetworkChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    int64_t connect_start_time_ = 0;
+    int64_t auth_start_time_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(RouterPeer);
+};
+
+// One end of a relayed session. The host end streams the messages as fast as the relay forwards
+// them, the client end counts them.
+class RelayStream
+    : public base::RelayPeer::Delegate,
+      public base::NetworkChannel::Listener
+{
+public:
+    RelayStream(Harness* harness, bool is_sender);
+    ~RelayStream() = default;
+
+    void start(const proto::RelayCredentials& credentials);
+
+protected:
+    // base::RelayPeer::Delegate implementation.
+    void onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel) override;
+    void onRelayConnectionError() override;
+
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void sendMessages();
+
+    Harness* harness_;
+    const bool is_sender_;
+    bool is_streaming_ = false;
+    int64_t start_time_ = 0;
+
+    std::unique_ptr<base::RelayPeer> relay_peer_;
+    std::unique_ptr<base::NetworkChannel> channel_;
+
+    DISALLOW_COPY_AND_ASSIGN(RelayStream);
+};
+
+class Host : public RouterPeer
+{
+public:
+    explicit Host(Harness* harness)
+        : RouterPeer(harness, proto::ROUTER_SESSION_HOST)
+    {
+        // Nothing
+    }
+
+    base::HostId hostId() const { return host_id_; }
+
+protected:
+    // RouterPeer implementation.
+    void onAuthenticated() override;
+    void onRouterMessage(const proto::RouterToPeer& message) override;
+    void onFailed() override;
+
+private:
+    base::HostId host_id_ = base::kInvalidHostId;
+    int64_t request_time_ = 0;
+    std::unique_ptr<RelayStream> stream_;
+};
+
+class Client : public RouterPeer
+{
+public:
+    Client(Harness* harness, base::HostId host_id)
+        : RouterPeer(harness, proto::ROUTER_SESSION_CLIENT),
+          host_id_(host_id)
+    {
+        // Nothing
+    }
+
+protected:
+    // RouterPeer implementation.
+    void onAuthenticated() override;
+    void onRouterMessage(const proto::RouterToPeer& message) override;
+    void onFailed() override;
+
+private:
+    const base::HostId host_id_;
+    int64_t request_time_ = 0;
+    std::unique_ptr<RelayStream> stream_;
+};
+
+class Harness
+{
+public:
+    Harness(const Options& options, std::shared_ptr<base::TaskRunner> task_runner);
+
+    void start();
+    bool printResults() const;
+
+    const Options& options() const { return options_; }
+    std::shared_ptr<base::TaskRunner> taskRunner() const { return task_runner_; }
+    const base::ByteArray& payload() const { return payload_; }
+
+    void onTcpConnected(int64_t latency) { connect_latency_.add(latency); }
+    void onAuthenticated(proto::RouterSession session_type, int64_t latency);
+    void onHostRegistered(int64_t latency);
+    void onOfferReceived(int64_t latency) { offer_latency_.add(latency); }
+    void onPeerFailed(proto::RouterSession session_type);
+    void onHostLost() { ++lost_hosts_; }
+
+    void onRelayConnected(int64_t latency);
+    void onRelayFailed(bool is_sender);
+    void onStreamStarted();
+    void onBytesReceived(size_t bytes);
+
+private:
+    enum class Phase { REGISTRATION, PAIRING, STREAMING, FINISHED };
+
+    void startNextHosts();
+    void startNextClients();
+    void checkRegistration();
+    void checkPairing();
+    void startPairing();
+    void startStreaming();
+    void finish();
+
+    const Options options_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    base::WaitableTimer timer_;
+    base::ByteArray payload_;
+
+    Phase phase_ = Phase::REGISTRATION;
+
+    std::vector<std::unique_ptr<Host>> hosts_;
+    std::vector<std::unique_ptr<Client>> clients_;
+
+    base::SampleWindow connect_latency_;
+    base::SampleWindow host_auth_latency_;
+    base::SampleWindow client_auth_latency_;
+    base::SampleWindow host_id_latency_;
+    base::SampleWindow offer_latency_;
+    base::SampleWindow relay_latency_;
+
+    int registered_hosts_ = 0;
+    int failed_hosts_ = 0;
+    int lost_hosts_ = 0;
+    size_t next_host_ = 0;
+    int pair_count_ = 0;
+    int failed_pairs_ = 0;
+    int relay_connections_ = 0;
+    int failed_relay_connections_ = 0;
+    int streams_ = 0;
+
+    int64_t registration_start_time_ = 0;
+    int64_t registration_time_ = 0;
+    int64_t streaming_start_time_ = 0;
+    int64_t streaming_time_ = 0;
+    int64_t received_bytes_ = 0;
+
+    int64_t router_memory_before_ = 0;
+    int64_t router_memory_after_ = 0;
+    int64_t relay_memory_before_ = 0;
+    int64_t relay_memory_after_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(Harness);
+};
+
+RouterPeer::RouterPeer(Harness* harness, proto::RouterSession session_type)
+    : harness_(harness),
+      session_type_(session_type)
+{
+    // Nothing
+}
+
+void RouterPeer::connect()
+{
+    connect_start_time_ = now();
+
+    channel_ = std::make_unique<base::NetworkChannel>();
+    channel_->setListener(this);
+    channel_->connect(harness_->options().address, harness_->options().port);
+}
+
+void RouterPeer::send(const google::protobuf::MessageLite& message)
+{
+    if (channel_)
+        channel_->send(base::serialize(message));
+}
+
+void RouterPeer::onConnected()
+{
+    auth_start_time_ = now();
+    harness_->onTcpConnected(auth_start_time_ - connect_start_time_);
+
+    const Options& options = harness_->options();
+
+    channel_->setOwnKeepAlive(true, std::chrono::seconds(options.keep_alive));
+    channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(harness_->taskRunner());
+
+    if (session_type_ == proto::ROUTER_SESSION_HOST)
+    {
+        authenticator_->setIdentify(proto::IDENTIFY_ANONYMOUS);
+        authenticator_->setPeerPublicKey(options.public_key);
+    }
+    else
+    {
+        authenticator_->setIdentify(proto::IDENTIFY_SRP);
+        authenticator_->setUserName(options.username);
+        authenticator_->setPassword(options.password);
+    }
+
+    authenticator_->setSessionType(session_type_);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            harness_->onAuthenticated(session_type_, now() - auth_start_time_);
+
+            channel_ = authenticator_->takeChannel();
+            channel_->setListener(this);
+            channel_->resume();
+
+            onAuthenticated();
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication failed: "
+                            << base::ClientAuthenticator::errorToString(error_code);
+            onFailed();
+        }
+
+        // Authenticator is no longer needed.
+        harness_->taskRunner()->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void RouterPeer::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Connection to the router is lost ("
+                    << base::NetworkChannel::errorToString(error_code) << ")";
+    onFailed();
+}
+
+void RouterPeer::onMessageReceived(const base::ByteArray& buffer)
+{
+    proto::RouterToPeer message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Invalid message from router";
+        return;
+    }
+
+    onRouterMessage(message);
+}
+
+void RouterPeer::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+RelayStream::RelayStream(Harness* harness, bool is_sender)
+    : harness_(harness),
+      is_sender_(is_sender)
+{
+    // Nothing
+}
+
+void RelayStream::start(const proto::RelayCredentials& credentials)
+{
+    start_time_ = now();
+
+    relay_peer_ = std::make_unique<base::RelayPeer>();
+    relay_peer_->start(credentials, this);
+}
+
+void RelayStream::onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel)
+{
+    harness_->onRelayConnected(now() - start_time_);
+    harness_->taskRunner()->deleteSoon(std::move(relay_peer_));
+
+    channel_ = std::move(channel);
+    channel_->setListener(this);
+    channel_->setNoDelay(true);
+    channel_->resume();
+
+    // The relay forwards the data only when both peers are connected. The host starts streaming
+    // after the first message of the client.
+    if (!is_sender_)
+        channel_->send(base::ByteArray(1));
+}
+
+void RelayStream::onRelayConnectionError()
+{
+    harness_->onRelayFailed(is_sender_);
+    harness_->taskRunner()->deleteSoon(std::move(relay_peer_));
+}
+
+void RelayStream::onConnected()
+{
+    // Nothing
+}
+
+void RelayStream::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Relay connection is lost ("
+                    << base::NetworkChannel::errorToString(error_code) << ")";
+    harness_->taskRunner()->deleteSoon(std::move(channel_));
+}
+
+void RelayStream::onMessageReceived(const base::ByteArray& buffer)
+{
+    if (!is_sender_)
+    {
+        harness_->onBytesReceived(buffer.size());
+        return;
+    }
+
+    if (is_streaming_)
+        return;
+
+    is_streaming_ = true;
+    harness_->onStreamStarted();
+    sendMessages();
+}
+
+void RelayStream::onMessageWritten(size_t /* pending */)
+{
+    if (is_streaming_)
+        sendMessages();
+}
+
+void RelayStream::sendMessages()
+{
+    while (channel_ && channel_->pendingMessages() < kStreamWindow)
+        channel_->send(base::ByteArray(harness_->payload()), base::NetworkChannel::Priority::VIDEO);
+}
+
+void Host::onAuthenticated()
+{
+    request_time_ = now();
+
+    proto::PeerToRouter message;
+    message.mutable_host_id_request()->set_type(proto::HostIdRequest::NEW_ID);
+    send(message);
+}
+
+void Host::onRouterMessage(const proto::RouterToPeer& message)
+{
+    if (message.has_host_id_response())
+    {
+        if (host_id_ != base::kInvalidHostId)
+            return;
+
+        host_id_ = message.host_id_response().host_id();
+        if (host_id_ == base::kInvalidHostId)
+        {
+            onFailed();
+            return;
+        }
+
+        harness_->onHostRegistered(now() - request_time_);
+    }
+    else if (message.has_connection_offer())
+    {
+        const proto::ConnectionOffer& offer = message.connection_offer();
+
+        if (offer.error_code() != proto::ConnectionOffer::SUCCESS ||
+            offer.peer_role() != proto::ConnectionOffer::HOST || stream_)
+        {
+            LOG(LS_WARNING) << "Unexpected connection offer for host " << host_id_;
+            return;
+        }
+
+        stream_ = std::make_unique<RelayStream>(harness_, true);
+        stream_->start(offer.relay());
+    }
+}
+
+void Host::onFailed()
+{
+    // A registered host must keep its connection (and the keep alive) until the end.
+    if (host_id_ != base::kInvalidHostId)
+        harness_->onHostLost();
+    else
+        harness_->onPeerFailed(proto::ROUTER_SESSION_HOST);
+}
+
+void Client::onAuthenticated()
+{
+    request_time_ = now();
+
+    proto::PeerToRouter message;
+    message.mutable_connection_request()->set_host_id(host_id_);
+    send(message);
+}
+
+void Client::onRouterMessage(const proto::RouterToPeer& message)
+{
+    if (!message.has_connection_offer() || stream_)
+        return;
+
+    const proto::ConnectionOffer& offer = message.connection_offer();
+
+    if (offer.error_code() != proto::ConnectionOffer::SUCCESS ||
+        offer.peer_role() != proto::ConnectionOffer::CLIENT)
+    {
+        LOG(LS_WARNING) << "Connection offer is rejected (host: " << host_id_ << ", error: "
+                        << offer.error_code() << ")";
+        onFailed();
+        return;
+    }
+
+    harness_->onOfferReceived(now() - request_time_);
+
+    stream_ = std::make_unique<RelayStream>(harness_, false);
+    stream_->start(offer.relay());
+}
+
+void Client::onFailed()
+{
+    // The connection to the router is not needed after the offer.
+    if (!stream_)
+        harness_->onPeerFailed(proto::ROUTER_SESSION_CLIENT);
+}
+
+Harness::Harness(const Options& options, std::shared_ptr<base::TaskRunner> task_runner)
+    : options_(options),
+      task_runner_(std::move(task_runner)),
+      timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_),
+      payload_(static_cast<size_t>(options.message_size)),
+      connect_latency_(kMaxSamples),
+      host_auth_latency_(kMaxSamples),
+      client_auth_latency_(kMaxSamples),
+      host_id_latency_(kMaxSamples),
+      offer_latency_(kMaxSamples),
+      relay_latency_(kMaxSamples)
+{
+    // Nothing
+}
+
+void Harness::start()
+{
+    router_memory_before_ = residentMemory(options_.router_pid);
+    registration_start_time_ = now();
+
+    timer_.start(std::chrono::seconds(options_.timeout), [this]()
+    {
+        std::cout << "Registration timeout." << std::endl;
+        startPairing();
+    });
+
+    startNextHosts();
+}
+
+void Harness::onAuthenticated(proto::RouterSession session_type, int64_t latency)
+{
+    if (session_type == proto::ROUTER_SESSION_HOST)
+        host_auth_latency_.add(latency);
+    else
+        client_auth_latency_.add(latency);
+}
+
+void Harness::onHostRegistered(int64_t latency)
+{
+    host_id_latency_.add(latency);
+    ++registered_hosts_;
+    checkRegistration();
+}
+
+void Harness::onPeerFailed(proto::RouterSession session_type)
+{
+    if (session_type == proto::ROUTER_SESSION_HOST)
+    {
+        ++failed_hosts_;
+        checkRegistration();
+    }
+    else
+    {
+        ++failed_pairs_;
+        checkPairing();
+    }
+}
+
+void Harness::onRelayConnected(int64_t latency)
+{
+    relay_latency_.add(latency);
+    ++relay_connections_;
+}
+
+void Harness::onRelayFailed(bool is_sender)
+{
+    ++failed_relay_connections_;
+
+    // The pair is failed once, the relay connection of the host can be lost too.
+    if (!is_sender)
+    {
+        ++failed_pairs_;
+        checkPairing();
+    }
+}
+
+void Harness::onStreamStarted()
+{
+    ++streams_;
+    checkPairing();
+}
+
+void Harness::onBytesReceived(size_t bytes)
+{
+    if (phase_ == Phase::STREAMING)
+        received_bytes_ += static_cast<int64_t>(bytes);
+}
+
+void Harness::startNextHosts()
+{
+    if (phase_ != Phase::REGISTRATION)
+        return;
+
+    // The connections are started in batches of 10 ms.
+    const int batch = std::max(options_.rate / 100, 1);
+
+    for (int i = 0; i < batch && static_cast<int>(hosts_.size()) < options_.hosts; ++i)
+    {
+        hosts_.emplace_back(std::make_unique<Host>(this));
+        hosts_.back()->connect();
+    }
+
+    if (static_cast<int>(hosts_.size()) < options_.hosts)
+    {
+        task_runner_->postDelayedTask(
+            std::bind(&Harness::startNextHosts, this), std::chrono::milliseconds(10));
+    }
+}
+
+void Harness::startNextClients()
+{
+    if (phase_ != Phase::PAIRING)
+        return;
+
+    const int batch = std::max(options_.rate / 100, 1);
+
+    for (int i = 0; i < batch && static_cast<int>(clients_.size()) < pair_count_; ++i)
+    {
+        // The hosts without the ID are skipped.
+        while (next_host_ < hosts_.size() && hosts_[next_host_]->hostId() == base::kInvalidHostId)
+            ++next_host_;
+
+        if (next_host_ == hosts_.size())
+            return;
+
+        clients_.emplace_back(std::make_unique<Client>(this, hosts_[next_host_]->hostId()));
+        clients_.back()->connect();
+        ++next_host_;
+    }
+
+    if (static_cast<int>(clients_.size()) < pair_count_)
+    {
+        task_runner_->postDelayedTask(
+            std::bind(&Harness::startNextClients, this), std::chrono::milliseconds(10));
+    }
+}
+
+void Harness::checkRegistration()
+{
+    if (phase_ == Phase::REGISTRATION && registered_hosts_ + failed_hosts_ >= options_.hosts)
+        startPairing();
+}
+
+void Harness::checkPairing()
+{
+    if (phase_ == Phase::PAIRING && streams_ + failed_pairs_ >= pair_count_)
+        startStreaming();
+}
+
+void Harness::startPairing()
+{
+    if (phase_ != Phase::REGISTRATION)
+        return;
+
+    registration_time_ = now() - registration_start_time_;
+    router_memory_after_ = residentMemory(options_.router_pid);
+    relay_memory_before_ = residentMemory(options_.relay_pid);
+
+    phase_ = Phase::PAIRING;
+    pair_count_ = std::min(options_.pairs, registered_hosts_);
+
+    timer_.start(std::chrono::seconds(options_.timeout), [this]()
+    {
+        std::cout << "Pairing timeout." << std::endl;
+        startStreaming();
+    });
+
+    startNextClients();
+    checkPairing();
+}
+
+void Harness::startStreaming()
+{
+    if (phase_ != Phase::PAIRING)
+        return;
+
+    relay_memory_after_ = residentMemory(options_.relay_pid);
+
+    phase_ = Phase::STREAMING;
+    streaming_start_time_ = now();
+
+    timer_.start(std::chrono::seconds(options_.duration), std::bind(&Harness::finish, this));
+}
+
+void Harness::finish()
+{
+    streaming_time_ = now() - streaming_start_time_;
+    phase_ = Phase::FINISHED;
+
+    task_runner_->postQuit();
+}
+
+bool Harness::printResults() const
+{
+    const double registration_seconds = static_cast<double>(registration_time_) / 1000000.0;
+    const double streaming_seconds = static_cast<double>(streaming_time_) / 1000000.0;
+
+    const double accept_rate = registration_seconds > 0 ?
+        static_cast<double>(registered_hosts_) / registration_seconds : 0;
+    const double gbps = streaming_seconds > 0 ?
+        static_cast<double>(received_bytes_) * 8 / streaming_seconds / 1000000000.0 : 0;
+
+    std::cout << "Hosts: " << registered_hosts_ << " registered, " << failed_hosts_ << " failed, "
+              << lost_hosts_ << " lost" << std::endl
+              << base::stringPrintf("Accept rate: %.1f hosts/s", accept_rate) << std::endl
+              << "TCP connect: " << percentilesToString(connect_latency_) << std::endl
+              << "Host authentication: " << percentilesToString(host_auth_latency_) << std::endl
+              << "Host ID: " << percentilesToString(host_id_latency_) << std::endl
+              << std::endl
+              << "Pairs: " << clients_.size() << " started, " << failed_pairs_ << " failed"
+              << std::endl
+              << "Client authentication: " << percentilesToString(client_auth_latency_)
+              << std::endl
+              << "Connection offer: " << percentilesToString(offer_latency_) << std::endl
+              << "Relay connections: " << relay_connections_ << " established, "
+              << failed_relay_connections_ << " failed" << std::endl
+              << "Relay connect: " << percentilesToString(relay_latency_) << std::endl
+              << std::endl
+              << "Streams: " << streams_ << std::endl
+              << base::stringPrintf("Forwarding: %.3f Gbit/s (%.1f s)", gbps, streaming_seconds)
+              << std::endl;
+
+    if (router_memory_after_ && registered_hosts_)
+    {
+        std::cout << base::stringPrintf("Router memory: %.1f KB per host",
+            static_cast<double>(router_memory_after_ - router_memory_before_) /
+                registered_hosts_ / 1024) << std::endl;
+    }
+
+    if (relay_memory_after_ && streams_)
+    {
+        std::cout << base::stringPrintf("Relay memory: %.1f KB per session",
+            static_cast<double>(relay_memory_after_ - relay_memory_before_) / streams_ / 1024)
+                  << std::endl;
+    }
+
+    bool passed = true;
+
+    if (options_.min_accept_rate && accept_rate < options_.min_accept_rate)
+    {
+        std::cout << "FAILED: accept rate is below " << options_.min_accept_rate << std::endl;
+        passed = false;
+    }
+
+    if (options_.max_auth_p99)
+    {
+        const double auth_p99 = host_auth_latency_.isEmpty() ? 0 :
+            static_cast<double>(host_auth_latency_.percentile(99)) / 1000.0;
+
+        if (host_auth_latency_.isEmpty() || auth_p99 > options_.max_auth_p99)
+        {
+            std::cout << "FAILED: p99 of the authentication is above " << options_.max_auth_p99
+                      << " ms" << std::endl;
+            passed = false;
+        }
+    }
+
+    if (options_.min_mbps && gbps * 1000 < options_.min_mbps)
+    {
+        std::cout << "FAILED: forwarding is below " << options_.min_mbps << " Mbit/s"
+                  << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::LoggingSettings logging_settings;
+    logging_settings.min_log_level = base::LOG_LS_ERROR;
+    base::initLogging(logging_settings);
+
+    base::CommandLine command_line(argc, argv);
+    int result = 0;
+    Options options;
+
+    if (command_line.hasSwitch(u"help"))
+    {
+        showHelp();
+    }
+    else if (!parseOptions(command_line, &options))
+    {
+        showHelp();
+        result = 1;
+    }
+    else
+    {
+        std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+            std::make_unique<base::ScopedCryptoInitializer>();
+
+        std::unique_ptr<base::MessageLoop> message_loop =
+            std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+
+        std::unique_ptr<Harness> harness =
+            std::make_unique<Harness>(options, message_loop->taskRunner());
+
+        harness->start();
+        message_loop->run();
+
+        // The exit code is used by the regression gate.
+        if (!harness->printResults())
+            result = 1;
+
+        harness.reset();
+        message_loop.reset();
+        crypto_initializer.reset();
+    }
+
+    base::shutdownLogging();
+    return result;
+}